@@ -5,17 +5,33 @@
 #include "Atlas\GameObject.h"
 #include "ChunkSystems\ChunkManager.h"
 
+#include <algorithm>
+
 namespace Atlas
 {
 	/**
 	* Base for all updatable components that can
-	* be attached to gameobjects.
+	* be attached to gameobjects. Behaviors tick in a group of the frame,
+	* every frame unless given an interval or a distance scaled rate.
 	*/
 	class FBehavior : public IComponent
 	{
 		friend class FGameObject;
+		template <typename T>
+		friend class TBehaviorPool;
 	public:
-		FBehavior() : mGameObject{ nullptr }{}
+		FBehavior()
+			: mGameObject{ nullptr }
+			, mChunkManager{ nullptr }
+			, mLastTickTime{ -1.0 }
+			, mTickDeltaTime{ 0.0f }
+			, mTickDistance{ 0.0f }
+			, mPoolIndex{ 0 }
+			, mNextTickFrame{ UNSCHEDULED_TICK }
+			, mTickInterval{ 1 }
+			, mMaxTickInterval{ 1 }
+			, mTickGroup{ ETickGroup::PrePhysics }
+		{}
 		~FBehavior(){}
 
 		/**
@@ -26,10 +42,37 @@ namespace Atlas
 		virtual void OnStart(){};
 
 		/**
-		* Called once per frame.
+		* Called each time the behavior ticks, once per frame by default.
 		*/
 		virtual void Update(){};
 
+		/**
+		* Sets where in the frame Update is called, see ETickGroup.
+		*/
+		void SetTickGroup(const ETickGroup::Type Group) { mTickGroup = Group; }
+
+		/**
+		* Ticks every few frames instead of every frame. Behaviors of a type start at
+		* different frames of the interval, so their work is spread over it.
+		* @param Frames - Frames between ticks, 1 to tick every frame.
+		*/
+		void SetTickInterval(const uint32_t Frames);
+
+		/**
+		* Ticks less often the further the gameobject is from FCamera::Main. Ticks are
+		* every frame within FullRateDistance, then a frame further apart for each
+		* FullRateDistance past it, up to MaxInterval. The distance is taken as it ticks.
+		* @param FullRateDistance - World units, 0 to tick at the SetTickInterval rate instead.
+		* @param MaxInterval - The most frames between ticks.
+		*/
+		void SetTickDistance(const float FullRateDistance, const uint32_t MaxInterval);
+
+		/**
+		* Seconds since the behavior last ticked, to use in place of the frame's delta
+		* time by behaviors that don't tick every frame.
+		*/
+		float GetTickDeltaTime() const { return mTickDeltaTime; }
+
 		//virtual void OnCollisionEnter(){};
 		//virtual void OnCollisionExit(){};
 		
@@ -48,6 +91,32 @@ namespace Atlas
 		*/
 		void DestroyBlock(const Vector3i& Position);
 
+		/**
+		* Sets many blocks within the world at once, rebuilding each touched chunk once.
+		*/
+		void ApplyEdits(const FChunkManager::BlockEdit* Edits, const uint32_t EditCount);
+
+		/**
+		* Sets every block within an inclusive box in the world.
+		*/
+		void FillBox(const Vector3i& Min, const Vector3i& Max, const FBlockTypes::BlockID ID);
+
+		/**
+		* Sets every block within a radius of a world position.
+		*/
+		void FillSphere(const Vector3i& Center, const int32_t Radius, const FBlockTypes::BlockID ID);
+
+		/**
+		* Sets blocks of one type within an inclusive box in the world to another.
+		*/
+		void ReplaceInBox(const Vector3i& Min, const Vector3i& Max, const FBlockTypes::BlockID From, const FBlockTypes::BlockID To);
+
+		/**
+		* Finds the first solid block in the world along a ray.
+		* @return True if a block was hit within MaxDistance.
+		*/
+		bool Raycast(const FRay& Ray, const float MaxDistance, FChunkManager::RaycastHit& HitOut) const;
+
 		template <typename T, void(T::*Function)(Vector3i, FBlockTypes::BlockID)>
 		/**
 		* Adds a function to call when a block is set within the world. A single instance
@@ -76,6 +145,19 @@ namespace Atlas
 		*/
 		void RemoveOnBlockDestroyListener(T* Instance);
 
+		template <typename T, void(T::*Function)(const FChunkManager::BlockChange*, uint32_t)>
+		/**
+		* Adds a function to call with the blocks changed by ApplyEdits or a region
+		* operation. Remember to remove this listener before the object is destroyed.
+		*/
+		void AddOnBlocksEditedListener(T* Instance);
+
+		template <typename T>
+		/**
+		* Removes the listener from the OnBlocksEdited event.
+		*/
+		void RemoveOnBlocksEditedListener(T* Instance);
+
 		/**
 		* Loads a world.
 		* @param WorldName - The name of the world directory.
@@ -103,15 +185,72 @@ namespace Atlas
 		*/
 		FGameObject& CreateGameObject();
 
+	private:
+		// Next tick frame of behaviors that haven't been placed in their interval
+		static const uint32_t UNSCHEDULED_TICK = UINT32_MAX;
+
 	private:
 		void SetGameObject(FGameObject* GameObject){ mGameObject = GameObject; }
 		void SetChunkManager(FChunkManager* ChunkManager){ mChunkManager = ChunkManager; }
 
+		/**
+		* Checks if the behavior ticks in the group this frame, scheduling its next tick if it does.
+		*/
+		bool IsTickDue(const FTickContext& Context);
+
 	private:
 		FGameObject* mGameObject;
 		FChunkManager* mChunkManager;
+		double   mLastTickTime;    // FTickContext::Time of the last tick, negative before the first
+		float    mTickDeltaTime;
+		float    mTickDistance;    // Full rate distance, 0 if ticks aren't distance scaled
+		uint32_t mPoolIndex;       // Index in the pool of its type
+		uint32_t mNextTickFrame;   // First frame the behavior ticks again
+		uint32_t mTickInterval;
+		uint32_t mMaxTickInterval; // Of distance scaled ticks
+		ETickGroup::Type mTickGroup;
 	};
 
+	inline void FBehavior::SetTickInterval(const uint32_t Frames)
+	{
+		mTickInterval = std::max(Frames, 1u);
+		mNextTickFrame = UNSCHEDULED_TICK;
+	}
+
+	inline void FBehavior::SetTickDistance(const float FullRateDistance, const uint32_t MaxInterval)
+	{
+		mTickDistance = FullRateDistance;
+		mMaxTickInterval = std::max(MaxInterval, 1u);
+		mNextTickFrame = UNSCHEDULED_TICK;
+	}
+
+	inline bool FBehavior::IsTickDue(const FTickContext& Context)
+	{
+		if (Context.Group != mTickGroup)
+			return false;
+
+		if (mNextTickFrame == UNSCHEDULED_TICK)
+		{
+			const uint32_t Spread = (mTickDistance > 0.0f) ? mMaxTickInterval : mTickInterval;
+			mNextTickFrame = Context.Frame + mPoolIndex % Spread;
+		}
+
+		if (Context.Frame < mNextTickFrame)
+			return false;
+
+		uint32_t Interval = mTickInterval;
+		if (mTickDistance > 0.0f)
+		{
+			const float Distance = (mGameObject->Transform.GetWorldPosition() - Context.CameraPosition).Length();
+			Interval = std::min((uint32_t)std::min(Distance / mTickDistance, (float)mMaxTickInterval) + 1, mMaxTickInterval);
+		}
+		mNextTickFrame = Context.Frame + Interval;
+
+		mTickDeltaTime = (mLastTickTime < 0.0) ? Context.DeltaTime : (float)(Context.Time - mLastTickTime);
+		mLastTickTime = Context.Time;
+		return true;
+	}
+
 	// Inlines for all pass-through functions
 
 	inline void FBehavior::SetBlock(const Vector3i& Position, const FBlockTypes::BlockID ID)
@@ -129,6 +268,31 @@ namespace Atlas
 		mChunkManager->DestroyBlock(Position);
 	}
 
+	inline void FBehavior::ApplyEdits(const FChunkManager::BlockEdit* Edits, const uint32_t EditCount)
+	{
+		mChunkManager->ApplyEdits(Edits, EditCount);
+	}
+
+	inline void FBehavior::FillBox(const Vector3i& Min, const Vector3i& Max, const FBlockTypes::BlockID ID)
+	{
+		mChunkManager->FillBox(Min, Max, ID);
+	}
+
+	inline void FBehavior::FillSphere(const Vector3i& Center, const int32_t Radius, const FBlockTypes::BlockID ID)
+	{
+		mChunkManager->FillSphere(Center, Radius, ID);
+	}
+
+	inline void FBehavior::ReplaceInBox(const Vector3i& Min, const Vector3i& Max, const FBlockTypes::BlockID From, const FBlockTypes::BlockID To)
+	{
+		mChunkManager->ReplaceInBox(Min, Max, From, To);
+	}
+
+	inline bool FBehavior::Raycast(const FRay& Ray, const float MaxDistance, FChunkManager::RaycastHit& HitOut) const
+	{
+		return mChunkManager->Raycast(Ray, MaxDistance, HitOut);
+	}
+
 	template <typename T, void(T::*Function)(Vector3i, FBlockTypes::BlockID)>
 	inline void FBehavior::AddOnBlockSetListener(T* Instance)
 	{
@@ -154,6 +318,18 @@ namespace Atlas
 		mChunkManager->mOnBlockDestroy.RemoveListener(Instance);
 	}
 
+	template <typename T, void(T::*Function)(const FChunkManager::BlockChange*, uint32_t)>
+	inline void FBehavior::AddOnBlocksEditedListener(T* Instance)
+	{
+		mChunkManager->mOnBlocksEdited.AddListener<T, Function>(Instance);
+	}
+
+	template <typename T>
+	inline void FBehavior::RemoveOnBlocksEditedListener(T* Instance)
+	{
+		mChunkManager->mOnBlocksEdited.RemoveListener(Instance);
+	}
+
 	inline void FBehavior::LoadWorld(const wchar_t* WorldName)
 	{
 		mChunkManager->LoadWorld(WorldName);
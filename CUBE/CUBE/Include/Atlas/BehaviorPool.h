@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <new>
+
+#include "Containers\RawGappedArray.h"
+#include "Math\Vector3.h"
+
+namespace Atlas
+{
+	class FBehavior;
+
+	/**
+	* Where in the frame a behavior ticks, see FBehavior::SetTickGroup.
+	*/
+	namespace ETickGroup
+	{
+		enum Type : uint8_t
+		{
+			PostPhysics, // After the last physics step finished, reading its results
+			PrePhysics,  // Before the next step, changing what it simulates. The default.
+			Late,        // After the chunks update, before the step is submitted
+			Count
+		};
+	}
+
+	/**
+	* What the behaviors of a tick group are ticked with.
+	*/
+	struct FTickContext
+	{
+		Vector3f         CameraPosition; // Of FCamera::Main, for distance scaled rates
+		double           Time;           // Seconds of frames updated so far
+		float            DeltaTime;      // Of this frame
+		uint32_t         Frame;          // Frames updated so far
+		ETickGroup::Type Group;
+	};
+
+	/**
+	* Holds every behavior of one type, so a frame updates them one after
+	* another without looking them up through their gameobjects.
+	*/
+	class IBehaviorPool
+	{
+	public:
+		virtual ~IBehaviorPool(){}
+
+		/**
+		* Calls OnStart on every behavior in the pool.
+		*/
+		virtual void OnStart() = 0;
+
+		/**
+		* Calls Update on every behavior in the pool that is due to tick in the group.
+		* @return The number of behaviors that ticked.
+		*/
+		virtual uint32_t Update(const FTickContext& Context) = 0;
+
+		/**
+		* Destroys a behavior allocated by this pool.
+		*/
+		virtual void Free(FBehavior& Behavior) = 0;
+
+		/**
+		* The number of behaviors in the pool.
+		*/
+		virtual uint32_t Size() const = 0;
+	};
+
+	template <typename T>
+	/**
+	* A pool of one behavior type. Behaviors are updated through their own type,
+	* so the calls are not virtual.
+	* @tparam T - The behavior type, derived from FBehavior.
+	*/
+	class TBehaviorPool : public IBehaviorPool
+	{
+	public:
+		TBehaviorPool()
+			: mBehaviors()
+		{
+			mBehaviors.Init<T>(PAGE_SIZE);
+		}
+
+		~TBehaviorPool()
+		{
+			for (auto Itr = mBehaviors.Begin<T>(); Itr != mBehaviors.End<T>(); Itr++)
+				Itr->~T();
+		}
+
+		/**
+		* Constructs a new behavior. It stays at the same address until freed.
+		*/
+		T& Allocate()
+		{
+			const uint32_t Index = mBehaviors.Allocate();
+			T* Behavior = new (mBehaviors[Index]) T;
+			Behavior->mPoolIndex = Index;
+			return *Behavior;
+		}
+
+		void OnStart() override
+		{
+			for (auto Itr = mBehaviors.Begin<T>(); Itr != mBehaviors.End<T>(); Itr++)
+				Itr->OnStart();
+		}
+
+		uint32_t Update(const FTickContext& Context) override
+		{
+			// Behaviors added while updating may be updated from the next frame on
+			uint32_t TickCount = 0;
+			for (auto Itr = mBehaviors.Begin<T>(); Itr != mBehaviors.End<T>(); Itr++)
+			{
+				if (Itr->IsTickDue(Context))
+				{
+					Itr->T::Update();
+					TickCount++;
+				}
+			}
+
+			return TickCount;
+		}
+
+		void Free(FBehavior& Behavior) override
+		{
+			T& Typed = static_cast<T&>(Behavior);
+			const uint32_t Index = Typed.mPoolIndex;
+			Typed.~T();
+			mBehaviors.Free(Index);
+		}
+
+		uint32_t Size() const override { return mBehaviors.Size(); }
+
+	private:
+		static const uint32_t PAGE_SIZE = 64;
+
+	private:
+		FTypelessPageArray mBehaviors;
+	};
+}
@@ -36,8 +36,7 @@ namespace Atlas
 		FComponentHandle(const EComponent::Type Type);	// Only to be created by the manager
 
 	private:
-		// Next available component bit mask
-		static std::bitset<BITSIZE> NextBit;
+		static_assert(EComponent::Count <= BITSIZE, "Every component type needs a bit in the component bit mask.");
 
 		EComponent::Type mID;
 		std::bitset<BITSIZE> mBit;
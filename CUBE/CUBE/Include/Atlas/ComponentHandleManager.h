@@ -1,7 +1,6 @@
 #pragma once
 #include "Bitsize.h"
 
-#include <unordered_map>
 #include <cstdint>
 
 //#include "Component.h"
@@ -11,8 +10,8 @@ namespace Atlas
 {
 
 	/**
-	* Used to assign a unique ID and Bit to a System when
-	* added to the SystemManager.
+	* Used to assign a unique ID and Bit to each property component type.
+	* Each type's bit follows from its place in EComponent::Type, so no lookup is needed.
 	*/
 	class SComponentHandleManager
 	{
@@ -20,23 +19,23 @@ namespace Atlas
 
 		/**
 		* Retrieves an handle for a property component type.
-		* If an handle has not been assigned to the component type, one is created and assigned.
 		*
-		* @param index - type_index for the property component type
+		* @param Type - The property component type
 		*/
-		static const FComponentHandle& GetHandle(const EComponent::Type Type);
+		static FComponentHandle GetHandle(const EComponent::Type Type)
+		{
+			return FComponentHandle{ Type };
+		}
 
 		/**
 		* Retrieves the bit mask assigned to a property component type.
 		*/
 		static std::bitset<BITSIZE> GetBitMask(const EComponent::Type Type)
 		{
-			return GetHandle(Type).GetBitMask();
+			return std::bitset<BITSIZE>(1u << Type);
 		}
 
 	private:
 		SComponentHandleManager() = delete;	// Not meant for instantiation
-
-		static std::unordered_map<EComponent::Type, FComponentHandle> ComponentMap;	// Map of Components-to-ComponentHandles
 	};
 }
\ No newline at end of file
@@ -52,6 +52,11 @@ namespace Atlas
 		*/
 		void RemoveComponent(const EComponent::Type Type);
 
+		/**
+		* Checks if the FGameObject has a specified component.
+		*/
+		bool HasComponent(const EComponent::Type Type) const;
+
 		template <typename Type>
 		/**
 		* Retrieve a behavior component.
@@ -129,18 +134,6 @@ namespace Atlas
 
 		FGameObject(FGameObjectManager& GOManager, FChunkManager& ChunkManager);	// Only the GameObject Manager creates Entities
 
-		/**
-		* Calls OnStart on all behavior components.
-		* Should be called at the start of the game.
-		*/
-		void OnStart();
-
-		/**
-		* Updates all behavior components for
-		* this object.
-		*/
-		void Update();
-
 		/**
 		* Sets the ID for the GameObject.
 		* This is not a GUID, it is just an index in the GameObject Managers' container.
@@ -193,9 +186,10 @@ namespace Atlas
 		FChunkManager&                    mChunkManager;
 
 		uint32_t						  mComponents[EComponent::Count]; // Handles for common property components.
-		std::map<std::type_index, FBehavior*>   mBehaviors;
+		std::map<std::type_index, FBehavior*>   mBehaviors;     // Owned by the manager's behavior pools
 		ID		                          mID;            // Non-unique id for this GO.
 		bool                              mIsActive;      // If not active, this GO's components will not be processed.
+		bool                              mIsInterestQueued; // Has components systems have yet to check.
 	};
 }
 
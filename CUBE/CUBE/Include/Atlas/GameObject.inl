@@ -23,11 +23,26 @@ namespace Atlas
 		ComponentType* Component = reinterpret_cast<ComponentType*>(AllocateComponentForObject(Type, GameObject));
 		new (Component) ComponentType();
 
-		UpdateComponentSystems(GameObject, *reinterpret_cast<IComponent*>(Component));
+		QueueInterestCheck(GameObject);
 
 		return *Component;
 	}
 
+	template <EComponent::Type Type>
+	inline void FGameObjectManager::DeferAddComponent(FGameObject& GameObject, std::function<void(typename ComponentTraits::Object<Type>::Type&)> Setup)
+	{
+		FGameObject* Object = &GameObject;
+		DeferChange([this, Object, Setup]()
+		{
+			if (Object->mComponents[Type] != FGameObject::NULL_COMPONENT)
+				return;
+
+			auto& Component = AddComponent<Type>(*Object);
+			if (Setup)
+				Setup(Component);
+		});
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	//////////////// RigidBody and Collider specializations ////////////////////////////////////////////////////////////////////////
 	template <>
@@ -40,7 +55,7 @@ namespace Atlas
 		ComponentType* Component = reinterpret_cast<ComponentType*>(AllocateComponentForObject(Type, GameObject));
 		new (Component) ComponentType(static_cast<btMotionState*>(&GameObject));
 
-		UpdateComponentSystems(GameObject, *reinterpret_cast<IComponent*>(Component));
+		QueueInterestCheck(GameObject);
 
 		return *Component;
 	}
@@ -55,7 +70,7 @@ namespace Atlas
 		ComponentType* Component = reinterpret_cast<ComponentType*>(AllocateComponentForObject(Type, GameObject));
 		new (Component)ComponentType(static_cast<btMotionState*>(&GameObject));
 
-		UpdateComponentSystems(GameObject, *reinterpret_cast<IComponent*>(Component));
+		QueueInterestCheck(GameObject);
 
 		return *Component;
 	}
@@ -99,6 +114,24 @@ namespace Atlas
 		mGOManager.RemoveComponent(*this, Type);
 	}
 
+	inline bool FGameObject::HasComponent(const EComponent::Type Type) const
+	{
+		return mComponentBits[Type];
+	}
+
+	template <typename T>
+	inline T& FGameObjectManager::AllocateBehavior()
+	{
+		auto& Pool = mBehaviorPools[typeid(T)];
+		if (!Pool)
+		{
+			Pool.reset(new TBehaviorPool<T>);
+			mBehaviorPoolOrder.push_back(Pool.get());
+		}
+
+		return static_cast<TBehaviorPool<T>*>(Pool.get())->Allocate();
+	}
+
 	template <typename Type>
 	inline Type* FGameObject::GetBehavior()
 	{
@@ -106,7 +139,7 @@ namespace Atlas
 
 		try
 		{
-			Component = mBehaviors.at(typeid(Type)).get();
+			Component = static_cast<Type*>(mBehaviors.at(typeid(Type)));
 		}
 		catch (const std::out_of_range& e)
 		{
@@ -119,7 +152,8 @@ namespace Atlas
 	template <typename Type>
 	inline Type* FGameObject::AddBehavior()
 	{
-		Type* ComponentPtr = new Type;
+		ASSERT(mBehaviors.find(typeid(Type)) == mBehaviors.end() && "Trying to add duplicate behavior to gameobject.");
+		Type* ComponentPtr = &mGOManager.AllocateBehavior<Type>();
 
 		ComponentPtr->SetGameObject(this);
 		ComponentPtr->SetChunkManager(&mChunkManager);
@@ -131,8 +165,12 @@ namespace Atlas
 	template <typename Type>
 	inline void FGameObject::RemoveBehavior()
 	{
-		delete mBehaviors[typeid(Type)];
-		mBehaviors.erase(typeid(Type));
+		auto Behavior = mBehaviors.find(typeid(Type));
+		if (Behavior == mBehaviors.end())
+			return;
+
+		mGOManager.FreeBehavior(Behavior->first, *Behavior->second);
+		mBehaviors.erase(Behavior);
 	}
 
 	inline std::vector<IComponent*> FGameObject::GetAllComponents()
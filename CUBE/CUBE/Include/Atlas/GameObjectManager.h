@@ -1,7 +1,14 @@
 #pragma once
 #include <queue>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
 
 #include "ComponentTypes.h"
+#include "BehaviorPool.h"
 #include "Containers\RawGappedArray.h"
 
 class FChunkManager;
@@ -10,6 +17,7 @@ namespace Atlas
 {
 	class FGameObject;
 	class IComponent;
+	class FBehavior;
 	class FWorld;
 	class FSystemManager;
 
@@ -36,10 +44,18 @@ namespace Atlas
 		void Start();
 
 		/**
-		* Updates the GameObject manager.
+		* Updates the GameObject manager, then ticks the post and pre physics behaviors
+		* a type at a time, then the world matrices of every gameobject for systems to
+		* read. Called between physics steps.
 		*/
 		void Update();
 
+		/**
+		* Ticks the late behaviors, then rebuilds the world matrices of every gameobject
+		* again if any ticked. Called after the chunks update, before the next physics step.
+		*/
+		void LateUpdate();
+
 		/**
 		* Creates an empty GameObject
 		* @returns Reference to the new GameObject
@@ -64,7 +80,8 @@ namespace Atlas
 
 		template <EComponent::Type Type>
 		/**
-		* Attaches a system component to a GameObject.
+		* Attaches a system component to a GameObject. Systems take the GameObject once the
+		* manager next updates, so components added together cost one check of every system.
 		* @tparam Type - The type of component to add.
 		* @param GameObject - The GameObject to add the component to.
 		* @return A reference to the added component
@@ -79,6 +96,39 @@ namespace Atlas
 		*/
 		void RemoveComponent(FGameObject& GameObject, EComponent::Type Type);
 
+		template <typename T>
+		/**
+		* Constructs a behavior in the pool of its type.
+		* @tparam T - The behavior type.
+		* @return A reference to the new behavior.
+		*/
+		T& AllocateBehavior();
+
+		/**
+		* Destroys a behavior allocated with AllocateBehavior.
+		* @param Type - The type the behavior was allocated as.
+		* @param Behavior - The behavior to destroy.
+		*/
+		void FreeBehavior(const std::type_index& Type, FBehavior& Behavior);
+
+		template <EComponent::Type Type>
+		/**
+		* Queues a system component to be attached to a GameObject when the manager next updates,
+		* if it doesn't have one by then. Unlike AddComponent, this may be called from parallel loops.
+		* @tparam Type - The type of component to add.
+		* @param GameObject - The GameObject to add the component to.
+		* @param Setup - Called with the added component, may be empty.
+		*/
+		void DeferAddComponent(FGameObject& GameObject, std::function<void(typename ComponentTraits::Object<Type>::Type&)> Setup);
+
+		/**
+		* Queues a system component to be removed from a GameObject when the manager next
+		* updates. Unlike RemoveComponent, this may be called from parallel loops.
+		* @param GameObject - The GameObject to remove the component from.
+		* @param Type - The type of component to remove.
+		*/
+		void DeferRemoveComponent(FGameObject& GameObject, EComponent::Type Type);
+
 		template <EComponent::Type Type>
 		/**
 		* Retrieve a component type by it's index handle into the
@@ -120,13 +170,27 @@ namespace Atlas
 		uint32_t GetGameObjectCount() const { return mGameObjects.Size(); }
 
 		/**
-		* Sets a gameobject to be destroyed.
+		* Sets a gameobject to be destroyed when the manager next updates.
+		* May be called from parallel loops.
 		* @param GameObject - The targeted GameObject
 		*/
 		void DestroyGameObject(FGameObject& GameObject);
 
 		void SetChunkManager(FChunkManager* ChunkManager) { mChunkManager = ChunkManager; }
 
+		/**
+		* System timer cycles spent in each part of the last Update.
+		*/
+		struct UpdateTimings
+		{
+			uint64_t InterestCycles;  // Systems checking gameobjects with added components
+			uint64_t DestroyCycles;   // Detaching and destroying gameobjects and components
+			uint64_t BehaviorCycles;  // Updating behaviors
+			uint64_t TransformCycles; // Rebuilding world matrices
+		};
+
+		const UpdateTimings& GetLastUpdateTimings() const { return mLastUpdateTimings; }
+
 	private:
 		/**
 		* Resets a GameObject and moves it from the active GameObject container to the dead GameObject pool
@@ -134,12 +198,49 @@ namespace Atlas
 		*/
 		void DestroyGameObjectHelp(FGameObject& GameObject);
 
+		/**
+		* Detaches a component and notifies systems, leaving it to be destroyed by
+		* DestroyRemovedComponents.
+		*/
+		void DetachComponent(FGameObject& GameObject, const EComponent::Type Type);
+
+		/**
+		* Ends the batch of removals with the systems, then destroys and frees every detached component.
+		*/
+		void DestroyRemovedComponents();
+
 		void* AllocateComponentForObject(const EComponent::Type Type, FGameObject& GameObject);
 
-		void UpdateComponentSystems(FGameObject& GameObject, IComponent& UpdatedComponent);
+		/**
+		* Queues a GameObject that had a component added to be checked by the systems.
+		*/
+		void QueueInterestCheck(FGameObject& GameObject);
+
+		/**
+		* Lets the systems check every queued GameObject against its final components.
+		*/
+		void CheckQueuedInterest();
+
+		/**
+		* Queues a change to the components of gameobjects for the next update.
+		*/
+		void DeferChange(std::function<void()> Change);
+
+		/**
+		* Rebuilds the cached world matrix of every gameobject that changed, parents before
+		* their children, so systems reading them later only read.
+		*/
+		void UpdateTransforms();
+
+		/**
+		* Ticks the behaviors of a group that are due this frame.
+		* @return True if any behavior ticked.
+		*/
+		bool TickBehaviors(const ETickGroup::Type Group);
 
 	private:
 		static const uint32_t DEFAULT_CONTAINER_SIZE = 300;
+		static const uint32_t DEFAULT_TRANSFORM_GRAIN_SIZE = 256;
 
 	private:
 		// The world this manager represents
@@ -153,8 +254,39 @@ namespace Atlas
 		// Holds all system based components.
 		FTypelessPageArray mSystemComponents[EComponent::Type::Count];
 
+		// A pool for each behavior type, and the pools in the order they are updated
+		std::unordered_map<std::type_index, std::unique_ptr<IBehaviorPool>> mBehaviorPools;
+		std::vector<IBehaviorPool*> mBehaviorPoolOrder;
+
 		// List of gameobjects set to be destroyed
 		std::queue<FGameObject*> mDestroyQueue;
+
+		// Components detached from their gameobjects, destroyed once systems are done with them
+		struct RemovedComponent
+		{
+			EComponent::Type Type;
+			uint32_t         Index;
+		};
+		std::vector<RemovedComponent> mRemovedComponents;
+
+		// Gameobjects with components added since the systems last checked them
+		std::vector<FGameObject*> mInterestQueue;
+
+		// Component changes queued from loops that can't make them, applied before destroying
+		std::vector<std::function<void()>> mDeferredChanges;
+
+		// Guards the queues, which may be filled from several threads
+		std::mutex mQueueMutex;
+
+		// Gameobject IDs keyed by the depth of their transform, with room to sort them
+		std::vector<uint64_t> mTransformOrder;
+		std::vector<uint64_t> mTransformScratch;
+
+		UpdateTimings mLastUpdateTimings;
+
+		// Frames and seconds updated so far, which behaviors are ticked on
+		uint32_t mTickFrame;
+		double   mTickTime;
 	};
 }
 
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "Math\Vector3.h"
+#include "Math\Box.h"
+#include "Math\Frustum.h"
+
+namespace Atlas
+{
+	class FGameObject;
+
+	/**
+	* A loose spatial hash of game objects, each a sphere around its transform's
+	* world position. Objects are kept in the cell holding their center, and
+	* queries grow the cells they visit by the largest radius in the index. Moved
+	* objects are found by their transform revision, so only they are rehashed.
+	* Queries visit the cells overlapping their bounds, or every occupied cell if
+	* there are fewer, and test the objects in each.
+	*/
+	class FSpatialIndex
+	{
+	public:
+		using RadiusFunc = std::function<float(FGameObject& Object)>;
+
+	public:
+		/**
+		* Creates an empty index.
+		* @param CellSize - The width of a cell, such as FChunk::CHUNK_SIZE to hash by chunk.
+		*/
+		explicit FSpatialIndex(const float CellSize);
+
+		FSpatialIndex(const FSpatialIndex& Other) = delete;
+		FSpatialIndex& operator=(const FSpatialIndex& Other) = delete;
+
+		/**
+		* Adds an object to the index at its current position.
+		* @param Radius - The distance from the object's position that queries find it within.
+		*/
+		void Add(FGameObject& Object, const float Radius);
+
+		void Remove(FGameObject& Object);
+
+		/**
+		* Changes the radius an object is found within.
+		*/
+		void SetRadius(FGameObject& Object, const float Radius);
+
+		/**
+		* Rehashes the objects whose transforms changed since the last update.
+		* Positions are read from the transforms, so none may be written meanwhile.
+		* @param GetRadius - Reads the radius of each object, for radii that change
+		*                    without the index being told. Null to keep the radii set.
+		*/
+		void Update(const RadiusFunc& GetRadius = RadiusFunc{});
+
+		/**
+		* Finds the objects whose sphere intersects a sphere.
+		* @param ObjectsOut - The objects found are appended to this.
+		*/
+		void QueryRadius(const Vector3f& Center, const float Radius, std::vector<FGameObject*>& ObjectsOut) const;
+
+		/**
+		* Finds the objects whose sphere intersects an axis aligned box.
+		* @param ObjectsOut - The objects found are appended to this.
+		*/
+		void QueryBox(const FBox& Box, std::vector<FGameObject*>& ObjectsOut) const;
+
+		/**
+		* Finds the objects whose sphere is at least partly within a frustum.
+		* @param Frustum - A frustum in world space.
+		* @param ObjectsOut - The objects found are appended to this.
+		*/
+		void QueryFrustum(const FFrustum& Frustum, std::vector<FGameObject*>& ObjectsOut) const;
+
+		uint32_t GetObjectCount() const { return mEntries.size(); }
+
+	private:
+		struct Entry
+		{
+			FGameObject* Object;
+			Vector3f     Position;
+			float        Radius;
+			Vector3i     Cell;
+			uint32_t     CellSlot; // Index within its cell's entries
+			uint32_t     Revision; // Of the transform when last hashed
+		};
+
+		// Hash functor for the cell table
+		struct Vector3iHash
+		{
+			std::size_t operator()(const Vector3i& Val) const
+			{
+				return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+			}
+		};
+
+		Vector3i GetCell(const Vector3f& Position) const;
+
+		void InsertIntoCell(const uint32_t EntryIndex);
+
+		void RemoveFromCell(const uint32_t EntryIndex);
+
+		/**
+		* Calls Func with the entries of every cell that overlaps a box grown by the largest radius.
+		*/
+		template <typename FuncType>
+		void ForEachCell(const FBox& Bounds, FuncType Func) const;
+
+	private:
+		std::vector<Entry>                                                mEntries;
+		std::unordered_map<const FGameObject*, uint32_t>                  mEntryIndices; // Index into mEntries of each object
+		std::unordered_map<Vector3i, std::vector<uint32_t>, Vector3iHash> mCells;        // Entries whose center is in each cell
+		float                                                             mCellSize;
+		float                                                             mMaxRadius;    // At least the largest radius of any entry
+		bool                                                              mIsMaxRadiusStale;
+	};
+}
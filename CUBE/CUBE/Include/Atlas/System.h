@@ -1,7 +1,9 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <bitset>
+#include <functional>
 
 #include "Bitsize.h"
 #include "GameObject.h"
@@ -22,6 +24,8 @@ namespace Atlas
 	* evaluate to nothing since the gameobject list will not be used.
 	* If a system processes 2 or more components from gameobjects, the gameobject
 	* list can be used to retrieve a list of gameobjects with the required components.
+	* Alongside the list, the system keeps a packed array of each type's components,
+	* in the same order, so loops read them without going through the gameobject.
 	*/
 	class ISystem : public NonCopyable
 	{
@@ -47,12 +51,28 @@ namespace Atlas
 		*/
 		virtual void CheckInterest(FGameObject& GameObject, IComponent& UpdateComponent);
 
+		/**
+		* Checks to see if the System is interested in a GameObject that has had components
+		* added since its last check. Systems that take the GameObject are given the component
+		* of the first type they process. Removed components are checked as they are removed.
+		* @param GameObject - The GameObject to be checked
+		*/
+		void CheckAddedInterest(FGameObject& GameObject);
+
 		/**
 		* Retrieves the system type bits that are assigned to this system.
 		* @return Bitset assigned to this system
 		*/
 		std::bitset<BITSIZE> GetSystemBitMask() const;
 
+		/**
+		* Checks if work for this system may not run at the same time as work for another,
+		* because one writes a component type the other reads or writes. A system always
+		* conflicts with itself.
+		* @param Other - The other system.
+		*/
+		bool ConflictsWith(const ISystem& Other) const;
+
 	protected:
 		/**
 		* Get the world object this system is a part of.
@@ -61,10 +81,24 @@ namespace Atlas
 
 		template <EComponent::Type Type>
 		/**
-		* Adds a component type for the system to process.
+		* Adds a component type for the system to process. The system is taken to
+		* read components of the type.
 		*/
 		void AddComponentType();
 
+		template <EComponent::Type Type>
+		/**
+		* Declares that the system reads components of a type, without processing
+		* game objects for it.
+		*/
+		void AddReadType();
+
+		template <EComponent::Type Type>
+		/**
+		* Declares that the system writes components of a type.
+		*/
+		void AddWriteType();
+
 		/**
 		* Retrieves the component bit mask that the system will process.
 		* @return Bitset of component types
@@ -77,6 +111,24 @@ namespace Atlas
 		*/
 		const std::vector<FGameObject*>& GetGameObjects() const;
 
+		template <EComponent::Type Type>
+		/**
+		* Retrieves a component of an interested GameObject from the system's packed arrays.
+		* @tparam Type - A component type added with AddComponentType.
+		* @param Index - The index of the GameObject in GetGameObjects.
+		* @return A reference to the component.
+		*/
+		typename ComponentTraits::Object<Type>::Type& GetComponentAt(const uint32_t Index) const;
+
+		/**
+		* Calls a function for every interested GameObject, split between the scheduler's
+		* workers in ranges of GameObjects. Components can't be added or removed directly
+		* within the loop, use the gameobject manager's deferred changes instead.
+		* @param Func - Called with each GameObject and its index in GetGameObjects.
+		* @param GrainSize - The number of GameObjects a thread takes at a time.
+		*/
+		void ParallelForEach(const std::function<void(FGameObject& GameObject, const uint32_t Index)>& Func, const uint32_t GrainSize = DEFAULT_GRAIN_SIZE);
+
 		const std::vector<std::unique_ptr<ISystem>>& GetSubSystems();
 
 		template <typename T>
@@ -125,17 +177,50 @@ namespace Atlas
 		*/
 		virtual void OnGameObjectRemove(FGameObject& GameObject, IComponent& UpdateComponent);
 
+		/**
+		* This function is called once a batch of components was removed, before any of
+		* them are destroyed. Work queued for removed components in OnGameObjectRemove
+		* must be finished here.
+		*/
+		virtual void OnRemoveBatchEnd(){}
+
+		/**
+		* Ends a batch of removals for this system and its sub-systems.
+		*/
+		void EndRemoveBatch();
+
 		/**
 		* Assigns the system type bit for the System
 		* @params Bit - The bit to be assigned
 		*/
 		void SetSystemBitMask(const std::bitset<BITSIZE>& Bit);
 
+		/**
+		* Appends an interested GameObject and its components to the packed arrays.
+		*/
+		void AddPackedObject(FGameObject& GameObject);
+
+		/**
+		* Removes a GameObject from the packed arrays by moving the last one into its place.
+		*/
+		void RemovePackedObject(FGameObject& GameObject);
+
+	protected:
+		static const uint32_t DEFAULT_GRAIN_SIZE = 64;
+
+	private:
+		static const uint32_t NULL_INDEX = UINT32_MAX;
+
 	private:
 		FWorld&                                 mWorld;
 		std::bitset<BITSIZE>                    mTypeBitMask;
 		std::bitset<BITSIZE>                    mSystemBitMask;
+		std::bitset<BITSIZE>                    mReadBitMask;
+		std::bitset<BITSIZE>                    mWriteBitMask;
 		std::vector<FGameObject*>               mGameObjectIDs;
+		std::vector<EComponent::Type>           mComponentTypes;                   // Types added with AddComponentType
+		std::vector<void*>                      mComponents[EComponent::Count];    // Per type, the component of each object in mGameObjectIDs
+		std::vector<uint32_t>                   mObjectIndices;                    // Index into mGameObjectIDs by GameObject ID
 		std::vector<std::unique_ptr<ISystem>>   mSubSystems;
 	};
 
@@ -143,6 +228,29 @@ namespace Atlas
 	inline void ISystem::AddComponentType()
 	{
 		mTypeBitMask |= SComponentHandleManager::GetBitMask(Type);
+		mReadBitMask |= SComponentHandleManager::GetBitMask(Type);
+		mComponentTypes.push_back(Type);
+	}
+
+	template <EComponent::Type Type>
+	inline void ISystem::AddReadType()
+	{
+		mReadBitMask |= SComponentHandleManager::GetBitMask(Type);
+	}
+
+	template <EComponent::Type Type>
+	inline void ISystem::AddWriteType()
+	{
+		mWriteBitMask |= SComponentHandleManager::GetBitMask(Type);
+	}
+
+	template <EComponent::Type Type>
+	inline typename ComponentTraits::Object<Type>::Type& ISystem::GetComponentAt(const uint32_t Index) const
+	{
+		using ComponentType = typename ComponentTraits::Object<Type>::Type;
+
+		ASSERT(Index < mComponents[Type].size() && "Component type not processed by this system.");
+		return *static_cast<ComponentType*>(mComponents[Type][Index]);
 	}
 
 	inline std::bitset<BITSIZE> ISystem::GetSystemBitMask() const
@@ -150,6 +258,11 @@ namespace Atlas
 		return mSystemBitMask;
 	}
 
+	inline bool ISystem::ConflictsWith(const ISystem& Other) const
+	{
+		return this == &Other || (mWriteBitMask & (Other.mReadBitMask | Other.mWriteBitMask)).any() || (Other.mWriteBitMask & mReadBitMask).any();
+	}
+
 	inline std::bitset<BITSIZE> ISystem::GetTypeBitMask() const
 	{
 		return mTypeBitMask;
@@ -1,23 +1,27 @@
 #pragma once
 #include "Bitsize.h"
 
-#include <unordered_map>
-#include <typeindex>
+#include <cstdint>
 
 namespace Atlas
 {
 	/**
-	* Used to distribute a unique bit identifier to each System created.
+	* Used to distribute a unique ID and bit identifier to each System type created.
+	* IDs are held per type, so finding them is a load rather than a lookup.
 	*/
 	class SSystemBitManager
 	{
 	public:
+		template <typename T>
 		/**
-		* Retrieves the bitmask for a System
-		* @param type - the System of interest
-		* @return A bitset containing the System bit
+		* Retrieves the ID for a System type, counting up from 0.
+		* @tparam T - the System of interest
+		* @return The ID of the System type
 		*/
-		static std::bitset<BITSIZE> GetBitMaskFor(const std::type_index& type);
+		static uint32_t GetTypeID()
+		{
+			return TypeID<T>::Value;
+		}
 
 		template <typename T>
 		/**
@@ -27,14 +31,28 @@ namespace Atlas
 		*/
 		static std::bitset<BITSIZE> GetBitMaskFor(const T* type)
 		{
-			return GetBitMaskFor(typeid(*type));
+			type; // Suppress compiler warning
+			return std::bitset<BITSIZE>().set(GetTypeID<T>());
 		}
 
-
 	private:
 		SSystemBitManager() = delete; 		//Not meant for instantiation
 
-		static std::bitset<BITSIZE>                                         mNextBit;
-		static std::unordered_map<std::type_index, std::bitset<BITSIZE>>    mSystemBitMap;
+		template <typename T>
+		struct TypeID
+		{
+			static const uint32_t Value;
+		};
+
+		/**
+		* Assigns the next System type ID.
+		*/
+		static uint32_t NextTypeID();
+
+		static uint32_t mNextTypeID;
 	};
-}
\ No newline at end of file
+
+	// Each System type takes the next ID during static initialization
+	template <typename T>
+	const uint32_t SSystemBitManager::TypeID<T>::Value = SSystemBitManager::NextTypeID();
+}
@@ -3,6 +3,7 @@
 #include "SystemBitManager.h"
 #include "NonCopyable.h"
 #include "System.h"
+#include "SystemScheduler.h"
 
 #include <vector>
 #include <memory>
@@ -27,10 +28,16 @@ namespace Atlas
 		~FSystemManager();
 
 		/**
-		* Initalizes all systems.
+		* Initalizes all systems and starts the scheduler's workers.
 		*/
 		void Start();
 
+		/**
+		* The scheduler systems run their work through, so work for systems
+		* that don't conflict runs at the same time.
+		*/
+		FSystemScheduler& GetScheduler() { return mScheduler; }
+
 		template <typename T>
 		/**
 		* Adds a new System.
@@ -60,8 +67,8 @@ namespace Atlas
 
 		template <typename T>
 		/**
-		* Retrieves a type of system.
-		* @return A pointer to the System.
+		* Retrieves a type of system by its type ID, without a search.
+		* @return A pointer to the System, or null if there is none of that type.
 		*/
 		T* GetSystem();
 
@@ -82,6 +89,19 @@ namespace Atlas
 		*/
 		void CheckInterest(FGameObject& GameObject, IComponent& UpdatedComponent);
 
+		/**
+		* Checks to see if any Systems are interested in a GameObject once it has had
+		* all of a batch of components added.
+		* @param GameObject - The GameObject to be checked
+		*/
+		void CheckAddedInterest(FGameObject& GameObject);
+
+		/**
+		* Lets every system finish the work it queued for removed components,
+		* before those components are destroyed.
+		*/
+		void EndRemoveBatch();
+
 		template <typename T>
 		/**
 		* Retrieves a type of system.
@@ -95,69 +115,79 @@ namespace Atlas
 		*/
 		void RemoveSystem(const uint32_t Index);
 
+	private:
+		template <typename T>
+		/**
+		* Assigns a new System its bit and takes ownership of it.
+		*/
+		T& AddSystemHelp(T* RawSystem);
+
+		/**
+		* Forgets the type ID slot of a System that is being removed.
+		*/
+		void ClearSystemType(const ISystem* System);
+
 	private:
 		FWorld& mWorld;
 		std::vector<std::unique_ptr<ISystem>> mSystems;
+		std::vector<ISystem*> mSystemsByType; // Indexed by System type ID
+		FSystemScheduler mScheduler;
 	};
 
 	template <typename T>
 	inline T& FSystemManager::AddSystem()
 	{
-		T* RawSystem = new T(mWorld);
-		std::unique_ptr<ISystem> System{ RawSystem };
-
-		RawSystem->SetSystemBitMask(SSystemBitManager::GetBitMaskFor(RawSystem));
-
-		mSystems.push_back(std::move(System));
-		return *RawSystem;
+		return AddSystemHelp(new T(mWorld));
 	}
 
 	template <typename T, typename Param1>
 	inline T& FSystemManager::AddSystem(const Param1& P1)
 	{
-		T* RawSystem = new T(mWorld, P1);
-		std::unique_ptr<ISystem> System{ RawSystem };
-
-		RawSystem->SetSystemBitMask(SSystemBitManager::GetBitMaskFor(RawSystem));
-
-		mSystems.push_back(std::move(System));
-		return *RawSystem;
+		return AddSystemHelp(new T(mWorld, P1));
 	}
 
 	template <typename T, typename Param1, typename Param2>
 	inline T& FSystemManager::AddSystem(Param1& P1, Param2& P2)
 	{
-		T* RawSystem = new T(mWorld, P1, P2);
+		return AddSystemHelp(new T(mWorld, P1, P2));
+	}
+
+	template <typename T>
+	inline T& FSystemManager::AddSystemHelp(T* RawSystem)
+	{
 		std::unique_ptr<ISystem> System{ RawSystem };
 
 		RawSystem->SetSystemBitMask(SSystemBitManager::GetBitMaskFor(RawSystem));
 
+		const uint32_t TypeID = SSystemBitManager::GetTypeID<T>();
+		if (TypeID >= mSystemsByType.size())
+			mSystemsByType.resize(TypeID + 1, nullptr);
+		mSystemsByType[TypeID] = RawSystem;
+
 		mSystems.push_back(std::move(System));
 		return *RawSystem;
 	}
 
 	inline void FSystemManager::RemoveSystem(const uint32_t Index)
 	{
+		ClearSystemType(mSystems[Index].get());
 		mSystems.erase(mSystems.begin() + Index);
 	}
 
-	template <typename T>
-	inline T* FSystemManager::GetSystem()
+	inline void FSystemManager::ClearSystemType(const ISystem* System)
 	{
-		System* SystemPtr = nullptr;
-
-		for (const auto& System : mSystems)
+		for (ISystem*& Slot : mSystemsByType)
 		{
-			if (typeid(*System) == typeid(T))
-			{
-				SystemPtr = System.get();
-				break;
-			}
+			if (Slot == System)
+				Slot = nullptr;
 		}
+	}
 
-		// make sure the System is there and cast is safe
-		assert(dynamic_cast<T*>(SystemPtr));
-		return static_cast<T*>(SystemPtr);
+	template <typename T>
+	inline T* FSystemManager::GetSystem()
+	{
+		const uint32_t TypeID = SSystemBitManager::GetTypeID<T>();
+		return TypeID < mSystemsByType.size() ? static_cast<T*>(mSystemsByType[TypeID]) : nullptr;
 	}
 
 	inline ISystem* FSystemManager::GetSystem(const uint32_t Index)
@@ -168,6 +198,11 @@ namespace Atlas
 	template <typename Type>
 	inline void FSystemManager::RemoveSystem()
 	{
-		mSystems.erase(std::find_if(mSystems.begin(), mSystems.end(), [](std::unique_ptr<ISystem> Ptr){ return typeid(Ptr) == Type; }));
+		Type* System = GetSystem<Type>();
+		if (!System)
+			return;
+
+		ClearSystemType(System);
+		mSystems.erase(std::find_if(mSystems.begin(), mSystems.end(), [System](const std::unique_ptr<ISystem>& Ptr){ return Ptr.get() == System; }));
 	}
 }
\ No newline at end of file
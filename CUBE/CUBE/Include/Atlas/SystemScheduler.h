@@ -0,0 +1,128 @@
+#pragma once
+#include "NonCopyable.h"
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace Atlas
+{
+	class ISystem;
+
+	/**
+	* Runs work for several systems as a dependency graph. Work added for a
+	* system depends on all earlier work whose system conflicts with it, by
+	* writing a component type the other reads or writes, so the results are
+	* the same as running everything in the order it was added. Work without
+	* conflicts runs at the same time on the workers and the calling thread.
+	* The same workers also split loops, from any thread and within running work.
+	*/
+	class FSystemScheduler : public NonCopyable
+	{
+	public:
+		using Work = std::function<void()>;
+
+		/**
+		* A loop iteration.
+		* @param Index - The index of the iteration.
+		*/
+		using LoopWork = std::function<void(const uint32_t Index)>;
+
+	public:
+		FSystemScheduler();
+
+		/**
+		* Dtor
+		* Joins all workers.
+		*/
+		~FSystemScheduler();
+
+		/**
+		* Starts the scheduler with a specific amount of worker threads, restarting
+		* it if it is already running.
+		* @param WorkerCount - The number of worker threads, besides the calling thread.
+		*/
+		void Start(const uint32_t WorkerCount);
+
+		/**
+		* Joins all workers. Graphs then run on the calling thread alone, in order.
+		*/
+		void Stop();
+
+		/**
+		* Adds work to the next graph to run.
+		* @param System - The system the work reads and writes components for.
+		* @param Task - The work.
+		* @param IsPinned - If the work must run on the thread calling Run, as with GL calls.
+		*/
+		void Add(const ISystem& System, Work Task, const bool IsPinned = false);
+
+		/**
+		* Runs all work added since the last run and waits for it to finish.
+		* Must not be called from within running work.
+		*/
+		void Run();
+
+		/**
+		* Runs a loop over every index in [0, Count), split into ranges between idle
+		* workers and the calling thread, and waits for every iteration to finish.
+		* @param Count - The number of iterations.
+		* @param GrainSize - The number of iterations taken at a time, at least 1.
+		* @param Task - The iteration to run for each index.
+		*/
+		void ParallelFor(const uint32_t Count, const uint32_t GrainSize, const LoopWork& Task);
+
+		/**
+		* The number of threads a graph is split between, including the calling thread.
+		*/
+		uint32_t GetThreadCount() const { return mWorkers.size() + 1; }
+
+	private:
+		struct LoopRecord
+		{
+			const LoopWork*       Task;
+			uint32_t              Count;
+			uint32_t              GrainSize;
+			std::atomic<uint32_t> NextIndex;
+			uint32_t              ActiveHelpers; // Workers running ranges, the loop outlives them
+		};
+
+		void WorkerThreadLoop();
+
+		/**
+		* Runs a task and releases the tasks waiting on it.
+		*/
+		void RunTask(const uint32_t Index);
+
+		/**
+		* Runs ranges of a loop until none are left.
+		*/
+		void RunLoopRanges(LoopRecord& Loop);
+
+	private:
+		struct TaskRecord
+		{
+			const ISystem*        System;
+			Work                  Task;
+			std::vector<uint32_t> Dependents; // Tasks that wait on this one
+			uint32_t              WaitCount;  // Tasks this one still waits on
+			bool                  IsPinned;
+		};
+
+		std::vector<std::thread> mWorkers;
+		std::vector<TaskRecord>  mTasks;
+		std::deque<uint32_t>     mReadyTasks;   // May run on any thread
+		std::deque<uint32_t>     mPinnedTasks;  // Only run on the calling thread
+		std::deque<LoopRecord*>  mLoopHelpers;  // Each entry asks one worker to help with a loop
+		std::mutex               mTaskMutex;
+		std::condition_variable  mTaskAvailable;
+		std::condition_variable  mTaskFinished;
+		uint32_t                 mFinishedCount;
+		bool                     mMustStop;
+	};
+}
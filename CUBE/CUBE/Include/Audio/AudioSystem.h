@@ -1,26 +1,71 @@
 #pragma once
+#include <memory>
 #include "Atlas\System.h"
 #include "FMOD\fmod.hpp"
+#include "Audio\SoundBank.h"
+#include "Math\Vector3.h"
+#include "Threading\JobSystem.h"
+
+#include <vector>
 
 class FAudioListenerSystem;
+class FChunkManager;
 
 /**
 * System that manages the audio engine.
+* Playing emitters are occluded by the terrain between them and the listener,
+* which lowers and muffles them through FMOD's occlusion low pass. Occlusion
+* is measured by walking the block grid from the listener to a few emitters a
+* frame, in turn, on a worker. Emitters ease towards their last measure, so
+* the delay before an emitter is measured again isn't heard.
 */
 class FAudioSystem : public Atlas::ISystem
 {
 public:
-	FAudioSystem(Atlas::FWorld& World);
+	// Emitters whose occlusion is measured each frame, the rest wait their turn
+	static const uint32_t OCCLUSION_QUERIES_PER_FRAME = 8;
+
+public:
+	FAudioSystem(Atlas::FWorld& World, const FChunkManager& ChunkManager);
+
+	/**
+	* Waits for occlusion being measured, then releases the audio engine.
+	*/
 	~FAudioSystem();
 
 	void Update() override;
 
 private:
+	/**
+	* An emitter whose occlusion is measured on a worker.
+	*/
+	struct OcclusionQuery
+	{
+		Atlas::FGameObject* Object;   // Checked when the result is applied, in case emitters changed
+		uint32_t            Emitter;  // Index among the system's objects
+		Vector3f            Position;
+		float               Occlusion; // Written by the worker
+	};
+
+	/**
+	* Applies the occlusion of the last measured emitters once their job is done,
+	* and measures the next emitters in turn.
+	* @param ListenerPosition - Where the next emitters are heard from.
+	*/
+	void UpdateOcclusion(const Vector3f& ListenerPosition);
+
 	void OnGameObjectRemove(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent) override;
 	void OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent) override;
 private:
 	FMOD::System* mSystem;
+	std::unique_ptr<FSoundBank> mSoundBank; // Created once mSystem is initialized
 	FAudioListenerSystem* mListenerSubSystem;
+	const FChunkManager& mChunkManager; // Terrain occluding emitters
+
+	// Occlusion
+	std::vector<OcclusionQuery> mOcclusionQueries; // Being measured until mOcclusionCounter is done
+	FJobCounter                 mOcclusionCounter;
+	uint32_t                    mNextOcclusionEmitter; // Where the next queries start, round robin
 };
 
 
@@ -35,9 +80,15 @@ public:
 
 	void Update() override;
 
+	/**
+	* Gets the position of the listener as of the last update, the origin without a listener.
+	*/
+	const Vector3f& GetPosition() const { return mPosition; }
+
 private:
 	void OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent) override;
 
 private:
 	FMOD::System* mSystem;
+	Vector3f      mPosition;
 };
\ No newline at end of file
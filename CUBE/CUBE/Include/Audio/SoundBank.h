@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "FMOD\fmod.hpp"
+#include "StringID.h"
+
+/**
+* Sounds shared between every emitter that plays the same file. Sounds are keyed
+* by the FStringID of their path and reference counted, so a file is loaded and
+* decoded once no matter how many emitters use it, and released with its last
+* handle. Loads don't block, Play starts a sound once it's ready. Small files
+* are decompressed into memory, large files are streamed from disk. A streamed
+* sound only plays on one channel at a time, other sounds play on at most
+* MAX_INSTANCES channels, with the oldest taken for new instances.
+*/
+class FSoundBank
+{
+public:
+	using Handle = FStringID::StringID;
+
+	static const Handle INVALID_HANDLE = 0;
+
+	// Files at least this large are streamed instead of decompressed into memory
+	static const uint32_t STREAM_FILE_SIZE = 1024 * 1024;
+
+	// Channels a sound plays on at once
+	static const uint32_t MAX_INSTANCES = 8;
+
+public:
+	explicit FSoundBank(FMOD::System* System);
+
+	/**
+	* Dtor
+	* Releases every sound, even if handles to them remain.
+	*/
+	~FSoundBank();
+
+	FSoundBank(const FSoundBank& Other) = delete;
+	FSoundBank& operator=(const FSoundBank& Other) = delete;
+
+	/**
+	* Takes a reference to the sound of a file, starting to load it if no other handle holds it.
+	* @param Filename - The path of the audio file.
+	* @return The handle of the sound, released with Release.
+	*/
+	Handle Acquire(const std::string& Filename);
+
+	/**
+	* Drops a reference to a sound, releasing the sound with its last reference.
+	* @param Sound - The handle of the sound. INVALID_HANDLE is ignored.
+	*/
+	void Release(const Handle Sound);
+
+	/**
+	* If a sound failed to load, or the handle is invalid.
+	*/
+	bool HasFailed(const Handle Sound) const { return GetOpenState(Sound) == FMOD_OPENSTATE_ERROR; }
+
+	/**
+	* Starts a paused instance of a sound that is ready to play, stopping its
+	* oldest instance if it already plays on MAX_INSTANCES channels.
+	* @return The paused channel, or nullptr if the sound is still loading, busy seeking or has failed.
+	*/
+	FMOD::Channel* Play(const Handle Sound);
+
+private:
+	struct Entry
+	{
+		FMOD::Sound*                Sound;
+		uint32_t                    References;
+		std::vector<FMOD::Channel*> Channels;   // Instances started by Play, oldest first
+	};
+
+	/**
+	* Gets a sound that is ready to play.
+	* @return The sound, or nullptr if it is still loading, busy seeking or has failed.
+	*/
+	FMOD::Sound* GetSound(const Handle Sound) const;
+
+	/**
+	* Gets the open state of a sound, FMOD_OPENSTATE_ERROR for invalid handles.
+	*/
+	FMOD_OPENSTATE GetOpenState(const Handle Sound) const;
+
+private:
+	FMOD::System*                     mSystem;
+	std::unordered_map<Handle, Entry> mSounds;
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ChunkManager.h"
+#include "Math\Vector3.h"
+
+/**
+* Walks the blocks of the world through a BlockReader, keeping the blocks of the chunk it
+* is in, so steps only find a chunk when they cross into another instead of dividing and
+* finding the slot for every block. Each chunk is read as of when the cursor entered it,
+* and chunks that aren't loaded are air. Cursors must not outlive their reader.
+*/
+class FBlockCursor
+{
+public:
+	// Blocks read by GetNeighborhood
+	static const uint32_t NEIGHBORHOOD_SIZE = 27;
+
+public:
+	FBlockCursor(const FChunkManager::BlockReader& Reader, const Vector3i& Position);
+
+	/**
+	* Moves to any position, only finding its chunk if it's another.
+	*/
+	void MoveTo(const Vector3i& Position);
+
+	/**
+	* Steps to the neighbor across a face of the block.
+	* @param Face - The FChunk::NormalID of the face.
+	*/
+	void Step(const uint32_t Face);
+
+	/**
+	* The type of the block at the cursor.
+	*/
+	FBlockTypes::BlockID Get() const { return mBlocks ? mBlocks->Get(mIndex) : FBlock::AIR_BLOCK_ID; }
+
+	/**
+	* Reads the 3x3x3 blocks around the cursor, its own included. Neighborhoods within the
+	* chunk are read straight from its blocks, those crossing a border find each chunk once.
+	* @param BlocksOut - To put the blocks, each at the NeighborhoodIndex of its offset.
+	*/
+	void GetNeighborhood(FBlockTypes::BlockID BlocksOut[NEIGHBORHOOD_SIZE]) const;
+
+	/**
+	* The index of an offset from the center in the blocks of GetNeighborhood, x first.
+	* @param Offset - Each axis within [-1, 1].
+	*/
+	static uint32_t NeighborhoodIndex(const Vector3i& Offset) { return (Offset.x + 1) + (Offset.y + 1) * 3 + (Offset.z + 1) * 9; }
+
+	const Vector3i& GetPosition() const { return mPosition; }
+
+	/**
+	* Checks if the chunk the cursor is in was loaded when it was entered.
+	*/
+	bool IsLoaded() const { return mBlocks != nullptr; }
+
+private:
+	void EnterChunk(const Vector3i& ChunkPosition);
+
+private:
+	const FChunkManager::BlockReader& mReader;
+	const FBlockStorage* mBlocks;        // Of the chunk the cursor is in, null if it isn't loaded
+	Vector3i             mPosition;
+	Vector3i             mChunkPosition;
+	Vector3i             mLocalPosition; // Within the chunk
+	int32_t              mIndex;         // FChunk::BlockIndex of mLocalPosition
+};
+
+/**
+* The blocks of an inclusive box, iterated chunk by chunk and within each chunk in the
+* order blocks are stored, so each chunk is found once and read in order. Reads are as
+* of FBlockCursor.
+*
+* for (const FBlockBox::Block& Block : FBlockBox(Reader, Min, Max))
+*/
+class FBlockBox
+{
+public:
+	/**
+	* A block of the box.
+	*/
+	struct Block
+	{
+		Vector3i             Position;
+		FBlockTypes::BlockID ID;
+	};
+
+	/**
+	* Visits the blocks of a box. Only compares equal to the end once every block was visited.
+	*/
+	class Iterator
+	{
+	public:
+		Block operator*() const;
+		Iterator& operator++();
+		bool operator!=(const Iterator& Other) const { return mIsEnd != Other.mIsEnd; }
+
+	private:
+		friend class FBlockBox;
+
+		Iterator(const FBlockBox& Box, const bool IsEnd);
+
+		/**
+		* Moves to the next chunk of the box, or to the end after the last.
+		*/
+		void NextChunk();
+
+		/**
+		* Finds the blocks of the current chunk and starts at its first block within the box.
+		*/
+		void EnterChunk();
+
+	private:
+		const FBlockBox*     mBox;
+		const FBlockStorage* mBlocks;   // Of the current chunk, null if it isn't loaded
+		Vector3i             mChunkPosition;
+		Vector3i             mLocalMin; // Bounds of the box within the current chunk, inclusive
+		Vector3i             mLocalMax;
+		Vector3i             mLocalPosition;
+		int32_t              mIndex;    // FChunk::BlockIndex of mLocalPosition
+		bool                 mIsEnd;
+	};
+
+public:
+	/**
+	* @param Min - The first corner of the box, inclusive.
+	* @param Max - The last corner of the box, inclusive. Boxes with any axis below Min are empty.
+	*/
+	FBlockBox(const FChunkManager::BlockReader& Reader, const Vector3i& Min, const Vector3i& Max);
+
+	Iterator begin() const { return Iterator(*this, false); }
+	Iterator end() const { return Iterator(*this, true); }
+
+private:
+	const FChunkManager::BlockReader& mReader;
+	Vector3i mMin;
+	Vector3i mMax;
+	Vector3i mMinChunk; // Chunks overlapped by the box, inclusive
+	Vector3i mMaxChunk;
+};
+
+inline FBlockBox::Block FBlockBox::Iterator::operator*() const
+{
+	return Block{ mChunkPosition * FChunk::CHUNK_SIZE + mLocalPosition, mBlocks ? mBlocks->Get(mIndex) : FBlock::AIR_BLOCK_ID };
+}
+
+inline FBlockBox::Iterator& FBlockBox::Iterator::operator++()
+{
+	// Blocks are stored z first, so runs along z are consecutive
+	if (mLocalPosition.z < mLocalMax.z)
+	{
+		mLocalPosition.z++;
+		mIndex++;
+		return *this;
+	}
+
+	mLocalPosition.z = mLocalMin.z;
+	if (mLocalPosition.x < mLocalMax.x)
+		mLocalPosition.x++;
+	else if (mLocalPosition.y < mLocalMax.y)
+	{
+		mLocalPosition.x = mLocalMin.x;
+		mLocalPosition.y++;
+	}
+	else
+	{
+		NextChunk();
+		return *this;
+	}
+
+	mIndex = FChunk::BlockIndex(mLocalPosition);
+	return *this;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Block.h"
+#include "BlockTypes.h"
+#include "Misc\Assertions.h"
+
+/**
+* Paletted block storage for a chunk. Each block stores an index into a
+* small palette of block types, bit packed with 1, 2, 4 or 8 bits per
+* block. The index width grows as new types are added. Storage with a
+* single block type holds no indices at all.
+*/
+class FBlockStorage
+{
+public:
+	/**
+	* Constructs storage of a single block type.
+	* @param BlockCount - The number of blocks held.
+	* @param ID - The type of every block.
+	*/
+	FBlockStorage(const uint32_t BlockCount, const FBlockTypes::BlockID ID = FBlock::AIR_BLOCK_ID);
+
+	/**
+	* Frees index data.
+	*/
+	~FBlockStorage();
+
+	FBlockStorage(const FBlockStorage& Other) = delete;
+	FBlockStorage& operator=(const FBlockStorage& Other) = delete;
+
+	/**
+	* Retrieves the type of a block.
+	*/
+	FBlockTypes::BlockID Get(const uint32_t Index) const;
+
+	/**
+	* Sets the type of a block. Adds the type to the palette if it is new,
+	* which may widen the indices of every block.
+	*/
+	void Set(const uint32_t Index, const FBlockTypes::BlockID ID);
+
+	/**
+	* Sets every block to a single type and frees all index data.
+	*/
+	void Fill(const FBlockTypes::BlockID ID);
+
+	/**
+	* Replaces every block from a plain array. Indices are packed once at
+	* the width needed by the types in use.
+	* @param Blocks - The blocks to store. Must hold the block count.
+	*/
+	void Pack(const FBlock* Blocks);
+
+	/**
+	* Expands every block into a plain array.
+	* @param BlocksOut - Location to place the blocks. Must hold the block count.
+	*/
+	void Unpack(FBlock* BlocksOut) const;
+
+	/**
+	* Exchanges blocks with storage of the same block count.
+	*/
+	void Swap(FBlockStorage& Other);
+
+	/**
+	* Replaces every block with those of storage of the same block count.
+	*/
+	void CopyFrom(const FBlockStorage& Other);
+
+	/**
+	* Checks if every block is of a single type.
+	*/
+	bool IsUniform() const { return mBitsPerIndex == 0; }
+
+	/**
+	* Checks if a block type is in the palette. The palette keeps types that were
+	* overwritten, so a type may be reported that no block holds any longer.
+	*/
+	bool Contains(const FBlockTypes::BlockID ID) const { return mPaletteLookup[ID] < mPalette.size() && mPalette[mPaletteLookup[ID]] == ID; }
+
+private:
+	/**
+	* Repacks every index with a new width.
+	*/
+	void Repack(const uint32_t NewBitsPerIndex);
+
+	/**
+	* Reads a packed palette index.
+	*/
+	uint32_t GetIndex(const uint32_t Index) const;
+
+	/**
+	* Writes a packed palette index.
+	*/
+	void SetIndex(const uint32_t Index, const uint32_t PaletteIndex);
+
+private:
+	std::vector<FBlockTypes::BlockID> mPalette;
+	std::vector<uint32_t>             mIndices;      // Packed palette indices, empty when uniform
+	uint8_t                           mPaletteLookup[256]; // Palette index of each block type, valid only if the palette holds the type
+	uint32_t                          mBlockCount;
+	uint32_t                          mBitsPerIndex; // 0, 1, 2, 4 or 8
+	uint32_t                          mIndexShift;   // log2 of mBitsPerIndex
+};
+
+inline FBlockTypes::BlockID FBlockStorage::Get(const uint32_t Index) const
+{
+	ASSERT(Index < mBlockCount);
+	return (mBitsPerIndex == 0) ? mPalette[0] : mPalette[GetIndex(Index)];
+}
+
+inline uint32_t FBlockStorage::GetIndex(const uint32_t Index) const
+{
+	// Indices never straddle words since the width divides 32
+	const uint32_t Bit = Index << mIndexShift;
+	return (mIndices[Bit >> 5] >> (Bit & 31)) & ((1u << mBitsPerIndex) - 1);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Math\Vector3.h"
+
+/**
+* Block positions waiting to be ticked, kept in a timing wheel of WHEEL_SIZE ticks
+* so each tick only visits the positions due in it. A position is scheduled at most
+* once, at its earliest tick. Positions in chunks that aren't loaded when they are
+* due are parked by chunk until the chunk is loaded again. Every scheduled and
+* parked tick is saved with the world. Any thread may save while the ticking thread
+* uses the scheduler.
+*/
+class FBlockTickScheduler
+{
+public:
+	// Ticks covered by one turn of the wheel. Later ticks wait in their slot for more turns.
+	static const uint32_t WHEEL_SIZE = 256;
+
+public:
+	FBlockTickScheduler();
+
+	FBlockTickScheduler(const FBlockTickScheduler& Other) = delete;
+	FBlockTickScheduler& operator=(const FBlockTickScheduler& Other) = delete;
+
+	/**
+	* Loads the ticks saved with a world as parked ticks, dropping every tick held.
+	* @param WorldName - The name of the world.
+	*/
+	void Open(const wchar_t* WorldName);
+
+	/**
+	* Saves every scheduled and parked tick with the world last opened.
+	* @return False if the ticks could not be written.
+	*/
+	bool Save() const;
+
+	/**
+	* Schedules a block to tick. A block already scheduled sooner keeps its tick.
+	* @param Position - The world position of the block.
+	* @param Delay - Ticks from the current tick, at least 1.
+	*/
+	void Schedule(const Vector3i& Position, const uint32_t Delay);
+
+	/**
+	* Advances to the next tick and takes the blocks due in it.
+	* @param PositionsOut - Set to the world positions of the blocks due.
+	*/
+	void Advance(std::vector<Vector3i>& PositionsOut);
+
+	/**
+	* Holds a due tick until its chunk is loaded.
+	* @param ChunkPosition - The chunk space position of the block's chunk.
+	* @param Position - The world position of the block.
+	* @param Delay - Ticks after the chunk is loaded that the block ticks.
+	*/
+	void Park(const Vector3i& ChunkPosition, const Vector3i& Position, const uint32_t Delay);
+
+	/**
+	* Schedules the parked ticks of a chunk that was loaded.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	*/
+	void Resume(const Vector3i& ChunkPosition);
+
+	/**
+	* The current tick, counted from when the world was opened.
+	*/
+	uint64_t GetTick() const { return mTick; }
+
+	/**
+	* The number of blocks scheduled, not counting parked ticks.
+	*/
+	uint32_t GetScheduledCount() const;
+
+private:
+	// Hash functor for the tick tables
+	struct Vector3iHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	/**
+	* A block waiting in the wheel. Entries whose tick no longer matches mScheduled were rescheduled sooner.
+	*/
+	struct ScheduledTick
+	{
+		Vector3i Position;
+		uint64_t Tick;
+	};
+
+	/**
+	* A tick waiting on its chunk, or as stored on file.
+	*/
+	struct ParkedTick
+	{
+		Vector3i Position;
+		uint32_t Delay;
+	};
+
+	/**
+	* Schedules a block with the lock held.
+	*/
+	void Insert(const Vector3i& Position, const uint32_t Delay);
+
+private:
+	std::vector<ScheduledTick> mWheel[WHEEL_SIZE]; // By tick modulo WHEEL_SIZE
+	std::unordered_map<Vector3i, uint64_t, Vector3iHash> mScheduled; // Tick of each scheduled block
+	std::unordered_map<Vector3i, std::vector<ParkedTick>, Vector3iHash> mParked; // By chunk
+	std::wstring       mFilepath;
+	uint64_t           mTick;
+	mutable std::mutex mMutex;
+};
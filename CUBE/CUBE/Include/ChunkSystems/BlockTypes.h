@@ -11,19 +11,150 @@
 * unique block types is the max numeric size of the type used 
 * to store block IDs. You can overwrite block types by adding a
 * block type to a previously used ID.
+*
+* The properties of each type are packed into a byte of a table
+* indexed by ID, so the mesher, light propagation and collision
+* look a block up with a load and a mask instead of branching on
+* its type. Air, ID 0, has no properties.
+*
+* Faces of each type can be given a texture, a layer of the block
+* texture array that FBlockTextureArray uploads. Textures are tinted
+* by the type's color, and faces without one sample a white layer,
+* so they keep the flat color.
 */
 class FBlockTypes
 {
 public:
 	using BlockID = uint8_t;
 
+	// Every ID a block can have
+	static const uint32_t MAX_BLOCK_TYPES = 256;
+
+	/**
+	* Bits of a type's properties. The block light the type emits is held above them.
+	*/
+	struct Property
+	{
+		enum Type : uint8_t
+		{
+			Opaque      = 1 << 0, // Hides the faces behind it and stops light
+			Transparent = 1 << 1, // Seen through, faces behind it are still built
+			Collidable  = 1 << 2, // Hit by raycasts and physics
+			Emissive    = 1 << 3  // Emits block light, set by AddBlock from the light level
+		};
+	};
+
+	// Shift of the block light within a type's properties
+	static const uint8_t LIGHT_SHIFT = 4;
+
+	// Properties of types added without any, solid blocks
+	static const uint8_t DEFAULT_PROPERTIES = Property::Opaque | Property::Collidable;
+
+	// Side of every block texture in texels
+	static const uint32_t TEXTURE_SIZE = 16;
+
+	// Layers the block texture array can hold, the least every GL 4.3 driver supports
+	static const uint32_t MAX_TEXTURES = 2048;
+
+	// Layer of the white texture faces without one sample
+	static const uint32_t NO_TEXTURE = 0;
+
+	// Faces of each type given a texture, indexed by FChunk::NormalID
+	static const uint32_t FACE_COUNT = 6;
+
 public:
 	FBlockTypes() = delete;
 
-	static void AddBlock(const BlockID ID, const Vector4f& Color);
+	/**
+	* Adds a block type.
+	* @param ID - The ID of the type.
+	* @param Color - The color of the type's blocks.
+	* @param LightLevel - The block light the type's blocks emit, within [0, 15].
+	* @param Properties - Bits of Property, the type can't be both opaque and transparent.
+	*/
+	static void AddBlock(const BlockID ID, const Vector4f& Color, const uint8_t LightLevel = 0, const uint8_t Properties = DEFAULT_PROPERTIES);
 	static const Vector4f& GetBlockColor(const BlockID ID);
 
+	/**
+	* Retrieves the block light emitted by a block type. 0 if the type emits no light.
+	*/
+	static uint8_t GetBlockLight(const BlockID ID);
+
+	/**
+	* Retrieves the property bits of a block type, with its block light above LIGHT_SHIFT.
+	*/
+	static uint8_t GetProperties(const BlockID ID);
+
+	static bool IsOpaque(const BlockID ID);
+	static bool IsTransparent(const BlockID ID);
+	static bool IsCollidable(const BlockID ID);
+
+	/**
+	* Adds a block texture.
+	* @param Texels - TEXTURE_SIZE * TEXTURE_SIZE RGBA8 texels, in rows from the bottom up.
+	* @return The layer of the texture.
+	*/
+	static uint32_t AddTexture(const uint32_t* Texels);
+
+	/**
+	* Sets the texture of every face of a block type. The texture tiles once a block.
+	* @param Layer - A layer returned by AddTexture, or NO_TEXTURE.
+	*/
+	static void SetBlockTexture(const BlockID ID, const uint32_t Layer);
+
+	/**
+	* Sets the texture of one face of a block type.
+	* @param Face - The FChunk::NormalID of the face.
+	* @param Layer - A layer returned by AddTexture, or NO_TEXTURE.
+	*/
+	static void SetBlockTexture(const BlockID ID, const uint32_t Face, const uint32_t Layer);
+
+	/**
+	* Retrieves the texture layer of a face of a block type.
+	*/
+	static uint32_t GetBlockTexture(const BlockID ID, const uint32_t Face) { return mFaceTextures[ID * FACE_COUNT + Face]; }
+
+	/**
+	* The number of textures added, with the white texture at NO_TEXTURE.
+	*/
+	static uint32_t GetTextureCount() { return mTextureTexels.size() / (TEXTURE_SIZE * TEXTURE_SIZE); }
+
+	/**
+	* Checks if any transparent type was added, so meshing can skip looking for them.
+	*/
+	static bool HasTransparentTypes() { return mTransparentCount != 0; }
+
 private:
 	friend class FRenderSystem;
+	friend class FBlockTextureArray;
 	static std::vector<Vector4f> mBlockTypes;
-};
\ No newline at end of file
+	static uint8_t               mBlockProperties[MAX_BLOCK_TYPES];
+	static uint32_t              mTransparentCount; // Types with Property::Transparent
+	static std::vector<uint32_t> mTextureTexels;    // Texels of every texture, a layer after another
+	static uint32_t              mFaceTextures[MAX_BLOCK_TYPES * FACE_COUNT]; // Texture layer of each face of each type
+};
+
+inline uint8_t FBlockTypes::GetBlockLight(const BlockID ID)
+{
+	return mBlockProperties[ID] >> LIGHT_SHIFT;
+}
+
+inline uint8_t FBlockTypes::GetProperties(const BlockID ID)
+{
+	return mBlockProperties[ID];
+}
+
+inline bool FBlockTypes::IsOpaque(const BlockID ID)
+{
+	return (mBlockProperties[ID] & Property::Opaque) != 0;
+}
+
+inline bool FBlockTypes::IsTransparent(const BlockID ID)
+{
+	return (mBlockProperties[ID] & Property::Transparent) != 0;
+}
+
+inline bool FBlockTypes::IsCollidable(const BlockID ID)
+{
+	return (mBlockProperties[ID] & Property::Collidable) != 0;
+}
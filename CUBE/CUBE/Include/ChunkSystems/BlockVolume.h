@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GL\glew.h"
+#include "Math\Vector3.h"
+#include "Math\Vector4.h"
+#include "Chunk.h"
+#include "Rendering\UniformBlockStandard.h"
+#include "Memory\MemoryStats.h"
+
+class FBlockStorage;
+
+/**
+* The chunks around the camera mirrored on the GPU at a bit per block, so screen
+* space passes can trace rays through the blocks, see Shaders/BlockVolume.glsl.
+* Each texel of an R32UI 3D texture holds a row of CHUNK_SIZE blocks along x, a bit
+* set for each opaque block, so a chunk takes 4 KB. Chunks are kept in the
+* slots of a toroidal grid, so moving the center only uploads the chunks that
+* entered the volume. The chunk held by each slot is tagged in a buffer, and slots
+* whose chunk wasn't uploaded yet read as air.
+*/
+class FBlockVolume
+{
+public:
+	// Chunks held on each side of the center horizontally, before clamping to the view distance
+	static const int32_t DEFAULT_RADIUS = 6;
+
+	// Chunks held above and below the center
+	static const int32_t DEFAULT_VERTICAL_RADIUS = 3;
+
+	// Largest radius, so each side of the texture stays within the 2048 texels every GPU supports
+	static const int32_t MAX_RADIUS = 31;
+
+	// Chunks uploaded in a frame, about 128 KB
+	static const uint32_t MAX_UPLOADS_PER_FRAME = 32;
+
+	// Rows are R32UI texels, so there's no volume of chunks wider than 32 blocks
+	static const bool IS_SUPPORTED = (FChunk::CHUNK_SIZE <= 32);
+
+public:
+	/**
+	* Creates the volume's parameter block, holding no chunks.
+	*/
+	FBlockVolume();
+
+	/**
+	* Deletes every GL object held by the volume.
+	*/
+	~FBlockVolume();
+
+	FBlockVolume(const FBlockVolume& Other) = delete;
+	FBlockVolume& operator=(const FBlockVolume& Other) = delete;
+
+	/**
+	* Sets the chunks held around the center, reallocating the volume and dropping every chunk.
+	* @param Radius - Chunks held on each side of the center along x and z, or 0 to hold none and free the volume.
+	* @param VerticalRadius - Chunks held above and below the center.
+	*/
+	void SetRadius(int32_t Radius, int32_t VerticalRadius);
+
+	/**
+	* Moves the center of the volume, dropping the chunks that left it.
+	* @param CenterChunk - The chunk in the middle of the volume.
+	* @param EnteredOut - Added the chunks that entered the volume, or every chunk of it the first time it's centered.
+	*/
+	void SetCenter(const Vector3i& CenterChunk, std::vector<Vector3i>& EnteredOut);
+
+	/**
+	* Checks if a chunk is within the volume around its center.
+	*/
+	bool Contains(const Vector3i& ChunkPosition) const;
+
+	/**
+	* Uploads the blocks of a chunk to its slot. Chunks outside the volume are ignored.
+	*/
+	void Upload(const Vector3i& ChunkPosition, const FBlockStorage& Blocks);
+
+	/**
+	* Binds the volume and its slot tags for Shaders/BlockVolume.glsl.
+	*/
+	void Bind() const;
+
+	/**
+	* Checks if chunks are held, which is once a radius is set and the volume is centered.
+	*/
+	bool IsEnabled() const { return mTexture != 0 && mIsCentered; }
+
+	int32_t GetRadius() const { return mRadius.x; }
+	int32_t GetVerticalRadius() const { return mRadius.y; }
+
+private:
+	/**
+	* The index of the slot holding a chunk within the toroidal grid.
+	*/
+	int32_t SlotIndex(const Vector3i& ChunkPosition) const;
+
+	/**
+	* Uploads the center and size of the volume to its parameter block.
+	*/
+	void UploadParams();
+
+private:
+	std::vector<Vector4i> mSlotChunks; // Chunk each slot is tagged with, w is 0 for slots holding none
+	std::vector<uint32_t> mRows;       // Rows of the chunk being uploaded, reused by Upload
+	FUniformBlock mParams;
+	Vector3i      mCenter;
+	Vector3i      mRadius;   // Chunks held on each side of the center along each axis
+	Vector3i      mSlots;    // Slots along each axis, 2 * mRadius + 1
+	bool          mIsCentered; // False until the first center after the radius is set
+	GLuint        mTexture;
+	GLuint        mSlotBuffer;
+	FTrackedBytes mBytes;    // Size of the texture and the slot tags
+};
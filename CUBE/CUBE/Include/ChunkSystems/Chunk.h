@@ -3,17 +3,27 @@
 #include <GL\glew.h>
 #include <cstdint>
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 
 #include "Memory\PoolAllocator.h"
+#include "Memory\ConcurrentPoolAllocator.h"
+#include "Threading\EpochReclaimer.h"
 #include "Common.h"
+#include "ChunkSize.h"
 #include "Block.h"
-#include "BulletPhysics\btBulletCollisionCommon.h"
+#include "BlockStorage.h"
 #include "Rendering\GLBindings.h"
 #include "ChunkMesh.h"
+#include "ChunkLight.h"
 #include "BlockTypes.h"
 
 class FChunkManager;
-class FPhysicsSystem;
+class FUploadRing;
+class FChunkGeometryArena;
+class FChunkDrawList;
+class FChunkMeshCache;
 
 /**
 * Represents a 3D mesh of voxels of CHUNK_SIZE
@@ -21,47 +31,110 @@ class FPhysicsSystem;
 */
 class FChunk
 {
-private:
-	WIN_ALIGN(16)
-	struct CollisionData
+public:
+	// Dimensions of each chunk, see CHUNK_SIZE_BITS
+	static const int32_t CHUNK_SIZE = 1 << CHUNK_SIZE_BITS;
+	static const int32_t BLOCKS_PER_CHUNK = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+
+	// Dimensions of each mesh section. Sections are rebuilt separately after edits.
+	static const int32_t SECTION_SIZE = CHUNK_SIZE / 2;
+
+	// A bit for each block of a row along an axis, as the mesher and chunk borders hold rows
+	using RowMask = std::conditional<(CHUNK_SIZE <= 32), uint32_t, uint64_t>::type;
+
+	// Smallest type holding every BlockIndex, for block indices kept or sent in bulk
+	using PackedIndex = std::conditional<(BLOCKS_PER_CHUNK <= 0x10000), uint16_t, uint32_t>::type;
+	static const uint32_t SECTION_COUNT = FChunkMesh::SECTION_COUNT;
+	static const uint32_t ALL_SECTIONS = FChunkMesh::ALL_SECTIONS;
+
+	// Largest possible RLE block layout, with a run for every block after the FChunkRLE header
+	static const uint32_t MAX_RLE_BYTES = 2 * BLOCKS_PER_CHUNK + 2;
+
+	// Face connection bits of a chunk where every face can be seen from every other, see GetFaceConnections
+	static const uint32_t ALL_FACE_CONNECTIONS = (1 << 15) - 1;
+
+	// Mesh detail levels. Level n meshes cells of 2^n blocks, so the last level is (CHUNK_SIZE / 8)^3 cells.
+	static const uint32_t LOD_LEVELS = 4;
+
+	// Memory pools. They grow by POOL_PAGE_SIZE chunks at a time.
+	static const uint32_t POOL_PAGE_SIZE = 256;
+	using MeshPool = FPoolAllocatorType<FChunkMesh, POOL_PAGE_SIZE, FConcurrentPoolAllocator, FVirtualPageSource>;
+
+	// Meshes of chunks not given a pool of their own, such as those outside of a chunk manager
+	static MeshPool SharedMeshPool;
+
+	// Retires the block storage replaced by loads and edits, see GetPublishedBlocks
+	static FEpochReclaimer BlockEpochs;
+
+	// Constants used for constructing quads with correct normals in GreedyMesh().
+	// Also used to identify the faces of a chunk. Opposite faces only differ by the first bit.
+	struct NormalID
 	{
-		struct MeshData
+		enum : uint32_t
 		{
-			MeshData()
-				: Mesh()
-				, Shape(&Mesh, false, false)
-			{}
-			btTriangleIndexVertexArray Mesh;
-			btBvhTriangleMeshShape     Shape;
+			East,
+			West,
+			Top,
+			Bottom,
+			North,
+			South
 		};
-
-		CollisionData()
-			: Object()
-			, ActiveMesh(false)
-		{}
-		MeshData            Mesh[2]; // Double buffer for collision mesh data
-		btCollisionObject   Object;
-		bool                ActiveMesh;
 	};
 
-public:
-	// Dimensions of each chunk
-	static const int32_t CHUNK_SIZE = 32;
-	static const int32_t BLOCKS_PER_CHUNK = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+	/**
+	* Blocks of the neighboring chunks along each face of a chunk. For a face along axis d,
+	* with the other axes u = (d + 1) % 3 and v = (d + 2) % 3, bit x[u] of Solid[Face][x[v]] is
+	* set if the neighboring block across the face is opaque, and Light[Face][x[v]][x[u]]
+	* holds its packed FChunkLight levels.
+	*/
+	struct NeighborBorders
+	{
+		RowMask  Solid[6][CHUNK_SIZE];
+		uint8_t  Light[6][CHUNK_SIZE][CHUNK_SIZE];
+	};
 
-	// Memory pools
-	static const uint32_t POOL_SIZE = 30000;
-	static FPoolAllocator<sizeof(FBlock) * BLOCKS_PER_CHUNK, POOL_SIZE> ChunkAllocator;
-	static FPoolAllocatorType<FChunkMesh, POOL_SIZE> MeshAllocator;
-	static FPoolAllocatorType<CollisionData, POOL_SIZE> CollisionAllocator;
+	/**
+	* A block to set with SetBlocks.
+	*/
+	struct BlockWrite
+	{
+		int32_t              Index; // BlockIndex of the block
+		FBlockTypes::BlockID ID;
+	};
 
 public:
 	/**
-	* Returns the index of a block in the mBlocks array based on 3D coordinates within the chunk.
+	* Returns the index of a block in mBlocks based on 3D coordinates within the chunk.
 	*/
 	static int32_t BlockIndex(Vector3i Position);
 	static int32_t FChunk::BlockIndex(int32_t X, int32_t Y, int32_t Z);
 
+	/**
+	* Returns the index of the mesh section holding a block. Sections are ordered x, then y, then z.
+	*/
+	static uint32_t SectionIndex(const Vector3i& Position);
+
+	/**
+	* Returns the bits of the mesh sections whose faces can change with an edit of a
+	* block, which are the sections holding it and its neighbors in the chunk, including
+	* diagonal neighbors that occlude its faces.
+	*/
+	static uint32_t EditSections(const Vector3i& Position);
+
+	/**
+	* Returns the bits of the mesh sections along a face of the chunk.
+	* @param Face - The face, a NormalID.
+	*/
+	static uint32_t FaceSections(const uint32_t Face);
+
+	/**
+	* Returns the bit of a pair of faces in a face connection mask. Each of the
+	* 15 pairs of different faces has its own bit, the order of the faces doesn't matter.
+	* @param FaceA - A face, a NormalID.
+	* @param FaceB - Another face, a NormalID.
+	*/
+	static uint32_t FaceConnection(const uint32_t FaceA, const uint32_t FaceB);
+
 public:
 	/**
 	* Constructs chunk of voxels.
@@ -76,34 +149,188 @@ public:
 	*/
 	~FChunk();
 
+	/**
+	* Sets the pool meshes of this chunk are allocated from, which must outlive it.
+	* Chunks use SharedMeshPool until set. The chunk must not hold a mesh.
+	*/
+	void SetMeshPool(MeshPool& Pool);
+
 	/**
 	* Allocates and builds chunk data. Chunk meshes will still need to 
 	* be built before rendering.
-	* @param BlockData - RLE block layout for this chunk.
-	* @return True if the chunk is not empty, false otherwise.
+	* @param BlockData - RLE block layout for this chunk, in either layout of FChunkRLE.
+	* @param DataSize - The size of BlockData in bytes.
+	* @return True if the chunk is empty, false otherwise.
+	*/
+	bool Load(const uint8_t* BlockData, const uint32_t DataSize);
+
+	/**
+	* Frees block and mesh data. Blocks are only encoded if they were modified
+	* since the chunk was loaded or saved.
+	* @param BlockDataOut - Memory to place RLE block layout for this chunk. Must hold MAX_RLE_BYTES.
+	* @return The size of the RLE block layout in bytes. 0 if the chunk is unmodified and doesn't need to be written.
+	*/
+	uint32_t Unload(uint8_t* BlockDataOut);
+
+	/**
+	* Exchanges blocks, light, mesh and state with another chunk, moving a
+	* loaded chunk to another slot. Neither chunk may be in use by another thread,
+	* and both must use the same mesh pool.
+	*/
+	void Swap(FChunk& Other);
+
+	/**
+	* Identifies the state of a chunk's blocks.
 	*/
-	bool Load(const std::vector<uint8_t>& BlockData);
+	struct Version
+	{
+		uint32_t LoadCount;   // Number of times the chunk has been loaded
+		uint32_t ModifyCount; // Number of block edits made
+	};
 
 	/**
-	* Frees block and mesh data.
-	* @param BlockDataOut - Memory to place RLE block layout for this chunk.
+	* Encodes the blocks of a loaded chunk without unloading it.
+	* @param BlockDataOut - Memory to place RLE block layout for this chunk. Must hold MAX_RLE_BYTES.
+	* @param VersionOut - To put the version of the encoded blocks.
+	* @return The size of the RLE block layout in bytes.
 	*/
-	void Unload(std::vector<uint8_t>& BlockDataOut);
+	uint32_t Serialize(uint8_t* BlockDataOut, Version& VersionOut);
+
+	/**
+	* Marks a version of the chunk's blocks as written to file. Later edits
+	* leave the chunk modified, and versions from a previous load are ignored.
+	*/
+	void MarkSaved(const Version& SavedVersion);
+
+	/**
+	* Checks if blocks were set since the chunk was loaded or saved.
+	*/
+	bool IsModified() const { return mModifyCount != mSavedModifyCount; }
+
+	/**
+	* The number of times the chunk has been loaded. Tells apart data of the
+	* same chunk across unloads.
+	*/
+	uint32_t GetLoadCount() const { return mLoadCount; }
 
 	/**
 	* Removes data held by this chunk from external services.
 	*/
-	void ShutDown(FPhysicsSystem& PhysicsSystem);
+	void ShutDown();
+
+	/**
+	* Marks mesh sections to be rebuilt by the next RebuildMesh.
+	* @param SectionMask - Bits of the sections to rebuild.
+	*/
+	void MarkSectionsDirty(const uint32_t SectionMask) { mDirtySections |= SectionMask; }
+
+	/**
+	* Takes the bits of the mesh sections marked dirty, leaving none dirty. Sections
+	* should be taken before reading the data they are rebuilt from, so later changes
+	* dirty them again.
+	*/
+	uint32_t TakeDirtySections() { return mDirtySections.exchange(0); }
+
+	/**
+	* Checks if any mesh sections are waiting to be rebuilt.
+	*/
+	bool HasDirtySections() const { return mDirtySections != 0; }
+
+	/**
+	* Builds/Rebuilds sections of this chunks' mesh. Every section is
+	* rebuilt after a load or when the detail level changes. The mesh is built from a
+	* snapshot of the published blocks taken without the block lock, so edits are never
+	* blocked by meshing.
+	* @param WorldPosition - The world position of the chunk.
+	* @param Neighbors - Blocks bordering this chunk. Faces hidden by solid neighbors are not built.
+	* @param Light - The packed FChunkLight levels of the chunk's BLOCKS_PER_CHUNK blocks. Faces are lit by the block in front of them.
+	* @param SectionMask - Bits of the sections to rebuild, taken with TakeDirtySections.
+	* @param LODLevel - The detail level to build. Levels above 0 don't use solid neighbors and always build border faces.
+	* @param MeshCache - Cache to take whole meshes from when built from the same data, or null.
+	* @return False if blocks were published while meshing, so the mesh is stale. Its sections are
+	*         marked dirty again for the rebuild queued with the edit, and it need not be swapped in.
+	*/
+	bool RebuildMesh(const Vector3f& WorldPosition, const NeighborBorders& Neighbors, const uint8_t* Light, const uint32_t SectionMask, const uint32_t LODLevel = 0, FChunkMeshCache* MeshCache = nullptr);
+
+	/**
+	* Prepares sections of this chunk's mesh to be built at detail level 0 by FChunkGPUMesher,
+	* in place of RebuildMesh. Sections waiting in the back buffer are dropped and built again,
+	* so they aren't swapped over the GPU mesh.
+	* @param SectionMask - Bits of the sections to rebuild, taken with TakeDirtySections.
+	* @param BlocksOut - Location to place the BLOCKS_PER_CHUNK unpacked blocks, in the layout of mBlocks.
+	* @return Bits of the sections to build on the GPU. 0 if there are none, or if the chunk is all
+	*         air and its cleared mesh is swapped in by SwapMeshBuffer as usual.
+	*/
+	uint32_t PrepareGPUMesh(const uint32_t SectionMask, FBlock* BlocksOut);
+
+	/**
+	* Puts sections built by FChunkGPUMesher into the active mesh, in place of SwapMeshBuffer.
+	* @param GeometryArena - The arena holding chunk quad data.
+	* @param SectionMask - Bits of the sections built.
+	* @param Allocations - The arena range of each section, taken by the mesh.
+	* @param Ranges - The quad range of each face direction of each section.
+	*/
+	void SwapGPUMesh(FChunkGeometryArena& GeometryArena, const uint32_t SectionMask, const FChunkGeometryArena::Allocation* Allocations, const FChunkMesh::FaceRanges* Ranges);
+
+	/**
+	* Bits of the pairs of faces joined through air inside the chunk, found from the blocks
+	* each time the chunk is meshed. A chunk can only be seen through from one face to
+	* another if their FaceConnection bit is set. Chunks that haven't been meshed since they
+	* were loaded have every bit set.
+	*/
+	uint32_t GetFaceConnections() const { return mFaceConnections; }
 
 	/**
-	* Builds/Rebuilds this chunks' mesh.
+	* The detail level of the last mesh that was built.
 	*/
-	void RebuildMesh(const Vector3f& WorldPosition);
+	uint32_t GetMeshLOD() const { return mMeshLOD; }
+
+	/**
+	* Retrieves the opaque blocks of the layer along a face of this chunk.
+	* @param Face - The NormalID of the face.
+	* @param SolidOut - Location to place the layer's opaque blocks, in the layout used by NeighborBorders.
+	*/
+	void GetBorder(const uint32_t Face, RowMask SolidOut[CHUNK_SIZE]) const;
+
+	/**
+	* Retrieves the light of the layer along a face of this chunk.
+	* @param Face - The NormalID of the face.
+	* @param LightOut - Location to place the layer's packed light, in the layout used by NeighborBorders.
+	*/
+	void GetBorderLight(const uint32_t Face, uint8_t LightOut[CHUNK_SIZE][CHUNK_SIZE]) const;
+
+	/**
+	* The light of the chunk's blocks, set by FLightPropagator. It isn't guarded
+	* by the block lock, so the chunk manager guards it with its own light lock.
+	*/
+	FChunkLight& GetLight() { return mLight; }
+	const FChunkLight& GetLight() const { return mLight; }
 
 	/**
 	* Swaps the currently used mesh for rendering.
+	* @param GeometryArena - The arena holding chunk quad data.
+	* @param UploadRing - Staging ring used to upload the mesh.
 	*/
-	void SwapMeshBuffer(FPhysicsSystem& PhysicsSystem);
+	void SwapMeshBuffer(FChunkGeometryArena& GeometryArena, FUploadRing& UploadRing);
+
+	/**
+	* Takes the sections waiting for SwapMeshBuffer to be uploaded elsewhere, in place of
+	* SwapMeshBuffer. Once they are in the geometry arena they are put in with SwapGPUMesh.
+	* @param QuadsOut - To swap the quad data of each taken section into. Should be empty.
+	* @param RangesOut - To put the quad range of each face direction of each taken section.
+	* @return Bits of the sections taken. 0 if the chunk has no mesh.
+	*/
+	uint32_t TakeMeshSections(FChunkMesh::QuadData QuadsOut[FChunkMesh::SECTION_COUNT], FChunkMesh::FaceRanges RangesOut[FChunkMesh::SECTION_COUNT]);
+
+	/**
+	* Incremented each time SwapMeshBuffer changes the mesh that is rendered.
+	*/
+	uint32_t GetMeshRevision() const { return mMeshRevision; }
+
+	/**
+	* The size in bytes of the mesh data waiting for SwapMeshBuffer.
+	*/
+	uint32_t GetPendingMeshSize() const;
 
 	/**
 	* Checks if the chunk has been loaded.
@@ -111,82 +338,151 @@ public:
 	bool IsLoaded() const;
 
 	/**
-	* Renders active blocks in the chunk.
+	* Adds draws of active blocks in the chunk to a draw list.
+	* @param DrawList - The list to add to.
+	* @param Origin - The world position of the chunk.
+	* @param ViewPosition - The world position the chunk is viewed from. Used to skip faces pointing away from the view.
 	*/
-	void Render(const GLenum RenderMode = GL_TRIANGLES);
+	void AddDraw(FChunkDrawList& DrawList, const Vector3i& Origin, const Vector3f& ViewPosition) const;
 
 	/**
 	* Set a block in the chunk at a specific position.
+	* @return The type of the block it replaced.
 	*/
-	void SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID);
+	FBlockTypes::BlockID SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID);
 
 	/**
 	* Retrieves the type of block in the chunk at a specific position.
 	*/
 	FBlockTypes::BlockID GetBlock(const Vector3i& Position) const;
 
+	/**
+	* Calls a function with the chunk's block storage under its block lock,
+	* so many blocks can be read without locking for each.
+	* @param Reader - Called as Reader(const FBlockStorage&).
+	*/
+	template <typename Function>
+	void ReadBlocks(const Function& Reader) const;
+
+	/**
+	* The chunk's blocks, read without locking. Published storage is never written, loads
+	* and edits publish a copy instead, so it can be read for as long as BlockEpochs is
+	* pinned across the call and the reads.
+	*/
+	const FBlockStorage& GetPublishedBlocks() const { return *mBlocks.load(); }
+
+	/**
+	* Advanced each time loads and edits publish new blocks. Read before the published
+	* blocks, it tells if a snapshot of them was replaced since.
+	*/
+	uint32_t GetBlockGeneration() const { return mBlockGeneration; }
+
 	/**
 	* Destroys a block in the chunk at a specific position.
 	* @return ID of the block that was destroyed.
 	*/
 	FBlockTypes::BlockID DestroyBlock(const Vector3i& Position);
 
+	/**
+	* Sets several blocks in the chunk under a single lock.
+	* @param Writes - The blocks to set, applied in order.
+	* @param Count - The number of writes.
+	* @param PreviousIDsOut - To put the ID each block had before it was written. Must hold Count IDs.
+	* @param ReplacedID - If not null, only blocks of this type are set.
+	*/
+	void SetBlocks(const BlockWrite* Writes, const uint32_t Count, FBlockTypes::BlockID* PreviousIDsOut, const FBlockTypes::BlockID* ReplacedID = nullptr);
+
 	/**
 	* Checks if this chunk contains any blocks.
 	*/
 	bool IsEmpty() const { return mIsEmpty; }
 
-private:
-	// Constants used for constructing quads with correct normals in GreedyMesh()
-	struct NormalID
-	{
-		enum : uint32_t
-		{
-			East,
-			West,
-			Top,
-			Bottom,
-			North,
-			South
-		};
-	};
-
 private:
 	/**
-	* Voxel mesh algorithm to minimize triangle count on chunk meshes.
+	* Voxel mesh algorithm to minimize triangle count on chunk meshes. Face visibility is
+	* computed with bitmasks, one bit per block in a row, then faces are merged greedily per block type.
 	* Algorithm by Mikola Lysenko from http://0fps.net/2012/06/30/meshing-in-a-minecraft-game/
+	* @param Blocks - The BLOCKS_PER_CHUNK blocks to mesh, in the layout of mBlocks.
+	* @param WorldPosition - The world position of the chunk.
+	* @param Neighbors - Blocks bordering the chunk.
+	* @param Light - The packed light of the chunk's blocks. Quads only merge faces lit the same.
+	* @param SectionMask - Bits of the mesh sections to build. Quads never cross a section.
+	* Each quad corner is also given ambient occlusion from the 3 blocks touching it in front
+	* of the face. Quads only merge faces occluded evenly at every corner.
 	*/
-	void GreedyMesh(const Vector3f WorldPosition);
-
-	/**
-	* Adds a quad from 4 vertices based on if the quad is backfaced, the direction of the surface,
-	* and block type we are generating the quad for. Output is given through a given vertex and index
-	* list.
-	* @param Bottom left position
-	* @param Top left position
-	* @param Top right position
-	* @param Bottom right position
-	* @param IsBackFace - Used to specify vertex ordering.
-	* @param Side - Direction the surface is facing
-	* @param Type - The type of block the quad is used for.
-	* @param VerticesOut - Location to place vertex data.
-	* @param IndicesOut - Location to place index data.
-	*/
-	void AddQuad(	const Vector3f& BottomLeft, 
-					const Vector3f& TopLeft, 
-					const Vector3f& TopRight, 
-					const Vector3f& BottomRight,
-					const bool IsBackface, 
-					const uint32_t Side, 
-					const FBlock BlockType,
-					FChunkMesh::VertexData& VerticesOut,
-					FChunkMesh::IndexData& IndicesOut);
+	void GreedyMesh(const FBlock* Blocks, const NeighborBorders& Neighbors, const uint8_t* Light, const uint32_t SectionMask);
+
+	/**
+	* Downsamples blocks into cells of 2^LODLevel blocks. A cell is solid if any of its
+	* blocks are, so coarse meshes never open gaps against finer neighbors, and takes the
+	* most common solid block type in the cell.
+	* @param LODLevel - The detail level, within [1, LOD_LEVELS).
+	* @param Blocks - BLOCKS_PER_CHUNK blocks in the layout of mBlocks. Each cell's type is written to all of its blocks.
+	*/
+	static void DownsampleBlocks(const uint32_t LODLevel, FBlock* Blocks);
+
+	/**
+	* The mesh of the chunk, allocated on first use. Only called by the thread building the mesh.
+	*/
+	FChunkMesh& AcquireMesh();
+
+	/**
+	* Gives the mesh back to its pool once it neither draws nor waits to be swapped
+	* in, so slots holding only air hold no mesh. Only called by the thread swapping meshes.
+	*/
+	void ReleaseEmptyMesh();
+
+	/**
+	* Flood fills the blocks of the chunk that aren't opaque to find which faces are joined through them.
+	* @param Blocks - The BLOCKS_PER_CHUNK blocks of the chunk, in the layout of mBlocks.
+	* @return The FaceConnection bits of every pair of faces touched by the same open region.
+	*/
+	static uint32_t FindFaceConnections(const FBlock* Blocks);
+
+	/**
+	* A copy of the chunk's blocks to edit and publish. Called with mBlockMutex held.
+	*/
+	FBlockStorage* CopyBlocks() const;
+
+	/**
+	* Replaces the chunk's blocks, retiring the storage they replace to BlockEpochs. Called with mBlockMutex held.
+	* @param Blocks - The new blocks, owned by the chunk from now on, or AirBlocks.
+	*/
+	void PublishBlocks(const FBlockStorage* Blocks);
+
+	/**
+	* Checks if the blocks of a generation are still published once meshed. Sections meshed
+	* from replaced blocks are marked dirty again.
+	* @param Generation - The block generation read before the blocks were.
+	* @param SectionMask - Bits of the sections meshed from them.
+	*/
+	bool IsSnapshotCurrent(const uint32_t Generation, const uint32_t SectionMask);
 
 private:
-	FBlock* mBlocks;
-	FChunkMesh* mMesh;
-	CollisionData* mCollisionData;
+	// Blocks of every unloaded and all air chunk, never retired
+	static const FBlockStorage AirBlocks;
+
+	std::atomic<const FBlockStorage*> mBlocks; // Never written once published, see GetPublishedBlocks
+	std::atomic<uint32_t> mBlockGeneration;    // Advanced after each publish of mBlocks
+	mutable std::mutex mBlockMutex; // Serializes loads and edits, which publish new blocks
+	FChunkLight mLight;
+	std::atomic<FChunkMesh*> mMesh; // Null while the slot has no geometry, see AcquireMesh
+	MeshPool* mMeshPool;            // Where mMesh is allocated from
 
 	std::atomic_bool mIsLoaded;
 	std::atomic_bool mIsEmpty;
-};
\ No newline at end of file
+	std::atomic<uint32_t> mMeshLOD;
+	std::atomic<uint32_t> mDirtySections;    // Mesh sections waiting for RebuildMesh
+	std::atomic<uint32_t> mFaceConnections;  // Set when meshed, see GetFaceConnections
+	std::atomic<uint32_t> mLoadCount;
+	std::atomic<uint32_t> mModifyCount;      // Incremented with each block edit
+	std::atomic<uint32_t> mSavedModifyCount; // Modify count of the blocks on file
+	uint32_t mMeshRevision;                  // Only used by the thread swapping meshes
+};
+
+template <typename Function>
+inline void FChunk::ReadBlocks(const Function& Reader) const
+{
+	std::lock_guard<std::mutex> Lock(mBlockMutex);
+	Reader(*mBlocks.load());
+}
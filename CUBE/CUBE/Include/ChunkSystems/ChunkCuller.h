@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Rendering\ShaderProgram.h"
+
+class FChunkDrawList;
+class FFrustum;
+class FHiZBuffer;
+
+/**
+* Culls an uploaded chunk draw list on the GPU. A compute pass tests each
+* chunk's bounds against the view frustum and a Hi-Z depth pyramid, and
+* sets the instance count of culled draws to 0 in the indirect buffer.
+*/
+class FChunkCuller
+{
+public:
+	FChunkCuller();
+
+	FChunkCuller(const FChunkCuller& Other) = delete;
+	FChunkCuller& operator=(const FChunkCuller& Other) = delete;
+
+	/**
+	* Culls every draw in a draw list. The list must be uploaded. Leaves
+	* the culling program active.
+	* @param DrawList - The list to cull.
+	* @param WorldFrustum - The view frustum in world coordinates.
+	* @param HiZBuffer - Depth pyramid for occlusion tests. Only the frustum is tested if it is not valid.
+	*/
+	void Cull(const FChunkDrawList& DrawList, const FFrustum& WorldFrustum, const FHiZBuffer& HiZBuffer);
+
+private:
+	FShaderProgram mCullingProgram;
+
+	// Uniforms of ChunkCulling.comp
+	FShaderProgram::UniformHandle mDrawCountUniform;
+	FShaderProgram::UniformHandle mChunkSizeUniform;
+	FShaderProgram::UniformHandle mFrustumPlanesUniform;
+	FShaderProgram::UniformHandle mUseHiZUniform;
+	FShaderProgram::UniformHandle mHiZViewProjectionUniform;
+	FShaderProgram::UniformHandle mHiZUVScaleUniform;
+};
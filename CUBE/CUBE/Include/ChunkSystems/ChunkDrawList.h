@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GL\glew.h"
+#include "Math\Vector3.h"
+
+class FChunkGeometryArena;
+
+/**
+* Collects chunk draws for a frame and submits them with a single
+* glMultiDrawArraysIndirect call. Draws have no index buffer, each quad
+* is drawn as 6 vertices expanded from the quad buffer of the geometry
+* arena. Chunk origins are stored in a per-instance attribute buffer
+* that is indexed with each command's base instance, so several draws
+* of one chunk can share an origin.
+*/
+class FChunkDrawList
+{
+public:
+	/**
+	* Layout of a GL indirect arrays draw command.
+	*/
+	struct DrawCommand
+	{
+		uint32_t VertexCount;
+		uint32_t InstanceCount;
+		uint32_t FirstVertex;  // Of the first quad, so the shader finds the quad from gl_VertexID
+		uint32_t BaseInstance;
+	};
+
+public:
+	FChunkDrawList();
+
+	/**
+	* Deletes the command and origin buffers.
+	*/
+	~FChunkDrawList();
+
+	FChunkDrawList(const FChunkDrawList& Other) = delete;
+	FChunkDrawList& operator=(const FChunkDrawList& Other) = delete;
+
+	/**
+	* Removes all draws from the list.
+	*/
+	void Clear();
+
+	/**
+	* Adds a chunk origin to the list.
+	* @param Origin - The world position of the chunk.
+	* @return The index used to draw with the origin.
+	*/
+	uint32_t AddOrigin(const Vector3i& Origin);
+
+	/**
+	* Adds a chunk draw to the list.
+	* @param QuadCount - The number of quads to draw.
+	* @param FirstQuad - The first quad to draw in the geometry arena.
+	* @param OriginIndex - The index of the chunk origin returned by AddOrigin.
+	*/
+	void AddDraw(const uint32_t QuadCount, const uint32_t FirstQuad, const uint32_t OriginIndex);
+
+	/**
+	* Uploads the draw list to its GL buffers. Must be called before
+	* the list is culled or drawn.
+	*/
+	void Upload();
+
+	/**
+	* Draws every chunk in the last uploaded list. Draws with an
+	* instance count of 0 are skipped by the GPU.
+	* @param GeometryArena - The arena holding the quad data for all draws.
+	* @param RenderMode - The primitive mode used for drawing.
+	*/
+	void Draw(const FChunkGeometryArena& GeometryArena, const GLenum RenderMode) const;
+
+	/**
+	* The number of draws in the list.
+	*/
+	uint32_t GetDrawCount() const { return mCommands.size(); }
+
+	/**
+	* The GL buffer holding DrawCommands for the uploaded list.
+	*/
+	GLuint GetCommandBuffer() const { return mCommandBuffer; }
+
+	/**
+	* The GL buffer holding packed Vector3f origins for the uploaded list.
+	*/
+	GLuint GetOriginBuffer() const { return mOriginBuffer; }
+
+private:
+	std::vector<DrawCommand> mCommands;
+	std::vector<Vector3f>    mOrigins;
+	GLuint                   mCommandBuffer;
+	GLuint                   mOriginBuffer;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Math\Vector3.h"
+#include "Math\Quaternion.h"
+
+namespace Atlas
+{
+	class FGameObject;
+}
+
+/**
+* Game objects bound to the chunk they are in, which only exist while that chunk is
+* loaded. Bound objects found in a chunk that isn't loaded have their state parked by
+* chunk and are despawned, the chunk's entities are spawned again once it is loaded.
+* Each entity has a type, registered by its owner, that spawns and despawns its objects.
+* Every parked and bound entity is saved with the world. Only the main thread binds,
+* parks and resumes, between physics steps. Any thread may save meanwhile.
+*/
+class FChunkEntities
+{
+public:
+	/**
+	* What is kept of an entity while it is parked.
+	*/
+	struct State
+	{
+		Vector3f    Position;
+		FQuaternion Rotation;
+		Vector3f    Velocity;        // Of the rigidbody, zero without one
+		Vector3f    AngularVelocity;
+	};
+
+	using SpawnFunction = std::function<Atlas::FGameObject*(const State& Saved)>;
+	using DespawnFunction = std::function<void(Atlas::FGameObject& GameObject)>;
+	using ResidencyFunction = std::function<bool(const Vector3i& ChunkPosition)>;
+
+public:
+	FChunkEntities();
+
+	FChunkEntities(const FChunkEntities& Other) = delete;
+	FChunkEntities& operator=(const FChunkEntities& Other) = delete;
+
+	/**
+	* Despawns every bound object and loads the entities saved with a world as parked.
+	* @param WorldName - The name of the world.
+	*/
+	void Open(const wchar_t* WorldName);
+
+	/**
+	* Keeps the state of every bound and parked entity for the next save.
+	*/
+	void Snapshot();
+
+	/**
+	* Saves the entities of the last snapshot with the world last opened.
+	* @return False if the entities could not be written.
+	*/
+	bool Save() const;
+
+	/**
+	* Registers how entities of a type are spawned and despawned.
+	* @param Name - The name the type is saved by.
+	* @param Spawn - Creates an object from a parked state, returning null if it can't.
+	* @param Despawn - Takes back an object once its state is parked.
+	*/
+	void RegisterType(const std::string& Name, SpawnFunction Spawn, DespawnFunction Despawn);
+
+	/**
+	* Unbinds the objects of a type, whose entities stay parked until it is registered again.
+	*/
+	void UnregisterType(const std::string& Name);
+
+	/**
+	* Binds an object to the chunk it is in. Bound objects must be unbound before they are destroyed.
+	* @param Type - The registered type of the entity.
+	*/
+	void Bind(Atlas::FGameObject& GameObject, const std::string& Type);
+
+	void Unbind(Atlas::FGameObject& GameObject);
+
+	/**
+	* Parks and despawns the bound objects outside of chunks that are loaded.
+	* Inactive objects are left alone, such as despawned pooled objects.
+	* @param IsResident - If the chunk at a chunk space position is loaded.
+	* @param IsInWorld - If a chunk is in the world, entities leaving it are dropped.
+	*/
+	void Park(const ResidencyFunction& IsResident, const ResidencyFunction& IsInWorld);
+
+	/**
+	* Spawns the parked entities of a chunk that was loaded, those of unregistered types stay parked.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	*/
+	void Resume(const Vector3i& ChunkPosition);
+
+	/**
+	* The number of bound objects.
+	*/
+	uint32_t GetBoundCount() const { return mBound.size(); }
+
+	/**
+	* The number of parked entities.
+	*/
+	uint32_t GetParkedCount() const;
+
+private:
+	// Hash functor for the parked entities
+	struct Vector3iHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	struct EntityType
+	{
+		std::string     Name;
+		SpawnFunction   Spawn;   // Null while the type is unregistered
+		DespawnFunction Despawn;
+	};
+
+	struct ParkedEntity
+	{
+		uint32_t Type; // Index into mTypes
+		State    Saved;
+	};
+
+	/**
+	* The index of a type by name, added unregistered if it's new.
+	*/
+	uint32_t FindType(const std::string& Name);
+
+	static State Capture(Atlas::FGameObject& GameObject);
+
+private:
+	std::vector<EntityType>                                               mTypes;
+	std::unordered_map<std::string, uint32_t>                             mTypeIndices;
+	std::unordered_map<Atlas::FGameObject*, uint32_t>                     mBound;    // Type of each bound object
+	std::unordered_map<Vector3i, std::vector<ParkedEntity>, Vector3iHash> mParked;   // By chunk
+	std::vector<uint8_t>                                                  mSaveData; // Entities at the last snapshot, as written on file
+	std::vector<Atlas::FGameObject*>                                      mLeaving;
+	std::wstring                                                          mFilepath;
+	mutable std::mutex                                                    mMutex;    // Held while using the save data
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "GL\glew.h"
+#include "Chunk.h"
+#include "ChunkMesh.h"
+#include "ChunkGeometryArena.h"
+#include "Rendering\ShaderProgram.h"
+#include "Memory\MemoryStats.h"
+
+/**
+* Meshes chunks with a compute shader, so workers only gather the blocks, light
+* and borders of a chunk. Chunks are meshed in batches of BATCH_SIZE. A batch
+* uploads its chunks, counts the quads of each face direction of every section
+* with atomic counters, and reads the counts back behind a fence. Once the fence
+* has passed, the quads are copied into ranges of the geometry arena on the GPU,
+* so quad data never returns to the CPU.
+*
+* The shader builds a quad for every visible face, lit and occluded as the CPU
+* mesher does, but doesn't merge faces, so meshes hold more quads than greedy
+* meshes. Only detail level 0 is built.
+*/
+class FChunkGPUMesher
+{
+public:
+	/**
+	* Everything a chunk is meshed from, in the layout read by ChunkMeshing.comp.
+	*/
+	struct ChunkInput
+	{
+		uint32_t                SectionMask;                      // Bits of the sections to build
+		uint8_t                 Blocks[FChunk::BLOCKS_PER_CHUNK]; // Unpacked blocks, in the layout of the chunk's blocks
+		uint8_t                 Light[FChunk::BLOCKS_PER_CHUNK];  // Packed FChunkLight levels of each block
+		FChunk::NeighborBorders Neighbors;
+	};
+
+	/**
+	* A chunk to mesh.
+	*/
+	struct Request
+	{
+		uint32_t   Index;  // Chunk slot
+		uint32_t   Serial; // Mesh serial of the slot when requested. Meshes of older serials are dropped.
+		ChunkInput Input;
+	};
+
+	/**
+	* Sections meshed for a chunk. Each section's quads are held by an arena range.
+	*/
+	struct Result
+	{
+		uint32_t                        Index;
+		uint32_t                        SectionMask;
+		FChunkGeometryArena::Allocation Allocations[FChunkMesh::SECTION_COUNT];
+		FChunkMesh::FaceRanges          Ranges[FChunkMesh::SECTION_COUNT];
+	};
+
+	// Chunks meshed by each dispatch
+	static const uint32_t BATCH_SIZE = 8;
+
+	// Batches that can be in flight at once
+	static const uint32_t BATCH_COUNT = 2;
+
+	// The shader reads each border row as a uint, so chunks wider than 32 blocks are only meshed on workers
+	static const bool IS_SUPPORTED = (FChunk::CHUNK_SIZE <= 32);
+
+public:
+	/**
+	* Builds the meshing program and the buffers of every batch.
+	*/
+	FChunkGPUMesher();
+
+	/**
+	* Deletes the buffers and fences of every batch.
+	*/
+	~FChunkGPUMesher();
+
+	FChunkGPUMesher(const FChunkGPUMesher& Other) = delete;
+	FChunkGPUMesher& operator=(const FChunkGPUMesher& Other) = delete;
+
+	/**
+	* Dispatches requests in every batch that isn't in flight.
+	* @param Requests - Requests to take from, front first. Requests that don't fit are left for a later dispatch.
+	*/
+	void Dispatch(std::deque<std::unique_ptr<Request>>& Requests);
+
+	/**
+	* Copies the meshes of finished batches into the geometry arena, without waiting.
+	* @param GeometryArena - The arena holding chunk quad data.
+	* @param Serials - The current mesh serial of each chunk slot. Meshes requested with another serial are dropped.
+	* @param ResultsOut - To add the meshes of the finished requests to. Their arena ranges must be taken by the chunks.
+	*/
+	void Complete(FChunkGeometryArena& GeometryArena, const std::vector<uint32_t>& Serials, std::vector<Result>& ResultsOut);
+
+	/**
+	* Drops every batch in flight, so none of their meshes are returned.
+	*/
+	void DropBatches();
+
+private:
+	/**
+	* Chunks meshed by a single dispatch, and the buffers they are meshed with.
+	*/
+	struct Batch
+	{
+		GLsync   Fence;          // Null when not in flight
+		uint32_t ChunkCount;
+		uint32_t Indices[BATCH_SIZE];
+		uint32_t Serials[BATCH_SIZE];
+		uint32_t SectionMasks[BATCH_SIZE];
+		GLuint   InputBuffer;    // A ChunkInput for each chunk
+		GLuint   CountBuffer;    // Quads of each face direction of each section
+		GLuint   QuadBuffer;     // Quads of each face direction of each section, at fixed offsets
+		GLuint   ReadbackBuffer; // Counts copied for the CPU
+	};
+
+private:
+	FShaderProgram mMeshingProgram;
+	Batch          mBatches[BATCH_COUNT];
+	uint32_t       mNextBatch;   // Batches are dispatched and completed in order
+	FTrackedBytes  mBufferBytes; // Size of every batch's buffers
+};
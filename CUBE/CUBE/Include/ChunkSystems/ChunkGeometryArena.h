@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "GL\glew.h"
+#include "Memory\MemoryStats.h"
+
+class FUploadRing;
+
+/**
+* A single GL buffer of quad records shared by all chunk meshes. Chunks sub-allocate
+* ranges from a free list and draw from their first quad, so every chunk is drawn
+* with one VAO and storage buffer bind. Vertex shaders read the quads from the
+* buffer, see Shaders/ChunkQuad.glsl, and the VAO only reads the chunk origin of
+* each draw from a per-instance buffer. The buffer grows when an allocation does not fit.
+*
+* Allocations are rounded up to size classes, eight for each power of two, and
+* placed in the smallest free range that fits, so the ranges freed by streamed
+* out meshes are reused by meshes of the same class. Allocations are handles to
+* the arena's table of ranges, so Compact can move live quads to the front of
+* the buffer with a GPU copy and only the table changes. Draws read the first
+* quad through the table each time they are built. The buffer shrinks again
+* once compaction leaves most of it unused.
+*/
+class FChunkGeometryArena
+{
+public:
+	/**
+	* A range of quads within the arena.
+	*/
+	struct Allocation
+	{
+		uint32_t ID;    // Entry of the arena's range table, see GetFirstQuad
+		uint32_t Count; // Number of quads reserved, 0 if nothing is allocated
+	};
+
+	/**
+	* How full and how fragmented the arena is.
+	*/
+	struct Stats
+	{
+		uint32_t Capacity;         // Quads the buffer holds
+		uint32_t UsedCount;        // Quads reserved by allocations
+		uint32_t AllocationCount;
+		uint32_t FreeRangeCount;
+		uint32_t LargestFreeRange; // In quads
+		uint32_t HighWater;        // Quad after the last allocation
+		float    Utilization;      // Share of the capacity that is reserved
+		float    Fragmentation;    // Share of the space below the high water mark that is free
+		uint64_t BytesMoved;       // By compaction since the arena was created
+	};
+
+	// Bytes Compact moves in a frame by default
+	static const uint32_t DEFAULT_COMPACTION_BYTES = 4 * 1024 * 1024;
+
+public:
+	/**
+	* Creates the arena buffers and vertex array.
+	* @param QuadCapacity - The initial number of quads the arena can hold.
+	*/
+	FChunkGeometryArena(const uint32_t QuadCapacity);
+
+	/**
+	* Deletes all GL objects held by the arena.
+	*/
+	~FChunkGeometryArena();
+
+	FChunkGeometryArena(const FChunkGeometryArena& Other) = delete;
+	FChunkGeometryArena& operator=(const FChunkGeometryArena& Other) = delete;
+
+	/**
+	* Reserves a range of quads, growing the arena if needed.
+	* @param QuadCount - The number of quads needed. Must be larger than 0.
+	*/
+	Allocation Allocate(const uint32_t QuadCount);
+
+	/**
+	* Returns a range to the arena. Empty allocations are ignored.
+	*/
+	void Free(const Allocation& Range);
+
+	/**
+	* The quad an allocation currently starts at. Changes when the arena is compacted,
+	* so draws must look it up each time they are built.
+	*/
+	uint32_t GetFirstQuad(const Allocation& Range) const { return mBlocks[Range.ID].Offset; }
+
+	/**
+	* Moves the last allocations of the buffer into free ranges nearer its front, and
+	* shrinks the buffer once less than half of it is below the high water mark. Moves
+	* start once a quarter of the space below the high water mark is free, and stop
+	* once a tenth is. Call once a frame, between building draws.
+	* @param MaxBytes - The most quad data to copy.
+	* @return The number of bytes copied.
+	*/
+	uint32_t Compact(const uint32_t MaxBytes);
+
+	/**
+	* How full and how fragmented the arena is.
+	*/
+	Stats GetStats() const;
+
+	/**
+	* Uploads quad data into an allocated range.
+	* @param Range - The range to fill.
+	* @param Data - The quad data.
+	* @param DataSize - The size of the data in bytes. Must fit within the range.
+	* @param UploadRing - Staging ring used for the upload.
+	*/
+	void Upload(const Allocation& Range, const void* Data, const GLsizeiptr DataSize, FUploadRing& UploadRing);
+
+	/**
+	* Copies quad data from another GL buffer into an allocated range, on the GPU.
+	* @param Range - The range to fill.
+	* @param FirstQuad - The quad of the range to copy to.
+	* @param SourceBuffer - The buffer holding the quad data.
+	* @param SourceOffset - The offset of the quad data in bytes.
+	* @param QuadCount - The number of quads to copy. Must fit within the range.
+	*/
+	void Copy(const Allocation& Range, const uint32_t FirstQuad, const GLuint SourceBuffer, const GLintptr SourceOffset, const uint32_t QuadCount);
+
+	/**
+	* Binds the arena vertex array and quad buffer for drawing chunk meshes.
+	*/
+	void Bind() const;
+
+	/**
+	* Sets the buffer chunk origins are read from, one per draw instance.
+	* The arena must be bound.
+	* @param OriginBuffer - A buffer of Vector3f origins.
+	*/
+	void SetDrawOrigins(const GLuint OriginBuffer) const;
+
+	/**
+	* The number of quads the arena can hold before growing.
+	*/
+	uint32_t GetCapacity() const { return mCapacity; }
+
+	/**
+	* The number of quads reserved by allocations.
+	*/
+	uint32_t GetUsedCount() const { return mUsedCount; }
+
+private:
+	/**
+	* Reallocates the quad buffer with more space, keeping all current data.
+	* @param MinCapacity - The minimum quad capacity after growing.
+	*/
+	void Grow(const uint32_t MinCapacity);
+
+	/**
+	* Reallocates the quad buffer, keeping the data below the new capacity.
+	* @param NewCapacity - The quad capacity, at least the high water mark.
+	*/
+	void Resize(const uint32_t NewCapacity);
+
+	/**
+	* Adds a free range, merged with the free ranges next to it.
+	*/
+	void AddFreeRange(uint32_t Offset, uint32_t Count);
+
+	/**
+	* Takes a range out of a free range, leaving the rest of it free.
+	* @param FreeRange - The free range, at least Count long.
+	*/
+	void TakeFreeRange(std::map<uint32_t, uint32_t>::iterator FreeRange, const uint32_t Offset, const uint32_t Count);
+
+	/**
+	* The quad after the last allocation.
+	*/
+	uint32_t GetHighWater() const;
+
+private:
+	struct Block
+	{
+		uint32_t Offset; // First quad
+		uint32_t Count;
+	};
+
+	std::map<uint32_t, uint32_t> mFreeRanges; // Free quad ranges, offset to count
+	std::set<std::pair<uint32_t, uint32_t>> mFreeSizes; // Count and offset of each free range, for the smallest fit
+	std::map<uint32_t, uint32_t> mLiveRanges; // First quad to ID of each allocation, for compaction
+	std::vector<Block>    mBlocks;   // Range of each allocation by ID
+	std::vector<uint32_t> mFreeIDs;  // IDs of mBlocks that can be reused
+	GLuint   mVertexArray;
+	GLuint   mQuadBuffer;
+	uint32_t mInitialCapacity; // The buffer doesn't shrink below this
+	uint32_t mCapacity;
+	uint32_t mUsedCount;
+	uint64_t mBytesMoved;
+	bool     mIsCompacting;
+	FTrackedBytes mBufferBytes; // Size of the quad buffer
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "Misc\Assertions.h"
+
+/**
+* Light levels of every block in a chunk. Each block holds a sky light
+* level in its high 4 bits and a block light level in its low 4 bits.
+* Chunks lit by a single level, like open sky or solid ground, hold no
+* per block levels at all.
+*/
+class FChunkLight
+{
+public:
+	// Highest level of either light channel
+	static const uint8_t MAX_LEVEL = 15;
+
+	/**
+	* Constructs light of a single level.
+	* @param BlockCount - The number of blocks held.
+	* @param Levels - The packed light of every block.
+	*/
+	FChunkLight(const uint32_t BlockCount, const uint8_t Levels = 0);
+
+	FChunkLight(const FChunkLight& Other) = delete;
+	FChunkLight& operator=(const FChunkLight& Other) = delete;
+
+	/**
+	* Packs sky and block light levels into a single byte.
+	*/
+	static uint8_t PackLevels(const uint8_t Sky, const uint8_t Block) { return (uint8_t)((Sky << 4) | Block); }
+
+	static uint8_t GetSky(const uint8_t Levels) { return Levels >> 4; }
+
+	static uint8_t GetBlock(const uint8_t Levels) { return Levels & 0xF; }
+
+	/**
+	* Retrieves the packed light of a block.
+	*/
+	uint8_t Get(const uint32_t Index) const;
+
+	/**
+	* Sets the packed light of a block. Per block levels are allocated the
+	* first time a block differs from the rest.
+	*/
+	void Set(const uint32_t Index, const uint8_t Levels);
+
+	/**
+	* Sets every block to a single level and frees per block levels.
+	*/
+	void Fill(const uint8_t Levels);
+
+	/**
+	* Replaces every level from a plain array. Per block levels are only kept
+	* if the array holds more than one level.
+	* @param Levels - The packed light to store. Must hold the block count.
+	*/
+	void Pack(const uint8_t* Levels);
+
+	/**
+	* Expands every level into a plain array.
+	* @param LevelsOut - Location to place the packed light. Must hold the block count.
+	*/
+	void Unpack(uint8_t* LevelsOut) const;
+
+	/**
+	* Exchanges levels with light of the same block count.
+	*/
+	void Swap(FChunkLight& Other);
+
+	/**
+	* Checks if every block has a single level.
+	*/
+	bool IsUniform() const { return !mLevels; }
+
+private:
+	std::unique_ptr<uint8_t[]> mLevels; // Null when uniform
+	uint32_t                   mBlockCount;
+	uint8_t                    mUniformLevels;
+};
+
+inline uint8_t FChunkLight::Get(const uint32_t Index) const
+{
+	ASSERT(Index < mBlockCount);
+	return mLevels ? mLevels[Index] : mUniformLevels;
+}
@@ -2,38 +2,174 @@
 
 #include <vector>
 #include <queue>
+#include <memory>
 #include <unordered_map>
 #include <string>
 #include <thread>
 #include <mutex>
+#include <functional>
+#include <random>
 
 #include "Chunk.h"
+#include "ChunkWorkerPool.h"
+#include "ChunkGeometryArena.h"
+#include "ChunkDrawList.h"
+#include "ChunkCuller.h"
+#include "ChunkGPUMesher.h"
+#include "ChunkUploader.h"
+#include "FarTerrain.h"
+#include "BlockVolume.h"
+#include "LightPropagator.h"
+#include "ChunkMeshCache.h"
+#include "ChunkPipelineStats.h"
+#include "ColumnHeights.h"
+#include "BlockTickScheduler.h"
+#include "ChunkEntities.h"
+#include "FluidSimulator.h"
+#include "VoxelTerrainShape.h"
 #include "LibNoise\noise.h"
 #include "LibNoise\noiseutils.h"
 #include "Utils/Singleton.h"
 #include "FileIO\WorldFileSystem.h"
+#include "FileIO\ChunkIOQueue.h"
+#include "FileIO\EditJournal.h"
 #include "BlockTypes.h"
 #include "Utils\Event.h"
 #include "Math\Frustum.h"
+#include "Math\Ray.h"
+#include "Math\FMath.h"
+#include "Memory\MemoryUtil.h"
+#include "Rendering\UploadRing.h"
 
+class FCamera;
 class FPhysicsSystem;
 class FRenderSystem;
+class FWorldGenerator;
 
 /**
 * Class for managing a world.
 */
+WIN_ALIGN(16)
 class FChunkManager
 {
 public:
-	FChunkManager();
+	ALIGNED_ALLOC(16);
+
+	/**
+	* Reports save progress. Called from the save thread.
+	* @param ChunksSaved - The number of chunks written so far.
+	* @param ChunkCount - The number of modified chunks being saved.
+	*/
+	using SaveProgressCallback = std::function<void(uint32_t ChunksSaved, uint32_t ChunkCount)>;
+
+	/**
+	* Reports warmup progress, such as to a loading screen. Called from the main thread.
+	* @param ChunksReady - The chunks of the spawn area loaded, lit and swapped in.
+	* @param ChunkCount - The chunks in the spawn area.
+	*/
+	using WarmupProgressCallback = std::function<void(uint32_t ChunksReady, uint32_t ChunkCount)>;
+
+	/**
+	* A block to set with ApplyEdits.
+	*/
+	using BlockEdit = FEditJournal::Edit;
+
+	/**
+	* Ticks a block. Edits added to EditsOut are applied with every other edit
+	* of the tick through ApplyEdits. Called on the main thread.
+	* @param Position - The world position of the block.
+	* @param ID - The type of the block.
+	* @param EditsOut - To add the blocks the tick sets.
+	*/
+	using BlockTickHandler = std::function<void(const Vector3i& Position, const FBlockTypes::BlockID ID, std::vector<BlockEdit>& EditsOut)>;
+
+	/**
+	* A block changed by ApplyEdits or a region operation.
+	*/
+	struct BlockChange
+	{
+		Vector3i             Position;
+		FBlockTypes::BlockID PreviousID;
+		FBlockTypes::BlockID ID;
+	};
+
+	/**
+	* The first collidable block along a ray, found by Raycast.
+	*/
+	struct RaycastHit
+	{
+		Vector3i             Position; // World position of the block
+		Vector3i             Normal;   // Normal of the face the ray entered through. Zero if the ray starts inside the block.
+		float                Distance; // Distance along the ray to the face
+		FBlockTypes::BlockID ID;
+	};
+
+	/**
+	* A snapshot of the chunk streaming pipeline, taken by GetStats.
+	*/
+	struct Stats
+	{
+		uint32_t LoadListDepth;    // Chunks waiting to be read
+		uint32_t ReadQueueDepth;   // Reads waiting on the I/O thread
+		uint32_t PendingJobs;      // Load and rebuild jobs waiting on or running on workers
+		uint32_t RebuildListDepth; // Chunks waiting to have a rebuild submitted
+		uint32_t SwapQueueDepth;   // Meshes waiting to be uploaded, edited ones included
+		FChunkPipelineStats::Rates  Rates;
+		FChunkPipelineStats::Timing Stages[EChunkStage::Count];
+		FChunkPipelineStats::Timing VisibleToDraw; // From being queued for load until the chunk's mesh is swapped in
+		FChunkGeometryArena::Stats  Geometry;      // Zero when headless
+
+		/**
+		* Checks if the pipeline has no work left, so nothing streams in.
+		*/
+		bool IsIdle() const
+		{
+			return LoadListDepth == 0 && ReadQueueDepth == 0 && PendingJobs == 0 && RebuildListDepth == 0 && SwapQueueDepth == 0;
+		}
+	};
+
+	/**
+	* Where the time went from loading the world until it could be played, see WarmUp.
+	* Stage times are summed over every thread, so they may add up to more than the warmup.
+	*/
+	struct StartupTimings
+	{
+		float    WorldOpenMs;  // Opening the world's files in LoadWorld
+		float    WarmupMs;     // Streaming in the spawn area
+		float    ReadMs;       // In each stage during the warmup
+		float    DecodeMs;
+		float    MeshMs;
+		float    UploadMs;
+		float    FirstFrameMs; // From LoadWorld until the end of the first frame, 0 until then
+		uint32_t ChunkCount;   // In the spawn area
+	};
+
+public:
+	/**
+	* Ctor
+	* @param IsHeadless - If chunks are only simulated. Headless managers build no
+	*                     meshes and make no GL calls, so they need no GL context
+	*                     and can't be rendered. Collision reads the blocks either way.
+	*/
+	explicit FChunkManager(const bool IsHeadless = false);
 	~FChunkManager();
 
+	bool IsHeadless() const { return mIsHeadless; }
+
 	/**
 	* Updates chunk information. This function should be called
-	* during each game loop.
+	* during each game loop. Swaps meshes the renderer reads, so it
+	* must not overlap a frame being submitted on the render thread.
 	*/
 	void Update();
 
+	/**
+	* Builds the chunk draw list and culls it on the GPU against the view of
+	* the renderer's packet and its Hi-Z buffer. Must be called before Render,
+	* and before the chunk shader is made active.
+	*/
+	void PrepareRender(FRenderSystem& Renderer);
+
 	/**
 	* Renders all current visible world geometry.
 	* @brief This function will render what is visible to the 
@@ -42,25 +178,212 @@ public:
 	void Render(FRenderSystem& Renderer, const GLenum RenderMode = GL_TRIANGLES);
 
 	/**
-	* Set a block in the world at a specific position.
+	* Renders the far terrain around the loaded chunks, if it is enabled.
+	* Must be called after Render, with a far terrain shader active.
+	*/
+	void RenderFarTerrain() const;
+
+	/**
+	* Finds the loaded chunks with geometry inside a light's frustum, to cast shadows. These
+	* include chunks hidden from the camera. Must be called after PrepareRender.
+	* @param LightFrustum - The frustum of the light in world space.
+	* @param CastersOut - To put the index of each chunk found.
+	* @return A signature of the chunks found and their meshes. It changes when a chunk
+	*         enters or leaves the frustum, or when the mesh of one of them is swapped.
+	*/
+	uint64_t CullShadowCasters(const FFrustum& LightFrustum, std::vector<uint32_t>& CastersOut);
+
+	/**
+	* Renders the chunks found by CullShadowCasters. A depth shader must be active.
+	* @param Casters - Chunks found by CullShadowCasters this frame.
+	* @param LightDirection - The direction the light shines in. Only faces toward the light are drawn.
+	* @param DrawList - List to build the draws in.
+	*/
+	void RenderShadowCasters(const std::vector<uint32_t>& Casters, const Vector3f& LightDirection, FChunkDrawList& DrawList);
+
+	/**
+	* Set a block in the world at a specific position. Block positions
+	* are signed, chunks below zero extend to negative positions.
 	*/
 	void SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID);
 
 	/**
-	* Retrieves the type of block in the world at a specific position.
+	* Retrieves the type of block in the world at a specific position. Safe to call from any
+	* thread, blocks of chunks that aren't loaded are air. Threads reading many blocks should
+	* read through a BlockReader instead, which pins once for all of its reads.
 	*/
 	FBlockTypes::BlockID GetBlock(Vector3i Position) const;
 
+	/**
+	* Reads blocks without locks from any thread while chunks stream in and out, see below.
+	*/
+	class BlockReader;
+
 	/**
 	* Destroys a block in the world at a specific position.
 	*/
 	void DestroyBlock(const Vector3i& Position);
 
 	/**
-	* Retrieves the size of the world in chunks.
+	* The height of the surface of a block column, kept as blocks are loaded and edited.
+	* Columns whose top lies in chunks that aren't loaded may read higher than their surface.
+	* @param X, Z - The world position of the column.
+	* @return One above the top solid block, or FColumnHeights::NO_SURFACE if none is known.
+	*/
+	int32_t GetSurfaceHeight(const int32_t X, const int32_t Z) const { return mColumnHeights.GetHeight(X, Z); }
+
+	/**
+	* Sets the handler that scheduled ticks of a block type call. Ticks of blocks
+	* whose type has no handler when they are due are dropped.
+	* @param ID - The block type.
+	* @param Handler - The handler, or null to remove it.
+	* @param PlacedDelay - Ticks after a block of the type is set that it ticks. 0 to only tick when scheduled.
+	*/
+	void SetBlockTickHandler(const FBlockTypes::BlockID ID, BlockTickHandler Handler, const uint32_t PlacedDelay = 0);
+
+	/**
+	* Sets the handler that random ticks of a block type call. Each tick, a few
+	* random blocks of every section of the chunks near the camera are ticked.
+	* @param ID - The block type.
+	* @param Handler - The handler, or null to remove it.
+	*/
+	void SetRandomTickHandler(const FBlockTypes::BlockID ID, BlockTickHandler Handler);
+
+	/**
+	* Schedules a block to tick. Ticks are kept while the block's chunk is
+	* unloaded and saved with the world.
+	* @param Position - The world position of the block.
+	* @param Delay - Ticks until the block ticks, 20 to a second.
+	*/
+	void ScheduleBlockTick(const Vector3i& Position, const uint32_t Delay) { mBlockTicks.Schedule(Position, Delay); }
+
+	/**
+	* Registers a type of entity, game objects that only exist while their chunk is
+	* loaded. Parked entities of the type in loaded chunks are spawned right away.
+	* @param Name - The name the type's entities are saved by.
+	* @param Spawn - Creates an object from a parked state.
+	* @param Despawn - Takes back an object as its chunk unloads.
+	*/
+	void RegisterEntityType(const std::string& Name, FChunkEntities::SpawnFunction Spawn, FChunkEntities::DespawnFunction Despawn);
+
+	/**
+	* Unbinds the objects of an entity type, its parked entities are kept.
+	*/
+	void UnregisterEntityType(const std::string& Name) { mEntities.UnregisterType(Name); }
+
+	/**
+	* Binds a game object to the chunk it is in, so it is parked while that chunk
+	* is unloaded and saved with the world. It must be unbound before it is destroyed.
+	* @param Type - The registered entity type of the object.
+	*/
+	void BindEntity(Atlas::FGameObject& GameObject, const std::string& Type) { mEntities.Bind(GameObject, Type); }
+
+	void UnbindEntity(Atlas::FGameObject& GameObject) { mEntities.Unbind(GameObject); }
+
+	/**
+	* Adds a fluid that flows through the world. Its block types must not be
+	* used by another fluid. Fluids are added before a world is loaded.
+	* @param First - The block type of the fluid's lowest level, the rest follow it.
+	* @param LevelCount - The number of levels including the source block, at least 2.
+	*/
+	void AddFluid(const FBlockTypes::BlockID First, const uint32_t LevelCount) { mFluids.AddFluid(First, LevelCount); }
+
+	/**
+	* Sets many blocks at once. Edits are grouped by chunk, so each chunk is
+	* locked and queued for a rebuild once. mOnBlocksEdited is fired once with
+	* every changed block in place of mOnBlockSet and mOnBlockDestroy. As with
+	* SetBlock, edits to chunks that aren't loaded are dropped.
+	* @param Edits - The blocks to set. Later edits of the same block win.
+	* @param EditCount - The number of edits.
+	*/
+	void ApplyEdits(const BlockEdit* Edits, const uint32_t EditCount);
+
+	/**
+	* Sets if block events are buffered. Buffered changes of SetBlock, DestroyBlock
+	* and ApplyEdits are queued and delivered by Update once per frame on the main
+	* thread, keeping only the final state of each block. mOnBlocksEdited is fired
+	* once per chunk with its changes, mOnBlockSet and mOnBlockDestroy aren't fired.
+	* Changes queued before buffering stops are still delivered by the next Update.
+	*/
+	void SetBufferedBlockEvents(const bool IsBuffered) { mIsBufferingBlockEvents = IsBuffered; }
+
+	/**
+	* Reduces buffered block changes to the final state of each block, as they
+	* are dispatched. Each block keeps the type it had before its first change
+	* and after its last, blocks set back to what they were are dropped.
+	* @param Changes - The changes in the order they were made. Left grouped by chunk, then block.
+	*/
+	static void CoalesceBlockChanges(std::vector<BlockChange>& Changes);
+
+	/**
+	* Sets every block within a box with ApplyEdits.
+	* @param Min, Max - Inclusive corners of the box.
+	*/
+	void FillBox(const Vector3i& Min, const Vector3i& Max, const FBlockTypes::BlockID ID);
+
+	/**
+	* Sets every block within Radius of Center with ApplyEdits.
+	*/
+	void FillSphere(const Vector3i& Center, const int32_t Radius, const FBlockTypes::BlockID ID);
+
+	/**
+	* Sets blocks of one type within a box to another with ApplyEdits.
+	* @param Min, Max - Inclusive corners of the box.
+	* @param From - The type of block to replace.
+	* @param To - The type to replace it with.
+	*/
+	void ReplaceInBox(const Vector3i& Min, const Vector3i& Max, const FBlockTypes::BlockID From, const FBlockTypes::BlockID To);
+
+	/**
+	* Finds the first collidable block along a ray by walking the block grid.
+	* Chunks that aren't loaded or hold no collidable blocks are crossed in one step.
+	* Reads blocks through a BlockReader, so it can be called from any thread.
+	* @param Ray - The ray to cast. The direction doesn't need to be normalized.
+	* @param MaxDistance - The distance along the ray to stop at.
+	* @param HitOut - To put the block that was hit.
+	* @return True if a block was hit.
+	*/
+	bool Raycast(const FRay& Ray, const float MaxDistance, RaycastHit& HitOut) const;
+
+	/**
+	* Raycast reading through a reader the caller pinned, for threads casting several rays.
+	* The reader must be of this manager.
+	*/
+	bool Raycast(const BlockReader& Reader, const FRay& Ray, const float MaxDistance, RaycastHit& HitOut) const;
+
+	/**
+	* Finds the collidable blocks within a box. Blocks of chunks that aren't loaded
+	* are air. Reads blocks through a BlockReader, so it can be called from any thread.
+	* @param Min, Max - Inclusive corners of the box.
+	* @param SolidOut - Location to place a byte for each block of the box, 1 if it is solid. Blocks are ordered by x, then y, then z.
+	*/
+	void GetSolidBlocks(const Vector3i& Min, const Vector3i& Max, uint8_t* SolidOut) const;
+
+	/**
+	* Retrieves the size of the world in chunks. 0 if the world is unbounded.
 	*/
 	int32_t GetWorldSize() const { return mWorldSize; }
 
+	/**
+	* Checks if a chunk position is within the world. Every position is
+	* within an unbounded world.
+	*/
+	bool IsInWorld(const Vector3i& ChunkPosition) const;
+
+	/**
+	* Checks if a chunk has taken its slot, so its blocks can be read and set.
+	*/
+	bool IsChunkLoaded(const Vector3i& ChunkPosition) const;
+
+	/**
+	* Encodes the blocks of a loaded chunk as they are written to file, such as to send them.
+	* @param Compress - If the RLE block layout is compressed with the LZ codec when that makes it smaller.
+	* @param DataOut - Set to the encoded blocks.
+	* @param CodecOut - To put the FChunkCodec::Codec of the data.
+	* @return False if the chunk isn't loaded.
+	*/
+	bool EncodeChunk(const Vector3i& ChunkPosition, const bool Compress, std::vector<uint8_t>& DataOut, uint8_t& CodecOut);
+
 	/**
 	* Loads a new world from file.
 	* @param WorldName - The name of the world to load.
@@ -70,22 +393,212 @@ public:
 	void LoadWorld(const wchar_t* WorldName);
 
 	/**
-	* Save the current world to file. If the world is large, this operation may
-	* take some time due to a large amount of data needing to be copied on file.
+	* Saves the current world to file in the background. Modified chunks are
+	* snapshot and then written on a save thread, leaving the loaded world
+	* untouched. Waits for a save that is still running.
+	* @param OnProgress - Optional callback for save progress.
+	*/
+	void SaveWorld(SaveProgressCallback OnProgress = nullptr);
+
+	/**
+	* Streams in the chunks around FCamera::Main before the first frame, so it doesn't
+	* show the spawn area loading. Blocks until every chunk within the radius is loaded,
+	* lit and meshed on the workers and swapped in without the swap budget. Chunks past
+	* it keep streaming as they would. Must be called from the main thread after LoadWorld.
+	* @param Radius - Chunks from the camera chunk along each axis, clamped to the view distance.
+	* @param OnProgress - Optional callback, called each time readiness is checked.
 	*/
-	void SaveWorld();
+	void WarmUp(const int32_t Radius, WarmupProgressCallback OnProgress = nullptr);
+
+	/**
+	* Records the time to the first frame and logs the startup timings, once for each
+	* LoadWorld. Called by FCubeRoot at the end of each frame.
+	*/
+	void EndFrame();
+
+	/**
+	* Gets the timings of the last LoadWorld and WarmUp.
+	*/
+	const StartupTimings& GetStartupTimings() const { return mStartupTimings; }
+
+	/**
+	* Prints the timings of the last LoadWorld and WarmUp to the console.
+	*/
+	void LogStartupTimings() const;
+
+	/**
+	* Checks if a background save is running.
+	*/
+	bool IsSaving() const { return mIsSaving; }
 
 	/**
 	* Sets the world view distance. This is in terms
-	* of chunk space.
+	* of chunk space. Chunks still in view stay loaded, so only
+	* the chunks entering or leaving the view are loaded or written.
 	*/
 	void SetViewDistance(const uint32_t Distance);
 
+	/**
+	* Sets the vertical view distance, above and below the camera
+	* chunk. This is in terms of chunk space. Only the difference
+	* is loaded, as with SetViewDistance.
+	*/
+	void SetVerticalViewDistance(const uint32_t Distance);
+
+	/**
+	* Sets how far past the view distance loaded chunks are kept. Chunks are only
+	* evicted once they are this many chunks outside the view, so a camera moving
+	* back and forth across a chunk border doesn't unload and reload them.
+	* @param Margin - The margin in chunks, on every axis.
+	*/
+	void SetEvictionMargin(const uint32_t Margin);
+
+	/**
+	* Sets the distance that chunks start using a mesh detail level. This
+	* is in terms of chunk space.
+	* @param Level - The detail level, within [1, FChunk::LOD_LEVELS).
+	* @param Distance - Chunks at least this far from the camera chunk on any axis use the level.
+	*/
+	void SetLODDistance(const uint32_t Level, const uint32_t Distance);
+
+	/**
+	* Sets the number of worker threads used to load and
+	* mesh chunks.
+	* @param Count - The number of workers. Clamped to at least 1.
+	*/
+	void SetWorkerCount(const uint32_t Count);
+
+	/**
+	* Retrieves the number of worker threads used to load and
+	* mesh chunks.
+	*/
+	uint32_t GetWorkerCount() const { return mWorkerCount; }
+
+	/**
+	* Retrieves the number of chunk load and rebuild jobs completed
+	* per second, sampled about once a second.
+	*/
+	float GetJobsPerSecond() const { return mJobsPerSecond; }
+
+	/**
+	* Takes a snapshot of the chunk streaming pipeline. Rates are sampled about
+	* once a second. Must be called from the main thread.
+	*/
+	Stats GetStats();
+
+	/**
+	* Prints a snapshot of the chunk streaming pipeline to the console.
+	*/
+	void LogStats();
+
 	/**
 	* Sets the physics system used by the chunk manager.
 	*/
 	void SetPhysicsSystem(FPhysicsSystem& Physics);
 
+	/**
+	* Sets if the terrain collides through its voxel shape. Without it bodies only collide
+	* with other colliders, such as a mesh built from the blocks for comparison.
+	* @param Flag - True to collide with the terrain, as it does by default.
+	*/
+	void SetTerrainCollision(const bool Flag);
+
+	/**
+	* Sets the generator used for chunks missing from the world's region
+	* files. Generated chunks are written to the world as they are
+	* loaded. Missing chunks are air without a generator.
+	* @param Generator - The generator of a world made with FWorldGenerator::CreateWorld, or nullptr.
+	*/
+	void SetWorldGenerator(const FWorldGenerator* Generator);
+
+	/**
+	* Sets the camera chunks are loaded and culled around, so worlds of one
+	* process can each follow their own view.
+	* @param Camera - The camera, or nullptr to follow FCamera::Main.
+	*/
+	void SetCamera(FCamera* Camera);
+
+	/**
+	* The camera the world follows.
+	*/
+	FCamera* GetCamera() const;
+
+	/**
+	* The number of chunk meshes allocated from this world's pool.
+	*/
+	uint32_t GetMeshCount() const { return mMeshPool.Size(); }
+
+	/**
+	* Sets if built chunk meshes are cached on disk, so chunks streamed back in
+	* unchanged skip meshing. Takes effect when the next world is loaded.
+	*/
+	void SetMeshCaching(const bool IsEnabled) { mUsesMeshCache = IsEnabled; }
+
+	/**
+	* Sets if chunks at detail level 0 are meshed on the GPU by FChunkGPUMesher. Workers then
+	* only gather the blocks, light and borders of a chunk, and the mesh is put in place a frame
+	* or more later without the mesh cache. Coarser levels are always meshed on workers.
+	* Ignored by headless managers, and with chunks FChunkGPUMesher doesn't support.
+	*/
+	void SetGPUMeshing(const bool IsEnabled) { mUsesGPUMeshing = IsEnabled && FChunkGPUMesher::IS_SUPPORTED; }
+
+	/**
+	* Sets if swapped meshes are uploaded by FChunkUploader on a thread of its own, and put
+	* in place a frame or more later, instead of being copied to the driver while swapping.
+	* Meshes built on the GPU are already there, so this is ignored while GPU meshing.
+	* Ignored by headless managers.
+	*/
+	void SetBackgroundUploads(const bool IsEnabled) { mUsesBackgroundUploads = IsEnabled; }
+
+	/**
+	* Sets if a coarse heightmap of the world generator's surface is drawn past the view
+	* distance by FFarTerrain. Worlds without a generator have no far terrain.
+	*/
+	void SetFarTerrain(const bool IsEnabled) { mUsesFarTerrain = IsEnabled; }
+
+	/**
+	* Sets if the blocks of the chunks around the camera are mirrored on the GPU by
+	* FBlockVolume, so shadows and occlusion can be traced through them. Ignored by
+	* headless managers, and with chunks FBlockVolume doesn't support.
+	*/
+	void SetBlockVolume(const bool IsEnabled) { mUsesBlockVolume = IsEnabled; }
+
+	/**
+	* The blocks around the camera on the GPU, or nullptr when headless or unsupported. It holds no
+	* chunks while the block volume is off.
+	*/
+	const FBlockVolume* GetBlockVolume() const { return mBlockVolume.get(); }
+
+	/**
+	* Sets if the render list only holds chunks reached from the camera chunk through
+	* the face connections of the chunks between them, see FindConnectedChunks.
+	*/
+	void SetConnectivityCulling(const bool IsEnabled) { mUsesConnectivityCulling = IsEnabled; }
+
+	/**
+	* Sets when mesh swaps of the next Update must stop, so uploads fit in the
+	* time left in the frame. At least one swap always runs.
+	* @param Deadline - System timer cycles, or 0 to only limit swaps by bytes.
+	*/
+	void SetSwapDeadline(const uint64_t Deadline) { mSwapDeadline = Deadline; }
+
+	/**
+	* Sets how much mesh data is swapped in each frame. Swaps stop once either budget
+	* is spent, or at the swap deadline if that comes first. Swaps over the staging
+	* ring's free space upload directly, so large byte budgets may stall the GPU.
+	* @param Bytes - The mesh bytes uploaded each frame.
+	* @param Milliseconds - The time spent swapping each frame.
+	*/
+	void SetSwapBudget(const uint32_t Bytes, const float Milliseconds);
+
+	/**
+	* Sets how far ahead the camera's movement is extrapolated to prefetch chunks. Chunks
+	* that will enter the view range around the predicted camera chunk are read and decoded
+	* at low priority, and kept in memory until they are loaded.
+	* @param Seconds - The time the camera's velocity is extrapolated over. 0 disables prefetching.
+	*/
+	void SetPrefetchLookahead(const float Seconds) { mPrefetchLookahead = Seconds; }
+
 private:
 	void InitializeWorld();
 
@@ -104,10 +617,67 @@ private:
 	void ChunkLoaderThreadLoop();
 
 	/**
-	* Processes the buffer swap list for chunks.
+	* Writes the chunk snapshots in mSaveRequests and saves the world files.
+	*/
+	void SaveThreadLoop(SaveProgressCallback OnProgress);
+
+	/**
+	* Processes the buffer swap list for chunks, visible chunks nearest to the
+	* camera first. Swaps are limited by the swap budget and deadline. Edited
+	* chunks are swapped before any of them, under a budget of their own.
 	*/
 	void SwapChunkBuffers();
 
+	/**
+	* Puts the pending mesh of a chunk in place. mBufferSwapMutex must be locked when calling this.
+	* @param Index - The chunk slot to swap, which must have a swap queued.
+	* @param SwapBytesOut - To add the bytes of the mesh to.
+	* @return System timer cycles when the mesh was put in place.
+	*/
+	uint64_t SwapChunkMesh(const uint32_t Index, uint32_t& SwapBytesOut);
+
+	/**
+	* Finishes the swap of a chunk whose mesh was put in place. mBufferSwapMutex must
+	* be locked when calling this.
+	* @param Index - The chunk slot swapped.
+	* @param ChunkPosition - The position of the chunk within the slot.
+	* @param SwapEnd - System timer cycles when the mesh was put in place.
+	*/
+	void FinishBufferSwap(const uint32_t Index, const Vector3i& ChunkPosition, const uint64_t SwapEnd);
+
+	/**
+	* Puts the meshes finished by mGPUMesher in place, finishing the swaps waiting on them,
+	* and dispatches queued GPU mesh requests. mBufferSwapMutex must be locked when calling this.
+	*/
+	void UpdateGPUMeshes();
+
+	/**
+	* Drops a GPU mesh in flight for a chunk slot, so it can't replace a newer mesh. Called
+	* each time the slot is meshed or loaded.
+	* @param Index - The chunk slot.
+	* @param SerialOut - To put the slot's new mesh serial.
+	* @return Bits of the sections the dropped mesh would have built, which must be built again.
+	*/
+	uint32_t DropGPUMesh(const uint32_t Index, uint32_t& SerialOut);
+
+	/**
+	* Adds a chunk to the GPU mesh requests, unless the slot was meshed again since the request was made.
+	*/
+	void QueueGPUMesh(std::unique_ptr<FChunkGPUMesher::Request> Request);
+
+	/**
+	* Checks if a chunk slot is waiting for a GPU mesh. Its swap waits with it, so the
+	* chunk doesn't take its position with the slot's previous mesh.
+	*/
+	bool IsGPUMeshPending(const uint32_t Index);
+
+	/**
+	* Puts the meshes finished by mUploader in place. A swap that wasn't taken back since
+	* its upload was submitted finishes with it. mBufferSwapMutex must be locked when calling this.
+	* @param Wait - If every upload in flight is waited for.
+	*/
+	void CompleteUploads(const bool Wait);
+
 	/**
 	* Updates the current load list
 	*/
@@ -120,14 +690,400 @@ private:
 	void UpdateRebuildList();
 
 	/**
-	* Updates the currently visible chunks in the scene.
+	* Joins the light of chunks loaded since the last update with their
+	* neighbors, and rebuilds the mesh sections lit differently.
+	*/
+	void UpdateLighting();
+
+	/**
+	* Relights around edited blocks and rebuilds the mesh sections lit differently.
+	* @param Positions - The world positions of the edited blocks.
+	* @param Count - The number of positions.
+	*/
+	void RelightBlocks(const Vector3i* Positions, const uint32_t Count);
+
+	/**
+	* Raises columns to placed blocks and lowers columns whose top block was removed.
+	* @param Changes - The changed blocks.
+	* @param Count - The number of changes.
+	*/
+	void UpdateColumnHeights(const BlockChange* Changes, const uint32_t Count);
+
+	/**
+	* Schedules the ticks of set blocks whose type ticks once placed.
+	* @param Changes - The changed blocks.
+	* @param Count - The number of changes.
+	*/
+	void SchedulePlacedTicks(const BlockChange* Changes, const uint32_t Count);
+
+	/**
+	* Activates the fluid cells around changed blocks for the next fluid tick.
+	* @param Changes - The changed blocks.
+	* @param Count - The number of changes.
+	*/
+	void ActivateFluids(const BlockChange* Changes, const uint32_t Count);
+
+	/**
+	* Runs one block tick. Scheduled blocks whose chunk isn't loaded are parked
+	* until it is, then random ticks are sampled around the camera. The edits of
+	* every handler are applied together.
+	* @param CameraChunk - The chunk the camera is in.
+	*/
+	void TickBlocks(const Vector3i& CameraChunk);
+
+	/**
+	* Samples random blocks of each section of a loaded chunk that holds a random tick type.
+	* @param Index - The slot of the chunk.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	*/
+	void SampleRandomTicks(const uint32_t Index, const Vector3i& ChunkPosition);
+
+	/**
+	* Runs one fluid tick. The fluid changes found by the last tick are applied
+	* with one ApplyEdits, and the cells activated since are stepped by a job on
+	* each chunk's slot. Skipped while the last tick's jobs are running.
+	*/
+	void TickFluids();
+
+	/**
+	* Queues block changes for the next dispatch while block events are buffered.
+	*/
+	void QueueBlockChanges(const BlockChange* Changes, const uint32_t Count);
+
+	/**
+	* Fires mOnBlocksEdited once per chunk with the final state of each block changed since the last dispatch.
+	*/
+	void DispatchBlockChanges();
+
+	/**
+	* Steps the active fluid cells of a chunk. The chunk's blocks are read under
+	* one lock, then the cells beyond its border with one read of each neighbor.
+	* Cells next to a chunk that isn't loaded are left as they are.
+	* Called from a worker thread.
+	*/
+	void SimulateFluids(const uint32_t Index, const FFluidSimulator::ActiveChunk& Chunk);
+
+	/**
+	* Searches down a block column through loaded chunks for its top solid block.
+	* @param X, Z - The world position of the column.
+	* @param Y - The height to search down from.
+	* @return One above the block found. The top of the first chunk that isn't loaded
+	*         if the search reaches one, or NO_SURFACE below a bounded world.
+	*/
+	int32_t FindColumnTop(const int32_t X, const int32_t Z, const int32_t Y) const;
+
+	/**
+	* Wakes the rigidbodies near edited blocks, since sleeping bodies don't see the terrain change.
+	* @param Min, Max - Inclusive corners of the edited blocks.
+	*/
+	void WakeBodies(const Vector3i& Min, const Vector3i& Max);
+
+	/**
+	* Moves the box rigidbodies are simulated and collide with the terrain in, so
+	* it stays centered on the camera.
+	* @param CameraChunk - The chunk that the camera is in.
+	*/
+	void UpdatePhysicsResidency(const Vector3i& CameraChunk);
+
+	/**
+	* Finds the chunk the camera is in. When it changed, moves the load
+	* frustum and physics residency along and flags the visible list for refresh.
+	* @return The chunk that the camera is in.
+	*/
+	Vector3i UpdateCameraChunk();
+
+	/**
+	* Counts the chunks that are loaded and have no mesh waiting to be built or
+	* swapped in.
+	* @param Chunks - Positions of chunks within the world.
+	*/
+	uint32_t CountReadyChunks(const std::vector<Vector3i>& Chunks);
+
+	/**
+	* Adds the terrain collider and its raycast to the physics system.
+	*/
+	void AttachTerrain();
+
+	/**
+	* Queues the removal of the terrain collider and clears its raycast.
+	*/
+	void DetachTerrain();
+
+	/**
+	* Queues rebuilds of the mesh sections changed by a light pass.
+	* @param IsEdit - If the light changed with edited blocks, so the rebuilds take the edit lane.
+	*/
+	void QueueLightRebuilds(const std::vector<FLightPropagator::ChunkChange>& Changes, const bool IsEdit);
+
+	/**
+	* A chunk waiting to be loaded.
+	*/
+	struct LoadRequest
+	{
+		Vector3i Position;
+		float    Priority;  // Lower values are loaded first
+		uint64_t QueueTime; // FClock::ReadSystemTimer when the request was made
+
+		// Ordered so the front of the load heap holds the lowest priority value
+		bool operator<(const LoadRequest& Other) const { return Priority > Other.Priority; }
+	};
+
+	/**
+	* Chunk data read ahead of the job that loads it.
+	*/
+	struct ChunkReadResult
+	{
+		std::vector<uint8_t> Data;       // Chunk data as stored on file
+		uint8_t              Codec;      // FChunkCodec::Codec of Data
+		uint64_t             WriteCount; // Write count of the chunk's region when Data was read
+		uint64_t             QueueTime;  // FClock::ReadSystemTimer when the chunk was queued for load
+		bool                 IsGenerated; // Data was made by the world generator and isn't on file yet
+	};
+
+	/**
+	* Decoded data of a chunk read ahead of its load.
+	*/
+	struct PrefetchedChunk
+	{
+		std::vector<uint8_t> Data;        // RLE block layout of the chunk
+		bool                 IsGenerated; // Data was made by the world generator and isn't on file yet
+	};
+
+	/**
+	* Extrapolates the camera's velocity over the prefetch lookahead, and has the loader
+	* thread queue prefetches when the predicted camera chunk changes.
+	* @param CameraPosition - The world position of the camera.
+	* @param CameraChunk - The chunk the camera is in.
+	*/
+	void UpdatePrefetch(const Vector3f& CameraPosition, const Vector3i& CameraChunk);
+
+	/**
+	* Recenters mBlockVolume on the camera, and uploads the chunks that entered it
+	* or were swapped in it, nearest first, up to FBlockVolume::MAX_UPLOADS_PER_FRAME.
+	* @param CameraChunk - The chunk the camera is in.
+	*/
+	void UpdateBlockVolume(const Vector3i& CameraChunk);
+
+	/**
+	* Queues low priority reads of the chunks within view range of the predicted camera
+	* chunk that aren't within view range of the camera chunk, nearest to the camera first.
+	* Replaces the prefetches of the previous prediction, and drops prefetched chunks out of both ranges.
+	*/
+	void QueuePrefetches();
+
+	/**
+	* Low priority I/O job that reads and decodes a chunk into mPrefetchedChunks, so its
+	* load skips the read, decompression and generation.
+	* @param ChunkPosition - The position of the chunk to prefetch.
+	*/
+	void PrefetchChunk(const Vector3i ChunkPosition);
+
+	/**
+	* I/O job that reads the data of chunks of one region in a single pass and
+	* submits the jobs to load them. Holds a region file reference for each load job.
+	* @param Requests - The load requests of the chunks to read.
+	*/
+	void ReadChunks(const std::vector<LoadRequest>& Requests);
+
+	/**
+	* Submits the job to load a chunk known to be of a single block type, without
+	* reading its data. Holds a region file reference for the load job as a read would.
+	* @param ChunkPosition - The position of the chunk to load.
+	* @param QueueTime - FClock::ReadSystemTimer when the chunk was queued for load.
+	* @param ID - The block type every block of the chunk is.
+	*/
+	void LoadUniformChunk(const Vector3i& ChunkPosition, const uint64_t QueueTime, const FBlockTypes::BlockID ID);
+
+	/**
+	* Worker job that unloads the chunk currently within a chunk slot and
+	* loads a new chunk into it.
+	* @param ChunkPosition - The position of the chunk to load.
+	* @param Read - The chunk's data, read again if a chunk was written since.
+	*/
+	void LoadChunk(const Vector3i ChunkPosition, const ChunkReadResult& Read);
+
+	/**
+	* Worker job that rebuilds the mesh of a loaded chunk.
+	* @param Index - The chunk slot to rebuild.
+	* @param IsEdit - If the chunk was edited, so its swap takes the edit lane.
+	*/
+	void RebuildChunk(const uint32_t Index, const bool IsEdit);
+
+	/**
+	* Rebuilds the dirty mesh sections of a loaded chunk from its neighbors' borders and its light,
+	* or queues them for mGPUMesher.
+	* @param Index - The chunk slot to mesh.
+	* @param ChunkPosition - The position of the chunk in the slot.
+	* @return False if the chunk's blocks were replaced while meshing, see FChunk::RebuildMesh.
+	*/
+	bool MeshChunk(const uint32_t Index, const Vector3i& ChunkPosition);
+
+	/**
+	* Adds a chunk to the rebuild list if it is not already in it. Rebuilds of edited
+	* chunks take the edit lane instead. They are submitted right away as urgent jobs,
+	* which reserved workers take however much streaming work is queued, and their
+	* meshes are swapped before any streamed chunk's in the next swap.
+	* @param Index - The chunk slot to rebuild.
+	* @param SectionMask - Bits of the mesh sections to rebuild.
+	* @param IsEdit - If the rebuild shows edited blocks.
+	*/
+	void QueueChunkRebuild(const uint32_t Index, const uint32_t SectionMask = FChunk::ALL_SECTIONS, const bool IsEdit = false);
+
+	/**
+	* Rebuilds loaded neighbor chunks that share a face with an edited block on the border of a chunk.
+	* @param ChunkPosition - The position of the chunk with the block.
+	* @param LocalPosition - The position of the block within the chunk.
+	*/
+	void QueueBorderRebuilds(const Vector3i& ChunkPosition, const Vector3i& LocalPosition);
+
+	/**
+	* Rebuilds loaded neighbor chunks across a set of faces of an edited chunk.
+	* @param ChunkPosition - The position of the chunk.
+	* @param FaceMask - Bits of the faces, ordered by FChunk::NormalID.
+	*/
+	void QueueFaceRebuilds(const Vector3i& ChunkPosition, const uint32_t FaceMask);
+
+	/**
+	* Applies edits for ApplyEdits and the region operations.
+	* @param ReplacedID - If not null, only blocks of this type are set.
+	*/
+	void WriteEdits(const BlockEdit* Edits, const uint32_t EditCount, const FBlockTypes::BlockID* ReplacedID);
+
+	/**
+	* Rebuilds loaded chunks whose mesh detail level doesn't match their
+	* current distance from the camera.
+	*/
+	void QueueLODRebuilds();
+
+	/**
+	* Finds the mesh detail level for a chunk at its distance from the
+	* current camera chunk.
+	* @param ChunkPosition - The position of the chunk.
+	*/
+	uint32_t GetLODLevel(const Vector3i& ChunkPosition);
+
+	/**
+	* Finds the chunk slot index of a loaded chunk.
+	* @param ChunkPosition - The position of the chunk.
+	* @return The index of the chunk, or -1 if that chunk is not loaded.
+	*/
+	int32_t FindLoadedChunk(const Vector3i& ChunkPosition);
+
+	/**
+	* Retrieves the border blocks and light of all loaded neighbors of a chunk.
+	* Missing neighbors leave border faces visible and lit by the sky.
+	* @param ChunkPosition - The position of the chunk.
+	* @param NeighborsOut - Location to place the neighbor borders.
+	*/
+	void GetNeighborBorders(const Vector3i& ChunkPosition, FChunk::NeighborBorders& NeighborsOut);
+
+	/**
+	* Adds a chunk to the buffer swap queue. mBufferSwapMutex must
+	* be locked when calling this.
+	* @param Index - The chunk slot to swap.
+	* @param ChunkPosition - The position of the chunk within the slot.
+	* @param IsEdit - If the mesh shows edited blocks, so it is swapped through the edit lane.
+	*/
+	void QueueBufferSwap(const uint32_t Index, const Vector3i& ChunkPosition, const bool IsEdit = false);
+
+	/**
+	* Updates the currently visible chunks in the scene. After the first scan,
+	* only the chunks that entered the view volume since the last update are checked.
 	*/
 	void UpdateVisibleList();
 
 	/**
-	* Updates the render list.
+	* Updates the render list with every loaded chunk that has geometry, nearest first,
+	* and the shadow caster list with all of them. Chunks are walked by slot group, so
+	* groups without geometry are skipped, groups outside the frustum are rejected with one
+	* test and chunks of groups inside it aren't tested. With connectivity culling the render
+	* list only keeps chunks found by FindConnectedChunks. Visibility is then tested on the
+	* GPU by mChunkCuller.
+	* @param ViewPosition - The world position chunks are ordered from.
+	* @param ViewFrustum - The view frustum in world space.
+	*/
+	void UpdateRenderList(const Vector3f& ViewPosition, const FFrustum& ViewFrustum);
+
+	/**
+	* Finds the chunks that can be seen from the camera chunk with a breadth first search
+	* through the chunk grid. A chunk entered through one face is only left through faces
+	* joined to it by the chunk's face connections, never back toward the camera, and only
+	* into neighbors within the view frustum. Chunks that aren't loaded are passed through.
+	* @param ViewPosition - The world position of the camera.
+	* @param ViewFrustum - The view frustum in world space.
+	* @param VisibleOut - To put the index of each loaded chunk found.
+	* @return False if the camera is outside the world, in which case nothing is searched.
+	*/
+	bool FindConnectedChunks(const Vector3f& ViewPosition, const FFrustum& ViewFrustum, std::vector<uint32_t>& VisibleOut);
+
+	/**
+	* Sizes the slot groups for the slot window and counts the chunks with geometry in each.
+	*/
+	void ResetChunkGroups();
+
+	/**
+	* Counts a chunk index in its group as it is after a buffer swap, and marks the group's bounds for update.
+	*/
+	void UpdateChunkGroup(const uint32_t Index);
+
+	/**
+	* Calls a function with each chunk index of a slot group.
+	*/
+	template <typename Function>
+	void ForEachGroupSlot(const uint32_t Group, Function Call) const;
+
+	/**
+	* The slot group a chunk index is in.
+	*/
+	uint32_t ChunkGroupIndex(const uint32_t Index) const;
+
+	/**
+	* Adds a chunk to the load list if it is not loaded and not already
+	* waiting to be loaded.
+	* @param ChunkPosition - The position of the chunk.
+	* @param CameraChunk - The chunk that the camera is in.
+	* @param ViewFrustum - The camera view frustum in chunk coordinates.
 	*/
-	void UpdateRenderList();
+	void QueueChunkLoad(const Vector3i& ChunkPosition, const Vector3i& CameraChunk, const FFrustum& ViewFrustum);
+
+	/**
+	* Queues loads for all chunks within a volume, clamped to the world.
+	* @param Min - The minimum chunk position of the volume, inclusive.
+	* @param Max - The maximum chunk position of the volume, inclusive.
+	* @param CameraChunk - The chunk that the camera is in.
+	* @param ViewFrustum - The camera view frustum in chunk coordinates.
+	*/
+	void QueueVolumeLoads(Vector3i Min, Vector3i Max, const Vector3i& CameraChunk, const FFrustum& ViewFrustum);
+
+	/**
+	* Calculates the load priority of a chunk. Chunks closest to the camera
+	* and within the view frustum have the lowest values.
+	* @param ChunkPosition - The position of the chunk.
+	* @param CameraChunk - The chunk that the camera is in.
+	* @param ViewFrustum - The camera view frustum in chunk coordinates.
+	* @return The priority value. Lower values are loaded first.
+	*/
+	float LoadPriority(const Vector3i& ChunkPosition, const Vector3i& CameraChunk, const FFrustum& ViewFrustum) const;
+
+	/**
+	* Checks if a chunk position is within the view distance of a camera chunk.
+	*/
+	bool IsInViewRange(const Vector3i& ChunkPosition, const Vector3i& CameraChunk) const;
+
+	/**
+	* Checks if a chunk position is within the view distance and eviction margin of a camera chunk.
+	*/
+	bool IsInResidentRange(const Vector3i& ChunkPosition, const Vector3i& CameraChunk) const;
+
+	/**
+	* Notes when a chunk was evicted, to count a reload soon after as thrash. Called under mFileSystemMutex.
+	*/
+	void RecordEviction(const Vector3i& ChunkPosition);
+
+	/**
+	* Retrieves the current main camera view frustum in chunk coordinates.
+	*/
+	FFrustum GetChunkViewFrustum() const;
 
 	/**
 	* Reconstructs internal data to function with
@@ -135,13 +1091,45 @@ private:
 	*/
 	void ResizeWorld();
 
-	void ReallocateChunkData(const int32_t NewViewDistance);
+	/**
+	* Resizes the chunk slot window for new view distances. The loader and workers are paused,
+	* chunks leaving the view are unloaded and the rest are moved to their slots in the new window.
+	*/
+	void ReallocateChunkData(const int32_t NewViewDistance, const int32_t NewVerticalViewDistance);
+
+	/**
+	* Joins the save and loader threads and stops the workers and I/O queue, then finishes
+	* every pending buffer swap. mMustShutdown is left set for the caller to clear.
+	*/
+	void StopChunkThreads();
+
+	/**
+	* Resets the per slot state of the pipeline and starts the workers, I/O queue and loader thread.
+	*/
+	void StartChunkThreads();
 
 	/**
 	* Unloads all chunks that are currently loaded.
 	*/
 	void UnloadAllChunks();
 
+	/**
+	* Unloads the chunk in a slot, writing its blocks if modified and releasing its region reference.
+	* Only called while the chunk threads are stopped.
+	*/
+	void UnloadChunkSlot(const uint32_t Index);
+
+	/**
+	* Shows a slot to BlockReader as holding a chunk, once its blocks are in place.
+	* The slot must have been hidden first.
+	*/
+	void ShowResidentSlot(const uint32_t Index, const Vector3i& ChunkPosition);
+
+	/**
+	* Hides a slot from BlockReader before its chunk is loaded, unloaded or moved.
+	*/
+	void HideResidentSlot(const uint32_t Index);
+
 	/**
 	* Obtains data needed after a new world has been loaded.
 	*/
@@ -158,26 +1146,234 @@ private:
 	int32_t ChunkIndex(int32_t X, int32_t Y, int32_t Z) const;
 
 private:
+	/**
+	* A chunk reached by FindConnectedChunks.
+	*/
+	struct VisibilityStep
+	{
+		Vector3i Position;
+		uint32_t EnteredFace; // NormalID of the face the chunk was entered through, 6 for the camera chunk
+		uint32_t Directions;  // Bits of the NormalID of each step taken to reach the chunk
+	};
+
+	// Chunk slots along each axis of a slot group, as a power of 2, fewer if the window is smaller
+	static const int32_t GROUP_SLOT_BITS = 2;
+
+	/**
+	* A block of neighboring chunk slots, culled as one by UpdateRenderList. Slots wrap,
+	* so the bounds are of the chunk positions held rather than of the slots.
+	*/
+	struct ChunkGroup
+	{
+		Vector3i Min;          // Chunk position bounds of the slots with geometry, inclusive
+		Vector3i Max;
+		uint32_t MeshCount;    // Slots with geometry as of their last buffer swap
+		bool     IsBoundsDirty; // If a slot was swapped since the bounds were found
+	};
+
+	// Hash functor for chunk position maps
+	struct ChunkPositionHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	/**
+	* A snapshot of a modified chunk waiting to be saved.
+	*/
+	struct SaveRequest
+	{
+		Vector3i             Position;
+		uint32_t             Index;
+		FChunk::Version      Version;   // Version of the chunk's blocks in the snapshot
+		std::vector<uint8_t> BlockData; // RLE block layout
+	};
+
+	/**
+	* The chunk a slot holds, as seen by BlockReader. The sequence is odd while the slot is
+	* hidden and changes every time it's hidden or shown, so readers know the blocks they
+	* read were of the chunk they found if it's the same after reading.
+	*/
+	struct ResidentSlot
+	{
+		std::atomic<uint32_t> Sequence;
+		std::atomic<int32_t>  X;
+		std::atomic<int32_t>  Y;
+		std::atomic<int32_t>  Z;
+	};
+
+	/**
+	* The slots of a chunks array as seen by BlockReader. Replaced when the slot window is rehomed.
+	*/
+	struct ResidentTable
+	{
+		std::unique_ptr<ResidentSlot[]> Slots;
+		FChunk*                         Chunks;
+		int32_t                         HorizontalSlotBits;
+		int32_t                         VerticalSlotBits;
+	};
+
+	/**
+	* A resident table for a chunks array of the current slot window, with every slot hidden.
+	*/
+	ResidentTable* NewResidentTable(FChunk* Chunks) const;
+
+	std::unique_ptr<FChunkGeometryArena> mGeometryArena; // Quads of all chunk meshes, must outlive mChunks. Null when headless.
+	FChunk::MeshPool      mMeshPool;      // Meshes of this world's chunks, must outlive mChunks
 	FWorldFileSystem      mFileSystem;
+	FEditJournal          mJournal;       // Block edits since the last save
+	FColumnHeights        mColumnHeights; // Surface height of each known column, saved with the world
+	FBlockTickScheduler   mBlockTicks;    // Scheduled block ticks, saved with the world
+	FChunkEntities        mEntities;      // Game objects bound to their chunk, saved with the world
+	FFluidSimulator       mFluids;        // Fluid types, and active cells used on the main thread
+	FChunkMeshCache       mMeshCache;     // Open while the world is loaded if mUsesMeshCache
+	std::unordered_map<Vector3i, std::vector<FEditJournal::Edit>, ChunkPositionHash> mReplayEdits; // Journal edits not yet in their chunk, guarded by mFileSystemMutex
 	FChunk*               mChunks;        // All world chunks
 	Vector4i*             mChunkPositions;
-	std::vector<uint32_t> mRenderList;    // Index list of chunks to render
-	std::queue<Vector3i>  mLoadList;      // Index list of chunks to be loaded
+	std::atomic<ResidentTable*> mResidentTable; // Slots read by BlockReader, only replaced while the chunk threads are stopped
+	std::vector<uint32_t> mRenderList;    // Index list of chunks to render, front to back
+	std::vector<uint64_t> mRenderSortItems;   // Distance keyed chunk indices, reused by UpdateRenderList
+	std::vector<uint64_t> mRenderSortScratch;
+	std::vector<uint32_t> mCasterList;    // Index list of every loaded chunk with geometry, for shadows
+	std::vector<uint32_t> mConnectedList; // Chunks left to draw, reused by UpdateRenderList
+	std::vector<ChunkGroup> mChunkGroups; // Slot groups of the window, only used on the main thread
+	std::vector<uint8_t>  mHasGroupMesh;  // If each chunk index is counted in its group's MeshCount
+	std::vector<VisibilityStep> mVisibilitySteps; // Search queue, reused by FindConnectedChunks
+	std::vector<uint8_t>  mIsVisibilityVisited;   // If FindConnectedChunks reached each chunk index
+	std::unique_ptr<FChunkDrawList> mDrawList;    // Draws for chunks in mRenderList. Null when headless.
+	std::unique_ptr<FChunkCuller>   mChunkCuller; // Culls mDrawList on the GPU. Null when headless.
+	std::unique_ptr<FChunkGPUMesher> mGPUMesher;  // Meshes chunks when mUsesGPUMeshing. Null when headless or unsupported.
+	std::unique_ptr<FFarTerrain>     mFarTerrain; // Surface past the view distance. Null when headless.
+	std::unique_ptr<FBlockVolume>    mBlockVolume; // Blocks around the camera when mUsesBlockVolume. Null when headless or unsupported.
+	std::vector<Vector3i> mBlockVolumeUploads; // Chunks waiting to be uploaded to mBlockVolume, farthest first, only used on the main thread
+	std::deque<std::unique_ptr<FChunkGPUMesher::Request>> mGPUMeshRequests; // Chunks waiting for a GPU dispatch, guarded by mGPUMeshMutex
+	std::vector<FChunkGPUMesher::Result> mGPUMeshResults; // Reused by UpdateGPUMeshes
+	std::vector<uint32_t> mMeshSerials;      // Incremented each time a chunk index is meshed or loaded, guarded by mGPUMeshMutex
+	std::vector<uint32_t> mGPUMeshSections;  // Sections of the GPU mesh in flight for each chunk index, 0 if none, guarded by mGPUMeshMutex
+	std::vector<uint32_t> mDeferredSwaps;    // Swaps waiting on a GPU mesh or an upload, reused by SwapChunkBuffers
+	std::unique_ptr<FChunkUploader> mUploader; // Uploads meshes when mUsesBackgroundUploads. Null when headless.
+	std::vector<std::unique_ptr<FChunkUploader::Upload>> mCompletedUploads; // Reused by CompleteUploads
+	std::vector<bool>     mIsUploadPending;  // If each chunk index has an upload in flight, guarded by mBufferSwapMutex
+	std::vector<Vector4f> mCasterCenters;    // Center of each chunk in mCasterList, built with the list
+	std::vector<uint8_t>  mCasterVisibility; // Frustum test result for each center
+	std::vector<LoadRequest> mLoadList;   // Heap of chunks to be loaded
+	std::vector<Vector3i> mLoadListPositions; // Position waiting in the load list for each chunk index
 	std::deque<uint32_t>  mRebuildList;   // Index list of chunks to be rebuilt
-	std::deque<Vector3i>  mBufferSwapQueue;
+	std::vector<bool>     mIsRebuildQueued;  // If each chunk index is in the rebuild list
+	std::vector<bool>     mIsEditRebuildQueued; // If each chunk index has an edit rebuild that hasn't started, guarded by mRebuildListMutex
+	std::deque<uint32_t>  mBufferSwapQueue;  // Index list of chunks waiting for a buffer swap
+	std::deque<uint32_t>  mEditSwapQueue;    // Index list of edited chunks waiting for a buffer swap, swapped first
+	std::vector<bool>     mIsEditSwapQueued; // If each chunk index is in mEditSwapQueue
+	std::vector<Vector3i> mSwapPositions;    // Position waiting for a buffer swap for each chunk index
+	std::vector<uint64_t> mSwapQueueTimes;   // Load queue time of each chunk index until its first swap, 0 after
+	std::vector<uint64_t> mSwapSortItems;    // Priority keyed chunk indices, reused by SwapChunkBuffers
+	std::vector<uint64_t> mSwapSortScratch;
+	std::atomic<uint32_t> mLoadListDepth;    // Size of mLoadList, which only the loader thread reads
+	std::vector<LoadRequest> mReadBatch;     // Requests taken from mLoadList to be read, grouped by region
+	std::atomic<uint32_t> mPendingChunkReads; // Chunks submitted to the I/O queue and not yet read
 	std::thread           mLoaderThread;
+	std::thread           mSaveThread;
+	std::vector<SaveRequest> mSaveRequests; // Only used by the save thread while saving
+	std::unique_ptr<FUploadRing> mUploadRing;  // Stages chunk meshes for upload. Null when headless.
+	FChunkWorkerPool      mWorkerPool;    // Processes chunk load and rebuild jobs
+	FChunkIOQueue         mIOQueue;       // Reads chunk data ahead of load jobs
+	FLightPropagator      mLightPropagator; // Spreads light between loaded chunks, guarded by mLightMutex
+	std::vector<Vector3i> mLightLoads;    // Chunks lit on their own since the last update, guarded by mLightMutex
+	std::unordered_map<Vector3i, PrefetchedChunk, ChunkPositionHash> mPrefetchedChunks; // Taken by reads and dropped by writes, guarded by mFileSystemMutex
+	std::unordered_map<Vector3i, uint64_t, ChunkPositionHash> mEvictionTimes; // FClock::ReadSystemTimer when recently evicted chunks were unloaded, guarded by mFileSystemMutex
 	std::mutex            mRebuildListMutex;
+	std::mutex            mLightMutex;    // Guards the light of every chunk
 	std::mutex            mBufferSwapMutex;
+	std::mutex            mFileSystemMutex;
+	std::mutex            mCameraMutex;
+	std::mutex            mGPUMeshMutex;
 	std::atomic_bool      mNeedsToRefreshVisibleList;
+	std::atomic_bool      mNeedsToPrefetch;
 	std::atomic_bool      mMustShutdown;
+	std::atomic_bool      mIsSaving;
+	uint32_t              mWorkerCount;
+	bool                  mUsesMeshCache;
+	std::atomic_bool      mUsesGPUMeshing;
+	bool                  mUsesBackgroundUploads;
+	bool                  mUsesFarTerrain;
+	bool                  mUsesBlockVolume;
+	bool                  mUsesConnectivityCulling;
+	const bool            mIsHeadless;
+	uint64_t              mSwapDeadline;
+	uint32_t              mSwapByteBudget;
+	float                 mSwapTimeBudget;   // In milliseconds
+
+	float    mJournalCommitTimer;
+
+	// Block ticks, all used on the main thread
+	std::vector<BlockTickHandler>     mTickHandlers;       // By block type
+	std::vector<uint32_t>             mPlacedTickDelays;   // By block type, 0 if placed blocks don't tick
+	std::vector<BlockTickHandler>     mRandomTickHandlers; // By block type
+	std::vector<FBlockTypes::BlockID> mRandomTickTypes;    // Types with a random tick handler
+	std::vector<Vector3i>             mDueTicks;           // Reused by TickBlocks
+	std::vector<BlockEdit>            mTickedBlocks;       // Blocks to tick with their type, reused by TickBlocks
+	std::vector<BlockEdit>            mTickEdits;          // Reused by TickBlocks
+	std::minstd_rand                  mTickRandom;
+	float                             mBlockTickTimer;
+
+	// Fluid ticks
+	struct FluidChange
+	{
+		Vector3i             Position;
+		FBlockTypes::BlockID PreviousID; // The change is dropped if the block was set since
+		FBlockTypes::BlockID ID;
+	};
+	std::vector<FluidChange>                    mFluidChanges;     // Found by fluid jobs, guarded by mFluidMutex
+	std::vector<FluidChange>                    mAppliedFluids;    // Reused by TickFluids
+	std::vector<BlockEdit>                      mFluidEdits;       // Reused by TickFluids
+	std::vector<FFluidSimulator::ActiveChunk>   mActiveFluids;     // Reused by TickFluids
+	std::mutex                                  mFluidMutex;
+	std::atomic<uint32_t>                       mPendingFluidJobs;
+	float                                       mFluidTickTimer;
+
+	// Buffered block events
+	std::vector<BlockChange> mQueuedChanges;     // Guarded by mBlockEventMutex
+	std::vector<BlockChange> mDispatchedChanges; // Reused by DispatchBlockChanges
+	std::mutex               mBlockEventMutex;
+	std::atomic_bool         mIsBufferingBlockEvents;
+
+	// Job statistics
+	uint64_t mLastCompletedJobCount;
+	float    mJobRateTimer;
+	float    mJobsPerSecond;
+	FChunkPipelineStats mPipelineStats;
+	StartupTimings      mStartupTimings;
+	uint64_t            mLoadWorldTime;   // FClock::ReadSystemTimer when LoadWorld began
+	bool                mIsFirstFrameDone; // If a frame ended since LoadWorld
 
 	// Rendering data
+	FFrustum mLoadFrustum;            // Camera frustum in chunk coordinates when mLastCameraChunk was set
 	Vector3i mLastCameraChunk;
+	Vector3i mScannedCameraChunk;     // Camera chunk used by the last visible list update
+	Vector3i mPrefetchChunk;          // Predicted camera chunk, guarded by mCameraMutex
+	Vector3f mLastCameraPosition;
+	Vector3f mCameraVelocity;         // Smoothed, in blocks per second
+	bool     mHasCameraPosition;      // False until the first update of a world, when there's no velocity yet
+	float    mPrefetchLookahead;      // In seconds
+	bool     mNeedsFullVisibleScan;
 	int32_t mWorldSize;
 	int32_t mViewDistance;
+	int32_t mVerticalViewDistance;
+	int32_t mEvictionMargin;          // Chunks past the view distance kept loaded, the slot window covers both
+	int32_t mHorizontalSlotBits;      // Chunk slots along x and z are 1 << mHorizontalSlotBits
+	int32_t mVerticalSlotBits;        // Chunk slots along y are 1 << mVerticalSlotBits
+	uint32_t mLODDistances[FChunk::LOD_LEVELS]; // Distance each detail level starts at, guarded by mCameraMutex
 
 	// Physics Data
-	FPhysicsSystem* mPhysicsSystem;
+	FPhysicsSystem*    mPhysicsSystem;
+	FVoxelTerrainShape mTerrainShape;
+	btCollisionObject  mTerrainObject; // The only collider of the terrain, added with the physics system
+	bool               mHasTerrainCollision;
+
+	const FWorldGenerator* mWorldGenerator; // Generates chunks missing from file, called from workers
+	FCamera*               mCamera;         // Followed in place of FCamera::Main if set
 
 public:
 	// Block events
@@ -186,24 +1382,57 @@ public:
 
 	TEvent<Vector3i, FBlockTypes::BlockID> mOnBlockDestroy;
 	TEvent<Vector3i, FBlockTypes::BlockID> mOnBlockSet;
+	TEvent<const BlockChange*, uint32_t>   mOnBlocksEdited; // Changes made by one ApplyEdits or region operation, or of one chunk when buffered
+};
+
+/**
+* Pins FChunk::BlockEpochs for as long as it lives, so blocks can be read from any thread
+* without locks while the loader streams chunks in and out of their slots. Chunk blocks
+* are never written once published, loads and edits publish new blocks and retire the old,
+* so reads never see a block half written. Slots are checked again after each read, reads
+* of chunks that are loading, unloading or not loaded are air. Readers should live for a
+* batch of reads, such as one path search, rather than across frames, since nothing
+* retired is freed while they live. They must not outlive the manager.
+*/
+class FChunkManager::BlockReader
+{
+public:
+	explicit BlockReader(const FChunkManager& Manager);
+
+	BlockReader(const BlockReader& Other) = delete;
+	BlockReader& operator=(const BlockReader& Other) = delete;
+
+	/**
+	* Retrieves the type of block in the world at a specific position, as of the read.
+	*/
+	FBlockTypes::BlockID GetBlock(const Vector3i& Position) const;
+
+	/**
+	* The blocks of a chunk as of the call, or null if it isn't loaded. They stay readable for
+	* as long as the reader lives, but edits and unloads after the call aren't seen through them.
+	*/
+	const FBlockStorage* FindChunkBlocks(const Vector3i& ChunkPosition) const;
+
+private:
+	FEpochReclaimer::Guard mGuard;
+	const ResidentTable*   mTable; // Loaded once pinned, stays valid while pinned
 };
 
 
 inline int32_t FChunkManager::ChunkIndex(Vector3i Position) const 
 {
-	ASSERT(Position.x >= 0 && Position.x < mWorldSize &&
-		Position.y >= 0 && Position.y < mWorldSize &&
-		Position.z >= 0 && Position.z < mWorldSize)
-
-	// Normalize the position
-	const int32_t HorizontalBounds = 2 * mViewDistance + 1;
-	const int32_t VerticalBounds = mViewDistance + 1;
-	const Vector3i PositionToIndex{ HorizontalBounds, HorizontalBounds * HorizontalBounds, 1 };
+	ASSERT(IsInWorld(Position));
 
-	// Bit shift for mod operation
-	Position = Vector3i{ Position.x % HorizontalBounds, Position.y % VerticalBounds, Position.z % HorizontalBounds };
+	// Chunk slots wrap around the view volume, so only positions
+	// within view of each other need distinct slots. The slot window is
+	// rounded up to powers of 2, so wrapping is a mask. Masking two's
+	// complement values also wraps negative positions to the top.
+	const int32_t HorizontalMask = (1 << mHorizontalSlotBits) - 1;
+	const int32_t VerticalMask = (1 << mVerticalSlotBits) - 1;
 
-	return Vector3i::Dot(Position, PositionToIndex);
+	return (Position.z & HorizontalMask) |
+		((Position.x & HorizontalMask) << mHorizontalSlotBits) |
+		((Position.y & VerticalMask) << (2 * mHorizontalSlotBits));
 }
 
 inline int32_t FChunkManager::ChunkIndex(int32_t X, int32_t Y, int32_t Z) const 
@@ -213,5 +1442,15 @@ inline int32_t FChunkManager::ChunkIndex(int32_t X, int32_t Y, int32_t Z) const
 
 inline uint32_t FChunkManager::ChunkCount() const
 {
-	return (2 * mViewDistance + 1) * (mViewDistance + 1) * (2 * mViewDistance + 1);
+	return 1u << (2 * mHorizontalSlotBits + mVerticalSlotBits);
+}
+
+inline bool FChunkManager::IsInWorld(const Vector3i& ChunkPosition) const
+{
+	if (mWorldSize == 0)
+		return true;
+
+	return ChunkPosition.x >= 0 && ChunkPosition.x < mWorldSize &&
+		ChunkPosition.y >= 0 && ChunkPosition.y < mWorldSize &&
+		ChunkPosition.z >= 0 && ChunkPosition.z < mWorldSize;
 }
\ No newline at end of file
@@ -1,17 +1,35 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <memory>
 #include <atomic>
 
 #include "GL\glew.h"
 #include "Math\Vector3.h"
 #include "Common.h"
+#include "ChunkSize.h"
+#include "ChunkGeometryArena.h"
+#include "ChunkDrawList.h"
+#include "Memory\MemoryStats.h"
+
+class FUploadRing;
 
 
 /**
 * A double buffered mesh used to construct and render
-* chunks.
+* chunks. Meshes are made of quads only, each stored as a single
+* record that the vertex shader expands into its corners, so meshes
+* hold no vertices or indices. Quad data for the active buffer is held
+* in a FChunkGeometryArena. Quads are grouped by face direction so
+* directions facing away from the camera can be skipped when drawing.
+*
+* The mesh is split into SECTION_COUNT sections, each with its own
+* quad data and arena range. The back buffer only holds rebuilt
+* sections, so an edit only remeshes and uploads the sections it touched.
+* Sections are built in place in the back buffer, which keeps its capacity
+* between rebuilds, and the active buffer only keeps quad counts. The kept
+* capacity is given back while chunk meshes are over their memory budget.
 */
 class FChunkMesh
 {
@@ -21,152 +39,224 @@ public:
 	struct FrontBuffer{};
 
 	/**
-	* Compressed rendering data for a chunk vertex.
+	* Compressed rendering data for a chunk quad, expanded into its corners by
+	* Shaders/ChunkQuad.glsl. Placement holds the chunk local position of the first
+	* block the face covers at POSITION_BITS an axis, followed by the width less one
+	* along the face's u axis and the height less one along its v axis at SPAN_BITS
+	* each, then the normal id in 3 bits. With 32 block chunks these are bits 0-14,
+	* 15-19, 20-24 and 25-27. Surface holds the block type in bits 0-7, the light
+	* level in bits 8-10 and the ambient occlusion level of each corner in bits 11-18,
+	* in the corner order of FChunk::GreedyMesh.
+	*/
+	struct Quad
+	{
+		// Light levels that fit in a quad, from dark to fully lit
+		static const uint8_t LIGHT_LEVELS = 8;
+
+		// Ambient occlusion levels that fit in a corner, from fully occluded to open
+		static const uint8_t OCCLUSION_LEVELS = 4;
+
+		// Bits of each axis of a position, enough for any block of a chunk
+		static const uint32_t POSITION_BITS = CHUNK_SIZE_BITS;
+
+		// Bits of the width and height. Quads stop at section borders, so they span at most half a 64 block chunk.
+		static const uint32_t SPAN_BITS = 5;
+		static const uint32_t MAX_SPAN = 1 << SPAN_BITS;
+
+		uint32_t Placement;
+		uint32_t Surface;
+
+		/**
+		* Packs quad data.
+		* @param Block - Position within the chunk of the first block the face covers. Each axis must be within [0, CHUNK_SIZE).
+		* @param Width - Blocks covered along the u axis of the face direction, within [1, MAX_SPAN].
+		* @param Height - Blocks covered along the v axis of the face direction, within [1, MAX_SPAN].
+		* @param BlockType - The type of block the quad is used for.
+		* @param NormalID - The direction the surface is facing.
+		* @param LightLevel - The light of the surface, within [0, LIGHT_LEVELS).
+		* @param Occlusion - The ambient occlusion level of each corner, 2 bits each.
+		*/
+		static Quad Pack(const Vector3i& Block, const uint32_t Width, const uint32_t Height, const uint8_t BlockType,
+			const uint8_t NormalID, const uint8_t LightLevel, const uint8_t Occlusion);
+	};
+
+	/**
+	* A contiguous range of mesh quads that share a face direction.
 	*/
-	struct Vertex
+	struct FaceRange
 	{
-		Vector3f Position;
-		uint8_t  BlockType;
-		uint8_t  NormalID;
+		uint32_t FirstQuad;
+		uint32_t QuadCount;
 	};
 
 public:
 	static GLuint BufferUsageMode;
 
-	using VertexData = std::vector<Vertex>;
-	using VertexDataPtr = std::unique_ptr<VertexData>;
+	// Vertices each quad is drawn with, as 2 triangles
+	static const uint32_t VERTICES_PER_QUAD = 6;
+
+	using QuadData = std::vector<Quad>;
+
+	// Quad ranges of each face direction, indexed by FChunk::NormalID
+	using FaceRanges = std::array<FaceRange, 6>;
 
-	using IndexData = std::vector<uint32_t>;
-	using IndexDataPtr = std::unique_ptr<IndexData>;
+	// Number of mesh sections, sized to FChunk::SECTION_SIZE
+	static const uint32_t SECTION_COUNT = 8;
+	static const uint32_t ALL_SECTIONS = (1 << SECTION_COUNT) - 1;
 
 public:
 	FChunkMesh();
 	~FChunkMesh();
 
 	/**
-	* Add vertex data to the active buffer. This is uncompressed vertex
-	* position data to be used this physics.
+	* Starts rebuilding a section of the back buffer. The quad data is emptied but keeps
+	* its capacity from earlier builds, and reserves at least the section's active quad count.
+	* @param SectionIndex - The index of the section, within [0, SECTION_COUNT).
+	* @return The quad data to build the section into, until AddSection.
 	*/
-	void AddVertexData(VertexDataPtr Vertices);
+	QuadData& BeginSection(const uint32_t SectionIndex);
 
 	/**
-	* Add index data to the active buffer.
+	* Adds a section built with BeginSection to the back buffer, replacing the section at the next swap.
+	* @param SectionIndex - The index of the section, within [0, SECTION_COUNT).
+	* @param Ranges - The quad range of each face direction. Ranges must not overlap and must cover all quad data.
 	*/
-	void AddIndexData(IndexDataPtr Indices);
+	void AddSection(const uint32_t SectionIndex, const FaceRanges& Ranges);
 
 	/**
-	* Render this mesh using the active buffer.
+	* Adds empty sections to the back buffer, clearing the sections at the next swap.
+	* @param SectionMask - Bits of the sections to clear.
 	*/
-	void Render(GLenum RenderMode = GL_TRIANGLES);
+	void ClearSections(const uint32_t SectionMask);
 
 	/**
-	* Swap the active buffer with the back buffer.
+	* Adds draws of the active buffer to a draw list. Face directions that can't be
+	* seen from the view position are skipped, and directions that are adjacent in
+	* the quad data are merged into a single draw. Empty meshes are skipped.
+	* @param DrawList - The list to add to. It must be submitted with the arena this mesh was uploaded to.
+	* @param Origin - The world position of the mesh.
+	* @param ViewPosition - The world position the mesh is viewed from.
 	*/
-	void SwapBuffer();
+	void AddDraw(FChunkDrawList& DrawList, const Vector3i& Origin, const Vector3f& ViewPosition) const;
 
 	/**
-	* Clear data held by the inactive vertex and index
-	* buffers.
+	* Swap sections in the back buffer into the active buffer. Quad data of each
+	* swapped section is uploaded to a new range in the geometry arena and its
+	* previous range is freed.
+	* @param GeometryArena - The arena holding chunk quad data. A mesh must always use the same arena.
+	* @param UploadRing - Staging ring used to upload quad data.
 	*/
-	void ClearBackBuffer();
+	void SwapBuffer(FChunkGeometryArena& GeometryArena, FUploadRing& UploadRing);
 
 	/**
-	* Get vertex position data for the inactive mesh buffer.
+	* Replaces a section of the active buffer with quad data that is already in the
+	* geometry arena, such as sections meshed on the GPU. The previous range is freed.
+	* @param SectionIndex - The index of the section, within [0, SECTION_COUNT).
+	* @param GeometryArena - The arena holding the quad data. A mesh must always use the same arena.
+	* @param Range - The range holding the section's quads, taken by the mesh. Empty for an empty section.
+	* @param Ranges - The quad range of each face direction within Range.
 	*/
-	const Vertex* GetVertexData(BackBuffer) const;
+	void SetFrontSection(const uint32_t SectionIndex, FChunkGeometryArena& GeometryArena, const FChunkGeometryArena::Allocation& Range, const FaceRanges& Ranges);
 
 	/**
-	* Get vertex position data for the active mesh buffer.
+	* Drops the sections held by the back buffer.
 	*/
-	const Vertex* GetVertexData(FrontBuffer) const;
+	void ClearBackBuffer();
 
 	/**
-	* Get the vertex count for the inactive mesh buffer.
+	* Gets the bits of the sections held by the back buffer.
 	*/
-	uint32_t GetVertexCount(BackBuffer) const;
+	uint32_t GetBackSections() const { return mBackSectionMask; }
 
 	/**
-	* Get the vertex count for the active mesh buffer.
+	* Gets the quad data of a section held by the back buffer.
+	* @param SectionIndex - The index of the section, within [0, SECTION_COUNT).
+	* @param RangesOut - To put the quad range of each face direction.
+	* @return Null if the back buffer doesn't hold the section.
 	*/
-	uint32_t GetVertexCount(FrontBuffer) const;
+	const QuadData* GetBackSection(const uint32_t SectionIndex, FaceRanges& RangesOut) const;
 
 	/**
-	* Get index data for the inactive mesh buffer.
+	* Moves the sections held by the back buffer out of the mesh, to be uploaded elsewhere
+	* and put into the active buffer with SetFrontSection. The back buffer is left empty.
+	* @param QuadsOut - To swap the quad data of each taken section into. Should be empty.
+	* @param RangesOut - To put the quad range of each face direction of each taken section.
+	* @return Bits of the sections taken.
 	*/
-	const uint32_t* GetIndexData(BackBuffer) const;
+	uint32_t TakeBackSections(QuadData QuadsOut[SECTION_COUNT], FaceRanges RangesOut[SECTION_COUNT]);
 
 	/**
-	* Get index data for the active mesh buffer.
+	* Get the quad count of the sections in the inactive mesh buffer.
 	*/
-	const uint32_t* GetIndexData(FrontBuffer) const;
+	uint32_t GetQuadCount(BackBuffer) const;
 
 	/**
-	* Get the index count for the inavtive mesh buffer.
+	* Get the quad count for the active mesh buffer.
 	*/
-	uint32_t GetIndexCount(BackBuffer) const;
+	uint32_t GetQuadCount(FrontBuffer) const;
 
 	/**
-	* Get the index count for the active mesh buffer.
+	* Get the quad count of the mesh as it will be after the next swap.
 	*/
-	uint32_t GetIndexCount(FrontBuffer) const;
+	uint32_t GetSwappedQuadCount() const;
 
 private:
-	struct Buffer
+	/**
+	* Quad data of a single mesh section.
+	*/
+	struct Section
 	{
-		enum
-		{
-			Vertex,
-			Index
-		};
+		QuadData   Quads;
+		FaceRanges Ranges;
 	};
 
-private:
-	VertexDataPtr   mVertices[2];
-	IndexDataPtr    mIndices[2];
-
-	// GL buffers held by this object
-	GLuint mVertexArray;
-	GLuint mBuffers[2];
-
-	std::atomic_bool mActiveBuffer;
-};
-
-inline const FChunkMesh::Vertex* FChunkMesh::GetVertexData(FChunkMesh::BackBuffer) const
-{
-	return mVertices[!mActiveBuffer]->data();
-}
+	/**
+	* A section of the active buffer. Its quad data is only held by the geometry arena.
+	*/
+	struct ActiveSection
+	{
+		uint32_t   QuadCount;
+		FaceRanges Ranges;
+	};
 
-inline uint32_t FChunkMesh::GetVertexCount(FChunkMesh::BackBuffer) const
-{
-	return mVertices[!mActiveBuffer]->size();
-}
+	/**
+	* Resets a section to hold no quads, keeping the capacity of its quad data.
+	*/
+	static void ClearSection(Section& SectionOut);
 
-inline const uint32_t* FChunkMesh::GetIndexData(FChunkMesh::BackBuffer) const
-{
-	return mIndices[!mActiveBuffer]->data();
-}
+	/**
+	* Reports the capacity of the back sections' quad data.
+	*/
+	void UpdateQuadBytes();
 
-inline uint32_t FChunkMesh::GetIndexCount(FChunkMesh::BackBuffer) const
-{
-	return mIndices[!mActiveBuffer]->size();
-}
+private:
+	ActiveSection mFrontSections[SECTION_COUNT];
+	Section       mBackSections[SECTION_COUNT];
+	uint32_t      mBackSectionMask;   // Bits of the sections held by mBackSections
+	uint32_t      mFrontQuadCount;
+	FTrackedBytes mQuadBytes;         // Capacity of the back sections' quad data
+
+	// Arena ranges holding the active quad data of each section
+	FChunkGeometryArena*            mGeometryArena;
+	FChunkGeometryArena::Allocation mAllocations[SECTION_COUNT];
+};
 
-inline const FChunkMesh::Vertex* FChunkMesh::GetVertexData(FChunkMesh::FrontBuffer) const
+inline FChunkMesh::Quad FChunkMesh::Quad::Pack(const Vector3i& Block, const uint32_t Width, const uint32_t Height, const uint8_t BlockType,
+	const uint8_t NormalID, const uint8_t LightLevel, const uint8_t Occlusion)
 {
-	return mVertices[mActiveBuffer]->data();
-}
+	static_assert(3 * POSITION_BITS + 2 * SPAN_BITS + 3 <= 32, "Quad placement must fit in 32 bits.");
 
-inline uint32_t FChunkMesh::GetVertexCount(FChunkMesh::FrontBuffer) const
-{
-	return mVertices[mActiveBuffer]->size();
-}
+	// Faces lie on a side of their first block, so positions never reach CHUNK_SIZE and fit in POSITION_BITS
+	const uint32_t Position = (uint32_t)Block.x | ((uint32_t)Block.y << POSITION_BITS) | ((uint32_t)Block.z << (2 * POSITION_BITS));
+	const uint32_t SpanShift = 3 * POSITION_BITS;
 
-inline const uint32_t* FChunkMesh::GetIndexData(FChunkMesh::FrontBuffer) const
-{
-	return mIndices[mActiveBuffer]->data();
+	Quad PackedQuad;
+	PackedQuad.Placement = Position | ((Width - 1) << SpanShift) | ((Height - 1) << (SpanShift + SPAN_BITS)) | ((uint32_t)NormalID << (SpanShift + 2 * SPAN_BITS));
+	PackedQuad.Surface = (uint32_t)BlockType | ((uint32_t)LightLevel << 8) | ((uint32_t)Occlusion << 11);
+	return PackedQuad;
 }
 
-inline uint32_t FChunkMesh::GetIndexCount(FChunkMesh::FrontBuffer) const
+inline uint32_t FChunkMesh::GetQuadCount(FChunkMesh::FrontBuffer) const
 {
-	return mIndices[mActiveBuffer]->size();
+	return mFrontQuadCount;
 }
\ No newline at end of file
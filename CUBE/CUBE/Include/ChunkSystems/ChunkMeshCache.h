@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Math\Vector3.h"
+#include "FileIO\RegionFile.h"
+#include "ChunkMesh.h"
+
+/**
+* Persistent cache of built chunk meshes, so chunks streamed back in with
+* unchanged blocks skip meshing. Each chunk holds the last full mesh built for
+* it, keyed by a hash of everything the mesh was built from. A mismatched hash
+* is a miss, so stale entries are never used and are replaced by the next write.
+*
+* Entries are stored in region files of their own next to the world's, in
+* the Worlds/(world-name)_MeshCache directory. The cache is thread safe.
+*/
+class FChunkMeshCache
+{
+public:
+	// Changes whenever the entry layout or the meshes built from the same blocks change
+	static const uint32_t VERSION = 3;
+
+	// Largest entry a region file sector run holds
+	static const uint32_t MAX_ENTRY_SIZE = 255 * FRegionFile::RegionData::SECTOR_SIZE - sizeof(FRegionFile::ChunkHeader) - 1;
+
+	// Initial value of HashData, and the hash of no data
+	static const uint64_t EMPTY_HASH = 14695981039346656037ull;
+
+	/**
+	* A cached chunk mesh.
+	*/
+	struct MeshData
+	{
+		FChunkMesh::QuadData*     Quads[FChunkMesh::SECTION_COUNT]; // Filled in place, as from FChunkMesh::BeginSection
+		FChunkMesh::FaceRanges    Ranges[FChunkMesh::SECTION_COUNT];
+	};
+
+public:
+	FChunkMeshCache();
+	~FChunkMeshCache();
+
+	FChunkMeshCache(const FChunkMeshCache& Other) = delete;
+	FChunkMeshCache& operator=(const FChunkMeshCache& Other) = delete;
+
+	/**
+	* Opens the cache of a world, closing any cache already open.
+	* @param WorldName - The name of the world.
+	*/
+	void Open(const wchar_t* WorldName);
+
+	/**
+	* Flushes and closes the region files of the cache.
+	*/
+	void Close();
+
+	/**
+	* True if a world's cache is open.
+	*/
+	bool IsOpen() const;
+
+	/**
+	* Continues a 64 bit FNV-1a style hash over a block of data, taken 8 bytes at a time.
+	* @param Data - The data to hash.
+	* @param Size - The size of Data in bytes.
+	* @param Hash - The hash of the data before it.
+	*/
+	static uint64_t HashData(const void* Data, const uint32_t Size, const uint64_t Hash = EMPTY_HASH);
+
+	/**
+	* Reads the cached mesh of a chunk.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param InputHash - The hash of the data the mesh would be built from.
+	* @param MeshOut - To put every section of the mesh. Its quad data must be set, and is resized to fit.
+	* @return False if the chunk has no entry built from the same data.
+	*/
+	bool Read(const Vector3i& ChunkPosition, const uint64_t InputHash, MeshData& MeshOut);
+
+	/**
+	* Writes the mesh of a chunk, replacing its entry. Meshes too large for an
+	* entry are not written.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param InputHash - The hash of the data the mesh was built from.
+	* @param Mesh - The mesh. Every section must be held by its back buffer.
+	*/
+	void Write(const Vector3i& ChunkPosition, const uint64_t InputHash, const FChunkMesh& Mesh);
+
+private:
+	/**
+	* Layout of the start of an entry. The quads of each section follow.
+	*/
+	struct EntryHeader
+	{
+		uint32_t               Version;
+		uint32_t               Padding;
+		uint64_t               InputHash;
+		FChunkMesh::FaceRanges Ranges[FChunkMesh::SECTION_COUNT];
+	};
+
+	// Hash functor for region table
+	struct Vector3iHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	/**
+	* Finds the region file holding a chunk, loading it if needed.
+	* @return Null if the region could not be loaded.
+	*/
+	FRegionFile* GetRegion(const Vector3i& ChunkPosition);
+
+private:
+	std::wstring mCacheName; // Directory of the cache within the worlds directory, empty when closed
+	std::unordered_map<Vector3i, std::unique_ptr<FRegionFile>, Vector3iHash> mRegionFiles;
+	std::vector<uint8_t> mEntryBuffer;
+	mutable std::mutex   mMutex;
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <atomic>
+
+/**
+* Stages a chunk passes through between being queued for load and being drawn.
+*/
+namespace EChunkStage
+{
+	enum Type : uint8_t
+	{
+		Read,   // Reading chunk data from its region file
+		Decode, // Decompressing or generating the data and loading and lighting the blocks
+		Mesh,   // Building the chunk mesh
+		Upload, // Swapping the mesh into the geometry arena on the main thread
+		Count
+	};
+}
+
+/**
+* Timings and throughput of the chunk streaming pipeline. Stage times and
+* counters may be added from any thread. Times are kept for the newest
+* SAMPLES_PER_STAGE samples of each stage, so averages and percentiles follow
+* the current load rather than the whole session.
+*/
+class FChunkPipelineStats
+{
+public:
+	// Newest samples kept for each stage
+	static const uint32_t SAMPLES_PER_STAGE = 512;
+
+	/**
+	* Timing of recent samples, in milliseconds.
+	*/
+	struct Timing
+	{
+		float    AverageMs;
+		float    P99Ms;
+		uint32_t SampleCount;
+	};
+
+	/**
+	* Rates over the last sample period.
+	*/
+	struct Rates
+	{
+		float LoadsPerSecond;
+		float ThrashesPerSecond; // Chunks loaded again soon after being evicted
+		float BytesReadPerSecond;
+		float BytesWrittenPerSecond;
+	};
+
+public:
+	FChunkPipelineStats();
+
+	FChunkPipelineStats(const FChunkPipelineStats& Other) = delete;
+	FChunkPipelineStats& operator=(const FChunkPipelineStats& Other) = delete;
+
+	/**
+	* Adds the time a chunk spent in a stage.
+	* @param Begin - FClock::ReadSystemTimer when the stage began.
+	* @param End - FClock::ReadSystemTimer when the stage ended.
+	*/
+	void AddStageTime(const EChunkStage::Type Stage, const uint64_t Begin, const uint64_t End);
+
+	/**
+	* Adds the time from a chunk being queued for load until its mesh could be drawn.
+	* @param Queued - FClock::ReadSystemTimer when the chunk was queued.
+	* @param Drawable - FClock::ReadSystemTimer when its mesh was swapped in.
+	*/
+	void AddVisibleToDraw(const uint64_t Queued, const uint64_t Drawable);
+
+	/**
+	* Counts a loaded chunk.
+	*/
+	void AddLoad() { mLoadCount++; }
+
+	/**
+	* Counts a chunk loaded again soon after it was evicted.
+	*/
+	void AddThrash() { mThrashCount++; }
+
+	/**
+	* Counts chunk data read from or written to region files.
+	*/
+	void AddBytesRead(const uint32_t Bytes) { mBytesRead += Bytes; }
+	void AddBytesWritten(const uint32_t Bytes) { mBytesWritten += Bytes; }
+
+	/**
+	* Updates the rates from the counters added since the last sample.
+	* @param Elapsed - Seconds since the last sample.
+	*/
+	void SampleRates(const float Elapsed);
+
+	/**
+	* Gets the rates of the last sample. Only valid on the thread sampling the rates.
+	*/
+	Rates GetRates() const { return mRates; }
+
+	/**
+	* Gets the timing of recent samples of a stage.
+	*/
+	Timing GetStageTiming(const EChunkStage::Type Stage) const { return GetTiming(mStages[Stage]); }
+
+	/**
+	* Gets the cycles spent in a stage by every thread since the stats were made. Totals
+	* aren't reset, so spans are measured by the difference of two reads.
+	*/
+	uint64_t GetStageCycles(const EChunkStage::Type Stage) const { return mStageCycles[Stage]; }
+
+	/**
+	* Gets the timing of recent chunks from being queued for load until they could be drawn.
+	*/
+	Timing GetVisibleToDrawTiming() const { return GetTiming(mVisibleToDraw); }
+
+	/**
+	* Drops every sample and the rates. Must be called from the thread sampling the rates.
+	*/
+	void Reset();
+
+	/**
+	* Gets the name of a stage.
+	*/
+	static const char* GetStageName(const EChunkStage::Type Stage);
+
+private:
+	/**
+	* A ring of the newest samples of a timing.
+	*/
+	struct SampleRing
+	{
+		mutable std::mutex Mutex;
+		float              Samples[SAMPLES_PER_STAGE]; // Milliseconds
+		uint32_t           Written;                    // Samples added since the last reset
+	};
+
+	static void AddSample(SampleRing& Ring, const uint64_t Begin, const uint64_t End);
+	static Timing GetTiming(const SampleRing& Ring);
+
+private:
+	SampleRing            mStages[EChunkStage::Count];
+	SampleRing            mVisibleToDraw;
+	std::atomic<uint64_t> mStageCycles[EChunkStage::Count];
+	std::atomic<uint64_t> mLoadCount;
+	std::atomic<uint64_t> mThrashCount;
+	std::atomic<uint64_t> mBytesRead;
+	std::atomic<uint64_t> mBytesWritten;
+
+	// Only used by the thread sampling the rates
+	uint64_t mLastLoadCount;
+	uint64_t mLastThrashCount;
+	uint64_t mLastBytesRead;
+	uint64_t mLastBytesWritten;
+	Rates    mRates;
+};
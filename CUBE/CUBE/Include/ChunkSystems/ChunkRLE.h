@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+* The run length encoded block layout chunks are stored and sent in. Runs are of
+* blocks in FChunk::BlockIndex order, each a block type followed by its length.
+*
+* Row payloads, written before spanning runs, have a byte for each length and
+* restart runs at every row of CHUNK_SIZE blocks. Spanning payloads lead with
+* SPANNING_VERSION and a 0 byte, which no row payload holds as its first length,
+* and their runs cross rows with lengths stored as varints of 7 bits per byte,
+* low bits first. A uniform chunk is then a single run. Both are read, and only
+* spanning payloads are written.
+*/
+class FChunkRLE
+{
+public:
+	// First byte of spanning payloads, followed by a 0 byte
+	static const uint8_t SPANNING_VERSION = 2;
+	static const uint32_t HEADER_SIZE = 2;
+
+	// Largest varint length of a run, the block count of a chunk takes 3
+	static const uint32_t MAX_LENGTH_BYTES = 5;
+
+	/**
+	* A run of blocks of one type.
+	*/
+	struct Run
+	{
+		uint8_t  Type;
+		uint32_t Length;
+	};
+
+	/**
+	* Reads the runs of a payload of either layout in order.
+	*/
+	class RunReader
+	{
+	public:
+		RunReader(const uint8_t* Data, const uint32_t DataSize);
+
+		/**
+		* Reads the next run.
+		* @return False once every run was read, or if the rest of the payload is malformed.
+		*/
+		bool Next(Run& RunOut);
+
+	private:
+		const uint8_t* mData;
+		const uint8_t* mEnd;
+		bool           mIsSpanning;
+	};
+
+public:
+	/**
+	* Encodes blocks as a spanning payload.
+	* @param Blocks - BLOCKS_PER_CHUNK blocks, padded so they can be read a byte past their last.
+	* @param DataOut - To put the payload. Must hold FChunk::MAX_RLE_BYTES.
+	* @return The size of the payload in bytes.
+	*/
+	static uint32_t Encode(const uint8_t* Blocks, uint8_t* DataOut);
+
+	/**
+	* Decodes a payload of either layout. Blocks past the end of the payload are air.
+	* @param BlocksOut - To put the BLOCKS_PER_CHUNK blocks.
+	*/
+	static void Decode(const uint8_t* Data, const uint32_t DataSize, uint8_t* BlocksOut);
+
+	/**
+	* Checks if every run of a payload is of one type. Empty payloads are all air.
+	* @param TypeOut - To put the type of the runs if they are uniform.
+	*/
+	static bool IsUniform(const uint8_t* Data, const uint32_t DataSize, uint8_t& TypeOut);
+
+	/**
+	* The header leading spanning payloads.
+	* @param DataOut - To put the HEADER_SIZE bytes.
+	*/
+	static void WriteHeader(uint8_t* DataOut);
+
+	/**
+	* Appends a run to a spanning payload. Adjacent runs of the same type should be merged first.
+	* @param DataOut - To put the run, which takes at most 1 + MAX_LENGTH_BYTES.
+	* @return The bytes written.
+	*/
+	static uint32_t WriteRun(const uint8_t Type, const uint32_t Length, uint8_t* DataOut);
+};
+
+inline FChunkRLE::RunReader::RunReader(const uint8_t* Data, const uint32_t DataSize)
+	: mData(Data)
+	, mEnd(Data + DataSize)
+	, mIsSpanning(DataSize >= HEADER_SIZE && Data[0] == SPANNING_VERSION && Data[1] == 0)
+{
+	if (mIsSpanning)
+		mData += HEADER_SIZE;
+}
+
+inline bool FChunkRLE::RunReader::Next(Run& RunOut)
+{
+	if (mEnd - mData < 2)
+		return false;
+
+	RunOut.Type = *mData++;
+	if (!mIsSpanning)
+	{
+		RunOut.Length = *mData++;
+		return true;
+	}
+
+	// Truncated or overlong lengths end the payload
+	uint32_t Length = 0;
+	for (uint32_t Shift = 0; mData != mEnd && Shift < 7 * MAX_LENGTH_BYTES; Shift += 7)
+	{
+		const uint8_t Byte = *mData++;
+		Length |= (uint32_t)(Byte & 0x7F) << Shift;
+		if (!(Byte & 0x80))
+		{
+			RunOut.Length = Length;
+			return Length != 0;
+		}
+	}
+
+	mData = mEnd;
+	return false;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ChunkManager.h"
+
+/**
+* Applies the packets of a server's FChunkReplicator to a client's world.
+* Snapshots of chunks the client has loaded set the blocks that differ,
+* snapshots of chunks still loading wait for them along with the edits
+* sent after. Edits of chunks the client has neither loaded nor waits on
+* are dropped, as with ApplyEdits. Only used on the main thread.
+*/
+class FChunkReplica
+{
+public:
+	explicit FChunkReplica(FChunkManager& ChunkManager);
+
+	FChunkReplica(const FChunkReplica& Other) = delete;
+	FChunkReplica& operator=(const FChunkReplica& Other) = delete;
+
+	/**
+	* Applies a packet from the server. Edits of the packet are applied together with ApplyEdits.
+	* @param Packet - The packet as it was sent.
+	* @param Size - The size of the packet in bytes.
+	* @return False if the packet is malformed, its messages up to the malformed one are applied.
+	*/
+	bool Receive(const uint8_t* Packet, const uint32_t Size);
+
+	/**
+	* Applies the snapshots waiting on chunks that have loaded. This should be called once per frame.
+	*/
+	void Update();
+
+	/**
+	* The server tick of the last packet received.
+	*/
+	uint32_t GetTick() const { return mTick; }
+
+	/**
+	* The number of snapshots waiting on their chunk to load.
+	*/
+	uint32_t GetWaitingCount() const { return mWaiting.size(); }
+
+private:
+	// Hash functor for the waiting snapshots
+	struct Vector3iHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	/**
+	* A snapshot waiting on its chunk, with the edits sent since.
+	*/
+	struct WaitingChunk
+	{
+		std::vector<uint8_t>                 BlockData; // RLE block layout
+		std::vector<FChunkManager::BlockEdit> Edits;
+	};
+
+	/**
+	* Adds the edits setting a loaded chunk's blocks to those of a snapshot.
+	* @param BlockData - The RLE block layout of the snapshot.
+	*/
+	void AddSnapshotEdits(const Vector3i& ChunkPosition, const std::vector<uint8_t>& BlockData);
+
+private:
+	FChunkManager&                                               mChunkManager;
+	std::unordered_map<Vector3i, WaitingChunk, Vector3iHash>     mWaiting;
+	std::vector<FChunkManager::BlockEdit>                        mEdits;     // Reused to apply each packet
+	std::vector<uint8_t>                                         mBlockData; // Reused to decode snapshots
+	uint32_t                                                     mTick;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ChunkManager.h"
+
+/**
+* Replicates the loaded chunks of a server's world to its clients. Each
+* client is sent the chunks within its view distance once, as snapshots of
+* their RLE block layout, then only the blocks edited in them. Edits are
+* gathered from the chunk manager's block events and sent once per tick,
+* grouped by chunk, so bandwidth follows the edits made rather than the
+* size of the chunks. Snapshots are paced by a per client byte budget.
+*
+* Packets are handed to a transport that must deliver them reliably and
+* in order, a client's FChunkReplica applies them. Only used on the main
+* thread.
+*
+* Each packet is a uint32_t tick followed by messages, each starting with
+* its EMessage::Type:
+*  Snapshot - int32_t chunk x, y, z, uint8_t FChunkCodec::Codec, uint32_t size, encoded blocks.
+*  Edits    - int32_t chunk x, y, z, uint16_t count, then an FChunk::PackedIndex block index and BlockID per edit.
+*             Indices are uint16_t unless chunks are 64 blocks on a side.
+*  Forget   - int32_t chunk x, y, z of a chunk that left the client's view.
+*/
+class FChunkReplicator
+{
+public:
+	struct EMessage
+	{
+		enum Type : uint8_t
+		{
+			Snapshot,
+			Edits,
+			Forget,
+			Count
+		};
+	};
+
+	/**
+	* Hands a client's packet to the transport.
+	* @param ClientID - The client the packet is for.
+	* @param Packet - The packet, only valid during the call.
+	* @param Size - The size of the packet in bytes.
+	*/
+	using SendFunction = std::function<void(const uint32_t ClientID, const uint8_t* Packet, const uint32_t Size)>;
+
+	// Snapshot bytes each client is sent per tick, at least one snapshot is always sent
+	static const uint32_t DEFAULT_SNAPSHOT_BUDGET = 64 * 1024;
+
+public:
+	/**
+	* Listens to the block events of a chunk manager.
+	* @param Compress - If snapshots are compressed with the LZ codec, trading server time for bandwidth.
+	*/
+	FChunkReplicator(FChunkManager& ChunkManager, const bool Compress = true);
+	~FChunkReplicator();
+
+	FChunkReplicator(const FChunkReplicator& Other) = delete;
+	FChunkReplicator& operator=(const FChunkReplicator& Other) = delete;
+
+	/**
+	* Adds a client with nothing replicated to it yet.
+	* @param ClientID - The ID packets of the client are sent with.
+	*/
+	void AddClient(const uint32_t ClientID);
+
+	void RemoveClient(const uint32_t ClientID);
+
+	/**
+	* Sets the chunks a client is interested in. Chunks it was sent that
+	* leave the range are forgotten, those that enter it are snapshot.
+	* @param CenterChunk - The chunk space position the client views from.
+	* @param ViewDistance - Horizontal distance in chunks of the chunks it is sent.
+	* @param VerticalViewDistance - Vertical distance in chunks of the chunks it is sent.
+	*/
+	void SetClientView(const uint32_t ClientID, const Vector3i& CenterChunk, const uint32_t ViewDistance, const uint32_t VerticalViewDistance);
+
+	/**
+	* Sets the snapshot bytes each client is sent per tick.
+	*/
+	void SetSnapshotBudget(const uint32_t Bytes) { mSnapshotBudget = Bytes; }
+
+	/**
+	* Sends each client the edits made since the last tick to chunks it was
+	* sent, followed by snapshots of the chunks in its view it is waiting on.
+	* Clients with nothing to send are skipped.
+	*/
+	void Tick(const SendFunction& Send);
+
+	/**
+	* Bytes sent to every client since the replicator was created.
+	*/
+	uint64_t GetBytesSent() const { return mBytesSent; }
+
+private:
+	// Hash functor for the chunk tables
+	struct Vector3iHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	/**
+	* An edit within its chunk.
+	*/
+	struct DeltaEdit
+	{
+		FChunk::PackedIndex  Index; // FChunk::BlockIndex of the block
+		FBlockTypes::BlockID ID;
+	};
+
+	struct Client
+	{
+		Vector3i                                   CenterChunk;
+		uint32_t                                   ViewDistance;
+		uint32_t                                   VerticalViewDistance;
+		std::unordered_set<Vector3i, Vector3iHash> Sent;    // Chunks the client holds a snapshot of
+		std::vector<Vector3i>                      Waiting; // Chunks in view to snapshot, farthest first
+		std::vector<Vector3i>                      Forgotten;
+	};
+
+	void OnBlockSet(Vector3i Position, FBlockTypes::BlockID ID);
+
+	void OnBlockDestroy(Vector3i Position, FBlockTypes::BlockID ID);
+
+	void OnBlocksEdited(const FChunkManager::BlockChange* Changes, uint32_t Count);
+
+	void AddEdit(const Vector3i& Position, const FBlockTypes::BlockID ID);
+
+	bool IsInView(const Client& Viewer, const Vector3i& ChunkPosition) const;
+
+private:
+	FChunkManager&                                                     mChunkManager;
+	std::unordered_map<uint32_t, Client>                               mClients;
+	std::unordered_map<Vector3i, std::vector<DeltaEdit>, Vector3iHash> mEdits;       // Edits since the last tick by chunk
+	std::vector<uint8_t>                                               mPacket;      // Reused by Tick
+	std::vector<uint8_t>                                               mChunkData;   // Reused by Tick
+	uint32_t                                                           mTick;
+	uint32_t                                                           mSnapshotBudget;
+	uint64_t                                                           mBytesSent;
+	bool                                                               mCompresses;
+};
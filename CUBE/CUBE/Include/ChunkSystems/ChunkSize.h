@@ -0,0 +1,11 @@
+#pragma once
+
+// Blocks along each axis of a chunk are 1 << CHUNK_SIZE_BITS, so 16, 32 or 64 blocks.
+// Set by the build to compare chunk sizes. Everything sized by FChunk::CHUNK_SIZE
+// follows it, and shaders are compiled with the same value, see FShader. Worlds are
+// only readable at the chunk size they were saved with.
+#ifndef CHUNK_SIZE_BITS
+#define CHUNK_SIZE_BITS 5
+#endif
+
+static_assert(CHUNK_SIZE_BITS >= 4 && CHUNK_SIZE_BITS <= 6, "Chunks must be 16, 32 or 64 blocks on a side.");
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "GL\glew.h"
+#include "ChunkMesh.h"
+#include "Math\Vector3.h"
+#include "Memory\MemoryStats.h"
+
+/**
+* Uploads chunk meshes on a thread of its own, through a GL context shared with the
+* window's, so copying quad data to the driver doesn't take frame time. Each upload
+* writes the quads of a chunk's swapped sections into a staging buffer of their own
+* and fences it. Once the fence has passed, the thread swapping meshes copies the
+* quads into the geometry arena on the GPU and swaps them in, so the arena and the
+* chunks' draw ranges are still only changed by that thread. Staging buffers are
+* deleted as they are copied, and GL keeps them until the copies have run.
+*/
+class FChunkUploader
+{
+public:
+	/**
+	* The sections of a chunk's back buffer, taken to be swapped in once uploaded.
+	*/
+	struct Upload
+	{
+		FChunkMesh::QuadData   Quads[FChunkMesh::SECTION_COUNT];   // Freed by the upload thread once staged
+		FChunkMesh::FaceRanges Ranges[FChunkMesh::SECTION_COUNT];
+		uint32_t               QuadCounts[FChunkMesh::SECTION_COUNT];
+		GLintptr               Offsets[FChunkMesh::SECTION_COUNT]; // Of each section's quads in Buffer, in bytes
+		Vector3i               Position;     // Of the chunk when its swap was taken
+		uint32_t               Index;        // Chunk slot
+		uint32_t               SectionMask;  // Bits of the sections taken
+		uint32_t               Serial;       // Of the chunk slot's mesh when taken, only read by the submitter
+		GLuint                 Buffer;       // Staging buffer, 0 until staged
+		GLsizeiptr             BufferSize;   // In bytes
+		GLsync                 Fence;        // Passed once Buffer is written, null until staged
+		uint64_t               StageBegin;   // FClock::ReadSystemTimer around the staging, on the upload thread
+		uint64_t               StageEnd;
+	};
+
+public:
+	/**
+	* Starts the upload thread, which makes a GL context of its own.
+	*/
+	FChunkUploader();
+
+	/**
+	* Stops the upload thread. Uploads that weren't completed are dropped along with their buffers.
+	*/
+	~FChunkUploader();
+
+	FChunkUploader(const FChunkUploader& Other) = delete;
+	FChunkUploader& operator=(const FChunkUploader& Other) = delete;
+
+	/**
+	* Queues an upload. Its quads are only read by the upload thread from here on.
+	*/
+	void Submit(std::unique_ptr<Upload> NewUpload);
+
+	/**
+	* Takes the uploads whose fences have passed, in the order they were submitted.
+	* Their staging buffers must be copied from and deleted by the caller.
+	* @param UploadsOut - To add the finished uploads to.
+	* @param Wait - If every submitted upload is waited for.
+	*/
+	void Complete(std::vector<std::unique_ptr<Upload>>& UploadsOut, const bool Wait);
+
+	/**
+	* The number of uploads submitted and not yet completed.
+	*/
+	uint32_t GetPendingCount() const;
+
+private:
+	void UploadThreadLoop();
+
+	/**
+	* Writes the quads of an upload into a new staging buffer and fences it.
+	*/
+	void Stage(Upload& Pending);
+
+	/**
+	* Sums the quad data held by uploads that aren't staged yet. Must hold mMutex.
+	*/
+	void UpdateQuadBytes();
+
+private:
+	std::deque<std::unique_ptr<Upload>> mQueued; // Waiting for the upload thread
+	std::deque<std::unique_ptr<Upload>> mStaged; // Fenced, waiting to be completed, oldest first
+	std::thread             mUploadThread;
+	mutable std::mutex      mMutex;              // Guards both queues and the tracked bytes
+	std::condition_variable mUploadAvailable;
+	std::condition_variable mUploadStaged;
+	FTrackedBytes           mQuadBytes;          // Quads waiting to be staged
+	FTrackedBytes           mStagingBytes;       // Staging buffers not yet completed
+	uint64_t                mStagingByteCount;
+	bool                    mIsStaging;          // If the upload thread holds an upload taken from mQueued
+	bool                    mMustStop;
+};
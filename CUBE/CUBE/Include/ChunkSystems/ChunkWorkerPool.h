@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+* A fixed set of worker threads used to process chunk load and
+* rebuild jobs in parallel. Every job is submitted for a chunk slot
+* (an index into the chunk array). Jobs for the same slot are executed
+* in submission order and never concurrently, so a rebuild submitted
+* after a load for the same chunk will always wait on that load.
+*
+* Urgent jobs, such as rebuilds of edited chunks, are taken before any
+* other ready job. Reserved workers only take urgent jobs, so they are
+* started right away however much other work is queued.
+*/
+class FChunkWorkerPool
+{
+public:
+	using Job = std::function<void()>;
+
+public:
+	FChunkWorkerPool();
+
+	/**
+	* Dtor
+	* Waits for all submitted work to finish and joins all workers.
+	*/
+	~FChunkWorkerPool();
+
+	FChunkWorkerPool(const FChunkWorkerPool& Other) = delete;
+	FChunkWorkerPool& operator=(const FChunkWorkerPool& Other) = delete;
+
+	/**
+	* Starts the pool with a specific amount of worker threads. If the pool is
+	* already running, current work is finished and the workers are restarted.
+	* @param WorkerCount - The number of worker threads. Must be at least 1.
+	* @param ReservedCount - Worker threads started on top of them that only take urgent jobs.
+	*/
+	void Start(const uint32_t WorkerCount, const uint32_t ReservedCount = 0);
+
+	/**
+	* Finishes all submitted work and joins all workers.
+	*/
+	void Stop();
+
+	/**
+	* Submits a job for a chunk slot.
+	* @param Slot - The chunk slot this job operates on.
+	* @param NewJob - The work to execute.
+	* @param IsUrgent - If the job is taken before other ready jobs, and by reserved workers.
+	*/
+	void Submit(const uint32_t Slot, Job NewJob, const bool IsUrgent = false);
+
+	/**
+	* Blocks until every submitted job has completed.
+	*/
+	void WaitForIdle();
+
+	/**
+	* The number of jobs that have been submitted, but have not
+	* completed.
+	*/
+	uint32_t GetPendingJobCount() const { return mPendingJobs; }
+
+	/**
+	* The total number of jobs completed by this pool.
+	*/
+	uint64_t GetCompletedJobCount() const { return mCompletedJobs; }
+
+	/**
+	* Checks if no job is running on or waiting for a slot.
+	*/
+	bool IsSlotIdle(const uint32_t Slot) const;
+
+	/**
+	* The number of worker threads that take any job, reserved workers left out.
+	*/
+	uint32_t GetWorkerCount() const { return mWorkers.size() - mReservedCount; }
+
+private:
+	/**
+	* @param IsReserved - If the worker only takes urgent jobs.
+	*/
+	void WorkerThreadLoop(const bool IsReserved);
+
+	struct SlotRecord
+	{
+		uint32_t Slot;
+		Job      Work;
+		bool     IsUrgent;
+	};
+
+	/**
+	* Makes a job ready to run, waking a worker that may take it. Must hold mJobMutex.
+	*/
+	void PushReady(SlotRecord&& Record);
+
+private:
+	std::vector<std::thread>                              mWorkers;
+	std::deque<SlotRecord>                                mReadyJobs;   // Jobs that may run now
+	std::deque<SlotRecord>                                mUrgentJobs;  // Urgent jobs that may run now, taken first
+	std::unordered_map<uint32_t, std::deque<SlotRecord>>  mBusySlots;   // Slots with an active job, and the jobs waiting on it
+	mutable std::mutex                                    mJobMutex;
+	std::condition_variable                               mJobAvailable;
+	std::condition_variable                               mUrgentJobAvailable; // Only waited on by reserved workers
+	std::condition_variable                               mJobsFinished;
+	std::atomic<uint32_t>                                 mPendingJobs;
+	std::atomic<uint64_t>                                 mCompletedJobs;
+	uint32_t                                              mReservedCount;
+	bool                                                  mMustStop;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <climits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Math\Vector3.h"
+#include "Chunk.h"
+
+class FBlockStorage;
+
+/**
+* The height of the top solid block of every block column, kept for each chunk
+* column that has been loaded and saved with the world. Heights are raised by
+* loaded chunks and placed blocks, and lowered by the owner when the top block of
+* a column is removed. Columns whose surface lies in chunks that aren't loaded
+* may read higher than their surface, never lower. Any thread may read or update.
+*/
+class FColumnHeights
+{
+public:
+	// Height of columns holding no known solid block
+	static const int32_t NO_SURFACE = INT_MIN;
+
+public:
+	FColumnHeights();
+
+	FColumnHeights(const FColumnHeights& Other) = delete;
+	FColumnHeights& operator=(const FColumnHeights& Other) = delete;
+
+	/**
+	* Loads the heights saved with a world, dropping every height held.
+	* @param WorldName - The name of the world.
+	*/
+	void Open(const wchar_t* WorldName);
+
+	/**
+	* Saves every height with the world last opened.
+	* @return False if the heights could not be written.
+	*/
+	bool Save() const;
+
+	/**
+	* The height of a column.
+	* @param X, Z - The world position of the column.
+	* @return One above the top solid block, or NO_SURFACE if the column has none.
+	*/
+	int32_t GetHeight(const int32_t X, const int32_t Z) const;
+
+	/**
+	* Raises the columns of a chunk to its solid blocks.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param Blocks - The blocks of the chunk.
+	*/
+	void RaiseColumns(const Vector3i& ChunkPosition, const FBlockStorage& Blocks);
+
+	/**
+	* Raises a column to a height if it is lower.
+	*/
+	void Raise(const int32_t X, const int32_t Z, const int32_t Height);
+
+	/**
+	* Lowers a column, unless it was changed since it was found at a height.
+	* @param From - The height the column was found at.
+	* @param To - The height of the column below From.
+	*/
+	void Lower(const int32_t X, const int32_t Z, const int32_t From, const int32_t To);
+
+private:
+	// Hash functor for the column table
+	struct Vector3iHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.z * 83492791));
+		}
+	};
+
+	/**
+	* The heights of the block columns of a chunk column.
+	*/
+	struct ChunkColumn
+	{
+		int32_t Heights[FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE];
+	};
+
+	/**
+	* The height of a column, added with no surface if its chunk column has none.
+	*/
+	int32_t& FindHeight(const int32_t X, const int32_t Z);
+
+private:
+	std::unordered_map<Vector3i, ChunkColumn, Vector3iHash> mColumns; // By chunk column, y is 0
+	std::wstring       mFilepath;
+	mutable std::mutex mMutex;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GL\glew.h"
+#include "Math\Vector3.h"
+#include "Chunk.h"
+#include "BlockTypes.h"
+#include "Memory\MemoryStats.h"
+
+class FWorldGenerator;
+
+/**
+* A coarse heightmap of the world's surface drawn beyond the loaded chunks, so the
+* world doesn't end at the view distance. The map is a grid of GRID_SIZE^2 surface
+* samples, one for each chunk column corner, centered on the camera. Samples are
+* taken from the world generator and kept in a toroidal grid, so moving the camera
+* only samples the columns that entered the grid. Cells of chunk columns within the
+* view distance are left out, so the loaded chunks are drawn in their place.
+*/
+class FFarTerrain
+{
+public:
+	// Samples along each side of the grid
+	static const int32_t GRID_SIZE = 128;
+
+	// Blocks between samples, so each cell covers a chunk column
+	static const int32_t CELL_SIZE = FChunk::CHUNK_SIZE;
+
+public:
+	/**
+	* Creates the terrain's buffers and vertex array.
+	*/
+	FFarTerrain();
+
+	/**
+	* Deletes every GL object held by the terrain.
+	*/
+	~FFarTerrain();
+
+	FFarTerrain(const FFarTerrain& Other) = delete;
+	FFarTerrain& operator=(const FFarTerrain& Other) = delete;
+
+	/**
+	* Sets the generator the surface is sampled from, dropping every sample.
+	* @param Generator - The generator of a world made with FWorldGenerator::CreateWorld, or nullptr to draw nothing.
+	*/
+	void SetGenerator(const FWorldGenerator* Generator);
+
+	/**
+	* Recenters the grid on the camera and rebuilds the mesh if the grid or the loaded
+	* area moved. The first update after the generator is set samples the whole grid.
+	* @param CameraChunk - The chunk the camera is in.
+	* @param ViewDistance - The view distance in chunks. Chunk columns within it aren't drawn.
+	* @param WorldSize - The size of the world in chunks, or 0 if it is unbounded. Columns outside the world aren't drawn.
+	*/
+	void Update(const Vector3i& CameraChunk, const int32_t ViewDistance, const int32_t WorldSize);
+
+	/**
+	* Draws the terrain in a single draw. A far terrain shader must be active.
+	*/
+	void Render() const;
+
+private:
+	/**
+	* A vertex of the grid, at the top of a column's highest solid block.
+	*/
+	struct Vertex
+	{
+		float                Position[3];
+		int8_t               Normal[3];
+		FBlockTypes::BlockID BlockType;
+	};
+
+	/**
+	* Samples an area of the grid, in cell coordinates.
+	*/
+	void SampleCells(const int32_t FirstX, const int32_t FirstZ, const int32_t CountX, const int32_t CountZ);
+
+	/**
+	* Rebuilds and uploads the vertices and indices of the grid.
+	*/
+	void BuildMesh();
+
+	/**
+	* The index of a cell's sample within the toroidal grid.
+	*/
+	static int32_t SampleIndex(const int32_t CellX, const int32_t CellZ);
+
+private:
+	const FWorldGenerator*            mGenerator;
+	std::vector<int32_t>              mHeights; // Surface height of each sample, in the toroidal grid
+	std::vector<FBlockTypes::BlockID> mIDs;     // Surface block of each sample, in the toroidal grid
+	std::vector<int32_t>              mSampledHeights; // Reused by SampleCells
+	std::vector<FBlockTypes::BlockID> mSampledIDs;
+	std::vector<Vertex>               mVertices;       // Reused by BuildMesh
+	std::vector<uint32_t>             mIndices;
+	Vector3i      mOrigin;     // Cell of the first sample of the grid, y is unused
+	bool          mHasSamples; // False until the first update after the generator is set
+	int32_t       mViewDistance;
+	int32_t       mWorldSize;
+	GLuint        mVertexArray;
+	GLuint        mVertexBuffer;
+	GLuint        mIndexBuffer;
+	uint32_t      mIndexCount;
+	FTrackedBytes mBufferBytes; // Size of the vertex and index buffers
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <type_traits>
+
+#include "Math\Vector3.h"
+#include "ChunkSize.h"
+#include "BlockTypes.h"
+
+/**
+* Cellular fluids, such as water and lava. A fluid is a run of block types, one for
+* each level it flows at, of which the highest is a source block. Fluid falls into
+* the cell below, and spreads one level lower into the cells beside it when it rests
+* on a block. Flowing fluid that nothing flows into drains.
+* Only active cells are stepped. Cells become active when a block their next state
+* is read from changes, and are held in a sparse list for each chunk. Fluids are
+* added before the world is simulated, after which Step can be called from any thread.
+*/
+class FFluidSimulator
+{
+public:
+	// Cells the next state of a cell is read from: above, the four sides, and below each side
+	static const uint32_t NEIGHBORHOOD_SIZE = 9;
+	static const Vector3i NEIGHBORHOOD[NEIGHBORHOOD_SIZE];
+
+	// A chunk local position packed at CHUNK_SIZE_BITS an axis, see UnpackCell
+	using PackedCell = std::conditional<(3 * CHUNK_SIZE_BITS <= 16), uint16_t, uint32_t>::type;
+
+	/**
+	* The active cells of a chunk.
+	*/
+	struct ActiveChunk
+	{
+		Vector3i              ChunkPosition;
+		std::vector<PackedCell> Cells; // Packed local positions, see UnpackCell
+	};
+
+public:
+	FFluidSimulator();
+
+	FFluidSimulator(const FFluidSimulator& Other) = delete;
+	FFluidSimulator& operator=(const FFluidSimulator& Other) = delete;
+
+	/**
+	* Adds a fluid.
+	* @param First - The block type of the lowest level, the rest follow it.
+	* @param LevelCount - The number of levels including the source, at least 2.
+	*/
+	void AddFluid(const FBlockTypes::BlockID First, const uint32_t LevelCount);
+
+	/**
+	* Checks if any fluid was added.
+	*/
+	bool HasFluids() const { return !mFluids.empty(); }
+
+	/**
+	* Checks if a block type is a level of a fluid.
+	*/
+	bool IsFluid(const FBlockTypes::BlockID ID) const { return mLevels[ID].Fluid != 0; }
+
+	/**
+	* Activates a changed block and every cell whose neighborhood holds it.
+	* @param Position - The world position of the block.
+	*/
+	void ActivateAround(const Vector3i& Position);
+
+	/**
+	* Takes every active cell, one entry for each chunk. Each chunk's cells are unique.
+	* @param ChunksOut - Set to the chunks holding active cells.
+	*/
+	void TakeActive(std::vector<ActiveChunk>& ChunksOut);
+
+	/**
+	* Drops every active cell.
+	*/
+	void Clear() { mActive.clear(); }
+
+	/**
+	* The next state of a cell.
+	* @param ID - The block of the cell.
+	* @param Neighborhood - The blocks of the cell's NEIGHBORHOOD, in order.
+	* @return The block the cell holds after the step.
+	*/
+	FBlockTypes::BlockID Step(const FBlockTypes::BlockID ID, const FBlockTypes::BlockID* Neighborhood) const;
+
+	/**
+	* The local position of a packed cell.
+	*/
+	static Vector3i UnpackCell(const PackedCell Cell);
+
+private:
+	// Hash functor for the active cell table
+	struct Vector3iHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	struct Fluid
+	{
+		FBlockTypes::BlockID First;
+		uint32_t             LevelCount;
+	};
+
+	/**
+	* The fluid a block type is a level of.
+	*/
+	struct LevelRecord
+	{
+		uint8_t Fluid; // Index of the fluid plus one, 0 if the type isn't a fluid
+		uint8_t Level; // From 1, LevelCount for the source
+	};
+
+private:
+	std::vector<Fluid> mFluids;
+	LevelRecord        mLevels[256]; // By block type
+	std::unordered_map<Vector3i, std::vector<PackedCell>, Vector3iHash> mActive; // By chunk, may hold repeats
+};
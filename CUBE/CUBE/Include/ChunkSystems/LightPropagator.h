@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "Math\Vector3.h"
+#include "Block.h"
+#include "BlockStorage.h"
+#include "ChunkLight.h"
+
+class FChunk;
+
+/**
+* Flood fills sky and block light through the blocks of loaded chunks that
+* aren't opaque, see FBlockTypes::Property. Light drops a level with each block
+* it spreads to, except full sky light, which falls straight down without
+* dimming. Opaque blocks hold no light unless they emit it.
+*
+* Changes are applied incrementally. Removed light is cleared outward from
+* its source first, then the light bordering the cleared blocks fills back
+* in, so an edit only touches the blocks its light reaches.
+*
+* A propagator is not thread safe. Blocks are read once per pass, so blocks
+* must not be edited between a change and TakeChanges.
+*/
+class FLightPropagator
+{
+public:
+	/**
+	* Finds a loaded chunk by chunk position, or returns null.
+	*/
+	using ChunkLookup = std::function<FChunk*(const Vector3i& ChunkPosition)>;
+
+	/**
+	* Mesh sections of a chunk with faces lit differently after a pass.
+	*/
+	struct ChunkChange
+	{
+		Vector3i ChunkPosition;
+		uint32_t SectionMask;
+	};
+
+public:
+	explicit FLightPropagator(const ChunkLookup& FindChunk);
+
+	FLightPropagator(const FLightPropagator& Other) = delete;
+	FLightPropagator& operator=(const FLightPropagator& Other) = delete;
+
+	/**
+	* Lights the blocks of a chunk on its own. Sky light enters every open
+	* column at the top of the chunk until AddChunk joins it to the chunk above.
+	* @param Blocks - The blocks of the chunk.
+	* @param LightOut - To put the light of each block.
+	*/
+	static void LightChunk(const FBlockStorage& Blocks, FChunkLight& LightOut);
+
+	/**
+	* Joins the light of a chunk lit by LightChunk with its loaded neighbors.
+	* @param ChunkPosition - The position of the chunk.
+	*/
+	void AddChunk(const Vector3i& ChunkPosition);
+
+	/**
+	* Relights around a block that was edited.
+	* @param Position - The world position of the block.
+	*/
+	void UpdateBlock(const Vector3i& Position);
+
+	/**
+	* Spreads all light changes made since the last call.
+	*/
+	void Propagate();
+
+	/**
+	* Ends a pass, dropping the blocks read during it.
+	* @param ChangesOut - To put the mesh sections of each chunk lit differently during the pass.
+	*/
+	void TakeChanges(std::vector<ChunkChange>& ChangesOut);
+
+private:
+	/**
+	* A loaded chunk touched during a pass.
+	*/
+	struct ChunkEntry
+	{
+		ChunkEntry()
+			: Chunk(nullptr)
+			, Blocks()
+			, SectionMask(0)
+		{}
+		FChunk*             Chunk;       // Null if the chunk isn't loaded
+		std::vector<FBlock> Blocks;      // Blocks of the chunk when it was first touched
+		uint32_t            SectionMask; // Sections with faces lit differently
+	};
+
+	/**
+	* A block within a touched chunk.
+	*/
+	struct Cell
+	{
+		ChunkEntry* Entry;
+		uint32_t    Index; // FChunk::BlockIndex of the block
+	};
+
+	/**
+	* Light removed from a block, to be cleared from the blocks it reached.
+	*/
+	struct LightNode
+	{
+		Vector3i Position;
+		uint8_t  Level;
+	};
+
+	// Hash functor for chunk position maps
+	struct ChunkPositionHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	ChunkEntry& GetChunk(const Vector3i& ChunkPosition);
+
+	/**
+	* Finds the block at a world position.
+	* @return False if the block's chunk isn't loaded.
+	*/
+	bool FindCell(const Vector3i& Position, Cell& CellOut);
+
+	/**
+	* Sets the light of a block and marks the mesh sections it lights.
+	*/
+	void SetLight(const Vector3i& Position, const Cell& Target, const uint8_t Levels);
+
+	/**
+	* Clears removed light of one channel from the blocks it reached.
+	*/
+	void RemoveLight(std::deque<LightNode>& Removals, const bool IsSky);
+
+	/**
+	* Spreads light from every queued block.
+	*/
+	void AddLight();
+
+private:
+	ChunkLookup mFindChunk;
+	std::unordered_map<Vector3i, ChunkEntry, ChunkPositionHash> mChunks; // Chunks touched during the pass
+	Vector3i    mLastChunkPosition;
+	ChunkEntry* mLastChunk;
+
+	std::deque<Vector3i>  mAdditions;     // Blocks to spread light from
+	std::deque<LightNode> mSkyRemovals;
+	std::deque<LightNode> mBlockRemovals;
+};
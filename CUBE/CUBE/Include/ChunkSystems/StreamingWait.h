@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+class FChunkManager;
+
+/**
+* Waits for chunk streaming to go idle, so nothing streams in while something
+* is measured. Streaming is idle once the pipeline had no work left for
+* IDLE_FRAMES frames in a row, and the wait gives up after MAX_FRAMES frames.
+*/
+class FStreamingWait
+{
+public:
+	// Frames without any streaming work before streaming is idle
+	static const uint32_t IDLE_FRAMES = 30;
+
+	// Frames waited for streaming to go idle before giving up
+	static const uint32_t MAX_FRAMES = 3600;
+
+public:
+	FStreamingWait();
+
+	/**
+	* Starts waiting again.
+	*/
+	void Reset();
+
+	/**
+	* Counts a frame. Call once per frame while waiting.
+	* @param ChunkManager - The chunks whose streaming is waited for.
+	* @return If the wait is over, as streaming went idle or the wait gave up.
+	*/
+	bool Update(FChunkManager& ChunkManager);
+
+	/**
+	* Checks if streaming went idle, rather than the wait giving up.
+	*/
+	bool IsIdle() const { return mIdleFrames >= IDLE_FRAMES; }
+
+	/**
+	* Gets the frames counted since the wait started.
+	*/
+	uint32_t GetFrameCount() const { return mFrames; }
+
+private:
+	uint32_t mFrames;
+	uint32_t mIdleFrames; // Frames in a row without streaming work
+};
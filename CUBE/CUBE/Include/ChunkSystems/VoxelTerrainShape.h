@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include "BulletPhysics\btBulletCollisionCommon.h"
+
+class FChunkManager;
+
+/**
+* Collision shape of the whole world's terrain, answered directly from chunk
+* block storage, so block edits and chunk loads need no collision rebuild.
+* Queries emit the 2 triangles of each solid block face bordering air within
+* the query box. Blocks of chunks that aren't loaded are air.
+*
+* Blocks are read through FChunkManager::GetSolidBlocks, so queries may run on
+* any thread. A query reads every block of its box within the shape's bounds,
+* so it costs the volume of the box, a chunk sized piece at a time.
+*/
+ATTRIBUTE_ALIGNED16(class) FVoxelTerrainShape : public btConcaveShape
+{
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	/**
+	* Constructs the terrain shape of a world.
+	* @param ChunkManager - The manager of the world's chunks.
+	*/
+	FVoxelTerrainShape(const FChunkManager& ChunkManager);
+
+	void processAllTriangles(btTriangleCallback* Callback, const btVector3& AabbMin, const btVector3& AabbMax) const override;
+
+	void getAabb(const btTransform& Transform, btVector3& AabbMin, btVector3& AabbMax) const override;
+
+	void setLocalScaling(const btVector3& Scaling) override { mLocalScaling = Scaling; }
+
+	const btVector3& getLocalScaling() const override { return mLocalScaling; }
+
+	void calculateLocalInertia(btScalar Mass, btVector3& Inertia) const override;
+
+	const char* getName() const override { return "VoxelTerrain"; }
+
+	/**
+	* Limits the bounds of the shape to a box, so only bodies within it are paired
+	* with the terrain. Nothing may collide while the bounds change.
+	* @param Min, Max - Corners of the box in world space.
+	*/
+	void SetBounds(const btVector3& Min, const btVector3& Max);
+
+private:
+	const FChunkManager& mChunkManager;
+	btVector3            mLocalScaling;
+	btVector3            mBoundsMin;
+	btVector3            mBoundsMax;
+};
@@ -4,6 +4,8 @@
 #include "Math\Vector2.h"
 #include "Math\Vector3.h"
 #include "LibNoise\noiseutils.h"
+#include "LibNoise\module\perlin.h"
+#include "Math\SIMDNoise.h"
 #include "BlockTypes.h"
 
 #include <vector>
@@ -51,13 +53,84 @@ public:
 	void SetBounds(const Vector2f LowerBounds, const Vector2f UpperBounds);
 
 	/**
-	* Builds the world region files.
-	* @param NoiseModule - The noise module used to build to world.
+	* Sets the number of threads used to build worlds.
+	* @param Count - The number of threads. Clamped to at least 1.
+	*/
+	void SetThreadCount(const uint32_t Count) { mThreadCount = (Count > 0) ? Count : 1; }
+
+	/**
+	* Samples heights with FSIMDNoise in place of the noise module given to
+	* Build or CreateWorld, which should then be the same Perlin module.
+	* @param PerlinModule - The module to take noise parameters from.
+	*/
+	void SetSIMDNoise(const noise::module::Perlin& PerlinModule);
+
+	/**
+	* Samples heights with the noise module again.
+	*/
+	void ClearSIMDNoise() { mUseSIMDNoise = false; }
+
+	/**
+	* Carves caves out of the terrain where a 3D noise module is above a threshold, which
+	* also leaves overhangs where caves break through the surface. The module is sampled
+	* on a lattice of LatticeSpacing blocks and interpolated trilinearly in between, so
+	* a chunk takes at most (CHUNK_SIZE / LatticeSpacing + 1)^3 samples, and chunks of air
+	* take none.
+	* @param CaveModule - Sampled at world block coordinates, so its frequency sets the size of caves. Must outlive generation and be safe to evaluate from several threads.
+	* @param Threshold - Blocks are carved where the interpolated noise is above it.
+	* @param LatticeSpacing - The distance in blocks between samples, 4 or 8.
+	*/
+	void SetCaves(const noise::module::Module& CaveModule, const float Threshold, const int32_t LatticeSpacing = 4);
+
+	/**
+	* Stops carving caves.
+	*/
+	void ClearCaves() { mCaveModule = nullptr; }
+
+	/**
+	* Builds the world region files. Heightmap tiles and regions are
+	* built in parallel.
+	* @param NoiseModule - The noise module used to build to world. Must be safe to evaluate from several threads, so it can't contain Cache modules.
 	* @param WorldName - The name of the world to build.
 	*/
 	void Build(noise::module::Module& NoiseModule, const wchar_t* WorldName);
 
+	/**
+	* Creates a world without building its regions, so it can be loaded
+	* at once. Chunks are generated from the noise module as they are
+	* first loaded.
+	* @param NoiseModule - The noise module used to generate the world. Must outlive generation and be safe to evaluate from several threads.
+	* @param WorldName - The name of the world to create.
+	* @param Unbounded - If the world has no edges. The world size then only sets the scale of the noise bounds.
+	*/
+	void CreateWorld(const noise::module::Module& NoiseModule, const wchar_t* WorldName, const bool Unbounded = false);
+
+	/**
+	* Generates RLE data for a single chunk from noise sampled for just
+	* its column. Thread safe. Requires the noise module set by CreateWorld.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param DataOut - RLE data for this chunk will be placed here.
+	* @return The size of the data added to DataOut.
+	*/
+	uint32_t GenerateChunk(const Vector3i& ChunkPosition, std::vector<uint8_t>& DataOut) const;
+
+	/**
+	* Samples the surface of a grid of block columns without building any chunks, for
+	* terrain drawn beyond the loaded chunks. Thread safe. Requires the noise module set
+	* by CreateWorld.
+	* @param FirstX, FirstZ - The world block position of the first column.
+	* @param Spacing - The distance in blocks between sampled columns.
+	* @param CountX, CountZ - The size of the grid in columns.
+	* @param HeightsOut - To put the world height of the top of each column's highest solid block, ordered by z, then x.
+	* @param IDsOut - To put the type of each column's highest solid block.
+	*/
+	void SampleSurface(const int32_t FirstX, const int32_t FirstZ, const int32_t Spacing, const int32_t CountX, const int32_t CountZ,
+		int32_t* HeightsOut, FBlockTypes::BlockID* IDsOut) const;
+
 private:
+	// Times BuildChunk on fixed heightmaps
+	friend class SMicroBenchmarks;
+
 	/**
 	* Builds a heightmap with the currently stored world info.
 	* @param NoiseModule - The module to built the map with.
@@ -65,6 +138,33 @@ private:
 	*/
 	void BuildHeightMap(const noise::module::Module& NoiseModule, utils::NoiseMap& HeightMapOut);
 
+	/**
+	* Samples noise for an area of the world heightmap. Rows are world x
+	* and columns world z, matching utils::NoiseMapBuilderPlane over the
+	* world bounds.
+	* @param NoiseModule - The module to sample, unless SIMD noise is set.
+	* @param FirstRow, FirstColumn - The world block position of the first sample.
+	* @param RowCount, ColumnCount - The size of the area in samples.
+	* @param HeightsOut - To put the samples, row by row.
+	* @param Stride - The distance between rows in HeightsOut.
+	* @param Spacing - The distance in blocks between samples.
+	*/
+	void SampleHeights(const noise::module::Module& NoiseModule, const int32_t FirstRow, const int32_t RowCount,
+		const int32_t FirstColumn, const int32_t ColumnCount, float* HeightsOut, const int32_t Stride, const int32_t Spacing = 1) const;
+
+	/**
+	* Samples the cave module on the lattice of a chunk.
+	* @param WorldPosition - The world position of the chunk.
+	* @param LayerCount - The layers of the lattice to sample from the bottom.
+	* @param LatticeOut - To put the samples, indexed [y][x][z] with CHUNK_SIZE / mCaveSpacing + 1 along each axis.
+	*/
+	void SampleCaveLattice(const Vector3i& WorldPosition, const int32_t LayerCount, float* LatticeOut) const;
+
+	/**
+	* Finds the block type used at a world height from the table of every level's heights.
+	*/
+	FBlockTypes::BlockID TerrainBlock(const int32_t WorldY) const;
+
 	/**
 	* Builds a region file for a world from a given heightmap.
 	* @param WorldName - The name of the world for this region.
@@ -74,15 +174,23 @@ private:
 	void BuildRegion(const wchar_t* WorldName, const Vector3i& RegionPosition, const utils::NoiseMap& HeightMap);
 
 	/**
-	* Builds RLE chunk data based of a heightmap.
+	* Builds RLE chunk data based of a heightmap. Column heights are mapped with SSE, and
+	* each row of blocks is compared against them at once. Caves are carved from the rows
+	* when set.
 	* @param WorldPosition - The world position of this chunk.
-	* @param HeightMap - The heightmap to use to build this chunk.
+	* @param Heights - Heightmap samples for the chunk's first block column.
+	* @param Stride - The distance between heightmap rows, which are along x.
 	* @param DataOut - RLE data for this chunk will be placed here.
 	* @return The size of the data added to DataOut.
 	*/
-	uint32_t BuildChunk(const Vector3i& WorldPosition, const utils::NoiseMap& HeightMap, std::vector<uint8_t>& DataOut);
+	uint32_t BuildChunk(const Vector3i& WorldPosition, const float* Heights, const int32_t Stride, std::vector<uint8_t>& DataOut) const;
 
-	void BuildWorldInfoFile(const wchar_t* WorldName) const;
+	/**
+	* Creates the world directory and info file.
+	* @param WorldName - The name of the world.
+	* @param WorldSize - The size of the world in chunks, or 0 if it is unbounded.
+	*/
+	void BuildWorldInfoFile(const wchar_t* WorldName, const int32_t WorldSize) const;
 
 
 private:
@@ -93,11 +201,20 @@ private:
 	};
 
 private:
-	std::vector<TerrainLevelRecord> mTerrainLevels;
+	std::vector<TerrainLevelRecord> mTerrainLevels; // Sorted from the highest starting height
+	std::vector<FBlockTypes::BlockID> mTerrainTable; // Type of each height from the lowest starting height to the highest
+	int32_t mTerrainTableFirst;
+	const noise::module::Module* mNoiseModule;      // Module chunks are generated from on demand
+	const noise::module::Module* mCaveModule;       // 3D noise caves are carved with, or null
+	float mCaveThreshold;
+	int32_t mCaveSpacing;                           // Blocks between cave lattice points
+	FSIMDNoise mSIMDNoise;
+	bool mUseSIMDNoise;
 	Vector2f mLowerBounds;
 	Vector2f mUpperBounds;
 	int32_t mWorldSizeInChunks;
 	int32_t mMaxHeight;
 	int32_t mMinHeight;
+	uint32_t mThreadCount;
 };
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "Atlas\Behavior.h"
+#include "Physics\RigidBodyPool.h"
 
 class CBoxShooter : public Atlas::FBehavior
 {
@@ -7,6 +8,9 @@ public:
 	CBoxShooter();
 	~CBoxShooter();
 
+	void OnStart() override;
 	void Update() override;
-};
 
+private:
+	FRigidBodyPool mBoxes;
+};
@@ -3,6 +3,7 @@
 #include "BulletPhysics\btBulletCollisionCommon.h"
 #include "Atlas\ComponentTypes.h"
 #include "Common.h"
+#include "Physics\CollisionShapeRegistry.h"
 
 /**
 * Collision component for gameobjects that
@@ -12,18 +13,18 @@ WIN_ALIGN(16)
 struct FCollider : public Atlas::IComponent
 {
 	FCollider(const btMotionState* StartState = nullptr)
-		: BoxCollider(btVector3{0.5f, 0.5f, 0.5f})
+		: Shape(FCollisionShapeRegistry::GetBox(btVector3{ 0.5f, 0.5f, 0.5f }))
 		, CollisionObject()
 	{
-		CollisionObject.setCollisionShape(&BoxCollider);
+		CollisionObject.setCollisionShape(Shape->Shape.get());
 
 		btTransform WorldTransform;
 		StartState->getWorldTransform(WorldTransform);
 		CollisionObject.setWorldTransform(WorldTransform);
 	}
 
-	btBoxShape        BoxCollider;
-	btCollisionObject CollisionObject;
+	FCollisionShapeRegistry::ShapeHandle Shape;
+	btCollisionObject                    CollisionObject;
 };
 
 template <>
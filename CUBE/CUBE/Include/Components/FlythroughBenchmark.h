@@ -0,0 +1,81 @@
+#pragma once
+#include "Atlas\Behavior.h"
+#include "Math\Vector3.h"
+
+#include <vector>
+#include <string>
+#include <functional>
+
+/**
+* Flies FCamera::Main along a Catmull-Rom spline through a list of waypoints and
+* measures the chunk streaming pipeline on the way. The camera moves a fixed
+* distance each frame no matter how long the frame took, so every run covers
+* the same path in the same number of frames. After warming up it records frame
+* times, the time from a chunk being queued to being drawable, chunk loads per
+* second and peak memory, and writes them as JSON once the path is done, with the
+* startup timings of FChunkManager. Runs compared against a baseline fail if a p95
+* or p99, or the time to the first frame, regressed past a tolerance.
+*/
+class CFlythroughBenchmark : public Atlas::FBehavior
+{
+public:
+	/**
+	* Called once the results are written.
+	* @param Passed - If no gated statistic regressed, true when there is no baseline.
+	*/
+	using FinishedCallback = std::function<void(bool Passed)>;
+
+	// Frames flown before recording starts, while the first chunks stream in
+	static const uint32_t WARMUP_FRAMES = 120;
+
+public:
+	CFlythroughBenchmark();
+
+	/**
+	* Sets the path to fly. The camera starts at the first waypoint and stops at the last.
+	* @param Waypoints - At least two points the spline passes through.
+	* @param Speed - Blocks travelled each frame.
+	*/
+	void SetPath(const std::vector<Vector3f>& Waypoints, const float Speed);
+
+	/**
+	* Sets where the results go and what they are compared against.
+	* @param ResultFilename - The JSON file to write.
+	* @param BaselineFilename - Results of an earlier run to gate against, or an empty string.
+	* @param Tolerance - How much larger than the baseline a statistic may be, 0.1 for 10%.
+	*/
+	void SetOutput(const std::wstring& ResultFilename, const std::wstring& BaselineFilename, const float Tolerance);
+
+	void SetOnFinished(FinishedCallback OnFinished) { mOnFinished = OnFinished; }
+
+	void OnStart() override;
+	void Update() override;
+
+private:
+	/**
+	* Gets the position on the spline a distance along the path, by chord length.
+	*/
+	Vector3f SamplePath(const float Distance) const;
+
+	/**
+	* Writes the results and compares them with the baseline.
+	* @return If the run passed the baseline gate.
+	*/
+	bool Finish();
+
+private:
+	std::vector<Vector3f> mWaypoints;
+	std::vector<float>    mSegmentStarts; // Path distance at each waypoint
+	std::vector<float>    mFrameTimes;    // Milliseconds of each recorded frame
+	std::vector<float>    mLoadRates;     // Chunk loads per second sampled each recorded frame
+	std::wstring          mResultFilename;
+	std::wstring          mBaselineFilename;
+	FinishedCallback      mOnFinished;
+	float                 mTolerance;
+	float                 mSpeed;
+	float                 mPathLength;
+	float                 mDistance;
+	uint64_t              mLastFrame;
+	uint32_t              mFrame;
+	bool                  mIsFinished;
+};
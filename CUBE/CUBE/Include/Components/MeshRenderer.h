@@ -3,6 +3,8 @@
 #include "Atlas\Component.h"
 #include "ObjectMesh.h"
 
+class FTransform;
+
 /**
 * A component used to link a triangle mesh with a 
 * gameobject. Each FMeshRenderer is linked with a FObjectMesh
@@ -11,11 +13,28 @@
 class FMeshRenderer : public Atlas::IComponent
 {
 public:
+	FMeshRenderer();
+
 	void LinkToMesh(const char* MeshName);
 
+	/**
+	* Gets the bounding sphere of the mesh in world space. It is
+	* only recomputed when the transform has changed since the last call.
+	* @param Transform - The transform of the game object.
+	* @param CenterOut - To put the center of the sphere.
+	* @param RadiusOut - To put the radius of the sphere.
+	*/
+	void GetWorldBounds(const FTransform& Transform, Vector3f& CenterOut, float& RadiusOut);
+
 private:
 	friend class FRenderSystem;
 	FObjectMesh* Mesh;
+
+	// Cached world bounds, valid while the transform revision is unchanged
+	Vector3f mWorldCenter;
+	float    mWorldRadius;
+	uint32_t mBoundsRevision;
+	bool     mHasBounds;
 };
 
 template <>
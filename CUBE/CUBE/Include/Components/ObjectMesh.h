@@ -35,8 +35,39 @@ class FMeshRenderer;
 */
 struct FObjectMesh
 {
+	FObjectMesh();
+
+	/**
+	* Loads a .obj model into the mesh, and fits the bounds to it.
+	* @param ModelFilepath - The model to load.
+	* @return False if the model couldn't be loaded.
+	*/
+	bool LoadModel(const char* ModelFilepath);
+
+	/**
+	* Loads a mesh cooked by SMeshAsset, along with its bounds.
+	* @param AssetFilename - The cooked mesh to load.
+	* @return False if the asset is missing or must be cooked again.
+	*/
+	bool LoadAsset(const wchar_t* AssetFilename);
+
+	/**
+	* Stores a mesh in the mesh holder and loads it in the background. The cooked
+	* mesh is read on a job worker, or the model parsed if it's missing or out of
+	* date, and uploaded on the main thread. Renderers skip the mesh until then.
+	* @param Name - The name of the mesh in the holder.
+	* @param AssetFilename - The cooked mesh to load.
+	* @param ModelFilepath - The model to load instead of the cooked mesh.
+	* @param Counter - Counts the load until the mesh is uploaded. Optional.
+	*/
+	static void LoadAsync(const char* Name, const wchar_t* AssetFilename, const char* ModelFilepath, FJobCounter* Counter = nullptr);
+
 	TMesh<MeshVertex> Mesh;
 	std::vector<FMeshRenderer*> Renderers;
+
+	// Bounding sphere of the mesh in its local space
+	Vector3f BoundsCenter;
+	float BoundsRadius;
 };
 
 using SMeshHolder = TResourceHolder<FObjectMesh>;
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+#include "Atlas\Behavior.h"
+#include "Physics\PhysicsSystem.h"
+#include "ChunkSystems\StreamingWait.h"
+#include "Math\Vector3.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+
+/**
+* Stresses the physics system with rigidbodies dropped onto streamed terrain. Once
+* streaming around FCamera::Main is idle, grids of bodies are spawned above the
+* terrain under it, from a hundred to ten thousand, and simulated for a fixed
+* number of steps. Each count is run with the terrain colliding through its voxel
+* shape and through a triangle mesh built from the same blocks, each with the
+* narrowphase on one thread and on the physics workers. Every step is split into
+* its broadphase, narrowphase, solver and integration, and the time taken applying
+* queued adds is kept with them. The sleeping ratio and memory per body are taken
+* at the end of each run, and everything is written as JSON.
+*/
+class CPhysicsBenchmark : public Atlas::FBehavior
+{
+public:
+	// Frames after a run's bodies are destroyed before the next run spawns, so their removals are done
+	static const uint32_t SETTLE_FRAMES = 2;
+
+public:
+	CPhysicsBenchmark();
+	~CPhysicsBenchmark();
+
+	/**
+	* Sets the physics system that is measured.
+	*/
+	void SetPhysicsSystem(FPhysicsSystem& PhysicsSystem) { mPhysicsSystem = &PhysicsSystem; }
+
+	/**
+	* Sets the fixed steps simulated for each run.
+	*/
+	void SetStepCount(const uint32_t StepCount) { mStepCount = StepCount; }
+
+	/**
+	* Sets the JSON file the results are written to.
+	*/
+	void SetOutput(const std::wstring& ResultFilename) { mResultFilename = ResultFilename; }
+
+	/**
+	* Sets what is called once the results are written.
+	*/
+	void SetOnFinished(std::function<void()> OnFinished) { mOnFinished = OnFinished; }
+
+	void OnStart() override;
+	void Update() override;
+
+private:
+	/**
+	* How the terrain collides and the narrowphase runs during a run.
+	*/
+	struct Configuration
+	{
+		bool IsMeshTerrain;
+		bool IsParallel;
+	};
+
+private:
+	/**
+	* Builds a triangle mesh of the faces of collidable blocks that touch anything else,
+	* over the spawn area and down to below its lowest surface.
+	*/
+	void BuildTerrainMesh();
+
+	/**
+	* Applies the configuration of the current run and spawns its bodies.
+	*/
+	void BeginRun();
+
+	/**
+	* Appends the results of the current run, then destroys its bodies.
+	*/
+	void EndRun();
+
+	/**
+	* Adds or removes the mesh collider, turning the voxel terrain's collision the other way.
+	*/
+	void SetMeshTerrain(const bool Flag);
+
+	/**
+	* Restores how the terrain collided and the narrowphase ran, then writes the results.
+	*/
+	void Finish();
+
+private:
+	std::vector<Atlas::FGameObject*>        mBodies;        // Of the current run
+	std::vector<Configuration>              mConfigurations;
+	std::unique_ptr<btTriangleMesh>         mTerrainMesh;
+	std::unique_ptr<btBvhTriangleMeshShape> mTerrainMeshShape;
+	std::unique_ptr<btCollisionObject>      mTerrainMeshObject;
+	FPhysicsSystem::UpdateTimings           mTotals;        // Of the current run's updates
+	std::string                             mResults;       // JSON of the runs measured so far
+	std::wstring                            mResultFilename;
+	std::function<void()>                   mOnFinished;
+	FPhysicsSystem*                         mPhysicsSystem;
+	Vector3i                                mSpawnCenter;   // Block the grids are centered over
+	uint32_t                                mStepCount;
+	uint32_t                                mRun;           // Of every configuration and count
+	uint32_t                                mUpdates;       // Physics updates measured in the current run
+	uint32_t                                mFrame;         // Frames into the current phase
+	FStreamingWait                          mStreamingWait;
+	bool                                    mIsStreaming;   // If waiting for streaming to go idle
+	bool                                    mIsSettling;    // If waiting for the last run's removals
+	bool                                    mHasMeshTerrain;
+	bool                                    mWasParallel;   // How the narrowphase ran before the benchmark
+	bool                                    mIsFinished;
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include "Atlas\Behavior.h"
+#include "Math\Vector3.h"
+#include "ChunkSystems\StreamingWait.h"
+
+#include <vector>
+#include <string>
+#include <functional>
+
+class FRenderSystem;
+
+/**
+* Measures the GPU time of each render pass from fixed camera shots. Each shot
+* moves FCamera::Main to a position looking at a target and waits until chunk
+* streaming is idle, so every run renders the same scene. It is then rendered
+* with the renderer as it was set up, and again with each post process and each
+* light system flipped on or off in turn, timing every pass over a number of
+* frames. The passes of every shot and configuration are written as JSON.
+*/
+class CRenderBenchmark : public Atlas::FBehavior
+{
+public:
+	/**
+	* A fixed camera to render from.
+	*/
+	struct Shot
+	{
+		std::string                      Name;
+		Vector3f                         Position;
+		Vector3f                         Target;       // What the camera looks at
+		uint32_t                         ViewDistance; // In chunks
+		std::vector<Atlas::FGameObject*> Lights;       // Only active during this shot
+	};
+
+	// Frames rendered after a configuration changes before it is measured, so the profiler's queued frames drain
+	static const uint32_t WARMUP_FRAMES = 16;
+
+public:
+	CRenderBenchmark();
+
+	/**
+	* Sets the renderer whose passes are measured and toggled.
+	*/
+	void SetRenderSystem(FRenderSystem& RenderSystem) { mRenderSystem = &RenderSystem; }
+
+	/**
+	* Adds a shot, shots are rendered in the order they are added. Its lights are deactivated until it is rendered.
+	*/
+	void AddShot(const Shot& NewShot);
+
+	/**
+	* Sets the frames measured for each configuration of each shot.
+	*/
+	void SetFrameCount(const uint32_t FrameCount) { mFrameCount = FrameCount; }
+
+	/**
+	* Sets the JSON file the results are written to.
+	*/
+	void SetOutput(const std::wstring& ResultFilename) { mResultFilename = ResultFilename; }
+
+	/**
+	* Sets the device reported with the results, such as the GL renderer string.
+	*/
+	void SetDevice(const std::string& Device) { mDevice = Device; }
+
+	/**
+	* Sets what is called once the results are written.
+	*/
+	void SetOnFinished(std::function<void()> OnFinished) { mOnFinished = OnFinished; }
+
+	void OnStart() override;
+	void Update() override;
+
+private:
+	/**
+	* The GPU time of a pass, summed over the measured frames.
+	*/
+	struct PassTime
+	{
+		const char* Name;
+		uint32_t    Depth;
+		uint64_t    TotalNs;
+		uint32_t    Frames; // Frames the pass ran in
+	};
+
+	/**
+	* What is flipped from the renderer's setup. None is the setup as it is.
+	*/
+	struct Toggle
+	{
+		enum Type : uint8_t
+		{
+			None,
+			PostProcess,
+			LightSystem
+		};
+	};
+
+	struct Configuration
+	{
+		Toggle::Type Type;
+		uint32_t     Index; // Of the post process or light system
+	};
+
+private:
+	/**
+	* Moves the camera to a shot and sets its view distance and lights.
+	*/
+	void BeginShot();
+
+	/**
+	* Flips what a configuration toggles.
+	*/
+	void ApplyConfiguration(const Configuration& Config);
+
+	/**
+	* Adds the newest resolved frame of the GPU profiler to the pass times, if it wasn't yet.
+	*/
+	void MeasureFrame();
+
+	/**
+	* Appends the times of the measured configuration to the results, then clears them.
+	*/
+	void AppendConfiguration(const Configuration& Config);
+
+	/**
+	* Writes the results of every shot.
+	*/
+	void Finish();
+
+private:
+	std::vector<Shot>          mShots;
+	std::vector<Configuration> mConfigurations;
+	std::vector<PassTime>      mPassTimes;    // Of the configuration being measured
+	std::string                mResults;      // JSON of the shots measured so far
+	std::string                mDevice;
+	std::wstring               mResultFilename;
+	std::function<void()>      mOnFinished;
+	FRenderSystem*             mRenderSystem;
+	uint64_t                   mFrameTotalNs; // GPU time of the measured frames
+	uint64_t                   mLastMeasured; // Profiler frame last added
+	uint32_t                   mMeasuredFrames;
+	uint32_t                   mFrameCount;
+	uint32_t                   mShot;
+	uint32_t                   mConfiguration;
+	uint32_t                   mFrame;        // Frames into the current phase
+	FStreamingWait             mStreamingWait;
+	bool                       mIsStreaming;  // If the shot is waiting for streaming to go idle
+	bool                       mIsFinished;
+};
@@ -3,6 +3,7 @@
 #include "BulletPhysics\btBulletCollisionCommon.h"
 #include "BulletPhysics\btBulletDynamicsCommon.h"
 #include "Math\Vector3.h"
+#include "Physics\CollisionShapeRegistry.h"
 #include "Atlas\ComponentTypes.h"
 #include "Common.h"
 
@@ -13,18 +14,46 @@
 WIN_ALIGN(16)
 struct FRigidBody : public Atlas::IComponent
 {
+	// Bodies slower than these sleep once they have been for Bullet's deactivation time.
+	// Capsules keep rolling slowly over flat block tops, so these are above Bullet's defaults.
+	static const btScalar LINEAR_SLEEP_THRESHOLD;
+	static const btScalar ANGULAR_SLEEP_THRESHOLD;
+
 	FRigidBody(btMotionState* MotionState = nullptr)
-		: CapsuleCollider(.5f, 2)
-		, Body(1.0f, MotionState, &CapsuleCollider)
+		: Shape(FCollisionShapeRegistry::GetCapsule(.5f, 2))
+		, Body(1.0f, MotionState, Shape->Shape.get(), Shape->UnitInertia)
+	{
+		Body.setSleepingThresholds(LINEAR_SLEEP_THRESHOLD, ANGULAR_SLEEP_THRESHOLD);
+	}
+
+	/**
+	* Sets the shared shape of the body, keeping its mass. Shapes must be set before the
+	* body is first simulated, such as in the frame the component is added.
+	*/
+	void SetShape(FCollisionShapeRegistry::ShapeHandle NewShape)
+	{
+		const btScalar Mass = btScalar(1) / Body.getInvMass();
+
+		Shape = std::move(NewShape);
+		Body.setCollisionShape(Shape->Shape.get());
+		Body.setMassProps(Mass, Shape->UnitInertia * Mass);
+		Body.updateInertiaTensor();
+	}
+
+	/**
+	* Sets up continuous collision, so fast bodies don't pass through thin walls between
+	* steps. Bodies that move further than the threshold in a step are swept as a sphere.
+	* @param SweptSphereRadius - Radius of the swept sphere, at most the body's own size.
+	* @param MotionThreshold - Distance moved in a step before the body is swept, 0 to turn sweeps off.
+	*/
+	void SetContinuousCollision(const btScalar SweptSphereRadius, const btScalar MotionThreshold)
 	{
-		btVector3 Inertia;
-		CapsuleCollider.calculateLocalInertia(1.0f, Inertia);
-		Inertia = btVector3{ 1, 1, 1 } / Inertia;
-		Body.setInvInertiaDiagLocal(Inertia);
+		Body.setCcdSweptSphereRadius(SweptSphereRadius);
+		Body.setCcdMotionThreshold(MotionThreshold);
 	}
 
-	btCapsuleShape  CapsuleCollider;
-	btRigidBody   Body;
+	FCollisionShapeRegistry::ShapeHandle Shape;
+	btRigidBody                          Body;
 };
 
 template <>
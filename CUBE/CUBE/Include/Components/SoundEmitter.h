@@ -3,16 +3,24 @@
 #include <string>
 
 #include "FMOD\fmod.hpp"
+#include "Audio\SoundBank.h"
+#include "Math\Vector3.h"
 #include "Atlas\Component.h"
 #include "Atlas\ComponentTypes.h"
 
 struct FSoundEmitter : public Atlas::IComponent
 {
-	std::string    Filename;       // Filepath for the audio file
-	FMOD::Sound*   Sound{ nullptr };
-	FMOD::Channel* Channel{ nullptr };
-	bool           ActivateSound;  // If set to true, the sound with be activated in the next update
-	bool           Looping{false};
+	std::string         Filename;       // Filepath for the audio file
+	FSoundBank::Handle  Sound{ FSoundBank::INVALID_HANDLE }; // Shared with every emitter playing the same file
+	FMOD::Channel*      Channel{ nullptr };
+	bool                ActivateSound;  // If set to true, the sound with be activated once it has loaded
+	bool                Looping{false};
+	float               MinDistance{ 1.0f };  // Distance the sound starts to attenuate at
+	float               MaxDistance{ 64.0f }; // Emitters farther from the listener aren't played or updated
+	int32_t             Priority{ 128 };      // Channel priority from 0, the most important, to 256. Lower priorities go virtual first.
+	Vector3f            LastPosition;         // Position last given to the channel
+	float               Occlusion{ 0.0f };       // Terrain occlusion given to the channel, from 0 in the open to 1
+	float               TargetOcclusion{ 0.0f }; // Occlusion last measured, eased towards
 };
 
 template <>
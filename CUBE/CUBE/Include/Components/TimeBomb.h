@@ -9,10 +9,19 @@ public:
 
 	void Update() override;
 
+private:
+	// Blocks read to color the debris of an explosion
+	static const uint32_t DEBRIS_SAMPLES = 7;
+
+	/**
+	* Throws GPU particles out of the blocks about to be cleared by the explosion.
+	*/
+	void EmitDebris(const Vector3i& Center);
+
 private:
 	float mLifetime;
 	float mTimer;
 	uint32_t mRadius;
+	uint32_t mDebrisCount; // Particles thrown by the explosion, split between the sampled blocks
 	bool mHasExploded;
 };
-
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+template <typename ElementType, uint32_t Capacity>
+/**
+* Fixed size lock-free queue that any number of threads may push to, and a
+* single thread pops from. Each slot holds a sequence number that tells
+* producers when it is free and the consumer when it is written, so neither
+* side ever waits on the other. Pushing to a full queue fails instead of
+* blocking.
+* \n
+* @param ElementType The type of the elements, which should be cheap to copy.
+* @param Capacity The number of slots, which must be a power of two.
+*/
+class FBoundedMPSCQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+public:
+	FBoundedMPSCQueue()
+		: mEnqueuePosition(0)
+		, mDequeuePosition(0)
+	{
+		for (uint32_t i = 0; i < Capacity; i++)
+			mSlots[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	FBoundedMPSCQueue(const FBoundedMPSCQueue&) = delete;
+	FBoundedMPSCQueue& operator=(const FBoundedMPSCQueue&) = delete;
+
+	/**
+	* Pushes an element to the back of the queue. Safe to call from any thread.
+	* @param Element - The element to copy into the queue.
+	* @return False if the queue is full.
+	*/
+	bool Push(const ElementType& Element)
+	{
+		Slot* Cell;
+		uint32_t Position = mEnqueuePosition.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			Cell = &mSlots[Position & MASK];
+			const int32_t Difference = (int32_t)(Cell->Sequence.load(std::memory_order_acquire) - Position);
+
+			if (Difference == 0)
+			{
+				// The slot is free, claim it before another producer does
+				if (mEnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (Difference < 0)
+			{
+				// The consumer hasn't read this slot since the last lap
+				return false;
+			}
+			else
+			{
+				Position = mEnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		Cell->Element = Element;
+		Cell->Sequence.store(Position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	* Pops the element at the front of the queue. Only one thread may pop.
+	* @param ElementOut - To put the element.
+	* @return False if the queue is empty, or the front element is still being written.
+	*/
+	bool Pop(ElementType& ElementOut)
+	{
+		Slot& Cell = mSlots[mDequeuePosition & MASK];
+		if ((int32_t)(Cell.Sequence.load(std::memory_order_acquire) - (mDequeuePosition + 1)) < 0)
+			return false;
+
+		ElementOut = Cell.Element;
+
+		// Hand the slot back to producers for the next lap
+		Cell.Sequence.store(mDequeuePosition + Capacity, std::memory_order_release);
+		mDequeuePosition++;
+		return true;
+	}
+
+private:
+	static const uint32_t MASK = Capacity - 1;
+
+	struct Slot
+	{
+		std::atomic<uint32_t> Sequence;
+		ElementType           Element;
+	};
+
+	Slot                  mSlots[Capacity];
+
+	// Producers and the consumer write these, so they don't share a cache line
+	uint8_t               mPadding0[64];
+	std::atomic<uint32_t> mEnqueuePosition;
+	uint8_t               mPadding1[64];
+	uint32_t              mDequeuePosition;
+};
@@ -2,21 +2,21 @@
 
 #include <cstdint>
 #include <vector>
-#include <queue>
 #include <functional>
 
 #include "Misc\Assertions.h"
+#include "Math\FMath.h"
 
 /**
 * Allocation Strategy
 * This allocator keeps elements as dense as possible up front
 * without relocating elements when an object is removed from the
-* container. In order to provide faster iterating through the list of
-* all objects that are currently constructed, an active index list is maintained
-* as elements are allocated. The iterator for this allocator grants read access
-* to this active list. As elements are added, the first avaliable slot in the list
-* is used. When more memory is needed for new objects, a new page is created that
-* is the size of the specified pages in Init.
+* container. Each page keeps a bitmap of its constructed elements, which
+* the iterator walks a word of bits at a time, skipping dead elements, and
+* a free list of its dead elements, so allocating and freeing take constant
+* time. New elements go in the first page with a free slot, the most
+* recently freed one. When more memory is needed for new objects, a new page
+* is created that is the size of the specified pages in Init.
 */
 class FTypelessPageArray
 {
@@ -149,6 +149,16 @@ public:
  	*/
 	uint32_t Size() const { return mActiveCount; }
 
+	/**
+	* Get the number of pages allocated, each holding the page size in elements.
+	*/
+	uint32_t PageCount() const { return mPages.size(); }
+
+	/**
+	* Get the size of the elements in bytes.
+	*/
+	uint32_t ElementSize() const { return mElementSize; }
+
 private:
 
 	void AddPage();
@@ -157,12 +167,16 @@ private:
 
 	void AssignNextFreePage();
 
+	bool IsActive(const uint32_t PageID, const uint32_t ElementID) const;
+
 private:
+	static const uint32_t BITS_PER_WORD = 32;
+
 	struct Page
 	{
 		uint8_t* Data;
-		std::vector<uint32_t> ActiveList; // Ordered list of active elements
-		std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> DeadList; // Min-heap of dead elements
+		std::vector<uint32_t> ActiveBits; // Bit i of word i / 32 is set while element i is constructed
+		std::vector<uint32_t> DeadList;   // Stack of dead elements
 	};
 
 	uint32_t          mElementSize;
@@ -180,25 +194,39 @@ public:
 	{
 	public:
 		Iterator()
-			: mCurrentPage(0)
+			: mElementSize(0)
+			, mCurrentPage(0)
 			, mIndex(0)
+			, mBits(0)
 			, mContainer(nullptr)
 		{
 		}
 
+		/**
+		* Creates an iterator to the first active element at or after an element of a page.
+		*/
 		Iterator(FTypelessPageArray& Array, const uint32_t CurrentPage, const uint32_t Index)
-			: mCurrentPage(CurrentPage)
+			: mElementSize(Array.mElementSize)
+			, mCurrentPage(CurrentPage)
 			, mIndex(Index)
+			, mBits(0)
 			, mContainer(&Array)
 		{
-			mElementSize = mContainer->mElementSize;
+			if (mCurrentPage < mContainer->mPages.size())
+			{
+				// Bits below the element are already passed
+				mBits = mContainer->mPages[mCurrentPage].ActiveBits[mIndex / BITS_PER_WORD] & (~0u << (mIndex % BITS_PER_WORD));
+				mIndex -= mIndex % BITS_PER_WORD;
+				SeekActive();
+			}
 		}
 
 		Iterator(const Iterator& Other)
-			: mCurrentPage(Other.mCurrentPage)
+			: mElementSize(Other.mElementSize)
+			, mCurrentPage(Other.mCurrentPage)
 			, mIndex(Other.mIndex)
+			, mBits(Other.mBits)
 			, mContainer(Other.mContainer)
-			, mElementSize(Other.mElementSize)
 		{
 		}
 
@@ -206,23 +234,20 @@ public:
 
 		Iterator& operator=(const Iterator& Other)
 		{
+			mElementSize = Other.mElementSize;
 			mCurrentPage = Other.mCurrentPage;
 			mIndex = Other.mIndex;
+			mBits = Other.mBits;
 			mContainer = Other.mContainer;
-			mElementSize = Other.mElementSize;
+			return *this;
 		}
 
 		Iterator& operator++()
 		{
-			if (mIndex >= mContainer->mPages[mCurrentPage].ActiveList.size() - 1)
-			{
-				mIndex = 0;
-				mCurrentPage++;
-			}
-			else
-			{
-				mIndex++;
-			}
+			// Clear the current element's bit, then find the next set one
+			mBits &= mBits - 1;
+			mIndex -= mIndex % BITS_PER_WORD;
+			SeekActive();
 
 			return *this;
 		}
@@ -238,14 +263,12 @@ public:
 
 		ElementType& operator*()
 		{
-			const uint32_t PageIndex = mContainer->mPages[mCurrentPage].ActiveList[mIndex];
-			return *reinterpret_cast<ElementType*>(mContainer->mPages[mCurrentPage].Data + (mElementSize * PageIndex));
+			return *reinterpret_cast<ElementType*>(mContainer->mPages[mCurrentPage].Data + (mElementSize * mIndex));
 		}
 
 		ElementType* operator->()
 		{
-			const uint32_t PageIndex = mContainer->mPages[mCurrentPage].ActiveList[mIndex];
-			return reinterpret_cast<ElementType*>(mContainer->mPages[mCurrentPage].Data + (mElementSize * PageIndex));
+			return reinterpret_cast<ElementType*>(mContainer->mPages[mCurrentPage].Data + (mElementSize * mIndex));
 		}
 
 		bool operator==(const Iterator& Other) const
@@ -259,7 +282,7 @@ public:
 		}
 
 		/**
-		* Get the current index of the iterator into the container.
+		* Get the current index of the iterator into its page.
 		*/
 		uint32_t GetIndex() const
 		{
@@ -271,10 +294,40 @@ public:
 			return mCurrentPage;
 		}
 
+	private:
+		/**
+		* Moves to the lowest bit left in the current word, or the first set bit of
+		* a later word, or the end. mIndex must be the first element of the current word.
+		*/
+		void SeekActive()
+		{
+			const uint32_t PageCount = mContainer->mPages.size();
+			const uint32_t PageSize = mContainer->mPageSize;
+
+			while (mBits == 0)
+			{
+				mIndex += BITS_PER_WORD;
+				if (mIndex >= PageSize)
+				{
+					mIndex = 0;
+					if (++mCurrentPage >= PageCount)
+					{
+						mCurrentPage = PageCount;
+						return;
+					}
+				}
+
+				mBits = mContainer->mPages[mCurrentPage].ActiveBits[mIndex / BITS_PER_WORD];
+			}
+
+			mIndex += (uint32_t)FMath::CountTrailingZeros(mBits);
+		}
+
 	private:
 		uint32_t mElementSize;
 		uint32_t mCurrentPage;
-		uint32_t mIndex;
+		uint32_t mIndex;    // Element within the page
+		uint32_t mBits;     // Active bits left in the word holding mIndex, including it
 		FTypelessPageArray* mContainer;
 	};
 };
@@ -290,7 +343,7 @@ template <typename T>
 inline uint32_t FTypelessPageArray::AllocateAndConstruct()
 {
 	uint32_t Index = Allocate();
-	new (*this[Index]) T;
+	new ((*this)[Index]) T;
 	return Index;
 }
 
@@ -298,7 +351,7 @@ template <typename T, typename Param>
 inline uint32_t FTypelessPageArray::AllocateAndConstruct(const Param& Arg1)
 {
 	uint32_t Index = Allocate();
-	new (*this[Index]) T(Arg1);
+	new ((*this)[Index]) T(Arg1);
 	return Index;
 }
 
@@ -306,7 +359,7 @@ template <typename T, typename Param>
 inline uint32_t FTypelessPageArray::AllocateAndConstruct(Param& Arg1)
 {
 	uint32_t Index = Allocate();
-	new (*this[Index]) T(Arg1);
+	new ((*this)[Index]) T(Arg1);
 	return Index;
 }
 
@@ -314,9 +367,7 @@ template <typename T>
 inline T& FTypelessPageArray::At(const uint32_t Index)
 {
 #ifndef NDEBUG
-	const uint32_t PageID = Index / mPageSize;
-	const uint32_t ElementID = Index % mPageSize;
-	ASSERT(std::find(mPages[PageID].ActiveList.begin(), mPages[PageID].ActiveList.end(), ElementID) != mPages[PageID].ActiveList.end() && "Trying to access dead element.");
+	ASSERT(IsActive(Index / mPageSize, Index % mPageSize) && "Trying to access dead element.");
 #endif
 	return *(reinterpret_cast<T*>((*this)[Index]));
 }
@@ -325,9 +376,7 @@ template <typename T>
 inline const T& FTypelessPageArray::At(const uint32_t Index) const
 {
 #ifndef NDEBUG
-	const uint32_t PageID = Index / mPageSize;
-	const uint32_t ElementID = Index % mPageSize;
-	ASSERT(std::find(mPages[PageID].ActiveList.begin(), mPages[PageID].ActiveList.end(), ElementID) != mPages[PageID].ActiveList.end() && "Trying to access dead element.");
+	ASSERT(IsActive(Index / mPageSize, Index % mPageSize) && "Trying to access dead element.");
 #endif
 	return *(reinterpret_cast<T*>((*this)[Index]));
 }
@@ -344,6 +393,11 @@ inline FTypelessPageArray::Iterator<T> FTypelessPageArray::End()
 	return FTypelessPageArray::Iterator<T>(*this, mPages.size(), 0);
 }
 
+inline bool FTypelessPageArray::IsActive(const uint32_t PageID, const uint32_t ElementID) const
+{
+	return (mPages[PageID].ActiveBits[ElementID / BITS_PER_WORD] & (1u << (ElementID % BITS_PER_WORD))) != 0;
+}
+
 inline void* FTypelessPageArray::operator[](const size_t Index) 
 { 
 	const uint32_t PageID = Index / mPageSize;
@@ -4,6 +4,7 @@
 #include "SFML\Window\Window.hpp"
 #include "Math\Vector2.h"
 #include <cstdint>
+#include <functional>
 
 class Atlas::FGameObjectManager;
 class FRenderSystem;
@@ -19,14 +20,41 @@ class FCubeRoot
 public:
 	FCubeRoot(const wchar_t* AppName, const Vector2ui Resolution, const uint32_t WindowStyle = sf::Style::Default);
 
+	/**
+	* Creates a headless engine, for dedicated servers and batch simulations. There is
+	* no window or GL context, and no render or audio system. Chunks stream around
+	* FCamera::Main and are only simulated, see FChunkManager. The game loop runs
+	* until Stop is called.
+	*/
+	struct Headless {};
+	explicit FCubeRoot(Headless);
+
 	~FCubeRoot();
 
 	// Disable copying of this object.
 	FCubeRoot(const FCubeRoot& Other) = delete;
 	FCubeRoot& operator=(const FCubeRoot& Other) = delete;
 
+	/**
+	* Streams in the area around FCamera::Main once the world's behaviors have started,
+	* see FChunkManager::WarmUp, then runs the game loop.
+	*/
 	void Start();
 
+	/**
+	* Sets what is told the warmup's progress in Start, such as a loading screen.
+	* @param OnProgress - Called with the spawn chunks ready and the spawn chunk count.
+	*/
+	void SetLoadingProgress(std::function<void(uint32_t ChunksReady, uint32_t ChunkCount)> OnProgress) { mOnLoadingProgress = OnProgress; }
+
+	/**
+	* Ends the game loop after the current frame.
+	*/
+	void Stop();
+
+	bool IsHeadless() const { return mIsHeadless; }
+
+	// Only available when not headless
 	FRenderSystem& GetRenderSystem(){ return *mRenderSystem; }
 	FPhysicsSystem& GetPhysicsSystem() { return *mPhysicsSystem; }
 	Atlas::FGameObjectManager& GetGameObjectManager() { return *mGameObjectManager; }
@@ -35,6 +63,12 @@ public:
 private:
 	void AllocateSingletons();
 	void LoadEngineSystems();
+
+	/**
+	* Registers the console variables of the engine's systems, applying the config's values.
+	*/
+	void RegisterConsoleVariables();
+
 	void GameLoop();
 	void ServiceEvents();
 
@@ -58,5 +92,8 @@ private:
 	FPhysicsSystem*             mPhysicsSystem;
 	FAudioSystem*               mAudioSystem;
 	Atlas::FGameObjectManager*  mGameObjectManager;
+	const bool                  mIsHeadless;
+	bool                        mIsStopping;
+	std::function<void(uint32_t, uint32_t)> mOnLoadingProgress;
 };
 
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include "Clock.h"
+
+#define CPU_PROFILE_CONCAT_INNER(A, B) A##B
+#define CPU_PROFILE_CONCAT(A, B) CPU_PROFILE_CONCAT_INNER(A, B)
+
+/**
+* Measures the rest of the enclosing scope as a marker, while a capture is running.
+* @param Name - The name of the marker, which must outlive the profiler.
+*/
+#define CPU_PROFILE(Name) FDebug::CPUProfiler::Scope CPU_PROFILE_CONCAT(CPUProfileScope, __LINE__){ Name }
+
+namespace FDebug
+{
+	/**
+	* Records scoped markers on any thread with FClock::ReadSystemTimer. Each thread
+	* writes to a ring buffer of its own, keeping the newest EVENTS_PER_THREAD markers
+	* of a capture. Markers only read the timer while capturing, so they can stay in
+	* hot paths. Captures are exported as a trace viewable in chrome://tracing.
+	*/
+	class CPUProfiler
+	{
+	public:
+		// Markers kept for each thread, the oldest are overwritten first
+		static const uint32_t EVENTS_PER_THREAD = 32 * 1024;
+
+		/**
+		* Scope based measuring of a marker. Begins the marker on construct and
+		* records it on destruction.
+		*/
+		class Scope
+		{
+		public:
+			Scope(const char* Name)
+				: mName(Name)
+				, mBegin(IsCapturing() ? FClock::ReadSystemTimer() : 0)
+			{
+			}
+
+			~Scope()
+			{
+				if (mBegin != 0 && IsCapturing())
+					Record(mName, mBegin, FClock::ReadSystemTimer());
+			}
+
+			Scope(const Scope& Other) = delete;
+			Scope& operator=(const Scope& Other) = delete;
+
+		private:
+			const char* mName;
+			uint64_t    mBegin;
+		};
+
+	public:
+		/**
+		* Starts a capture, dropping the markers of the last one.
+		* @param FrameCount - Frames to capture before stopping, or 0 to capture until StopCapture.
+		*/
+		static void StartCapture(const uint32_t FrameCount);
+
+		/**
+		* Stops the running capture.
+		*/
+		static void StopCapture();
+
+		/**
+		* Counts a frame of the running capture, stopping it after its last frame.
+		*/
+		static void EndFrame();
+
+		/**
+		* If markers are being recorded.
+		*/
+		static bool IsCapturing() { return CaptureRunning.load(std::memory_order_relaxed); }
+
+		/**
+		* Names the calling thread in exported traces.
+		* @param Name - The name of the thread, which must outlive the profiler.
+		*/
+		static void SetThreadName(const char* Name);
+
+		/**
+		* Writes the markers of the last capture to a Chrome trace, one track per thread.
+		* @param Filename - The file to write, relative to the working directory.
+		* @param Since - FClock::ReadSystemTimer before which markers are left out, 0 to write the whole capture.
+		* @return True if the file was written.
+		*/
+		static bool Export(const wchar_t* Filename, const uint64_t Since = 0);
+
+	private:
+		/**
+		* Adds a marker to the ring buffer of the calling thread.
+		*/
+		static void Record(const char* Name, const uint64_t Begin, const uint64_t End);
+
+	private:
+		CPUProfiler() = delete;	// Not meant for instantiation
+
+		static std::atomic<bool> CaptureRunning;
+	};
+}
@@ -13,7 +13,7 @@
 namespace FDebug
 {
 	/**
-	* Prints a formatted output to a debug window. If arguments
+	* Prints a formatted output to a debug window through FDebug::Log. If arguments
 	* are not in the form of va_list, use FDebug::PrintF for a more
 	* convenient debug print function.
 	* @param Format - PrintF like format for the output string.
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace FDebug
+{
+	/**
+	* Named, typed settings that can be tuned without rebuilding. Values
+	* are read from a config file at startup and may be set from the game
+	* console. Each variable's handler applies a new value where it is
+	* used, variables without one are only read when their owner starts.
+	* Only used from the main thread.
+	*
+	* Config files hold one "Name Value" pair per line, lines starting
+	* with # are ignored. Values of variables registered later are kept
+	* until they are.
+	*/
+	class ConsoleVariables
+	{
+	public:
+		using BoolHandler = std::function<void(const bool)>;
+		using IntHandler = std::function<void(const int32_t)>;
+		using FloatHandler = std::function<void(const float)>;
+
+	public:
+		/**
+		* Reads values from a config file, applying those of registered variables.
+		* @param Filename - The file to read, relative to the working directory.
+		* @return False if the file could not be read.
+		*/
+		static bool LoadConfig(const wchar_t* Filename);
+
+		/**
+		* Registers a variable, its value is the config's if it was read,
+		* otherwise the default. The handler is called with the value right away.
+		* @param Name - The name the variable is set by, which must outlive the registry.
+		* @param Default - The variable's value unless the config or console sets one.
+		* @param Description - Shown when listing the variables, which must outlive the registry.
+		* @param OnChange - Applies new values, or null if the value is only read with Get.
+		*/
+		static void RegisterBool(const char* Name, const bool Default, const char* Description, BoolHandler OnChange = BoolHandler{});
+		static void RegisterInt(const char* Name, const int32_t Default, const char* Description, IntHandler OnChange = IntHandler{});
+		static void RegisterFloat(const char* Name, const float Default, const char* Description, FloatHandler OnChange = FloatHandler{});
+
+		/**
+		* The value of a registered variable.
+		*/
+		static bool GetBool(const char* Name);
+		static int32_t GetInt(const char* Name);
+		static float GetFloat(const char* Name);
+
+		/**
+		* Parses and sets the value of a variable, calling its handler.
+		* @return False if no variable has the name or the value doesn't parse.
+		*/
+		static bool Set(const std::string& Name, const std::string& Value);
+
+		/**
+		* Runs a console command of a variable's name, followed by a value to
+		* set it to or nothing to print it.
+		* @return False if the command doesn't start with a variable's name.
+		*/
+		static bool Execute(const std::string& Command);
+
+		/**
+		* Prints every variable with its value and description.
+		*/
+		static void List();
+
+	private:
+		ConsoleVariables() = delete;	// Not meant for instantiation
+	};
+}
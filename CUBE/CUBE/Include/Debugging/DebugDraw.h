@@ -1,7 +1,7 @@
 #pragma once
 #include "Utils/Singleton.h"
-#include "Rendering\Mesh.h"
 #include "Rendering\ShaderProgram.h"
+#include "Rendering\StreamingBuffer.h"
 #include "Math\Vector3.h"
 #include "BulletPhysics\LinearMath\btIDebugDraw.h"
 
@@ -22,7 +22,11 @@ namespace FDebug
 
 	/**
 	* Debug drawing facility. Used to draw useful debug
-	* shapes in a scene.
+	* shapes in a scene. Every shape is drawn as lines, streamed
+	* into one buffer each frame and drawn in one call. Shapes
+	* drawn for longer than a frame are kept on the CPU. Lines of
+	* a closed frame are kept apart, so shapes can be added for the
+	* next frame while the render thread draws the last.
 	*/
 	class Draw : public TSingleton<Draw>, public btIDebugDraw
 	{
@@ -60,26 +64,40 @@ namespace FDebug
 		void DrawBox(const Vector3f& Center, const Vector3f& Dimensions, const Vector3f& Color, const float Lifetime = 0.0f);
 
 		/**
-		* Renders all queued debug draw commands.
+		* Ends the frame, so the shapes added so far are drawn by the next Render.
+		* Shapes added after are drawn the frame after.
+		*/
+		void CloseFrame();
+
+		/**
+		* Renders the shapes of the last closed frame.
 		*/
 		void Render();
 
 	private:
-		struct ObjectData
+		// A shape drawn for longer than a frame, its lines are kept in mTimedVertices
+		struct TimedShape
 		{
-			ObjectData() = default;
-			ObjectData(ObjectData&& Other)
-				: Lifetime(Other.Lifetime)
-				, Mesh(std::move(Other.Mesh))
-			{
-			}
 			float Lifetime;
-			TMesh<DrawVertex> Mesh;
+			uint32_t VertexCount;
 		};
 
 	private:
-		std::vector<ObjectData> mObjects;
-		TMesh<DrawVertex> mLines;
+		/**
+		* Adds the twelve edges of a box, or any shape with a box's corners.
+		* @param Corners - Corners of the front face, then the back face, each in the same winding.
+		* @param Color - The color to draw the edges.
+		* @param Lifetime - The length, in seconds, to draw the edges.
+		*/
+		void AddBoxEdges(const Vector3f* Corners, const Vector3f& Color, const float Lifetime);
+
+	private:
+		std::vector<DrawVertex> mVertices;      // Lines of this frame, two vertices each
+		std::vector<DrawVertex> mFrameVertices; // Lines of the closed frame, drawn by Render
+		std::vector<DrawVertex> mTimedVertices; // Lines of each timed shape, in order
+		std::vector<TimedShape> mTimedShapes;
+		FStreamingBuffer mVertexBuffer;
+		GLuint mVertexArray;
 		FShaderProgram mShader;
 		int mDebugMode;
 	};
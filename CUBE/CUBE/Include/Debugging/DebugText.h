@@ -10,12 +10,19 @@
 #include "Rendering\Uniform.h"
 #include "Memory\MemoryUtil.h"
 
+#include <string>
+#include <vector>
+
 // Forward declaration
 struct text_buffer_t;
 struct markup_t;
 
 /**
 * Singleton class for drawing debug text to an OpenGL window.
+* Text added each frame at the same position with the same markup is kept
+* laid out across frames, and only laid out again when its string changes.
+* All text is drawn from one vertex buffer, uploaded only when the text drawn
+* differs from the last frame.
 */
 namespace FDebug
 {
@@ -35,10 +42,15 @@ namespace FDebug
 		* Add debug text to be displayed this frame. All data added will be erased
 		* after each frame.
 		* @param String - Text to be displayed.
-		* @param Color - Color of the text.
 		* @param Position - Size position of the text. Bottom-Left is (0, 0)
+		* @param Markup - Font and color of the text.
+		*/
+		void AddText(const std::wstring& String, Vector2i Position, const markup_t& Markup);
+
+		/**
+		* Add debug text to be displayed this frame, from a null terminated string.
 		*/
-		void AddText(std::wstring& String, Vector2i Position, markup_t& Markup);
+		void AddText(const wchar_t* String, Vector2i Position, const markup_t& Markup);
 
 		/**
 		* Render all text data held by this object. Local data will be cleared
@@ -48,12 +60,41 @@ namespace FDebug
 
 		void OnResolutionChange(Vector2ui NewResolution);
 
+	private:
+		/**
+		* Text laid out once, and kept while it is added each frame.
+		*/
+		struct TextRun
+		{
+			std::wstring          String;
+			Vector2i              Position;
+			uint64_t              MarkupHash; // Of the markup's bytes
+			std::vector<uint8_t>  Vertices;   // Glyph vertices in the text buffer's format
+			std::vector<GLuint>   Indices;    // From the first vertex of the run
+			bool                  IsUsed;     // Added this frame
+		};
+
+		/**
+		* Lays out a run's string into its vertices.
+		*/
+		void LayOut(TextRun& Run, const markup_t& Markup);
+
+		/**
+		* Whether the runs added this frame are those drawn last frame, in the same order.
+		*/
+		bool IsFrameUnchanged() const;
+
 	private:
 		FMatrix4 mTextProjection;
 		text_buffer_t* mTextBuffer;
 		FUniform mProjectionUniform;
 		FUniform mViewUniform;
 		FUniform mModelUniform;
+		std::vector<TextRun>  mRuns;       // Runs drawn last frame in order, then those new this frame
+		std::vector<TextRun>  mKeptRuns;   // Scratch for the runs kept after rendering
+		std::vector<uint32_t> mFrameRuns;  // Index in mRuns of each run added this frame, in order
+		uint32_t              mLastFrameRunCount;
+		bool                  mIsBufferStale; // A run was laid out since the buffer was filled
 	};
 
 
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Atlas
+{
+	class FGameObjectManager;
+}
+
+/**
+* Stresses the gameobject manager with 1k to 100k gameobjects of mixed components,
+* to measure what the layout of components and systems costs as objects scale.
+* For each count it times spawning, the systems checking their interest in the new
+* objects, frames of behavior dispatch and transform updates, iterating every
+* component type as a system would, and destroying every object again. The pages
+* each component type holds are reported after the spawn, then after the despawn.
+* Runs on a manager that isn't updated by a game loop, before the engine starts.
+*/
+class SECSBenchmark
+{
+public:
+	SECSBenchmark() = delete;	// Not meant for instantiation
+
+	// Frames updated at each count, after the frame that checks interest
+	static const uint32_t FRAMES_PER_COUNT = 30;
+
+	/**
+	* Runs the benchmark at every count.
+	* @param Manager - The manager to spawn in, with every component type registered and no gameobjects.
+	* @param ResultFilename - A JSON file to write the results to, or nullptr.
+	*/
+	static void Run(Atlas::FGameObjectManager& Manager, const wchar_t* ResultFilename);
+};
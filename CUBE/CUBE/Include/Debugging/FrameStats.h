@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "Clock.h"
+
+#define FRAME_STAGE_CONCAT_INNER(A, B) A##B
+#define FRAME_STAGE_CONCAT(A, B) FRAME_STAGE_CONCAT_INNER(A, B)
+
+/**
+* Adds the rest of the enclosing scope to the time of a stage of this frame.
+* @param Stage - The EFrameStage the scope is part of.
+*/
+#define FRAME_STAGE(Stage) FDebug::FrameStats::Scope FRAME_STAGE_CONCAT(FrameStageScope, __LINE__){ EFrameStage::Stage }
+
+/**
+* Stages of the main thread's frame that are timed by FDebug::FrameStats.
+*/
+struct EFrameStage
+{
+	enum Type : uint8_t
+	{
+		WaitForStep,    // Waiting on the physics step
+		GameObjects,    // Updating game objects and behaviors
+		Audio,
+		WaitForRender,  // Waiting on the render thread
+		MainThreadJobs, // Uploads and other main thread jobs
+		Chunks,         // Streaming and swapping chunks
+		Physics,        // Starting the physics step
+		Render,         // Submitting the frame
+		Events,         // Servicing window and input events
+		Count
+	};
+};
+
+namespace FDebug
+{
+	/**
+	* Histograms of the frame time and the time of each stage of the main thread's
+	* frame. Times are counted into log-linear buckets, 32 for each power of two of
+	* microseconds, so percentiles are within about 3% of the measured times and
+	* cost no more to keep for long intervals. The histograms cover the last
+	* completed interval, which ends every INTERVAL seconds.
+	*
+	* Frames longer than the hitch threshold are counted, and while the CPU
+	* profiler is capturing, its markers of the last HITCH_CAPTURE_FRAMES frames
+	* are exported as a trace. Intervals may be exported as a line of JSON each,
+	* appended to a file and passed to an export handler. Only used from the main
+	* thread, exports are written on the job system.
+	*/
+	class FrameStats
+	{
+	public:
+		// Seconds covered by each interval
+		static const uint32_t INTERVAL = 10;
+
+		// Frames before a hitch whose markers are exported
+		static const uint32_t HITCH_CAPTURE_FRAMES = 32;
+
+		// Seconds after a hitch is exported before the next can be
+		static const uint32_t HITCH_CAPTURE_COOLDOWN = 5;
+
+		/**
+		* Percentiles of an interval, in milliseconds.
+		*/
+		struct Summary
+		{
+			float    P50Ms;
+			float    P95Ms;
+			float    P99Ms;
+			float    MaxMs;
+			uint32_t SampleCount;
+		};
+
+		/**
+		* Passed each exported interval, as a line of JSON.
+		*/
+		using ExportHandler = std::function<void(const std::string& Json)>;
+
+		/**
+		* Scope based timing of a stage. Adds to the stage's time of this frame on destruction.
+		*/
+		class Scope
+		{
+		public:
+			Scope(const EFrameStage::Type Stage)
+				: mStage(Stage)
+				, mBegin(FClock::ReadSystemTimer())
+			{
+			}
+
+			~Scope()
+			{
+				AddStageTime(mStage, FClock::ReadSystemTimer() - mBegin);
+			}
+
+			Scope(const Scope& Other) = delete;
+			Scope& operator=(const Scope& Other) = delete;
+
+		private:
+			EFrameStage::Type mStage;
+			uint64_t          mBegin;
+		};
+
+	public:
+		/**
+		* Counts the frame that ended since the last call into the histograms. Call once a frame.
+		*/
+		static void EndFrame();
+
+		/**
+		* Sets the frame time over which a frame is a hitch.
+		* @param Milliseconds - The threshold, or 0 to detect no hitches.
+		*/
+		static void SetHitchThreshold(const float Milliseconds) { HitchThresholdMs = Milliseconds; }
+
+		/**
+		* Sets the file each interval is appended to.
+		* @param Filename - The file, relative to the working directory, or empty to write none.
+		*/
+		static void SetExportFile(const std::wstring& Filename);
+
+		/**
+		* Sets what is passed each interval, such as a sender to a metrics collector.
+		* Called on a job worker. Null to pass nothing.
+		*/
+		static void SetExportHandler(ExportHandler Handler);
+
+		/**
+		* The frame times of the last interval.
+		*/
+		static Summary GetFrameSummary();
+
+		/**
+		* The times of a stage over the frames of the last interval.
+		*/
+		static Summary GetStageSummary(const EFrameStage::Type Stage);
+
+		/**
+		* Hitches since the engine started.
+		*/
+		static uint32_t GetHitchCount() { return HitchCount; }
+
+		/**
+		* The name of a stage, as exported.
+		*/
+		static const char* GetName(const EFrameStage::Type Stage);
+
+	private:
+		static void AddStageTime(const EFrameStage::Type Stage, const uint64_t Cycles);
+
+		/**
+		* Ends the interval, exporting it if there is a file or handler to export to.
+		*/
+		static void EndInterval(const uint64_t Now);
+
+	private:
+		FrameStats() = delete;	// Not meant for instantiation
+
+		static uint64_t StageCycles[EFrameStage::Count]; // Of the frame being timed
+		static float    HitchThresholdMs;
+		static uint32_t HitchCount;
+	};
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "Utils/Singleton.h"
+
+namespace FDebug
+{
+	/**
+	* Measures the GPU time of render passes with timestamp queries. Queries of
+	* a frame are read back FRAME_COUNT frames later, when the GPU has long
+	* finished them, so measuring never stalls the pipeline. Passes may nest.
+	* Resolved frames are kept so they can be exported, as CSV or as a trace
+	* viewable in chrome://tracing.
+	*/
+	class GPUProfiler : public TSingleton<GPUProfiler>
+	{
+	public:
+		// Frames of queries in flight before the oldest is read
+		static const uint32_t FRAME_COUNT = 4;
+
+		// Resolved frames kept for exporting
+		static const uint32_t HISTORY_FRAMES = 600;
+
+		/**
+		* A measured pass, in nanoseconds of GPU time.
+		*/
+		struct PassResult
+		{
+			const char* Name;
+			uint32_t    Depth; // Number of passes this one is nested in
+			uint64_t    Begin;
+			uint64_t    End;
+		};
+
+		/**
+		* Every pass measured over a frame.
+		*/
+		struct FrameResult
+		{
+			uint64_t                Frame;
+			uint64_t                Begin;
+			uint64_t                End;
+			std::vector<PassResult> Passes;
+		};
+
+		/**
+		* Scope based measuring of a pass. Begins the pass on construct and
+		* ends it on destruction.
+		*/
+		class Scope
+		{
+		public:
+			Scope(const char* Name) { GPUProfiler::GetInstance().BeginPass(Name); }
+			~Scope() { GPUProfiler::GetInstance().EndPass(); }
+
+			Scope(const Scope& Other) = delete;
+			Scope& operator=(const Scope& Other) = delete;
+		};
+
+	public:
+		GPUProfiler();
+		~GPUProfiler();
+
+		/**
+		* Starts measuring a frame, reading back the frame FRAME_COUNT frames before it.
+		*/
+		void BeginFrame();
+
+		/**
+		* Stops measuring the frame. Every pass must have ended.
+		*/
+		void EndFrame();
+
+		/**
+		* Begins measuring a pass of the current frame.
+		* @param Name - The name of the pass, which must outlive the profiler.
+		*/
+		void BeginPass(const char* Name);
+
+		/**
+		* Ends the last pass begun.
+		*/
+		void EndPass();
+
+		/**
+		* The most recently resolved frame, or null if none was yet.
+		*/
+		const FrameResult* GetLastResult() const;
+
+		/**
+		* Writes every kept frame to a file. Files ending in .csv get a row for
+		* each pass, anything else gets a Chrome trace.
+		* @param Filename - The file to write, relative to the working directory.
+		* @return True if the file was written.
+		*/
+		bool Export(const wchar_t* Filename) const;
+
+	private:
+		struct Pass
+		{
+			const char* Name;
+			uint32_t    Depth;
+			uint32_t    BeginQuery;
+			uint32_t    EndQuery;
+		};
+
+		struct FrameQueries
+		{
+			std::vector<GLuint> Queries;
+			std::vector<Pass>   Passes;
+			uint64_t            Frame;
+			uint32_t            QueryCount; // Queries issued, the first and last bound the frame
+			bool                IsPending;  // True until read back
+		};
+
+	private:
+		/**
+		* Reads back a frame, dropping it if its queries somehow aren't done.
+		*/
+		void Resolve(FrameQueries& Frame);
+
+		/**
+		* Records the GPU time once every command before it completes.
+		* @return The index of the query in the frame.
+		*/
+		uint32_t IssueTimestamp(FrameQueries& Frame);
+
+	private:
+		FrameQueries            mFrames[FRAME_COUNT];
+		std::vector<uint32_t>   mPassStack;  // Passes begun and not ended, innermost last
+		std::vector<GLuint64>   mTimestamps; // Read back results, reused each frame
+		std::deque<FrameResult> mHistory;
+		uint64_t                mFrame;
+		bool                    mIsRecording;
+	};
+}
@@ -14,7 +14,33 @@ namespace FDebug
 	* In-game console.
 	* Commands:
 	* DrawPhysics bool
+	* ParallelPhysics bool
 	* LoadWorld string
+	* SetViewDistance int
+	* SetEvictionMargin int, chunks past the view distance kept loaded
+	* SetChunkWorkers int
+	* SetLODDistance int int
+	* DrawGPUProfile bool
+	* ExportGPUProfile string, as CSV if it ends in .csv and a Chrome trace otherwise
+	* DynamicResolution bool
+	* SetGPUBudget float, in milliseconds
+	* DepthPrePass bool
+	* DrawMemory bool
+	* SetMemoryBudget string int, a memory tag and its budget in megabytes, 0 for none
+	* LogMemory
+	* CaptureCPUProfile int, a number of frames, 0 to capture until stopped
+	* StopCPUProfile
+	* ExportCPUProfile string, as a Chrome trace
+	* DrawChunkStats bool
+	* LogChunkStats
+	* CookMesh string, an .obj model cooked to a .cmesh of the same name
+	* SetTargetFPS float, 0 to run unpaced
+	* SetSwapBudget int float, chunk mesh kilobytes and milliseconds swapped each frame
+	* GPUMeshing bool
+	* FarTerrain bool
+	* ConnectivityCulling bool
+	* SetPrefetchLookahead float, seconds of camera movement to prefetch chunks for, 0 to disable
+	* SmoothDeltaTime bool
 	*/
 	class GameConsole : public TSingleton<GameConsole>
 	{
@@ -39,6 +65,9 @@ namespace FDebug
 		FRenderSystem*      mRenderSystem;
 		FChunkManager*      mChunkManager;
 		bool                mDrawPhysics;
+		bool                mDrawGPUProfile;
+		bool                mDrawMemory;
+		bool                mDrawChunkStats;
 		bool                mIsActive;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdarg>
+#include <atomic>
+
+/**
+* How important a logged message is.
+*/
+struct ELogSeverity
+{
+	enum Type : uint32_t
+	{
+		Debug,   // Tracing while developing
+		Info,    // Progress and results
+		Warning, // Something recoverable went wrong
+		Error,   // Something failed
+		Count
+	};
+};
+
+/**
+* The subsystem a logged message comes from, each can be filtered out at runtime.
+*/
+struct ELogCategory
+{
+	enum Type : uint32_t
+	{
+		General,
+		Audio,
+		Rendering,
+		Chunks,
+		Physics,
+		FileIO,
+		Count
+	};
+};
+
+// Messages less severe are compiled out, release builds keep only warnings and errors
+#ifndef LOG_MIN_SEVERITY
+#ifdef NDEBUG
+#define LOG_MIN_SEVERITY ELogSeverity::Warning
+#else
+#define LOG_MIN_SEVERITY ELogSeverity::Debug
+#endif
+#endif
+
+/**
+* Logs a printf formatted message. The arguments aren't evaluated if the message is filtered out.
+* @param Severity - An ELogSeverity, such as Warning.
+* @param Category - An ELogCategory, such as Audio.
+*/
+#define LOG(Severity, Category, ...) \
+	if (ELogSeverity::Severity < LOG_MIN_SEVERITY || !FDebug::Log::IsEnabled(ELogSeverity::Severity, ELogCategory::Category)) { } \
+	else FDebug::Log::Write(ELogSeverity::Severity, ELogCategory::Category, __VA_ARGS__)
+
+namespace FDebug
+{
+	/**
+	* Logs messages from any thread without waiting on console I/O. Messages are
+	* formatted into a ring buffer of the calling thread, which only its thread
+	* writes to and only the writer thread reads from. The writer thread prints
+	* the buffers every WRITE_INTERVAL_MS. Each thread may log MESSAGES_PER_SECOND of
+	* each category, further messages and those that don't fit are counted as dropped.
+	* Until the writer is started, messages are printed as they are logged.
+	*/
+	class Log
+	{
+	public:
+		// Entries in the ring buffer of each thread, long messages span several
+		static const uint32_t ENTRIES_PER_THREAD = 512;
+
+		// Characters of a message held by one entry
+		static const uint32_t ENTRY_CHARS = 120;
+
+		// Longest message, the rest is cut off
+		static const uint32_t MAX_MESSAGE_CHARS = 2048;
+
+		// Messages of one category each thread may log per second
+		static const uint32_t MESSAGES_PER_SECOND = 200;
+
+		// Time the writer thread sleeps between printing the buffers
+		static const uint32_t WRITE_INTERVAL_MS = 10;
+
+	public:
+		/**
+		* Starts the writer thread.
+		*/
+		static void Start();
+
+		/**
+		* Prints every buffered message and stops the writer thread.
+		* Messages logged after are printed as they are logged.
+		*/
+		static void Stop();
+
+		/**
+		* Prints every message logged so far before returning, such as before exiting.
+		*/
+		static void Flush();
+
+		/**
+		* Formats and queues a message. Use the LOG macro, which compiles out filtered severities.
+		* @return The number of chars in the message.
+		*/
+		static int32_t Write(const ELogSeverity::Type Severity, const ELogCategory::Type Category, const char* Format, ...);
+
+		/**
+		* Formats and queues a message from a va_list.
+		* @return The number of chars in the message.
+		*/
+		static int32_t VWrite(const ELogSeverity::Type Severity, const ELogCategory::Type Category, const char* Format, va_list ArgList);
+
+		/**
+		* Sets the least severe messages kept at runtime.
+		*/
+		static void SetMinSeverity(const ELogSeverity::Type Severity) { MinSeverity.store(Severity, std::memory_order_relaxed); }
+
+		/**
+		* Enables or disables the messages of a category at runtime.
+		*/
+		static void SetCategoryEnabled(const ELogCategory::Type Category, const bool IsEnabled);
+
+		/**
+		* If messages of a severity and category are kept at runtime.
+		*/
+		static bool IsEnabled(const ELogSeverity::Type Severity, const ELogCategory::Type Category)
+		{
+			return Severity >= MinSeverity.load(std::memory_order_relaxed) && (EnabledCategories.load(std::memory_order_relaxed) & (1u << Category)) != 0;
+		}
+
+		/**
+		* The name of a category as printed before its messages.
+		*/
+		static const char* GetName(const ELogCategory::Type Category);
+
+	private:
+		Log() = delete;	// Not meant for instantiation
+
+		static std::atomic<uint32_t> MinSeverity;
+		static std::atomic<uint32_t> EnabledCategories; // One bit for each category
+	};
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+* Times the CPU kernels of the chunk pipeline on fixed chunk corpora, so changes
+* to the mesher, codecs and region files show up in numbers. The corpora are
+* all air, all solid, a terrain surface, a checkerboard that is the worst case
+* for runs and merged faces, and noise caves. Each kernel is run on each corpus
+* for at least a quarter of a second and is reported in nanoseconds
+* per chunk and megabytes per second of the data it reads or writes.
+* Verify checks kernels against simpler reference implementations first.
+* Needs an IFileSystem for the region kernels, and no GL.
+*/
+class SMicroBenchmarks
+{
+public:
+	SMicroBenchmarks() = delete;	// Not meant for instantiation
+
+	/**
+	* The timing of one kernel on one corpus.
+	*/
+	struct Result
+	{
+		std::string Kernel;
+		std::string Corpus;
+		double      NanosecondsPerChunk;
+		double      MegabytesPerSecond;
+	};
+
+	// Chunks each kernel runs on at the least, however fast it is
+	static const uint32_t MIN_RUN_CHUNKS = 64;
+
+	/**
+	* Runs every kernel on every corpus.
+	* @param ResultFilename - A JSON file to write the results to, or nullptr.
+	* @return The results, also printed to the console output.
+	*/
+	static std::vector<Result> Run(const wchar_t* ResultFilename);
+
+	/**
+	* Checks kernels against simpler reference implementations, so an
+	* optimization that changes what a kernel produces isn't timed as a win.
+	* @return If every check passed. Each is also printed to the console output.
+	*/
+	static bool Verify();
+
+private:
+	/**
+	* Checks that buffered block changes made with FChunk::SetBlock coalesce to
+	* the type each block had before and after, for overwrites and blocks set to air.
+	*/
+	static bool VerifyBlockChanges();
+
+	/**
+	* Checks that FWorldGenerator::BuildChunk builds the same payloads, byte for byte, as
+	* mapping each block's column height and searching the terrain levels one block at a time.
+	*/
+	static bool VerifyGenerator();
+
+	/**
+	* Checks that caves carved by FWorldGenerator::BuildChunk match interpolating the cave
+	* lattice trilinearly one block at a time, at both lattice spacings.
+	*/
+	static bool VerifyCaves();
+
+	/**
+	* Times FWorldGenerator::BuildChunk on fixed heightmaps, as the heights
+	* would be sampled from noise for each column.
+	*/
+	static void TimeGenerator(std::vector<Result>& ResultsOut);
+};
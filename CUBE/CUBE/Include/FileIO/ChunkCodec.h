@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+* Compression of chunk RLE data stored in region files. LZ compresses
+* with the LZ4 block format: runs of literals followed by back references
+* of at least 4 bytes within the last 64KiB.
+*/
+class FChunkCodec
+{
+public:
+	/**
+	* Encodings of chunk data on file. Stored with each chunk, so chunks
+	* of different codecs can be mixed within a region file.
+	*/
+	enum Codec : uint8_t
+	{
+		Raw = 0,
+		LZ = 1
+	};
+
+public:
+	/**
+	* Compresses data with the LZ codec.
+	* @param Data - The data to compress.
+	* @param DataSize - The size of Data in bytes.
+	* @param DataOut - To put the compressed data.
+	* @param Capacity - The size of DataOut in bytes.
+	* @return The compressed size in bytes. 0 if the compressed data would not fit in DataOut.
+	*/
+	static uint32_t Compress(const uint8_t* Data, const uint32_t DataSize, uint8_t* DataOut, const uint32_t Capacity);
+
+	/**
+	* Decompresses LZ codec data.
+	* @param Data - The compressed data.
+	* @param DataSize - The size of Data in bytes.
+	* @param DataOut - To put the decompressed data.
+	* @param Capacity - The size of DataOut in bytes.
+	* @return The decompressed size in bytes. 0 if the data is malformed or would not fit in DataOut.
+	*/
+	static uint32_t Decompress(const uint8_t* Data, const uint32_t DataSize, uint8_t* DataOut, const uint32_t Capacity);
+};
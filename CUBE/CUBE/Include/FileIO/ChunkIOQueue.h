@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+* A thread that runs chunk file I/O in submission order. Region reads
+* block this thread instead of the chunk workers, and the work submitted
+* once data arrives overlaps with the next read. Region files are mapped,
+* so reads are page faults taken here rather than overlapped requests.
+* Low priority requests, such as speculative reads, only run while no
+* other request is waiting.
+*/
+class FChunkIOQueue
+{
+public:
+	using Request = std::function<void()>;
+
+public:
+	FChunkIOQueue();
+
+	/**
+	* Dtor
+	* Finishes all submitted requests and joins the I/O thread.
+	*/
+	~FChunkIOQueue();
+
+	FChunkIOQueue(const FChunkIOQueue& Other) = delete;
+	FChunkIOQueue& operator=(const FChunkIOQueue& Other) = delete;
+
+	/**
+	* Starts the I/O thread. If it is already running, current requests
+	* are finished and the thread is restarted.
+	*/
+	void Start();
+
+	/**
+	* Finishes all submitted requests and joins the I/O thread.
+	*/
+	void Stop();
+
+	/**
+	* Submits an I/O request.
+	* @param NewRequest - The work to execute.
+	*/
+	void Submit(Request NewRequest);
+
+	/**
+	* Submits an I/O request that only runs while no other request is waiting.
+	* Low priority requests that haven't started when the queue stops are dropped.
+	* @param NewRequest - The work to execute.
+	*/
+	void SubmitLowPriority(Request NewRequest);
+
+	/**
+	* Drops every low priority request that hasn't started.
+	*/
+	void ClearLowPriority();
+
+	/**
+	* The number of requests that have been submitted, but have not
+	* completed.
+	*/
+	uint32_t GetPendingRequestCount() const { return mPendingRequests; }
+
+	/**
+	* The number of low priority requests that have been submitted, but have
+	* not started. Not included in GetPendingRequestCount.
+	*/
+	uint32_t GetPendingLowPriorityCount() const { return mPendingLowPriority; }
+
+private:
+	void IOThreadLoop();
+
+private:
+	std::thread             mIOThread;
+	std::deque<Request>     mRequests;
+	std::deque<Request>     mLowPriorityRequests;
+	std::mutex              mRequestMutex;
+	std::condition_variable mRequestAvailable;
+	std::atomic<uint32_t>   mPendingRequests;
+	std::atomic<uint32_t>   mPendingLowPriority;
+	bool                    mMustStop;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Math\Vector3.h"
+#include "SystemResources\SystemFile.h"
+
+/**
+* What each chunk of a world holds, kept in tables of one region each and stored
+* with the world's info. Chunks of a single block type, all air ones included, can
+* be loaded from their entry without reading their data. Chunks not yet read or
+* written are unknown.
+*/
+class FChunkOccupancy
+{
+public:
+	/**
+	* The occupancy of a chunk.
+	*/
+	struct Entry
+	{
+		enum State : uint8_t
+		{
+			Unknown, // Must be read
+			Uniform, // Every block is ID
+			Mixed    // Must be read
+		};
+
+		uint8_t State;
+		uint8_t ID; // FBlockTypes::BlockID of uniform chunks
+	};
+
+public:
+	FChunkOccupancy();
+
+	/**
+	* Summarizes RLE chunk data, as FChunk::Load would read it.
+	* @param BlockData - The RLE encoded blocks of the chunk.
+	* @param DataSize - The size of BlockData in bytes. Chunks without data are all air.
+	*/
+	static Entry Summarize(const uint8_t* BlockData, const uint32_t DataSize);
+
+	/**
+	* The entry of a chunk, unknown if it has none.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	*/
+	Entry Find(const Vector3i& ChunkPosition) const;
+
+	/**
+	* Sets the entry of a chunk.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param Occupancy - What the chunk holds.
+	*/
+	void Set(const Vector3i& ChunkPosition, const Entry& Occupancy);
+
+	/**
+	* Drops every entry.
+	*/
+	void Clear();
+
+	/**
+	* Replaces every entry with the tables read from a file, up to its end.
+	* @return False if the tables are cut short, leaving every entry unknown.
+	*/
+	bool Read(IFileHandle& File);
+
+	/**
+	* Writes every table to a file.
+	*/
+	bool Write(IFileHandle& File) const;
+
+private:
+	// Hash functor for the region table
+	struct Vector3iHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	/**
+	* The index of a chunk within its region's table.
+	*/
+	static uint32_t EntryIndex(const Vector3i& ChunkPosition);
+
+private:
+	std::unordered_map<Vector3i, std::vector<Entry>, Vector3iHash> mRegions; // Entries of each region, by region position
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "Math\Vector3.h"
+#include "Memory\MemoryStats.h"
+
+/**
+* Encoded chunk data held in memory in front of the region files, least recently
+* used first out. Entries hold chunks as they are stored on file, RLE encoded and
+* possibly LZ compressed. Dirty entries are newer than their region file, and must
+* be written back by the owner once taken out. The ChunkCache memory budget sets how
+* much is held, and nothing is held without one. The cache is not thread safe.
+*/
+class FChunkPayloadCache
+{
+public:
+	/**
+	* The data of a chunk.
+	*/
+	struct Entry
+	{
+		std::vector<uint8_t> Data;
+		uint8_t              Codec;   // FChunkCodec::Codec of Data
+		bool                 IsDirty; // Not yet written to the region file
+	};
+
+public:
+	FChunkPayloadCache();
+
+	FChunkPayloadCache(const FChunkPayloadCache& Other) = delete;
+	FChunkPayloadCache& operator=(const FChunkPayloadCache& Other) = delete;
+
+	/**
+	* Finds the entry of a chunk, making it the most recently used.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @return Null if the chunk has no entry.
+	*/
+	const Entry* Find(const Vector3i& ChunkPosition);
+
+	/**
+	* Sets the entry of a chunk, replacing any it had, as the most recently used.
+	* An entry replaced while dirty stays dirty.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param Data - The encoded data of the chunk.
+	* @param DataSize - The size of Data in bytes.
+	* @param Codec - The FChunkCodec::Codec the data is encoded with.
+	* @param IsDirty - If the data isn't on file yet.
+	*/
+	void Insert(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec, const bool IsDirty);
+
+	/**
+	* If the cache holds more than the ChunkCache memory budget.
+	*/
+	bool IsOverBudget() const;
+
+	/**
+	* Takes out the least recently used entry.
+	* @param PositionOut - To put the position of the entry's chunk.
+	* @param EntryOut - To put the entry.
+	* @return False if the cache is empty.
+	*/
+	bool TakeLeastRecent(Vector3i& PositionOut, Entry& EntryOut);
+
+	/**
+	* Calls a function with every dirty entry, and marks them clean.
+	* @param Writer - Called as Writer(const Vector3i& ChunkPosition, const Entry& DirtyEntry).
+	*/
+	template <typename Function>
+	void TakeDirty(const Function& Writer);
+
+	/**
+	* Drops every entry, dirty or not.
+	*/
+	void Clear();
+
+private:
+	// Hash functor for the entry table
+	struct Vector3iHash
+	{
+		std::size_t operator()(const Vector3i& Val) const
+		{
+			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
+		}
+	};
+
+	struct Record
+	{
+		Entry                         Value;
+		std::list<Vector3i>::iterator Use; // Position in mUseOrder
+	};
+
+	/**
+	* The bytes held for an entry, including the table and list nodes.
+	*/
+	static uint64_t EntryBytes(const Entry& Value);
+
+private:
+	std::unordered_map<Vector3i, Record, Vector3iHash> mEntries;
+	std::list<Vector3i> mUseOrder; // Most recently used first
+	uint64_t            mDirtyCount;
+	FTrackedBytes       mBytes;
+};
+
+template <typename Function>
+inline void FChunkPayloadCache::TakeDirty(const Function& Writer)
+{
+	if (mDirtyCount == 0)
+		return;
+
+	for (auto& Pair : mEntries)
+	{
+		if (Pair.second.Value.IsDirty)
+		{
+			Writer(Pair.first, Pair.second.Value);
+			Pair.second.Value.IsDirty = false;
+		}
+	}
+
+	mDirtyCount = 0;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Math\Vector3.h"
+#include "SystemResources\SystemFile.h"
+
+/**
+* Append-only log of block edits for the currently loaded world. Edits are
+* buffered and written in groups by Commit, so durability only costs
+* sequential writes. Region files are only rewritten when the world is
+* saved, and edits since the last completed save are replayed on load.
+*
+* A save starts a new journal segment. The previous segment is kept until
+* the save finishes, so a crash during a save loses no edits.
+*/
+class FEditJournal
+{
+public:
+	/**
+	* A block set in the world.
+	*/
+	struct Edit
+	{
+		Vector3i Position; // World block position
+		uint8_t  BlockID;  // FBlockTypes::BlockID the block was set to
+	};
+
+public:
+	FEditJournal();
+
+	/**
+	* Dtor
+	* Commits pending edits and closes the journal.
+	*/
+	~FEditJournal();
+
+	FEditJournal(const FEditJournal& Other) = delete;
+	FEditJournal& operator=(const FEditJournal& Other) = delete;
+
+	/**
+	* Opens the journal of a world for appending, closing the current one.
+	* Segments left by a crash are read and folded into one journal.
+	* Edits on file are read even if the journal can't be opened. Until a
+	* save starts a new segment, appended edits are then dropped.
+	* @param WorldName - The name of the world.
+	* @param EditsOut - To put the edits on file, oldest first.
+	* @return True if the journal was opened.
+	*/
+	bool Open(const wchar_t* WorldName, std::vector<Edit>& EditsOut);
+
+	/**
+	* Commits pending edits and closes the journal.
+	*/
+	void Close();
+
+	/**
+	* Checks if appended edits are being written to the journal.
+	*/
+	bool IsOpen() const { return mIsOpen; }
+
+	/**
+	* Adds an edit to be written with the next commit.
+	*/
+	void Append(const Vector3i& Position, const uint8_t BlockID);
+
+	/**
+	* Adds several edits to be written with the next commit.
+	*/
+	void Append(const std::vector<Edit>& Edits);
+
+	/**
+	* Checks if there are edits waiting to be committed.
+	*/
+	bool HasPendingEdits() const;
+
+	/**
+	* Writes all pending edits to the end of the journal and flushes them
+	* to disk.
+	* @return True if the edits are on disk.
+	*/
+	bool Commit();
+
+	/**
+	* Commits pending edits and starts a new segment. Edits before this call
+	* are expected to be covered by the save. Also reopens a journal that
+	* failed to open.
+	* @param RetainedEdits - Edits the save won't cover, written at the start of the new segment.
+	* @return True if the new segment was created.
+	*/
+	bool BeginSave(const std::vector<Edit>& RetainedEdits);
+
+	/**
+	* Deletes the segment replaced by BeginSave once the save is on disk.
+	*/
+	void EndSave();
+
+private:
+	/**
+	* Writes pending edits. mFileMutex must be locked when calling this.
+	*/
+	bool CommitPending();
+
+private:
+	std::wstring                 mFilepath;
+	std::wstring                 mSavingFilepath; // Segment being replaced by a save
+	std::unique_ptr<IFileHandle> mFile;
+	std::vector<Edit>            mPendingEdits;
+	mutable std::mutex           mPendingMutex;
+	std::mutex                   mFileMutex;
+	std::atomic<bool>            mIsOpen;         // Set while edits are written to mFile
+};
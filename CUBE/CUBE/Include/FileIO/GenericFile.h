@@ -30,6 +30,28 @@ public:
 	*/
 	virtual bool Write(const uint8_t* Data, const uint32_t NumBytesToWrite) = 0;
 
+	/**
+	* Reads a specific amount of data at an offset in the file. The offset is
+	* passed with the read, so threads may read one handle at the same time.
+	* The current file pointer is undefined afterwards.
+	* @param Offset - The byte offset in the file to read from.
+	* @param DataOut - Buffer for the data read.
+	* @param NumBytesToRead - Number of bytes to read from the file.
+	* @return False if the number of bytes to read could not be read.
+	*/
+	virtual bool ReadAt(const uint64_t Offset, uint8_t* DataOut, const uint32_t NumBytesToRead) = 0;
+
+	/**
+	* Writes a specific amount of data at an offset in the file. Writes of
+	* different ranges may be made by several threads at the same time.
+	* The current file pointer is undefined afterwards.
+	* @param Offset - The byte offset in the file to write to.
+	* @param Data - The data to write.
+	* @param NumBytesToWrite - Number of bytes to write to the file.
+	* @return False if the number of bytes to write could not be written.
+	*/
+	virtual bool WriteAt(const uint64_t Offset, const uint8_t* Data, const uint32_t NumBytesToWrite) = 0;
+
 	/**
 	* Seeks the current file pointer from it's current position to
 	* some specified distance.
@@ -58,6 +80,51 @@ public:
 	* Retrieves the size of this file.
 	*/
 	virtual uint32_t GetFileSize() const = 0;
+
+	/**
+	* Writes buffered data of the file to disk.
+	* @return True if the flush succeeded.
+	*/
+	virtual bool Flush() = 0;
+};
+
+/**
+* Interface for platform files mapped into memory. The whole file is
+* mapped, so reads and writes are plain memory accesses and caching is
+* left to the OS page cache.
+*/
+class IMappedFile
+{
+public:
+	IMappedFile() = default;
+
+	virtual ~IMappedFile(){};
+
+	/**
+	* Retrieves the start of the mapped file. The pointer is invalidated
+	* by Resize().
+	*/
+	virtual uint8_t* GetData() = 0;
+
+	/**
+	* Retrieves the size of the mapped file.
+	*/
+	virtual uint32_t GetFileSize() const = 0;
+
+	/**
+	* Changes the size of the file and remaps it. Data up to the smaller
+	* of the old and new size is kept. The contents of grown space are
+	* undefined.
+	* @param NewSize - The new size of the file in bytes.
+	* @return True if the file was resized and remapped.
+	*/
+	virtual bool Resize(const uint32_t NewSize) = 0;
+
+	/**
+	* Writes modified pages of the mapping back to disk.
+	* @return True if the flush succeeded.
+	*/
+	virtual bool Flush() = 0;
 };
 
 /**
@@ -107,6 +174,17 @@ public:
 	*/
 	virtual std::unique_ptr<IFileHandle> OpenReadWritable(const wchar_t* FileName, const bool AllowRead = false, const bool CreateNew = false) = 0;
 
+	/**
+	* Opens or creates a file in the current working directory and maps it
+	* into memory for reading and writing.
+	* @param Filename to open.
+	* @param CreateNew True if a new, empty file should be created.
+	* @param ReadOnly True if the mapping should only be readable. Read only files can't be resized.
+	* @return A pointer to the mapped file. Nullptr if the open/create
+	* operation failed.
+	*/
+	virtual std::unique_ptr<IMappedFile> OpenMapped(const wchar_t* Filename, const bool CreateNew = false, const bool ReadOnly = false) = 0;
+
 	/**
 	* Deletes a file.
 	* @param Filename Name of the file to delete.
@@ -114,6 +192,23 @@ public:
 	*/
 	virtual bool DeleteFilename(const wchar_t* Filename) = 0;
 
+	/**
+	* Copies a file, overwriting the destination if it exists.
+	* @param From - The file to copy.
+	* @param To - The file to copy to.
+	* @return True if the copy succeeded.
+	*/
+	virtual bool CopyFilename(const wchar_t* From, const wchar_t* To) = 0;
+
+	/**
+	* Moves a file over another in a single rename, so the destination
+	* is either the old or the new file, never partly written.
+	* @param From - The file to move.
+	* @param To - The file to replace. Created if it doesn't exist.
+	* @return True if the move succeeded.
+	*/
+	virtual bool ReplaceFilename(const wchar_t* From, const wchar_t* To) = 0;
+
 	/**
 	* Retrieves the current working file directory.
 	* @param DataOut Location for the directory to be written.
@@ -2,19 +2,24 @@
 
 #include <cstdint>
 #include "Math\Vector3.h"
+#include "Math\FMath.h"
 #include "SystemResources\SystemFile.h"
+#include "Memory\MemoryStats.h"
 #include <memory>
+#include <vector>
+#include <string>
 
 /**
 * Represents a region file for storing world
-* chunk layouts.
+* chunk layouts. The file is mapped into memory, so
+* the lookup table and sectors are accessed in place.
 */
 class FRegionFile
 {
 public:
 	static Vector3i ChunkToRegionPosition(const Vector3i& WorldChunkPosition)
 	{
-		return WorldChunkPosition / (int32_t)RegionData::REGION_SIZE;
+		return FMath::FloorDivide(WorldChunkPosition, (int32_t)RegionData::REGION_SIZE);
 	}
 
 	static Vector3i ChunkToRegionPosition(int32_t x, int32_t y, int32_t z)
@@ -24,9 +29,7 @@ public:
 
 	static Vector3i LocalRegionPosition(const Vector3i& WorldChunkPosition)
 	{
-		return Vector3i{ WorldChunkPosition.x % (int32_t)RegionData::REGION_SIZE,
-			WorldChunkPosition.y % (int32_t)RegionData::REGION_SIZE,
-			WorldChunkPosition.z % (int32_t)RegionData::REGION_SIZE };
+		return FMath::FloorModulo(WorldChunkPosition, (int32_t)RegionData::REGION_SIZE);
 	}
 
 public:
@@ -35,24 +38,52 @@ public:
 	*/
 	FRegionFile();
 
+	/**
+	* Closes the region file.
+	*/
 	~FRegionFile();
 
+	/**
+	* Builds the path of a region file.
+	* @param WorldName - The name of this world the region is a part of.
+	* @param RegionPosition - The position of the region.
+	*/
+	static std::wstring GetFilepath(const wchar_t* WorldName, const Vector3i& RegionPosition);
+
 	/**
 	* Loads a specific region file. All region files for a world is placed in
 	* the Worlds/(world-name)/.vgr directory. 
 	* @param WorldName - The name of this world this region is a part of.
 	* @param RegionPosition - The position of the region you world to load.
+	* @param ReadOnly - True if the file will only be read. Read only files must already exist.
 	* @return True if the region file was loaded successfully.
 	*/
-	bool Load(const wchar_t* WorldName, const Vector3i& RegionPosition);
+	bool Load(const wchar_t* WorldName, const Vector3i& RegionPosition, const bool ReadOnly = false);
+
+	/**
+	* Compacts the region file if enough of it is free, then flushes
+	* and unmaps the file.
+	*/
+	void Close();
+
+	/**
+	* Writes modified pages of the region file to disk.
+	*/
+	void Flush();
+
+	/**
+	* True if the region file was loaded read only and can't be written to.
+	*/
+	bool IsReadOnly() const { return mReadOnly; }
 
 	/**
 	* Retrieve info about a specific chunk.
 	* @param ChunkPosition - Position of the chunk within this region.
 	* @param SizeOut - To put the size, in bytes, of the data for the chunk.
 	* @param SectorOffsetOut - The sector offset for this chunks data.
+	* @param CodecOut - To put the FChunkCodec::Codec the data is encoded with.
 	*/
-	void GetChunkDataInfo(const Vector3i& ChunkPosition, uint32_t& SizeOut, uint32_t& SectorOffsetOut);
+	void GetChunkDataInfo(const Vector3i& ChunkPosition, uint32_t& SizeOut, uint32_t& SectorOffsetOut, uint8_t& CodecOut);
 
 	/**
 	* Retrieves the data for the layout of a chunk.
@@ -62,13 +93,46 @@ public:
 	*/
 	void GetChunkData(const uint32_t SectorOffset, uint8_t* DataOut, const uint32_t DataSize);
 
+	/**
+	* A chunk read by GetChunkDataBatch.
+	*/
+	struct BatchRead
+	{
+		Vector3i              ChunkPosition; // Position of the chunk within this region
+		std::vector<uint8_t>* DataOut;       // Set to the chunk data, empty if the chunk is not in the file or larger than Capacity
+		uint8_t               Codec;         // Set to the FChunkCodec::Codec the data is encoded with
+	};
+
+	/**
+	* Retrieves the data of several chunks in the order of their sectors, so the
+	* mapped file is walked front to back in runs of adjacent sectors instead of
+	* being faulted in at random.
+	* @param Reads - The chunks to read, their data and codec are set.
+	* @param Count - The number of reads.
+	* @param Capacity - The largest chunk data in bytes that is read.
+	*/
+	void GetChunkDataBatch(BatchRead* Reads, const uint32_t Count, const uint32_t Capacity);
+
 	/**
 	* Writes data for a chunk to file.
 	* @param ChunkPosition - Position of the chunk within this region.
 	* @param Data - Data to write.
 	* @param SizeOut - The size of the data to write.
+	* @param Codec - The FChunkCodec::Codec the data is encoded with.
+	*/
+	void WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec = 0);
+
+	/**
+	* Moves all chunk data to the front of the file, removing free sectors,
+	* and truncates the file. This touches every sector after the first free
+	* one, so it is only done when a region is closed.
 	*/
-	void WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize);
+	void Compact();
+
+	/**
+	* The number of sectors in the file not used by any chunk.
+	*/
+	uint32_t GetFreeSectorCount() const { return mFreeSectorCount; }
 
 public:
 	/**
@@ -89,28 +153,83 @@ public:
 		LookupEntry ChunkEntry[REGION_SIZE * REGION_SIZE * REGION_SIZE];
 		// Sectors will follow the lookup table.
 		// Each sector is 4KiB and contains RLE chunk data.
-		// Chunk data starts with 4 byte data size at the beginning
+		// Chunk data starts with a 4 byte ChunkHeader at the beginning
 		// of the sector.
 	};
 
+	/**
+	* Header before the data of each chunk. Regions written before codecs
+	* were added read as raw, since their data sizes fit in 24 bits.
+	*/
+	struct ChunkHeader
+	{
+		uint32_t DataSize : 24; // Size of the encoded chunk data
+		uint32_t Codec : 8;     // FChunkCodec::Codec of the data
+	};
+
 private:
 	/**
-	* Adds a new chunk to the region file.
+	* Finds a run of free sectors, first fit. If no run is large enough,
+	* the sectors are appended to the end of the file.
+	* @param NumOfSectors - The number of consecutive sectors needed.
+	* @param SectorOffsetOut - To put the offset of the first sector.
+	* @return False if the file could not be grown.
+	*/
+	bool AllocateSectors(const uint32_t NumOfSectors, uint32_t& SectorOffsetOut);
+
+	/**
+	* Marks a run of sectors as free.
+	*/
+	void FreeSectors(const uint32_t SectorOffset, const uint32_t NumOfSectors);
+
+	/**
+	* Rebuilds the sector usage map from the lookup table.
 	*/
-	void AddNewChunk(LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize);
+	void BuildSectorMap();
 
 	/**
-	* Shifts chunk data to the left and relocates RelocationEntry to the end of the file.
+	* Writes sized chunk data to a sector and pads the rest of the chunk's sectors.
 	*/
-	void RelocateAndAddChunkData(LookupEntry& RelocationEntry, const uint8_t* Data, const uint32_t DataSize);
+	void WriteSectors(const LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec);
+
+	/**
+	* Resizes the region file to hold a number of sectors. Remaps the file, so
+	* any pointers into it are invalidated.
+	*/
+	bool ResizeSectors(const uint32_t SectorCount);
+
+	uint32_t GetSectorCount() const;
+
+	uint8_t* GetSector(const uint32_t SectorOffset);
+
+	RegionData& GetRegionData();
 
 	uint32_t GetTableIndex(Vector3i Position);
 
 private:
-	RegionData mRegionData;
-	std::unique_ptr<IFileHandle> mRegionFile;
+	std::unique_ptr<IMappedFile> mRegionFile;
+	std::vector<bool>            mUsedSectors;
+	uint32_t                     mFreeSectorCount;
+	bool                         mReadOnly;
+	FTrackedBytes                mMappedBytes; // Size of the mapped file
 };
 
+inline uint32_t FRegionFile::GetSectorCount() const
+{
+	return (mRegionFile->GetFileSize() - sizeof(RegionData)) / RegionData::SECTOR_SIZE;
+}
+
+inline uint8_t* FRegionFile::GetSector(const uint32_t SectorOffset)
+{
+	return mRegionFile->GetData() + sizeof(RegionData) + SectorOffset * RegionData::SECTOR_SIZE;
+}
+
+inline FRegionFile::RegionData& FRegionFile::GetRegionData()
+{
+	// The lookup table is at the start of the mapping
+	return *(RegionData*)mRegionFile->GetData();
+}
+
 inline uint32_t FRegionFile::GetTableIndex(Vector3i Position)
 {
 	const Vector3i PositionToIndex{ (int32_t)FRegionFile::RegionData::REGION_SIZE, (int32_t)FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE, 1 };
@@ -1,17 +1,33 @@
 #pragma once
 
+#include <list>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "RegionFile.h"
+#include "ChunkPayloadCache.h"
+#include "ChunkOccupancy.h"
 #include "Math\Vector3.h"
 
+/**
+* Chunk storage for the currently loaded world. Region files of the world
+* are only read. The first write to a region copies it to a shadow file in
+* the temp directory, and saving moves each shadow over its original.
+* Chunk data read or written recently is held in memory in front of the
+* regions, and writes reach their region once the data is evicted or saved.
+* The world's info holds what each known chunk is filled with, so uniform
+* chunks can be loaded without reading them. Each file system has its own
+* temp directory, so worlds of one process keep their shadows apart.
+*/
 class FWorldFileSystem
 {
 public:
-	static const wchar_t TEMP_DIRECTORY_NAME[];
+	static const wchar_t TEMP_DIRECTORY_NAME[]; // Of the first file system, later ones add their number
 	static const wchar_t WORLDS_DIRECTORY_NAME[];
-	static const wchar_t TEMP_DIRECTORY_PATH[];
+
+	// Unreferenced regions kept open in case they are referenced again
+	static const uint32_t REGION_CACHE_SIZE = 16;
 
 public:
 	FWorldFileSystem();
@@ -22,7 +38,7 @@ public:
 
 	/**
 	* Sets the specified world as the one currently being operated
-	* on.
+	* on. Discards shadow regions and held chunk data of the previous world.
 	* @return False if the world file could not be loaded, true otherwise.
 	*/
 	bool SetWorld(const wchar_t* WorldName);
@@ -38,7 +54,11 @@ public:
 	std::wstring GetWorldName() const;
 
 	/**
-	* Saves the current world data to it's original location on file.
+	* Saves the current world data to it's original location on file by
+	* replacing only the regions that were written to. Held chunk data is
+	* written to its region first. Regions that are still referenced are
+	* copied and stay open. The world's info is rewritten with the occupancy
+	* of every known chunk.
 	*/
 	void SaveWorld();
 
@@ -50,7 +70,9 @@ public:
 	void AddRegionFileReference(const Vector3i& ChunkPosition);
 
 	/**
-	* Removes a reference the a region file in the region map.
+	* Removes a reference the a region file in the region map. Regions
+	* without references stay open until they are the least recently
+	* used of more than REGION_CACHE_SIZE unreferenced regions.
 	* @param X, Y, Z Coordinates of the chunk.
 	*/
 	void RemoveRegionFileReference(const Vector3i& ChunkPosition);
@@ -64,34 +86,114 @@ public:
 	* Retrieves data for a chunk within the currently loaded world.
 	* @param ChunkPosition - The chunk space position of the chunk.
 	* @param DataOut - Buffer to place chunk data.
+	* @param Capacity - The size of DataOut in bytes.
+	* @param CodecOut - To put the FChunkCodec::Codec the data is encoded with.
+	* @return The size of the chunk data in bytes. 0 if the chunk is not on file or doesn't fit in DataOut.
+	*/
+	uint32_t GetChunkData(const Vector3i& ChunkPosition, uint8_t* DataOut, const uint32_t Capacity, uint8_t& CodecOut);
+
+	/**
+	* Retrieves data for several chunks, reading the chunks of each region in one
+	* pass over its sectors. Every chunk's region must be referenced.
+	* @param ChunkPositions - The chunk space positions of the chunks.
+	* @param Count - The number of chunks.
+	* @param DataOut - Set to the data of each chunk, empty if it is not on file or larger than Capacity.
+	* @param CodecsOut - To put the FChunkCodec::Codec the data of each chunk is encoded with.
+	* @param Capacity - The largest chunk data in bytes that is read.
 	*/
-	void GetChunkData(const Vector3i& ChunkPosition, std::vector<uint8_t>& DataOut);
+	void GetChunkDataBatch(const Vector3i* ChunkPositions, const uint32_t Count, std::vector<uint8_t>* DataOut, uint8_t* CodecsOut, const uint32_t Capacity);
 
 	/**
-	* Writes data for a chunk within the currently loaded world.
+	* Writes data for a chunk within the currently loaded world. The data
+	* is held in memory until evicted or saved, so the region needn't be
+	* referenced after the call returns.
 	* @param ChunkPosition - The chunk space position of the chunk.
 	* @param Data - Buffer containing chunk data.
+	* @param DataSize - The size of Data in bytes.
+	* @param Codec - The FChunkCodec::Codec the data is encoded with.
+	* @param Occupancy - What the chunk holds, from FChunkOccupancy::Summarize of the data before encoding.
+	* @param IsGenerated - If the data was made by the world generator. Reads from before the write
+	*                      would generate the same data, so the write doesn't change the write count.
+	*/
+	void WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec, const FChunkOccupancy::Entry& Occupancy, const bool IsGenerated = false);
+
+	/**
+	* What a chunk is known to hold. Needs no region reference.
+	* @param ChunkPosition - The chunk space position of the chunk.
 	*/
-	void WriteChunkData(const Vector3i& ChunkPosition, const std::vector<uint8_t>& Data);
+	FChunkOccupancy::Entry GetChunkOccupancy(const Vector3i& ChunkPosition) const { return mOccupancy.Find(ChunkPosition); }
+
+	/**
+	* Records what a chunk read from the world holds.
+	* @param ChunkPosition - The chunk space position of the chunk.
+	* @param Occupancy - What the chunk holds, from FChunkOccupancy::Summarize of its decoded data.
+	*/
+	void SetChunkOccupancy(const Vector3i& ChunkPosition, const FChunkOccupancy::Entry& Occupancy) { mOccupancy.Set(ChunkPosition, Occupancy); }
+
+	/**
+	* The write count of the region of a chunk, changed by each chunk write to the
+	* region, not counting generated chunks. Reads taken at the same count are still
+	* up to date, writes to other regions leave them be.
+	* @param ChunkPosition - The chunk space position of a chunk in the region.
+	*/
+	uint64_t GetWriteCount(const Vector3i& ChunkPosition) const;
 
 private:
 	struct RegionFileRecord
 	{
 		FRegionFile File;
 		uint32_t ReferenceCount;
+		bool IsShadow; // True if File is the writable copy in the temp directory
 	};
 
 	// Hash functor for file table
 	struct Vector3iHash
 	{
-		std::size_t operator()(const Vector3i& Val)
+		std::size_t operator()(const Vector3i& Val) const
 		{
 			return ((Val.x * 73856093) ^ (Val.y * 19349663) ^ (Val.z * 83492791));
 		}
 	};
 
+	/**
+	* Copies a region of the world to the temp directory and reopens its
+	* record on the copy.
+	*/
+	void CreateShadowRegion(const Vector3i& RegionID, RegionFileRecord& Record);
+
+	bool HasShadowRegion(const Vector3i& RegionID) const;
+
+	/**
+	* Writes data for a chunk to its region, which must be referenced.
+	*/
+	void WriteRegionData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec);
+
+	/**
+	* Takes held chunk data out while over the ChunkCache budget, writing dirty data to its region.
+	*/
+	void EvictPayloads();
+
+	/**
+	* Writes every dirty chunk held in memory to its region.
+	*/
+	void FlushPayloads();
+
+	/**
+	* Closes unreferenced regions until at most MaxCount remain open.
+	*/
+	void EvictCachedRegions(const uint32_t MaxCount);
+
 private:
 	std::wstring mWorldName;
+	std::wstring mTempDirectoryName; // Within the worlds directory
 	std::unordered_map<Vector3i, RegionFileRecord, Vector3iHash> mRegionFiles;
+	std::vector<Vector3i> mShadowRegions; // Regions written since the world was set or saved
+	std::list<Vector3i> mCachedRegions;   // Unreferenced open regions, most recently used first
+	FChunkPayloadCache mPayloadCache;     // Chunk data held in front of the regions
+	FChunkOccupancy mOccupancy;           // What each known chunk holds, saved with the world's info
+	std::vector<uint32_t> mBatchMisses;   // Reused by GetChunkDataBatch
+	std::vector<FRegionFile::BatchRead> mBatchReads;
+	std::unordered_map<Vector3i, uint64_t, Vector3iHash> mRegionWriteCounts; // Of regions written since the world was set
+	uint64_t mWriteCount; // Chunk writes across all regions, each region takes the count of its last write
 	uint32_t mWorldSize;
 };
\ No newline at end of file
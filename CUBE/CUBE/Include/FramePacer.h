@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+* Paces the game loop to a target frame rate. Once a frame's work is done
+* the main thread sleeps until shortly before the frame is due, then spins
+* for the rest, as sleeps may wake late. Background work such as chunk mesh
+* swaps and resource uploads is given the time the frame has left after the
+* work that follows it, so it fills idle time instead of lengthening frames.
+*/
+class SFramePacer
+{
+public:
+	SFramePacer() = delete;	// Not meant for instantiation
+
+	/**
+	* Sets the frame rate to pace to.
+	* @param FPS - Frames per second, 0 to run unpaced.
+	*/
+	static void SetTargetFPS(const float FPS);
+
+	static float GetTargetFPS()
+	{
+		return mTargetFPS;
+	}
+
+	/**
+	* Starts timing a frame. Call at the top of the game loop.
+	*/
+	static void BeginFrame();
+
+	/**
+	* Gets when background work of this frame must stop, in system timer cycles.
+	* The budget is the time left in the frame less the smoothed time of the
+	* work after it, and never below a minimum so the work keeps progressing.
+	* Unpaced frames get a fixed budget.
+	*/
+	static uint64_t GetBackgroundDeadline();
+
+	/**
+	* Marks the end of this frame's background work.
+	*/
+	static void EndBackgroundWork();
+
+	/**
+	* Waits until the frame is due. Returns at once when unpaced or late.
+	*/
+	static void EndFrame();
+
+private:
+	static float    mTargetFPS;
+	static uint64_t mTargetCycles;   // Cycles per frame, 0 when unpaced
+	static uint64_t mFrameStart;
+	static uint64_t mBackgroundEnd;
+	static float    mTailTime;       // Smoothed seconds from the end of background work to the end of the frame
+};
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "SFML\Window\Event.hpp"
+
+/**
+* Records the input of each frame to a file and replays it, so sessions
+* can be profiled again with the same input. A frame holds its button,
+* wheel and text events, the mouse delta and the delta and fixed
+* update times, which replace the measured ones on replay. Other
+* window events, such as closing and resizing, are still serviced
+* while replaying. Only used from the main thread.
+*
+* Recordings are kept in memory and written when recording stops,
+* so writing doesn't show up in the frames being recorded.
+*/
+class SInputRecorder
+{
+public:
+	SInputRecorder() = delete;
+	~SInputRecorder() = delete;
+
+	/**
+	* Records the input of every frame from the next one on.
+	* @param Filename - The file written when recording stops.
+	*/
+	static void StartRecording(const wchar_t* Filename);
+
+	/**
+	* Writes the frames recorded so far.
+	* @return False if not recording or the file couldn't be written.
+	*/
+	static bool StopRecording();
+
+	/**
+	* Replays the frames of a recording, in place of the player's input.
+	* @return False if the file couldn't be read or isn't a recording.
+	*/
+	static bool StartReplay(const wchar_t* Filename);
+
+	static void StopReplay();
+
+	/**
+	* Sets what is called after the last recorded frame has been replayed.
+	*/
+	static void SetOnReplayFinished(std::function<void()> OnFinished);
+
+	static bool IsRecording() { return mIsRecording; }
+	static bool IsReplaying() { return mIsReplaying; }
+
+private:
+	friend class FCubeRoot;
+
+	/**
+	* Checks if a window event is input that is recorded.
+	*/
+	static bool IsRecordedEvent(const sf::Event& Event);
+
+	/**
+	* Adds an input event to the frame being recorded.
+	*/
+	static void RecordEvent(const sf::Event& Event);
+
+	/**
+	* Ends the frame being recorded, after its events have been serviced.
+	*/
+	static void RecordFrame();
+
+	/**
+	* Feeds the events of the next recorded frame to the input classes, and
+	* replaces the delta time and mouse delta with the recorded ones.
+	*/
+	static void ReplayFrame();
+
+private:
+	static std::vector<uint8_t>   mData;        // The recording being written or replayed
+	static std::vector<sf::Event> mFrameEvents; // Recorded so far in this frame
+	static std::wstring           mFilename;
+	static std::function<void()>  mOnReplayFinished;
+	static uint32_t               mReadOffset;
+	static uint32_t               mFrameCount;
+	static bool                   mIsRecording;
+	static bool                   mIsReplaying;
+};
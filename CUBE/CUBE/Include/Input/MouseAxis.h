@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <mutex>
 #include "SFML\Window\Event.hpp"
 #include "..\Math\Vector2.h"
 
@@ -50,6 +51,12 @@ public:
 	*/
 	static Vector2i GetDelta();
 
+	/**
+	* Retrieve the total movement of the mouse, including movement
+	* made since the last game frame. Safe to call from any thread.
+	*/
+	static Vector2i GetMovement();
+
 	/**
 	* Retrieve the wheel movement of the mouse
 	* during the last game frame.
@@ -58,6 +65,7 @@ public:
 
 private:
 	friend class FCubeRoot;
+	friend class SInputRecorder;
 
 	/**
 	* Updates mouse movement for the current frame. Upon a new frame
@@ -76,6 +84,12 @@ private:
 	*/
 	static void UpdateDelta();
 
+	/**
+	* Replaces the delta movement of the current frame with a recorded one,
+	* after UpdateDelta. The total movement follows the replaced delta.
+	*/
+	static void ReplayDelta(const Vector2i Delta);
+
 	/**
 	* Resets the mouse movement values from the last frame. This should
 	* be called before updating deltas for the current frame.
@@ -96,6 +110,8 @@ private:
 	static Vector2i     mDefaultMousePosition;
 	static Vector2i     mLastMousePosition;
 	static Vector2i	    mMouseDelta;
+	static Vector2i     mMovement;     // Sum of the deltas of every frame
+	static std::mutex   mMovementMutex; // Guards the last position and movement for GetMovement
 	static sf::Window*  mWindow;
 	static int32_t      mWheelDelta;
 	static bool         mIsLocked;
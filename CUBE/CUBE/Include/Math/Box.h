@@ -18,6 +18,17 @@ struct FBox
 	Vector3f GetCenter() const { return (Min + Max) * 0.5f; }
 
 	void TransformAABB(const FMatrix4& Transform);
+
+	/**
+	* Transforms boxes by a matrix, each into the axis aligned box
+	* enclosing the transformed box. 4 boxes are transformed at once.
+	* @param Transform - The matrix to transform by.
+	* @param Boxes - The boxes to transform.
+	* @param BoxesOut - To put the transformed boxes. May be the same as Boxes.
+	* @param Count - The number of boxes.
+	*/
+	static void TransformAABBs(const FMatrix4& Transform, const FBox* Boxes, FBox* BoxesOut, const uint32_t Count);
+
 	Vector3f GetDimensions() const;
 };
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <intrin.h>
 #include "Vector3.h"
 
 struct FPlane;
@@ -49,6 +50,66 @@ namespace FMath
 		return (Value - MinOriginal) / (MaxOriginal - MinOriginal) * (MaxResult - MinResult) + MinResult;
 	}
 
+	/**
+	* Divides and rounds toward negative infinity, so negative values
+	* fall in the cell below zero.
+	* @param Divisor - Must be positive.
+	*/
+	inline int32_t FloorDivide(const int32_t Value, const int32_t Divisor)
+	{
+		return (Value >= 0) ? Value / Divisor : -((Divisor - 1 - Value) / Divisor);
+	}
+
+	inline Vector3i FloorDivide(const Vector3i& Value, const int32_t Divisor)
+	{
+		return Vector3i{ FloorDivide(Value.x, Divisor), FloorDivide(Value.y, Divisor), FloorDivide(Value.z, Divisor) };
+	}
+
+	/**
+	* The remainder of FloorDivide, always within [0, Divisor).
+	* @param Divisor - Must be positive.
+	*/
+	inline int32_t FloorModulo(const int32_t Value, const int32_t Divisor)
+	{
+		const int32_t Remainder = Value % Divisor;
+		return (Remainder < 0) ? Remainder + Divisor : Remainder;
+	}
+
+	inline Vector3i FloorModulo(const Vector3i& Value, const int32_t Divisor)
+	{
+		return Vector3i{ FloorModulo(Value.x, Divisor), FloorModulo(Value.y, Divisor), FloorModulo(Value.z, Divisor) };
+	}
+
+	/**
+	* The number of bits needed to hold values in [0, Value), so
+	* 1 << CeilLog2(Value) is the smallest power of 2 >= Value.
+	*/
+	inline uint32_t CeilLog2(const uint32_t Value)
+	{
+		uint32_t Bits = 0;
+		while ((1u << Bits) < Value)
+			Bits++;
+
+		return Bits;
+	}
+
+	/**
+	* Retrieves the index of the lowest set bit. Value must not be 0.
+	*/
+	inline int32_t CountTrailingZeros(const uint32_t Value)
+	{
+		unsigned long Index;
+		_BitScanForward(&Index, Value);
+		return (int32_t)Index;
+	}
+
+	// Split in halves, as 32 bit builds have no 64 bit scan
+	inline int32_t CountTrailingZeros(const uint64_t Value)
+	{
+		const uint32_t Low = (uint32_t)Value;
+		return (Low != 0) ? CountTrailingZeros(Low) : 32 + CountTrailingZeros((uint32_t)(Value >> 32));
+	}
+
 	/**
 	* Computes the barycentric coordinates of a point in respect
 	* to a triangle. If the point is outside the bounds of the 
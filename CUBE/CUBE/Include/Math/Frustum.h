@@ -5,6 +5,7 @@
 
 struct FBox;
 struct FSphere;
+struct FMatrix4A;
 
 /**
 * Represents a volume with 6 planes.
@@ -37,6 +38,21 @@ public:
 	FFrustum() = default;
 	~FFrustum() = default;
 
+	/**
+	* Gets the frustum of a projection, in the space the projection takes points from.
+	* @param Matrix - A projection, or a projection combined with a view transform.
+	*/
+	static FFrustum FromMatrix(const FMatrix4& Matrix);
+	static FFrustum FromMatrix(const FMatrix4A& Matrix);
+
+	/**
+	* Gets the frustum of a projection with reversed zero to one depth, see FPerspectiveMatrix.
+	* The far plane of an infinite projection is one no point is behind.
+	* @param Matrix - A projection, or a projection combined with a view transform.
+	*/
+	static FFrustum FromReverseZMatrix(const FMatrix4& Matrix);
+	static FFrustum FromReverseZMatrix(const FMatrix4A& Matrix);
+
 	/**
 	* Set a specific plane in the frustum.
 	*/
@@ -76,6 +92,25 @@ public:
 	*/
 	Intersection IntersectsAABB(const Vector4f& CenterPoint, const Vector3f& Diminsions) const;
 
+	/**
+	* Checks if each aabb in a batch of same sized boxes is visible. Boxes
+	* are tested 4 at a time with SSE.
+	* @param Centers - The center of each box. w is ignored.
+	* @param Count - The number of boxes.
+	* @param HalfExtents - Half the size of every box along each axis.
+	* @param VisibleOut - Location to place 1 for each visible box and 0 for the rest.
+	*/
+	void CullAABBBatch(const Vector4f* Centers, const uint32_t Count, const Vector3f& HalfExtents, uint8_t* VisibleOut) const;
+
+	/**
+	* Checks if each sphere in a batch is visible. Spheres are tested
+	* 4 at a time with SSE.
+	* @param Spheres - The spheres to check.
+	* @param Count - The number of spheres.
+	* @param VisibleOut - Location to place 1 for each visible sphere and 0 for the rest.
+	*/
+	void CullSphereBatch(const FSphere* Spheres, const uint32_t Count, uint8_t* VisibleOut) const;
+
 private:
 	FPlane mPlanes[6];
 };
@@ -133,6 +133,23 @@ struct FMatrix4
 	*/
 	Vector4f TransformVector(const Vector4f& Vector) const;
 
+	/**
+	* Transforms a batch of positions, taking translation into account. Positions are
+	* regrouped by component in registers, 4 at a time with SSE or 8 with AVX.
+	* @param Positions - The positions to transform.
+	* @param PositionsOut - Location to place the transformed positions. May be the same as Positions.
+	* @param Count - The number of positions.
+	*/
+	void TransformPositions(const Vector3f* Positions, Vector3f* PositionsOut, const uint32_t Count) const;
+
+	/**
+	* Transforms a batch of vectors with homogeneous coordinates, 2 at a time with AVX.
+	* @param Vectors - The vectors to transform.
+	* @param VectorsOut - Location to place the transformed vectors. May be the same as Vectors.
+	* @param Count - The number of vectors.
+	*/
+	void TransformVectors(const Vector4f* Vectors, Vector4f* VectorsOut, const uint32_t Count) const;
+
 	/**
 	* Retrieve an axis vector from the matrix.
 	*/
@@ -0,0 +1,265 @@
+#pragma once
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+#include "Vector4A.h"
+#include "Matrix4.h"
+#include "Quaternion.h"
+
+/**
+* A 4x4 column-vector column-major matrix held in 4 SSE registers, one
+* per column. Used for chains of matrix math that would otherwise load and
+* store a FMatrix4 between every step. Matrix-matrix multiplication uses
+* AVX when it is enabled, multiplying two columns at a time.
+*/
+WIN_ALIGN(16)
+struct FMatrix4A
+{
+	ALIGNED_ALLOC(16)
+
+	__m128 Columns[4];
+
+	/**
+	* Constructs identity matrix.
+	*/
+	FMatrix4A();
+
+	/**
+	* Loads a FMatrix4.
+	*/
+	explicit FMatrix4A(const FMatrix4& Matrix);
+
+	/**
+	* Constructs a matrix from its columns.
+	*/
+	FMatrix4A(const FVector4A& Col0, const FVector4A& Col1, const FVector4A& Col2, const FVector4A& Col3);
+
+	/**
+	* Stores the matrix to a FMatrix4.
+	*/
+	void Store(FMatrix4& MatrixOut) const;
+
+	/**
+	* Gets the matrix as a FMatrix4.
+	*/
+	FMatrix4 ToMatrix4() const;
+
+	/**
+	* Gets a column of the matrix.
+	*/
+	FVector4A GetColumn(const uint32_t Col) const { return FVector4A{ Columns[Col] }; }
+
+	/**
+	* Gets the transpose of the matrix.
+	*/
+	FMatrix4A Transpose() const;
+
+	/**
+	* Transforms a vector with homogeneous coordinates.
+	*/
+	FVector4A TransformVector(const FVector4A& Vector) const;
+
+	/**
+	* Transforms a position, taking translation into account. w of the position is ignored.
+	*/
+	FVector4A TransformPosition(const FVector4A& Position) const;
+
+	/**
+	* Transforms a direction without taking translation into account. w of the direction is ignored.
+	*/
+	FVector4A TransformDirection(const FVector4A& Direction) const;
+
+	/**
+	* Calculates the inverse of an affine matrix built by FromScaleRotationTranslation.
+	* The rows of its 3x3 part are orthogonal, so the inverse is the transpose with
+	* each column divided by its squared scale. Axes with a scale of 0 are left at 0.
+	* @param Scale - The scale the matrix was built with.
+	*/
+	FMatrix4A GetInverseScaledAffine(const FVector4A& Scale) const;
+
+	/**
+	* Constructs the rotation matrix of a quaternion.
+	*/
+	static FMatrix4A FromRotation(const FQuaternion& Rotation);
+
+	/**
+	* Constructs a matrix that rotates, then scales along each axis, then translates.
+	* This matches an FMatrix4 scaled, multiplied by the rotation matrix and given an origin.
+	* @param Scale - The scale of each axis. w is ignored.
+	* @param Rotation - The rotation.
+	* @param Translation - The origin of the matrix. w is ignored.
+	*/
+	static FMatrix4A FromScaleRotationTranslation(const FVector4A& Scale, const FQuaternion& Rotation, const FVector4A& Translation);
+};
+
+///////////////////////////////////////////////////////////////////////////
+////////////////// Non Member Functions ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////
+
+inline FMatrix4A operator*(const FMatrix4A& Lhs, const FMatrix4A& Rhs)
+{
+	FMatrix4A Result;
+
+#ifdef __AVX__
+	// Each 256 bit register holds 2 columns of the result. Lhs columns are in both halves,
+	// and the in-lane shuffle replicates the components of both Rhs columns at once.
+	const __m256 L0 = _mm256_broadcast_ps(&Lhs.Columns[0]);
+	const __m256 L1 = _mm256_broadcast_ps(&Lhs.Columns[1]);
+	const __m256 L2 = _mm256_broadcast_ps(&Lhs.Columns[2]);
+	const __m256 L3 = _mm256_broadcast_ps(&Lhs.Columns[3]);
+
+	for (uint32_t Col = 0; Col < 4; Col += 2)
+	{
+		const __m256 R = _mm256_insertf128_ps(_mm256_castps128_ps256(Rhs.Columns[Col]), Rhs.Columns[Col + 1], 1);
+
+		__m256 Sum = _mm256_mul_ps(L0, _mm256_shuffle_ps(R, R, SHUFFLE_PARAM(0, 0, 0, 0)));
+		Sum = _mm256_add_ps(Sum, _mm256_mul_ps(L1, _mm256_shuffle_ps(R, R, SHUFFLE_PARAM(1, 1, 1, 1))));
+		Sum = _mm256_add_ps(Sum, _mm256_mul_ps(L2, _mm256_shuffle_ps(R, R, SHUFFLE_PARAM(2, 2, 2, 2))));
+		Sum = _mm256_add_ps(Sum, _mm256_mul_ps(L3, _mm256_shuffle_ps(R, R, SHUFFLE_PARAM(3, 3, 3, 3))));
+
+		Result.Columns[Col] = _mm256_castps256_ps128(Sum);
+		Result.Columns[Col + 1] = _mm256_extractf128_ps(Sum, 1);
+	}
+#else
+	for (uint32_t Col = 0; Col < 4; Col++)
+	{
+		const __m128 R = Rhs.Columns[Col];
+
+		__m128 Sum = _mm_mul_ps(Lhs.Columns[0], _mm_replicate_x_ps(R));
+		Sum = _mm_madd_ps(Lhs.Columns[1], _mm_replicate_y_ps(R), Sum);
+		Sum = _mm_madd_ps(Lhs.Columns[2], _mm_replicate_z_ps(R), Sum);
+		Sum = _mm_madd_ps(Lhs.Columns[3], _mm_replicate_w_ps(R), Sum);
+
+		Result.Columns[Col] = Sum;
+	}
+#endif
+
+	return Result;
+}
+
+///////////////////////////////////////////////////////////////////////////
+////////////////// Inlined Member Functions ///////////////////////////////
+///////////////////////////////////////////////////////////////////////////
+
+inline FMatrix4A::FMatrix4A()
+{
+	Columns[0] = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+	Columns[1] = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+	Columns[2] = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+	Columns[3] = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline FMatrix4A::FMatrix4A(const FMatrix4& Matrix)
+{
+	// FMatrix4 is 16 byte aligned and column-major, so each column is one load
+	Columns[0] = _mm_load_ps(Matrix.M[0]);
+	Columns[1] = _mm_load_ps(Matrix.M[1]);
+	Columns[2] = _mm_load_ps(Matrix.M[2]);
+	Columns[3] = _mm_load_ps(Matrix.M[3]);
+}
+
+inline FMatrix4A::FMatrix4A(const FVector4A& Col0, const FVector4A& Col1, const FVector4A& Col2, const FVector4A& Col3)
+{
+	Columns[0] = Col0.V;
+	Columns[1] = Col1.V;
+	Columns[2] = Col2.V;
+	Columns[3] = Col3.V;
+}
+
+inline void FMatrix4A::Store(FMatrix4& MatrixOut) const
+{
+	_mm_store_ps(MatrixOut.M[0], Columns[0]);
+	_mm_store_ps(MatrixOut.M[1], Columns[1]);
+	_mm_store_ps(MatrixOut.M[2], Columns[2]);
+	_mm_store_ps(MatrixOut.M[3], Columns[3]);
+}
+
+inline FMatrix4 FMatrix4A::ToMatrix4() const
+{
+	FMatrix4 Matrix;
+	Store(Matrix);
+	return Matrix;
+}
+
+inline FMatrix4A FMatrix4A::Transpose() const
+{
+	FMatrix4A Result{ *this };
+	_MM_TRANSPOSE4_PS(Result.Columns[0], Result.Columns[1], Result.Columns[2], Result.Columns[3]);
+	return Result;
+}
+
+inline FVector4A FMatrix4A::TransformVector(const FVector4A& Vector) const
+{
+	__m128 Sum = _mm_mul_ps(Columns[0], _mm_replicate_x_ps(Vector.V));
+	Sum = _mm_madd_ps(Columns[1], _mm_replicate_y_ps(Vector.V), Sum);
+	Sum = _mm_madd_ps(Columns[2], _mm_replicate_z_ps(Vector.V), Sum);
+	Sum = _mm_madd_ps(Columns[3], _mm_replicate_w_ps(Vector.V), Sum);
+	return FVector4A{ Sum };
+}
+
+inline FVector4A FMatrix4A::TransformPosition(const FVector4A& Position) const
+{
+	__m128 Sum = _mm_madd_ps(Columns[0], _mm_replicate_x_ps(Position.V), Columns[3]);
+	Sum = _mm_madd_ps(Columns[1], _mm_replicate_y_ps(Position.V), Sum);
+	Sum = _mm_madd_ps(Columns[2], _mm_replicate_z_ps(Position.V), Sum);
+	return FVector4A{ Sum };
+}
+
+inline FVector4A FMatrix4A::TransformDirection(const FVector4A& Direction) const
+{
+	__m128 Sum = _mm_mul_ps(Columns[0], _mm_replicate_x_ps(Direction.V));
+	Sum = _mm_madd_ps(Columns[1], _mm_replicate_y_ps(Direction.V), Sum);
+	Sum = _mm_madd_ps(Columns[2], _mm_replicate_z_ps(Direction.V), Sum);
+	return FVector4A{ Sum };
+}
+
+inline FMatrix4A FMatrix4A::GetInverseScaledAffine(const FVector4A& Scale) const
+{
+	// Transpose the 3x3 part, dropping the translation row the transpose brings in
+	FMatrix4A Inverse{ *this };
+	Inverse.Columns[3] = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(Inverse.Columns[0], Inverse.Columns[1], Inverse.Columns[2], Inverse.Columns[3]);
+
+	// The reciprocal squared scale, masked to 0 where the scale is 0
+	const __m128 ScaleSq = _mm_mul_ps(Scale.V, Scale.V);
+	const __m128 InvScaleSq = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), ScaleSq), _mm_cmpneq_ps(ScaleSq, _mm_setzero_ps()));
+
+	Inverse.Columns[0] = _mm_mul_ps(Inverse.Columns[0], _mm_replicate_x_ps(InvScaleSq));
+	Inverse.Columns[1] = _mm_mul_ps(Inverse.Columns[1], _mm_replicate_y_ps(InvScaleSq));
+	Inverse.Columns[2] = _mm_mul_ps(Inverse.Columns[2], _mm_replicate_z_ps(InvScaleSq));
+
+	// Translation is the negated origin taken through the inverse 3x3, with a w of 1
+	const __m128 Origin = Inverse.TransformDirection(FVector4A{ Columns[3] }).V;
+	Inverse.Columns[3] = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), Origin);
+
+	return Inverse;
+}
+
+inline FMatrix4A FMatrix4A::FromRotation(const FQuaternion& Rotation)
+{
+	const float w = Rotation.w, x = Rotation.x, y = Rotation.y, z = Rotation.z;
+
+	return FMatrix4A
+	{
+		FVector4A{ 1 - 2*y*y - 2*z*z, 2*x*y + 2*w*z,     2*x*z - 2*w*y,     0 },
+		FVector4A{ 2*x*y - 2*w*z,     1 - 2*x*x - 2*z*z, 2*y*z + 2*w*x,     0 },
+		FVector4A{ 2*x*z + 2*w*y,     2*y*z - 2*w*x,     1 - 2*x*x - 2*y*y, 0 },
+		FVector4A{ 0,                 0,                 0,                 1 }
+	};
+}
+
+inline FMatrix4A FMatrix4A::FromScaleRotationTranslation(const FVector4A& Scale, const FQuaternion& Rotation, const FVector4A& Translation)
+{
+	// Scaling after rotating scales each row of the rotation, the same for every column
+	FMatrix4A Matrix = FromRotation(Rotation);
+	const __m128 RowScale = Scale.WithW(0.0f).V;
+
+	Matrix.Columns[0] = _mm_mul_ps(Matrix.Columns[0], RowScale);
+	Matrix.Columns[1] = _mm_mul_ps(Matrix.Columns[1], RowScale);
+	Matrix.Columns[2] = _mm_mul_ps(Matrix.Columns[2], RowScale);
+	Matrix.Columns[3] = Translation.WithW(1.0f).V;
+
+	return Matrix;
+}
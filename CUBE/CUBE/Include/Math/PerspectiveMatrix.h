@@ -2,8 +2,13 @@
 #include "..\Common.h"
 #include "Matrix4.h"
 
+#include <limits>
+
 /**
-* An OpenGL perspective matrix.
+* An OpenGL perspective matrix, with reversed depth. The near plane maps to a
+* depth of 1 and the far plane to 0, for clip control's zero to one depth range,
+* so depth precision is spread evenly over the view instead of bunched at the
+* near plane. Depth tests pass on greater depths.
 */
 WIN_ALIGN(16)
 class FPerspectiveMatrix : public FMatrix4
@@ -30,12 +35,32 @@ public:
 	*/
 	FPerspectiveMatrix(const float Aspect, const float HalfFOV, const float Near, const float Far);
 
+	/**
+	* Ctor
+	* Construct a perspective matrix with the far plane at infinity. Depth nears 0 with distance
+	* but never reaches it, so nothing is clipped however far away.
+	* @param Aspect - The aspect ratio of the view.
+	* @param HalfFOV - Half of the camera horizontal FOV
+	* @param Near - Distance to the near plane
+	*/
+	FPerspectiveMatrix(const float Aspect, const float HalfFOV, const float Near);
+
 	~FPerspectiveMatrix() = default;
 
 	/**
 	* Copy conversion with standard matrix class.
 	*/
 	FPerspectiveMatrix& operator=(const FMatrix4& Other);
+
+	/**
+	* Gets the distance to the near plane of a perspective matrix.
+	*/
+	static float GetNear(const FMatrix4& Projection);
+
+	/**
+	* Gets the distance to the far plane of a perspective matrix, infinity for infinite ones.
+	*/
+	static float GetFar(const FMatrix4& Projection);
 };
 
 inline FPerspectiveMatrix::FPerspectiveMatrix(const float Width, const float Height, const float HalfFOV, const float Near, const float Far)
@@ -49,7 +74,19 @@ inline FPerspectiveMatrix::FPerspectiveMatrix(const float Aspect, const float Ha
 	*this = FMatrix4{
 		1.0f / (Aspect * TanHalfFOV), 0, 0, 0,
 		0, 1.0f / TanHalfFOV, 0, 0,
-		0, 0, ((Far + Near) / (Near - Far)), ((2 * Far * Near) / (Near - Far)),
+		0, 0, (Near / (Far - Near)), ((Far * Near) / (Far - Near)),
+		0, 0, -1, 0
+	};
+}
+
+inline FPerspectiveMatrix::FPerspectiveMatrix(const float Aspect, const float HalfFOV, const float Near)
+{
+	// The limit of the finite matrix as Far goes to infinity
+	const float TanHalfFOV = tan(FMath::ToRadians(HalfFOV));
+	*this = FMatrix4{
+		1.0f / (Aspect * TanHalfFOV), 0, 0, 0,
+		0, 1.0f / TanHalfFOV, 0, 0,
+		0, 0, 0, Near,
 		0, 0, -1, 0
 	};
 }
@@ -66,4 +103,16 @@ inline FPerspectiveMatrix& FPerspectiveMatrix::operator=(const FMatrix4& Other)
 	}
 
 	return *this;
+}
+
+inline float FPerspectiveMatrix::GetNear(const FMatrix4& Projection)
+{
+	// Distance is M[3][2] / (Depth + M[2][2]), the near plane is at a depth of 1
+	return Projection.M[3][2] / (1.0f + Projection.M[2][2]);
+}
+
+inline float FPerspectiveMatrix::GetFar(const FMatrix4& Projection)
+{
+	// And the far plane at 0
+	return Projection.M[2][2] > 0.0f ? Projection.M[3][2] / Projection.M[2][2] : std::numeric_limits<float>::infinity();
 }
\ No newline at end of file
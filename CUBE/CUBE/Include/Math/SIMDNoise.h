@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+* Fractal gradient noise evaluated for 4 points at a time with SSE2. The
+* noise follows LibNoise's Perlin module, including its lattice hashing
+* and gradient table, so a module graph of a single Perlin module is
+* matched to within float precision.
+*/
+class FSIMDNoise
+{
+public:
+	static const uint32_t LANE_COUNT = 4;
+
+	/**
+	* Interpolation used between lattice points, matching noise::NoiseQuality.
+	*/
+	enum Quality : uint8_t
+	{
+		Fast = 0, // Linear
+		Standard, // Cubic s-curve
+		Best      // Quintic s-curve
+	};
+
+	/**
+	* Fractal noise parameters, matching those of noise::module::Perlin.
+	*/
+	struct Parameters
+	{
+		float   Frequency;
+		float   Lacunarity;
+		float   Persistence;
+		int32_t OctaveCount;
+		int32_t Seed;
+		Quality NoiseQuality;
+	};
+
+public:
+	/**
+	* Ctor
+	* Uses the default parameters of noise::module::Perlin.
+	*/
+	FSIMDNoise();
+
+	explicit FSIMDNoise(const Parameters& NoiseParameters);
+
+	void SetParameters(const Parameters& NoiseParameters) { mParameters = NoiseParameters; }
+
+	const Parameters& GetParameters() const { return mParameters; }
+
+	/**
+	* Evaluates the noise at LANE_COUNT points.
+	* @param X, Y, Z - Coordinates of each point.
+	* @param ValuesOut - To put the noise value of each point.
+	*/
+	void GetValues(const float* X, const float* Y, const float* Z, float* ValuesOut) const;
+
+	/**
+	* Evaluates the noise at evenly spaced points along x.
+	* @param X - The x coordinate of the first point.
+	* @param XStep - The distance between points.
+	* @param Y, Z - The coordinates shared by all points.
+	* @param Count - The number of points.
+	* @param ValuesOut - To put Count noise values.
+	*/
+	void GetRow(const double X, const double XStep, const double Y, const double Z, const uint32_t Count, float* ValuesOut) const;
+
+private:
+	Parameters mParameters;
+};
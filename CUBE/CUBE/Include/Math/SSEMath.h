@@ -53,6 +53,27 @@ __forceinline void MultVectorMatrix(const float* Matrix4, const float* Vector4,
 	StoreVector(ResultOut, Mult);
 }
 
+/**
+* Regroups 4 packed 3 component vectors, loaded as 3 registers of x0 y0 z0 x1,
+* y1 z1 x2 y2 and z2 x3 y3 z3, into a register for each component.
+*/
+__forceinline void DeinterleaveVector3(const __m128 A, const __m128 B, const __m128 C, __m128& X, __m128& Y, __m128& Z)
+{
+	X = _mm_shuffle_ps(A, _mm_shuffle_ps(B, C, SHUFFLE_PARAM(2, 2, 1, 1)), SHUFFLE_PARAM(0, 3, 0, 2));
+	Y = _mm_shuffle_ps(_mm_shuffle_ps(A, B, SHUFFLE_PARAM(1, 1, 0, 0)), _mm_shuffle_ps(B, C, SHUFFLE_PARAM(3, 3, 2, 2)), SHUFFLE_PARAM(0, 2, 0, 2));
+	Z = _mm_shuffle_ps(_mm_shuffle_ps(A, B, SHUFFLE_PARAM(2, 2, 1, 1)), _mm_shuffle_ps(C, C, SHUFFLE_PARAM(0, 0, 3, 3)), SHUFFLE_PARAM(0, 2, 0, 2));
+}
+
+/**
+* Packs a register for each component back into 4 3 component vectors, the reverse of DeinterleaveVector3.
+*/
+__forceinline void InterleaveVector3(const __m128 X, const __m128 Y, const __m128 Z, __m128& A, __m128& B, __m128& C)
+{
+	A = _mm_shuffle_ps(_mm_shuffle_ps(X, Y, SHUFFLE_PARAM(0, 0, 0, 0)), _mm_shuffle_ps(Z, X, SHUFFLE_PARAM(0, 0, 1, 1)), SHUFFLE_PARAM(0, 2, 0, 2));
+	B = _mm_shuffle_ps(_mm_shuffle_ps(Y, Z, SHUFFLE_PARAM(1, 1, 1, 1)), _mm_shuffle_ps(X, Y, SHUFFLE_PARAM(2, 2, 2, 2)), SHUFFLE_PARAM(0, 2, 0, 2));
+	C = _mm_shuffle_ps(_mm_shuffle_ps(Z, X, SHUFFLE_PARAM(2, 2, 3, 3)), _mm_shuffle_ps(Y, Z, SHUFFLE_PARAM(3, 3, 3, 3)), SHUFFLE_PARAM(0, 2, 0, 2));
+}
+
 /**
 * Converts 4 32-bit floating-point values to 4 32-bit 
 * integers.
@@ -2,13 +2,20 @@
 
 #include "Vector3.h"
 #include "Quaternion.h"
+#include "Matrix4.h"
+#include "Memory\MemoryUtil.h"
 
 /**
 * Class for representing 3D spatial information for an object.
+* The local and local-to-world matrices are cached by UpdateMatrices and
+* used until this transform or one of its parents changes. Getters only
+* read the caches, so they can be called from several threads.
 */
+WIN_ALIGN(16)
 class FTransform
 {
 public:
+	ALIGNED_ALLOC(16)
 
 	/**
 	* Ctor
@@ -33,13 +40,13 @@ public:
 	FTransform& operator=(const FTransform& Other);
 
 	/**
-	* Constructs a matrix that will transform local coordinates
+	* Get the matrix that will transform local coordinates
 	* to world coordinates.
 	*/
 	FMatrix4 LocalToWorldMatrix() const;
 
 	/**
-	* Constructs a matrix that will transform world coordinates
+	* Get the matrix that will transform world coordinates
 	* to local coordinates of this transform.
 	*/
 	FMatrix4 WorldToLocalMatrix() const;
@@ -101,11 +108,47 @@ public:
 	*/
 	FTransform* GetParent() const;
 
+	/**
+	* Get a count that changes whenever this transform, or one of
+	* its parents, is changed. Used to cache data derived from it.
+	*/
+	uint32_t GetRevision() const;
+
+	/**
+	* Rebuilds the cached matrices that are out of date. The parent must be
+	* updated first. No other thread may read this transform meanwhile.
+	*/
+	void UpdateMatrices();
+
 private:
+	/**
+	* Marks the transform as changed with a revision no transform has had yet.
+	*/
+	void MarkChanged();
+
+	/**
+	* Get a revision higher than any handed out before.
+	*/
+	static uint32_t NewRevision();
+
+	/**
+	* Get the matrix from scale, rotation and translation, relative to the parent.
+	*/
+	FMatrix4 LocalMatrix() const;
+
+private:
+	// Cached matrices, each valid while its revision matches. Stale ones are
+	// built into a copy on each call until the next UpdateMatrices.
+	FMatrix4 mLocal;
+	FMatrix4 mLocalToWorld;
+	uint32_t mLocalRevision;
+	uint32_t mLocalToWorldRevision;
+
 	FQuaternion mRotation;
 	Vector3f mTranslation;
 	Vector3f mScale;
 	FTransform* mParent;
+	uint32_t mRevision;
 };
 
 #include "Transform.inl"
\ No newline at end of file
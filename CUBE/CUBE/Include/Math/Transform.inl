@@ -5,18 +5,28 @@
 //////////////////////////////////////////////////////////////////////////////////////
 
 inline FTransform::FTransform(const Vector3f& Position, const float Scale)
-	: mTranslation(Position)
+	: mLocal()
+	, mLocalToWorld()
+	, mLocalRevision(0)
+	, mLocalToWorldRevision(0)
+	, mTranslation(Position)
 	, mRotation()
 	, mScale(Scale, Scale, Scale)
 	, mParent(nullptr)
+	, mRevision(NewRevision())
 {
 }
 
 inline FTransform::FTransform(const FTransform& Other)
-	: mTranslation(Other.mTranslation)
+	: mLocal()
+	, mLocalToWorld()
+	, mLocalRevision(0)
+	, mLocalToWorldRevision(0)
+	, mTranslation(Other.mTranslation)
 	, mRotation(Other.mRotation)
 	, mScale(Other.mScale)
 	, mParent(Other.mParent)
+	, mRevision(NewRevision())
 {
 }
 
@@ -26,6 +36,7 @@ inline FTransform& FTransform::operator=(const FTransform& Other)
 	mRotation = Other.mRotation;
 	mScale = Other.mScale;
 	mParent = Other.mParent;
+	MarkChanged();
 
 	return *this;
 }
@@ -33,6 +44,7 @@ inline FTransform& FTransform::operator=(const FTransform& Other)
 inline void FTransform::SetLocalPosition(const Vector3f& NewPosition)
 {
 	mTranslation = NewPosition;
+	MarkChanged();
 }
 
 inline Vector3f FTransform::GetLocalPosition() const
@@ -43,11 +55,13 @@ inline Vector3f FTransform::GetLocalPosition() const
 inline void FTransform::Translate(const Vector3f& Translation)
 {
 	mTranslation += (mRotation * Translation);
+	MarkChanged();
 }
 
 inline void FTransform::SetRotation(const FQuaternion& NewRotation)
 {
 	mRotation = NewRotation;
+	MarkChanged();
 }
 
 inline FQuaternion FTransform::GetRotation() const
@@ -58,11 +72,13 @@ inline FQuaternion FTransform::GetRotation() const
 inline void FTransform::Rotate(const FQuaternion& Rotation)
 {
 	mRotation *= Rotation;
+	MarkChanged();
 }
 
 inline void FTransform::SetScale(const Vector3f NewScale)
 {
 	mScale = NewScale;
+	MarkChanged();
 }
 
 inline Vector3f FTransform::GetScale() const
@@ -73,6 +89,7 @@ inline Vector3f FTransform::GetScale() const
 inline void FTransform::SetParent(FTransform* NewParent)
 {
 	mParent = NewParent;
+	MarkChanged();
 }
 
 inline FTransform* FTransform::GetParent() const
@@ -80,6 +97,21 @@ inline FTransform* FTransform::GetParent() const
 	return mParent;
 }
 
+inline uint32_t FTransform::GetRevision() const
+{
+	// Every change takes a revision higher than all before, so the highest changes with any of them
+	if (!mParent)
+		return mRevision;
+
+	const uint32_t ParentRevision = mParent->GetRevision();
+	return ParentRevision > mRevision ? ParentRevision : mRevision;
+}
+
+inline void FTransform::MarkChanged()
+{
+	mRevision = NewRevision();
+}
+
 
 //////////////////////////////////////////////////////////////////////////////////////
 ////////////////////// Non-Member Functions //////////////////////////////////////////
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "SystemMath.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Memory\MemoryUtil.h"
+
+/**
+* A 4 component float vector held in an SSE register. Operations
+* return new registers, so chained math stays out of memory until
+* the result is stored back to a Vector3f or Vector4f.
+*/
+WIN_ALIGN(16)
+struct FVector4A
+{
+	ALIGNED_ALLOC(16)
+
+	__m128 V;
+
+	/**
+	* Constructs a zero vector.
+	*/
+	FVector4A();
+
+	/**
+	* Constructs a vector from a register.
+	*/
+	explicit FVector4A(const __m128 Register);
+
+	/**
+	* Constructs vector with x, y, z, w components.
+	*/
+	FVector4A(const float X, const float Y, const float Z, const float W);
+
+	/**
+	* Constructs a vector from the components of a Vector3f.
+	* @param Vector - The x, y, z components.
+	* @param W - The fourth component.
+	*/
+	FVector4A(const Vector3f& Vector, const float W);
+
+	/**
+	* Loads a Vector4f. Vector4f is 16 byte aligned, so this is a single load.
+	*/
+	explicit FVector4A(const Vector4f& Vector);
+
+	/**
+	* Constructs a vector with every component set to a value.
+	*/
+	static FVector4A Replicate(const float Value);
+
+	/**
+	* Loads 4 floats from 16 byte aligned memory.
+	*/
+	static FVector4A Load(const float* Memory);
+
+	/**
+	* Stores the vector to 16 byte aligned memory.
+	*/
+	void Store(float* MemoryOut) const;
+
+	/**
+	* Gets the x, y, z components.
+	*/
+	Vector3f ToVector3() const;
+
+	/**
+	* Gets all 4 components.
+	*/
+	Vector4f ToVector4() const;
+
+	/**
+	* Gets the first component.
+	*/
+	float GetX() const;
+
+	/**
+	* Gets a vector with every component set to one component of this vector.
+	*/
+	FVector4A ReplicateX() const;
+	FVector4A ReplicateY() const;
+	FVector4A ReplicateZ() const;
+	FVector4A ReplicateW() const;
+
+	/**
+	* Gets the vector with w set to a value.
+	*/
+	FVector4A WithW(const float W) const;
+
+	/**
+	* Gets the length of the x, y, z components, in every component.
+	*/
+	FVector4A Length3() const;
+
+	/**
+	* Gets the vector scaled so x, y, z are unit length.
+	*/
+	FVector4A Normalize3() const;
+
+	/**
+	* Gets the dot product of the x, y, z components, in every component.
+	*/
+	static FVector4A Dot3(const FVector4A& Lhs, const FVector4A& Rhs);
+
+	/**
+	* Gets the dot product of all 4 components, in every component.
+	*/
+	static FVector4A Dot4(const FVector4A& Lhs, const FVector4A& Rhs);
+
+	/**
+	* Gets the cross product of the x, y, z components. w is 0.
+	*/
+	static FVector4A Cross(const FVector4A& Lhs, const FVector4A& Rhs);
+
+	/**
+	* Computes A * B + C.
+	*/
+	static FVector4A MultiplyAdd(const FVector4A& A, const FVector4A& B, const FVector4A& C);
+
+	/**
+	* Component-wise minimum, maximum and absolute value.
+	*/
+	static FVector4A Min(const FVector4A& Lhs, const FVector4A& Rhs);
+	static FVector4A Max(const FVector4A& Lhs, const FVector4A& Rhs);
+	static FVector4A Abs(const FVector4A& Vector);
+};
+
+/////////////////////////////////////////////////////
+//////////// Inlined Non-Member Functions ///////////
+/////////////////////////////////////////////////////
+
+inline FVector4A operator+(const FVector4A& Lhs, const FVector4A& Rhs)
+{
+	return FVector4A{ _mm_add_ps(Lhs.V, Rhs.V) };
+}
+
+inline FVector4A operator-(const FVector4A& Lhs, const FVector4A& Rhs)
+{
+	return FVector4A{ _mm_sub_ps(Lhs.V, Rhs.V) };
+}
+
+inline FVector4A operator*(const FVector4A& Lhs, const FVector4A& Rhs)
+{
+	return FVector4A{ _mm_mul_ps(Lhs.V, Rhs.V) };
+}
+
+inline FVector4A operator/(const FVector4A& Lhs, const FVector4A& Rhs)
+{
+	return FVector4A{ _mm_div_ps(Lhs.V, Rhs.V) };
+}
+
+inline FVector4A operator*(const FVector4A& Lhs, const float Scalar)
+{
+	return FVector4A{ _mm_mul_ps(Lhs.V, _mm_set1_ps(Scalar)) };
+}
+
+inline FVector4A operator*(const float Scalar, const FVector4A& Rhs)
+{
+	return Rhs * Scalar;
+}
+
+inline FVector4A operator-(const FVector4A& Vector)
+{
+	return FVector4A{ _mm_sub_ps(_mm_setzero_ps(), Vector.V) };
+}
+
+/////////////////////////////////////////////////////
+//////////// Inlined Member Functions ///////////////
+/////////////////////////////////////////////////////
+
+inline FVector4A::FVector4A()
+	: V(_mm_setzero_ps())
+{
+}
+
+inline FVector4A::FVector4A(const __m128 Register)
+	: V(Register)
+{
+}
+
+inline FVector4A::FVector4A(const float X, const float Y, const float Z, const float W)
+	: V(_mm_setr_ps(X, Y, Z, W))
+{
+}
+
+inline FVector4A::FVector4A(const Vector3f& Vector, const float W)
+	: V(_mm_setr_ps(Vector.x, Vector.y, Vector.z, W))
+{
+}
+
+inline FVector4A::FVector4A(const Vector4f& Vector)
+	: V(_mm_load_ps(&Vector.x))
+{
+}
+
+inline FVector4A FVector4A::Replicate(const float Value)
+{
+	return FVector4A{ _mm_set1_ps(Value) };
+}
+
+inline FVector4A FVector4A::Load(const float* Memory)
+{
+	return FVector4A{ _mm_load_ps(Memory) };
+}
+
+inline void FVector4A::Store(float* MemoryOut) const
+{
+	_mm_store_ps(MemoryOut, V);
+}
+
+inline Vector3f FVector4A::ToVector3() const
+{
+	WIN_ALIGN(16) float Components[4];
+	_mm_store_ps(Components, V);
+	return Vector3f{ Components[0], Components[1], Components[2] };
+}
+
+inline Vector4f FVector4A::ToVector4() const
+{
+	Vector4f Vector;
+	_mm_store_ps(&Vector.x, V);
+	return Vector;
+}
+
+inline float FVector4A::GetX() const
+{
+	return _mm_cvtss_f32(V);
+}
+
+inline FVector4A FVector4A::ReplicateX() const
+{
+	return FVector4A{ _mm_replicate_x_ps(V) };
+}
+
+inline FVector4A FVector4A::ReplicateY() const
+{
+	return FVector4A{ _mm_replicate_y_ps(V) };
+}
+
+inline FVector4A FVector4A::ReplicateZ() const
+{
+	return FVector4A{ _mm_replicate_z_ps(V) };
+}
+
+inline FVector4A FVector4A::ReplicateW() const
+{
+	return FVector4A{ _mm_replicate_w_ps(V) };
+}
+
+inline FVector4A FVector4A::WithW(const float W) const
+{
+	// Move W into the first lane of the z, w pair, then shuffle it into place
+	const __m128 ZW = _mm_shuffle_ps(V, _mm_set_ss(W), SHUFFLE_PARAM(2, 2, 0, 0));
+	return FVector4A{ _mm_shuffle_ps(V, ZW, SHUFFLE_PARAM(0, 1, 0, 2)) };
+}
+
+inline FVector4A FVector4A::Length3() const
+{
+	return FVector4A{ _mm_sqrt_ps(Dot3(*this, *this).V) };
+}
+
+inline FVector4A FVector4A::Normalize3() const
+{
+	return *this / Length3();
+}
+
+inline FVector4A FVector4A::Dot3(const FVector4A& Lhs, const FVector4A& Rhs)
+{
+	const __m128 Mult = _mm_mul_ps(Lhs.V, Rhs.V);
+	const __m128 Sum = _mm_add_ps(_mm_replicate_x_ps(Mult), _mm_add_ps(_mm_replicate_y_ps(Mult), _mm_replicate_z_ps(Mult)));
+	return FVector4A{ Sum };
+}
+
+inline FVector4A FVector4A::Dot4(const FVector4A& Lhs, const FVector4A& Rhs)
+{
+	// Add the halves, then the pairs, leaving the sum in every component
+	const __m128 Mult = _mm_mul_ps(Lhs.V, Rhs.V);
+	const __m128 Halves = _mm_add_ps(Mult, _mm_shuffle_ps(Mult, Mult, SHUFFLE_PARAM(2, 3, 0, 1)));
+	return FVector4A{ _mm_add_ps(Halves, _mm_shuffle_ps(Halves, Halves, SHUFFLE_PARAM(1, 0, 3, 2))) };
+}
+
+inline FVector4A FVector4A::Cross(const FVector4A& Lhs, const FVector4A& Rhs)
+{
+	// Lhs.yzx * Rhs.zxy - Lhs.zxy * Rhs.yzx, w of both products cancels to 0
+	const __m128 LhsYZX = _mm_shuffle_ps(Lhs.V, Lhs.V, SHUFFLE_PARAM(1, 2, 0, 3));
+	const __m128 RhsYZX = _mm_shuffle_ps(Rhs.V, Rhs.V, SHUFFLE_PARAM(1, 2, 0, 3));
+	const __m128 Diff = _mm_sub_ps(_mm_mul_ps(Lhs.V, RhsYZX), _mm_mul_ps(LhsYZX, Rhs.V));
+	return FVector4A{ _mm_shuffle_ps(Diff, Diff, SHUFFLE_PARAM(1, 2, 0, 3)) };
+}
+
+inline FVector4A FVector4A::MultiplyAdd(const FVector4A& A, const FVector4A& B, const FVector4A& C)
+{
+	return FVector4A{ _mm_madd_ps(A.V, B.V, C.V) };
+}
+
+inline FVector4A FVector4A::Min(const FVector4A& Lhs, const FVector4A& Rhs)
+{
+	return FVector4A{ _mm_min_ps(Lhs.V, Rhs.V) };
+}
+
+inline FVector4A FVector4A::Max(const FVector4A& Lhs, const FVector4A& Rhs)
+{
+	return FVector4A{ _mm_max_ps(Lhs.V, Rhs.V) };
+}
+
+inline FVector4A FVector4A::Abs(const FVector4A& Vector)
+{
+	// Clear the sign bits
+	return FVector4A{ _mm_andnot_ps(_mm_set1_ps(-0.0f), Vector.V) };
+}
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include "Misc/Assertions.h"
+#include "MemoryUtil.h"
+#include "PageSource.h"
+
+#include <algorithm>
+#include <vector>
+
+#undef min
+
+/**
+* Gives each thread a small number of its own, so concurrent pools can
+* pick a cache for it out of a fixed array.
+*/
+class SPoolThreadSlot
+{
+public:
+	/**
+	* Retrieves the slot of the calling thread, assigned the first time it asks.
+	*/
+	static uint32_t Get();
+
+private:
+	SPoolThreadSlot() = delete;	// Not meant for instantiation
+};
+
+template <uint32_t ElementSize, uint32_t PageSize, typename PageSourceType = FHeapPageSource>
+/**
+* Pool allocator that may be used from several threads at once. Each thread
+* allocates from and frees into a small cache of its own, which is refilled
+* from and drained into a shared free list in batches. The shared list is a
+* lock-free stack whose head is tagged with a count of its changes, so a
+* thread can't swap in a stale head after other threads pop and push the
+* same element (the ABA problem). Only growing the pool takes a lock.
+* On destruction of this object, all allocations need to be freed back into
+* the pool with FConcurrentPoolAllocator::Free.
+* \n
+* @param ElementSize The size of each allocation object.
+* @param PageSize The number of objects added each time the pool grows.
+* @param PageSourceType Where pages come from, FVirtualPageSource for large pools accessed at random.
+*/
+class FConcurrentPoolAllocator
+{
+public:
+	/**
+	* Ctor
+	* Constructs an empty pool allocator with specified alignment.
+	* @param Alignment for each allocation
+	* @param MaxSize The max number of objects contained in the pool.
+	*/
+	FConcurrentPoolAllocator(uint32_t Alignment, uint32_t MaxSize = UINT32_MAX)
+		: mFreeHead(0)
+		, mObjectsConstructed(0)
+		, mPageSource()
+		, mPages()
+		, mGrowMutex()
+		, mMaxSize(MaxSize)
+		, mAlignment(std::max(Alignment, (uint32_t)__alignof(PoolElement)))
+	{
+		ASSERT(0 < PageSize && "PageSize must be larger that 0");
+		ASSERT(ElementSize >= sizeof(PoolElement) && "ElementSize must at least the size of a standard pointer type.");
+
+		for (ThreadCache& Cache : mCaches)
+		{
+			Cache.IsLocked = false;
+			Cache.Count = 0;
+		}
+	}
+
+	~FConcurrentPoolAllocator()
+	{
+		ASSERT(mObjectsConstructed == 0 && "All objects should be back in the pool on destruction.");
+
+		for (uint8_t* Page : mPages)
+			mPageSource.Free(Page);
+	}
+
+	/**
+	* Allocate a new element from the memory pool.
+	* If the memory pool is full, nullptr is returned.
+	*/
+	void* Allocate()
+	{
+		ThreadCache& Cache = LockCache();
+		if (Cache.Count == 0)
+			Refill(Cache);
+
+		void* Memory = nullptr;
+		if (Cache.Count > 0)
+		{
+			Memory = Cache.Elements[--Cache.Count];
+			mObjectsConstructed.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		Cache.IsLocked.store(false, std::memory_order_release);
+		return Memory;
+	}
+
+	/**
+	* Release an object back into the memory pool, from any thread.
+	*/
+	void Free(void* Data)
+	{
+		ASSERT(mObjectsConstructed > 0);
+		mObjectsConstructed.fetch_sub(1, std::memory_order_relaxed);
+
+		ThreadCache& Cache = LockCache();
+		if (Cache.Count == CACHE_SIZE)
+			Drain(Cache, CACHE_SIZE / 2);
+
+		Cache.Elements[Cache.Count++] = (PoolElement*)Data;
+		Cache.IsLocked.store(false, std::memory_order_release);
+	}
+
+	/**
+	* Sets the max number of objects that can be allocated from the
+	* pool. Pages that have already been added are kept.
+	*/
+	void SetMaxSize(uint32_t MaxSize)
+	{
+		std::lock_guard<std::mutex> Lock(mGrowMutex);
+		mMaxSize = MaxSize;
+	}
+
+	/**
+	* Gets the max number of objects that can be
+	* allocated from the pool.
+	*/
+	uint32_t Capacity() const
+	{
+		return mMaxSize;
+	}
+
+	/**
+	* Returns the number of objects in the pool
+	* that are constructed.
+	*/
+	uint32_t Size() const
+	{
+		return mObjectsConstructed.load(std::memory_order_relaxed);
+	}
+
+private:
+	// Disable copy ctor and copy assignment
+	FConcurrentPoolAllocator(const FConcurrentPoolAllocator& Other) = delete;
+	FConcurrentPoolAllocator& operator=(const FConcurrentPoolAllocator& Other) = delete;
+
+	struct PoolElement
+	{
+		PoolElement* Next{nullptr};
+	};
+
+	static const uint32_t CACHE_COUNT = 16;  // Threads past this many share caches
+	static const uint32_t CACHE_SIZE = 32;   // Elements each cache holds
+	static const uint32_t REFILL_SIZE = 16;  // Elements moved from the shared list at a time
+
+	// Pointers fit below the tag, user space addresses on 64-bit Windows take 47 bits
+	static const uint32_t TAG_SHIFT = sizeof(void*) == 4 ? 32 : 48;
+
+	struct ThreadCache
+	{
+		std::atomic<bool> IsLocked;
+		uint32_t          Count;
+		PoolElement*      Elements[CACHE_SIZE];
+	};
+
+	static PoolElement* HeadElement(const uint64_t Head)
+	{
+		return (PoolElement*)(uintptr_t)(Head & ((uint64_t(1) << TAG_SHIFT) - 1));
+	}
+
+	static uint64_t MakeHead(const PoolElement* Element, const uint64_t PreviousHead)
+	{
+		const uint64_t Tag = (PreviousHead >> TAG_SHIFT) + 1;
+		return (Tag << TAG_SHIFT) | (uint64_t)(uintptr_t)Element;
+	}
+
+	/**
+	* Locks the cache of the calling thread. It is only contended when
+	* more threads than caches use the pool.
+	*/
+	ThreadCache& LockCache()
+	{
+		ThreadCache& Cache = mCaches[SPoolThreadSlot::Get() % CACHE_COUNT];
+		while (Cache.IsLocked.exchange(true, std::memory_order_acquire))
+			;
+
+		return Cache;
+	}
+
+	/**
+	* Pops an element off the shared free list.
+	* @return The element, or null if the list is empty.
+	*/
+	PoolElement* PopShared()
+	{
+		uint64_t Head = mFreeHead.load(std::memory_order_acquire);
+		while (PoolElement* Element = HeadElement(Head))
+		{
+			// Another thread may pop and reuse the element meanwhile, then Next is garbage but the tag has
+			// changed and this fails. Pages are only freed with the pool, so the read itself is safe.
+			if (mFreeHead.compare_exchange_weak(Head, MakeHead(Element->Next, Head), std::memory_order_acq_rel, std::memory_order_acquire))
+				return Element;
+		}
+
+		return nullptr;
+	}
+
+	/**
+	* Pushes a linked chain of elements onto the shared free list at once.
+	*/
+	void PushShared(PoolElement* First, PoolElement* Last)
+	{
+		uint64_t Head = mFreeHead.load(std::memory_order_relaxed);
+		do
+		{
+			Last->Next = HeadElement(Head);
+		} while (!mFreeHead.compare_exchange_weak(Head, MakeHead(First, Head), std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	/**
+	* Fills an empty cache from the shared free list, growing the pool if the list is empty.
+	*/
+	void Refill(ThreadCache& Cache)
+	{
+		while (Cache.Count < REFILL_SIZE)
+		{
+			PoolElement* Element = PopShared();
+			if (!Element)
+				break;
+
+			Cache.Elements[Cache.Count++] = Element;
+		}
+
+		if (Cache.Count == 0)
+			AddPage(Cache);
+	}
+
+	/**
+	* Moves elements from a cache to the shared free list.
+	*/
+	void Drain(ThreadCache& Cache, const uint32_t Count)
+	{
+		PoolElement* First = Cache.Elements[Cache.Count - 1];
+		PoolElement* Last = First;
+		for (uint32_t i = 1; i < Count; i++)
+		{
+			PoolElement* Element = Cache.Elements[Cache.Count - 1 - i];
+			Last->Next = Element;
+			Last = Element;
+		}
+
+		Cache.Count -= Count;
+		PushShared(First, Last);
+	}
+
+	/**
+	* Adds a page of elements, filling a cache and pushing the rest to the shared free list.
+	* Does nothing if the pool is at its max size or out of memory.
+	*/
+	void AddPage(ThreadCache& Cache)
+	{
+		std::lock_guard<std::mutex> Lock(mGrowMutex);
+
+		// Another thread may have grown the pool while this one waited
+		if (PoolElement* Element = PopShared())
+		{
+			Cache.Elements[Cache.Count++] = Element;
+			return;
+		}
+
+		const uint32_t PoolSize = mPages.size() * PageSize;
+		if (PoolSize >= mMaxSize)
+			return;
+
+		// The byte gap between each allocation
+		const uint32_t BlockGap = (ElementSize + mAlignment - 1) / mAlignment * mAlignment;
+		const uint32_t ElementCount = std::min(PageSize, mMaxSize - PoolSize);
+
+		// Obtain a page of memory
+		uint8_t* RawMem = (uint8_t*)mPageSource.Allocate(BlockGap * ElementCount, mAlignment);
+		if (!RawMem)
+			return;
+
+		mPages.push_back(RawMem);
+
+		const uint32_t CachedCount = std::min(ElementCount, REFILL_SIZE);
+		for (uint32_t i = 0; i < CachedCount; i++)
+			Cache.Elements[Cache.Count++] = (PoolElement*)(&RawMem[i * BlockGap]);
+
+		if (CachedCount == ElementCount)
+			return;
+
+		// Link the rest of the blocks of memory together
+		for (uint32_t i = CachedCount; i < ElementCount - 1; i++)
+			((PoolElement*)(&RawMem[i * BlockGap]))->Next = (PoolElement*)(&RawMem[(i + 1) * BlockGap]);
+
+		PushShared((PoolElement*)(&RawMem[CachedCount * BlockGap]), (PoolElement*)(&RawMem[(ElementCount - 1) * BlockGap]));
+	}
+
+private:
+	std::atomic<uint64_t>  mFreeHead;           // Tagged entry into the shared freelist
+	std::atomic<uint32_t>  mObjectsConstructed; // Number of active objects from the pool
+	ThreadCache            mCaches[CACHE_COUNT];
+	PageSourceType         mPageSource;         // Guarded by mGrowMutex
+	std::vector<uint8_t*>  mPages;              // All memory pages owned by the pool
+	std::mutex             mGrowMutex;          // Held while adding pages
+	uint32_t               mMaxSize;            // Max number of objects in the pool
+	uint32_t               mAlignment;
+};
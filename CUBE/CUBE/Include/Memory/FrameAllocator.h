@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+#include "StackAllocator.h"
+#include "StackAdapter.h"
+
+/**
+* Memory for temporaries that only live for a frame or a job, taken from stacks
+* instead of the heap. Frame memory is double-buffered: what the main thread
+* allocates in a frame stays valid through the next one, so a frame being
+* rendered on another thread can still read it. Every thread also has a scratch
+* stack of its own, to be used under an FStackScope.
+*/
+class SFrameAllocator
+{
+public:
+	/**
+	* Creates both frame stacks. Scratch stacks are created as threads first ask for them.
+	* @param FrameBytes - The size of each frame stack.
+	* @param ScratchBytes - The size of each thread's scratch stack.
+	*/
+	static void Init(const uint32_t FrameBytes, const uint32_t ScratchBytes);
+
+	/**
+	* Frees every stack. No thread may use them afterwards.
+	*/
+	static void Shutdown();
+
+	/**
+	* Swaps the frame stacks and clears the one the new frame allocates from.
+	* Called by the main thread at the start of each frame.
+	*/
+	static void BeginFrame();
+
+	/**
+	* Retrieves the stack of the current frame. Only the main thread may use it.
+	*/
+	static FStackAllocator& GetFrame()
+	{
+		return *mFrames[mCurrentFrame];
+	}
+
+	/**
+	* Retrieves the scratch stack of the calling thread.
+	*/
+	static FStackAllocator& GetScratch();
+
+	template <typename T>
+	/**
+	* An STL allocator for the current frame's stack.
+	*/
+	static TStackAdapter<T> FrameAdapter()
+	{
+		return TStackAdapter<T>(GetFrame());
+	}
+
+	template <typename T>
+	/**
+	* An STL allocator for the calling thread's scratch stack.
+	*/
+	static TStackAdapter<T> ScratchAdapter()
+	{
+		return TStackAdapter<T>(GetScratch());
+	}
+
+private:
+	SFrameAllocator() = delete;	// Not meant for instantiation
+
+	static FStackAllocator* mFrames[2];
+	static uint32_t         mCurrentFrame;
+	static uint32_t         mScratchBytes;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+/**
+* Subsystems whose memory is tracked by SMemoryStats.
+*/
+struct EMemoryTag
+{
+	enum Type : uint32_t
+	{
+		ChunkBlocks,   // Packed block indices of chunks
+		ChunkMeshes,   // Vertex data of chunk meshes held on the CPU
+		ChunkGeometry, // Vertex data of chunk meshes held on the GPU
+		RegionFiles,   // Mapped region files of the world and the mesh cache
+		Components,    // Pages of components and behaviors
+		Textures,      // Render target textures
+		ChunkCache,    // Encoded chunk data held in front of region files
+		Count
+	};
+};
+
+/**
+* Live bytes, high-water marks and budgets of each tracked subsystem. Subsystems
+* report their own allocations, and check their budget where they can give memory
+* back. Any thread may report or read.
+*/
+class SMemoryStats
+{
+public:
+	/**
+	* Adds to the live bytes of a tag.
+	*/
+	static void Allocate(const EMemoryTag::Type Tag, const uint64_t Bytes);
+
+	/**
+	* Removes from the live bytes of a tag.
+	*/
+	static void Free(const EMemoryTag::Type Tag, const uint64_t Bytes);
+
+	/**
+	* The bytes a tag holds.
+	*/
+	static uint64_t GetLiveBytes(const EMemoryTag::Type Tag) { return LiveBytes[Tag].load(std::memory_order_relaxed); }
+
+	/**
+	* The most bytes a tag has held at once.
+	*/
+	static uint64_t GetPeakBytes(const EMemoryTag::Type Tag) { return PeakBytes[Tag].load(std::memory_order_relaxed); }
+
+	/**
+	* Sets the bytes a tag should stay under. Subsystems over budget give back what they can.
+	* @param Bytes - The budget, or 0 for none.
+	*/
+	static void SetBudget(const EMemoryTag::Type Tag, const uint64_t Bytes) { Budgets[Tag].store(Bytes, std::memory_order_relaxed); }
+
+	/**
+	* The budget of a tag, 0 if it has none.
+	*/
+	static uint64_t GetBudget(const EMemoryTag::Type Tag) { return Budgets[Tag].load(std::memory_order_relaxed); }
+
+	/**
+	* If a tag holds more than its budget.
+	*/
+	static bool IsOverBudget(const EMemoryTag::Type Tag);
+
+	/**
+	* The name of a tag, as shown in logs and taken by console commands.
+	*/
+	static const char* GetName(const EMemoryTag::Type Tag);
+
+	/**
+	* Finds a tag by name.
+	* @return EMemoryTag::Count if no tag has the name.
+	*/
+	static EMemoryTag::Type FindTag(const char* Name);
+
+	/**
+	* Logs every tag once every LOG_INTERVAL seconds. Called once a frame.
+	* @param DeltaTime - The time since the last call, in seconds.
+	*/
+	static void Update(const float DeltaTime);
+
+	/**
+	* Logs the live bytes, high-water mark and budget of every tag.
+	*/
+	static void Log();
+
+private:
+	SMemoryStats() = delete;	// Not meant for instantiation
+
+	static const float LOG_INTERVAL;
+
+	static std::atomic<uint64_t> LiveBytes[EMemoryTag::Count];
+	static std::atomic<uint64_t> PeakBytes[EMemoryTag::Count];
+	static std::atomic<uint64_t> Budgets[EMemoryTag::Count];
+	static float                 TimeSinceLog;
+};
+
+/**
+* Bytes one owner holds under a tag. Setting a new size only reports the change,
+* so owners that reallocate don't have to remember what they reported.
+*/
+class FTrackedBytes
+{
+public:
+	explicit FTrackedBytes(const EMemoryTag::Type Tag)
+		: mTag(Tag)
+		, mBytes(0)
+	{
+	}
+
+	/**
+	* Dtor
+	* Frees everything the owner reported.
+	*/
+	~FTrackedBytes()
+	{
+		Set(0);
+	}
+
+	/**
+	* Sets the bytes the owner holds.
+	*/
+	void Set(const uint64_t Bytes)
+	{
+		if (Bytes > mBytes)
+			SMemoryStats::Allocate(mTag, Bytes - mBytes);
+		else if (Bytes < mBytes)
+			SMemoryStats::Free(mTag, mBytes - Bytes);
+
+		mBytes = Bytes;
+	}
+
+	/**
+	* The bytes the owner holds.
+	*/
+	uint64_t Get() const { return mBytes; }
+
+private:
+	// Disable copy ctor and copy assignment
+	FTrackedBytes(const FTrackedBytes& Other) = delete;
+	FTrackedBytes& operator=(const FTrackedBytes& Other) = delete;
+
+private:
+	EMemoryTag::Type mTag;
+	uint64_t         mBytes;
+};
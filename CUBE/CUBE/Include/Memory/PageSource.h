@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "MemoryUtil.h"
+
+/**
+* Gives pool allocators their pages from the heap, through FMemory::AllocateAligned.
+*/
+class FHeapPageSource
+{
+public:
+	/**
+	* Allocates memory for a pool page.
+	* @param Bytes - The size of the page.
+	* @param Alignment - The alignment of the page, at most 128 bytes.
+	* @return The page, or null if it couldn't be allocated.
+	*/
+	void* Allocate(const uint32_t Bytes, const uint32_t Alignment)
+	{
+		return FMemory::AllocateAligned(Bytes, Alignment);
+	}
+
+	/**
+	* Frees a page from Allocate.
+	*/
+	void Free(void* Page)
+	{
+		FMemory::FreeAligned(Page);
+	}
+};
+
+/**
+* Gives pool allocators their pages from virtual memory. Pages are placed one
+* after another in large reserved ranges, which are committed as they fill up,
+* so address space grows ahead of the pool but only used memory is committed.
+* If the process is allowed to lock large pages, pages are placed in large
+* pages instead, so a pool takes far fewer TLB entries when accessed at random.
+* Memory is only given back on destruction.
+*/
+class FVirtualPageSource
+{
+public:
+	FVirtualPageSource();
+
+	/**
+	* Dtor
+	* Releases every range, along with all pages allocated from it.
+	*/
+	~FVirtualPageSource();
+
+	/**
+	* Allocates memory for a pool page.
+	* @param Bytes - The size of the page.
+	* @param Alignment - The alignment of the page, at most the system page size.
+	* @return The page, or null if it couldn't be committed.
+	*/
+	void* Allocate(const uint32_t Bytes, const uint32_t Alignment);
+
+	/**
+	* Does nothing, pages are kept until destruction.
+	*/
+	void Free(void* Page) { Page; } // Suppress compiler warning
+
+private:
+	// Disable copy ctor and copy assignment
+	FVirtualPageSource(const FVirtualPageSource& Other) = delete;
+	FVirtualPageSource& operator=(const FVirtualPageSource& Other) = delete;
+
+	struct Range
+	{
+		uint8_t* Base;
+		size_t   Size;
+		size_t   Committed; // Bytes from Base backed by memory
+	};
+
+	/**
+	* Adds a range with room for at least a number of bytes, preferring large pages.
+	* @return False if no range could be reserved.
+	*/
+	bool AddRange(const size_t Bytes);
+
+	// Address space reserved at a time, when not using large pages
+	static const size_t RESERVE_BYTES = 64 * 1024 * 1024;
+
+private:
+	std::vector<Range> mRanges;
+	size_t             mUsed; // Bytes allocated from the last range
+};
@@ -3,78 +3,61 @@
 #include <cstdint>
 #include "Misc/Assertions.h"
 #include "MemoryUtil.h"
+#include "PageSource.h"
 
 #include <algorithm>
+#include <vector>
 
-template <uint32_t ElementSize, uint32_t BlockSize>
+#undef min
+
+template <uint32_t ElementSize, uint32_t PageSize, typename PageSourceType = FHeapPageSource>
 /**
-* Fixed size pool allocator that uses a singly-linked free list
-* to store allocated memory. Currently, the pool is of fixed size,
-* so you will need to specify a BlockSize that will be sufficent for the max
-* number of objects required.
+* Pool allocator that uses a singly-linked free list to store allocated
+* memory. The pool starts empty and grows a page of PageSize elements at a
+* time when the free list runs out, up to a configurable max number of objects.
 * On destruction of this object, all allocations need to be freed back into
 * the pool with FPoolAllocator::Free.
 * \n
 * @oaram ElementSize The size of each allocation object.
-* @param BlockSize The max number of objects contained in the pool.
+* @param PageSize The number of objects added each time the pool grows.
+* @param PageSourceType Where pages come from, FVirtualPageSource for large pools accessed at random.
 */
 class FPoolAllocator
 {
 public:
 	/**
 	* Ctor
-	* Constructs a fixed size pool allocator with specified alignment.
+	* Constructs an empty pool allocator with specified alignment.
 	* @param Alignment for each allocation
+	* @param MaxSize The max number of objects contained in the pool.
 	*/
-	FPoolAllocator(uint32_t Alignment)
+	FPoolAllocator(uint32_t Alignment, uint32_t MaxSize = UINT32_MAX)
+		: mPageSource()
+		, mPages()
+		, mNextFreeBlock(nullptr)
+		, mObjectsConstructed(0)
+		, mMaxSize(MaxSize)
+		, mAlignment(std::max(Alignment, (uint32_t)__alignof(PoolElement)))
 	{
-		ASSERT(0 < BlockSize && "BlockSize must be larger that 0");
+		ASSERT(0 < PageSize && "PageSize must be larger that 0");
 		ASSERT(ElementSize >= sizeof(PoolElement) && "ElementSize must at least the size of a standard pointer type.");
-
-		// The byte gap between each allocation
-		const uint32_t BlockGap = std::max(ElementSize, Alignment);
-
-		// Obtain a block of memory
-		uint8_t* RawMem = (uint8_t*)FMemory::AllocateAligned(BlockGap * BlockSize, Alignment);
-		mNextFreeBlock = (PoolElement*)RawMem;
-
-		// Link the blocks of memory together
-		for (int i = 1; i < BlockSize; i++)
-		{
-			mNextFreeBlock->Next = (PoolElement*)(&RawMem[i * BlockGap]);
-			mNextFreeBlock = mNextFreeBlock->Next;
-		}
-
-		// Point back to the beginning of the free list
-		mNextFreeBlock->Next = nullptr;
-		mNextFreeBlock = (PoolElement*)(RawMem);
 	}
 
-#undef min
-
 	~FPoolAllocator()
 	{
 		ASSERT(mObjectsConstructed == 0 && "All objects should be back in the pool on destruction.");
 
-		// Find the start of the allocated chunk of memory
-		PoolElement* MemoryStart = mNextFreeBlock;
-		mNextFreeBlock = mNextFreeBlock->Next;
-		while (mNextFreeBlock)
-		{
-			MemoryStart = std::min(MemoryStart, mNextFreeBlock);
-			mNextFreeBlock = mNextFreeBlock->Next;
-		}
-
-		FMemory::FreeAligned(MemoryStart);
+		for (uint8_t* Page : mPages)
+			mPageSource.Free(Page);
 	}
 
 	/**
 	* Allocate a new element from the memory pool.
-	* If the memory pool is empty, nullptr is returned.
+	* If the memory pool is full, nullptr is returned.
 	*/
 	void* Allocate()
 	{
-		if (!mNextFreeBlock)
+		if (!mNextFreeBlock && !AddPage())
 			return nullptr;
 
 		mObjectsConstructed++;
@@ -96,13 +79,22 @@ public:
 		mNextFreeBlock = Element;
 	}
 
+	/**
+	* Sets the max number of objects that can be allocated from the
+	* pool. Pages that have already been added are kept.
+	*/
+	void SetMaxSize(uint32_t MaxSize)
+	{
+		mMaxSize = MaxSize;
+	}
+
 	/**
 	* Gets the max number of objects that can be
 	* allocated from the pool.
 	*/
 	uint32_t Capacity() const
 	{
-		return BlockSize;
+		return mMaxSize;
 	}
 
 	/**
@@ -124,14 +116,50 @@ private:
 		PoolElement* Next{nullptr};
 	};
 
+	/**
+	* Adds a page of elements to the free list.
+	* @return False if the pool is at its max size or out of memory.
+	*/
+	bool AddPage()
+	{
+		const uint32_t PoolSize = mPages.size() * PageSize;
+		if (PoolSize >= mMaxSize)
+			return false;
+
+		// The byte gap between each allocation
+		const uint32_t BlockGap = (ElementSize + mAlignment - 1) / mAlignment * mAlignment;
+		const uint32_t ElementCount = std::min(PageSize, mMaxSize - PoolSize);
+
+		// Obtain a page of memory
+		uint8_t* RawMem = (uint8_t*)mPageSource.Allocate(BlockGap * ElementCount, mAlignment);
+		if (!RawMem)
+			return false;
+
+		mPages.push_back(RawMem);
+
+		// Link the blocks of memory together
+		for (uint32_t i = 0; i < ElementCount; i++)
+		{
+			PoolElement* Element = (PoolElement*)(&RawMem[i * BlockGap]);
+			Element->Next = mNextFreeBlock;
+			mNextFreeBlock = Element;
+		}
+
+		return true;
+	}
+
 private:
-	PoolElement* mNextFreeBlock; // Entry into the freelist
-	uint32_t mObjectsConstructed; // Number of active objects from the pool
+	PageSourceType mPageSource;
+	std::vector<uint8_t*> mPages;        // All memory pages owned by the pool
+	PoolElement* mNextFreeBlock;         // Entry into the freelist
+	uint32_t mObjectsConstructed;        // Number of active objects from the pool
+	uint32_t mMaxSize;                   // Max number of objects in the pool
+	uint32_t mAlignment;
 };
 
 
 
-template <typename ElementType, uint32_t BlockSize>
+template <typename ElementType, uint32_t PageSize, template <uint32_t, uint32_t, typename> class PoolType = FPoolAllocator, typename PageSourceType = FHeapPageSource>
 /**
 * A wrapper class of FPoolAllocator for conveniently creating a 
 * pool for a specific object type. All functions are inlined, so
@@ -139,13 +167,17 @@ template <typename ElementType, uint32_t BlockSize>
 * the raw FPoolAllocator class.
 * \n
 * @param ElementType The object contained within the pool
-* @param BlockSize The max number of objects contained in the pool.
+* @param PageSize The number of objects added each time the pool grows.
+* @param PoolType The untyped pool, FConcurrentPoolAllocator for pools shared between threads.
+* @param PageSourceType Where the pool's pages come from.
 */
-class FPoolAllocatorType : private FPoolAllocator<sizeof(ElementType), BlockSize>
+class FPoolAllocatorType : private PoolType<sizeof(ElementType), PageSize, PageSourceType>
 {
+	using Pool = PoolType<sizeof(ElementType), PageSize, PageSourceType>;
+
 public:
-	FPoolAllocatorType(uint8_t Alignment)
-		:FPoolAllocator(Alignment)
+	FPoolAllocatorType(uint8_t Alignment, uint32_t MaxSize = UINT32_MAX)
+		:Pool(Alignment, MaxSize)
 	{
 
 	}
@@ -158,7 +190,7 @@ public:
 	*/
 	ElementType* Allocate()
 	{
-		return reinterpret_cast<ElementType*>(FPoolAllocator::Allocate());
+		return reinterpret_cast<ElementType*>(Pool::Allocate());
 	}
 
 	/**
@@ -169,7 +201,16 @@ public:
 	void Free(ElementType* Data)
 	{
 		Data->~ElementType();
-		FPoolAllocator::Free((void*)Data);
+		Pool::Free((void*)Data);
+	}
+
+	/**
+	* Sets the max number of objects that can be allocated from the
+	* pool. Pages that have already been added are kept.
+	*/
+	void SetMaxSize(uint32_t MaxSize)
+	{
+		Pool::SetMaxSize(MaxSize);
 	}
 
 	/**
@@ -178,7 +219,7 @@ public:
 	*/
 	uint32_t Capacity() const
 	{
-		return FPoolAllocator::Capacity();
+		return Pool::Capacity();
 	}
 
 	/**
@@ -187,6 +228,6 @@ public:
 	*/
 	uint32_t Size() const
 	{
-		return FPoolAllocator::Size();
+		return Pool::Size();
 	}
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "StackAllocator.h"
+
+template <typename T>
+/**
+* Lets STL containers allocate from a stack allocator, for temporaries that
+* would otherwise go through the heap. Memory is only given back when the stack
+* is cleared, so containers should be reserved up front. If the stack runs out,
+* allocations fall back to the heap and are freed as usual.
+* @tparam T - The element type.
+*/
+class TStackAdapter
+{
+public:
+	using value_type      = T;
+	using pointer         = T*;
+	using const_pointer   = const T*;
+	using reference       = T&;
+	using const_reference = const T&;
+	using size_type       = std::size_t;
+	using difference_type = std::ptrdiff_t;
+
+	template <typename U>
+	struct rebind
+	{
+		using other = TStackAdapter<U>;
+	};
+
+public:
+	explicit TStackAdapter(FStackAllocator& Stack)
+		: mStack(&Stack)
+	{
+	}
+
+	template <typename U>
+	TStackAdapter(const TStackAdapter<U>& Other)
+		: mStack(Other.GetStack())
+	{
+	}
+
+	T* allocate(const size_type Count, const void* Hint = nullptr)
+	{
+		Hint; // Suppress compiler warning
+		void* Data = mStack->TryAllocate(Count * sizeof(T), __alignof(T));
+		return static_cast<T*>(Data ? Data : ::operator new(Count * sizeof(T)));
+	}
+
+	void deallocate(T* Data, const size_type Count)
+	{
+		Count; // Suppress compiler warning
+		if (!mStack->Owns(Data))
+			::operator delete(Data);
+	}
+
+	template <typename U, typename... Args>
+	void construct(U* Data, Args&&... Arguments)
+	{
+		new (Data) U(std::forward<Args>(Arguments)...);
+	}
+
+	template <typename U>
+	void destroy(U* Data)
+	{
+		Data; // Suppress compiler warning
+		Data->~U();
+	}
+
+	T* address(T& Value) const { return &Value; }
+	const T* address(const T& Value) const { return &Value; }
+
+	size_type max_size() const { return size_type(-1) / sizeof(T); }
+
+	FStackAllocator* GetStack() const { return mStack; }
+
+private:
+	FStackAllocator* mStack;
+};
+
+template <typename T, typename U>
+inline bool operator==(const TStackAdapter<T>& Lhs, const TStackAdapter<U>& Rhs)
+{
+	return Lhs.GetStack() == Rhs.GetStack();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const TStackAdapter<T>& Lhs, const TStackAdapter<U>& Rhs)
+{
+	return Lhs.GetStack() != Rhs.GetStack();
+}
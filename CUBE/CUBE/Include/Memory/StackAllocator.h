@@ -39,6 +39,14 @@ public:
 	*/
 	void* Allocate(const uint32_t Bytes, const uint32_t Alignment);
 
+	/**
+	* Allocates a chunk of aligned memory from the stack if it fits.
+	* @param Bytes requested
+	* @param Alignment of the requested bytes
+	* @return The memory, or null if the stack doesn't have room for it.
+	*/
+	void* TryAllocate(const uint32_t Bytes, const uint32_t Alignment);
+
 	template <typename Type>
 	/**
 	* Allocates memory for a specific data type. If no alignment for
@@ -65,6 +73,11 @@ public:
 	*/
 	void ClearToMarker(const UMarker Marker);
 
+	/**
+	* Checks if memory was allocated from this stack.
+	*/
+	bool Owns(const void* Data) const;
+
 private:
 	/**
 	* Moves the current marker for the stack to a 
@@ -78,4 +91,30 @@ private:
 	// The current location we are at in the memory stack
 	UMarker mCurrentMarker;
 	UMarker mCapacity;
+};
+
+/**
+* Rolls a stack allocator back to where it was when the scope was
+* entered, freeing everything allocated from it within the scope.
+*/
+class FStackScope
+{
+public:
+	explicit FStackScope(FStackAllocator& Stack)
+		: mStack(Stack)
+		, mMarker(Stack.GetMarker())
+	{
+	}
+
+	~FStackScope()
+	{
+		mStack.ClearToMarker(mMarker);
+	}
+
+	FStackScope(const FStackScope& Other) = delete;
+	FStackScope& operator=(const FStackScope& Other) = delete;
+
+private:
+	FStackAllocator& mStack;
+	const FStackAllocator::UMarker mMarker;
 };
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace FSort
+{
+	/**
+	* Packs a sort key and a value into one item for RadixSort. Keys are compared
+	* as unsigned integers, so positive floats can be passed by their bits.
+	*/
+	inline uint64_t MakeKeyedItem(const uint32_t Key, const uint32_t Value)
+	{
+		return ((uint64_t)Key << 32) | Value;
+	}
+
+	/**
+	* The value of an item made with MakeKeyedItem.
+	*/
+	inline uint32_t GetItemValue(const uint64_t Item)
+	{
+		return (uint32_t)Item;
+	}
+
+	/**
+	* Sorts items by their key, least significant byte first. Equal keys keep their order.
+	* Bytes every key shares are skipped, so keys in a narrow range take fewer passes.
+	* @param Items - Items made with MakeKeyedItem, sorted in place.
+	* @param Scratch - Working memory, resized to the item count.
+	*/
+	inline void RadixSort(std::vector<uint64_t>& Items, std::vector<uint64_t>& Scratch)
+	{
+		const size_t Count = Items.size();
+		if (Count < 2)
+			return;
+
+		// Every pass is counted up front in a single read of the items
+		uint32_t Counts[4][256];
+		memset(Counts, 0, sizeof(Counts));
+		for (const uint64_t Item : Items)
+		{
+			for (uint32_t Pass = 0; Pass < 4; Pass++)
+				Counts[Pass][(Item >> (32 + Pass * 8)) & 0xFF]++;
+		}
+
+		Scratch.resize(Count);
+		uint64_t* Source = Items.data();
+		uint64_t* Destination = Scratch.data();
+
+		for (uint32_t Pass = 0; Pass < 4; Pass++)
+		{
+			const uint32_t Shift = 32 + Pass * 8;
+			if (Counts[Pass][(Source[0] >> Shift) & 0xFF] == Count)
+				continue;
+
+			uint32_t Offsets[256];
+			uint32_t Offset = 0;
+			for (uint32_t Digit = 0; Digit < 256; Digit++)
+			{
+				Offsets[Digit] = Offset;
+				Offset += Counts[Pass][Digit];
+			}
+
+			for (size_t i = 0; i < Count; i++)
+				Destination[Offsets[(Source[i] >> Shift) & 0xFF]++] = Source[i];
+
+			uint64_t* Sorted = Destination;
+			Destination = Source;
+			Source = Sorted;
+		}
+
+		if (Source != Items.data())
+			memcpy(Items.data(), Source, Count * sizeof(uint64_t));
+	}
+}
@@ -1,17 +1,88 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 
 namespace FString
 {
+	static const uint32_t CRC32_POLYNOMIAL = 0x04C11DB7;
+
+	/**
+	* Wraps a string built at runtime. Taking it by this rather than by
+	* pointer leaves the literal overloads the better match for literals.
+	*/
+	struct FDynamicString
+	{
+		FDynamicString(const char* String)
+			: String(String)
+		{
+		}
+
+		FDynamicString(const std::string& String)
+			: String(String.c_str())
+		{
+		}
+
+		const char* String;
+	};
+
+	/**
+	* Adds one character to a CRC32 hash in progress.
+	*/
+	__forceinline uint32_t HashCRC32Char(uint32_t Result, const char Char)
+	{
+		Result ^= Char;
+		for (int i = 0; i < 8; i++)
+		{
+			Result = (Result >> 1) ^ (-int(Result & 1) & CRC32_POLYNOMIAL);
+		}
+
+		return Result;
+	}
+
+	/**
+	* Hashes the first Length characters of a string, unrolled per character
+	* so hashes of literals fold to constants.
+	*/
+	template <std::size_t Length>
+	struct TCRC32
+	{
+		static __forceinline uint32_t Hash(const char* String)
+		{
+			return HashCRC32Char(TCRC32<Length - 1>::Hash(String), String[Length - 1]);
+		}
+	};
+
+	template <>
+	struct TCRC32<0>
+	{
+		static __forceinline uint32_t Hash(const char*)
+		{
+			return 0x0;
+		}
+	};
+
+	/**
+	* CRC32 hash of a string literal, the same as of the string at runtime.
+	* The toolset has no constexpr, so the hash is unrolled for the optimizer
+	* to compute when compiling. Character buffers must be passed as pointers,
+	* as their whole length is hashed here.
+	* @param String - Null-terminated string literal to be hashed.
+	*/
+	template <std::size_t Size>
+	__forceinline uint32_t HashCRC32(const char (&String)[Size])
+	{
+		return ~TCRC32<Size - 1>::Hash(String);
+	}
+
 	/**
 	* CRC32 based hash function that uses a precalculated lookup table
 	* for computation.
 	* @param String Null-terminated c-string to be hashed.
 	*/
-	inline uint32_t HashCRC32(const char* String)
+	inline uint32_t HashCRC32(const FDynamicString String)
 	{
-		static const uint32_t Polynomial = 0x04C11DB7;
 		static const uint32_t Table[256] = {
 			0x00000000U, 0x04C11DB7U, 0x09823B6EU, 0x0D4326D9U,
 			0x130476DCU, 0x17C56B6BU, 0x1A864DB2U, 0x1E475005U,
@@ -80,13 +151,9 @@ namespace FString
 		};
 
 		uint32_t Result = 0x0;
-		while (*String != '\0')
+		for (const char* Char = String.String; *Char != '\0'; Char++)
 		{
-			Result ^= *String++;
-			for (int i = 0; i < 8; i++)
-			{
-				Result = (Result >> 1) ^ (-int(Result & 1) & Polynomial);
-			}
+			Result = HashCRC32Char(Result, *Char);
 		}
 
 		return ~Result;
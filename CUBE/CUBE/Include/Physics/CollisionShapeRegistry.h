@@ -0,0 +1,63 @@
+#pragma once
+#include "BulletPhysics\btBulletCollisionCommon.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+/**
+* Registry of collision shapes shared between every object of the same
+* dimensions, so identical bodies don't each hold a shape and recompute its
+* inertia. Shapes are reference counted by their handles, and are freed once
+* the last handle to them is gone. The registry is thread safe.
+*/
+class FCollisionShapeRegistry
+{
+public:
+	/**
+	* A shared shape and its local inertia.
+	*/
+	ATTRIBUTE_ALIGNED16(struct) SharedShape
+	{
+		BT_DECLARE_ALIGNED_ALLOCATOR();
+
+		std::unique_ptr<btCollisionShape> Shape;
+		btVector3                         UnitInertia; // Local inertia at a mass of 1
+	};
+
+	using ShapeHandle = std::shared_ptr<const SharedShape>;
+
+public:
+	/**
+	* Gets the shape of a capsule along the y axis.
+	* @param Radius - Radius of the capsule.
+	* @param Height - Distance between the centers of the capsule's caps.
+	*/
+	static ShapeHandle GetCapsule(const btScalar Radius, const btScalar Height);
+
+	/**
+	* Gets the shape of a box.
+	* @param HalfExtents - Half of the size of the box on each axis.
+	*/
+	static ShapeHandle GetBox(const btVector3& HalfExtents);
+
+private:
+	enum class ShapeType
+	{
+		Capsule,
+		Box
+	};
+
+	using ShapeKey = std::tuple<ShapeType, btScalar, btScalar, btScalar>;
+
+	/**
+	* Finds a registered shape, or registers a new one made by Create.
+	*/
+	template <typename CreateFunction>
+	static ShapeHandle FindOrCreate(const ShapeKey& Key, const CreateFunction& Create);
+
+private:
+	static std::mutex                                     ShapeMutex;
+	static std::map<ShapeKey, std::weak_ptr<SharedShape>> Shapes;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "BulletPhysics\btBulletCollisionCommon.h"
+#include "BulletPhysics\BulletCollision\CollisionDispatch\btConvexConvexAlgorithm.h"
+#include "BulletPhysics\BulletCollision\NarrowPhaseCollision\btVoronoiSimplexSolver.h"
+
+class FPhysicsTaskPool;
+
+/**
+* Collision dispatcher that can run the narrowphase of every overlapping pair
+* on a task pool. Pairs only write to their own algorithm and manifold, so the
+* shared manifold and algorithm pools are the only state that is locked.
+*
+* Bullet's convex algorithms share a single simplex solver, so they are replaced
+* by ones that own a solver each. The collision configuration must leave room for
+* them in its algorithm pool, see ALGORITHM_SIZE.
+*/
+class FParallelDispatcher : public btCollisionDispatcher
+{
+public:
+	// Pairs below this count are processed on the calling thread
+	static const uint32_t MIN_PARALLEL_PAIRS = 32;
+
+	/**
+	* Convex algorithm with a simplex solver of its own.
+	*/
+	ATTRIBUTE_ALIGNED16(class) ConvexConvexAlgorithm : public btConvexConvexAlgorithm
+	{
+	public:
+		ConvexConvexAlgorithm(btPersistentManifold* Manifold, const btCollisionAlgorithmConstructionInfo& Info,
+							  const btCollisionObjectWrapper* Body0, const btCollisionObjectWrapper* Body1,
+							  btConvexPenetrationDepthSolver* PenetrationSolver, int PerturbationIterations, int PerturbationThreshold);
+
+	private:
+		// Only its address is used while the base is constructed
+		btVoronoiSimplexSolver mSimplexSolver;
+	};
+
+	// Size of the largest algorithm this dispatcher creates
+	static const int ALGORITHM_SIZE = sizeof(ConvexConvexAlgorithm);
+
+public:
+	FParallelDispatcher(btDefaultCollisionConfiguration& CollisionConfig);
+
+	/**
+	* Sets the pool to run the narrowphase on.
+	* @param TaskPool - The pool, or null to process every pair on the calling thread.
+	*/
+	void SetTaskPool(FPhysicsTaskPool* TaskPool) { mTaskPool = TaskPool; }
+
+	void dispatchAllCollisionPairs(btOverlappingPairCache* PairCache, const btDispatcherInfo& DispatchInfo, btDispatcher* Dispatcher) override;
+
+	btPersistentManifold* getNewManifold(const btCollisionObject* Body0, const btCollisionObject* Body1) override;
+
+	void releaseManifold(btPersistentManifold* Manifold) override;
+
+	void* allocateCollisionAlgorithm(int Size) override;
+
+	void freeCollisionAlgorithm(void* Algorithm) override;
+
+private:
+	struct ConvexConvexCreateFunc : public btCollisionAlgorithmCreateFunc
+	{
+		ConvexConvexCreateFunc(const btConvexConvexAlgorithm::CreateFunc& Default)
+			: PenetrationSolver(Default.m_pdSolver)
+			, PerturbationIterations(Default.m_numPerturbationIterations)
+			, PerturbationThreshold(Default.m_minimumPointsPerturbationThreshold)
+		{}
+
+		btCollisionAlgorithm* CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& Info, const btCollisionObjectWrapper* Body0, const btCollisionObjectWrapper* Body1) override;
+
+		btConvexPenetrationDepthSolver* PenetrationSolver;
+		int                             PerturbationIterations;
+		int                             PerturbationThreshold;
+	};
+
+private:
+	ConvexConvexCreateFunc mConvexConvexCreateFunc;
+	FPhysicsTaskPool*      mTaskPool;
+	std::mutex             mPoolMutex; // Guards the manifold and algorithm pools
+};
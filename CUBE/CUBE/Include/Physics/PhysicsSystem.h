@@ -2,9 +2,15 @@
 #include "Atlas\System.h"
 #include "BulletPhysics\btBulletDynamicsCommon.h"
 #include "Memory\MemoryUtil.h"
+#include "PhysicsTaskPool.h"
+#include "ParallelDispatcher.h"
+#include "Containers\BoundedMPSCQueue.h"
 
-#include <queue>
+#include <functional>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
 
 WIN_ALIGN(16)
 class FPhysicsSystem : public Atlas::ISystem
@@ -13,6 +19,69 @@ public:
 
 	ALIGNED_ALLOC(16);
 
+	// Fixed steps taken in a single update before simulation time is dropped
+	static const uint32_t DEFAULT_MAX_SUB_STEPS = 4;
+
+	// Adds and removals that may be queued between two updates without waiting
+	static const uint32_t COMMAND_QUEUE_SIZE = 4096;
+
+	/**
+	* Casts a ray against the terrain for continuous collision and ray queries, from any thread.
+	* @param From, To - Start and end world positions of the ray.
+	* @param FractionOut - To put the part of the ray before the hit.
+	* @param NormalOut - To put the world normal of the face that was hit.
+	* @return False if nothing was hit, or the ray starts inside the terrain.
+	*/
+	using TerrainRaycast = std::function<bool(const btVector3& From, const btVector3& To, btScalar& FractionOut, btVector3& NormalOut)>;
+
+	/**
+	* Results of RaycastBatch, with an element of each array for each ray.
+	*/
+	struct RaycastResults
+	{
+		btAlignedObjectArray<btVector3>                Points;    // World position of the closest hit
+		btAlignedObjectArray<btVector3>                Normals;   // World normal of the surface that was hit
+		btAlignedObjectArray<btScalar>                 Fractions; // Part of the ray before the hit, 1 if nothing was hit
+		btAlignedObjectArray<const btCollisionObject*> Objects;   // The object hit, null if nothing was hit
+	};
+
+	/**
+	* Results of OverlapSphereBatch. The objects overlapping sphere i start at
+	* Objects[FirstObjects[i]], and there are ObjectCounts[i] of them.
+	*/
+	struct OverlapResults
+	{
+		std::vector<uint32_t>                 FirstObjects;
+		std::vector<uint32_t>                 ObjectCounts;
+		std::vector<const btCollisionObject*> Objects;
+	};
+
+	/**
+	* Time spent in each part of an update, the step parts summed over every fixed step it took.
+	*/
+	struct UpdateTimings
+	{
+		uint64_t QueueCycles;       // Applying queued adds and removals
+		uint64_t BroadphaseCycles;  // Updating bounds and finding overlapping pairs
+		uint64_t NarrowphaseCycles; // Finding the contacts of each pair
+		uint64_t SolverCycles;      // Solving contacts and constraints
+		uint64_t IntegrateCycles;   // Moving bodies, with their continuous collision
+		uint32_t StepCount;         // Fixed steps taken
+	};
+
+	/**
+	* A snapshot of what the simulation holds, taken by GetWorldStats.
+	*/
+	struct WorldStats
+	{
+		uint32_t ObjectCount;    // Rigidbodies and colliders
+		uint32_t RigidBodyCount; // Dynamic rigidbodies
+		uint32_t SleepingCount;  // Dynamic rigidbodies that are asleep
+		uint32_t PairCount;      // Overlapping pairs of the broadphase
+		uint32_t ManifoldCount;  // Contact manifolds of the narrowphase
+		uint64_t BulletBytes;    // Estimate of what Bullet allocated for them, objects themselves left out
+	};
+
 	FPhysicsSystem(Atlas::FWorld& World);
 	~FPhysicsSystem();
 
@@ -23,6 +92,49 @@ public:
 	*/
 	void Update() override;
 
+	/**
+	* Sets the most fixed steps a single update may take. Frames longer than this
+	* many steps slow the simulation down instead of stalling the next frames.
+	* @param MaxSubSteps - The step budget, must be at least 1.
+	*/
+	void SetMaxSubSteps(const uint32_t MaxSubSteps);
+
+	/**
+	* Sets if steps run on a physics thread of their own. A pipelined step overlaps
+	* with everything after the update that started it, such as rendering, while game
+	* objects keep the transforms of the previous step.
+	* @param Flag - True to pipeline steps.
+	*/
+	void SetPipelined(const bool Flag);
+
+	/**
+	* Waits for a pipelined step to finish, then gives its transforms to game objects.
+	* Nothing may touch the simulation while a step runs, so this must be called before
+	* game objects and chunks are updated. Does nothing if no step is running.
+	*/
+	void WaitForStep();
+
+	/**
+	* Sets if the narrowphase of a step is split between worker threads.
+	* @param Flag - True to run collision pairs in parallel.
+	*/
+	void SetParallel(const bool Flag);
+
+	/**
+	* True if the narrowphase runs on worker threads.
+	*/
+	bool IsParallel() const { return mTaskPool.GetThreadCount() > 1; }
+
+	/**
+	* The timings of the last update. Waits for a pipelined step, so its parts are complete.
+	*/
+	const UpdateTimings& GetLastUpdateTimings();
+
+	/**
+	* Counts what the simulation holds. Waits for a pipelined step.
+	*/
+	WorldStats GetWorldStats();
+
 	/**
 	* Checks if the gameobject has a rigidbody or collider. If so,
 	* it is added to the dynamics world.
@@ -35,7 +147,10 @@ public:
 	void RenderCollisionObjects();
 
 	/**
-	* Adds a collision object to the simulation.
+	* Adds a collision object to the simulation. Adds and removals are queued
+	* without locking from any thread, and applied at the next update. The
+	* broadphase bounds of colliders are only found when they are added, so
+	* steps spend nothing on static colliders.
 	*/
 	void AddCollider(btCollisionObject& CollisionObject);
 
@@ -44,6 +159,12 @@ public:
 	*/
 	void RemoveCollider(btCollisionObject& CollisionObject);
 
+	/**
+	* Updates the broadphase bounds of a collider in the simulation after its
+	* shape or transform changed. Colliders still queued are found when added.
+	*/
+	void UpdateColliderBounds(btCollisionObject& CollisionObject);
+
 	/**
 	* Adds a rigidbody to the simulation.
 	*/
@@ -54,37 +175,196 @@ public:
 	*/
 	void RemoveRigidBody(btRigidBody& RigidBody);
 
+	/**
+	* Adds and removes the queued rigidbodies and colliders now, instead of at the
+	* next update. Objects must be removed this way before they are destroyed.
+	* Objects added and removed again since the last update are skipped. Must be
+	* called from the thread that created the system.
+	*/
+	void ApplyQueuedChanges();
+
+	/**
+	* Wakes every rigidbody overlapping a box, so sleeping bodies react to changes
+	* of static colliders they rest on.
+	* @param Min, Max - Corners of the box.
+	*/
+	void ActivateBodiesInBox(const btVector3& Min, const btVector3& Max);
+
+	/**
+	* Sets the box rigidbodies are simulated in. Bodies that leave the box are held
+	* where they are until they are back inside, so they never fall through terrain
+	* that isn't loaded. Bodies are simulated everywhere until a box is set.
+	* @param Min, Max - Corners of the box.
+	*/
+	void SetResidentBox(const btVector3& Min, const btVector3& Max);
+
+	/**
+	* Sets the collider of the terrain, which bodies with continuous collision and
+	* RaycastBatch are tested against with a raycast instead of with its shape.
+	* @param Terrain - The collider of the terrain, or null to clear it.
+	* @param Raycast - Ray test against the terrain, called during steps.
+	*/
+	void SetTerrain(const btCollisionObject* Terrain, TerrainRaycast Raycast);
+
+	/**
+	* Finds the closest object along each of many rays. Waits for a pipelined step,
+	* then splits the rays between the physics workers while nothing else touches
+	* the world, so it must be called between steps. Objects that don't respond to
+	* contacts are skipped, and so is the terrain for rays starting inside it.
+	* @param From, To - Start and end world positions of each ray.
+	* @param Count - The number of rays.
+	* @param ResultsOut - To put the hit of each ray.
+	*/
+	void RaycastBatch(const btVector3* From, const btVector3* To, const uint32_t Count, RaycastResults& ResultsOut);
+
+	/**
+	* Finds every object overlapping each of many spheres, the same way as RaycastBatch.
+	* @param Centers - World position of each sphere.
+	* @param Radii - Radius of each sphere.
+	* @param Count - The number of spheres.
+	* @param ResultsOut - To put the objects overlapping each sphere.
+	*/
+	void OverlapSphereBatch(const btVector3* Centers, const btScalar* Radii, const uint32_t Count, OverlapResults& ResultsOut);
+
 	/**
 	* Override for removing object from this system. Since this system
 	* does not need to hold object IDs, this evaluates to nothing.
 	*/
 	void RemoveObject(Atlas::FGameObject& GameObject) override { GameObject; } // Suppress compiler warning
 
+	/**
+	* Removes the bodies and colliders of the removed components from the world.
+	*/
+	void OnRemoveBatchEnd() override;
+
 private:
-	struct RigidBodyRecord
+	/**
+	* Dynamics world that can hold back motion state updates, so a step on the
+	* physics thread never writes transforms that are being rendered.
+	*/
+	ATTRIBUTE_ALIGNED16(class) DynamicsWorld : public btDiscreteDynamicsWorld
+	{
+	public:
+		BT_DECLARE_ALIGNED_ALLOCATOR();
+
+		DynamicsWorld(btDispatcher* Dispatcher, btBroadphaseInterface* BroadPhase, btConstraintSolver* Solver, btCollisionConfiguration* CollisionConfig)
+			: btDiscreteDynamicsWorld(Dispatcher, BroadPhase, Solver, CollisionConfig)
+			, DefersMotionStates(false)
+			, Terrain(nullptr)
+			, RaycastTerrain()
+			, Timings()
+		{
+			// Continuous collision is done by integrateTransforms alone
+			getDispatchInfo().m_useContinuous = false;
+		}
+
+		/**
+		* Moves bodies to their transforms at the end of the step. Bodies with continuous
+		* collision that move past their motion threshold stop where their swept sphere
+		* first touches the terrain or another object.
+		*/
+		void integrateTransforms(btScalar TimeStep) override;
+
+		/**
+		* The parts of a step, each timed into Timings.
+		*/
+		void internalSingleStepSimulation(btScalar TimeStep) override;
+		void updateAabbs() override;
+		void computeOverlappingPairs() override;
+		void performDiscreteCollisionDetection() override;
+		void solveConstraints(btContactSolverInfo& SolverInfo) override;
+
+		void synchronizeMotionStates() override
+		{
+			if (!DefersMotionStates)
+				btDiscreteDynamicsWorld::synchronizeMotionStates();
+		}
+
+		/**
+		* Updates motion states held back by the last step.
+		*/
+		void SynchronizeDeferred() { btDiscreteDynamicsWorld::synchronizeMotionStates(); }
+
+		bool                           DefersMotionStates;
+		const btCollisionObject*       Terrain;
+		FPhysicsSystem::TerrainRaycast RaycastTerrain;
+		FPhysicsSystem::UpdateTimings  Timings;        // Of the last update
+	};
+
+	/**
+	* Steps the simulation by a frame's time.
+	*/
+	void StepSimulation(const float DeltaTime);
+
+	/**
+	* Holds the bodies that left the resident box or belong to inactive game objects,
+	* and frees the ones that are simulated again. Inactive objects don't collide.
+	*/
+	void UpdateResidency();
+
+	void StepThreadLoop();
+
+	/**
+	* An add or removal waiting for the next update.
+	*/
+	struct Command
 	{
-		btRigidBody* RigidBody;
-		bool         ToBeAdded;
+		enum class Type : uint8_t
+		{
+			AddRigidBody,
+			RemoveRigidBody,
+			AddCollider,
+			RemoveCollider
+		};
+
+		btCollisionObject* Object;
+		Type               Action;
 	};
 
-	struct ColliderRecord
+	/**
+	* Queues a command. A full queue is drained here on the updating thread,
+	* other threads wait for it to be drained by the next update.
+	*/
+	void QueueCommand(const Command& NewCommand);
+
+private:
+	/**
+	* Memory kept by each worker between query batches.
+	*/
+	struct QueryScratch
 	{
-		btCollisionObject* Collider;
-		bool               ToBeAdded;
+		btAlignedObjectArray<btCollisionObject*>                   Candidates; // Objects the broadphase found for a query
+		std::vector<std::pair<uint32_t, const btCollisionObject*>> Overlaps;   // Overlapping objects with their sphere
 	};
 
-	std::mutex                  mRigidBodyMutex;
-	std::queue<RigidBodyRecord> mRigidBodyQueue;
+	FBoundedMPSCQueue<Command, COMMAND_QUEUE_SIZE> mCommandQueue;
+	std::thread::id                                 mUpdateThread;
+	std::vector<Command>                            mCommandBatch; // Commands drained by ApplyQueuedChanges
+	std::unordered_map<btCollisionObject*, size_t>  mPendingAdds;  // Batch index of each object's latest add
+
+	uint32_t                    mMaxSubSteps;
+
+	btVector3                   mResidentMin;
+	btVector3                   mResidentMax;
+	bool                        mHasResidentBox;
+
+	std::thread                 mStepThread;
+	std::mutex                  mStepMutex;
+	std::condition_variable     mStepCondition;
+	float                       mStepDeltaTime;
+	bool                        mIsStepPending;   // Set while the physics thread owns the simulation
+	bool                        mIsSyncPending;   // Motion states wait for the last pipelined step
+	bool                        mMustStop;
 
-	std::mutex                  mColliderMutex;
-	std::queue<ColliderRecord>  mColliderQueue;
+	std::vector<QueryScratch>   mQueryScratch;
 
 private:
-	btDefaultCollisionConfiguration      mCollisionConfig; 
-	btCollisionDispatcher                mCollisionDispatcher;
+	FPhysicsTaskPool                     mTaskPool;
+	btDefaultCollisionConfiguration      mCollisionConfig;
+	FParallelDispatcher                  mCollisionDispatcher;
 	btDbvtBroadphase                     mBroadPhase;
 	btSequentialImpulseConstraintSolver  mConstraintSolver;
-	btDiscreteDynamicsWorld              mDynamicsWorld;
+	DynamicsWorld                        mDynamicsWorld;
 };
 
 /**
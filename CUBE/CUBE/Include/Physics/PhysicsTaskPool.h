@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Threading\JobSystem.h"
+
+/**
+* Splits loops with independent iterations of the physics step between
+* the workers of the job system. The thread starting a loop works on it
+* too, and waits for every iteration to finish before returning.
+*/
+class FPhysicsTaskPool
+{
+public:
+	/**
+	* A loop iteration.
+	* @param Index - The index of the iteration.
+	* @param Worker - The thread running it, within [0, GetThreadCount()). The calling thread is 0.
+	*/
+	using Task = FJobSystem::LoopWork;
+
+public:
+	FPhysicsTaskPool();
+
+	FPhysicsTaskPool(const FPhysicsTaskPool& Other) = delete;
+	FPhysicsTaskPool& operator=(const FPhysicsTaskPool& Other) = delete;
+
+	/**
+	* Starts splitting loops between the job system's workers.
+	*/
+	void Start();
+
+	/**
+	* Stops splitting loops. Loops then run on the calling thread alone.
+	*/
+	void Stop();
+
+	/**
+	* Runs a loop over every index in [0, Count), split between the workers
+	* and the calling thread.
+	* @param Count - The number of iterations.
+	* @param Work - The iteration to run for each index.
+	*/
+	void ParallelFor(const uint32_t Count, const Task& Work);
+
+	/**
+	* The number of threads a loop is split between, including the calling thread.
+	*/
+	uint32_t GetThreadCount() const;
+
+private:
+	bool mIsRunning;
+};
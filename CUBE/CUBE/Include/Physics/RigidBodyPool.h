@@ -0,0 +1,91 @@
+#pragma once
+#include "Math\Vector3.h"
+#include "Math\Quaternion.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace Atlas
+{
+	class FGameObject;
+}
+
+/**
+* Fixed set of game objects with rigidbodies that are spawned and despawned
+* instead of created and destroyed, so short lived bodies such as projectiles
+* pay for their components once. Despawned objects are inactive, so they are
+* neither drawn nor simulated.
+*
+* Spawning with every object in use takes back the least recently spawned
+* one, and awake bodies past the active budget are despawned oldest first.
+* The pool must only be used between physics steps, such as from behaviors.
+*/
+class FRigidBodyPool
+{
+public:
+	using SetupFunction = std::function<void(Atlas::FGameObject&)>;
+
+	// Awake bodies kept before the oldest are despawned
+	static const uint32_t DEFAULT_ACTIVE_BUDGET = 32;
+
+	FRigidBodyPool();
+
+	FRigidBodyPool(const FRigidBodyPool& Other) = delete;
+	FRigidBodyPool& operator=(const FRigidBodyPool& Other) = delete;
+
+	/**
+	* Creates every object of the pool, each with a rigidbody. Objects start despawned.
+	* @param Creator - The game object that creates the pooled objects.
+	* @param Size - The number of objects, the most that are spawned at once.
+	* @param Setup - Adds the rest of an object's components, called once per object.
+	*/
+	void Create(Atlas::FGameObject& Creator, const uint32_t Size, const SetupFunction& Setup);
+
+	/**
+	* Spawns an object, taking back the least recently spawned one if none are free.
+	* @param Position - World position of the object.
+	* @param Velocity - Starting linear velocity of the rigidbody.
+	* @return The spawned object.
+	*/
+	Atlas::FGameObject& Spawn(const Vector3f& Position, const Vector3f& Velocity);
+
+	/**
+	* Spawns an object facing a rotation, such as one whose state was saved.
+	* @param AngularVelocity - Starting angular velocity of the rigidbody.
+	*/
+	Atlas::FGameObject& Spawn(const Vector3f& Position, const FQuaternion& Rotation, const Vector3f& Velocity, const Vector3f& AngularVelocity);
+
+	/**
+	* Despawns a spawned object of the pool.
+	*/
+	void Despawn(Atlas::FGameObject& GameObject);
+
+	/**
+	* Despawns the least recently spawned awake bodies past the active budget.
+	* This should be called once per frame.
+	*/
+	void Update();
+
+	/**
+	* Sets the most awake bodies the pool keeps spawned.
+	*/
+	void SetActiveBudget(const uint32_t Budget) { mActiveBudget = Budget; }
+
+	/**
+	* Number of objects currently spawned.
+	*/
+	uint32_t GetSpawnedCount() const { return mSpawned.size(); }
+
+private:
+	/**
+	* Makes an object inactive and stops its body.
+	*/
+	void Deactivate(Atlas::FGameObject& GameObject);
+
+private:
+	std::deque<Atlas::FGameObject*>  mSpawned; // Least recently spawned first
+	std::vector<Atlas::FGameObject*> mFree;
+	uint32_t                         mActiveBudget;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "../FileIO/GenericFile.h"
+
+#include <cstdint>
+#include <string>
+
+/**
+* Wrapper class for file descriptor operations on POSIX platforms.
+*/
+class FPosixHandle : public IFileHandle
+{
+public:
+	/**
+	* Constructs a handle owning an open file descriptor.
+	*/
+	FPosixHandle(const int FileDescriptor = -1);
+
+	~FPosixHandle();
+
+	FPosixHandle(const FPosixHandle& Other) = delete;
+	FPosixHandle& operator=(const FPosixHandle& Other) = delete;
+
+	bool Read(uint8_t* DataOut, uint32_t NumBytesToRead) override;
+
+	bool Write(const uint8_t* Data, const uint32_t NumBytesToWrite) override;
+
+	bool ReadAt(const uint64_t Offset, uint8_t* DataOut, const uint32_t NumBytesToRead) override;
+
+	bool WriteAt(const uint64_t Offset, const uint8_t* Data, const uint32_t NumBytesToWrite) override;
+
+	bool Seek(const uint64_t Distance) override;
+
+	bool SeekFromEnd(const uint64_t Distance) override;
+
+	bool SeekFromStart(const uint64_t Distance) override;
+
+	uint32_t GetFileSize() const override;
+
+	bool Flush() override;
+
+private:
+	/**
+	* Moves the current file offset a specified distance based on
+	* a specified whence.
+	* @return True if the seek succeeded.
+	*/
+	bool FileSeek(const int64_t Distance, const int Whence);
+
+private:
+	int mFileDescriptor;
+};
+
+/**
+* Memory mapped file on POSIX platforms.
+*/
+class FPosixMappedFile : public IMappedFile
+{
+public:
+	/**
+	* Maps an open file. Takes ownership of the file descriptor.
+	* @param ReadOnly - True if the descriptor only has read access.
+	*/
+	FPosixMappedFile(const int FileDescriptor, const bool ReadOnly);
+
+	~FPosixMappedFile();
+
+	FPosixMappedFile(const FPosixMappedFile& Other) = delete;
+	FPosixMappedFile& operator=(const FPosixMappedFile& Other) = delete;
+
+	uint8_t* GetData() override;
+
+	uint32_t GetFileSize() const override;
+
+	bool Resize(const uint32_t NewSize) override;
+
+	bool Flush() override;
+
+private:
+	/**
+	* Maps the whole file. Empty files are not mapped.
+	* @return True if the mapping succeeded.
+	*/
+	bool Map();
+
+	/**
+	* Releases the current mapping.
+	*/
+	void Unmap();
+
+private:
+	int      mFileDescriptor;
+	uint8_t* mData;
+	uint32_t mFileSize;
+	bool     mReadOnly;
+};
+
+/**
+* Wrapper class for file operations on POSIX platforms. Wide paths are
+* converted to UTF-8.
+*/
+class FPosixFileSystem : public IFileSystem
+{
+public:
+	FPosixFileSystem();
+	~FPosixFileSystem() = default;
+
+	std::unique_ptr<IFileHandle> OpenWritable(const wchar_t* FileName, const bool AllowShareRead = false, const bool CreateNew = false) override;
+	std::unique_ptr<IFileHandle> OpenReadable(const wchar_t* Filename) override;
+	std::unique_ptr<IFileHandle> OpenReadWritable(const wchar_t* FileName, const bool AllowRead = false, const bool CreateNew = false) override;
+	std::unique_ptr<IMappedFile> OpenMapped(const wchar_t* Filename, const bool CreateNew = false, const bool ReadOnly = false) override;
+
+	bool DeleteFilename(const wchar_t* Filename) override;
+
+	bool CopyFilename(const wchar_t* From, const wchar_t* To) override;
+
+	bool ReplaceFilename(const wchar_t* From, const wchar_t* To) override;
+
+	bool CurrentDirectory(wchar_t* DataOut, const uint32_t BufferLength) override;
+
+	bool DeleteDirectory(const wchar_t* DirectoryName) override;
+
+	bool RenameDirectory(const wchar_t* CurrentName, const wchar_t* NewName) override;
+
+	bool CreateFileDirectory(const wchar_t* DirectoryName) override;
+
+	bool GetProgramDirectory(wchar_t* DataOut, const uint32_t BufferLength) override;
+
+	bool SetDirectory(const wchar_t* DirectoryName) override;
+
+	bool FileExists(const wchar_t* Filename) override;
+
+	bool SetToProgramDirectory() override;
+
+	bool CopyFileDirectory(const wchar_t* From, const wchar_t* To) override;
+
+private:
+	void SetProgramDirectory();
+
+	/**
+	* Opens a file descriptor, printing the error if it fails.
+	* @return The descriptor, or -1 if the open failed.
+	*/
+	int OpenDescriptor(const wchar_t* Filename, const int Flags);
+};
+
+using FFileHandle = FPosixHandle;
+using FFileSystem = FPosixFileSystem;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <cstdint>
+
+#include "Memory\MemoryStats.h"
+
+/**
+* The block textures of FBlockTypes in one GL_TEXTURE_2D_ARRAY, so chunks of
+* every block type are drawn in a single batch without binding textures. Each
+* texture is a layer of the array, with its mipmaps built on the CPU so the
+* array can be stored compressed. The layer of each face of each block type is
+* uploaded to a storage buffer, which DeferredChunkRender.vert indexes by block
+* type and normal id.
+*/
+class FBlockTextureArray
+{
+public:
+	FBlockTextureArray();
+
+	/**
+	* Deletes the array and the face layers.
+	*/
+	~FBlockTextureArray();
+
+	FBlockTextureArray(const FBlockTextureArray& Other) = delete;
+	FBlockTextureArray& operator=(const FBlockTextureArray& Other) = delete;
+
+	/**
+	* Uploads the textures and face layers of every block type, replacing the previous
+	* upload, and binds them to GLTextureBindings::BlockTextures and their storage block.
+	* @param IsCompressed - If the array is stored as DXT5, a quarter of the memory. Ignored
+	*                       when the driver doesn't support S3TC.
+	*/
+	void Upload(const bool IsCompressed);
+
+	/**
+	* If the textures were uploaded.
+	*/
+	bool IsUploaded() const { return mTexture != 0; }
+
+	/**
+	* If the uploaded array is stored compressed.
+	*/
+	bool IsCompressed() const { return mIsCompressed; }
+
+private:
+	GLuint        mTexture;
+	GLuint        mFaceBuffer;   // Texture layer of each face of each block type
+	FTrackedBytes mBytes;        // Size of the array and its mipmaps
+	bool          mIsCompressed;
+};
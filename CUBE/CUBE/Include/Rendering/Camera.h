@@ -16,6 +16,10 @@ public:
 public:
 	FTransform Transform;
 
+	// Degrees the view turns per pixel of mouse movement made after the frame
+	// is extracted, like the camera will when it next updates. 0 if it doesn't.
+	float LateLookSpeed;
+
 public:
 	/**
 	* Constructs a camera at world origin.
@@ -31,7 +35,7 @@ public:
 	FCamera& operator=(const FCamera& Other) = default;
 
 	/**
-	* Get the view projection used by this camera.
+	* Set the view projection used by this camera, which has reversed depth like FPerspectiveMatrix.
 	*/
 	void SetProjection(const FMatrix4& NewProjection);
 
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Common.h"
+#include "Math\Matrix4.h"
+#include "Math\Vector3.h"
+#include "Rendering\DepthRenderTarget.h"
+#include "Rendering\ShaderProgram.h"
+#include "ChunkSystems\ChunkDrawList.h"
+
+class FChunkManager;
+struct FRenderView;
+
+/**
+* Shadows of a directional light over the view of the main camera. The view is
+* split into cascades that grow with distance, each with its own shadow map.
+* A cascade is fit to the bounding sphere of its part of the view, and snapped
+* to steps in light space, so it holds still while the camera turns and only
+* moves in whole steps. A cascade is only rendered again when it moves, the
+* light turns, or a chunk inside it is loaded, unloaded or remeshed.
+* Only chunks cast shadows.
+*/
+WIN_ALIGN(16)
+class FCascadedShadowMap
+{
+public:
+	static const uint32_t CASCADE_COUNT = 3;
+
+	// Texels on each side of a cascade's shadow map
+	static const uint32_t RESOLUTION = 2048;
+
+public:
+	FCascadedShadowMap();
+
+	FCascadedShadowMap(const FCascadedShadowMap& Other) = delete;
+	FCascadedShadowMap& operator=(const FCascadedShadowMap& Other) = delete;
+
+	/**
+	* Fits each cascade to the view of the main camera, and renders the ones
+	* that changed. Must be called after the chunk manager prepared its render
+	* list for the frame. Leaves depth testing and blending as it found them.
+	* @param ChunkManager - The chunks casting shadows.
+	* @param View - The view of the frame.
+	* @param LightDirection - The normalized direction the light shines in.
+	*/
+	void Update(FChunkManager& ChunkManager, const FRenderView& View, const Vector3f& LightDirection);
+
+	/**
+	* Binds the shadow map of each cascade, and sets the uniforms reading them
+	* from view space. The program must be active.
+	* @param Program - The lighting program sampling the shadows.
+	* @param View - The view the cascades were fit to.
+	*/
+	void Bind(FShaderProgram& Program, const FRenderView& View) const;
+
+	/**
+	* Sets how far from the camera shadows reach. Every cascade is rendered again.
+	* @param Distance - The view depth where the last cascade ends.
+	*/
+	void SetShadowDistance(const float Distance);
+
+	/**
+	* How far from the camera shadows reach.
+	*/
+	float GetShadowDistance() const { return mShadowDistance; }
+
+private:
+	WIN_ALIGN(16)
+	struct Cascade
+	{
+		FMatrix4                            ViewProjection; // World space to the clip space of the light
+		std::unique_ptr<FDepthRenderTarget> Target;
+		Vector3f                            Center;         // Snapped center in the space of the light
+		Vector3f                            LightDirection; // Direction the cascade was rendered with
+		float                               Radius;
+		float                               SplitDepth;     // View depth where the cascade ends
+		uint64_t                            Signature;      // Of the chunks rendered into the cascade
+		bool                                IsValid;        // False until rendered
+	};
+
+private:
+	Cascade               mCascades[CASCADE_COUNT];
+	FShaderProgram        mDepthProgram;
+	FShaderProgram::UniformHandle mViewProjectionUniform;
+	FChunkDrawList        mDrawList;       // Draws of the cascade being rendered
+	std::vector<uint32_t> mCasters;        // Chunks inside the cascade being fit, reused each update
+	float                 mShadowDistance;
+};
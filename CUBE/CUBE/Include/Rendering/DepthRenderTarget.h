@@ -4,10 +4,12 @@
 #include <GL\glew.h>
 
 #include "Math\Vector2.h"
+#include "Memory\MemoryStats.h"
 
 /**
 * A framebuffer processes and saves depth
 * information to a texture of a rendered scene.
+* Written with standard, negative one to one depth, nearer depths passing.
 */
 class FDepthRenderTarget
 {
@@ -25,15 +27,15 @@ public:
 	void StartWrite();
 
 	/**
-	* Disables the depth texture for writing.
+	* Disables the depth texture for writing, binding the framebuffer
+	* and clip depth mode that were in use when writing started.
 	* @param DefaultViewPort - The gl viewport to return to.
 	*/
 	void EndWrite(const Vector2ui DefaultViewPort);
 
 	/**
 	* Enables the depth texture to be read from
-	* in the shader pipeline.
-	* @param ActiveTexture - The texture unit to bind to.
+	* in the shader pipeline, on the unit set with SetTextureUnit.
 	*/
 	void StartRead();
 	
@@ -52,12 +54,18 @@ public:
 	*/
 	Vector2ui GetResolution() const { return mTextureResolution; }
 
+	/**
+	* Sets the texture unit StartRead binds to, as an index from GL_TEXTURE0.
+	*/
 	void SetTextureUnit(const GLenum ActiveTexture) { mActiveTexture = ActiveTexture; }
 
 private:
 	GLuint      mFrameBuffer;
+	GLuint      mPreviousFrameBuffer; // Bound before StartWrite
+	GLenum      mPreviousClipDepth;   // Set before StartWrite
 	GLuint      mDepthTexture;
 	GLenum      mActiveTexture;
 	Vector2ui   mTextureResolution;
+	FTrackedBytes mTextureBytes;
 };
 
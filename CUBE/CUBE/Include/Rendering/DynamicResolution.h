@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include "Debugging\GPUProfiler.h"
+
+/**
+* Picks the scale the scene is rendered at from the GPU time of recent frames,
+* to keep frames within a time budget. The scale drops as far as the time
+* over budget needs as soon as frames run over, and only climbs back a step
+* at a time once they are well under, so it holds still in between instead of
+* flickering. Each change waits for frames rendered at the new scale to be
+* measured before the next.
+*/
+class FDynamicResolution
+{
+public:
+	FDynamicResolution();
+
+	/**
+	* Feeds the most recently measured frame. Frames already fed are ignored.
+	* @param Frame - The last frame resolved by the GPU profiler, or null if none was yet.
+	*/
+	void Update(const FDebug::GPUProfiler::FrameResult* Frame);
+
+	/**
+	* Sets if the scale follows the frame time. Disabling goes back to the full resolution.
+	*/
+	void SetEnabled(const bool Flag);
+
+	bool IsEnabled() const { return mIsEnabled; }
+
+	/**
+	* Sets the GPU time a frame should take.
+	* @param Milliseconds - The budget, 1000 / 60 to keep 60 Hz.
+	*/
+	void SetBudget(const float Milliseconds);
+
+	float GetBudget() const { return mBudget; }
+
+	/**
+	* The scale of each axis of the screen resolution to render at, in (0, 1].
+	*/
+	float GetScale() const { return mScale; }
+
+private:
+	float    mBudget;       // In milliseconds
+	float    mScale;
+	float    mFrameTime;    // Smoothed GPU time of recent frames, in milliseconds
+	uint64_t mLastFrame;    // The last frame fed
+	uint32_t mSettleFrames; // Frames left before the scale may change again
+	bool     mHasFrame;
+	bool     mIsEnabled;
+};
@@ -10,7 +10,7 @@ namespace GLAttributePosition
 		Normal = 1,
 		Color = 2,
 		UV = 3,
-		ChunkData = 4,
+		ChunkOrigin = 5,
 	};
 }
 
@@ -20,7 +20,9 @@ namespace GLUniformBindings
 	{
 		ProjectionInfoBlock = 1,
 		TransformBlock = 2,
+		GBufferLayoutBlock = 3,
 		ResolutionBlock = 4,
+		BlockVolumeBlock = 5,
 		FogParamBlock = 8,
 		PointLight = 10,
 		DirectionalLight = 11,
@@ -40,5 +42,11 @@ namespace GLTextureBindings
 		SSAOSamples = 5,
 		SSAONoise = 6,
 		SSAOTexture = 7,
+		HiZ = 8,
+		ShadowCascades = 9, // First of FCascadedShadowMap::CASCADE_COUNT units
+		SSAODepth = 12,
+		BlockVolume = 13,
+		BlockTextures = 14,
+		RenderTargetPool = 15, // Bound to while FRenderTargetPool creates targets
 	};
 }
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <cstdint>
+
+/**
+* Shadow of the OpenGL state changed most often while rendering a frame. Calls
+* setting state that is already current are filtered out before reaching the
+* driver. Code changing this state directly, such as third party libraries,
+* must call Invalidate afterwards so the next call is always issued.
+* Must only be used from the thread owning the GL context.
+*/
+class SGLState
+{
+public:
+	/**
+	* Number of state calls made through this class over a frame.
+	*/
+	struct FrameStats
+	{
+		uint32_t Issued;   // Calls passed on to OpenGL
+		uint32_t Filtered; // Calls dropped because the state was already set
+	};
+
+	// Texture units with cached bindings, higher units are always issued
+	static const uint32_t TEXTURE_UNIT_COUNT = 16;
+
+public:
+	SGLState() = delete;
+
+	static void UseProgram(const GLuint Program);
+
+	static void BindVertexArray(const GLuint VertexArray);
+
+	/**
+	* Binds a framebuffer for both drawing and reading.
+	*/
+	static void BindFramebuffer(const GLuint Framebuffer);
+
+	/**
+	* The framebuffer bound for drawing, only querying OpenGL when it isn't known.
+	*/
+	static GLuint GetFramebuffer();
+
+	/**
+	* Binds a texture to a texture unit, leaving that unit active.
+	* @param Unit - The index of the unit, not offset by GL_TEXTURE0.
+	* @param Target - The texture target, such as GL_TEXTURE_2D.
+	* @param Texture - The texture to bind.
+	*/
+	static void BindTexture(const uint32_t Unit, const GLenum Target, const GLuint Texture);
+
+	/**
+	* Sets the active texture unit.
+	* @param Unit - The index of the unit, not offset by GL_TEXTURE0.
+	*/
+	static void ActiveTexture(const uint32_t Unit);
+
+	/**
+	* Enables a capability. Capabilities without a cached state are passed through.
+	*/
+	static void Enable(const GLenum Capability);
+
+	/**
+	* Disables a capability. Capabilities without a cached state are passed through.
+	*/
+	static void Disable(const GLenum Capability);
+
+	/**
+	* Whether a capability is enabled, only querying OpenGL when the state isn't known.
+	*/
+	static bool IsEnabled(const GLenum Capability);
+
+	static void BlendFunc(const GLenum Source, const GLenum Destination);
+
+	static void BlendEquation(const GLenum Mode);
+
+	static void DepthFunc(const GLenum Function);
+
+	/**
+	* Sets the depth range clip space maps to, keeping the lower left origin.
+	* @param Mode - GL_NEGATIVE_ONE_TO_ONE or GL_ZERO_TO_ONE.
+	*/
+	static void ClipDepthMode(const GLenum Mode);
+
+	/**
+	* The clip depth mode, only querying OpenGL when it isn't known.
+	*/
+	static GLenum GetClipDepthMode();
+
+	/**
+	* Forgets all cached state, so each following call is issued. Must be called
+	* after the state was changed without going through this class, or a bound
+	* object was deleted. Called at the start of each frame.
+	*/
+	static void Invalidate();
+
+	/**
+	* Ends the counting of the current frame.
+	*/
+	static void EndFrame();
+
+	/**
+	* The calls made over the last ended frame.
+	*/
+	static FrameStats GetLastFrameStats() { return LastFrameStats; }
+
+private:
+	// Capabilities with a cached state
+	enum CachedCapability : uint32_t
+	{
+		Blend,
+		DepthTest,
+		CullFace,
+		ScissorTest,
+		PolygonOffsetFill,
+		CapabilityCount,
+		Uncached = CapabilityCount
+	};
+
+	static CachedCapability GetCachedCapability(const GLenum Capability);
+
+	static void SetEnabled(const GLenum Capability, const bool ShouldEnable);
+
+	/**
+	* Counts a call, returning true if it must be issued.
+	*/
+	static bool CountCall(const bool IsRedundant);
+
+private:
+	static GLuint   Program;
+	static GLuint   VertexArray;
+	static GLuint   Framebuffer;
+	static uint32_t ActiveUnit;
+	static GLenum   TextureTargets[TEXTURE_UNIT_COUNT];
+	static GLuint   Textures[TEXTURE_UNIT_COUNT];
+	static int8_t   Capabilities[CapabilityCount]; // 1 if enabled, 0 if disabled, -1 if unknown
+	static GLenum   BlendSource;
+	static GLenum   BlendDestination;
+	static GLenum   BlendMode;
+	static GLenum   DepthFunction;
+	static GLenum   ClipDepth;
+
+	static FrameStats CurrentFrameStats;
+	static FrameStats LastFrameStats;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <GL\glew.h>
+#include "Rendering\GLState.h"
 #include <cstdint>
 #include <cstdlib>
 #include <iostream>
@@ -74,12 +75,12 @@ namespace GLUtils
 	{
 		ArrayBinder(GLuint ArrayID)
 		{
-			glBindVertexArray(ArrayID);
+			SGLState::BindVertexArray(ArrayID);
 		}
 
 		~ArrayBinder()
 		{
-			glBindVertexArray(0);
+			SGLState::BindVertexArray(0);
 		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <cstdint>
+#include <vector>
+
+#include "Rendering\ShaderProgram.h"
+#include "Math\Matrix4.h"
+#include "Math\Vector2.h"
+#include "Math\Sphere.h"
+#include "Memory\MemoryUtil.h"
+#include "Memory\MemoryStats.h"
+
+/**
+* A depth pyramid where each level holds the farthest depth of the
+* texels it covers in the level below. Built from the depth buffer at the
+* end of a frame and used the following frame for occlusion tests. The view
+* projection that rendered the depth is kept with the pyramid, so tests can
+* project bounds into the same space.
+* A coarse level of each build is also read back to the CPU without
+* stalling, arriving a frame or two later, to test objects on the CPU.
+*/
+WIN_ALIGN(16)
+class FHiZBuffer
+{
+public:
+	ALIGNED_ALLOC(16);
+
+	FHiZBuffer();
+
+	/**
+	* Deletes the pyramid texture.
+	*/
+	~FHiZBuffer();
+
+	FHiZBuffer(const FHiZBuffer& Other) = delete;
+	FHiZBuffer& operator=(const FHiZBuffer& Other) = delete;
+
+	/**
+	* Allocates the pyramid for a depth buffer resolution. The
+	* pyramid is invalid until it is built.
+	* @param Resolution - The resolution of the depth buffer.
+	*/
+	void Allocate(const Vector2ui& Resolution);
+
+	/**
+	* Builds every level of the pyramid from a depth texture.
+	* @param DepthTexture - Depth texture with the allocated resolution.
+	* @param RenderResolution - How much of the texture was rendered to, from the bottom left.
+	*                           Depth outside it must be cleared to the far plane.
+	* @param ViewProjection - The view projection the depth was rendered with.
+	*/
+	void Build(const GLuint DepthTexture, const Vector2ui& RenderResolution, const FMatrix4& ViewProjection);
+
+	/**
+	* Binds the pyramid to its texture unit, GLTextureBindings::HiZ.
+	*/
+	void Bind() const;
+
+	/**
+	* If the pyramid holds depth from a previous build.
+	*/
+	bool IsValid() const { return mIsValid; }
+
+	/**
+	* The view projection used to render the depth held by the pyramid.
+	*/
+	const FMatrix4& GetViewProjection() const { return mViewProjection; }
+
+	/**
+	* Scales screen coordinates in [0, 1] to the part of the pyramid that was rendered to.
+	*/
+	const Vector2f& GetUVScale() const { return mUVScale; }
+
+	/**
+	* Tests a sphere against the latest level read back to the CPU, projected with the
+	* view projection that level was rendered with.
+	* @param Sphere - World space bounds.
+	* @return True if the sphere is certainly behind the depth, false if it may be
+	*         visible or no level was read back yet.
+	*/
+	bool IsSphereOccluded(const FSphere& Sphere) const;
+
+private:
+	/**
+	* Starts reading back the coarse level of the pyramid just built.
+	*/
+	void QueueReadback();
+
+	/**
+	* Copies out the newest finished readback, without waiting.
+	*/
+	void ResolveReadbacks();
+
+	/**
+	* Deletes the readback buffers and fences, dropping every readback.
+	*/
+	void ReleaseReadbacks();
+
+private:
+	// Readbacks in flight, the oldest is next to finish
+	static const uint32_t READBACK_COUNT = 3;
+
+	struct Readback
+	{
+		GLuint   Buffer;
+		GLsync   Fence; // Null when not in flight
+		FMatrix4 ViewProjection;
+		Vector2f UVScale;
+	};
+
+	Readback       mReadbacks[READBACK_COUNT];
+	uint32_t       mNextReadback;
+	uint32_t       mReadbackLevel;
+	Vector2ui      mReadbackSize;
+
+	// The latest readback. Only changed by Build, so can be read while no build runs.
+	std::vector<float> mCPUDepth;
+	FMatrix4           mCPUViewProjection;
+	Vector2f           mCPUUVScale;
+	bool               mHasCPUDepth;
+
+private:
+	FMatrix4       mViewProjection;
+	Vector2f       mUVScale;
+	FShaderProgram mDownsampleProgram;
+	Vector2ui      mResolution;
+	GLuint         mTexture;
+	uint32_t       mLevelCount;
+	bool           mIsValid;
+	FTrackedBytes  mTextureBytes; // Size of the mip chain and readback buffers
+};
@@ -10,6 +10,8 @@ public:
 
 	void OnPostLightingPass() override;
 
+	const char* GetName() const override { return "EdgeDetection"; }
+
 private:
 	FShaderProgram mShader;
 };
@@ -15,6 +15,10 @@ public:
 
 	void OnPostLightingPass() override;
 
+	const char* GetName() const override { return "Fog"; }
+
+	const char* GetCompositeStage() const override { return "FogComposite"; }
+
 	void SetColor(const Vector3f& Color);
 	void SetDensity(const float Density);
 	void SetBounds(const float Min, const float Max);
@@ -1,5 +1,8 @@
 #pragma once
 
+class FShaderProgram;
+class FRenderTargetPool;
+
 class IImageEffect
 {
 public:
@@ -10,5 +13,33 @@ public:
 	virtual void OnPreLightingPass(){}
 	virtual void OnPostLightingPass(){}
 	virtual void OnPostGUIPass(){}
+
+	/**
+	* Called once the effect is added to a render system.
+	* @param RenderTargets - The pool the effect takes the targets it draws to from while frames
+	*                        are submitted, which outlives the effect.
+	*/
+	virtual void OnAdded(FRenderTargetPool& RenderTargets){}
+
+	/**
+	* The name the effect's passes are profiled under.
+	*/
+	virtual const char* GetName() const { return "ImageEffect"; }
+
+	/**
+	* Effects whose post lighting pass only scales and offsets the lit scene
+	* may be composited with their neighbours in one pass, which decodes the
+	* GBuffer once for all of them. Such an effect names its stage, defined in
+	* Shaders/<Stage>.glsl as described in CompositeCommon.glsl.
+	* @return The name of the stage, or null if the effect has its own pass.
+	*/
+	virtual const char* GetCompositeStage() const { return nullptr; }
+
+	/**
+	* Called instead of OnPostLightingPass when the effect is composited.
+	* Renders anything the stage reads, and sets the stage's uniforms.
+	* @param Program - The composite program, which isn't active.
+	*/
+	virtual void OnComposite(FShaderProgram& Program){}
 };
 
@@ -0,0 +1,45 @@
+#pragma once
+#include "IImageEffect.h"
+#include "Rendering\ShaderProgram.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+* Runs the post lighting passes of image effects in order. Each run of two or
+* more effects with a composite stage is fused into one full screen pass,
+* with a program generated from their stages. The stages read one decoded
+* pixel, and their results are blended onto the scene with dual source
+* blending, so the fused pass draws the same image as the separate ones.
+*/
+class FPostProcessGraph
+{
+public:
+	FPostProcessGraph();
+	~FPostProcessGraph();
+
+	FPostProcessGraph(const FPostProcessGraph& Other) = delete;
+	FPostProcessGraph& operator=(const FPostProcessGraph& Other) = delete;
+
+	/**
+	* Runs the post lighting pass of each effect, in order.
+	* @param Effects - The active effects.
+	*/
+	void RunPostLightingPass(const std::vector<IImageEffect*>& Effects);
+
+private:
+	/**
+	* Runs effects that all have composite stages in one pass.
+	*/
+	void RunComposite(IImageEffect* const* Effects, const uint32_t Count);
+
+	/**
+	* Gets the program fusing the stages of effects, generating it the first time.
+	*/
+	FShaderProgram& GetCompositeProgram(IImageEffect* const* Effects, const uint32_t Count);
+
+private:
+	std::map<std::string, std::unique_ptr<FShaderProgram>> mPrograms; // Keyed by the names of their stages
+};
@@ -5,17 +5,46 @@
 #include "Math\Vector2.h"
 #include "Math\Vector3.h"
 
+/**
+* Screen space ambient occlusion. Below full quality, depth is first reduced
+* to the occlusion resolution, so the kernel samples a small linear depth
+* texture instead of the full depth buffer. The occlusion is then blurred up
+* to the screen with weights that fall off across depth edges. The depth and
+* occlusion targets are taken from the render system's pool each frame, so none
+* are held while the pass is off or traced.
+*/
 class FSSAOPostProcess : public IImageEffect
 {
 public:
 	static const uint32_t DEFAULT_KERNAL_SIZE = 16;
 	static const uint32_t DEFAULT_NOISE_SIZE = 4;
+
+	/**
+	* Resolution the occlusion pass runs at. Chunk meshes bake their own
+	* ambient occlusion, so the pass can be lowered or skipped.
+	*/
+	enum Quality : uint8_t
+	{
+		Off = 0,   // Ambient light only
+		Sixteenth, // Quarter width and quarter height
+		Quarter,   // Half width and half height
+		Full,
+		Traced     // No occlusion pass, short rays are traced through the chunk manager's block volume instead
+	};
 public:
 	FSSAOPostProcess();
 	~FSSAOPostProcess();
 
 	void OnPostLightingPass() override;
 
+	const char* GetName() const override { return "SSAO"; }
+
+	const char* GetCompositeStage() const override { return "SSAOComposite"; }
+
+	void OnComposite(FShaderProgram& Program) override;
+
+	void OnAdded(FRenderTargetPool& RenderTargets) override;
+
 	/**
 	* Sets the max radius that contributes
 	* to an object being occluded.
@@ -45,22 +74,39 @@ public:
 	*/
 	void SetGlobalAmbient(const Vector3f& Ambient);
 
+	/**
+	* Sets the resolution of the occlusion pass.
+	*/
+	void SetQuality(const Quality Mode);
+
 private:
 	void GenerateNoiseTexture(const uint32_t Size);
 	void GenerateSampleTexture(const uint32_t KernalSize);
-	void ResizeRenderTarget(const Vector2ui Size);
+
+	/**
+	* Sizes the targets taken each frame for a screen resolution.
+	*/
+	void ResizeRenderTarget(const Vector2ui Resolution);
+
+	/**
+	* Renders occlusion to the occlusion texture, read by the blur or composite stage.
+	* The targets are taken from the pool, and the occlusion is held until the frame ends.
+	*/
+	void RenderOcclusion();
 
 private:
-	struct
-	{
-		GLuint FBO;
-		GLuint mSSAOTex;
-	} mSSAOBuffer;
+	FRenderTargetPool* mRenderTargets; // Set once added to a render system
 
+	FShaderProgram mDepthDownsample;
 	FShaderProgram mSSAO;
 	GLuint         mNoiseTex;
 	GLuint         mSampleTex;
 
 	FShaderProgram mBlur;
+
+	Vector3f   mAmbient;
+	Quality    mQuality;
+	Vector2ui  mResolution;  // Screen resolution
+	Vector2ui  mSSAOSize;    // Resolution of the occlusion targets, drawn as far as the render resolution needs
 };
 
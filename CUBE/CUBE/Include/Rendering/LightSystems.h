@@ -1,12 +1,24 @@
 #pragma once
 #include "Atlas\System.h"
+#include "Atlas\SpatialIndex.h"
 #include "ShaderProgram.h"
 #include "UniformBlockStandard.h"
 #include "Camera.h"
 #include "DepthRenderTarget.h"
+#include "StreamingBuffer.h"
+#include "CascadedShadowMap.h"
+#include "Math\Sphere.h"
+#include "RenderPacket.h"
+#include "ImageEffects\IImageEffect.h"
+
+#include <vector>
 
 class FRenderSystem;
 
+/**
+* Shades one type of light. Lights are copied into the render packet on the
+* main thread, and shaded from it when the packet is submitted.
+*/
 class ILightSystem : public Atlas::ISystem
 {
 public:
@@ -17,6 +29,18 @@ public:
 	{
 	}
 
+	/**
+	* Copies the lights of the frame from their game objects. Runs alongside the other
+	* systems' extraction, so only the packet's lights of this type may be written.
+	* @param Packet - The packet of the frame, its view is already set.
+	*/
+	virtual void Extract(FRenderPacket& Packet) = 0;
+
+	/**
+	* The name the system's lighting is reported under.
+	*/
+	virtual const char* GetName() const = 0;
+
 protected:
 	FRenderSystem& mRenderSystem;
 	FShaderProgram mLightShader;
@@ -28,54 +52,122 @@ public:
 	FDirectionalLightSystem(Atlas::FWorld& World, FRenderSystem& RenderSystem);
 	~FDirectionalLightSystem();
 
+	void Extract(FRenderPacket& Packet) override;
 	void Update() override;
+	const char* GetName() const override { return "DirectionalLights"; }
+
+	/**
+	* Sets if the lights are shaded by the composite effect after lighting, Update
+	* only rendering their shadows then. Set before each Update.
+	*/
+	void SetComposited(const bool Flag) { mIsComposited = Flag; }
 
-private:
 	/**
-	* Structure of directional light struct
-	* used in shader buffer block.
+	* Shades the lights of the frame as a composite stage, so their pass can be fused
+	* with the post processes after lighting. Only run when composited, with lights in the packet.
 	*/
-#pragma pack (push, 1)
-	struct ShaderDirectionalLight
+	IImageEffect& GetCompositeEffect() { return mCompositeEffect; }
+
+private:
+	class FCompositeEffect : public IImageEffect
 	{
-		Vector3f  Direction;
-		uint32_t  Pad0;
-		Vector3f  Color;
+	public:
+		explicit FCompositeEffect(FDirectionalLightSystem& LightSystem) : mLightSystem(LightSystem) {}
+
+		void OnPostLightingPass() override;
+		void OnComposite(FShaderProgram& Program) override;
+
+		const char* GetName() const override { return "DirectionalLights"; }
+		const char* GetCompositeStage() const override { return "DirectionalComposite"; }
+
+	private:
+		FDirectionalLightSystem& mLightSystem;
 	};
-#pragma pack (pop)
+
+	/**
+	* Binds the lights and shadows of the frame, and makes a program running DirectionalComposite.glsl active.
+	*/
+	void BindLighting(FShaderProgram& Program);
 
 private:
-	FUniformBlock mLightUniformBuffer;
+	FCascadedShadowMap                  mShadowMap;   // Shadows of the first light
+	FStreamingBuffer                    mLightBuffer;
+	FCompositeEffect                    mCompositeEffect;
+	bool                                mIsComposited;
 };
 
+/**
+* Shades point lights with tiled deferred lighting. A compute pass bins the
+* visible lights into screen tiles and depth slices found from the depth
+* buffer, then one full screen pass shades each pixel with only the lights
+* binned to its tile and slice. Without compute shaders, each light is drawn
+* on its own, bounded by the screen rect of its volume.
+*/
 class FPointLightSystem : public ILightSystem
 {
 public:
+	enum class ShadingMode
+	{
+		Tiled,       // Lights binned into tiles, shaded in one pass
+		LightVolumes // A scissored draw for each light
+	};
+
 	FPointLightSystem(Atlas::FWorld& World, FRenderSystem& RenderSystem);
 	~FPointLightSystem();
 
+	void Extract(FRenderPacket& Packet) override;
 	void Update() override;
+	const char* GetName() const override { return "PointLights"; }
+
+	/**
+	* Sets how lights are shaded. Stays on light volumes if tiled shading is not supported.
+	* @param Mode - The shading mode.
+	*/
+	void SetShadingMode(const ShadingMode Mode);
+
+	/**
+	* How lights are shaded.
+	*/
+	ShadingMode GetShadingMode() const { return mShadingMode; }
+
+	/**
+	* If the hardware has the compute shaders needed for tiled shading.
+	*/
+	static bool IsTiledShadingSupported();
 
 private:
 	/**
-	* Structure of point light struct
-	* used in shader buffer block.
+	* Bins the visible lights into tiles, then shades them in one pass.
 	*/
-#pragma pack (push, 1)
-	struct ShaderPointLight
-	{
-		Vector3f  Position;
-		uint32_t  Pad0;
-		Vector3f  Color;
-		float     Constant;
-		float     Linear;
-		float     Quadratic;
-		float     Intensity;
-	};
-#pragma pack (pop)
+	void RenderTiled(const std::vector<FRenderPacket::PointLight>& Lights);
+
+	/**
+	* Shades each visible light within the screen rect of its volume.
+	*/
+	void RenderLightVolumes(const FRenderView& View, const std::vector<FRenderPacket::PointLight>& Lights);
+
+	/**
+	* Grows the tile buffers to hold at least a number of tiles.
+	*/
+	void AllocateTiles(const uint32_t TileCount);
+
+	void OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent) override;
+	void OnGameObjectRemove(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent) override;
 
 private:
-	FUniformBlock mUniformBuffer;
+	ShadingMode                      mShadingMode;
+	FShaderProgram                   mCullingProgram;
+	FShaderProgram                   mVolumeShader;
+	FShaderProgram::UniformHandle    mLightIndexUniform;
+	FStreamingBuffer                 mLightBuffer;     // Visible lights of each frame
+	GLuint                           mTileInfoBuffer;
+	GLuint                           mTileLightBuffer;
+	uint32_t                         mTileCapacity;    // Tiles the tile buffers have room for
+	Atlas::FSpatialIndex             mLightIndex;      // Every light, hashed by chunk
+	std::vector<Atlas::FGameObject*> mFrustumLights;   // Lights the index found in the view, reused each extract
+	std::vector<FSphere>             mLightVolumes;    // World space volume of each light in mFrustumLights
+	std::vector<uint8_t>             mLightVisibility; // Occlusion test result for each light volume
+	std::vector<Vector3f>            mLightPositions;  // Positions of the visible lights, transformed to view space together
 };
 
 //class FSpotLightSystem : public Atlas::ISystem
@@ -59,6 +59,13 @@ public:
 	*/
 	void RenderB(const GLenum RenderMode = GL_TRIANGLES);
 
+	/**
+	* Renders several instances of the vertex data in one draw.
+	* @param InstanceCount - The number of instances to draw.
+	* @param RenderMode - The OpenGL render mode.
+	*/
+	void RenderInstancedB(const uint32_t InstanceCount, const GLenum RenderMode = GL_TRIANGLES);
+
 	/**
 	* Adds a vertex to the mesh.
 	* @param Vertex to add.
@@ -261,6 +268,14 @@ public:
 	*/
 	void Render(const GLenum RenderMode = GL_TRIANGLES);
 
+	/**
+	* Renders several instances of the vertex data in one draw.
+	* Shaders tell the instances apart with gl_InstanceID.
+	* @param InstanceCount - The number of instances to draw.
+	* @param RenderMode - The OpenGL render mode.
+	*/
+	void RenderInstanced(const uint32_t InstanceCount, const GLenum RenderMode = GL_TRIANGLES);
+
 	/**
 	* Adds a vertex to the mesh.
 	* @param Vertex to add.
@@ -84,6 +84,12 @@ inline void TMesh<T>::Render(const GLenum RenderMode)
 	RenderB(RenderMode);
 }
 
+template <typename T>
+inline void TMesh<T>::RenderInstanced(const uint32_t InstanceCount, const GLenum RenderMode)
+{
+	RenderInstancedB(InstanceCount, RenderMode);
+}
+
 template <typename T>
 inline uint32_t TMesh<T>::AddVertex(const VertexType& Vertex)
 {
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math\Vector3.h"
+#include "Rendering\Mesh.h"
+
+struct MeshVertex;
+
+/**
+* Cooked object meshes. A cooked asset holds the vertices and indices of a model
+* in the MeshVertex layout, so it's mapped and uploaded as is instead of being
+* parsed. Models are cooked offline with Cook, or the CookMesh console command.
+* Assets are versioned and sized for the vertex layout they were cooked with,
+* any other asset fails to load and its model must be cooked again.
+*/
+class SMeshAsset
+{
+public:
+	SMeshAsset() = delete;	// Not meant for instantiation
+
+	/**
+	* Parses a .obj model into MeshVertex vertices and indices.
+	* @param ModelFilepath - The model to parse.
+	* @return False if the model couldn't be parsed.
+	*/
+	static bool ReadOBJ(const char* ModelFilepath, std::vector<MeshVertex>& VerticesOut, std::vector<uint32_t>& IndicesOut);
+
+	/**
+	* Parses a .obj model and writes it as a cooked asset, replacing any asset of the same name.
+	* @param ModelFilepath - The model to cook.
+	* @param AssetFilename - The asset to write.
+	* @return False if the model couldn't be parsed or the asset couldn't be written.
+	*/
+	static bool Cook(const char* ModelFilepath, const wchar_t* AssetFilename);
+
+	/**
+	* Maps a cooked asset and uploads it to a mesh. The mesh keeps no local copy of the data.
+	* @param AssetFilename - The asset to load.
+	* @param MeshOut - The mesh to upload to.
+	* @param BoundsCenterOut - The center of the mesh's bounding sphere, computed when it was cooked.
+	* @param BoundsRadiusOut - The radius of the mesh's bounding sphere.
+	* @return False if the asset is missing, or was cooked with another version or vertex layout.
+	*/
+	static bool Load(const wchar_t* AssetFilename, TMesh<MeshVertex>& MeshOut, Vector3f& BoundsCenterOut, float& BoundsRadiusOut);
+
+	/**
+	* Reads and checks a cooked asset without touching GL, so it may run on any thread.
+	* @param AssetFilename - The asset to read.
+	* @param AssetOut - To put the bytes of the asset, uploaded later with Upload.
+	* @return False if the asset is missing, or was cooked with another version or vertex layout.
+	*/
+	static bool Read(const wchar_t* AssetFilename, std::vector<uint8_t>& AssetOut);
+
+	/**
+	* Uploads an asset returned by Read to a mesh, on the thread owning the GL context.
+	*/
+	static void Upload(const std::vector<uint8_t>& Asset, TMesh<MeshVertex>& MeshOut, Vector3f& BoundsCenterOut, float& BoundsRadiusOut);
+
+	/**
+	* Computes a sphere around the center of the box holding every vertex.
+	*/
+	static void ComputeBounds(const MeshVertex* Vertices, const uint32_t VertexCount, Vector3f& CenterOut, float& RadiusOut);
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Utils\Singleton.h"
+#include "Rendering\ShaderProgram.h"
+#include "ChunkSystems\BlockTypes.h"
+#include "Math\Vector3.h"
+#include "Math\Vector4.h"
+
+/**
+* Block debris simulated and drawn on the GPU. Bursts of particles are queued on
+* the main thread, then spawned by a compute pass into a ring of MAX_PARTICLES
+* slots, so the newest particles take the slots of the oldest once it is full.
+* Particles fall and bounce off the blocks of the chunk manager's block volume
+* where it holds them, and off the previous frame's depth and normals elsewhere.
+* They are drawn as small cubes colored by their block type with one instanced
+* draw into the G-Buffer, so they are lit like the terrain. Bursts of a closed
+* frame are kept apart, so bursts can be queued for the next frame while the
+* render thread submits the last.
+*/
+class FParticleSystem : public TSingleton<FParticleSystem>
+{
+public:
+	// Slots of the particle ring, 32 bytes each
+	static const uint32_t MAX_PARTICLES = 65536;
+
+	// Bursts spawned in a frame, later ones are dropped
+	static const uint32_t MAX_BURSTS_PER_FRAME = 64;
+
+	/**
+	* Particles thrown out from a point together.
+	*/
+	struct Burst
+	{
+		Vector3f             Position;
+		float                Radius;    // Particles start within this distance of the position
+		Vector3f             Velocity;  // Shared by every particle
+		float                Speed;     // Most speed each particle is thrown outward with, on top of Velocity
+		uint32_t             Count;
+		float                Lifetime;  // In seconds, staggered a little for each particle
+		FBlockTypes::BlockID BlockType; // Colors the particles
+	};
+
+public:
+	/**
+	* Creates the particle ring and loads the particle shaders.
+	*/
+	FParticleSystem();
+
+	/**
+	* Deletes every GL object held by the system.
+	*/
+	~FParticleSystem();
+
+	/**
+	* Queues a burst to spawn with the next closed frame. Does nothing while no
+	* particle system exists, as when headless. Only called on the main thread.
+	*/
+	static void Emit(const Burst& NewBurst);
+
+	/**
+	* Ends the frame, so the bursts queued so far are spawned by the next Simulate.
+	* @param DeltaTime - Seconds the particles are simulated for.
+	*/
+	void CloseFrame(const float DeltaTime);
+
+	/**
+	* Spawns the bursts of the last closed frame and moves every live particle.
+	* Called before the G-Buffer is cleared, while it and the transform block
+	* still hold the previous frame.
+	* @param DepthTexture - The previous frame's G-Buffer depth.
+	* @param GBufferTexture - The previous frame's G-Buffer surfaces, read for normals.
+	*/
+	void Simulate(const GLuint DepthTexture, const GLuint GBufferTexture);
+
+	/**
+	* Draws the live particles into the bound G-Buffer.
+	*/
+	void Render();
+
+	/**
+	* Slots of the ring that may hold live particles in the last closed frame.
+	*/
+	uint32_t GetLiveCount() const { return mFrameLiveCount; }
+
+private:
+	/**
+	* A burst as ParticleEmit.comp reads it.
+	*/
+	struct GPUBurst
+	{
+		Vector4f PositionRadius;
+		Vector4f VelocitySpeed;
+		uint32_t Offset; // First particle of the burst among those spawned in its frame
+		uint32_t Count;
+		uint32_t BlockType;
+		float    Lifetime;
+	};
+
+	/**
+	* The particles spawned in a frame, until the longest lived of them dies.
+	*/
+	struct SpawnedFrame
+	{
+		float    TimeLeft;
+		uint32_t Count;
+	};
+
+private:
+	std::vector<Burst>       mBursts;       // Queued for the next closed frame
+	std::vector<GPUBurst>    mFrameBursts;  // Of the closed frame, spawned by Simulate
+	std::deque<SpawnedFrame> mSpawnedFrames; // Oldest first, the live slots end at mNextSlot
+	FShaderProgram           mEmitProgram;
+	FShaderProgram           mSimulateProgram;
+	FShaderProgram           mRenderProgram;
+	GLuint                   mParticleBuffer;
+	GLuint                   mBurstBuffer;
+	GLuint                   mVertexArray;  // Holds no attributes, cubes are built from vertex ids
+	uint32_t                 mNextSlot;     // Slot the next spawned particle takes
+	uint32_t                 mFrameSpawnSlot;  // First slot spawned into by the closed frame
+	uint32_t                 mFrameSpawnCount;
+	uint32_t                 mFrameFirstLive;  // First slot that may hold a live particle
+	uint32_t                 mFrameLiveCount;
+	uint32_t                 mFrameSeed;
+	float                    mFrameDeltaTime;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <cstdint>
+#include <string>
+
+/**
+* On-disk cache of linked shader programs, so programs are loaded from the
+* driver's binary instead of being compiled and linked from source. Binaries
+* are keyed by a hash of their shader sources, and the driver they were made
+* with, since a driver only accepts its own binaries. Any binary the driver
+* rejects is treated as a miss, and the program is built from source.
+* Must only be used from the thread owning the GL context.
+*/
+class SProgramBinaryCache
+{
+public:
+	SProgramBinaryCache() = delete;
+
+	/**
+	* Starts the key of a program, from the driver in use.
+	*/
+	static uint64_t GetBaseKey();
+
+	/**
+	* Continues a key over a block of data, such as a shader's source.
+	*/
+	static uint64_t CombineKey(uint64_t Key, const void* Data, const size_t DataSize);
+
+	/**
+	* Loads a cached binary into a program.
+	* @param Key - The key of the program's sources.
+	* @param Program - The program to load into, which has no shaders attached.
+	* @return True if the program was loaded and linked.
+	*/
+	static bool Load(const uint64_t Key, const GLuint Program);
+
+	/**
+	* Saves the binary of a linked program, replacing any saved with the same key.
+	* The program must have been linked retrievable, see GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+	* @param Key - The key of the program's sources.
+	* @param Program - The linked program.
+	*/
+	static void Save(const uint64_t Key, const GLuint Program);
+
+	/**
+	* Whether the driver can save and load program binaries.
+	*/
+	static bool IsSupported();
+
+private:
+	static std::wstring GetFilename(const uint64_t Key);
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math\Matrix4.h"
+#include "Math\Quaternion.h"
+#include "Math\Vector2.h"
+#include "Math\Vector3.h"
+#include "Math\Frustum.h"
+#include "Memory\MemoryUtil.h"
+
+struct FObjectMesh;
+
+/**
+* The main camera, as it was when a frame was extracted.
+*/
+WIN_ALIGN(16)
+struct FRenderView
+{
+	ALIGNED_ALLOC(16)
+
+	FMatrix4 WorldToView;
+	FMatrix4 ViewToWorld;
+	FMatrix4 Projection;
+	FFrustum WorldFrustum;  // In world space
+	FFrustum ViewFrustum;   // In view space
+	Vector3f Position;      // In world space
+	FQuaternion Rotation;   // In world space
+	Vector2i MouseMovement; // SMouseAxis::GetMovement when extracted
+	float LookSpeed;        // FCamera::LateLookSpeed when extracted
+};
+
+/**
+* Everything a frame is rendered from, copied out of the world on the main thread.
+* Submitting a packet reads nothing game objects write, so the next frame can be
+* simulated while the render thread submits this one.
+*/
+WIN_ALIGN(16)
+struct FRenderPacket
+{
+	ALIGNED_ALLOC(16)
+
+	// Lights are laid out as in the shader storage blocks they are uploaded to
+#pragma pack (push, 1)
+	struct DirectionalLight
+	{
+		Vector3f  Direction;
+		uint32_t  Pad0;
+		Vector3f  Color;
+		uint32_t  Pad1;
+	};
+
+	struct PointLight
+	{
+		Vector3f  Position; // In view space
+		float     Radius;
+		Vector3f  Color;
+		float     Intensity;
+		float     Constant;
+		float     Linear;
+		float     Quadratic;
+		uint32_t  Pad0;
+	};
+#pragma pack (pop)
+
+	FRenderView                   View;
+	Vector2ui                     RenderResolution;  // The scaled resolution the scene is drawn at
+	std::vector<FObjectMesh*>     Meshes;            // Visible objects, those sharing a mesh are next to each other
+	std::vector<FMatrix4>         ModelTransforms;   // Model matrix of each object in Meshes
+	std::vector<DirectionalLight> DirectionalLights; // The first casts shadows
+	std::vector<PointLight>       PointLights;       // Visible lights
+	uint32_t                      LightSystemMask;   // A bit for each of the renderer's light systems that shades this frame
+	bool                          HasBlockVolume;    // If the chunk manager's block volume holds the chunks around the camera
+	bool                          IsShadowTraced;    // If the first directional light's shadows are traced through the block volume
+};
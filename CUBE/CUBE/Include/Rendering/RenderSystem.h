@@ -2,20 +2,51 @@
 #include "Atlas\System.h"
 #include "SFML\Window\Window.hpp"
 #include "Rendering\UniformBlockStandard.h"
+#include "Rendering\StagedUniformBlock.h"
 #include "Rendering\ShaderProgram.h"
 #include "Rendering\GBuffer.h"
 #include "Math\Box.h"
 #include "ImageEffects\IImageEffect.h"
+#include "ImageEffects\PostProcessGraph.h"
 #include "Utils\Event.h"
 #include "Math\Vector2.h"
+#include "Rendering\HiZBuffer.h"
+#include "Rendering\StreamingBuffer.h"
+#include "Rendering\RenderPacket.h"
+#include "Rendering\DynamicResolution.h"
+#include "Rendering\ParticleSystem.h"
+#include "Rendering\BlockTextureArray.h"
+#include "Rendering\RenderTargetPool.h"
+#include "Math\Sphere.h"
+#include "Memory\MemoryUtil.h"
+#include "Memory\MemoryStats.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 class FChunkManager;
+class FTransform;
+class ILightSystem;
+struct FObjectMesh;
 
+WIN_ALIGN(16)
 class FRenderSystem : public Atlas::ISystem
 {
 public:
+	ALIGNED_ALLOC(16);
+
 	static TEvent<Vector2ui> OnResolutionChange;
 
+	/**
+	* How surfaces are stored in the G-Buffer.
+	*/
+	enum class GBufferLayout
+	{
+		Wide,   // 16 bytes a pixel: half float color and normal, and a material id
+		Compact // 8 bytes a pixel: 8 bit color and an octahedral encoded normal
+	};
+
 public:
 	/**
 	* Constructs a rendering system.
@@ -29,19 +60,95 @@ public:
 	/**
 	* Sets the current model transform for render calls. This is combined
 	* with the current camera transform to produce the modelview transform.
+	* Written with the view data of the next frame.
 	*/
 	void SetModelTransform(const FTransform& WorldTransform);
 
 	/**
-	* Renders the scene.
+	* Renders the scene. Everything the frame needs is copied into the render
+	* packet, which is then submitted. When threaded, the packet is handed to
+	* the render thread, and this returns before the frame is submitted.
 	*/
 	void Update() override;
 
+	/**
+	* Sets if frames are submitted on a render thread, which owns the GL context
+	* while it submits. The main thread gets the context back in WaitForRender,
+	* so nothing may use GL between Update and WaitForRender.
+	* @param Flag - True to submit frames on the render thread.
+	*/
+	void SetThreaded(const bool Flag);
+
+	/**
+	* If frames are submitted on the render thread.
+	*/
+	bool IsThreaded() const { return mRenderThread.joinable(); }
+
+	/**
+	* Waits for the render thread to submit the last frame, and makes the GL
+	* context current on this thread again. Must be called before anything
+	* the packet doesn't hold is changed, such as chunk meshes or the
+	* resolution. Does nothing if no frame is being submitted.
+	*/
+	void WaitForRender();
+
+	/**
+	* The packet of the frame being submitted.
+	*/
+	const FRenderPacket& GetPacket() const { return mPacket; }
+
 	/**
 	* Sets the resolution of the rendering display.
 	*/
 	void SetResolution(const Vector2ui& Resolution);
 
+	/**
+	* Sets how surfaces are stored in the G-Buffer, and reallocates it. The compact
+	* layout halves G-Buffer bandwidth at the cost of color precision.
+	* @param Layout - The layout to use.
+	*/
+	void SetGBufferLayout(const GBufferLayout Layout);
+
+	/**
+	* How surfaces are stored in the G-Buffer.
+	*/
+	GBufferLayout GetGBufferLayout() const { return mGBufferLayout; }
+
+	/**
+	* Sets if chunks are drawn depth only before the G-Buffer is filled, so the
+	* G-Buffer shader runs once per pixel. Pays off in scenes with heavy overdraw,
+	* where chunk vertices cost less than the fragments they hide.
+	*/
+	void SetDepthPrePass(const bool Flag) { mIsDepthPrePassEnabled = Flag; }
+
+	bool IsDepthPrePassEnabled() const { return mIsDepthPrePassEnabled; }
+
+	/**
+	* Sets if directional lights are shaded in the pass that composites the post
+	* processes after lighting, so the lights, ambient occlusion and fog decode
+	* the G-Buffer once per pixel instead of once each.
+	*/
+	void SetCompositedLighting(const bool Flag) { mIsLightingComposited = Flag; }
+
+	bool IsLightingComposited() const { return mIsLightingComposited; }
+
+	/**
+	* Sets if the first directional light's shadows are traced through the chunk
+	* manager's block volume instead of drawn to shadow cascades. Shadows then only
+	* reach as far as the volume, and cascades are used while it holds no chunks.
+	*/
+	void SetTracedShadows(const bool Flag) { mIsShadowTraced = Flag; }
+
+	bool IsShadowTraced() const { return mIsShadowTraced; }
+
+	/**
+	* Sets if block textures are stored compressed, a quarter of the memory at some
+	* loss of detail. Textures already uploaded are uploaded again.
+	*/
+	void SetCompressedBlockTextures(const bool Flag);
+
+	bool IsBlockTextureCompressed() const { return mBlockTextures.IsCompressed(); }
+
 	/**
 	* Sends draw calls to all the currently visible geometry with respect to
  	* the main camera.
@@ -55,7 +162,34 @@ public:
 	//FBox GetViewBounds() const;
 
 	/**
-	* Adds a rendering post process technique.
+	* The depth pyramid built from the previous frame's G-Buffer depth.
+	*/
+	const FHiZBuffer& GetHiZBuffer() const { return mHiZBuffer; }
+
+	/**
+	* Clears the visibility of spheres hidden behind the depth of a recent frame.
+	* Only called while no frame is being submitted, as when extracting a packet.
+	* @param Spheres - World space bounds.
+	* @param Count - The number of spheres.
+	* @param VisibleInOut - A flag for each sphere, only those set are tested.
+	*/
+	void CullOccluded(const FSphere* Spheres, const uint32_t Count, uint8_t* VisibleInOut) const;
+
+	/**
+	* The manager of the chunks being rendered.
+	*/
+	FChunkManager& GetChunkManager() { return mChunkManager; }
+
+	/**
+	* Scales the resolution the scene is rendered at to keep the GPU time of
+	* frames in its budget. Scaled scenes are drawn into the bottom left of the
+	* G-Buffer and scene targets, which keep the screen resolution, then scaled
+	* up to the screen before overlays are drawn.
+	*/
+	FDynamicResolution& GetDynamicResolution() { return mDynamicResolution; }
+
+	/**
+	* Adds a rendering post process technique. Its targets are taken from the render system's pool.
 	* @return The id of the postprocess.
 	*/
 	uint32_t AddPostProcess(std::unique_ptr<IImageEffect> PostProcess);
@@ -70,9 +204,45 @@ public:
 	*/
 	void DisablePostProcess(const uint32_t ID);
 
+	bool IsPostProcessEnabled(const uint32_t ID) const;
+
+	/**
+	* The number of post processes added, their ids count up from 0.
+	*/
+	uint32_t GetPostProcessCount() const { return mPostProcesses.size(); }
+
+	/**
+	* Gets a post process that was previously added.
+	*/
+	const IImageEffect& GetPostProcess(const uint32_t ID) const;
+
+	/**
+	* Sets if a light subsystem extracts and shades its lights. Disabled
+	* systems leave their light out of the frame entirely.
+	* @param Index - The subsystem, in the order they are shaded.
+	*/
+	void SetLightSystemEnabled(const uint32_t Index, const bool Flag);
+
+	bool IsLightSystemEnabled(const uint32_t Index) const;
+
+	/**
+	* The number of light subsystems.
+	*/
+	uint32_t GetLightSystemCount() const { return mLightSystems.size(); }
+
+	/**
+	* Gets a light subsystem, in the order they are shaded.
+	*/
+	const ILightSystem& GetLightSystem(const uint32_t Index) const;
+
 private:
 	void AllocateGBuffer(const Vector2ui& Resolution);
 
+	/**
+	* Sets the resolution the scene is drawn at, and the resolution shaders read.
+	*/
+	void SetRenderResolution(const Vector2ui& Resolution);
+
 	/**
 	* Load all rendering based shaders to the
 	* shader manager.
@@ -94,11 +264,34 @@ private:
 	*/
 	void LightingPass();
 
+	/**
+	* Copies the view, visible objects and lights of the frame into the packet.
+	*/
+	void ExtractPacket();
+
+	/**
+	* Copies the visible objects into the packet. Runs alongside the light subsystems' extraction.
+	*/
+	void ExtractMeshes();
+
+	/**
+	* Renders the packet, and displays it.
+	*/
+	void Submit();
+
+	void RenderThreadLoop();
+
 	/**
 	* Updates the bounding box for the current view volume.
 	*/
 	//void UpdateViewBounds();
 
+	/**
+	* Turns the packet's view by the mouse movement made since it was extracted,
+	* as the camera will when it next updates. Culling keeps the extracted view.
+	*/
+	void LatchView();
+
 	/**
 	* Transfers view and projection data to shaders.
 	*/
@@ -134,12 +327,27 @@ private:
 	};
 	using PostProcessContainer = std::vector<PostProcessRecord>;
 
+	/**
+	* An object to draw, sorted by mesh so objects sharing one are drawn together.
+	*/
+	struct MeshInstance
+	{
+		FObjectMesh*       Mesh;
+		const FTransform*  Transform;
+	};
+
 private:
 	sf::Window&           mWindow;
 	FChunkManager&        mChunkManager;
 	FShaderProgram        mDeferredRender;
+	FShaderProgram::UniformHandle mFirstInstanceUniform;
 	FShaderProgram        mChunkRender;
+	FShaderProgram        mChunkDepthPrePass;
+	FShaderProgram        mFarTerrainRender;
+	FRenderTargetPool     mRenderTargets;    // Transient targets of the frame being submitted, outlives the post processes
 	PostProcessContainer  mPostProcesses;
+	FPostProcessGraph     mPostProcessGraph;
+	std::vector<IImageEffect*> mActiveEffects; // Effects enabled this frame, in order
 	//FBox                  mViewAABB;
 
 	struct GBuffer
@@ -149,9 +357,43 @@ private:
 		GLuint ColorTex[1];
 	} mGBuffer;
 
+	// Color target scaled scenes are lit in before being scaled up to the screen. Taken
+	// from mRenderTargets while a scaled frame is submitted, the FBO is 0 otherwise.
+	FRenderTargetPool::Target mSceneTarget;
+
+	FTrackedBytes         mGBufferBytes;
+
+	FHiZBuffer            mHiZBuffer;
+	FDynamicResolution    mDynamicResolution;
+	FParticleSystem       mParticles;
+	FBlockTextureArray    mBlockTextures;
+
 	// Shader info blocks and buffers
-	FUniformBlock   mTransformBlock;
+	FStagedUniformBlock mTransformBlock;      // Written once per frame
 	FUniformBlock   mResolutionBlock;
-	FUniformBlock   mProjectionInfoBlock;
+	FStagedUniformBlock mProjectionInfoBlock; // Written once per frame
+	FUniformBlock   mGBufferLayoutBlock;
 	GLuint          mBlockInfoBuffer;
+	GBufferLayout   mGBufferLayout;
+	bool            mIsDepthPrePassEnabled;
+	bool            mIsLightingComposited;
+	bool            mIsShadowTraced;
+	bool            mIsBlockTextureCompressed; // Applied when the block textures are uploaded
+
+	// Instanced object rendering
+	FStreamingBuffer           mModelTransformBuffer;
+	std::vector<MeshInstance>  mMeshInstances;   // Objects of the frame, reused each extract
+	std::vector<FSphere>       mMeshBounds;      // World bounds of each object in mMeshInstances
+	std::vector<uint8_t>       mMeshVisibility;  // Frustum test result of each object in mMeshInstances
+
+	// Frame submission
+	FRenderPacket              mPacket;
+	std::vector<ILightSystem*> mLightSystems;    // Every subsystem, extracted from in order
+	uint32_t                   mLightSystemMask; // A bit for each enabled subsystem in mLightSystems
+	std::thread                mRenderThread;
+	std::mutex                 mRenderMutex;
+	std::condition_variable    mRenderCondition;
+	bool                       mIsFramePending;    // Set while the render thread owns the packet and context
+	bool                       mIsContextReleased; // The context waits for the last frame to be submitted
+	bool                       mMustStop;
 };
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <cstdint>
+#include <vector>
+
+#include "Math\Vector2.h"
+#include "Memory\MemoryStats.h"
+
+/**
+* Color targets passes only need while a frame is submitted. Passes take a target of
+* the size and format they draw, and give it back once their last read of it is
+* issued, so a later pass taking a target of the same description draws over the
+* same texture. GL orders the draws and reads, so a target given back can be taken
+* again within the frame. Targets are created the first time they are taken and
+* deleted once unused for MAX_UNUSED_FRAMES, so nothing is reallocated eagerly when
+* the resolution changes, and targets of passes that were turned off are freed.
+* Must only be used from the thread submitting frames.
+*/
+class FRenderTargetPool
+{
+public:
+	// Frames a target may go untaken before it is deleted, so targets switched between often aren't recreated
+	static const uint32_t MAX_UNUSED_FRAMES = 120;
+
+	/**
+	* The size and format of a target. Targets are only shared between passes taking the same description.
+	*/
+	struct Description
+	{
+		Vector2ui Size;
+		GLenum    Format; // Internal format of the texture
+		GLenum    Filter; // Min and mag filter of the texture
+
+		bool operator==(const Description& Other) const
+		{
+			return Size == Other.Size && Format == Other.Format && Filter == Other.Filter;
+		}
+	};
+
+	/**
+	* A texture and the framebuffer it is the first color attachment of. Its contents are
+	* undefined once taken, and it must not be used once given back.
+	*/
+	struct Target
+	{
+		GLuint FBO;
+		GLuint Texture;
+	};
+
+public:
+	FRenderTargetPool();
+
+	/**
+	* Deletes every target. Targets still taken are deleted as well.
+	*/
+	~FRenderTargetPool();
+
+	FRenderTargetPool(const FRenderTargetPool& Other) = delete;
+	FRenderTargetPool& operator=(const FRenderTargetPool& Other) = delete;
+
+	/**
+	* Takes a target, reusing one given back with the same description if there is one.
+	* Textures clamp to their edges, and draw to their first color attachment.
+	*/
+	Target Acquire(const Description& Desc);
+
+	/**
+	* Gives back a target once its last read was issued, so later passes may take it.
+	*/
+	void Release(const Target& Taken);
+
+	/**
+	* Gives back a target once the frame is submitted, for targets read by passes the
+	* taker doesn't run itself, such as composited stages.
+	*/
+	void ReleaseAtFrameEnd(const Target& Taken);
+
+	/**
+	* Gives back targets held to the end of the frame, and deletes those untaken for
+	* MAX_UNUSED_FRAMES. Called once each frame is submitted.
+	*/
+	void EndFrame();
+
+	/**
+	* Deletes every target that isn't taken, such as once the resolution changed.
+	*/
+	void DeleteUnused();
+
+	/**
+	* The number of targets created, taken or not.
+	*/
+	uint32_t GetTargetCount() const { return mEntries.size(); }
+
+private:
+	/**
+	* A target created by the pool.
+	*/
+	struct Entry
+	{
+		Description Desc;
+		Target      Handle;
+		uint32_t    LastFrame;    // Frame the target was last taken in
+		bool        IsTaken;
+		bool        IsFrameHeld;  // Given back by EndFrame
+	};
+
+	Entry& FindEntry(const Target& Taken);
+
+	/**
+	* Deletes the target of an entry, and removes the entry.
+	*/
+	void DeleteEntry(const uint32_t Index);
+
+private:
+	std::vector<Entry> mEntries;
+	uint32_t           mFrame;
+	uint64_t           mByteCount;
+	FTrackedBytes      mBytes;
+};
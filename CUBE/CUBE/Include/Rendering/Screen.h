@@ -12,12 +12,21 @@ public:
 
 	static TVector2<uint32_t> GetResolution();
 
+	/**
+	* The resolution the scene is rendered at before it is scaled up to the
+	* screen. Passes up to the post processes draw into this much of their
+	* targets, starting at the bottom left.
+	*/
+	static TVector2<uint32_t> GetRenderResolution();
+
 	static float GetAspectRatio();
 
 private:
 	friend class FRenderSystem;
 	static void SetResolution(const TVector2<uint32_t> Resolution);
+	static void SetRenderResolution(const TVector2<uint32_t> Resolution);
 
 private:
 	static TVector2<uint32_t> ScreenResolution;
+	static TVector2<uint32_t> RenderResolution;
 };
\ No newline at end of file
@@ -4,15 +4,19 @@
 #include <GL\GL.h>
 #include <vector>
 #include <map>
+#include <string>
 
 #include "Rendering\Uniform.h"
+#include "Rendering\GLState.h"
 
 /**
 * Class for creating an OpenGL shader object.
 * Shader objects encapsulated by this class can
 * be attached to shader programs from FShaderProgram.
 * Shader objects create with this class will be deleted
-* when the objects destructor is called.
+* when the objects destructor is called. A shader is only
+* compiled once a program needs it, so programs loaded from
+* the program binary cache never compile their shaders.
 */
 class FShader
 {
@@ -24,6 +28,14 @@ public:
 	*/
 	FShader(const wchar_t* SourceFile, GLenum ShaderType);
 
+	/**
+	* Construct an OpenGL shader object from source held in memory.
+	* Includes are read from the shader directory, as they are for files.
+	* @param Source - The source of the shader.
+	* @param ShaderType - The type of the shader.
+	*/
+	FShader(const std::string& Source, GLenum ShaderType);
+
 	/**
 	* Dtor
 	* Delete the shader object from OpenGL.
@@ -35,10 +47,15 @@ public:
 	FShader& operator=(const FShader&) = delete;
 
 	/**
-	* Retrieve the OpenGL shader ID.
+	* Retrieve the OpenGL shader ID, compiling the shader if it wasn't yet.
 	*/
 	GLuint GetID() const;
 
+	/**
+	* The source of the shader, with its includes resolved.
+	*/
+	const std::string& GetSource() const { return mSource; }
+
 	/**
 	* Retrieve the OpenGL shader type.
 	*/
@@ -50,6 +67,22 @@ private:
 	*/
 	std::string ReadShader(const wchar_t* SourceFile) const;
 
+	/**
+	* Replaces each #include of a source with the file it names.
+	*/
+	void ResolveIncludes(std::string& ShaderSource) const;
+
+	/**
+	* Defines the build settings shaders share with the engine after the #version of a
+	* source, such as CHUNK_SIZE_BITS.
+	*/
+	void AddBuildDefines(std::string& ShaderSource) const;
+
+	/**
+	* Creates the shader object and compiles the source into it.
+	*/
+	void Compile() const;
+
 #ifndef NDEBUG
 	/**
 	* Checks for errors in a shader. If errors are
@@ -59,8 +92,9 @@ private:
 #endif
 
 private:
-	GLuint mID;
+	mutable GLuint mID; // Zero until compiled
 	GLenum mType;
+	std::string mSource;
 };
 
 
@@ -72,6 +106,12 @@ private:
 */
 class FShaderProgram
 {
+public:
+	/**
+	* A uniform found once by FindUniform, to be set without looking up its name.
+	*/
+	using UniformHandle = uint32_t;
+
 public:
 	FShaderProgram();
 
@@ -100,10 +140,20 @@ public:
 	/**
 	* Links this shader program with previously attached shaders.
 	* Once the linking is complete, all previously attacheds shaders
-	* are detached from this program.
+	* are detached from this program. The program is loaded from the
+	* program binary cache when its shaders are unchanged, and saved
+	* to it otherwise. The attached shaders must live until this returns.
+	* The link isn't waited on, and may run on driver threads where
+	* parallel shader compiling is supported, until the program is used.
 	*/
 	void LinkProgram();
 
+	/**
+	* Whether the program finished linking, without waiting for it. Always
+	* true without parallel shader compiling, where the link is done when issued.
+	*/
+	bool IsLinkComplete() const;
+
 	/**
 	* Returns the GLuint id of the program.
 	**/
@@ -111,10 +161,61 @@ public:
 
 	/**
 	* Tells OpenGL to use this
-	* shader program.
+	* shader program. Waits for the link on first use.
 	*/
-	void Use() { glUseProgram(mID); }
+	void Use()
+	{
+		if (mIsLinkPending)
+			FinishLink();
+
+		SGLState::UseProgram(mID);
+	}
 	
+	/**
+	* Finds a uniform to be set by handle. Its location is resolved when the
+	* link finishes, so it may be found before the program is linked.
+	* @param Name - The name of the uniform variable.
+	*/
+	UniformHandle FindUniform(const char* Name);
+
+	template <typename T>
+	/**
+	* Sets data to a uniform found with FindUniform.
+	* @param Handle - The uniform to set.
+	* @param Data - The data to set.
+	*/
+	void SetUniform(const UniformHandle Handle, T Data);
+
+	template <typename T>
+	/**
+	* Sets data to a uniform found with FindUniform.
+	* @param Handle - The uniform to set.
+	* @param Data - The data to set.
+	* @param ShaderActive - Supply if this shader is already active.
+	*/
+	void SetUniform(const UniformHandle Handle, T Data, std::true_type ShaderActive);
+
+	template <typename T>
+	/**
+	* Sets a vector to a uniform found with FindUniform.
+	* @param Handle - The uniform to set.
+	* @param Count - The number of sets of data.
+	* @param Data - The data to set.
+	* @param ShaderActive - Supply if this shader is already active.
+	*/
+	void SetVector(const UniformHandle Handle, GLsizei Count, const T* Data, std::true_type ShaderActive);
+
+	template <typename T>
+	/**
+	* Sets a matrix to a uniform found with FindUniform.
+	* @param Handle - The uniform to set.
+	* @param Count - The number of sets of data.
+	* @param Transpose - If this matrix should be transposed.
+	* @param Data - The data to set.
+	* @param ShaderActive - Supply if this shader is already active.
+	*/
+	void SetMatrix(const UniformHandle Handle, GLsizei Count, GLboolean Transpose, const T* Data, std::true_type ShaderActive);
+
 	template <typename T>
 	/**
 	* Sets data to the currently bound uniform variable.
@@ -174,6 +275,16 @@ private:
 
 	FUniform& GetUniform(const char* Name);
 
+	/**
+	* Finds the location of every active uniform and every handle of the linked program.
+	*/
+	void ResolveUniforms();
+
+	/**
+	* Waits for the issued link, then detaches the shaders and saves the binary.
+	*/
+	void FinishLink();
+
 #ifndef NDEBUG
 	/**
 	* Checks for errors in this program. If errors are
@@ -185,8 +296,41 @@ private:
 private:
 	GLuint mID; // ID for the GL program.
 	std::map<std::string, FUniform> mUniforms;
+	std::vector<FUniform> mHandles;        // By UniformHandle
+	std::vector<std::string> mHandleNames; // By UniformHandle
+	std::vector<const FShader*> mShaders; // Attached and waiting for the link
+	uint64_t mLinkKey;                    // Binary cache key of the issued link
+	bool mIsLinkPending;                  // True from issuing the link until it's finished
 };
 
+template <typename T>
+inline void FShaderProgram::SetUniform(const UniformHandle Handle, T Data)
+{
+	Use();
+	SetUniform(Handle, Data, std::true_type{});
+}
+
+template <typename T>
+inline void FShaderProgram::SetUniform(const UniformHandle Handle, T Data, std::true_type ShaderActive)
+{
+	ShaderActive; // compiler suppress
+	mHandles[Handle].SetUniform(Data);
+}
+
+template <typename T>
+inline void FShaderProgram::SetVector(const UniformHandle Handle, GLsizei Count, const T* Data, std::true_type ShaderActive)
+{
+	ShaderActive; // compiler suppress
+	mHandles[Handle].SetVector(Count, Data);
+}
+
+template <typename T>
+inline void FShaderProgram::SetMatrix(const UniformHandle Handle, GLsizei Count, GLboolean Transpose, const T* Data, std::true_type ShaderActive)
+{
+	ShaderActive; // compiler suppress
+	mHandles[Handle].SetMatrix(Count, Transpose, Data);
+}
+
 template <typename T>
 inline void FShaderProgram::SetUniform(const char* Name, T Data)
 {
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <GL\glew.h>
+
+#include "Rendering\StreamingBuffer.h"
+
+/**
+* A std140 uniform block built in CPU memory and written to the GPU whole.
+* Fields are staged without any GL calls, then Commit copies the block into
+* this frame's region of a persistently mapped ring and binds it. Must only be
+* used from the thread owning the GL context.
+*/
+class FStagedUniformBlock
+{
+public:
+	/**
+	* Creates the block's ring. Nothing is bound until the first commit.
+	* @param BindingIndex - The binding index of the uniform block.
+	* @param BlockSize - The size in bytes of the uniform block.
+	*/
+	FStagedUniformBlock(const GLuint BindingIndex, const uint32_t BlockSize);
+
+	FStagedUniformBlock(const FStagedUniformBlock& Other) = delete;
+	FStagedUniformBlock& operator=(const FStagedUniformBlock& Other) = delete;
+
+	/**
+	* Places data at an offset within the block, to be written by the next commit.
+	* Data layout must correspond with: https://www.opengl.org/registry/specs/ARB/uniform_buffer_object.txt
+	* @param DataOffset - Position of the data in the uniform block.
+	* @param Data - Data to place in the block.
+	* @param DataSize - Size, in bytes, of the data to be placed.
+	*/
+	void Stage(const uint32_t DataOffset, const void* Data, const uint32_t DataSize);
+
+	template <typename T>
+	/**
+	* Places an object at an offset within the block. The object is copied as it
+	* is laid out in memory, which must match its std140 layout.
+	* @param DataOffset - Position of the data in the uniform block.
+	* @param Data - Object to copy.
+	*/
+	void Stage(const uint32_t DataOffset, const T& Data) { Stage(DataOffset, &Data, sizeof(T)); }
+
+	/**
+	* Writes the block with one copy and binds it, if anything was staged since the
+	* last commit. May write once per frame, draws after the commit read the new data.
+	*/
+	void Commit();
+
+	/**
+	* Fences this frame's region. Should be called once per frame after the draws
+	* reading the block.
+	*/
+	void EndFrame() { mBuffer.EndFrame(); }
+
+private:
+	FStreamingBuffer     mBuffer;
+	std::vector<uint8_t> mStaging;    // The whole block, kept across commits
+	GLuint               mBindingIndex;
+	bool                 mIsDirty;    // Staged since the last commit
+};
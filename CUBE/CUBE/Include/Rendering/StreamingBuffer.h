@@ -0,0 +1,85 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <cstdint>
+
+/**
+* A persistently mapped buffer written once per frame and read directly by
+* shaders. The buffer holds a region for each of FRAME_COUNT frames, so the CPU
+* fills one region while the GPU still reads the regions of earlier frames.
+* Each region is fenced by EndFrame, and only waited on when it comes around
+* again. Must only be used from the thread owning the GL context.
+*/
+class FStreamingBuffer
+{
+public:
+	// Frames of data in flight at once
+	static const uint32_t FRAME_COUNT = 3;
+
+	/**
+	* Creates the buffer and maps it for the lifetime of this object.
+	* @param Target - The indexed target shaders read the buffer from, GL_SHADER_STORAGE_BUFFER or GL_UNIFORM_BUFFER,
+	* or GL_ARRAY_BUFFER for vertex data bound with GetBuffer and GetFrameOffset.
+	* @param FrameCapacity - Bytes each frame may write before the buffer grows.
+	*/
+	FStreamingBuffer(const GLenum Target, const GLsizeiptr FrameCapacity);
+
+	/**
+	* Unmaps and deletes the buffer and any active fences.
+	*/
+	~FStreamingBuffer();
+
+	FStreamingBuffer(const FStreamingBuffer& Other) = delete;
+	FStreamingBuffer& operator=(const FStreamingBuffer& Other) = delete;
+
+	/**
+	* Copies the data of this frame into its region. Waits if the GPU is still reading
+	* the region, and grows the buffer if the data doesn't fit. May be called once per frame.
+	* @param Data - The data of this frame.
+	* @param DataSize - The size of the data in bytes.
+	*/
+	void Upload(const void* Data, const GLsizeiptr DataSize);
+
+	/**
+	* Binds the data of this frame to an indexed binding of the target.
+	* @param BindingIndex - The binding shaders read the data from.
+	*/
+	void Bind(const GLuint BindingIndex) const;
+
+	/**
+	* The buffer holding every frame's region.
+	*/
+	GLuint GetBuffer() const { return mBuffer; }
+
+	/**
+	* Offset in bytes of this frame's region in the buffer.
+	*/
+	GLintptr GetFrameOffset() const { return mFrame * mFrameStride; }
+
+	/**
+	* Fences the region of this frame and moves on to the next. Should be called
+	* once per frame after the draws reading the data. Does nothing if nothing was uploaded.
+	*/
+	void EndFrame();
+
+private:
+	/**
+	* Creates and maps a buffer with room for a capacity in each frame.
+	*/
+	void Allocate(const GLsizeiptr FrameCapacity);
+
+	/**
+	* Waits for the GPU to pass a fence, then deletes it.
+	*/
+	static void WaitForFence(GLsync& Fence);
+
+private:
+	GLsync     mFences[FRAME_COUNT];
+	uint8_t*   mMappedData;
+	GLuint     mBuffer;
+	GLenum     mTarget;
+	GLsizeiptr mFrameCapacity;
+	GLsizeiptr mFrameStride;    // Capacity rounded up to the offset alignment of the target
+	GLsizeiptr mUploadedBytes;  // Bytes written this frame
+	uint32_t   mFrame;          // Region written this frame
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <cstdint>
+#include <deque>
+
+/**
+* A persistently mapped staging buffer used to stream data to the GPU
+* without reallocating driver storage. Data is copied into the mapped
+* ring and then moved to its destination buffer with glCopyBufferSubData.
+* Space used during a frame is fenced by EndFrame and reused once the GPU
+* has consumed it. Must only be used from the thread owning the GL context.
+*/
+class FUploadRing
+{
+public:
+	/**
+	* Creates the ring buffer and maps it for the lifetime of this object.
+	* @param Capacity - The size of the ring in bytes.
+	*/
+	FUploadRing(const GLsizeiptr Capacity);
+
+	/**
+	* Unmaps and deletes the ring buffer and any active fences.
+	*/
+	~FUploadRing();
+
+	FUploadRing(const FUploadRing& Other) = delete;
+	FUploadRing& operator=(const FUploadRing& Other) = delete;
+
+	/**
+	* Copies data into the ring.
+	* @param Data - The data to stage.
+	* @param DataSize - The size of the data in bytes.
+	* @param OffsetOut - The offset of the staged data within the ring buffer.
+	* @return False if the ring has no free space for the data. Nothing is staged in this case.
+	*/
+	bool Stage(const void* Data, const GLsizeiptr DataSize, GLintptr& OffsetOut);
+
+	/**
+	* Copies staged data from the ring into another buffer.
+	* @param Offset - The offset of the staged data, given by Stage.
+	* @param DataSize - The size of the data in bytes.
+	* @param Destination - The buffer to copy into.
+	* @param DestinationOffset - The offset within the destination buffer.
+	*/
+	void CopyTo(const GLintptr Offset, const GLsizeiptr DataSize, const GLuint Destination, const GLintptr DestinationOffset) const;
+
+	/**
+	* Fences all data staged since the last call so its space can be
+	* reused after the GPU has finished the copies. Should be called once
+	* per frame after all staging is done.
+	*/
+	void EndFrame();
+
+	/**
+	* The size of the ring in bytes.
+	*/
+	GLsizeiptr GetCapacity() const { return mCapacity; }
+
+	/**
+	* The number of bytes that are in use by staged data.
+	*/
+	GLsizeiptr GetUsedBytes() const { return mUsedBytes; }
+
+private:
+	/**
+	* Releases space for every fence the GPU has passed.
+	*/
+	void ReclaimSpace();
+
+private:
+	struct FrameFence
+	{
+		GLsync     Sync;
+		GLsizeiptr Bytes; // Bytes released when the fence is signaled
+	};
+
+	std::deque<FrameFence> mFences;
+	uint8_t*               mMappedData;
+	GLuint                 mBuffer;
+	GLsizeiptr             mCapacity;
+	GLintptr               mHead;          // Next write position
+	GLsizeiptr             mUsedBytes;     // Bytes staged and not yet released
+	GLsizeiptr             mUnfencedBytes; // Bytes staged since the last EndFrame
+};
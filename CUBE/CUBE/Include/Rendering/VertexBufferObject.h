@@ -263,5 +263,5 @@ inline FVertexBufferObject& FVertexArrayObject::GetBuffer(GLuint Index)
 
 inline void FVertexArrayObject::SetActive(bool IsActive)
 {
-	IsActive ? glBindVertexArray(mVertexArrayID) : glBindVertexArray(0);
+	SGLState::BindVertexArray(IsActive ? mVertexArrayID : 0);
 }
\ No newline at end of file
@@ -1,16 +1,38 @@
 #pragma once
-#include <map>
 #include <cstdint>
 #include <memory>
+#include <functional>
 
 #include "Utils/Singleton.h"
+#include "StringID.h"
+
+class FJobCounter;
 
 template <typename Resource>
 /**
-* Singleton class for loading resources from files.
+* Singleton class for loading resources from files. Resources
+* are kept in an open addressing table keyed by the FStringID of
+* their name, so literal names are hashed when compiling. They
+* live until unloaded, so references to them stay valid as other
+* resources are added. Resources loaded with
+* LoadAsync are read on the job system and finished on the main
+* thread, until then Get returns a default constructed placeholder.
 */
 class TResourceHolder
 {
+public:
+	/**
+	* Finishes an asynchronous load on the main thread, such as uploading to GL.
+	*/
+	using FinishStep = std::function<void(Resource&)>;
+
+	/**
+	* Reads and parses the data of an asynchronous load on a job worker,
+	* without touching GL or the resource.
+	* @return The step finishing the resource with the parsed data.
+	*/
+	using ReadStep = std::function<FinishStep()>;
+
 public:
 	TResourceHolder() = delete;
 	~TResourceHolder() = delete;
@@ -19,13 +41,13 @@ public:
 	* Loads a resource and stores it with
 	* a specified name.
 	*/
-	static void Load(const char* Name);
+	static void Load(const FStringID Name);
 
 	/**
 	* Loads a resource from a file and stores it with
 	* a specified name.
 	*/
-	static void Load(const char* Name, const wchar_t* Filename);
+	static void Load(const FStringID Name, const wchar_t* Filename);
 
 	template <typename FirstParam>
 	/**
@@ -33,20 +55,52 @@ public:
 	* a specified name.
 	* @param Param - Parameter for constructing the resource type.
 	*/
-	static void Load(const char* Name, const wchar_t* Filename, const FirstParam& Param);
+	static void Load(const FStringID Name, const wchar_t* Filename, const FirstParam& Param);
+
+	/**
+	* Stores a default constructed resource with a specified name, and loads
+	* it in the background. Call from the main thread.
+	* @param Name - The name of the resource.
+	* @param Read - Runs on a job worker, then its finish step runs on the main thread.
+	* @param Counter - Counts the load until its finish step has run. Optional.
+	*/
+	static void LoadAsync(const FStringID Name, ReadStep Read, FJobCounter* Counter = nullptr);
+
+	/**
+	* Deletes a resource stored in this holder. A resource still
+	* loading is deleted right away and its finish step is skipped.
+	*/
+	static void Unload(const FStringID Name);
 
 	/**
-	* Deletes a resource stored in this holder.
+	* Retrieves a resource by name. Resources still loading are placeholders.
 	*/
-	static void Unload(const char* Name);
+	static Resource& Get(const FStringID Name);
 
 	/**
-	* Retrieves a resource by name.
+	* If a resource has finished loading.
 	*/
-	static Resource& Get(const char* Name);
+	static bool IsReady(const FStringID Name);
+
+private:
+	struct Slot
+	{
+		uint32_t                  Key;     // 0 when the slot is empty
+		bool                      IsReady;
+		std::unique_ptr<Resource> Value;
+	};
+
+	// Slots in use before the table grows, in tenths of its size
+	static const uint32_t MAX_LOAD_TENTHS = 7;
+
+	static void Insert(const uint32_t Key, std::unique_ptr<Resource> Value, const bool IsReady);
+	static Slot* Find(const uint32_t Key);
+	static void Grow();
 
 private:
-	static std::map<uint32_t, std::unique_ptr<Resource>> mResourceMap;
+	static std::unique_ptr<Slot[]> mSlots;
+	static uint32_t                mSlotCount; // A power of two
+	static uint32_t                mUsedCount;
 };
 
 class FShader;
@@ -55,4 +109,4 @@ using SShaderHolder = TResourceHolder<FShader>;
 class FShaderProgram;
 using SShaderProgramHolder = TResourceHolder<FShaderProgram>;
 
-#include "ResourceHolder.inl"
\ No newline at end of file
+#include "ResourceHolder.inl"
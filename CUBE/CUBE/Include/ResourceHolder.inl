@@ -1,49 +1,175 @@
 #pragma once
-#include "Misc\StringUtil.h"
 #include "Misc\Assertions.h"
+#include "Threading\JobSystem.h"
 
 template <typename Resource>
-inline void TResourceHolder<Resource>::Load(const char* Name)
+inline void TResourceHolder<Resource>::Load(const FStringID Name)
 {
 	std::unique_ptr<Resource> ResourcePtr(new Resource);
-	uint32_t GUID = FString::HashCRC32(Name);
-	auto Insert = mResourceMap.insert({ GUID, std::move(ResourcePtr) });
-	ASSERT(Insert.second && "Duplicate keys in resource map.");
+	Insert(Name.GetID(), std::move(ResourcePtr), true);
 }
 
 template <typename Resource>
-inline void TResourceHolder<Resource>::Load(const char* Name, const wchar_t* Filename)
+inline void TResourceHolder<Resource>::Load(const FStringID Name, const wchar_t* Filename)
 {
 	std::unique_ptr<Resource> ResourcePtr(new Resource(Filename));
-	uint32_t GUID = FString::HashCRC32(Name);
-	auto Insert = mResourceMap.insert({ GUID, std::move(ResourcePtr) });
-	ASSERT(Insert.second && "Duplicate keys in resource map.");
+	Insert(Name.GetID(), std::move(ResourcePtr), true);
 }
 
 template <typename Resource>
 template <typename FirstParam>
-inline void TResourceHolder<Resource>::Load(const char* Name, const wchar_t* Filename, const FirstParam& Param)
+inline void TResourceHolder<Resource>::Load(const FStringID Name, const wchar_t* Filename, const FirstParam& Param)
 {
 	std::unique_ptr<Resource> ResourcePtr(new Resource(Filename, Param));
-	uint32_t GUID = FString::HashCRC32(Name);
-	auto Insert = mResourceMap.insert({ GUID, std::move(ResourcePtr) });
-	ASSERT(Insert.second && "Duplicate keys in resource map.");
+	Insert(Name.GetID(), std::move(ResourcePtr), true);
 }
 
 template <typename Resource>
-inline void TResourceHolder<Resource>::Unload(const char* Name)
+inline void TResourceHolder<Resource>::LoadAsync(const FStringID Name, ReadStep Read, FJobCounter* Counter)
 {
-	auto NumErased = mResourceMap.erase(FString::HashCRC32(Name));
-	ASSERT(NumErased == 1 && "Tried to unload a non-existent resource.");
+	FJobSystem& JobSystem = FJobSystem::GetInstance();
+	ASSERT(JobSystem.IsMainThread() && "Resources are only added from the main thread.");
+
+	// The placeholder is stored first, so it's found even if the jobs run as they are submitted
+	const uint32_t GUID = Name.GetID();
+	std::unique_ptr<Resource> ResourcePtr(new Resource);
+	Insert(GUID, std::move(ResourcePtr), false);
+
+	JobSystem.Submit([GUID, Read, Counter]()
+	{
+		const FinishStep Finish = Read();
+
+		// Submitted before this job ends, so the counter doesn't finish in between
+		FJobSystem::GetInstance().Submit([GUID, Finish]()
+		{
+			Slot* Found = Find(GUID);
+			if (!Found || Found->IsReady)
+				return;
+
+			Finish(*Found->Value);
+			Found->IsReady = true;
+		}, Counter, EJobAffinity::MainThread);
+	}, Counter);
+}
+
+template <typename Resource>
+inline void TResourceHolder<Resource>::Unload(const FStringID Name)
+{
+	Slot* Found = Find(Name.GetID());
+	ASSERT(Found && "Tried to unload a non-existent resource.");
+	if (!Found)
+		return;
+
+	// Shifts back the slots probed past this one, so no tombstones are needed
+	const uint32_t Mask = mSlotCount - 1;
+	uint32_t Hole = (uint32_t)(Found - mSlots.get());
+	for (uint32_t i = (Hole + 1) & Mask; mSlots[i].Key != 0; i = (i + 1) & Mask)
+	{
+		const uint32_t Home = mSlots[i].Key & Mask;
+		if (((i - Home) & Mask) >= ((i - Hole) & Mask))
+		{
+			mSlots[Hole].Key = mSlots[i].Key;
+			mSlots[Hole].IsReady = mSlots[i].IsReady;
+			mSlots[Hole].Value = std::move(mSlots[i].Value);
+			Hole = i;
+		}
+	}
+
+	mSlots[Hole].Key = 0;
+	mSlots[Hole].IsReady = false;
+	mSlots[Hole].Value.reset();
+	mUsedCount--;
+}
+
+template <typename Resource>
+inline Resource& TResourceHolder<Resource>::Get(const FStringID Name)
+{
+	Slot* Found = Find(Name.GetID());
+	ASSERT(Found && "Resource not in resource map.");
+	return *Found->Value;
 }
 
 template <typename Resource>
-inline Resource& TResourceHolder<Resource>::Get(const char* Name)
+inline bool TResourceHolder<Resource>::IsReady(const FStringID Name)
 {
-	auto Found = mResourceMap.find(FString::HashCRC32(Name));
-	ASSERT(Found != mResourceMap.end() && "Resource not in resource map.");
-	return *Found->second;
+	Slot* Found = Find(Name.GetID());
+	return Found && Found->IsReady;
 }
 
 template <typename Resource>
-std::map<uint32_t, std::unique_ptr<Resource>> TResourceHolder<Resource>::mResourceMap;
\ No newline at end of file
+inline void TResourceHolder<Resource>::Insert(const uint32_t Key, std::unique_ptr<Resource> Value, const bool IsReady)
+{
+	ASSERT(Key != 0 && "Resource name hashes to the empty key.");
+	if ((mUsedCount + 1) * 10 > mSlotCount * MAX_LOAD_TENTHS)
+		Grow();
+
+	const uint32_t Mask = mSlotCount - 1;
+	uint32_t i = Key & Mask;
+	for (; mSlots[i].Key != 0; i = (i + 1) & Mask)
+	{
+		ASSERT(mSlots[i].Key != Key && "Duplicate keys in resource map.");
+		if (mSlots[i].Key == Key)
+			return;
+	}
+
+	mSlots[i].Key = Key;
+	mSlots[i].IsReady = IsReady;
+	mSlots[i].Value = std::move(Value);
+	mUsedCount++;
+}
+
+template <typename Resource>
+inline typename TResourceHolder<Resource>::Slot* TResourceHolder<Resource>::Find(const uint32_t Key)
+{
+	if (mSlotCount == 0)
+		return nullptr;
+
+	const uint32_t Mask = mSlotCount - 1;
+	for (uint32_t i = Key & Mask; mSlots[i].Key != 0; i = (i + 1) & Mask)
+	{
+		if (mSlots[i].Key == Key)
+			return &mSlots[i];
+	}
+
+	return nullptr;
+}
+
+template <typename Resource>
+inline void TResourceHolder<Resource>::Grow()
+{
+	const uint32_t OldCount = mSlotCount;
+	std::unique_ptr<Slot[]> OldSlots = std::move(mSlots);
+
+	mSlotCount = OldCount == 0 ? 16 : OldCount * 2;
+	mSlots.reset(new Slot[mSlotCount]);
+	for (uint32_t i = 0; i < mSlotCount; i++)
+	{
+		mSlots[i].Key = 0;
+		mSlots[i].IsReady = false;
+	}
+
+	// Only the owning pointers move, the resources stay where they are
+	const uint32_t Mask = mSlotCount - 1;
+	for (uint32_t i = 0; i < OldCount; i++)
+	{
+		if (OldSlots[i].Key == 0)
+			continue;
+
+		uint32_t j = OldSlots[i].Key & Mask;
+		while (mSlots[j].Key != 0)
+			j = (j + 1) & Mask;
+
+		mSlots[j].Key = OldSlots[i].Key;
+		mSlots[j].IsReady = OldSlots[i].IsReady;
+		mSlots[j].Value = std::move(OldSlots[i].Value);
+	}
+}
+
+template <typename Resource>
+std::unique_ptr<typename TResourceHolder<Resource>::Slot[]> TResourceHolder<Resource>::mSlots;
+
+template <typename Resource>
+uint32_t TResourceHolder<Resource>::mSlotCount = 0;
+
+template <typename Resource>
+uint32_t TResourceHolder<Resource>::mUsedCount = 0;
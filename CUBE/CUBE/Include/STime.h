@@ -8,6 +8,9 @@
 class STime
 {
 public:
+	// Frames averaged into the delta time while smoothing
+	static const uint32_t SMOOTHED_FRAMES = 8;
+
 	static float GetDeltaTime()
 	{
 		return mDeltaTime;
@@ -23,6 +26,25 @@ public:
 		mFixedUpdate = Time;
 	}
 
+	/**
+	* Averages the delta time over the last SMOOTHED_FRAMES frames, so
+	* a single long or short frame doesn't jolt movement. The game clock
+	* still advances by the measured frame times.
+	*/
+	static void SetDeltaSmoothing(bool IsSmoothed)
+	{
+		mIsSmoothed = IsSmoothed;
+	}
+
+	/**
+	* Replaces the delta time of the last frame, such as with a recorded
+	* one while replaying input. The game clock keeps the measured time.
+	*/
+	static void OverrideDeltaTime(float DeltaTime)
+	{
+		mDeltaTime = DeltaTime;
+	}
+
 	static FClock& GetGameClock()
 	{
 		return mGameClock;
@@ -38,5 +60,8 @@ private:
 	static uint64_t mFrameEnd;
 	static float mDeltaTime;
 	static float mFixedUpdate;
+	static float mDeltaHistory[SMOOTHED_FRAMES];
+	static uint32_t mDeltaHistoryCount;
+	static bool mIsSmoothed;
 };
 
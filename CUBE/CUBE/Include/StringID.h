@@ -1,29 +1,46 @@
 #pragma once
 #include <cstdint>
+#include <cstring>
 #include <string>
 
+#include "Misc\StringUtil.h"
+#include "Misc\Assertions.h"
+
+// Names are kept for GetName and to report colliding IDs, by default only in debug builds
+#ifndef STRING_ID_NAMES_ENABLED
+#ifdef NDEBUG
+#define STRING_ID_NAMES_ENABLED 0
+#else
+#define STRING_ID_NAMES_ENABLED 1
+#endif
+#endif
+
 /**
 * A class the allows string names to be represented
 * as a compact integer, which allows for faster and more
-* efficient operations than when done with strings. All strings
-* are hashed into IDs and stored in a hashtable for fast lookups.
+* efficient operations than when done with strings. IDs of
+* literals are hashed when compiling, others when constructed.
+* Names are kept in a table for debugging, which is locked
+* so IDs can be made on any thread.
 */
 class FStringID
 {
 public:
 	using StringID = uint32_t;
 
+	template <std::size_t Size>
 	/**
-	* Construct a string id from a c-string.
+	* Construct a string id from a string literal, hashed when compiling.
+	* Implicit so literals can be passed where string ids are taken.
 	* @param Name for the string id
 	*/
-	explicit FStringID(const char* Name);
+	FStringID(const char (&Name)[Size]);
 
 	/**
-	* Construct a string id from a std::string.
+	* Construct a string id from a c-string or std::string.
 	* @param Name for the string id
 	*/
-	explicit FStringID(const std::string& Name);
+	explicit FStringID(const FString::FDynamicString Name);
 
 	// Default the copy ctor and assignment
 	FStringID(const FStringID& Other) = default;
@@ -38,10 +55,26 @@ public:
 
 	/**
 	* Retrieves the string representation of the string id.
+	* Empty if names aren't kept.
 	*/
 	const std::string GetName() const;
 
+private:
+	/**
+	* Adds the name of an id to the name table, reporting ids used by another name.
+	*/
+	static void AddName(const StringID ID, const char* Name);
+
 private:
 	StringID mID;
 };
 
+template <std::size_t Size>
+inline FStringID::FStringID(const char (&Name)[Size])
+	: mID(FString::HashCRC32(Name))
+{
+	ASSERT(strlen(Name) == Size - 1 && "Character buffers must be passed as pointers.");
+#if STRING_ID_NAMES_ENABLED
+	AddName(mID, Name);
+#endif
+}
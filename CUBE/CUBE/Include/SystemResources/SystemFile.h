@@ -2,4 +2,6 @@
 
 #ifdef _WIN32
 	#include "Windows\WindowsFile.h"
+#else
+	#include "Posix/PosixFile.h"
 #endif
\ No newline at end of file
@@ -0,0 +1,5 @@
+#pragma once
+
+#ifdef _WIN32
+	#include "Windows\WindowsThread.h"
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <atomic>
+
+/**
+* Epoch based reclamation, so shared data can be read without locks while it's
+* replaced. Readers pin the reclaimer for as long as they hold pointers into the
+* data. Writers publish a replacement, then retire what it replaced instead of
+* freeing it. Reclaim advances the epoch and frees what was retired before the
+* epoch every pinned reader pinned at, so no reader sees its data freed. Pinning
+* only stores the epoch to a slot of the calling thread, and pins nest.
+*/
+class FEpochReclaimer
+{
+public:
+	// Threads that may ever pin a reclaimer, every reclaimer gives each thread the same slot
+	static const uint32_t MAX_READERS = 64;
+
+	/**
+	* Pins a reclaimer for as long as it lives.
+	*/
+	class Guard
+	{
+	public:
+		explicit Guard(FEpochReclaimer& Reclaimer);
+		~Guard();
+
+		Guard(const Guard& Other) = delete;
+		Guard& operator=(const Guard& Other) = delete;
+
+	private:
+		FEpochReclaimer& mReclaimer;
+	};
+
+public:
+	FEpochReclaimer();
+
+	/**
+	* Dtor
+	* Frees everything retired. No thread may still be pinned.
+	*/
+	~FEpochReclaimer();
+
+	FEpochReclaimer(const FEpochReclaimer& Other) = delete;
+	FEpochReclaimer& operator=(const FEpochReclaimer& Other) = delete;
+
+	/**
+	* Retires data no longer reachable from what is published, so it's freed once no reader can hold it.
+	* @param Free - Frees the data, called by a later Reclaim on the thread reclaiming.
+	*/
+	void Retire(std::function<void()> Free);
+
+	/**
+	* Advances the epoch and frees the data retired before every pinned reader pinned.
+	* Called regularly by the thread owning the data, such as once a frame.
+	*/
+	void Reclaim();
+
+	/**
+	* Waits until every reader pinned before the call has unpinned, for data that can't
+	* wait to be retired. The calling thread must not be pinned, and readers must not
+	* wait on it while pinned.
+	*/
+	void Synchronize();
+
+private:
+	void Pin();
+	void Unpin();
+
+private:
+	/**
+	* Data waiting to be freed.
+	*/
+	struct Retired
+	{
+		uint64_t              Epoch; // Epoch when it was retired
+		std::function<void()> Free;
+	};
+
+	std::atomic<uint64_t> mEpoch;
+	std::atomic<uint64_t> mReaderEpochs[MAX_READERS]; // Epoch each reader pinned at, 0 while unpinned
+	uint32_t              mReaderDepths[MAX_READERS]; // Nested pins of each reader, only used by its thread
+	std::vector<Retired>  mRetired;      // Guarded by mRetiredMutex
+	std::mutex            mRetiredMutex;
+};
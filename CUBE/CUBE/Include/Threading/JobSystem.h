@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "Utils\Singleton.h"
+
+class FJobCounter;
+
+/**
+* The threads a job may run on.
+*/
+enum class EJobAffinity : uint8_t
+{
+	Any,       // Any worker, or any thread helping while it waits
+	MainThread // Only the thread that started the job system, as with GL calls
+};
+
+/**
+* Worker threads shared by every subsystem, one per core besides the main thread.
+* Each worker has its own deque of jobs. Workers run the newest job of their own
+* deque and steal the oldest from the others once it's empty. Jobs can add to a
+* counter and be held until another counter finishes, and threads waiting on a
+* counter run jobs instead of blocking. Without workers, jobs run as they are submitted.
+*/
+class FJobSystem : public TSingleton<FJobSystem>
+{
+public:
+	using Job = std::function<void()>;
+
+	/**
+	* A loop iteration.
+	* @param Index - The index of the iteration.
+	* @param Participant - The thread running it among those splitting the loop,
+	*                      within [0, GetThreadCount()). The calling thread is 0.
+	*/
+	using LoopWork = std::function<void(const uint32_t Index, const uint32_t Participant)>;
+
+public:
+	FJobSystem();
+
+	/**
+	* Dtor
+	* Finishes queued jobs and joins all workers.
+	*/
+	~FJobSystem();
+
+	/**
+	* Starts the job system with a specific amount of worker threads, restarting it if
+	* it is already running. The calling thread becomes the main thread.
+	* @param WorkerCount - The number of worker threads, besides the calling thread.
+	* @param UseCoreHints - If each worker should prefer a core of its own, with the first kept for the main thread.
+	*/
+	void Start(const uint32_t WorkerCount, const bool UseCoreHints);
+
+	/**
+	* Finishes queued jobs and joins all workers. Jobs still held on counters
+	* must be released before stopping.
+	*/
+	void Stop();
+
+	/**
+	* Queues a job.
+	* @param NewJob - The work to run.
+	* @param Counter - Counts the job until it finishes. Optional.
+	* @param Affinity - The threads the job may run on.
+	*/
+	void Submit(Job NewJob, FJobCounter* Counter = nullptr, const EJobAffinity Affinity = EJobAffinity::Any);
+
+	/**
+	* Queues a job once every job counted by another counter has finished.
+	* @param Dependency - The counter to wait on. It must outlive the held job.
+	* @param NewJob - The work to run.
+	* @param Counter - Counts the job from now until it finishes. Optional.
+	* @param Affinity - The threads the job may run on.
+	*/
+	void SubmitAfter(FJobCounter& Dependency, Job NewJob, FJobCounter* Counter = nullptr, const EJobAffinity Affinity = EJobAffinity::Any);
+
+	/**
+	* Runs queued jobs until every job counted by a counter has finished. The main
+	* thread also runs main thread jobs. Other threads must not wait on main thread
+	* jobs unless the main thread waits or calls RunMainThreadJobs.
+	*/
+	void Wait(FJobCounter& Counter);
+
+	/**
+	* Runs queued main thread jobs. Must be called from the main thread.
+	* @param Deadline - System timer cycles after which no new job starts, or 0 to run every job.
+	*/
+	void RunMainThreadJobs(const uint64_t Deadline = 0);
+
+	/**
+	* Runs a loop over every index in [0, Count), split into ranges between idle
+	* workers and the calling thread, and waits for every iteration to finish.
+	* Loops may be started from any thread and from within running jobs.
+	* @param Count - The number of iterations.
+	* @param GrainSize - The number of iterations taken at a time, at least 1.
+	* @param Task - The iteration to run for each index.
+	*/
+	void ParallelFor(const uint32_t Count, const uint32_t GrainSize, const LoopWork& Task);
+
+	/**
+	* The number of threads jobs are split between, including the main thread.
+	*/
+	uint32_t GetThreadCount() const { return mWorkers.size() + 1; }
+
+	/**
+	* If the calling thread is the thread that started the job system.
+	*/
+	bool IsMainThread() const { return std::this_thread::get_id() == mMainThreadID; }
+
+	/**
+	* The number of workers for a machine, one per core besides the main thread.
+	*/
+	static uint32_t GetDefaultWorkerCount();
+
+private:
+	friend class FJobCounter;
+
+	struct JobRecord
+	{
+		Job          Work;
+		FJobCounter* Counter;
+		EJobAffinity Affinity;
+	};
+
+	struct JobQueue
+	{
+		std::mutex            Mutex;
+		std::deque<JobRecord> Jobs;
+	};
+
+	void WorkerThreadLoop(const uint32_t Worker, const bool UseCoreHints);
+
+	/**
+	* Adds a job to a queue, or runs it now without workers.
+	*/
+	void Enqueue(JobRecord&& Record);
+
+	/**
+	* Runs a queued job the calling thread may take.
+	* @return False if there were none.
+	*/
+	bool TryRunJob(const bool IsMain);
+
+	/**
+	* Runs a job and finishes it on its counter.
+	*/
+	void RunJob(JobRecord& Record);
+
+	/**
+	* Removes a finished job from a counter, queuing the jobs held on it once it reaches 0.
+	*/
+	void FinishJob(FJobCounter& Counter);
+
+	/**
+	* Wakes threads sleeping until jobs are queued or counters finish.
+	*/
+	void WakeThreads(const bool WakeAll);
+
+private:
+	std::vector<std::thread>               mWorkers;
+	std::vector<std::unique_ptr<JobQueue>> mQueues;        // One per worker, only the owner takes its newest jobs
+	JobQueue                               mMainQueue;      // Jobs only the main thread runs
+	std::atomic<uint32_t>                  mQueuedJobs;     // Jobs in the worker queues
+	std::atomic<uint32_t>                  mQueuedMainJobs;
+	std::atomic<uint32_t>                  mNextQueue;      // Spreads jobs submitted from other threads
+	std::mutex                             mWakeMutex;
+	std::condition_variable                mWakeCondition;
+	std::thread::id                        mMainThreadID;
+	bool                                   mMustStop;
+};
+
+/**
+* Counts unfinished jobs. Jobs submitted with a counter add to it until they
+* finish, and jobs submitted after it are held until it reaches 0. A counter
+* must outlive the jobs it counts and holds, and can be reused once it's done.
+*/
+class FJobCounter
+{
+public:
+	FJobCounter();
+
+	FJobCounter(const FJobCounter& Other) = delete;
+	FJobCounter& operator=(const FJobCounter& Other) = delete;
+
+	/**
+	* If every job counted has finished.
+	*/
+	bool IsDone() const { return mCount == 0; }
+
+private:
+	friend class FJobSystem;
+
+	std::atomic<uint32_t>               mCount;
+	std::mutex                          mMutex;   // Guards the held jobs, and the count reaching 0
+	std::vector<FJobSystem::JobRecord>  mHeldJobs;
+};
@@ -24,6 +24,10 @@ public:
 
 	bool Write(const uint8_t* Data, const uint32_t NumBytesToWrite) override;
 
+	bool ReadAt(const uint64_t Offset, uint8_t* DataOut, const uint32_t NumBytesToRead) override;
+
+	bool WriteAt(const uint64_t Offset, const uint8_t* Data, const uint32_t NumBytesToWrite) override;
+
 	bool Seek(const uint64_t Distance) override;
 
 	bool SeekFromEnd(const uint64_t Distance) override;
@@ -32,6 +36,8 @@ public:
 
 	uint32_t GetFileSize() const override;
 
+	bool Flush() override;
+
 private:
 	/**
 	* Moves the current file pointer a specified distance based on
@@ -44,6 +50,51 @@ private:
 	HANDLE mFileHandle;
 };
 
+/**
+* Memory mapped file on the Windows platform.
+*/
+class FWindowsMappedFile : public IMappedFile
+{
+public:
+	/**
+	* Maps an open file. Takes ownership of the handle.
+	* @param ReadOnly - True if the handle only has read access.
+	*/
+	FWindowsMappedFile(HANDLE FileHandle, const bool ReadOnly);
+
+	~FWindowsMappedFile();
+
+	FWindowsMappedFile(const FWindowsMappedFile& Other) = delete;
+	FWindowsMappedFile& operator=(const FWindowsMappedFile& Other) = delete;
+
+	uint8_t* GetData() override;
+
+	uint32_t GetFileSize() const override;
+
+	bool Resize(const uint32_t NewSize) override;
+
+	bool Flush() override;
+
+private:
+	/**
+	* Maps the whole file. Empty files are not mapped.
+	* @return True if the mapping succeeded.
+	*/
+	bool Map();
+
+	/**
+	* Releases the current view and mapping.
+	*/
+	void Unmap();
+
+private:
+	HANDLE   mFileHandle;
+	HANDLE   mMappingHandle;
+	uint8_t* mData;
+	uint32_t mFileSize;
+	bool     mReadOnly;
+};
+
 
 /**
 * Wrapper class for file operations on the Windows platform.
@@ -57,9 +108,14 @@ public:
 	std::unique_ptr<IFileHandle> OpenWritable(const wchar_t* FileName, const bool AllowShareRead = false, const bool CreateNew = false) override;
 	std::unique_ptr<IFileHandle> OpenReadable(const wchar_t* Filename) override;
 	std::unique_ptr<IFileHandle> OpenReadWritable(const wchar_t* FileName, const bool AllowRead = false, const bool CreateNew = false) override;
+	std::unique_ptr<IMappedFile> OpenMapped(const wchar_t* Filename, const bool CreateNew = false, const bool ReadOnly = false) override;
 
 	bool DeleteFilename(const wchar_t* Filename) override;
 
+	bool CopyFilename(const wchar_t* From, const wchar_t* To) override;
+
+	bool ReplaceFilename(const wchar_t* From, const wchar_t* To) override;
+
 	bool CurrentDirectory(wchar_t* DataOut, const uint32_t BufferLength) override;
 
 	bool DeleteDirectory(const wchar_t* DirectoryName) override;
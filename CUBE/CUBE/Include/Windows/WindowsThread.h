@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+* Queries processor cores and places threads on them on the Windows platform.
+*/
+class SWindowsThread
+{
+public:
+	/**
+	* The number of logical processors the process may run on.
+	*/
+	static uint32_t GetCoreCount();
+
+	/**
+	* Asks the scheduler to prefer running the calling thread on one logical processor.
+	* This is a hint only, the thread may still run on any processor.
+	* @param Core - The index of the processor among those the process may run on, wrapped to GetCoreCount.
+	*/
+	static void SetCurrentThreadCore(const uint32_t Core);
+
+	/**
+	* Suspends the calling thread. Uses a high resolution timer where the system has one,
+	* otherwise the wait is rounded up to the scheduler's tick.
+	* @param Seconds - The least time to sleep for.
+	*/
+	static void Sleep(const float Seconds);
+
+private:
+	SWindowsThread() = delete;	// Not meant for instantiation
+};
+
+using SThread = SWindowsThread;
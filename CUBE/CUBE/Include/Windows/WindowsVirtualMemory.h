@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+* Reserves and commits pages of virtual memory on the Windows platform.
+* Reserved pages take address space only, and committed pages only become
+* resident once they are touched.
+*/
+class SWindowsVirtualMemory
+{
+public:
+	/**
+	* The size of a page, which commits are rounded to.
+	*/
+	static size_t GetPageSize();
+
+	/**
+	* The size of a large page, or 0 if the process can't lock large pages in memory.
+	*/
+	static size_t GetLargePageSize();
+
+	/**
+	* Reserves a range of address space without backing it with memory.
+	* @param Bytes - The size of the range.
+	* @return The start of the range, or null if it couldn't be reserved.
+	*/
+	static void* Reserve(const size_t Bytes);
+
+	/**
+	* Backs pages of a reserved range with memory.
+	* @param Address - The first page to commit, within a range from Reserve.
+	* @param Bytes - The number of bytes to commit, rounded up to whole pages.
+	* @return False if the memory couldn't be committed.
+	*/
+	static bool Commit(void* Address, const size_t Bytes);
+
+	/**
+	* Reserves and commits a range of large pages at once. They are always resident.
+	* @param Bytes - The size of the range, a multiple of GetLargePageSize.
+	* @return The start of the range, or null if no large pages are available.
+	*/
+	static void* AllocateLargePages(const size_t Bytes);
+
+	/**
+	* Releases a range from Reserve or AllocateLargePages.
+	*/
+	static void Release(void* Address);
+
+private:
+	SWindowsVirtualMemory() = delete;	// Not meant for instantiation
+};
+
+using SVirtualMemory = SWindowsVirtualMemory;
@@ -0,0 +1,113 @@
+// The blocks around the camera at a bit per block, see FBlockVolume. Rays walk
+// the volume block by block, so screen space passes can trace what's between a
+// pixel and the sun or the sky. Included by composite stages, which may share a pass.
+
+#ifndef BLOCK_VOLUME_GLSL
+#define BLOCK_VOLUME_GLSL
+
+layout(std140, binding = 5) uniform BlockVolumeBlock
+{
+	ivec4 Center;    // Chunk in the middle of the volume, w is 0 while it holds no chunks
+	ivec4 Radius;    // Chunks held on each side of the center along each axis
+	ivec4 Slots;     // Slots along each axis
+	ivec4 FirstSlot; // Slot of the chunk at Center - Radius
+} BlockVolume;
+
+// Chunk each slot holds, w is 0 for slots that weren't uploaded
+layout (std430, binding = 7) readonly buffer BlockVolumeSlots
+{
+	ivec4 SlotChunks[];
+};
+
+// Each texel is a row of a chunk along x, a bit set for each block that isn't air.
+// Slots are a texel wide, and a chunk tall and deep.
+layout (binding = 13) uniform usampler3D BlockVolumeRows;
+
+// Rows are a texel each, so the volume is only kept for chunks of at most 32 blocks.
+// CHUNK_SIZE_BITS is defined by FShader.
+const int BLOCK_VOLUME_CHUNK_SIZE = 1 << CHUNK_SIZE_BITS;
+
+// Blocks a ray walks through before it's taken as unblocked
+const int MAX_TRACE_STEPS = 192;
+
+// Chunks outside the volume, or not uploaded to it yet, read as air
+bool IsBlockSolid(ivec3 Block)
+{
+	// Arithmetic shifts floor negative blocks to their chunk
+	ivec3 Chunk = Block >> CHUNK_SIZE_BITS;
+	ivec3 Offset = Chunk - BlockVolume.Center.xyz + BlockVolume.Radius.xyz;
+	if (any(lessThan(Offset, ivec3(0))) || any(greaterThan(Offset, BlockVolume.Radius.xyz * 2)))
+		return false;
+
+	ivec3 Slot = (BlockVolume.FirstSlot.xyz + Offset) % BlockVolume.Slots.xyz;
+	int SlotIndex = Slot.x + (Slot.y + Slot.z * BlockVolume.Slots.y) * BlockVolume.Slots.x;
+	if (SlotChunks[SlotIndex] != ivec4(Chunk, 1))
+		return false;
+
+	ivec3 Local = Block & (BLOCK_VOLUME_CHUNK_SIZE - 1);
+	uint Row = texelFetch(BlockVolumeRows, ivec3(Slot.x, Slot.y * BLOCK_VOLUME_CHUNK_SIZE + Local.y, Slot.z * BLOCK_VOLUME_CHUNK_SIZE + Local.z), 0).r;
+	return ((Row >> uint(Local.x)) & 1u) != 0u;
+}
+
+bool IsInBlockVolume(ivec3 Block)
+{
+	ivec3 Offset = (Block >> CHUNK_SIZE_BITS) - BlockVolume.Center.xyz;
+	return all(lessThanEqual(abs(Offset), BlockVolume.Radius.xyz));
+}
+
+// Walks a ray from block to block, Amanatides and Woo. Returns 0 if it hits a solid block within the
+// distance, and 1 if it doesn't or leaves the volume first. The block holding the origin isn't tested.
+float TraceBlockVolume(vec3 Origin, vec3 Direction, float MaxDistance)
+{
+	if (BlockVolume.Center.w == 0)
+		return 1.0;
+
+	ivec3 Block = ivec3(floor(Origin));
+	ivec3 Step = ivec3(sign(Direction));
+	vec3 Delta = 1.0 / max(abs(Direction), vec3(1e-6));
+
+	// Distance along the ray to the next block boundary on each axis, never reached on axes the ray is parallel to
+	vec3 Next = (vec3(Step) * (vec3(Block) - Origin) + max(vec3(Step), vec3(0.0))) * Delta;
+	Next = mix(vec3(1e30), Next, notEqual(Step, ivec3(0)));
+
+	for (int i = 0; i < MAX_TRACE_STEPS; i++)
+	{
+		if (min(Next.x, min(Next.y, Next.z)) > MaxDistance)
+			return 1.0;
+
+		if (Next.x <= Next.y && Next.x <= Next.z)
+		{
+			Block.x += Step.x;
+			Next.x += Delta.x;
+		}
+		else if (Next.y <= Next.z)
+		{
+			Block.y += Step.y;
+			Next.y += Delta.y;
+		}
+		else
+		{
+			Block.z += Step.z;
+			Next.z += Delta.z;
+		}
+
+		if (!IsInBlockVolume(Block))
+			return 1.0;
+		if (IsBlockSolid(Block))
+			return 0.0;
+	}
+	return 1.0;
+}
+
+// The view is rigid, so its inverse rotation is its transpose
+vec3 ViewToWorldPosition(vec3 ViewPosition)
+{
+	return transpose(mat3(Transforms.View)) * (ViewPosition - Transforms.View[3].xyz);
+}
+
+vec3 ViewToWorldDirection(vec3 ViewDirection)
+{
+	return transpose(mat3(Transforms.View)) * ViewDirection;
+}
+
+#endif
@@ -1,27 +1,16 @@
 #version 430 core
 
-#include "DeferredCommon.glsl"
-
-layout (binding = 7) uniform sampler2D AOTex;
-
-uniform uint uBlurSize = 4;
-uniform vec3 uAmbient = vec3(.3, .3, .3);
+#include "CompositeCommon.glsl"
+#include "SSAOComposite.glsl"
 
 out vec4 oColor;
 
 void main()
 {
-	ivec2 ScreenCoord = ivec2(gl_FragCoord.xy);
-	float Sum = 0.0;
-	for(uint y = 0; y < uBlurSize; ++y)
-	{
-		for(uint x = 0; x < uBlurSize; ++x)
-		{
-			Sum += texelFetch(AOTex, ScreenCoord + ivec2(x, y), 0).r;
-		}
-	}
+	vec3 Add;
+	vec3 Scale;
+	SSAOComposite(GetCompositePixel(ivec2(gl_FragCoord.xy)), Add, Scale);
 
-	Sum /= (uBlurSize * uBlurSize);
-	oColor = vec4(Sum * uAmbient * GetColor(ScreenCoord), 1);
+	// Added onto the lit scene
+	oColor = vec4(Add, 1);
 }
-
@@ -0,0 +1,20 @@
+#version 430 core
+
+#include "UniformBlocks.glsl"
+
+// Fills depth before DeferredChunkRender.vert draws the same chunks, so only the
+// nearest fragment of each pixel is shaded. Only the position is used, see
+// ChunkQuad.glsl for the quad layout.
+#include "ChunkQuad.glsl"
+
+// Per draw, read with the base instance of each indirect draw command
+layout (location = 5) in vec3 ChunkOrigin;
+
+// Computed exactly as in DeferredChunkRender.vert, so both passes write the same depths
+invariant gl_Position;
+
+void main()
+{
+	ChunkVertex Vertex = UnpackChunkVertex(uint(gl_VertexID));
+	gl_Position = Transforms.Projection * Transforms.View * vec4(ChunkOrigin + Vertex.Position, 1.0);
+}
@@ -0,0 +1,78 @@
+// Chunk quads pulled from the quad buffer of FChunkGeometryArena, a packed
+// FChunkMesh::Quad for each quad. Chunk draws have no index buffer, each quad
+// is drawn as 6 vertices from 6 times its first quad, so gl_VertexID gives both
+// the quad and its corner. Included by every pass that draws chunk meshes.
+
+#ifndef CHUNK_QUAD_GLSL
+#define CHUNK_QUAD_GLSL
+
+// x holds the first block the face covers at CHUNK_SIZE_BITS an axis, followed by
+// the width less one along the face's u axis and the height less one along its v
+// axis at 5 bits each, then the normal id in 3 bits. y holds the block type in bits
+// 0-7, the light level in bits 8-10 and the ambient occlusion level of each corner
+// in bits 11-18, in the order x, x + du, x + du + dv and x + dv.
+layout (std430, binding = 10) readonly buffer ChunkQuads
+{
+	uvec2 Quads[];
+};
+
+const uint VERTICES_PER_QUAD = 6;
+
+// Layout of x, as FChunkMesh::Quad::Pack packs it. CHUNK_SIZE_BITS is defined by FShader.
+const uint QUAD_POSITION_BITS = CHUNK_SIZE_BITS;
+const uint QUAD_POSITION_MASK = (1u << QUAD_POSITION_BITS) - 1;
+const uint QUAD_WIDTH_SHIFT = 3 * QUAD_POSITION_BITS;
+const uint QUAD_HEIGHT_SHIFT = QUAD_WIDTH_SHIFT + 5;
+const uint QUAD_NORMAL_SHIFT = QUAD_WIDTH_SHIFT + 10;
+
+// Corners of the 2 triangles of a quad, counted from the corner its split starts at
+const uint QUAD_TRIANGLES[6] = uint[6](0u, 1u, 2u, 0u, 2u, 3u);
+
+struct ChunkVertex
+{
+	vec3 Position; // Chunk local
+	uint NormalID;
+	uint BlockType;
+	uint LightLevel;
+	uint OcclusionLevel;
+};
+
+// The position of a corner only depends on the quad, so every pass drawing it computes the same depth
+ChunkVertex UnpackChunkVertex(uint VertexID)
+{
+	const uvec2 Quad = Quads[VertexID / VERTICES_PER_QUAD];
+	const uint NormalID = (Quad.x >> QUAD_NORMAL_SHIFT) & 0x7;
+	const uint Occlusion = (Quad.y >> 11) & 0xFF;
+
+	// Faces lie along axis d, spanning u = (d + 1) % 3 and v = (d + 2) % 3 as in FChunk::GreedyMesh
+	const int d = int(NormalID >> 1);
+	const int u = (d + 1) % 3;
+	const int v = (d + 2) % 3;
+	const bool BackFace = (NormalID & 1) != 0;
+
+	// Back faces are wound the other way around
+	const uint Corners[4] = uint[4](0u, BackFace ? 3u : 1u, 2u, BackFace ? 1u : 3u);
+	uint Levels[4];
+	for (int i = 0; i < 4; i++)
+		Levels[i] = (Occlusion >> (Corners[i] * 2)) & 0x3;
+
+	// Split along the diagonal that blends occlusion the same way on every quad
+	const uint FirstCorner = (Levels[0] + Levels[2] > Levels[1] + Levels[3]) ? 1 : 0;
+	const uint Corner = Corners[(FirstCorner + QUAD_TRIANGLES[VertexID % VERTICES_PER_QUAD]) % 4];
+
+	// Back faces lie on the near side of their blocks, front faces on the far side
+	ivec3 Position = ivec3(Quad.x & QUAD_POSITION_MASK, (Quad.x >> QUAD_POSITION_BITS) & QUAD_POSITION_MASK, (Quad.x >> (2 * QUAD_POSITION_BITS)) & QUAD_POSITION_MASK);
+	Position[d] += BackFace ? 0 : 1;
+	Position[u] += (Corner == 1 || Corner == 2) ? int((Quad.x >> QUAD_WIDTH_SHIFT) & 0x1F) + 1 : 0;
+	Position[v] += (Corner >= 2) ? int((Quad.x >> QUAD_HEIGHT_SHIFT) & 0x1F) + 1 : 0;
+
+	ChunkVertex Vertex;
+	Vertex.Position = vec3(Position);
+	Vertex.NormalID = NormalID;
+	Vertex.BlockType = Quad.y & 0xFF;
+	Vertex.LightLevel = (Quad.y >> 8) & 0x7;
+	Vertex.OcclusionLevel = (Occlusion >> (Corner * 2)) & 0x3;
+	return Vertex;
+}
+
+#endif
@@ -0,0 +1,29 @@
+// Pixel data decoded once and shared by every stage of a composited post process.
+// A stage is a function void Name(CompositePixel_t Pixel, out vec3 Add, out vec3 Scale),
+// and its result is blended onto the lit scene as Scene * Scale + Add.
+
+#include "DeferredCommon.glsl"
+
+struct CompositePixel_t
+{
+	ivec2 ScreenCoord;
+	vec3  ViewPosition;
+	float LinearDepth;
+	vec3  Color;
+	vec3  Normal;
+	uint  MaterialID; // 0 for pixels nothing was drawn to
+};
+
+CompositePixel_t GetCompositePixel(ivec2 ScreenCoord)
+{
+	uvec4 Data0 = texelFetch(GBuffer0, ScreenCoord, 0);
+
+	CompositePixel_t Pixel;
+	Pixel.ScreenCoord = ScreenCoord;
+	Pixel.ViewPosition = GetViewPosition(ScreenCoord);
+	Pixel.LinearDepth = -Pixel.ViewPosition.z;
+	Pixel.Color = UnpackColor(Data0);
+	Pixel.Normal = UnpackNormal(Data0);
+	Pixel.MaterialID = UnpackMaterialID(Data0);
+	return Pixel;
+}
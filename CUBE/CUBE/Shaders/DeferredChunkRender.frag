@@ -0,0 +1,25 @@
+#version 430 core
+
+#include "UniformBlocks.glsl"
+#include "GBufferEncoding.glsl"
+
+layout (location = 0) out uvec4 color0;
+
+in VS_OUT 
+{
+	vec3 Normal;
+	vec3 Color;
+	vec2 UV;
+	flat uint MaterialID;
+	flat uint TextureLayer;
+} fs_in;
+
+// Every block texture, a layer each, see FBlockTextureArray
+layout(binding = 14) uniform sampler2DArray BlockTextures;
+
+void main()
+{
+	// Textures repeat once a block, so greedy merged quads tile them
+	vec3 Texel = texture(BlockTextures, vec3(fs_in.UV, float(fs_in.TextureLayer))).rgb;
+	color0 = PackGBuffer(fs_in.Color * Texel, fs_in.Normal, fs_in.MaterialID);
+}
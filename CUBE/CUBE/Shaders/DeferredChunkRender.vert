@@ -2,18 +2,32 @@
 
 #include "UniformBlocks.glsl"
 
-layout (location = 0) in vec4 iPosition;
-layout (location = 4) in uint Normal8_Block8;
+// Quads are pulled from their storage buffer by gl_VertexID, see ChunkQuad.glsl for their layout
+#include "ChunkQuad.glsl"
+
+// Per draw, read with the base instance of each indirect draw command
+layout (location = 5) in vec3 ChunkOrigin;
 
 out VS_OUT 
 {
 	vec3 Normal;
 	vec3 Color;
+	vec2 UV;
 	flat uint MaterialID;
+	flat uint TextureLayer;
 } vs_out;
 
 layout(binding = 4) uniform sampler1D BlockColors;
 
+// Texture layer of each face of each block type, at BlockType * 6 + NormalID, see FBlockTextureArray
+layout (std430, binding = 11) readonly buffer BlockFaceLayers
+{
+	uint FaceLayers[];
+};
+
+// Depth must match ChunkDepthPrePass.vert exactly
+invariant gl_Position;
+
 const vec3 BlockNormals[6] =
 {
 	vec3( 1,  0,  0),
@@ -24,16 +38,37 @@ const vec3 BlockNormals[6] =
 	vec3( 0,  0, -1)
 };
 
+// Brightness of each baked light level, from dark to fully lit
+const float LightLevels[8] =
+{
+	0.05, 0.09, 0.15, 0.23, 0.34, 0.5, 0.72, 1.0
+};
+
+// Brightness of each baked ambient occlusion level, from fully occluded to open
+const float OcclusionLevels[4] =
+{
+	0.5, 0.66, 0.83, 1.0
+};
+
 void main()
 {
+	ChunkVertex Vertex = UnpackChunkVertex(uint(gl_VertexID));
+
 	// Unpack color
-	vs_out.Color = texelFetch(BlockColors, int(Normal8_Block8 & 0xFF), 0).xyz;
+	vs_out.Color = texelFetch(BlockColors, int(Vertex.BlockType), 0).xyz;
+	vs_out.Color *= LightLevels[Vertex.LightLevel];
+	vs_out.Color *= OcclusionLevels[Vertex.OcclusionLevel];
 
-	// Unpack normal and lookup with table
-	vec3 WorldNormal = BlockNormals[(Normal8_Block8 & 0xFF00) >> 8];
+	// Lookup normal with table
+	vec3 WorldNormal = BlockNormals[Vertex.NormalID];
 	vs_out.Normal = mat3(Transforms.View) * WorldNormal;
 
+	// UVs are in blocks, and side faces keep y up so their textures stand upright
+	uint Axis = Vertex.NormalID >> 1;
+	vs_out.UV = Axis == 0 ? Vertex.Position.zy : (Axis == 1 ? Vertex.Position.xz : Vertex.Position.xy);
+	vs_out.TextureLayer = FaceLayers[Vertex.BlockType * 6 + Vertex.NormalID];
+
 	vs_out.MaterialID = uint(gl_VertexID);
 
-	gl_Position = Transforms.Projection * Transforms.View * iPosition;
+	gl_Position = Transforms.Projection * Transforms.View * vec4(ChunkOrigin + Vertex.Position, 1.0);
 }
\ No newline at end of file
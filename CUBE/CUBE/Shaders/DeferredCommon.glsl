@@ -1,8 +1,13 @@
 #include "UniformBlocks.glsl"
+#include "GBufferEncoding.glsl"
 
 layout (binding = 0) uniform usampler2D GBuffer0;
 layout (binding = 2) uniform sampler2D DepthTexture;
 
+// Depth is reversed in a zero to one range, see FPerspectiveMatrix. Cleared pixels are at 0,
+// infinitely far with an infinite projection, so depth is kept above this to stay finite.
+const float MIN_DEPTH = 1e-6;
+
 struct FragmentData_t
 {
 	vec3 Color;
@@ -14,40 +19,35 @@ struct FragmentData_t
 vec3 GetViewPosition(ivec2 ScreenCoord)
 {
 	vec2 NDC = ((ScreenCoord * 2.0) / Resolution) - 1.0;
-	float Depth = texelFetch(DepthTexture, ScreenCoord, 0).r * 2.0 - 1.0;
+	float Depth = max(texelFetch(DepthTexture, ScreenCoord, 0).r, MIN_DEPTH);
 	vec4 View = Transforms.InvProjection * vec4(NDC, Depth, 1.0);
 	return View.xyz / View.w;
 }
 
 vec3 GetNormal(ivec2 ScreenCoord)
 {
-	uvec4 Data0 = texelFetch(GBuffer0, ScreenCoord, 0);
-	vec2 ColorZNormX = unpackHalf2x16(Data0.y);
-	return normalize(vec3(ColorZNormX.y, unpackHalf2x16(Data0.z)));
+	return UnpackNormal(texelFetch(GBuffer0, ScreenCoord, 0));
 }
 
 vec3 GetColor(ivec2 ScreenCoord)
 {
-	uvec4 Data0 = texelFetch(GBuffer0, ScreenCoord, 0);
-	vec2 ColorZNormX = unpackHalf2x16(Data0.y);
-	return vec3(unpackHalf2x16(Data0.x), ColorZNormX.x);
+	return UnpackColor(texelFetch(GBuffer0, ScreenCoord, 0));
 }
 
 float GetLinearDepth(ivec2 ScreenCoord)
 {
-	float Depth = texelFetch(DepthTexture, ScreenCoord, 0).r;
-    float z = Depth * 2.0 - 1.0; // Back to NDC 
-    return (2.0 * ProjectionInfo.Near * ProjectionInfo.Far) / (ProjectionInfo.Far + ProjectionInfo.Near - z * (ProjectionInfo.Far - ProjectionInfo.Near));	
+	// Depth is NDC in the zero to one range, for a view distance of Projection[3][2] / (Depth + Projection[2][2])
+	float Depth = max(texelFetch(DepthTexture, ScreenCoord, 0).r, MIN_DEPTH);
+	return Transforms.Projection[3][2] / (Depth + Transforms.Projection[2][2]);
 }
 
 void UnpackGBuffer(ivec2 ScreenCoord, out FragmentData_t Fragment)
 {
 	uvec4 Data0 = texelFetch(GBuffer0, ScreenCoord, 0);
 
-	vec2 ColorZNormX = unpackHalf2x16(Data0.y);
-	Fragment.Color = vec3(unpackHalf2x16(Data0.x), ColorZNormX.x);
-	Fragment.Normal = normalize(vec3(ColorZNormX.y, unpackHalf2x16(Data0.z)));
-	Fragment.MaterialID = Data0.w;
+	Fragment.Color = UnpackColor(Data0);
+	Fragment.Normal = UnpackNormal(Data0);
+	Fragment.MaterialID = UnpackMaterialID(Data0);
 
 	Fragment.ViewCoord = GetViewPosition(ScreenCoord);
 }
\ No newline at end of file
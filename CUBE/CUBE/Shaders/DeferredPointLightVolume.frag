@@ -0,0 +1,18 @@
+#version 430 core
+
+// Shades the pixels in one point light's scissor rect, for the light volume
+// path of FPointLightSystem.
+
+#include "DeferredCommon.glsl"
+#include "PointLighting.glsl"
+
+uniform uint uLightIndex;
+
+void main()
+{
+	FragmentData_t Fragment;
+
+	UnpackGBuffer(ivec2(gl_FragCoord.xy), Fragment);
+
+	gl_FragColor = ApplyLighting(Fragment, Lights[uLightIndex]);
+}
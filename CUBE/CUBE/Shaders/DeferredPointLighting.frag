@@ -1,64 +1,34 @@
 #version 430 core
 
+// Shades each pixel with the point lights binned into its tile and depth slice
+// by TiledLightCulling.comp.
+
 #include "DeferredCommon.glsl"
+#include "TiledLighting.glsl"
 
-// sizeof = 40
-struct PointLight_t
+void main()
 {
-    // std140 alignment      Base Align		Aligned Offset		End
-	vec3 ViewPosition;     //    16               0              12
-	vec3 Color;            //    16               16             28
-	float Constant;        //     4               28             32   
-	float Linear;          //     4               32             36   
-	float Quadratic;       //     4               36             40     
-	float Intensity;       //     4               40             44
-};
+	FragmentData_t Fragment;
 
-layout(std140, binding = 10) uniform PointLightBlock
-{
-    PointLight_t PointLight;
-};
+	ivec2 Pixel = ivec2(gl_FragCoord.xy);
+	UnpackGBuffer(Pixel, Fragment);
 
-vec4 ApplyLighting(FragmentData_t Fragment, PointLight_t Light)
-{
-	vec4 Result = vec4(0.0, 0.0, 0.0, 1.0);
+	uvec2 Tile = uvec2(Pixel) / TILE_SIZE;
+	uint TileIndex = Tile.y * GetTileCountX() + Tile.x;
+	uint LightCount = Tiles[TileIndex].LightCount;
 
-	// Unfilled fragments will have a material id of 0
-	if (Fragment.MaterialID != 0)
+	vec4 Result = vec4(0.0, 0.0, 0.0, 1.0);
+	if (LightCount > 0)
 	{
-		// Get light direction and distance
-		vec3 L =  Light.ViewPosition - Fragment.ViewCoord;
-		float Distance = length(L);
-		L = normalize(L);
-
-		float Attenuation = Light.Intensity / (Light.Constant + Light.Linear * Distance + Light.Quadratic * Distance * Distance);
-
-		// Normal and reflection vectors
-		vec3 N = normalize(Fragment.Normal);
-		vec3 H = normalize(L - Fragment.ViewCoord);
-
-		// Calc lighting
-		float NdotH = max(0.0, dot(N, H));
-		float NdotL = max(0.0, dot(N, L));
-
-		vec3 Diffuse = Light.Color * Fragment.Color * NdotL * Attenuation;
-
-		vec3 Specular;
-		if(NdotL < 0.0)
-			Specular = vec3(0,0,0);
-		else
-			Specular = Light.Color * Fragment.Color * pow(NdotH, 4) * Attenuation;
-		
-		Result += vec4(Diffuse + Specular, 0.0);;
+		uint SliceBit = 1u << GetDepthSlice(-Fragment.ViewCoord.z, Tiles[TileIndex].MinDepth, Tiles[TileIndex].MaxDepth);
+
+		for (uint i = 0; i < LightCount; i++)
+		{
+			TileLight_t Entry = TileLightList[TileIndex * MAX_LIGHTS_PER_TILE + i];
+			if ((Entry.SliceMask & SliceBit) != 0)
+				Result.rgb += ApplyLighting(Fragment, Lights[Entry.LightIndex]).rgb;
+		}
 	}
-	return Result;
-}
-
-void main()
-{
-	FragmentData_t Fragment;
-
-	UnpackGBuffer(ivec2(gl_FragCoord.xy), Fragment);
 
-	gl_FragColor = ApplyLighting(Fragment, PointLight);
+	gl_FragColor = Result;
 }
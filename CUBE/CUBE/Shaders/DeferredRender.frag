@@ -1,5 +1,8 @@
 #version 430 core
 
+#include "UniformBlocks.glsl"
+#include "GBufferEncoding.glsl"
+
 layout (location = 0) out uvec4 color0;
 
 in VS_OUT 
@@ -11,12 +14,5 @@ in VS_OUT
 
 void main()
 {
-	uvec4 OutVec0 = uvec4(0);
-
-	OutVec0.x = packHalf2x16(fs_in.Color.xy);
-	OutVec0.y = packHalf2x16(vec2(fs_in.Color.z, fs_in.Normal.x));
-	OutVec0.z = packHalf2x16(fs_in.Normal.yz);
-	OutVec0.w = fs_in.MaterialID;
-
-	color0 = OutVec0;
-}
\ No newline at end of file
+	color0 = PackGBuffer(fs_in.Color, fs_in.Normal, fs_in.MaterialID);
+}
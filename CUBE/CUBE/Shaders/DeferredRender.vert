@@ -6,6 +6,15 @@ layout ( location = 0 ) in vec3 vPosition;
 layout( location = 1 ) in vec3 vNormal;
 layout( location = 2 ) in vec4 vColor;
 
+// Model matrix of every object drawn this frame, sorted by mesh
+layout (std430, binding = 6) readonly buffer ModelTransforms
+{
+	mat4 Models[];
+};
+
+// Index of the first instance of the draw in Models
+uniform uint uFirstInstance = 0;
+
 out VS_OUT 
 {
 	vec3 Normal;
@@ -15,9 +24,11 @@ out VS_OUT
 
 void main()
 {
+	mat4 Model = Models[uFirstInstance + uint(gl_InstanceID)];
+
 	vs_out.Color = vColor.xyz;
-	vs_out.Normal = mat3(Transforms.View) * mat3(Transforms.Model) * vNormal;
+	vs_out.Normal = mat3(Transforms.View) * mat3(Model) * vNormal;
 	vs_out.MaterialID = uint(gl_VertexID);
 
-	gl_Position = Transforms.Projection * Transforms.View * Transforms.Model * vec4(vPosition, 1.0);
+	gl_Position = Transforms.Projection * Transforms.View * Model * vec4(vPosition, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 430 core
+
+// Renders chunk meshes into a shadow map. Only the position is used,
+// see ChunkQuad.glsl for the quad layout.
+#include "ChunkQuad.glsl"
+
+// Per draw, read with the base instance of each indirect draw command
+layout (location = 5) in vec3 ChunkOrigin;
+
+uniform mat4 uViewProjection;
+
+void main()
+{
+	ChunkVertex Vertex = UnpackChunkVertex(uint(gl_VertexID));
+	gl_Position = uViewProjection * vec4(ChunkOrigin + Vertex.Position, 1.0);
+}
@@ -0,0 +1,137 @@
+// Composite stage of FDirectionalLightSystem, adds the light of every directional light
+// with shadows from the first. DeferredDirectionalLighting.frag runs it on its own when not composited.
+
+#include "BlockVolume.glsl"
+
+// sizeof = 32
+struct DirectionalLight_t
+{
+	// std430 alignment      Base Align		Aligned Offset		End
+	vec3 Direction;         //    16               0              12
+	vec3 Color;            //    16               16             28
+};
+
+// Every directional light of the frame
+layout (std430, binding = 5) readonly buffer DirectionalLights
+{
+	DirectionalLight_t Lights[];
+};
+
+uniform uint uDirectionalLightCount;
+
+// Shadows of the first light, one map for each cascade. Matrices take view
+// space to the texture space of a cascade, and each split is the view depth
+// where a cascade ends.
+const int CASCADE_COUNT = 3;
+
+uniform mat4 uCascadeMatrices[CASCADE_COUNT];
+uniform vec4 uCascadeSplits;
+
+layout (binding = 9) uniform sampler2DShadow ShadowCascade0;
+layout (binding = 10) uniform sampler2DShadow ShadowCascade1;
+layout (binding = 11) uniform sampler2DShadow ShadowCascade2;
+
+// View space distance along the normal shadows are looked up from, scaled by cascade
+const float NORMAL_OFFSET = 0.04;
+
+// Set when shadows are traced through the block volume, leaving the cascades unbound
+uniform uint uIsShadowTraced = 0;
+
+// Blocks a shadow ray is traced toward the light, and its start off the surface
+const float SHADOW_TRACE_DISTANCE = 64.0;
+const float SHADOW_TRACE_OFFSET = 0.01;
+
+vec4 ApplyLighting(FragmentData_t Fragment, DirectionalLight_t Light)
+{
+	vec4 Result = vec4(0.0, 0.0, 0.0, 1.0);
+
+	// Unfilled fragments will have a material id of 0
+	if (Fragment.MaterialID != 0)
+	{
+		// Normal and reflection vectors
+		vec3 L = mat3(Transforms.View) * (-Light.Direction);
+		vec3 N = normalize(Fragment.Normal);
+		vec3 H = normalize(L - Fragment.ViewCoord);
+
+		// Calc lighting
+		float NdotH = max(0.0, dot(N, H));
+		float NdotL = max(0.0, dot(N, L));
+
+		vec3 Diffuse = Light.Color * Fragment.Color * NdotL;
+
+		//vec3 Specular;
+		//if(NdotL < 0.0)
+		//	Specular = vec3(0,0,0);
+		//else
+		//	Specular = Light.Color * Fragment.Color * pow(NdotH, 4);
+
+		Result += vec4(Diffuse, 0.0);
+	}
+	return Result;
+}
+
+// 3x3 texel percentage closer filter, each tap bilinearly compared by the sampler
+float SampleShadow(sampler2DShadow ShadowMap, vec3 Coord)
+{
+	vec2 TexelSize = 1.0 / vec2(textureSize(ShadowMap, 0));
+
+	float Lit = 0.0;
+	for (int y = -1; y <= 1; y++)
+	{
+		for (int x = -1; x <= 1; x++)
+			Lit += texture(ShadowMap, vec3(Coord.xy + vec2(x, y) * TexelSize, Coord.z));
+	}
+	return Lit / 9.0;
+}
+
+// Blocks between the pixel and the light, pixels outside the volume are lit
+float TraceShadow(FragmentData_t Fragment, DirectionalLight_t Light)
+{
+	vec3 Normal = ViewToWorldDirection(normalize(Fragment.Normal));
+	vec3 Origin = ViewToWorldPosition(Fragment.ViewCoord) + Normal * SHADOW_TRACE_OFFSET;
+	return TraceBlockVolume(Origin, normalize(-Light.Direction), SHADOW_TRACE_DISTANCE);
+}
+
+float GetShadow(FragmentData_t Fragment)
+{
+	float Depth = -Fragment.ViewCoord.z;
+	int Cascade = Depth < uCascadeSplits.x ? 0 : Depth < uCascadeSplits.y ? 1 : Depth < uCascadeSplits.z ? 2 : CASCADE_COUNT;
+	if (Cascade == CASCADE_COUNT)
+		return 1.0;
+
+	// Farther cascades have larger texels, so they are looked up further from the surface
+	vec3 Position = Fragment.ViewCoord + normalize(Fragment.Normal) * NORMAL_OFFSET * float(1 << Cascade);
+	vec3 Coord = (uCascadeMatrices[Cascade] * vec4(Position, 1.0)).xyz;
+
+	// Samplers are picked with constant indices, which every GPU supports
+	if (Cascade == 0)
+		return SampleShadow(ShadowCascade0, Coord);
+	else if (Cascade == 1)
+		return SampleShadow(ShadowCascade1, Coord);
+	return SampleShadow(ShadowCascade2, Coord);
+}
+
+void DirectionalComposite(CompositePixel_t Pixel, out vec3 Add, out vec3 Scale)
+{
+	FragmentData_t Fragment;
+	Fragment.Color = Pixel.Color;
+	Fragment.Normal = Pixel.Normal;
+	Fragment.ViewCoord = Pixel.ViewPosition;
+	Fragment.MaterialID = Pixel.MaterialID;
+
+	Add = vec3(0.0);
+	if (uDirectionalLightCount > 0 && Fragment.MaterialID != 0)
+	{
+		// Surfaces facing away from the light aren't traced
+		vec3 Light = ApplyLighting(Fragment, Lights[0]).rgb;
+		if (uIsShadowTraced == 0)
+			Add += Light * GetShadow(Fragment);
+		else if (any(greaterThan(Light, vec3(0.0))))
+			Add += Light * TraceShadow(Fragment, Lights[0]);
+	}
+
+	for (uint i = 1; i < uDirectionalLightCount; i++)
+		Add += ApplyLighting(Fragment, Lights[i]).rgb;
+
+	Scale = vec3(1.0);
+}
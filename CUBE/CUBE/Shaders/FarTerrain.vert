@@ -0,0 +1,27 @@
+#version 430 core
+
+#include "UniformBlocks.glsl"
+
+// World space corner of the far terrain grid, on top of the column's highest block
+layout (location = 0) in vec3 Position;
+layout (location = 1) in vec3 Normal;
+layout (location = 2) in uint BlockType;
+
+out VS_OUT 
+{
+	vec3 Normal;
+	vec3 Color;
+	flat uint MaterialID;
+} vs_out;
+
+layout(binding = 4) uniform sampler1D BlockColors;
+
+void main()
+{
+	// The surface is fully sky lit and unoccluded, as the tops of chunk meshes are
+	vs_out.Color = texelFetch(BlockColors, int(BlockType), 0).xyz;
+	vs_out.Normal = mat3(Transforms.View) * normalize(Normal);
+	vs_out.MaterialID = uint(gl_VertexID);
+
+	gl_Position = Transforms.Projection * Transforms.View * vec4(Position, 1.0);
+}
@@ -0,0 +1,20 @@
+// Composite stage of FFogPostProcess, fades the scene into the fog color with distance
+
+layout(std140, binding = 8) uniform FogParamsBlock
+{
+//   Member				Base Align		Aligned Offset		End
+	float Density;   //	    4					0			4
+	float Min;       //	    4					4			8
+	float Max;       //	    4					8			12
+	vec3  Color;   	 //		16					16			32
+} FogParams; 
+
+void FogComposite(CompositePixel_t Pixel, out vec3 Add, out vec3 Scale)
+{
+	// No sqrt since using exp fog
+	float DistanceSquared = dot(Pixel.ViewPosition, Pixel.ViewPosition);
+	float FogFactor = clamp(exp(-FogParams.Density * DistanceSquared), FogParams.Min, FogParams.Max);
+
+	Add = FogParams.Color * (1.0 - FogFactor);
+	Scale = vec3(FogFactor);
+}
@@ -0,0 +1,56 @@
+// Packing of surfaces into the G-Buffer. The wide layout holds half float color
+// and normal, and a material id that is 0 for unfilled pixels. The compact layout
+// holds 8 bit color with a filled flag in its last byte, and an octahedral normal.
+
+vec2 OctahedronWrap(vec2 V)
+{
+	return (1.0 - abs(V.yx)) * vec2(V.x >= 0.0 ? 1.0 : -1.0, V.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Folds a unit vector onto the [-1, 1] square
+vec2 EncodeOctahedron(vec3 Normal)
+{
+	Normal /= abs(Normal.x) + abs(Normal.y) + abs(Normal.z);
+	return Normal.z >= 0.0 ? Normal.xy : OctahedronWrap(Normal.xy);
+}
+
+vec3 DecodeOctahedron(vec2 Encoded)
+{
+	vec3 Normal = vec3(Encoded, 1.0 - abs(Encoded.x) - abs(Encoded.y));
+	float Fold = clamp(-Normal.z, 0.0, 1.0);
+	Normal.xy += vec2(Normal.x >= 0.0 ? -Fold : Fold, Normal.y >= 0.0 ? -Fold : Fold);
+	return normalize(Normal);
+}
+
+uvec4 PackGBuffer(vec3 Color, vec3 Normal, uint MaterialID)
+{
+	if (GBufferLayout.IsCompact != 0)
+		return uvec4(packUnorm4x8(vec4(Color, 1.0)), packSnorm2x16(EncodeOctahedron(normalize(Normal))), 0, 0);
+
+	return uvec4(packHalf2x16(Color.xy), packHalf2x16(vec2(Color.z, Normal.x)), packHalf2x16(Normal.yz), MaterialID);
+}
+
+vec3 UnpackColor(uvec4 Data)
+{
+	if (GBufferLayout.IsCompact != 0)
+		return unpackUnorm4x8(Data.x).rgb;
+
+	return vec3(unpackHalf2x16(Data.x), unpackHalf2x16(Data.y).x);
+}
+
+vec3 UnpackNormal(uvec4 Data)
+{
+	if (GBufferLayout.IsCompact != 0)
+		return DecodeOctahedron(unpackSnorm2x16(Data.y));
+
+	return normalize(vec3(unpackHalf2x16(Data.y).y, unpackHalf2x16(Data.z)));
+}
+
+// 0 for pixels nothing was drawn to
+uint UnpackMaterialID(uvec4 Data)
+{
+	if (GBufferLayout.IsCompact != 0)
+		return Data.x >> 24;
+
+	return Data.w;
+}
@@ -0,0 +1,13 @@
+// The particle ring of FParticleSystem, shared by its compute and render passes.
+
+// Matches FParticleSystem::MAX_PARTICLES
+const uint MAX_PARTICLES = 65536;
+
+// 32 bytes, as FParticleSystem allocates them. Slots with no life left hold no particle.
+struct Particle
+{
+	vec3  Position;
+	float Life;      // Seconds left
+	vec3  Velocity;
+	uint  BlockType;
+};
@@ -0,0 +1,72 @@
+#version 430 core
+
+// Draws each particle of the ring as a cube colored by its block type, see
+// FParticleSystem. Cubes are built from the vertex id, and each instance is a
+// slot of the ring. Slots whose particle died are drawn as degenerate cubes.
+
+#include "UniformBlocks.glsl"
+#include "ParticleCommon.glsl"
+
+layout (std430, binding = 8) readonly buffer Particles
+{
+	Particle Ring[];
+};
+
+layout(binding = 4) uniform sampler1D BlockColors;
+
+uniform uint uFirstSlot; // Slot of the first instance
+
+out VS_OUT 
+{
+	vec3 Normal;
+	vec3 Color;
+	flat uint MaterialID;
+} vs_out;
+
+// Edge of a particle's cube in blocks
+const float CUBE_SIZE = 0.2;
+
+// Seconds a particle shrinks over before it dies
+const float SHRINK_TIME = 0.5;
+
+// Corners of the 2 triangles of each face, along the face's u and v axes
+const vec2 FaceCorners[6] =
+{
+	vec2(0, 0), vec2(1, 0), vec2(1, 1),
+	vec2(0, 0), vec2(1, 1), vec2(0, 1)
+};
+
+void main()
+{
+	const Particle P = Ring[(uFirstSlot + uint(gl_InstanceID)) % MAX_PARTICLES];
+
+	vs_out.MaterialID = 1u;
+	if (P.Life <= 0.0)
+	{
+		vs_out.Normal = vec3(0.0);
+		vs_out.Color = vec3(0.0);
+		gl_Position = vec4(0.0);
+		return;
+	}
+
+	// Positive faces have even ids. Axes u and v cross to the face normal, so triangles wind outward.
+	const uint Face = uint(gl_VertexID) / 6u;
+	const int d = int(Face >> 1u);
+	const bool BackFace = (Face & 1u) != 0u;
+	const int u = BackFace ? (d + 2) % 3 : (d + 1) % 3;
+	const int v = BackFace ? (d + 1) % 3 : (d + 2) % 3;
+
+	vec3 Normal = vec3(0.0);
+	Normal[d] = BackFace ? -1.0 : 1.0;
+
+	const vec2 Corner = FaceCorners[uint(gl_VertexID) % 6u];
+	vec3 Local = Normal * 0.5;
+	Local[u] += Corner.x - 0.5;
+	Local[v] += Corner.y - 0.5;
+
+	const float Size = CUBE_SIZE * min(P.Life / SHRINK_TIME, 1.0);
+
+	vs_out.Color = texelFetch(BlockColors, int(P.BlockType), 0).xyz;
+	vs_out.Normal = mat3(Transforms.View) * Normal;
+	gl_Position = Transforms.Projection * Transforms.View * vec4(P.Position + Local * Size, 1.0);
+}
@@ -0,0 +1,60 @@
+// Point light shading shared by the tiled and light volume paths. Needs
+// DeferredCommon.glsl to be included first.
+
+// sizeof = 48
+struct PointLight_t
+{
+	// std430 alignment      Base Align		Aligned Offset		End
+	vec3 ViewPosition;     //    16               0              12
+	float Radius;          //     4               12             16
+	vec3 Color;            //    16               16             28
+	float Intensity;       //     4               28             32
+	float Constant;        //     4               32             36
+	float Linear;          //     4               36             40
+	float Quadratic;       //     4               40             44
+};
+
+// Every visible light of the frame
+layout (std430, binding = 2) readonly buffer PointLights
+{
+	PointLight_t Lights[];
+};
+
+vec4 ApplyLighting(FragmentData_t Fragment, PointLight_t Light)
+{
+	vec4 Result = vec4(0.0, 0.0, 0.0, 1.0);
+
+	// Unfilled fragments will have a material id of 0
+	if (Fragment.MaterialID != 0)
+	{
+		// Get light direction and distance
+		vec3 L =  Light.ViewPosition - Fragment.ViewCoord;
+		float Distance = length(L);
+		L = normalize(L);
+
+		float Attenuation = Light.Intensity / (Light.Constant + Light.Linear * Distance + Light.Quadratic * Distance * Distance);
+
+		// Fade out at the edge of the light's volume, where it stops being drawn
+		float Falloff = clamp(1.0 - pow(Distance / Light.Radius, 4.0), 0.0, 1.0);
+		Attenuation *= Falloff * Falloff;
+
+		// Normal and reflection vectors
+		vec3 N = normalize(Fragment.Normal);
+		vec3 H = normalize(L - Fragment.ViewCoord);
+
+		// Calc lighting
+		float NdotH = max(0.0, dot(N, H));
+		float NdotL = max(0.0, dot(N, L));
+
+		vec3 Diffuse = Light.Color * Fragment.Color * NdotL * Attenuation;
+
+		vec3 Specular;
+		if(NdotL < 0.0)
+			Specular = vec3(0,0,0);
+		else
+			Specular = Light.Color * Fragment.Color * pow(NdotH, 4) * Attenuation;
+		
+		Result += vec4(Diffuse + Specular, 0.0);;
+	}
+	return Result;
+}
@@ -0,0 +1,81 @@
+// Composite stage of FSSAOPostProcess, adds ambient light scaled by occlusion
+
+#include "BlockVolume.glsl"
+
+layout (binding = 7) uniform sampler2D AOTex;
+layout (binding = 12) uniform sampler2D SSAODepth;
+
+uniform uint uSSAOBlurSize = 4;
+uniform vec3 uSSAOAmbient = vec3(.3, .3, .3);
+
+// Screen pixels per occlusion texel along each axis
+uniform uint uSSAODownsample = 1;
+
+// Zero when the occlusion pass is off, leaving ambient light only
+uniform uint uSSAOIsOccluded = 1;
+
+// Set when occlusion is traced through the block volume instead of read from the occlusion pass
+uniform uint uSSAOIsTraced = 0;
+
+// Depth difference, relative to the pixel's depth, where a tap's weight falls to about a third
+const float SSAO_DEPTH_TOLERANCE = 0.05;
+
+// Blocks each occlusion ray is traced over, and its start off the surface
+const float SSAO_TRACE_DISTANCE = 4.0;
+const float SSAO_TRACE_OFFSET = 0.01;
+
+// Rays along the normal and tilted toward each tangent, z is the normal
+const int SSAO_TRACE_RAYS = 5;
+const vec3 SSAO_TRACE_DIRECTIONS[SSAO_TRACE_RAYS] = vec3[](
+	vec3(0.0, 0.0, 1.0), vec3(0.707, 0.0, 0.707), vec3(-0.707, 0.0, 0.707), vec3(0.0, 0.707, 0.707), vec3(0.0, -0.707, 0.707));
+
+// Share of the rays around the normal that no block stops
+float TraceOcclusion(CompositePixel_t Pixel)
+{
+	vec3 Normal = ViewToWorldDirection(normalize(Pixel.Normal));
+	vec3 Tangent = normalize(cross(Normal, (abs(Normal.y) < 0.99) ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+	mat3 Basis = mat3(Tangent, cross(Normal, Tangent), Normal);
+	vec3 Origin = ViewToWorldPosition(Pixel.ViewPosition) + Normal * SSAO_TRACE_OFFSET;
+
+	float Open = 0.0;
+	for (int i = 0; i < SSAO_TRACE_RAYS; i++)
+		Open += TraceBlockVolume(Origin, Basis * SSAO_TRACE_DIRECTIONS[i], SSAO_TRACE_DISTANCE);
+	return Open / float(SSAO_TRACE_RAYS);
+}
+
+void SSAOComposite(CompositePixel_t Pixel, out vec3 Add, out vec3 Scale)
+{
+	float Sum = 1.0;
+	if(uSSAOIsOccluded != 0)
+	{
+		ivec2 OcclusionCoord = Pixel.ScreenCoord / int(uSSAODownsample);
+		ivec2 Limit = min(textureSize(AOTex, 0), (ivec2(Resolution) + int(uSSAODownsample) - 1) / int(uSSAODownsample)) - 1;
+		int First = -int(uSSAOBlurSize) / 2;
+
+		// Bilateral blur and upsample, taps across a depth edge from the pixel barely count
+		Sum = 0.0;
+		float WeightSum = 0.0;
+		for(int y = 0; y < int(uSSAOBlurSize); ++y)
+		{
+			for(int x = 0; x < int(uSSAOBlurSize); ++x)
+			{
+				ivec2 TapCoord = clamp(OcclusionCoord + ivec2(First + x, First + y), ivec2(0), Limit);
+				float TapDepth = texelFetch(SSAODepth, TapCoord, 0).r;
+				float Weight = exp(-abs(TapDepth - Pixel.LinearDepth) / (Pixel.LinearDepth * SSAO_DEPTH_TOLERANCE));
+
+				Sum += Weight * texelFetch(AOTex, TapCoord, 0).r;
+				WeightSum += Weight;
+			}
+		}
+
+		// Every tap can be across an edge around thin objects, then the nearest one is used
+		Sum = (WeightSum > 1e-4) ? Sum / WeightSum : texelFetch(AOTex, OcclusionCoord, 0).r;
+	}
+	else if(uSSAOIsTraced != 0 && Pixel.MaterialID != 0)
+	{
+		Sum = TraceOcclusion(Pixel);
+	}
+
+	Add = Sum * uSSAOAmbient * Pixel.Color;
+	Scale = vec3(1.0);
+}
@@ -0,0 +1,33 @@
+#version 430 core
+
+#include "DeferredCommon.glsl"
+
+// Screen pixels per occlusion texel along each axis
+uniform uint uDownsample = 1;
+
+// Linear depth of the closest pixel in the block, and its offset in the block as x + y * uDownsample
+out vec2 oDepth;
+
+void main()
+{
+	ivec2 BlockCoord = ivec2(gl_FragCoord.xy) * int(uDownsample);
+	ivec2 Limit = ivec2(Resolution) - 1;
+
+	// The closest pixel is kept, so thin objects in front still occlude what is behind them
+	float Closest = ProjectionInfo.Far * 2.0;
+	int ClosestOffset = 0;
+	for (int y = 0; y < int(uDownsample); ++y)
+	{
+		for (int x = 0; x < int(uDownsample); ++x)
+		{
+			float Depth = GetLinearDepth(min(BlockCoord + ivec2(x, y), Limit));
+			if (Depth < Closest)
+			{
+				Closest = Depth;
+				ClosestOffset = x + y * int(uDownsample);
+			}
+		}
+	}
+
+	oDepth = vec2(Closest, float(ClosestOffset));
+}
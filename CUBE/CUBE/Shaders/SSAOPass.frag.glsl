@@ -5,25 +5,43 @@
 layout (binding = 5) uniform sampler1D KernalSamples;
 layout (binding = 6) uniform sampler2D NoiseSamples;
 
+// Written by SSAODepthDownsample.frag.glsl at the occlusion resolution
+layout (binding = 12) uniform sampler2D SSAODepth;
+
 uniform uint uKernalSize = 16;
 uniform uint uNoiseSize = 4;
 uniform float uRadius = 1.25;
 uniform float uPower = 1.5;
 
+// Screen pixels per occlusion texel along each axis
+uniform uint uDownsample = 1;
+
+// Linear depth a sample must be behind the surface it's compared to, so reduced depth doesn't occlude itself
+const float DEPTH_BIAS = 0.025;
+
 out float oOcclusion;
 
-float LDepth(float Depth)
+// View space direction through an NDC position, scaled to a linear depth of 1
+vec3 GetViewRay(vec2 NDC)
 {
-    return (2.0 * ProjectionInfo.Near) / (ProjectionInfo.Far + ProjectionInfo.Near - Depth * (ProjectionInfo.Far - ProjectionInfo.Near));	
+	// Taken at the near plane, at a depth of 1
+	vec4 View = Transforms.InvProjection * vec4(NDC, 1.0, 1.0);
+	vec3 Ray = View.xyz / View.w;
+	return Ray / -Ray.z;
 }
 
 void main()
 {
-	ivec2 ScreenCoord = ivec2(gl_FragCoord.xy);
-	ivec2 NoiseCoord = ScreenCoord % int(uNoiseSize);
-	vec2 TexCoord = vec2(ScreenCoord) / vec2(Resolution);
+	ivec2 OcclusionCoord = ivec2(gl_FragCoord.xy);
+	ivec2 NoiseCoord = OcclusionCoord % int(uNoiseSize);
+	ivec2 OcclusionLimit = textureSize(SSAODepth, 0) - 1;
 
-	vec3 Position = GetViewPosition(ScreenCoord);
+	// The pixel of the block the depth was kept from
+	vec2 BlockDepth = texelFetch(SSAODepth, OcclusionCoord, 0).rg;
+	int Offset = int(BlockDepth.g);
+	ivec2 ScreenCoord = min(OcclusionCoord * int(uDownsample) + ivec2(Offset % int(uDownsample), Offset / int(uDownsample)), ivec2(Resolution) - 1);
+
+	vec3 Position = GetViewRay(((ScreenCoord * 2.0) / Resolution) - 1.0) * BlockDepth.r;
 	vec3 Normal = GetNormal(ScreenCoord);
 
 	// Construct change of basis about the normal
@@ -43,9 +61,12 @@ void main()
 		SampleCoord.xyz /= SampleCoord.w;
 		SampleCoord.xy = SampleCoord.xy * 0.5 + 0.5;
 
-		float SampledDepth = texture(DepthTexture, SampleCoord.xy).r * 2.0 - 1.0;
-		float RangeCheck = ((abs(LDepth(SampleCoord.z) - LDepth(SampledDepth)) * ProjectionInfo.Far) > uRadius) ? 0.0 : 1.0;
-		Occlusion += RangeCheck * ((SampledDepth <= SampleCoord.z) ? 1.0 : 0.0);
+		ivec2 SampledCoord = clamp(ivec2(SampleCoord.xy * Resolution) / int(uDownsample), ivec2(0), OcclusionLimit);
+		float SampledDepth = texelFetch(SSAODepth, SampledCoord, 0).r;
+		float SampleDepth = -SamplePosition.z;
+
+		float RangeCheck = (abs(SampleDepth - SampledDepth) > uRadius) ? 0.0 : 1.0;
+		Occlusion += RangeCheck * ((SampledDepth <= SampleDepth - DEPTH_BIAS) ? 1.0 : 0.0);
 	}
 
 	Occlusion = 1.0 - Occlusion / uKernalSize;
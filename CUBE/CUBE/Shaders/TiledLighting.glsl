@@ -0,0 +1,45 @@
+// Point lights binned into screen tiles by TiledLightCulling.comp. Each tile's
+// depth range is split into DEPTH_SLICES slices, and every light in a tile keeps
+// a mask of the slices it touches, so pixels skip lights in front of or behind them.
+
+#include "PointLighting.glsl"
+
+const uint TILE_SIZE = 16;
+const uint MAX_LIGHTS_PER_TILE = 128;
+const uint DEPTH_SLICES = 32;
+
+// Linear depth range of the pixels in a tile, and the number of lights touching them
+struct TileInfo_t
+{
+	uint LightCount;
+	float MinDepth;
+	float MaxDepth;
+};
+
+struct TileLight_t
+{
+	uint LightIndex;
+	uint SliceMask;
+};
+
+layout (std430, binding = 3) buffer TileInfos
+{
+	TileInfo_t Tiles[];
+};
+
+// MAX_LIGHTS_PER_TILE entries for each tile
+layout (std430, binding = 4) buffer TileLights
+{
+	TileLight_t TileLightList[];
+};
+
+uint GetTileCountX()
+{
+	return (Resolution.x + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+uint GetDepthSlice(float LinearDepth, float MinDepth, float MaxDepth)
+{
+	float Range = max(MaxDepth - MinDepth, 1e-4);
+	return uint(clamp((LinearDepth - MinDepth) / Range * float(DEPTH_SLICES), 0.0, float(DEPTH_SLICES - 1)));
+}
@@ -18,3 +18,8 @@ layout(std140, binding = 1) uniform ProjectionInfoBlock
 	float Near;
 	float Far;
 } ProjectionInfo;
+
+layout(std140, binding = 3) uniform GBufferLayoutBlock
+{
+	uint IsCompact; // Set for the 8 byte layout of GBufferEncoding.glsl
+} GBufferLayout;
@@ -4,10 +4,8 @@ namespace Atlas
 {
 	FComponentHandle::FComponentHandle(const EComponent::Type Type)
 		: mID(Type)
-		, mBit(NextBit)
+		, mBit(1u << Type)
 	{
-		// Shift to the next bit mask
-		NextBit <<= 1;
 	}
 
 
@@ -20,6 +18,4 @@ namespace Atlas
 	{
 		return mBit;
 	}
-
-	std::bitset<BITSIZE> FComponentHandle::NextBit(1);
 }
\ No newline at end of file
@@ -12,6 +12,7 @@ namespace Atlas
 		, mBehaviors()
 		, mID(0)
 		, mIsActive(true)
+		, mIsInterestQueued(false)
 	{
 		for (uint32_t i = 0; i < EComponent::Count; i++)
 			mComponents[i] = NULL_COMPONENT;
@@ -22,22 +23,6 @@ namespace Atlas
 		WorldTransform.setFromOpenGLMatrix(*Transform.LocalToWorldMatrix().M);
 	}
 
-	void FGameObject::Update()
-	{
-		for (auto& Behavior : mBehaviors)
-		{
-			Behavior.second->Update();
-		}
-	}
-
-	void FGameObject::OnStart()
-	{
-		for (auto& Behavior : mBehaviors)
-		{
-			Behavior.second->OnStart();
-		}
-	}
-
 	FChunkManager& FGameObject::GetChunkManager()
 	{
 		return mChunkManager;
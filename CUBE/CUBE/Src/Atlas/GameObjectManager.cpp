@@ -3,6 +3,13 @@
 #include "Atlas\ComponentTypes.h"
 #include "Atlas\GameObject.h"
 #include "Atlas\SystemManager.h"
+#include "Misc\RadixSort.h"
+#include "Rendering\Camera.h"
+#include "STime.h"
+#include "Memory\FrameAllocator.h"
+#include "Clock.h"
+
+#include <algorithm>
 
 namespace Atlas
 {
@@ -10,31 +17,160 @@ namespace Atlas
 		: mSystemManager(World.GetSystemManager())
 		, mGameObjects()
 		, mSystemComponents()
+		, mBehaviorPools()
+		, mBehaviorPoolOrder()
 		, mDestroyQueue()
+		, mRemovedComponents()
+		, mInterestQueue()
+		, mDeferredChanges()
+		, mQueueMutex()
+		, mTransformOrder()
+		, mTransformScratch()
+		, mLastUpdateTimings()
+		, mTickFrame(0)
+		, mTickTime(0.0)
 	{
 		mGameObjects.Init<FGameObject>(DEFAULT_CONTAINER_SIZE);
 	}
 
 	void FGameObjectManager::Start()
 	{
-		for (auto Itr = mGameObjects.Begin<FGameObject>(); Itr != mGameObjects.End<FGameObject>(); Itr++)
+		CheckQueuedInterest();
+
+		for (uint32_t i = 0; i < mBehaviorPoolOrder.size(); i++)
 		{
-			Itr->OnStart();
+			mBehaviorPoolOrder[i]->OnStart();
 		}
 	}
 
 	void FGameObjectManager::Update()
 	{
+		mTickFrame++;
+		mTickTime += STime::GetDeltaTime();
+
+		// Changes may queue more changes, which wait for the next update
+		std::vector<std::function<void()>> Changes;
+		{
+			std::lock_guard<std::mutex> Lock(mQueueMutex);
+			Changes.swap(mDeferredChanges);
+		}
+
+		for (const auto& Change : Changes)
+			Change();
+
+		// Objects are in their systems before any of them are destroyed
+		const uint64_t InterestBegin = FClock::ReadSystemTimer();
+		CheckQueuedInterest();
+		const uint64_t DestroyBegin = FClock::ReadSystemTimer();
+
 		// remove destroyed GOs
-		while(!mDestroyQueue.empty())
+		std::queue<FGameObject*> DestroyQueue;
+		{
+			std::lock_guard<std::mutex> Lock(mQueueMutex);
+			DestroyQueue.swap(mDestroyQueue);
+		}
+
+		// Systems see every removal before any component is destroyed, so they can finish them together
+		std::vector<FGameObject*, TStackAdapter<FGameObject*>> Destroyed(SFrameAllocator::FrameAdapter<FGameObject*>());
+		Destroyed.reserve(DestroyQueue.size());
+		while(!DestroyQueue.empty())
+		{
+			FGameObject& GameObject = *DestroyQueue.front();
+			DestroyQueue.pop();
+
+			for (uint32_t i = 0; i < EComponent::Count; i++)
+			{
+				if (GameObject.mComponents[i] != FGameObject::NULL_COMPONENT)
+					DetachComponent(GameObject, EComponent::Type(i));
+			}
+			Destroyed.push_back(&GameObject);
+		}
+
+		DestroyRemovedComponents();
+		for (FGameObject* GameObject : Destroyed)
+			DestroyGameObjectHelp(*GameObject);
+
+		// The last step's results are read before the next step is set up
+		const uint64_t BehaviorBegin = FClock::ReadSystemTimer();
+		TickBehaviors(ETickGroup::PostPhysics);
+		TickBehaviors(ETickGroup::PrePhysics);
+
+		// Systems see what behaviors added before they next update
+		const uint64_t LateInterestBegin = FClock::ReadSystemTimer();
+		CheckQueuedInterest();
+		const uint64_t TransformBegin = FClock::ReadSystemTimer();
+		UpdateTransforms();
+		const uint64_t UpdateEnd = FClock::ReadSystemTimer();
+
+		mLastUpdateTimings.InterestCycles = (DestroyBegin - InterestBegin) + (TransformBegin - LateInterestBegin);
+		mLastUpdateTimings.DestroyCycles = BehaviorBegin - DestroyBegin;
+		mLastUpdateTimings.BehaviorCycles = LateInterestBegin - BehaviorBegin;
+		mLastUpdateTimings.TransformCycles = UpdateEnd - TransformBegin;
+	}
+
+	void FGameObjectManager::LateUpdate()
+	{
+		if (!TickBehaviors(ETickGroup::Late))
+			return;
+
+		CheckQueuedInterest();
+		UpdateTransforms();
+	}
+
+	bool FGameObjectManager::TickBehaviors(const ETickGroup::Type Group)
+	{
+		FTickContext Context;
+		Context.CameraPosition = FCamera::Main ? FCamera::Main->Transform.GetWorldPosition() : Vector3f{};
+		Context.Time = mTickTime;
+		Context.DeltaTime = STime::GetDeltaTime();
+		Context.Frame = mTickFrame;
+		Context.Group = Group;
+
+		// Behaviors may add behaviors of new types, which get pools as they are updated
+		uint32_t TickCount = 0;
+		for (uint32_t i = 0; i < mBehaviorPoolOrder.size(); i++)
 		{
-			DestroyGameObjectHelp(*mDestroyQueue.front());
-			mDestroyQueue.pop();
+			if (mBehaviorPoolOrder[i]->Size() > 0)
+				TickCount += mBehaviorPoolOrder[i]->Update(Context);
 		}
 
+		return TickCount > 0;
+	}
+
+	void FGameObjectManager::UpdateTransforms()
+	{
+		mTransformOrder.clear();
+
+		bool HasChildren = false;
 		for (auto Itr = mGameObjects.Begin<FGameObject>(); Itr != mGameObjects.End<FGameObject>(); Itr++)
 		{
-			Itr->Update();
+			uint32_t Depth = 0;
+			for (const FTransform* Parent = Itr->Transform.GetParent(); Parent; Parent = Parent->GetParent())
+				Depth++;
+
+			HasChildren |= Depth > 0;
+			mTransformOrder.push_back(FSort::MakeKeyedItem(Depth, Itr->GetID()));
+		}
+
+		if (HasChildren)
+			FSort::RadixSort(mTransformOrder, mTransformScratch);
+
+		// Transforms at the same depth only read the depth above, which is already built
+		FSystemScheduler& Scheduler = mSystemManager.GetScheduler();
+		for (uint32_t Begin = 0; Begin < mTransformOrder.size();)
+		{
+			const uint32_t Depth = mTransformOrder[Begin] >> 32;
+			uint32_t End = Begin + 1;
+			while (End < mTransformOrder.size() && (mTransformOrder[End] >> 32) == Depth)
+				End++;
+
+			Scheduler.ParallelFor(End - Begin, DEFAULT_TRANSFORM_GRAIN_SIZE, [this, Begin](const uint32_t Index)
+			{
+				const uint32_t ID = FSort::GetItemValue(mTransformOrder[Begin + Index]);
+				GetGameObject(ID).Transform.UpdateMatrices();
+			});
+
+			Begin = End;
 		}
 	}
 
@@ -50,26 +186,53 @@ namespace Atlas
 		FGameObject& NewObject = mGameObjects.At<FGameObject>(Index);
 		NewObject.SetID(Index);
 
-		std::cout << mGameObjects.Size() << std::endl;
-
 		return NewObject;
 	}
 
 	void FGameObjectManager::DestroyGameObject(FGameObject& GameObject)
 	{
+		std::lock_guard<std::mutex> Lock(mQueueMutex);
 		mDestroyQueue.push(&GameObject);
 	}
 
+	void FGameObjectManager::DeferRemoveComponent(FGameObject& GameObject, EComponent::Type Type)
+	{
+		FGameObject* Object = &GameObject;
+		DeferChange([this, Object, Type]()
+		{
+			if (Object->mComponents[Type] != FGameObject::NULL_COMPONENT)
+				RemoveComponent(*Object, Type);
+		});
+	}
+
+	void FGameObjectManager::DeferChange(std::function<void()> Change)
+	{
+		std::lock_guard<std::mutex> Lock(mQueueMutex);
+		mDeferredChanges.push_back(std::move(Change));
+	}
+
 	void FGameObjectManager::DestroyGameObjectHelp(FGameObject& GameObject)
 	{
 		// Deactivate entity and reset properties
 		const uint32_t ID = GameObject.mID;
 		RemoveAllComponentsFor(ID);
 
+		for (auto& Behavior : GameObject.mBehaviors)
+			FreeBehavior(Behavior.first, *Behavior.second);
+		GameObject.mBehaviors.clear();
+
+		if (GameObject.mIsInterestQueued)
+			mInterestQueue.erase(std::find(mInterestQueue.begin(), mInterestQueue.end(), &GameObject));
+
 		mGameObjects.At<FGameObject>(ID).~FGameObject();
 		mGameObjects.Free(ID);
 	}
 
+	void FGameObjectManager::FreeBehavior(const std::type_index& Type, FBehavior& Behavior)
+	{
+		mBehaviorPools.at(Type)->Free(Behavior);
+	}
+
 	FGameObject& FGameObjectManager::GetGameObject(const uint32_t GameObjectID)
 	{
 		ASSERT(GameObjectID < mGameObjects.Capacity());
@@ -83,18 +246,46 @@ namespace Atlas
 
 	void FGameObjectManager::RemoveComponent(FGameObject& GameObject, EComponent::Type Type)
 	{
+		if (GameObject.mComponents[Type] == FGameObject::NULL_COMPONENT)
+			return;
+
+		DetachComponent(GameObject, Type);
+		DestroyRemovedComponents();
+	}
+
+	void FGameObjectManager::DetachComponent(FGameObject& GameObject, const EComponent::Type Type)
+	{
+		// Systems catch up on queued additions first, so they only see the removal. The object stays queued.
+		if (GameObject.mIsInterestQueued)
+			mSystemManager.CheckAddedInterest(GameObject);
+
 		GameObject.RemoveComponentBit(SComponentHandleManager::GetBitMask(Type));
 
 		const uint32_t ComponentIndex = GameObject.mComponents[Type];
-		IComponent& RemovedComponent = mSystemComponents[Type].At<IComponent>(ComponentIndex);
+		IComponent& Component = mSystemComponents[Type].At<IComponent>(ComponentIndex);
 
 		// Notify component systems
-		mSystemManager.CheckInterest(GameObject, RemovedComponent);
-
-		// Free the component
-		mSystemComponents[Type].Free(ComponentIndex);
+		mSystemManager.CheckInterest(GameObject, Component);
 
 		GameObject.mComponents[Type] = FGameObject::NULL_COMPONENT;
+		mRemovedComponents.push_back(RemovedComponent{ Type, ComponentIndex });
+	}
+
+	void FGameObjectManager::DestroyRemovedComponents()
+	{
+		if (mRemovedComponents.empty())
+			return;
+
+		mSystemManager.EndRemoveBatch();
+
+		// Destroy and free the components
+		for (const RemovedComponent& Removed : mRemovedComponents)
+		{
+			mSystemComponents[Removed.Type].At<IComponent>(Removed.Index).~IComponent();
+			mSystemComponents[Removed.Type].Free(Removed.Index);
+		}
+
+		mRemovedComponents.clear();
 	}
 
 	std::vector<IComponent*> FGameObjectManager::GetAllComponentsFor(const uint32_t ID)
@@ -121,9 +312,11 @@ namespace Atlas
 			uint32_t ComponentIndex = Object.mComponents[i];
 			if (ComponentIndex != FGameObject::NULL_COMPONENT)
 			{
-				RemoveComponent(Object, Atlas::EComponent::Type(i));
+				DetachComponent(Object, Atlas::EComponent::Type(i));
 			}
 		}
+
+		DestroyRemovedComponents();
 	}
 
 	void* FGameObjectManager::AllocateComponentForObject(const EComponent::Type Type, FGameObject& GameObject)
@@ -141,8 +334,25 @@ namespace Atlas
 		return Component;
 	}
 
-	void FGameObjectManager::UpdateComponentSystems(FGameObject& GameObject, IComponent& UpdatedComponent)
+	void FGameObjectManager::QueueInterestCheck(FGameObject& GameObject)
 	{
-		mSystemManager.CheckInterest(GameObject, UpdatedComponent);
+		if (GameObject.mIsInterestQueued)
+			return;
+
+		GameObject.mIsInterestQueued = true;
+		mInterestQueue.push_back(&GameObject);
+	}
+
+	void FGameObjectManager::CheckQueuedInterest()
+	{
+		// Systems may add components while taking objects, which queues them again
+		for (uint32_t i = 0; i < mInterestQueue.size(); i++)
+		{
+			FGameObject& GameObject = *mInterestQueue[i];
+			GameObject.mIsInterestQueued = false;
+			mSystemManager.CheckAddedInterest(GameObject);
+		}
+
+		mInterestQueue.clear();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "Atlas\SpatialIndex.h"
+#include "Atlas\GameObject.h"
+#include "Math\Vector4.h"
+#include "Math\Sphere.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Atlas
+{
+	FSpatialIndex::FSpatialIndex(const float CellSize)
+		: mEntries()
+		, mEntryIndices()
+		, mCells()
+		, mCellSize(CellSize)
+		, mMaxRadius(0.0f)
+		, mIsMaxRadiusStale(false)
+	{
+	}
+
+	template <typename FuncType>
+	void FSpatialIndex::ForEachCell(const FBox& Bounds, FuncType Func) const
+	{
+		const Vector3f Reach{ mMaxRadius, mMaxRadius, mMaxRadius };
+		const Vector3i First = GetCell(Bounds.Min - Reach);
+		const Vector3i Last = GetCell(Bounds.Max + Reach);
+
+		const uint64_t RangeCount = (uint64_t)(Last.x - First.x + 1) * (Last.y - First.y + 1) * (Last.z - First.z + 1);
+		if (RangeCount > mCells.size())
+		{
+			for (const auto& Cell : mCells)
+			{
+				const Vector3i& Key = Cell.first;
+				if (Key.x >= First.x && Key.x <= Last.x && Key.y >= First.y && Key.y <= Last.y && Key.z >= First.z && Key.z <= Last.z)
+					Func(Cell.second);
+			}
+			return;
+		}
+
+		for (int32_t x = First.x; x <= Last.x; x++)
+		{
+			for (int32_t y = First.y; y <= Last.y; y++)
+			{
+				for (int32_t z = First.z; z <= Last.z; z++)
+				{
+					auto Found = mCells.find(Vector3i{ x, y, z });
+					if (Found != mCells.end())
+						Func(Found->second);
+				}
+			}
+		}
+	}
+
+	void FSpatialIndex::Add(FGameObject& Object, const float Radius)
+	{
+		ASSERT(mEntryIndices.find(&Object) == mEntryIndices.end() && "Object is already in the index.");
+
+		Entry NewEntry;
+		NewEntry.Object = &Object;
+		NewEntry.Position = Object.Transform.GetWorldPosition();
+		NewEntry.Radius = Radius;
+		NewEntry.Cell = GetCell(NewEntry.Position);
+		NewEntry.CellSlot = 0;
+		NewEntry.Revision = Object.Transform.GetRevision();
+
+		mEntryIndices[&Object] = mEntries.size();
+		mEntries.push_back(NewEntry);
+		InsertIntoCell(mEntries.size() - 1);
+
+		mMaxRadius = std::max(mMaxRadius, Radius);
+	}
+
+	void FSpatialIndex::Remove(FGameObject& Object)
+	{
+		auto Found = mEntryIndices.find(&Object);
+		if (Found == mEntryIndices.end())
+			return;
+
+		const uint32_t Index = Found->second;
+		mEntryIndices.erase(Found);
+		RemoveFromCell(Index);
+
+		if (mEntries[Index].Radius >= mMaxRadius)
+			mIsMaxRadiusStale = true;
+
+		// The last entry takes the removed one's place
+		const uint32_t Last = mEntries.size() - 1;
+		if (Index != Last)
+		{
+			mEntries[Index] = mEntries[Last];
+			mEntryIndices[mEntries[Index].Object] = Index;
+			mCells[mEntries[Index].Cell][mEntries[Index].CellSlot] = Index;
+		}
+		mEntries.pop_back();
+	}
+
+	void FSpatialIndex::SetRadius(FGameObject& Object, const float Radius)
+	{
+		auto Found = mEntryIndices.find(&Object);
+		ASSERT(Found != mEntryIndices.end() && "Object is not in the index.");
+
+		Entry& Target = mEntries[Found->second];
+		if (Target.Radius >= mMaxRadius && Radius < Target.Radius)
+			mIsMaxRadiusStale = true;
+
+		Target.Radius = Radius;
+		mMaxRadius = std::max(mMaxRadius, Radius);
+	}
+
+	void FSpatialIndex::Update(const RadiusFunc& GetRadius)
+	{
+		if (GetRadius)
+			mIsMaxRadiusStale = true;
+
+		for (uint32_t i = 0; i < mEntries.size(); i++)
+		{
+			Entry& Moved = mEntries[i];
+			if (GetRadius)
+				Moved.Radius = GetRadius(*Moved.Object);
+
+			const uint32_t Revision = Moved.Object->Transform.GetRevision();
+			if (Revision == Moved.Revision)
+				continue;
+
+			Moved.Revision = Revision;
+			Moved.Position = Moved.Object->Transform.GetWorldPosition();
+
+			const Vector3i Cell = GetCell(Moved.Position);
+			if (Cell != Moved.Cell)
+			{
+				RemoveFromCell(i);
+				Moved.Cell = Cell;
+				InsertIntoCell(i);
+			}
+		}
+
+		// Shrinking the bound is left to updates, so queries stay cheap to make
+		if (mIsMaxRadiusStale)
+		{
+			mMaxRadius = 0.0f;
+			for (const Entry& Sphere : mEntries)
+				mMaxRadius = std::max(mMaxRadius, Sphere.Radius);
+			mIsMaxRadiusStale = false;
+		}
+	}
+
+	void FSpatialIndex::QueryRadius(const Vector3f& Center, const float Radius, std::vector<FGameObject*>& ObjectsOut) const
+	{
+		FBox Bounds;
+		Bounds.Min = Center - Vector3f{ Radius, Radius, Radius };
+		Bounds.Max = Center + Vector3f{ Radius, Radius, Radius };
+
+		ForEachCell(Bounds, [&](const std::vector<uint32_t>& Cell)
+		{
+			for (const uint32_t Index : Cell)
+			{
+				const Entry& Sphere = mEntries[Index];
+				const Vector3f Offset = Sphere.Position - Center;
+				const float Reach = Sphere.Radius + Radius;
+				if (Vector3f::Dot(Offset, Offset) <= Reach * Reach)
+					ObjectsOut.push_back(Sphere.Object);
+			}
+		});
+	}
+
+	void FSpatialIndex::QueryBox(const FBox& Box, std::vector<FGameObject*>& ObjectsOut) const
+	{
+		ForEachCell(Box, [&](const std::vector<uint32_t>& Cell)
+		{
+			for (const uint32_t Index : Cell)
+			{
+				// Distance from the sphere's center to the closest point of the box
+				const Entry& Sphere = mEntries[Index];
+				const Vector3f Closest{
+					std::min(std::max(Sphere.Position.x, Box.Min.x), Box.Max.x),
+					std::min(std::max(Sphere.Position.y, Box.Min.y), Box.Max.y),
+					std::min(std::max(Sphere.Position.z, Box.Min.z), Box.Max.z) };
+				const Vector3f Offset = Sphere.Position - Closest;
+				if (Vector3f::Dot(Offset, Offset) <= Sphere.Radius * Sphere.Radius)
+					ObjectsOut.push_back(Sphere.Object);
+			}
+		});
+	}
+
+	void FSpatialIndex::QueryFrustum(const FFrustum& Frustum, std::vector<FGameObject*>& ObjectsOut) const
+	{
+		// A frustum has no tight box, so occupied cells are tested against it instead
+		const float CellExtent = mCellSize + 2.0f * mMaxRadius;
+		const Vector3f CellDimensions{ CellExtent, CellExtent, CellExtent };
+
+		for (const auto& Cell : mCells)
+		{
+			const Vector3f CellCenter = (Vector3f{ (float)Cell.first.x, (float)Cell.first.y, (float)Cell.first.z } + Vector3f{ 0.5f, 0.5f, 0.5f }) * mCellSize;
+			const FFrustum::Intersection Result = Frustum.IntersectsAABB(Vector4f{ CellCenter.x, CellCenter.y, CellCenter.z, 1.0f }, CellDimensions);
+			if (Result == FFrustum::Intersection::Outside)
+				continue;
+
+			for (const uint32_t Index : Cell.second)
+			{
+				const Entry& Sphere = mEntries[Index];
+				if (Result == FFrustum::Intersection::Inside || Frustum.IsSphereVisible(FSphere{ Sphere.Position, Sphere.Radius }))
+					ObjectsOut.push_back(Sphere.Object);
+			}
+		}
+	}
+
+	Vector3i FSpatialIndex::GetCell(const Vector3f& Position) const
+	{
+		return Vector3i{ (int32_t)std::floor(Position.x / mCellSize), (int32_t)std::floor(Position.y / mCellSize), (int32_t)std::floor(Position.z / mCellSize) };
+	}
+
+	void FSpatialIndex::InsertIntoCell(const uint32_t EntryIndex)
+	{
+		std::vector<uint32_t>& Cell = mCells[mEntries[EntryIndex].Cell];
+		mEntries[EntryIndex].CellSlot = Cell.size();
+		Cell.push_back(EntryIndex);
+	}
+
+	void FSpatialIndex::RemoveFromCell(const uint32_t EntryIndex)
+	{
+		auto Found = mCells.find(mEntries[EntryIndex].Cell);
+		ASSERT(Found != mCells.end());
+
+		// The cell's last entry takes the removed one's slot, empty cells are dropped
+		std::vector<uint32_t>& Cell = Found->second;
+		const uint32_t Slot = mEntries[EntryIndex].CellSlot;
+		Cell[Slot] = Cell.back();
+		mEntries[Cell[Slot]].CellSlot = Slot;
+		Cell.pop_back();
+
+		if (Cell.empty())
+			mCells.erase(Found);
+	}
+}
@@ -1,4 +1,6 @@
 #include "Atlas/System.h"
+#include "Atlas/GameObjectManager.h"
+#include "Atlas/World.h"
 
 namespace Atlas
 {
@@ -6,7 +8,12 @@ namespace Atlas
 		: mWorld(World)
 		, mTypeBitMask()
 		, mSystemBitMask()
+		, mReadBitMask()
+		, mWriteBitMask()
 		, mGameObjectIDs()
+		, mComponentTypes()
+		, mComponents()
+		, mObjectIndices()
 	{
 		////////////////////////////////////////////////////////////////////////////
 		////// Call addComponentType() in derived classes //////////////////////////
@@ -23,7 +30,7 @@ namespace Atlas
 		// It is not in the system, but we are interested
 		if (!Contains && Interest && mTypeBitMask.any())
 		{
-			mGameObjectIDs.push_back(&GameObject);
+			AddPackedObject(GameObject);
 			GameObject.SetSystemBit(mSystemBitMask);
 			OnGameObjectAdd(GameObject, UpdateComponent);
 		}
@@ -38,10 +45,73 @@ namespace Atlas
 			SubSystem->CheckInterest(GameObject, UpdateComponent);
 	}
 
+	void ISystem::CheckAddedInterest(FGameObject& GameObject)
+	{
+		bool Contains = (GameObject.GetSystemBitMask() & mSystemBitMask) == mSystemBitMask;
+		bool Interest = (GameObject.GetComponentBitMask() & mTypeBitMask) == mTypeBitMask;
+
+		if (!Contains && Interest && mTypeBitMask.any())
+		{
+			const EComponent::Type Type = mComponentTypes.front();
+			IComponent& Component = GameObject.mGOManager.GetComponentsOfType(Type).At<IComponent>(GameObject.mComponents[Type]);
+
+			AddPackedObject(GameObject);
+			GameObject.SetSystemBit(mSystemBitMask);
+			OnGameObjectAdd(GameObject, Component);
+		}
+
+		for (auto& SubSystem : mSubSystems)
+			SubSystem->CheckAddedInterest(GameObject);
+	}
+
 	void ISystem::RemoveObject(FGameObject& GameObject)
 	{
 		GameObject.RemoveSystemBit(mSystemBitMask);
-		mGameObjectIDs.erase(std::find(mGameObjectIDs.begin(), mGameObjectIDs.end(), &GameObject));
+		RemovePackedObject(GameObject);
+	}
+
+	void ISystem::ParallelForEach(const std::function<void(FGameObject& GameObject, const uint32_t Index)>& Func, const uint32_t GrainSize)
+	{
+		mWorld.GetSystemManager().GetScheduler().ParallelFor(mGameObjectIDs.size(), GrainSize, [this, &Func](const uint32_t Index)
+		{
+			Func(*mGameObjectIDs[Index], Index);
+		});
+	}
+
+	void ISystem::AddPackedObject(FGameObject& GameObject)
+	{
+		const uint32_t ID = GameObject.GetID();
+		if (ID >= mObjectIndices.size())
+			mObjectIndices.resize(ID + 1, NULL_INDEX);
+
+		mObjectIndices[ID] = mGameObjectIDs.size();
+		mGameObjectIDs.push_back(&GameObject);
+
+		// Components stay where the gameobject manager allocated them, so their addresses can be kept
+		for (const EComponent::Type Type : mComponentTypes)
+			mComponents[Type].push_back(GameObject.mGOManager.GetComponentsOfType(Type)[GameObject.mComponents[Type]]);
+	}
+
+	void ISystem::RemovePackedObject(FGameObject& GameObject)
+	{
+		const uint32_t ID = GameObject.GetID();
+		ASSERT(ID < mObjectIndices.size() && mObjectIndices[ID] != NULL_INDEX);
+
+		const uint32_t Index = mObjectIndices[ID];
+		const uint32_t LastIndex = mGameObjectIDs.size() - 1;
+
+		FGameObject* LastObject = mGameObjectIDs[LastIndex];
+		mGameObjectIDs[Index] = LastObject;
+		mGameObjectIDs.pop_back();
+
+		for (const EComponent::Type Type : mComponentTypes)
+		{
+			mComponents[Type][Index] = mComponents[Type][LastIndex];
+			mComponents[Type].pop_back();
+		}
+
+		mObjectIndices[LastObject->GetID()] = Index;
+		mObjectIndices[ID] = NULL_INDEX;
 	}
 
 	void ISystem::OnGameObjectAdd(FGameObject& GameObject, IComponent& UpdateComponent)
@@ -53,4 +123,12 @@ namespace Atlas
 	{
 		GameObject; UpdateComponent; // Suppress compiler warning
 	}
+
+	void ISystem::EndRemoveBatch()
+	{
+		OnRemoveBatchEnd();
+
+		for (auto& SubSystem : mSubSystems)
+			SubSystem->EndRemoveBatch();
+	}
 }
\ No newline at end of file
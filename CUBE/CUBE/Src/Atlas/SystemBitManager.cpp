@@ -1,19 +1,13 @@
 #include "Atlas\SystemBitManager.h"
+#include "Misc\Assertions.h"
 
 namespace Atlas
 {
-	std::bitset<BITSIZE> SSystemBitManager::GetBitMaskFor(const std::type_index& type)
+	uint32_t SSystemBitManager::NextTypeID()
 	{
-		// if the System is not in the map, assign a bit to it and add it to the map
-		if (mSystemBitMap.find(type) == mSystemBitMap.end())
-		{
-			mSystemBitMap[type] = mNextBit;
-			mNextBit <<= 1;
-		}
-
-		return mSystemBitMap[type];
+		ASSERT(mNextTypeID < BITSIZE && "Too many System types for the System bit mask.");
+		return mNextTypeID++;
 	}
 
-	std::bitset<BITSIZE> SSystemBitManager::mNextBit(1);
-	std::unordered_map<std::type_index, std::bitset<BITSIZE>> SSystemBitManager::mSystemBitMap;
-}
\ No newline at end of file
+	uint32_t SSystemBitManager::mNextTypeID(0);
+}
@@ -1,17 +1,31 @@
 #include "Atlas\SystemManager.h"
 #include "Atlas\System.h"
 
+#include <algorithm>
+#include <thread>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Systems only run a few tasks at a time, more workers would just wait
+	const uint32_t MAX_SCHEDULER_WORKERS = 3;
+}
+
 namespace Atlas
 {
 	FSystemManager::FSystemManager(FWorld& World)
 		: mWorld(World)
 		, mSystems()
+		, mSystemsByType()
+		, mScheduler()
 	{
 	}
 
 	FSystemManager::~FSystemManager()
 	{
-
+		mScheduler.Stop();
 	}
 
 	void FSystemManager::CheckInterest(FGameObject& GameObject, IComponent& UpdateComponent)
@@ -21,9 +35,24 @@ namespace Atlas
 			System->CheckInterest(GameObject, UpdateComponent);
 	}
 
+	void FSystemManager::CheckAddedInterest(FGameObject& GameObject)
+	{
+		for (auto& System : mSystems)
+			System->CheckAddedInterest(GameObject);
+	}
+
+	void FSystemManager::EndRemoveBatch()
+	{
+		for (auto& System : mSystems)
+			System->EndRemoveBatch();
+	}
+
 	void FSystemManager::Start()
 	{
 		for (auto& System : mSystems)
 			System->Start();
+
+		const uint32_t ThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+		mScheduler.Start(std::min(ThreadCount - 1, MAX_SCHEDULER_WORKERS));
 	}
 }
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "Atlas\SystemScheduler.h"
+#include "Atlas\System.h"
+
+#include <algorithm>
+
+#undef min
+#undef max
+
+namespace Atlas
+{
+	FSystemScheduler::FSystemScheduler()
+		: mWorkers()
+		, mTasks()
+		, mReadyTasks()
+		, mPinnedTasks()
+		, mLoopHelpers()
+		, mTaskMutex()
+		, mTaskAvailable()
+		, mTaskFinished()
+		, mFinishedCount(0)
+		, mMustStop(false)
+	{
+	}
+
+	FSystemScheduler::~FSystemScheduler()
+	{
+		Stop();
+	}
+
+	void FSystemScheduler::Start(const uint32_t WorkerCount)
+	{
+		Stop();
+
+		mMustStop = false;
+		for (uint32_t i = 0; i < WorkerCount; i++)
+		{
+			mWorkers.push_back(std::thread(&FSystemScheduler::WorkerThreadLoop, this));
+		}
+	}
+
+	void FSystemScheduler::Stop()
+	{
+		if (mWorkers.empty())
+			return;
+
+		{
+			std::lock_guard<std::mutex> Lock(mTaskMutex);
+			mMustStop = true;
+		}
+		mTaskAvailable.notify_all();
+
+		for (std::thread& Worker : mWorkers)
+			Worker.join();
+
+		mWorkers.clear();
+	}
+
+	void FSystemScheduler::Add(const ISystem& System, Work Task, const bool IsPinned)
+	{
+		TaskRecord Record;
+		Record.System = &System;
+		Record.Task = std::move(Task);
+		Record.WaitCount = 0;
+		Record.IsPinned = IsPinned;
+		mTasks.push_back(std::move(Record));
+	}
+
+	void FSystemScheduler::Run()
+	{
+		const uint32_t TaskCount = mTasks.size();
+
+		// Edges only go from earlier work to later, so the added order is already a valid one
+		if (mWorkers.empty() || TaskCount < 2)
+		{
+			for (auto& Record : mTasks)
+				Record.Task();
+
+			mTasks.clear();
+			return;
+		}
+
+		for (uint32_t i = 0; i < TaskCount; i++)
+		{
+			for (uint32_t j = i + 1; j < TaskCount; j++)
+			{
+				if (mTasks[i].System->ConflictsWith(*mTasks[j].System))
+				{
+					mTasks[i].Dependents.push_back(j);
+					mTasks[j].WaitCount++;
+				}
+			}
+		}
+
+		std::unique_lock<std::mutex> Lock(mTaskMutex);
+
+		for (uint32_t i = 0; i < TaskCount; i++)
+		{
+			if (mTasks[i].WaitCount == 0)
+				(mTasks[i].IsPinned ? mPinnedTasks : mReadyTasks).push_back(i);
+		}
+		mTaskAvailable.notify_all();
+
+		// The calling thread takes pinned work first, as no other thread can
+		while (mFinishedCount < TaskCount)
+		{
+			std::deque<uint32_t>& Queue = !mPinnedTasks.empty() ? mPinnedTasks : mReadyTasks;
+			if (Queue.empty())
+			{
+				mTaskFinished.wait(Lock);
+				continue;
+			}
+
+			const uint32_t Index = Queue.front();
+			Queue.pop_front();
+
+			Lock.unlock();
+			RunTask(Index);
+			Lock.lock();
+		}
+
+		mFinishedCount = 0;
+		mTasks.clear();
+	}
+
+	void FSystemScheduler::WorkerThreadLoop()
+	{
+		std::unique_lock<std::mutex> Lock(mTaskMutex);
+
+		while (true)
+		{
+			mTaskAvailable.wait(Lock, [this]() { return mMustStop || !mReadyTasks.empty() || !mLoopHelpers.empty(); });
+
+			if (mMustStop)
+				return;
+
+			// Loops hold up the thread that started them, so they go first
+			if (!mLoopHelpers.empty())
+			{
+				LoopRecord& Loop = *mLoopHelpers.front();
+				mLoopHelpers.pop_front();
+				Loop.ActiveHelpers++;
+
+				Lock.unlock();
+				RunLoopRanges(Loop);
+				Lock.lock();
+
+				if (--Loop.ActiveHelpers == 0)
+					mTaskFinished.notify_all();
+
+				continue;
+			}
+
+			const uint32_t Index = mReadyTasks.front();
+			mReadyTasks.pop_front();
+
+			Lock.unlock();
+			RunTask(Index);
+			Lock.lock();
+		}
+	}
+
+	void FSystemScheduler::RunTask(const uint32_t Index)
+	{
+		TaskRecord& Record = mTasks[Index];
+		Record.Task();
+
+		std::lock_guard<std::mutex> Lock(mTaskMutex);
+		for (const uint32_t Dependent : Record.Dependents)
+		{
+			if (--mTasks[Dependent].WaitCount == 0)
+			{
+				(mTasks[Dependent].IsPinned ? mPinnedTasks : mReadyTasks).push_back(Dependent);
+				if (!mTasks[Dependent].IsPinned)
+					mTaskAvailable.notify_one();
+			}
+		}
+
+		// The calling thread waits for pinned work and for the graph to finish
+		mFinishedCount++;
+		mTaskFinished.notify_all();
+	}
+
+	void FSystemScheduler::ParallelFor(const uint32_t Count, const uint32_t GrainSize, const LoopWork& Task)
+	{
+		const uint32_t RangeCount = (Count + GrainSize - 1) / GrainSize;
+
+		// Waking the workers costs more than a single range
+		if (mWorkers.empty() || RangeCount < 2)
+		{
+			for (uint32_t i = 0; i < Count; i++)
+				Task(i);
+
+			return;
+		}
+
+		LoopRecord Loop;
+		Loop.Task = &Task;
+		Loop.Count = Count;
+		Loop.GrainSize = GrainSize;
+		Loop.NextIndex = 0;
+		Loop.ActiveHelpers = 0;
+
+		const uint32_t HelperCount = std::min<uint32_t>(mWorkers.size(), RangeCount - 1);
+		{
+			std::lock_guard<std::mutex> Lock(mTaskMutex);
+			for (uint32_t i = 0; i < HelperCount; i++)
+				mLoopHelpers.push_back(&Loop);
+		}
+		mTaskAvailable.notify_all();
+
+		RunLoopRanges(Loop);
+
+		// Every range is taken, busy workers finish theirs and the rest aren't needed
+		std::unique_lock<std::mutex> Lock(mTaskMutex);
+		mLoopHelpers.erase(std::remove(mLoopHelpers.begin(), mLoopHelpers.end(), &Loop), mLoopHelpers.end());
+		mTaskFinished.wait(Lock, [&Loop]() { return Loop.ActiveHelpers == 0; });
+	}
+
+	void FSystemScheduler::RunLoopRanges(LoopRecord& Loop)
+	{
+		for (uint32_t Begin = Loop.NextIndex.fetch_add(Loop.GrainSize); Begin < Loop.Count; Begin = Loop.NextIndex.fetch_add(Loop.GrainSize))
+		{
+			const uint32_t End = std::min(Begin + Loop.GrainSize, Loop.Count);
+			for (uint32_t i = Begin; i < End; i++)
+				(*Loop.Task)(i);
+		}
+	}
+}
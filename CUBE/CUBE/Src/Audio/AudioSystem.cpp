@@ -2,26 +2,100 @@
 #include "FMOD\fmod_errors.h"
 #include "Components\SoundEmitter.h"
 #include "Components\SoundListener.h"
+#include "ChunkSystems\ChunkManager.h"
+#include "Debugging\CPUProfiler.h"
+#include "Debugging\Log.h"
+#include "Math\Ray.h"
+#include "STime.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
-FAudioSystem::FAudioSystem(Atlas::FWorld& World)
+namespace
+{
+	// Voices that are tracked, and the voices among them that are mixed. The
+	// quietest and lowest priority voices beyond the mixed ones go virtual.
+	const int32_t MAX_VOICES = 512;
+	const int32_t MIXED_VOICES = 64;
+
+	// Voices quieter than this are virtual even with mixed voices to spare
+	const float VIRTUAL_VOLUME = 0.001f;
+
+	// Emitters that moved less than this keep the position of their channel
+	const float MOVE_THRESHOLD = 0.01f;
+
+	// Occlusion of a sound behind a single block, and the blocks crossed before it's fully occluded
+	const float MIN_OCCLUSION = 0.4f;
+	const float FULL_OCCLUSION_BLOCKS = 6.0f;
+
+	// Occlusion an emitter eases by each second, so it fades as it's walked behind terrain
+	const float OCCLUSION_RATE = 2.0f;
+
+	// Share of occlusion applied to the reverb, which still reaches the listener around terrain
+	const float REVERB_OCCLUSION = 0.5f;
+
+	/**
+	* Measures how much of a sound the terrain blocks, from its first block along the
+	* line to the listener to its last. Any thread may measure through its own reader.
+	* @return 0 in the open, rising with the blocks crossed up to 1.
+	*/
+	float MeasureOcclusion(const FChunkManager& ChunkManager, const FChunkManager::BlockReader& Reader, const Vector3f& ListenerPosition, const Vector3f& EmitterPosition)
+	{
+		const Vector3f ToEmitter = EmitterPosition - ListenerPosition;
+		const float Distance = std::sqrt(Vector3f::Dot(ToEmitter, ToEmitter));
+
+		FChunkManager::RaycastHit Hit;
+		if (!ChunkManager.Raycast(Reader, FRay{ ListenerPosition, ToEmitter }, Distance, Hit))
+			return 0.0f;
+
+		// Walked back from the emitter to find where the terrain ends, emitters within blocks are behind all of it
+		const float Entry = Hit.Distance;
+		float Exit = Distance;
+		if (ChunkManager.Raycast(Reader, FRay{ EmitterPosition, -ToEmitter }, Distance - Entry, Hit))
+			Exit = Distance - Hit.Distance;
+
+		const float Blocks = std::max(Exit - Entry, 0.0f);
+		return std::min(MIN_OCCLUSION + (1.0f - MIN_OCCLUSION) * Blocks / FULL_OCCLUSION_BLOCKS, 1.0f);
+	}
+}
+
+FAudioSystem::FAudioSystem(Atlas::FWorld& World, const FChunkManager& ChunkManager)
 	: ISystem(World)
 	, mSystem(nullptr)
+	, mSoundBank()
 	, mListenerSubSystem(nullptr)
+	, mChunkManager(ChunkManager)
+	, mOcclusionQueries()
+	, mOcclusionCounter()
+	, mNextOcclusionEmitter(0)
 {
 	FMOD_RESULT Result = FMOD::System_Create(&mSystem);
 	if (Result != FMOD_OK)
 	{
-		printf("FMOD error! (%d) %s\n", Result, FMOD_ErrorString(Result));
+		LOG(Error, Audio, "FMOD error! (%d) %s", Result, FMOD_ErrorString(Result));
+		FDebug::Log::Flush();
 		exit(-1);
 	}
 
-	Result = mSystem->init(512, FMOD_INIT_NORMAL, 0);
+	mSystem->setSoftwareChannels(MIXED_VOICES);
+
+	FMOD_ADVANCEDSETTINGS Settings;
+	memset(&Settings, 0, sizeof(Settings));
+	Settings.cbSize = sizeof(Settings);
+	Settings.vol0virtualvol = VIRTUAL_VOLUME;
+	mSystem->setAdvancedSettings(&Settings);
+
+	// Occluded channels are low passed as well as quieter
+	Result = mSystem->init(MAX_VOICES, FMOD_INIT_VOL0_BECOMES_VIRTUAL | FMOD_INIT_CHANNEL_LOWPASS, 0);
 	if (Result != FMOD_OK)
 	{
-		printf("FMOD error! (%d) %s\n", Result, FMOD_ErrorString(Result));
+		LOG(Error, Audio, "FMOD error! (%d) %s", Result, FMOD_ErrorString(Result));
+		FDebug::Log::Flush();
 		exit(-1);
 	}
 
+	mSoundBank.reset(new FSoundBank(mSystem));
+
 	AddComponentType<Atlas::EComponent::SoundEmitter>();
 	mListenerSubSystem = &AddSubSystem<FAudioListenerSystem>(mSystem);
 }
@@ -29,11 +103,15 @@ FAudioSystem::FAudioSystem(Atlas::FWorld& World)
 
 FAudioSystem::~FAudioSystem()
 {
+	FJobSystem::GetInstance().Wait(mOcclusionCounter);
+
+	mSoundBank.reset();
 	mSystem->close();
 	FMOD_RESULT Result = mSystem->release();
 	if (Result != FMOD_OK)
 	{
-		printf("FMOD error! (%d) %s\n", Result, FMOD_ErrorString(Result));
+		LOG(Error, Audio, "FMOD error! (%d) %s", Result, FMOD_ErrorString(Result));
+		FDebug::Log::Flush();
 		exit(-1);
 	}
 }
@@ -41,48 +119,135 @@ FAudioSystem::~FAudioSystem()
 
 void FAudioSystem::Update()
 {
+	CPU_PROFILE("AudioSystemUpdate");
+
 	FMOD_VECTOR Velocity = { 0.0f, 0.0f, 0.0f }; // Disregard velocity for now
 
+	// Emitters are culled against the listener of this frame
+	mListenerSubSystem->Update();
+	const Vector3f ListenerPosition = mListenerSubSystem->GetPosition();
+	UpdateOcclusion(ListenerPosition);
+	const float OcclusionStep = OCCLUSION_RATE * STime::GetDeltaTime();
+
 	auto& Objects = GetGameObjects();
-	for (auto& Object : Objects)
+	for (uint32_t i = 0; i < Objects.size(); i++)
 	{
-		const Vector3f Position = Object->Transform.GetWorldPosition();
-		FMOD_VECTOR FMODPosition = { Position.x, Position.y, Position.z };
-
-		FSoundEmitter& Emitter = Object->GetComponent<Atlas::EComponent::SoundEmitter>();
-		Emitter.Channel->set3DAttributes(&FMODPosition, &Velocity);
+		FSoundEmitter& Emitter = GetComponentAt<Atlas::EComponent::SoundEmitter>(i);
 
 		if (Emitter.Filename.size() > 0)
 		{
-			if (Emitter.Sound)
-				Emitter.Sound->release();
+			// Acquire before releasing, so setting the same file again keeps it loaded
+			const FSoundBank::Handle NewSound = mSoundBank->Acquire(Emitter.Filename);
+			mSoundBank->Release(Emitter.Sound);
+			Emitter.Sound = NewSound;
+			Emitter.Filename.resize(0);
+		}
 
-			FMOD_MODE Mode = FMOD_3D;
-			if (Emitter.Looping)
-				Mode |= FMOD_LOOP_NORMAL;
+		// Emitters out of range are left alone. Their channels are quiet enough
+		// to go virtual, so their positions can stay stale until they're back in range.
+		const Vector3f Position = Objects[i]->Transform.GetWorldPosition();
+		const Vector3f ToListener = Position - ListenerPosition;
+		if (Vector3f::Dot(ToListener, ToListener) > Emitter.MaxDistance * Emitter.MaxDistance)
+		{
+			// One shots that can't be heard are dropped, looping sounds start once in range
+			if (!Emitter.Looping)
+				Emitter.ActivateSound = false;
 
-			mSystem->createSound(Emitter.Filename.data(), Mode, nullptr, &Emitter.Sound);
-			Emitter.Filename.resize(0);
+			continue;
 		}
 
+		FMOD_VECTOR FMODPosition = { Position.x, Position.y, Position.z };
+
+		// Sounds that are still loading are played in a later update
 		if (Emitter.ActivateSound)
 		{
-			mSystem->playSound(Emitter.Sound, nullptr, false, &Emitter.Channel);
-			Emitter.ActivateSound = false;
+			FMOD::Channel* Channel = mSoundBank->Play(Emitter.Sound);
+			if (Channel)
+			{
+				// Sounds are shared, so looping and attenuation are set on the emitter's channel
+				Emitter.Channel = Channel;
+				Emitter.Channel->setMode(Emitter.Looping ? FMOD_LOOP_NORMAL : FMOD_LOOP_OFF);
+				Emitter.Channel->setPriority(Emitter.Priority);
+				Emitter.Channel->set3DMinMaxDistance(Emitter.MinDistance, Emitter.MaxDistance);
+				Emitter.Channel->set3DAttributes(&FMODPosition, &Velocity);
+				Emitter.Channel->set3DOcclusion(Emitter.Occlusion, Emitter.Occlusion * REVERB_OCCLUSION);
+				Emitter.Channel->setPaused(false);
+				Emitter.LastPosition = Position;
+				Emitter.ActivateSound = false;
+			}
+			else if (mSoundBank->HasFailed(Emitter.Sound))
+			{
+				Emitter.ActivateSound = false;
+			}
 		}
-	}
+		else if (Emitter.Channel)
+		{
+			const Vector3f Moved = Position - Emitter.LastPosition;
+			if (Vector3f::Dot(Moved, Moved) > MOVE_THRESHOLD * MOVE_THRESHOLD)
+			{
+				Emitter.Channel->set3DAttributes(&FMODPosition, &Velocity);
+				Emitter.LastPosition = Position;
+			}
 
-	// Update audio listener
-	mListenerSubSystem->Update();
+			if (Emitter.Occlusion != Emitter.TargetOcclusion)
+			{
+				const float Change = std::min(std::max(Emitter.TargetOcclusion - Emitter.Occlusion, -OcclusionStep), OcclusionStep);
+				Emitter.Occlusion += Change;
+				Emitter.Channel->set3DOcclusion(Emitter.Occlusion, Emitter.Occlusion * REVERB_OCCLUSION);
+			}
+		}
+	}
 
 	mSystem->update();
 }
 
+void FAudioSystem::UpdateOcclusion(const Vector3f& ListenerPosition)
+{
+	// Measures finish within a frame or two, emitters wait for their turn until they do
+	if (!mOcclusionCounter.IsDone())
+		return;
+
+	auto& Objects = GetGameObjects();
+	for (const OcclusionQuery& Query : mOcclusionQueries)
+	{
+		if (Query.Emitter < Objects.size() && Objects[Query.Emitter] == Query.Object)
+			GetComponentAt<Atlas::EComponent::SoundEmitter>(Query.Emitter).TargetOcclusion = Query.Occlusion;
+	}
+	mOcclusionQueries.clear();
+
+	// Only emitters playing in range are measured, one pass over the emitters at most
+	const uint32_t EmitterCount = Objects.size();
+	for (uint32_t i = 0; i < EmitterCount && mOcclusionQueries.size() < OCCLUSION_QUERIES_PER_FRAME; i++)
+	{
+		const uint32_t Index = (mNextOcclusionEmitter + i) % EmitterCount;
+		const FSoundEmitter& Emitter = GetComponentAt<Atlas::EComponent::SoundEmitter>(Index);
+		const Vector3f Position = Objects[Index]->Transform.GetWorldPosition();
+		const Vector3f ToListener = Position - ListenerPosition;
+		if (Emitter.Channel && Vector3f::Dot(ToListener, ToListener) <= Emitter.MaxDistance * Emitter.MaxDistance)
+			mOcclusionQueries.push_back(OcclusionQuery{ Objects[Index], Index, Position, 0.0f });
+	}
+
+	if (mOcclusionQueries.empty())
+		return;
+	mNextOcclusionEmitter = (mOcclusionQueries.back().Emitter + 1) % EmitterCount;
+
+	FJobSystem::GetInstance().Submit([this, ListenerPosition]()
+	{
+		CPU_PROFILE("AudioOcclusion");
+
+		// Pinned once for every query, chunks stream in and out while the job runs
+		const FChunkManager::BlockReader Reader(mChunkManager);
+		for (OcclusionQuery& Query : mOcclusionQueries)
+			Query.Occlusion = MeasureOcclusion(mChunkManager, Reader, ListenerPosition, Query.Position);
+	}, &mOcclusionCounter);
+}
+
 void FAudioSystem::OnGameObjectRemove(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent)
 {
 	GameObject; // remove compiler warning
 	FSoundEmitter& Emitter = *static_cast<FSoundEmitter*>(&UpdateComponent);
-	Emitter.Sound->release();
+	mSoundBank->Release(Emitter.Sound);
+	Emitter.Sound = FSoundBank::INVALID_HANDLE;
 }
 
 void FAudioSystem::OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent)
@@ -90,7 +255,7 @@ void FAudioSystem::OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::ICompo
 	GameObject; // remove compiler warning
 	FSoundEmitter& Emitter = *static_cast<FSoundEmitter*>(&UpdateComponent);
 	Emitter.Channel = nullptr;
-	Emitter.Sound = nullptr;
+	Emitter.Sound = FSoundBank::INVALID_HANDLE;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -100,12 +265,15 @@ void FAudioSystem::OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::ICompo
 FAudioListenerSystem::FAudioListenerSystem(Atlas::FWorld& World, FMOD::System* System)
 	: ISystem(World)
 	, mSystem(System)
+	, mPosition()
 {
 	AddComponentType<Atlas::EComponent::SoundListener>();
 }
 
 void FAudioListenerSystem::Update()
 {
+	CPU_PROFILE("AudioListenerSystemUpdate");
+
 	// Only supporting one listener for now
 	using namespace Atlas;
 
@@ -116,6 +284,7 @@ void FAudioListenerSystem::Update()
 	{
 		FGameObject& Object = *Objects[0];
 		const Vector3f ListenerPosition = Object.Transform.GetWorldPosition();
+		mPosition = ListenerPosition;
 		FMOD_VECTOR FMODPosition = { ListenerPosition.x, ListenerPosition.y, ListenerPosition.z };
 
 		const FQuaternion Rotation = Object.Transform.GetRotation();
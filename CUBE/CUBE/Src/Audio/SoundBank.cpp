@@ -0,0 +1,119 @@
+#include "Audio\SoundBank.h"
+#include "FMOD\fmod_errors.h"
+#include "FileIO\GenericFile.h"
+#include "Debugging\Log.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+
+FSoundBank::FSoundBank(FMOD::System* System)
+	: mSystem(System)
+	, mSounds()
+{
+}
+
+FSoundBank::~FSoundBank()
+{
+	for (auto& Sound : mSounds)
+		Sound.second.Sound->release();
+}
+
+FSoundBank::Handle FSoundBank::Acquire(const std::string& Filename)
+{
+	const Handle Sound = FStringID{ Filename }.GetID();
+
+	auto Existing = mSounds.find(Sound);
+	if (Existing != mSounds.end())
+	{
+		Existing->second.References++;
+		return Sound;
+	}
+
+	// Missing files fail to open below, so their size doesn't matter
+	const std::wstring WideFilename{ Filename.begin(), Filename.end() };
+	std::unique_ptr<IFileHandle> File = IFileSystem::GetInstance().OpenReadable(WideFilename.c_str());
+	const uint32_t FileSize = File ? File->GetFileSize() : 0;
+	File.reset();
+
+	// Emitters loop their own channels, so the sound is shared by looping and non-looping emitters
+	FMOD_MODE Mode = FMOD_3D | FMOD_LOOP_OFF | FMOD_NONBLOCKING;
+	Mode |= (FileSize >= STREAM_FILE_SIZE) ? FMOD_CREATESTREAM : FMOD_CREATESAMPLE;
+
+	Entry NewEntry;
+	NewEntry.Sound = nullptr;
+	NewEntry.References = 1;
+	const FMOD_RESULT Result = mSystem->createSound(Filename.c_str(), Mode, nullptr, &NewEntry.Sound);
+	if (Result != FMOD_OK)
+	{
+		LOG(Error, Audio, "Failed to load sound %s. FMOD error (%d) %s", Filename.c_str(), Result, FMOD_ErrorString(Result));
+		return INVALID_HANDLE;
+	}
+
+	mSounds.emplace(Sound, std::move(NewEntry));
+	return Sound;
+}
+
+void FSoundBank::Release(const Handle Sound)
+{
+	if (Sound == INVALID_HANDLE)
+		return;
+
+	auto Existing = mSounds.find(Sound);
+	ASSERT(Existing != mSounds.end() && "Releasing a sound that isn't in the bank.");
+
+	if (--Existing->second.References == 0)
+	{
+		// Blocks until the sound has finished opening
+		Existing->second.Sound->release();
+		mSounds.erase(Existing);
+	}
+}
+
+FMOD::Channel* FSoundBank::Play(const Handle Sound)
+{
+	FMOD::Sound* ReadySound = GetSound(Sound);
+	if (!ReadySound)
+		return nullptr;
+
+	// Handles of finished channels are no longer valid
+	std::vector<FMOD::Channel*>& Channels = mSounds.find(Sound)->second.Channels;
+	Channels.erase(std::remove_if(Channels.begin(), Channels.end(), [](FMOD::Channel* Channel)
+	{
+		bool IsPlaying = false;
+		return Channel->isPlaying(&IsPlaying) != FMOD_OK || !IsPlaying;
+	}), Channels.end());
+
+	if (Channels.size() >= MAX_INSTANCES)
+	{
+		Channels.front()->stop();
+		Channels.erase(Channels.begin());
+	}
+
+	FMOD::Channel* Channel = nullptr;
+	if (mSystem->playSound(ReadySound, nullptr, true, &Channel) != FMOD_OK)
+		return nullptr;
+
+	Channels.push_back(Channel);
+	return Channel;
+}
+
+FMOD::Sound* FSoundBank::GetSound(const Handle Sound) const
+{
+	// Other states return FMOD_ERR_NOTREADY from sound commands
+	const FMOD_OPENSTATE State = GetOpenState(Sound);
+	if (State != FMOD_OPENSTATE_READY && State != FMOD_OPENSTATE_PLAYING)
+		return nullptr;
+
+	return mSounds.find(Sound)->second.Sound;
+}
+
+FMOD_OPENSTATE FSoundBank::GetOpenState(const Handle Sound) const
+{
+	auto Existing = mSounds.find(Sound);
+	if (Existing == mSounds.end())
+		return FMOD_OPENSTATE_ERROR;
+
+	FMOD_OPENSTATE State = FMOD_OPENSTATE_ERROR;
+	Existing->second.Sound->getOpenState(&State, nullptr, nullptr, nullptr);
+	return State;
+}
@@ -0,0 +1,190 @@
+#include "ChunkSystems\BlockCursor.h"
+#include "Math\FMath.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+
+#undef min
+#undef max
+
+namespace
+{
+	const int32_t CHUNK_SIZE = FChunk::CHUNK_SIZE;
+
+	// Steps between blocks along each axis in the layout of FChunk::BlockIndex
+	const int32_t AXIS_STRIDES[3] = { CHUNK_SIZE, CHUNK_SIZE * CHUNK_SIZE, 1 };
+}
+
+FBlockCursor::FBlockCursor(const FChunkManager::BlockReader& Reader, const Vector3i& Position)
+	: mReader(Reader)
+	, mBlocks(nullptr)
+	, mPosition(Position)
+	, mChunkPosition(FMath::FloorDivide(Position, CHUNK_SIZE))
+	, mLocalPosition(FMath::FloorModulo(Position, CHUNK_SIZE))
+	, mIndex(FChunk::BlockIndex(mLocalPosition))
+{
+	EnterChunk(mChunkPosition);
+}
+
+void FBlockCursor::MoveTo(const Vector3i& Position)
+{
+	const Vector3i ChunkPosition = FMath::FloorDivide(Position, CHUNK_SIZE);
+	if (ChunkPosition != mChunkPosition)
+		EnterChunk(ChunkPosition);
+
+	mPosition = Position;
+	mLocalPosition = FMath::FloorModulo(Position, CHUNK_SIZE);
+	mIndex = FChunk::BlockIndex(mLocalPosition);
+}
+
+void FBlockCursor::Step(const uint32_t Face)
+{
+	ASSERT(Face < 6);
+
+	// Positive faces have even ids
+	const uint32_t Axis = Face / 2;
+	const int32_t Direction = (Face % 2 == 0) ? 1 : -1;
+	mPosition[Axis] += Direction;
+	mLocalPosition[Axis] += Direction;
+
+	if (mLocalPosition[Axis] >= 0 && mLocalPosition[Axis] < CHUNK_SIZE)
+	{
+		mIndex += Direction * AXIS_STRIDES[Axis];
+		return;
+	}
+
+	// Crossed into the neighbor, whose blocks are found once
+	mLocalPosition[Axis] -= Direction * CHUNK_SIZE;
+	mIndex = FChunk::BlockIndex(mLocalPosition);
+
+	Vector3i ChunkPosition = mChunkPosition;
+	ChunkPosition[Axis] += Direction;
+	EnterChunk(ChunkPosition);
+}
+
+void FBlockCursor::GetNeighborhood(FBlockTypes::BlockID BlocksOut[NEIGHBORHOOD_SIZE]) const
+{
+	const Vector3i& Local = mLocalPosition;
+	const bool IsInside = Local.x > 0 && Local.y > 0 && Local.z > 0 &&
+		Local.x < CHUNK_SIZE - 1 && Local.y < CHUNK_SIZE - 1 && Local.z < CHUNK_SIZE - 1;
+
+	if (IsInside)
+	{
+		if (!mBlocks || mBlocks->IsUniform())
+		{
+			std::fill_n(BlocksOut, NEIGHBORHOOD_SIZE, Get());
+			return;
+		}
+
+		uint32_t i = 0;
+		for (int32_t z = -1; z <= 1; z++)
+		{
+			for (int32_t y = -1; y <= 1; y++)
+			{
+				for (int32_t x = -1; x <= 1; x++)
+					BlocksOut[i++] = mBlocks->Get(mIndex + x * AXIS_STRIDES[0] + y * AXIS_STRIDES[1] + z * AXIS_STRIDES[2]);
+			}
+		}
+		return;
+	}
+
+	// Chunks are indexed by their offset from the cursor's chunk, as blocks are
+	const FBlockStorage* Chunks[NEIGHBORHOOD_SIZE];
+	bool IsFound[NEIGHBORHOOD_SIZE] = {};
+	const uint32_t Center = NeighborhoodIndex(Vector3i{ 0, 0, 0 });
+	Chunks[Center] = mBlocks;
+	IsFound[Center] = true;
+
+	for (int32_t z = -1; z <= 1; z++)
+	{
+		for (int32_t y = -1; y <= 1; y++)
+		{
+			for (int32_t x = -1; x <= 1; x++)
+			{
+				const Vector3i Position = Local + Vector3i{ x, y, z };
+				const Vector3i ChunkOffset{
+					(Position.x < 0) ? -1 : (Position.x >= CHUNK_SIZE ? 1 : 0),
+					(Position.y < 0) ? -1 : (Position.y >= CHUNK_SIZE ? 1 : 0),
+					(Position.z < 0) ? -1 : (Position.z >= CHUNK_SIZE ? 1 : 0) };
+
+				const uint32_t Chunk = NeighborhoodIndex(ChunkOffset);
+				if (!IsFound[Chunk])
+				{
+					Chunks[Chunk] = mReader.FindChunkBlocks(mChunkPosition + ChunkOffset);
+					IsFound[Chunk] = true;
+				}
+
+				BlocksOut[NeighborhoodIndex(Vector3i{ x, y, z })] = Chunks[Chunk] ?
+					Chunks[Chunk]->Get(FChunk::BlockIndex(Position - ChunkOffset * CHUNK_SIZE)) : FBlock::AIR_BLOCK_ID;
+			}
+		}
+	}
+}
+
+void FBlockCursor::EnterChunk(const Vector3i& ChunkPosition)
+{
+	mChunkPosition = ChunkPosition;
+	mBlocks = mReader.FindChunkBlocks(ChunkPosition);
+}
+
+FBlockBox::FBlockBox(const FChunkManager::BlockReader& Reader, const Vector3i& Min, const Vector3i& Max)
+	: mReader(Reader)
+	, mMin(Min)
+	, mMax(Max)
+	, mMinChunk(FMath::FloorDivide(Min, CHUNK_SIZE))
+	, mMaxChunk(FMath::FloorDivide(Max, CHUNK_SIZE))
+{
+}
+
+FBlockBox::Iterator::Iterator(const FBlockBox& Box, const bool IsEnd)
+	: mBox(&Box)
+	, mBlocks(nullptr)
+	, mChunkPosition(Box.mMinChunk)
+	, mLocalMin()
+	, mLocalMax()
+	, mLocalPosition()
+	, mIndex(0)
+	, mIsEnd(IsEnd || Box.mMax.x < Box.mMin.x || Box.mMax.y < Box.mMin.y || Box.mMax.z < Box.mMin.z)
+{
+	if (!mIsEnd)
+		EnterChunk();
+}
+
+void FBlockBox::Iterator::NextChunk()
+{
+	// Chunks are visited in the same order as blocks within them
+	const Vector3i& MinChunk = mBox->mMinChunk;
+	const Vector3i& MaxChunk = mBox->mMaxChunk;
+	if (mChunkPosition.z < MaxChunk.z)
+		mChunkPosition.z++;
+	else if (mChunkPosition.x < MaxChunk.x)
+	{
+		mChunkPosition.z = MinChunk.z;
+		mChunkPosition.x++;
+	}
+	else if (mChunkPosition.y < MaxChunk.y)
+	{
+		mChunkPosition.z = MinChunk.z;
+		mChunkPosition.x = MinChunk.x;
+		mChunkPosition.y++;
+	}
+	else
+	{
+		mIsEnd = true;
+		return;
+	}
+
+	EnterChunk();
+}
+
+void FBlockBox::Iterator::EnterChunk()
+{
+	const Vector3i Origin = mChunkPosition * CHUNK_SIZE;
+	const Vector3i MinOffset = mBox->mMin - Origin;
+	const Vector3i MaxOffset = mBox->mMax - Origin;
+	mLocalMin = Vector3i{ std::max(MinOffset.x, 0), std::max(MinOffset.y, 0), std::max(MinOffset.z, 0) };
+	mLocalMax = Vector3i{ std::min(MaxOffset.x, CHUNK_SIZE - 1), std::min(MaxOffset.y, CHUNK_SIZE - 1), std::min(MaxOffset.z, CHUNK_SIZE - 1) };
+	mLocalPosition = mLocalMin;
+	mIndex = FChunk::BlockIndex(mLocalPosition);
+	mBlocks = mBox->mReader.FindChunkBlocks(mChunkPosition);
+}
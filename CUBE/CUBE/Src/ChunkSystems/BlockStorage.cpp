@@ -0,0 +1,172 @@
+#include "ChunkSystems\BlockStorage.h"
+#include "Memory\MemoryStats.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+
+FBlockStorage::FBlockStorage(const uint32_t BlockCount, const FBlockTypes::BlockID ID)
+	: mPalette()
+	, mIndices()
+	, mBlockCount(BlockCount)
+	, mBitsPerIndex(0)
+	, mIndexShift(0)
+{
+	std::fill_n(mPaletteLookup, 256, (uint8_t)0);
+	Fill(ID);
+}
+
+FBlockStorage::~FBlockStorage()
+{
+	SMemoryStats::Free(EMemoryTag::ChunkBlocks, mIndices.size() * sizeof(uint32_t));
+}
+
+void FBlockStorage::Set(const uint32_t Index, const FBlockTypes::BlockID ID)
+{
+	ASSERT(Index < mBlockCount);
+
+	// Setting a uniform block to its own type changes nothing
+	if (mBitsPerIndex == 0 && mPalette[0] == ID)
+		return;
+
+	uint32_t PaletteIndex = mPaletteLookup[ID];
+	if (PaletteIndex >= mPalette.size() || mPalette[PaletteIndex] != ID)
+	{
+		PaletteIndex = mPalette.size();
+		mPalette.push_back(ID);
+		mPaletteLookup[ID] = (uint8_t)PaletteIndex;
+
+		// Widen indices until the new palette entry fits
+		uint32_t NewBitsPerIndex = (mBitsPerIndex == 0) ? 1 : mBitsPerIndex;
+		while ((1u << NewBitsPerIndex) < mPalette.size())
+			NewBitsPerIndex *= 2;
+
+		if (NewBitsPerIndex != mBitsPerIndex)
+			Repack(NewBitsPerIndex);
+	}
+
+	SetIndex(Index, PaletteIndex);
+}
+
+void FBlockStorage::Fill(const FBlockTypes::BlockID ID)
+{
+	SMemoryStats::Free(EMemoryTag::ChunkBlocks, mIndices.size() * sizeof(uint32_t));
+
+	// Swap to actually release the index memory
+	std::vector<uint32_t>{}.swap(mIndices);
+	mPalette.assign(1, ID);
+	mPaletteLookup[ID] = 0;
+	mBitsPerIndex = 0;
+	mIndexShift = 0;
+}
+
+void FBlockStorage::Swap(FBlockStorage& Other)
+{
+	ASSERT(mBlockCount == Other.mBlockCount);
+
+	mPalette.swap(Other.mPalette);
+	mIndices.swap(Other.mIndices);
+	std::swap_ranges(mPaletteLookup, mPaletteLookup + 256, Other.mPaletteLookup);
+	std::swap(mBitsPerIndex, Other.mBitsPerIndex);
+	std::swap(mIndexShift, Other.mIndexShift);
+}
+
+void FBlockStorage::CopyFrom(const FBlockStorage& Other)
+{
+	ASSERT(mBlockCount == Other.mBlockCount);
+
+	SMemoryStats::Allocate(EMemoryTag::ChunkBlocks, Other.mIndices.size() * sizeof(uint32_t));
+	SMemoryStats::Free(EMemoryTag::ChunkBlocks, mIndices.size() * sizeof(uint32_t));
+
+	mPalette = Other.mPalette;
+	mIndices = Other.mIndices;
+	std::copy_n(Other.mPaletteLookup, 256, mPaletteLookup);
+	mBitsPerIndex = Other.mBitsPerIndex;
+	mIndexShift = Other.mIndexShift;
+}
+
+void FBlockStorage::Pack(const FBlock* Blocks)
+{
+	// Find every type in use first
+	bool IsUsed[256] = { false };
+	uint32_t TypeCount = 0;
+	for (uint32_t i = 0; i < mBlockCount && TypeCount < 256; i++)
+	{
+		if (!IsUsed[Blocks[i].ID])
+		{
+			IsUsed[Blocks[i].ID] = true;
+			TypeCount++;
+		}
+	}
+
+	Fill(Blocks[0].ID);
+	if (TypeCount == 1)
+		return;
+
+	for (uint32_t ID = 0; ID < 256; ID++)
+	{
+		if (IsUsed[ID] && ID != Blocks[0].ID)
+		{
+			mPaletteLookup[ID] = (uint8_t)mPalette.size();
+			mPalette.push_back((FBlockTypes::BlockID)ID);
+		}
+	}
+
+	uint32_t BitsPerIndex = 1;
+	while ((1u << BitsPerIndex) < mPalette.size())
+		BitsPerIndex *= 2;
+
+	Repack(BitsPerIndex);
+
+	for (uint32_t i = 0; i < mBlockCount; i++)
+	{
+		const uint32_t Bit = i << mIndexShift;
+		mIndices[Bit >> 5] |= (uint32_t)mPaletteLookup[Blocks[i].ID] << (Bit & 31);
+	}
+}
+
+void FBlockStorage::Unpack(FBlock* BlocksOut) const
+{
+	if (mBitsPerIndex == 0)
+	{
+		std::fill_n(BlocksOut, mBlockCount, FBlock{ mPalette[0] });
+		return;
+	}
+
+	for (uint32_t i = 0; i < mBlockCount; i++)
+		BlocksOut[i].ID = mPalette[GetIndex(i)];
+}
+
+void FBlockStorage::Repack(const uint32_t NewBitsPerIndex)
+{
+	ASSERT(NewBitsPerIndex <= 8 && 32 % NewBitsPerIndex == 0);
+
+	uint32_t NewIndexShift = 0;
+	while ((1u << NewIndexShift) < NewBitsPerIndex)
+		NewIndexShift++;
+
+	std::vector<uint32_t> NewIndices(((mBlockCount << NewIndexShift) + 31) / 32, 0u);
+
+	// Uniform storage has every block at palette index 0, which needs no writes
+	if (mBitsPerIndex != 0)
+	{
+		for (uint32_t i = 0; i < mBlockCount; i++)
+		{
+			const uint32_t Bit = i << NewIndexShift;
+			NewIndices[Bit >> 5] |= GetIndex(i) << (Bit & 31);
+		}
+	}
+
+	SMemoryStats::Allocate(EMemoryTag::ChunkBlocks, NewIndices.size() * sizeof(uint32_t));
+	SMemoryStats::Free(EMemoryTag::ChunkBlocks, mIndices.size() * sizeof(uint32_t));
+
+	mIndices.swap(NewIndices);
+	mBitsPerIndex = NewBitsPerIndex;
+	mIndexShift = NewIndexShift;
+}
+
+void FBlockStorage::SetIndex(const uint32_t Index, const uint32_t PaletteIndex)
+{
+	const uint32_t Bit = Index << mIndexShift;
+	const uint32_t Mask = ((1u << mBitsPerIndex) - 1) << (Bit & 31);
+	mIndices[Bit >> 5] = (mIndices[Bit >> 5] & ~Mask) | (PaletteIndex << (Bit & 31));
+}
@@ -0,0 +1,175 @@
+#include "ChunkSystems\BlockTickScheduler.h"
+#include "ChunkSystems\Chunk.h"
+#include "FileIO\WorldFileSystem.h"
+#include "SystemResources\SystemFile.h"
+#include "Math\FMath.h"
+
+#include <algorithm>
+
+namespace
+{
+	/**
+	* A tick as stored on file, due Delay ticks after its chunk is loaded.
+	*/
+	struct TickRecord
+	{
+		int32_t X;
+		int32_t Y;
+		int32_t Z;
+		uint32_t Delay;
+	};
+}
+
+FBlockTickScheduler::FBlockTickScheduler()
+	: mWheel()
+	, mScheduled()
+	, mParked()
+	, mFilepath()
+	, mTick(0)
+	, mMutex()
+{
+}
+
+void FBlockTickScheduler::Open(const wchar_t* WorldName)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	for (auto& Slot : mWheel)
+		Slot.clear();
+	mScheduled.clear();
+	mParked.clear();
+	mTick = 0;
+
+	mFilepath = FWorldFileSystem::WORLDS_DIRECTORY_NAME;
+	mFilepath += WorldName;
+	mFilepath += L"/Ticks.vgt";
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	if (!FileSystem.FileExists(mFilepath.c_str()))
+		return;
+
+	auto File = FileSystem.OpenReadable(mFilepath.c_str());
+	if (!File)
+		return;
+
+	// A partly written record at the end is dropped
+	std::vector<TickRecord> Records(File->GetFileSize() / sizeof(TickRecord));
+	if (Records.empty() || !File->Read((uint8_t*)Records.data(), Records.size() * sizeof(TickRecord)))
+		return;
+
+	// Every block waits on its chunk, which has yet to be loaded
+	for (const TickRecord& Record : Records)
+	{
+		const Vector3i Position{ Record.X, Record.Y, Record.Z };
+		const Vector3i ChunkPosition{ FMath::FloorDivide(Position.x, FChunk::CHUNK_SIZE), FMath::FloorDivide(Position.y, FChunk::CHUNK_SIZE), FMath::FloorDivide(Position.z, FChunk::CHUNK_SIZE) };
+		mParked[ChunkPosition].push_back(ParkedTick{ Position, Record.Delay });
+	}
+}
+
+bool FBlockTickScheduler::Save() const
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	std::vector<TickRecord> Records;
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		if (mFilepath.empty())
+			return false;
+
+		Records.reserve(mScheduled.size());
+		for (const auto& Scheduled : mScheduled)
+			Records.push_back(TickRecord{ Scheduled.first.x, Scheduled.first.y, Scheduled.first.z, (uint32_t)(Scheduled.second - mTick) });
+
+		for (const auto& Chunk : mParked)
+		{
+			for (const ParkedTick& Parked : Chunk.second)
+				Records.push_back(TickRecord{ Parked.Position.x, Parked.Position.y, Parked.Position.z, Parked.Delay });
+		}
+	}
+
+	// Written beside the saved ticks, so a failed write keeps them
+	const std::wstring SavePath = mFilepath + L".save";
+	bool IsWritten = false;
+	{
+		auto File = FileSystem.OpenWritable(SavePath.c_str(), false, true);
+		IsWritten = File && (Records.empty() || File->Write((const uint8_t*)Records.data(), Records.size() * sizeof(TickRecord))) && File->Flush();
+	}
+
+	return IsWritten && FileSystem.ReplaceFilename(SavePath.c_str(), mFilepath.c_str());
+}
+
+void FBlockTickScheduler::Schedule(const Vector3i& Position, const uint32_t Delay)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	Insert(Position, Delay);
+}
+
+void FBlockTickScheduler::Advance(std::vector<Vector3i>& PositionsOut)
+{
+	PositionsOut.clear();
+
+	std::lock_guard<std::mutex> Lock(mMutex);
+	mTick++;
+
+	// The slot also holds blocks due on later turns and blocks rescheduled sooner
+	std::vector<ScheduledTick>& Slot = mWheel[mTick % WHEEL_SIZE];
+	for (std::size_t i = 0; i < Slot.size();)
+	{
+		if (Slot[i].Tick > mTick)
+		{
+			i++;
+			continue;
+		}
+
+		auto Scheduled = mScheduled.find(Slot[i].Position);
+		if (Scheduled != mScheduled.end() && Scheduled->second == Slot[i].Tick)
+		{
+			PositionsOut.push_back(Slot[i].Position);
+			mScheduled.erase(Scheduled);
+		}
+
+		Slot[i] = Slot.back();
+		Slot.pop_back();
+	}
+}
+
+void FBlockTickScheduler::Park(const Vector3i& ChunkPosition, const Vector3i& Position, const uint32_t Delay)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	mParked[ChunkPosition].push_back(ParkedTick{ Position, Delay });
+}
+
+void FBlockTickScheduler::Resume(const Vector3i& ChunkPosition)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	auto Chunk = mParked.find(ChunkPosition);
+	if (Chunk == mParked.end())
+		return;
+
+	for (const ParkedTick& Parked : Chunk->second)
+		Insert(Parked.Position, Parked.Delay);
+
+	mParked.erase(Chunk);
+}
+
+uint32_t FBlockTickScheduler::GetScheduledCount() const
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	return (uint32_t)mScheduled.size();
+}
+
+void FBlockTickScheduler::Insert(const Vector3i& Position, const uint32_t Delay)
+{
+	const uint64_t Tick = mTick + std::max(Delay, 1u);
+
+	auto Scheduled = mScheduled.emplace(Position, Tick);
+	if (!Scheduled.second)
+	{
+		if (Scheduled.first->second <= Tick)
+			return;
+
+		// The entry left in the later slot no longer matches and is dropped when reached
+		Scheduled.first->second = Tick;
+	}
+
+	mWheel[Tick % WHEEL_SIZE].push_back(ScheduledTick{ Position, Tick });
+}
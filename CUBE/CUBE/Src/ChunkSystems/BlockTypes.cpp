@@ -1,13 +1,51 @@
 #include "ChunkSystems\BlockTypes.h"
+#include "Misc\Assertions.h"
 
-std::vector<Vector4f> FBlockTypes::mBlockTypes(std::numeric_limits<uint8_t>::max());
+std::vector<Vector4f> FBlockTypes::mBlockTypes(FBlockTypes::MAX_BLOCK_TYPES);
+uint8_t FBlockTypes::mBlockProperties[FBlockTypes::MAX_BLOCK_TYPES] = {};
+uint32_t FBlockTypes::mTransparentCount = 0;
+std::vector<uint32_t> FBlockTypes::mTextureTexels(FBlockTypes::TEXTURE_SIZE * FBlockTypes::TEXTURE_SIZE, ~0u);
+uint32_t FBlockTypes::mFaceTextures[FBlockTypes::MAX_BLOCK_TYPES * FBlockTypes::FACE_COUNT] = {};
 
-void FBlockTypes::AddBlock(const BlockID ID, const Vector4f& Color)
+void FBlockTypes::AddBlock(const BlockID ID, const Vector4f& Color, const uint8_t LightLevel, const uint8_t Properties)
 {
+	ASSERT(LightLevel <= 15);
+	ASSERT((Properties & (Property::Opaque | Property::Transparent)) != (Property::Opaque | Property::Transparent));
+
+	// Replaced types are counted again with their new properties
+	if (IsTransparent(ID))
+		mTransparentCount--;
+
+	const uint8_t Flags = (uint8_t)((Properties & ~Property::Emissive) | (LightLevel != 0 ? Property::Emissive : 0));
 	mBlockTypes[ID] = Color;
+	mBlockProperties[ID] = (uint8_t)(Flags | (LightLevel << LIGHT_SHIFT));
+
+	if (IsTransparent(ID))
+		mTransparentCount++;
 }
 
 const Vector4f& FBlockTypes::GetBlockColor(const BlockID ID)
 {
 	return mBlockTypes[ID];
-}
\ No newline at end of file
+}
+
+uint32_t FBlockTypes::AddTexture(const uint32_t* Texels)
+{
+	const uint32_t Layer = GetTextureCount();
+	ASSERT(Layer < MAX_TEXTURES);
+
+	mTextureTexels.insert(mTextureTexels.end(), Texels, Texels + TEXTURE_SIZE * TEXTURE_SIZE);
+	return Layer;
+}
+
+void FBlockTypes::SetBlockTexture(const BlockID ID, const uint32_t Layer)
+{
+	for (uint32_t Face = 0; Face < FACE_COUNT; Face++)
+		SetBlockTexture(ID, Face, Layer);
+}
+
+void FBlockTypes::SetBlockTexture(const BlockID ID, const uint32_t Face, const uint32_t Layer)
+{
+	ASSERT(Face < FACE_COUNT && Layer < GetTextureCount());
+	mFaceTextures[ID * FACE_COUNT + Face] = Layer;
+}
@@ -0,0 +1,205 @@
+#include "ChunkSystems\BlockVolume.h"
+#include "ChunkSystems\BlockStorage.h"
+#include "ChunkSystems\BlockTypes.h"
+#include "Debugging\CPUProfiler.h"
+#include "Rendering\GLBindings.h"
+#include "Rendering\GLState.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+	// Slot tag storage block of BlockVolume.glsl
+	const GLuint SLOT_BINDING = 7;
+
+	// Laid out as BlockVolumeBlock of BlockVolume.glsl
+	const uint32_t PARAMS_SIZE = sizeof(Vector4i) * 4;
+
+	const int32_t CHUNK_SIZE = FChunk::CHUNK_SIZE;
+
+	int32_t WrapSlot(const int32_t Position, const int32_t Slots)
+	{
+		return ((Position % Slots) + Slots) % Slots;
+	}
+}
+
+FBlockVolume::FBlockVolume()
+	: mSlotChunks()
+	, mRows(CHUNK_SIZE * CHUNK_SIZE, 0)
+	, mParams(GLUniformBindings::BlockVolumeBlock, PARAMS_SIZE)
+	, mCenter()
+	, mRadius()
+	, mSlots()
+	, mIsCentered(false)
+	, mTexture(0)
+	, mSlotBuffer(0)
+	, mBytes(EMemoryTag::Textures)
+{
+	UploadParams();
+}
+
+FBlockVolume::~FBlockVolume()
+{
+	glDeleteTextures(1, &mTexture);
+	glDeleteBuffers(1, &mSlotBuffer);
+}
+
+void FBlockVolume::SetRadius(int32_t Radius, int32_t VerticalRadius)
+{
+	Radius = std::min(std::max(Radius, 0), MAX_RADIUS);
+	VerticalRadius = std::min(std::max(VerticalRadius, 0), MAX_RADIUS);
+
+	glDeleteTextures(1, &mTexture);
+	glDeleteBuffers(1, &mSlotBuffer);
+	mTexture = 0;
+	mSlotBuffer = 0;
+	mIsCentered = false;
+	mSlotChunks.clear();
+	mBytes.Set(0);
+
+	mRadius = Vector3i{ Radius, VerticalRadius, Radius };
+	mSlots = mRadius * 2 + 1;
+	if (Radius == 0)
+	{
+		UploadParams();
+		return;
+	}
+
+	// A texel for each row along x, so slots are a texel wide and a chunk tall and deep
+	const uint32_t SlotCount = mSlots.x * mSlots.y * mSlots.z;
+	glGenTextures(1, &mTexture);
+	SGLState::BindTexture(GLTextureBindings::BlockVolume, GL_TEXTURE_3D, mTexture);
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_R32UI, mSlots.x, mSlots.y * CHUNK_SIZE, mSlots.z * CHUNK_SIZE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// Every slot starts untagged, so nothing is read before it's uploaded
+	mSlotChunks.assign(SlotCount, Vector4i{ 0, 0, 0, 0 });
+	glGenBuffers(1, &mSlotBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSlotBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Vector4i) * SlotCount, mSlotChunks.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	mBytes.Set((uint64_t)SlotCount * (CHUNK_SIZE * CHUNK_SIZE * sizeof(uint32_t) + sizeof(Vector4i)));
+	UploadParams();
+}
+
+void FBlockVolume::SetCenter(const Vector3i& CenterChunk, std::vector<Vector3i>& EnteredOut)
+{
+	if (mTexture == 0 || (mIsCentered && CenterChunk == mCenter))
+		return;
+
+	CPU_PROFILE("BlockVolumeRecenter");
+
+	const bool WasCentered = mIsCentered;
+	const Vector3i OldCenter = mCenter;
+	mCenter = CenterChunk;
+	mIsCentered = true;
+
+	// Slots tagged with a chunk that left are dropped, so they read as air until they're uploaded again
+	bool HasDropped = false;
+	for (Vector4i& Slot : mSlotChunks)
+	{
+		if (Slot.w != 0 && !Contains(Vector3i{ Slot.x, Slot.y, Slot.z }))
+		{
+			Slot = Vector4i{ 0, 0, 0, 0 };
+			HasDropped = true;
+		}
+	}
+
+	if (HasDropped)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSlotBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Vector4i) * mSlotChunks.size(), mSlotChunks.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	for (int32_t z = -mRadius.z; z <= mRadius.z; z++)
+	{
+		for (int32_t y = -mRadius.y; y <= mRadius.y; y++)
+		{
+			for (int32_t x = -mRadius.x; x <= mRadius.x; x++)
+			{
+				const Vector3i ChunkPosition = CenterChunk + Vector3i{ x, y, z };
+				const Vector3i FromOld = ChunkPosition - OldCenter;
+				if (!WasCentered || std::abs(FromOld.x) > mRadius.x || std::abs(FromOld.y) > mRadius.y || std::abs(FromOld.z) > mRadius.z)
+					EnteredOut.push_back(ChunkPosition);
+			}
+		}
+	}
+
+	UploadParams();
+}
+
+bool FBlockVolume::Contains(const Vector3i& ChunkPosition) const
+{
+	const Vector3i Offset = ChunkPosition - mCenter;
+	return mIsCentered && std::abs(Offset.x) <= mRadius.x && std::abs(Offset.y) <= mRadius.y && std::abs(Offset.z) <= mRadius.z;
+}
+
+void FBlockVolume::Upload(const Vector3i& ChunkPosition, const FBlockStorage& Blocks)
+{
+	if (mTexture == 0 || !Contains(ChunkPosition))
+		return;
+
+	// A bit along x for each opaque block, rows ordered y then z as the texture's texels are
+	if (Blocks.IsUniform())
+	{
+		const uint32_t Row = FBlockTypes::IsOpaque(Blocks.Get(0)) ? ~0u : 0u;
+		std::fill(mRows.begin(), mRows.end(), Row);
+	}
+	else
+	{
+		for (int32_t z = 0; z < CHUNK_SIZE; z++)
+		{
+			for (int32_t y = 0; y < CHUNK_SIZE; y++)
+			{
+				uint32_t Row = 0;
+				for (int32_t x = 0; x < CHUNK_SIZE; x++)
+				{
+					Row |= (uint32_t)FBlockTypes::IsOpaque(Blocks.Get(FChunk::BlockIndex(x, y, z))) << x;
+				}
+				mRows[y + z * CHUNK_SIZE] = Row;
+			}
+		}
+	}
+
+	const Vector3i Slot{ WrapSlot(ChunkPosition.x, mSlots.x), WrapSlot(ChunkPosition.y, mSlots.y), WrapSlot(ChunkPosition.z, mSlots.z) };
+	SGLState::BindTexture(GLTextureBindings::BlockVolume, GL_TEXTURE_3D, mTexture);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, Slot.x, Slot.y * CHUNK_SIZE, Slot.z * CHUNK_SIZE, 1, CHUNK_SIZE, CHUNK_SIZE,
+		GL_RED_INTEGER, GL_UNSIGNED_INT, mRows.data());
+
+	// Tagged after the rows, so the slot is never read with another chunk's blocks
+	const int32_t Index = SlotIndex(ChunkPosition);
+	mSlotChunks[Index] = Vector4i{ ChunkPosition, 1 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mSlotBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(Vector4i) * Index, sizeof(Vector4i), &mSlotChunks[Index]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void FBlockVolume::Bind() const
+{
+	if (mTexture == 0)
+		return;
+
+	SGLState::BindTexture(GLTextureBindings::BlockVolume, GL_TEXTURE_3D, mTexture);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SLOT_BINDING, mSlotBuffer);
+}
+
+int32_t FBlockVolume::SlotIndex(const Vector3i& ChunkPosition) const
+{
+	return WrapSlot(ChunkPosition.x, mSlots.x) + (WrapSlot(ChunkPosition.y, mSlots.y) + WrapSlot(ChunkPosition.z, mSlots.z) * mSlots.y) * mSlots.x;
+}
+
+void FBlockVolume::UploadParams()
+{
+	// Shaders find slots from the first one, so they never wrap negative coordinates
+	const Vector3i First = mCenter - mRadius;
+	const Vector4i Params[4] = {
+		Vector4i{ mCenter, IsEnabled() ? 1 : 0 },
+		Vector4i{ mRadius, 0 },
+		Vector4i{ mSlots, 0 },
+		Vector4i{ WrapSlot(First.x, mSlots.x), WrapSlot(First.y, mSlots.y), WrapSlot(First.z, mSlots.z), 0 } };
+	mParams.SetData(0, (const uint8_t*)Params, PARAMS_SIZE);
+}
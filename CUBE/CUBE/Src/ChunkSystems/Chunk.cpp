@@ -4,11 +4,176 @@
 #include "Debugging\DebugText.h"
 #include "Rendering\Screen.h"
 #include "ChunkSystems\ChunkManager.h"
-#include "Physics\PhysicsSystem.h"
+#include "ChunkSystems\ChunkMeshCache.h"
+#include "ChunkSystems\ChunkRLE.h"
+#include "Debugging\CPUProfiler.h"
+#include "Math\FMath.h"
+#include <emmintrin.h>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+	// Per thread unpacked blocks used when loading, unloading and meshing. Padded
+	// so row compares may read past the last block.
+	static_assert(sizeof(FBlock) == 1, "Unpacked blocks must be single bytes.");
+	THREAD_LOCAL uint8_t BlockScratch[FChunk::BLOCKS_PER_CHUNK + 16];
+
+	// Per thread flood fill state of FindFaceConnections
+	THREAD_LOCAL uint8_t FloodVisited[FChunk::BLOCKS_PER_CHUNK];
+	THREAD_LOCAL FChunk::PackedIndex FloodQueue[FChunk::BLOCKS_PER_CHUNK];
+
+	using RowMask = FChunk::RowMask;
+
+	// Bits of every block of a row, chunks narrower than their row masks leave the high bits clear
+	const RowMask FULL_ROW = (RowMask)(~0ull >> (64 - FChunk::CHUNK_SIZE));
+
+	/**
+	* Exchanges the values of two atomics. Only used where neither is shared.
+	*/
+	template <typename AtomicType>
+	void SwapAtomic(AtomicType& A, AtomicType& B)
+	{
+		B = A.exchange(B.load());
+	}
+
+	/**
+	* Converts packed block light to a vertex light level. Faces take the
+	* brighter of sky and block light.
+	*/
+	uint8_t VertexLightLevel(const uint8_t Levels)
+	{
+		static_assert(FChunkMesh::Quad::LIGHT_LEVELS == (FChunkLight::MAX_LEVEL >> 1) + 1, "Quad light levels must halve FChunkLight levels.");
+
+		const uint8_t Sky = FChunkLight::GetSky(Levels);
+		const uint8_t Block = FChunkLight::GetBlock(Levels);
+		return ((Sky > Block) ? Sky : Block) >> 1;
+	}
+
+	/**
+	* Finds the ambient occlusion level of a face corner from the blocks beside it and
+	* diagonal to it. A corner between two solid blocks is fully occluded whatever the
+	* diagonal block is.
+	*/
+	uint8_t CornerOcclusion(const bool SideU, const bool SideV, const bool Diagonal)
+	{
+		if (SideU && SideV)
+			return 0;
+
+		return (uint8_t)(FChunkMesh::Quad::OCCLUSION_LEVELS - 1 - SideU - SideV - Diagonal);
+	}
+
+	/**
+	* Checks if every corner of packed face occlusion has the same level.
+	*/
+	bool IsUniformOcclusion(const uint8_t Occlusion)
+	{
+		return Occlusion == (Occlusion & 0x3) * 0x55;
+	}
+
+	/**
+	* Transposes a CHUNK_SIZE square bit matrix in place. Bit i of row j becomes
+	* bit j of row i.
+	*/
+	void TransposeBits(RowMask Rows[FChunk::CHUNK_SIZE])
+	{
+		const uint32_t Size = FChunk::CHUNK_SIZE;
+
+		// Swaps blocks of half the size each pass, starting with the quadrants
+		RowMask Mask = FULL_ROW >> (Size / 2);
+		for (uint32_t j = Size / 2; j != 0; j >>= 1, Mask ^= (Mask << j))
+		{
+			for (uint32_t k = 0; k < Size; k = ((k | j) + 1) & ~j)
+			{
+				const RowMask Swap = ((Rows[k] >> j) ^ Rows[k | j]) & Mask;
+				Rows[k | j] ^= Swap;
+				Rows[k] ^= Swap << j;
+			}
+		}
+	}
+
+	/**
+	* Finds the solid blocks of each column along the z axis, 16 blocks at a time.
+	* @param Blocks - BLOCKS_PER_CHUNK blocks in the layout of FChunk::mBlocks.
+	* @param ColumnsOut - Bit z of ColumnsOut[y][x] is set if that block is not air.
+	*/
+	void BuildSolidColumns(const FBlock* Blocks, RowMask ColumnsOut[FChunk::CHUNK_SIZE][FChunk::CHUNK_SIZE])
+	{
+		static_assert(FChunk::CHUNK_SIZE % 16 == 0, "Rows are compared 16 blocks at a time.");
+
+		const __m128i AirBlocks = _mm_set1_epi8((char)FBlock::AIR_BLOCK_ID);
+		for (int32_t y = 0; y < FChunk::CHUNK_SIZE; y++)
+		{
+			for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+			{
+				const __m128i* Row = reinterpret_cast<const __m128i*>(Blocks + x * FChunk::CHUNK_SIZE + y * FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE);
+
+				RowMask Air = 0;
+				for (int32_t Part = 0; Part < FChunk::CHUNK_SIZE / 16; Part++)
+					Air |= (RowMask)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(Row + Part), AirBlocks)) << (Part * 16);
+
+				ColumnsOut[y][x] = ~Air & FULL_ROW;
+			}
+		}
+	}
+
+	/**
+	* Finds the transparent blocks of each column along the z axis from their types' properties.
+	* @param Blocks - BLOCKS_PER_CHUNK blocks in the layout of FChunk::mBlocks.
+	* @param ColumnsOut - Bit z of ColumnsOut[y][x] is set if that block is transparent.
+	*/
+	void BuildTransparentColumns(const FBlock* Blocks, RowMask ColumnsOut[FChunk::CHUNK_SIZE][FChunk::CHUNK_SIZE])
+	{
+		for (int32_t y = 0; y < FChunk::CHUNK_SIZE; y++)
+		{
+			for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+			{
+				const FBlock* Row = Blocks + x * FChunk::CHUNK_SIZE + y * FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE;
+
+				RowMask Column = 0;
+				for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z++)
+					Column |= (RowMask)((FBlockTypes::GetProperties(Row[z].ID) & FBlockTypes::Property::Transparent) != 0) << z;
+
+				ColumnsOut[y][x] = Column;
+			}
+		}
+	}
 
-FPoolAllocator<sizeof(FBlock) * FChunk::BLOCKS_PER_CHUNK, FChunk::POOL_SIZE> FChunk::ChunkAllocator(__alignof(FChunk));
-FPoolAllocatorType<FChunkMesh, FChunk::POOL_SIZE> FChunk::MeshAllocator(__alignof(FChunkMesh));
-FPoolAllocatorType<FChunk::CollisionData, FChunk::POOL_SIZE> FChunk::CollisionAllocator(__alignof(FChunk::CollisionData));
+	/**
+	* Fills the x and y axis columns as bit transposes of the z axis columns.
+	* @param Columns - Columns along each axis in the layout of FChunk::GreedyMesh, with the z columns set.
+	*/
+	void TransposeColumns(RowMask Columns[3][FChunk::CHUNK_SIZE][FChunk::CHUNK_SIZE])
+	{
+		// x columns are indexed [z][y], y columns are indexed [x][z]
+		RowMask Transpose[FChunk::CHUNK_SIZE];
+		for (int32_t y = 0; y < FChunk::CHUNK_SIZE; y++)
+		{
+			for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+				Transpose[x] = Columns[2][y][x];
+
+			TransposeBits(Transpose);
+
+			for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z++)
+				Columns[0][z][y] = Transpose[z];
+		}
+
+		for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+		{
+			for (int32_t y = 0; y < FChunk::CHUNK_SIZE; y++)
+				Transpose[y] = Columns[2][y][x];
+
+			TransposeBits(Transpose);
+
+			for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z++)
+				Columns[1][x][z] = Transpose[z];
+		}
+	}
+}
+
+FChunk::MeshPool FChunk::SharedMeshPool(__alignof(FChunkMesh));
+FEpochReclaimer FChunk::BlockEpochs;
+const FBlockStorage FChunk::AirBlocks(FChunk::BLOCKS_PER_CHUNK);
 
 int32_t FChunk::BlockIndex(Vector3i Position)
 {
@@ -25,117 +190,214 @@ int32_t FChunk::BlockIndex(int32_t X, int32_t Y, int32_t Z)
 	return FChunk::BlockIndex(Vector3i{ X, Y, Z });
 }
 
+uint32_t FChunk::SectionIndex(const Vector3i& Position)
+{
+	static_assert((CHUNK_SIZE / SECTION_SIZE) == 2 && SECTION_COUNT == 8, "Sections are indexed with one bit per axis.");
+
+	return (Position.x / SECTION_SIZE) | ((Position.y / SECTION_SIZE) << 1) | ((Position.z / SECTION_SIZE) << 2);
+}
+
+uint32_t FChunk::EditSections(const Vector3i& Position)
+{
+	uint32_t SectionMask = 0;
+
+	// Blocks on a section border also change faces of the next sections. Occlusion
+	// reaches diagonal blocks, so diagonal sections change too.
+	for (int32_t z = -1; z <= 1; z++)
+	{
+		for (int32_t y = -1; y <= 1; y++)
+		{
+			for (int32_t x = -1; x <= 1; x++)
+			{
+				const Vector3i Neighbor = Position + Vector3i{ x, y, z };
+
+				if (Neighbor.x >= 0 && Neighbor.x < CHUNK_SIZE && Neighbor.y >= 0 && Neighbor.y < CHUNK_SIZE && Neighbor.z >= 0 && Neighbor.z < CHUNK_SIZE)
+					SectionMask |= 1 << SectionIndex(Neighbor);
+			}
+		}
+	}
+
+	return SectionMask;
+}
+
+uint32_t FChunk::FaceSections(const uint32_t Face)
+{
+	// Positive faces have even ids
+	const uint32_t Axis = Face / 2;
+	const bool IsPositive = (Face % 2 == 0);
+
+	uint32_t SectionMask = 0;
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+	{
+		if ((((i >> Axis) & 1) == 1) == IsPositive)
+			SectionMask |= 1 << i;
+	}
+
+	return SectionMask;
+}
+
+uint32_t FChunk::FaceConnection(const uint32_t FaceA, const uint32_t FaceB)
+{
+	ASSERT(FaceA != FaceB && FaceA < 6 && FaceB < 6);
+
+	// Pairs are numbered in order of the lower face, 5 pairs for face 0, 4 for face 1 and so on
+	const uint32_t Low = std::min(FaceA, FaceB);
+	const uint32_t High = std::max(FaceA, FaceB);
+	return 1 << (Low * (11 - Low) / 2 + High - Low - 1);
+}
+
 FChunk::FChunk()
-	: mBlocks(nullptr)
-	, mCollisionData(nullptr)
+	: mBlocks(&AirBlocks)
+	, mBlockGeneration()
+	, mBlockMutex()
+	, mLight(BLOCKS_PER_CHUNK)
+	, mMesh(nullptr)
+	, mMeshPool(&SharedMeshPool)
 	, mIsLoaded()
 	, mIsEmpty()
+	, mMeshLOD()
+	, mDirtySections()
+	, mFaceConnections()
+	, mLoadCount()
+	, mModifyCount()
+	, mSavedModifyCount()
+	, mMeshRevision(0)
 {
+	mBlockGeneration = 0;
 	mIsLoaded = false;
 	mIsEmpty = true;
+	mMeshLOD = 0;
+	mDirtySections = ALL_SECTIONS;
+	mFaceConnections = ALL_FACE_CONNECTIONS;
+	mLoadCount = 0;
+	mModifyCount = 0;
+	mSavedModifyCount = 0;
+}
 
-	// Allocate mesh, block, and collision data
-	mMesh = new (MeshAllocator.Allocate()) FChunkMesh{};
-	mBlocks = static_cast<FBlock*>(ChunkAllocator.Allocate());
-
-	// Construct Collision fields with new memory
-	mCollisionData = new (CollisionAllocator.Allocate()) CollisionData{};
-
-	// Set collision data
-	CollisionData& CollisionInfo = *mCollisionData;
+FChunk::~FChunk()
+{
+	if (mMesh)
+		mMeshPool->Free(mMesh);
 
-	// Set collision shape and transform
-	auto& CollisionMesh = CollisionInfo.Mesh[CollisionInfo.ActiveMesh];
-	CollisionInfo.Object.setCollisionShape(&CollisionMesh.Shape);
+	// Chunks are only destroyed once no reader can hold them
+	const FBlockStorage* Blocks = mBlocks;
+	if (Blocks != &AirBlocks)
+		delete Blocks;
 }
 
-FChunk::~FChunk()
+void FChunk::SetMeshPool(MeshPool& Pool)
 {
-	ChunkAllocator.Free(mBlocks);
-	MeshAllocator.Free(mMesh);
-	CollisionAllocator.Free(mCollisionData);
+	ASSERT(!mMesh && "Meshes are freed to the pool they came from.");
+	mMeshPool = &Pool;
 }
 
 
-bool FChunk::Load(const std::vector<uint8_t>& BlockData)
+bool FChunk::Load(const uint8_t* BlockData, const uint32_t DataSize)
 {
 	ASSERT(!mIsLoaded);
 
-	// Current index to access block type
-	int32_t TypeIndex = 0;
-	int32_t DataSize = BlockData.size();
-	int32_t IsEmpty = 0;
+	std::lock_guard<std::mutex> Lock(mBlockMutex);
+	mSavedModifyCount = mModifyCount.load();
+	mLoadCount++;
 
-	// Write RLE data for chunk
-	for (int32_t y = 0; y < CHUNK_SIZE && TypeIndex < DataSize; y++)
-	{
-		for (int32_t x = 0; x < CHUNK_SIZE; x++)
-		{
-			int32_t BaseIndex = BlockIndex(x, y, 0);
-			for (int32_t z = 0; z < CHUNK_SIZE;)
-			{
-				uint8_t Count = 0;
-				FBlockTypes::BlockID BlockType = (FBlockTypes::BlockID)BlockData[TypeIndex];
-				uint8_t RunLength = BlockData[TypeIndex + 1];
+	// The mesh still holds the sections of the chunk last loaded in this slot
+	mDirtySections = ALL_SECTIONS;
+	mFaceConnections = ALL_FACE_CONNECTIONS;
 
-				// If a single block is not None, this number can never be 0 again
-				IsEmpty += (int32_t)BlockType - (int32_t)FBlock::AIR_BLOCK_ID;
+	// Chunks of a single block type are filled without decoding each run.
+	// New chunks have no data and are all air.
+	uint8_t UniformType;
+	if (FChunkRLE::IsUniform(BlockData, DataSize, UniformType))
+	{
+		const FBlockTypes::BlockID BlockType = (FBlockTypes::BlockID)UniformType;
+		PublishBlocks((BlockType == FBlock::AIR_BLOCK_ID) ? &AirBlocks : new FBlockStorage(BLOCKS_PER_CHUNK, BlockType));
 
-				for (Count = 0; Count < RunLength; Count++)
-				{
-					mBlocks[BaseIndex + z + Count].ID = BlockType;
-				}
+		// Solid chunks can't be seen through, and won't be flood filled since they have no mesh
+		if (BlockType != FBlock::AIR_BLOCK_ID)
+			mFaceConnections = 0;
 
-				z += RunLength;
-				TypeIndex += 2;
-			}
-		}
+		mIsLoaded = true;
+		return (BlockType == FBlock::AIR_BLOCK_ID);
 	}
 
+	// Runs are stored in block index order, so they decode straight into the scratch blocks
+	FChunkRLE::Decode(BlockData, DataSize, BlockScratch);
+	FBlockStorage* Blocks = new FBlockStorage(BLOCKS_PER_CHUNK);
+	Blocks->Pack(reinterpret_cast<const FBlock*>(BlockScratch));
+	PublishBlocks(Blocks);
 
+	// Runs of more than one type hold a block that isn't air
 	mIsLoaded = true;
-	return (IsEmpty == 0);
+	return false;
 }
 
-void FChunk::Unload(std::vector<uint8_t>& BlockDataOut)
+uint32_t FChunk::Unload(uint8_t* BlockDataOut)
 {
 	ASSERT(mIsLoaded);
 
 	mIsLoaded = false;
 
-	// Extract RLE data for chunk
-	for (int32_t y = 0; y < CHUNK_SIZE; y++)
+	std::lock_guard<std::mutex> Lock(mBlockMutex);
+
+	// Blocks on file are already up to date
+	if (!IsModified())
 	{
-		for (int32_t x = 0; x < CHUNK_SIZE; x++)
-		{
-			for (int32_t z = 0; z < CHUNK_SIZE;)
-			{
-				const uint32_t CurrentBlockIndex = BlockIndex(x, y, z);
-				const FBlockTypes::BlockID CurrentBlock = mBlocks[CurrentBlockIndex].ID;
-				uint8_t Length = 1;
+		PublishBlocks(&AirBlocks);
+		return 0;
+	}
 
-				FBlockTypes::BlockID NextBlock = mBlocks[CurrentBlockIndex + (int32_t)Length].ID;
-				while (CurrentBlock == NextBlock && Length + z < CHUNK_SIZE)
-				{
-					Length++;
-					NextBlock = mBlocks[CurrentBlockIndex + (int32_t)Length].ID;
-				}
+	mBlocks.load()->Unpack(reinterpret_cast<FBlock*>(BlockScratch));
 
-				// Append RLE data
-				BlockDataOut.insert(BlockDataOut.end(), { CurrentBlock, Length });
-				z += (int32_t)Length;
-			}
-		}
-	}
+	// Unloaded chunks hold no block data
+	PublishBlocks(&AirBlocks);
+
+	return FChunkRLE::Encode(BlockScratch, BlockDataOut);
 }
 
-void FChunk::ShutDown(FPhysicsSystem& PhysicsSystem)
+uint32_t FChunk::Serialize(uint8_t* BlockDataOut, Version& VersionOut)
 {
-	// Remove collision data from physics system
-	if (!mIsEmpty)
-		PhysicsSystem.RemoveCollider(mCollisionData->Object);
+	ASSERT(mIsLoaded);
+
+	std::lock_guard<std::mutex> Lock(mBlockMutex);
+	mBlocks.load()->Unpack(reinterpret_cast<FBlock*>(BlockScratch));
 
-	mMesh->ClearBackBuffer();
+	VersionOut.LoadCount = mLoadCount;
+	VersionOut.ModifyCount = mModifyCount;
+
+	return FChunkRLE::Encode(BlockScratch, BlockDataOut);
+}
+
+void FChunk::Swap(FChunk& Other)
+{
+	ASSERT(mMeshPool == Other.mMeshPool);
+	Other.mBlocks = mBlocks.exchange(Other.mBlocks);
+	SwapAtomic(mBlockGeneration, Other.mBlockGeneration);
+	mLight.Swap(Other.mLight);
+	Other.mMesh = mMesh.exchange(Other.mMesh);
+
+	SwapAtomic(mIsLoaded, Other.mIsLoaded);
+	SwapAtomic(mIsEmpty, Other.mIsEmpty);
+	SwapAtomic(mMeshLOD, Other.mMeshLOD);
+	SwapAtomic(mDirtySections, Other.mDirtySections);
+	SwapAtomic(mFaceConnections, Other.mFaceConnections);
+	SwapAtomic(mLoadCount, Other.mLoadCount);
+	SwapAtomic(mModifyCount, Other.mModifyCount);
+	SwapAtomic(mSavedModifyCount, Other.mSavedModifyCount);
+	std::swap(mMeshRevision, Other.mMeshRevision);
+}
+
+void FChunk::MarkSaved(const Version& SavedVersion)
+{
+	std::lock_guard<std::mutex> Lock(mBlockMutex);
+
+	if (SavedVersion.LoadCount == mLoadCount)
+		mSavedModifyCount = SavedVersion.ModifyCount;
+}
+
+void FChunk::ShutDown()
+{
+	if (FChunkMesh* Mesh = mMesh)
+		Mesh->ClearBackBuffer();
 }
 
 bool FChunk::IsLoaded() const
@@ -143,125 +405,554 @@ bool FChunk::IsLoaded() const
 	return mIsLoaded;
 }
 
-void FChunk::Render(const GLenum RenderMode)
+void FChunk::AddDraw(FChunkDrawList& DrawList, const Vector3i& Origin, const Vector3f& ViewPosition) const
 {
 	ASSERT(mIsLoaded);
 
-	mMesh->Render(RenderMode);
+	if (const FChunkMesh* Mesh = mMesh)
+		Mesh->AddDraw(DrawList, Origin, ViewPosition);
 }
 
-void FChunk::SwapMeshBuffer(FPhysicsSystem& PhysicsSystem)
+void FChunk::SwapMeshBuffer(FChunkGeometryArena& GeometryArena, FUploadRing& UploadRing)
 {
-	bool WasEmpty = (mMesh->GetIndexCount(FChunkMesh::FrontBuffer{}) == 0);
-	mMesh->SwapBuffer();
-	mMesh->ClearBackBuffer();
-	mIsEmpty = (mMesh->GetIndexCount(FChunkMesh::FrontBuffer{}) == 0);
+	// Slots without a mesh have never been built with geometry
+	FChunkMesh* Mesh = mMesh;
+	if (!Mesh)
+		return;
 
-	// Set to new collision shape
-	mCollisionData->ActiveMesh = !mCollisionData->ActiveMesh;
-	auto& CollisionMesh = mCollisionData->Mesh[mCollisionData->ActiveMesh];
-	mCollisionData->Object.setCollisionShape(&CollisionMesh.Shape);
+	bool WasEmpty = (Mesh->GetQuadCount(FChunkMesh::FrontBuffer{}) == 0);
 
-	// Update collision info
-	if (!mIsEmpty && WasEmpty)
+	// Rebuilds with no dirty sections leave nothing to swap
+	if (Mesh->GetBackSections() == 0)
+		return;
+
+	// Swapping one empty mesh for another changes nothing
+	if (WasEmpty && Mesh->GetQuadCount(FChunkMesh::BackBuffer{}) == 0)
 	{
-		// Previous mesh was empty
-		PhysicsSystem.AddCollider(mCollisionData->Object);
+		Mesh->ClearBackBuffer();
+		mIsEmpty = true;
+		ReleaseEmptyMesh();
+		return;
 	}
-	else if (!WasEmpty && mIsEmpty)
+
+	Mesh->SwapBuffer(GeometryArena, UploadRing);
+	Mesh->ClearBackBuffer();
+	mMeshRevision++;
+	mIsEmpty = (Mesh->GetQuadCount(FChunkMesh::FrontBuffer{}) == 0);
+	ReleaseEmptyMesh();
+}
+
+uint32_t FChunk::TakeMeshSections(FChunkMesh::QuadData QuadsOut[FChunkMesh::SECTION_COUNT], FChunkMesh::FaceRanges RangesOut[FChunkMesh::SECTION_COUNT])
+{
+	FChunkMesh* Mesh = mMesh;
+	return Mesh ? Mesh->TakeBackSections(QuadsOut, RangesOut) : 0;
+}
+
+uint32_t FChunk::GetPendingMeshSize() const
+{
+	const FChunkMesh* Mesh = mMesh;
+	return Mesh ? Mesh->GetQuadCount(FChunkMesh::BackBuffer{}) * sizeof(FChunkMesh::Quad) : 0;
+}
+
+FChunkMesh& FChunk::AcquireMesh()
+{
+	if (!mMesh)
+		mMesh = new (mMeshPool->Allocate()) FChunkMesh{};
+
+	return *mMesh;
+}
+
+void FChunk::ReleaseEmptyMesh()
+{
+	FChunkMesh* Mesh = mMesh;
+	if (Mesh && Mesh->GetQuadCount(FChunkMesh::FrontBuffer{}) == 0 && Mesh->GetBackSections() == 0)
+	{
+		mMesh = nullptr;
+		mMeshPool->Free(Mesh);
+	}
+}
+
+bool FChunk::RebuildMesh(const Vector3f& WorldPosition, const NeighborBorders& Neighbors, const uint8_t* Light, const uint32_t SectionMask, const uint32_t LODLevel, FChunkMeshCache* MeshCache)
+{
+	CPU_PROFILE("RebuildMesh");
+
+	ASSERT(LODLevel < LOD_LEVELS);
+
+	// Changing levels rebuilds every section
+	const uint32_t BuiltSections = (LODLevel != mMeshLOD) ? ALL_SECTIONS : SectionMask;
+	if (BuiltSections == 0)
+		return true;
+
+	// Mesh from a plain copy of the published blocks. Edits publish a copy of their own,
+	// so the snapshot is taken without the block lock and edits aren't blocked while meshing.
+	FBlock* Blocks = reinterpret_cast<FBlock*>(BlockScratch);
+	const uint32_t Generation = mBlockGeneration;
+	{
+		FEpochReclaimer::Guard Pin(BlockEpochs);
+
+		// All air chunks have no geometry at any level. Without a mesh there is nothing to clear.
+		const FBlockStorage& Storage = GetPublishedBlocks();
+		if (Storage.IsUniform() && Storage.Get(0) == FBlock::AIR_BLOCK_ID)
+		{
+			if (FChunkMesh* Mesh = mMesh)
+				Mesh->ClearSections(ALL_SECTIONS);
+			mMeshLOD = LODLevel;
+			mFaceConnections = ALL_FACE_CONNECTIONS;
+			return IsSnapshotCurrent(Generation, ALL_SECTIONS);
+		}
+
+		Storage.Unpack(Blocks);
+	}
+
+	mFaceConnections = FindFaceConnections(Blocks);
+	FChunkMesh& Mesh = AcquireMesh();
+
+	// Only whole meshes are cached, keyed by everything they are built from
+	const bool IsCached = (MeshCache != nullptr && BuiltSections == ALL_SECTIONS);
+	const Vector3i ChunkPosition{ (int32_t)WorldPosition.x / CHUNK_SIZE, (int32_t)WorldPosition.y / CHUNK_SIZE, (int32_t)WorldPosition.z / CHUNK_SIZE };
+	uint64_t InputHash = 0;
+
+	FChunkMeshCache::MeshData CachedMesh;
+	bool IsCacheHit = false;
+	if (IsCached)
+	{
+		InputHash = FChunkMeshCache::HashData(Blocks, BLOCKS_PER_CHUNK * sizeof(FBlock));
+		InputHash = FChunkMeshCache::HashData(&Neighbors, sizeof(NeighborBorders), InputHash);
+		InputHash = FChunkMeshCache::HashData(Light, BLOCKS_PER_CHUNK, InputHash);
+		InputHash = FChunkMeshCache::HashData(&LODLevel, sizeof(LODLevel), InputHash);
+
+		for (uint32_t Section = 0; Section < SECTION_COUNT; Section++)
+			CachedMesh.Quads[Section] = &Mesh.BeginSection(Section);
+
+		IsCacheHit = MeshCache->Read(ChunkPosition, InputHash, CachedMesh);
+	}
+
+	if (IsCacheHit)
+	{
+		for (uint32_t Section = 0; Section < SECTION_COUNT; Section++)
+			Mesh.AddSection(Section, CachedMesh.Ranges[Section]);
+	}
+	else if (LODLevel == 0)
 	{
-		// Previous mesh was not empty but this one is
-		PhysicsSystem.RemoveCollider(mCollisionData->Object);
+		GreedyMesh(Blocks, Neighbors, Light, BuiltSections);
 	}
+	else
+	{
+		// Neighbors may be meshed at another level, so border faces are always built. Since
+		// coarse cells only ever grow, these faces cover any seam between levels. Faces of
+		// coarse cells only border air, so they are still lit by the blocks in front of them.
+		NeighborBorders OpenBorders = Neighbors;
+		std::memset(OpenBorders.Solid, 0, sizeof(OpenBorders.Solid));
+
+		DownsampleBlocks(LODLevel, Blocks);
+		GreedyMesh(Blocks, OpenBorders, Light, BuiltSections);
+	}
+
+	mMeshLOD = LODLevel;
+
+	if (IsCached && !IsCacheHit)
+		MeshCache->Write(ChunkPosition, InputHash, Mesh);
+
+	return IsSnapshotCurrent(Generation, BuiltSections);
 }
 
-void FChunk::RebuildMesh(const Vector3f& WorldPosition)
+uint32_t FChunk::PrepareGPUMesh(const uint32_t SectionMask, FBlock* BlocksOut)
 {
-	GreedyMesh(WorldPosition);
+	// Changing levels rebuilds every section
+	FChunkMesh* Mesh = mMesh;
+	const uint32_t BuiltSections = (mMeshLOD != 0) ? ALL_SECTIONS : (SectionMask | (Mesh ? Mesh->GetBackSections() : 0));
+	if (BuiltSections == 0)
+		return 0;
+
+	// Copied from the published blocks like RebuildMesh. Edits made since drop the GPU mesh through its serial.
+	{
+		FEpochReclaimer::Guard Pin(BlockEpochs);
+
+		// All air chunks have no geometry at any level
+		const FBlockStorage& Storage = GetPublishedBlocks();
+		if (Storage.IsUniform() && Storage.Get(0) == FBlock::AIR_BLOCK_ID)
+		{
+			if (Mesh)
+				Mesh->ClearSections(ALL_SECTIONS);
+			mMeshLOD = 0;
+			mFaceConnections = ALL_FACE_CONNECTIONS;
+			return 0;
+		}
+
+		Storage.Unpack(BlocksOut);
+	}
 
-	int32_t VertexCount = (int)mMesh->GetVertexCount(FChunkMesh::BackBuffer{});
+	mFaceConnections = FindFaceConnections(BlocksOut);
 
-	if (VertexCount != 0)
+	if (Mesh)
+		Mesh->ClearBackBuffer();
+	mMeshLOD = 0;
+	return BuiltSections;
+}
+
+void FChunk::SwapGPUMesh(FChunkGeometryArena& GeometryArena, const uint32_t SectionMask, const FChunkGeometryArena::Allocation* Allocations, const FChunkMesh::FaceRanges* Ranges)
+{
+	// GPU built sections are swapped in on the thread that swaps meshes, so the mesh is taken here
+	FChunkMesh& Mesh = AcquireMesh();
+	for (uint32_t Section = 0; Section < SECTION_COUNT; Section++)
 	{
-		// Build collision data
-		// Set vertex properties for collision mesh
-		const int32_t IndexStride = 3 * sizeof(uint32_t);
-		const int32_t VertexStride = sizeof(FChunkMesh::Vertex);
+		if (SectionMask & (1 << Section))
+			Mesh.SetFrontSection(Section, GeometryArena, Allocations[Section], Ranges[Section]);
+	}
 
-		// Build final collision mesh
-		btIndexedMesh VertexData;
-		VertexData.m_triangleIndexStride = IndexStride;
-		VertexData.m_numTriangles = (int)mMesh->GetIndexCount(FChunkMesh::BackBuffer{}) / 3;;
-		VertexData.m_numVertices = VertexCount;
-		VertexData.m_triangleIndexBase = (const unsigned char*)mMesh->GetIndexData(FChunkMesh::BackBuffer{});
-		VertexData.m_vertexBase = (const unsigned char*)mMesh->GetVertexData(FChunkMesh::BackBuffer{});
-		VertexData.m_vertexStride = VertexStride;
+	mMeshRevision++;
+	mIsEmpty = (Mesh.GetQuadCount(FChunkMesh::FrontBuffer{}) == 0);
+	ReleaseEmptyMesh();
+}
 
-		// Reconstruct the collision shape with updated data
-		auto& CollisionMesh = mCollisionData->Mesh[!mCollisionData->ActiveMesh];
-		CollisionMesh.Mesh.getIndexedMeshArray().clear();
-		CollisionMesh.Mesh.getIndexedMeshArray().push_back(VertexData);
-		CollisionMesh.Shape.~btBvhTriangleMeshShape();
-		new (&CollisionMesh.Shape) btBvhTriangleMeshShape{ &CollisionMesh.Mesh, false };
+FBlockTypes::BlockID FChunk::SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID)
+{
+	std::lock_guard<std::mutex> Lock(mBlockMutex);
+	const FBlockTypes::BlockID PreviousID = mBlocks.load()->Get(BlockIndex(Position));
+	if (PreviousID != ID)
+	{
+		FBlockStorage* Blocks = CopyBlocks();
+		Blocks->Set(BlockIndex(Position), ID);
+		PublishBlocks(Blocks);
 	}
+	mModifyCount++;
+	return PreviousID;
+}
+
+FBlockStorage* FChunk::CopyBlocks() const
+{
+	FBlockStorage* Blocks = new FBlockStorage(BLOCKS_PER_CHUNK);
+	Blocks->CopyFrom(*mBlocks.load());
+	return Blocks;
+}
+
+void FChunk::PublishBlocks(const FBlockStorage* Blocks)
+{
+	// Readers pinned before the exchange may still hold the storage it replaces
+	const FBlockStorage* Replaced = mBlocks.exchange(Blocks);
+	if (Replaced != &AirBlocks && Replaced != Blocks)
+		BlockEpochs.Retire([Replaced]() { delete Replaced; });
+
+	// Advanced after the exchange, a snapshot reading the generation first never takes newer blocks for current ones
+	mBlockGeneration++;
 }
 
-void FChunk::SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID)
+bool FChunk::IsSnapshotCurrent(const uint32_t Generation, const uint32_t SectionMask)
 {
-	mBlocks[BlockIndex(Position)].ID = ID;
+	if (mBlockGeneration == Generation)
+		return true;
+
+	// The edit that published the newer blocks queued a rebuild after it, which takes these sections
+	MarkSectionsDirty(SectionMask);
+	return false;
 }
 
 FBlockTypes::BlockID FChunk::GetBlock(const Vector3i& Position) const
 {
-	return mBlocks[BlockIndex(Position)].ID;
+	std::lock_guard<std::mutex> Lock(mBlockMutex);
+	return mBlocks.load()->Get(BlockIndex(Position));
+}
+
+void FChunk::GetBorder(const uint32_t Face, RowMask SolidOut[CHUNK_SIZE]) const
+{
+	const int32_t AxisStride[3] = { CHUNK_SIZE, CHUNK_SIZE * CHUNK_SIZE, 1 };
+
+	// Positive faces have even ids
+	const int32_t d = Face / 2;
+	const int32_t u = (d + 1) % 3;
+	const int32_t v = (d + 2) % 3;
+	const int32_t LayerOffset = (Face % 2 == 0) ? (CHUNK_SIZE - 1) * AxisStride[d] : 0;
+
+	// Read from the published blocks, so meshing the neighbors doesn't block edits of this chunk
+	FEpochReclaimer::Guard Pin(BlockEpochs);
+	const FBlockStorage& Blocks = GetPublishedBlocks();
+
+	for (int32_t j = 0; j < CHUNK_SIZE; j++)
+	{
+		const int32_t RowOffset = LayerOffset + j * AxisStride[v];
+
+		RowMask Row = 0;
+		for (int32_t i = 0; i < CHUNK_SIZE; i++)
+		{
+			Row |= (RowMask)FBlockTypes::IsOpaque(Blocks.Get(RowOffset + i * AxisStride[u])) << i;
+		}
+
+		SolidOut[j] = Row;
+	}
+}
+
+void FChunk::GetBorderLight(const uint32_t Face, uint8_t LightOut[CHUNK_SIZE][CHUNK_SIZE]) const
+{
+	const int32_t AxisStride[3] = { CHUNK_SIZE, CHUNK_SIZE * CHUNK_SIZE, 1 };
+
+	// Positive faces have even ids
+	const int32_t d = Face / 2;
+	const int32_t u = (d + 1) % 3;
+	const int32_t v = (d + 2) % 3;
+	const int32_t LayerOffset = (Face % 2 == 0) ? (CHUNK_SIZE - 1) * AxisStride[d] : 0;
+
+	if (mLight.IsUniform())
+	{
+		std::memset(LightOut, mLight.Get(0), CHUNK_SIZE * CHUNK_SIZE);
+		return;
+	}
+
+	for (int32_t j = 0; j < CHUNK_SIZE; j++)
+	{
+		const int32_t RowOffset = LayerOffset + j * AxisStride[v];
+
+		for (int32_t i = 0; i < CHUNK_SIZE; i++)
+			LightOut[j][i] = mLight.Get(RowOffset + i * AxisStride[u]);
+	}
+}
+
+uint32_t FChunk::FindFaceConnections(const FBlock* Blocks)
+{
+	CPU_PROFILE("FindFaceConnections");
+
+	// Steps to the neighbors of a block in the layout of mBlocks, z + x * CHUNK_SIZE + y * CHUNK_SIZE^2
+	const int32_t RowStep = CHUNK_SIZE;
+	const int32_t LayerStep = CHUNK_SIZE * CHUNK_SIZE;
+
+	std::memset(FloodVisited, 0, sizeof(FloodVisited));
+	uint32_t Connections = 0;
+
+	for (int32_t First = 0; First < BLOCKS_PER_CHUNK && Connections != ALL_FACE_CONNECTIONS; First++)
+	{
+		if (FloodVisited[First] || FBlockTypes::IsOpaque(Blocks[First].ID))
+			continue;
+
+		// Bits of the NormalID of each face the region touches
+		uint32_t Faces = 0;
+		uint32_t QueueSize = 0;
+		FloodQueue[QueueSize++] = (PackedIndex)First;
+		FloodVisited[First] = 1;
+
+		for (uint32_t Next = 0; Next < QueueSize; Next++)
+		{
+			const int32_t Index = FloodQueue[Next];
+			const int32_t z = Index % CHUNK_SIZE;
+			const int32_t x = (Index / RowStep) % CHUNK_SIZE;
+			const int32_t y = Index / LayerStep;
+
+			const auto Visit = [&](const int32_t Neighbor)
+			{
+				if (!FloodVisited[Neighbor] && !FBlockTypes::IsOpaque(Blocks[Neighbor].ID))
+				{
+					FloodVisited[Neighbor] = 1;
+					FloodQueue[QueueSize++] = (PackedIndex)Neighbor;
+				}
+			};
+
+			if (x == CHUNK_SIZE - 1) Faces |= 1 << NormalID::East;  else Visit(Index + RowStep);
+			if (x == 0)              Faces |= 1 << NormalID::West;  else Visit(Index - RowStep);
+			if (y == CHUNK_SIZE - 1) Faces |= 1 << NormalID::Top;    else Visit(Index + LayerStep);
+			if (y == 0)              Faces |= 1 << NormalID::Bottom; else Visit(Index - LayerStep);
+			if (z == CHUNK_SIZE - 1) Faces |= 1 << NormalID::North;  else Visit(Index + 1);
+			if (z == 0)              Faces |= 1 << NormalID::South;  else Visit(Index - 1);
+		}
+
+		for (uint32_t FaceA = 0; FaceA < 6; FaceA++)
+		{
+			for (uint32_t FaceB = FaceA + 1; FaceB < 6; FaceB++)
+			{
+				if ((Faces & (1 << FaceA)) && (Faces & (1 << FaceB)))
+					Connections |= FaceConnection(FaceA, FaceB);
+			}
+		}
+	}
+
+	return Connections;
+}
+
+void FChunk::DownsampleBlocks(const uint32_t LODLevel, FBlock* Blocks)
+{
+	const int32_t CellSize = 1 << LODLevel;
+
+	// Block type counts for the current cell, reset after each cell
+	uint16_t TypeCounts[256] = { 0 };
+
+	for (int32_t y = 0; y < CHUNK_SIZE; y += CellSize)
+	{
+		for (int32_t x = 0; x < CHUNK_SIZE; x += CellSize)
+		{
+			for (int32_t z = 0; z < CHUNK_SIZE; z += CellSize)
+			{
+				FBlockTypes::BlockID CellType = FBlock::AIR_BLOCK_ID;
+				uint16_t CellTypeCount = 0;
+
+				for (int32_t cy = y; cy < y + CellSize; cy++)
+				{
+					for (int32_t cx = x; cx < x + CellSize; cx++)
+					{
+						for (int32_t cz = z; cz < z + CellSize; cz++)
+						{
+							const FBlockTypes::BlockID ID = Blocks[BlockIndex(cx, cy, cz)].ID;
+							if (ID != FBlock::AIR_BLOCK_ID && ++TypeCounts[ID] > CellTypeCount)
+							{
+								CellType = ID;
+								CellTypeCount = TypeCounts[ID];
+							}
+						}
+					}
+				}
+
+				for (int32_t cy = y; cy < y + CellSize; cy++)
+				{
+					for (int32_t cx = x; cx < x + CellSize; cx++)
+					{
+						for (int32_t cz = z; cz < z + CellSize; cz++)
+						{
+							const int32_t Index = BlockIndex(cx, cy, cz);
+							TypeCounts[Blocks[Index].ID] = 0;
+							Blocks[Index].ID = CellType;
+						}
+					}
+				}
+			}
+		}
+	}
 }
 
 FBlockTypes::BlockID FChunk::DestroyBlock(const Vector3i& Position)
 {
-	FBlockTypes::BlockID ID = mBlocks[BlockIndex(Position)].ID;
-	mBlocks[BlockIndex(Position)].ID = FBlock::AIR_BLOCK_ID;
+	std::lock_guard<std::mutex> Lock(mBlockMutex);
+
+	FBlockTypes::BlockID ID = mBlocks.load()->Get(BlockIndex(Position));
+	if (ID != FBlock::AIR_BLOCK_ID)
+	{
+		FBlockStorage* Blocks = CopyBlocks();
+		Blocks->Set(BlockIndex(Position), FBlock::AIR_BLOCK_ID);
+		PublishBlocks(Blocks);
+	}
+	mModifyCount++;
 	return ID;
 }
 
-void FChunk::GreedyMesh(const Vector3f WorldPosition)
+void FChunk::SetBlocks(const BlockWrite* Writes, const uint32_t Count, FBlockTypes::BlockID* PreviousIDsOut, const FBlockTypes::BlockID* ReplacedID)
 {
-	// Greedy mesh algorithm by Mikola Lysenko from http://0fps.net/2012/06/30/meshing-in-a-minecraft-game/
-	// Java implementation from https://github.com/roboleary/GreedyMesh/blob/master/src/mygame/Main.java
+	std::lock_guard<std::mutex> Lock(mBlockMutex);
 
-	// Vertex and index data to be sent to the mesh
-	FChunkMesh::VertexDataPtr Vertices{ new FChunkMesh::VertexData{} };
-	FChunkMesh::IndexDataPtr Indices{ new FChunkMesh::IndexData{} };
+	// Copied on the first change, so the whole batch is published at once
+	const FBlockStorage* Blocks = mBlocks.load();
+	FBlockStorage* Copy = nullptr;
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		const BlockWrite& Write = Writes[i];
+		ASSERT(Write.Index >= 0 && Write.Index < BLOCKS_PER_CHUNK);
 
-	// Variables to be used by the algorithm
-	int32_t i, j, k, Length, Width, Height, u, v, n, Side = 0;
-	int32_t x[3], q[3], du[3], dv[3];
+		PreviousIDsOut[i] = Blocks->Get(Write.Index);
+		if (PreviousIDsOut[i] != Write.ID && (!ReplacedID || PreviousIDsOut[i] == *ReplacedID))
+		{
+			if (!Copy)
+				Blocks = Copy = CopyBlocks();
+			Copy->Set(Write.Index, Write.ID);
+		}
+	}
 
-	// This mask will contain matching voxel faces as we
-	// loop through each direction in the chunk
-	FBlock Mask[CHUNK_SIZE * CHUNK_SIZE];
+	if (Copy)
+	{
+		PublishBlocks(Copy);
+		mModifyCount++;
+	}
+}
+
+void FChunk::GreedyMesh(const FBlock* Blocks, const NeighborBorders& Neighbors, const uint8_t* Light, const uint32_t SectionMask)
+{
+	CPU_PROFILE("GreedyMesh");
+
+	// Binary greedy mesh. Each row of CHUNK_SIZE blocks is a single bitmask, so face visibility for a
+	// whole row is found with a few bitwise operations. Quads are then merged greedily per block type
+	// in the same manner as the algorithm by Mikola Lysenko from http://0fps.net/2012/06/30/meshing-in-a-minecraft-game/
+	// Rows are RowMask wide, so 64 block chunks mesh 64 bits at a time.
+
+	static_assert(CHUNK_SIZE <= 8 * sizeof(RowMask), "Binary greedy meshing requires chunk rows to fit in a row mask.");
+	static_assert(SECTION_SIZE <= FChunkMesh::Quad::MAX_SPAN, "Quads spanning a section must fit in a packed quad.");
+
+	// Quad data of each rebuilt mesh section, built in place
+	FChunkMesh::QuadData* Quads[SECTION_COUNT] = {};
+
+	// Every quad of a face direction is emitted together, so each direction is one quad range of a section
+	FChunkMesh::FaceRanges FaceRanges[SECTION_COUNT];
+
+	// Acquired by RebuildMesh
+	FChunkMesh& Mesh = *mMesh;
+	for (uint32_t Section = 0; Section < SECTION_COUNT; Section++)
+	{
+		if (SectionMask & (1 << Section))
+			Quads[Section] = &Mesh.BeginSection(Section);
+	}
+
+	// Distance between blocks along each axis within Blocks
+	const int32_t AxisStride[3] = { CHUNK_SIZE, CHUNK_SIZE * CHUNK_SIZE, 1 };
+
+	// Solid block columns along each axis. For axis d, with the other axes u = (d + 1) % 3
+	// and v = (d + 2) % 3, bit x[d] of Columns[d][x[v]][x[u]] is set if that block is not air.
+	RowMask Columns[3][CHUNK_SIZE][CHUNK_SIZE];
+
+	// Transparent block columns in the same layout, a subset of the solid columns
+	RowMask Transparent[3][CHUNK_SIZE][CHUNK_SIZE];
+
+	// Build the z axis columns directly from block data, z columns are indexed [y][x]. The
+	// x and y axis columns are bit transposes of them.
+	BuildSolidColumns(Blocks, Columns[2]);
+	TransposeColumns(Columns);
+
+	// Without transparent types every solid block is opaque, so the property lookups are skipped
+	if (FBlockTypes::HasTransparentTypes())
+	{
+		BuildTransparentColumns(Blocks, Transparent[2]);
+		TransposeColumns(Transparent);
+	}
+	else
+	{
+		std::memset(Transparent, 0, sizeof(Transparent));
+	}
+
+	RowMask Transpose[CHUNK_SIZE];
+
+	// Opaque blocks around faces, used for ambient occlusion. Blocks past a face of the chunk are
+	// read from the neighboring chunk's border, and blocks past an edge are taken as air.
+	const auto IsSolid = [&](const int32_t (&Position)[3]) -> bool
+	{
+		int32_t OutsideAxis = -1;
+		for (int32_t Axis = 0; Axis < 3; Axis++)
+		{
+			if (Position[Axis] < 0 || Position[Axis] >= CHUNK_SIZE)
+			{
+				if (OutsideAxis != -1)
+					return false;
+
+				OutsideAxis = Axis;
+			}
+		}
+
+		if (OutsideAxis == -1)
+			return (((Columns[2][Position[1]][Position[0]] & ~Transparent[2][Position[1]][Position[0]]) >> Position[2]) & 1) != 0;
+
+		// Positive faces have even ids
+		const uint32_t Face = OutsideAxis * 2 + ((Position[OutsideAxis] < 0) ? 1 : 0);
+		return ((Neighbors.Solid[Face][Position[(OutsideAxis + 2) % 3]] >> Position[(OutsideAxis + 1) % 3]) & 1) != 0;
+	};
+
+	// Visible faces for each slice along an axis. Bit x[u] of Slices[x[d]][x[v]] is set
+	// if that block has a visible face.
+	RowMask Slices[CHUNK_SIZE][CHUNK_SIZE];
+
+	int32_t x[3];
 
 	// Start with a for loop the will flip face direction once we iterate through
 	// the chunk in one direction.
 	for (bool BackFace = true, b = false; b != BackFace; BackFace = BackFace && b, b = !b)
 	{
-
 		// Iterate through each dimension of the chunk
 		for (int32_t d = 0; d < 3; d++)
 		{
 			// Get the other 2 axes
-			u = (d + 1) % 3;
-			v = (d + 2) % 3;
-
-			x[0] = 0;
-			x[1] = 0;
-			x[2] = 0;
-
-			// Used to check against covering voxels
-			q[0] = 0;
-			q[1] = 0;
-			q[2] = 0;
-			q[d] = 1;
+			const int32_t u = (d + 1) % 3;
+			const int32_t v = (d + 2) % 3;
 
+			uint32_t Side = 0;
 			if (d == 0)
 			{ 
 				Side = BackFace ? NormalID::West : NormalID::East;
@@ -275,174 +966,178 @@ void FChunk::GreedyMesh(const Vector3f WorldPosition)
 				Side = BackFace ? NormalID::South : NormalID::North;
 			}
 
-			// Move through the dimension from front to back
-			for (x[d] = -1; x[d] < CHUNK_SIZE;)
+			for (uint32_t Section = 0; Section < SECTION_COUNT; Section++)
 			{
-				// Compute mask
-				n = 0;
+				if (SectionMask & (1 << Section))
+					FaceRanges[Section][Side].FirstQuad = Quads[Section]->size();
+			}
 
-				for (x[v] = 0; x[v] < CHUNK_SIZE; x[v]++)
-				{
-					for (x[u] = 0; x[u] < CHUNK_SIZE; x[u]++)
-					{
-						// Check covering voxel
-						FBlock Voxel1 = (x[d] >= 0) ? mBlocks[BlockIndex(x[0], x[1], x[2])] : FBlock{ FBlock::AIR_BLOCK_ID };
-						FBlock Voxel2 = (x[d] < CHUNK_SIZE - 1) ? mBlocks[BlockIndex(x[0] + q[0], x[1] + q[1], x[2] + q[2])] : FBlock{ FBlock::AIR_BLOCK_ID };
-
-						// If both voxels are active and the same type, mark the mask with an inactive block, if not
-						// choose the appropriate voxel to mark
-						if (Voxel1 == Voxel2)
-							Mask[n++] = FBlock{ FBlock::AIR_BLOCK_ID };
-						else
-							Mask[n++] = (BackFace) ? Voxel2 : Voxel1;
-					}
-				}
+			// Faces are lit by the block in front of them. Faces on the chunk border are lit
+			// by the neighboring chunk's blocks.
+			const int32_t FrontOffset = BackFace ? -AxisStride[d] : AxisStride[d];
+			const auto FaceLight = [&](const int32_t FaceSlice, const int32_t FaceU, const int32_t FaceV) -> uint8_t
+			{
+				const int32_t Front = FaceSlice + (BackFace ? -1 : 1);
+				if (Front < 0 || Front >= CHUNK_SIZE)
+					return VertexLightLevel(Neighbors.Light[Side][FaceV][FaceU]);
 
-				x[d]++;
+				return VertexLightLevel(Light[FaceSlice * AxisStride[d] + FaceU * AxisStride[u] + FaceV * AxisStride[v] + FrontOffset]);
+			};
 
-				// Generate the mesh for the mask
-				n = 0;
+			// Faces are occluded by the blocks around the block in front of them. Each corner takes
+			// 2 bits, in the order of the quad corners x, x + du, x + du + dv and x + dv.
+			const auto FaceOcclusion = [&](const int32_t FaceSlice, const int32_t FaceU, const int32_t FaceV) -> uint8_t
+			{
+				int32_t Front[3];
+				Front[d] = FaceSlice + (BackFace ? -1 : 1);
 
-				for (j = 0; j < CHUNK_SIZE; j++)
+				uint8_t Occlusion = 0;
+				for (int32_t Corner = 0; Corner < 4; Corner++)
 				{
-					for (i = 0; i < CHUNK_SIZE;)
-					{
-						if (Mask[n].ID != FBlock::AIR_BLOCK_ID)
-						{
-							// Compute the width
-							for (Width = 1; i + Width < CHUNK_SIZE && (Mask[n + Width] == Mask[n]); Width++){}
+					const int32_t CornerU = (Corner == 1 || Corner == 2) ? 1 : -1;
+					const int32_t CornerV = (Corner >= 2) ? 1 : -1;
 
-							// Compute Height
-							bool Done = false;
+					Front[u] = FaceU + CornerU;
+					Front[v] = FaceV;
+					const bool SideU = IsSolid(Front);
 
-							for (Height = 1; j + Height < CHUNK_SIZE; Height++)
-							{
-								for (k = 0; k < Width; k++)
-								{
-									if (Mask[n + k + Height*CHUNK_SIZE] != Mask[n])
-									{
-										Done = true;
-										break;
-									}
-								}
-
-								if (Done) 
-									break;
-							}
+					Front[u] = FaceU;
+					Front[v] = FaceV + CornerV;
+					const bool SideV = IsSolid(Front);
 
+					Front[u] = FaceU + CornerU;
+					const bool Diagonal = IsSolid(Front);
 
-							// Add the quad
-							x[u] = i;
-							x[v] = j;
+					Occlusion |= (uint8_t)(CornerOcclusion(SideU, SideV, Diagonal) << (Corner * 2));
+				}
 
-							du[0] = 0;
-							du[1] = 0;
-							du[2] = 0;
-							du[u] = Width;
+				return Occlusion;
+			};
 
-							dv[0] = 0;
-							dv[1] = 0;
-							dv[2] = 0;
-							dv[v] = Height;
+			// A face is visible unless the neighboring block in the face direction is opaque, or both
+			// blocks are transparent. Faces on the chunk border check the neighboring chunk's blocks.
+			const RowMask* NeighborSolid = Neighbors.Solid[Side];
+			for (int32_t j = 0; j < CHUNK_SIZE; j++)
+			{
+				for (int32_t i = 0; i < CHUNK_SIZE; i++)
+				{
+					const RowMask Column = Columns[d][j][i];
+					const RowMask Clear = Transparent[d][j][i];
+					const RowMask Opaque = Column & ~Clear;
+					const RowMask Neighbor = (NeighborSolid[j] >> i) & 1;
+					const RowMask Hidden = BackFace ? ((Opaque << 1) | Neighbor | (Clear & (Clear << 1))) :
+						((Opaque >> 1) | (Neighbor << (CHUNK_SIZE - 1)) | (Clear & (Clear >> 1)));
+					Transpose[i] = Column & ~Hidden;
+				}
 
-							const Vector3f Corners[4] = 
-							{
-								{ Vector3f{ x[0], x[1], x[2] } + WorldPosition },
-								{ Vector3f{ x[0] + du[0], x[1] + du[1], x[2] + du[2] } + WorldPosition },
-								{ Vector3f{ x[0] + du[0] + dv[0], x[1] + du[1] + dv[1], x[2] + du[2] + dv[2] } + WorldPosition },
-								{ Vector3f{ x[0] + dv[0], x[1] + dv[1], x[2] + dv[2] } + WorldPosition }
-							};
+				// Rows of u for each slice along d
+				TransposeBits(Transpose);
 
-							AddQuad(Corners[0], Corners[1], Corners[2], Corners[3], BackFace, Side, Mask[n], *Vertices, *Indices);
+				for (int32_t k = 0; k < CHUNK_SIZE; k++)
+					Slices[k][j] = Transpose[k];
+			}
 
+			// Generate the mesh for each slice
+			for (int32_t Slice = 0; Slice < CHUNK_SIZE; Slice++)
+			{
+				const int32_t SliceOffset = Slice * AxisStride[d];
 
-							// Zero the mask
-							for (Length = 0; Length < Height; Length++)
-							{
-								for (k = 0; k < Width; k++)
-								{
-									Mask[n + k + Length * CHUNK_SIZE].ID = FBlock::AIR_BLOCK_ID;
-								}
-							}
+				for (int32_t j = 0; j < CHUNK_SIZE; j++)
+				{
+					RowMask& Row = Slices[Slice][j];
 
-							// Increment counters
-							i += Width;
-							n += Width;
-						}
-						else
-						{
-							i++;
-							n++;
-						}
+					// Only build faces in the requested sections, one half of the row for each
+					int32_t SectionPosition[3];
+					SectionPosition[d] = Slice / SECTION_SIZE;
+					SectionPosition[v] = j / SECTION_SIZE;
+
+					uint32_t RowSections[2];
+					for (int32_t Half = 0; Half < 2; Half++)
+					{
+						SectionPosition[u] = Half;
+						RowSections[Half] = SectionPosition[0] | (SectionPosition[1] << 1) | (SectionPosition[2] << 2);
+
+						if (!(SectionMask & (1 << RowSections[Half])))
+							Row &= ~((FULL_ROW >> SECTION_SIZE) << (Half * SECTION_SIZE));
 					}
-				}
-			}
-		}
-	}
 
-	// Add data to mesh
-	mMesh->AddVertexData(std::move(Vertices));
-	mMesh->AddIndexData(std::move(Indices));
-}
+					// Quads stop at section borders
+					const int32_t HeightEnd = (j / SECTION_SIZE + 1) * SECTION_SIZE;
 
-void FChunk::AddQuad(	const Vector3f& BottomLeft,
-						const Vector3f& TopLeft,
-						const Vector3f& TopRight,
-						const Vector3f& BottomRight,
-						const bool IsBackface,
-						const uint32_t Side,
-						const FBlock FaceInfo,
-						FChunkMesh::VertexData& VerticesOut,
-						FChunkMesh::IndexData& IndicesOut)
-{
-	
-	// Get the index offset by checking the size of the vertex list.
-	uint32_t BaseIndex = VerticesOut.size();
+					while (Row != 0)
+					{
+						const int32_t i = FMath::CountTrailingZeros(Row);
+						const int32_t BlockOffset = SliceOffset + j * AxisStride[v];
+						const FBlock BlockType = Blocks[BlockOffset + i * AxisStride[u]];
+						const uint8_t LightLevel = FaceLight(Slice, i, j);
+						const uint8_t Occlusion = FaceOcclusion(Slice, i, j);
+						const uint32_t Section = RowSections[i / SECTION_SIZE];
+						const int32_t WidthEnd = (i / SECTION_SIZE + 1) * SECTION_SIZE;
+
+						// Unevenly occluded faces stay single quads, so their occlusion isn't stretched
+						const bool CanMerge = IsUniformOcclusion(Occlusion);
+
+						// Compute the width
+						int32_t Width = 1;
+						while (CanMerge && i + Width < WidthEnd && (Row & ((RowMask)1 << (i + Width))) &&
+							Blocks[BlockOffset + (i + Width) * AxisStride[u]] == BlockType &&
+							FaceLight(Slice, i + Width, j) == LightLevel &&
+							FaceOcclusion(Slice, i + Width, j) == Occlusion)
+						{
+							Width++;
+						}
 
-	// Add normal index and block type for each vertex
-	FChunkMesh::Vertex BottomLeftData;
-	BottomLeftData.Position = BottomLeft;
-	BottomLeftData.BlockType = FaceInfo.ID;
-	BottomLeftData.NormalID= Side;
+						// Widths stay within a section, so the mask is never a whole row
+						const RowMask WidthMask = (((RowMask)1 << Width) - 1) << i;
 
-	FChunkMesh::Vertex BottomRightData;
-	BottomRightData.Position = BottomRight;
-	BottomRightData.BlockType = FaceInfo.ID;
-	BottomRightData.NormalID = Side;
+						// Compute Height
+						int32_t Height = 1;
+						for (; CanMerge && j + Height < HeightEnd; Height++)
+						{
+							if ((Slices[Slice][j + Height] & WidthMask) != WidthMask)
+								break;
 
-	FChunkMesh::Vertex TopLeftData;
-	TopLeftData.Position = TopLeft;
-	TopLeftData.BlockType = FaceInfo.ID;
-	TopLeftData.NormalID = Side;
+							const int32_t HeightOffset = SliceOffset + (j + Height) * AxisStride[v];
 
-	FChunkMesh::Vertex TopRightData;
-	TopRightData.Position = TopRight;
-	TopRightData.BlockType = FaceInfo.ID;
-	TopRightData.NormalID = Side;
+							int32_t k = 0;
+							while (k < Width && Blocks[HeightOffset + (i + k) * AxisStride[u]] == BlockType &&
+								FaceLight(Slice, i + k, j + Height) == LightLevel &&
+								FaceOcclusion(Slice, i + k, j + Height) == Occlusion)
+							{
+								k++;
+							}
 
-	VerticesOut.insert(VerticesOut.end(), { BottomLeftData, BottomRightData, TopRightData, TopLeftData });
-	
+							if (k != Width)
+								break;
+						}
 
+						// Zero the mask
+						for (int32_t Length = 0; Length < Height; Length++)
+							Slices[Slice][j + Length] &= ~WidthMask;
 
-	// Add adjusted indices.
-	if (IsBackface)
-	{
-		IndicesOut.insert(IndicesOut.end(), {	0 + BaseIndex, 
-												1 + BaseIndex, 
-												2 + BaseIndex, 
-												2 + BaseIndex, 
-												3 + BaseIndex, 
-												0 + BaseIndex });
+						// Add the quad at its first block. Its corners are placed by the vertex shader, on the near
+						// side of the block for back faces and on the far side for front faces.
+						x[d] = Slice;
+						x[u] = i;
+						x[v] = j;
 
+						Quads[Section]->push_back(FChunkMesh::Quad::Pack(Vector3i{ x[0], x[1], x[2] }, Width, Height, BlockType.ID, (uint8_t)Side, LightLevel, Occlusion));
+					}
+				}
+			}
+
+			for (uint32_t Section = 0; Section < SECTION_COUNT; Section++)
+			{
+				if (SectionMask & (1 << Section))
+					FaceRanges[Section][Side].QuadCount = Quads[Section]->size() - FaceRanges[Section][Side].FirstQuad;
+			}
+		}
 	}
-	else
+
+	// Add data to mesh
+	for (uint32_t Section = 0; Section < SECTION_COUNT; Section++)
 	{
-		IndicesOut.insert(IndicesOut.end(), {	0 + BaseIndex, 
-												3 + BaseIndex, 
-												2 + BaseIndex, 
-												0 + BaseIndex, 
-												2 + BaseIndex, 
-												1 + BaseIndex });
+		if (SectionMask & (1 << Section))
+			Mesh.AddSection(Section, FaceRanges[Section]);
 	}
-
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "ChunkSystems\ChunkCuller.h"
+#include "ChunkSystems\ChunkDrawList.h"
+#include "ChunkSystems\Chunk.h"
+#include "Rendering\HiZBuffer.h"
+#include "Math\Frustum.h"
+
+namespace
+{
+	// Work group size of ChunkCulling.comp
+	const uint32_t CULLING_GROUP_SIZE = 64;
+
+	// Shader storage bindings of ChunkCulling.comp
+	const GLuint COMMAND_BINDING = 0;
+	const GLuint ORIGIN_BINDING = 1;
+}
+
+FChunkCuller::FChunkCuller()
+	: mCullingProgram()
+	, mDrawCountUniform(mCullingProgram.FindUniform("uDrawCount"))
+	, mChunkSizeUniform(mCullingProgram.FindUniform("uChunkSize"))
+	, mFrustumPlanesUniform(mCullingProgram.FindUniform("uFrustumPlanes"))
+	, mUseHiZUniform(mCullingProgram.FindUniform("uUseHiZ"))
+	, mHiZViewProjectionUniform(mCullingProgram.FindUniform("uHiZViewProjection"))
+	, mHiZUVScaleUniform(mCullingProgram.FindUniform("uHiZUVScale"))
+{
+	FShader CullingShader{ L"Shaders/ChunkCulling.comp", GL_COMPUTE_SHADER };
+	mCullingProgram.AttachShader(CullingShader);
+	mCullingProgram.LinkProgram();
+}
+
+void FChunkCuller::Cull(const FChunkDrawList& DrawList, const FFrustum& WorldFrustum, const FHiZBuffer& HiZBuffer)
+{
+	const uint32_t DrawCount = DrawList.GetDrawCount();
+	if (DrawCount == 0)
+		return;
+
+	Vector4f Planes[6];
+	for (uint32_t i = 0; i < 6; i++)
+		Planes[i] = WorldFrustum.GetPlane((FFrustum::PlaneType)i).NormalwDistance;
+
+	mCullingProgram.Use();
+	mCullingProgram.SetUniform(mDrawCountUniform, DrawCount, std::true_type{});
+	mCullingProgram.SetUniform(mChunkSizeUniform, (float)FChunk::CHUNK_SIZE, std::true_type{});
+	mCullingProgram.SetVector(mFrustumPlanesUniform, 6, Planes, std::true_type{});
+	mCullingProgram.SetUniform(mUseHiZUniform, HiZBuffer.IsValid() ? 1 : 0, std::true_type{});
+
+	if (HiZBuffer.IsValid())
+	{
+		mCullingProgram.SetMatrix(mHiZViewProjectionUniform, 1, GL_FALSE, &HiZBuffer.GetViewProjection(), std::true_type{});
+		mCullingProgram.SetVector(mHiZUVScaleUniform, 1, &HiZBuffer.GetUVScale(), std::true_type{});
+		HiZBuffer.Bind();
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, DrawList.GetCommandBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ORIGIN_BINDING, DrawList.GetOriginBuffer());
+
+	glDispatchCompute((DrawCount + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE, 1, 1);
+
+	// Commands are read by the following indirect draw
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
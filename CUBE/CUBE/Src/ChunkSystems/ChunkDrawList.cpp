@@ -0,0 +1,66 @@
+#include "ChunkSystems\ChunkDrawList.h"
+#include "ChunkSystems\ChunkGeometryArena.h"
+#include "ChunkSystems\ChunkMesh.h"
+
+FChunkDrawList::FChunkDrawList()
+	: mCommands()
+	, mOrigins()
+	, mCommandBuffer(0)
+	, mOriginBuffer(0)
+{
+	glGenBuffers(1, &mCommandBuffer);
+	glGenBuffers(1, &mOriginBuffer);
+}
+
+FChunkDrawList::~FChunkDrawList()
+{
+	glDeleteBuffers(1, &mOriginBuffer);
+	glDeleteBuffers(1, &mCommandBuffer);
+}
+
+void FChunkDrawList::Clear()
+{
+	mCommands.clear();
+	mOrigins.clear();
+}
+
+uint32_t FChunkDrawList::AddOrigin(const Vector3i& Origin)
+{
+	mOrigins.push_back(Vector3f{ Origin });
+	return mOrigins.size() - 1;
+}
+
+void FChunkDrawList::AddDraw(const uint32_t QuadCount, const uint32_t FirstQuad, const uint32_t OriginIndex)
+{
+	const uint32_t Vertices = FChunkMesh::VERTICES_PER_QUAD;
+	mCommands.push_back(DrawCommand{ QuadCount * Vertices, 1, FirstQuad * Vertices, OriginIndex });
+}
+
+void FChunkDrawList::Upload()
+{
+	if (mCommands.empty())
+		return;
+
+	// Orphan last frame's data so the upload doesn't wait on its draws
+	glBindBuffer(GL_ARRAY_BUFFER, mOriginBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(Vector3f) * mOrigins.size(), mOrigins.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand) * mCommands.size(), mCommands.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void FChunkDrawList::Draw(const FChunkGeometryArena& GeometryArena, const GLenum RenderMode) const
+{
+	if (mCommands.empty())
+		return;
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+
+	GeometryArena.Bind();
+	GeometryArena.SetDrawOrigins(mOriginBuffer);
+	glMultiDrawArraysIndirect(RenderMode, nullptr, mCommands.size(), 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
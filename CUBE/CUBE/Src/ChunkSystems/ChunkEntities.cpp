@@ -0,0 +1,307 @@
+#include "ChunkSystems\ChunkEntities.h"
+#include "ChunkSystems\Chunk.h"
+#include "FileIO\WorldFileSystem.h"
+#include "SystemResources\SystemFile.h"
+#include "Atlas\GameObject.h"
+#include "Misc\Assertions.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	/**
+	* An entity as stored on file, after the table of type names.
+	*/
+	struct EntityRecord
+	{
+		uint32_t Type;
+		float    Position[3];
+		float    Rotation[4];
+		float    Velocity[3];
+		float    AngularVelocity[3];
+	};
+
+	void Append(std::vector<uint8_t>& Data, const void* Source, const uint32_t Size)
+	{
+		const uint8_t* Bytes = (const uint8_t*)Source;
+		Data.insert(Data.end(), Bytes, Bytes + Size);
+	}
+}
+
+FChunkEntities::FChunkEntities()
+	: mTypes()
+	, mTypeIndices()
+	, mBound()
+	, mParked()
+	, mSaveData()
+	, mLeaving()
+	, mFilepath()
+	, mMutex()
+{
+}
+
+void FChunkEntities::Open(const wchar_t* WorldName)
+{
+	// Objects of the last world have no chunks to wait on
+	std::unordered_map<Atlas::FGameObject*, uint32_t> Bound;
+	Bound.swap(mBound);
+	for (const auto& Object : Bound)
+		mTypes[Object.second].Despawn(*Object.first);
+	mParked.clear();
+
+	std::wstring Filepath = FWorldFileSystem::WORLDS_DIRECTORY_NAME;
+	Filepath += WorldName;
+	Filepath += L"/Entities.vge";
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		mFilepath = Filepath;
+		mSaveData.clear();
+	}
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	if (!FileSystem.FileExists(Filepath.c_str()))
+		return;
+
+	auto File = FileSystem.OpenReadable(Filepath.c_str());
+	if (!File)
+		return;
+
+	std::vector<uint8_t> Data(File->GetFileSize());
+	if (Data.empty() || !File->Read(Data.data(), Data.size()))
+		return;
+
+	// Types are saved by name, so their indices on file are mapped to those of this run
+	uint32_t Offset = 0;
+	uint32_t TypeCount = 0;
+	if (Data.size() < sizeof(TypeCount))
+		return;
+	memcpy(&TypeCount, Data.data(), sizeof(TypeCount));
+	Offset += sizeof(TypeCount);
+
+	std::vector<uint32_t> FileTypes;
+	for (uint32_t i = 0; i < TypeCount; i++)
+	{
+		uint32_t NameLength = 0;
+		if (Data.size() - Offset < sizeof(NameLength))
+			return;
+		memcpy(&NameLength, Data.data() + Offset, sizeof(NameLength));
+		Offset += sizeof(NameLength);
+
+		if (Data.size() - Offset < NameLength)
+			return;
+		FileTypes.push_back(FindType(std::string((const char*)Data.data() + Offset, NameLength)));
+		Offset += NameLength;
+	}
+
+	// A partly written record at the end is dropped. Every entity waits on its chunk, which has yet to be loaded.
+	for (; Data.size() - Offset >= sizeof(EntityRecord); Offset += sizeof(EntityRecord))
+	{
+		EntityRecord Record;
+		memcpy(&Record, Data.data() + Offset, sizeof(Record));
+		if (Record.Type >= FileTypes.size())
+			continue;
+
+		ParkedEntity Parked;
+		Parked.Type = FileTypes[Record.Type];
+		Parked.Saved.Position = Vector3f{ Record.Position[0], Record.Position[1], Record.Position[2] };
+		Parked.Saved.Rotation = FQuaternion{ Record.Rotation[0], Record.Rotation[1], Record.Rotation[2], Record.Rotation[3] };
+		Parked.Saved.Velocity = Vector3f{ Record.Velocity[0], Record.Velocity[1], Record.Velocity[2] };
+		Parked.Saved.AngularVelocity = Vector3f{ Record.AngularVelocity[0], Record.AngularVelocity[1], Record.AngularVelocity[2] };
+
+		const Vector3f ChunkPosition = Parked.Saved.Position / (float)FChunk::CHUNK_SIZE;
+		mParked[Vector3i{ (int32_t)std::floor(ChunkPosition.x), (int32_t)std::floor(ChunkPosition.y), (int32_t)std::floor(ChunkPosition.z) }].push_back(Parked);
+	}
+}
+
+void FChunkEntities::Snapshot()
+{
+	std::vector<uint8_t> Data;
+
+	const uint32_t TypeCount = mTypes.size();
+	Append(Data, &TypeCount, sizeof(TypeCount));
+	for (const EntityType& Type : mTypes)
+	{
+		const uint32_t NameLength = Type.Name.size();
+		Append(Data, &NameLength, sizeof(NameLength));
+		Append(Data, Type.Name.data(), NameLength);
+	}
+
+	auto AppendRecord = [&Data](const uint32_t Type, const State& Saved)
+	{
+		const EntityRecord Record = {
+			Type,
+			{ Saved.Position.x, Saved.Position.y, Saved.Position.z },
+			{ Saved.Rotation.w, Saved.Rotation.x, Saved.Rotation.y, Saved.Rotation.z },
+			{ Saved.Velocity.x, Saved.Velocity.y, Saved.Velocity.z },
+			{ Saved.AngularVelocity.x, Saved.AngularVelocity.y, Saved.AngularVelocity.z } };
+		Append(Data, &Record, sizeof(Record));
+	};
+
+	for (const auto& Bound : mBound)
+	{
+		if (Bound.first->IsActive())
+			AppendRecord(Bound.second, Capture(*Bound.first));
+	}
+
+	for (const auto& Chunk : mParked)
+	{
+		for (const ParkedEntity& Parked : Chunk.second)
+			AppendRecord(Parked.Type, Parked.Saved);
+	}
+
+	std::lock_guard<std::mutex> Lock(mMutex);
+	mSaveData.swap(Data);
+}
+
+bool FChunkEntities::Save() const
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	std::lock_guard<std::mutex> Lock(mMutex);
+	if (mFilepath.empty() || mSaveData.empty())
+		return false;
+
+	// Written beside the saved entities, so a failed write keeps them
+	const std::wstring SavePath = mFilepath + L".save";
+	bool IsWritten = false;
+	{
+		auto File = FileSystem.OpenWritable(SavePath.c_str(), false, true);
+		IsWritten = File && File->Write(mSaveData.data(), mSaveData.size()) && File->Flush();
+	}
+
+	return IsWritten && FileSystem.ReplaceFilename(SavePath.c_str(), mFilepath.c_str());
+}
+
+void FChunkEntities::RegisterType(const std::string& Name, SpawnFunction Spawn, DespawnFunction Despawn)
+{
+	ASSERT(Spawn && Despawn && "Entity types must spawn and despawn their objects.");
+
+	EntityType& Type = mTypes[FindType(Name)];
+	Type.Spawn = std::move(Spawn);
+	Type.Despawn = std::move(Despawn);
+}
+
+void FChunkEntities::UnregisterType(const std::string& Name)
+{
+	const uint32_t Type = FindType(Name);
+	mTypes[Type].Spawn = SpawnFunction{};
+	mTypes[Type].Despawn = DespawnFunction{};
+
+	for (auto Bound = mBound.begin(); Bound != mBound.end();)
+	{
+		if (Bound->second == Type)
+			Bound = mBound.erase(Bound);
+		else
+			++Bound;
+	}
+}
+
+void FChunkEntities::Bind(Atlas::FGameObject& GameObject, const std::string& Type)
+{
+	const uint32_t Index = FindType(Type);
+	ASSERT(mTypes[Index].Spawn && "Binding an object of an unregistered entity type.");
+
+	mBound[&GameObject] = Index;
+}
+
+void FChunkEntities::Unbind(Atlas::FGameObject& GameObject)
+{
+	mBound.erase(&GameObject);
+}
+
+void FChunkEntities::Park(const ResidencyFunction& IsResident, const ResidencyFunction& IsInWorld)
+{
+	mLeaving.clear();
+	for (const auto& Bound : mBound)
+	{
+		Atlas::FGameObject& GameObject = *Bound.first;
+		if (!GameObject.IsActive())
+			continue;
+
+		const Vector3f Position = GameObject.Transform.GetWorldPosition() / (float)FChunk::CHUNK_SIZE;
+		if (!IsResident(Vector3i{ (int32_t)std::floor(Position.x), (int32_t)std::floor(Position.y), (int32_t)std::floor(Position.z) }))
+			mLeaving.push_back(&GameObject);
+	}
+
+	// Despawning may bind or unbind objects, so it waits until the bound objects are walked
+	for (Atlas::FGameObject* GameObject : mLeaving)
+	{
+		ParkedEntity Parked;
+		Parked.Type = mBound[GameObject];
+		Parked.Saved = Capture(*GameObject);
+		mBound.erase(GameObject);
+
+		const Vector3f Position = Parked.Saved.Position / (float)FChunk::CHUNK_SIZE;
+		const Vector3i ChunkPosition{ (int32_t)std::floor(Position.x), (int32_t)std::floor(Position.y), (int32_t)std::floor(Position.z) };
+		if (IsInWorld(ChunkPosition))
+			mParked[ChunkPosition].push_back(Parked);
+
+		mTypes[Parked.Type].Despawn(*GameObject);
+	}
+}
+
+void FChunkEntities::Resume(const Vector3i& ChunkPosition)
+{
+	auto Found = mParked.find(ChunkPosition);
+	if (Found == mParked.end())
+		return;
+
+	std::vector<ParkedEntity> Parked;
+	Parked.swap(Found->second);
+	mParked.erase(Found);
+
+	std::vector<ParkedEntity> Waiting;
+	for (const ParkedEntity& Entity : Parked)
+	{
+		const EntityType& Type = mTypes[Entity.Type];
+		Atlas::FGameObject* GameObject = Type.Spawn ? Type.Spawn(Entity.Saved) : nullptr;
+		if (GameObject)
+			mBound[GameObject] = Entity.Type;
+		else
+			Waiting.push_back(Entity);
+	}
+
+	if (!Waiting.empty())
+		mParked[ChunkPosition].swap(Waiting);
+}
+
+uint32_t FChunkEntities::GetParkedCount() const
+{
+	uint32_t Count = 0;
+	for (const auto& Chunk : mParked)
+		Count += Chunk.second.size();
+	return Count;
+}
+
+uint32_t FChunkEntities::FindType(const std::string& Name)
+{
+	auto Found = mTypeIndices.find(Name);
+	if (Found != mTypeIndices.end())
+		return Found->second;
+
+	EntityType Type;
+	Type.Name = Name;
+	mTypes.push_back(Type);
+	mTypeIndices[Name] = mTypes.size() - 1;
+	return mTypes.size() - 1;
+}
+
+FChunkEntities::State FChunkEntities::Capture(Atlas::FGameObject& GameObject)
+{
+	State Saved;
+	Saved.Position = GameObject.Transform.GetWorldPosition();
+	Saved.Rotation = GameObject.Transform.GetRotation();
+	Saved.Velocity = Vector3f{};
+	Saved.AngularVelocity = Vector3f{};
+
+	if (GameObject.HasComponent(Atlas::EComponent::RigidBody))
+	{
+		const btRigidBody& Body = GameObject.GetComponent<Atlas::EComponent::RigidBody>().Body;
+		const btVector3& Linear = Body.getLinearVelocity();
+		const btVector3& Angular = Body.getAngularVelocity();
+		Saved.Velocity = Vector3f{ Linear.x(), Linear.y(), Linear.z() };
+		Saved.AngularVelocity = Vector3f{ Angular.x(), Angular.y(), Angular.z() };
+	}
+
+	return Saved;
+}
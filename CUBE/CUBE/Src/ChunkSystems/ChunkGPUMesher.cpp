@@ -0,0 +1,212 @@
+#include "ChunkSystems\ChunkGPUMesher.h"
+#include "Debugging\CPUProfiler.h"
+#include "Misc\Assertions.h"
+
+namespace
+{
+	// Work group size of ChunkMeshing.comp, and the groups needed to cover a section
+	const uint32_t MESHING_GROUP_SIZE = 256;
+	const uint32_t GROUPS_PER_SECTION = FChunk::SECTION_SIZE * FChunk::SECTION_SIZE * FChunk::SECTION_SIZE / MESHING_GROUP_SIZE;
+
+	// Shader storage bindings of ChunkMeshing.comp
+	const GLuint INPUT_BINDING = 0;
+	const GLuint COUNT_BINDING = 1;
+	const GLuint QUAD_BINDING = 2;
+
+	// A quad count for each face direction of each section
+	const uint32_t RANGES_PER_CHUNK = FChunkMesh::SECTION_COUNT * 6;
+
+	// Every other layer of a section's blocks facing air gives the most faces in one direction
+	const uint32_t MAX_SECTION_QUADS = FChunk::SECTION_SIZE * FChunk::SECTION_SIZE * FChunk::SECTION_SIZE / 2;
+
+	const GLsizeiptr INPUT_BUFFER_SIZE = sizeof(FChunkGPUMesher::ChunkInput) * FChunkGPUMesher::BATCH_SIZE;
+	const GLsizeiptr COUNT_BUFFER_SIZE = sizeof(uint32_t) * RANGES_PER_CHUNK * FChunkGPUMesher::BATCH_SIZE;
+	const GLsizeiptr QUAD_BUFFER_SIZE = sizeof(FChunkMesh::Quad) * MAX_SECTION_QUADS * RANGES_PER_CHUNK * FChunkGPUMesher::BATCH_SIZE;
+
+	static_assert(!FChunkGPUMesher::IS_SUPPORTED || sizeof(FChunkGPUMesher::ChunkInput) == sizeof(uint32_t) * (1 + FChunk::BLOCKS_PER_CHUNK / 2 + 6 * FChunk::CHUNK_SIZE + 6 * FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE / 4),
+		"Chunk inputs must match the layout of ChunkMeshing.comp.");
+}
+
+FChunkGPUMesher::FChunkGPUMesher()
+	: mMeshingProgram()
+	, mBatches()
+	, mNextBatch(0)
+	, mBufferBytes(EMemoryTag::ChunkGeometry)
+{
+	FShader MeshingShader{ L"Shaders/ChunkMeshing.comp", GL_COMPUTE_SHADER };
+	mMeshingProgram.AttachShader(MeshingShader);
+	mMeshingProgram.LinkProgram();
+
+	for (auto& Slot : mBatches)
+	{
+		Slot.Fence = nullptr;
+		Slot.ChunkCount = 0;
+
+		glGenBuffers(1, &Slot.InputBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, Slot.InputBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, INPUT_BUFFER_SIZE, nullptr, GL_DYNAMIC_DRAW);
+
+		glGenBuffers(1, &Slot.CountBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, Slot.CountBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, COUNT_BUFFER_SIZE, nullptr, GL_DYNAMIC_COPY);
+
+		glGenBuffers(1, &Slot.QuadBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, Slot.QuadBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, QUAD_BUFFER_SIZE, nullptr, GL_DYNAMIC_COPY);
+
+		glGenBuffers(1, &Slot.ReadbackBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, Slot.ReadbackBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, COUNT_BUFFER_SIZE, nullptr, GL_STREAM_READ);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	mBufferBytes.Set((INPUT_BUFFER_SIZE + COUNT_BUFFER_SIZE * 2 + QUAD_BUFFER_SIZE) * BATCH_COUNT);
+}
+
+FChunkGPUMesher::~FChunkGPUMesher()
+{
+	DropBatches();
+
+	for (auto& Slot : mBatches)
+	{
+		glDeleteBuffers(1, &Slot.InputBuffer);
+		glDeleteBuffers(1, &Slot.CountBuffer);
+		glDeleteBuffers(1, &Slot.QuadBuffer);
+		glDeleteBuffers(1, &Slot.ReadbackBuffer);
+	}
+}
+
+void FChunkGPUMesher::Dispatch(std::deque<std::unique_ptr<Request>>& Requests)
+{
+	CPU_PROFILE("GPUMeshDispatch");
+
+	// A batch only comes round again once its meshes are completed or dropped
+	while (!Requests.empty() && !mBatches[mNextBatch].Fence)
+	{
+		Batch& Slot = mBatches[mNextBatch];
+		Slot.ChunkCount = 0;
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, Slot.InputBuffer);
+		while (!Requests.empty() && Slot.ChunkCount < BATCH_SIZE)
+		{
+			const Request& Next = *Requests.front();
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(ChunkInput) * Slot.ChunkCount, sizeof(ChunkInput), &Next.Input);
+
+			Slot.Indices[Slot.ChunkCount] = Next.Index;
+			Slot.Serials[Slot.ChunkCount] = Next.Serial;
+			Slot.SectionMasks[Slot.ChunkCount] = Next.Input.SectionMask;
+			Slot.ChunkCount++;
+			Requests.pop_front();
+		}
+
+		// Null data clears the counters to 0
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, Slot.CountBuffer);
+		glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, sizeof(uint32_t) * RANGES_PER_CHUNK * Slot.ChunkCount, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		mMeshingProgram.Use();
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INPUT_BINDING, Slot.InputBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, Slot.CountBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, QUAD_BINDING, Slot.QuadBuffer);
+
+		glDispatchCompute(GROUPS_PER_SECTION * FChunkMesh::SECTION_COUNT, Slot.ChunkCount, 1);
+
+		// Counts and quads are read by buffer copies
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, Slot.CountBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, Slot.ReadbackBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(uint32_t) * RANGES_PER_CHUNK * Slot.ChunkCount);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		Slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		mNextBatch = (mNextBatch + 1) % BATCH_COUNT;
+	}
+}
+
+void FChunkGPUMesher::Complete(FChunkGeometryArena& GeometryArena, const std::vector<uint32_t>& Serials, std::vector<Result>& ResultsOut)
+{
+	CPU_PROFILE("GPUMeshComplete");
+
+	// Batches finish in order, starting from the oldest
+	for (uint32_t i = 0; i < BATCH_COUNT; i++)
+	{
+		Batch& Slot = mBatches[(mNextBatch + i) % BATCH_COUNT];
+		if (!Slot.Fence)
+			continue;
+
+		const GLenum Status = glClientWaitSync(Slot.Fence, 0, 0);
+		if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED)
+			break;
+
+		glDeleteSync(Slot.Fence);
+		Slot.Fence = nullptr;
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, Slot.ReadbackBuffer);
+		const uint32_t* Counts = (const uint32_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, sizeof(uint32_t) * RANGES_PER_CHUNK * Slot.ChunkCount, GL_MAP_READ_BIT);
+
+		for (uint32_t Chunk = 0; Counts && Chunk < Slot.ChunkCount; Chunk++)
+		{
+			// The slot was meshed again or unloaded since the request
+			const uint32_t Index = Slot.Indices[Chunk];
+			if (Index >= Serials.size() || Serials[Index] != Slot.Serials[Chunk])
+				continue;
+
+			ResultsOut.push_back(Result{});
+			Result& Meshed = ResultsOut.back();
+			Meshed.Index = Index;
+			Meshed.SectionMask = Slot.SectionMasks[Chunk];
+
+			for (uint32_t Section = 0; Section < FChunkMesh::SECTION_COUNT; Section++)
+			{
+				if (!(Meshed.SectionMask & (1 << Section)))
+					continue;
+
+				// Each face direction becomes one range of the section, in NormalID order
+				const uint32_t FirstRange = (Chunk * FChunkMesh::SECTION_COUNT + Section) * 6;
+				uint32_t QuadCount = 0;
+				for (uint32_t Side = 0; Side < 6; Side++)
+				{
+					ASSERT(Counts[FirstRange + Side] <= MAX_SECTION_QUADS);
+
+					Meshed.Ranges[Section][Side] = FChunkMesh::FaceRange{ QuadCount, Counts[FirstRange + Side] };
+					QuadCount += Counts[FirstRange + Side];
+				}
+
+				Meshed.Allocations[Section] = FChunkGeometryArena::Allocation{ 0, 0 };
+				if (QuadCount == 0)
+					continue;
+
+				Meshed.Allocations[Section] = GeometryArena.Allocate(QuadCount);
+				for (uint32_t Side = 0; Side < 6; Side++)
+				{
+					const FChunkMesh::FaceRange& Range = Meshed.Ranges[Section][Side];
+					if (Range.QuadCount > 0)
+					{
+						const GLintptr SourceOffset = sizeof(FChunkMesh::Quad) * MAX_SECTION_QUADS * (FirstRange + Side);
+						GeometryArena.Copy(Meshed.Allocations[Section], Range.FirstQuad, Slot.QuadBuffer, SourceOffset, Range.QuadCount);
+					}
+				}
+			}
+		}
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, Slot.ReadbackBuffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+}
+
+void FChunkGPUMesher::DropBatches()
+{
+	for (auto& Slot : mBatches)
+	{
+		if (Slot.Fence)
+			glDeleteSync(Slot.Fence);
+
+		Slot.Fence = nullptr;
+		Slot.ChunkCount = 0;
+	}
+}
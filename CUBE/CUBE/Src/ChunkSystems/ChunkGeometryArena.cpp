@@ -0,0 +1,371 @@
+#include "ChunkSystems\ChunkGeometryArena.h"
+#include "ChunkSystems\ChunkMesh.h"
+#include "Rendering\GLBindings.h"
+#include "Rendering\GLState.h"
+#include "Rendering\UploadRing.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Allocations are rounded to this many quads, then up to a size class
+	const uint32_t ALLOCATION_GRANULARITY = 64;
+
+	// Size classes for each power of two of granules are 2^SIZE_CLASS_BITS, so a class wastes at most an eighth
+	const uint32_t SIZE_CLASS_BITS = 3;
+
+	// Buffer binding point used by the arena vertex array
+	const GLuint ORIGIN_BINDING = 1;
+
+	// Quad storage block of ChunkQuad.glsl
+	const GLuint QUAD_BINDING = 10;
+
+	/**
+	* The quads reserved for an allocation, rounded up to its size class.
+	*/
+	uint32_t GetSizeClassCount(const uint32_t QuadCount)
+	{
+		uint32_t Granules = (QuadCount + ALLOCATION_GRANULARITY - 1) / ALLOCATION_GRANULARITY;
+
+		// Small counts are their own class, larger ones keep their highest bits
+		if (Granules >= (1u << (SIZE_CLASS_BITS + 1)))
+		{
+			uint32_t HighestBit = 0;
+			for (uint32_t Value = Granules; Value > 1; Value >>= 1)
+				HighestBit++;
+
+			const uint32_t Shift = HighestBit - SIZE_CLASS_BITS;
+			Granules = ((Granules + (1u << Shift) - 1) >> Shift) << Shift;
+		}
+
+		return Granules * ALLOCATION_GRANULARITY;
+	}
+}
+
+FChunkGeometryArena::FChunkGeometryArena(const uint32_t QuadCapacity)
+	: mFreeRanges()
+	, mFreeSizes()
+	, mLiveRanges()
+	, mBlocks()
+	, mFreeIDs()
+	, mVertexArray(0)
+	, mQuadBuffer(0)
+	, mInitialCapacity(QuadCapacity)
+	, mCapacity(QuadCapacity)
+	, mUsedCount(0)
+	, mBytesMoved(0)
+	, mIsCompacting(false)
+	, mBufferBytes(EMemoryTag::ChunkGeometry)
+{
+	ASSERT(QuadCapacity > 0);
+
+	AddFreeRange(0, mCapacity);
+
+	glGenBuffers(1, &mQuadBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mQuadBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(FChunkMesh::Quad) * mCapacity, nullptr, FChunkMesh::BufferUsageMode);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Corners are expanded from the quad buffer, so only the origins are attributes
+	glGenVertexArrays(1, &mVertexArray);
+
+	SGLState::BindVertexArray(mVertexArray);
+		glVertexAttribFormat(GLAttributePosition::ChunkOrigin, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexAttribBinding(GLAttributePosition::ChunkOrigin, ORIGIN_BINDING);
+		glVertexBindingDivisor(ORIGIN_BINDING, 1);
+		glEnableVertexAttribArray(GLAttributePosition::ChunkOrigin);
+	SGLState::BindVertexArray(0);
+
+	mBufferBytes.Set(sizeof(FChunkMesh::Quad) * mCapacity);
+}
+
+FChunkGeometryArena::~FChunkGeometryArena()
+{
+	glDeleteVertexArrays(1, &mVertexArray);
+	glDeleteBuffers(1, &mQuadBuffer);
+}
+
+FChunkGeometryArena::Allocation FChunkGeometryArena::Allocate(const uint32_t QuadCount)
+{
+	ASSERT(QuadCount > 0);
+
+	const uint32_t Count = GetSizeClassCount(QuadCount);
+
+	// Smallest fit, the nearest to the front of equally sized ranges
+	auto Fit = mFreeSizes.lower_bound(std::make_pair(Count, 0u));
+	if (Fit == mFreeSizes.end())
+	{
+		Grow(mCapacity + Count);
+
+		// Growing extends the range at the end of the buffer
+		Fit = mFreeSizes.lower_bound(std::make_pair(Count, 0u));
+		ASSERT(Fit != mFreeSizes.end());
+	}
+
+	const uint32_t Offset = Fit->second;
+	TakeFreeRange(mFreeRanges.find(Offset), Offset, Count);
+
+	uint32_t ID;
+	if (mFreeIDs.empty())
+	{
+		ID = mBlocks.size();
+		mBlocks.push_back(Block{ Offset, Count });
+	}
+	else
+	{
+		ID = mFreeIDs.back();
+		mFreeIDs.pop_back();
+		mBlocks[ID] = Block{ Offset, Count };
+	}
+
+	mLiveRanges[Offset] = ID;
+	mUsedCount += Count;
+	return Allocation{ ID, Count };
+}
+
+void FChunkGeometryArena::Free(const Allocation& Range)
+{
+	if (Range.Count == 0)
+		return;
+
+	const Block Freed = mBlocks[Range.ID];
+	ASSERT(Freed.Offset + Freed.Count <= mCapacity);
+	mUsedCount -= Freed.Count;
+
+	mLiveRanges.erase(Freed.Offset);
+	mFreeIDs.push_back(Range.ID);
+	AddFreeRange(Freed.Offset, Freed.Count);
+}
+
+void FChunkGeometryArena::Upload(const Allocation& Range, const void* Data, const GLsizeiptr DataSize, FUploadRing& UploadRing)
+{
+	ASSERT(DataSize <= (GLsizeiptr)(sizeof(FChunkMesh::Quad) * Range.Count));
+
+	const GLintptr DestinationOffset = sizeof(FChunkMesh::Quad) * mBlocks[Range.ID].Offset;
+
+	GLintptr StagedOffset;
+	if (UploadRing.Stage(Data, DataSize, StagedOffset))
+	{
+		UploadRing.CopyTo(StagedOffset, DataSize, mQuadBuffer, DestinationOffset);
+	}
+	else
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, mQuadBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, DestinationOffset, DataSize, Data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+void FChunkGeometryArena::Copy(const Allocation& Range, const uint32_t FirstQuad, const GLuint SourceBuffer, const GLintptr SourceOffset, const uint32_t QuadCount)
+{
+	ASSERT(FirstQuad + QuadCount <= Range.Count);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, SourceBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, mQuadBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, SourceOffset, sizeof(FChunkMesh::Quad) * (mBlocks[Range.ID].Offset + FirstQuad), sizeof(FChunkMesh::Quad) * QuadCount);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void FChunkGeometryArena::Bind() const
+{
+	SGLState::BindVertexArray(mVertexArray);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, QUAD_BINDING, mQuadBuffer);
+}
+
+void FChunkGeometryArena::SetDrawOrigins(const GLuint OriginBuffer) const
+{
+	glBindVertexBuffer(ORIGIN_BINDING, OriginBuffer, 0, sizeof(Vector3f));
+}
+
+uint32_t FChunkGeometryArena::Compact(const uint32_t MaxBytes)
+{
+	// Starts once a quarter of the space below the high water mark is free
+	if (!mIsCompacting && (GetHighWater() - mUsedCount) * 4 > GetHighWater())
+		mIsCompacting = true;
+
+	uint32_t BytesMoved = 0;
+	bool IsBound = false;
+	while (mIsCompacting)
+	{
+		// Stops once a tenth is
+		const uint32_t HighWater = GetHighWater();
+		if ((HighWater - mUsedCount) * 10 <= HighWater)
+		{
+			mIsCompacting = false;
+			break;
+		}
+
+		const auto Last = std::prev(mLiveRanges.end());
+		const uint32_t ID = Last->second;
+		const Block Moved = mBlocks[ID];
+		const uint32_t Bytes = sizeof(FChunkMesh::Quad) * Moved.Count;
+		if (BytesMoved > 0 && BytesMoved + Bytes > MaxBytes)
+			break;
+
+		// The free range nearest the front that fits, only ranges before the allocation are free below it
+		auto Destination = std::find_if(mFreeRanges.begin(), mFreeRanges.end(),
+			[&Moved](const std::pair<const uint32_t, uint32_t>& Range){ return Range.second >= Moved.Count; });
+		if (Destination == mFreeRanges.end() || Destination->first > Moved.Offset)
+		{
+			mIsCompacting = false;
+			break;
+		}
+
+		// Ranges are disjoint, so the copy stays within one buffer
+		if (!IsBound)
+		{
+			glBindBuffer(GL_COPY_READ_BUFFER, mQuadBuffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, mQuadBuffer);
+			IsBound = true;
+		}
+
+		const uint32_t NewOffset = Destination->first;
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sizeof(FChunkMesh::Quad) * Moved.Offset, sizeof(FChunkMesh::Quad) * NewOffset, Bytes);
+
+		// Draws built after this read the new range, earlier ones were issued before the copy
+		TakeFreeRange(Destination, NewOffset, Moved.Count);
+		mLiveRanges.erase(Last);
+		mLiveRanges[NewOffset] = ID;
+		mBlocks[ID].Offset = NewOffset;
+		AddFreeRange(Moved.Offset, Moved.Count);
+
+		BytesMoved += Bytes;
+	}
+
+	if (IsBound)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	mBytesMoved += BytesMoved;
+
+	// Shrinks once less than half is used, leaving room to grow into
+	const uint32_t HighWater = GetHighWater();
+	if (!mIsCompacting && mCapacity > mInitialCapacity && HighWater < mCapacity / 2)
+	{
+		const uint32_t NewCapacity = std::max(mInitialCapacity, HighWater + HighWater / 2);
+
+		// The free range at the end is cut to the new capacity
+		const auto End = std::prev(mFreeRanges.end());
+		ASSERT(End->first == HighWater);
+		mFreeSizes.erase(std::make_pair(End->second, End->first));
+		mFreeRanges.erase(End);
+
+		Resize(NewCapacity);
+		if (NewCapacity > HighWater)
+			AddFreeRange(HighWater, NewCapacity - HighWater);
+	}
+
+	return BytesMoved;
+}
+
+FChunkGeometryArena::Stats FChunkGeometryArena::GetStats() const
+{
+	const uint32_t HighWater = GetHighWater();
+
+	Stats Result;
+	Result.Capacity = mCapacity;
+	Result.UsedCount = mUsedCount;
+	Result.AllocationCount = mLiveRanges.size();
+	Result.FreeRangeCount = mFreeRanges.size();
+	Result.LargestFreeRange = mFreeSizes.empty() ? 0 : mFreeSizes.rbegin()->first;
+	Result.HighWater = HighWater;
+	Result.Utilization = (float)mUsedCount / (float)mCapacity;
+	Result.Fragmentation = HighWater > 0 ? (float)(HighWater - mUsedCount) / (float)HighWater : 0.0f;
+	Result.BytesMoved = mBytesMoved;
+	return Result;
+}
+
+void FChunkGeometryArena::Grow(const uint32_t MinCapacity)
+{
+	// Grown by half, compaction and shrinking keep the buffer near what is used
+	const uint32_t OldCapacity = mCapacity;
+	Resize(std::max(MinCapacity, mCapacity + mCapacity / 2));
+	AddFreeRange(OldCapacity, mCapacity - OldCapacity);
+}
+
+void FChunkGeometryArena::Resize(const uint32_t NewCapacity)
+{
+	ASSERT(NewCapacity >= GetHighWater());
+
+	GLuint NewBuffer;
+	glGenBuffers(1, &NewBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, NewBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(FChunkMesh::Quad) * NewCapacity, nullptr, FChunkMesh::BufferUsageMode);
+
+	const uint32_t KeptCount = std::min(mCapacity, NewCapacity);
+	glBindBuffer(GL_COPY_READ_BUFFER, mQuadBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(FChunkMesh::Quad) * KeptCount);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &mQuadBuffer);
+	mQuadBuffer = NewBuffer;
+
+	mCapacity = NewCapacity;
+	mBufferBytes.Set(sizeof(FChunkMesh::Quad) * mCapacity);
+}
+
+void FChunkGeometryArena::AddFreeRange(uint32_t Offset, uint32_t Count)
+{
+	// Merge with the following range
+	auto Next = mFreeRanges.lower_bound(Offset);
+	if (Next != mFreeRanges.end() && Offset + Count == Next->first)
+	{
+		Count += Next->second;
+		mFreeSizes.erase(std::make_pair(Next->second, Next->first));
+		Next = mFreeRanges.erase(Next);
+	}
+
+	// Merge with the preceding range
+	if (Next != mFreeRanges.begin())
+	{
+		auto Previous = std::prev(Next);
+		if (Previous->first + Previous->second == Offset)
+		{
+			Offset = Previous->first;
+			Count += Previous->second;
+			mFreeSizes.erase(std::make_pair(Previous->second, Previous->first));
+			mFreeRanges.erase(Previous);
+		}
+	}
+
+	mFreeRanges[Offset] = Count;
+	mFreeSizes.insert(std::make_pair(Count, Offset));
+}
+
+void FChunkGeometryArena::TakeFreeRange(std::map<uint32_t, uint32_t>::iterator FreeRange, const uint32_t Offset, const uint32_t Count)
+{
+	const uint32_t FreeOffset = FreeRange->first;
+	const uint32_t FreeEnd = FreeRange->first + FreeRange->second;
+	ASSERT(Offset >= FreeOffset && Offset + Count <= FreeEnd);
+
+	mFreeSizes.erase(std::make_pair(FreeRange->second, FreeRange->first));
+	mFreeRanges.erase(FreeRange);
+
+	// What is left on either side borders allocations, so nothing merges
+	if (Offset > FreeOffset)
+	{
+		mFreeRanges[FreeOffset] = Offset - FreeOffset;
+		mFreeSizes.insert(std::make_pair(Offset - FreeOffset, FreeOffset));
+	}
+	if (Offset + Count < FreeEnd)
+	{
+		mFreeRanges[Offset + Count] = FreeEnd - Offset - Count;
+		mFreeSizes.insert(std::make_pair(FreeEnd - Offset - Count, Offset + Count));
+	}
+}
+
+uint32_t FChunkGeometryArena::GetHighWater() const
+{
+	if (mLiveRanges.empty())
+		return 0;
+
+	const auto Last = std::prev(mLiveRanges.end());
+	return Last->first + mBlocks[Last->second].Count;
+}
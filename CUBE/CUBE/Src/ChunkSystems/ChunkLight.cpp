@@ -0,0 +1,66 @@
+#include "ChunkSystems\ChunkLight.h"
+
+#include <algorithm>
+#include <cstring>
+
+FChunkLight::FChunkLight(const uint32_t BlockCount, const uint8_t Levels)
+	: mLevels()
+	, mBlockCount(BlockCount)
+	, mUniformLevels(Levels)
+{
+}
+
+void FChunkLight::Set(const uint32_t Index, const uint8_t Levels)
+{
+	ASSERT(Index < mBlockCount);
+
+	if (!mLevels)
+	{
+		// Setting a uniform block to its own level changes nothing
+		if (Levels == mUniformLevels)
+			return;
+
+		mLevels.reset(new uint8_t[mBlockCount]);
+		std::fill_n(mLevels.get(), mBlockCount, mUniformLevels);
+	}
+
+	mLevels[Index] = Levels;
+}
+
+void FChunkLight::Fill(const uint8_t Levels)
+{
+	mLevels.reset();
+	mUniformLevels = Levels;
+}
+
+void FChunkLight::Pack(const uint8_t* Levels)
+{
+	const bool IsUniform = std::all_of(Levels + 1, Levels + mBlockCount, [Levels](const uint8_t Level) { return Level == Levels[0]; });
+
+	if (IsUniform)
+	{
+		Fill(Levels[0]);
+		return;
+	}
+
+	if (!mLevels)
+		mLevels.reset(new uint8_t[mBlockCount]);
+
+	std::memcpy(mLevels.get(), Levels, mBlockCount);
+}
+
+void FChunkLight::Unpack(uint8_t* LevelsOut) const
+{
+	if (mLevels)
+		std::memcpy(LevelsOut, mLevels.get(), mBlockCount);
+	else
+		std::memset(LevelsOut, mUniformLevels, mBlockCount);
+}
+
+void FChunkLight::Swap(FChunkLight& Other)
+{
+	ASSERT(mBlockCount == Other.mBlockCount);
+
+	mLevels.swap(Other.mLevels);
+	std::swap(mUniformLevels, Other.mUniformLevels);
+}
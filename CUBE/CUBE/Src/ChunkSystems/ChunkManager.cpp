@@ -1,6 +1,8 @@
 #include "ChunkSystems\ChunkManager.h"
+#include "ChunkSystems\BlockCursor.h"
 #include "Input\ButtonEvent.h"
 #include "Debugging\ConsoleOutput.h"
+#include "Debugging\Log.h"
 #include "Rendering\GLUtils.h"
 #include "ResourceHolder.h"
 #include "Rendering\Camera.h"
@@ -9,486 +11,3646 @@
 #include "SFML\Window\Context.hpp"
 #include "STime.h"
 #include "GL\glew.h"
+#include "FileIO\ChunkCodec.h"
+#include "ChunkSystems\WorldGenerator.h"
+#include "Physics\PhysicsSystem.h"
+#include "Misc\RadixSort.h"
+#include "Memory\FrameAllocator.h"
+#include "Debugging\CPUProfiler.h"
 #include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
 
 static const uint32_t DEFAULT_VIEW_DISTANCE = 14;
-static const uint32_t MESH_SWAPS_PER_FRAME = 25;
-static const int32_t CHUNKS_TO_LOAD_PER_ITERATION = 8;
+static const uint32_t DEFAULT_VERTICAL_VIEW_DISTANCE = DEFAULT_VIEW_DISTANCE / 2;
 
-// Height is half width
-static const uint32_t DEFAULT_CHUNK_SIZE = (2 * DEFAULT_VIEW_DISTANCE + 1) * (DEFAULT_VIEW_DISTANCE + 1) * (2 * DEFAULT_VIEW_DISTANCE + 1);
+// Chunks past the view distance by up to this many chunks aren't evicted, so
+// a camera crossing back and forth over a chunk border doesn't reload a face of chunks
+static const uint32_t DEFAULT_EVICTION_MARGIN = 1;
 
-FChunkManager::FChunkManager()
-	: mFileSystem()
+// Chunks loaded again within this many seconds of being evicted count as thrash
+static const float THRASH_SECONDS = 5.0f;
+
+// Chunk coordinate marking chunk positions that are not set. Chunk
+// coordinates are signed, so it is far outside any reachable world.
+static const int32_t INVALID_CHUNK_COORDINATE = INT32_MIN;
+static const Vector3i INVALID_CHUNK_POSITION{ INVALID_CHUNK_COORDINATE, INVALID_CHUNK_COORDINATE, INVALID_CHUNK_COORDINATE };
+static const uint32_t MESH_SWAP_BYTES_PER_FRAME = 2 * 1024 * 1024;
+static const float MESH_SWAP_MS_PER_FRAME = 2.0f;
+
+// Mesh bytes of edited chunks swapped each frame, on top of the streaming budget
+static const uint32_t EDIT_SWAP_BYTES_PER_FRAME = 1024 * 1024;
+
+// Workers started on top of the others that only rebuild edited chunks
+static const uint32_t EDIT_WORKER_COUNT = 1;
+
+// Time spent swapping between readiness checks in WarmUp, which has no frame to fit in
+static const float WARMUP_SWAP_MS = 50.0f;
+
+// Milliseconds WarmUp sleeps between readiness checks, while the workers load
+static const uint32_t WARMUP_POLL_MS = 1;
+
+// Seconds WarmUp waits for the spawn area before the first frame is shown anyway
+static const float WARMUP_TIMEOUT_SECONDS = 30.0f;
+
+// Enough staging for the GPU to run a few frames behind
+static const uint32_t UPLOAD_RING_SIZE = 4 * MESH_SWAP_BYTES_PER_FRAME;
+static const uint32_t JOBS_IN_FLIGHT_PER_WORKER = 2;
+
+// Chunk reads issued ahead of the load jobs that decode them, enough for reads of a region to be batched
+static const uint32_t READ_AHEAD_COUNT = 16;
+
+// Initial quad capacity of the chunk geometry arena, 16MB of packed quads
+static const uint32_t GEOMETRY_ARENA_QUADS = 2 * 1024 * 1024;
+static const float JOB_RATE_SAMPLE_TIME = 1.0f;
+
+// Block edits are committed to the journal in groups this often
+static const float JOURNAL_COMMIT_TIME = 0.5f;
+
+// Rate of block ticks, and the most run in one frame to catch up after a long frame
+static const uint32_t BLOCK_TICKS_PER_SECOND = 20;
+static const float BLOCK_TICK_TIME = 1.0f / BLOCK_TICKS_PER_SECOND;
+static const uint32_t MAX_BLOCK_TICKS_PER_FRAME = 4;
+
+// Random ticks per section of each chunk within RANDOM_TICK_DISTANCE chunks of the camera
+static const uint32_t RANDOM_TICKS_PER_SECTION = 3;
+static const int32_t RANDOM_TICK_DISTANCE = 4;
+
+// Fluids step slower than blocks tick, so flows can be seen spreading
+static const float FLUID_TICK_TIME = 0.2f;
+
+// Rigidbodies are only simulated this many chunks around the camera
+static const int32_t PHYSICS_DISTANCE = 4;
+
+// Per thread copy of a chunk's light used while meshing
+static THREAD_LOCAL uint8_t LightScratch[FChunk::BLOCKS_PER_CHUNK];
+
+// Per thread buffer for RLE chunk data moving between chunks and region files
+static THREAD_LOCAL uint8_t ChunkDataScratch[FChunk::MAX_RLE_BYTES];
+
+// Per thread buffer for chunk data as it is encoded on file
+static THREAD_LOCAL uint8_t EncodedDataScratch[FChunk::MAX_RLE_BYTES];
+
+// RLE data of a chunk of air, a single run decodes as a uniform chunk
+static const uint8_t AIR_CHUNK_DATA[] = { FBlock::AIR_BLOCK_ID, 1 };
+
+/**
+* Compresses RLE chunk data into EncodedDataScratch if that makes it smaller.
+* @param DataSize - The size of Data, set to the size of the returned data.
+* @param CodecOut - To put the codec of the returned data.
+* @return The data to write to file.
+*/
+static const uint8_t* EncodeChunkData(const uint8_t* Data, uint32_t& DataSize, uint8_t& CodecOut)
+{
+	const uint32_t CompressedSize = DataSize > 1 ? FChunkCodec::Compress(Data, DataSize, EncodedDataScratch, DataSize - 1) : 0;
+
+	if (CompressedSize == 0)
+	{
+		CodecOut = FChunkCodec::Raw;
+		return Data;
+	}
+
+	DataSize = CompressedSize;
+	CodecOut = FChunkCodec::LZ;
+	return EncodedDataScratch;
+}
+
+// Chunk distance that each mesh detail level starts at
+static const uint32_t DEFAULT_LOD_DISTANCES[FChunk::LOD_LEVELS] = { 0, 6, 10, 16 };
+
+// Chunk offsets to the neighbor across each face, ordered by FChunk::NormalID
+static const Vector3i FACE_OFFSETS[6] =
+{
+	Vector3i{ 1, 0, 0 },
+	Vector3i{ -1, 0, 0 },
+	Vector3i{ 0, 1, 0 },
+	Vector3i{ 0, -1, 0 },
+	Vector3i{ 0, 0, 1 },
+	Vector3i{ 0, 0, -1 }
+};
+
+// Most chunks read ahead by prefetches and held until loaded, and prefetches queued for each prediction
+static const uint32_t MAX_PREFETCHED_CHUNKS = 2048;
+static const uint32_t MAX_PREFETCH_REQUESTS = 512;
+static const float DEFAULT_PREFETCH_LOOKAHEAD = 1.0f;
+
+// Weight of each frame's camera velocity in the smoothed velocity
+static const float VELOCITY_SMOOTHING = 0.2f;
+
+// Chunk distance removed from the load priority of chunks within the view frustum
+static const float FRUSTUM_PRIORITY_BONUS = 8.0f;
+
+/**
+* Faces of its chunk that a block borders, as bits ordered by FChunk::NormalID.
+*/
+static uint32_t BorderFaces(const Vector3i& LocalPosition)
+{
+	uint32_t FaceMask = 0;
+	for (uint32_t Axis = 0; Axis < 3; Axis++)
+	{
+		// Positive faces have even ids
+		if (LocalPosition[Axis] == FChunk::CHUNK_SIZE - 1)
+			FaceMask |= 1 << (2 * Axis);
+		else if (LocalPosition[Axis] == 0)
+			FaceMask |= 1 << (2 * Axis + 1);
+	}
+
+	return FaceMask;
+}
+
+/**
+* Amanatides-Woo traversal of a grid of cubic cells along a ray.
+*/
+struct GridWalk
+{
+	/**
+	* Starts the walk at the cell holding a point on the ray.
+	* @param T - The distance along the ray of the point.
+	* @param MinCell, MaxCell - Bounds the starting cell is clamped to, for points on a boundary.
+	* @param EntryAxis - The axis of the face the ray entered the cell through, or -1.
+	*/
+	void Start(const Vector3f& Origin, const Vector3f& Direction, const float CellSize, const float T,
+		const Vector3i& MinCell, const Vector3i& MaxCell, const int32_t EntryAxis)
+	{
+		for (uint32_t Axis = 0; Axis < 3; Axis++)
+		{
+			int32_t StartCell = (int32_t)std::floor((Origin[Axis] + Direction[Axis] * T) / CellSize);
+			StartCell = (StartCell < MinCell[Axis]) ? MinCell[Axis] : (StartCell > MaxCell[Axis]) ? MaxCell[Axis] : StartCell;
+			Cell[Axis] = StartCell;
+
+			// Boundary distances are taken from the origin, so walks started mid-ray don't drift
+			if (Direction[Axis] > 0.0f)
+			{
+				Step[Axis] = 1;
+				TMax[Axis] = ((StartCell + 1) * CellSize - Origin[Axis]) / Direction[Axis];
+				TDelta[Axis] = CellSize / Direction[Axis];
+			}
+			else if (Direction[Axis] < 0.0f)
+			{
+				Step[Axis] = -1;
+				TMax[Axis] = (StartCell * CellSize - Origin[Axis]) / Direction[Axis];
+				TDelta[Axis] = -CellSize / Direction[Axis];
+			}
+			else
+			{
+				Step[Axis] = 0;
+				TMax[Axis] = FLT_MAX;
+				TDelta[Axis] = FLT_MAX;
+			}
+		}
+
+		Axis = EntryAxis;
+	}
+
+	/**
+	* The distance along the ray where it leaves the current cell.
+	*/
+	float ExitDistance() const
+	{
+		// The min macro from Windows.h is only undefined further down
+		const float MinXY = (TMax[0] < TMax[1]) ? TMax[0] : TMax[1];
+		return (MinXY < TMax[2]) ? MinXY : TMax[2];
+	}
+
+	/**
+	* Steps into the next cell along the ray.
+	* @return The distance along the ray where the cell is entered.
+	*/
+	float Advance()
+	{
+		Axis = (TMax[0] < TMax[1]) ? ((TMax[0] < TMax[2]) ? 0 : 2) : ((TMax[1] < TMax[2]) ? 1 : 2);
+
+		const float T = TMax[Axis];
+		Cell[Axis] += Step[Axis];
+		TMax[Axis] += TDelta[Axis];
+		return T;
+	}
+
+	/**
+	* The normal of the face the current cell was entered through.
+	*/
+	Vector3i EntryNormal() const
+	{
+		Vector3i Normal;
+		if (Axis != -1)
+			Normal[Axis] = -Step[Axis];
+
+		return Normal;
+	}
+
+	Vector3i Cell;
+	Vector3i Step;
+	Vector3f TMax;   // Distance along the ray to the next boundary on each axis
+	Vector3f TDelta; // Distance along the ray between boundaries on each axis
+	int32_t  Axis;   // Axis of the last step, -1 before the first
+};
+
+FChunkManager::FChunkManager(const bool IsHeadless)
+	: mGeometryArena(IsHeadless ? nullptr : new FChunkGeometryArena(GEOMETRY_ARENA_QUADS))
+	, mMeshPool(__alignof(FChunkMesh))
+	, mFileSystem()
+	, mJournal()
+	, mColumnHeights()
+	, mBlockTicks()
+	, mEntities()
+	, mFluids()
+	, mMeshCache()
+	, mReplayEdits()
 	, mChunks(nullptr)
 	, mChunkPositions()
 	, mRenderList()
+	, mCasterList()
+	, mConnectedList()
+	, mChunkGroups()
+	, mHasGroupMesh()
+	, mVisibilitySteps()
+	, mIsVisibilityVisited()
+	, mDrawList(IsHeadless ? nullptr : new FChunkDrawList)
+	, mChunkCuller(IsHeadless ? nullptr : new FChunkCuller)
+	, mGPUMesher((IsHeadless || !FChunkGPUMesher::IS_SUPPORTED) ? nullptr : new FChunkGPUMesher)
+	, mFarTerrain(IsHeadless ? nullptr : new FFarTerrain)
+	, mBlockVolume((IsHeadless || !FBlockVolume::IS_SUPPORTED) ? nullptr : new FBlockVolume)
+	, mBlockVolumeUploads()
+	, mGPUMeshRequests()
+	, mGPUMeshResults()
+	, mMeshSerials()
+	, mGPUMeshSections()
+	, mDeferredSwaps()
+	, mUploader(IsHeadless ? nullptr : new FChunkUploader())
+	, mCompletedUploads()
+	, mIsUploadPending()
+	, mCasterCenters()
+	, mCasterVisibility()
 	, mLoadList()
+	, mLoadListPositions()
 	, mRebuildList()
+	, mIsRebuildQueued()
+	, mIsEditRebuildQueued()
 	, mBufferSwapQueue()
+	, mEditSwapQueue()
+	, mIsEditSwapQueued()
+	, mSwapPositions()
+	, mSwapQueueTimes()
+	, mLoadListDepth()
+	, mReadBatch()
+	, mPendingChunkReads(0)
 	, mLoaderThread()
+	, mSaveThread()
+	, mSaveRequests()
+	, mUploadRing(IsHeadless ? nullptr : new FUploadRing(UPLOAD_RING_SIZE))
+	, mWorkerPool()
+	, mIOQueue()
+	, mLightPropagator([this](const Vector3i& ChunkPosition) -> FChunk*
+	{
+		const int32_t Index = FindLoadedChunk(ChunkPosition);
+		return (Index != -1) ? &mChunks[Index] : nullptr;
+	})
+	, mLightLoads()
+	, mPrefetchedChunks()
+	, mEvictionTimes()
 	, mRebuildListMutex()
+	, mLightMutex()
 	, mBufferSwapMutex()
+	, mFileSystemMutex()
+	, mCameraMutex()
+	, mGPUMeshMutex()
 	, mNeedsToRefreshVisibleList()
+	, mNeedsToPrefetch()
 	, mMustShutdown()
+	, mIsSaving()
+	, mWorkerCount(1)
+	, mUsesMeshCache(false)
+	, mUsesGPUMeshing(false)
+	, mUsesBackgroundUploads(true)
+	, mUsesFarTerrain(true)
+	, mUsesBlockVolume(false)
+	, mUsesConnectivityCulling(true)
+	, mIsHeadless(IsHeadless)
+	, mSwapDeadline(0)
+	, mSwapByteBudget(MESH_SWAP_BYTES_PER_FRAME)
+	, mSwapTimeBudget(MESH_SWAP_MS_PER_FRAME)
+	, mJournalCommitTimer(0.0f)
+	, mTickHandlers(256)
+	, mPlacedTickDelays(256, 0)
+	, mRandomTickHandlers(256)
+	, mRandomTickTypes()
+	, mDueTicks()
+	, mTickedBlocks()
+	, mTickEdits()
+	, mTickRandom()
+	, mBlockTickTimer(0.0f)
+	, mFluidChanges()
+	, mAppliedFluids()
+	, mFluidEdits()
+	, mActiveFluids()
+	, mFluidMutex()
+	, mPendingFluidJobs()
+	, mFluidTickTimer(0.0f)
+	, mQueuedChanges()
+	, mDispatchedChanges()
+	, mBlockEventMutex()
+	, mIsBufferingBlockEvents(false)
+	, mLastCompletedJobCount(0)
+	, mJobRateTimer(0.0f)
+	, mJobsPerSecond(0.0f)
+	, mPipelineStats()
+	, mStartupTimings()
+	, mLoadWorldTime(0)
+	, mIsFirstFrameDone(true)
+	, mLoadFrustum()
 	, mLastCameraChunk()
+	, mScannedCameraChunk()
+	, mPrefetchChunk()
+	, mLastCameraPosition()
+	, mCameraVelocity()
+	, mHasCameraPosition(false)
+	, mPrefetchLookahead(DEFAULT_PREFETCH_LOOKAHEAD)
+	, mNeedsFullVisibleScan(true)
 	, mWorldSize(0)
 	, mViewDistance(DEFAULT_VIEW_DISTANCE)
+	, mVerticalViewDistance(DEFAULT_VERTICAL_VIEW_DISTANCE)
+	, mEvictionMargin(DEFAULT_EVICTION_MARGIN)
+	, mHorizontalSlotBits(FMath::CeilLog2(2 * (DEFAULT_VIEW_DISTANCE + DEFAULT_EVICTION_MARGIN) + 1))
+	, mVerticalSlotBits(FMath::CeilLog2(2 * (DEFAULT_VERTICAL_VIEW_DISTANCE + DEFAULT_EVICTION_MARGIN) + 1))
+	, mLODDistances()
 	, mPhysicsSystem(nullptr)
+	, mTerrainShape(*this)
+	, mTerrainObject()
+	, mHasTerrainCollision(true)
+	, mWorldGenerator(nullptr)
+	, mCamera(nullptr)
 	, mOnBlockDestroy()
 	, mOnBlockSet()
 {
-	mChunks = new FChunk[DEFAULT_CHUNK_SIZE];
-	mChunkPositions = new Vector4i[DEFAULT_CHUNK_SIZE];
+	mMeshPool.SetMaxSize(ChunkCount());
+	mChunks = new FChunk[ChunkCount()];
+	for (uint32_t i = 0; i < ChunkCount(); i++)
+		mChunks[i].SetMeshPool(mMeshPool);
+	mChunkPositions = new Vector4i[ChunkCount()];
+	mResidentTable = NewResidentTable(mChunks);
 	mNeedsToRefreshVisibleList = false;
 	mMustShutdown = false;
+	mIsSaving = false;
+	mPendingFluidJobs = 0;
+	std::copy(std::begin(DEFAULT_LOD_DISTANCES), std::end(DEFAULT_LOD_DISTANCES), mLODDistances);
+
+	// Leave a hardware thread for the main thread
+	const uint32_t HardwareThreads = std::thread::hardware_concurrency();
+	if (HardwareThreads > 1)
+		mWorkerCount = HardwareThreads - 1;
+
+	mTerrainObject.setCollisionShape(&mTerrainShape);
 }
 
 FChunkManager::~FChunkManager()
 {
+	// The terrain can't outlive the manager within the simulation, and steps read chunks
+	if (mPhysicsSystem && mHasTerrainCollision)
+	{
+		DetachTerrain();
+		mPhysicsSystem->ApplyQueuedChanges();
+	}
+
 	Shutdown();
 	delete[] mChunks;
 	delete[] mChunkPositions;
+	delete mResidentTable.load();
+
+	// Readers can't outlive the manager, so the blocks its chunks retired can all be freed
+	FChunk::BlockEpochs.Reclaim();
 }
 
 void FChunkManager::Shutdown()
 {	
+	StopChunkThreads();
+	mJournal.Commit();
+	mPrefetchedChunks.clear();
+	mEvictionTimes.clear();
+	mMeshCache.Close();
+	UnloadAllChunks();
+
+	// Fluid jobs finished with the workers
+	mFluids.Clear();
+	mFluidChanges.clear();
+
+	mLoadList.clear();
+	mLoadListDepth = 0;
+	mPendingChunkReads = 0;
+	mRebuildList.clear();
+	mRenderList.clear();
+	mCasterList.clear();
+	mCasterCenters.clear();
+	mLightLoads.clear();
+
+	// The next world's chunks take the same slots
+	if (mBlockVolume)
+		mBlockVolume->SetRadius(0, 0);
+	mBlockVolumeUploads.clear();
+	mPipelineStats.Reset();
+
+	mMustShutdown = false;
+}
+
+void FChunkManager::StopChunkThreads()
+{
+	// The save thread writes to chunks' region files, so it finishes first
+	if (mSaveThread.joinable())
+		mSaveThread.join();
+
 	mMustShutdown = true;
 	if(mLoaderThread.joinable())
 		mLoaderThread.join();
 
+	// Queued reads and jobs exit early during shutdown, so this only waits
+	// for work that is currently running. Reads submit jobs, so they stop first.
+	mIOQueue.Stop();
+	mWorkerPool.Stop();
+
 	// Finish processing chunks and make sure the correct
-	// position are in mChunkPositions
-	SwapChunkBuffers();
-	UnloadAllChunks();
+	// position are in mChunkPositions. Uploads in flight finish their swaps.
+	while (!mBufferSwapQueue.empty() || !mEditSwapQueue.empty() || (mUploader && mUploader->GetPendingCount() > 0))
+		SwapChunkBuffers();
+}
+
+void FChunkManager::LoadWorld(const wchar_t* WorldName)
+{
+	mLoadWorldTime = FClock::ReadSystemTimer();
+	mStartupTimings = StartupTimings();
+	mIsFirstFrameDone = false;
+
+	Shutdown();
+	mFileSystem.SetWorld(WorldName);
+
+	// Shadow regions were discarded, so every edit since the last save is replayed
+	std::vector<FEditJournal::Edit> Edits;
+	if (!mJournal.Open(WorldName, Edits))
+		std::wcerr << L"Edits to " << WorldName << L" are not journaled until the world is saved" << std::endl;
+	mColumnHeights.Open(WorldName);
+	mBlockTicks.Open(WorldName);
+	mEntities.Open(WorldName);
+
+	if (mUsesMeshCache)
+		mMeshCache.Open(WorldName);
+
+	mReplayEdits.clear();
+	for (const FEditJournal::Edit& Edit : Edits)
+		mReplayEdits[FMath::FloorDivide(Edit.Position, FChunk::CHUNK_SIZE)].push_back(Edit);
+
+	mWorldSize = mFileSystem.GetWorldSize();
+	InitializeWorld();
+
+	mStartupTimings.WorldOpenMs = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - mLoadWorldTime) * 1000.0f;
+}
+
+void FChunkManager::SaveWorld(SaveProgressCallback OnProgress)
+{
+	if (mSaveThread.joinable())
+		mSaveThread.join();
+
+	// Chunk positions only change under the buffer swap lock. A chunk waiting
+	// for a buffer swap already holds the blocks of its new position.
+	mSaveRequests.clear();
+	{
+		std::lock_guard<std::mutex> BufferSwapLock(mBufferSwapMutex);
+
+		const uint32_t Size = ChunkCount();
+		for (uint32_t i = 0; i < Size; i++)
+		{
+			if (!mChunks[i].IsLoaded() || !mChunks[i].IsModified())
+				continue;
+
+			const Vector3i ChunkPosition = (mSwapPositions[i].y != INVALID_CHUNK_COORDINATE) ? mSwapPositions[i] : Vector3i{ mChunkPositions[i] };
+			if (ChunkPosition.y == INVALID_CHUNK_COORDINATE)
+				continue;
+
+			SaveRequest Request;
+			Request.Position = ChunkPosition;
+			Request.Index = i;
+
+			const uint32_t DataSize = mChunks[i].Serialize(ChunkDataScratch, Request.Version);
+			Request.BlockData.assign(ChunkDataScratch, ChunkDataScratch + DataSize);
+
+			mSaveRequests.push_back(std::move(Request));
+		}
+	}
+
+	// Edits are only made on this thread, so the journal splits at the snapshot.
+	// Replay edits of chunks that were never loaded aren't in the snapshot.
+	{
+		std::vector<FEditJournal::Edit> RetainedEdits;
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+
+		for (const auto& ChunkEdits : mReplayEdits)
+			RetainedEdits.insert(RetainedEdits.end(), ChunkEdits.second.begin(), ChunkEdits.second.end());
+
+		mJournal.BeginSave(RetainedEdits);
+	}
+
+	// Bound objects are only read between physics steps on this thread
+	mEntities.Snapshot();
+
+	mIsSaving = true;
+	mSaveThread = std::thread(&FChunkManager::SaveThreadLoop, this, OnProgress);
+}
+
+void FChunkManager::WarmUp(const int32_t Radius, WarmupProgressCallback OnProgress)
+{
+	// No world is loaded
+	if (!mLoaderThread.joinable())
+		return;
+
+	CPU_PROFILE("ChunkWarmup");
+
+	const uint64_t WarmupBegin = FClock::ReadSystemTimer();
+	uint64_t StageBegins[EChunkStage::Count];
+	for (uint32_t i = 0; i < EChunkStage::Count; i++)
+		StageBegins[i] = mPipelineStats.GetStageCycles((EChunkStage::Type)i);
+
+	// Loads are ordered out from the camera chunk, so the spawn area is read and meshed first
+	const Vector3i CameraChunk = UpdateCameraChunk();
+	const Vector3i Range{ std::min(Radius, mViewDistance), std::min(Radius, mVerticalViewDistance), std::min(Radius, mViewDistance) };
+
+	std::vector<Vector3i> Chunks;
+	for (int32_t y = -Range.y; y <= Range.y; y++)
+	{
+		for (int32_t x = -Range.x; x <= Range.x; x++)
+		{
+			for (int32_t z = -Range.z; z <= Range.z; z++)
+			{
+				const Vector3i ChunkPosition = CameraChunk + Vector3i{ x, y, z };
+				if (IsInWorld(ChunkPosition))
+					Chunks.push_back(ChunkPosition);
+			}
+		}
+	}
+
+	// Nothing is drawn until the warmup ends, so uploads aren't spread over frames
+	const uint32_t SwapByteBudget = mSwapByteBudget;
+	const float SwapTimeBudget = mSwapTimeBudget;
+	const uint64_t SwapDeadline = mSwapDeadline;
+	mSwapByteBudget = UINT32_MAX;
+	mSwapTimeBudget = WARMUP_SWAP_MS;
+	mSwapDeadline = 0;
+
+	const uint32_t ChunkCount = Chunks.size();
+	const uint64_t Timeout = WarmupBegin + FClock::SecondsToCycles(WARMUP_TIMEOUT_SECONDS);
+	while (true)
+	{
+		FChunk::BlockEpochs.Reclaim();
+		SwapChunkBuffers();
+
+		// Light spreading into the area queues rebuilds, which are counted below
+		UpdateLighting();
+
+		const uint32_t ReadyCount = CountReadyChunks(Chunks);
+		if (OnProgress)
+			OnProgress(ReadyCount, ChunkCount);
+
+		if (ReadyCount == ChunkCount)
+			break;
+
+		if (FClock::ReadSystemTimer() >= Timeout)
+		{
+			FDebug::PrintF("Warmup timed out with %u of %u spawn chunks ready\n", ReadyCount, ChunkCount);
+			break;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(WARMUP_POLL_MS));
+	}
+
+	mSwapByteBudget = SwapByteBudget;
+	mSwapTimeBudget = SwapTimeBudget;
+	mSwapDeadline = SwapDeadline;
+
+	const float MsPerCycle = FClock::CyclesToSeconds(1) * 1000.0f;
+	mStartupTimings.WarmupMs = (FClock::ReadSystemTimer() - WarmupBegin) * MsPerCycle;
+	mStartupTimings.ReadMs = (mPipelineStats.GetStageCycles(EChunkStage::Read) - StageBegins[EChunkStage::Read]) * MsPerCycle;
+	mStartupTimings.DecodeMs = (mPipelineStats.GetStageCycles(EChunkStage::Decode) - StageBegins[EChunkStage::Decode]) * MsPerCycle;
+	mStartupTimings.MeshMs = (mPipelineStats.GetStageCycles(EChunkStage::Mesh) - StageBegins[EChunkStage::Mesh]) * MsPerCycle;
+	mStartupTimings.UploadMs = (mPipelineStats.GetStageCycles(EChunkStage::Upload) - StageBegins[EChunkStage::Upload]) * MsPerCycle;
+	mStartupTimings.ChunkCount = ChunkCount;
+}
+
+void FChunkManager::EndFrame()
+{
+	if (mIsFirstFrameDone)
+		return;
+
+	mIsFirstFrameDone = true;
+	mStartupTimings.FirstFrameMs = FClock::CyclesToSeconds(FClock::ReadSystemTimer() - mLoadWorldTime) * 1000.0f;
+	LogStartupTimings();
+}
+
+void FChunkManager::LogStartupTimings() const
+{
+	const StartupTimings& Timings = mStartupTimings;
+
+	FDebug::PrintF("Startup:\n");
+	FDebug::PrintF("    World open %.1f ms   Warmup %.1f ms   First frame %.1f ms   Spawn chunks %u\n", Timings.WorldOpenMs,
+		Timings.WarmupMs, Timings.FirstFrameMs, Timings.ChunkCount);
+	FDebug::PrintF("    Read %.1f ms   Decode %.1f ms   Mesh %.1f ms   Upload %.1f ms\n", Timings.ReadMs, Timings.DecodeMs,
+		Timings.MeshMs, Timings.UploadMs);
+}
+
+void FChunkManager::SaveThreadLoop(SaveProgressCallback OnProgress)
+{
+	const uint32_t RequestCount = mSaveRequests.size();
+
+	for (uint32_t i = 0; i < RequestCount; i++)
+	{
+		const SaveRequest& Request = mSaveRequests[i];
+
+		uint32_t DataSize = Request.BlockData.size();
+		uint8_t Codec;
+		const FChunkOccupancy::Entry Occupancy = FChunkOccupancy::Summarize(Request.BlockData.data(), DataSize);
+		const uint8_t* EncodedData = EncodeChunkData(Request.BlockData.data(), DataSize, Codec);
+
+		{
+			std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+
+			// Chunks unloaded since the snapshot have already written newer data
+			FChunk& Chunk = mChunks[Request.Index];
+			if (Chunk.IsLoaded() && Chunk.GetLoadCount() == Request.Version.LoadCount)
+			{
+				mFileSystem.WriteChunkData(Request.Position, EncodedData, DataSize, Codec, Occupancy);
+				mPrefetchedChunks.erase(Request.Position);
+				mPipelineStats.AddBytesWritten(DataSize);
+				Chunk.MarkSaved(Request.Version);
+			}
+		}
+
+		if (OnProgress)
+			OnProgress(i + 1, RequestCount);
+	}
+
+	{
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+		mFileSystem.SaveWorld();
+	}
+
+	mColumnHeights.Save();
+	mBlockTicks.Save();
+	mEntities.Save();
+
+	mJournal.EndSave();
+	mSaveRequests.clear();
+	mIsSaving = false;
+}
+
+void FChunkManager::SetViewDistance(const uint32_t Distance)
+{
+	ReallocateChunkData(Distance, mVerticalViewDistance);
+}
+
+void FChunkManager::SetVerticalViewDistance(const uint32_t Distance)
+{
+	ReallocateChunkData(mViewDistance, Distance);
+}
+
+void FChunkManager::SetEvictionMargin(const uint32_t Margin)
+{
+	mEvictionMargin = Margin;
+	ReallocateChunkData(mViewDistance, mVerticalViewDistance);
+}
+
+void FChunkManager::SetLODDistance(const uint32_t Level, const uint32_t Distance)
+{
+	if (Level == 0 || Level >= FChunk::LOD_LEVELS)
+		return;
+
+	std::lock_guard<std::mutex> Lock(mCameraMutex);
+	mLODDistances[Level] = Distance;
+
+	// The visible list update rebuilds chunks at the wrong level
+	mNeedsToRefreshVisibleList = true;
+}
+
+void FChunkManager::SetWorkerCount(const uint32_t Count)
+{
+	Shutdown();
+	mWorkerCount = (Count > 0) ? Count : 1;
+
+	InitializeWorld();
+}
+
+void FChunkManager::InitializeWorld()
+{
+	// Set chunk positions to invalid value
+	for (uint32_t i = 0; i < ChunkCount(); i++)
+	{
+		mChunkPositions[i] = Vector4i{ INVALID_CHUNK_POSITION, 0 };
+		HideResidentSlot(i);
+	}
+
+	StartChunkThreads();
+}
+
+void FChunkManager::StartChunkThreads()
+{
+	mLoadListPositions.assign(ChunkCount(), INVALID_CHUNK_POSITION);
+	mSwapPositions.assign(ChunkCount(), INVALID_CHUNK_POSITION);
+	mSwapQueueTimes.assign(ChunkCount(), 0);
+	mIsRebuildQueued.assign(ChunkCount(), false);
+	mIsEditRebuildQueued.assign(ChunkCount(), false);
+	mIsEditSwapQueued.assign(ChunkCount(), false);
+	mIsUploadPending.assign(ChunkCount(), false);
+	ResetChunkGroups();
+	mNeedsFullVisibleScan = true;
+	mNeedsToPrefetch = false;
+	mHasCameraPosition = false;
+
+	// Meshes in flight were requested for the previous slots
+	{
+		std::lock_guard<std::mutex> Lock(mGPUMeshMutex);
+		mGPUMeshRequests.clear();
+		mMeshSerials.assign(ChunkCount(), 0);
+		mGPUMeshSections.assign(ChunkCount(), 0);
+		if (mGPUMesher)
+			mGPUMesher->DropBatches();
+	}
+
+	if (GetCamera())
+	{
+		std::lock_guard<std::mutex> Lock(mCameraMutex);
+		mLoadFrustum = GetChunkViewFrustum();
+	}
+
+	// Activate workers and loader thread
+	mWorkerPool.Start(mWorkerCount, EDIT_WORKER_COUNT);
+	mIOQueue.Start();
+	mNeedsToRefreshVisibleList = true;
+	mLoaderThread = std::thread(&FChunkManager::ChunkLoaderThreadLoop, this);
+
+	// The view distance may have changed
+	UpdatePhysicsResidency(mLastCameraChunk);
+}
+
+void FChunkManager::ReallocateChunkData(const int32_t NewViewDistance, const int32_t NewVerticalViewDistance)
+{
+	// Running jobs are finished, but loaded chunks keep their blocks, light and mesh
+	StopChunkThreads();
+
+	Vector3i CameraChunk;
+	{
+		std::lock_guard<std::mutex> Lock(mCameraMutex);
+		CameraChunk = mLastCameraChunk;
+	}
+
+	const uint32_t OldSize = ChunkCount();
+	const int32_t OldHorizontalSlotBits = mHorizontalSlotBits;
+	const int32_t OldVerticalSlotBits = mVerticalSlotBits;
+
+	mViewDistance = NewViewDistance;
+	mVerticalViewDistance = NewVerticalViewDistance;
+	mHorizontalSlotBits = FMath::CeilLog2(2 * (NewViewDistance + mEvictionMargin) + 1);
+	mVerticalSlotBits = FMath::CeilLog2(2 * (NewVerticalViewDistance + mEvictionMargin) + 1);
+	const uint32_t NewSize = ChunkCount();
+
+	// The slot window only changes when it crosses a power of 2
+	const bool IsRehomed = (mHorizontalSlotBits != OldHorizontalSlotBits || mVerticalSlotBits != OldVerticalSlotBits);
+	FChunk* Chunks = mChunks;
+	Vector4i* ChunkPositions = mChunkPositions;
+	if (IsRehomed)
+	{
+		Chunks = new FChunk[NewSize];
+		for (uint32_t i = 0; i < NewSize; i++)
+			Chunks[i].SetMeshPool(mMeshPool);
+		ChunkPositions = new Vector4i[NewSize];
+		std::fill_n(ChunkPositions, NewSize, Vector4i{ INVALID_CHUNK_POSITION, 0 });
+	}
+
+	// Chunks leaving the eviction margin are written back. Those staying are within the
+	// margin of each other, so each takes a distinct slot of the new window.
+	for (uint32_t i = 0; i < OldSize; i++)
+	{
+		const Vector3i ChunkPosition = mChunkPositions[i];
+		if (!mChunks[i].IsLoaded() || ChunkPosition.y == INVALID_CHUNK_COORDINATE)
+			continue;
+
+		if (!IsInResidentRange(ChunkPosition, CameraChunk))
+		{
+			UnloadChunkSlot(i);
+			mChunkPositions[i] = Vector4i{ INVALID_CHUNK_POSITION, 0 };
+
+			// Kept slots give the chunk's mesh back now, rehomed ones are deleted below
+			if (!IsRehomed)
+			{
+				FChunk Unloaded;
+				Unloaded.SetMeshPool(mMeshPool);
+				mChunks[i].Swap(Unloaded);
+			}
+		}
+		else if (IsRehomed)
+		{
+			const int32_t Index = ChunkIndex(ChunkPosition);
+			HideResidentSlot(i);
+			Chunks[Index].Swap(mChunks[i]);
+			ChunkPositions[Index] = mChunkPositions[i];
+		}
+	}
+
+	if (IsRehomed)
+	{
+		// Readers still holding the old table only find hidden slots, and are waited for before its chunks are deleted
+		ResidentTable* OldTable = mResidentTable.exchange(NewResidentTable(Chunks));
+		for (uint32_t i = 0; i < NewSize; i++)
+		{
+			if (Chunks[i].IsLoaded() && ChunkPositions[i].y != INVALID_CHUNK_COORDINATE)
+				ShowResidentSlot(i, ChunkPositions[i]);
+		}
+
+		FChunk::BlockEpochs.Synchronize();
+		delete OldTable;
+		delete[] mChunks;
+		delete[] mChunkPositions;
+		mMeshPool.SetMaxSize(NewSize);
+		mChunks = Chunks;
+		mChunkPositions = ChunkPositions;
+	}
+
+	// Queued work refers to the old slots and is found again by the loader
+	mLoadList.clear();
+	mLoadListDepth = 0;
+	mRebuildList.clear();
+	mRenderList.clear();
+	mCasterList.clear();
+	mCasterCenters.clear();
+	mMustShutdown = false;
+	StartChunkThreads();
+
+	// Rebuilds dropped by the stop left their sections dirty
+	for (uint32_t i = 0; i < NewSize; i++)
+	{
+		if (mChunks[i].IsLoaded() && mChunks[i].HasDirtySections())
+			QueueChunkRebuild(i, 0);
+	}
+}
+
+void FChunkManager::UnloadAllChunks()
+{
+	const uint32_t Size = ChunkCount();
+	for (uint32_t i = 0; i < Size; i++)
+	{
+		if (mChunks[i].IsLoaded() && mChunkPositions[i].y != INVALID_CHUNK_COORDINATE)
+			UnloadChunkSlot(i);
+	}
+
+	mFileSystem.ClearAllRegionFileReferences();
+}
+
+void FChunkManager::UnloadChunkSlot(const uint32_t Index)
+{
+	const Vector3i UnloadChunkPosition = mChunkPositions[Index];
+	HideResidentSlot(Index);
+
+	// Unload the chunk currently in this index, unmodified chunks have nothing to write
+	uint32_t DataSize = mChunks[Index].Unload(ChunkDataScratch);
+
+	if (DataSize != 0)
+	{
+		uint8_t Codec;
+		const FChunkOccupancy::Entry Occupancy = FChunkOccupancy::Summarize(ChunkDataScratch, DataSize);
+		const uint8_t* EncodedData = EncodeChunkData(ChunkDataScratch, DataSize, Codec);
+
+		// Write the data to file
+		mFileSystem.WriteChunkData(UnloadChunkPosition, EncodedData, DataSize, Codec, Occupancy);
+		mPrefetchedChunks.erase(UnloadChunkPosition);
+		mPipelineStats.AddBytesWritten(DataSize);
+	}
+
+	mFileSystem.RemoveRegionFileReference(UnloadChunkPosition);
+}
+
+void FChunkManager::PrepareRender(FRenderSystem& Renderer)
+{
+	// Draw list for everything in the renderlist, seen from the view of the frame being submitted
+	ASSERT(!mIsHeadless && "Headless chunk managers can't be rendered.");
+	const FRenderView& View = Renderer.GetPacket().View;
+	const Vector3f ViewPosition = View.Position;
+	UpdateRenderList(ViewPosition, View.WorldFrustum);
+
+	mDrawList->Clear();
+	for (const auto& Index : mRenderList)
+	{
+		if (mChunks[Index].IsLoaded())
+		{
+			// Chunk quads are in chunk local space
+			mChunks[Index].AddDraw(*mDrawList, Vector3i{ mChunkPositions[Index] } * FChunk::CHUNK_SIZE, ViewPosition);
+		}
+	}
+
+	mDrawList->Upload();
+	mChunkCuller->Cull(*mDrawList, View.WorldFrustum, Renderer.GetHiZBuffer());
+}
+
+void FChunkManager::Render(FRenderSystem& Renderer, const GLenum RenderMode)
+{
+	// Culled chunks have no instances, so everything is drawn with one indirect draw
+	mDrawList->Draw(*mGeometryArena, RenderMode);
+}
+
+void FChunkManager::RenderFarTerrain() const
+{
+	if (mUsesFarTerrain)
+		mFarTerrain->Render();
+}
+
+uint64_t FChunkManager::CullShadowCasters(const FFrustum& LightFrustum, std::vector<uint32_t>& CastersOut)
+{
+	const float HalfSize = FChunk::CHUNK_SIZE / 2.0f;
+
+	mCasterVisibility.resize(mCasterCenters.size());
+	LightFrustum.CullAABBBatch(mCasterCenters.data(), mCasterCenters.size(), Vector3f{ HalfSize, HalfSize, HalfSize }, mCasterVisibility.data());
+
+	// FNV-1a over each caster's index, position and mesh
+	uint64_t Signature = 14695981039346656037ULL;
+	const auto Combine = [&Signature](const uint32_t Value)
+	{
+		Signature = (Signature ^ Value) * 1099511628211ULL;
+	};
+
+	CastersOut.clear();
+	for (uint32_t i = 0; i < mCasterList.size(); i++)
+	{
+		if (!mCasterVisibility[i])
+			continue;
+
+		const uint32_t Index = mCasterList[i];
+		CastersOut.push_back(Index);
+
+		Combine(Index);
+		Combine((uint32_t)mChunkPositions[Index].x);
+		Combine((uint32_t)mChunkPositions[Index].y);
+		Combine((uint32_t)mChunkPositions[Index].z);
+		Combine(mChunks[Index].GetMeshRevision());
+	}
+
+	return Signature;
+}
+
+void FChunkManager::RenderShadowCasters(const std::vector<uint32_t>& Casters, const Vector3f& LightDirection, FChunkDrawList& DrawList)
+{
+	// Each chunk is seen from far back along the light, so faces are culled as they are for the light
+	const float LightDistance = 1.0e4f;
+
+	DrawList.Clear();
+	for (const auto& Index : Casters)
+	{
+		if (!mChunks[Index].IsLoaded())
+			continue;
+
+		const Vector3i Origin = Vector3i{ mChunkPositions[Index] } * FChunk::CHUNK_SIZE;
+		const Vector3f Center = Vector3f{ Origin } + Vector3f{ 1, 1, 1 } * (FChunk::CHUNK_SIZE / 2.0f);
+		mChunks[Index].AddDraw(DrawList, Origin, Center - LightDirection * LightDistance);
+	}
+
+	DrawList.Upload();
+	DrawList.Draw(*mGeometryArena, GL_TRIANGLES);
+}
+
+void FChunkManager::Update()
+{
+	CPU_PROFILE("ChunkManagerUpdate");
+
+	// Frees the blocks replaced by loads and edits once no reader can hold them
+	FChunk::BlockEpochs.Reclaim();
+
+	const FCamera& Camera = *GetCamera();
+	const Vector3i CameraChunk = UpdateCameraChunk();
+
+	UpdatePrefetch(Camera.Transform.GetWorldPosition(), CameraChunk);
+
+	SwapChunkBuffers();
+	UpdateLighting();
+
+	// Entities that left the loaded chunks, or whose chunk was unloaded, wait for it to load again
+	mEntities.Park([this](const Vector3i& ChunkPosition) { return IsChunkLoaded(ChunkPosition); },
+		[this](const Vector3i& ChunkPosition) { return IsInWorld(ChunkPosition); });
+
+	// Blocks tick at a fixed rate. Ticks past MAX_BLOCK_TICKS_PER_FRAME are dropped.
+	mBlockTickTimer += STime::GetDeltaTime();
+	for (uint32_t i = 0; i < MAX_BLOCK_TICKS_PER_FRAME && mBlockTickTimer >= BLOCK_TICK_TIME; i++)
+	{
+		mBlockTickTimer -= BLOCK_TICK_TIME;
+		TickBlocks(CameraChunk);
+	}
+	mBlockTickTimer = std::min(mBlockTickTimer, BLOCK_TICK_TIME);
+
+	mFluidTickTimer += STime::GetDeltaTime();
+	if (mFluidTickTimer >= FLUID_TICK_TIME)
+	{
+		mFluidTickTimer = 0.0f;
+		TickFluids();
+	}
+
+	// Sent after the frame's ticks, so their edits are delivered with the rest
+	DispatchBlockChanges();
+
+	if (mFarTerrain && mUsesFarTerrain)
+		mFarTerrain->Update(CameraChunk, mViewDistance, mWorldSize);
+
+	if (mBlockVolume)
+		UpdateBlockVolume(CameraChunk);
+
+	// Group edits into one journal write on the I/O thread
+	mJournalCommitTimer += STime::GetDeltaTime();
+	if (mJournalCommitTimer >= JOURNAL_COMMIT_TIME)
+	{
+		mJournalCommitTimer = 0.0f;
+		if (mJournal.HasPendingEdits())
+			mIOQueue.Submit([this]() { mJournal.Commit(); });
+	}
+
+	// Sample worker throughput
+	mJobRateTimer += STime::GetDeltaTime();
+	if (mJobRateTimer >= JOB_RATE_SAMPLE_TIME)
+	{
+		const uint64_t CompletedJobs = mWorkerPool.GetCompletedJobCount();
+		mJobsPerSecond = (float)(CompletedJobs - mLastCompletedJobCount) / mJobRateTimer;
+		mLastCompletedJobCount = CompletedJobs;
+		mPipelineStats.SampleRates(mJobRateTimer);
+		mJobRateTimer = 0.0f;
+	}
+}
+
+FChunkManager::Stats FChunkManager::GetStats()
+{
+	Stats Result;
+	Result.LoadListDepth = mLoadListDepth;
+	Result.ReadQueueDepth = mIOQueue.GetPendingRequestCount();
+	Result.PendingJobs = mWorkerPool.GetPendingJobCount();
+	{
+		std::lock_guard<std::mutex> Lock(mRebuildListMutex);
+		Result.RebuildListDepth = mRebuildList.size();
+	}
+	{
+		std::lock_guard<std::mutex> Lock(mBufferSwapMutex);
+		Result.SwapQueueDepth = mBufferSwapQueue.size() + mEditSwapQueue.size() + (mUploader ? mUploader->GetPendingCount() : 0);
+		Result.Geometry = mGeometryArena ? mGeometryArena->GetStats() : FChunkGeometryArena::Stats();
+	}
+
+	Result.Rates = mPipelineStats.GetRates();
+	for (uint32_t i = 0; i < EChunkStage::Count; i++)
+		Result.Stages[i] = mPipelineStats.GetStageTiming((EChunkStage::Type)i);
+	Result.VisibleToDraw = mPipelineStats.GetVisibleToDrawTiming();
+
+	return Result;
+}
+
+void FChunkManager::LogStats()
+{
+	const Stats Snapshot = GetStats();
+
+	FDebug::PrintF("Chunk pipeline:\n");
+	FDebug::PrintF("    Queued loads %u   Reads %u   Jobs %u   Rebuilds %u   Swaps %u\n", Snapshot.LoadListDepth, Snapshot.ReadQueueDepth,
+		Snapshot.PendingJobs, Snapshot.RebuildListDepth, Snapshot.SwapQueueDepth);
+	FDebug::PrintF("    Loads/sec %.1f   Thrash/sec %.1f   Read %.1f KB/sec   Written %.1f KB/sec\n", Snapshot.Rates.LoadsPerSecond,
+		Snapshot.Rates.ThrashesPerSecond, Snapshot.Rates.BytesReadPerSecond / 1024.0f, Snapshot.Rates.BytesWrittenPerSecond / 1024.0f);
+
+	const FChunkGeometryArena::Stats& Geometry = Snapshot.Geometry;
+	const float QuadsPerMB = 1024.0f * 1024.0f / sizeof(FChunkMesh::Quad);
+	FDebug::PrintF("    Geometry %.1f / %.1f MB   Used %.0f%%   Fragmented %.0f%%   Free ranges %u   Largest %.1f MB   Compacted %.1f MB\n",
+		Geometry.UsedCount / QuadsPerMB, Geometry.Capacity / QuadsPerMB, Geometry.Utilization * 100.0f, Geometry.Fragmentation * 100.0f,
+		Geometry.FreeRangeCount, Geometry.LargestFreeRange / QuadsPerMB, Geometry.BytesMoved / (1024.0f * 1024.0f));
+
+	FDebug::PrintF("    Stage (avg / p99 ms):\n");
+	for (uint32_t i = 0; i < EChunkStage::Count; i++)
+	{
+		const FChunkPipelineStats::Timing& Stage = Snapshot.Stages[i];
+		FDebug::PrintF("        %-14s %8.3f %8.3f\n", FChunkPipelineStats::GetStageName((EChunkStage::Type)i), Stage.AverageMs, Stage.P99Ms);
+	}
+	FDebug::PrintF("        %-14s %8.3f %8.3f\n", "VisibleToDraw", Snapshot.VisibleToDraw.AverageMs, Snapshot.VisibleToDraw.P99Ms);
+}
+
+void FChunkManager::SetSwapBudget(const uint32_t Bytes, const float Milliseconds)
+{
+	mSwapByteBudget = Bytes;
+	mSwapTimeBudget = Milliseconds;
+}
+
+void FChunkManager::SwapChunkBuffers()
+{
+	CPU_PROFILE("ChunkSwap");
+
+	std::unique_lock<std::mutex> Lock(mBufferSwapMutex, std::try_to_lock);
+
+	if (Lock.owns_lock())
+	{
+		// Uploads from before GPU meshing was turned on are waited for, so they can't replace GPU meshes
+		if (mUploader)
+			CompleteUploads(mUsesGPUMeshing);
+
+		if (mGPUMesher)
+			UpdateGPUMeshes();
+
+		// Edits are swapped before streamed chunks and regardless of the deadline, so they
+		// show the frame after they were meshed. Always allow one, as with streamed swaps.
+		uint32_t SwapBytes = 0;
+		mDeferredSwaps.clear();
+		while (SwapBytes < EDIT_SWAP_BYTES_PER_FRAME && !mEditSwapQueue.empty())
+		{
+			const uint32_t Index = mEditSwapQueue.front();
+			mEditSwapQueue.pop_front();
+
+			// Taken back by a worker that queues it again, or already swapped by the streamed lane
+			if (mSwapPositions[Index].y == INVALID_CHUNK_COORDINATE)
+			{
+				mIsEditSwapQueued[Index] = false;
+				continue;
+			}
+
+			if (IsGPUMeshPending(Index) || mIsUploadPending[Index])
+			{
+				mDeferredSwaps.push_back(Index);
+				continue;
+			}
+
+			mIsEditSwapQueued[Index] = false;
+			SwapChunkMesh(Index, SwapBytes);
+		}
+		mEditSwapQueue.insert(mEditSwapQueue.begin(), mDeferredSwaps.begin(), mDeferredSwaps.end());
+
+		// Entries taken back by a worker are dropped. Offset by the frustum bonus,
+		// priorities are positive so their bits sort in the same order.
+		mSwapSortItems.clear();
+		for (const uint32_t Index : mBufferSwapQueue)
+		{
+			if (mSwapPositions[Index].y == INVALID_CHUNK_COORDINATE)
+				continue;
+
+			const float Priority = LoadPriority(mSwapPositions[Index], mLastCameraChunk, mLoadFrustum) + FRUSTUM_PRIORITY_BONUS;
+			uint32_t Key;
+			memcpy(&Key, &Priority, sizeof(Key));
+			mSwapSortItems.push_back(FSort::MakeKeyedItem(Key, Index));
+		}
+
+		FSort::RadixSort(mSwapSortItems, mSwapSortScratch);
+		mBufferSwapQueue.clear();
+		for (const uint64_t Item : mSwapSortItems)
+			mBufferSwapQueue.push_back(FSort::GetItemValue(Item));
+
+		uint64_t Deadline = FClock::ReadSystemTimer() + FClock::SecondsToCycles(mSwapTimeBudget / 1000.0f);
+		if (mSwapDeadline != 0 && mSwapDeadline < Deadline)
+			Deadline = mSwapDeadline;
+
+		// Always allow one swap so meshes larger than the budget still get uploaded
+		SwapBytes = 0;
+		uint64_t UploadEnd = 0;
+		mDeferredSwaps.clear();
+		while (SwapBytes < mSwapByteBudget && UploadEnd <= Deadline && !mBufferSwapQueue.empty())
+		{
+			const uint32_t Index = mBufferSwapQueue.front();
+			mBufferSwapQueue.pop_front();
+
+			if (IsGPUMeshPending(Index) || mIsUploadPending[Index])
+			{
+				mDeferredSwaps.push_back(Index);
+				continue;
+			}
+
+			UploadEnd = SwapChunkMesh(Index, SwapBytes);
+		}
+
+		// Swaps waiting on their GPU mesh or the slot's last upload keep their place at the front
+		mBufferSwapQueue.insert(mBufferSwapQueue.begin(), mDeferredSwaps.begin(), mDeferredSwaps.end());
+
+		// Meshes freed by the swaps leave gaps, which live meshes from the end of the arena are moved into
+		if (!mIsHeadless)
+		{
+			mGeometryArena->Compact(FChunkGeometryArena::DEFAULT_COMPACTION_BYTES);
+			mUploadRing->EndFrame();
+		}
+	}
+}
+
+uint64_t FChunkManager::SwapChunkMesh(const uint32_t Index, uint32_t& SwapBytesOut)
+{
+	SwapBytesOut += mChunks[Index].GetPendingMeshSize();
+
+	// The swap stays pending until the upload is put in place, so the slot keeps its newest position
+	if (mUploader && mUsesBackgroundUploads && !mUsesGPUMeshing && mChunks[Index].GetPendingMeshSize() > 0)
+	{
+		std::unique_ptr<FChunkUploader::Upload> Upload{ new FChunkUploader::Upload() };
+		Upload->SectionMask = mChunks[Index].TakeMeshSections(Upload->Quads, Upload->Ranges);
+		Upload->Position = mSwapPositions[Index];
+		Upload->Index = Index;
+		{
+			std::lock_guard<std::mutex> GPUMeshLock(mGPUMeshMutex);
+			Upload->Serial = mMeshSerials[Index];
+		}
+
+		mUploader->Submit(std::move(Upload));
+		mIsUploadPending[Index] = true;
+		return FClock::ReadSystemTimer();
+	}
+
+	const Vector3i ChunkPosition = mSwapPositions[Index];
+	mSwapPositions[Index] = INVALID_CHUNK_POSITION;
+
+	// Headless chunks have no mesh, they only take their position
+	const uint64_t UploadBegin = FClock::ReadSystemTimer();
+	if (!mIsHeadless)
+		mChunks[Index].SwapMeshBuffer(*mGeometryArena, *mUploadRing);
+	const uint64_t UploadEnd = FClock::ReadSystemTimer();
+	mPipelineStats.AddStageTime(EChunkStage::Upload, UploadBegin, UploadEnd);
+
+	FinishBufferSwap(Index, ChunkPosition, UploadEnd);
+	return UploadEnd;
+}
+
+void FChunkManager::FinishBufferSwap(const uint32_t Index, const Vector3i& ChunkPosition, const uint64_t SwapEnd)
+{
+	// The first swap after a load makes the chunk drawable
+	if (mSwapQueueTimes[Index] != 0)
+	{
+		mPipelineStats.AddVisibleToDraw(mSwapQueueTimes[Index], SwapEnd);
+		mSwapQueueTimes[Index] = 0;
+	}
+
+	// Terrain collision reads a chunk once it takes its position
+	if (mChunkPositions[Index] != Vector4i{ ChunkPosition, 1 })
+	{
+		mChunkPositions[Index] = Vector4i{ ChunkPosition, 1 };
+		WakeBodies(ChunkPosition * FChunk::CHUNK_SIZE, ChunkPosition * FChunk::CHUNK_SIZE + (FChunk::CHUNK_SIZE - 1));
+		mBlockTicks.Resume(ChunkPosition);
+		mEntities.Resume(ChunkPosition);
+	}
+	UpdateChunkGroup(Index);
+
+	// Swapped meshes follow block changes, so the volume's copy is replaced with them
+	if (mBlockVolume && mBlockVolume->Contains(ChunkPosition))
+		mBlockVolumeUploads.push_back(ChunkPosition);
+}
+
+void FChunkManager::UpdateGPUMeshes()
+{
+	std::lock_guard<std::mutex> Lock(mGPUMeshMutex);
+
+	// Only meshes of each slot's current serial are returned
+	mGPUMeshResults.clear();
+	mGPUMesher->Complete(*mGeometryArena, mMeshSerials, mGPUMeshResults);
+
+	for (const FChunkGPUMesher::Result& Result : mGPUMeshResults)
+	{
+		const uint32_t Index = Result.Index;
+		mChunks[Index].SwapGPUMesh(*mGeometryArena, Result.SectionMask, Result.Allocations, Result.Ranges);
+		mGPUMeshSections[Index] = 0;
+		UpdateChunkGroup(Index);
+
+		// A swap waiting on the mesh finishes with it. Its queue entry is dropped as taken back.
+		if (mSwapPositions[Index].y != INVALID_CHUNK_COORDINATE)
+		{
+			const Vector3i ChunkPosition = mSwapPositions[Index];
+			mSwapPositions[Index] = INVALID_CHUNK_POSITION;
+			FinishBufferSwap(Index, ChunkPosition, FClock::ReadSystemTimer());
+		}
+	}
+
+	mGPUMesher->Dispatch(mGPUMeshRequests);
+}
+
+void FChunkManager::CompleteUploads(const bool Wait)
+{
+	mCompletedUploads.clear();
+	mUploader->Complete(mCompletedUploads, Wait);
+
+	for (const std::unique_ptr<FChunkUploader::Upload>& Upload : mCompletedUploads)
+	{
+		// The staging buffer is copied on the GPU, and kept by GL until the copies have run
+		FChunkGeometryArena::Allocation Allocations[FChunkMesh::SECTION_COUNT] = {};
+		for (uint32_t Section = 0; Section < FChunkMesh::SECTION_COUNT; Section++)
+		{
+			const uint32_t QuadCount = Upload->QuadCounts[Section];
+			if ((Upload->SectionMask & (1 << Section)) && QuadCount > 0)
+			{
+				Allocations[Section] = mGeometryArena->Allocate(QuadCount);
+				mGeometryArena->Copy(Allocations[Section], 0, Upload->Buffer, Upload->Offsets[Section], QuadCount);
+			}
+		}
+		glDeleteBuffers(1, &Upload->Buffer);
+
+		// Put in place even when taken back, since the rebuild only replaces its dirty sections.
+		// Its swap waits for this one, as does that of a chunk loaded in the slot since, which replaces every section.
+		const uint32_t Index = Upload->Index;
+		mChunks[Index].SwapGPUMesh(*mGeometryArena, Upload->SectionMask, Allocations, Upload->Ranges);
+		mIsUploadPending[Index] = false;
+		mPipelineStats.AddStageTime(EChunkStage::Upload, Upload->StageBegin, Upload->StageEnd);
+
+		uint32_t MeshSerial;
+		{
+			std::lock_guard<std::mutex> GPUMeshLock(mGPUMeshMutex);
+			MeshSerial = mMeshSerials[Index];
+		}
+
+		if (MeshSerial == Upload->Serial && mSwapPositions[Index].y != INVALID_CHUNK_COORDINATE)
+		{
+			ASSERT(mSwapPositions[Index] == Upload->Position);
+			mSwapPositions[Index] = INVALID_CHUNK_POSITION;
+			FinishBufferSwap(Index, Upload->Position, FClock::ReadSystemTimer());
+		}
+		else
+		{
+			UpdateChunkGroup(Index);
+		}
+	}
+	mCompletedUploads.clear();
+}
+
+uint32_t FChunkManager::DropGPUMesh(const uint32_t Index, uint32_t& SerialOut)
+{
+	std::lock_guard<std::mutex> Lock(mGPUMeshMutex);
+
+	const uint32_t DroppedSections = mGPUMeshSections[Index];
+	mGPUMeshSections[Index] = 0;
+	SerialOut = ++mMeshSerials[Index];
+	return DroppedSections;
+}
+
+void FChunkManager::QueueGPUMesh(std::unique_ptr<FChunkGPUMesher::Request> Request)
+{
+	std::lock_guard<std::mutex> Lock(mGPUMeshMutex);
+
+	if (mMeshSerials[Request->Index] != Request->Serial)
+		return;
+
+	mGPUMeshSections[Request->Index] = Request->Input.SectionMask;
+	mGPUMeshRequests.push_back(std::move(Request));
+}
+
+bool FChunkManager::IsGPUMeshPending(const uint32_t Index)
+{
+	std::lock_guard<std::mutex> Lock(mGPUMeshMutex);
+	return mGPUMeshSections[Index] != 0;
+}
+
+#undef min
+#undef max
+void FChunkManager::SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID)
+{
+	const Vector3i ChunkCoordinates = FMath::FloorDivide(Position, FChunk::CHUNK_SIZE);
+
+	if (IsInWorld(ChunkCoordinates))
+	{
+		const Vector4i ChunkPosition = Vector4i(ChunkCoordinates, 1);
+		const Vector3i LocalPosition = FMath::FloorModulo(Position, FChunk::CHUNK_SIZE);
+
+		int32_t Index = ChunkIndex(ChunkPosition);
+
+		// Only set if the right chunk is loaded
+		if (ChunkPosition == mChunkPositions[Index])
+		{
+			const FBlockTypes::BlockID PreviousID = mChunks[Index].SetBlock(LocalPosition, ID);
+			mJournal.Append(Position, ID);
+
+			const BlockChange Change{ Position, PreviousID, ID };
+			if (mIsBufferingBlockEvents)
+				QueueBlockChanges(&Change, 1);
+			else
+				mOnBlockSet.Invoke(Position, ID);
+
+			UpdateColumnHeights(&Change, 1);
+			SchedulePlacedTicks(&Change, 1);
+			ActivateFluids(&Change, 1);
+			RelightBlocks(&Position, 1);
+			WakeBodies(Position, Position);
+			QueueChunkRebuild(Index, FChunk::EditSections(LocalPosition), true);
+			QueueBorderRebuilds(ChunkPosition, LocalPosition);
+		}
+	}
+}
+
+FBlockTypes::BlockID FChunkManager::GetBlock(Vector3i Position) const
+{
+	return BlockReader(*this).GetBlock(Position);
+}
+
+FChunkManager::BlockReader::BlockReader(const FChunkManager& Manager)
+	: mGuard(FChunk::BlockEpochs)
+	, mTable(Manager.mResidentTable.load())
+{
+}
+
+FBlockTypes::BlockID FChunkManager::BlockReader::GetBlock(const Vector3i& Position) const
+{
+	const FBlockStorage* Blocks = FindChunkBlocks(FMath::FloorDivide(Position, FChunk::CHUNK_SIZE));
+	return Blocks ? Blocks->Get(FChunk::BlockIndex(FMath::FloorModulo(Position, FChunk::CHUNK_SIZE))) : FBlock::AIR_BLOCK_ID;
+}
+
+const FBlockStorage* FChunkManager::BlockReader::FindChunkBlocks(const Vector3i& ChunkPosition) const
+{
+	// Slots of the table's window, as ChunkIndex finds them
+	const int32_t HorizontalMask = (1 << mTable->HorizontalSlotBits) - 1;
+	const int32_t VerticalMask = (1 << mTable->VerticalSlotBits) - 1;
+	const int32_t Index = (ChunkPosition.z & HorizontalMask) |
+		((ChunkPosition.x & HorizontalMask) << mTable->HorizontalSlotBits) |
+		((ChunkPosition.y & VerticalMask) << (2 * mTable->HorizontalSlotBits));
+
+	const ResidentSlot& Slot = mTable->Slots[Index];
+	for (;;)
+	{
+		// Hidden slots and slots of other chunks hold nothing as of the first read of the sequence
+		const uint32_t Sequence = Slot.Sequence.load(std::memory_order_acquire);
+		if ((Sequence & 1) != 0 || Slot.X.load(std::memory_order_relaxed) != ChunkPosition.x ||
+			Slot.Y.load(std::memory_order_relaxed) != ChunkPosition.y || Slot.Z.load(std::memory_order_relaxed) != ChunkPosition.z)
+		{
+			return nullptr;
+		}
+
+		const FBlockStorage* Blocks = &mTable->Chunks[Index].GetPublishedBlocks();
+
+		// The slot may have changed chunks while reading, then the blocks are of the wrong chunk
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (Slot.Sequence.load(std::memory_order_relaxed) == Sequence)
+			return Blocks;
+	}
+}
+
+void FChunkManager::ShowResidentSlot(const uint32_t Index, const Vector3i& ChunkPosition)
+{
+	ResidentSlot& Slot = mResidentTable.load()->Slots[Index];
+	ASSERT((Slot.Sequence.load(std::memory_order_relaxed) & 1) != 0 && "Slots are hidden before they change chunks.");
+
+	Slot.X.store(ChunkPosition.x, std::memory_order_relaxed);
+	Slot.Y.store(ChunkPosition.y, std::memory_order_relaxed);
+	Slot.Z.store(ChunkPosition.z, std::memory_order_relaxed);
+	Slot.Sequence.fetch_add(1, std::memory_order_release);
+}
+
+void FChunkManager::HideResidentSlot(const uint32_t Index)
+{
+	// Ordered before the blocks of the slot are replaced, so readers of the old ones see it changed
+	ResidentSlot& Slot = mResidentTable.load()->Slots[Index];
+	if ((Slot.Sequence.load(std::memory_order_relaxed) & 1) == 0)
+		Slot.Sequence.fetch_add(1);
+}
+
+FChunkManager::ResidentTable* FChunkManager::NewResidentTable(FChunk* Chunks) const
+{
+	const uint32_t Size = ChunkCount();
+
+	ResidentTable* Table = new ResidentTable;
+	Table->Slots.reset(new ResidentSlot[Size]);
+	Table->Chunks = Chunks;
+	Table->HorizontalSlotBits = mHorizontalSlotBits;
+	Table->VerticalSlotBits = mVerticalSlotBits;
+	for (uint32_t i = 0; i < Size; i++)
+	{
+		Table->Slots[i].Sequence = 1;
+		Table->Slots[i].X = 0;
+		Table->Slots[i].Y = 0;
+		Table->Slots[i].Z = 0;
+	}
+
+	return Table;
+}
+
+void FChunkManager::DestroyBlock(const Vector3i& Position)
+{
+	const Vector3i ChunkCoordinates = FMath::FloorDivide(Position, FChunk::CHUNK_SIZE);
+
+	if (IsInWorld(ChunkCoordinates))
+	{
+		const Vector4i ChunkPosition = Vector4i(ChunkCoordinates, 1);
+		const Vector3i LocalPosition = FMath::FloorModulo(Position, FChunk::CHUNK_SIZE);
+
+		int32_t Index = ChunkIndex(ChunkPosition);
+
+		// Only destroy if the right chunk is loaded
+		if (ChunkPosition == mChunkPositions[Index])
+		{
+			const FBlockTypes::BlockID ID = mChunks[Index].DestroyBlock(LocalPosition);
+			mJournal.Append(Position, FBlock::AIR_BLOCK_ID);
+
+			const BlockChange Change{ Position, ID, FBlock::AIR_BLOCK_ID };
+			if (mIsBufferingBlockEvents)
+				QueueBlockChanges(&Change, 1);
+			else
+				mOnBlockDestroy.Invoke(Position, ID);
+
+			UpdateColumnHeights(&Change, 1);
+			ActivateFluids(&Change, 1);
+			RelightBlocks(&Position, 1);
+			WakeBodies(Position, Position);
+			QueueChunkRebuild(Index, FChunk::EditSections(LocalPosition), true);
+			QueueBorderRebuilds(ChunkPosition, LocalPosition);
+		}
+	}
+}
+
+void FChunkManager::ApplyEdits(const BlockEdit* Edits, const uint32_t EditCount)
+{
+	WriteEdits(Edits, EditCount, nullptr);
+}
+
+void FChunkManager::FillBox(const Vector3i& Min, const Vector3i& Max, const FBlockTypes::BlockID ID)
+{
+	std::vector<BlockEdit> Edits;
+	for (int32_t y = Min.y; y <= Max.y; y++)
+	{
+		for (int32_t x = Min.x; x <= Max.x; x++)
+		{
+			for (int32_t z = Min.z; z <= Max.z; z++)
+			{
+				Edits.push_back(BlockEdit{ Vector3i{ x, y, z }, ID });
+			}
+		}
+	}
+
+	ASSERT(Edits.size() <= UINT32_MAX && "Edits are indexed with 32 bits.");
+	WriteEdits(Edits.data(), (uint32_t)Edits.size(), nullptr);
+}
+
+void FChunkManager::FillSphere(const Vector3i& Center, const int32_t Radius, const FBlockTypes::BlockID ID)
+{
+	// Blocks already of the type are left out, so they aren't locked and written again
+	BlockReader Reader(*this);
+	std::vector<BlockEdit> Edits;
+	for (const FBlockBox::Block& Block : FBlockBox(Reader, Center - Radius, Center + Radius))
+	{
+		const Vector3i Offset = Block.Position - Center;
+		if (Block.ID != ID && Offset.x * Offset.x + Offset.y * Offset.y + Offset.z * Offset.z <= Radius * Radius)
+			Edits.push_back(BlockEdit{ Block.Position, ID });
+	}
+
+	ASSERT(Edits.size() <= UINT32_MAX && "Edits are indexed with 32 bits.");
+	WriteEdits(Edits.data(), (uint32_t)Edits.size(), nullptr);
+}
+
+void FChunkManager::ReplaceInBox(const Vector3i& Min, const Vector3i& Max, const FBlockTypes::BlockID From, const FBlockTypes::BlockID To)
+{
+	// Only blocks of the type are edited, the type is checked again as they're written
+	BlockReader Reader(*this);
+	std::vector<BlockEdit> Edits;
+	for (const FBlockBox::Block& Block : FBlockBox(Reader, Min, Max))
+	{
+		if (Block.ID == From)
+			Edits.push_back(BlockEdit{ Block.Position, To });
+	}
+
+	ASSERT(Edits.size() <= UINT32_MAX && "Edits are indexed with 32 bits.");
+	WriteEdits(Edits.data(), (uint32_t)Edits.size(), &From);
+}
+
+void FChunkManager::WriteEdits(const BlockEdit* Edits, const uint32_t EditCount, const FBlockTypes::BlockID* ReplacedID)
+{
+	using SlotEdit = std::pair<int32_t, uint32_t>;
+
+	// Working data only lives for the call, so it comes from scratch memory
+	FStackScope Scratch(SFrameAllocator::GetScratch());
+
+	// Pair edits with the slot of their chunk, dropping edits to chunks that aren't loaded
+	std::vector<SlotEdit, TStackAdapter<SlotEdit>> SlotEdits(SFrameAllocator::ScratchAdapter<SlotEdit>());
+	SlotEdits.reserve(EditCount);
+	for (uint32_t i = 0; i < EditCount; i++)
+	{
+		const Vector3i ChunkCoordinates = FMath::FloorDivide(Edits[i].Position, FChunk::CHUNK_SIZE);
+		if (IsInWorld(ChunkCoordinates))
+		{
+			const int32_t Index = ChunkIndex(ChunkCoordinates);
+			if (Vector4i(ChunkCoordinates, 1) == mChunkPositions[Index])
+				SlotEdits.push_back(SlotEdit{ Index, i });
+		}
+	}
+
+	// Group edits by chunk, keeping the order of edits within each chunk
+	std::stable_sort(SlotEdits.begin(), SlotEdits.end(), [](const SlotEdit& A, const SlotEdit& B) { return A.first < B.first; });
+
+	std::vector<FChunk::BlockWrite, TStackAdapter<FChunk::BlockWrite>> Writes(SFrameAllocator::ScratchAdapter<FChunk::BlockWrite>());
+	std::vector<FBlockTypes::BlockID, TStackAdapter<FBlockTypes::BlockID>> PreviousIDs(SFrameAllocator::ScratchAdapter<FBlockTypes::BlockID>());
+	std::vector<BlockChange, TStackAdapter<BlockChange>> Changes(SFrameAllocator::ScratchAdapter<BlockChange>());
+	Writes.reserve(SlotEdits.size());
+	PreviousIDs.reserve(SlotEdits.size());
+	Changes.reserve(SlotEdits.size());
+	std::vector<FEditJournal::Edit> AppliedEdits;
+
+	for (uint32_t First = 0; First < SlotEdits.size();)
+	{
+		const int32_t Index = SlotEdits[First].first;
+
+		Writes.clear();
+		for (uint32_t i = First; i < SlotEdits.size() && SlotEdits[i].first == Index; i++)
+		{
+			const BlockEdit& Edit = Edits[SlotEdits[i].second];
+			Writes.push_back(FChunk::BlockWrite{ FChunk::BlockIndex(FMath::FloorModulo(Edit.Position, FChunk::CHUNK_SIZE)), Edit.BlockID });
+		}
+
+		PreviousIDs.resize(Writes.size());
+		mChunks[Index].SetBlocks(Writes.data(), Writes.size(), PreviousIDs.data(), ReplacedID);
+
+		uint32_t FaceMask = 0;
+		uint32_t SectionMask = 0;
+		const uint32_t ChangeCount = Changes.size();
+		for (uint32_t i = 0; i < Writes.size(); i++)
+		{
+			// Same condition SetBlocks writes with
+			if (PreviousIDs[i] == Writes[i].ID || (ReplacedID && PreviousIDs[i] != *ReplacedID))
+				continue;
+
+			const BlockEdit& Edit = Edits[SlotEdits[First + i].second];
+			Changes.push_back(BlockChange{ Edit.Position, PreviousIDs[i], Edit.BlockID });
+			AppliedEdits.push_back(Edit);
+			const Vector3i LocalPosition = FMath::FloorModulo(Edit.Position, FChunk::CHUNK_SIZE);
+			FaceMask |= BorderFaces(LocalPosition);
+			SectionMask |= FChunk::EditSections(LocalPosition);
+		}
+
+		if (Changes.size() != ChangeCount)
+		{
+			QueueChunkRebuild(Index, SectionMask, true);
+			QueueFaceRebuilds(FMath::FloorDivide(Edits[SlotEdits[First].second].Position, FChunk::CHUNK_SIZE), FaceMask);
+		}
+
+		First += Writes.size();
+	}
+
+	if (Changes.empty())
+		return;
+
+	std::vector<Vector3i, TStackAdapter<Vector3i>> ChangedPositions(Changes.size(), Vector3i{}, SFrameAllocator::ScratchAdapter<Vector3i>());
+	Vector3i ChangedMin = Changes[0].Position;
+	Vector3i ChangedMax = Changes[0].Position;
+	for (uint32_t i = 0; i < Changes.size(); i++)
+	{
+		const Vector3i& Position = Changes[i].Position;
+		ChangedPositions[i] = Position;
+
+		ChangedMin = Vector3i{ (Position.x < ChangedMin.x) ? Position.x : ChangedMin.x, (Position.y < ChangedMin.y) ? Position.y : ChangedMin.y, (Position.z < ChangedMin.z) ? Position.z : ChangedMin.z };
+		ChangedMax = Vector3i{ (Position.x > ChangedMax.x) ? Position.x : ChangedMax.x, (Position.y > ChangedMax.y) ? Position.y : ChangedMax.y, (Position.z > ChangedMax.z) ? Position.z : ChangedMax.z };
+	}
+
+	UpdateColumnHeights(Changes.data(), Changes.size());
+	SchedulePlacedTicks(Changes.data(), Changes.size());
+	ActivateFluids(Changes.data(), Changes.size());
+	RelightBlocks(ChangedPositions.data(), ChangedPositions.size());
+	WakeBodies(ChangedMin, ChangedMax);
+
+	mJournal.Append(AppliedEdits);
+	if (mIsBufferingBlockEvents)
+		QueueBlockChanges(Changes.data(), Changes.size());
+	else
+		mOnBlocksEdited.Invoke(Changes.data(), Changes.size());
+}
+
+void FChunkManager::QueueBlockChanges(const BlockChange* Changes, const uint32_t Count)
+{
+	std::lock_guard<std::mutex> Lock(mBlockEventMutex);
+	mQueuedChanges.insert(mQueuedChanges.end(), Changes, Changes + Count);
+}
+
+void FChunkManager::DispatchBlockChanges()
+{
+	mDispatchedChanges.clear();
+	{
+		std::lock_guard<std::mutex> Lock(mBlockEventMutex);
+		mDispatchedChanges.swap(mQueuedChanges);
+	}
+
+	CoalesceBlockChanges(mDispatchedChanges);
+
+	for (uint32_t First = 0; First < mDispatchedChanges.size();)
+	{
+		const Vector3i ChunkPosition = FMath::FloorDivide(mDispatchedChanges[First].Position, FChunk::CHUNK_SIZE);
+		uint32_t End = First + 1;
+		while (End < mDispatchedChanges.size() && FMath::FloorDivide(mDispatchedChanges[End].Position, FChunk::CHUNK_SIZE) == ChunkPosition)
+			End++;
+
+		mOnBlocksEdited.Invoke(&mDispatchedChanges[First], End - First);
+		First = End;
+	}
+}
+
+void FChunkManager::CoalesceBlockChanges(std::vector<BlockChange>& Changes)
+{
+	if (Changes.empty())
+		return;
+
+	// Grouped by chunk, then block. Stable so each block's changes keep the order they were made in.
+	auto IsBefore = [](const Vector3i& Lhs, const Vector3i& Rhs)
+	{
+		return (Lhs.x != Rhs.x) ? Lhs.x < Rhs.x : (Lhs.y != Rhs.y) ? Lhs.y < Rhs.y : Lhs.z < Rhs.z;
+	};
+
+	std::stable_sort(Changes.begin(), Changes.end(), [&IsBefore](const BlockChange& Lhs, const BlockChange& Rhs)
+	{
+		const Vector3i LhsChunk = FMath::FloorDivide(Lhs.Position, FChunk::CHUNK_SIZE);
+		const Vector3i RhsChunk = FMath::FloorDivide(Rhs.Position, FChunk::CHUNK_SIZE);
+		if (LhsChunk != RhsChunk)
+			return IsBefore(LhsChunk, RhsChunk);
+		return IsBefore(Lhs.Position, Rhs.Position);
+	});
+
+	// Each block keeps the type it had before its first change and after its last, blocks set back are dropped
+	uint32_t Kept = 0;
+	for (uint32_t First = 0; First < Changes.size();)
+	{
+		uint32_t Last = First;
+		while (Last + 1 < Changes.size() && Changes[Last + 1].Position == Changes[First].Position)
+			Last++;
+
+		const BlockChange Change{ Changes[First].Position, Changes[First].PreviousID, Changes[Last].ID };
+		if (Change.PreviousID != Change.ID)
+			Changes[Kept++] = Change;
+
+		First = Last + 1;
+	}
+	Changes.resize(Kept);
+}
+
+bool FChunkManager::Raycast(const FRay& Ray, const float MaxDistance, RaycastHit& HitOut) const
+{
+	return Raycast(BlockReader(*this), Ray, MaxDistance, HitOut);
+}
+
+bool FChunkManager::Raycast(const BlockReader& Reader, const FRay& Ray, const float MaxDistance, RaycastHit& HitOut) const
+{
+	if (Ray.Direction.LengthSquared() == 0.0f)
+		return false;
+
+	const Vector3f Direction = Vector3f{ Ray.Direction }.Normalize();
+	const Vector3i Unbounded{ INT32_MIN, INT32_MIN, INT32_MIN };
+	const Vector3i UnboundedMax{ INT32_MAX, INT32_MAX, INT32_MAX };
+
+	GridWalk ChunkWalk;
+	ChunkWalk.Start(Ray.Origin, Direction, (float)FChunk::CHUNK_SIZE, 0.0f, Unbounded, UnboundedMax, -1);
+
+	float ChunkEntry = 0.0f;
+	while (ChunkEntry <= MaxDistance)
+	{
+		const Vector3i ChunkPosition = ChunkWalk.Cell;
+		const float ChunkExit = std::min(ChunkWalk.ExitDistance(), MaxDistance);
+
+		// Chunks that aren't loaded, or of a single type that can't be hit, are crossed in one step
+		const FBlockStorage* Blocks = IsInWorld(ChunkPosition) ? Reader.FindChunkBlocks(ChunkPosition) : nullptr;
+		if (Blocks && !(Blocks->IsUniform() && !FBlockTypes::IsCollidable(Blocks->Get(0))))
+		{
+			const Vector3i ChunkMin = ChunkPosition * FChunk::CHUNK_SIZE;
+			const Vector3i ChunkMax = ChunkMin + (FChunk::CHUNK_SIZE - 1);
+
+			GridWalk BlockWalk;
+			BlockWalk.Start(Ray.Origin, Direction, 1.0f, ChunkEntry, ChunkMin, ChunkMax, ChunkWalk.Axis);
+
+			float BlockEntry = ChunkEntry;
+			while (true)
+			{
+				const FBlockTypes::BlockID ID = Blocks->Get(FChunk::BlockIndex(BlockWalk.Cell - ChunkMin));
+				if (FBlockTypes::IsCollidable(ID))
+				{
+					HitOut = RaycastHit{ BlockWalk.Cell, BlockWalk.EntryNormal(), BlockEntry, ID };
+					return true;
+				}
+
+				if (BlockWalk.ExitDistance() > ChunkExit)
+					break;
+
+				BlockEntry = BlockWalk.Advance();
+
+				// Rounding may step out of the chunk just before its exit distance
+				const Vector3i& Cell = BlockWalk.Cell;
+				if (Cell.x < ChunkMin.x || Cell.y < ChunkMin.y || Cell.z < ChunkMin.z ||
+					Cell.x > ChunkMax.x || Cell.y > ChunkMax.y || Cell.z > ChunkMax.z)
+					break;
+			}
+		}
+
+		if (ChunkExit >= MaxDistance)
+			break;
+
+		ChunkEntry = ChunkWalk.Advance();
+	}
+
+	return false;
+}
+
+void FChunkManager::GetSolidBlocks(const Vector3i& Min, const Vector3i& Max, uint8_t* SolidOut) const
+{
+	const Vector3i Size = Max - Min + 1;
+	std::memset(SolidOut, 0, Size.x * Size.y * Size.z);
+
+	const BlockReader Reader(*this);
+	const Vector3i FirstChunk = FMath::FloorDivide(Min, FChunk::CHUNK_SIZE);
+	const Vector3i LastChunk = FMath::FloorDivide(Max, FChunk::CHUNK_SIZE);
+
+	Vector3i ChunkPosition;
+	for (ChunkPosition.z = FirstChunk.z; ChunkPosition.z <= LastChunk.z; ChunkPosition.z++)
+	{
+		for (ChunkPosition.y = FirstChunk.y; ChunkPosition.y <= LastChunk.y; ChunkPosition.y++)
+		{
+			for (ChunkPosition.x = FirstChunk.x; ChunkPosition.x <= LastChunk.x; ChunkPosition.x++)
+			{
+				if (!IsInWorld(ChunkPosition))
+					continue;
+
+				const FBlockStorage* Blocks = Reader.FindChunkBlocks(ChunkPosition);
+				if (!Blocks)
+					continue;
+
+				// Chunks of a single type that can't be collided with have nothing to set
+				const bool IsUniform = Blocks->IsUniform();
+				if (IsUniform && !FBlockTypes::IsCollidable(Blocks->Get(0)))
+					continue;
+
+				// The part of the box within this chunk
+				const Vector3i ChunkMin = ChunkPosition * FChunk::CHUNK_SIZE;
+				const Vector3i ChunkMax = ChunkMin + (FChunk::CHUNK_SIZE - 1);
+				const Vector3i From{ std::max(Min.x, ChunkMin.x), std::max(Min.y, ChunkMin.y), std::max(Min.z, ChunkMin.z) };
+				const Vector3i To{ std::min(Max.x, ChunkMax.x), std::min(Max.y, ChunkMax.y), std::min(Max.z, ChunkMax.z) };
+
+				Vector3i Position;
+				for (Position.z = From.z; Position.z <= To.z; Position.z++)
+				{
+					for (Position.y = From.y; Position.y <= To.y; Position.y++)
+					{
+						uint8_t* Row = SolidOut + (Position.y - Min.y) * Size.x + (Position.z - Min.z) * Size.x * Size.y - Min.x;
+						for (Position.x = From.x; Position.x <= To.x; Position.x++)
+						{
+							Row[Position.x] = (uint8_t)(IsUniform || FBlockTypes::IsCollidable(Blocks->Get(FChunk::BlockIndex(Position - ChunkMin))));
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void FChunkManager::SetPhysicsSystem(FPhysicsSystem& Physics)
+{
+	if (mPhysicsSystem && mHasTerrainCollision)
+		DetachTerrain();
+
+	mPhysicsSystem = &Physics;
+	UpdatePhysicsResidency(mLastCameraChunk);
+	if (mHasTerrainCollision)
+		AttachTerrain();
+}
+
+void FChunkManager::SetTerrainCollision(const bool Flag)
+{
+	if (Flag == mHasTerrainCollision)
+		return;
+
+	mHasTerrainCollision = Flag;
+	if (!mPhysicsSystem)
+		return;
+
+	if (Flag)
+		AttachTerrain();
+	else
+		DetachTerrain();
+}
+
+void FChunkManager::AttachTerrain()
+{
+	mPhysicsSystem->AddCollider(mTerrainObject);
+
+	// Fast bodies are swept against blocks with the voxel raycast
+	mPhysicsSystem->SetTerrain(&mTerrainObject, [this](const btVector3& From, const btVector3& To, btScalar& FractionOut, btVector3& NormalOut)
+	{
+		const btVector3 Motion = To - From;
+		const float Length = Motion.length();
+
+		RaycastHit Hit;
+		if (!Raycast(FRay{ Vector3f{ From.x(), From.y(), From.z() }, Vector3f{ Motion.x(), Motion.y(), Motion.z() } }, Length, Hit))
+			return false;
+
+		// Bodies already inside a block are left to the solver
+		if (Hit.Normal == Vector3i{ 0, 0, 0 })
+			return false;
+
+		FractionOut = Hit.Distance / Length;
+		NormalOut = btVector3((btScalar)Hit.Normal.x, (btScalar)Hit.Normal.y, (btScalar)Hit.Normal.z);
+		return true;
+	});
+}
+
+void FChunkManager::DetachTerrain()
+{
+	mPhysicsSystem->SetTerrain(nullptr, nullptr);
+	mPhysicsSystem->RemoveCollider(mTerrainObject);
+}
+
+void FChunkManager::WakeBodies(const Vector3i& Min, const Vector3i& Max)
+{
+	if (!mPhysicsSystem)
+		return;
+
+	// Bodies resting on a block touch it from just outside
+	const btScalar Margin = btScalar(0.1);
+	mPhysicsSystem->ActivateBodiesInBox(btVector3((btScalar)Min.x - Margin, (btScalar)Min.y - Margin, (btScalar)Min.z - Margin),
+										btVector3((btScalar)Max.x + 1 + Margin, (btScalar)Max.y + 1 + Margin, (btScalar)Max.z + 1 + Margin));
+}
+
+void FChunkManager::UpdatePhysicsResidency(const Vector3i& CameraChunk)
+{
+	if (!mPhysicsSystem)
+		return;
+
+	// Chunks past the view distance are never loaded, so they would be air
+	const Vector3i Range{ std::min(PHYSICS_DISTANCE, mViewDistance), std::min(PHYSICS_DISTANCE, mVerticalViewDistance), std::min(PHYSICS_DISTANCE, mViewDistance) };
+	const Vector3i Min = (CameraChunk - Range) * FChunk::CHUNK_SIZE;
+	const Vector3i Max = (CameraChunk + Range + 1) * FChunk::CHUNK_SIZE;
+
+	const btVector3 BoxMin((btScalar)Min.x, (btScalar)Min.y, (btScalar)Min.z);
+	const btVector3 BoxMax((btScalar)Max.x, (btScalar)Max.y, (btScalar)Max.z);
+
+	// Bodies outside the box are held, so the terrain only pairs with bodies inside it
+	mPhysicsSystem->WaitForStep();
+	mTerrainShape.SetBounds(BoxMin, BoxMax);
+	mPhysicsSystem->UpdateColliderBounds(mTerrainObject);
+	mPhysicsSystem->SetResidentBox(BoxMin, BoxMax);
+}
+
+Vector3i FChunkManager::UpdateCameraChunk()
+{
+	// Positions below zero are in negative chunks
+	const Vector3f CameraPosition = GetCamera()->Transform.GetWorldPosition() / (float)FChunk::CHUNK_SIZE;
+	const Vector3i CameraChunk{ (int32_t)std::floor(CameraPosition.x), (int32_t)std::floor(CameraPosition.y), (int32_t)std::floor(CameraPosition.z) };
+
+	// Only update visibility list when that camera crosses a chunk boundary
+	if (mLastCameraChunk != CameraChunk)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(mCameraMutex);
+			mLastCameraChunk = CameraChunk;
+			mLoadFrustum = GetChunkViewFrustum();
+			mNeedsToRefreshVisibleList = true;
+		}
+
+		UpdatePhysicsResidency(CameraChunk);
+	}
+
+	return CameraChunk;
+}
+
+uint32_t FChunkManager::CountReadyChunks(const std::vector<Vector3i>& Chunks)
+{
+	// Rebuilds from neighbors loading or light spreading still change the mesh. Jobs queue
+	// their swap before freeing the slot, so swaps are checked after the slots.
+	std::vector<Vector3i> Built;
+	{
+		std::lock_guard<std::mutex> RebuildLock(mRebuildListMutex);
+		for (const Vector3i& ChunkPosition : Chunks)
+		{
+			const uint32_t Index = ChunkIndex(ChunkPosition);
+			if (!mIsRebuildQueued[Index] && !mIsEditRebuildQueued[Index] && mWorkerPool.IsSlotIdle(Index))
+				Built.push_back(ChunkPosition);
+		}
+	}
+
+	// Chunks are loaded in place of the last chunk of their slot, and only hold their position once swapped in
+	uint32_t ReadyCount = 0;
+	std::lock_guard<std::mutex> BufferSwapLock(mBufferSwapMutex);
+	for (const Vector3i& ChunkPosition : Built)
+	{
+		if (IsChunkLoaded(ChunkPosition) && mSwapPositions[ChunkIndex(ChunkPosition)].y == INVALID_CHUNK_COORDINATE)
+			ReadyCount++;
+	}
+
+	return ReadyCount;
+}
+
+bool FChunkManager::IsChunkLoaded(const Vector3i& ChunkPosition) const
+{
+	return IsInWorld(ChunkPosition) && mChunkPositions[ChunkIndex(ChunkPosition)] == Vector4i{ ChunkPosition, 1 };
+}
+
+bool FChunkManager::EncodeChunk(const Vector3i& ChunkPosition, const bool Compress, std::vector<uint8_t>& DataOut, uint8_t& CodecOut)
+{
+	if (!IsChunkLoaded(ChunkPosition))
+		return false;
+
+	// A worker may have already unloaded the slot for the chunk replacing it
+	uint32_t DataSize;
+	{
+		const uint32_t Index = ChunkIndex(ChunkPosition);
+		std::lock_guard<std::mutex> BufferSwapLock(mBufferSwapMutex);
+
+		const Vector3i LoadedPosition = (mSwapPositions[Index].y != INVALID_CHUNK_COORDINATE) ? mSwapPositions[Index] : Vector3i{ mChunkPositions[Index] };
+		if (LoadedPosition != ChunkPosition || !mChunks[Index].IsLoaded())
+			return false;
+
+		FChunk::Version Version;
+		DataSize = mChunks[Index].Serialize(ChunkDataScratch, Version);
+	}
+
+	const uint8_t* EncodedData = ChunkDataScratch;
+	CodecOut = FChunkCodec::Raw;
+	if (Compress)
+		EncodedData = EncodeChunkData(ChunkDataScratch, DataSize, CodecOut);
+
+	DataOut.assign(EncodedData, EncodedData + DataSize);
+	return true;
+}
+
+void FChunkManager::RegisterEntityType(const std::string& Name, FChunkEntities::SpawnFunction Spawn, FChunkEntities::DespawnFunction Despawn)
+{
+	mEntities.RegisterType(Name, std::move(Spawn), std::move(Despawn));
+
+	// Chunks loaded before the type was registered still hold its entities
+	const uint32_t Size = ChunkCount();
+	for (uint32_t i = 0; i < Size; i++)
+	{
+		if (mChunkPositions[i].w == 1)
+			mEntities.Resume(Vector3i{ mChunkPositions[i] });
+	}
+}
+
+void FChunkManager::SetWorldGenerator(const FWorldGenerator* Generator)
+{
+	// Workers call the generator while loading
+	Shutdown();
+	mWorldGenerator = Generator;
+	if (mFarTerrain)
+		mFarTerrain->SetGenerator(Generator);
+
+	InitializeWorld();
+}
+
+void FChunkManager::SetCamera(FCamera* Camera)
+{
+	mCamera = Camera;
+	if (!GetCamera())
+		return;
+
+	// Chunks of a new camera in the same chunk are still culled by its own frustum
+	std::lock_guard<std::mutex> Lock(mCameraMutex);
+	mLoadFrustum = GetChunkViewFrustum();
+	mNeedsToRefreshVisibleList = true;
+}
+
+FCamera* FChunkManager::GetCamera() const
+{
+	return mCamera ? mCamera : FCamera::Main;
+}
+
+void FChunkManager::ChunkLoaderThreadLoop()
+{
+	while (!mMustShutdown)
+	{
+		while (!mMustShutdown && !mNeedsToRefreshVisibleList)
+		{
+			UpdateRebuildList();
+			UpdateLoadList();
+
+			if (mNeedsToPrefetch.exchange(false))
+				QueuePrefetches();
+
+			std::this_thread::yield();
+		}
+
+		mNeedsToRefreshVisibleList = false;
+		UpdateVisibleList();
+	}
+}
+
+void FChunkManager::UpdateLoadList()
+{
+	// Only keep a few jobs queued so a visible list refresh
+	// can reprioritize the chunks that still need loading. Reads
+	// run ahead so their jobs have data when a worker frees up.
+	const uint32_t MaxJobsInFlight = mWorkerPool.GetWorkerCount() * JOBS_IN_FLIGHT_PER_WORKER;
+
+	const uint32_t PendingReads = mPendingChunkReads;
+	mReadBatch.clear();
+
+	while (!mLoadList.empty() && PendingReads + mReadBatch.size() < READ_AHEAD_COUNT &&
+		mWorkerPool.GetPendingJobCount() + PendingReads + mReadBatch.size() < MaxJobsInFlight + READ_AHEAD_COUNT)
+	{
+		std::pop_heap(mLoadList.begin(), mLoadList.end());
+		const Vector3i ChunkPosition = mLoadList.back().Position;
+		const uint64_t QueueTime = mLoadList.back().QueueTime;
+		mLoadList.pop_back();
+
+		mLoadListPositions[ChunkIndex(ChunkPosition)] = INVALID_CHUNK_POSITION;
+
+		// Chunks known to be of a single block type skip the read
+		FChunkOccupancy::Entry Occupancy;
+		{
+			std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+			Occupancy = mFileSystem.GetChunkOccupancy(ChunkPosition);
+		}
+
+		if (Occupancy.State == FChunkOccupancy::Entry::Uniform)
+			LoadUniformChunk(ChunkPosition, QueueTime, Occupancy.ID);
+		else
+			mReadBatch.push_back(LoadRequest{ ChunkPosition, 0.0f, QueueTime });
+	}
+
+	// Chunks of a region are read together, so the region file is walked once in sector order
+	while (!mReadBatch.empty())
+	{
+		const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(mReadBatch.front().Position);
+		auto RegionEnd = std::stable_partition(mReadBatch.begin(), mReadBatch.end(), [&RegionID](const LoadRequest& Request)
+		{
+			return FRegionFile::ChunkToRegionPosition(Request.Position) == RegionID;
+		});
+
+		std::vector<LoadRequest> Requests(mReadBatch.begin(), RegionEnd);
+		mReadBatch.erase(mReadBatch.begin(), RegionEnd);
+
+		mPendingChunkReads += Requests.size();
+		mIOQueue.Submit([this, Requests]() { ReadChunks(Requests); });
+	}
+
+	mLoadListDepth = mLoadList.size();
+}
+
+void FChunkManager::UpdatePrefetch(const Vector3f& CameraPosition, const Vector3i& CameraChunk)
+{
+	// Smoothed so a single uneven frame doesn't move the prediction
+	const float DeltaTime = STime::GetDeltaTime();
+	if (mHasCameraPosition && DeltaTime > 0.0f)
+	{
+		const Vector3f Velocity = (CameraPosition - mLastCameraPosition) / DeltaTime;
+		mCameraVelocity = mCameraVelocity + (Velocity - mCameraVelocity) * VELOCITY_SMOOTHING;
+	}
+	else
+	{
+		mCameraVelocity = Vector3f{};
+	}
+
+	mLastCameraPosition = CameraPosition;
+	mHasCameraPosition = true;
+
+	if (mPrefetchLookahead <= 0.0f)
+		return;
+
+	// Predictions past the view range would prefetch chunks that are unloaded before they are reached
+	Vector3f Lookahead = mCameraVelocity * mPrefetchLookahead;
+	const float MaxLookahead = (float)(mViewDistance * FChunk::CHUNK_SIZE);
+	const float LookaheadSquared = Vector3f::Dot(Lookahead, Lookahead);
+	if (LookaheadSquared > MaxLookahead * MaxLookahead)
+		Lookahead = Lookahead * (MaxLookahead / std::sqrt(LookaheadSquared));
+
+	const Vector3f Predicted = (CameraPosition + Lookahead) / (float)FChunk::CHUNK_SIZE;
+	const Vector3i PredictedChunk{ (int32_t)std::floor(Predicted.x), (int32_t)std::floor(Predicted.y), (int32_t)std::floor(Predicted.z) };
+
+	std::lock_guard<std::mutex> Lock(mCameraMutex);
+	if (PredictedChunk != mPrefetchChunk)
+	{
+		mPrefetchChunk = PredictedChunk;
+		mNeedsToPrefetch = (PredictedChunk != CameraChunk);
+	}
+}
+
+void FChunkManager::UpdateBlockVolume(const Vector3i& CameraChunk)
+{
+	CPU_PROFILE("BlockVolumeUpdate");
+
+	// Chunks past the view distance aren't loaded to fill the volume
+	const int32_t Radius = mUsesBlockVolume ? std::min(FBlockVolume::DEFAULT_RADIUS, mViewDistance) : 0;
+	const int32_t VerticalRadius = mUsesBlockVolume ? std::min(FBlockVolume::DEFAULT_VERTICAL_RADIUS, mVerticalViewDistance) : 0;
+	if (Radius != mBlockVolume->GetRadius() || VerticalRadius != mBlockVolume->GetVerticalRadius())
+	{
+		mBlockVolume->SetRadius(Radius, VerticalRadius);
+		mBlockVolumeUploads.clear();
+	}
+	if (Radius == 0)
+		return;
+
+	// Entered chunks are uploaded nearest first, taken from the back
+	const size_t QueuedCount = mBlockVolumeUploads.size();
+	mBlockVolume->SetCenter(CameraChunk, mBlockVolumeUploads);
+	if (mBlockVolumeUploads.size() != QueuedCount)
+	{
+		std::sort(mBlockVolumeUploads.begin(), mBlockVolumeUploads.end(), [&CameraChunk](const Vector3i& A, const Vector3i& B)
+		{
+			const Vector3i ToA = A - CameraChunk;
+			const Vector3i ToB = B - CameraChunk;
+			return ToA.x * ToA.x + ToA.y * ToA.y + ToA.z * ToA.z > ToB.x * ToB.x + ToB.y * ToB.y + ToB.z * ToB.z;
+		});
+	}
+
+	// Chunks that aren't loaded yet are queued again by their first swap
+	uint32_t UploadCount = 0;
+	while (!mBlockVolumeUploads.empty() && UploadCount < FBlockVolume::MAX_UPLOADS_PER_FRAME)
+	{
+		const Vector3i ChunkPosition = mBlockVolumeUploads.back();
+		mBlockVolumeUploads.pop_back();
+		if (!mBlockVolume->Contains(ChunkPosition) || !IsChunkLoaded(ChunkPosition))
+			continue;
+
+		mChunks[ChunkIndex(ChunkPosition)].ReadBlocks([&](const FBlockStorage& Blocks)
+		{
+			mBlockVolume->Upload(ChunkPosition, Blocks);
+		});
+		UploadCount++;
+	}
+}
+
+void FChunkManager::QueuePrefetches()
+{
+	CPU_PROFILE("QueuePrefetches");
+
+	Vector3i CameraChunk;
+	Vector3i PredictedChunk;
+	{
+		std::lock_guard<std::mutex> Lock(mCameraMutex);
+		CameraChunk = mLastCameraChunk;
+		PredictedChunk = mPrefetchChunk;
+	}
+
+	// Prefetches of the last prediction may no longer be ahead of the camera
+	mIOQueue.ClearLowPriority();
+	{
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+		for (auto Itr = mPrefetchedChunks.begin(); Itr != mPrefetchedChunks.end();)
+		{
+			if (IsInViewRange(Itr->first, CameraChunk) || IsInViewRange(Itr->first, PredictedChunk))
+				Itr++;
+			else
+				Itr = mPrefetchedChunks.erase(Itr);
+		}
+	}
+
+	// Chunks in the predicted view range but not the current one are loaded once the camera moves
+	std::vector<Vector3i> Positions;
+	for (int32_t x = -mViewDistance; x <= mViewDistance; x++)
+	{
+		for (int32_t y = -mVerticalViewDistance; y <= mVerticalViewDistance; y++)
+		{
+			for (int32_t z = -mViewDistance; z <= mViewDistance; z++)
+			{
+				const Vector3i ChunkPosition = PredictedChunk + Vector3i{ x, y, z };
+				if (IsInWorld(ChunkPosition) && !IsInViewRange(ChunkPosition, CameraChunk))
+					Positions.push_back(ChunkPosition);
+			}
+		}
+	}
+
+	// The chunks nearest the camera enter the view range first
+	std::sort(Positions.begin(), Positions.end(), [&CameraChunk](const Vector3i& Lhs, const Vector3i& Rhs)
+	{
+		const Vector3i LhsOffset = Lhs - CameraChunk;
+		const Vector3i RhsOffset = Rhs - CameraChunk;
+		return Vector3i::Dot(LhsOffset, LhsOffset) < Vector3i::Dot(RhsOffset, RhsOffset);
+	});
+
+	if (Positions.size() > MAX_PREFETCH_REQUESTS)
+		Positions.resize(MAX_PREFETCH_REQUESTS);
+
+	for (const Vector3i& ChunkPosition : Positions)
+		mIOQueue.SubmitLowPriority([this, ChunkPosition]() { PrefetchChunk(ChunkPosition); });
+}
+
+void FChunkManager::PrefetchChunk(const Vector3i ChunkPosition)
+{
+	CPU_PROFILE("ChunkPrefetch");
+
+	// The camera may have reached the chunk before the prefetch ran
+	if (mMustShutdown || FindLoadedChunk(ChunkPosition) != -1)
+		return;
+
+	uint32_t DataSize = 0;
+	uint8_t Codec = FChunkCodec::Raw;
+	{
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+		if (mPrefetchedChunks.size() >= MAX_PREFETCHED_CHUNKS || mPrefetchedChunks.count(ChunkPosition) != 0)
+			return;
+
+		// Loading uniform chunks reads nothing, so there is nothing to prefetch
+		if (mFileSystem.GetChunkOccupancy(ChunkPosition).State == FChunkOccupancy::Entry::Uniform)
+			return;
+
+		mFileSystem.AddRegionFileReference(ChunkPosition);
+		DataSize = mFileSystem.GetChunkData(ChunkPosition, EncodedDataScratch, FChunk::MAX_RLE_BYTES, Codec);
+		mFileSystem.RemoveRegionFileReference(ChunkPosition);
+
+		// Held empty while decoding, so a write of the chunk in the meantime drops it
+		mPrefetchedChunks[ChunkPosition] = PrefetchedChunk{};
+	}
+	mPipelineStats.AddBytesRead(DataSize);
+
+	// Decoded as LoadChunk would, outside of the file system lock
+	PrefetchedChunk Prefetched;
+	Prefetched.IsGenerated = false;
+	if (DataSize != 0 && Codec == FChunkCodec::LZ)
+	{
+		DataSize = FChunkCodec::Decompress(EncodedDataScratch, DataSize, ChunkDataScratch, FChunk::MAX_RLE_BYTES);
+
+		// Empty data would be generated over the saved blocks. The prefetch is dropped, so the
+		// load reads the chunk again and handles the corrupt data itself.
+		if (DataSize == 0)
+		{
+			LOG(Warning, Chunks, "Chunk data of %d %d %d on file is corrupt, the prefetch is dropped.", ChunkPosition.x, ChunkPosition.y, ChunkPosition.z);
+
+			std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+			mPrefetchedChunks.erase(ChunkPosition);
+			return;
+		}
+
+		Prefetched.Data.assign(ChunkDataScratch, ChunkDataScratch + DataSize);
+	}
+	else if (DataSize != 0)
+	{
+		Prefetched.Data.assign(EncodedDataScratch, EncodedDataScratch + DataSize);
+	}
+	else if (mWorldGenerator)
+	{
+		DataSize = mWorldGenerator->GenerateChunk(ChunkPosition, Prefetched.Data);
+		Prefetched.Data.resize(DataSize);
+		Prefetched.IsGenerated = true;
+	}
+
+	std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+	auto Entry = mPrefetchedChunks.find(ChunkPosition);
+	if (Entry != mPrefetchedChunks.end())
+		Entry->second = std::move(Prefetched);
+}
+
+void FChunkManager::UpdateRebuildList()
+{
+	std::lock_guard<std::mutex> RebuildLock(mRebuildListMutex);
+
+	// Rebuilds are submitted to the chunk's slot, so they will
+	// always run after any load already queued for that chunk.
+	while (!mRebuildList.empty())
+	{
+		const uint32_t Index = mRebuildList.front();
+		mRebuildList.pop_front();
+		mIsRebuildQueued[Index] = false;
+
+		mWorkerPool.Submit(Index, [this, Index]() { RebuildChunk(Index, false); });
+	}
+}
+
+void FChunkManager::UpdateLighting()
+{
+	std::vector<FLightPropagator::ChunkChange> Changes;
+	{
+		std::lock_guard<std::mutex> LightLock(mLightMutex);
+		if (mLightLoads.empty())
+			return;
+
+		for (const Vector3i& ChunkPosition : mLightLoads)
+			mLightPropagator.AddChunk(ChunkPosition);
+		mLightLoads.clear();
+
+		mLightPropagator.Propagate();
+		mLightPropagator.TakeChanges(Changes);
+	}
+
+	QueueLightRebuilds(Changes, false);
+}
+
+void FChunkManager::SetBlockTickHandler(const FBlockTypes::BlockID ID, BlockTickHandler Handler, const uint32_t PlacedDelay)
+{
+	mTickHandlers[ID] = std::move(Handler);
+	mPlacedTickDelays[ID] = mTickHandlers[ID] ? PlacedDelay : 0;
+}
+
+void FChunkManager::SetRandomTickHandler(const FBlockTypes::BlockID ID, BlockTickHandler Handler)
+{
+	mRandomTickHandlers[ID] = std::move(Handler);
+
+	mRandomTickTypes.erase(std::remove(mRandomTickTypes.begin(), mRandomTickTypes.end(), ID), mRandomTickTypes.end());
+	if (mRandomTickHandlers[ID])
+		mRandomTickTypes.push_back(ID);
+}
+
+void FChunkManager::SchedulePlacedTicks(const BlockChange* Changes, const uint32_t Count)
+{
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		if (mPlacedTickDelays[Changes[i].ID] != 0)
+			mBlockTicks.Schedule(Changes[i].Position, mPlacedTickDelays[Changes[i].ID]);
+	}
+}
+
+void FChunkManager::ActivateFluids(const BlockChange* Changes, const uint32_t Count)
+{
+	if (!mFluids.HasFluids())
+		return;
+
+	for (uint32_t i = 0; i < Count; i++)
+		mFluids.ActivateAround(Changes[i].Position);
+}
+
+void FChunkManager::TickBlocks(const Vector3i& CameraChunk)
+{
+	mBlockTicks.Advance(mDueTicks);
+	mTickedBlocks.clear();
+
+	for (const Vector3i& Position : mDueTicks)
+	{
+		const Vector3i ChunkPosition = FMath::FloorDivide(Position, FChunk::CHUNK_SIZE);
+		if (!IsInWorld(ChunkPosition))
+			continue;
+
+		// The tick runs once the chunk is loaded again
+		const int32_t Index = ChunkIndex(ChunkPosition);
+		if (mChunkPositions[Index] != Vector4i(ChunkPosition, 1))
+		{
+			mBlockTicks.Park(ChunkPosition, Position, 1);
+			continue;
+		}
+
+		const FBlockTypes::BlockID ID = mChunks[Index].GetBlock(FMath::FloorModulo(Position, FChunk::CHUNK_SIZE));
+		if (mTickHandlers[ID])
+			mTickedBlocks.push_back(BlockEdit{ Position, ID });
+	}
+
+	const uint32_t ScheduledCount = mTickedBlocks.size();
+	if (!mRandomTickTypes.empty())
+	{
+		for (int32_t z = -RANDOM_TICK_DISTANCE; z <= RANDOM_TICK_DISTANCE; z++)
+		{
+			for (int32_t y = -RANDOM_TICK_DISTANCE; y <= RANDOM_TICK_DISTANCE; y++)
+			{
+				for (int32_t x = -RANDOM_TICK_DISTANCE; x <= RANDOM_TICK_DISTANCE; x++)
+				{
+					const Vector3i ChunkPosition = CameraChunk + Vector3i{ x, y, z };
+					if (!IsInWorld(ChunkPosition))
+						continue;
+
+					const int32_t Index = ChunkIndex(ChunkPosition);
+					if (mChunkPositions[Index] == Vector4i(ChunkPosition, 1))
+						SampleRandomTicks(Index, ChunkPosition);
+				}
+			}
+		}
+	}
+
+	// Handlers run outside of chunk locks, so they can read blocks
+	mTickEdits.clear();
+	for (uint32_t i = 0; i < mTickedBlocks.size(); i++)
+	{
+		const BlockEdit& Block = mTickedBlocks[i];
+		const BlockTickHandler& Handler = (i < ScheduledCount) ? mTickHandlers[Block.BlockID] : mRandomTickHandlers[Block.BlockID];
+		Handler(Block.Position, Block.BlockID, mTickEdits);
+	}
+
+	if (!mTickEdits.empty())
+		ApplyEdits(mTickEdits.data(), mTickEdits.size());
+}
+
+void FChunkManager::SampleRandomTicks(const uint32_t Index, const Vector3i& ChunkPosition)
+{
+	const Vector3i ChunkOrigin = ChunkPosition * FChunk::CHUNK_SIZE;
+	std::uniform_int_distribution<int32_t> LocalDistribution(0, FChunk::SECTION_SIZE - 1);
+
+	mChunks[Index].ReadBlocks([&](const FBlockStorage& Blocks)
+	{
+		// Chunks without a random tick type aren't sampled
+		bool HoldsRandomTicks = false;
+		for (const FBlockTypes::BlockID ID : mRandomTickTypes)
+		{
+			if (Blocks.Contains(ID))
+			{
+				HoldsRandomTicks = true;
+				break;
+			}
+		}
+
+		if (!HoldsRandomTicks)
+			return;
+
+		for (int32_t SectionZ = 0; SectionZ < FChunk::CHUNK_SIZE; SectionZ += FChunk::SECTION_SIZE)
+		{
+			for (int32_t SectionY = 0; SectionY < FChunk::CHUNK_SIZE; SectionY += FChunk::SECTION_SIZE)
+			{
+				for (int32_t SectionX = 0; SectionX < FChunk::CHUNK_SIZE; SectionX += FChunk::SECTION_SIZE)
+				{
+					for (uint32_t i = 0; i < RANDOM_TICKS_PER_SECTION; i++)
+					{
+						const Vector3i LocalPosition{ SectionX + LocalDistribution(mTickRandom), SectionY + LocalDistribution(mTickRandom), SectionZ + LocalDistribution(mTickRandom) };
+						const FBlockTypes::BlockID ID = Blocks.Get(FChunk::BlockIndex(LocalPosition));
+						if (mRandomTickHandlers[ID])
+							mTickedBlocks.push_back(BlockEdit{ ChunkOrigin + LocalPosition, ID });
+					}
+				}
+			}
+		}
+	});
+}
+
+void FChunkManager::TickFluids()
+{
+	if (!mFluids.HasFluids() || mPendingFluidJobs != 0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> Lock(mFluidMutex);
+		mAppliedFluids.swap(mFluidChanges);
+		mFluidChanges.clear();
+	}
+
+	// Activates the cells around each change for the jobs below
+	mFluidEdits.clear();
+	for (const FluidChange& Change : mAppliedFluids)
+	{
+		if (GetBlock(Change.Position) == Change.PreviousID)
+			mFluidEdits.push_back(BlockEdit{ Change.Position, Change.ID });
+	}
+
+	if (!mFluidEdits.empty())
+		ApplyEdits(mFluidEdits.data(), mFluidEdits.size());
+
+	mFluids.TakeActive(mActiveFluids);
+	for (FFluidSimulator::ActiveChunk& Active : mActiveFluids)
+	{
+		if (!IsInWorld(Active.ChunkPosition))
+			continue;
+
+		// Cells of chunks that aren't loaded are dropped
+		const int32_t Index = ChunkIndex(Active.ChunkPosition);
+		if (mChunkPositions[Index] != Vector4i(Active.ChunkPosition, 1))
+			continue;
+
+		std::shared_ptr<FFluidSimulator::ActiveChunk> Chunk = std::make_shared<FFluidSimulator::ActiveChunk>();
+		Chunk->ChunkPosition = Active.ChunkPosition;
+		Chunk->Cells.swap(Active.Cells);
+
+		mPendingFluidJobs++;
+		mWorkerPool.Submit(Index, [this, Index, Chunk]() { SimulateFluids(Index, *Chunk); });
+	}
+}
+
+void FChunkManager::SimulateFluids(const uint32_t Index, const FFluidSimulator::ActiveChunk& Chunk)
+{
+	CPU_PROFILE("FluidSimulate");
+
+	// A block read from a neighbor into the cell Slot / Stride
+	struct HaloRead
+	{
+		Vector3i ChunkPosition;
+		int32_t  BlockIndex;
+		uint32_t Slot;
+	};
+
+	// Each cell's block followed by its neighborhood
+	const uint32_t Stride = FFluidSimulator::NEIGHBORHOOD_SIZE + 1;
+	const uint32_t CellCount = Chunk.Cells.size();
+
+	if (!mMustShutdown && FindLoadedChunk(Chunk.ChunkPosition) == (int32_t)Index)
+	{
+		std::vector<FBlockTypes::BlockID> Blocks(CellCount * Stride);
+		std::vector<HaloRead> Halo;
+
+		mChunks[Index].ReadBlocks([&](const FBlockStorage& Storage)
+		{
+			for (uint32_t i = 0; i < CellCount; i++)
+			{
+				const Vector3i Local = FFluidSimulator::UnpackCell(Chunk.Cells[i]);
+				Blocks[i * Stride] = Storage.Get(FChunk::BlockIndex(Local));
+
+				for (uint32_t n = 0; n < FFluidSimulator::NEIGHBORHOOD_SIZE; n++)
+				{
+					const Vector3i Neighbor = Local + FFluidSimulator::NEIGHBORHOOD[n];
+					const int32_t Slot = i * Stride + n + 1;
+					if (Neighbor.x < 0 || Neighbor.y < 0 || Neighbor.z < 0 || Neighbor.x >= FChunk::CHUNK_SIZE || Neighbor.y >= FChunk::CHUNK_SIZE || Neighbor.z >= FChunk::CHUNK_SIZE)
+						Halo.push_back(HaloRead{ Chunk.ChunkPosition + FMath::FloorDivide(Neighbor, FChunk::CHUNK_SIZE), FChunk::BlockIndex(FMath::FloorModulo(Neighbor, FChunk::CHUNK_SIZE)), Slot });
+					else
+						Blocks[Slot] = Storage.Get(FChunk::BlockIndex(Neighbor));
+				}
+			}
+		});
+
+		// Border cells are read with one lock of each neighbor
+		std::sort(Halo.begin(), Halo.end(), [](const HaloRead& A, const HaloRead& B)
+		{
+			if (A.ChunkPosition.x != B.ChunkPosition.x) return A.ChunkPosition.x < B.ChunkPosition.x;
+			if (A.ChunkPosition.y != B.ChunkPosition.y) return A.ChunkPosition.y < B.ChunkPosition.y;
+			return A.ChunkPosition.z < B.ChunkPosition.z;
+		});
+
+		std::vector<bool> IsMissing(CellCount, false);
+		for (uint32_t First = 0; First < Halo.size();)
+		{
+			uint32_t Last = First + 1;
+			while (Last < Halo.size() && Halo[Last].ChunkPosition == Halo[First].ChunkPosition)
+				Last++;
+
+			const int32_t NeighborIndex = FindLoadedChunk(Halo[First].ChunkPosition);
+			if (NeighborIndex == -1)
+			{
+				for (uint32_t i = First; i < Last; i++)
+					IsMissing[Halo[i].Slot / Stride] = true;
+			}
+			else
+			{
+				mChunks[NeighborIndex].ReadBlocks([&](const FBlockStorage& Storage)
+				{
+					for (uint32_t i = First; i < Last; i++)
+						Blocks[Halo[i].Slot] = Storage.Get(Halo[i].BlockIndex);
+				});
+			}
+
+			First = Last;
+		}
+
+		std::vector<FluidChange> Changes;
+		const Vector3i ChunkOrigin = Chunk.ChunkPosition * FChunk::CHUNK_SIZE;
+		for (uint32_t i = 0; i < CellCount; i++)
+		{
+			if (IsMissing[i])
+				continue;
+
+			const FBlockTypes::BlockID ID = Blocks[i * Stride];
+			const FBlockTypes::BlockID NewID = mFluids.Step(ID, &Blocks[i * Stride + 1]);
+			if (NewID != ID)
+				Changes.push_back(FluidChange{ ChunkOrigin + FFluidSimulator::UnpackCell(Chunk.Cells[i]), ID, NewID });
+		}
+
+		if (!Changes.empty())
+		{
+			std::lock_guard<std::mutex> Lock(mFluidMutex);
+			mFluidChanges.insert(mFluidChanges.end(), Changes.begin(), Changes.end());
+		}
+	}
+
+	mPendingFluidJobs--;
+}
+
+void FChunkManager::UpdateColumnHeights(const BlockChange* Changes, const uint32_t Count)
+{
+	// Placed blocks first, so a removal below a placed block in the same column leaves it be
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		if (Changes[i].ID != FBlock::AIR_BLOCK_ID)
+			mColumnHeights.Raise(Changes[i].Position.x, Changes[i].Position.z, Changes[i].Position.y + 1);
+	}
+
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		const Vector3i& Position = Changes[i].Position;
+		if (Changes[i].ID != FBlock::AIR_BLOCK_ID)
+			continue;
+
+		// Only removing the top block lowers the column
+		const int32_t Height = mColumnHeights.GetHeight(Position.x, Position.z);
+		if (Height == Position.y + 1)
+			mColumnHeights.Lower(Position.x, Position.z, Height, FindColumnTop(Position.x, Position.z, Position.y - 1));
+	}
+}
+
+int32_t FChunkManager::FindColumnTop(const int32_t X, const int32_t Z, const int32_t Y) const
+{
+	const Vector3i LocalColumn = FMath::FloorModulo(Vector3i{ X, 0, Z }, FChunk::CHUNK_SIZE);
+	Vector3i ChunkCoordinates = FMath::FloorDivide(Vector3i{ X, Y, Z }, FChunk::CHUNK_SIZE);
+	int32_t LocalY = FMath::FloorModulo(Y, FChunk::CHUNK_SIZE);
+
+	for (;; ChunkCoordinates.y--, LocalY = FChunk::CHUNK_SIZE - 1)
+	{
+		if (!IsInWorld(ChunkCoordinates))
+			return FColumnHeights::NO_SURFACE;
+
+		// Blocks of a chunk that isn't loaded are unknown, so it may be solid to its top
+		const int32_t Index = ChunkIndex(ChunkCoordinates);
+		if (Vector4i(ChunkCoordinates, 1) != mChunkPositions[Index])
+			return (ChunkCoordinates.y + 1) * FChunk::CHUNK_SIZE;
+
+		for (; LocalY >= 0; LocalY--)
+		{
+			if (mChunks[Index].GetBlock(Vector3i{ LocalColumn.x, LocalY, LocalColumn.z }) != FBlock::AIR_BLOCK_ID)
+				return ChunkCoordinates.y * FChunk::CHUNK_SIZE + LocalY + 1;
+		}
+	}
+}
+
+void FChunkManager::RelightBlocks(const Vector3i* Positions, const uint32_t Count)
+{
+	std::vector<FLightPropagator::ChunkChange> Changes;
+	{
+		std::lock_guard<std::mutex> LightLock(mLightMutex);
+		for (uint32_t i = 0; i < Count; i++)
+			mLightPropagator.UpdateBlock(Positions[i]);
+
+		mLightPropagator.Propagate();
+		mLightPropagator.TakeChanges(Changes);
+	}
+
+	QueueLightRebuilds(Changes, true);
+}
+
+void FChunkManager::QueueLightRebuilds(const std::vector<FLightPropagator::ChunkChange>& Changes, const bool IsEdit)
+{
+	for (const FLightPropagator::ChunkChange& Change : Changes)
+	{
+		const int32_t Index = FindLoadedChunk(Change.ChunkPosition);
+		if (Index != -1)
+			QueueChunkRebuild(Index, Change.SectionMask, IsEdit);
+	}
+}
+
+void FChunkManager::ReadChunks(const std::vector<LoadRequest>& Requests)
+{
+	CPU_PROFILE("ChunkRead");
+
+	if (mMustShutdown)
+	{
+		mPendingChunkReads -= Requests.size();
+		return;
+	}
+
+	std::vector<std::shared_ptr<ChunkReadResult>> Reads(Requests.size());
+	std::vector<Vector3i> FilePositions; // Chunks that weren't prefetched, read in one batch
+	std::vector<uint32_t> FileReads;
+	std::vector<std::vector<uint8_t>> FileData;
+	std::vector<uint8_t> FileCodecs;
+
+	const uint64_t ReadBegin = FClock::ReadSystemTimer();
+	{
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+
+		for (uint32_t i = 0; i < Requests.size(); i++)
+		{
+			const Vector3i& ChunkPosition = Requests[i].Position;
+			mFileSystem.AddRegionFileReference(ChunkPosition);
+
+			Reads[i] = std::make_shared<ChunkReadResult>();
+			Reads[i]->Codec = FChunkCodec::Raw;
+			Reads[i]->WriteCount = mFileSystem.GetWriteCount(ChunkPosition);
+			Reads[i]->QueueTime = Requests[i].QueueTime;
+			Reads[i]->IsGenerated = false;
+
+			// Prefetched data is dropped when the chunk is written, so it is as new as the file.
+			// A prefetch still decoding holds no data yet, which would read as a chunk not on file.
+			auto Prefetched = mPrefetchedChunks.find(ChunkPosition);
+			const bool IsPrefetched = Prefetched != mPrefetchedChunks.end() && (!Prefetched->second.Data.empty() || Prefetched->second.IsGenerated);
+			if (IsPrefetched)
+			{
+				Reads[i]->Data = std::move(Prefetched->second.Data);
+				Reads[i]->IsGenerated = Prefetched->second.IsGenerated;
+			}
+			else
+			{
+				FilePositions.push_back(ChunkPosition);
+				FileReads.push_back(i);
+			}
+
+			if (Prefetched != mPrefetchedChunks.end())
+				mPrefetchedChunks.erase(Prefetched);
+		}
+
+		FileData.resize(FilePositions.size());
+		FileCodecs.resize(FilePositions.size());
+		if (!FilePositions.empty())
+			mFileSystem.GetChunkDataBatch(FilePositions.data(), FilePositions.size(), FileData.data(), FileCodecs.data(), FChunk::MAX_RLE_BYTES);
+	}
+
+	uint32_t BytesRead = 0;
+	for (uint32_t i = 0; i < FileReads.size(); i++)
+	{
+		BytesRead += FileData[i].size();
+		Reads[FileReads[i]]->Data.swap(FileData[i]);
+		Reads[FileReads[i]]->Codec = FileCodecs[i];
+	}
+
+	mPipelineStats.AddStageTime(EChunkStage::Read, ReadBegin, FClock::ReadSystemTimer());
+	mPipelineStats.AddBytesRead(BytesRead);
+
+	for (uint32_t i = 0; i < Requests.size(); i++)
+	{
+		const Vector3i ChunkPosition = Requests[i].Position;
+		std::shared_ptr<ChunkReadResult> Read = Reads[i];
+		mWorkerPool.Submit(ChunkIndex(ChunkPosition), [this, ChunkPosition, Read]() { LoadChunk(ChunkPosition, *Read); });
+	}
+
+	// Submitted jobs are counted as pending jobs from here on
+	mPendingChunkReads -= Requests.size();
+}
+
+void FChunkManager::LoadUniformChunk(const Vector3i& ChunkPosition, const uint64_t QueueTime, const FBlockTypes::BlockID ID)
+{
+	// A single run decodes as a uniform chunk, and isn't empty data a generator would fill
+	std::shared_ptr<ChunkReadResult> Read = std::make_shared<ChunkReadResult>();
+	Read->Data = { ID, 1 };
+	Read->Codec = FChunkCodec::Raw;
+	Read->QueueTime = QueueTime;
+	Read->IsGenerated = false;
+	{
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+		mFileSystem.AddRegionFileReference(ChunkPosition);
+		Read->WriteCount = mFileSystem.GetWriteCount(ChunkPosition);
+		mPrefetchedChunks.erase(ChunkPosition);
+	}
+
+	mWorkerPool.Submit(ChunkIndex(ChunkPosition), [this, ChunkPosition, Read]() { LoadChunk(ChunkPosition, *Read); });
+}
+
+void FChunkManager::LoadChunk(const Vector3i ChunkPosition, const ChunkReadResult& Read)
+{
+	CPU_PROFILE("ChunkLoad");
+
+	if (mMustShutdown)
+	{
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+		mFileSystem.RemoveRegionFileReference(ChunkPosition);
+		return;
+	}
+
+	const uint32_t Index = ChunkIndex(ChunkPosition);
+
+	std::unique_lock<std::mutex> BufferSwapLock(mBufferSwapMutex);
+
+	// Get region position info for unloaded chunk
+	Vector3i UnloadChunkPosition = mChunkPositions[Index];
+
+	// If this chunk slot is waiting for a buffer swap, that position tells us which chunk position
+	// is really currently loaded within the chunk data.
+	if (mSwapPositions[Index].y != INVALID_CHUNK_COORDINATE)
+		UnloadChunkPosition = mSwapPositions[Index];
+
+	// A previous job may have already loaded this chunk
+	if (mChunks[Index].IsLoaded() && UnloadChunkPosition == ChunkPosition)
+	{
+		BufferSwapLock.unlock();
+
+		// Release the reference taken by the read
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+		mFileSystem.RemoveRegionFileReference(ChunkPosition);
+		return;
+	}
+
+	// Take back the pending swap to prevent redundant buffer swaps
+	mSwapPositions[Index] = INVALID_CHUNK_POSITION;
+	BufferSwapLock.unlock();
+
+	// A GPU mesh of the previous chunk in the slot must not be put in place
+	uint32_t MeshSerial;
+	DropGPUMesh(Index, MeshSerial);
+
+	// Readers find air in the slot until the new chunk is in place
+	HideResidentSlot(Index);
+
+	///// Unload Chunk ////////////////////////////////////////////////////////////////
+	///////////////////////////////////////////////////////////////////////////////////
+	if (mChunks[Index].IsLoaded())
+	{
+		// Unload the chunk currently in this index, unmodified chunks have nothing to write
+		uint32_t DataSize = mChunks[Index].Unload(ChunkDataScratch);
+
+		// Compress before taking the file system lock
+		uint8_t Codec = FChunkCodec::Raw;
+		const FChunkOccupancy::Entry Occupancy = FChunkOccupancy::Summarize(ChunkDataScratch, DataSize);
+		const uint8_t* EncodedData = (DataSize != 0) ? EncodeChunkData(ChunkDataScratch, DataSize, Codec) : nullptr;
+
+		ASSERT(UnloadChunkPosition.y != INVALID_CHUNK_COORDINATE);
+		// Write the data to file
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+		if (DataSize != 0)
+		{
+			mFileSystem.WriteChunkData(UnloadChunkPosition, EncodedData, DataSize, Codec, Occupancy);
+			mPrefetchedChunks.erase(UnloadChunkPosition);
+			mPipelineStats.AddBytesWritten(DataSize);
+		}
+
+		mFileSystem.RemoveRegionFileReference(UnloadChunkPosition);
+		RecordEviction(UnloadChunkPosition);
+	}
+
+	///// Load Chunk /////////////////////////////////////////////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////////////
+
+	// The region file reference was taken by the read
+	const uint64_t DecodeBegin = FClock::ReadSystemTimer();
+	const uint8_t* EncodedData = Read.Data.data();
+	uint32_t DataSize = Read.Data.size();
+	uint8_t Codec = Read.Codec;
+	bool IsGenerated = Read.IsGenerated;
+	{
+		// Any chunk of the region written since the read might have been this one, so read it again
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+		auto Evicted = mEvictionTimes.find(ChunkPosition);
+		if (Evicted != mEvictionTimes.end())
+		{
+			if (DecodeBegin - Evicted->second < FClock::SecondsToCycles(THRASH_SECONDS))
+				mPipelineStats.AddThrash();
+			mEvictionTimes.erase(Evicted);
+		}
+
+		if (mFileSystem.GetWriteCount(ChunkPosition) != Read.WriteCount)
+		{
+			DataSize = mFileSystem.GetChunkData(ChunkPosition, EncodedDataScratch, FChunk::MAX_RLE_BYTES, Codec);
+			EncodedData = EncodedDataScratch;
+			IsGenerated = false;
+			mPipelineStats.AddBytesRead(DataSize);
+		}
+	}
+
+	// Decompress outside of the file system lock
+	const uint8_t* BlockData = EncodedData;
+	bool IsCorrupt = false;
+	if (DataSize != 0 && Codec == FChunkCodec::LZ)
+	{
+		DataSize = FChunkCodec::Decompress(EncodedData, DataSize, ChunkDataScratch, FChunk::MAX_RLE_BYTES);
+		BlockData = ChunkDataScratch;
+
+		// Corrupt data isn't missing data, generating over it would replace the saved blocks for good.
+		// The chunk loads as air and nothing is written until it is edited.
+		if (DataSize == 0)
+		{
+			LOG(Error, Chunks, "Chunk data of %d %d %d on file is corrupt, the chunk is loaded as air.", ChunkPosition.x, ChunkPosition.y, ChunkPosition.z);
+			BlockData = AIR_CHUNK_DATA;
+			DataSize = sizeof(AIR_CHUNK_DATA);
+			IsCorrupt = true;
+		}
+	}
+
+	// Generate chunks that aren't on file yet and keep them, prefetches may have generated them already
+	std::vector<uint8_t> GeneratedData;
+	if (DataSize == 0 && mWorldGenerator)
+	{
+		DataSize = mWorldGenerator->GenerateChunk(ChunkPosition, GeneratedData);
+		BlockData = GeneratedData.data();
+		IsGenerated = true;
+	}
+
+	const FChunkOccupancy::Entry Occupancy = FChunkOccupancy::Summarize(BlockData, DataSize);
+	if (IsGenerated)
+	{
+		uint32_t EncodedSize = DataSize;
+		uint8_t EncodedCodec;
+		const uint8_t* Encoded = EncodeChunkData(BlockData, EncodedSize, EncodedCodec);
+
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+		mFileSystem.WriteChunkData(ChunkPosition, Encoded, EncodedSize, EncodedCodec, Occupancy, true);
+		mPipelineStats.AddBytesWritten(EncodedSize);
+	}
+
+	// Load and build the chunk
+	Vector3i WorldPosition = ChunkPosition * FChunk::CHUNK_SIZE;
+	bool DoesntNeedRebuild = mChunks[Index].Load(BlockData, DataSize);
+
+	// Replay journal edits made after the chunk was last saved
+	{
+		std::lock_guard<std::mutex> FileSystemLock(mFileSystemMutex);
+
+		// Only a loaded chunk writes its position, so the occupancy of what was read is still current
+		if (!IsGenerated && !IsCorrupt)
+			mFileSystem.SetChunkOccupancy(ChunkPosition, Occupancy);
+
+		auto ChunkEdits = mReplayEdits.find(ChunkPosition);
+
+		if (ChunkEdits != mReplayEdits.end())
+		{
+			// Replayed as one batch, so the chunk's blocks are copied and published once
+			std::vector<FChunk::BlockWrite> Writes;
+			Writes.reserve(ChunkEdits->second.size());
+			for (const FEditJournal::Edit& Edit : ChunkEdits->second)
+				Writes.push_back(FChunk::BlockWrite{ FChunk::BlockIndex(Edit.Position - WorldPosition), Edit.BlockID });
+
+			std::vector<FBlockTypes::BlockID> PreviousIDs(Writes.size());
+			mChunks[Index].SetBlocks(Writes.data(), Writes.size(), PreviousIDs.data());
+
+			mReplayEdits.erase(ChunkEdits);
+			DoesntNeedRebuild = false;
+		}
+	}
 
-	mLoadList = std::queue<Vector3i>();
-	mRebuildList.clear();
-	mRenderList.clear();
+	ShowResidentSlot(Index, ChunkPosition);
 
-	mMustShutdown = false;
-}
+	// Light the chunk on its own. Light crossing its borders is joined on the main thread.
+	FChunkLight Light(FChunk::BLOCKS_PER_CHUNK);
+	mChunks[Index].ReadBlocks([&](const FBlockStorage& Blocks)
+	{
+		FLightPropagator::LightChunk(Blocks, Light);
+		mColumnHeights.RaiseColumns(ChunkPosition, Blocks);
+	});
+	{
+		std::lock_guard<std::mutex> LightLock(mLightMutex);
+		mChunks[Index].GetLight().Swap(Light);
+	}
+	mPipelineStats.AddStageTime(EChunkStage::Decode, DecodeBegin, FClock::ReadSystemTimer());
 
-void FChunkManager::LoadWorld(const wchar_t* WorldName)
-{
-	Shutdown();
-	mFileSystem.SetWorld(WorldName);
+	// The swap of a load always goes in, as it makes the chunk visible. Edits made while meshing rebuild it after.
+	if (!DoesntNeedRebuild)
+		MeshChunk(Index, ChunkPosition);
 
-	mWorldSize = mFileSystem.GetWorldSize();
-	InitializeWorld();
-}
+	BufferSwapLock.lock();
+		QueueBufferSwap(Index, ChunkPosition);
+		mSwapQueueTimes[Index] = Read.QueueTime;
+	BufferSwapLock.unlock();
+	mPipelineStats.AddLoad();
 
-void FChunkManager::SaveWorld()
-{
-	Shutdown();
-	mFileSystem.SaveWorld();
-	InitializeWorld();
+	// The chunk is only found by the light pass once its swap is queued
+	{
+		std::lock_guard<std::mutex> LightLock(mLightMutex);
+		mLightLoads.push_back(ChunkPosition);
+	}
+
+	// Loaded neighbors may now have faces hidden by this chunk. Opposite faces only differ by the first bit.
+	if (!DoesntNeedRebuild)
+	{
+		for (uint32_t Face = 0; Face < 6; Face++)
+		{
+			const int32_t NeighborIndex = FindLoadedChunk(ChunkPosition + FACE_OFFSETS[Face]);
+			if (NeighborIndex != -1)
+				QueueChunkRebuild(NeighborIndex, FChunk::FaceSections(Face ^ 1));
+		}
+	}
 }
 
-void FChunkManager::SetViewDistance(const uint32_t Distance)
+void FChunkManager::RebuildChunk(const uint32_t Index, const bool IsEdit)
 {
-	Shutdown();
-	ReallocateChunkData(Distance);
+	CPU_PROFILE("ChunkRebuild");
 
-	InitializeWorld();
-}
+	if (mMustShutdown)
+		return;
 
-void FChunkManager::InitializeWorld()
-{
-	// Set chunk positions to invalid value
-	for (uint32_t i = 0; i < ChunkCount(); i++)
+	std::unique_lock<std::mutex> BufferSwapLock(mBufferSwapMutex);
+
+	Vector3i ChunkPosition = mChunkPositions[Index];
+
+	// Check if it is waiting for a buffer swap and take the swap back if it is. The
+	// pending swap holds the newest position for this slot.
+	const bool IsSwapTaken = (mSwapPositions[Index].y != INVALID_CHUNK_COORDINATE);
+	if (IsSwapTaken)
 	{
-		mChunkPositions[i] = Vector4i{ -1, -1, -1 };
+		ChunkPosition = mSwapPositions[Index];
+		mSwapPositions[Index] = INVALID_CHUNK_POSITION;
 	}
+	BufferSwapLock.unlock();
 
-	// Activate loader thread
-	mNeedsToRefreshVisibleList = true;
-	mLoaderThread = std::thread(&FChunkManager::ChunkLoaderThreadLoop, this);
+	if (ChunkPosition.y != INVALID_CHUNK_COORDINATE)
+	{
+		// A mesh of blocks replaced while meshing is dropped, the edit replacing them queued the
+		// rebuild that follows. A swap taken back may be of a newly loaded chunk, so it still goes in.
+		if (MeshChunk(Index, ChunkPosition) || IsSwapTaken)
+		{
+			BufferSwapLock.lock();
+				QueueBufferSwap(Index, ChunkPosition, IsEdit);
+			BufferSwapLock.unlock();
+		}
+	}
 }
 
-void FChunkManager::ReallocateChunkData(const int32_t NewViewDistance)
+bool FChunkManager::MeshChunk(const uint32_t Index, const Vector3i& ChunkPosition)
 {
-	const uint32_t Size = ChunkCount();
-	for (uint32_t i = 0; i < Size; i++)
+	// Sections are taken before their borders and light are read, so later changes dirty them again
+	uint32_t SectionMask = mChunks[Index].TakeDirtySections();
+
+	// Headless chunks are only simulated, their dirty sections are dropped
+	if (mIsHeadless)
+		return true;
+
+	// Sections of a GPU mesh still in flight are built again along with the rest
+	uint32_t MeshSerial;
+	SectionMask |= DropGPUMesh(Index, MeshSerial);
+
+	const uint32_t LODLevel = GetLODLevel(ChunkPosition);
+	if (mUsesGPUMeshing && LODLevel == 0)
 	{
-		mChunks[i].ShutDown(*mPhysicsSystem);
+		// Only the chunk's data is gathered here, the mesh is built on the GPU
+		const uint64_t GatherBegin = FClock::ReadSystemTimer();
+		std::unique_ptr<FChunkGPUMesher::Request> Request{ new FChunkGPUMesher::Request };
+		Request->Index = Index;
+		Request->Serial = MeshSerial;
+		Request->Input.SectionMask = mChunks[Index].PrepareGPUMesh(SectionMask, reinterpret_cast<FBlock*>(Request->Input.Blocks));
+
+		if (Request->Input.SectionMask != 0)
+		{
+			GetNeighborBorders(ChunkPosition, Request->Input.Neighbors);
+			{
+				std::lock_guard<std::mutex> LightLock(mLightMutex);
+				mChunks[Index].GetLight().Unpack(Request->Input.Light);
+			}
+
+			QueueGPUMesh(std::move(Request));
+		}
+
+		mPipelineStats.AddStageTime(EChunkStage::Mesh, GatherBegin, FClock::ReadSystemTimer());
+		return true;
 	}
 
-	mViewDistance = NewViewDistance;
-	const uint32_t NewSize = ChunkCount();
+	FChunk::NeighborBorders Neighbors;
+	GetNeighborBorders(ChunkPosition, Neighbors);
+	{
+		std::lock_guard<std::mutex> LightLock(mLightMutex);
+		mChunks[Index].GetLight().Unpack(LightScratch);
+	}
 
-	// Resize data
-	delete[] mChunks;
-	delete[] mChunkPositions;
-	mChunks = new FChunk[NewSize];
-	mChunkPositions = new Vector4i[NewSize];
+	FChunkMeshCache* MeshCache = mMeshCache.IsOpen() ? &mMeshCache : nullptr;
+	const uint64_t MeshBegin = FClock::ReadSystemTimer();
+	const bool IsCurrent = mChunks[Index].RebuildMesh(ChunkPosition * FChunk::CHUNK_SIZE, Neighbors, LightScratch, SectionMask, LODLevel, MeshCache);
+	mPipelineStats.AddStageTime(EChunkStage::Mesh, MeshBegin, FClock::ReadSystemTimer());
+	return IsCurrent;
 }
 
-void FChunkManager::UnloadAllChunks()
+void FChunkManager::QueueChunkRebuild(const uint32_t Index, const uint32_t SectionMask, const bool IsEdit)
 {
-	const uint32_t Size = ChunkCount();
-	for (uint32_t i = 0; i < Size; i++)
-	{
-		if (mChunks[i].IsLoaded())
-		{
-			const Vector3i UnloadChunkPosition = mChunkPositions[i];
+	mChunks[Index].MarkSectionsDirty(SectionMask);
 
-			if (UnloadChunkPosition.y != -1)
-			{
-				// Buffer for all chunk data
-				std::vector<uint8_t> ChunkData;
+	std::unique_lock<std::mutex> Lock(mRebuildListMutex);
 
-				// Unload the chunk currently in this index
-				mChunks[i].Unload(ChunkData);
+	// Edits go straight to the workers while they run. A rebuild that hasn't started takes the sections
+	// dirtied since, one that has leaves them to the next. Jobs on the slot still run in order.
+	if (IsEdit && mWorkerPool.GetWorkerCount() > 0)
+	{
+		if (mIsEditRebuildQueued[Index])
+			return;
+		mIsEditRebuildQueued[Index] = true;
+		Lock.unlock();
 
-				// Write the data to file
-				mFileSystem.WriteChunkData(UnloadChunkPosition, ChunkData);
+		mWorkerPool.Submit(Index, [this, Index]()
+		{
+			{
+				std::lock_guard<std::mutex> RebuildLock(mRebuildListMutex);
+				mIsEditRebuildQueued[Index] = false;
 			}
-		}
+			RebuildChunk(Index, true);
+		}, true);
+		return;
 	}
 
-	mFileSystem.ClearAllRegionFileReferences();
+	if (!mIsRebuildQueued[Index])
+	{
+		mIsRebuildQueued[Index] = true;
+		mRebuildList.push_back(Index);
+	}
 }
 
-void FChunkManager::Render(FRenderSystem& Renderer, const GLenum RenderMode)
+void FChunkManager::QueueBorderRebuilds(const Vector3i& ChunkPosition, const Vector3i& LocalPosition)
 {
-	UpdateRenderList();
+	QueueFaceRebuilds(ChunkPosition, BorderFaces(LocalPosition));
+}
 
-	// Render everything in the renderlist
-	for (const auto& Index : mRenderList)
+void FChunkManager::QueueFaceRebuilds(const Vector3i& ChunkPosition, const uint32_t FaceMask)
+{
+	for (uint32_t Face = 0; Face < 6; Face++)
 	{
-		if (mChunks[Index].IsLoaded())
+		if (FaceMask & (1 << Face))
 		{
-			mChunks[Index].Render(RenderMode);
+			const int32_t NeighborIndex = FindLoadedChunk(ChunkPosition + FACE_OFFSETS[Face]);
+			if (NeighborIndex != -1)
+				QueueChunkRebuild(NeighborIndex, FChunk::FaceSections(Face ^ 1), true);
 		}
 	}
 }
 
-void FChunkManager::Update()
+void FChunkManager::QueueLODRebuilds()
 {
-	// Get the chunk that the camera is currently in.
-	const Vector3i CameraChunk = FCamera::Main->Transform.GetWorldPosition() / FChunk::CHUNK_SIZE;
-
-	// Only update visibility list when that camera crosses a chunk boundary
-	if (mLastCameraChunk != CameraChunk)
+	for (uint32_t Index = 0; Index < ChunkCount(); Index++)
 	{
-		mLastCameraChunk = CameraChunk;
-		mNeedsToRefreshVisibleList = true;
+		const Vector3i ChunkPosition = mChunkPositions[Index];
+
+		// Empty chunks have no mesh at any level
+		if (ChunkPosition.y == INVALID_CHUNK_COORDINATE || !mChunks[Index].IsLoaded() || mChunks[Index].IsEmpty())
+			continue;
+
+		if (mChunks[Index].GetMeshLOD() != GetLODLevel(ChunkPosition))
+			QueueChunkRebuild(Index);
 	}
+}
 
-	SwapChunkBuffers();
+uint32_t FChunkManager::GetLODLevel(const Vector3i& ChunkPosition)
+{
+	std::lock_guard<std::mutex> Lock(mCameraMutex);
+
+	const Vector3i Offset = ChunkPosition - mLastCameraChunk;
+	const uint32_t Distance = (uint32_t)std::max({ std::abs(Offset.x), std::abs(Offset.y), std::abs(Offset.z) });
+
+	uint32_t Level = 0;
+	while (Level + 1 < FChunk::LOD_LEVELS && Distance >= mLODDistances[Level + 1])
+		Level++;
+
+	return Level;
 }
 
-void FChunkManager::SwapChunkBuffers()
+int32_t FChunkManager::FindLoadedChunk(const Vector3i& ChunkPosition)
 {
-	std::unique_lock<std::mutex> Lock(mBufferSwapMutex, std::try_to_lock);
+	if (!IsInWorld(ChunkPosition))
+		return -1;
 
-	if (Lock.owns_lock())
-	{
-		int32_t SwapCount = MESH_SWAPS_PER_FRAME;
-		while (SwapCount > 0 && !mBufferSwapQueue.empty())
-		{
-			const Vector3i ChunkPosition = mBufferSwapQueue.front();
-			mBufferSwapQueue.pop_front();
+	const int32_t Index = ChunkIndex(ChunkPosition);
 
-			const uint32_t Index = ChunkIndex(ChunkPosition);
+	// A pending buffer swap holds the newest position for the slot
+	std::lock_guard<std::mutex> Lock(mBufferSwapMutex);
+	const Vector3i LoadedPosition = (mSwapPositions[Index].y != INVALID_CHUNK_COORDINATE) ? mSwapPositions[Index] : Vector3i{ mChunkPositions[Index] };
 
-			mChunks[Index].SwapMeshBuffer(*mPhysicsSystem);
+	if (LoadedPosition == ChunkPosition && mChunks[Index].IsLoaded())
+		return Index;
 
-			mChunkPositions[Index] = Vector4i{ ChunkPosition, 1 };
-			SwapCount--;
-		}
-	}
+	return -1;
 }
 
-#undef min
-#undef max
-void FChunkManager::SetBlock(const Vector3i& Position, FBlockTypes::BlockID ID)
+void FChunkManager::GetNeighborBorders(const Vector3i& ChunkPosition, FChunk::NeighborBorders& NeighborsOut)
 {
-	int32_t BlockWorldSize = mWorldSize * FChunk::CHUNK_SIZE;
+	std::lock_guard<std::mutex> LightLock(mLightMutex);
 
-	if (std::min({ Position.x, Position.y, Position.z }) >= 0 && std::max({ Position.x, Position.y, Position.z }) < BlockWorldSize)
+	for (uint32_t Face = 0; Face < 6; Face++)
 	{
-		const Vector4i ChunkPosition = Vector4i(Position / FChunk::CHUNK_SIZE, 1);
-		const Vector3i LocalPosition = Vector3i{ Position.x % FChunk::CHUNK_SIZE, Position.y % FChunk::CHUNK_SIZE, Position.z % FChunk::CHUNK_SIZE };
-
-		int32_t Index = ChunkIndex(ChunkPosition);
+		const int32_t NeighborIndex = FindLoadedChunk(ChunkPosition + FACE_OFFSETS[Face]);
 
-		// Only set if the right chunk is loaded
-		if (ChunkPosition == mChunkPositions[Index])
+		// Missing neighbors leave border faces visible and lit by the sky.
+		// The opposite face only differs by the first bit.
+		if (NeighborIndex != -1)
 		{
-			mChunks[Index].SetBlock(LocalPosition, ID);
-			mOnBlockSet.Invoke(Position, ID);
-
-			std::lock_guard<std::mutex> Lock(mRebuildListMutex);
-			if (std::find(mRebuildList.begin(), mRebuildList.end(), Index) == mRebuildList.end())
-				mRebuildList.push_back(Index);
+			mChunks[NeighborIndex].GetBorder(Face ^ 1, NeighborsOut.Solid[Face]);
+			mChunks[NeighborIndex].GetBorderLight(Face ^ 1, NeighborsOut.Light[Face]);
+		}
+		else
+		{
+			std::fill_n(NeighborsOut.Solid[Face], FChunk::CHUNK_SIZE, 0u);
+			std::memset(NeighborsOut.Light[Face], FChunkLight::PackLevels(FChunkLight::MAX_LEVEL, 0), sizeof(NeighborsOut.Light[Face]));
 		}
 	}
 }
 
-FBlockTypes::BlockID FChunkManager::GetBlock(Vector3i Position) const
+void FChunkManager::QueueBufferSwap(const uint32_t Index, const Vector3i& ChunkPosition, const bool IsEdit)
 {
-	int32_t BlockWorldSize = mWorldSize * FChunk::CHUNK_SIZE;
+	// Only queue the index once in each lane. A stale entry that was taken back
+	// by a worker can still be reused, and one in the edit lane keeps its lane.
+	// Swaps queued in both are done by the edit lane and dropped by the other.
+	if (IsEdit && !mIsEditSwapQueued[Index])
+	{
+		mIsEditSwapQueued[Index] = true;
+		mEditSwapQueue.push_back(Index);
+	}
+	else if (mSwapPositions[Index].y == INVALID_CHUNK_COORDINATE && !mIsEditSwapQueued[Index])
+	{
+		mBufferSwapQueue.push_back(Index);
+	}
+
+	mSwapPositions[Index] = ChunkPosition;
+}
 
-	if (std::min({ Position.x, Position.y, Position.z }) >= 0 && std::max({ Position.x, Position.y, Position.z }) < BlockWorldSize)
+void FChunkManager::UpdateVisibleList()
+{
+	Vector3i CameraChunk;
+	FFrustum ViewFrustum;
 	{
-		const Vector4i ChunkPosition = Vector4i(Position / FChunk::CHUNK_SIZE, 1);
-		Position = Vector3i{ Position.x % FChunk::CHUNK_SIZE, Position.y % FChunk::CHUNK_SIZE, Position.z % FChunk::CHUNK_SIZE };
+		std::lock_guard<std::mutex> Lock(mCameraMutex);
+		CameraChunk = mLastCameraChunk;
+		ViewFrustum = mLoadFrustum;
+	}
 
-		int32_t Index = ChunkIndex(ChunkPosition);
+	// Re-prioritize chunks still waiting to load and drop the ones
+	// that have been loaded or left the view range.
+	for (uint32_t i = 0; i < mLoadList.size();)
+	{
+		LoadRequest& Request = mLoadList[i];
+		const int32_t Index = ChunkIndex(Request.Position);
 
-		// Only get if the right chunk is loaded
-		if (ChunkPosition == mChunkPositions[Index])
+		if (!IsInViewRange(Request.Position, CameraChunk) || mChunkPositions[Index] == Vector4i{ Request.Position, 1 })
+		{
+			mLoadListPositions[Index] = INVALID_CHUNK_POSITION;
+			Request = mLoadList.back();
+			mLoadList.pop_back();
+		}
+		else
 		{
-			return mChunks[Index].GetBlock(Position);
+			Request.Priority = LoadPriority(Request.Position, CameraChunk, ViewFrustum);
+			i++;
 		}
 	}
 
-	return FBlock::AIR_BLOCK_ID;
-}
-
-void FChunkManager::DestroyBlock(const Vector3i& Position)
-{
-	int32_t BlockWorldSize = mWorldSize * FChunk::CHUNK_SIZE;
+	const Vector3i ViewRange{ mViewDistance, mVerticalViewDistance, mViewDistance };
+	const Vector3i NewMin = CameraChunk - ViewRange;
+	const Vector3i NewMax = CameraChunk + ViewRange;
 
-	if (std::min({ Position.x, Position.y, Position.z }) >= 0 && std::max({ Position.x, Position.y, Position.z }) < BlockWorldSize)
+	if (mNeedsFullVisibleScan)
+	{
+		QueueVolumeLoads(NewMin, NewMax, CameraChunk, ViewFrustum);
+		mNeedsFullVisibleScan = false;
+	}
+	else
 	{
-		const Vector4i ChunkPosition = Vector4i(Position / FChunk::CHUNK_SIZE, 1);
-		const Vector3i LocalPosition = Vector3i{ Position.x % FChunk::CHUNK_SIZE, Position.y % FChunk::CHUNK_SIZE, Position.z % FChunk::CHUNK_SIZE };
+		// Only the slabs that entered the view volume need to be scanned. Everything else in
+		// the volume is already loaded or waiting in the load list.
+		const Vector3i OldMin = mScannedCameraChunk - ViewRange;
+		const Vector3i OldMax = mScannedCameraChunk + ViewRange;
+
+		Vector3i SlabMin = NewMin;
+		Vector3i SlabMax = NewMax;
+		for (uint32_t Axis = 0; Axis < 3; Axis++)
+		{
+			if (CameraChunk[Axis] == mScannedCameraChunk[Axis])
+				continue;
 
-		int32_t Index = ChunkIndex(ChunkPosition);
+			// The slab along this axis that was not in the old volume
+			Vector3i EnteredMin = SlabMin;
+			Vector3i EnteredMax = SlabMax;
+			if (CameraChunk[Axis] > mScannedCameraChunk[Axis])
+				EnteredMin[Axis] = std::max(NewMin[Axis], OldMax[Axis] + 1);
+			else
+				EnteredMax[Axis] = std::min(NewMax[Axis], OldMin[Axis] - 1);
 
-		// Only destroy if the right chunk is loaded
-		if (ChunkPosition == mChunkPositions[Index])
-		{
-			const FBlockTypes::BlockID ID = mChunks[Index].DestroyBlock(LocalPosition);
-			mOnBlockDestroy.Invoke(Position, ID);
+			QueueVolumeLoads(EnteredMin, EnteredMax, CameraChunk, ViewFrustum);
 
-			std::lock_guard<std::mutex> Lock(mRebuildListMutex);
-			if (std::find(mRebuildList.begin(), mRebuildList.end(), Index) == mRebuildList.end())
-				mRebuildList.push_back(Index);
+			// The remaining axes only scan the part shared with the old volume
+			SlabMin[Axis] = std::max(NewMin[Axis], OldMin[Axis]);
+			SlabMax[Axis] = std::min(NewMax[Axis], OldMax[Axis]);
 		}
 	}
+
+	mScannedCameraChunk = CameraChunk;
+
+	// Order all waiting chunks by their new priorities
+	std::make_heap(mLoadList.begin(), mLoadList.end());
+	mLoadListDepth = mLoadList.size();
+
+	// Chunks may have crossed into another detail level
+	QueueLODRebuilds();
 }
 
-void FChunkManager::SetPhysicsSystem(FPhysicsSystem& Physics)
+void FChunkManager::QueueChunkLoad(const Vector3i& ChunkPosition, const Vector3i& CameraChunk, const FFrustum& ViewFrustum)
 {
-	mPhysicsSystem = &Physics;
+	const int32_t Index = ChunkIndex(ChunkPosition);
+
+	// If this visible chunk is not loaded or waiting, load it.
+	if (mChunkPositions[Index] != Vector4i{ ChunkPosition, 1 } && mLoadListPositions[Index] != ChunkPosition)
+	{
+		mLoadList.push_back(LoadRequest{ ChunkPosition, LoadPriority(ChunkPosition, CameraChunk, ViewFrustum), FClock::ReadSystemTimer() });
+		mLoadListPositions[Index] = ChunkPosition;
+	}
 }
 
-void FChunkManager::ChunkLoaderThreadLoop()
+void FChunkManager::QueueVolumeLoads(Vector3i Min, Vector3i Max, const Vector3i& CameraChunk, const FFrustum& ViewFrustum)
 {
-	while (!mMustShutdown)
+	// Clamp the volume to bounded worlds
+	if (mWorldSize != 0)
 	{
-		while (!mMustShutdown && !mNeedsToRefreshVisibleList)
+		Min = Vector3i{ std::max(Min.x, 0), std::max(Min.y, 0), std::max(Min.z, 0) };
+		Max = Vector3i{ std::min(Max.x, mWorldSize - 1), std::min(Max.y, mWorldSize - 1), std::min(Max.z, mWorldSize - 1) };
+	}
+
+	for (int32_t y = Min.y; y <= Max.y; y++)
+	{
+		for (int32_t x = Min.x; x <= Max.x; x++)
 		{
-			UpdateRebuildList();
-			UpdateLoadList();
+			for (int32_t z = Min.z; z <= Max.z; z++)
+			{
+				QueueChunkLoad(Vector3i{ x, y, z }, CameraChunk, ViewFrustum);
+			}
 		}
-
-		mNeedsToRefreshVisibleList = false;
-		UpdateVisibleList();
 	}
 }
 
-void FChunkManager::UpdateLoadList()
+float FChunkManager::LoadPriority(const Vector3i& ChunkPosition, const Vector3i& CameraChunk, const FFrustum& ViewFrustum) const
 {
-	uint32_t LoadsLeft = CHUNKS_TO_LOAD_PER_ITERATION;
+	const Vector3i Offset = ChunkPosition - CameraChunk;
+	float Priority = std::sqrt((float)Vector3i::Dot(Offset, Offset));
 
-	std::unique_lock<std::mutex> BufferSwapLock(mBufferSwapMutex, std::defer_lock);
+	if (ViewFrustum.IsUniformAABBVisible(Vector4f{ ChunkPosition, 1.0f }, 1.0f))
+		Priority -= FRUSTUM_PRIORITY_BONUS;
 
-	// Buffer for all chunk data
-	std::vector<uint8_t> ChunkData;
-	while (!mLoadList.empty() && LoadsLeft > 0)
-	{
-		Vector3i ChunkPosition = mLoadList.front();
-		mLoadList.pop();
+	return Priority;
+}
 
-		const uint32_t Index = ChunkIndex(ChunkPosition);
+bool FChunkManager::IsInViewRange(const Vector3i& ChunkPosition, const Vector3i& CameraChunk) const
+{
+	const Vector3i Offset = ChunkPosition - CameraChunk;
+	return std::abs(Offset.x) <= mViewDistance && std::abs(Offset.z) <= mViewDistance && std::abs(Offset.y) <= mVerticalViewDistance;
+}
+
+bool FChunkManager::IsInResidentRange(const Vector3i& ChunkPosition, const Vector3i& CameraChunk) const
+{
+	const Vector3i Offset = ChunkPosition - CameraChunk;
+	const int32_t Distance = mViewDistance + mEvictionMargin;
+	return std::abs(Offset.x) <= Distance && std::abs(Offset.z) <= Distance && std::abs(Offset.y) <= mVerticalViewDistance + mEvictionMargin;
+}
 
-		// Get region position info for unloaded chunk
-		Vector3i UnloadChunkPosition = mChunkPositions[Index];
+void FChunkManager::RecordEviction(const Vector3i& ChunkPosition)
+{
+	const uint64_t Now = FClock::ReadSystemTimer();
+	mEvictionTimes[ChunkPosition] = Now;
 
-		// If this chunk is already in the swap list, remove it. This prevents redundant buffer swaps and
-		// tells us which chunk position is really currently loaded within the chunk data.
-		BufferSwapLock.lock();
-		auto InSwapList = std::find(mBufferSwapQueue.begin(), mBufferSwapQueue.end(), ChunkPosition);
-		if (InSwapList != mBufferSwapQueue.end())
+	// Evictions too old to count as thrash are dropped once there are more than there are slots
+	if (mEvictionTimes.size() > ChunkCount())
+	{
+		const uint64_t ThrashCycles = FClock::SecondsToCycles(THRASH_SECONDS);
+		for (auto Itr = mEvictionTimes.begin(); Itr != mEvictionTimes.end();)
 		{
-			UnloadChunkPosition = *InSwapList;
-			mBufferSwapQueue.erase(InSwapList);
+			if (Now - Itr->second >= ThrashCycles)
+				Itr = mEvictionTimes.erase(Itr);
+			else
+				Itr++;
 		}
-		BufferSwapLock.unlock();
+	}
+}
 
-		///// Unload Chunk ////////////////////////////////////////////////////////////////
-		///////////////////////////////////////////////////////////////////////////////////
-		if (mChunks[Index].IsLoaded())
-		{
-			// Unload the chunk currently in this index
-			mChunks[Index].Unload(ChunkData);
+FFrustum FChunkManager::GetChunkViewFrustum() const
+{
+	// The the current view frustum in chunk coord
+	FMatrix4 ToChunkCoord;
+	ToChunkCoord.Scale(1.0f / (float)FChunk::CHUNK_SIZE);
+	ToChunkCoord.SetOrigin(-Vector3f{ 0.5f, 0.5f, 0.5f }); // align with center of chunks
 
-			ASSERT(UnloadChunkPosition.y != -1);
-			// Write the data to file
-			mFileSystem.WriteChunkData(UnloadChunkPosition, ChunkData);
-			mFileSystem.RemoveRegionFileReference(UnloadChunkPosition);
-		}
+	FFrustum ViewFrustum = GetCamera()->GetWorldViewFrustum();
+	ViewFrustum.TransformBy(ToChunkCoord);
 
-		///// Load Chunk /////////////////////////////////////////////////////////////////////
-		//////////////////////////////////////////////////////////////////////////////////////
-		
-		// Get info for chunk data within its region
-		ChunkData.clear();
-		mFileSystem.AddRegionFileReference(ChunkPosition);
-		mFileSystem.GetChunkData(ChunkPosition, ChunkData);
-	
-		// Load and build the chunk
-		Vector3i WorldPosition = ChunkPosition * FChunk::CHUNK_SIZE;
-		bool DoesntNeedRebuild = mChunks[Index].Load(ChunkData);
+	return ViewFrustum;
+}
 
-		if (!DoesntNeedRebuild)
-			mChunks[Index].RebuildMesh(WorldPosition);
+template <typename Function>
+void FChunkManager::ForEachGroupSlot(const uint32_t Group, Function Call) const
+{
+	const int32_t HorizontalBits = std::min(GROUP_SLOT_BITS, mHorizontalSlotBits);
+	const int32_t VerticalBits = std::min(GROUP_SLOT_BITS, mVerticalSlotBits);
+	const int32_t HorizontalGroupBits = mHorizontalSlotBits - HorizontalBits;
 
-		BufferSwapLock.lock();
-			mBufferSwapQueue.push_back(ChunkPosition);
-		BufferSwapLock.unlock();
+	// Groups are laid out as slots are, z then x then y
+	const uint32_t GroupMask = (1u << HorizontalGroupBits) - 1;
+	const uint32_t FirstZ = (Group & GroupMask) << HorizontalBits;
+	const uint32_t FirstX = ((Group >> HorizontalGroupBits) & GroupMask) << HorizontalBits;
+	const uint32_t FirstY = (Group >> (2 * HorizontalGroupBits)) << VerticalBits;
 
-		ChunkData.clear();
-		LoadsLeft--;
+	for (uint32_t y = FirstY; y < FirstY + (1u << VerticalBits); y++)
+	{
+		for (uint32_t x = FirstX; x < FirstX + (1u << HorizontalBits); x++)
+		{
+			for (uint32_t z = FirstZ; z < FirstZ + (1u << HorizontalBits); z++)
+				Call(z | (x << mHorizontalSlotBits) | (y << (2 * mHorizontalSlotBits)));
+		}
 	}
 }
 
-void FChunkManager::UpdateRebuildList()
+uint32_t FChunkManager::ChunkGroupIndex(const uint32_t Index) const
 {
-	std::unique_lock<std::mutex> RebuildLock(mRebuildListMutex);
-	std::unique_lock<std::mutex> BufferSwapLock(mBufferSwapMutex, std::defer_lock);
+	const int32_t HorizontalBits = std::min(GROUP_SLOT_BITS, mHorizontalSlotBits);
+	const int32_t VerticalBits = std::min(GROUP_SLOT_BITS, mVerticalSlotBits);
+	const int32_t HorizontalGroupBits = mHorizontalSlotBits - HorizontalBits;
 
-	while (!mRebuildList.empty())
-	{
-		int32_t ChunkIndex = mRebuildList.front();
-		mRebuildList.pop_front();
-		RebuildLock.unlock();
+	const uint32_t HorizontalMask = (1u << mHorizontalSlotBits) - 1;
+	const uint32_t z = Index & HorizontalMask;
+	const uint32_t x = (Index >> mHorizontalSlotBits) & HorizontalMask;
+	const uint32_t y = Index >> (2 * mHorizontalSlotBits);
 
-		const Vector3i ChunkPosition = mChunkPositions[ChunkIndex];
-		if (ChunkPosition.y != -1)
-		{
-			// Check if its already in the swap list and remove if it is.
-			BufferSwapLock.lock();
-			auto InSwapList = std::find(mBufferSwapQueue.begin(), mBufferSwapQueue.end(), ChunkPosition);
-			if (InSwapList != mBufferSwapQueue.end())
-				mBufferSwapQueue.erase(InSwapList);
-			BufferSwapLock.unlock();
+	return (z >> HorizontalBits) | ((x >> HorizontalBits) << HorizontalGroupBits) | ((y >> VerticalBits) << (2 * HorizontalGroupBits));
+}
 
-			mChunks[ChunkIndex].RebuildMesh(ChunkPosition * FChunk::CHUNK_SIZE);
+void FChunkManager::ResetChunkGroups()
+{
+	const int32_t HorizontalGroupBits = mHorizontalSlotBits - std::min(GROUP_SLOT_BITS, mHorizontalSlotBits);
+	const int32_t VerticalGroupBits = mVerticalSlotBits - std::min(GROUP_SLOT_BITS, mVerticalSlotBits);
 
-			BufferSwapLock.lock();
-				mBufferSwapQueue.push_back(mChunkPositions[ChunkIndex]);
-			BufferSwapLock.unlock();
-		}
-		RebuildLock.lock();
-	}
+	mChunkGroups.assign(1u << (2 * HorizontalGroupBits + VerticalGroupBits), ChunkGroup{ Vector3i{}, Vector3i{}, 0, true });
+	mHasGroupMesh.assign(ChunkCount(), 0);
+
+	// Chunks kept through a reallocation keep their meshes
+	for (uint32_t i = 0; i < ChunkCount(); i++)
+		UpdateChunkGroup(i);
 }
 
-void FChunkManager::UpdateVisibleList()
+void FChunkManager::UpdateChunkGroup(const uint32_t Index)
 {
-	// Offset the camera chunk position so the loop centers the camera
-	Vector3i CameraChunkOffset = mLastCameraChunk - Vector3i{ mViewDistance, 0, mViewDistance };
+	const uint8_t HasMesh = mChunks[Index].IsEmpty() ? 0 : 1;
+	ChunkGroup& Group = mChunkGroups[ChunkGroupIndex(Index)];
+
+	// The slot may have taken a new position even when its mesh didn't change
+	Group.MeshCount = Group.MeshCount + HasMesh - mHasGroupMesh[Index];
+	Group.IsBoundsDirty = true;
+	mHasGroupMesh[Index] = HasMesh;
+}
 
-	// Get the total range of visible area.
-	const int32_t HorizontalBounds = 2 * mViewDistance + 1;
+void FChunkManager::UpdateRenderList(const Vector3f& ViewPosition, const FFrustum& ViewFrustum)
+{
+	// Start with a fresh list
+	mRenderList.clear();
+	mRenderSortItems.clear();
+	mCasterList.clear();
 
-	// Clear previous load and visibile list when moving across chunks.
-	mLoadList = std::queue<Vector3i>();
+	// Without connectivity culling the chunks left by the group tests are drawn
+	const bool IsConnected = mUsesConnectivityCulling && FindConnectedChunks(ViewPosition, ViewFrustum, mConnectedList);
+	if (!IsConnected)
+		mConnectedList.clear();
 
-	// Add all chunks in the visible range to the visible list.
-	// First add the xz plane that the camera is currently on.
-	if (CameraChunkOffset.y < mWorldSize && CameraChunkOffset.y >= 0)
+	const float HalfSize = FChunk::CHUNK_SIZE / 2.0f;
+	for (uint32_t Group = 0; Group < mChunkGroups.size(); Group++)
 	{
-		for (int32_t x = 0; x < HorizontalBounds; x++)
-		{
-			const int32_t xPosition = CameraChunkOffset.x + x;
-			if (xPosition >= mWorldSize || xPosition < 0)
-				continue;
+		ChunkGroup& Bounds = mChunkGroups[Group];
+		if (Bounds.MeshCount == 0)
+			continue;
 
-			for (int32_t z = 0; z < HorizontalBounds; z++)
+		// Bounds are only found again for groups swapped into since the last update
+		if (Bounds.IsBoundsDirty)
+		{
+			Bounds.Min = Vector3i{ INT32_MAX, INT32_MAX, INT32_MAX };
+			Bounds.Max = Vector3i{ INT32_MIN, INT32_MIN, INT32_MIN };
+			ForEachGroupSlot(Group, [&](const uint32_t i)
 			{
-				const int32_t zPosition = CameraChunkOffset.z + z;
-				if (zPosition >= mWorldSize || zPosition < 0)
-					continue;
-
-				const Vector4i ChunkPosition{ xPosition, CameraChunkOffset.y, zPosition, 1 };
-				const int32_t VisibleChunkIndex = ChunkIndex(ChunkPosition);
-
-				// If this visible chunk is not loaded, load it.
-				if (mChunkPositions[VisibleChunkIndex] != ChunkPosition)
-				{
-					mLoadList.push(ChunkPosition);
-				}
-			}
+				if (!mHasGroupMesh[i] || mChunkPositions[i].w == 0)
+					return;
+
+				const Vector3i ChunkPosition = mChunkPositions[i];
+				Bounds.Min = Vector3i{ std::min(Bounds.Min.x, ChunkPosition.x), std::min(Bounds.Min.y, ChunkPosition.y), std::min(Bounds.Min.z, ChunkPosition.z) };
+				Bounds.Max = Vector3i{ std::max(Bounds.Max.x, ChunkPosition.x), std::max(Bounds.Max.y, ChunkPosition.y), std::max(Bounds.Max.z, ChunkPosition.z) };
+			});
+			Bounds.IsBoundsDirty = false;
 		}
-	}
 
-	// Now add the world by alternating the xz planes from below to above the camera's chunk
-	for (int32_t v = 1; v <= mViewDistance / 2; v++)
-	{
-		for (int32_t y = -v; y < v + 1; y += 2 * v)
+		// Groups holding no placed chunk have nothing to draw, their chunks are still casters
+		FFrustum::Intersection Result = FFrustum::Intersection::Outside;
+		if (!IsConnected && Bounds.Min.x <= Bounds.Max.x)
 		{
-			const int32_t yPosition = CameraChunkOffset.y + y;
+			const Vector3i Origin = Bounds.Min * FChunk::CHUNK_SIZE;
+			const Vector3f Size = Vector3f{ (Bounds.Max - Bounds.Min) + Vector3i{ 1, 1, 1 } } * (float)FChunk::CHUNK_SIZE;
+			const Vector4f Center{ Origin.x + Size.x / 2.0f, Origin.y + Size.y / 2.0f, Origin.z + Size.z / 2.0f, 1.0f };
+			Result = ViewFrustum.IntersectsAABB(Center, Size);
+		}
 
-			if (yPosition >= mWorldSize || yPosition < 0)
-				continue;
+		// Shadows can be cast by chunks hidden from the camera, so every chunk with geometry is a caster
+		ForEachGroupSlot(Group, [&](const uint32_t i)
+		{
+			if (mChunks[i].IsEmpty() || !mChunks[i].IsLoaded())
+				return;
 
-			for (int32_t x = 0; x < HorizontalBounds; x++)
-			{
-				const int32_t xPosition = CameraChunkOffset.x + x;
+			mCasterList.push_back(i);
+			if (IsConnected || Result == FFrustum::Intersection::Outside)
+				return;
 
-				if (xPosition >= mWorldSize || xPosition < 0)
-					continue;
+			// Chunks of groups within every plane are within them too
+			const Vector3i Origin = Vector3i{ mChunkPositions[i] } * FChunk::CHUNK_SIZE;
+			if (Result == FFrustum::Intersection::Straddle &&
+				!ViewFrustum.IsUniformAABBVisible(Vector4f{ Origin.x + HalfSize, Origin.y + HalfSize, Origin.z + HalfSize, 1.0f }, (float)FChunk::CHUNK_SIZE))
+				return;
 
-				for (int32_t z = 0; z < HorizontalBounds; z++)
-				{
-					const int32_t zPosition = CameraChunkOffset.z + z;
+			mConnectedList.push_back(i);
+		});
+	}
 
-					if (zPosition >= mWorldSize || zPosition < 0)
-						continue;
+	// Occlusion and the frustum tests of what is left are done on the GPU
+	for (const uint32_t i : mConnectedList)
+	{
+		// Squared distances are positive, so their bits sort in the same order
+		const Vector3i Origin = Vector3i{ mChunkPositions[i] } * FChunk::CHUNK_SIZE;
+		const Vector3f Center = Vector3f{ Origin } + Vector3f{ 1, 1, 1 } * (FChunk::CHUNK_SIZE / 2.0f);
+		const Vector3f ToCenter = Center - ViewPosition;
+		const float DistanceSquared = Vector3f::Dot(ToCenter, ToCenter);
+
+		uint32_t Key;
+		memcpy(&Key, &DistanceSquared, sizeof(Key));
+		mRenderSortItems.push_back(FSort::MakeKeyedItem(Key, i));
+	}
 
-					const Vector4i ChunkPosition{ xPosition, yPosition, zPosition, 1 };
-					const int32_t VisibleChunkIndex = ChunkIndex(ChunkPosition);
+	// Front to back, so nearer chunks fill depth first and hide the fragments of those behind them
+	FSort::RadixSort(mRenderSortItems, mRenderSortScratch);
+	for (const uint64_t Item : mRenderSortItems)
+		mRenderList.push_back(FSort::GetItemValue(Item));
 
-					// If this visible chunk is not loaded, load it.
-					if (mChunkPositions[VisibleChunkIndex] != ChunkPosition)
-					{
-						mLoadList.push(ChunkPosition);
-					}
-				}
-			}
-		}
+	// Centers are built once here and shared by the shadow caster tests of every cascade
+	mCasterCenters.clear();
+	for (const auto& Index : mCasterList)
+	{
+		const Vector3i Origin = Vector3i{ mChunkPositions[Index] } * FChunk::CHUNK_SIZE;
+		mCasterCenters.push_back(Vector4f{ Origin.x + HalfSize, Origin.y + HalfSize, Origin.z + HalfSize, 1.0f });
 	}
 }
 
-void FChunkManager::UpdateRenderList()
+bool FChunkManager::FindConnectedChunks(const Vector3f& ViewPosition, const FFrustum& ViewFrustum, std::vector<uint32_t>& VisibleOut)
 {
-	// Start with a fresh list
-	mRenderList.clear();
+	CPU_PROFILE("FindConnectedChunks");
 
-	// The the current view frustum in chunk coord
-	FMatrix4 ToChunkCoord;
-	ToChunkCoord.Scale(1.0f / (float)FChunk::CHUNK_SIZE);
-	ToChunkCoord.SetOrigin(-Vector3f{ 0.5f, 0.5f, 0.5f }); // align with center of chunks
+	const Vector3f CameraPosition = ViewPosition / (float)FChunk::CHUNK_SIZE;
+	const Vector3i CameraChunk{ (int32_t)std::floor(CameraPosition.x), (int32_t)std::floor(CameraPosition.y), (int32_t)std::floor(CameraPosition.z) };
 
-	FFrustum ViewFrustum = FCamera::Main->GetWorldViewFrustum();
-	ViewFrustum.TransformBy(ToChunkCoord);
+	VisibleOut.clear();
+	if (!IsInWorld(CameraChunk))
+		return false;
 
-	// Check each visible chunk against the frustum
-	const uint32_t ListSize = ChunkCount();
+	// Positions within view range have distinct chunk indices, so indices mark what was reached
+	const uint32_t NO_FACE = 6;
+	const float HalfSize = FChunk::CHUNK_SIZE / 2.0f;
+	mIsVisibilityVisited.assign(ChunkCount(), 0);
+	mVisibilitySteps.clear();
 
-	for (uint32_t i = 0; i < ListSize; i++)
+	mVisibilitySteps.push_back(VisibilityStep{ CameraChunk, NO_FACE, 0 });
+	mIsVisibilityVisited[ChunkIndex(CameraChunk)] = 1;
+
+	for (size_t Next = 0; Next < mVisibilitySteps.size(); Next++)
 	{
-		Vector4f CenterFloats{mChunkPositions[i]};
+		// Copied, since pushing steps may move the queue
+		const VisibilityStep Step = mVisibilitySteps[Next];
+		const int32_t Index = ChunkIndex(Step.Position);
+
+		// Chunks that aren't loaded yet are seen through, so loading never hides what is behind them
+		uint32_t Connections = FChunk::ALL_FACE_CONNECTIONS;
+		if (mChunkPositions[Index] == Vector4i{ Step.Position, 1 } && mChunks[Index].IsLoaded())
+		{
+			Connections = mChunks[Index].GetFaceConnections();
+			if (!mChunks[Index].IsEmpty())
+				VisibleOut.push_back(Index);
+		}
 
-		if (!mChunks[i].IsEmpty() && ViewFrustum.IsUniformAABBVisible(CenterFloats, 1.0f))
+		for (uint32_t Face = 0; Face < 6; Face++)
 		{
-			mRenderList.push_back(i);
+			// Steps never turn back toward the camera
+			if (Step.Directions & (1 << (Face ^ 1)))
+				continue;
+			if (Step.EnteredFace != NO_FACE && !(Connections & FChunk::FaceConnection(Step.EnteredFace, Face)))
+				continue;
+
+			const Vector3i Neighbor = Step.Position + FACE_OFFSETS[Face];
+			if (!IsInWorld(Neighbor) || !IsInViewRange(Neighbor, CameraChunk))
+				continue;
+
+			const int32_t NeighborIndex = ChunkIndex(Neighbor);
+			if (mIsVisibilityVisited[NeighborIndex])
+				continue;
+
+			const Vector3i Origin = Neighbor * FChunk::CHUNK_SIZE;
+			if (!ViewFrustum.IsUniformAABBVisible(Vector4f{ Origin.x + HalfSize, Origin.y + HalfSize, Origin.z + HalfSize, 1.0f }, (float)FChunk::CHUNK_SIZE))
+				continue;
+
+			// The neighbor is entered through its face opposite the step
+			mIsVisibilityVisited[NeighborIndex] = 1;
+			mVisibilitySteps.push_back(VisibilityStep{ Neighbor, Face ^ 1, Step.Directions | (1 << Face) });
 		}
 	}
+
+	return true;
 }
\ No newline at end of file
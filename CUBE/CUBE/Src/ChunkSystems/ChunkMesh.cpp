@@ -1,73 +1,282 @@
 #include "ChunkSystems\ChunkMesh.h"
-#include "Rendering\GLBindings.h"
+#include "ChunkSystems\Chunk.h"
 #include "Rendering\GLUtils.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
 
 GLuint FChunkMesh::BufferUsageMode = GL_STATIC_DRAW;
 
 FChunkMesh::FChunkMesh()
-	: mVertexArray(0)
-	, mActiveBuffer()
+	: mBackSectionMask(0)
+	, mFrontQuadCount(0)
+	, mQuadBytes(EMemoryTag::ChunkMeshes)
+	, mGeometryArena(nullptr)
 {
-	mActiveBuffer = false;
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+	{
+		mFrontSections[i].QuadCount = 0;
+		mFrontSections[i].Ranges.fill(FaceRange{ 0, 0 });
+		ClearSection(mBackSections[i]);
+		mAllocations[i] = FChunkGeometryArena::Allocation{ 0, 0 };
+	}
+}
 
-	// Setup vertex and index data with dummy object
-	// to prevent nullptr references
-	mVertices[0] = VertexDataPtr{ new VertexData{} };
-	mVertices[1] = VertexDataPtr{ new VertexData{} };
 
-	mIndices[0] = IndexDataPtr{ new IndexData{} };
-	mIndices[1] = IndexDataPtr{ new IndexData{} };
+FChunkMesh::~FChunkMesh()
+{
+	if (mGeometryArena)
+	{
+		for (uint32_t i = 0; i < SECTION_COUNT; i++)
+			mGeometryArena->Free(mAllocations[i]);
+	}
+}
 
-	glGenVertexArrays(1, &mVertexArray);
-	glGenBuffers(2, mBuffers);
+void FChunkMesh::ClearSection(Section& SectionOut)
+{
+	SectionOut.Quads.clear();
+	SectionOut.Ranges.fill(FaceRange{ 0, 0 });
+}
 
-	glBindVertexArray(mVertexArray);
-		glBindBuffer(GL_ARRAY_BUFFER, mBuffers[Buffer::Vertex]);
-			glVertexAttribPointer(GLAttributePosition::Position, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(0));
-			glEnableVertexAttribArray(GLAttributePosition::Position);
-			glVertexAttribIPointer(GLAttributePosition::ChunkData, 1, GL_UNSIGNED_INT, sizeof(Vertex), BUFFER_OFFSET(offsetof(struct Vertex, BlockType)));
-			glEnableVertexAttribArray(GLAttributePosition::ChunkData);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBuffers[Buffer::Index]);
-	glBindVertexArray(0);
+FChunkMesh::QuadData& FChunkMesh::BeginSection(const uint32_t SectionIndex)
+{
+	ASSERT(SectionIndex < SECTION_COUNT);
 
+	// Rebuilds mostly come out close to the previous build of the section
+	QuadData& Quads = mBackSections[SectionIndex].Quads;
+	Quads.clear();
+	Quads.reserve(mFrontSections[SectionIndex].QuadCount);
+
+	return Quads;
 }
 
+void FChunkMesh::AddSection(const uint32_t SectionIndex, const FaceRanges& Ranges)
+{
+	ASSERT(SectionIndex < SECTION_COUNT);
+
+	mBackSections[SectionIndex].Ranges = Ranges;
+	mBackSectionMask |= 1 << SectionIndex;
 
-FChunkMesh::~FChunkMesh()
+	// Building may have grown the quad data
+	UpdateQuadBytes();
+}
+
+void FChunkMesh::UpdateQuadBytes()
+{
+	uint64_t Bytes = 0;
+	for (const Section& BackSection : mBackSections)
+		Bytes += BackSection.Quads.capacity() * sizeof(Quad);
+
+	mQuadBytes.Set(Bytes);
+}
+
+void FChunkMesh::ClearSections(const uint32_t SectionMask)
 {
-	glDeleteBuffers(2, mBuffers);
-	glDeleteVertexArrays(1, &mVertexArray);
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+	{
+		if (SectionMask & (1 << i))
+			ClearSection(mBackSections[i]);
+	}
+
+	mBackSectionMask |= SectionMask;
 }
 
-void FChunkMesh::AddVertexData(VertexDataPtr VertexData)
+const FChunkMesh::QuadData* FChunkMesh::GetBackSection(const uint32_t SectionIndex, FaceRanges& RangesOut) const
 {
-	mVertices[!mActiveBuffer] = std::move(VertexData);
+	ASSERT(SectionIndex < SECTION_COUNT);
+
+	if (!(mBackSectionMask & (1 << SectionIndex)))
+		return nullptr;
+
+	RangesOut = mBackSections[SectionIndex].Ranges;
+	return &mBackSections[SectionIndex].Quads;
 }
 
-void FChunkMesh::AddIndexData(IndexDataPtr Indices)
+uint32_t FChunkMesh::GetQuadCount(BackBuffer) const
 {
-	mIndices[!mActiveBuffer] = std::move(Indices);
+	uint32_t QuadCount = 0;
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+	{
+		if (mBackSectionMask & (1 << i))
+			QuadCount += mBackSections[i].Quads.size();
+	}
+
+	return QuadCount;
 }
 
-void FChunkMesh::Render(GLenum RenderMode)
+uint32_t FChunkMesh::GetSwappedQuadCount() const
 {
-	glBindVertexArray(mVertexArray);
-	glDrawElements(RenderMode, mIndices[mActiveBuffer]->size(), GL_UNSIGNED_INT, BUFFER_OFFSET(0));
+	uint32_t QuadCount = 0;
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+		QuadCount += (mBackSectionMask & (1 << i)) ? mBackSections[i].Quads.size() : mFrontSections[i].QuadCount;
+
+	return QuadCount;
 }
 
-void FChunkMesh::SwapBuffer()
+void FChunkMesh::AddDraw(FChunkDrawList& DrawList, const Vector3i& Origin, const Vector3f& ViewPosition) const
 {
-	glBindBuffer(GL_ARRAY_BUFFER, mBuffers[Buffer::Vertex]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * mVertices[!mActiveBuffer]->size(), mVertices[!mActiveBuffer]->data(), BufferUsageMode);
+	if (mFrontQuadCount == 0)
+		return;
+
+	uint32_t OriginIndex = 0;
+	bool HasOrigin = false;
+
+	for (uint32_t SectionIndex = 0; SectionIndex < SECTION_COUNT; SectionIndex++)
+	{
+		const ActiveSection& FrontSection = mFrontSections[SectionIndex];
+		if (FrontSection.QuadCount == 0)
+			continue;
+
+		const FaceRanges& Ranges = FrontSection.Ranges;
+		const FChunkGeometryArena::Allocation& Allocation = mAllocations[SectionIndex];
+
+		// Sections are ordered x, then y, then z
+		const float Size = (float)FChunk::SECTION_SIZE;
+		const Vector3f SectionOffset{ (float)(SectionIndex & 1), (float)((SectionIndex >> 1) & 1), (float)(SectionIndex >> 2) };
+		const Vector3f BoundsMin = Vector3f{ Origin } + SectionOffset * Size;
+		const Vector3f BoundsMax = BoundsMin + Vector3f{ Size, Size, Size };
+
+		// A face direction is visible if the view is on the front side of at least one face plane
+		bool IsVisible[6];
+		IsVisible[FChunk::NormalID::East]   = ViewPosition.x > BoundsMin.x;
+		IsVisible[FChunk::NormalID::West]   = ViewPosition.x < BoundsMax.x;
+		IsVisible[FChunk::NormalID::Top]    = ViewPosition.y > BoundsMin.y;
+		IsVisible[FChunk::NormalID::Bottom] = ViewPosition.y < BoundsMax.y;
+		IsVisible[FChunk::NormalID::North]  = ViewPosition.z > BoundsMin.z;
+		IsVisible[FChunk::NormalID::South]  = ViewPosition.z < BoundsMax.z;
+
+		// Visit face directions in quad order so adjacent visible ranges can be merged
+		uint32_t Sides[6] = { 0, 1, 2, 3, 4, 5 };
+		std::sort(std::begin(Sides), std::end(Sides), [&Ranges](const uint32_t Lhs, const uint32_t Rhs)
+		{
+			return Ranges[Lhs].FirstQuad < Ranges[Rhs].FirstQuad;
+		});
+
+		FaceRange Run{ 0, 0 };
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBuffers[Buffer::Index]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * mIndices[!mActiveBuffer]->size(), mIndices[!mActiveBuffer]->data(), BufferUsageMode);
+		for (uint32_t i = 0; i <= 6; i++)
+		{
+			// Empty ranges don't break a run
+			if (i < 6 && Ranges[Sides[i]].QuadCount == 0)
+				continue;
 
-	mActiveBuffer = !mActiveBuffer;
+			if (i < 6 && IsVisible[Sides[i]] && (Run.QuadCount == 0 || Run.FirstQuad + Run.QuadCount == Ranges[Sides[i]].FirstQuad))
+			{
+				if (Run.QuadCount == 0)
+					Run.FirstQuad = Ranges[Sides[i]].FirstQuad;
+				Run.QuadCount += Ranges[Sides[i]].QuadCount;
+				continue;
+			}
+
+			if (Run.QuadCount > 0)
+			{
+				if (!HasOrigin)
+				{
+					OriginIndex = DrawList.AddOrigin(Origin);
+					HasOrigin = true;
+				}
+
+				DrawList.AddDraw(Run.QuadCount, mGeometryArena->GetFirstQuad(Allocation) + Run.FirstQuad, OriginIndex);
+			}
+
+			Run = (i < 6 && IsVisible[Sides[i]]) ? Ranges[Sides[i]] : FaceRange{ 0, 0 };
+		}
+	}
+}
+
+void FChunkMesh::SwapBuffer(FChunkGeometryArena& GeometryArena, FUploadRing& UploadRing)
+{
+	ASSERT((!mGeometryArena || mGeometryArena == &GeometryArena) && "Chunk meshes can't move between arenas.");
+	mGeometryArena = &GeometryArena;
+
+	const bool IsOverBudget = SMemoryStats::IsOverBudget(EMemoryTag::ChunkMeshes);
+
+	for (uint32_t SectionIndex = 0; SectionIndex < SECTION_COUNT; SectionIndex++)
+	{
+		if (!(mBackSectionMask & (1 << SectionIndex)))
+			continue;
+
+		ActiveSection& FrontSection = mFrontSections[SectionIndex];
+		Section& BackSection = mBackSections[SectionIndex];
+
+		// The old range is freed after allocating so the upload doesn't write
+		// over quads that earlier draws may still be reading.
+		const uint32_t QuadCount = BackSection.Quads.size();
+		FChunkGeometryArena::Allocation NewAllocation{ 0, 0 };
+
+		if (QuadCount > 0)
+		{
+			NewAllocation = GeometryArena.Allocate(QuadCount);
+			GeometryArena.Upload(NewAllocation, BackSection.Quads.data(), sizeof(Quad) * QuadCount, UploadRing);
+		}
+
+		GeometryArena.Free(mAllocations[SectionIndex]);
+		mAllocations[SectionIndex] = NewAllocation;
+
+		// The back section keeps the capacity of its quad data for the next rebuild, unless over budget
+		mFrontQuadCount = mFrontQuadCount - FrontSection.QuadCount + QuadCount;
+		FrontSection.QuadCount = QuadCount;
+		FrontSection.Ranges = BackSection.Ranges;
+		ClearSection(BackSection);
+
+		if (IsOverBudget)
+			QuadData{}.swap(BackSection.Quads);
+	}
+
+	mBackSectionMask = 0;
+	UpdateQuadBytes();
+}
+
+void FChunkMesh::SetFrontSection(const uint32_t SectionIndex, FChunkGeometryArena& GeometryArena, const FChunkGeometryArena::Allocation& Range, const FaceRanges& Ranges)
+{
+	ASSERT((!mGeometryArena || mGeometryArena == &GeometryArena) && "Chunk meshes can't move between arenas.");
+	mGeometryArena = &GeometryArena;
+
+	uint32_t QuadCount = 0;
+	for (const FaceRange& Face : Ranges)
+		QuadCount += Face.QuadCount;
+
+	GeometryArena.Free(mAllocations[SectionIndex]);
+	mAllocations[SectionIndex] = Range;
+
+	ActiveSection& FrontSection = mFrontSections[SectionIndex];
+	mFrontQuadCount = mFrontQuadCount - FrontSection.QuadCount + QuadCount;
+	FrontSection.QuadCount = QuadCount;
+	FrontSection.Ranges = Ranges;
+}
+
+uint32_t FChunkMesh::TakeBackSections(QuadData QuadsOut[SECTION_COUNT], FaceRanges RangesOut[SECTION_COUNT])
+{
+	const uint32_t SectionMask = mBackSectionMask;
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+	{
+		if (!(SectionMask & (1 << i)))
+			continue;
+
+		QuadsOut[i].swap(mBackSections[i].Quads);
+		RangesOut[i] = mBackSections[i].Ranges;
+		ClearSection(mBackSections[i]);
+	}
+
+	mBackSectionMask = 0;
+	UpdateQuadBytes();
+	return SectionMask;
 }
 
 void FChunkMesh::ClearBackBuffer()
 {
-	mVertices[!mActiveBuffer]   = VertexDataPtr{ new VertexData{} };
-	mIndices[!mActiveBuffer]    = IndexDataPtr{ new IndexData{} };
+	const bool IsOverBudget = SMemoryStats::IsOverBudget(EMemoryTag::ChunkMeshes);
+
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+	{
+		if (!(mBackSectionMask & (1 << i)))
+			continue;
+
+		ClearSection(mBackSections[i]);
+		if (IsOverBudget)
+			QuadData{}.swap(mBackSections[i].Quads);
+	}
+
+	mBackSectionMask = 0;
+	UpdateQuadBytes();
 }
\ No newline at end of file
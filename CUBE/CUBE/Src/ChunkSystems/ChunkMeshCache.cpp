@@ -0,0 +1,198 @@
+#include "ChunkSystems\ChunkMeshCache.h"
+#include "Misc\Assertions.h"
+#include <cstring>
+
+namespace
+{
+	const uint64_t HASH_PRIME = 1099511628211ull;
+}
+
+FChunkMeshCache::FChunkMeshCache()
+	: mCacheName()
+	, mRegionFiles()
+	, mEntryBuffer()
+	, mMutex()
+{
+}
+
+FChunkMeshCache::~FChunkMeshCache()
+{
+	Close();
+}
+
+void FChunkMeshCache::Open(const wchar_t* WorldName)
+{
+	Close();
+
+	std::lock_guard<std::mutex> Lock(mMutex);
+	mCacheName = WorldName;
+	mCacheName += L"_MeshCache";
+}
+
+void FChunkMeshCache::Close()
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	// Region files flush as they close
+	mRegionFiles.clear();
+	mCacheName.clear();
+
+	// Entries can be large, so the buffer isn't kept between worlds
+	std::vector<uint8_t>().swap(mEntryBuffer);
+}
+
+bool FChunkMeshCache::IsOpen() const
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	return !mCacheName.empty();
+}
+
+uint64_t FChunkMeshCache::HashData(const void* Data, const uint32_t Size, const uint64_t Hash)
+{
+	const uint8_t* Bytes = reinterpret_cast<const uint8_t*>(Data);
+	uint64_t Result = Hash;
+
+	uint32_t i = 0;
+	for (; i + sizeof(uint64_t) <= Size; i += sizeof(uint64_t))
+	{
+		uint64_t Word;
+		std::memcpy(&Word, Bytes + i, sizeof(uint64_t));
+
+		// Folding the high bits down lets every bit of a word reach the whole hash
+		Result = (Result ^ Word) * HASH_PRIME;
+		Result ^= Result >> 32;
+	}
+
+	for (; i < Size; i++)
+		Result = (Result ^ Bytes[i]) * HASH_PRIME;
+
+	return Result;
+}
+
+bool FChunkMeshCache::Read(const Vector3i& ChunkPosition, const uint64_t InputHash, MeshData& MeshOut)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	FRegionFile* Region = GetRegion(ChunkPosition);
+	if (!Region)
+		return false;
+
+	uint32_t EntrySize;
+	uint32_t SectorOffset;
+	uint8_t Codec;
+	Region->GetChunkDataInfo(FRegionFile::LocalRegionPosition(ChunkPosition), EntrySize, SectorOffset, Codec);
+
+	if (EntrySize < sizeof(EntryHeader))
+		return false;
+
+	// Misses only read the header
+	EntryHeader Header;
+	Region->GetChunkData(SectorOffset, reinterpret_cast<uint8_t*>(&Header), sizeof(EntryHeader));
+
+	if (Header.Version != VERSION || Header.InputHash != InputHash)
+		return false;
+
+	// Every range must lie within its section
+	uint32_t QuadCounts[FChunkMesh::SECTION_COUNT];
+	uint32_t DataSize = sizeof(EntryHeader);
+	for (uint32_t Section = 0; Section < FChunkMesh::SECTION_COUNT; Section++)
+	{
+		QuadCounts[Section] = 0;
+		for (const FChunkMesh::FaceRange& Range : Header.Ranges[Section])
+		{
+			const uint32_t RangeEnd = Range.FirstQuad + Range.QuadCount;
+			QuadCounts[Section] = (RangeEnd > QuadCounts[Section]) ? RangeEnd : QuadCounts[Section];
+		}
+
+		DataSize += QuadCounts[Section] * sizeof(FChunkMesh::Quad);
+	}
+
+	if (DataSize != EntrySize)
+		return false;
+
+	mEntryBuffer.resize(EntrySize);
+	Region->GetChunkData(SectorOffset, mEntryBuffer.data(), EntrySize);
+
+	const uint8_t* Entry = mEntryBuffer.data() + sizeof(EntryHeader);
+	for (uint32_t Section = 0; Section < FChunkMesh::SECTION_COUNT; Section++)
+	{
+		MeshOut.Quads[Section]->resize(QuadCounts[Section]);
+		MeshOut.Ranges[Section] = Header.Ranges[Section];
+
+		const uint32_t SectionSize = QuadCounts[Section] * sizeof(FChunkMesh::Quad);
+		if (SectionSize != 0)
+			std::memcpy(MeshOut.Quads[Section]->data(), Entry, SectionSize);
+
+		Entry += SectionSize;
+	}
+
+	return true;
+}
+
+void FChunkMeshCache::Write(const Vector3i& ChunkPosition, const uint64_t InputHash, const FChunkMesh& Mesh)
+{
+	EntryHeader Header;
+	Header.Version = VERSION;
+	Header.InputHash = InputHash;
+
+	const FChunkMesh::QuadData* Sections[FChunkMesh::SECTION_COUNT];
+	uint32_t MeshSize = sizeof(EntryHeader);
+	for (uint32_t Section = 0; Section < FChunkMesh::SECTION_COUNT; Section++)
+	{
+		Sections[Section] = Mesh.GetBackSection(Section, Header.Ranges[Section]);
+		ASSERT(Sections[Section] && "Only whole meshes can be cached.");
+
+		MeshSize += Sections[Section]->size() * sizeof(FChunkMesh::Quad);
+	}
+
+	if (MeshSize > MAX_ENTRY_SIZE)
+		return;
+
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	FRegionFile* Region = GetRegion(ChunkPosition);
+	if (!Region)
+		return;
+
+	mEntryBuffer.resize(MeshSize);
+
+	uint8_t* Entry = mEntryBuffer.data();
+	std::memcpy(Entry, &Header, sizeof(EntryHeader));
+	Entry += sizeof(EntryHeader);
+
+	for (const FChunkMesh::QuadData* Quads : Sections)
+	{
+		const uint32_t SectionSize = Quads->size() * sizeof(FChunkMesh::Quad);
+		if (SectionSize != 0)
+			std::memcpy(Entry, Quads->data(), SectionSize);
+
+		Entry += SectionSize;
+	}
+
+	Region->WriteChunkData(FRegionFile::LocalRegionPosition(ChunkPosition), mEntryBuffer.data(), mEntryBuffer.size());
+}
+
+FRegionFile* FChunkMeshCache::GetRegion(const Vector3i& ChunkPosition)
+{
+	if (mCacheName.empty())
+		return nullptr;
+
+	const Vector3i RegionPosition = FRegionFile::ChunkToRegionPosition(ChunkPosition);
+
+	auto Record = mRegionFiles.find(RegionPosition);
+	if (Record != mRegionFiles.end())
+		return Record->second.get();
+
+	// Close the opened regions before mapping another while region files are over budget
+	if (SMemoryStats::IsOverBudget(EMemoryTag::RegionFiles))
+		mRegionFiles.clear();
+
+	// Regions that fail to load stay null, so they aren't retried by every chunk
+	std::unique_ptr<FRegionFile> Region{ new FRegionFile{} };
+	if (!Region->Load(mCacheName.c_str(), RegionPosition))
+		Region.reset();
+
+	FRegionFile* Found = Region.get();
+	mRegionFiles.emplace(RegionPosition, std::move(Region));
+	return Found;
+}
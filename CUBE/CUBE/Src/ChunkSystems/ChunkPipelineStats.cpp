@@ -0,0 +1,126 @@
+#include "ChunkSystems\ChunkPipelineStats.h"
+#include "Clock.h"
+
+#include <algorithm>
+
+#undef min
+#undef max
+
+FChunkPipelineStats::FChunkPipelineStats()
+	: mStages()
+	, mVisibleToDraw()
+	, mStageCycles()
+	, mLoadCount()
+	, mThrashCount()
+	, mBytesRead()
+	, mBytesWritten()
+	, mLastLoadCount(0)
+	, mLastThrashCount(0)
+	, mLastBytesRead(0)
+	, mLastBytesWritten(0)
+	, mRates()
+{
+	mLoadCount = 0;
+	mThrashCount = 0;
+	mBytesRead = 0;
+	mBytesWritten = 0;
+
+	for (std::atomic<uint64_t>& Cycles : mStageCycles)
+		Cycles = 0;
+
+	for (SampleRing& Ring : mStages)
+		Ring.Written = 0;
+	mVisibleToDraw.Written = 0;
+}
+
+void FChunkPipelineStats::AddStageTime(const EChunkStage::Type Stage, const uint64_t Begin, const uint64_t End)
+{
+	AddSample(mStages[Stage], Begin, End);
+	mStageCycles[Stage] += End - Begin;
+}
+
+void FChunkPipelineStats::AddVisibleToDraw(const uint64_t Queued, const uint64_t Drawable)
+{
+	AddSample(mVisibleToDraw, Queued, Drawable);
+}
+
+void FChunkPipelineStats::SampleRates(const float Elapsed)
+{
+	const uint64_t LoadCount = mLoadCount;
+	const uint64_t ThrashCount = mThrashCount;
+	const uint64_t BytesRead = mBytesRead;
+	const uint64_t BytesWritten = mBytesWritten;
+
+	mRates.LoadsPerSecond = (float)(LoadCount - mLastLoadCount) / Elapsed;
+	mRates.ThrashesPerSecond = (float)(ThrashCount - mLastThrashCount) / Elapsed;
+	mRates.BytesReadPerSecond = (float)(BytesRead - mLastBytesRead) / Elapsed;
+	mRates.BytesWrittenPerSecond = (float)(BytesWritten - mLastBytesWritten) / Elapsed;
+
+	mLastLoadCount = LoadCount;
+	mLastThrashCount = ThrashCount;
+	mLastBytesRead = BytesRead;
+	mLastBytesWritten = BytesWritten;
+}
+
+void FChunkPipelineStats::Reset()
+{
+	for (SampleRing& Ring : mStages)
+	{
+		std::lock_guard<std::mutex> Lock(Ring.Mutex);
+		Ring.Written = 0;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(mVisibleToDraw.Mutex);
+		mVisibleToDraw.Written = 0;
+	}
+
+	// Counters keep running, the next sample only counts what was added after the reset
+	mLastLoadCount = mLoadCount;
+	mLastThrashCount = mThrashCount;
+	mLastBytesRead = mBytesRead;
+	mLastBytesWritten = mBytesWritten;
+	mRates = Rates{};
+}
+
+const char* FChunkPipelineStats::GetStageName(const EChunkStage::Type Stage)
+{
+	static const char* Names[EChunkStage::Count] = { "Read", "Decode", "Mesh", "Upload" };
+	return Names[Stage];
+}
+
+void FChunkPipelineStats::AddSample(SampleRing& Ring, const uint64_t Begin, const uint64_t End)
+{
+	const float Milliseconds = FClock::CyclesToSeconds(End - Begin) * 1000.0f;
+
+	std::lock_guard<std::mutex> Lock(Ring.Mutex);
+	Ring.Samples[Ring.Written % SAMPLES_PER_STAGE] = Milliseconds;
+	Ring.Written++;
+}
+
+FChunkPipelineStats::Timing FChunkPipelineStats::GetTiming(const SampleRing& Ring)
+{
+	float Samples[SAMPLES_PER_STAGE];
+	uint32_t Count;
+	{
+		std::lock_guard<std::mutex> Lock(Ring.Mutex);
+		Count = std::min(Ring.Written, SAMPLES_PER_STAGE);
+		std::copy(Ring.Samples, Ring.Samples + Count, Samples);
+	}
+
+	Timing Result{ 0.0f, 0.0f, Count };
+	if (Count == 0)
+		return Result;
+
+	float Total = 0.0f;
+	for (uint32_t i = 0; i < Count; i++)
+		Total += Samples[i];
+	Result.AverageMs = Total / Count;
+
+	// The sample that 99% of samples are at or below
+	const uint32_t P99Index = (Count * 99 - 1) / 100;
+	std::nth_element(Samples, Samples + P99Index, Samples + Count);
+	Result.P99Ms = Samples[P99Index];
+
+	return Result;
+}
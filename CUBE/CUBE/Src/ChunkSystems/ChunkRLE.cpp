@@ -0,0 +1,112 @@
+#include "ChunkSystems\ChunkRLE.h"
+#include "ChunkSystems\Chunk.h"
+#include <emmintrin.h>
+#include <intrin.h>
+#include <cstring>
+#include <algorithm>
+
+#undef min
+#undef max
+
+static_assert(FChunk::MAX_RLE_BYTES >= FChunkRLE::HEADER_SIZE + 2 * FChunk::BLOCKS_PER_CHUNK, "A run for every block must fit in a payload.");
+static_assert(FChunk::BLOCKS_PER_CHUNK % 32 == 0, "Blocks are compared 32 at a time.");
+
+uint32_t FChunkRLE::Encode(const uint8_t* Blocks, uint8_t* DataOut)
+{
+	WriteHeader(DataOut);
+	uint32_t DataSize = HEADER_SIZE;
+	uint32_t RunStart = 0;
+
+	for (uint32_t First = 0; First < (uint32_t)FChunk::BLOCKS_PER_CHUNK; First += 32)
+	{
+		const uint8_t* Span = Blocks + First;
+
+		// Bit i is set if block i ends a run. Runs of one type skip 32 blocks at a time.
+		const __m128i Low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Span));
+		const __m128i High = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Span + 16));
+		const __m128i NextLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Span + 1));
+		const __m128i NextHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Span + 17));
+
+		const uint32_t SameLow = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(Low, NextLow));
+		const uint32_t SameHigh = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(High, NextHigh));
+		uint32_t RunEnds = ~(SameLow | (SameHigh << 16));
+
+		// The last compare reads the padding, so the last block always ends a run
+		if (First + 32 == (uint32_t)FChunk::BLOCKS_PER_CHUNK)
+			RunEnds |= 1u << 31;
+
+		while (RunEnds)
+		{
+			unsigned long Bit;
+			_BitScanForward(&Bit, RunEnds);
+			RunEnds &= RunEnds - 1;
+
+			const uint32_t RunEnd = First + Bit;
+			DataSize += WriteRun(Blocks[RunStart], RunEnd - RunStart + 1, DataOut + DataSize);
+			RunStart = RunEnd + 1;
+		}
+	}
+
+	return DataSize;
+}
+
+void FChunkRLE::Decode(const uint8_t* Data, const uint32_t DataSize, uint8_t* BlocksOut)
+{
+	const uint32_t BlockCount = FChunk::BLOCKS_PER_CHUNK;
+	uint32_t BlockOffset = 0;
+
+	RunReader Reader(Data, DataSize);
+	Run Next;
+	while (BlockOffset < BlockCount && Reader.Next(Next))
+	{
+		const uint32_t Length = std::min(Next.Length, BlockCount - BlockOffset);
+		std::memset(BlocksOut + BlockOffset, Next.Type, Length);
+		BlockOffset += Length;
+	}
+
+	// Missing data is air
+	std::memset(BlocksOut + BlockOffset, FBlock::AIR_BLOCK_ID, BlockCount - BlockOffset);
+}
+
+bool FChunkRLE::IsUniform(const uint8_t* Data, const uint32_t DataSize, uint8_t& TypeOut)
+{
+	RunReader Reader(Data, DataSize);
+	Run First;
+	if (!Reader.Next(First))
+	{
+		TypeOut = FBlock::AIR_BLOCK_ID;
+		return true;
+	}
+
+	Run Next;
+	while (Reader.Next(Next))
+	{
+		if (Next.Type != First.Type)
+			return false;
+	}
+
+	TypeOut = First.Type;
+	return true;
+}
+
+void FChunkRLE::WriteHeader(uint8_t* DataOut)
+{
+	DataOut[0] = SPANNING_VERSION;
+	DataOut[1] = 0;
+}
+
+uint32_t FChunkRLE::WriteRun(const uint8_t Type, const uint32_t Length, uint8_t* DataOut)
+{
+	uint32_t DataSize = 0;
+	DataOut[DataSize++] = Type;
+
+	uint32_t Remaining = Length;
+	while (Remaining >= 0x80)
+	{
+		DataOut[DataSize++] = (uint8_t)(Remaining | 0x80);
+		Remaining >>= 7;
+	}
+	DataOut[DataSize++] = (uint8_t)Remaining;
+
+	return DataSize;
+}
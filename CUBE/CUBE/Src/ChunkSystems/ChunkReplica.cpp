@@ -0,0 +1,188 @@
+#include "ChunkSystems\ChunkReplica.h"
+#include "ChunkSystems\ChunkReplicator.h"
+#include "ChunkSystems\Chunk.h"
+#include "ChunkSystems\ChunkRLE.h"
+#include "FileIO\ChunkCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	/**
+	* Reads the values of a packet in order, failing once the packet is used up.
+	*/
+	struct PacketReader
+	{
+		const uint8_t* Data;
+		uint32_t       Size;
+		uint32_t       Offset;
+
+		template <typename Type>
+		bool Read(Type& ValueOut)
+		{
+			if (Size - Offset < sizeof(Type))
+				return false;
+
+			memcpy(&ValueOut, Data + Offset, sizeof(Type));
+			Offset += sizeof(Type);
+			return true;
+		}
+
+		bool ReadChunk(Vector3i& ChunkPositionOut)
+		{
+			return Read(ChunkPositionOut.x) && Read(ChunkPositionOut.y) && Read(ChunkPositionOut.z);
+		}
+	};
+}
+
+FChunkReplica::FChunkReplica(FChunkManager& ChunkManager)
+	: mChunkManager(ChunkManager)
+	, mWaiting()
+	, mEdits()
+	, mBlockData()
+	, mTick(0)
+{
+}
+
+bool FChunkReplica::Receive(const uint8_t* Packet, const uint32_t Size)
+{
+	PacketReader Reader{ Packet, Size, 0 };
+	if (!Reader.Read(mTick))
+		return false;
+
+	mEdits.clear();
+	bool IsValid = true;
+
+	while (IsValid && Reader.Offset < Reader.Size)
+	{
+		uint8_t Message;
+		Vector3i ChunkPosition;
+		if (!Reader.Read(Message) || !Reader.ReadChunk(ChunkPosition))
+		{
+			IsValid = false;
+			break;
+		}
+
+		if (Message == FChunkReplicator::EMessage::Snapshot)
+		{
+			uint8_t Codec;
+			uint32_t DataSize;
+			IsValid = Reader.Read(Codec) && Reader.Read(DataSize) && Reader.Size - Reader.Offset >= DataSize;
+			if (!IsValid)
+				break;
+
+			const uint8_t* Data = Reader.Data + Reader.Offset;
+			Reader.Offset += DataSize;
+
+			if (Codec == FChunkCodec::LZ)
+			{
+				mBlockData.resize(FChunk::MAX_RLE_BYTES);
+				const uint32_t DecodedSize = FChunkCodec::Decompress(Data, DataSize, mBlockData.data(), mBlockData.size());
+				IsValid = (DecodedSize != 0);
+				mBlockData.resize(DecodedSize);
+			}
+			else
+			{
+				IsValid = (Codec == FChunkCodec::Raw);
+				mBlockData.assign(Data, Data + DataSize);
+			}
+
+			if (!IsValid)
+				break;
+
+			// A newer snapshot replaces a waiting one and the edits it already holds
+			if (mChunkManager.IsChunkLoaded(ChunkPosition))
+			{
+				mWaiting.erase(ChunkPosition);
+				AddSnapshotEdits(ChunkPosition, mBlockData);
+			}
+			else
+			{
+				WaitingChunk& Waiting = mWaiting[ChunkPosition];
+				Waiting.BlockData = mBlockData;
+				Waiting.Edits.clear();
+			}
+		}
+		else if (Message == FChunkReplicator::EMessage::Edits)
+		{
+			uint16_t Count;
+			if (!Reader.Read(Count))
+			{
+				IsValid = false;
+				break;
+			}
+
+			auto Waiting = mWaiting.find(ChunkPosition);
+			std::vector<FChunkManager::BlockEdit>& Edits = (Waiting != mWaiting.end()) ? Waiting->second.Edits : mEdits;
+
+			const Vector3i Origin = ChunkPosition * FChunk::CHUNK_SIZE;
+			for (uint32_t i = 0; i < Count && IsValid; i++)
+			{
+				FChunk::PackedIndex Index;
+				FBlockTypes::BlockID ID;
+				IsValid = Reader.Read(Index) && Reader.Read(ID) && Index < FChunk::BLOCKS_PER_CHUNK;
+				if (!IsValid)
+					break;
+
+				// Blocks are indexed by x, then y, then z
+				const Vector3i Local{ (Index / FChunk::CHUNK_SIZE) % FChunk::CHUNK_SIZE, Index / (FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE), Index % FChunk::CHUNK_SIZE };
+				Edits.push_back(FChunkManager::BlockEdit{ Origin + Local, ID });
+			}
+		}
+		else if (Message == FChunkReplicator::EMessage::Forget)
+		{
+			mWaiting.erase(ChunkPosition);
+		}
+		else
+		{
+			IsValid = false;
+		}
+	}
+
+	if (!mEdits.empty())
+		mChunkManager.ApplyEdits(mEdits.data(), mEdits.size());
+
+	return IsValid;
+}
+
+void FChunkReplica::Update()
+{
+	mEdits.clear();
+	for (auto Waiting = mWaiting.begin(); Waiting != mWaiting.end();)
+	{
+		if (!mChunkManager.IsChunkLoaded(Waiting->first))
+		{
+			++Waiting;
+			continue;
+		}
+
+		AddSnapshotEdits(Waiting->first, Waiting->second.BlockData);
+		mEdits.insert(mEdits.end(), Waiting->second.Edits.begin(), Waiting->second.Edits.end());
+		Waiting = mWaiting.erase(Waiting);
+	}
+
+	if (!mEdits.empty())
+		mChunkManager.ApplyEdits(mEdits.data(), mEdits.size());
+}
+
+void FChunkReplica::AddSnapshotEdits(const Vector3i& ChunkPosition, const std::vector<uint8_t>& BlockData)
+{
+	// Runs are stored in block index order, only blocks that differ are set
+	const Vector3i Origin = ChunkPosition * FChunk::CHUNK_SIZE;
+	uint32_t Index = 0;
+	FChunkRLE::RunReader Reader(BlockData.data(), BlockData.size());
+	FChunkRLE::Run Run;
+	while (Index < (uint32_t)FChunk::BLOCKS_PER_CHUNK && Reader.Next(Run))
+	{
+		const FBlockTypes::BlockID ID = Run.Type;
+		const uint32_t RunEnd = std::min(Index + Run.Length, (uint32_t)FChunk::BLOCKS_PER_CHUNK);
+
+		for (; Index < RunEnd; Index++)
+		{
+			const Vector3i Position = Origin + Vector3i{ (int32_t)((Index / FChunk::CHUNK_SIZE) % FChunk::CHUNK_SIZE), (int32_t)(Index / (FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE)), (int32_t)(Index % FChunk::CHUNK_SIZE) };
+			if (mChunkManager.GetBlock(Position) != ID)
+				mEdits.push_back(FChunkManager::BlockEdit{ Position, ID });
+		}
+	}
+}
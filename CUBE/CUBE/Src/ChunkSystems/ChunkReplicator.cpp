@@ -0,0 +1,225 @@
+#include "ChunkSystems\ChunkReplicator.h"
+#include "ChunkSystems\Chunk.h"
+#include "Math\FMath.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+	template <typename Type>
+	void Append(std::vector<uint8_t>& Packet, const Type& Value)
+	{
+		const uint8_t* Bytes = reinterpret_cast<const uint8_t*>(&Value);
+		Packet.insert(Packet.end(), Bytes, Bytes + sizeof(Type));
+	}
+
+	void AppendChunk(std::vector<uint8_t>& Packet, const FChunkReplicator::EMessage::Type Message, const Vector3i& ChunkPosition)
+	{
+		Append(Packet, (uint8_t)Message);
+		Append(Packet, ChunkPosition.x);
+		Append(Packet, ChunkPosition.y);
+		Append(Packet, ChunkPosition.z);
+	}
+}
+
+FChunkReplicator::FChunkReplicator(FChunkManager& ChunkManager, const bool Compress)
+	: mChunkManager(ChunkManager)
+	, mClients()
+	, mEdits()
+	, mPacket()
+	, mChunkData()
+	, mTick(0)
+	, mSnapshotBudget(DEFAULT_SNAPSHOT_BUDGET)
+	, mBytesSent(0)
+	, mCompresses(Compress)
+{
+	mChunkManager.mOnBlockSet.AddListener<FChunkReplicator, &FChunkReplicator::OnBlockSet>(this);
+	mChunkManager.mOnBlockDestroy.AddListener<FChunkReplicator, &FChunkReplicator::OnBlockDestroy>(this);
+	mChunkManager.mOnBlocksEdited.AddListener<FChunkReplicator, &FChunkReplicator::OnBlocksEdited>(this);
+}
+
+FChunkReplicator::~FChunkReplicator()
+{
+	mChunkManager.mOnBlockSet.RemoveListener(this);
+	mChunkManager.mOnBlockDestroy.RemoveListener(this);
+	mChunkManager.mOnBlocksEdited.RemoveListener(this);
+}
+
+void FChunkReplicator::AddClient(const uint32_t ClientID)
+{
+	Client& NewClient = mClients[ClientID];
+	NewClient.CenterChunk = Vector3i{};
+	NewClient.ViewDistance = 0;
+	NewClient.VerticalViewDistance = 0;
+	NewClient.Sent.clear();
+	NewClient.Waiting.clear();
+	NewClient.Forgotten.clear();
+}
+
+void FChunkReplicator::RemoveClient(const uint32_t ClientID)
+{
+	mClients.erase(ClientID);
+}
+
+void FChunkReplicator::SetClientView(const uint32_t ClientID, const Vector3i& CenterChunk, const uint32_t ViewDistance, const uint32_t VerticalViewDistance)
+{
+	auto Found = mClients.find(ClientID);
+	if (Found == mClients.end())
+		return;
+
+	Client& Viewer = Found->second;
+	Viewer.CenterChunk = CenterChunk;
+	Viewer.ViewDistance = ViewDistance;
+	Viewer.VerticalViewDistance = VerticalViewDistance;
+
+	for (auto Sent = Viewer.Sent.begin(); Sent != Viewer.Sent.end();)
+	{
+		if (IsInView(Viewer, *Sent))
+		{
+			++Sent;
+			continue;
+		}
+
+		Viewer.Forgotten.push_back(*Sent);
+		Sent = Viewer.Sent.erase(Sent);
+	}
+
+	// Nearest chunks are taken from the back first
+	Viewer.Waiting.clear();
+	const int32_t Distance = (int32_t)ViewDistance;
+	const int32_t VerticalDistance = (int32_t)VerticalViewDistance;
+	for (int32_t x = -Distance; x <= Distance; x++)
+	{
+		for (int32_t y = -VerticalDistance; y <= VerticalDistance; y++)
+		{
+			for (int32_t z = -Distance; z <= Distance; z++)
+			{
+				const Vector3i ChunkPosition = CenterChunk + Vector3i{ x, y, z };
+				if (mChunkManager.IsInWorld(ChunkPosition) && Viewer.Sent.find(ChunkPosition) == Viewer.Sent.end())
+					Viewer.Waiting.push_back(ChunkPosition);
+			}
+		}
+	}
+
+	std::sort(Viewer.Waiting.begin(), Viewer.Waiting.end(), [&CenterChunk](const Vector3i& Lhs, const Vector3i& Rhs)
+	{
+		const Vector3i LhsOffset = Lhs - CenterChunk;
+		const Vector3i RhsOffset = Rhs - CenterChunk;
+		return Vector3i::Dot(LhsOffset, LhsOffset) > Vector3i::Dot(RhsOffset, RhsOffset);
+	});
+}
+
+void FChunkReplicator::Tick(const SendFunction& Send)
+{
+	mTick++;
+
+	// Blocks edited more than once this tick only send their last edit
+	for (auto& Chunk : mEdits)
+	{
+		std::vector<DeltaEdit>& Edits = Chunk.second;
+		std::stable_sort(Edits.begin(), Edits.end(), [](const DeltaEdit& Lhs, const DeltaEdit& Rhs) { return Lhs.Index < Rhs.Index; });
+
+		uint32_t Kept = 0;
+		for (uint32_t i = 0; i < Edits.size(); i++)
+		{
+			if (i + 1 == Edits.size() || Edits[i + 1].Index != Edits[i].Index)
+				Edits[Kept++] = Edits[i];
+		}
+		Edits.resize(Kept);
+	}
+
+	for (auto& Entry : mClients)
+	{
+		Client& Viewer = Entry.second;
+
+		mPacket.clear();
+		Append(mPacket, mTick);
+		const uint32_t HeaderSize = mPacket.size();
+
+		for (const Vector3i& ChunkPosition : Viewer.Forgotten)
+			AppendChunk(mPacket, EMessage::Forget, ChunkPosition);
+		Viewer.Forgotten.clear();
+
+		// Chunks snapshot below already hold this tick's edits
+		for (const auto& Chunk : mEdits)
+		{
+			if (Viewer.Sent.find(Chunk.first) == Viewer.Sent.end())
+				continue;
+
+			const std::vector<DeltaEdit>& Edits = Chunk.second;
+			for (uint32_t First = 0; First < Edits.size(); First += UINT16_MAX)
+			{
+				const uint16_t Count = (uint16_t)std::min<std::size_t>(Edits.size() - First, UINT16_MAX);
+				AppendChunk(mPacket, EMessage::Edits, Chunk.first);
+				Append(mPacket, Count);
+				for (uint32_t i = First; i < First + Count; i++)
+				{
+					Append(mPacket, Edits[i].Index);
+					Append(mPacket, Edits[i].ID);
+				}
+			}
+		}
+
+		// Chunks the server hasn't loaded yet keep their place
+		uint32_t SnapshotBytes = 0;
+		for (uint32_t i = Viewer.Waiting.size(); i > 0 && SnapshotBytes < mSnapshotBudget; i--)
+		{
+			const Vector3i ChunkPosition = Viewer.Waiting[i - 1];
+			uint8_t Codec;
+			if (!mChunkManager.EncodeChunk(ChunkPosition, mCompresses, mChunkData, Codec))
+				continue;
+
+			AppendChunk(mPacket, EMessage::Snapshot, ChunkPosition);
+			Append(mPacket, Codec);
+			Append(mPacket, (uint32_t)mChunkData.size());
+			mPacket.insert(mPacket.end(), mChunkData.begin(), mChunkData.end());
+
+			SnapshotBytes += mChunkData.size();
+			Viewer.Sent.insert(ChunkPosition);
+			Viewer.Waiting.erase(Viewer.Waiting.begin() + (i - 1));
+		}
+
+		if (mPacket.size() == HeaderSize)
+			continue;
+
+		Send(Entry.first, mPacket.data(), mPacket.size());
+		mBytesSent += mPacket.size();
+	}
+
+	mEdits.clear();
+}
+
+void FChunkReplicator::OnBlockSet(Vector3i Position, FBlockTypes::BlockID ID)
+{
+	AddEdit(Position, ID);
+}
+
+void FChunkReplicator::OnBlockDestroy(Vector3i Position, FBlockTypes::BlockID ID)
+{
+	AddEdit(Position, FBlock::AIR_BLOCK_ID);
+}
+
+void FChunkReplicator::OnBlocksEdited(const FChunkManager::BlockChange* Changes, uint32_t Count)
+{
+	for (uint32_t i = 0; i < Count; i++)
+		AddEdit(Changes[i].Position, Changes[i].ID);
+}
+
+void FChunkReplicator::AddEdit(const Vector3i& Position, const FBlockTypes::BlockID ID)
+{
+	// Clients are snapshot with the blocks as they are when they join
+	if (mClients.empty())
+		return;
+
+	const Vector3i ChunkPosition = FMath::FloorDivide(Position, FChunk::CHUNK_SIZE);
+	const FChunk::PackedIndex Index = (FChunk::PackedIndex)FChunk::BlockIndex(FMath::FloorModulo(Position, FChunk::CHUNK_SIZE));
+	mEdits[ChunkPosition].push_back(DeltaEdit{ Index, ID });
+}
+
+bool FChunkReplicator::IsInView(const Client& Viewer, const Vector3i& ChunkPosition) const
+{
+	const Vector3i Offset = ChunkPosition - Viewer.CenterChunk;
+	return (uint32_t)std::abs(Offset.x) <= Viewer.ViewDistance && (uint32_t)std::abs(Offset.z) <= Viewer.ViewDistance &&
+		(uint32_t)std::abs(Offset.y) <= Viewer.VerticalViewDistance;
+}
@@ -0,0 +1,182 @@
+#include "ChunkSystems\ChunkUploader.h"
+#include "Debugging\CPUProfiler.h"
+#include "Misc\Assertions.h"
+#include "Clock.h"
+
+#include "SFML\Window\Context.hpp"
+
+namespace
+{
+	// Nanoseconds waited on a fence at a time when completing every upload
+	const GLuint64 FENCE_WAIT_TIMEOUT = 1000000;
+}
+
+FChunkUploader::FChunkUploader()
+	: mQueued()
+	, mStaged()
+	, mUploadThread()
+	, mMutex()
+	, mUploadAvailable()
+	, mUploadStaged()
+	, mQuadBytes(EMemoryTag::ChunkMeshes)
+	, mStagingBytes(EMemoryTag::ChunkGeometry)
+	, mStagingByteCount(0)
+	, mIsStaging(false)
+	, mMustStop(false)
+{
+	mUploadThread = std::thread(&FChunkUploader::UploadThreadLoop, this);
+}
+
+FChunkUploader::~FChunkUploader()
+{
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		mMustStop = true;
+	}
+
+	mUploadAvailable.notify_all();
+	mUploadThread.join();
+}
+
+void FChunkUploader::Submit(std::unique_ptr<Upload> NewUpload)
+{
+	ASSERT(NewUpload && NewUpload->SectionMask != 0);
+
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		mQueued.push_back(std::move(NewUpload));
+		UpdateQuadBytes();
+	}
+
+	mUploadAvailable.notify_one();
+}
+
+void FChunkUploader::Complete(std::vector<std::unique_ptr<Upload>>& UploadsOut, const bool Wait)
+{
+	std::unique_lock<std::mutex> Lock(mMutex);
+	while (Wait && (!mQueued.empty() || mIsStaging))
+		mUploadStaged.wait(Lock);
+
+	while (!mStaged.empty())
+	{
+		Upload& Oldest = *mStaged.front();
+		GLenum Status = glClientWaitSync(Oldest.Fence, 0, 0);
+		while (Wait && Status == GL_TIMEOUT_EXPIRED)
+			Status = glClientWaitSync(Oldest.Fence, 0, FENCE_WAIT_TIMEOUT);
+
+		// Later uploads were fenced after this one, so they can't have passed either
+		if (Status == GL_TIMEOUT_EXPIRED)
+			break;
+
+		glDeleteSync(Oldest.Fence);
+		Oldest.Fence = nullptr;
+
+		mStagingByteCount -= Oldest.BufferSize;
+		UploadsOut.push_back(std::move(mStaged.front()));
+		mStaged.pop_front();
+	}
+
+	mStagingBytes.Set(mStagingByteCount);
+}
+
+uint32_t FChunkUploader::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	return mQueued.size() + mStaged.size() + (mIsStaging ? 1 : 0);
+}
+
+void FChunkUploader::UploadThreadLoop()
+{
+	FDebug::CPUProfiler::SetThreadName("Chunk Upload");
+
+	// Shares its objects with the window's context, and is active on this thread until it returns
+	sf::Context UploadContext;
+
+	std::unique_lock<std::mutex> Lock(mMutex);
+	while (true)
+	{
+		while (!mMustStop && mQueued.empty())
+			mUploadAvailable.wait(Lock);
+
+		if (mMustStop)
+			break;
+
+		std::unique_ptr<Upload> Pending = std::move(mQueued.front());
+		mQueued.pop_front();
+		mIsStaging = true;
+		UpdateQuadBytes();
+		Lock.unlock();
+
+		Stage(*Pending);
+
+		Lock.lock();
+		mStagingByteCount += Pending->BufferSize;
+		mStagingBytes.Set(mStagingByteCount);
+		mStaged.push_back(std::move(Pending));
+		mIsStaging = false;
+		mUploadStaged.notify_all();
+	}
+
+	// Nothing is left to complete these, and their objects have to go with this context
+	for (std::unique_ptr<Upload>& Staged : mStaged)
+	{
+		glDeleteSync(Staged->Fence);
+		glDeleteBuffers(1, &Staged->Buffer);
+	}
+
+	mStaged.clear();
+	mQueued.clear();
+	mStagingByteCount = 0;
+	mStagingBytes.Set(0);
+	UpdateQuadBytes();
+}
+
+void FChunkUploader::Stage(Upload& Pending)
+{
+	CPU_PROFILE("Stage Chunk Upload");
+	Pending.StageBegin = FClock::ReadSystemTimer();
+
+	GLsizeiptr BufferSize = 0;
+	for (uint32_t Section = 0; Section < FChunkMesh::SECTION_COUNT; Section++)
+	{
+		Pending.QuadCounts[Section] = Pending.Quads[Section].size();
+		Pending.Offsets[Section] = BufferSize;
+		BufferSize += sizeof(FChunkMesh::Quad) * Pending.QuadCounts[Section];
+	}
+
+	ASSERT(BufferSize > 0 && "Empty meshes are swapped without an upload.");
+	Pending.BufferSize = BufferSize;
+
+	glGenBuffers(1, &Pending.Buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, Pending.Buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, BufferSize, nullptr, GL_STREAM_DRAW);
+
+	for (uint32_t Section = 0; Section < FChunkMesh::SECTION_COUNT; Section++)
+	{
+		if (Pending.QuadCounts[Section] > 0)
+			glBufferSubData(GL_COPY_WRITE_BUFFER, Pending.Offsets[Section], sizeof(FChunkMesh::Quad) * Pending.QuadCounts[Section], Pending.Quads[Section].data());
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// Flushed so the fence is seen by the context waiting on it
+	Pending.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	for (FChunkMesh::QuadData& Quads : Pending.Quads)
+		FChunkMesh::QuadData{}.swap(Quads);
+
+	Pending.StageEnd = FClock::ReadSystemTimer();
+}
+
+void FChunkUploader::UpdateQuadBytes()
+{
+	uint64_t QuadBytes = 0;
+	for (const std::unique_ptr<Upload>& Pending : mQueued)
+	{
+		for (const FChunkMesh::QuadData& Quads : Pending->Quads)
+			QuadBytes += Quads.capacity() * sizeof(FChunkMesh::Quad);
+	}
+
+	mQuadBytes.Set(QuadBytes);
+}
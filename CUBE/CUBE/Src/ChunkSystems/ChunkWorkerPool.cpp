@@ -0,0 +1,155 @@
+#include "ChunkSystems\ChunkWorkerPool.h"
+#include "Misc\Assertions.h"
+
+FChunkWorkerPool::FChunkWorkerPool()
+	: mWorkers()
+	, mReadyJobs()
+	, mUrgentJobs()
+	, mBusySlots()
+	, mJobMutex()
+	, mJobAvailable()
+	, mUrgentJobAvailable()
+	, mJobsFinished()
+	, mPendingJobs()
+	, mCompletedJobs()
+	, mReservedCount(0)
+	, mMustStop(false)
+{
+	mPendingJobs = 0;
+	mCompletedJobs = 0;
+}
+
+FChunkWorkerPool::~FChunkWorkerPool()
+{
+	Stop();
+}
+
+void FChunkWorkerPool::Start(const uint32_t WorkerCount, const uint32_t ReservedCount)
+{
+	ASSERT(WorkerCount > 0 && "The worker pool needs at least one worker.");
+
+	Stop();
+
+	mMustStop = false;
+	mReservedCount = ReservedCount;
+	for (uint32_t i = 0; i < WorkerCount + ReservedCount; i++)
+	{
+		mWorkers.push_back(std::thread(&FChunkWorkerPool::WorkerThreadLoop, this, i >= WorkerCount));
+	}
+}
+
+void FChunkWorkerPool::Stop()
+{
+	if (mWorkers.empty())
+		return;
+
+	WaitForIdle();
+
+	{
+		std::lock_guard<std::mutex> Lock(mJobMutex);
+		mMustStop = true;
+	}
+	mJobAvailable.notify_all();
+	mUrgentJobAvailable.notify_all();
+
+	for (auto& Worker : mWorkers)
+		Worker.join();
+
+	mReservedCount = 0;
+	mWorkers.clear();
+}
+
+void FChunkWorkerPool::Submit(const uint32_t Slot, Job NewJob, const bool IsUrgent)
+{
+	ASSERT(!mWorkers.empty() && "Submitting a job to a pool that has not been started.");
+
+	std::lock_guard<std::mutex> Lock(mJobMutex);
+	mPendingJobs++;
+
+	auto BusySlot = mBusySlots.find(Slot);
+	if (BusySlot != mBusySlots.end())
+	{
+		// Another job is using this slot, wait behind it. Urgent jobs are still urgent once released.
+		BusySlot->second.push_back(SlotRecord{ Slot, std::move(NewJob), IsUrgent });
+		return;
+	}
+
+	mBusySlots[Slot];
+	PushReady(SlotRecord{ Slot, std::move(NewJob), IsUrgent });
+}
+
+void FChunkWorkerPool::PushReady(SlotRecord&& Record)
+{
+	if (!Record.IsUrgent)
+	{
+		mReadyJobs.push_back(std::move(Record));
+		mJobAvailable.notify_one();
+		return;
+	}
+
+	// Reserved workers are woken first, the others take it if they are free sooner
+	mUrgentJobs.push_back(std::move(Record));
+	if (mReservedCount > 0)
+		mUrgentJobAvailable.notify_one();
+	mJobAvailable.notify_one();
+}
+
+void FChunkWorkerPool::WaitForIdle()
+{
+	std::unique_lock<std::mutex> Lock(mJobMutex);
+	while (mPendingJobs > 0)
+	{
+		mJobsFinished.wait(Lock);
+	}
+}
+
+bool FChunkWorkerPool::IsSlotIdle(const uint32_t Slot) const
+{
+	std::lock_guard<std::mutex> Lock(mJobMutex);
+	return mBusySlots.find(Slot) == mBusySlots.end();
+}
+
+void FChunkWorkerPool::WorkerThreadLoop(const bool IsReserved)
+{
+	std::unique_lock<std::mutex> Lock(mJobMutex);
+	std::condition_variable& JobAvailable = IsReserved ? mUrgentJobAvailable : mJobAvailable;
+
+	while (true)
+	{
+		while (!mMustStop && mUrgentJobs.empty() && (IsReserved || mReadyJobs.empty()))
+		{
+			JobAvailable.wait(Lock);
+		}
+
+		// Work left is finished before stopping
+		std::deque<SlotRecord>& Jobs = !mUrgentJobs.empty() ? mUrgentJobs : mReadyJobs;
+		if (Jobs.empty() || (IsReserved && &Jobs != &mUrgentJobs))
+			return;
+
+		SlotRecord Record = std::move(Jobs.front());
+		Jobs.pop_front();
+		Lock.unlock();
+
+		Record.Work();
+
+		Lock.lock();
+
+		// Release the next job waiting on this slot, or free the slot
+		auto& WaitingJobs = mBusySlots[Record.Slot];
+		if (!WaitingJobs.empty())
+		{
+			PushReady(std::move(WaitingJobs.front()));
+			WaitingJobs.pop_front();
+		}
+		else
+		{
+			mBusySlots.erase(Record.Slot);
+		}
+
+		mCompletedJobs++;
+		mPendingJobs--;
+
+		if (mPendingJobs == 0)
+			mJobsFinished.notify_all();
+	}
+}
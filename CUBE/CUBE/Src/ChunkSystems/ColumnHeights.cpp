@@ -0,0 +1,175 @@
+#include "ChunkSystems\ColumnHeights.h"
+#include "ChunkSystems\BlockStorage.h"
+#include "FileIO\WorldFileSystem.h"
+#include "SystemResources\SystemFile.h"
+#include "Math\FMath.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	const int32_t COLUMNS_PER_CHUNK = FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE;
+
+	/**
+	* A chunk column's heights as stored on file.
+	*/
+	struct ColumnRecord
+	{
+		int32_t X;
+		int32_t Z;
+		int32_t Heights[COLUMNS_PER_CHUNK];
+	};
+}
+
+FColumnHeights::FColumnHeights()
+	: mColumns()
+	, mFilepath()
+	, mMutex()
+{
+}
+
+void FColumnHeights::Open(const wchar_t* WorldName)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+	mColumns.clear();
+
+	mFilepath = FWorldFileSystem::WORLDS_DIRECTORY_NAME;
+	mFilepath += WorldName;
+	mFilepath += L"/Heights.vgh";
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	if (!FileSystem.FileExists(mFilepath.c_str()))
+		return;
+
+	auto File = FileSystem.OpenReadable(mFilepath.c_str());
+	if (!File)
+		return;
+
+	// A partly written record at the end is dropped
+	std::vector<ColumnRecord> Records(File->GetFileSize() / sizeof(ColumnRecord));
+	if (Records.empty() || !File->Read((uint8_t*)Records.data(), Records.size() * sizeof(ColumnRecord)))
+		return;
+
+	for (const ColumnRecord& Record : Records)
+		std::copy(Record.Heights, Record.Heights + COLUMNS_PER_CHUNK, mColumns[Vector3i{ Record.X, 0, Record.Z }].Heights);
+}
+
+bool FColumnHeights::Save() const
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	std::vector<ColumnRecord> Records;
+	{
+		std::lock_guard<std::mutex> Lock(mMutex);
+		if (mFilepath.empty())
+			return false;
+
+		Records.resize(mColumns.size());
+		uint32_t i = 0;
+		for (const auto& Column : mColumns)
+		{
+			Records[i].X = Column.first.x;
+			Records[i].Z = Column.first.z;
+			std::copy(Column.second.Heights, Column.second.Heights + COLUMNS_PER_CHUNK, Records[i].Heights);
+			i++;
+		}
+	}
+
+	// Written beside the saved heights, so a failed write keeps them
+	const std::wstring SavePath = mFilepath + L".save";
+	bool IsWritten = false;
+	{
+		auto File = FileSystem.OpenWritable(SavePath.c_str(), false, true);
+		IsWritten = File && (Records.empty() || File->Write((const uint8_t*)Records.data(), Records.size() * sizeof(ColumnRecord))) && File->Flush();
+	}
+
+	return IsWritten && FileSystem.ReplaceFilename(SavePath.c_str(), mFilepath.c_str());
+}
+
+int32_t FColumnHeights::GetHeight(const int32_t X, const int32_t Z) const
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	auto Column = mColumns.find(Vector3i{ FMath::FloorDivide(X, FChunk::CHUNK_SIZE), 0, FMath::FloorDivide(Z, FChunk::CHUNK_SIZE) });
+	if (Column == mColumns.end())
+		return NO_SURFACE;
+
+	const int32_t LocalX = FMath::FloorModulo(X, FChunk::CHUNK_SIZE);
+	const int32_t LocalZ = FMath::FloorModulo(Z, FChunk::CHUNK_SIZE);
+	return Column->second.Heights[LocalZ * FChunk::CHUNK_SIZE + LocalX];
+}
+
+void FColumnHeights::RaiseColumns(const Vector3i& ChunkPosition, const FBlockStorage& Blocks)
+{
+	const bool IsUniform = Blocks.IsUniform();
+	if (IsUniform && Blocks.Get(0) == FBlock::AIR_BLOCK_ID)
+		return;
+
+	// Columns are searched from the top of the chunk down, outside of the lock
+	int32_t Tops[COLUMNS_PER_CHUNK];
+	const int32_t ChunkBottom = ChunkPosition.y * FChunk::CHUNK_SIZE;
+
+	for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z++)
+	{
+		for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+		{
+			int32_t& Top = Tops[z * FChunk::CHUNK_SIZE + x];
+			Top = NO_SURFACE;
+
+			for (int32_t y = FChunk::CHUNK_SIZE - 1; y >= 0; y--)
+			{
+				if (IsUniform || Blocks.Get(FChunk::BlockIndex(x, y, z)) != FBlock::AIR_BLOCK_ID)
+				{
+					Top = ChunkBottom + y + 1;
+					break;
+				}
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> Lock(mMutex);
+	const Vector3i ChunkColumnPosition{ ChunkPosition.x, 0, ChunkPosition.z };
+
+	auto Column = mColumns.find(ChunkColumnPosition);
+	if (Column == mColumns.end())
+	{
+		std::copy(Tops, Tops + COLUMNS_PER_CHUNK, mColumns[ChunkColumnPosition].Heights);
+		return;
+	}
+
+	for (int32_t i = 0; i < COLUMNS_PER_CHUNK; i++)
+		Column->second.Heights[i] = std::max(Column->second.Heights[i], Tops[i]);
+}
+
+void FColumnHeights::Raise(const int32_t X, const int32_t Z, const int32_t Height)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	int32_t& ColumnHeight = FindHeight(X, Z);
+	ColumnHeight = std::max(ColumnHeight, Height);
+}
+
+void FColumnHeights::Lower(const int32_t X, const int32_t Z, const int32_t From, const int32_t To)
+{
+	std::lock_guard<std::mutex> Lock(mMutex);
+
+	int32_t& ColumnHeight = FindHeight(X, Z);
+	if (ColumnHeight == From)
+		ColumnHeight = To;
+}
+
+int32_t& FColumnHeights::FindHeight(const int32_t X, const int32_t Z)
+{
+	const Vector3i ChunkColumnPosition{ FMath::FloorDivide(X, FChunk::CHUNK_SIZE), 0, FMath::FloorDivide(Z, FChunk::CHUNK_SIZE) };
+
+	auto Column = mColumns.find(ChunkColumnPosition);
+	if (Column == mColumns.end())
+	{
+		Column = mColumns.emplace(ChunkColumnPosition, ChunkColumn{}).first;
+		std::fill(Column->second.Heights, Column->second.Heights + COLUMNS_PER_CHUNK, NO_SURFACE);
+	}
+
+	const int32_t LocalX = FMath::FloorModulo(X, FChunk::CHUNK_SIZE);
+	const int32_t LocalZ = FMath::FloorModulo(Z, FChunk::CHUNK_SIZE);
+	return Column->second.Heights[LocalZ * FChunk::CHUNK_SIZE + LocalX];
+}
@@ -0,0 +1,231 @@
+#include "ChunkSystems\FarTerrain.h"
+#include "ChunkSystems\WorldGenerator.h"
+#include "Debugging\CPUProfiler.h"
+#include "Rendering\GLBindings.h"
+#include "Rendering\GLState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace
+{
+	const GLuint VERTEX_BINDING = 0;
+
+	const uint32_t VERTEX_COUNT = FFarTerrain::GRID_SIZE * FFarTerrain::GRID_SIZE;
+	const uint32_t MAX_INDEX_COUNT = (FFarTerrain::GRID_SIZE - 1) * (FFarTerrain::GRID_SIZE - 1) * 6;
+}
+
+FFarTerrain::FFarTerrain()
+	: mGenerator(nullptr)
+	, mHeights(VERTEX_COUNT, 0)
+	, mIDs(VERTEX_COUNT, 0)
+	, mSampledHeights()
+	, mSampledIDs()
+	, mVertices()
+	, mIndices()
+	, mOrigin()
+	, mHasSamples(false)
+	, mViewDistance(0)
+	, mWorldSize(0)
+	, mVertexArray(0)
+	, mVertexBuffer(0)
+	, mIndexBuffer(0)
+	, mIndexCount(0)
+	, mBufferBytes(EMemoryTag::ChunkGeometry)
+{
+	glGenBuffers(1, &mVertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * VERTEX_COUNT, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &mIndexBuffer);
+	glGenVertexArrays(1, &mVertexArray);
+
+	SGLState::BindVertexArray(mVertexArray);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * MAX_INDEX_COUNT, nullptr, GL_DYNAMIC_DRAW);
+
+		glVertexAttribFormat(GLAttributePosition::Position, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position));
+		glVertexAttribBinding(GLAttributePosition::Position, VERTEX_BINDING);
+		glEnableVertexAttribArray(GLAttributePosition::Position);
+
+		glVertexAttribFormat(GLAttributePosition::Normal, 3, GL_BYTE, GL_TRUE, offsetof(Vertex, Normal));
+		glVertexAttribBinding(GLAttributePosition::Normal, VERTEX_BINDING);
+		glEnableVertexAttribArray(GLAttributePosition::Normal);
+
+		glVertexAttribIFormat(GLAttributePosition::Color, 1, GL_UNSIGNED_BYTE, offsetof(Vertex, BlockType));
+		glVertexAttribBinding(GLAttributePosition::Color, VERTEX_BINDING);
+		glEnableVertexAttribArray(GLAttributePosition::Color);
+
+		glBindVertexBuffer(VERTEX_BINDING, mVertexBuffer, 0, sizeof(Vertex));
+	SGLState::BindVertexArray(0);
+
+	mBufferBytes.Set(sizeof(Vertex) * VERTEX_COUNT + sizeof(uint32_t) * MAX_INDEX_COUNT);
+}
+
+FFarTerrain::~FFarTerrain()
+{
+	glDeleteVertexArrays(1, &mVertexArray);
+	glDeleteBuffers(1, &mVertexBuffer);
+	glDeleteBuffers(1, &mIndexBuffer);
+}
+
+void FFarTerrain::SetGenerator(const FWorldGenerator* Generator)
+{
+	mGenerator = Generator;
+	mHasSamples = false;
+	mIndexCount = 0;
+}
+
+void FFarTerrain::Update(const Vector3i& CameraChunk, const int32_t ViewDistance, const int32_t WorldSize)
+{
+	if (!mGenerator)
+		return;
+
+	const Vector3i Origin{ CameraChunk.x - GRID_SIZE / 2, 0, CameraChunk.z - GRID_SIZE / 2 };
+	const bool OriginMoved = !mHasSamples || Origin.x != mOrigin.x || Origin.z != mOrigin.z;
+
+	if (!OriginMoved && ViewDistance == mViewDistance && WorldSize == mWorldSize)
+		return;
+
+	CPU_PROFILE("FarTerrainUpdate");
+
+	const int32_t ShiftX = Origin.x - mOrigin.x;
+	const int32_t ShiftZ = Origin.z - mOrigin.z;
+
+	if (!mHasSamples || std::abs(ShiftX) >= GRID_SIZE || std::abs(ShiftZ) >= GRID_SIZE)
+	{
+		SampleCells(Origin.x, Origin.z, GRID_SIZE, GRID_SIZE);
+	}
+	else if (OriginMoved)
+	{
+		// Columns that entered the grid along x, for every row of the new grid
+		if (ShiftX > 0)
+			SampleCells(mOrigin.x + GRID_SIZE, Origin.z, ShiftX, GRID_SIZE);
+		else if (ShiftX < 0)
+			SampleCells(Origin.x, Origin.z, -ShiftX, GRID_SIZE);
+
+		// Rows that entered along z, leaving out the columns sampled above
+		const int32_t FirstX = (ShiftX > 0) ? Origin.x : Origin.x - ShiftX;
+		const int32_t CountX = GRID_SIZE - std::abs(ShiftX);
+		if (ShiftZ > 0)
+			SampleCells(FirstX, mOrigin.z + GRID_SIZE, CountX, ShiftZ);
+		else if (ShiftZ < 0)
+			SampleCells(FirstX, Origin.z, CountX, -ShiftZ);
+	}
+
+	mOrigin = Origin;
+	mHasSamples = true;
+	mViewDistance = ViewDistance;
+	mWorldSize = WorldSize;
+
+	BuildMesh();
+}
+
+void FFarTerrain::Render() const
+{
+	if (mIndexCount == 0)
+		return;
+
+	SGLState::BindVertexArray(mVertexArray);
+	glDrawElements(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, nullptr);
+	SGLState::BindVertexArray(0);
+}
+
+void FFarTerrain::SampleCells(const int32_t FirstX, const int32_t FirstZ, const int32_t CountX, const int32_t CountZ)
+{
+	if (CountX <= 0 || CountZ <= 0)
+		return;
+
+	mSampledHeights.resize(CountX * CountZ);
+	mSampledIDs.resize(CountX * CountZ);
+	mGenerator->SampleSurface(FirstX * CELL_SIZE, FirstZ * CELL_SIZE, CELL_SIZE, CountX, CountZ, mSampledHeights.data(), mSampledIDs.data());
+
+	for (int32_t z = 0; z < CountZ; z++)
+	{
+		for (int32_t x = 0; x < CountX; x++)
+		{
+			const int32_t Index = SampleIndex(FirstX + x, FirstZ + z);
+			mHeights[Index] = mSampledHeights[z * CountX + x];
+			mIDs[Index] = mSampledIDs[z * CountX + x];
+		}
+	}
+}
+
+void FFarTerrain::BuildMesh()
+{
+	mVertices.resize(VERTEX_COUNT);
+	mIndices.clear();
+
+	const auto HeightAt = [this](const int32_t x, const int32_t z)
+	{
+		return (float)mHeights[SampleIndex(mOrigin.x + std::min(std::max(x, 0), GRID_SIZE - 1), mOrigin.z + std::min(std::max(z, 0), GRID_SIZE - 1))];
+	};
+
+	for (int32_t z = 0; z < GRID_SIZE; z++)
+	{
+		for (int32_t x = 0; x < GRID_SIZE; x++)
+		{
+			Vertex& Corner = mVertices[z * GRID_SIZE + x];
+			const int32_t Index = SampleIndex(mOrigin.x + x, mOrigin.z + z);
+
+			Corner.Position[0] = (float)((mOrigin.x + x) * CELL_SIZE);
+			Corner.Position[1] = (float)mHeights[Index];
+			Corner.Position[2] = (float)((mOrigin.z + z) * CELL_SIZE);
+			Corner.BlockType = mIDs[Index];
+
+			// Slopes by central differences, one sided on the edges of the grid
+			const float SlopeX = (HeightAt(x + 1, z) - HeightAt(x - 1, z)) / (2.0f * CELL_SIZE);
+			const float SlopeZ = (HeightAt(x, z + 1) - HeightAt(x, z - 1)) / (2.0f * CELL_SIZE);
+			const float Scale = 127.0f / std::sqrt(SlopeX * SlopeX + 1.0f + SlopeZ * SlopeZ);
+
+			Corner.Normal[0] = (int8_t)(-SlopeX * Scale);
+			Corner.Normal[1] = (int8_t)Scale;
+			Corner.Normal[2] = (int8_t)(-SlopeZ * Scale);
+		}
+	}
+
+	// A cell lies over a chunk column, so cells of loaded columns and columns outside the world are left out
+	const int32_t CenterX = mOrigin.x + GRID_SIZE / 2;
+	const int32_t CenterZ = mOrigin.z + GRID_SIZE / 2;
+
+	for (int32_t z = 0; z < GRID_SIZE - 1; z++)
+	{
+		for (int32_t x = 0; x < GRID_SIZE - 1; x++)
+		{
+			const int32_t ColumnX = mOrigin.x + x;
+			const int32_t ColumnZ = mOrigin.z + z;
+
+			if (std::abs(ColumnX - CenterX) <= mViewDistance && std::abs(ColumnZ - CenterZ) <= mViewDistance)
+				continue;
+			if (mWorldSize > 0 && (ColumnX < 0 || ColumnX >= mWorldSize || ColumnZ < 0 || ColumnZ >= mWorldSize))
+				continue;
+
+			// Counter clockwise seen from above
+			const uint32_t First = z * GRID_SIZE + x;
+			const uint32_t Corners[] = { First, First + GRID_SIZE, First + GRID_SIZE + 1, First, First + GRID_SIZE + 1, First + 1 };
+			mIndices.insert(mIndices.end(), std::begin(Corners), std::end(Corners));
+		}
+	}
+
+	mIndexCount = (uint32_t)mIndices.size();
+
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * mVertices.size(), mVertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (mIndexCount > 0)
+	{
+		SGLState::BindVertexArray(mVertexArray);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(uint32_t) * mIndexCount, mIndices.data());
+		SGLState::BindVertexArray(0);
+	}
+}
+
+int32_t FFarTerrain::SampleIndex(const int32_t CellX, const int32_t CellZ)
+{
+	const int32_t x = ((CellX % GRID_SIZE) + GRID_SIZE) % GRID_SIZE;
+	const int32_t z = ((CellZ % GRID_SIZE) + GRID_SIZE) % GRID_SIZE;
+	return z * GRID_SIZE + x;
+}
@@ -0,0 +1,106 @@
+#include "ChunkSystems\FluidSimulator.h"
+#include "ChunkSystems\Chunk.h"
+#include "Math\FMath.h"
+
+#include <algorithm>
+
+const Vector3i FFluidSimulator::NEIGHBORHOOD[NEIGHBORHOOD_SIZE] =
+{
+	Vector3i{ 0, 1, 0 },
+	Vector3i{ 1, 0, 0 }, Vector3i{ -1, 0, 0 }, Vector3i{ 0, 0, 1 }, Vector3i{ 0, 0, -1 },
+	Vector3i{ 1, -1, 0 }, Vector3i{ -1, -1, 0 }, Vector3i{ 0, -1, 1 }, Vector3i{ 0, -1, -1 },
+};
+
+namespace
+{
+	// Bits of each axis in a packed cell
+	const uint32_t CELL_AXIS_BITS = CHUNK_SIZE_BITS;
+	const uint32_t CELL_AXIS_MASK = (1 << CELL_AXIS_BITS) - 1;
+
+	// Index of the first side and of the block below the first side in NEIGHBORHOOD
+	const uint32_t FIRST_SIDE = 1;
+	const uint32_t FIRST_BELOW_SIDE = 5;
+}
+
+FFluidSimulator::FFluidSimulator()
+	: mFluids()
+	, mLevels()
+	, mActive()
+{
+	static_assert(FChunk::CHUNK_SIZE <= (1 << CELL_AXIS_BITS) && 3 * CELL_AXIS_BITS <= 8 * sizeof(PackedCell), "Local positions must fit in a packed cell");
+}
+
+void FFluidSimulator::AddFluid(const FBlockTypes::BlockID First, const uint32_t LevelCount)
+{
+	mFluids.push_back(Fluid{ First, LevelCount });
+	for (uint32_t Level = 1; Level <= LevelCount; Level++)
+		mLevels[First + Level - 1] = LevelRecord{ (uint8_t)mFluids.size(), (uint8_t)Level };
+}
+
+void FFluidSimulator::ActivateAround(const Vector3i& Position)
+{
+	for (uint32_t i = 0; i <= NEIGHBORHOOD_SIZE; i++)
+	{
+		const Vector3i Cell = (i == NEIGHBORHOOD_SIZE) ? Position : Position - NEIGHBORHOOD[i];
+		const Vector3i Local = FMath::FloorModulo(Cell, FChunk::CHUNK_SIZE);
+		mActive[FMath::FloorDivide(Cell, FChunk::CHUNK_SIZE)].push_back((PackedCell)(Local.x | (Local.y << CELL_AXIS_BITS) | (Local.z << (2 * CELL_AXIS_BITS))));
+	}
+}
+
+void FFluidSimulator::TakeActive(std::vector<ActiveChunk>& ChunksOut)
+{
+	ChunksOut.resize(mActive.size());
+
+	uint32_t i = 0;
+	for (auto& Chunk : mActive)
+	{
+		std::vector<PackedCell>& Cells = Chunk.second;
+		std::sort(Cells.begin(), Cells.end());
+		Cells.erase(std::unique(Cells.begin(), Cells.end()), Cells.end());
+
+		ChunksOut[i].ChunkPosition = Chunk.first;
+		ChunksOut[i].Cells.swap(Cells);
+		i++;
+	}
+
+	mActive.clear();
+}
+
+FBlockTypes::BlockID FFluidSimulator::Step(const FBlockTypes::BlockID ID, const FBlockTypes::BlockID* Neighborhood) const
+{
+	// Only air and flowing fluid change
+	const LevelRecord& Cell = mLevels[ID];
+	if (ID != FBlock::AIR_BLOCK_ID && (Cell.Fluid == 0 || Cell.Level == mFluids[Cell.Fluid - 1].LevelCount))
+		return ID;
+
+	// Falling fluid flows at the level below its source
+	const LevelRecord& Above = mLevels[Neighborhood[0]];
+	if (Above.Fluid != 0)
+	{
+		const Fluid& Falling = mFluids[Above.Fluid - 1];
+		return Falling.First + Falling.LevelCount - 2;
+	}
+
+	// Fluid resting on a block spreads one level lower to its sides
+	uint32_t BestFluid = 0;
+	uint32_t BestLevel = 0;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		const LevelRecord& Side = mLevels[Neighborhood[FIRST_SIDE + i]];
+		if (Side.Fluid != 0 && Side.Level > 1 && Side.Level - 1u > BestLevel && Neighborhood[FIRST_BELOW_SIDE + i] != FBlock::AIR_BLOCK_ID)
+		{
+			BestFluid = Side.Fluid;
+			BestLevel = Side.Level - 1;
+		}
+	}
+
+	if (BestFluid == 0)
+		return FBlock::AIR_BLOCK_ID;
+
+	return mFluids[BestFluid - 1].First + BestLevel - 1;
+}
+
+Vector3i FFluidSimulator::UnpackCell(const PackedCell Cell)
+{
+	return Vector3i{ (int32_t)(Cell & CELL_AXIS_MASK), (int32_t)((Cell >> CELL_AXIS_BITS) & CELL_AXIS_MASK), (int32_t)(Cell >> (2 * CELL_AXIS_BITS)) };
+}
@@ -0,0 +1,414 @@
+#include "ChunkSystems\LightPropagator.h"
+#include "ChunkSystems\Chunk.h"
+#include "ChunkSystems\BlockTypes.h"
+#include "Math\FMath.h"
+#include "Memory\FrameAllocator.h"
+
+#include <utility>
+
+namespace
+{
+	// Offsets to the neighbor across each face, ordered by FChunk::NormalID
+	const Vector3i FACE_OFFSETS[6] =
+	{
+		Vector3i{ 1, 0, 0 },
+		Vector3i{ -1, 0, 0 },
+		Vector3i{ 0, 1, 0 },
+		Vector3i{ 0, -1, 0 },
+		Vector3i{ 0, 0, 1 },
+		Vector3i{ 0, 0, -1 }
+	};
+
+	/**
+	* The light a block gets from a neighbor across one of its faces.
+	* @param SourceLevels - The packed light of the neighbor.
+	* @param TargetLevels - The packed light of the block.
+	* @param Face - The NormalID of the direction from the neighbor to the block.
+	* @return The packed light of the block with the neighbor's light spread into it.
+	*/
+	uint8_t SpreadLevels(const uint8_t SourceLevels, const uint8_t TargetLevels, const uint32_t Face)
+	{
+		const uint8_t SourceSky = FChunkLight::GetSky(SourceLevels);
+		const uint8_t SourceBlock = FChunkLight::GetBlock(SourceLevels);
+
+		// Full sky light falls straight down without dimming
+		const uint8_t SpreadSky = (SourceSky == FChunkLight::MAX_LEVEL && Face == FChunk::NormalID::Bottom) ? SourceSky : (SourceSky > 0) ? SourceSky - 1 : 0;
+		const uint8_t SpreadBlock = (SourceBlock > 0) ? SourceBlock - 1 : 0;
+
+		const uint8_t TargetSky = FChunkLight::GetSky(TargetLevels);
+		const uint8_t TargetBlock = FChunkLight::GetBlock(TargetLevels);
+
+		return FChunkLight::PackLevels((SpreadSky > TargetSky) ? SpreadSky : TargetSky, (SpreadBlock > TargetBlock) ? SpreadBlock : TargetBlock);
+	}
+}
+
+FLightPropagator::FLightPropagator(const ChunkLookup& FindChunk)
+	: mFindChunk(FindChunk)
+	, mChunks()
+	, mLastChunkPosition()
+	, mLastChunk(nullptr)
+	, mAdditions()
+	, mSkyRemovals()
+	, mBlockRemovals()
+{
+}
+
+void FLightPropagator::LightChunk(const FBlockStorage& Blocks, FChunkLight& LightOut)
+{
+	const int32_t Size = FChunk::CHUNK_SIZE;
+
+	// Chunks of a single block type are lit by a single level
+	if (Blocks.IsUniform())
+	{
+		const FBlockTypes::BlockID ID = Blocks.Get(0);
+		if (!FBlockTypes::IsOpaque(ID))
+			LightOut.Fill(FChunkLight::PackLevels(FChunkLight::MAX_LEVEL, FBlockTypes::GetBlockLight(ID)));
+		else
+			LightOut.Fill(FChunkLight::PackLevels(0, FBlockTypes::GetBlockLight(ID)));
+
+		return;
+	}
+
+	// Lighting runs on chunk workers, so the working data comes from the worker's scratch memory
+	FStackScope Scratch(SFrameAllocator::GetScratch());
+
+	std::vector<FBlock, TStackAdapter<FBlock>> BlockData(FChunk::BLOCKS_PER_CHUNK, FBlock{}, SFrameAllocator::ScratchAdapter<FBlock>());
+	Blocks.Unpack(BlockData.data());
+
+	std::vector<uint8_t, TStackAdapter<uint8_t>> Levels(FChunk::BLOCKS_PER_CHUNK, 0, SFrameAllocator::ScratchAdapter<uint8_t>());
+	std::vector<int32_t, TStackAdapter<int32_t>> Queue(SFrameAllocator::ScratchAdapter<int32_t>());
+	Queue.reserve(FChunk::BLOCKS_PER_CHUNK);
+
+	// Sky light falls down each column until it reaches an opaque block
+	for (int32_t x = 0; x < Size; x++)
+	{
+		for (int32_t z = 0; z < Size; z++)
+		{
+			for (int32_t y = Size - 1; y >= 0 && !FBlockTypes::IsOpaque(BlockData[FChunk::BlockIndex(x, y, z)].ID); y--)
+				Levels[FChunk::BlockIndex(x, y, z)] = FChunkLight::PackLevels(FChunkLight::MAX_LEVEL, 0);
+		}
+	}
+
+	// Full sky light below is either full or opaque, so it only spreads from blocks beside darker open blocks
+	for (int32_t y = 0; y < Size; y++)
+	{
+		for (int32_t x = 0; x < Size; x++)
+		{
+			for (int32_t z = 0; z < Size; z++)
+			{
+				const int32_t Index = FChunk::BlockIndex(x, y, z);
+				if (FChunkLight::GetSky(Levels[Index]) != FChunkLight::MAX_LEVEL)
+					continue;
+
+				bool BordersDarkAir = false;
+				for (uint32_t Face = 0; Face < 6 && !BordersDarkAir; Face++)
+				{
+					const Vector3i Neighbor = Vector3i{ x, y, z } + FACE_OFFSETS[Face];
+					if (Neighbor.y != y || Neighbor.x < 0 || Neighbor.x >= Size || Neighbor.z < 0 || Neighbor.z >= Size)
+						continue;
+
+					const int32_t NeighborIndex = FChunk::BlockIndex(Neighbor);
+					BordersDarkAir = !FBlockTypes::IsOpaque(BlockData[NeighborIndex].ID) && FChunkLight::GetSky(Levels[NeighborIndex]) != FChunkLight::MAX_LEVEL;
+				}
+
+				if (BordersDarkAir)
+					Queue.push_back(Index);
+			}
+		}
+	}
+
+	// Emitting blocks are lit by their own light
+	for (int32_t i = 0; i < FChunk::BLOCKS_PER_CHUNK; i++)
+	{
+		const uint8_t Emitted = FBlockTypes::GetBlockLight(BlockData[i].ID);
+		if (Emitted != 0)
+		{
+			Levels[i] = FChunkLight::PackLevels(FChunkLight::GetSky(Levels[i]), Emitted);
+			Queue.push_back(i);
+		}
+	}
+
+	// Flood fill within the chunk. Light crossing the chunk's borders is spread by AddChunk.
+	for (uint32_t Head = 0; Head < Queue.size(); Head++)
+	{
+		const int32_t Index = Queue[Head];
+		const Vector3i Position{ (Index / Size) % Size, Index / (Size * Size), Index % Size };
+
+		for (uint32_t Face = 0; Face < 6; Face++)
+		{
+			const Vector3i Neighbor = Position + FACE_OFFSETS[Face];
+			if (Neighbor.x < 0 || Neighbor.x >= Size || Neighbor.y < 0 || Neighbor.y >= Size || Neighbor.z < 0 || Neighbor.z >= Size)
+				continue;
+
+			const int32_t NeighborIndex = FChunk::BlockIndex(Neighbor);
+			if (FBlockTypes::IsOpaque(BlockData[NeighborIndex].ID))
+				continue;
+
+			const uint8_t NewLevels = SpreadLevels(Levels[Index], Levels[NeighborIndex], Face);
+			if (NewLevels != Levels[NeighborIndex])
+			{
+				Levels[NeighborIndex] = NewLevels;
+				Queue.push_back(NeighborIndex);
+			}
+		}
+	}
+
+	LightOut.Pack(Levels.data());
+}
+
+void FLightPropagator::AddChunk(const Vector3i& ChunkPosition)
+{
+	if (!GetChunk(ChunkPosition).Chunk)
+		return;
+
+	const int32_t Size = FChunk::CHUNK_SIZE;
+	const Vector3i Origin = ChunkPosition * Size;
+
+	for (uint32_t Face = 0; Face < 6; Face++)
+	{
+		if (!GetChunk(ChunkPosition + FACE_OFFSETS[Face]).Chunk)
+			continue;
+
+		// Positive faces have even ids
+		const int32_t d = Face / 2;
+		const int32_t u = (d + 1) % 3;
+		const int32_t v = (d + 2) % 3;
+
+		Vector3i Inner;
+		Inner[d] = (Face % 2 == 0) ? Size - 1 : 0;
+		Vector3i Outer;
+		Outer[d] = (Face % 2 == 0) ? Size : -1;
+
+		for (int32_t j = 0; j < Size; j++)
+		{
+			for (int32_t i = 0; i < Size; i++)
+			{
+				Inner[u] = Outer[u] = i;
+				Inner[v] = Outer[v] = j;
+
+				const Vector3i InnerPosition = Origin + Inner;
+				const Vector3i OuterPosition = Origin + Outer;
+
+				// Light on both sides of the border spreads across it
+				mAdditions.push_back(InnerPosition);
+				mAdditions.push_back(OuterPosition);
+
+				// Chunks lit on their own take full sky light from above, which is removed
+				// where the chunk above doesn't pass it down
+				if (d == 1)
+				{
+					const Vector3i& UpperPosition = (Face == FChunk::NormalID::Top) ? OuterPosition : InnerPosition;
+					const Vector3i& LowerPosition = (Face == FChunk::NormalID::Top) ? InnerPosition : OuterPosition;
+
+					Cell Upper, Lower;
+					FindCell(UpperPosition, Upper);
+					FindCell(LowerPosition, Lower);
+
+					const uint8_t UpperLevels = Upper.Entry->Chunk->GetLight().Get(Upper.Index);
+					const uint8_t LowerLevels = Lower.Entry->Chunk->GetLight().Get(Lower.Index);
+
+					if (FChunkLight::GetSky(LowerLevels) == FChunkLight::MAX_LEVEL && FChunkLight::GetSky(UpperLevels) != FChunkLight::MAX_LEVEL)
+					{
+						SetLight(LowerPosition, Lower, FChunkLight::PackLevels(0, FChunkLight::GetBlock(LowerLevels)));
+						mSkyRemovals.push_back(LightNode{ LowerPosition, FChunkLight::MAX_LEVEL });
+					}
+				}
+			}
+		}
+	}
+}
+
+void FLightPropagator::UpdateBlock(const Vector3i& Position)
+{
+	Cell Target;
+	if (!FindCell(Position, Target))
+		return;
+
+	const FBlockTypes::BlockID ID = Target.Entry->Blocks[Target.Index].ID;
+	const uint8_t Levels = Target.Entry->Chunk->GetLight().Get(Target.Index);
+	const uint8_t Emitted = FBlockTypes::GetBlockLight(ID);
+
+	// Clear the block's old light from everything it reached, then let the light around it fill back in
+	SetLight(Position, Target, FChunkLight::PackLevels(0, Emitted));
+
+	if (FChunkLight::GetSky(Levels) != 0)
+		mSkyRemovals.push_back(LightNode{ Position, FChunkLight::GetSky(Levels) });
+
+	if (FChunkLight::GetBlock(Levels) != 0)
+		mBlockRemovals.push_back(LightNode{ Position, FChunkLight::GetBlock(Levels) });
+
+	if (Emitted != 0)
+		mAdditions.push_back(Position);
+
+	if (!FBlockTypes::IsOpaque(ID))
+	{
+		for (uint32_t Face = 0; Face < 6; Face++)
+			mAdditions.push_back(Position + FACE_OFFSETS[Face]);
+
+		// Blocks below chunks that aren't loaded are open to the sky, as they are in LightChunk
+		Cell Above;
+		if (!FindCell(Position + FACE_OFFSETS[FChunk::NormalID::Top], Above))
+		{
+			SetLight(Position, Target, FChunkLight::PackLevels(FChunkLight::MAX_LEVEL, Emitted));
+			mAdditions.push_back(Position);
+		}
+	}
+}
+
+void FLightPropagator::Propagate()
+{
+	// Removals queue the blocks that fill removed light back in
+	RemoveLight(mSkyRemovals, true);
+	RemoveLight(mBlockRemovals, false);
+	AddLight();
+}
+
+void FLightPropagator::TakeChanges(std::vector<ChunkChange>& ChangesOut)
+{
+	ASSERT(mAdditions.empty() && mSkyRemovals.empty() && mBlockRemovals.empty());
+
+	for (const auto& Entry : mChunks)
+	{
+		if (Entry.second.Chunk && Entry.second.SectionMask != 0)
+			ChangesOut.push_back(ChunkChange{ Entry.first, Entry.second.SectionMask });
+	}
+
+	mChunks.clear();
+	mLastChunk = nullptr;
+}
+
+FLightPropagator::ChunkEntry& FLightPropagator::GetChunk(const Vector3i& ChunkPosition)
+{
+	// Light mostly spreads within a chunk, so the last chunk is checked first
+	if (mLastChunk && mLastChunkPosition == ChunkPosition)
+		return *mLastChunk;
+
+	auto Found = mChunks.find(ChunkPosition);
+	if (Found == mChunks.end())
+	{
+		Found = mChunks.insert(std::make_pair(ChunkPosition, ChunkEntry{})).first;
+
+		ChunkEntry& Entry = Found->second;
+		Entry.Chunk = mFindChunk(ChunkPosition);
+
+		// Blocks are read once so lookups don't take the block lock
+		if (Entry.Chunk)
+		{
+			Entry.Blocks.resize(FChunk::BLOCKS_PER_CHUNK);
+			Entry.Chunk->ReadBlocks([&Entry](const FBlockStorage& Blocks) { Blocks.Unpack(Entry.Blocks.data()); });
+		}
+	}
+
+	mLastChunkPosition = ChunkPosition;
+	mLastChunk = &Found->second;
+	return *mLastChunk;
+}
+
+bool FLightPropagator::FindCell(const Vector3i& Position, Cell& CellOut)
+{
+	ChunkEntry& Entry = GetChunk(FMath::FloorDivide(Position, FChunk::CHUNK_SIZE));
+	if (!Entry.Chunk)
+		return false;
+
+	CellOut.Entry = &Entry;
+	CellOut.Index = FChunk::BlockIndex(FMath::FloorModulo(Position, FChunk::CHUNK_SIZE));
+	return true;
+}
+
+void FLightPropagator::SetLight(const Vector3i& Position, const Cell& Target, const uint8_t Levels)
+{
+	Target.Entry->Chunk->GetLight().Set(Target.Index, Levels);
+
+	// The block lights the faces of its neighbors, which may be in the next chunk over
+	const Vector3i LocalPosition = FMath::FloorModulo(Position, FChunk::CHUNK_SIZE);
+	Target.Entry->SectionMask |= FChunk::EditSections(LocalPosition);
+
+	for (uint32_t Axis = 0; Axis < 3; Axis++)
+	{
+		if (LocalPosition[Axis] != 0 && LocalPosition[Axis] != FChunk::CHUNK_SIZE - 1)
+			continue;
+
+		const int32_t Offset = (LocalPosition[Axis] == 0) ? -1 : 1;
+
+		Vector3i NeighborPosition = Position;
+		NeighborPosition[Axis] += Offset;
+
+		ChunkEntry& Neighbor = GetChunk(FMath::FloorDivide(NeighborPosition, FChunk::CHUNK_SIZE));
+		Neighbor.SectionMask |= 1 << FChunk::SectionIndex(FMath::FloorModulo(NeighborPosition, FChunk::CHUNK_SIZE));
+	}
+}
+
+void FLightPropagator::RemoveLight(std::deque<LightNode>& Removals, const bool IsSky)
+{
+	while (!Removals.empty())
+	{
+		const LightNode Node = Removals.front();
+		Removals.pop_front();
+
+		for (uint32_t Face = 0; Face < 6; Face++)
+		{
+			const Vector3i Position = Node.Position + FACE_OFFSETS[Face];
+
+			Cell Neighbor;
+			if (!FindCell(Position, Neighbor))
+				continue;
+
+			const uint8_t Levels = Neighbor.Entry->Chunk->GetLight().Get(Neighbor.Index);
+			const uint8_t Level = IsSky ? FChunkLight::GetSky(Levels) : FChunkLight::GetBlock(Levels);
+			if (Level == 0)
+				continue;
+
+			// Full sky light below full sky light came straight down from it. Emitting blocks keep their own light.
+			const bool IsSkyColumn = IsSky && Face == FChunk::NormalID::Bottom && Node.Level == FChunkLight::MAX_LEVEL;
+			const bool IsEmitter = !IsSky && FBlockTypes::GetBlockLight(Neighbor.Entry->Blocks[Neighbor.Index].ID) != 0;
+
+			if ((Level < Node.Level || IsSkyColumn) && !IsEmitter)
+			{
+				const uint8_t ClearedLevels = IsSky ? FChunkLight::PackLevels(0, FChunkLight::GetBlock(Levels)) : FChunkLight::PackLevels(FChunkLight::GetSky(Levels), 0);
+				SetLight(Position, Neighbor, ClearedLevels);
+				Removals.push_back(LightNode{ Position, Level });
+			}
+			else
+			{
+				// Light from another source fills the removed light back in
+				mAdditions.push_back(Position);
+			}
+		}
+	}
+}
+
+void FLightPropagator::AddLight()
+{
+	while (!mAdditions.empty())
+	{
+		const Vector3i Position = mAdditions.front();
+		mAdditions.pop_front();
+
+		Cell Source;
+		if (!FindCell(Position, Source))
+			continue;
+
+		// Levels of 1 or less have nothing left to spread
+		const uint8_t SourceLevels = Source.Entry->Chunk->GetLight().Get(Source.Index);
+		if (FChunkLight::GetSky(SourceLevels) <= 1 && FChunkLight::GetBlock(SourceLevels) <= 1)
+			continue;
+
+		for (uint32_t Face = 0; Face < 6; Face++)
+		{
+			const Vector3i NeighborPosition = Position + FACE_OFFSETS[Face];
+
+			Cell Target;
+			if (!FindCell(NeighborPosition, Target) || FBlockTypes::IsOpaque(Target.Entry->Blocks[Target.Index].ID))
+				continue;
+
+			const uint8_t TargetLevels = Target.Entry->Chunk->GetLight().Get(Target.Index);
+			const uint8_t NewLevels = SpreadLevels(SourceLevels, TargetLevels, Face);
+
+			if (NewLevels != TargetLevels)
+			{
+				SetLight(NeighborPosition, Target, NewLevels);
+				mAdditions.push_back(NeighborPosition);
+			}
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#include "ChunkSystems\StreamingWait.h"
+#include "ChunkSystems\ChunkManager.h"
+
+FStreamingWait::FStreamingWait()
+	: mFrames(0)
+	, mIdleFrames(0)
+{
+}
+
+void FStreamingWait::Reset()
+{
+	mFrames = 0;
+	mIdleFrames = 0;
+}
+
+bool FStreamingWait::Update(FChunkManager& ChunkManager)
+{
+	mFrames++;
+	mIdleFrames = ChunkManager.GetStats().IsIdle() ? mIdleFrames + 1 : 0;
+	return IsIdle() || mFrames >= MAX_FRAMES;
+}
@@ -0,0 +1,146 @@
+#include "ChunkSystems\VoxelTerrainShape.h"
+#include "ChunkSystems\ChunkManager.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Half the size of the shape's bounds until they are set. Terrain is static,
+	// so its bounds only need to hold every body.
+	const btScalar WORLD_EXTENT = btScalar(1 << 20);
+
+	// Blocks along each axis of the pieces a query box is split into, so a piece's blocks fit in scratch
+	const int32_t PIECE_SIZE = FChunk::CHUNK_SIZE;
+
+	// Per thread solid blocks of a piece, with a border of neighbors
+	THREAD_LOCAL uint8_t SolidScratch[(PIECE_SIZE + 2) * (PIECE_SIZE + 2) * (PIECE_SIZE + 2)];
+
+	/**
+	* Emits the exposed faces of the solid blocks within a piece of a query box.
+	* @param First, Last - Inclusive corners of the piece, at most PIECE_SIZE blocks along each axis.
+	* @param TriangleIndex - Index of the next triangle, advanced past the emitted ones.
+	*/
+	void ProcessPiece(const FChunkManager& ChunkManager, const btVector3& LocalScaling, btTriangleCallback* Callback,
+		const Vector3i& First, const Vector3i& Last, int32_t& TriangleIndex)
+	{
+		// Blocks of the piece are read with a border of neighbors to find exposed faces
+		const Vector3i ReadMin = First - 1;
+		const Vector3i Size = Last - First + 3;
+
+		uint8_t* Solid = SolidScratch;
+		ChunkManager.GetSolidBlocks(ReadMin, Last + 1, Solid);
+
+		const int32_t Strides[3] = { 1, Size.x, Size.x * Size.y };
+
+		int32_t Block[3];
+		for (Block[2] = 1; Block[2] < Size.z - 1; Block[2]++)
+		{
+			for (Block[1] = 1; Block[1] < Size.y - 1; Block[1]++)
+			{
+				for (Block[0] = 1; Block[0] < Size.x - 1; Block[0]++)
+				{
+					const int32_t Index = Block[0] + Block[1] * Strides[1] + Block[2] * Strides[2];
+					if (!Solid[Index])
+						continue;
+
+					// Faces are ordered as FChunk::NormalID, positive faces have even ids
+					for (int32_t Face = 0; Face < 6; Face++)
+					{
+						const int32_t d = Face / 2;
+						const int32_t u = (d + 1) % 3;
+						const int32_t v = (d + 2) % 3;
+						const bool IsPositive = (Face % 2 == 0);
+
+						if (Solid[Index + (IsPositive ? Strides[d] : -Strides[d])])
+							continue;
+
+						// Corners wind counter clockwise seen from outside the block
+						int32_t Corner[3] = { Block[0] + ReadMin.x, Block[1] + ReadMin.y, Block[2] + ReadMin.z };
+						Corner[d] += IsPositive ? 1 : 0;
+
+						btVector3 Corners[4];
+						for (int32_t i = 0; i < 4; i++)
+						{
+							int32_t Position[3] = { Corner[0], Corner[1], Corner[2] };
+							Position[u] += (i == 1 || i == 2) ? 1 : 0;
+							Position[v] += (i >= 2) ? 1 : 0;
+							Corners[i] = btVector3((btScalar)Position[0], (btScalar)Position[1], (btScalar)Position[2]) * LocalScaling;
+						}
+
+						btVector3 Triangle[3];
+
+						Triangle[0] = Corners[0];
+						Triangle[1] = IsPositive ? Corners[1] : Corners[2];
+						Triangle[2] = IsPositive ? Corners[2] : Corners[1];
+						Callback->processTriangle(Triangle, 0, TriangleIndex++);
+
+						Triangle[0] = Corners[0];
+						Triangle[1] = IsPositive ? Corners[2] : Corners[3];
+						Triangle[2] = IsPositive ? Corners[3] : Corners[2];
+						Callback->processTriangle(Triangle, 0, TriangleIndex++);
+					}
+				}
+			}
+		}
+	}
+}
+
+FVoxelTerrainShape::FVoxelTerrainShape(const FChunkManager& ChunkManager)
+	: btConcaveShape()
+	, mChunkManager(ChunkManager)
+	, mLocalScaling(1, 1, 1)
+	, mBoundsMin(-WORLD_EXTENT, -WORLD_EXTENT, -WORLD_EXTENT)
+	, mBoundsMax(WORLD_EXTENT, WORLD_EXTENT, WORLD_EXTENT)
+{
+	m_shapeType = CUSTOM_CONCAVE_SHAPE_TYPE;
+}
+
+void FVoxelTerrainShape::processAllTriangles(btTriangleCallback* Callback, const btVector3& AabbMin, const btVector3& AabbMax) const
+{
+	btVector3 LocalMin = AabbMin / mLocalScaling;
+	btVector3 LocalMax = AabbMax / mLocalScaling;
+
+	// Only blocks within the bounds can collide. Queries such as Bullet's debug
+	// drawing pass boxes too large to convert to block positions.
+	LocalMin.setMax(mBoundsMin);
+	LocalMax.setMin(mBoundsMax);
+	if (LocalMin.x() > LocalMax.x() || LocalMin.y() > LocalMax.y() || LocalMin.z() > LocalMax.z())
+		return;
+
+	// Blocks overlapping the box
+	const Vector3i First{ (int32_t)std::floor(LocalMin.x()), (int32_t)std::floor(LocalMin.y()), (int32_t)std::floor(LocalMin.z()) };
+	const Vector3i Last{ (int32_t)std::floor(LocalMax.x()), (int32_t)std::floor(LocalMax.y()), (int32_t)std::floor(LocalMax.z()) };
+
+	int32_t TriangleIndex = 0;
+	Vector3i PieceFirst;
+	for (PieceFirst.z = First.z; PieceFirst.z <= Last.z; PieceFirst.z += PIECE_SIZE)
+	{
+		for (PieceFirst.y = First.y; PieceFirst.y <= Last.y; PieceFirst.y += PIECE_SIZE)
+		{
+			for (PieceFirst.x = First.x; PieceFirst.x <= Last.x; PieceFirst.x += PIECE_SIZE)
+			{
+				const Vector3i PieceLast{ std::min(PieceFirst.x + PIECE_SIZE - 1, Last.x), std::min(PieceFirst.y + PIECE_SIZE - 1, Last.y),
+					std::min(PieceFirst.z + PIECE_SIZE - 1, Last.z) };
+				ProcessPiece(mChunkManager, mLocalScaling, Callback, PieceFirst, PieceLast, TriangleIndex);
+			}
+		}
+	}
+}
+
+void FVoxelTerrainShape::getAabb(const btTransform& Transform, btVector3& AabbMin, btVector3& AabbMax) const
+{
+	btTransformAabb(mBoundsMin * mLocalScaling, mBoundsMax * mLocalScaling, getMargin(), Transform, AabbMin, AabbMax);
+}
+
+void FVoxelTerrainShape::SetBounds(const btVector3& Min, const btVector3& Max)
+{
+	mBoundsMin = Min / mLocalScaling;
+	mBoundsMax = Max / mLocalScaling;
+}
+
+void FVoxelTerrainShape::calculateLocalInertia(btScalar Mass, btVector3& Inertia) const
+{
+	// Terrain is static, so it never rotates
+	(void)Mass;
+	Inertia.setValue(0, 0, 0);
+}
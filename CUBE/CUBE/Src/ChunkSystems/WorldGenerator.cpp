@@ -1,19 +1,181 @@
 #include "ChunkSystems\WorldGenerator.h"
 #include "LibNoise\noise.h"
 #include "ChunkSystems\Chunk.h"
+#include "ChunkSystems\ChunkRLE.h"
 #include "FileIO\RegionFile.h"
+#include "FileIO\ChunkCodec.h"
 #include "Math\FMath.h"
 #include "SystemResources\SystemFile.h"
+#include <emmintrin.h>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Heightmap rows built by a thread at a time, one chunk wide
+	const int32_t HEIGHT_MAP_TILE_ROWS = FChunk::CHUNK_SIZE;
+
+	/**
+	* Runs Work on ThreadCount threads and waits for all of them.
+	*/
+	void RunOnThreads(const uint32_t ThreadCount, const std::function<void()>& Work)
+	{
+		std::vector<std::thread> Threads;
+		for (uint32_t i = 1; i < ThreadCount; i++)
+			Threads.push_back(std::thread(Work));
+
+		// This thread does its share too
+		Work();
+
+		for (std::thread& Thread : Threads)
+			Thread.join();
+	}
+
+	using RowMask = FChunk::RowMask;
+
+	// Bits of every block of a row along z
+	const RowMask FULL_ROW = (RowMask)(~0ull >> (64 - FChunk::CHUNK_SIZE));
+
+	/**
+	* Maps the heightmap samples of a chunk's columns to heights, 16 columns at a time, and
+	* finds how many of the chunk's layers each column fills. Blocks are solid up to their
+	* column's height.
+	* @param Heights - Samples for the chunk's first column, in rows along z.
+	* @param Stride - The distance between rows, which are along x.
+	* @param BaseY - The world height of the chunk's lowest layer.
+	* @param LayersOut - To put the solid layers of each column counted from the bottom, indexed [x][z].
+	*/
+	void FindSolidLayers(const float* Heights, const int32_t Stride, const float MinHeight, const float MaxHeight, const int32_t BaseY,
+		uint8_t LayersOut[FChunk::CHUNK_SIZE][FChunk::CHUNK_SIZE])
+	{
+		static_assert(FChunk::CHUNK_SIZE % 16 == 0, "Columns are mapped 16 at a time.");
+
+		// The steps of FMath::MapValue from [-1, 1] in the same order, so heights round as they always have
+		const __m128 One = _mm_set1_ps(1.0f);
+		const __m128 MinOriginal = _mm_set1_ps(-1.0f);
+		const __m128 OriginalRange = _mm_set1_ps(2.0f);
+		const __m128 ResultRange = _mm_set1_ps(MaxHeight - MinHeight);
+		const __m128 MinResult = _mm_set1_ps(MinHeight);
+
+		// A block is solid if its height is at most the column's, so a column fills floor(Height) - BaseY + 1 layers
+		const __m128 LayerOffset = _mm_set1_ps((float)(BaseY - 1));
+		const __m128 NoLayers = _mm_setzero_ps();
+		const __m128 AllLayers = _mm_set1_ps((float)FChunk::CHUNK_SIZE);
+
+		for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+		{
+			const float* Row = Heights + x * Stride;
+			for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z += 16)
+			{
+				__m128i Layers[4];
+				for (int32_t i = 0; i < 4; i++)
+				{
+					const __m128 Sample = _mm_loadu_ps(Row + z + i * 4);
+					const __m128 Height = _mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_sub_ps(_mm_add_ps(Sample, One), MinOriginal), OriginalRange), ResultRange), MinResult);
+
+					// Truncation rounds negative heights up, so those are stepped back down
+					const __m128 Truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(Height));
+					const __m128 Floor = _mm_sub_ps(Truncated, _mm_and_ps(_mm_cmpgt_ps(Truncated, Height), One));
+
+					const __m128 Filled = _mm_min_ps(_mm_max_ps(_mm_sub_ps(Floor, LayerOffset), NoLayers), AllLayers);
+					Layers[i] = _mm_cvttps_epi32(Filled);
+				}
+
+				const __m128i Packed = _mm_packus_epi16(_mm_packs_epi32(Layers[0], Layers[1]), _mm_packs_epi32(Layers[2], Layers[3]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&LayersOut[x][z]), Packed);
+			}
+		}
+	}
+
+	// Smallest distance between cave lattice points, and the most points it takes along each axis of a chunk
+	const int32_t MIN_CAVE_SPACING = 4;
+	const int32_t MAX_CAVE_POINTS = FChunk::CHUNK_SIZE / MIN_CAVE_SPACING + 1;
+
+	__m128 Lerp(const __m128 From, const __m128 To, const __m128 Weight)
+	{
+		return _mm_add_ps(From, _mm_mul_ps(_mm_sub_ps(To, From), Weight));
+	}
+
+	/**
+	* Interpolates a layer of a chunk's cave lattice to every column of the chunk, along x
+	* and z. A lattice cell spans a multiple of 4 blocks, so each 4 blocks along z share one.
+	* @param Lattice - Samples every Spacing blocks, indexed [y][x][z] with Points along each axis.
+	* @param Layer - The layer of the lattice to interpolate.
+	* @param PlaneOut - To put the noise of each column at the layer, indexed [x][z].
+	*/
+	void ExpandCaveLayer(const float* Lattice, const int32_t Points, const int32_t Spacing, const int32_t Layer,
+		float PlaneOut[FChunk::CHUNK_SIZE][FChunk::CHUNK_SIZE])
+	{
+		const __m128 BlockWeight = _mm_set1_ps(1.0f / Spacing);
+		const __m128 LaneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+		for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+		{
+			const float* Near = Lattice + (Layer * Points + x / Spacing) * Points;
+			const float* Far = Near + Points;
+			const __m128 WeightX = _mm_set1_ps((float)(x % Spacing) / Spacing);
+
+			for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z += 4)
+			{
+				const int32_t Cell = z / Spacing;
+				const __m128 WeightZ = _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)(z % Spacing)), LaneOffsets), BlockWeight);
+
+				const __m128 NearRow = Lerp(_mm_set1_ps(Near[Cell]), _mm_set1_ps(Near[Cell + 1]), WeightZ);
+				const __m128 FarRow = Lerp(_mm_set1_ps(Far[Cell]), _mm_set1_ps(Far[Cell + 1]), WeightZ);
+				_mm_storeu_ps(&PlaneOut[x][z], Lerp(NearRow, FarRow, WeightX));
+			}
+		}
+	}
+
+	/**
+	* Finds the blocks of a row along z that caves are carved from, interpolating between
+	* the expanded lattice layers below and above it.
+	* @param Below, Above - The noise of the row's columns at the lattice layers around it.
+	* @param WeightY - How far the row is from Below towards Above, within [0, 1).
+	* @return Bit z is set if that block is carved.
+	*/
+	RowMask FindCaveRow(const float* Below, const float* Above, const float WeightY, const float Threshold)
+	{
+		const __m128 Weight = _mm_set1_ps(WeightY);
+		const __m128 Thresholds = _mm_set1_ps(Threshold);
+
+		RowMask Carved = 0;
+		for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z += 4)
+		{
+			const __m128 Density = Lerp(_mm_loadu_ps(Below + z), _mm_loadu_ps(Above + z), Weight);
+			Carved |= (RowMask)_mm_movemask_ps(_mm_cmpgt_ps(Density, Thresholds)) << z;
+		}
+
+		return Carved;
+	}
+}
 
 FWorldGenerator::FWorldGenerator()
 	: mTerrainLevels()
+	, mTerrainTable()
+	, mTerrainTableFirst(0)
+	, mNoiseModule(nullptr)
+	, mCaveModule(nullptr)
+	, mCaveThreshold(0.0f)
+	, mCaveSpacing(4)
+	, mSIMDNoise()
+	, mUseSIMDNoise(false)
 	, mLowerBounds(0, 0)
 	, mUpperBounds(1, 1)
 	, mWorldSizeInChunks(2)
 	, mMaxHeight(1)
 	, mMinHeight(0)
+	, mThreadCount(1)
 {
+	const uint32_t HardwareThreads = std::thread::hardware_concurrency();
+	if (HardwareThreads > 1)
+		mThreadCount = HardwareThreads;
 
 }
 
@@ -24,7 +186,36 @@ FWorldGenerator::~FWorldGenerator()
 
 void FWorldGenerator::AddTerrainLevel(const int32_t StartingHeight, const FBlockTypes::BlockID ID)
 {
-	mTerrainLevels.push_back(TerrainLevelRecord{ StartingHeight, ID });
+	// Keep levels in reverse order to be used in world generation
+	auto Position = std::find_if(mTerrainLevels.begin(), mTerrainLevels.end(), [StartingHeight](const TerrainLevelRecord& Val)
+	{
+		return Val.StartingHeight < StartingHeight;
+	});
+
+	mTerrainLevels.insert(Position, TerrainLevelRecord{ StartingHeight, ID });
+
+	// Each height from the lowest level to the highest is looked up once here, so generation doesn't search the levels
+	mTerrainTableFirst = mTerrainLevels.back().StartingHeight;
+	mTerrainTable.resize(mTerrainLevels.front().StartingHeight - mTerrainTableFirst + 1);
+	for (uint32_t i = 0; i < mTerrainTable.size(); i++)
+	{
+		const int32_t WorldY = mTerrainTableFirst + (int32_t)i;
+		auto TerrainLevel = std::find_if(mTerrainLevels.begin(), mTerrainLevels.end(), [WorldY](const TerrainLevelRecord& Val)
+		{
+			return Val.StartingHeight <= WorldY;
+		});
+
+		mTerrainTable[i] = TerrainLevel->ID;
+	}
+}
+
+void FWorldGenerator::SetCaves(const noise::module::Module& CaveModule, const float Threshold, const int32_t LatticeSpacing)
+{
+	ASSERT((LatticeSpacing == 4 || LatticeSpacing == 8) && LatticeSpacing < FChunk::CHUNK_SIZE && "Cave lattices must be 4 or 8 blocks apart.");
+
+	mCaveModule = &CaveModule;
+	mCaveThreshold = Threshold;
+	mCaveSpacing = LatticeSpacing;
 }
 
 void FWorldGenerator::SetWorldSizeInChunks(const int32_t NewWorldSize)
@@ -39,43 +230,158 @@ void FWorldGenerator::SetBounds(const Vector2f LowerBounds, const Vector2f Upper
 	mUpperBounds = UpperBounds;
 }
 
+void FWorldGenerator::SetSIMDNoise(const noise::module::Perlin& PerlinModule)
+{
+	FSIMDNoise::Parameters Parameters;
+	Parameters.Frequency = (float)PerlinModule.GetFrequency();
+	Parameters.Lacunarity = (float)PerlinModule.GetLacunarity();
+	Parameters.Persistence = (float)PerlinModule.GetPersistence();
+	Parameters.OctaveCount = PerlinModule.GetOctaveCount();
+	Parameters.Seed = PerlinModule.GetSeed();
+	Parameters.NoiseQuality = (FSIMDNoise::Quality)PerlinModule.GetNoiseQuality();
+
+	mSIMDNoise.SetParameters(Parameters);
+	mUseSIMDNoise = true;
+}
+
 void FWorldGenerator::Build(noise::module::Module& NoiseModule, const wchar_t* WorldName)
 {
 	utils::NoiseMap HeightMap;
 	BuildHeightMap(NoiseModule, HeightMap);
-	BuildWorldInfoFile(WorldName);
+	BuildWorldInfoFile(WorldName, mWorldSizeInChunks);
+
+	const int32_t NumRegions = (mWorldSizeInChunks / FRegionFile::RegionData::REGION_SIZE) + 1;
+	const int32_t RegionCount = NumRegions * NumRegions * NumRegions;
 
-	// Sort terrain levels in reverse order to be used in world generation.
-	std::sort(mTerrainLevels.begin(), mTerrainLevels.end(), [](const TerrainLevelRecord& Lhs, const TerrainLevelRecord& Rhs)
+	// Each region is its own file, so threads take whole regions
+	std::atomic<int32_t> NextRegion(0);
+
+	RunOnThreads(mThreadCount, [&]()
 	{
-		return Lhs.StartingHeight > Rhs.StartingHeight;
+		for (int32_t i = NextRegion++; i < RegionCount; i = NextRegion++)
+		{
+			const Vector3i RegionPosition{ (i / NumRegions) % NumRegions, i / (NumRegions * NumRegions), i % NumRegions };
+			BuildRegion(WorldName, RegionPosition, HeightMap);
+		}
 	});
+}
 
-	const int32_t NumRegions = (mWorldSizeInChunks / FRegionFile::RegionData::REGION_SIZE) + 1;
+void FWorldGenerator::BuildHeightMap(const noise::module::Module& NoiseModule, utils::NoiseMap& HeightMapOut)
+{
+	const int32_t WorldSize = mWorldSizeInChunks * FChunk::CHUNK_SIZE;
+	HeightMapOut.SetSize(WorldSize, WorldSize);
+
+	// Threads take tiles of rows until the map is full
+	const int32_t TileCount = (WorldSize + HEIGHT_MAP_TILE_ROWS - 1) / HEIGHT_MAP_TILE_ROWS;
+	std::atomic<int32_t> NextTile(0);
 
-	for (int32_t y = 0; y < NumRegions; y++)
+	RunOnThreads(mThreadCount, [&]()
 	{
-		for (int32_t x = 0; x < NumRegions; x++)
+		for (int32_t Tile = NextTile++; Tile < TileCount; Tile = NextTile++)
 		{
-			for (int32_t z = 0; z < NumRegions; z++)
-			{
-				BuildRegion(WorldName, Vector3i{ x, y, z }, HeightMap);
-			}
+			const int32_t FirstRow = Tile * HEIGHT_MAP_TILE_ROWS;
+			const int32_t RowCount = (WorldSize - FirstRow < HEIGHT_MAP_TILE_ROWS) ? WorldSize - FirstRow : HEIGHT_MAP_TILE_ROWS;
+			SampleHeights(NoiseModule, FirstRow, RowCount, 0, WorldSize, HeightMapOut.GetSlabPtr(FirstRow), HeightMapOut.GetStride());
+		}
+	});
+}
+
+void FWorldGenerator::SampleHeights(const noise::module::Module& NoiseModule, const int32_t FirstRow, const int32_t RowCount,
+	const int32_t FirstColumn, const int32_t ColumnCount, float* HeightsOut, const int32_t Stride, const int32_t Spacing) const
+{
+	const int32_t WorldSize = mWorldSizeInChunks * FChunk::CHUNK_SIZE;
+	const double XDelta = ((double)mUpperBounds.x - mLowerBounds.x) / WorldSize;
+	const double ZDelta = ((double)mUpperBounds.y - mLowerBounds.y) / WorldSize;
+	const double XSpacing = XDelta * Spacing;
+
+	// Rows run along the z bounds, as with utils::NoiseMapBuilderPlane
+	for (int32_t Row = 0; Row < RowCount; Row++)
+	{
+		float* RowValues = HeightsOut + Row * Stride;
+		const double ZCur = mLowerBounds.y + (FirstRow + Row * Spacing) * ZDelta;
+
+		if (mUseSIMDNoise)
+		{
+			mSIMDNoise.GetRow(mLowerBounds.x + FirstColumn * XDelta, XSpacing, 0.0, ZCur, ColumnCount, RowValues);
+			continue;
+		}
+
+		for (int32_t Column = 0; Column < ColumnCount; Column++)
+		{
+			const double XCur = mLowerBounds.x + FirstColumn * XDelta + Column * XSpacing;
+			RowValues[Column] = (float)NoiseModule.GetValue(XCur, 0.0, ZCur);
 		}
 	}
+}
 
+void FWorldGenerator::CreateWorld(const noise::module::Module& NoiseModule, const wchar_t* WorldName, const bool Unbounded)
+{
+	mNoiseModule = &NoiseModule;
+	BuildWorldInfoFile(WorldName, Unbounded ? 0 : mWorldSizeInChunks);
 }
 
-void FWorldGenerator::BuildHeightMap(const noise::module::Module& NoiseModule, utils::NoiseMap& HeightMapOut)
+uint32_t FWorldGenerator::GenerateChunk(const Vector3i& ChunkPosition, std::vector<uint8_t>& DataOut) const
 {
-	utils::NoiseMapBuilderPlane heightMapBuilder;
-	heightMapBuilder.SetSourceModule(NoiseModule);
-	heightMapBuilder.SetDestNoiseMap(HeightMapOut);
+	ASSERT(mNoiseModule && "Chunks can only be generated for a created world.");
 
-	const int32_t WorldSize = mWorldSizeInChunks * FChunk::CHUNK_SIZE;
-	heightMapBuilder.SetDestSize(WorldSize, WorldSize);
-	heightMapBuilder.SetBounds(mLowerBounds.x, mUpperBounds.x, mLowerBounds.y, mUpperBounds.y);
-	heightMapBuilder.Build();
+	// Only the column of this chunk is sampled
+	float Heights[FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE];
+	const Vector3i WorldPosition = ChunkPosition * FChunk::CHUNK_SIZE;
+
+	SampleHeights(*mNoiseModule, WorldPosition.x, FChunk::CHUNK_SIZE, WorldPosition.z, FChunk::CHUNK_SIZE, Heights, FChunk::CHUNK_SIZE);
+	return BuildChunk(WorldPosition, Heights, FChunk::CHUNK_SIZE, DataOut);
+}
+
+void FWorldGenerator::SampleSurface(const int32_t FirstX, const int32_t FirstZ, const int32_t Spacing, const int32_t CountX, const int32_t CountZ,
+	int32_t* HeightsOut, FBlockTypes::BlockID* IDsOut) const
+{
+	ASSERT(mNoiseModule && "Surfaces can only be sampled for a created world.");
+
+	// Heightmap rows are along x, so each row holds a column of z samples
+	std::vector<float> Heights(CountX * CountZ);
+	SampleHeights(*mNoiseModule, FirstX, CountX, FirstZ, CountZ, Heights.data(), CountZ, Spacing);
+
+	const float MinHeight = (float)mMinHeight;
+	const float MaxHeight = (float)mMaxHeight;
+
+	for (int32_t x = 0; x < CountX; x++)
+	{
+		for (int32_t z = 0; z < CountZ; z++)
+		{
+			// Blocks are solid up to the mapped height, as BuildChunk fills them
+			const float Height = FMath::MapValue(Heights[x * CountZ + z] + 1, -1.0f, 1.0f, MinHeight, MaxHeight);
+			const int32_t TopBlock = (int32_t)std::floor(Height);
+
+			HeightsOut[z * CountX + x] = TopBlock + 1;
+			IDsOut[z * CountX + x] = TerrainBlock(TopBlock);
+		}
+	}
+}
+
+void FWorldGenerator::SampleCaveLattice(const Vector3i& WorldPosition, const int32_t LayerCount, float* LatticeOut) const
+{
+	const int32_t Points = FChunk::CHUNK_SIZE / mCaveSpacing + 1;
+	for (int32_t y = 0; y < LayerCount; y++)
+	{
+		const double WorldY = WorldPosition.y + y * mCaveSpacing;
+		for (int32_t x = 0; x < Points; x++)
+		{
+			const double WorldX = WorldPosition.x + x * mCaveSpacing;
+			float* Row = LatticeOut + (y * Points + x) * Points;
+
+			for (int32_t z = 0; z < Points; z++)
+				Row[z] = (float)mCaveModule->GetValue(WorldX, WorldY, WorldPosition.z + z * mCaveSpacing);
+		}
+	}
+}
+
+FBlockTypes::BlockID FWorldGenerator::TerrainBlock(const int32_t WorldY) const
+{
+	// Heights below the lowest level are air, and heights above the highest level take it
+	if (mTerrainTable.empty() || WorldY < mTerrainTableFirst)
+		return FBlock::AIR_BLOCK_ID;
+
+	return mTerrainTable[std::min<uint32_t>(WorldY - mTerrainTableFirst, mTerrainTable.size() - 1)];
 }
 
 void FWorldGenerator::BuildRegion(const wchar_t* WorldName, const Vector3i& RegionPosition, const utils::NoiseMap& HeightMapOut)
@@ -96,6 +402,8 @@ void FWorldGenerator::BuildRegion(const wchar_t* WorldName, const Vector3i& Regi
 	}
 
 
+	std::vector<uint8_t> CompressedBuffer;
+
 	// Build each chunk within the region
 	for (int32_t y = 0; y < RegionBounds.y; y++)
 	{
@@ -107,61 +415,115 @@ void FWorldGenerator::BuildRegion(const wchar_t* WorldName, const Vector3i& Regi
 				const Vector3i LocalChunkPosition{ x, y, z };
 				const Vector3i WorldChunkPosition = (LocalChunkPosition + (RegionPosition * RegionSize)) * FChunk::CHUNK_SIZE;
 
-				uint32_t DataSize = BuildChunk(WorldChunkPosition, HeightMapOut, ChunkDataBuffer);
-				Region.WriteChunkData(LocalChunkPosition, ChunkDataBuffer.data(), DataSize);
+				const float* Heights = HeightMapOut.GetConstSlabPtr(WorldChunkPosition.x) + WorldChunkPosition.z;
+				uint32_t DataSize = BuildChunk(WorldChunkPosition, Heights, HeightMapOut.GetStride(), ChunkDataBuffer);
+
+				// Store compressed when it is smaller than the RLE data
+				CompressedBuffer.resize(DataSize);
+				const uint32_t CompressedSize = DataSize > 1 ? FChunkCodec::Compress(ChunkDataBuffer.data(), DataSize, CompressedBuffer.data(), DataSize - 1) : 0;
+
+				if (CompressedSize != 0)
+					Region.WriteChunkData(LocalChunkPosition, CompressedBuffer.data(), CompressedSize, FChunkCodec::LZ);
+				else
+					Region.WriteChunkData(LocalChunkPosition, ChunkDataBuffer.data(), DataSize, FChunkCodec::Raw);
 			}
 		}
 	}
 }
 
-uint32_t FWorldGenerator::BuildChunk(const Vector3i& WorldPosition, const utils::NoiseMap& HeightMap, std::vector<uint8_t>& DataOut)
+uint32_t FWorldGenerator::BuildChunk(const Vector3i& WorldPosition, const float* Heights, const int32_t Stride, std::vector<uint8_t>& DataOut) const
 {
-	uint32_t DataSize = 0;
-	const float MinHeight = (float)mMinHeight;
-	const float MaxHeight = (float)mMaxHeight;
+	// Each column's height is found once, a layer count that rows of blocks are compared against
+	uint8_t SolidLayers[FChunk::CHUNK_SIZE][FChunk::CHUNK_SIZE];
+	FindSolidLayers(Heights, Stride, (float)mMinHeight, (float)mMaxHeight, WorldPosition.y, SolidLayers);
 
+	FBlockTypes::BlockID LayerTypes[FChunk::CHUNK_SIZE];
+	for (int32_t y = 0; y < FChunk::CHUNK_SIZE; y++)
+		LayerTypes[y] = TerrainBlock(y + WorldPosition.y);
+
+	// Caves are only sampled up to the highest solid layer, so chunks of air take no samples
+	int32_t SolidTop = 0;
+	for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+		SolidTop = std::max<int32_t>(SolidTop, *std::max_element(SolidLayers[x], SolidLayers[x] + FChunk::CHUNK_SIZE));
+
+	const bool HasCaves = mCaveModule && SolidTop > 0;
+	const int32_t CavePoints = FChunk::CHUNK_SIZE / mCaveSpacing + 1;
+	float CaveLattice[MAX_CAVE_POINTS * MAX_CAVE_POINTS * MAX_CAVE_POINTS];
+	if (HasCaves)
+		SampleCaveLattice(WorldPosition, (SolidTop - 1) / mCaveSpacing + 2, CaveLattice);
+
+	// The lattice layers around the current layer, interpolated to every column as the layers reach them
+	float CavePlanes[2][FChunk::CHUNK_SIZE][FChunk::CHUNK_SIZE];
+	float (*CaveBelow)[FChunk::CHUNK_SIZE] = CavePlanes[0];
+	float (*CaveAbove)[FChunk::CHUNK_SIZE] = CavePlanes[1];
+
+	// Runs are written in place, the payload is cut to size once done
+	const std::size_t DataStart = DataOut.size();
+	DataOut.resize(DataStart + FChunk::MAX_RLE_BYTES);
+	uint8_t* Data = DataOut.data() + DataStart;
+	FChunkRLE::WriteHeader(Data);
+	uint32_t DataSize = FChunkRLE::HEADER_SIZE;
+
+	// Runs are found along each row and merged across rows, so levels of one type are a single run
+	FChunkRLE::Run Pending{ FBlock::AIR_BLOCK_ID, 0 };
 	for (int32_t y = 0; y < FChunk::CHUNK_SIZE; y++)
 	{
-		const int32_t WorldY = y + WorldPosition.y;
+		const __m128i Layer = _mm_set1_epi8((char)y);
+		const FBlockTypes::BlockID BlockType = LayerTypes[y];
 
-		// Find the terrain at this level
-		auto TerrainLevel = std::find_if(mTerrainLevels.begin(), mTerrainLevels.end(), [WorldY](const TerrainLevelRecord& Val)
+		const bool IsCarved = HasCaves && y < SolidTop;
+		const float CaveWeight = (float)(y % mCaveSpacing) / mCaveSpacing;
+		if (IsCarved && y % mCaveSpacing == 0)
 		{
-			return Val.StartingHeight <= WorldY;
-		});
+			if (y == 0)
+				ExpandCaveLayer(CaveLattice, CavePoints, mCaveSpacing, 0, CaveBelow);
+			else
+				std::swap(CaveBelow, CaveAbove);
 
-		const FBlockTypes::BlockID BlockType = (TerrainLevel != mTerrainLevels.end()) ? TerrainLevel->ID : FBlock::AIR_BLOCK_ID;
+			ExpandCaveLayer(CaveLattice, CavePoints, mCaveSpacing, y / mCaveSpacing + 1, CaveAbove);
+		}
 
 		for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
 		{
-			const float* SlabValues = HeightMap.GetConstSlabPtr(WorldPosition.x + x);
-			for (int32_t z = 0; z < FChunk::CHUNK_SIZE;)
+			// Bit z is set if that column reaches this layer
+			RowMask Solid = 0;
+			for (int32_t Part = 0; Part < FChunk::CHUNK_SIZE / 16; Part++)
 			{
-				const int32_t WorldZ = z + WorldPosition.z;
+				const __m128i Columns = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&SolidLayers[x][Part * 16]));
+				Solid |= (RowMask)_mm_movemask_epi8(_mm_cmpgt_epi8(Columns, Layer)) << (Part * 16);
+			}
 
-				float xzHeight = FMath::MapValue(SlabValues[WorldZ] + 1, -1.0f, 1.0f, MinHeight, MaxHeight);
-				bool IsAir = xzHeight < WorldY;
+			if (IsCarved && Solid != 0)
+				Solid &= ~FindCaveRow(CaveBelow[x], CaveAbove[x], CaveWeight, mCaveThreshold);
+
+			// Bit z is set if block z ends a run of the row. Runs end at the chunk border.
+			RowMask RunEnds = ((Solid ^ (Solid >> 1)) & (FULL_ROW >> 1)) | ((RowMask)1 << (FChunk::CHUNK_SIZE - 1));
+			int32_t RunStart = 0;
+			while (RunEnds)
+			{
+				const int32_t RunEnd = FMath::CountTrailingZeros(RunEnds);
+				RunEnds &= RunEnds - 1;
 
-				uint8_t Length = 1;
-				xzHeight = FMath::MapValue(SlabValues[WorldZ + Length] + 1, -1.0f, 1.0f, MinHeight, MaxHeight);
-				while ((IsAir == (xzHeight < WorldY)) && (z + (int32_t)Length < FChunk::CHUNK_SIZE))
+				const uint8_t Type = ((Solid >> RunEnd) & 1) ? BlockType : FBlock::AIR_BLOCK_ID;
+				if (Pending.Length != 0 && Pending.Type != Type)
 				{
-					Length++;
-					xzHeight = FMath::MapValue(SlabValues[WorldZ + Length] + 1, -1.0f, 1.0f, MinHeight, MaxHeight);
+					DataSize += FChunkRLE::WriteRun(Pending.Type, Pending.Length, Data + DataSize);
+					Pending.Length = 0;
 				}
 
-				DataOut.push_back(IsAir ? FBlock::AIR_BLOCK_ID : BlockType);
-				DataOut.push_back(Length);
-				DataSize += 2;
-				z += Length;
+				Pending.Type = Type;
+				Pending.Length += RunEnd - RunStart + 1;
+				RunStart = RunEnd + 1;
 			}
 		}
 	}
 
+	DataSize += FChunkRLE::WriteRun(Pending.Type, Pending.Length, Data + DataSize);
+	DataOut.resize(DataStart + DataSize);
 	return DataSize;
 }
 
-void FWorldGenerator::BuildWorldInfoFile(const wchar_t* WorldName) const
+void FWorldGenerator::BuildWorldInfoFile(const wchar_t* WorldName, const int32_t WorldSize) const
 {
 	// Create the world directory
 	IFileSystem& FileSystem = IFileSystem::GetInstance();
@@ -174,5 +536,5 @@ void FWorldGenerator::BuildWorldInfoFile(const wchar_t* WorldName) const
 
 	// Create the world info file
 	auto InfoFile = FileSystem.OpenWritable(Filepath.c_str(), false, true);
-	InfoFile->Write((uint8_t*)&mWorldSizeInChunks, 4);
+	InfoFile->Write((uint8_t*)&WorldSize, 4);
 }
\ No newline at end of file
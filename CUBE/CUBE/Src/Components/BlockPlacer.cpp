@@ -9,7 +9,7 @@
 CBlockPlacer::CBlockPlacer()
 	: FBehavior()
 	, mActiveType(0)
-	, mPlacerRange(4.0f)
+	, mPlacerRange(8.0f)
 	, mShowBox(false)
 {
 }
@@ -28,27 +28,27 @@ void CBlockPlacer::Update()
 	if (SButtonEvent::GetKeyDown(sf::Keyboard::B))
 		mShowBox = !mShowBox;
 
+	FCamera& MainCamera = *FCamera::Main;
+
+	// Pick the block the camera is looking at
+	const FRay CameraRay{ MainCamera.Transform.GetWorldPosition(), MainCamera.Transform.GetRotation() * -Vector3f::Forward };
+	FChunkManager::RaycastHit Hit;
+	if (!Raycast(CameraRay, mPlacerRange, Hit))
+		return;
+
 	if (mShowBox)
 	{
-		Vector3f CamForward = FCamera::Main->Transform.GetRotation() * -Vector3f::Forward * mPlacerRange;
-		Vector3f CamPosition = FCamera::Main->Transform.GetWorldPosition() + CamForward;
-		CamPosition = Vector3f{ std::floor(CamPosition.x) + 0.5f, std::floor(CamPosition.y) + 0.5f, std::floor(CamPosition.z) + 0.5f };
-		FDebug::Draw::GetInstance().DrawBox(CamPosition, Vector3f{ 1, 1, 1 }, FBlockTypes::GetBlockColor(mActiveType));
+		const Vector3f BoxPosition = Vector3f{ Hit.Position + Hit.Normal } + 0.5f;
+		FDebug::Draw::GetInstance().DrawBox(BoxPosition, Vector3f{ 1, 1, 1 }, FBlockTypes::GetBlockColor(mActiveType));
 	}
 
-	FCamera& MainCamera = *FCamera::Main;
-
 	if (SButtonEvent::GetMouseDown(sf::Mouse::Right))
 	{
-		Vector3f CamForward = MainCamera.Transform.GetRotation() * -Vector3f::Forward * mPlacerRange;
-		Vector3f CamPosition = MainCamera.Transform.GetWorldPosition() + CamForward;
-		DestroyBlock(CamPosition);
+		DestroyBlock(Hit.Position);
 	}
 	else if (SButtonEvent::GetMouseDown(sf::Mouse::Left))
 	{
-		Vector3f CamForward = MainCamera.Transform.GetRotation() * -Vector3f::Forward * mPlacerRange;
-		Vector3f CamPosition = MainCamera.Transform.GetWorldPosition() + CamForward;
-		SetBlock(CamPosition, (FBlockTypes::BlockID)mActiveType);
+		SetBlock(Hit.Position + Hit.Normal, (FBlockTypes::BlockID)mActiveType);
 	}
 }
 
@@ -56,6 +56,6 @@ void CBlockPlacer::ChangeType()
 {
 	mActiveType++;
 
-	if (mActiveType == 6)
+	if (mActiveType == 7)
 		mActiveType = 0;
 }
\ No newline at end of file
@@ -5,8 +5,20 @@
 #include "Components\MeshRenderer.h"
 #include "Components\SoundEmitter.h"
 #include "Rendering\Light.h"
+#include "ChunkSystems\ChunkManager.h"
+
+namespace
+{
+	// Boxes in the world at once, older ones are taken back first
+	const uint32_t BOX_COUNT = 64;
+
+	// Entity type boxes are saved by
+	const char* BOX_ENTITY_TYPE = "Box";
+}
 
 CBoxShooter::CBoxShooter()
+	: FBehavior()
+	, mBoxes()
 {
 }
 
@@ -15,21 +27,19 @@ CBoxShooter::~CBoxShooter()
 {
 }
 
-void CBoxShooter::Update()
+void CBoxShooter::OnStart()
 {
-	if (SButtonEvent::GetKeyDown(sf::Keyboard::Space))
+	mBoxes.Create(*GetGameObject(), BOX_COUNT, [](Atlas::FGameObject& Box)
 	{
-		FCamera& Camera = *FCamera::Main;
-
-		auto& Box = CreateGameObject();
-		Box.Transform.SetLocalPosition(Camera.Transform.GetWorldPosition() + Vector3f::Up * 2.0f);
 		Box.Transform.SetScale(Vector3f{ .5f, .5f, .5f });
 
-		auto& Body = Box.AddComponent<Atlas::EComponent::RigidBody>();
-		Vector3f Forward = Camera.Transform.GetRotation() * -Vector3f::Forward;
-		Body.CapsuleCollider.setImplicitShapeDimensions(btVector3{ 1, 1, 1 });
-		Body.Body.setLinearVelocity(btVector3{ Forward.x, Forward.y, Forward.z } *40.0f);
-		//Body.BoxCollider.setImplicitShapeDimensions(btVector3{ .5f, .5f, .5f });
+		// Every box shares one capsule
+		auto& Body = Box.GetComponent<Atlas::EComponent::RigidBody>();
+		Body.SetShape(FCollisionShapeRegistry::GetCapsule(1, 2));
+
+		// Boxes cross most of a block each step, so they are swept instead of stepping more often
+		Body.SetContinuousCollision(.8f, .5f);
+		//Body.SetShape(FCollisionShapeRegistry::GetBox(btVector3{ .5f, .5f, .5f }));
 
 		auto& Mesh = Box.AddComponent<Atlas::EComponent::MeshRenderer>();
 		Mesh.LinkToMesh("Box");
@@ -40,5 +50,27 @@ void CBoxShooter::Update()
 		Light.Quadratic = .5f;
 		Light.Linear = .6f;
 		Light.Color = Vector3f{ .4f, .8f, .5f };
+	});
+
+	// Boxes are parked while their chunk is unloaded, instead of simulating wherever they land
+	GetGameObject()->GetChunkManager().RegisterEntityType(BOX_ENTITY_TYPE,
+		[this](const FChunkEntities::State& Saved)
+	{
+		return &mBoxes.Spawn(Saved.Position, Saved.Rotation, Saved.Velocity, Saved.AngularVelocity);
+	},
+		[this](Atlas::FGameObject& Box) { mBoxes.Despawn(Box); });
+}
+
+void CBoxShooter::Update()
+{
+	mBoxes.Update();
+
+	if (SButtonEvent::GetKeyDown(sf::Keyboard::Space))
+	{
+		FCamera& Camera = *FCamera::Main;
+
+		Vector3f Forward = Camera.Transform.GetRotation() * -Vector3f::Forward;
+		Atlas::FGameObject& Box = mBoxes.Spawn(Camera.Transform.GetWorldPosition() + Vector3f::Up * 2.0f, Forward * 40.0f);
+		GetGameObject()->GetChunkManager().BindEntity(Box, BOX_ENTITY_TYPE);
 	}
-}
\ No newline at end of file
+}
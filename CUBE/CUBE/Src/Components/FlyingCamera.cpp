@@ -32,6 +32,7 @@ void CFlyingCamera::Update()
 	{
 		ResetMouse = !ResetMouse;
 		SMouseAxis::SetMouseLock(ResetMouse);
+		mCamera->LateLookSpeed = 0.0f;
 	}
 
 	if (ResetMouse)
@@ -53,6 +54,7 @@ void CFlyingCamera::Update()
 			YMovement = -MoveSpeed;
 
 		const float LookSpeed = mLookSpeed * STime::GetDeltaTime();
+		mCamera->LateLookSpeed = LookSpeed;
 		FQuaternion CameraRotation = mCamera->Transform.GetRotation();
 
 		Vector3f CameraForward = CameraRotation * Vector3f::Forward;
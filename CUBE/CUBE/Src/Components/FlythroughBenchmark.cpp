@@ -0,0 +1,252 @@
+#include "Components\FlythroughBenchmark.h"
+#include "Rendering\Camera.h"
+#include "ChunkSystems\ChunkManager.h"
+#include "Atlas\GameObject.h"
+#include "Memory\MemoryStats.h"
+#include "FileIO\GenericFile.h"
+#include "Debugging\ConsoleOutput.h"
+#include "FramePacer.h"
+#include "Clock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Statistics gated against the baseline, lower is better for all of them
+	const char* GATED_KEYS[] = { "frame_p95_ms", "frame_p99_ms", "visible_to_draw_p99_ms", "time_to_first_frame_ms" };
+
+	/**
+	* Gets the sample that a fraction of samples are at or below.
+	*/
+	float Percentile(std::vector<float> Samples, const float Fraction)
+	{
+		if (Samples.empty())
+			return 0.0f;
+
+		const uint32_t Index = std::min((uint32_t)(Samples.size() * Fraction), (uint32_t)Samples.size() - 1);
+		std::nth_element(Samples.begin(), Samples.begin() + Index, Samples.end());
+		return Samples[Index];
+	}
+
+	float Average(const std::vector<float>& Samples)
+	{
+		float Total = 0.0f;
+		for (const float Sample : Samples)
+			Total += Sample;
+		return Samples.empty() ? 0.0f : Total / Samples.size();
+	}
+
+	/**
+	* Finds the number after a key in flat JSON.
+	* @return False if the key isn't there.
+	*/
+	bool FindNumber(const std::string& Json, const char* Key, float& ValueOut)
+	{
+		const std::string Quoted = std::string{ "\"" } + Key + "\":";
+		const size_t Found = Json.find(Quoted);
+		if (Found == std::string::npos)
+			return false;
+
+		ValueOut = std::strtof(Json.c_str() + Found + Quoted.size(), nullptr);
+		return true;
+	}
+}
+
+CFlythroughBenchmark::CFlythroughBenchmark()
+	: FBehavior()
+	, mWaypoints()
+	, mSegmentStarts()
+	, mFrameTimes()
+	, mLoadRates()
+	, mResultFilename(L"Benchmark.json")
+	, mBaselineFilename()
+	, mOnFinished()
+	, mTolerance(0.1f)
+	, mSpeed(0.5f)
+	, mPathLength(0.0f)
+	, mDistance(0.0f)
+	, mLastFrame(0)
+	, mFrame(0)
+	, mIsFinished(false)
+{
+}
+
+void CFlythroughBenchmark::SetPath(const std::vector<Vector3f>& Waypoints, const float Speed)
+{
+	ASSERT(Waypoints.size() >= 2 && "A path needs at least two waypoints.");
+	mWaypoints = Waypoints;
+	mSpeed = Speed;
+
+	mSegmentStarts.clear();
+	mPathLength = 0.0f;
+	for (uint32_t i = 0; i < mWaypoints.size(); i++)
+	{
+		if (i > 0)
+			mPathLength += (mWaypoints[i] - mWaypoints[i - 1]).Length();
+		mSegmentStarts.push_back(mPathLength);
+	}
+}
+
+void CFlythroughBenchmark::SetOutput(const std::wstring& ResultFilename, const std::wstring& BaselineFilename, const float Tolerance)
+{
+	mResultFilename = ResultFilename;
+	mBaselineFilename = BaselineFilename;
+	mTolerance = Tolerance;
+}
+
+void CFlythroughBenchmark::OnStart()
+{
+	mFrameTimes.clear();
+	mLoadRates.clear();
+	mDistance = 0.0f;
+	mFrame = 0;
+	mIsFinished = false;
+}
+
+void CFlythroughBenchmark::Update()
+{
+	if (mIsFinished || mWaypoints.size() < 2 || !FCamera::Main)
+		return;
+
+	const uint64_t Now = FClock::ReadSystemTimer();
+
+	// Paced frames would measure the pacer, so frames run as fast as they can
+	if (mFrame == 0)
+		SFramePacer::SetTargetFPS(0.0f);
+
+	// The camera holds at the start while warming up
+	if (mFrame > WARMUP_FRAMES)
+	{
+		mFrameTimes.push_back(FClock::CyclesToSeconds(Now - mLastFrame) * 1000.0f);
+		mLoadRates.push_back(GetGameObject()->GetChunkManager().GetStats().Rates.LoadsPerSecond);
+		mDistance += mSpeed;
+	}
+
+	mLastFrame = Now;
+	mFrame++;
+
+	if (mDistance >= mPathLength)
+	{
+		mIsFinished = true;
+		const bool Passed = Finish();
+		if (mOnFinished)
+			mOnFinished(Passed);
+		return;
+	}
+
+	const Vector3f Position = SamplePath(mDistance);
+	const Vector3f Ahead = SamplePath(std::min(mDistance + 1.0f, mPathLength));
+	FCamera::Main->Transform.SetLocalPosition(Position);
+	if ((Ahead - Position).Length() > 0.0f)
+		FCamera::Main->Transform.SetRotation(FQuaternion::LookAt(Position, Ahead));
+}
+
+Vector3f CFlythroughBenchmark::SamplePath(const float Distance) const
+{
+	uint32_t Segment = 0;
+	while (Segment + 2 < mWaypoints.size() && mSegmentStarts[Segment + 1] <= Distance)
+		Segment++;
+
+	const float SegmentLength = mSegmentStarts[Segment + 1] - mSegmentStarts[Segment];
+	const float t = SegmentLength > 0.0f ? std::min((Distance - mSegmentStarts[Segment]) / SegmentLength, 1.0f) : 0.0f;
+
+	// The end waypoints stand in for the missing neighbors at either end of the path
+	const Vector3f& P0 = mWaypoints[Segment > 0 ? Segment - 1 : 0];
+	const Vector3f& P1 = mWaypoints[Segment];
+	const Vector3f& P2 = mWaypoints[Segment + 1];
+	const Vector3f& P3 = mWaypoints[std::min(Segment + 2, (uint32_t)mWaypoints.size() - 1)];
+
+	const float t2 = t * t;
+	const float t3 = t2 * t;
+	return (P1 * 2.0f + (P2 - P0) * t + (P0 * 2.0f - P1 * 5.0f + P2 * 4.0f - P3) * t2 + (P1 * 3.0f - P0 - P2 * 3.0f + P3) * t3) * 0.5f;
+}
+
+bool CFlythroughBenchmark::Finish()
+{
+	const FChunkManager::Stats Stats = GetGameObject()->GetChunkManager().GetStats();
+	const FChunkManager::StartupTimings& Startup = GetGameObject()->GetChunkManager().GetStartupTimings();
+
+	char Line[256];
+	std::string Json = "{\n";
+	sprintf_s(Line, "\t\"frames\":%u,\n", (uint32_t)mFrameTimes.size());
+	Json += Line;
+	sprintf_s(Line, "\t\"frame_avg_ms\":%.3f,\n\t\"frame_p50_ms\":%.3f,\n\t\"frame_p95_ms\":%.3f,\n\t\"frame_p99_ms\":%.3f,\n\t\"frame_max_ms\":%.3f,\n",
+		Average(mFrameTimes), Percentile(mFrameTimes, 0.5f), Percentile(mFrameTimes, 0.95f), Percentile(mFrameTimes, 0.99f), Percentile(mFrameTimes, 1.0f));
+	Json += Line;
+
+	// Pipeline timings cover the last samples of the run
+	sprintf_s(Line, "\t\"visible_to_draw_avg_ms\":%.3f,\n\t\"visible_to_draw_p99_ms\":%.3f,\n", Stats.VisibleToDraw.AverageMs, Stats.VisibleToDraw.P99Ms);
+	Json += Line;
+	sprintf_s(Line, "\t\"world_open_ms\":%.1f,\n\t\"warmup_ms\":%.1f,\n\t\"time_to_first_frame_ms\":%.1f,\n",
+		Startup.WorldOpenMs, Startup.WarmupMs, Startup.FirstFrameMs);
+	Json += Line;
+	sprintf_s(Line, "\t\"warmup_stage_ms\":{\"read\":%.1f,\"decode\":%.1f,\"mesh\":%.1f,\"upload\":%.1f},\n",
+		Startup.ReadMs, Startup.DecodeMs, Startup.MeshMs, Startup.UploadMs);
+	Json += Line;
+	sprintf_s(Line, "\t\"loads_per_second\":%.1f,\n\t\"peak_memory_kb\":{", Average(mLoadRates));
+	Json += Line;
+	for (uint32_t Tag = 0; Tag < EMemoryTag::Count; Tag++)
+	{
+		sprintf_s(Line, "%s\"%s\":%llu", Tag == 0 ? "" : ",", SMemoryStats::GetName((EMemoryTag::Type)Tag), SMemoryStats::GetPeakBytes((EMemoryTag::Type)Tag) / 1024);
+		Json += Line;
+	}
+	Json += "}\n}\n";
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	if (FileSystem.FileExists(mResultFilename.c_str()))
+		FileSystem.DeleteFilename(mResultFilename.c_str());
+
+	auto File = FileSystem.OpenWritable(mResultFilename.c_str(), false, true);
+	if (!File || !File->Write((const uint8_t*)Json.data(), Json.size()))
+		FDebug::PrintF("Failed to write benchmark results to %S.\n", mResultFilename.c_str());
+	File.reset();
+
+	FDebug::PrintF("Benchmark results:\n%s", Json.c_str());
+	if (mBaselineFilename.empty())
+		return true;
+
+	auto Baseline = FileSystem.OpenReadable(mBaselineFilename.c_str());
+	if (!Baseline)
+	{
+		FDebug::PrintF("Benchmark baseline %S could not be read.\n", mBaselineFilename.c_str());
+		return false;
+	}
+
+	std::string BaselineJson(Baseline->GetFileSize(), '\0');
+	if (!Baseline->Read((uint8_t*)&BaselineJson[0], BaselineJson.size()))
+		return false;
+
+	bool Passed = true;
+	for (const char* Key : GATED_KEYS)
+	{
+		// A stale baseline or a renamed metric must not pass the gate
+		float Expected, Measured;
+		if (!FindNumber(BaselineJson, Key, Expected))
+		{
+			FDebug::PrintF("Benchmark baseline is missing %s.\n", Key);
+			Passed = false;
+			continue;
+		}
+
+		if (!FindNumber(Json, Key, Measured))
+		{
+			FDebug::PrintF("Benchmark results are missing %s.\n", Key);
+			Passed = false;
+			continue;
+		}
+
+		if (Measured > Expected * (1.0f + mTolerance))
+		{
+			FDebug::PrintF("Benchmark regressed: %s is %.3f, baseline %.3f.\n", Key, Measured, Expected);
+			Passed = false;
+		}
+	}
+
+	FDebug::PrintF("Benchmark %s the baseline.\n", Passed ? "passed" : "failed");
+	return Passed;
+}
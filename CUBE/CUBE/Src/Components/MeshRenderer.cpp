@@ -1,8 +1,46 @@
 #include "Components\MeshRenderer.h"
 #include "ResourceHolder.h"
+#include "Math\Transform.h"
+
+#include <algorithm>
+
+#undef min
+#undef max
+
+FMeshRenderer::FMeshRenderer()
+	: Mesh(nullptr)
+	, mWorldCenter()
+	, mWorldRadius(0.0f)
+	, mBoundsRevision(0)
+	, mHasBounds(false)
+{
+}
 
 void FMeshRenderer::LinkToMesh(const char* MeshName)
 {
-	Mesh = &SMeshHolder::Get(MeshName);
+	Mesh = &SMeshHolder::Get(FStringID{ MeshName });
 	Mesh->Renderers.push_back(this);
-}
\ No newline at end of file
+	mHasBounds = false;
+}
+
+void FMeshRenderer::GetWorldBounds(const FTransform& Transform, Vector3f& CenterOut, float& RadiusOut)
+{
+	const uint32_t Revision = Transform.GetRevision();
+	if (!mHasBounds || Revision != mBoundsRevision)
+	{
+		const FMatrix4 LocalToWorld = Transform.LocalToWorldMatrix();
+
+		// The sphere grows with the largest scale of any axis
+		const float Scale = std::max(Vector3f{ LocalToWorld.M[0][0], LocalToWorld.M[0][1], LocalToWorld.M[0][2] }.Length(),
+			std::max(Vector3f{ LocalToWorld.M[1][0], LocalToWorld.M[1][1], LocalToWorld.M[1][2] }.Length(),
+				Vector3f{ LocalToWorld.M[2][0], LocalToWorld.M[2][1], LocalToWorld.M[2][2] }.Length()));
+
+		mWorldCenter = LocalToWorld.TransformPosition(Mesh->BoundsCenter);
+		mWorldRadius = Mesh->BoundsRadius * Scale;
+		mBoundsRevision = Revision;
+		mHasBounds = true;
+	}
+
+	CenterOut = mWorldCenter;
+	RadiusOut = mWorldRadius;
+}
@@ -1 +1,60 @@
+#include "Components\ObjectMesh.h"
+#include "Rendering\MeshAsset.h"
 
+#include <memory>
+#include <string>
+
+FObjectMesh::FObjectMesh()
+	: Mesh()
+	, Renderers()
+	, BoundsCenter()
+	, BoundsRadius(0.0f)
+{
+}
+
+bool FObjectMesh::LoadModel(const char* ModelFilepath)
+{
+	if (!Mesh.LoadModel(ModelFilepath))
+		return false;
+
+	SMeshAsset::ComputeBounds((const MeshVertex*)Mesh.GetVertices(), Mesh.GetVertexCount(), BoundsCenter, BoundsRadius);
+	return true;
+}
+
+bool FObjectMesh::LoadAsset(const wchar_t* AssetFilename)
+{
+	return SMeshAsset::Load(AssetFilename, Mesh, BoundsCenter, BoundsRadius);
+}
+
+void FObjectMesh::LoadAsync(const char* Name, const wchar_t* AssetFilename, const char* ModelFilepath, FJobCounter* Counter)
+{
+	// The filenames outlive the call, the jobs may run after the caller's strings are gone
+	const std::wstring Asset{ AssetFilename };
+	const std::string Model{ ModelFilepath };
+
+	SMeshHolder::LoadAsync(FStringID{ Name }, [Asset, Model]() -> SMeshHolder::FinishStep
+	{
+		auto Cooked = std::make_shared<std::vector<uint8_t>>();
+		if (SMeshAsset::Read(Asset.c_str(), *Cooked))
+		{
+			return [Cooked](FObjectMesh& ObjectMesh)
+			{
+				SMeshAsset::Upload(*Cooked, ObjectMesh.Mesh, ObjectMesh.BoundsCenter, ObjectMesh.BoundsRadius);
+			};
+		}
+
+		auto Vertices = std::make_shared<std::vector<MeshVertex>>();
+		auto Indices = std::make_shared<std::vector<uint32_t>>();
+		if (!SMeshAsset::ReadOBJ(Model.c_str(), *Vertices, *Indices))
+		{
+			// Left as an empty mesh, which renderers keep skipping
+			return [](FObjectMesh&) {};
+		}
+
+		return [Vertices, Indices](FObjectMesh& ObjectMesh)
+		{
+			SMeshAsset::ComputeBounds(Vertices->data(), Vertices->size(), ObjectMesh.BoundsCenter, ObjectMesh.BoundsRadius);
+			ObjectMesh.Mesh.MapAndActivate(Vertices->data(), Vertices->size(), Indices->data(), Indices->size());
+		};
+	}, Counter);
+}
@@ -0,0 +1,339 @@
+#include "Components\PhysicsBenchmark.h"
+#include "Components\RigidBody.h"
+#include "ChunkSystems\ChunkManager.h"
+#include "ChunkSystems\StreamingWait.h"
+#include "ChunkSystems\BlockCursor.h"
+#include "ChunkSystems\BlockTypes.h"
+#include "Rendering\Camera.h"
+#include "Atlas\GameObject.h"
+#include "Debugging\ConsoleOutput.h"
+#include "Debugging\Log.h"
+#include "FileIO\GenericFile.h"
+#include "STime.h"
+#include "Clock.h"
+
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Bodies spawned by each run of a configuration
+	const uint32_t BODY_COUNTS[] = { 100, 1000, 10000 };
+
+	// Bodies along each side of a layer of the grid, and blocks between them
+	const uint32_t GRID_SIZE = 32;
+	const int32_t GRID_SPACING = 3;
+
+	// Blocks between the layers of the grid, and from the surface to the lowest layer
+	const int32_t LAYER_SPACING = 3;
+	const int32_t DROP_HEIGHT = 4;
+
+	// Blocks the terrain mesh reaches past the grid, and below its lowest surface
+	const int32_t MESH_MARGIN = 8;
+	const int32_t MESH_DEPTH = 8;
+
+	const uint32_t COUNT_RUNS = sizeof(BODY_COUNTS) / sizeof(BODY_COUNTS[0]);
+
+	double CyclesToMilliseconds(const uint64_t Cycles, const uint32_t Count)
+	{
+		return (Count > 0) ? (double)FClock::CyclesToSeconds(Cycles) * 1000.0 / Count : 0.0;
+	}
+}
+
+CPhysicsBenchmark::CPhysicsBenchmark()
+	: FBehavior()
+	, mBodies()
+	, mConfigurations()
+	, mTerrainMesh()
+	, mTerrainMeshShape()
+	, mTerrainMeshObject()
+	, mTotals()
+	, mResults()
+	, mResultFilename(L"PhysicsBenchmark.json")
+	, mOnFinished()
+	, mPhysicsSystem(nullptr)
+	, mSpawnCenter()
+	, mStepCount(240)
+	, mRun(0)
+	, mUpdates(0)
+	, mFrame(0)
+	, mStreamingWait()
+	, mIsStreaming(false)
+	, mIsSettling(false)
+	, mHasMeshTerrain(false)
+	, mWasParallel(false)
+	, mIsFinished(false)
+{
+}
+
+CPhysicsBenchmark::~CPhysicsBenchmark()
+{
+	// The mesh can't outlive the benchmark within the simulation
+	if (mHasMeshTerrain && mPhysicsSystem)
+	{
+		mPhysicsSystem->RemoveCollider(*mTerrainMeshObject);
+		mPhysicsSystem->ApplyQueuedChanges();
+	}
+}
+
+void CPhysicsBenchmark::OnStart()
+{
+	mConfigurations.clear();
+	mResults.clear();
+	mRun = 0;
+	mFrame = 0;
+	mStreamingWait.Reset();
+	mIsStreaming = true;
+	mIsSettling = false;
+	mIsFinished = false;
+
+	if (!mPhysicsSystem)
+		return;
+
+	// Each terrain on one thread, then on the workers
+	mConfigurations.push_back(Configuration{ false, false });
+	mConfigurations.push_back(Configuration{ false, true });
+	mConfigurations.push_back(Configuration{ true, false });
+	mConfigurations.push_back(Configuration{ true, true });
+	mWasParallel = mPhysicsSystem->IsParallel();
+}
+
+void CPhysicsBenchmark::Update()
+{
+	if (mIsFinished || !mPhysicsSystem || !FCamera::Main)
+		return;
+
+	mFrame++;
+
+	// Bodies are spawned once nothing streams in, or once it gave up waiting
+	if (mIsStreaming)
+	{
+		if (!mStreamingWait.Update(GetGameObject()->GetChunkManager()))
+			return;
+
+		if (!mStreamingWait.IsIdle())
+			LOG(Warning, General, "Physics benchmark spawns before streaming went idle.");
+
+		const Vector3f Camera = FCamera::Main->Transform.GetWorldPosition();
+		mSpawnCenter = Vector3i{ (int32_t)std::floor(Camera.x), (int32_t)std::floor(Camera.y), (int32_t)std::floor(Camera.z) };
+		BuildTerrainMesh();
+
+		mIsStreaming = false;
+		BeginRun();
+		return;
+	}
+
+	if (mIsSettling)
+	{
+		if (mFrame < SETTLE_FRAMES)
+			return;
+
+		mIsSettling = false;
+		if (mRun < mConfigurations.size() * COUNT_RUNS)
+			BeginRun();
+		else
+			Finish();
+		return;
+	}
+
+	// Every update of the run counts, the first ones add its bodies
+	const FPhysicsSystem::UpdateTimings& Timings = mPhysicsSystem->GetLastUpdateTimings();
+	mTotals.QueueCycles += Timings.QueueCycles;
+	mTotals.BroadphaseCycles += Timings.BroadphaseCycles;
+	mTotals.NarrowphaseCycles += Timings.NarrowphaseCycles;
+	mTotals.SolverCycles += Timings.SolverCycles;
+	mTotals.IntegrateCycles += Timings.IntegrateCycles;
+	mTotals.StepCount += Timings.StepCount;
+	mUpdates++;
+
+	if (mTotals.StepCount < mStepCount)
+		return;
+
+	EndRun();
+	mRun++;
+	mFrame = 0;
+	mIsSettling = true;
+}
+
+void CPhysicsBenchmark::BuildTerrainMesh()
+{
+	const FChunkManager& ChunkManager = GetGameObject()->GetChunkManager();
+	const int32_t Extent = (int32_t)GRID_SIZE * GRID_SPACING / 2 + MESH_MARGIN;
+	const Vector3i Center = mSpawnCenter;
+
+	// The mesh only needs to reach below the lowest surface bodies can land on
+	int32_t Bottom = Center.y;
+	int32_t Top = Center.y;
+	for (int32_t x = Center.x - Extent; x <= Center.x + Extent; x++)
+	{
+		for (int32_t z = Center.z - Extent; z <= Center.z + Extent; z++)
+		{
+			const int32_t Surface = ChunkManager.GetSurfaceHeight(x, z);
+			if (Surface == FColumnHeights::NO_SURFACE)
+				continue;
+
+			Bottom = std::min(Bottom, Surface - MESH_DEPTH);
+			Top = std::max(Top, Surface);
+		}
+	}
+
+	mTerrainMesh.reset(new btTriangleMesh());
+
+	const FChunkManager::BlockReader Reader(ChunkManager);
+	FBlockCursor Cursor(Reader, Center);
+	FBlockTypes::BlockID Neighborhood[FBlockCursor::NEIGHBORHOOD_SIZE];
+
+	const Vector3i Min{ Center.x - Extent, Bottom, Center.z - Extent };
+	const Vector3i Max{ Center.x + Extent, Top, Center.z + Extent };
+	for (const FBlockBox::Block& Block : FBlockBox(Reader, Min, Max))
+	{
+		if (!FBlockTypes::IsCollidable(Block.ID))
+			continue;
+
+		Cursor.MoveTo(Block.Position);
+		Cursor.GetNeighborhood(Neighborhood);
+
+		// Two triangles for each face whose neighbor doesn't collide
+		for (uint32_t Face = 0; Face < 6; Face++)
+		{
+			const uint32_t Axis = Face / 2;
+			const int32_t Direction = (Face % 2 == 0) ? 1 : -1;
+
+			Vector3i Offset{ 0, 0, 0 };
+			Offset[Axis] = Direction;
+			if (FBlockTypes::IsCollidable(Neighborhood[FBlockCursor::NeighborhoodIndex(Offset)]))
+				continue;
+
+			const uint32_t U = (Axis + 1) % 3;
+			const uint32_t V = (Axis + 2) % 3;
+			btVector3 Corners[4];
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				Vector3i Corner = Block.Position;
+				Corner[Axis] += (Direction > 0) ? 1 : 0;
+				Corner[U] += (i == 1 || i == 2) ? 1 : 0;
+				Corner[V] += (i >= 2) ? 1 : 0;
+				Corners[i] = btVector3((btScalar)Corner.x, (btScalar)Corner.y, (btScalar)Corner.z);
+			}
+
+			mTerrainMesh->addTriangle(Corners[0], Corners[1], Corners[2]);
+			mTerrainMesh->addTriangle(Corners[0], Corners[2], Corners[3]);
+		}
+	}
+
+	// Bullet can't build a tree without triangles, so an empty area gets none
+	if (mTerrainMesh->getNumTriangles() == 0)
+	{
+		LOG(Warning, General, "Physics benchmark found no terrain under the camera for its mesh.");
+		return;
+	}
+
+	mTerrainMeshShape.reset(new btBvhTriangleMeshShape(mTerrainMesh.get(), true));
+	mTerrainMeshObject.reset(new btCollisionObject());
+	mTerrainMeshObject->setCollisionShape(mTerrainMeshShape.get());
+}
+
+void CPhysicsBenchmark::BeginRun()
+{
+	const Configuration& Config = mConfigurations[mRun / COUNT_RUNS];
+	const uint32_t Count = BODY_COUNTS[mRun % COUNT_RUNS];
+
+	SetMeshTerrain(Config.IsMeshTerrain);
+	mPhysicsSystem->SetParallel(Config.IsParallel);
+
+	// Layers of a square grid, small counts are a single layer as square as they fit
+	const uint32_t Side = std::min(GRID_SIZE, (uint32_t)std::ceil(std::sqrt((double)Count)));
+	const uint32_t LayerSize = Side * Side;
+	const int32_t Origin = -(int32_t)(Side - 1) * GRID_SPACING / 2;
+
+	const FChunkManager& ChunkManager = GetGameObject()->GetChunkManager();
+	mBodies.reserve(Count);
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		const uint32_t Layer = i / LayerSize;
+		const int32_t x = mSpawnCenter.x + Origin + (int32_t)((i % LayerSize) % Side) * GRID_SPACING;
+		const int32_t z = mSpawnCenter.z + Origin + (int32_t)((i % LayerSize) / Side) * GRID_SPACING;
+
+		int32_t Surface = ChunkManager.GetSurfaceHeight(x, z);
+		if (Surface == FColumnHeights::NO_SURFACE)
+			Surface = mSpawnCenter.y;
+
+		// Bodies read their motion state when constructed, so they are placed before they are added
+		Atlas::FGameObject& Body = CreateGameObject();
+		Body.Transform.SetLocalPosition(Vector3f{ x + .5f, (float)(Surface + DROP_HEIGHT + (int32_t)Layer * LAYER_SPACING), z + .5f });
+		Body.AddComponent<Atlas::EComponent::RigidBody>();
+		mBodies.push_back(&Body);
+	}
+
+	mTotals = FPhysicsSystem::UpdateTimings{};
+	mUpdates = 0;
+	mFrame = 0;
+}
+
+void CPhysicsBenchmark::EndRun()
+{
+	const Configuration& Config = mConfigurations[mRun / COUNT_RUNS];
+	const uint32_t Count = BODY_COUNTS[mRun % COUNT_RUNS];
+	const FPhysicsSystem::WorldStats Stats = mPhysicsSystem->GetWorldStats();
+
+	// Objects and their components are counted with what Bullet holds for them
+	const double BodyBytes = sizeof(Atlas::FGameObject) + sizeof(FRigidBody) + (double)Stats.BulletBytes / std::max(Count, 1u);
+	const double SleepingRatio = (Stats.RigidBodyCount > 0) ? (double)Stats.SleepingCount / Stats.RigidBodyCount : 0.0;
+	const uint32_t Steps = mTotals.StepCount;
+
+	char Line[768];
+	sprintf_s(Line, "%s\t\t{\"terrain\":\"%s\",\"parallel\":%s,\"bodies\":%u,\"updates\":%u,\"steps\":%u,"
+		"\"queue_ms\":%.4f,\"broadphase_ms_per_step\":%.4f,\"narrowphase_ms_per_step\":%.4f,\"solver_ms_per_step\":%.4f,\"integrate_ms_per_step\":%.4f,"
+		"\"sleeping_ratio\":%.4f,\"pairs\":%u,\"manifolds\":%u,\"bytes_per_body\":%.1f}",
+		mRun == 0 ? "" : ",\n", Config.IsMeshTerrain ? "triangle_mesh" : "voxel", Config.IsParallel ? "true" : "false", Count, mUpdates, Steps,
+		CyclesToMilliseconds(mTotals.QueueCycles, 1), CyclesToMilliseconds(mTotals.BroadphaseCycles, Steps), CyclesToMilliseconds(mTotals.NarrowphaseCycles, Steps),
+		CyclesToMilliseconds(mTotals.SolverCycles, Steps), CyclesToMilliseconds(mTotals.IntegrateCycles, Steps),
+		SleepingRatio, Stats.PairCount, Stats.ManifoldCount, BodyBytes);
+	mResults += Line;
+
+	for (Atlas::FGameObject* Body : mBodies)
+		Body->Destroy();
+	mBodies.clear();
+}
+
+void CPhysicsBenchmark::SetMeshTerrain(const bool Flag)
+{
+	// Without a mesh the voxel terrain is kept, and the run measures it again
+	if (Flag == mHasMeshTerrain || !mTerrainMeshObject)
+		return;
+
+	mHasMeshTerrain = Flag;
+	GetGameObject()->GetChunkManager().SetTerrainCollision(!Flag);
+	if (Flag)
+		mPhysicsSystem->AddCollider(*mTerrainMeshObject);
+	else
+		mPhysicsSystem->RemoveCollider(*mTerrainMeshObject);
+}
+
+void CPhysicsBenchmark::Finish()
+{
+	mIsFinished = true;
+
+	SetMeshTerrain(false);
+	mPhysicsSystem->SetParallel(mWasParallel);
+
+	char Line[512];
+	sprintf_s(Line, "{\n\t\"steps_per_run\":%u,\n\t\"fixed_step_ms\":%.4f,\n\t\"hardware_threads\":%u,\n\t\"mesh_triangles\":%d,\n\t\"runs\":[\n",
+		mStepCount, STime::GetFixedUpdate() * 1000.0f, std::thread::hardware_concurrency(), mTerrainMesh ? mTerrainMesh->getNumTriangles() : 0);
+	const std::string Json = Line + mResults + "\n\t]\n}\n";
+
+	auto File = IFileSystem::GetInstance().OpenWritable(mResultFilename.c_str(), false, true);
+	if (File && File->Write((const uint8_t*)Json.data(), Json.size()) && File->Flush())
+		FDebug::PrintF("Physics benchmark results written to %S.\n", mResultFilename.c_str());
+	else
+		FDebug::PrintF("Failed to write physics benchmark results to %S.\n", mResultFilename.c_str());
+	File.reset();
+
+	if (mOnFinished)
+		mOnFinished();
+}
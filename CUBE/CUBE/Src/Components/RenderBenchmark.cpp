@@ -0,0 +1,256 @@
+#include "Components\RenderBenchmark.h"
+#include "Rendering\RenderSystem.h"
+#include "Rendering\LightSystems.h"
+#include "Rendering\Camera.h"
+#include "Rendering\Screen.h"
+#include "ChunkSystems\ChunkManager.h"
+#include "Atlas\GameObject.h"
+#include "Debugging\GPUProfiler.h"
+#include "Debugging\ConsoleOutput.h"
+#include "Debugging\Log.h"
+#include "FileIO\GenericFile.h"
+#include "FramePacer.h"
+
+#include <cstdio>
+#include <cstring>
+
+CRenderBenchmark::CRenderBenchmark()
+	: FBehavior()
+	, mShots()
+	, mConfigurations()
+	, mPassTimes()
+	, mResults()
+	, mDevice()
+	, mResultFilename(L"RenderBenchmark.json")
+	, mOnFinished()
+	, mRenderSystem(nullptr)
+	, mFrameTotalNs(0)
+	, mLastMeasured(0)
+	, mMeasuredFrames(0)
+	, mFrameCount(120)
+	, mShot(0)
+	, mConfiguration(0)
+	, mFrame(0)
+	, mStreamingWait()
+	, mIsStreaming(false)
+	, mIsFinished(false)
+{
+}
+
+void CRenderBenchmark::AddShot(const Shot& NewShot)
+{
+	mShots.push_back(NewShot);
+	for (Atlas::FGameObject* Light : NewShot.Lights)
+		Light->SetActive(false);
+}
+
+void CRenderBenchmark::OnStart()
+{
+	mConfigurations.clear();
+	mResults.clear();
+	mShot = 0;
+	mIsFinished = false;
+
+	if (!mRenderSystem)
+		return;
+
+	// The setup as it is, then each post process and light system flipped on its own
+	mConfigurations.push_back(Configuration{ Toggle::None, 0 });
+	for (uint32_t i = 0; i < mRenderSystem->GetPostProcessCount(); i++)
+		mConfigurations.push_back(Configuration{ Toggle::PostProcess, i });
+	for (uint32_t i = 0; i < mRenderSystem->GetLightSystemCount(); i++)
+		mConfigurations.push_back(Configuration{ Toggle::LightSystem, i });
+
+	// Scaled or paced frames would measure the scaler and the pacer
+	mRenderSystem->GetDynamicResolution().SetEnabled(false);
+	SFramePacer::SetTargetFPS(0.0f);
+
+	if (!mShots.empty())
+		BeginShot();
+}
+
+void CRenderBenchmark::Update()
+{
+	if (mIsFinished || !mRenderSystem || !FCamera::Main)
+		return;
+
+	if (mShot >= mShots.size())
+	{
+		Finish();
+		return;
+	}
+
+	mFrame++;
+
+	// Shots are measured once nothing streams in, or once they gave up waiting
+	if (mIsStreaming)
+	{
+		if (!mStreamingWait.Update(GetGameObject()->GetChunkManager()))
+			return;
+
+		if (!mStreamingWait.IsIdle())
+			LOG(Warning, General, "Shot %s is measured before streaming went idle.", mShots[mShot].Name.c_str());
+
+		char Line[256];
+		sprintf_s(Line, "%s\t\t{\"name\":\"%s\",\"view_distance\":%u,\"streaming_frames\":%u,\"configurations\":[\n",
+			mShot == 0 ? "" : ",\n", mShots[mShot].Name.c_str(), mShots[mShot].ViewDistance, mStreamingWait.GetFrameCount());
+		mResults += Line;
+
+		mIsStreaming = false;
+		mConfiguration = 0;
+		mFrame = 0;
+		ApplyConfiguration(mConfigurations[mConfiguration]);
+		return;
+	}
+
+	// Frames resolved during warmup were submitted before or just after the configuration changed
+	if (mFrame > WARMUP_FRAMES)
+		MeasureFrame();
+	if (mFrame < WARMUP_FRAMES + mFrameCount)
+		return;
+
+	// Flipped back, so each configuration differs from the setup by one toggle
+	ApplyConfiguration(mConfigurations[mConfiguration]);
+	AppendConfiguration(mConfigurations[mConfiguration]);
+	mConfiguration++;
+	mFrame = 0;
+
+	if (mConfiguration < mConfigurations.size())
+	{
+		ApplyConfiguration(mConfigurations[mConfiguration]);
+		return;
+	}
+
+	mResults += "\n\t\t]}";
+	for (Atlas::FGameObject* Light : mShots[mShot].Lights)
+		Light->SetActive(false);
+
+	mShot++;
+	if (mShot < mShots.size())
+		BeginShot();
+	else
+		Finish();
+}
+
+void CRenderBenchmark::BeginShot()
+{
+	const Shot& Current = mShots[mShot];
+	FCamera::Main->Transform.SetLocalPosition(Current.Position);
+	if ((Current.Target - Current.Position).Length() > 0.0f)
+		FCamera::Main->Transform.SetRotation(FQuaternion::LookAt(Current.Position, Current.Target));
+
+	GetGameObject()->GetChunkManager().SetViewDistance(Current.ViewDistance);
+	for (Atlas::FGameObject* Light : Current.Lights)
+		Light->SetActive(true);
+
+	mIsStreaming = true;
+	mStreamingWait.Reset();
+	mFrame = 0;
+}
+
+void CRenderBenchmark::ApplyConfiguration(const Configuration& Config)
+{
+	if (Config.Type == Toggle::PostProcess)
+	{
+		if (mRenderSystem->IsPostProcessEnabled(Config.Index))
+			mRenderSystem->DisablePostProcess(Config.Index);
+		else
+			mRenderSystem->EnablePostProcess(Config.Index);
+	}
+	else if (Config.Type == Toggle::LightSystem)
+	{
+		mRenderSystem->SetLightSystemEnabled(Config.Index, !mRenderSystem->IsLightSystemEnabled(Config.Index));
+	}
+}
+
+void CRenderBenchmark::MeasureFrame()
+{
+	// Frames are resolved a few frames late, and not every frame if one was dropped
+	const FDebug::GPUProfiler::FrameResult* Result = FDebug::GPUProfiler::GetInstance().GetLastResult();
+	if (!Result || Result->Frame == mLastMeasured)
+		return;
+	mLastMeasured = Result->Frame;
+
+	mFrameTotalNs += Result->End - Result->Begin;
+	mMeasuredFrames++;
+
+	for (const auto& Pass : Result->Passes)
+	{
+		PassTime* Time = nullptr;
+		for (auto& Existing : mPassTimes)
+		{
+			if (Existing.Depth == Pass.Depth && strcmp(Existing.Name, Pass.Name) == 0)
+			{
+				Time = &Existing;
+				break;
+			}
+		}
+
+		// Passes are kept in the order they first ran
+		if (!Time)
+		{
+			mPassTimes.push_back(PassTime{ Pass.Name, Pass.Depth, 0, 0 });
+			Time = &mPassTimes.back();
+		}
+
+		Time->TotalNs += Pass.End - Pass.Begin;
+		Time->Frames++;
+	}
+}
+
+void CRenderBenchmark::AppendConfiguration(const Configuration& Config)
+{
+	const char* Toggled = "none";
+	bool IsEnabled = true;
+	if (Config.Type == Toggle::PostProcess)
+	{
+		Toggled = mRenderSystem->GetPostProcess(Config.Index).GetName();
+		IsEnabled = !mRenderSystem->IsPostProcessEnabled(Config.Index);
+	}
+	else if (Config.Type == Toggle::LightSystem)
+	{
+		Toggled = mRenderSystem->GetLightSystem(Config.Index).GetName();
+		IsEnabled = !mRenderSystem->IsLightSystemEnabled(Config.Index);
+	}
+
+	// Averages are over every measured frame, passes that didn't run in a frame count as 0 for it
+	const double Frames = mMeasuredFrames > 0 ? (double)mMeasuredFrames : 1.0;
+	char Line[256];
+	sprintf_s(Line, "%s\t\t\t{\"toggled\":\"%s\",\"enabled\":%s,\"frames\":%u,\"frame_gpu_ms\":%.4f,\"passes\":[",
+		mConfiguration == 0 ? "" : ",\n", Toggled, IsEnabled ? "true" : "false", mMeasuredFrames, mFrameTotalNs / Frames / 1000000.0);
+	mResults += Line;
+
+	for (uint32_t i = 0; i < mPassTimes.size(); i++)
+	{
+		const PassTime& Time = mPassTimes[i];
+		sprintf_s(Line, "%s{\"name\":\"%s\",\"depth\":%u,\"frames\":%u,\"gpu_ms\":%.4f}",
+			i == 0 ? "" : ",", Time.Name, Time.Depth, Time.Frames, Time.TotalNs / Frames / 1000000.0);
+		mResults += Line;
+	}
+	mResults += "]}";
+
+	mPassTimes.clear();
+	mFrameTotalNs = 0;
+	mMeasuredFrames = 0;
+}
+
+void CRenderBenchmark::Finish()
+{
+	mIsFinished = true;
+
+	const Vector2ui Resolution = SScreen::GetResolution();
+	char Line[512];
+	sprintf_s(Line, "{\n\t\"device\":\"%s\",\n\t\"resolution\":[%u,%u],\n\t\"frames_per_configuration\":%u,\n\t\"shots\":[\n",
+		mDevice.c_str(), Resolution.x, Resolution.y, mFrameCount);
+	const std::string Json = Line + mResults + "\n\t]\n}\n";
+
+	auto File = IFileSystem::GetInstance().OpenWritable(mResultFilename.c_str(), false, true);
+	if (File && File->Write((const uint8_t*)Json.data(), Json.size()) && File->Flush())
+		FDebug::PrintF("Render benchmark results written to %S.\n", mResultFilename.c_str());
+	else
+		FDebug::PrintF("Failed to write render benchmark results to %S.\n", mResultFilename.c_str());
+	File.reset();
+
+	if (mOnFinished)
+		mOnFinished();
+}
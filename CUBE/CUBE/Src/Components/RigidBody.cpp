@@ -1,2 +1,4 @@
 #include "..\..\Include\Components\RigidBody.h"
 
+const btScalar FRigidBody::LINEAR_SLEEP_THRESHOLD = btScalar(1.0);
+const btScalar FRigidBody::ANGULAR_SLEEP_THRESHOLD = btScalar(1.5);
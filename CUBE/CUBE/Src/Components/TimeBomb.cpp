@@ -1,6 +1,7 @@
 #include "Components\TimeBomb.h"
 #include "STime.h"
 #include "Atlas\GameObject.h"
+#include "Rendering\ParticleSystem.h"
 
 
 CTimeBomb::CTimeBomb()
@@ -8,6 +9,7 @@ CTimeBomb::CTimeBomb()
 	, mLifetime(3.0f)
 	, mTimer(0.0f)
 	, mRadius(5)
+	, mDebrisCount(4096)
 	, mHasExploded(false)
 {
 }
@@ -25,23 +27,41 @@ void CTimeBomb::Update()
 	if (!mHasExploded && mTimer >= mLifetime)
 	{
 		mHasExploded = true;
-		const Vector3i MinPoint = GetGameObject()->Transform.GetWorldPosition() - mRadius;
-		const int32_t Bounds = 2 * mRadius + 1;
-
-		for (int32_t y = 0; y < Bounds; y++)
-		{
-			for (int32_t x = 0; x < Bounds; x++)
-			{
-				for (int32_t z = 0; z < Bounds; z++)
-				{
-					if (sqrt((float)(x - Bounds / 2)*(x - Bounds / 2) + (y - Bounds / 2)*(y - Bounds / 2) + (z - Bounds / 2)*(z - Bounds / 2)) <= Bounds / 2)
-					{
-						DestroyBlock(MinPoint + Vector3i{ x, y, z });
-					}
-				}
-			}
-		}
+		const Vector3i Center = GetGameObject()->Transform.GetWorldPosition();
+		EmitDebris(Center);
+		FillSphere(Center, mRadius, FBlock::AIR_BLOCK_ID);
 
 		DestroyGameObject();
 	}
-}
\ No newline at end of file
+}
+
+void CTimeBomb::EmitDebris(const Vector3i& Center)
+{
+	// The blocks at the center and halfway out along each axis color the debris, a burst for each that isn't air
+	const int32_t Half = (int32_t)mRadius / 2;
+	const Vector3i Offsets[DEBRIS_SAMPLES] =
+	{
+		Vector3i{ 0, 0, 0 },
+		Vector3i{ Half, 0, 0 }, Vector3i{ -Half, 0, 0 },
+		Vector3i{ 0, Half, 0 }, Vector3i{ 0, -Half, 0 },
+		Vector3i{ 0, 0, Half }, Vector3i{ 0, 0, -Half }
+	};
+
+	for (const Vector3i& Offset : Offsets)
+	{
+		const Vector3i Position = Center + Offset;
+		const FBlockTypes::BlockID ID = GetBlock(Position);
+		if (ID == FBlock::AIR_BLOCK_ID)
+			continue;
+
+		FParticleSystem::Burst Debris;
+		Debris.Position = Vector3f{ (float)Position.x + 0.5f, (float)Position.y + 0.5f, (float)Position.z + 0.5f };
+		Debris.Radius = (float)Half;
+		Debris.Velocity = Vector3f{ 0.0f, 6.0f, 0.0f };
+		Debris.Speed = 4.0f * mRadius;
+		Debris.Count = mDebrisCount / DEBRIS_SAMPLES;
+		Debris.Lifetime = 3.0f;
+		Debris.BlockType = ID;
+		FParticleSystem::Emit(Debris);
+	}
+}
@@ -52,7 +52,7 @@ void CTimeBombShooter::ShootBomb()
 	auto& Body = Box.AddComponent<Atlas::EComponent::RigidBody>();
 	Vector3f Forward = Camera.Transform.GetRotation() * -Vector3f::Forward;
 	Body.Body.setLinearVelocity(btVector3{ Forward.x, Forward.y, Forward.z } * 40.0f);
-	//Body.BoxCollider.setImplicitShapeDimensions(btVector3{ .5f, .5f, .5f });
+	//Body.SetShape(FCollisionShapeRegistry::GetBox(btVector3{ .5f, .5f, .5f }));
 	
 	auto& Mesh = Box.AddComponent<Atlas::EComponent::MeshRenderer>();
 	Mesh.LinkToMesh("Box");
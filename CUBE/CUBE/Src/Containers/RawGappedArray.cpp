@@ -1,5 +1,6 @@
 #include "Containers\RawGappedArray.h"
 #include "Memory\MemoryUtil.h"
+#include "Memory\MemoryStats.h"
 
 #include <algorithm>
 
@@ -21,11 +22,13 @@ void FTypelessPageArray::Init(const uint32_t PageSize, const uint32_t ElementSiz
 {
 	ASSERT(Alignment != 0 && PageSize != 0 && ElementSize != 0);
 
+	// Pages are freed with the sizes they were allocated with
+	DeleteAllPages();
+
 	mElementSize = ElementSize;
 	mAlignment = Alignment;
 	mPageSize = PageSize;
 
-	DeleteAllPages();
 	AddPage();
 	mNextFreePage = 0;
 }
@@ -37,18 +40,14 @@ uint32_t FTypelessPageArray::Allocate()
 		AssignNextFreePage();
 	}
 	
-	// Get the first free element
+	// Get the most recently freed element, its memory is the likeliest to be cached
 	Page& FreePage = mPages[mNextFreePage];
 
-	const uint32_t FreeElement = FreePage.DeadList.top();
-	FreePage.DeadList.pop();
+	const uint32_t FreeElement = FreePage.DeadList.back();
+	FreePage.DeadList.pop_back();
 
    	const uint32_t FreeElementGlobalIndex = FreeElement + mPageSize * mNextFreePage;
-
-	// Find the first element that is greater than the newly allocated index and insert before this position
-	const auto ActivePosition = std::find_if(FreePage.ActiveList.begin(), FreePage.ActiveList.end(), [FreeElement](const uint32_t Index){ return Index > FreeElement; });
-
-	FreePage.ActiveList.insert(ActivePosition, FreeElement);
+	FreePage.ActiveBits[FreeElement / BITS_PER_WORD] |= 1u << (FreeElement % BITS_PER_WORD);
 
 	mActiveCount++;
 	return FreeElementGlobalIndex;
@@ -76,13 +75,11 @@ void FTypelessPageArray::Free(const uint32_t Index)
 	const uint32_t PageID = Index / mPageSize;
 	const uint32_t ElementID = Index % mPageSize;
 
-	Page& ElementPage = mPages[PageID];
-	auto ActiveIndex = std::find(ElementPage.ActiveList.begin(), ElementPage.ActiveList.end(), ElementID);
-	ASSERT(ActiveIndex != ElementPage.ActiveList.end() && "Trying to free an inactive element.");
-
-	ElementPage.ActiveList.erase(ActiveIndex);
+	ASSERT(IsActive(PageID, ElementID) && "Trying to free an inactive element.");
 
-	ElementPage.DeadList.push(Index);
+	Page& ElementPage = mPages[PageID];
+	ElementPage.ActiveBits[ElementID / BITS_PER_WORD] &= ~(1u << (ElementID % BITS_PER_WORD));
+	ElementPage.DeadList.push_back(ElementID);
 
 	if (PageID < mNextFreePage)
 	{
@@ -97,12 +94,16 @@ void FTypelessPageArray::AddPage()
 	mPages.push_back(Page{});
 	Page& NewPage = mPages.back();
 
-	NewPage.Data = (uint8_t*)FMemory::AllocateAligned(std::max(mPageSize, mAlignment) * mElementSize, mAlignment);
+	const uint32_t PageBytes = std::max(mPageSize, mAlignment) * mElementSize;
+	NewPage.Data = (uint8_t*)FMemory::AllocateAligned(PageBytes, mAlignment);
+	SMemoryStats::Allocate(EMemoryTag::Components, PageBytes);
+	NewPage.ActiveBits.resize((mPageSize + BITS_PER_WORD - 1) / BITS_PER_WORD, 0);
 
-	// Fill the dead list with every element
-	for (uint32_t i = 0; i < mPageSize; i++)
+	// Fill the dead list with every element, the first ones on top
+	NewPage.DeadList.reserve(mPageSize);
+	for (uint32_t i = mPageSize; i > 0; i--)
 	{
-		NewPage.DeadList.push(i);
+		NewPage.DeadList.push_back(i - 1);
 	}
 }
 
@@ -113,6 +114,7 @@ void FTypelessPageArray::DeleteAllPages()
 		if (Page.Data)
 		{
 			FMemory::FreeAligned(Page.Data);
+			SMemoryStats::Free(EMemoryTag::Components, std::max(mPageSize, mAlignment) * mElementSize);
 		}
 	}
 
@@ -1,13 +1,16 @@
 #include "CubeRoot.h"
 #include <cstdint>
+#include <algorithm>
 
 #include <SFML\Window\Context.hpp>
 #include <SFML\Window\Event.hpp>
 #include <SFML\Window\VideoMode.hpp>
 #include "Clock.h"
 #include "STime.h"
+#include "FramePacer.h"
 #include "Input\ButtonEvent.h"
 #include "Input\MouseAxis.h"
+#include "Input\InputRecorder.h"
 
 #include "GL\glew.h"
 #include "SystemResources\SystemFile.h"
@@ -27,6 +30,14 @@
 #include "Debugging\DebugText.h"
 #include "Input\TextEntered.h"
 #include "Debugging\GameConsole.h"
+#include "Debugging\GPUProfiler.h"
+#include "Debugging\CPUProfiler.h"
+#include "Debugging\FrameStats.h"
+#include "Debugging\Log.h"
+#include "Debugging\ConsoleVariables.h"
+#include "Memory\FrameAllocator.h"
+#include "Memory\MemoryStats.h"
+#include "Threading\JobSystem.h"
 #include "ResourceHolder.h"
 #include "Components\ObjectMesh.h"
 #include "Components\MeshRenderer.h"
@@ -35,13 +46,35 @@
 
 using namespace Atlas;
 
+namespace
+{
+	// Frame memory is double-buffered, scratch memory is per thread
+	const uint32_t FRAME_MEMORY_BYTES = 4 * 1024 * 1024;
+	const uint32_t SCRATCH_MEMORY_BYTES = 1024 * 1024;
+
+	// Subsystems over budget give back retained mesh capacity and cached regions
+	const uint64_t CHUNK_MESH_BUDGET = 256ull * 1024 * 1024;
+	const uint64_t REGION_FILE_BUDGET = 256ull * 1024 * 1024;
+	const uint64_t CHUNK_CACHE_BUDGET = 64ull * 1024 * 1024;
+
+	// Console variable values read at startup, from the working directory
+	const wchar_t CONFIG_FILENAME[] = L"Config.cfg";
+
+	// Chunks around the camera streamed in before the first frame, along each axis
+	const int32_t SPAWN_WARMUP_RADIUS = 3;
+}
+
 FCubeRoot::FCubeRoot(const wchar_t* AppName, const Vector2ui Resolution, const uint32_t WindowStyle)
 	: mGameWindow(sf::VideoMode{ Resolution.x, Resolution.y }, AppName, WindowStyle, sf::ContextSettings(24, 8, 0, 4, 4))
 	, mWorld()
 	, mChunkManager(nullptr)
 	, mRenderSystem(nullptr)
 	, mPhysicsSystem(nullptr)
+	, mAudioSystem(nullptr)
 	, mGameObjectManager(nullptr)
+	, mIsHeadless(false)
+	, mIsStopping(false)
+	, mOnLoadingProgress()
 {
 	if (glewInit())
 	{
@@ -49,6 +82,20 @@ FCubeRoot::FCubeRoot(const wchar_t* AppName, const Vector2ui Resolution, const u
 		exit(EXIT_FAILURE);
 	}
 
+	// The scene is rendered with reversed depth, see FPerspectiveMatrix
+	if (!GLEW_ARB_clip_control)
+	{
+		std::cerr << "GL_ARB_clip_control is not supported ... exiting" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	// Chunk quads, block face layers and point lights are read from storage buffers
+	if (!GLEW_ARB_shader_storage_buffer_object)
+	{
+		std::cerr << "GL_ARB_shader_storage_buffer_object is not supported ... exiting" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
 	SMouseAxis::SetWindow(mGameWindow);
 	SMouseAxis::UpdateDelta();
 	SMouseAxis::UpdateDelta();
@@ -57,29 +104,69 @@ FCubeRoot::FCubeRoot(const wchar_t* AppName, const Vector2ui Resolution, const u
 	LoadEngineSystems();
 }
 
+FCubeRoot::FCubeRoot(Headless)
+	: mGameWindow()
+	, mWorld()
+	, mChunkManager(nullptr)
+	, mRenderSystem(nullptr)
+	, mPhysicsSystem(nullptr)
+	, mAudioSystem(nullptr)
+	, mGameObjectManager(nullptr)
+	, mIsHeadless(true)
+	, mIsStopping(false)
+	, mOnLoadingProgress()
+{
+	AllocateSingletons();
+	LoadEngineSystems();
+}
+
 void FCubeRoot::AllocateSingletons()
 {
+	// Messages are printed off the threads that log them from here on
+	FDebug::Log::Start();
+
+	SFrameAllocator::Init(FRAME_MEMORY_BYTES, SCRATCH_MEMORY_BYTES);
+	SMemoryStats::SetBudget(EMemoryTag::ChunkMeshes, CHUNK_MESH_BUDGET);
+	SMemoryStats::SetBudget(EMemoryTag::RegionFiles, REGION_FILE_BUDGET);
+	SMemoryStats::SetBudget(EMemoryTag::ChunkCache, CHUNK_CACHE_BUDGET);
+
+	// Workers are shared by every subsystem, each preferring a core of its own
+	FJobSystem* JobSystem = new FJobSystem;
+	JobSystem->Start(FJobSystem::GetDefaultWorkerCount(), true);
+
 	IFileSystem* FileSystem = new FFileSystem;
+	FDebug::ConsoleVariables::LoadConfig(CONFIG_FILENAME);
+
+	// Debug drawing, the console and GPU profiling all need GL
+	if (mIsHeadless)
+		return;
+
 	FDebug::Text* DebugText = new FDebug::Text;
 	FDebug::Draw* DebugDraw = new FDebug::Draw;
 	FDebug::GameConsole*  GameConsole = new FDebug::GameConsole;
+	FDebug::GPUProfiler* GPUProfiler = new FDebug::GPUProfiler;
 }
 
 void FCubeRoot::LoadEngineSystems()
 {
-	mChunkManager = new FChunkManager;
+	mChunkManager = new FChunkManager(mIsHeadless);
 
-	// Load all subsystems
+	// Load all subsystems, headless engines only simulate
 	FSystemManager& SystemManager = mWorld.GetSystemManager();
-	mRenderSystem = &SystemManager.AddSystem<FRenderSystem>(mGameWindow, *mChunkManager);
+	if (!mIsHeadless)
+		mRenderSystem = &SystemManager.AddSystem<FRenderSystem>(mGameWindow, *mChunkManager);
 	mPhysicsSystem = &SystemManager.AddSystem<FPhysicsSystem>();
-	mAudioSystem = &SystemManager.AddSystem<FAudioSystem>();
+	if (!mIsHeadless)
+		mAudioSystem = &SystemManager.AddSystem<FAudioSystem>(*mChunkManager);
 
 	// Pass console dependencies
-	FDebug::GameConsole& Console = FDebug::GameConsole::GetInstance();
-	Console.SetChunkManager(mChunkManager);
-	Console.SetPhysicsSystem(mPhysicsSystem);
-	Console.SetRenderSystem(mRenderSystem);
+	if (!mIsHeadless)
+	{
+		FDebug::GameConsole& Console = FDebug::GameConsole::GetInstance();
+		Console.SetChunkManager(mChunkManager);
+		Console.SetPhysicsSystem(mPhysicsSystem);
+		Console.SetRenderSystem(mRenderSystem);
+	}
 
 	mChunkManager->SetPhysicsSystem(*mPhysicsSystem);
 	mGameObjectManager = &mWorld.GetObjectManager();
@@ -93,41 +180,227 @@ void FCubeRoot::LoadEngineSystems()
 	mGameObjectManager->RegisterComponentType<EComponent::MeshRenderer>();
 	mGameObjectManager->RegisterComponentType<EComponent::SoundEmitter>();
 	mGameObjectManager->RegisterComponentType<EComponent::SoundListener>();
+
+	RegisterConsoleVariables();
+}
+
+void FCubeRoot::RegisterConsoleVariables()
+{
+	using FDebug::ConsoleVariables;
+
+	// Frame pacing
+	ConsoleVariables::RegisterFloat("TargetFPS", 60.0f, "Frames per second frames are paced to",
+		[](const float FPS) { SFramePacer::SetTargetFPS(FPS); });
+	ConsoleVariables::RegisterBool("SmoothDeltaTime", true, "If movement uses smoothed frame deltas",
+		[](const bool IsSmoothed) { STime::SetDeltaSmoothing(IsSmoothed); });
+
+	// Frame stats, hitches are captured while the CPU profiler is capturing
+	ConsoleVariables::RegisterFloat("HitchThreshold", 50.0f, "Milliseconds over which a frame is a hitch, 0 to detect none",
+		[](const float Milliseconds) { FDebug::FrameStats::SetHitchThreshold(Milliseconds); });
+	ConsoleVariables::RegisterBool("HitchCapture", false, "If the CPU profiler keeps capturing, so hitches export their last frames",
+		[](const bool IsEnabled)
+	{
+		if (IsEnabled)
+			FDebug::CPUProfiler::StartCapture(0);
+		else
+			FDebug::CPUProfiler::StopCapture();
+	});
+	ConsoleVariables::RegisterBool("FrameStatsExport", false, "If frame stats are appended to FrameStats.jsonl every interval",
+		[](const bool IsEnabled) { FDebug::FrameStats::SetExportFile(IsEnabled ? L"FrameStats.jsonl" : L""); });
+
+	// Streaming, every setter is safe between frames
+	FChunkManager* ChunkManager = mChunkManager;
+	ConsoleVariables::RegisterInt("ViewDistance", 14, "Horizontal distance in chunks that chunks are loaded to",
+		[ChunkManager](const int32_t Distance) { ChunkManager->SetViewDistance((uint32_t)std::max(Distance, 1)); });
+	ConsoleVariables::RegisterInt("EvictionMargin", 1, "Chunks past the view distance that loaded chunks are kept to",
+		[ChunkManager](const int32_t Margin) { ChunkManager->SetEvictionMargin((uint32_t)std::max(Margin, 0)); });
+	ConsoleVariables::RegisterInt("ChunkWorkers", (int32_t)ChunkManager->GetWorkerCount(), "Threads chunks are generated and meshed on",
+		[ChunkManager](const int32_t Count)
+	{
+		// Changing the count restarts the world
+		if ((uint32_t)Count != ChunkManager->GetWorkerCount())
+			ChunkManager->SetWorkerCount((uint32_t)std::max(Count, 1));
+	});
+	ConsoleVariables::RegisterFloat("PrefetchLookahead", 1.0f, "Seconds ahead of the camera that chunks are prefetched for",
+		[ChunkManager](const float Seconds) { ChunkManager->SetPrefetchLookahead(Seconds); });
+	ConsoleVariables::RegisterBool("GPUMeshing", false, "If chunks are meshed by compute shaders",
+		[ChunkManager](const bool IsEnabled) { ChunkManager->SetGPUMeshing(IsEnabled); });
+	ConsoleVariables::RegisterBool("BackgroundUploads", true, "If chunk meshes are uploaded by a thread with a shared GL context",
+		[ChunkManager](const bool IsEnabled) { ChunkManager->SetBackgroundUploads(IsEnabled); });
+	ConsoleVariables::RegisterBool("FarTerrain", true, "If terrain past the view distance is drawn from column heights",
+		[ChunkManager](const bool IsEnabled) { ChunkManager->SetFarTerrain(IsEnabled); });
+	ConsoleVariables::RegisterBool("ConnectivityCulling", true, "If chunks hidden behind solid chunks are culled",
+		[ChunkManager](const bool IsEnabled) { ChunkManager->SetConnectivityCulling(IsEnabled); });
+	ConsoleVariables::RegisterBool("BlockVolume", false, "If the blocks around the camera are mirrored on the GPU for traced shadows and occlusion",
+		[ChunkManager](const bool IsEnabled) { ChunkManager->SetBlockVolume(IsEnabled); });
+
+	// Simulation
+	FPhysicsSystem* PhysicsSystem = mPhysicsSystem;
+	ConsoleVariables::RegisterBool("ParallelPhysics", true, "If the narrowphase is split between workers",
+		[PhysicsSystem](const bool IsParallel) { PhysicsSystem->SetParallel(IsParallel); });
+
+	if (!mRenderSystem)
+		return;
+
+	// Rendering
+	FRenderSystem* RenderSystem = mRenderSystem;
+	FDynamicResolution& DynamicResolution = RenderSystem->GetDynamicResolution();
+	ConsoleVariables::RegisterBool("DynamicResolution", DynamicResolution.IsEnabled(), "If the scene resolution scales to hold the GPU budget",
+		[RenderSystem](const bool IsEnabled) { RenderSystem->GetDynamicResolution().SetEnabled(IsEnabled); });
+	ConsoleVariables::RegisterFloat("GPUBudget", DynamicResolution.GetBudget(), "GPU milliseconds a frame may take before the resolution scales down",
+		[RenderSystem](const float Milliseconds) { RenderSystem->GetDynamicResolution().SetBudget(Milliseconds); });
+	ConsoleVariables::RegisterBool("DepthPrePass", false, "If chunks are drawn to depth before the G-Buffer",
+		[RenderSystem](const bool IsEnabled) { RenderSystem->SetDepthPrePass(IsEnabled); });
+	ConsoleVariables::RegisterBool("CompositedLighting", true, "If directional lights are shaded in one pass with ambient occlusion and fog",
+		[RenderSystem](const bool IsEnabled) { RenderSystem->SetCompositedLighting(IsEnabled); });
+	ConsoleVariables::RegisterBool("TracedShadows", false, "If sun shadows are traced through the block volume instead of drawn to cascades",
+		[RenderSystem](const bool IsEnabled) { RenderSystem->SetTracedShadows(IsEnabled); });
+	ConsoleVariables::RegisterBool("CompressedBlockTextures", false, "If block textures are stored as DXT5",
+		[RenderSystem](const bool IsEnabled) { RenderSystem->SetCompressedBlockTextures(IsEnabled); });
 }
 
 FCubeRoot::~FCubeRoot()
 {
 	delete mChunkManager;
-	delete FDebug::GameConsole::GetInstancePtr();
-	delete FDebug::Draw::GetInstancePtr();
-	delete FDebug::Text::GetInstancePtr();
+	if (!mIsHeadless)
+	{
+		delete FDebug::GPUProfiler::GetInstancePtr();
+		delete FDebug::GameConsole::GetInstancePtr();
+		delete FDebug::Draw::GetInstancePtr();
+		delete FDebug::Text::GetInstancePtr();
+	}
+
+	// Recordings are written once the session ends
+	SInputRecorder::StopRecording();
+	SInputRecorder::StopReplay();
 	delete IFileSystem::GetInstancePtr();
+	delete FJobSystem::GetInstancePtr();
+	SFrameAllocator::Shutdown();
+	FDebug::Log::Stop();
 }
 
 void FCubeRoot::Start()
 {
-	STime::StartGameTimer();
+	// Behaviors place the camera as they start, so the spawn area is known after them
 	mWorld.Start();
+	mChunkManager->WarmUp(SPAWN_WARMUP_RADIUS, mOnLoadingProgress);
+
+	// The first frame doesn't count the warmup as elapsed time
+	STime::StartGameTimer();
 	GameLoop();
 }
 
 void FCubeRoot::GameLoop()
 {
+	// Frames are paced to the fixed update by default, see the TargetFPS console variable
 	STime::SetFixedUpdate(1.0f / 60.0f);
 
-	// Game Loop
-	while (mGameWindow.isOpen())
+	// Physics steps overlap with audio and rendering
+	mPhysicsSystem->SetPipelined(true);
+
+	// Frames are submitted while the next one is simulated
+	if (mRenderSystem)
+		mRenderSystem->SetThreaded(true);
+
+	FDebug::CPUProfiler::SetThreadName("Main");
+
+	// Game Loop, headless engines have no window to close
+	while (!mIsStopping && (mIsHeadless || mGameWindow.isOpen()))
 	{	
-		mGameObjectManager->Update();
-		mChunkManager->Update();
+		{
+			CPU_PROFILE("Frame");
+			SFramePacer::BeginFrame();
+
+			// Frame memory from two frames ago is no longer read by the render thread
+			SFrameAllocator::BeginFrame();
+
+			// Game objects and chunks may only change the simulation between steps
+			{
+				CPU_PROFILE("WaitForStep");
+				FRAME_STAGE(WaitForStep);
+				mPhysicsSystem->WaitForStep();
+			}
+
+			{
+				CPU_PROFILE("GameObjects");
+				FRAME_STAGE(GameObjects);
+				mGameObjectManager->Update();
+			}
+
+			if (mAudioSystem)
+			{
+				FRAME_STAGE(Audio);
+				mAudioSystem->Update();
+			}
 
-		mPhysicsSystem->Update();
-		mAudioSystem->Update();
-		mRenderSystem->Update();
+			// Chunks swap meshes with GL, once the last frame no longer draws them
+			if (mRenderSystem)
+			{
+				CPU_PROFILE("WaitForRender");
+				FRAME_STAGE(WaitForRender);
+				mRenderSystem->WaitForRender();
+			}
 
-		STime::UpdateGameTimer();
-		ServiceEvents();
+			// Uploads only take the time left in the frame, the rest wait for the next one
+			const uint64_t BackgroundDeadline = SFramePacer::GetBackgroundDeadline();
+			{
+				CPU_PROFILE("MainThreadJobs");
+				FRAME_STAGE(MainThreadJobs);
+				FJobSystem::GetInstance().RunMainThreadJobs(BackgroundDeadline);
+			}
+
+			{
+				FRAME_STAGE(Chunks);
+				mChunkManager->SetSwapDeadline(BackgroundDeadline);
+				mChunkManager->Update();
+			}
+			SFramePacer::EndBackgroundWork();
+
+			{
+				CPU_PROFILE("LateGameObjects");
+				FRAME_STAGE(GameObjects);
+				mGameObjectManager->LateUpdate();
+			}
+
+			{
+				FRAME_STAGE(Physics);
+				mPhysicsSystem->Update();
+			}
+
+			if (mRenderSystem)
+			{
+				FRAME_STAGE(Render);
+				mRenderSystem->Update();
+			}
+
+			STime::UpdateGameTimer();
+			SMemoryStats::Update(STime::GetDeltaTime());
+
+			if (!mIsHeadless)
+			{
+				CPU_PROFILE("ServiceEvents");
+				FRAME_STAGE(Events);
+				ServiceEvents();
+			}
+
+			CPU_PROFILE("FramePacing");
+			SFramePacer::EndFrame();
+		}
+
+		FDebug::CPUProfiler::EndFrame();
+		FDebug::FrameStats::EndFrame();
+		mChunkManager->EndFrame();
 	}
+
+	// Systems are torn down on this thread
+	if (mRenderSystem)
+		mRenderSystem->SetThreaded(false);
+	mPhysicsSystem->SetPipelined(false);
+}
+
+void FCubeRoot::Stop()
+{
+	mIsStopping = true;
 }
 
 void FCubeRoot::ServiceEvents()
@@ -141,6 +414,9 @@ void FCubeRoot::ServiceEvents()
 	SMouseAxis::UpdateDelta();
 	STextEntered::Reset();
 
+	// Replayed input stands in for the player's, who can still close the window
+	const bool IsReplaying = SInputRecorder::IsReplaying();
+	const bool IsRecording = SInputRecorder::IsRecording();
 		
 	// Service window events
 	while (mGameWindow.pollEvent(Event))
@@ -148,6 +424,16 @@ void FCubeRoot::ServiceEvents()
 		if (Event.type == Event.Closed || SButtonEvent::GetKeyDown(sf::Keyboard::Escape))
 			mGameWindow.close();
 
+		if (IsReplaying && SInputRecorder::IsRecordedEvent(Event))
+		{
+			if (Event.type == sf::Event::KeyPressed && Event.key.code == sf::Keyboard::Escape)
+				mGameWindow.close();
+			continue;
+		}
+
+		if (IsRecording && SInputRecorder::IsRecordedEvent(Event))
+			SInputRecorder::RecordEvent(Event);
+
 		if (SButtonEvent::IsButtonEvent(Event))
 		{
 			SButtonEvent::AddButtonEvent(Event);
@@ -162,9 +448,15 @@ void FCubeRoot::ServiceEvents()
 		}
 		else if (Event.type == sf::Event::Resized)
 		{
-			// adjust the viewport when the window is resized
+			// adjust the viewport when the window is resized, which needs the context back
+			mRenderSystem->WaitForRender();
 			glViewport(0, 0, Event.size.width, Event.size.height);
 			mRenderSystem->SetResolution(Vector2ui{Event.size.width, Event.size.height});
 		}
 	}
+
+	if (IsReplaying)
+		SInputRecorder::ReplayFrame();
+	else if (IsRecording)
+		SInputRecorder::RecordFrame();
 }
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "Debugging\CPUProfiler.h"
+#include "FileIO\GenericFile.h"
+#include "Common.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	struct Event
+	{
+		const char* Name;
+		uint64_t    Begin;
+		uint64_t    End;
+	};
+
+	/**
+	* The markers of one thread. Only its thread writes to it, the lock
+	* keeps captures from being reset or exported during a write.
+	*/
+	struct ThreadBuffer
+	{
+		std::mutex         Mutex;
+		std::vector<Event> Events;  // Allocated with the first marker
+		uint64_t           Written; // Markers written this capture, the ring holds the newest
+		uint32_t           ThreadIndex;
+		const char*        Name;
+	};
+
+	std::mutex                                 RegistryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+	THREAD_LOCAL ThreadBuffer*                 CurrentBuffer = nullptr;
+
+	uint64_t CaptureBegin = 0;
+	uint32_t CaptureFramesLeft = 0;
+
+	/**
+	* The buffer of the calling thread, added the first time it's needed.
+	*/
+	ThreadBuffer& GetThreadBuffer()
+	{
+		if (!CurrentBuffer)
+		{
+			std::lock_guard<std::mutex> Lock(RegistryMutex);
+			Buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer));
+
+			CurrentBuffer = Buffers.back().get();
+			CurrentBuffer->Written = 0;
+			CurrentBuffer->ThreadIndex = Buffers.size() - 1;
+			CurrentBuffer->Name = nullptr;
+		}
+
+		return *CurrentBuffer;
+	}
+}
+
+namespace FDebug
+{
+	std::atomic<bool> CPUProfiler::CaptureRunning(false);
+
+	void CPUProfiler::StartCapture(const uint32_t FrameCount)
+	{
+		StopCapture();
+
+		{
+			std::lock_guard<std::mutex> Lock(RegistryMutex);
+			for (auto& Buffer : Buffers)
+			{
+				std::lock_guard<std::mutex> BufferLock(Buffer->Mutex);
+				Buffer->Written = 0;
+			}
+		}
+
+		CaptureBegin = FClock::ReadSystemTimer();
+		CaptureFramesLeft = FrameCount;
+		CaptureRunning = true;
+	}
+
+	void CPUProfiler::StopCapture()
+	{
+		CaptureRunning = false;
+		CaptureFramesLeft = 0;
+	}
+
+	void CPUProfiler::EndFrame()
+	{
+		if (IsCapturing() && CaptureFramesLeft > 0 && --CaptureFramesLeft == 0)
+			StopCapture();
+	}
+
+	void CPUProfiler::SetThreadName(const char* Name)
+	{
+		ThreadBuffer& Buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> Lock(Buffer.Mutex);
+		Buffer.Name = Name;
+	}
+
+	bool CPUProfiler::Export(const wchar_t* Filename, const uint64_t Since)
+	{
+		auto File = IFileSystem::GetInstance().OpenWritable(Filename, false, true);
+		if (!File)
+			return false;
+
+		const double MicrosecondsPerCycle = 1000000.0 / FClock::SecondsToCycles(1.0f);
+		const uint64_t Begin = (Since > CaptureBegin) ? Since : CaptureBegin;
+
+		std::string Output = "{\"traceEvents\":[\n";
+		char Line[256];
+		bool IsFirstEvent = true;
+
+		std::lock_guard<std::mutex> Lock(RegistryMutex);
+		for (auto& Buffer : Buffers)
+		{
+			std::lock_guard<std::mutex> BufferLock(Buffer->Mutex);
+
+			if (Buffer->Name)
+			{
+				sprintf_s(Line, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+					IsFirstEvent ? "" : ",\n", Buffer->ThreadIndex, Buffer->Name);
+				Output += Line;
+				IsFirstEvent = false;
+			}
+
+			// Markers begun before the capture or range started are partial, and left out
+			const uint64_t First = (Buffer->Written > EVENTS_PER_THREAD) ? Buffer->Written - EVENTS_PER_THREAD : 0;
+			for (uint64_t i = First; i < Buffer->Written; i++)
+			{
+				const Event& Marker = Buffer->Events[i % EVENTS_PER_THREAD];
+				if (Marker.Begin < Begin)
+					continue;
+
+				sprintf_s(Line, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					IsFirstEvent ? "" : ",\n", Marker.Name, Buffer->ThreadIndex,
+					(Marker.Begin - Begin) * MicrosecondsPerCycle, (Marker.End - Marker.Begin) * MicrosecondsPerCycle);
+				Output += Line;
+				IsFirstEvent = false;
+			}
+		}
+
+		Output += "\n]}\n";
+
+		return File->Write((const uint8_t*)Output.data(), Output.size()) && File->Flush();
+	}
+
+	void CPUProfiler::Record(const char* Name, const uint64_t Begin, const uint64_t End)
+	{
+		ThreadBuffer& Buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> Lock(Buffer.Mutex);
+
+		if (Buffer.Events.empty())
+			Buffer.Events.resize(EVENTS_PER_THREAD);
+
+		Buffer.Events[Buffer.Written % EVENTS_PER_THREAD] = Event{ Name, Begin, End };
+		Buffer.Written++;
+	}
+}
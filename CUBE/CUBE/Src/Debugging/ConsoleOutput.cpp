@@ -1,19 +1,12 @@
 #include "..\..\Include\Debugging\ConsoleOutput.h"
+#include "..\..\Include\Debugging\Log.h"
 
 namespace FDebug
 {
 	int32_t VPrintF(const char* Format, va_list ArgList)
 	{
-		const uint32_t MAX_CHARS = 2048;
-		static char DebugBuffer[MAX_CHARS];
-
-		// Format the arglist with specific Format
-		const int32_t CharsWritten = vsnprintf_s(DebugBuffer, MAX_CHARS, Format, ArgList);
-
-		OutputDebugStringA(DebugBuffer);
-		OutputDebugStringA("\n");
-
-		return CharsWritten;
+		// Printed by the log's writer thread, off the calling thread
+		return Log::VWrite(ELogSeverity::Info, ELogCategory::General, Format, ArgList);
 	}
 
 	int32_t PrintF(const char* Format, ...)
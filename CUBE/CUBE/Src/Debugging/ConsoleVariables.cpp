@@ -0,0 +1,280 @@
+#include "Debugging\ConsoleVariables.h"
+#include "Debugging\ConsoleOutput.h"
+#include "Debugging\Log.h"
+#include "FileIO\GenericFile.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	struct EVarType
+	{
+		enum Value : uint8_t
+		{
+			Bool,
+			Int,
+			Float
+		};
+	};
+
+	struct Variable
+	{
+		const char* Name;
+		const char* Description;
+		EVarType::Value Type;
+		union
+		{
+			bool    Bool;
+			int32_t Int;
+			float   Float;
+		};
+		FDebug::ConsoleVariables::BoolHandler  OnBoolChange;
+		FDebug::ConsoleVariables::IntHandler   OnIntChange;
+		FDebug::ConsoleVariables::FloatHandler OnFloatChange;
+	};
+
+	std::unordered_map<std::string, Variable> Variables;
+	std::unordered_map<std::string, std::string> PendingValues; // Read from the config before their variable was registered
+
+	bool Parse(Variable& Var, const std::string& Text)
+	{
+		const char* Begin = Text.c_str();
+		char* End = nullptr;
+		errno = 0;
+
+		switch (Var.Type)
+		{
+		case EVarType::Bool:
+			if (Text == "true" || Text == "1")
+				Var.Bool = true;
+			else if (Text == "false" || Text == "0")
+				Var.Bool = false;
+			else
+				return false;
+			return true;
+		case EVarType::Int:
+		{
+			const long Value = strtol(Begin, &End, 10);
+			if (End == Begin || *End != '\0' || errno == ERANGE || Value < INT32_MIN || Value > INT32_MAX)
+				return false;
+			Var.Int = (int32_t)Value;
+			return true;
+		}
+		case EVarType::Float:
+		{
+			const float Value = strtof(Begin, &End);
+			if (End == Begin || *End != '\0' || errno == ERANGE)
+				return false;
+			Var.Float = Value;
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+
+	void Apply(const Variable& Var)
+	{
+		if (Var.Type == EVarType::Bool && Var.OnBoolChange)
+			Var.OnBoolChange(Var.Bool);
+		else if (Var.Type == EVarType::Int && Var.OnIntChange)
+			Var.OnIntChange(Var.Int);
+		else if (Var.Type == EVarType::Float && Var.OnFloatChange)
+			Var.OnFloatChange(Var.Float);
+	}
+
+	/**
+	* Adds a variable, taking its value from the config if one was read, and applies it.
+	*/
+	void Add(Variable& Var)
+	{
+		ASSERT(Variables.find(Var.Name) == Variables.end() && "Console variables must have unique names.");
+
+		auto Pending = PendingValues.find(Var.Name);
+		if (Pending != PendingValues.end())
+		{
+			if (!Parse(Var, Pending->second))
+				LOG(Warning, General, "Config value %s of %s doesn't parse, the default is used.", Pending->second.c_str(), Var.Name);
+			PendingValues.erase(Pending);
+		}
+
+		Variable& Added = Variables.emplace(Var.Name, Var).first->second;
+		Apply(Added);
+	}
+
+	const Variable* Find(const char* Name, const EVarType::Value VarType)
+	{
+		auto Found = Variables.find(Name);
+		ASSERT(Found != Variables.end() && Found->second.Type == VarType && "Console variable isn't registered with this type.");
+		return (Found != Variables.end() && Found->second.Type == VarType) ? &Found->second : nullptr;
+	}
+
+	void Print(const Variable& Var)
+	{
+		if (Var.Type == EVarType::Bool)
+			FDebug::PrintF("%s = %s    %s", Var.Name, Var.Bool ? "true" : "false", Var.Description);
+		else if (Var.Type == EVarType::Int)
+			FDebug::PrintF("%s = %d    %s", Var.Name, Var.Int, Var.Description);
+		else
+			FDebug::PrintF("%s = %g    %s", Var.Name, Var.Float, Var.Description);
+	}
+}
+
+namespace FDebug
+{
+	bool ConsoleVariables::LoadConfig(const wchar_t* Filename)
+	{
+		auto File = IFileSystem::GetInstance().OpenReadable(Filename);
+		if (!File)
+			return false;
+
+		std::string Text;
+		Text.resize(File->GetFileSize());
+		if (!Text.empty() && !File->Read((uint8_t*)&Text[0], Text.size()))
+			return false;
+
+		size_t LineBegin = 0;
+		while (LineBegin < Text.size())
+		{
+			size_t LineEnd = Text.find('\n', LineBegin);
+			if (LineEnd == std::string::npos)
+				LineEnd = Text.size();
+
+			std::string Line = Text.substr(LineBegin, LineEnd - LineBegin);
+			LineBegin = LineEnd + 1;
+
+			// Lines may end with \r\n
+			if (!Line.empty() && Line.back() == '\r')
+				Line.pop_back();
+
+			const size_t NameBegin = Line.find_first_not_of(" \t");
+			if (NameBegin == std::string::npos || Line[NameBegin] == '#')
+				continue;
+
+			const size_t NameEnd = Line.find_first_of(" \t", NameBegin);
+			const size_t ValueBegin = (NameEnd == std::string::npos) ? std::string::npos : Line.find_first_not_of(" \t", NameEnd);
+			if (ValueBegin == std::string::npos)
+			{
+				LOG(Warning, General, "Config line %s has no value.", Line.c_str());
+				continue;
+			}
+
+			const size_t ValueEnd = Line.find_last_not_of(" \t");
+			const std::string Name = Line.substr(NameBegin, NameEnd - NameBegin);
+			const std::string Value = Line.substr(ValueBegin, ValueEnd + 1 - ValueBegin);
+
+			if (Variables.find(Name) != Variables.end())
+				Set(Name, Value);
+			else
+				PendingValues[Name] = Value;
+		}
+
+		return true;
+	}
+
+	void ConsoleVariables::RegisterBool(const char* Name, const bool Default, const char* Description, BoolHandler OnChange)
+	{
+		Variable Var;
+		Var.Name = Name;
+		Var.Description = Description;
+		Var.Type = EVarType::Bool;
+		Var.Bool = Default;
+		Var.OnBoolChange = std::move(OnChange);
+		Add(Var);
+	}
+
+	void ConsoleVariables::RegisterInt(const char* Name, const int32_t Default, const char* Description, IntHandler OnChange)
+	{
+		Variable Var;
+		Var.Name = Name;
+		Var.Description = Description;
+		Var.Type = EVarType::Int;
+		Var.Int = Default;
+		Var.OnIntChange = std::move(OnChange);
+		Add(Var);
+	}
+
+	void ConsoleVariables::RegisterFloat(const char* Name, const float Default, const char* Description, FloatHandler OnChange)
+	{
+		Variable Var;
+		Var.Name = Name;
+		Var.Description = Description;
+		Var.Type = EVarType::Float;
+		Var.Float = Default;
+		Var.OnFloatChange = std::move(OnChange);
+		Add(Var);
+	}
+
+	bool ConsoleVariables::GetBool(const char* Name)
+	{
+		const Variable* Var = Find(Name, EVarType::Bool);
+		return Var ? Var->Bool : false;
+	}
+
+	int32_t ConsoleVariables::GetInt(const char* Name)
+	{
+		const Variable* Var = Find(Name, EVarType::Int);
+		return Var ? Var->Int : 0;
+	}
+
+	float ConsoleVariables::GetFloat(const char* Name)
+	{
+		const Variable* Var = Find(Name, EVarType::Float);
+		return Var ? Var->Float : 0.0f;
+	}
+
+	bool ConsoleVariables::Set(const std::string& Name, const std::string& Value)
+	{
+		auto Found = Variables.find(Name);
+		if (Found == Variables.end())
+			return false;
+
+		// Values that don't parse leave the variable as it was
+		Variable Parsed = Found->second;
+		if (!Parse(Parsed, Value))
+		{
+			LOG(Warning, General, "%s can't be set to %s.", Name.c_str(), Value.c_str());
+			return false;
+		}
+
+		Found->second = Parsed;
+		Apply(Found->second);
+		return true;
+	}
+
+	bool ConsoleVariables::Execute(const std::string& Command)
+	{
+		const size_t NameEnd = Command.find(' ');
+		const std::string Name = Command.substr(0, NameEnd);
+
+		auto Found = Variables.find(Name);
+		if (Found == Variables.end())
+			return false;
+
+		const size_t ValueBegin = (NameEnd == std::string::npos) ? std::string::npos : Command.find_first_not_of(' ', NameEnd);
+		if (ValueBegin == std::string::npos)
+			Print(Found->second);
+		else
+			Set(Name, Command.substr(ValueBegin));
+
+		return true;
+	}
+
+	void ConsoleVariables::List()
+	{
+		// Listed by name, the map's order changes as variables are added
+		std::vector<const Variable*> Sorted;
+		for (const auto& Entry : Variables)
+			Sorted.push_back(&Entry.second);
+		std::sort(Sorted.begin(), Sorted.end(), [](const Variable* Lhs, const Variable* Rhs) { return strcmp(Lhs->Name, Rhs->Name) < 0; });
+
+		for (const Variable* Var : Sorted)
+			Print(*Var);
+	}
+}
@@ -4,12 +4,38 @@
 #include "Math\Transform.h"
 #include "Rendering\UniformBlockStandard.h"
 #include "Rendering\Camera.h"
+#include "Rendering\GLState.h"
+#include "Rendering\GLBindings.h"
+#include "Rendering\VertexTraits.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Lines the vertex buffer has room for each frame before growing
+	const uint32_t INITIAL_LINE_CAPACITY = 16384;
+
+	// Vertex buffer binding of the debug vertex array
+	const GLuint VERTEX_BINDING = 0;
+
+	// Pairs of box corners joined by an edge
+	const uint32_t BOX_EDGES[24] =
+	{
+		0, 1, 1, 2, 2, 3, 3, 0, // Front face
+		4, 5, 5, 6, 6, 7, 7, 4, // Back face
+		0, 4, 1, 5, 2, 6, 3, 7  // Joining the faces
+	};
+}
 
 namespace FDebug
 {
 	Draw::Draw()
-		: mObjects()
-		, mLines(GL_DYNAMIC_DRAW)
+		: mVertices()
+		, mFrameVertices()
+		, mTimedVertices()
+		, mTimedShapes()
+		, mVertexBuffer(GL_ARRAY_BUFFER, sizeof(DrawVertex) * 2 * INITIAL_LINE_CAPACITY)
+		, mVertexArray(0)
 		, mShader()
 		, mDebugMode(btIDebugDraw::DBG_DrawWireframe)
 	{
@@ -18,132 +44,134 @@ namespace FDebug
 		mShader.AttachShader(VertexShader);
 		mShader.AttachShader(FragShader);
 		mShader.LinkProgram();
+
+		// The buffer is bound at this frame's offset before each draw
+		using Attributes = VertexTraits::GL_Attribute<DrawVertex>;
+		glGenVertexArrays(1, &mVertexArray);
+		SGLState::BindVertexArray(mVertexArray);
+		for (uint32_t i = 0; i < VertexTraits::Attribute_Count<DrawVertex>::Count; i++)
+		{
+			glVertexAttribFormat(Attributes::Position[i], Attributes::ElementCount[i], Attributes::Type[i], Attributes::Normalized[i], Attributes::Offset[i]);
+			glVertexAttribBinding(Attributes::Position[i], VERTEX_BINDING);
+			glEnableVertexAttribArray(Attributes::Position[i]);
+		}
+		SGLState::BindVertexArray(0);
 	}
 
 	Draw::~Draw()
 	{
+		glDeleteVertexArrays(1, &mVertexArray);
 	}
 
 	void Draw::drawLine(const btVector3& From, const btVector3& To, const btVector3& Color)
 	{
-		const float Verts[12] = 
-		{
-			From.x(), From.y(), From.z(), Color.x(), Color.y(), Color.z(),
-			To.x(), To.y(), To.z(), Color.x(), Color.y(), Color.z()
-		};
-
-		const uint32_t BaseIndex = mLines.GetIndexCount();
-		const uint32_t Indices[2] = { BaseIndex + 0, BaseIndex + 1 };
-		mLines.AddVertex((DrawVertex*)Verts, 2);
-		mLines.AddIndices(Indices, 2);
+		const Vector3f LineColor{ Color.x(), Color.y(), Color.z() };
+		mVertices.push_back(DrawVertex{ Vector3f{ From.x(), From.y(), From.z() }, LineColor });
+		mVertices.push_back(DrawVertex{ Vector3f{ To.x(), To.y(), To.z() }, LineColor });
 	}
 
 	void Draw::DrawFrustum(FCamera& Camera, const Vector3f& Color, const float Lifetime)
 	{
-		const FMatrix4 CameraTransform = Camera.Transform.LocalToWorldMatrix();
-		const FMatrix4 InvProjection = Camera.GetProjection().GetInverse();
+		// The camera transform is affine, so it can be applied before the divide by W
+		const FMatrix4 ViewToWorld = Camera.Transform.LocalToWorldMatrix() * Camera.GetProjection().GetInverse();
 
-		// Opengl normalized view volume corners
+		// Normalized view volume corners, with reversed depth. The back is drawn short of a
+		// depth of 0, which infinite projections put at infinity.
+		static const float BackDepth = 0.001f;
 		static const Vector4f NormalizedCorners[8] =
 		{
-			Vector4f{ -1, 1, 0, 1 },	// T - L - F
-			Vector4f{ -1, -1, 0, 1 },	// B - L - F
-			Vector4f{ 1, -1, 0, 1 },    // B - R - F
-			Vector4f{ 1, 1, 0, 1 },		// T - R - F
-			Vector4f{ -1, 1, 1, 1 },	// T - L - B
-			Vector4f{ -1, -1, 1, 1 },	// B - L - B
-			Vector4f{ 1, -1, 1, 1 },	// B - R - B
-			Vector4f{ 1, 1, 1, 1 }		// T - R - B
+			Vector4f{ -1, 1, 1, 1 },	        // T - L - F
+			Vector4f{ -1, -1, 1, 1 },	        // B - L - F
+			Vector4f{ 1, -1, 1, 1 },            // B - R - F
+			Vector4f{ 1, 1, 1, 1 },		        // T - R - F
+			Vector4f{ -1, 1, BackDepth, 1 },	// T - L - B
+			Vector4f{ -1, -1, BackDepth, 1 },	// B - L - B
+			Vector4f{ 1, -1, BackDepth, 1 },	// B - R - B
+			Vector4f{ 1, 1, BackDepth, 1 }		// T - R - B
 		};
 
-		// Create a new object, then modify it's data
-		ObjectData Frustum;
-		Frustum.Lifetime = Lifetime;
+		Vector4f WorldCorners[8];
+		ViewToWorld.TransformVectors(NormalizedCorners, WorldCorners, 8);
 
-		auto& Mesh = Frustum.Mesh;
-		Mesh.SetUsageMode(GL_DYNAMIC_DRAW);
-
-		DrawVertex Vertices[8];
+		// Divide by W component to get correct 3D coordinates in world space
+		Vector3f Corners[8];
 		for (int32_t i = 0; i < 8; i++)
-		{
-			// Transform each vert by inv projection
-			Vector4f Vec4 = InvProjection.TransformVector(NormalizedCorners[i]);
-
-			// Divide by W component to get correct 3D coordinates in view space
-			Vertices[i].Position = Vector3f{ Vec4.x / Vec4.w, Vec4.y / Vec4.w, Vec4.z / Vec4.w };
-
-			// Transform into world space
-			Vertices[i].Position = CameraTransform.TransformPosition(Vertices[i].Position);
-			Vertices[i].Color = Color;
-		}
-
-		// Indices to connect each vertex with a line strip
-		static const uint32_t Indices[16] =
-		{
-			0, 1, 2, 3, 0, 4, 5, 1, 2, 6, 5, 6, 7, 4, 7, 3
-		};
-
-		Mesh.AddVertex(Vertices, 8);
-		Mesh.AddIndices(Indices, 16);
-		Mesh.Activate();
+			Corners[i] = Vector3f{ WorldCorners[i].x / WorldCorners[i].w, WorldCorners[i].y / WorldCorners[i].w, WorldCorners[i].z / WorldCorners[i].w };
 
-		mObjects.push_back(std::move(Frustum));
+		AddBoxEdges(Corners, Color, Lifetime);
 	}
 
 	void Draw::DrawBox(const Vector3f& Center, const Vector3f& Dimensions, const Vector3f& Color, const float Lifetime)
 	{
 		const Vector3f HalfWidths = Dimensions / 2.0f;
-		const DrawVertex Vertices[8] =
+		const Vector3f Corners[8] =
 		{
-			{ Center + Vector3f{ -HalfWidths.x, HalfWidths.y, HalfWidths.z }, Color },
-			{ Center + Vector3f{ -HalfWidths.x, -HalfWidths.y, HalfWidths.z }, Color },
-			{ Center + Vector3f{ HalfWidths.x, -HalfWidths.y, HalfWidths.z }, Color },
-			{ Center + Vector3f{ HalfWidths.x, HalfWidths.y, HalfWidths.z }, Color },
-			{ Center + Vector3f{ -HalfWidths.x, HalfWidths.y, -HalfWidths.z }, Color },
-			{ Center + Vector3f{ -HalfWidths.x, -HalfWidths.y, -HalfWidths.z }, Color },
-			{ Center + Vector3f{ HalfWidths.x, -HalfWidths.y, -HalfWidths.z }, Color },
-			{ Center + Vector3f{ HalfWidths.x, HalfWidths.y, -HalfWidths.z }, Color }
+			Center + Vector3f{ -HalfWidths.x, HalfWidths.y, HalfWidths.z },
+			Center + Vector3f{ -HalfWidths.x, -HalfWidths.y, HalfWidths.z },
+			Center + Vector3f{ HalfWidths.x, -HalfWidths.y, HalfWidths.z },
+			Center + Vector3f{ HalfWidths.x, HalfWidths.y, HalfWidths.z },
+			Center + Vector3f{ -HalfWidths.x, HalfWidths.y, -HalfWidths.z },
+			Center + Vector3f{ -HalfWidths.x, -HalfWidths.y, -HalfWidths.z },
+			Center + Vector3f{ HalfWidths.x, -HalfWidths.y, -HalfWidths.z },
+			Center + Vector3f{ HalfWidths.x, HalfWidths.y, -HalfWidths.z }
 		};
 
-		static const uint32_t Indices[16] =
-		{
-			0, 1, 2, 3, 0, 4, 5, 1, 2, 6, 5, 6, 7, 4, 7, 3
-		};
+		AddBoxEdges(Corners, Color, Lifetime);
+	}
 
-		// Create a new object, then modify it's data
-		ObjectData Box;
+	void Draw::CloseFrame()
+	{
+		// Timed shapes are drawn along with this frame's lines, then aged
+		const float DeltaTime = STime::GetDeltaTime();
+		uint32_t ReadVertex = 0;
+		uint32_t WriteVertex = 0;
+		uint32_t KeptShapes = 0;
+		for (TimedShape& Shape : mTimedShapes)
+		{
+			mVertices.insert(mVertices.end(), mTimedVertices.begin() + ReadVertex, mTimedVertices.begin() + ReadVertex + Shape.VertexCount);
 
-		Box.Lifetime = Lifetime;
-		auto& Mesh = Box.Mesh;
-		Mesh.SetUsageMode(GL_DYNAMIC_DRAW);
+			Shape.Lifetime -= DeltaTime;
+			if (Shape.Lifetime > 0)
+			{
+				std::copy(mTimedVertices.begin() + ReadVertex, mTimedVertices.begin() + ReadVertex + Shape.VertexCount, mTimedVertices.begin() + WriteVertex);
+				WriteVertex += Shape.VertexCount;
+				mTimedShapes[KeptShapes++] = Shape;
+			}
 
-		// Add vertex and index data
-		Mesh.AddVertex(Vertices, 8);
-		Mesh.AddIndices(Indices, 16);
-		Mesh.Activate();
+			ReadVertex += Shape.VertexCount;
+		}
+		mTimedVertices.resize(WriteVertex);
+		mTimedShapes.resize(KeptShapes);
 
-		mObjects.push_back(std::move(Box));
+		mFrameVertices.swap(mVertices);
+		mVertices.clear();
 	}
 
 	void Draw::Render()
 	{
+		if (mFrameVertices.empty())
+			return;
+
+		mVertexBuffer.Upload(mFrameVertices.data(), sizeof(DrawVertex) * mFrameVertices.size());
+
 		mShader.Use();
-		const float DeltaTime = STime::GetDeltaTime();
-		for (auto Itr = mObjects.begin(); Itr != mObjects.end();)
-		{
-			Itr->Mesh.Render(GL_LINE_STRIP);
-
-			// Subtract each objects lifetime and remove if dead
-			Itr->Lifetime -= DeltaTime;
-			if (Itr->Lifetime <= 0)
-				Itr = mObjects.erase(Itr);
-			else
-				Itr++;
-		}
+		SGLState::BindVertexArray(mVertexArray);
+		glBindVertexBuffer(VERTEX_BINDING, mVertexBuffer.GetBuffer(), mVertexBuffer.GetFrameOffset(), sizeof(DrawVertex));
+		glDrawArrays(GL_LINES, 0, mFrameVertices.size());
+		SGLState::BindVertexArray(0);
+		SGLState::UseProgram(0);
+
+		mVertexBuffer.EndFrame();
+	}
+
+	void Draw::AddBoxEdges(const Vector3f* Corners, const Vector3f& Color, const float Lifetime)
+	{
+		// Shapes lasting a frame go straight to this frame's lines
+		std::vector<DrawVertex>& Vertices = Lifetime > 0 ? mTimedVertices : mVertices;
+		for (uint32_t i = 0; i < 24; i++)
+			Vertices.push_back(DrawVertex{ Corners[BOX_EDGES[i]], Color });
 
-		mLines.Activate();
-		mLines.Render(GL_LINES);
-		mLines.ClearData();
-		glUseProgram(0);
+		if (Lifetime > 0)
+			mTimedShapes.push_back(TimedShape{ Lifetime, 24 });
 	}
 }
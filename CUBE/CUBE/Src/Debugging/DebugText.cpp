@@ -7,6 +7,25 @@
 #include "SystemResources\SystemFile.h"
 #include "freetype-gl\markup.h"
 #include "Rendering\RenderSystem.h"
+#include "Rendering\GLState.h"
+
+#include <cwchar>
+
+namespace
+{
+	/**
+	* FNV-1a over the bytes of a markup, so runs laid out with other fonts or colors aren't reused.
+	*/
+	uint64_t HashMarkup(const markup_t& Markup)
+	{
+		const uint8_t* Bytes = (const uint8_t*)&Markup;
+		uint64_t Hash = 14695981039346656037ULL;
+		for (size_t i = 0; i < sizeof(markup_t); i++)
+			Hash = (Hash ^ Bytes[i]) * 1099511628211ULL;
+
+		return Hash;
+	}
+}
 
 namespace FDebug
 {
@@ -17,6 +36,11 @@ namespace FDebug
 		, mProjectionUniform()
 		, mViewUniform()
 		, mModelUniform()
+		, mRuns()
+		, mKeptRuns()
+		, mFrameRuns()
+		, mLastFrameRunCount(0)
+		, mIsBufferStale(false)
 	{
 		FRenderSystem::OnResolutionChange.AddListener<Text, &Text::OnResolutionChange>(this);
 		mTextBuffer = text_buffer_new(LCD_FILTERING_ON);
@@ -33,27 +57,113 @@ namespace FDebug
 		text_buffer_delete(mTextBuffer);
 	}
 
-	void Text::AddText(std::wstring& String, Vector2i Position, markup_t& Markup)
+	void Text::AddText(const std::wstring& String, Vector2i Position, const markup_t& Markup)
+	{
+		AddText(String.c_str(), Position, Markup);
+	}
+
+	void Text::AddText(const wchar_t* String, Vector2i Position, const markup_t& Markup)
+	{
+		// Lines are added at the same place each frame, so runs are matched by place and markup
+		const uint64_t MarkupHash = HashMarkup(Markup);
+		uint32_t RunIndex = 0;
+		while (RunIndex < mRuns.size() && (mRuns[RunIndex].IsUsed || mRuns[RunIndex].Position != Position || mRuns[RunIndex].MarkupHash != MarkupHash))
+			RunIndex++;
+
+		if (RunIndex == mRuns.size())
+		{
+			mRuns.push_back(TextRun{});
+			mRuns.back().Position = Position;
+			mRuns.back().MarkupHash = MarkupHash;
+			mRuns.back().String = String;
+			LayOut(mRuns.back(), Markup);
+		}
+		else if (mRuns[RunIndex].String.compare(String) != 0)
+		{
+			mRuns[RunIndex].String = String;
+			LayOut(mRuns[RunIndex], Markup);
+		}
+
+		mRuns[RunIndex].IsUsed = true;
+		mFrameRuns.push_back(RunIndex);
+	}
+
+	void Text::LayOut(TextRun& Run, const markup_t& Markup)
 	{
-		vec2 P{ {(float)Position.x, (float)Position.y } };
-		text_buffer_add_text(mTextBuffer, &P, &Markup, &String[0], String.length());
+		// The text buffer only lays out, its vertices are copied out and it is filled again on render
+		text_buffer_clear(mTextBuffer);
+
+		// Layout caches the font in the markup, which must stay as given to keep its hash
+		markup_t RunMarkup = Markup;
+		vec2 Pen{ { (float)Run.Position.x, (float)Run.Position.y } };
+		text_buffer_add_text(mTextBuffer, &Pen, &RunMarkup, &Run.String[0], Run.String.length());
+
+		const vector_t* Vertices = mTextBuffer->buffer->vertices;
+		const vector_t* Indices = mTextBuffer->buffer->indices;
+		Run.Vertices.assign((const uint8_t*)Vertices->items, (const uint8_t*)Vertices->items + Vertices->size * Vertices->item_size);
+		Run.Indices.assign((const GLuint*)Indices->items, (const GLuint*)Indices->items + Indices->size);
+
+		text_buffer_clear(mTextBuffer);
+		mIsBufferStale = true;
+	}
+
+	bool Text::IsFrameUnchanged() const
+	{
+		// Runs kept from last frame are stored in the order they were drawn
+		if (mIsBufferStale || mFrameRuns.size() != mLastFrameRunCount)
+			return false;
+
+		for (uint32_t i = 0; i < mFrameRuns.size(); i++)
+		{
+			if (mFrameRuns[i] != i)
+				return false;
+		}
+
+		return true;
 	}
 
 	void Text::Render()
 	{
 
-		glUseProgram(mTextBuffer->shader);
+		SGLState::UseProgram(mTextBuffer->shader);
 		static const FMatrix4 Identity{};
 		mProjectionUniform.SetMatrix(1, GL_FALSE, &mTextProjection);
 		mViewUniform.SetMatrix(1, GL_FALSE, &Identity);
 		mModelUniform.SetMatrix(1, GL_FALSE, &Identity);
 
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_ONE, GL_ONE);
-		glBlendEquation(GL_FUNC_ADD);
+		SGLState::Enable(GL_BLEND);
+		SGLState::BlendFunc(GL_ONE, GL_ONE);
+		SGLState::BlendEquation(GL_FUNC_ADD);
+
+		// All runs go in one buffer, left as it is when the same text is drawn again
+		if (!IsFrameUnchanged())
+		{
+			vertex_buffer_t* Buffer = mTextBuffer->buffer;
+			vertex_buffer_clear(Buffer);
+			for (const uint32_t RunIndex : mFrameRuns)
+			{
+				const TextRun& Run = mRuns[RunIndex];
+				if (!Run.Indices.empty())
+					vertex_buffer_push_back(Buffer, Run.Vertices.data(), Run.Vertices.size() / Buffer->vertices->item_size, Run.Indices.data(), Run.Indices.size());
+			}
+		}
 
+		// Binds its own arrays and textures, and uploads the buffer if it changed
 		text_buffer_render(mTextBuffer);
-		text_buffer_clear(mTextBuffer);
+		SGLState::Invalidate();
+
+		// Runs not added this frame are dropped, the rest kept in drawing order
+		mKeptRuns.clear();
+		for (const uint32_t RunIndex : mFrameRuns)
+		{
+			mKeptRuns.push_back(std::move(mRuns[RunIndex]));
+			mKeptRuns.back().IsUsed = false;
+		}
+
+		mRuns.swap(mKeptRuns);
+		mLastFrameRunCount = mFrameRuns.size();
+		mFrameRuns.clear();
+		mIsBufferStale = false;
 	}
 
 	void Text::OnResolutionChange(Vector2ui NewResolution)
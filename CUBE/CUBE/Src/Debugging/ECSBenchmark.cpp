@@ -0,0 +1,229 @@
+#include "Debugging\ECSBenchmark.h"
+#include "Debugging\ConsoleOutput.h"
+#include "Atlas\GameObjectManager.h"
+#include "Atlas\GameObject.h"
+#include "Atlas\Behavior.h"
+#include "Components\RigidBody.h"
+#include "Components\MeshRenderer.h"
+#include "Components\SoundEmitter.h"
+#include "Rendering\Light.h"
+#include "Memory\FrameAllocator.h"
+#include "FileIO\GenericFile.h"
+#include "Clock.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace Atlas;
+
+namespace
+{
+	const uint32_t OBJECT_COUNTS[] = { 1000, 10000, 100000 };
+
+	// Iterations of every component type at each count
+	const uint32_t ITERATION_PASSES = 30;
+
+	/**
+	* Moves its gameobject a little every frame, so behavior dispatch and
+	* transform updates cost what they do for moving objects.
+	*/
+	class CDrift : public FBehavior
+	{
+	public:
+		void Update() override
+		{
+			GetGameObject()->Transform.Translate(Vector3f{ 0.0f, 0.001f, 0.0f });
+		}
+	};
+
+	double CyclesToNanoseconds(const uint64_t Cycles, const uint32_t Count)
+	{
+		return (Count > 0) ? (double)FClock::CyclesToSeconds(Cycles) * 1e9 / Count : 0.0;
+	}
+
+	/**
+	* Runs an update of the manager with a new frame of frame memory, as the game loop does.
+	*/
+	const FGameObjectManager::UpdateTimings& UpdateFrame(FGameObjectManager& Manager)
+	{
+		SFrameAllocator::BeginFrame();
+		Manager.Update();
+		return Manager.GetLastUpdateTimings();
+	}
+
+	/**
+	* Adds the components of the mix to a gameobject: half have rigid bodies, two
+	* thirds have mesh renderers, one in eight a point light, one in sixteen a
+	* sound emitter, and one in four a behavior.
+	*/
+	void AddMixedComponents(FGameObject& GameObject, const uint32_t Index)
+	{
+		GameObject.Transform.SetLocalPosition(Vector3f{ (float)(Index % 256), 64.0f, (float)(Index / 256) });
+
+		if (Index % 2 == 0)
+			GameObject.AddComponent<EComponent::RigidBody>();
+		if (Index % 3 != 0)
+			GameObject.AddComponent<EComponent::MeshRenderer>();
+		if (Index % 8 == 0)
+			GameObject.AddComponent<EComponent::PointLight>();
+		if (Index % 16 == 0)
+			GameObject.AddComponent<EComponent::SoundEmitter>();
+		if (Index % 4 == 0)
+			GameObject.AddBehavior<CDrift>();
+	}
+
+	template <EComponent::Type Type>
+	/**
+	* Reads every component of a type as a system loop does, a component at a time.
+	* @return The cycles taken by ITERATION_PASSES passes.
+	*/
+	uint64_t IterateComponents(FGameObjectManager& Manager, uint32_t& CountOut)
+	{
+		using ComponentType = typename ComponentTraits::Object<Type>::Type;
+		FTypelessPageArray& Components = Manager.GetComponentsOfType(Type);
+
+		// The first byte of each component's data, so every component is read without being optimized out
+		volatile uint32_t Sink = 0;
+		uint32_t Sum = 0;
+
+		const uint64_t Begin = FClock::ReadSystemTimer();
+		for (uint32_t Pass = 0; Pass < ITERATION_PASSES; Pass++)
+		{
+			for (auto Itr = Components.Begin<ComponentType>(); Itr != Components.End<ComponentType>(); Itr++)
+				Sum += reinterpret_cast<const uint8_t*>(&(*Itr))[sizeof(IComponent)];
+		}
+		const uint64_t End = FClock::ReadSystemTimer();
+
+		Sink = Sum;
+		CountOut = Components.Size() * ITERATION_PASSES;
+		return End - Begin;
+	}
+
+	/**
+	* Appends a value to the flat JSON results, as "<prefix>_<key>".
+	*/
+	void AddValue(std::string& Json, const std::string& Prefix, const char* Key, const double Value)
+	{
+		char Line[128];
+		sprintf_s(Line, "%s\t\"%s_%s\":%.1f", Json.size() > 2 ? ",\n" : "", Prefix.c_str(), Key, Value);
+		Json += Line;
+	}
+
+	struct TypeRecord
+	{
+		EComponent::Type Type;
+		const char*      Name;
+	};
+
+	const TypeRecord MIXED_TYPES[] =
+	{
+		{ EComponent::RigidBody, "rigid_body" },
+		{ EComponent::MeshRenderer, "mesh_renderer" },
+		{ EComponent::PointLight, "point_light" },
+		{ EComponent::SoundEmitter, "sound_emitter" }
+	};
+
+	/**
+	* Adds the size, capacity and pages of each component type in the mix.
+	*/
+	void AddPageUsage(std::string& Json, FGameObjectManager& Manager, const std::string& Prefix)
+	{
+		for (const TypeRecord& Record : MIXED_TYPES)
+		{
+			const FTypelessPageArray& Components = Manager.GetComponentsOfType(Record.Type);
+			const std::string TypePrefix = Prefix + "_" + Record.Name;
+			const double Occupancy = (Components.Capacity() > 0) ? (double)Components.Size() / Components.Capacity() : 0.0;
+
+			AddValue(Json, TypePrefix, "components", Components.Size());
+			AddValue(Json, TypePrefix, "pages", Components.PageCount());
+			AddValue(Json, TypePrefix, "page_kb", (double)Components.Capacity() * Components.ElementSize() / 1024.0);
+			AddValue(Json, TypePrefix, "occupancy", Occupancy);
+		}
+	}
+}
+
+void SECSBenchmark::Run(FGameObjectManager& Manager, const wchar_t* ResultFilename)
+{
+	std::string Json = "{\n";
+
+	for (const uint32_t Count : OBJECT_COUNTS)
+	{
+		const std::string Prefix = "n" + std::to_string(Count);
+		std::vector<FGameObject*> GameObjects;
+		GameObjects.reserve(Count);
+
+		// Components are added right away, systems only check them in the next update
+		const uint64_t SpawnBegin = FClock::ReadSystemTimer();
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			FGameObject& GameObject = Manager.CreateGameObject();
+			AddMixedComponents(GameObject, i);
+			GameObjects.push_back(&GameObject);
+		}
+		const uint64_t SpawnCycles = FClock::ReadSystemTimer() - SpawnBegin;
+
+		const uint64_t InterestCycles = UpdateFrame(Manager).InterestCycles;
+
+		uint64_t BehaviorCycles = 0;
+		uint64_t TransformCycles = 0;
+		const uint64_t FramesBegin = FClock::ReadSystemTimer();
+		for (uint32_t Frame = 0; Frame < FRAMES_PER_COUNT; Frame++)
+		{
+			const FGameObjectManager::UpdateTimings& Timings = UpdateFrame(Manager);
+			BehaviorCycles += Timings.BehaviorCycles;
+			TransformCycles += Timings.TransformCycles;
+		}
+		const uint64_t FramesCycles = FClock::ReadSystemTimer() - FramesBegin;
+
+		const uint32_t BehaviorCount = (Count + 3) / 4;
+		AddValue(Json, Prefix, "spawn_ns_per_object", CyclesToNanoseconds(SpawnCycles, Count));
+		AddValue(Json, Prefix, "check_interest_ns_per_object", CyclesToNanoseconds(InterestCycles, Count));
+		AddValue(Json, Prefix, "update_ms_per_frame", CyclesToNanoseconds(FramesCycles, FRAMES_PER_COUNT) / 1e6);
+		AddValue(Json, Prefix, "behavior_ns_per_behavior", CyclesToNanoseconds(BehaviorCycles, BehaviorCount * FRAMES_PER_COUNT));
+		AddValue(Json, Prefix, "transform_ns_per_object", CyclesToNanoseconds(TransformCycles, Count * FRAMES_PER_COUNT));
+
+		// Iterated as each system iterates its components
+		uint32_t Iterated;
+		uint64_t Cycles = IterateComponents<EComponent::RigidBody>(Manager, Iterated);
+		AddValue(Json, Prefix, "iterate_rigid_body_ns", CyclesToNanoseconds(Cycles, Iterated));
+		Cycles = IterateComponents<EComponent::MeshRenderer>(Manager, Iterated);
+		AddValue(Json, Prefix, "iterate_mesh_renderer_ns", CyclesToNanoseconds(Cycles, Iterated));
+		Cycles = IterateComponents<EComponent::PointLight>(Manager, Iterated);
+		AddValue(Json, Prefix, "iterate_point_light_ns", CyclesToNanoseconds(Cycles, Iterated));
+		Cycles = IterateComponents<EComponent::SoundEmitter>(Manager, Iterated);
+		AddValue(Json, Prefix, "iterate_sound_emitter_ns", CyclesToNanoseconds(Cycles, Iterated));
+
+		AddPageUsage(Json, Manager, Prefix + "_spawned");
+
+		// Destroys are queued, and carried out by the next update
+		const uint64_t DestroyBegin = FClock::ReadSystemTimer();
+		for (FGameObject* GameObject : GameObjects)
+			GameObject->Destroy();
+		const uint64_t QueueCycles = FClock::ReadSystemTimer() - DestroyBegin;
+
+		const uint64_t DestroyCycles = QueueCycles + UpdateFrame(Manager).DestroyCycles;
+		AddValue(Json, Prefix, "destroy_ns_per_object", CyclesToNanoseconds(DestroyCycles, Count));
+
+		// Pages stay allocated for the next spawn
+		AddPageUsage(Json, Manager, Prefix + "_destroyed");
+
+		FDebug::PrintF("ECS benchmark at %u gameobjects: spawn %.0f ns, interest %.0f ns, destroy %.0f ns per object, update %.3f ms per frame\n",
+			Count, CyclesToNanoseconds(SpawnCycles, Count), CyclesToNanoseconds(InterestCycles, Count), CyclesToNanoseconds(DestroyCycles, Count),
+			CyclesToNanoseconds(FramesCycles, FRAMES_PER_COUNT) / 1e6);
+	}
+
+	Json += "\n}\n";
+	FDebug::PrintF("ECS benchmark results:\n%s", Json.c_str());
+
+	if (!ResultFilename)
+		return;
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	if (FileSystem.FileExists(ResultFilename))
+		FileSystem.DeleteFilename(ResultFilename);
+
+	auto File = FileSystem.OpenWritable(ResultFilename, false, true);
+	if (!File || !File->Write((const uint8_t*)Json.data(), Json.size()))
+		FDebug::PrintF("Failed to write ECS benchmark results to %S\n", ResultFilename);
+}
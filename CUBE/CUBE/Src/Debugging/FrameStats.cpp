@@ -0,0 +1,260 @@
+#include "Debugging\FrameStats.h"
+#include "Debugging\CPUProfiler.h"
+#include "Debugging\Log.h"
+#include "FileIO\GenericFile.h"
+#include "Threading\JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Buckets for each power of two, times below twice this many microseconds are counted exactly
+	const uint32_t SUB_BUCKET_BITS = 5;
+	const uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+
+	// Times are counted up to 2^24 microseconds, about 16 seconds, longer ones as the longest
+	const uint32_t MAX_VALUE_BITS = 24;
+	const uint32_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+	struct Histogram
+	{
+		uint32_t Counts[BUCKET_COUNT];
+		uint32_t Total;
+		uint32_t Max; // Microseconds, kept exactly
+	};
+
+	const char* STAGE_NAMES[EFrameStage::Count] = { "WaitForStep", "GameObjects", "Audio", "WaitForRender", "MainThreadJobs", "Chunks", "Physics", "Render", "Events" };
+
+	Histogram FrameHistogram;
+	Histogram StageHistograms[EFrameStage::Count];
+	FDebug::FrameStats::Summary LastFrameSummary;
+	FDebug::FrameStats::Summary LastStageSummaries[EFrameStage::Count];
+
+	uint64_t FrameStarts[FDebug::FrameStats::HITCH_CAPTURE_FRAMES]; // Of the newest frames
+	uint32_t FrameIndex = 0;
+	uint64_t LastFrameEnd = 0;
+	uint64_t IntervalBegin = 0;
+	uint32_t IntervalHitches = 0;
+	uint64_t LastHitchCapture = 0;
+
+	std::wstring                      ExportFile;
+	FDebug::FrameStats::ExportHandler Handler;
+
+	uint32_t GetBucket(uint32_t Microseconds)
+	{
+		if (Microseconds >= (1u << MAX_VALUE_BITS))
+			Microseconds = (1u << MAX_VALUE_BITS) - 1;
+		if (Microseconds < 2 * SUB_BUCKET_COUNT)
+			return Microseconds;
+
+		uint32_t HighestBit = 0;
+		for (uint32_t Value = Microseconds; Value > 1; Value >>= 1)
+			HighestBit++;
+
+		// The highest bits pick the bucket, the rest are dropped
+		const uint32_t Shift = HighestBit - SUB_BUCKET_BITS;
+		return (Shift + 1) * SUB_BUCKET_COUNT + (Microseconds >> Shift) - SUB_BUCKET_COUNT;
+	}
+
+	/**
+	* The middle of the times counted into a bucket, in microseconds.
+	*/
+	float GetBucketValue(const uint32_t Bucket)
+	{
+		if (Bucket < 2 * SUB_BUCKET_COUNT)
+			return (float)Bucket;
+
+		const uint32_t Shift = Bucket / SUB_BUCKET_COUNT - 1;
+		const uint32_t Lowest = (Bucket % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT) << Shift;
+		return Lowest + ((1u << Shift) - 1) * 0.5f;
+	}
+
+	void Add(Histogram& Times, const uint64_t Cycles)
+	{
+		const uint32_t Microseconds = (uint32_t)std::min(FClock::CyclesToSeconds(Cycles) * 1000000.0f, 4.0e9f);
+		Times.Counts[GetBucket(Microseconds)]++;
+		Times.Total++;
+		Times.Max = std::max(Times.Max, Microseconds);
+	}
+
+	/**
+	* The time that a fraction of the times are at or below, in milliseconds.
+	*/
+	float GetPercentile(const Histogram& Times, const float Fraction)
+	{
+		if (Times.Total == 0)
+			return 0.0f;
+
+		const uint32_t Rank = std::max((uint32_t)std::ceil(Times.Total * Fraction), 1u);
+		uint32_t Counted = 0;
+		for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			Counted += Times.Counts[i];
+			if (Counted >= Rank)
+				return std::min(GetBucketValue(i), (float)Times.Max) / 1000.0f;
+		}
+
+		return Times.Max / 1000.0f;
+	}
+
+	FDebug::FrameStats::Summary Summarize(const Histogram& Times)
+	{
+		const FDebug::FrameStats::Summary Result = {
+			GetPercentile(Times, 0.5f),
+			GetPercentile(Times, 0.95f),
+			GetPercentile(Times, 0.99f),
+			Times.Max / 1000.0f,
+			Times.Total };
+		return Result;
+	}
+
+	void AppendSummary(std::string& Json, const char* Name, const FDebug::FrameStats::Summary& Times)
+	{
+		char Line[192];
+		sprintf_s(Line, "\"%s\":{\"p50\":%.3f,\"p95\":%.3f,\"p99\":%.3f,\"max\":%.3f}", Name, Times.P50Ms, Times.P95Ms, Times.P99Ms, Times.MaxMs);
+		Json += Line;
+	}
+
+	/**
+	* Appends a line to a file, creating it if it doesn't exist.
+	*/
+	bool AppendLine(const std::wstring& Filename, const std::string& Line)
+	{
+		IFileSystem& FileSystem = IFileSystem::GetInstance();
+		auto File = FileSystem.FileExists(Filename.c_str()) ? FileSystem.OpenWritable(Filename.c_str()) : FileSystem.OpenWritable(Filename.c_str(), false, true);
+		return File && File->SeekFromEnd(0) && File->Write((const uint8_t*)Line.data(), Line.size()) && File->Flush();
+	}
+}
+
+namespace FDebug
+{
+	uint64_t FrameStats::StageCycles[EFrameStage::Count] = {};
+	float FrameStats::HitchThresholdMs = 50.0f;
+	uint32_t FrameStats::HitchCount = 0;
+
+	void FrameStats::EndFrame()
+	{
+		const uint64_t Now = FClock::ReadSystemTimer();
+		if (LastFrameEnd == 0)
+		{
+			// The first call only starts the first frame
+			memset(StageCycles, 0, sizeof(StageCycles));
+			LastFrameEnd = Now;
+			IntervalBegin = Now;
+			return;
+		}
+
+		const uint64_t FrameCycles = Now - LastFrameEnd;
+		Add(FrameHistogram, FrameCycles);
+		for (uint32_t i = 0; i < EFrameStage::Count; i++)
+		{
+			Add(StageHistograms[i], StageCycles[i]);
+			StageCycles[i] = 0;
+		}
+
+		FrameStarts[FrameIndex % HITCH_CAPTURE_FRAMES] = LastFrameEnd;
+		FrameIndex++;
+		LastFrameEnd = Now;
+
+		const float FrameMs = FClock::CyclesToSeconds(FrameCycles) * 1000.0f;
+		if (HitchThresholdMs > 0.0f && FrameMs > HitchThresholdMs)
+		{
+			HitchCount++;
+			IntervalHitches++;
+			LOG(Info, General, "Hitch of %.1f ms.", FrameMs);
+
+			// Exported on a worker, so the export doesn't lengthen the next frame
+			if (CPUProfiler::IsCapturing() && (LastHitchCapture == 0 || Now - LastHitchCapture >= FClock::SecondsToCycles((float)HITCH_CAPTURE_COOLDOWN)))
+			{
+				LastHitchCapture = Now;
+
+				const uint64_t Since = FrameStarts[(FrameIndex < HITCH_CAPTURE_FRAMES) ? 0 : FrameIndex % HITCH_CAPTURE_FRAMES];
+				const std::wstring Filename = L"Hitch_" + std::to_wstring(HitchCount) + L".json";
+				FJobSystem::GetInstance().Submit([Filename, Since]()
+				{
+					if (!CPUProfiler::Export(Filename.c_str(), Since))
+						LOG(Warning, General, "Hitch capture couldn't be written to %S.", Filename.c_str());
+				});
+			}
+		}
+
+		if (Now - IntervalBegin >= FClock::SecondsToCycles((float)INTERVAL))
+			EndInterval(Now);
+	}
+
+	void FrameStats::SetExportFile(const std::wstring& Filename)
+	{
+		ExportFile = Filename;
+	}
+
+	void FrameStats::SetExportHandler(ExportHandler NewHandler)
+	{
+		Handler = std::move(NewHandler);
+	}
+
+	FrameStats::Summary FrameStats::GetFrameSummary()
+	{
+		return LastFrameSummary;
+	}
+
+	FrameStats::Summary FrameStats::GetStageSummary(const EFrameStage::Type Stage)
+	{
+		return LastStageSummaries[Stage];
+	}
+
+	const char* FrameStats::GetName(const EFrameStage::Type Stage)
+	{
+		return STAGE_NAMES[Stage];
+	}
+
+	void FrameStats::AddStageTime(const EFrameStage::Type Stage, const uint64_t Cycles)
+	{
+		StageCycles[Stage] += Cycles;
+	}
+
+	void FrameStats::EndInterval(const uint64_t Now)
+	{
+		const float Seconds = FClock::CyclesToSeconds(Now - IntervalBegin);
+		const uint32_t Hitches = IntervalHitches;
+		LastFrameSummary = Summarize(FrameHistogram);
+		for (uint32_t i = 0; i < EFrameStage::Count; i++)
+			LastStageSummaries[i] = Summarize(StageHistograms[i]);
+
+		memset(&FrameHistogram, 0, sizeof(FrameHistogram));
+		memset(StageHistograms, 0, sizeof(StageHistograms));
+		IntervalBegin = Now;
+		IntervalHitches = 0;
+
+		if (ExportFile.empty() && !Handler)
+			return;
+
+		char Line[128];
+		sprintf_s(Line, "{\"interval_s\":%.2f,\"frames\":%u,\"hitches\":%u,", Seconds, LastFrameSummary.SampleCount, Hitches);
+		std::string Json = Line;
+		AppendSummary(Json, "frame_ms", LastFrameSummary);
+		Json += ",\"stages_ms\":{";
+		for (uint32_t i = 0; i < EFrameStage::Count; i++)
+		{
+			if (i > 0)
+				Json += ",";
+			AppendSummary(Json, STAGE_NAMES[i], LastStageSummaries[i]);
+		}
+		Json += "}}\n";
+
+		const std::wstring Filename = ExportFile;
+		const ExportHandler Export = Handler;
+		FJobSystem::GetInstance().Submit([Filename, Export, Json]()
+		{
+			if (!Filename.empty() && !AppendLine(Filename, Json))
+				LOG(Warning, General, "Frame stats couldn't be written to %S.", Filename.c_str());
+			if (Export)
+				Export(Json);
+		});
+	}
+}
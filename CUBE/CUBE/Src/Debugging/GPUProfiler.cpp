@@ -0,0 +1,196 @@
+#include "Debugging\GPUProfiler.h"
+#include "FileIO\GenericFile.h"
+#include "Misc\Assertions.h"
+
+#include <cstdio>
+#include <string>
+
+namespace
+{
+	bool IsCSVFile(const wchar_t* Filename)
+	{
+		const std::wstring Name{ Filename };
+		return Name.size() >= 4 && Name.compare(Name.size() - 4, 4, L".csv") == 0;
+	}
+
+	double ToMilliseconds(const uint64_t Nanoseconds)
+	{
+		return Nanoseconds / 1000000.0;
+	}
+
+	double ToMicroseconds(const uint64_t Nanoseconds)
+	{
+		return Nanoseconds / 1000.0;
+	}
+}
+
+namespace FDebug
+{
+	GPUProfiler::GPUProfiler()
+		: mPassStack()
+		, mTimestamps()
+		, mHistory()
+		, mFrame(0)
+		, mIsRecording(false)
+	{
+		for (uint32_t i = 0; i < FRAME_COUNT; i++)
+		{
+			mFrames[i].Frame = 0;
+			mFrames[i].QueryCount = 0;
+			mFrames[i].IsPending = false;
+		}
+	}
+
+	GPUProfiler::~GPUProfiler()
+	{
+		for (uint32_t i = 0; i < FRAME_COUNT; i++)
+		{
+			if (!mFrames[i].Queries.empty())
+				glDeleteQueries(mFrames[i].Queries.size(), mFrames[i].Queries.data());
+		}
+	}
+
+	void GPUProfiler::BeginFrame()
+	{
+		ASSERT(!mIsRecording && "The last frame wasn't ended.");
+
+		FrameQueries& Frame = mFrames[mFrame % FRAME_COUNT];
+		if (Frame.IsPending)
+			Resolve(Frame);
+
+		Frame.Passes.clear();
+		Frame.Frame = mFrame;
+		Frame.QueryCount = 0;
+		mPassStack.clear();
+		mIsRecording = true;
+
+		IssueTimestamp(Frame);
+	}
+
+	void GPUProfiler::EndFrame()
+	{
+		ASSERT(mIsRecording && "No frame was begun.");
+		ASSERT(mPassStack.empty() && "Every pass must end before the frame.");
+
+		FrameQueries& Frame = mFrames[mFrame % FRAME_COUNT];
+		IssueTimestamp(Frame);
+		Frame.IsPending = true;
+
+		mIsRecording = false;
+		mFrame++;
+	}
+
+	void GPUProfiler::BeginPass(const char* Name)
+	{
+		// Passes outside a frame, such as during loading, aren't measured
+		if (!mIsRecording)
+			return;
+
+		FrameQueries& Frame = mFrames[mFrame % FRAME_COUNT];
+		const uint32_t BeginQuery = IssueTimestamp(Frame);
+
+		mPassStack.push_back(Frame.Passes.size());
+		Frame.Passes.push_back(Pass{ Name, (uint32_t)mPassStack.size() - 1, BeginQuery, 0 });
+	}
+
+	void GPUProfiler::EndPass()
+	{
+		if (!mIsRecording)
+			return;
+
+		ASSERT(!mPassStack.empty() && "No pass was begun.");
+
+		FrameQueries& Frame = mFrames[mFrame % FRAME_COUNT];
+		Frame.Passes[mPassStack.back()].EndQuery = IssueTimestamp(Frame);
+		mPassStack.pop_back();
+	}
+
+	const GPUProfiler::FrameResult* GPUProfiler::GetLastResult() const
+	{
+		return mHistory.empty() ? nullptr : &mHistory.back();
+	}
+
+	bool GPUProfiler::Export(const wchar_t* Filename) const
+	{
+		auto File = IFileSystem::GetInstance().OpenWritable(Filename, false, true);
+		if (!File)
+			return false;
+
+		const bool IsCSV = IsCSVFile(Filename);
+		const uint64_t Origin = mHistory.empty() ? 0 : mHistory.front().Begin;
+
+		std::string Output = IsCSV ? "Frame,Pass,Depth,StartMs,DurationMs\n" : "{\"traceEvents\":[\n";
+		char Line[256];
+		bool IsFirstEvent = true;
+
+		for (const FrameResult& Frame : mHistory)
+		{
+			// Frame first, so its passes nest inside it in the trace
+			if (!IsCSV)
+			{
+				sprintf_s(Line, "%s{\"name\":\"Frame %llu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+					IsFirstEvent ? "" : ",\n", Frame.Frame, ToMicroseconds(Frame.Begin - Origin), ToMicroseconds(Frame.End - Frame.Begin));
+				Output += Line;
+				IsFirstEvent = false;
+			}
+
+			for (const PassResult& Timed : Frame.Passes)
+			{
+				if (IsCSV)
+				{
+					sprintf_s(Line, "%llu,%s,%u,%.4f,%.4f\n", Frame.Frame, Timed.Name, Timed.Depth,
+						ToMilliseconds(Timed.Begin - Frame.Begin), ToMilliseconds(Timed.End - Timed.Begin));
+				}
+				else
+				{
+					sprintf_s(Line, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+						Timed.Name, ToMicroseconds(Timed.Begin - Origin), ToMicroseconds(Timed.End - Timed.Begin));
+				}
+				Output += Line;
+			}
+		}
+
+		if (!IsCSV)
+			Output += "\n]}\n";
+
+		return File->Write((const uint8_t*)Output.data(), Output.size()) && File->Flush();
+	}
+
+	void GPUProfiler::Resolve(FrameQueries& Frame)
+	{
+		Frame.IsPending = false;
+
+		// Several frames old, so only a lost context leaves it unfinished
+		GLint IsAvailable = GL_FALSE;
+		glGetQueryObjectiv(Frame.Queries[Frame.QueryCount - 1], GL_QUERY_RESULT_AVAILABLE, &IsAvailable);
+		if (IsAvailable == GL_FALSE)
+			return;
+
+		mTimestamps.resize(Frame.QueryCount);
+		for (uint32_t i = 0; i < Frame.QueryCount; i++)
+			glGetQueryObjectui64v(Frame.Queries[i], GL_QUERY_RESULT, &mTimestamps[i]);
+
+		if (mHistory.size() == HISTORY_FRAMES)
+			mHistory.pop_front();
+
+		mHistory.push_back(FrameResult{ Frame.Frame, mTimestamps.front(), mTimestamps[Frame.QueryCount - 1], std::vector<PassResult>{} });
+
+		FrameResult& Result = mHistory.back();
+		Result.Passes.reserve(Frame.Passes.size());
+		for (const Pass& Measured : Frame.Passes)
+			Result.Passes.push_back(PassResult{ Measured.Name, Measured.Depth, mTimestamps[Measured.BeginQuery], mTimestamps[Measured.EndQuery] });
+	}
+
+	uint32_t GPUProfiler::IssueTimestamp(FrameQueries& Frame)
+	{
+		if (Frame.QueryCount == Frame.Queries.size())
+		{
+			GLuint Query;
+			glGenQueries(1, &Query);
+			Frame.Queries.push_back(Query);
+		}
+
+		glQueryCounter(Frame.Queries[Frame.QueryCount], GL_TIMESTAMP);
+		return Frame.QueryCount++;
+	}
+}
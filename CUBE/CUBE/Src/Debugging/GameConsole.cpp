@@ -3,10 +3,21 @@
 #include "Debugging\DebugText.h"
 #include "Input\TextEntered.h"
 #include "Physics\PhysicsSystem.h"
+#include "Rendering\RenderSystem.h"
 #include "ChunkSystems\ChunkManager.h"
 #include "Rendering\Screen.h"
 #include "Rendering\Camera.h"
+#include "Rendering\GLState.h"
+#include "Debugging\GPUProfiler.h"
+#include "Debugging\CPUProfiler.h"
+#include "Debugging\ConsoleOutput.h"
+#include "Debugging\ConsoleVariables.h"
+#include "Memory\MemoryStats.h"
+#include "Rendering\MeshAsset.h"
 #include "STime.h"
+#include "FramePacer.h"
+#include "Math\FMath.h"
+#include <cmath>
 
 namespace FDebug
 {
@@ -18,6 +29,9 @@ namespace FDebug
 		, mChunkManager(nullptr)
 		, mIsActive(false)
 		, mDrawPhysics(false)
+		, mDrawGPUProfile(false)
+		, mDrawMemory(false)
+		, mDrawChunkStats(false)
 	{
 		const vec4 White{ { 1, 1, 1, 1 } };
 		const vec4 Background{ { 0.3f, 0.3f, 0.3f, 0.8f } };
@@ -57,17 +71,82 @@ namespace FDebug
 		wchar_t String[250];
 		const Vector3f Direction = FCamera::Main->Transform.GetRotation() * -Vector3f::Forward;
 		swprintf_s(String, L"FPS: %.0f   Position: %.1f %.1f %.1f Direction: %.1f %.1f %.1f", 1.0f / STime::GetDeltaTime(), CameraPosition.x, CameraPosition.y, CameraPosition.z, Direction.x, Direction.y, Direction.z);
-		DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 50), TextMarkup);
+		DebugText.AddText(String, Vector2i(50, SScreen::GetResolution().y - 50), TextMarkup);
 
 		swprintf_s(String, L"+");
-		DebugText.AddText(std::wstring{ String }, SScreen::GetResolution() / 2, TextMarkup);
+		DebugText.AddText(String, SScreen::GetResolution() / 2, TextMarkup);
 
-		swprintf_s(String, L"Chunks used: %d", FChunk::ChunkAllocator.Size());
-		DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 100), TextMarkup);
+		swprintf_s(String, L"Chunks used: %d   Block memory: %llu KB", mChunkManager ? mChunkManager->GetMeshCount() : 0, SMemoryStats::GetLiveBytes(EMemoryTag::ChunkBlocks) / 1024);
+		DebugText.AddText(String, Vector2i(50, SScreen::GetResolution().y - 100), TextMarkup);
 
-		Vector3i ChunkPosition = Vector3i(CameraPosition.x / FChunk::CHUNK_SIZE, CameraPosition.y / FChunk::CHUNK_SIZE, CameraPosition.z / FChunk::CHUNK_SIZE);
+		// Floored, so positions below zero fall in the chunk below rather than truncating toward it
+		const Vector3i CameraBlock{ (int32_t)std::floor(CameraPosition.x), (int32_t)std::floor(CameraPosition.y), (int32_t)std::floor(CameraPosition.z) };
+		const Vector3i ChunkPosition = FMath::FloorDivide(CameraBlock, FChunk::CHUNK_SIZE);
 		swprintf_s(String, L"Chunk Position: %d %d %d", ChunkPosition.x, ChunkPosition.y, ChunkPosition.z);
-		DebugText.AddText(std::wstring{ String }, Vector2i(50, SScreen::GetResolution().y - 150), TextMarkup);
+		DebugText.AddText(String, Vector2i(50, SScreen::GetResolution().y - 150), TextMarkup);
+
+		if (mChunkManager)
+		{
+			swprintf_s(String, L"Chunk Workers: %u   Jobs/sec: %.0f", mChunkManager->GetWorkerCount(), mChunkManager->GetJobsPerSecond());
+			DebugText.AddText(String, Vector2i(50, SScreen::GetResolution().y - 200), TextMarkup);
+		}
+
+		const SGLState::FrameStats StateStats = SGLState::GetLastFrameStats();
+		const Vector2ui RenderResolution = SScreen::GetRenderResolution();
+		swprintf_s(String, L"GL state calls: %u   Filtered: %u   Render resolution: %ux%u", StateStats.Issued, StateStats.Filtered, RenderResolution.x, RenderResolution.y);
+		DebugText.AddText(String, Vector2i(50, SScreen::GetResolution().y - 250), TextMarkup);
+
+		const GPUProfiler::FrameResult* Profile = GPUProfiler::GetInstance().GetLastResult();
+		if (mDrawGPUProfile && Profile)
+		{
+			swprintf_s(String, L"GPU frame: %.2f ms", (Profile->End - Profile->Begin) / 1000000.0);
+			DebugText.AddText(String, Vector2i(50, SScreen::GetResolution().y - 300), TextMarkup);
+
+			int32_t Line = 1;
+			for (const auto& Pass : Profile->Passes)
+			{
+				swprintf_s(String, L"%*s%S: %.2f ms", Pass.Depth * 4, L"", Pass.Name, (Pass.End - Pass.Begin) / 1000000.0);
+				DebugText.AddText(String, Vector2i(50, SScreen::GetResolution().y - 300 - 25 * Line++), TextMarkup);
+			}
+		}
+
+		if (mDrawMemory)
+		{
+			const int32_t Column = (int32_t)SScreen::GetResolution().x - 600;
+			for (uint32_t i = 0; i < EMemoryTag::Count; i++)
+			{
+				// A budget of 0 KB is no budget
+				const EMemoryTag::Type Tag = (EMemoryTag::Type)i;
+				swprintf_s(String, L"%S: %llu KB   Peak: %llu KB   Budget: %llu KB%s", SMemoryStats::GetName(Tag), SMemoryStats::GetLiveBytes(Tag) / 1024,
+					SMemoryStats::GetPeakBytes(Tag) / 1024, SMemoryStats::GetBudget(Tag) / 1024, SMemoryStats::IsOverBudget(Tag) ? L" (over)" : L"");
+				DebugText.AddText(String, Vector2i(Column, SScreen::GetResolution().y - 50 - 25 * (int32_t)i), TextMarkup);
+			}
+		}
+
+		if (mDrawChunkStats && mChunkManager)
+		{
+			// Below the memory stats when both are drawn
+			const int32_t Column = (int32_t)SScreen::GetResolution().x - 600;
+			int32_t Line = mDrawMemory ? EMemoryTag::Count + 1 : 0;
+			const FChunkManager::Stats Stats = mChunkManager->GetStats();
+
+			swprintf_s(String, L"Queued loads: %u   Reads: %u   Jobs: %u   Rebuilds: %u   Swaps: %u", Stats.LoadListDepth, Stats.ReadQueueDepth,
+				Stats.PendingJobs, Stats.RebuildListDepth, Stats.SwapQueueDepth);
+			DebugText.AddText(String, Vector2i(Column, SScreen::GetResolution().y - 50 - 25 * Line++), TextMarkup);
+
+			swprintf_s(String, L"Loads/sec: %.0f   Thrash/sec: %.1f   Read: %.0f KB/sec   Written: %.0f KB/sec", Stats.Rates.LoadsPerSecond,
+				Stats.Rates.ThrashesPerSecond, Stats.Rates.BytesReadPerSecond / 1024.0f, Stats.Rates.BytesWrittenPerSecond / 1024.0f);
+			DebugText.AddText(String, Vector2i(Column, SScreen::GetResolution().y - 50 - 25 * Line++), TextMarkup);
+
+			for (uint32_t i = 0; i < EChunkStage::Count; i++)
+			{
+				swprintf_s(String, L"%S: %.2f ms   p99: %.2f ms", FChunkPipelineStats::GetStageName((EChunkStage::Type)i), Stats.Stages[i].AverageMs, Stats.Stages[i].P99Ms);
+				DebugText.AddText(String, Vector2i(Column, SScreen::GetResolution().y - 50 - 25 * Line++), TextMarkup);
+			}
+
+			swprintf_s(String, L"Visible to draw: %.1f ms   p99: %.1f ms", Stats.VisibleToDraw.AverageMs, Stats.VisibleToDraw.P99Ms);
+			DebugText.AddText(String, Vector2i(Column, SScreen::GetResolution().y - 50 - 25 * Line++), TextMarkup);
+		}
 
 		///////////////////////////////////////////////
 		///////////////////////////////
@@ -123,6 +202,10 @@ namespace FDebug
 			else
 				mDrawPhysics = false;
 		}
+		else if (mPhysicsSystem && mCommandBuffer.substr(0, 15) == std::wstring{ L"ParallelPhysics" })
+		{
+			mPhysicsSystem->SetParallel(mCommandBuffer.substr(16) == std::wstring{ L"true" });
+		}
 		else if (mChunkManager && mCommandBuffer.substr(0, 9) == std::wstring{ L"LoadWorld" })
 		{
 			mChunkManager->LoadWorld(mCommandBuffer.substr(10).c_str());
@@ -132,6 +215,137 @@ namespace FDebug
 			std::wstring Distance = mCommandBuffer.substr(16, 18);
 			mChunkManager->SetViewDistance((int32_t)std::stoi(Distance));
 		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 17) == std::wstring{ L"SetEvictionMargin" })
+		{
+			mChunkManager->SetEvictionMargin((uint32_t)std::stoi(mCommandBuffer.substr(18)));
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 15) == std::wstring{ L"SetChunkWorkers" })
+		{
+			std::wstring Count = mCommandBuffer.substr(16, 18);
+			mChunkManager->SetWorkerCount((uint32_t)std::stoi(Count));
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 14) == std::wstring{ L"SetLODDistance" })
+		{
+			size_t DistanceStart = 0;
+			const uint32_t Level = (uint32_t)std::stoi(mCommandBuffer.substr(15), &DistanceStart);
+			const uint32_t Distance = (uint32_t)std::stoi(mCommandBuffer.substr(15 + DistanceStart));
+			mChunkManager->SetLODDistance(Level, Distance);
+		}
+		else if (mCommandBuffer.substr(0, 14) == std::wstring{ L"DrawGPUProfile" })
+		{
+			mDrawGPUProfile = mCommandBuffer.substr(15) == std::wstring{ L"true" };
+		}
+		else if (mCommandBuffer.substr(0, 16) == std::wstring{ L"ExportGPUProfile" })
+		{
+			if (!GPUProfiler::GetInstance().Export(mCommandBuffer.substr(17).c_str()))
+				FDebug::PrintF("Failed to export the GPU profile.\n");
+		}
+		else if (mRenderSystem && mCommandBuffer.substr(0, 17) == std::wstring{ L"DynamicResolution" })
+		{
+			mRenderSystem->GetDynamicResolution().SetEnabled(mCommandBuffer.substr(18) == std::wstring{ L"true" });
+		}
+		else if (mRenderSystem && mCommandBuffer.substr(0, 12) == std::wstring{ L"DepthPrePass" })
+		{
+			mRenderSystem->SetDepthPrePass(mCommandBuffer.substr(13) == std::wstring{ L"true" });
+		}
+		else if (mCommandBuffer.substr(0, 12) == std::wstring{ L"SetTargetFPS" })
+		{
+			SFramePacer::SetTargetFPS(std::stof(mCommandBuffer.substr(13)));
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 13) == std::wstring{ L"SetSwapBudget" })
+		{
+			size_t TimeStart = 0;
+			const uint32_t Kilobytes = (uint32_t)std::stoi(mCommandBuffer.substr(14), &TimeStart);
+			const float Milliseconds = std::stof(mCommandBuffer.substr(14 + TimeStart));
+			mChunkManager->SetSwapBudget(Kilobytes * 1024, Milliseconds);
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 10) == std::wstring{ L"GPUMeshing" })
+		{
+			mChunkManager->SetGPUMeshing(mCommandBuffer.substr(11) == std::wstring{ L"true" });
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 10) == std::wstring{ L"FarTerrain" })
+		{
+			mChunkManager->SetFarTerrain(mCommandBuffer.substr(11) == std::wstring{ L"true" });
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 19) == std::wstring{ L"ConnectivityCulling" })
+		{
+			mChunkManager->SetConnectivityCulling(mCommandBuffer.substr(20) == std::wstring{ L"true" });
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 20) == std::wstring{ L"SetPrefetchLookahead" })
+		{
+			mChunkManager->SetPrefetchLookahead(std::stof(mCommandBuffer.substr(21)));
+		}
+		else if (mCommandBuffer.substr(0, 15) == std::wstring{ L"SmoothDeltaTime" })
+		{
+			STime::SetDeltaSmoothing(mCommandBuffer.substr(16) == std::wstring{ L"true" });
+		}
+		else if (mRenderSystem && mCommandBuffer.substr(0, 12) == std::wstring{ L"SetGPUBudget" })
+		{
+			mRenderSystem->GetDynamicResolution().SetBudget(std::stof(mCommandBuffer.substr(13)));
+		}
+		else if (mCommandBuffer.substr(0, 10) == std::wstring{ L"DrawMemory" })
+		{
+			mDrawMemory = mCommandBuffer.substr(11) == std::wstring{ L"true" };
+		}
+		else if (mCommandBuffer.substr(0, 15) == std::wstring{ L"SetMemoryBudget" })
+		{
+			const std::wstring Arguments = mCommandBuffer.substr(16);
+			const size_t NameEnd = Arguments.find(L' ');
+			const std::wstring WideName = Arguments.substr(0, NameEnd);
+			const std::string Name{ WideName.begin(), WideName.end() };
+
+			const EMemoryTag::Type Tag = SMemoryStats::FindTag(Name.c_str());
+			if (Tag == EMemoryTag::Count || NameEnd == std::wstring::npos)
+				FDebug::PrintF("Unknown memory tag %s.\n", Name.c_str());
+			else
+				SMemoryStats::SetBudget(Tag, (uint64_t)std::stoi(Arguments.substr(NameEnd + 1)) * 1024 * 1024);
+		}
+		else if (mCommandBuffer.substr(0, 9) == std::wstring{ L"LogMemory" })
+		{
+			SMemoryStats::Log();
+		}
+		else if (mCommandBuffer.substr(0, 14) == std::wstring{ L"DrawChunkStats" })
+		{
+			mDrawChunkStats = mCommandBuffer.substr(15) == std::wstring{ L"true" };
+		}
+		else if (mChunkManager && mCommandBuffer.substr(0, 13) == std::wstring{ L"LogChunkStats" })
+		{
+			mChunkManager->LogStats();
+		}
+		else if (mCommandBuffer.substr(0, 8) == std::wstring{ L"CookMesh" })
+		{
+			// The asset is written next to the model
+			const std::wstring Model = mCommandBuffer.substr(9);
+			const std::wstring Asset = Model.substr(0, Model.rfind(L'.')) + L".cmesh";
+			const std::string ModelFilepath{ Model.begin(), Model.end() };
+
+			if (!SMeshAsset::Cook(ModelFilepath.c_str(), Asset.c_str()))
+				FDebug::PrintF("Failed to cook %s.\n", ModelFilepath.c_str());
+		}
+		else if (mCommandBuffer.substr(0, 17) == std::wstring{ L"CaptureCPUProfile" })
+		{
+			CPUProfiler::StartCapture((uint32_t)std::stoi(mCommandBuffer.substr(18)));
+		}
+		else if (mCommandBuffer.substr(0, 14) == std::wstring{ L"StopCPUProfile" })
+		{
+			CPUProfiler::StopCapture();
+		}
+		else if (mCommandBuffer.substr(0, 16) == std::wstring{ L"ExportCPUProfile" })
+		{
+			if (!CPUProfiler::Export(mCommandBuffer.substr(17).c_str()))
+				FDebug::PrintF("Failed to export the CPU profile.\n");
+		}
+		else if (mCommandBuffer.substr(0, 13) == std::wstring{ L"ListVariables" })
+		{
+			ConsoleVariables::List();
+		}
+		else
+		{
+			// Anything else may name a console variable, with a value to set it to
+			const std::string Command{ mCommandBuffer.begin(), mCommandBuffer.end() };
+			if (!ConsoleVariables::Execute(Command))
+				FDebug::PrintF("Unknown command %s.\n", Command.c_str());
+		}
 	}
 
 	void GameConsole::SetPhysicsSystem(FPhysicsSystem* Physics)
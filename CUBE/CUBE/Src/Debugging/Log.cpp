@@ -0,0 +1,270 @@
+#include "Debugging\Log.h"
+#include "Clock.h"
+#include "Common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include "Windows.h"
+#endif
+
+namespace
+{
+	struct Entry
+	{
+		uint8_t Severity;
+		uint8_t Category;
+		uint8_t Length; // Chars of Text used
+		uint8_t IsLast; // If the message ends with this entry
+		char    Text[FDebug::Log::ENTRY_CHARS];
+	};
+
+	/**
+	* The ring of one thread. Head is only written by its thread, Tail only
+	* by the writer, so neither waits on the other.
+	*/
+	struct ThreadBuffer
+	{
+		Entry                 Entries[FDebug::Log::ENTRIES_PER_THREAD];
+		std::atomic<uint32_t> Head;    // Entries written
+		std::atomic<uint32_t> Tail;    // Entries printed
+		std::atomic<uint32_t> Dropped; // Messages rate limited or without room since last printed
+
+		// Only used by the buffer's thread
+		uint64_t WindowBegin[ELogCategory::Count]; // When each category's second of messages began
+		uint32_t WindowCount[ELogCategory::Count];
+		char     Message[FDebug::Log::MAX_MESSAGE_CHARS];
+	};
+
+	const char* SEVERITY_PREFIXES[ELogSeverity::Count] = { "", "", "Warning: ", "Error: " };
+	const char* CATEGORY_NAMES[ELogCategory::Count] = { "General", "Audio", "Rendering", "Chunks", "Physics", "FileIO" };
+
+	std::mutex                                 RegistryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+	THREAD_LOCAL ThreadBuffer*                 CurrentBuffer = nullptr;
+
+	std::mutex              PrintMutex; // Held while emptying the buffers, so messages are printed in order
+	std::string             PrintText;
+	std::mutex              WriterMutex;
+	std::condition_variable WriterCondition;
+	std::thread             Writer;
+	std::atomic<bool>       IsWriterRunning(false);
+	bool                    MustStopWriter = false;
+
+	/**
+	* The buffer of the calling thread, added the first time it's needed.
+	*/
+	ThreadBuffer& GetThreadBuffer()
+	{
+		if (!CurrentBuffer)
+		{
+			std::lock_guard<std::mutex> Lock(RegistryMutex);
+			Buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer));
+
+			CurrentBuffer = Buffers.back().get();
+			CurrentBuffer->Head = 0;
+			CurrentBuffer->Tail = 0;
+			CurrentBuffer->Dropped = 0;
+			for (uint32_t i = 0; i < ELogCategory::Count; i++)
+			{
+				CurrentBuffer->WindowBegin[i] = 0;
+				CurrentBuffer->WindowCount[i] = 0;
+			}
+		}
+
+		return *CurrentBuffer;
+	}
+
+	/**
+	* Prints the messages of every buffer with one write to each output.
+	*/
+	void PrintBuffers()
+	{
+		std::lock_guard<std::mutex> PrintLock(PrintMutex);
+		PrintText.clear();
+
+		{
+			std::lock_guard<std::mutex> Lock(RegistryMutex);
+			for (auto& Buffer : Buffers)
+			{
+				// Messages are published whole, so the range never ends mid message
+				const uint32_t Head = Buffer->Head.load(std::memory_order_acquire);
+				bool IsFirst = true;
+				for (uint32_t i = Buffer->Tail.load(std::memory_order_relaxed); i != Head; i++)
+				{
+					const Entry& Piece = Buffer->Entries[i % FDebug::Log::ENTRIES_PER_THREAD];
+					if (IsFirst)
+					{
+						if (Piece.Category != ELogCategory::General)
+							PrintText.append(1, '[').append(CATEGORY_NAMES[Piece.Category]).append("] ");
+						PrintText.append(SEVERITY_PREFIXES[Piece.Severity]);
+					}
+
+					PrintText.append(Piece.Text, Piece.Length);
+					if (Piece.IsLast)
+						PrintText.append(1, '\n');
+					IsFirst = Piece.IsLast != 0;
+				}
+				Buffer->Tail.store(Head, std::memory_order_release);
+
+				const uint32_t Dropped = Buffer->Dropped.exchange(0, std::memory_order_relaxed);
+				if (Dropped > 0)
+				{
+					char Line[64];
+					sprintf_s(Line, "[Log] %u messages dropped\n", Dropped);
+					PrintText.append(Line);
+				}
+			}
+		}
+
+		if (PrintText.empty())
+			return;
+
+		fwrite(PrintText.data(), 1, PrintText.size(), stdout);
+		fflush(stdout);
+#ifdef _WIN32
+		OutputDebugStringA(PrintText.c_str());
+#endif
+	}
+
+	void WriterLoop()
+	{
+		std::unique_lock<std::mutex> Lock(WriterMutex);
+		while (!MustStopWriter)
+		{
+			WriterCondition.wait_for(Lock, std::chrono::milliseconds(FDebug::Log::WRITE_INTERVAL_MS));
+
+			Lock.unlock();
+			PrintBuffers();
+			Lock.lock();
+		}
+	}
+}
+
+namespace FDebug
+{
+	std::atomic<uint32_t> Log::MinSeverity(ELogSeverity::Debug);
+	std::atomic<uint32_t> Log::EnabledCategories((1u << ELogCategory::Count) - 1);
+
+	void Log::Start()
+	{
+		if (IsWriterRunning)
+			return;
+
+		MustStopWriter = false;
+		Writer = std::thread(&WriterLoop);
+		IsWriterRunning = true;
+	}
+
+	void Log::Stop()
+	{
+		if (!IsWriterRunning)
+			return;
+
+		{
+			std::lock_guard<std::mutex> Lock(WriterMutex);
+			MustStopWriter = true;
+		}
+		WriterCondition.notify_all();
+
+		Writer.join();
+		IsWriterRunning = false;
+
+		PrintBuffers();
+	}
+
+	void Log::Flush()
+	{
+		PrintBuffers();
+	}
+
+	int32_t Log::Write(const ELogSeverity::Type Severity, const ELogCategory::Type Category, const char* Format, ...)
+	{
+		va_list ArgList;
+		va_start(ArgList, Format);
+
+		const int32_t CharsWritten = VWrite(Severity, Category, Format, ArgList);
+
+		va_end(ArgList);
+		return CharsWritten;
+	}
+
+	int32_t Log::VWrite(const ELogSeverity::Type Severity, const ELogCategory::Type Category, const char* Format, va_list ArgList)
+	{
+		ThreadBuffer& Buffer = GetThreadBuffer();
+
+		// Checked before formatting, so messages over the limit cost no more than the check
+		const uint64_t Now = FClock::ReadSystemTimer();
+		if (Now - Buffer.WindowBegin[Category] >= FClock::SecondsToCycles(1.0f))
+		{
+			Buffer.WindowBegin[Category] = Now;
+			Buffer.WindowCount[Category] = 0;
+		}
+
+		if (Buffer.WindowCount[Category] >= MESSAGES_PER_SECOND)
+		{
+			Buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+			return 0;
+		}
+		Buffer.WindowCount[Category]++;
+
+		int32_t CharsWritten = vsnprintf_s(Buffer.Message, _TRUNCATE, Format, ArgList);
+		if (CharsWritten < 0)
+			CharsWritten = strlen(Buffer.Message);
+
+		// Messages already ending a line aren't given a second newline
+		uint32_t Length = CharsWritten;
+		if (Length > 0 && Buffer.Message[Length - 1] == '\n')
+			Length--;
+
+		const uint32_t EntryCount = std::max((Length + ENTRY_CHARS - 1) / ENTRY_CHARS, 1u);
+		const uint32_t Head = Buffer.Head.load(std::memory_order_relaxed);
+		if (Head - Buffer.Tail.load(std::memory_order_acquire) + EntryCount > ENTRIES_PER_THREAD)
+		{
+			Buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+			return CharsWritten;
+		}
+
+		for (uint32_t i = 0; i < EntryCount; i++)
+		{
+			Entry& Piece = Buffer.Entries[(Head + i) % ENTRIES_PER_THREAD];
+			const uint32_t Offset = i * ENTRY_CHARS;
+			const uint32_t PieceLength = (Length - Offset < ENTRY_CHARS) ? Length - Offset : ENTRY_CHARS;
+
+			Piece.Severity = (uint8_t)Severity;
+			Piece.Category = (uint8_t)Category;
+			Piece.Length = (uint8_t)PieceLength;
+			Piece.IsLast = (i == EntryCount - 1);
+			memcpy(Piece.Text, Buffer.Message + Offset, PieceLength);
+		}
+		Buffer.Head.store(Head + EntryCount, std::memory_order_release);
+
+		// Without the writer, messages are printed as they are logged
+		if (!IsWriterRunning.load(std::memory_order_relaxed))
+			PrintBuffers();
+
+		return CharsWritten;
+	}
+
+	void Log::SetCategoryEnabled(const ELogCategory::Type Category, const bool IsEnabled)
+	{
+		if (IsEnabled)
+			EnabledCategories.fetch_or(1u << Category, std::memory_order_relaxed);
+		else
+			EnabledCategories.fetch_and(~(1u << Category), std::memory_order_relaxed);
+	}
+
+	const char* Log::GetName(const ELogCategory::Type Category)
+	{
+		return CATEGORY_NAMES[Category];
+	}
+}
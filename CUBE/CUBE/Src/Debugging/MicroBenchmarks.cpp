@@ -0,0 +1,622 @@
+#include "Debugging\MicroBenchmarks.h"
+#include "Debugging\ConsoleOutput.h"
+#include "ChunkSystems\Chunk.h"
+#include "ChunkSystems\ChunkManager.h"
+#include "ChunkSystems\WorldGenerator.h"
+#include "ChunkSystems\ChunkRLE.h"
+#include "FileIO\RegionFile.h"
+#include "FileIO\ChunkCodec.h"
+#include "FileIO\GenericFile.h"
+#include "Math\FMath.h"
+#include "LibNoise\noise.h"
+#include "Clock.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+
+namespace
+{
+	// Least time each kernel runs for on each corpus
+	const float MIN_RUN_SECONDS = 0.25f;
+
+	// World holding the region written by the region kernels, deleted after the run
+	const wchar_t* const REGION_WORLD_NAME = L"MicroBenchmarks";
+
+	// Chunk positions the region kernels cycle through, so writes overwrite chunks already in the file
+	const uint32_t REGION_CHUNKS = 256;
+
+	const FBlockTypes::BlockID SOLID_BLOCK_ID = 1;
+	const FBlockTypes::BlockID STONE_BLOCK_ID = 4;
+
+	/**
+	* A chunk of blocks that every kernel runs on, in the RLE layout of region files.
+	*/
+	struct Corpus
+	{
+		const char*          Name;
+		std::vector<uint8_t> BlockData;
+	};
+
+	/**
+	* Runs a kernel until it has run on MIN_RUN_CHUNKS chunks and for MIN_RUN_SECONDS.
+	* @param Kernel - Runs the kernel on one chunk and returns the cycles it took, excluding its setup.
+	* @return The average seconds the kernel took per chunk.
+	*/
+	double TimeKernel(const std::function<uint64_t(uint32_t)>& Kernel)
+	{
+		const uint64_t MinCycles = FClock::SecondsToCycles(MIN_RUN_SECONDS);
+
+		uint64_t Cycles = 0;
+		uint32_t Chunks = 0;
+		while (Chunks < SMicroBenchmarks::MIN_RUN_CHUNKS || Cycles < MinCycles)
+			Cycles += Kernel(Chunks++);
+
+		return (double)FClock::CyclesToSeconds(Cycles) / Chunks;
+	}
+
+	SMicroBenchmarks::Result MakeResult(const char* Kernel, const char* Corpus, const double SecondsPerChunk, const uint32_t BytesPerChunk)
+	{
+		SMicroBenchmarks::Result Result;
+		Result.Kernel = Kernel;
+		Result.Corpus = Corpus;
+		Result.NanosecondsPerChunk = SecondsPerChunk * 1e9;
+		Result.MegabytesPerSecond = (SecondsPerChunk > 0.0) ? BytesPerChunk / SecondsPerChunk / (1024.0 * 1024.0) : 0.0;
+
+		FDebug::PrintF("%-16s %-12s %12.0f ns/chunk %10.1f MB/s\n", Kernel, Corpus, Result.NanosecondsPerChunk, Result.MegabytesPerSecond);
+		return Result;
+	}
+
+	/**
+	* Encodes the blocks given by a function of their position in the chunk.
+	*/
+	Corpus BuildCorpus(const char* Name, const std::function<FBlockTypes::BlockID(int32_t, int32_t, int32_t)>& BlockAt)
+	{
+		std::vector<FChunk::BlockWrite> Writes;
+		for (int32_t y = 0; y < FChunk::CHUNK_SIZE; y++)
+		{
+			for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+			{
+				for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z++)
+				{
+					const FBlockTypes::BlockID ID = BlockAt(x, y, z);
+					if (ID != FBlock::AIR_BLOCK_ID)
+						Writes.push_back(FChunk::BlockWrite{ FChunk::BlockIndex(x, y, z), ID });
+				}
+			}
+		}
+
+		// Chunks loaded without data are all air
+		std::unique_ptr<FChunk> Chunk{ new FChunk };
+		Chunk->Load(nullptr, 0);
+
+		std::vector<FBlockTypes::BlockID> PreviousIDs(Writes.size());
+		if (!Writes.empty())
+			Chunk->SetBlocks(Writes.data(), Writes.size(), PreviousIDs.data());
+
+		Corpus Result;
+		Result.Name = Name;
+		Result.BlockData.resize(FChunk::MAX_RLE_BYTES);
+
+		FChunk::Version Version;
+		Result.BlockData.resize(Chunk->Serialize(Result.BlockData.data(), Version));
+		Chunk->MarkSaved(Version);
+		Chunk->Unload(nullptr);
+		return Result;
+	}
+
+	/**
+	* Height of the terrain surface in the fixed corpora, crossing the middle of the chunk.
+	*/
+	float SurfaceHeight(const int32_t X, const int32_t Z)
+	{
+		return 16.0f + 6.0f * std::sin(X * 0.3f) * std::cos(Z * 0.2f) + 3.0f * std::sin((X + Z) * 0.7f);
+	}
+
+	std::vector<Corpus> BuildCorpora()
+	{
+		std::vector<Corpus> Corpora;
+		Corpora.push_back(BuildCorpus("AllAir", [](int32_t, int32_t, int32_t)
+		{
+			return FBlock::AIR_BLOCK_ID;
+		}));
+
+		Corpora.push_back(BuildCorpus("AllSolid", [](int32_t, int32_t, int32_t)
+		{
+			return SOLID_BLOCK_ID;
+		}));
+
+		Corpora.push_back(BuildCorpus("Terrain", [](int32_t X, int32_t Y, int32_t Z) -> FBlockTypes::BlockID
+		{
+			const float Height = SurfaceHeight(X, Z);
+			if (Y > Height)
+				return FBlock::AIR_BLOCK_ID;
+
+			return (Y + 4 > Height) ? SOLID_BLOCK_ID : STONE_BLOCK_ID;
+		}));
+
+		// Every block is its own run and every solid face is exposed
+		Corpora.push_back(BuildCorpus("Checkerboard", [](int32_t X, int32_t Y, int32_t Z)
+		{
+			return ((X + Y + Z) & 1) ? SOLID_BLOCK_ID : FBlock::AIR_BLOCK_ID;
+		}));
+
+		// Seeded, so the caves are the same on every run
+		noise::module::Perlin Caves;
+		Caves.SetSeed(1337);
+		Caves.SetFrequency(0.08);
+		Corpora.push_back(BuildCorpus("Caves", [&Caves](int32_t X, int32_t Y, int32_t Z)
+		{
+			return (Caves.GetValue(X, Y, Z) > 0.2) ? FBlock::AIR_BLOCK_ID : STONE_BLOCK_ID;
+		}));
+
+		return Corpora;
+	}
+
+	bool ReportCheck(const char* Check, const bool IsPassed)
+	{
+		FDebug::PrintF("%-28s %s\n", Check, IsPassed ? "passed" : "FAILED");
+		return IsPassed;
+	}
+
+	Vector3i RegionChunkPosition(const uint32_t Chunk)
+	{
+		const int32_t RegionSize = (int32_t)FRegionFile::RegionData::REGION_SIZE;
+		const int32_t Index = (int32_t)(Chunk % REGION_CHUNKS);
+		return Vector3i{ Index % RegionSize, (Index / RegionSize) % RegionSize, Index / (RegionSize * RegionSize) };
+	}
+
+	// Heightmap the generator checks build chunks from, two chunks along x and z
+	const int32_t CHECK_MAP_SIZE = 2 * FChunk::CHUNK_SIZE;
+
+	// Terrain levels of the generator checks, from the highest starting height as the generator keeps them
+	const struct
+	{
+		int32_t              StartingHeight;
+		FBlockTypes::BlockID ID;
+	} CHECK_LEVELS[] = { { FChunk::CHUNK_SIZE, SOLID_BLOCK_ID }, { -FChunk::CHUNK_SIZE / 2, STONE_BLOCK_ID } };
+
+	// Heights map from [-2, 0] to these, so the checked chunks hold the surface, solid ground and open air
+	const int32_t CHECK_MIN_HEIGHT = -FChunk::CHUNK_SIZE;
+	const int32_t CHECK_MAX_HEIGHT = 2 * FChunk::CHUNK_SIZE;
+
+	void SetCheckTerrain(FWorldGenerator& Generator)
+	{
+		Generator.SetMinHeight(CHECK_MIN_HEIGHT);
+		Generator.SetMaxHeight(CHECK_MAX_HEIGHT);
+		for (const auto& Level : CHECK_LEVELS)
+			Generator.AddTerrainLevel(Level.StartingHeight, Level.ID);
+	}
+
+	std::vector<float> BuildCheckHeightMap()
+	{
+		std::vector<float> HeightMap(CHECK_MAP_SIZE * CHECK_MAP_SIZE);
+		for (int32_t x = 0; x < CHECK_MAP_SIZE; x++)
+		{
+			for (int32_t z = 0; z < CHECK_MAP_SIZE; z++)
+				HeightMap[x * CHECK_MAP_SIZE + z] = std::sin(x * 0.13f) * std::cos(z * 0.21f) - 1.0f;
+		}
+
+		return HeightMap;
+	}
+
+	/**
+	* Calls Check for each chunk the generator checks build: two layers of chunks holding the
+	* surface, one below it and one above it.
+	* @param Check - Takes the world position of a chunk and the heights of its first column.
+	*/
+	void ForEachCheckChunk(const std::vector<float>& HeightMap, const std::function<void(const Vector3i&, const float*)>& Check)
+	{
+		for (int32_t y = -1; y <= 2; y++)
+		{
+			for (int32_t x = 0; x < CHECK_MAP_SIZE; x += FChunk::CHUNK_SIZE)
+			{
+				for (int32_t z = 0; z < CHECK_MAP_SIZE; z += FChunk::CHUNK_SIZE)
+					Check(Vector3i{ x, y * FChunk::CHUNK_SIZE, z }, HeightMap.data() + x * CHECK_MAP_SIZE + z);
+			}
+		}
+	}
+
+	/**
+	* Finds the type of a generated block as FWorldGenerator::BuildChunk did before it was
+	* vectorized, mapping its column's height and searching the terrain levels for each block.
+	* @param Heights - The heights of the chunk's first column, in rows of CHECK_MAP_SIZE.
+	*/
+	FBlockTypes::BlockID ReferenceTerrainBlock(const float* Heights, const int32_t X, const int32_t WorldY, const int32_t Z)
+	{
+		const float xzHeight = FMath::MapValue(Heights[X * CHECK_MAP_SIZE + Z] + 1, -1.0f, 1.0f, (float)CHECK_MIN_HEIGHT, (float)CHECK_MAX_HEIGHT);
+		if (xzHeight < WorldY)
+			return FBlock::AIR_BLOCK_ID;
+
+		for (const auto& Level : CHECK_LEVELS)
+		{
+			if (Level.StartingHeight <= WorldY)
+				return Level.ID;
+		}
+
+		return FBlock::AIR_BLOCK_ID;
+	}
+
+	/**
+	* Interpolates a chunk's cave lattice at a block one axis at a time, z, then x, then y,
+	* in the order FWorldGenerator::BuildChunk does, so the results round alike.
+	* @param Lattice - Samples every Spacing blocks, indexed [y][x][z] with Points along each axis.
+	*/
+	float ReferenceCaveNoise(const float* Lattice, const int32_t Points, const int32_t Spacing, const int32_t X, const int32_t Y, const int32_t Z)
+	{
+		auto Lerp = [](const float From, const float To, const float Weight)
+		{
+			return From + (To - From) * Weight;
+		};
+
+		const float WeightX = (float)(X % Spacing) / Spacing;
+		const float WeightZ = (float)(Z % Spacing) * (1.0f / Spacing);
+
+		float Layers[2];
+		for (int32_t i = 0; i < 2; i++)
+		{
+			const float* Near = Lattice + ((Y / Spacing + i) * Points + X / Spacing) * Points + Z / Spacing;
+			const float* Far = Near + Points;
+			Layers[i] = Lerp(Lerp(Near[0], Near[1], WeightZ), Lerp(Far[0], Far[1], WeightZ), WeightX);
+		}
+
+		return Lerp(Layers[0], Layers[1], (float)(Y % Spacing) / Spacing);
+	}
+
+	/**
+	* Encodes the blocks given by a function of their position in the chunk one block at a
+	* time, merging runs of a type across rows as FWorldGenerator::BuildChunk does.
+	*/
+	void EncodeReferenceChunk(const std::function<FBlockTypes::BlockID(int32_t, int32_t, int32_t)>& BlockAt, std::vector<uint8_t>& DataOut)
+	{
+		uint8_t Encoded[1 + FChunkRLE::MAX_LENGTH_BYTES];
+		DataOut.resize(FChunkRLE::HEADER_SIZE);
+		FChunkRLE::WriteHeader(DataOut.data());
+
+		FChunkRLE::Run Pending{ FBlock::AIR_BLOCK_ID, 0 };
+		for (int32_t y = 0; y < FChunk::CHUNK_SIZE; y++)
+		{
+			for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+			{
+				for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z++)
+				{
+					const FBlockTypes::BlockID Type = BlockAt(x, y, z);
+					if (Pending.Length != 0 && Pending.Type != Type)
+					{
+						const uint32_t RunSize = FChunkRLE::WriteRun(Pending.Type, Pending.Length, Encoded);
+						DataOut.insert(DataOut.end(), Encoded, Encoded + RunSize);
+						Pending.Length = 0;
+					}
+
+					Pending.Type = Type;
+					Pending.Length++;
+				}
+			}
+		}
+
+		const uint32_t RunSize = FChunkRLE::WriteRun(Pending.Type, Pending.Length, Encoded);
+		DataOut.insert(DataOut.end(), Encoded, Encoded + RunSize);
+	}
+}
+
+std::vector<SMicroBenchmarks::Result> SMicroBenchmarks::Run(const wchar_t* ResultFilename)
+{
+	std::vector<Result> Results;
+	const std::vector<Corpus> Corpora = BuildCorpora();
+
+	// Outlives the kernels, every chunk it holds is freed before the next kernel
+	std::unique_ptr<FChunk> Chunk{ new FChunk };
+	std::vector<uint8_t> Scratch(FChunk::MAX_RLE_BYTES);
+
+	// Faces on the border of the chunk are all exposed and unlit
+	std::unique_ptr<FChunk::NeighborBorders> Neighbors{ new FChunk::NeighborBorders };
+	memset(Neighbors.get(), 0, sizeof(FChunk::NeighborBorders));
+	std::vector<uint8_t> Light(FChunk::BLOCKS_PER_CHUNK, 0);
+
+	FRegionFile Region;
+	Region.Load(REGION_WORLD_NAME, Vector3i{});
+
+	for (const Corpus& Blocks : Corpora)
+	{
+		const uint32_t DataSize = Blocks.BlockData.size();
+		const uint32_t BlockBytes = FChunk::BLOCKS_PER_CHUNK * sizeof(FBlock);
+
+		Results.push_back(MakeResult("RLEDecode", Blocks.Name, TimeKernel([&](uint32_t)
+		{
+			const uint64_t Begin = FClock::ReadSystemTimer();
+			Chunk->Load(Blocks.BlockData.data(), DataSize);
+			const uint64_t End = FClock::ReadSystemTimer();
+
+			Chunk->Unload(Scratch.data());
+			return End - Begin;
+		}), BlockBytes));
+
+		Chunk->Load(Blocks.BlockData.data(), DataSize);
+
+		Results.push_back(MakeResult("RLEEncode", Blocks.Name, TimeKernel([&](uint32_t)
+		{
+			FChunk::Version Version;
+			const uint64_t Begin = FClock::ReadSystemTimer();
+			Chunk->Serialize(Scratch.data(), Version);
+			return FClock::ReadSystemTimer() - Begin;
+		}), BlockBytes));
+
+		// Every section is rebuilt each time, as for a newly loaded chunk
+		Results.push_back(MakeResult("GreedyMesh", Blocks.Name, TimeKernel([&](uint32_t)
+		{
+			const uint64_t Begin = FClock::ReadSystemTimer();
+			Chunk->RebuildMesh(Vector3f{}, *Neighbors, Light.data(), FChunk::ALL_SECTIONS, 0, nullptr);
+			return FClock::ReadSystemTimer() - Begin;
+		}), BlockBytes));
+
+		Chunk->Unload(Scratch.data());
+
+		// Data that doesn't compress below its RLE size is stored raw, as the generator does
+		std::vector<uint8_t> Compressed(DataSize);
+		const uint32_t CompressedSize = (DataSize > 1) ? FChunkCodec::Compress(Blocks.BlockData.data(), DataSize, Compressed.data(), DataSize - 1) : 0;
+		if (CompressedSize != 0)
+		{
+			Results.push_back(MakeResult("LZCompress", Blocks.Name, TimeKernel([&](uint32_t)
+			{
+				const uint64_t Begin = FClock::ReadSystemTimer();
+				FChunkCodec::Compress(Blocks.BlockData.data(), DataSize, Compressed.data(), DataSize - 1);
+				return FClock::ReadSystemTimer() - Begin;
+			}), DataSize));
+
+			Results.push_back(MakeResult("LZDecompress", Blocks.Name, TimeKernel([&](uint32_t)
+			{
+				const uint64_t Begin = FClock::ReadSystemTimer();
+				FChunkCodec::Decompress(Compressed.data(), CompressedSize, Scratch.data(), Scratch.size());
+				return FClock::ReadSystemTimer() - Begin;
+			}), DataSize));
+		}
+
+		// Fills the chunks first, so writes fit the sectors they already hold
+		for (uint32_t i = 0; i < REGION_CHUNKS; i++)
+			Region.WriteChunkData(RegionChunkPosition(i), Blocks.BlockData.data(), DataSize);
+
+		Results.push_back(MakeResult("RegionWrite", Blocks.Name, TimeKernel([&](uint32_t Index)
+		{
+			const uint64_t Begin = FClock::ReadSystemTimer();
+			Region.WriteChunkData(RegionChunkPosition(Index), Blocks.BlockData.data(), DataSize);
+			return FClock::ReadSystemTimer() - Begin;
+		}), DataSize));
+
+		Results.push_back(MakeResult("RegionRead", Blocks.Name, TimeKernel([&](uint32_t Index)
+		{
+			const uint64_t Begin = FClock::ReadSystemTimer();
+			uint32_t Size, SectorOffset;
+			uint8_t Codec;
+			Region.GetChunkDataInfo(RegionChunkPosition(Index), Size, SectorOffset, Codec);
+			Region.GetChunkData(SectorOffset, Scratch.data(), Size);
+			return FClock::ReadSystemTimer() - Begin;
+		}), DataSize));
+
+		// Every pass over the chunks alternates between the data and data a sector larger,
+		// so every write outgrows or shrinks below the sectors of the chunk
+		std::vector<uint8_t> Grown(DataSize + FRegionFile::RegionData::SECTOR_SIZE, 0);
+		memcpy(Grown.data(), Blocks.BlockData.data(), DataSize);
+
+		Results.push_back(MakeResult("RegionRelocate", Blocks.Name, TimeKernel([&](uint32_t Index)
+		{
+			const bool IsGrown = ((Index / REGION_CHUNKS) % 2) == 0;
+			const uint64_t Begin = FClock::ReadSystemTimer();
+			if (IsGrown)
+				Region.WriteChunkData(RegionChunkPosition(Index), Grown.data(), Grown.size());
+			else
+				Region.WriteChunkData(RegionChunkPosition(Index), Blocks.BlockData.data(), DataSize);
+			return FClock::ReadSystemTimer() - Begin;
+		}), DataSize));
+	}
+
+	Region.Close();
+	std::wstring WorldDirectory{ L"./Worlds/" };
+	WorldDirectory += REGION_WORLD_NAME;
+	IFileSystem::GetInstance().DeleteDirectory(WorldDirectory.c_str());
+
+	TimeGenerator(Results);
+
+	if (ResultFilename)
+	{
+		char Line[256];
+		std::string Json = "{\n";
+		for (uint32_t i = 0; i < Results.size(); i++)
+		{
+			sprintf_s(Line, "\t\"%s_%s_ns_per_chunk\":%.0f,\n\t\"%s_%s_mb_per_second\":%.1f%s\n",
+				Results[i].Kernel.c_str(), Results[i].Corpus.c_str(), Results[i].NanosecondsPerChunk,
+				Results[i].Kernel.c_str(), Results[i].Corpus.c_str(), Results[i].MegabytesPerSecond, (i + 1 < Results.size()) ? "," : "");
+			Json += Line;
+		}
+		Json += "}\n";
+
+		IFileSystem& FileSystem = IFileSystem::GetInstance();
+		if (FileSystem.FileExists(ResultFilename))
+			FileSystem.DeleteFilename(ResultFilename);
+
+		auto File = FileSystem.OpenWritable(ResultFilename, false, true);
+		if (!File || !File->Write((const uint8_t*)Json.data(), Json.size()))
+			FDebug::PrintF("Failed to write microbenchmark results to %S\n", ResultFilename);
+	}
+
+	return Results;
+}
+
+void SMicroBenchmarks::TimeGenerator(std::vector<Result>& ResultsOut)
+{
+	// Heights map from [-2, 0] to [MinHeight, MaxHeight], so the lowest is below the chunk at the origin and the highest is its top
+	FWorldGenerator Generator;
+	Generator.SetMinHeight(-1);
+	Generator.SetMaxHeight(FChunk::CHUNK_SIZE - 1);
+	Generator.AddTerrainLevel(0, STONE_BLOCK_ID);
+	Generator.AddTerrainLevel(FChunk::CHUNK_SIZE / 2, SOLID_BLOCK_ID);
+
+	struct HeightMap
+	{
+		const char* Name;
+		float       Heights[FChunk::CHUNK_SIZE * FChunk::CHUNK_SIZE];
+	};
+
+	std::unique_ptr<HeightMap[]> HeightMaps{ new HeightMap[3] };
+	HeightMaps[0].Name = "AllAir";
+	HeightMaps[1].Name = "AllSolid";
+	HeightMaps[2].Name = "Terrain";
+	for (int32_t x = 0; x < FChunk::CHUNK_SIZE; x++)
+	{
+		for (int32_t z = 0; z < FChunk::CHUNK_SIZE; z++)
+		{
+			const int32_t Index = x * FChunk::CHUNK_SIZE + z;
+			HeightMaps[0].Heights[Index] = -2.0f;
+			HeightMaps[1].Heights[Index] = 0.0f;
+			HeightMaps[2].Heights[Index] = (SurfaceHeight(x, z) + 1.0f) / FChunk::CHUNK_SIZE * 2.0f - 2.0f;
+		}
+	}
+
+	std::vector<uint8_t> DataOut;
+	DataOut.reserve(FChunk::MAX_RLE_BYTES);
+
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		uint32_t DataSize = 0;
+		const double SecondsPerChunk = TimeKernel([&](uint32_t)
+		{
+			DataOut.clear();
+			const uint64_t Begin = FClock::ReadSystemTimer();
+			DataSize = Generator.BuildChunk(Vector3i{}, HeightMaps[i].Heights, FChunk::CHUNK_SIZE, DataOut);
+			return FClock::ReadSystemTimer() - Begin;
+		});
+
+		ResultsOut.push_back(MakeResult("BuildChunk", HeightMaps[i].Name, SecondsPerChunk, DataSize));
+	}
+}
+
+bool SMicroBenchmarks::Verify()
+{
+	bool IsPassed = true;
+	IsPassed &= VerifyBlockChanges();
+	IsPassed &= VerifyGenerator();
+	IsPassed &= VerifyCaves();
+	return IsPassed;
+}
+
+bool SMicroBenchmarks::VerifyBlockChanges()
+{
+	// The chunk at the origin, so its local positions are world positions
+	std::unique_ptr<FChunk> Chunk{ new FChunk };
+	Chunk->Load(nullptr, 0);
+
+	const Vector3i Overwritten{ 1, 2, 3 };
+	const Vector3i Cleared{ 4, 5, 6 };
+	const Vector3i Restored{ 7, 8, 9 };
+
+	// Set before buffering, as if dispatched a frame earlier
+	Chunk->SetBlock(Overwritten, STONE_BLOCK_ID);
+	Chunk->SetBlock(Cleared, SOLID_BLOCK_ID);
+
+	std::vector<FChunkManager::BlockChange> Changes;
+	auto SetBlock = [&](const Vector3i& Position, const FBlockTypes::BlockID ID)
+	{
+		Changes.push_back(FChunkManager::BlockChange{ Position, Chunk->SetBlock(Position, ID), ID });
+	};
+
+	SetBlock(Overwritten, SOLID_BLOCK_ID);
+	SetBlock(Restored, STONE_BLOCK_ID);
+	SetBlock(Cleared, FBlock::AIR_BLOCK_ID);
+	SetBlock(Restored, FBlock::AIR_BLOCK_ID);
+
+	std::vector<uint8_t> Scratch(FChunk::MAX_RLE_BYTES);
+	Chunk->Unload(Scratch.data());
+
+	FChunkManager::CoalesceBlockChanges(Changes);
+
+	// Sorted by position, the block set back to air is dropped
+	const bool IsPassed = (Changes.size() == 2)
+		&& (Changes[0].Position == Overwritten) && (Changes[0].PreviousID == STONE_BLOCK_ID) && (Changes[0].ID == SOLID_BLOCK_ID)
+		&& (Changes[1].Position == Cleared) && (Changes[1].PreviousID == SOLID_BLOCK_ID) && (Changes[1].ID == FBlock::AIR_BLOCK_ID);
+
+	return ReportCheck("CoalesceBlockChanges", IsPassed);
+}
+
+bool SMicroBenchmarks::VerifyGenerator()
+{
+	FWorldGenerator Generator;
+	SetCheckTerrain(Generator);
+	const std::vector<float> HeightMap = BuildCheckHeightMap();
+
+	bool IsPassed = true;
+	std::vector<uint8_t> Built;
+	std::vector<uint8_t> Reference;
+	ForEachCheckChunk(HeightMap, [&](const Vector3i& WorldPosition, const float* Heights)
+	{
+		Built.clear();
+		Generator.BuildChunk(WorldPosition, Heights, CHECK_MAP_SIZE, Built);
+
+		EncodeReferenceChunk([&](int32_t X, int32_t Y, int32_t Z)
+		{
+			return ReferenceTerrainBlock(Heights, X, WorldPosition.y + Y, Z);
+		}, Reference);
+
+		IsPassed &= (Built == Reference);
+	});
+
+	return ReportCheck("BuildChunk", IsPassed);
+}
+
+bool SMicroBenchmarks::VerifyCaves()
+{
+	// Seeded, and off the integer frequencies Perlin noise is 0 at on whole blocks
+	noise::module::Perlin CaveNoise;
+	CaveNoise.SetSeed(1337);
+	CaveNoise.SetFrequency(0.05);
+	const float Threshold = 0.1f;
+
+	FWorldGenerator Generator;
+	SetCheckTerrain(Generator);
+	const std::vector<float> HeightMap = BuildCheckHeightMap();
+
+	bool IsPassed = true;
+	std::vector<uint8_t> Built;
+	std::vector<uint8_t> Reference;
+	std::vector<float> Lattice;
+
+	const int32_t Spacings[] = { 4, 8 };
+	for (const int32_t Spacing : Spacings)
+	{
+		Generator.SetCaves(CaveNoise, Threshold, Spacing);
+		const int32_t Points = FChunk::CHUNK_SIZE / Spacing + 1;
+
+		ForEachCheckChunk(HeightMap, [&](const Vector3i& WorldPosition, const float* Heights)
+		{
+			Built.clear();
+			Generator.BuildChunk(WorldPosition, Heights, CHECK_MAP_SIZE, Built);
+
+			// The whole lattice at world block coordinates, as the generator samples it
+			Lattice.resize(Points * Points * Points);
+			for (int32_t y = 0; y < Points; y++)
+			{
+				for (int32_t x = 0; x < Points; x++)
+				{
+					for (int32_t z = 0; z < Points; z++)
+					{
+						Lattice[(y * Points + x) * Points + z] = (float)CaveNoise.GetValue(WorldPosition.x + x * Spacing,
+							WorldPosition.y + y * Spacing, WorldPosition.z + z * Spacing);
+					}
+				}
+			}
+
+			EncodeReferenceChunk([&](int32_t X, int32_t Y, int32_t Z) -> FBlockTypes::BlockID
+			{
+				const FBlockTypes::BlockID Type = ReferenceTerrainBlock(Heights, X, WorldPosition.y + Y, Z);
+				if (Type != FBlock::AIR_BLOCK_ID && ReferenceCaveNoise(Lattice.data(), Points, Spacing, X, Y, Z) > Threshold)
+					return FBlock::AIR_BLOCK_ID;
+
+				return Type;
+			}, Reference);
+
+			IsPassed &= (Built == Reference);
+		});
+	}
+
+	return ReportCheck("BuildChunk caves", IsPassed);
+}
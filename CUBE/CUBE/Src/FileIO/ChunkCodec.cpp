@@ -0,0 +1,209 @@
+#include "FileIO\ChunkCodec.h"
+
+#include <cstring>
+
+namespace
+{
+	const uint32_t MIN_MATCH = 4;
+	const uint32_t MAX_OFFSET = 65535;
+
+	// The last match must start this many bytes before the end, and the last bytes are always literals
+	const uint32_t MATCH_FIND_LIMIT = 12;
+	const uint32_t LAST_LITERALS = 5;
+
+	const uint32_t HASH_BITS = 12;
+	const uint32_t RUN_MASK = 15;
+
+	uint32_t Read32(const uint8_t* Data)
+	{
+		uint32_t Value;
+		memcpy(&Value, Data, 4);
+		return Value;
+	}
+
+	uint32_t Hash(const uint32_t Sequence)
+	{
+		return (Sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	/**
+	* Writes the 255 continuation bytes of a length that overflowed its token nibble.
+	* @return False if the length doesn't fit in the output.
+	*/
+	bool WriteLength(uint32_t Length, uint8_t*& Out, const uint8_t* OutEnd)
+	{
+		while (Length >= 255)
+		{
+			if (Out >= OutEnd)
+				return false;
+
+			*Out++ = 255;
+			Length -= 255;
+		}
+
+		if (Out >= OutEnd)
+			return false;
+
+		*Out++ = (uint8_t)Length;
+		return true;
+	}
+
+	/**
+	* Reads the continuation bytes of a length from a token nibble.
+	* @return False if the data ended before the length.
+	*/
+	bool ReadLength(uint32_t& Length, const uint8_t*& In, const uint8_t* InEnd)
+	{
+		uint8_t Byte;
+		do
+		{
+			if (In >= InEnd)
+				return false;
+
+			Byte = *In++;
+			Length += Byte;
+		} while (Byte == 255);
+
+		return true;
+	}
+
+	/**
+	* Writes a sequence of literals followed by an optional match.
+	* @return False if the sequence doesn't fit in the output.
+	*/
+	bool WriteSequence(const uint8_t* Literals, const uint32_t LiteralCount, const uint32_t Offset, const uint32_t MatchLength, uint8_t*& Out, const uint8_t* OutEnd)
+	{
+		if (Out >= OutEnd)
+			return false;
+
+		uint8_t* Token = Out++;
+		*Token = (uint8_t)((LiteralCount < RUN_MASK ? LiteralCount : RUN_MASK) << 4);
+
+		if (LiteralCount >= RUN_MASK && !WriteLength(LiteralCount - RUN_MASK, Out, OutEnd))
+			return false;
+
+		if ((uint32_t)(OutEnd - Out) < LiteralCount)
+			return false;
+
+		memcpy(Out, Literals, LiteralCount);
+		Out += LiteralCount;
+
+		// The last sequence has no match
+		if (MatchLength == 0)
+			return true;
+
+		if (OutEnd - Out < 2)
+			return false;
+
+		*Out++ = (uint8_t)Offset;
+		*Out++ = (uint8_t)(Offset >> 8);
+
+		const uint32_t MatchCount = MatchLength - MIN_MATCH;
+		*Token |= (uint8_t)(MatchCount < RUN_MASK ? MatchCount : RUN_MASK);
+
+		if (MatchCount >= RUN_MASK && !WriteLength(MatchCount - RUN_MASK, Out, OutEnd))
+			return false;
+
+		return true;
+	}
+}
+
+uint32_t FChunkCodec::Compress(const uint8_t* Data, const uint32_t DataSize, uint8_t* DataOut, const uint32_t Capacity)
+{
+	uint8_t* Out = DataOut;
+	const uint8_t* OutEnd = DataOut + Capacity;
+	uint32_t Anchor = 0;
+
+	if (DataSize > MATCH_FIND_LIMIT)
+	{
+		// Positions are stored plus one so 0 marks an empty slot
+		uint32_t HashTable[1 << HASH_BITS];
+		memset(HashTable, 0, sizeof(HashTable));
+
+		const uint32_t MatchFindEnd = DataSize - MATCH_FIND_LIMIT;
+		const uint32_t MatchEnd = DataSize - LAST_LITERALS;
+
+		uint32_t Position = 0;
+		while (Position < MatchFindEnd)
+		{
+			const uint32_t Sequence = Read32(Data + Position);
+			const uint32_t HashIndex = Hash(Sequence);
+			const uint32_t Candidate = HashTable[HashIndex];
+			HashTable[HashIndex] = Position + 1;
+
+			if (Candidate == 0 || Position - (Candidate - 1) > MAX_OFFSET || Read32(Data + Candidate - 1) != Sequence)
+			{
+				Position++;
+				continue;
+			}
+
+			const uint32_t MatchStart = Candidate - 1;
+			uint32_t MatchLength = MIN_MATCH;
+			while (Position + MatchLength < MatchEnd && Data[MatchStart + MatchLength] == Data[Position + MatchLength])
+				MatchLength++;
+
+			if (!WriteSequence(Data + Anchor, Position - Anchor, Position - MatchStart, MatchLength, Out, OutEnd))
+				return 0;
+
+			Position += MatchLength;
+			Anchor = Position;
+		}
+	}
+
+	if (!WriteSequence(Data + Anchor, DataSize - Anchor, 0, 0, Out, OutEnd))
+		return 0;
+
+	return Out - DataOut;
+}
+
+uint32_t FChunkCodec::Decompress(const uint8_t* Data, const uint32_t DataSize, uint8_t* DataOut, const uint32_t Capacity)
+{
+	const uint8_t* In = Data;
+	const uint8_t* InEnd = Data + DataSize;
+	uint8_t* Out = DataOut;
+	const uint8_t* OutEnd = DataOut + Capacity;
+
+	while (In < InEnd)
+	{
+		const uint8_t Token = *In++;
+
+		uint32_t LiteralCount = Token >> 4;
+		if (LiteralCount == RUN_MASK && !ReadLength(LiteralCount, In, InEnd))
+			return 0;
+
+		if ((uint32_t)(InEnd - In) < LiteralCount || (uint32_t)(OutEnd - Out) < LiteralCount)
+			return 0;
+
+		memcpy(Out, In, LiteralCount);
+		In += LiteralCount;
+		Out += LiteralCount;
+
+		// The last sequence ends after its literals
+		if (In == InEnd)
+			break;
+
+		if (InEnd - In < 2)
+			return 0;
+
+		const uint32_t Offset = In[0] | (In[1] << 8);
+		In += 2;
+
+		uint32_t MatchLength = Token & RUN_MASK;
+		if (MatchLength == RUN_MASK && !ReadLength(MatchLength, In, InEnd))
+			return 0;
+
+		MatchLength += MIN_MATCH;
+
+		if (Offset == 0 || Offset > (uint32_t)(Out - DataOut) || (uint32_t)(OutEnd - Out) < MatchLength)
+			return 0;
+
+		// Matches can overlap their own output, so copy forward a byte at a time
+		const uint8_t* Match = Out - Offset;
+		for (uint32_t i = 0; i < MatchLength; i++)
+			Out[i] = Match[i];
+
+		Out += MatchLength;
+	}
+
+	return Out - DataOut;
+}
@@ -0,0 +1,112 @@
+#include "FileIO\ChunkIOQueue.h"
+#include "Misc\Assertions.h"
+
+FChunkIOQueue::FChunkIOQueue()
+	: mIOThread()
+	, mRequests()
+	, mLowPriorityRequests()
+	, mRequestMutex()
+	, mRequestAvailable()
+	, mPendingRequests()
+	, mPendingLowPriority()
+	, mMustStop(false)
+{
+	mPendingRequests = 0;
+	mPendingLowPriority = 0;
+}
+
+FChunkIOQueue::~FChunkIOQueue()
+{
+	Stop();
+}
+
+void FChunkIOQueue::Start()
+{
+	Stop();
+
+	mMustStop = false;
+	mIOThread = std::thread(&FChunkIOQueue::IOThreadLoop, this);
+}
+
+void FChunkIOQueue::Stop()
+{
+	if (!mIOThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> Lock(mRequestMutex);
+		mMustStop = true;
+	}
+	mRequestAvailable.notify_one();
+
+	// The thread drains the queue before exiting
+	mIOThread.join();
+}
+
+void FChunkIOQueue::Submit(Request NewRequest)
+{
+	ASSERT(mIOThread.joinable() && "Submitting a request to an I/O queue that has not been started.");
+
+	{
+		std::lock_guard<std::mutex> Lock(mRequestMutex);
+		mPendingRequests++;
+		mRequests.push_back(std::move(NewRequest));
+	}
+
+	mRequestAvailable.notify_one();
+}
+
+void FChunkIOQueue::SubmitLowPriority(Request NewRequest)
+{
+	ASSERT(mIOThread.joinable() && "Submitting a request to an I/O queue that has not been started.");
+
+	{
+		std::lock_guard<std::mutex> Lock(mRequestMutex);
+		mPendingLowPriority++;
+		mLowPriorityRequests.push_back(std::move(NewRequest));
+	}
+
+	mRequestAvailable.notify_one();
+}
+
+void FChunkIOQueue::ClearLowPriority()
+{
+	std::lock_guard<std::mutex> Lock(mRequestMutex);
+	mLowPriorityRequests.clear();
+	mPendingLowPriority = 0;
+}
+
+void FChunkIOQueue::IOThreadLoop()
+{
+	std::unique_lock<std::mutex> Lock(mRequestMutex);
+
+	while (true)
+	{
+		while (!mMustStop && mRequests.empty() && mLowPriorityRequests.empty())
+		{
+			mRequestAvailable.wait(Lock);
+		}
+
+		// Other requests are drained before stopping, low priority ones are dropped
+		const bool IsLowPriority = mRequests.empty();
+		if (IsLowPriority && mMustStop)
+		{
+			mLowPriorityRequests.clear();
+			mPendingLowPriority = 0;
+			return;
+		}
+
+		std::deque<Request>& Queue = IsLowPriority ? mLowPriorityRequests : mRequests;
+		Request Work = std::move(Queue.front());
+		Queue.pop_front();
+		if (IsLowPriority)
+			mPendingLowPriority--;
+		Lock.unlock();
+
+		Work();
+
+		Lock.lock();
+		if (!IsLowPriority)
+			mPendingRequests--;
+	}
+}
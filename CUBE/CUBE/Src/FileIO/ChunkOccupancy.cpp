@@ -0,0 +1,103 @@
+#include "FileIO\ChunkOccupancy.h"
+#include "FileIO\RegionFile.h"
+#include "ChunkSystems\Block.h"
+#include "ChunkSystems\ChunkRLE.h"
+
+namespace
+{
+	const uint32_t ENTRIES_PER_REGION = FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE * FRegionFile::RegionData::REGION_SIZE;
+
+	/**
+	* Leads each region's table on file.
+	*/
+	struct TableHeader
+	{
+		int32_t X;
+		int32_t Y;
+		int32_t Z;
+	};
+}
+
+FChunkOccupancy::FChunkOccupancy()
+	: mRegions()
+{
+}
+
+FChunkOccupancy::Entry FChunkOccupancy::Summarize(const uint8_t* BlockData, const uint32_t DataSize)
+{
+	uint8_t Type;
+	if (!FChunkRLE::IsUniform(BlockData, DataSize, Type))
+		return Entry{ Entry::Mixed, 0 };
+
+	return Entry{ Entry::Uniform, Type };
+}
+
+FChunkOccupancy::Entry FChunkOccupancy::Find(const Vector3i& ChunkPosition) const
+{
+	auto Region = mRegions.find(FRegionFile::ChunkToRegionPosition(ChunkPosition));
+	if (Region == mRegions.end())
+		return Entry{ Entry::Unknown, 0 };
+
+	return Region->second[EntryIndex(ChunkPosition)];
+}
+
+void FChunkOccupancy::Set(const Vector3i& ChunkPosition, const Entry& Occupancy)
+{
+	std::vector<Entry>& Table = mRegions[FRegionFile::ChunkToRegionPosition(ChunkPosition)];
+	if (Table.empty())
+		Table.resize(ENTRIES_PER_REGION, Entry{ Entry::Unknown, 0 });
+
+	Table[EntryIndex(ChunkPosition)] = Occupancy;
+}
+
+void FChunkOccupancy::Clear()
+{
+	mRegions.clear();
+}
+
+bool FChunkOccupancy::Read(IFileHandle& File)
+{
+	mRegions.clear();
+
+	uint32_t RegionCount = 0;
+	if (!File.Read((uint8_t*)&RegionCount, sizeof(RegionCount)))
+		return true;
+
+	for (uint32_t i = 0; i < RegionCount; i++)
+	{
+		TableHeader Header;
+		std::vector<Entry> Table(ENTRIES_PER_REGION);
+
+		if (!File.Read((uint8_t*)&Header, sizeof(Header)) || !File.Read((uint8_t*)Table.data(), ENTRIES_PER_REGION * sizeof(Entry)))
+		{
+			mRegions.clear();
+			return false;
+		}
+
+		mRegions[Vector3i{ Header.X, Header.Y, Header.Z }].swap(Table);
+	}
+
+	return true;
+}
+
+bool FChunkOccupancy::Write(IFileHandle& File) const
+{
+	const uint32_t RegionCount = (uint32_t)mRegions.size();
+	bool Written = File.Write((const uint8_t*)&RegionCount, sizeof(RegionCount));
+
+	for (const auto& Region : mRegions)
+	{
+		const TableHeader Header{ Region.first.x, Region.first.y, Region.first.z };
+		Written = Written && File.Write((const uint8_t*)&Header, sizeof(Header));
+		Written = Written && File.Write((const uint8_t*)Region.second.data(), ENTRIES_PER_REGION * sizeof(Entry));
+	}
+
+	return Written;
+}
+
+uint32_t FChunkOccupancy::EntryIndex(const Vector3i& ChunkPosition)
+{
+	const Vector3i Local = FRegionFile::LocalRegionPosition(ChunkPosition);
+	const int32_t RegionSize = (int32_t)FRegionFile::RegionData::REGION_SIZE;
+	return (Local.y * RegionSize + Local.x) * RegionSize + Local.z;
+}
@@ -0,0 +1,82 @@
+#include "FileIO\ChunkPayloadCache.h"
+
+FChunkPayloadCache::FChunkPayloadCache()
+	: mEntries()
+	, mUseOrder()
+	, mDirtyCount(0)
+	, mBytes(EMemoryTag::ChunkCache)
+{
+
+}
+
+const FChunkPayloadCache::Entry* FChunkPayloadCache::Find(const Vector3i& ChunkPosition)
+{
+	auto Found = mEntries.find(ChunkPosition);
+	if (Found == mEntries.end())
+		return nullptr;
+
+	mUseOrder.splice(mUseOrder.begin(), mUseOrder, Found->second.Use);
+	return &Found->second.Value;
+}
+
+void FChunkPayloadCache::Insert(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec, const bool IsDirty)
+{
+	auto Found = mEntries.find(ChunkPosition);
+	if (Found == mEntries.end())
+	{
+		mUseOrder.push_front(ChunkPosition);
+		Found = mEntries.emplace(ChunkPosition, Record{ Entry{ {}, Codec, false }, mUseOrder.begin() }).first;
+	}
+	else
+	{
+		mUseOrder.splice(mUseOrder.begin(), mUseOrder, Found->second.Use);
+	}
+
+	Entry& Value = Found->second.Value;
+	const uint64_t OldBytes = (Value.Data.empty() && !Value.IsDirty) ? 0 : EntryBytes(Value);
+
+	if (IsDirty && !Value.IsDirty)
+		mDirtyCount++;
+
+	Value.Data.assign(Data, Data + DataSize);
+	Value.Codec = Codec;
+	Value.IsDirty = Value.IsDirty || IsDirty;
+
+	mBytes.Set(mBytes.Get() - OldBytes + EntryBytes(Value));
+}
+
+bool FChunkPayloadCache::IsOverBudget() const
+{
+	return !mEntries.empty() && mBytes.Get() > SMemoryStats::GetBudget(EMemoryTag::ChunkCache);
+}
+
+bool FChunkPayloadCache::TakeLeastRecent(Vector3i& PositionOut, Entry& EntryOut)
+{
+	if (mUseOrder.empty())
+		return false;
+
+	PositionOut = mUseOrder.back();
+	mUseOrder.pop_back();
+
+	auto Found = mEntries.find(PositionOut);
+	mBytes.Set(mBytes.Get() - EntryBytes(Found->second.Value));
+	if (Found->second.Value.IsDirty)
+		mDirtyCount--;
+
+	EntryOut = std::move(Found->second.Value);
+	mEntries.erase(Found);
+	return true;
+}
+
+void FChunkPayloadCache::Clear()
+{
+	mEntries.clear();
+	mUseOrder.clear();
+	mDirtyCount = 0;
+	mBytes.Set(0);
+}
+
+uint64_t FChunkPayloadCache::EntryBytes(const Entry& Value)
+{
+	return Value.Data.size() + sizeof(Record) + sizeof(Vector3i) + 4 * sizeof(void*);
+}
@@ -0,0 +1,232 @@
+#include "FileIO\EditJournal.h"
+#include "Misc\Assertions.h"
+#include <iostream>
+
+namespace
+{
+	/**
+	* Layout of an edit on file. Writes torn by a crash fail the check
+	* and end the replay.
+	*/
+	struct EditRecord
+	{
+		int32_t  X;
+		int32_t  Y;
+		int32_t  Z;
+		uint8_t  BlockID;
+		uint8_t  Padding;
+		uint16_t Check;
+	};
+
+	uint16_t RecordCheck(const EditRecord& Record)
+	{
+		// Inverted so zero filled records are never valid
+		// Unsigned so the hash multiplies wrap instead of overflowing
+		return (uint16_t)~(((uint32_t)Record.X * 73856093u) ^ ((uint32_t)Record.Y * 19349663u) ^ ((uint32_t)Record.Z * 83492791u) ^ Record.BlockID);
+	}
+
+	bool WriteEdits(IFileHandle& File, const std::vector<FEditJournal::Edit>& Edits)
+	{
+		if (Edits.empty())
+			return true;
+
+		std::vector<EditRecord> Records(Edits.size());
+		for (uint32_t i = 0; i < Edits.size(); i++)
+		{
+			EditRecord& Record = Records[i];
+			Record.X = Edits[i].Position.x;
+			Record.Y = Edits[i].Position.y;
+			Record.Z = Edits[i].Position.z;
+			Record.BlockID = Edits[i].BlockID;
+			Record.Padding = 0;
+			Record.Check = RecordCheck(Record);
+		}
+
+		return File.Write((const uint8_t*)Records.data(), Records.size() * sizeof(EditRecord));
+	}
+
+	/**
+	* Reads the valid edits of a journal segment.
+	*/
+	void ReadEdits(const wchar_t* Filepath, std::vector<FEditJournal::Edit>& EditsOut)
+	{
+		IFileSystem& FileSystem = IFileSystem::GetInstance();
+		if (!FileSystem.FileExists(Filepath))
+			return;
+
+		auto File = FileSystem.OpenReadable(Filepath);
+		if (!File)
+			return;
+
+		// A partly written record at the end is dropped
+		std::vector<EditRecord> Records(File->GetFileSize() / sizeof(EditRecord));
+		if (Records.empty() || !File->Read((uint8_t*)Records.data(), Records.size() * sizeof(EditRecord)))
+			return;
+
+		for (const EditRecord& Record : Records)
+		{
+			if (Record.Check != RecordCheck(Record))
+				return;
+
+			EditsOut.push_back(FEditJournal::Edit{ Vector3i{ Record.X, Record.Y, Record.Z }, Record.BlockID });
+		}
+	}
+}
+
+FEditJournal::FEditJournal()
+	: mFilepath()
+	, mSavingFilepath()
+	, mFile()
+	, mPendingEdits()
+	, mPendingMutex()
+	, mFileMutex()
+	, mIsOpen(false)
+{
+}
+
+FEditJournal::~FEditJournal()
+{
+	Close();
+}
+
+bool FEditJournal::Open(const wchar_t* WorldName, std::vector<Edit>& EditsOut)
+{
+	Close();
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	std::lock_guard<std::mutex> FileLock(mFileMutex);
+
+	mFilepath = L"./Worlds/";
+	mFilepath += WorldName;
+	mFilepath += L"/Edits.vgj";
+	mSavingFilepath = mFilepath + L".old";
+
+	// The old segment is only left by a save that didn't finish
+	ReadEdits(mSavingFilepath.c_str(), EditsOut);
+	ReadEdits(mFilepath.c_str(), EditsOut);
+
+	// Rewrite the edits into a single segment without a torn tail, so appended edits can be replayed
+	const std::wstring NewFilepath = mFilepath + L".new";
+	auto NewFile = FileSystem.OpenWritable(NewFilepath.c_str(), false, true);
+	if (!NewFile || !WriteEdits(*NewFile, EditsOut) || !NewFile->Flush())
+	{
+		std::wcerr << L"Edit journal could not be written for " << WorldName << std::endl;
+		return false;
+	}
+
+	NewFile.reset();
+	FileSystem.ReplaceFilename(NewFilepath.c_str(), mFilepath.c_str());
+
+	if (FileSystem.FileExists(mSavingFilepath.c_str()))
+		FileSystem.DeleteFilename(mSavingFilepath.c_str());
+
+	mFile = FileSystem.OpenWritable(mFilepath.c_str());
+	if (!mFile || !mFile->SeekFromEnd(0))
+	{
+		std::wcerr << L"Edit journal could not be opened for " << WorldName << std::endl;
+		mFile.reset();
+		return false;
+	}
+
+	mIsOpen = true;
+	return true;
+}
+
+void FEditJournal::Close()
+{
+	std::lock_guard<std::mutex> FileLock(mFileMutex);
+
+	CommitPending();
+	mFile.reset();
+	mIsOpen = false;
+}
+
+void FEditJournal::Append(const Vector3i& Position, const uint8_t BlockID)
+{
+	if (!mIsOpen)
+		return;
+
+	std::lock_guard<std::mutex> PendingLock(mPendingMutex);
+	mPendingEdits.push_back(Edit{ Position, BlockID });
+}
+
+void FEditJournal::Append(const std::vector<Edit>& Edits)
+{
+	if (!mIsOpen)
+		return;
+
+	std::lock_guard<std::mutex> PendingLock(mPendingMutex);
+	mPendingEdits.insert(mPendingEdits.end(), Edits.begin(), Edits.end());
+}
+
+bool FEditJournal::HasPendingEdits() const
+{
+	std::lock_guard<std::mutex> PendingLock(mPendingMutex);
+	return !mPendingEdits.empty();
+}
+
+bool FEditJournal::Commit()
+{
+	std::lock_guard<std::mutex> FileLock(mFileMutex);
+	return CommitPending();
+}
+
+bool FEditJournal::CommitPending()
+{
+	// Taking the edits under the file lock keeps commits in append order
+	std::vector<Edit> Edits;
+	{
+		std::lock_guard<std::mutex> PendingLock(mPendingMutex);
+		Edits.swap(mPendingEdits);
+	}
+
+	if (Edits.empty())
+		return true;
+
+	if (!mFile)
+		return false;
+
+	return WriteEdits(*mFile, Edits) && mFile->Flush();
+}
+
+bool FEditJournal::BeginSave(const std::vector<Edit>& RetainedEdits)
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	std::lock_guard<std::mutex> FileLock(mFileMutex);
+
+	// No world is open
+	if (mFilepath.empty())
+		return false;
+
+	ASSERT(!FileSystem.FileExists(mSavingFilepath.c_str()) && "Starting a save before the last one ended.");
+
+	CommitPending();
+	mFile.reset();
+
+	// Replay reads the old segment first, so retained edits stay in order. A journal
+	// that failed to open is retired the same way, so its stale edits aren't replayed
+	// over the save.
+	if (FileSystem.FileExists(mFilepath.c_str()))
+		FileSystem.ReplaceFilename(mFilepath.c_str(), mSavingFilepath.c_str());
+
+	mFile = FileSystem.OpenWritable(mFilepath.c_str(), false, true);
+	if (!mFile || !WriteEdits(*mFile, RetainedEdits) || !mFile->Flush())
+	{
+		std::wcerr << L"Edit journal segment could not be started" << std::endl;
+		mFile.reset();
+		mIsOpen = false;
+		return false;
+	}
+
+	mIsOpen = true;
+	return true;
+}
+
+void FEditJournal::EndSave()
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	std::lock_guard<std::mutex> FileLock(mFileMutex);
+
+	if (FileSystem.FileExists(mSavingFilepath.c_str()))
+		FileSystem.DeleteFilename(mSavingFilepath.c_str());
+}
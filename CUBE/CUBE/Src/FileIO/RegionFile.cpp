@@ -1,167 +1,381 @@
 #include "FileIO/RegionFile.h"
 #include "Misc\Assertions.h"
+#include "Debugging\CPUProfiler.h"
 #include <wchar.h>
+#include <cstring>
+#include <algorithm>
 
-static const uint8_t FilePadding[sizeof(FRegionFile::RegionData)];
+namespace
+{
+	// Fraction of free sectors at which a region is compacted on close
+	const float COMPACTION_THRESHOLD = 0.25f;
+
+	uint32_t SectorsForData(const uint32_t DataSize)
+	{
+		return 1 + ((DataSize + sizeof(FRegionFile::ChunkHeader)) / FRegionFile::RegionData::SECTOR_SIZE);
+	}
+}
 
 FRegionFile::FRegionFile()
 	: mRegionFile()
+	, mUsedSectors()
+	, mFreeSectorCount(0)
+	, mReadOnly(false)
+	, mMappedBytes(EMemoryTag::RegionFiles)
 {
 }
 
 FRegionFile::~FRegionFile()
 {
-	// Write lookup table data back to disk
-	if (mRegionFile)
-	{
-		mRegionFile->SeekFromStart(0);
-		mRegionFile->Write((uint8_t*)&mRegionData, sizeof(RegionData));
-	}
+	Close();
 }
 
-bool FRegionFile::Load(const wchar_t* WorldName, const Vector3i& RegionPosition)
+std::wstring FRegionFile::GetFilepath(const wchar_t* WorldName, const Vector3i& RegionPosition)
 {
-	auto& FileSystem = IFileSystem::GetInstance();
-
 	static const uint32_t DirectoryBufferSize = 300;
 
-	// Enter the file directory for this region
 	std::wstring Filepath{ L"./Worlds/" };
 	Filepath += WorldName;
 
-	FileSystem.CreateFileDirectory(Filepath.c_str());
-
 	wchar_t ProgramDirectory[DirectoryBufferSize];
 	int32_t CharCount = swprintf(ProgramDirectory, DirectoryBufferSize, L"/x%dy%dz%d.vgr", RegionPosition.x, RegionPosition.y, RegionPosition.z);
 	ProgramDirectory[CharCount] = L'\0';
 
 	Filepath += ProgramDirectory;
+	return Filepath;
+}
+
+bool FRegionFile::Load(const wchar_t* WorldName, const Vector3i& RegionPosition, const bool ReadOnly)
+{
+	CPU_PROFILE("RegionLoad");
+
+	auto& FileSystem = IFileSystem::GetInstance();
 
-	if (FileSystem.FileExists(Filepath.c_str()))
+	Close();
+	mReadOnly = ReadOnly;
+
+	// Enter the file directory for this region
+	std::wstring Directory{ L"./Worlds/" };
+	Directory += WorldName;
+
+	FileSystem.CreateFileDirectory(Directory.c_str());
+
+	const std::wstring Filepath = GetFilepath(WorldName, RegionPosition);
+
+	if (ReadOnly)
 	{
-		mRegionFile = FileSystem.OpenReadWritable(Filepath.c_str(), true);
+		// Read only regions are never created, they have nothing to read
+		if (!FileSystem.FileExists(Filepath.c_str()))
+			return false;
+
+		mRegionFile = FileSystem.OpenMapped(Filepath.c_str(), false, true);
+		ASSERT(mRegionFile);
+	}
+	else if (FileSystem.FileExists(Filepath.c_str()))
+	{
+		mRegionFile = FileSystem.OpenMapped(Filepath.c_str());
 		ASSERT(mRegionFile);
 	}
 	else
 	{
 		// If it doesn't exist, create it
-		mRegionFile = FileSystem.OpenReadWritable(Filepath.c_str(), true, true);
+		mRegionFile = FileSystem.OpenMapped(Filepath.c_str(), true);
 		ASSERT(mRegionFile);
-		
-		// Add empty lookup table
-		mRegionFile->Write(FilePadding, sizeof(RegionData));
 	}
 
-	mRegionFile->SeekFromStart(0);
-	return mRegionFile->Read((uint8_t*)&mRegionData, sizeof(RegionData));
+	if (!mRegionFile)
+		return false;
+
+	// Add empty lookup table to new files
+	if (mRegionFile->GetFileSize() < sizeof(RegionData))
+	{
+		if (ReadOnly)
+		{
+			mRegionFile.reset();
+			return false;
+		}
+
+		if (!mRegionFile->Resize(sizeof(RegionData)))
+			return false;
+
+		memset(mRegionFile->GetData(), 0, sizeof(RegionData));
+	}
+
+	BuildSectorMap();
+	mMappedBytes.Set(mRegionFile->GetFileSize());
+	return true;
 }
 
-void FRegionFile::GetChunkDataInfo(const Vector3i& ChunkPosition, uint32_t& SizeOut, uint32_t& SectorOffsetOut)
+void FRegionFile::Flush()
 {
-	uint32_t TableIndex = GetTableIndex(ChunkPosition);
+	CPU_PROFILE("RegionFlush");
+
+	if (mRegionFile && !mReadOnly)
+		mRegionFile->Flush();
+}
+
+void FRegionFile::Close()
+{
+	if (!mRegionFile)
+		return;
+
+	// The lookup table is written in place, so only the mapping needs flushing
+	if (!mReadOnly)
+	{
+		if (mFreeSectorCount > GetSectorCount() * COMPACTION_THRESHOLD)
+			Compact();
+
+		mRegionFile->Flush();
+	}
+
+	mRegionFile.reset();
+	mUsedSectors.clear();
+	mFreeSectorCount = 0;
+	mMappedBytes.Set(0);
+}
+
+void FRegionFile::GetChunkDataInfo(const Vector3i& ChunkPosition, uint32_t& SizeOut, uint32_t& SectorOffsetOut, uint8_t& CodecOut)
+{
+	const LookupEntry& ChunkEntry = GetRegionData().ChunkEntry[GetTableIndex(ChunkPosition)];
 
 	// If number of sectors for the chunk is 0, the chunk is not in the file yet
-	if (mRegionData.ChunkEntry[TableIndex].NumOfSectors <= 0)
+	if (ChunkEntry.NumOfSectors <= 0)
 	{
 		SizeOut = 0;
 		return;
 	}
 
-	SectorOffsetOut = mRegionData.ChunkEntry[TableIndex].Offset;
-	mRegionFile->SeekFromStart(sizeof(RegionData) + SectorOffsetOut * RegionData::SECTOR_SIZE);
-	mRegionFile->Read((uint8_t*)&SizeOut, 4);
+	SectorOffsetOut = ChunkEntry.Offset;
+
+	ChunkHeader Header;
+	memcpy(&Header, GetSector(SectorOffsetOut), sizeof(ChunkHeader));
+	SizeOut = Header.DataSize;
+	CodecOut = Header.Codec;
 }
 
 void FRegionFile::GetChunkData(const uint32_t SectorOffset, uint8_t* DataOut, const uint32_t DataSize)
 {
+	CPU_PROFILE("RegionRead");
+
 	ASSERT(DataSize != 0);
 
-	// Add offset after region data block and offset for chunk data size (4 bytes)
-	mRegionFile->SeekFromStart((sizeof(RegionData) + SectorOffset * RegionData::SECTOR_SIZE) + 4);
-	mRegionFile->Read(DataOut, DataSize);
+	// Chunk data follows its header
+	memcpy(DataOut, GetSector(SectorOffset) + sizeof(ChunkHeader), DataSize);
 }
 
-void FRegionFile::WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize)
+void FRegionFile::GetChunkDataBatch(BatchRead* Reads, const uint32_t Count, const uint32_t Capacity)
 {
+	CPU_PROFILE("RegionBatchRead");
+
+	// Sector offsets of the chunks in the file, with the read each is for
+	std::vector<std::pair<uint32_t, uint32_t>> Order;
+	Order.reserve(Count);
+
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		Reads[i].DataOut->clear();
+
+		const LookupEntry& ChunkEntry = GetRegionData().ChunkEntry[GetTableIndex(Reads[i].ChunkPosition)];
+		if (ChunkEntry.NumOfSectors != 0)
+			Order.emplace_back(ChunkEntry.Offset, i);
+	}
+
+	// Runs of adjacent sectors are copied one after another, as a single sequential read
+	std::sort(Order.begin(), Order.end());
+
+	for (const auto& Sector : Order)
+	{
+		BatchRead& Read = Reads[Sector.second];
+		const uint8_t* Data = GetSector(Sector.first);
+
+		ChunkHeader Header;
+		memcpy(&Header, Data, sizeof(ChunkHeader));
+		Read.Codec = Header.Codec;
+
+		ASSERT(Header.DataSize <= Capacity && "Chunk data is larger than the buffer.");
+		if (Header.DataSize == 0 || Header.DataSize > Capacity)
+			continue;
+
+		Read.DataOut->assign(Data + sizeof(ChunkHeader), Data + sizeof(ChunkHeader) + Header.DataSize);
+	}
+}
+
+void FRegionFile::WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec)
+{
+	CPU_PROFILE("RegionWrite");
+
+	ASSERT(!mReadOnly && "Can't write chunks to a read only region file.");
+
 	uint32_t TableIndex = GetTableIndex(ChunkPosition);
-	LookupEntry& ChunkEntry = mRegionData.ChunkEntry[TableIndex];
+	const LookupEntry OldEntry = GetRegionData().ChunkEntry[TableIndex];
 
+	// If we have enough space with the current amount of sectors.
 	// If number of sectors are 0, the chunk is not in the file yet.
-	if (ChunkEntry.NumOfSectors != 0)
+	if (OldEntry.NumOfSectors != 0 && OldEntry.NumOfSectors * RegionData::SECTOR_SIZE >= DataSize + sizeof(ChunkHeader))
+	{
+		WriteSectors(OldEntry, Data, DataSize, Codec);
+		return;
+	}
+
+	// Release the outgrown sectors first so the chunk can grow into the run following them
+	if (OldEntry.NumOfSectors != 0)
+		FreeSectors(OldEntry.Offset, OldEntry.NumOfSectors);
+
+	const uint32_t NumOfSectors = SectorsForData(DataSize);
+	uint32_t SectorOffset;
+
+	// Allocating can remap the file, so the entry is only referenced after it
+	if (!AllocateSectors(NumOfSectors, SectorOffset))
+	{
+		if (OldEntry.NumOfSectors != 0)
+			GetRegionData().ChunkEntry[TableIndex].NumOfSectors = 0;
+
+		return;
+	}
+
+	LookupEntry& ChunkEntry = GetRegionData().ChunkEntry[TableIndex];
+	ChunkEntry.Offset = SectorOffset;
+	ChunkEntry.NumOfSectors = NumOfSectors;
+
+	WriteSectors(ChunkEntry, Data, DataSize, Codec);
+}
+
+void FRegionFile::Compact()
+{
+	CPU_PROFILE("RegionCompact");
+
+	if (mFreeSectorCount == 0)
+		return;
+
+	RegionData& Region = GetRegionData();
+
+	// Order chunks by where their data is in the file
+	std::vector<uint32_t> UsedEntries;
+	for (uint32_t i = 0; i < sizeof(Region.ChunkEntry) / sizeof(LookupEntry); i++)
+	{
+		if (Region.ChunkEntry[i].NumOfSectors != 0)
+			UsedEntries.push_back(i);
+	}
+
+	std::sort(UsedEntries.begin(), UsedEntries.end(), [&Region](const uint32_t A, const uint32_t B)
+	{
+		return Region.ChunkEntry[A].Offset < Region.ChunkEntry[B].Offset;
+	});
+
+	// Slide every chunk left over the free sectors before it
+	uint32_t NextSector = 0;
+	for (const uint32_t TableIndex : UsedEntries)
+	{
+		LookupEntry& Entry = Region.ChunkEntry[TableIndex];
+
+		if (Entry.Offset != NextSector)
+		{
+			memmove(GetSector(NextSector), GetSector(Entry.Offset), Entry.NumOfSectors * RegionData::SECTOR_SIZE);
+			Entry.Offset = NextSector;
+		}
+
+		NextSector += Entry.NumOfSectors;
+	}
+
+	ResizeSectors(NextSector);
+	BuildSectorMap();
+}
+
+bool FRegionFile::AllocateSectors(const uint32_t NumOfSectors, uint32_t& SectorOffsetOut)
+{
+	const uint32_t SectorCount = mUsedSectors.size();
+
+	// First fit over the free runs
+	uint32_t RunStart = 0;
+	uint32_t RunLength = 0;
+	for (uint32_t i = 0; i < SectorCount && RunLength < NumOfSectors; i++)
 	{
-		// If we have enough space with the current amount of sectors.
-		if (ChunkEntry.NumOfSectors * RegionData::SECTOR_SIZE >= DataSize + 4)
+		if (mUsedSectors[i])
 		{
-			// Add offset after region data block and offset for chunk data size (4 bytes)
-			mRegionFile->SeekFromStart((sizeof(RegionData) + ChunkEntry.Offset * RegionData::SECTOR_SIZE));
-			mRegionFile->Write((uint8_t*)&DataSize, 4);
-			mRegionFile->Write(Data, DataSize);
+			RunStart = i + 1;
+			RunLength = 0;
 		}
 		else
 		{
-			RelocateAndAddChunkData(ChunkEntry, Data, DataSize);
+			RunLength++;
 		}
 	}
+
+	// Append, reusing any free run at the end of the file
+	if (RunLength < NumOfSectors)
+	{
+		if (!ResizeSectors(RunStart + NumOfSectors))
+			return false;
+
+		mFreeSectorCount -= RunLength;
+		mUsedSectors.resize(RunStart + NumOfSectors, false);
+	}
 	else
 	{
-		// Chunk is not in file, add it
-		AddNewChunk(ChunkEntry, Data, DataSize);
+		mFreeSectorCount -= NumOfSectors;
 	}
-}
 
-void FRegionFile::AddNewChunk(LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize)
-{
-	// Determine how many sectors are currently in this region file.
-	uint32_t SectorCount = (mRegionFile->GetFileSize() - sizeof(RegionData)) / RegionData::SECTOR_SIZE;
+	std::fill(mUsedSectors.begin() + RunStart, mUsedSectors.begin() + RunStart + NumOfSectors, true);
 
-	// Set this chunks offset at the end of the file and write the data
-	ChunkEntry.Offset = SectorCount;
-	ChunkEntry.NumOfSectors = 1 + ((DataSize + 4) / RegionData::SECTOR_SIZE); // add 4 bytes for data size
+	SectorOffsetOut = RunStart;
+	return true;
+}
 
-	mRegionFile->SeekFromStart((sizeof(RegionData) + ChunkEntry.Offset * RegionData::SECTOR_SIZE));
-	mRegionFile->Write((uint8_t*)&DataSize, 4); // Write size of data
-	mRegionFile->Write(Data, DataSize); // Write chunk data
+void FRegionFile::FreeSectors(const uint32_t SectorOffset, const uint32_t NumOfSectors)
+{
+	ASSERT(SectorOffset + NumOfSectors <= mUsedSectors.size());
 
-	// Add padding to the rest of the sector
-	mRegionFile->Write(FilePadding, (ChunkEntry.NumOfSectors * RegionData::SECTOR_SIZE) - DataSize - 4);
+	std::fill(mUsedSectors.begin() + SectorOffset, mUsedSectors.begin() + SectorOffset + NumOfSectors, false);
+	mFreeSectorCount += NumOfSectors;
 }
 
-void FRegionFile::RelocateAndAddChunkData(LookupEntry& RelocationEntry, const uint8_t* Data, const uint32_t DataSize)
+void FRegionFile::BuildSectorMap()
 {
-	// Copy all data after this sector, then write it starting at this sector
-	uint32_t RelocationDataStart = sizeof(RegionData) + ((RelocationEntry.Offset + RelocationEntry.NumOfSectors) * RegionData::SECTOR_SIZE);
-	uint32_t RelocationDataSize = mRegionFile->GetFileSize() - RelocationDataStart;
+	const uint32_t SectorCount = GetSectorCount();
 
-	// Get data to shift left
-	std::unique_ptr<uint8_t> RelocationData{ new uint8_t[RelocationDataSize] };
-	mRegionFile->SeekFromStart(RelocationDataStart);
-	mRegionFile->Read(RelocationData.get(), RelocationDataSize);
+	mUsedSectors.assign(SectorCount, false);
+	mFreeSectorCount = SectorCount;
 
-	// Seek to the point where this chunk sector started and shift data to this point
-	mRegionFile->SeekFromStart(RelocationDataStart - (RelocationEntry.NumOfSectors * RegionData::SECTOR_SIZE));
-	mRegionFile->Write(RelocationData.get(), RelocationDataSize);
-
-	// Decrement all offsets in lookup table that were effected
-	for (auto& Entry : mRegionData.ChunkEntry)
+	for (const LookupEntry& Entry : GetRegionData().ChunkEntry)
 	{
-		if (Entry.Offset > RelocationEntry.Offset)
+		if (Entry.NumOfSectors == 0)
+			continue;
+
+		ASSERT(Entry.Offset + Entry.NumOfSectors <= SectorCount && "Chunk sectors are outside of the region file.");
+
+		for (uint32_t i = Entry.Offset; i < Entry.Offset + Entry.NumOfSectors && i < SectorCount; i++)
 		{
-			Entry.Offset -= RelocationEntry.NumOfSectors;
+			if (!mUsedSectors[i])
+			{
+				mUsedSectors[i] = true;
+				mFreeSectorCount--;
+			}
 		}
 	}
+}
 
-	//////////////////////////////////////////////////////////////////
-	// Add this chunk at the end of file, overwritting shifted data
+void FRegionFile::WriteSectors(const LookupEntry& ChunkEntry, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec)
+{
+	ASSERT(DataSize < (1 << 24));
+
+	uint8_t* Sector = GetSector(ChunkEntry.Offset);
 
-	// Determine how many sectors are currently in this region file.
-	uint32_t SectorCount = (mRegionFile->GetFileSize() - sizeof(RegionData)) / RegionData::SECTOR_SIZE;
-	RelocationEntry.Offset = SectorCount - RelocationEntry.NumOfSectors;
-	RelocationEntry.NumOfSectors = 1 + ((DataSize + 4) / RegionData::SECTOR_SIZE); // add 4 bytes for data size
+	ChunkHeader Header;
+	Header.DataSize = DataSize;
+	Header.Codec = Codec;
 
-	// We are already at the end of the old data, so just write from here
-	mRegionFile->Write((uint8_t*)&DataSize, 4); // Write size of data
-	mRegionFile->Write(Data, DataSize); // Write chunk data
+	memcpy(Sector, &Header, sizeof(ChunkHeader)); // Write size and codec of data
+	memcpy(Sector + sizeof(ChunkHeader), Data, DataSize); // Write chunk data
 
 	// Add padding to the rest of the sector
-	mRegionFile->Write(FilePadding, (RelocationEntry.NumOfSectors * RegionData::SECTOR_SIZE) - DataSize - 4);
-}
\ No newline at end of file
+	memset(Sector + sizeof(ChunkHeader) + DataSize, 0, (ChunkEntry.NumOfSectors * RegionData::SECTOR_SIZE) - DataSize - sizeof(ChunkHeader));
+}
+
+bool FRegionFile::ResizeSectors(const uint32_t SectorCount)
+{
+	const bool Resized = mRegionFile->Resize(sizeof(RegionData) + SectorCount * RegionData::SECTOR_SIZE);
+	ASSERT(Resized);
+
+	mMappedBytes.Set(mRegionFile->GetFileSize());
+	return Resized;
+}
@@ -1,51 +1,83 @@
 #include "FileIO\WorldFileSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 
 const wchar_t FWorldFileSystem::TEMP_DIRECTORY_NAME[] = L"Temp_World";
 const wchar_t FWorldFileSystem::WORLDS_DIRECTORY_NAME[] = L"./Worlds/";
-const wchar_t FWorldFileSystem::TEMP_DIRECTORY_PATH[] = L"./Worlds/Temp_World";
+
+namespace
+{
+	// File systems made so far, each numbers its temp directory by its place
+	std::atomic<uint32_t> InstanceCount(0);
+}
 
 FWorldFileSystem::FWorldFileSystem()
 	: mWorldName()
+	, mTempDirectoryName(TEMP_DIRECTORY_NAME)
 	, mRegionFiles()
+	, mShadowRegions()
+	, mCachedRegions()
+	, mPayloadCache()
+	, mOccupancy()
+	, mBatchMisses()
+	, mBatchReads()
+	, mWriteCount(0)
 	, mWorldSize(0)
 {
-
+	// The first keeps the plain name, so a single world's temp directory doesn't move
+	const uint32_t Instance = InstanceCount++;
+	if (Instance > 0)
+		mTempDirectoryName += L"_" + std::to_wstring(Instance);
 }
 
 FWorldFileSystem::~FWorldFileSystem()
 {
 	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	mPayloadCache.Clear();
 	mRegionFiles.clear();
+	mCachedRegions.clear();
 
 	// Delete the temp directory
-	std::wstring TempPath{ TEMP_DIRECTORY_PATH };
+	const std::wstring TempPath = WORLDS_DIRECTORY_NAME + mTempDirectoryName;
 	FileSystem.DeleteDirectory(TempPath.c_str());
 }
 
 bool FWorldFileSystem::SetWorld(const wchar_t* WorldName)
 {
+	mPayloadCache.Clear();
+	mOccupancy.Clear();
 	mRegionFiles.clear();
+	mCachedRegions.clear();
+	mShadowRegions.clear();
+	mRegionWriteCounts.clear();
 	mWorldName = WorldName;
 
 	IFileSystem& FileSystem = IFileSystem::GetInstance();
 
-	// Copy world into temp directory
-	std::wstring Filepath{ WORLDS_DIRECTORY_NAME };
-	Filepath += WorldName;
+	// Start with an empty temp directory for shadow regions
+	const std::wstring TempPath = WORLDS_DIRECTORY_NAME + mTempDirectoryName;
 
-	std::wstring TempPath{ TEMP_DIRECTORY_PATH };
+	if (FileSystem.FileExists(TempPath.c_str()))
+		FileSystem.DeleteDirectory(TempPath.c_str());
 
-	FileSystem.DeleteDirectory(TempPath.c_str());
-	FileSystem.CopyFileDirectory(Filepath.c_str(), TempPath.c_str());
+	FileSystem.CreateFileDirectory(TempPath.c_str());
 
 	// Get the world size
-	TempPath += L"/WorldInfo.vgw";
+	std::wstring Filepath{ WORLDS_DIRECTORY_NAME };
+	Filepath += WorldName;
+	Filepath += L"/WorldInfo.vgw";
 
-	auto WorldInfoFile = FileSystem.OpenReadable(TempPath.c_str());
+	auto WorldInfoFile = FileSystem.OpenReadable(Filepath.c_str());
 	
 	if (WorldInfoFile)
 	{
 		WorldInfoFile->Read((uint8_t*)&mWorldSize, 4);
+
+		// Worlds saved without occupancy read every chunk until it is known
+		if (!mOccupancy.Read(*WorldInfoFile))
+			std::wcerr << L"Chunk occupancy is cut short for " << WorldName << std::endl;
+
 		return true;
 	}
 	
@@ -65,17 +97,52 @@ std::wstring FWorldFileSystem::GetWorldName() const
 
 void FWorldFileSystem::SaveWorld()
 {
-	// Delete the original world directory
 	IFileSystem& FileSystem = IFileSystem::GetInstance();
-	std::wstring Filepath{ WORLDS_DIRECTORY_NAME };
-	Filepath += mWorldName;
+	std::vector<Vector3i> OpenShadowRegions;
+
+	// Held writes belong in the shadows being saved
+	FlushPayloads();
+
+	// Closed shadows can be moved instead of copied
+	EvictCachedRegions(0);
+
+	// Move each written region over its original
+	for (const Vector3i& RegionID : mShadowRegions)
+	{
+		const std::wstring ShadowPath = FRegionFile::GetFilepath(mTempDirectoryName.c_str(), RegionID);
+		const std::wstring Filepath = FRegionFile::GetFilepath(mWorldName.c_str(), RegionID);
+
+		auto Record = mRegionFiles.find(RegionID);
+		if (Record == mRegionFiles.end())
+		{
+			FileSystem.ReplaceFilename(ShadowPath.c_str(), Filepath.c_str());
+			continue;
+		}
+
+		// Mapped shadows can't be moved, so a flushed copy replaces the original instead
+		const std::wstring SavePath = Filepath + L".save";
+		Record->second.File.Flush();
+
+		if (FileSystem.CopyFilename(ShadowPath.c_str(), SavePath.c_str()))
+			FileSystem.ReplaceFilename(SavePath.c_str(), Filepath.c_str());
+
+		OpenShadowRegions.push_back(RegionID);
+	}
 
-	FileSystem.DeleteDirectory(Filepath.c_str());
+	// Open shadows may still be written to
+	mShadowRegions.swap(OpenShadowRegions);
 
-	// Copy temp world into a new world directory
-	std::wstring TempPath{ WORLDS_DIRECTORY_NAME };
-	TempPath += TEMP_DIRECTORY_NAME;
-	FileSystem.CopyFileDirectory(TempPath.c_str(), Filepath.c_str());
+	// The world's info is replaced whole, so a failed write keeps the last saved occupancy
+	const std::wstring InfoPath = std::wstring{ WORLDS_DIRECTORY_NAME } + mWorldName + L"/WorldInfo.vgw";
+	const std::wstring SavePath = InfoPath + L".save";
+	bool IsInfoWritten = false;
+	{
+		auto InfoFile = FileSystem.OpenWritable(SavePath.c_str(), false, true);
+		IsInfoWritten = InfoFile && InfoFile->Write((const uint8_t*)&mWorldSize, 4) && mOccupancy.Write(*InfoFile) && InfoFile->Flush();
+	}
+
+	if (IsInfoWritten)
+		FileSystem.ReplaceFilename(SavePath.c_str(), InfoPath.c_str());
 }
 
 void FWorldFileSystem::AddRegionFileReference(const Vector3i& ChunkPosition)
@@ -84,16 +151,32 @@ void FWorldFileSystem::AddRegionFileReference(const Vector3i& ChunkPosition)
 	const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPosition);
 
 	// Increment if the file is loaded
-	if (mRegionFiles.find(RegionID) != mRegionFiles.end())
+	auto Found = mRegionFiles.find(RegionID);
+	if (Found != mRegionFiles.end())
 	{
-		mRegionFiles[RegionID].ReferenceCount++;
+		// Take cached regions back out of the cache
+		if (Found->second.ReferenceCount++ == 0)
+			mCachedRegions.remove(RegionID);
 	}
 	else
 	{
 		// Add the file if not loaded
 		RegionFileRecord& Record = mRegionFiles[RegionID];
 		Record.ReferenceCount = 1;
-		Record.File.Load(TEMP_DIRECTORY_NAME, RegionID);
+		Record.IsShadow = HasShadowRegion(RegionID);
+
+		// Read the original until the region is written to
+		if (!Record.IsShadow && !Record.File.Load(mWorldName.c_str(), RegionID, true))
+		{
+			// Regions not in the world yet start out as shadows
+			Record.File.Load(mTempDirectoryName.c_str(), RegionID);
+			Record.IsShadow = true;
+			mShadowRegions.push_back(RegionID);
+		}
+		else if (Record.IsShadow)
+		{
+			Record.File.Load(mTempDirectoryName.c_str(), RegionID);
+		}
 	}
 }
 
@@ -104,48 +187,218 @@ void FWorldFileSystem::RemoveRegionFileReference(const Vector3i& ChunkPosition)
 
 	ASSERT(mRegionFiles.find(RegionID) != mRegionFiles.end() && "Shouldn't be removing a record that is not there.");
 
-	// Decrement reference count and erase if 0
+	// Decrement reference count and cache if 0
 	RegionFileRecord& Record = mRegionFiles[RegionID];
+	ASSERT(Record.ReferenceCount > 0);
 	Record.ReferenceCount--;
 
-	if (Record.ReferenceCount <= 0)
+	if (Record.ReferenceCount == 0)
 	{
-		mRegionFiles.erase(RegionID);
+		// Unreferenced regions aren't cached while region files are over budget
+		mCachedRegions.push_front(RegionID);
+		EvictCachedRegions(SMemoryStats::IsOverBudget(EMemoryTag::RegionFiles) ? 0 : REGION_CACHE_SIZE);
 	}
 }
 
 void FWorldFileSystem::ClearAllRegionFileReferences()
 {
 	mRegionFiles.clear();
+	mCachedRegions.clear();
 }
 
-void FWorldFileSystem::GetChunkData(const Vector3i& ChunkPosition, std::vector<uint8_t>& DataOut)
+uint32_t FWorldFileSystem::GetChunkData(const Vector3i& ChunkPosition, uint8_t* DataOut, const uint32_t Capacity, uint8_t& CodecOut)
 {
 	const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPosition);
 	const Vector3i RegionPosition = FRegionFile::LocalRegionPosition(ChunkPosition);
 
 	ASSERT(mRegionFiles.find(RegionID) != mRegionFiles.end());
 
+	if (const FChunkPayloadCache::Entry* Held = mPayloadCache.Find(ChunkPosition))
+	{
+		ASSERT(Held->Data.size() <= Capacity && "Chunk data is larger than the buffer.");
+		if (Held->Data.size() > Capacity)
+			return 0;
+
+		memcpy(DataOut, Held->Data.data(), Held->Data.size());
+		CodecOut = Held->Codec;
+		return (uint32_t)Held->Data.size();
+	}
+
 	FRegionFile& File = mRegionFiles[RegionID].File;
 
 	// Get size and offset
 	uint32_t DataSize, SectorOffset;
-	File.GetChunkDataInfo(RegionPosition, DataSize, SectorOffset);
+	File.GetChunkDataInfo(RegionPosition, DataSize, SectorOffset, CodecOut);
+
+	if (DataSize == 0)
+		return 0;
+
+	ASSERT(DataSize <= Capacity && "Chunk data is larger than the buffer.");
+	if (DataSize > Capacity)
+		return 0;
 
 	// Fill data buffer
-	DataOut.resize(DataSize);
-	File.GetChunkData(SectorOffset, DataOut.data(), DataSize);
+	File.GetChunkData(SectorOffset, DataOut, DataSize);
+
+	mPayloadCache.Insert(ChunkPosition, DataOut, DataSize, CodecOut, false);
+	EvictPayloads();
+
+	return DataSize;
+}
+
+void FWorldFileSystem::GetChunkDataBatch(const Vector3i* ChunkPositions, const uint32_t Count, std::vector<uint8_t>* DataOut, uint8_t* CodecsOut, const uint32_t Capacity)
+{
+	// Held chunks are copied, the rest are read a region at a time
+	mBatchMisses.clear();
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		ASSERT(mRegionFiles.find(FRegionFile::ChunkToRegionPosition(ChunkPositions[i])) != mRegionFiles.end());
+
+		if (const FChunkPayloadCache::Entry* Held = mPayloadCache.Find(ChunkPositions[i]))
+		{
+			ASSERT(Held->Data.size() <= Capacity && "Chunk data is larger than the buffer.");
+			if (Held->Data.size() <= Capacity)
+				DataOut[i] = Held->Data;
+			else
+				DataOut[i].clear();
+
+			CodecsOut[i] = Held->Codec;
+		}
+		else
+		{
+			mBatchMisses.push_back(i);
+		}
+	}
+
+	std::sort(mBatchMisses.begin(), mBatchMisses.end(), [ChunkPositions](const uint32_t A, const uint32_t B)
+	{
+		const Vector3i RegionA = FRegionFile::ChunkToRegionPosition(ChunkPositions[A]);
+		const Vector3i RegionB = FRegionFile::ChunkToRegionPosition(ChunkPositions[B]);
+		if (RegionA.x != RegionB.x)
+			return RegionA.x < RegionB.x;
+		if (RegionA.y != RegionB.y)
+			return RegionA.y < RegionB.y;
+		return RegionA.z < RegionB.z;
+	});
+
+	for (uint32_t First = 0; First < mBatchMisses.size();)
+	{
+		const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPositions[mBatchMisses[First]]);
+
+		mBatchReads.clear();
+		uint32_t End = First;
+		for (; End < mBatchMisses.size() && FRegionFile::ChunkToRegionPosition(ChunkPositions[mBatchMisses[End]]) == RegionID; End++)
+		{
+			const uint32_t Index = mBatchMisses[End];
+			mBatchReads.push_back(FRegionFile::BatchRead{ FRegionFile::LocalRegionPosition(ChunkPositions[Index]), &DataOut[Index], 0 });
+		}
+
+		mRegionFiles[RegionID].File.GetChunkDataBatch(mBatchReads.data(), mBatchReads.size(), Capacity);
 
+		for (uint32_t i = First; i < End; i++)
+		{
+			const uint32_t Index = mBatchMisses[i];
+			CodecsOut[Index] = mBatchReads[i - First].Codec;
+
+			if (!DataOut[Index].empty())
+				mPayloadCache.Insert(ChunkPositions[Index], DataOut[Index].data(), DataOut[Index].size(), CodecsOut[Index], false);
+		}
+
+		First = End;
+	}
+
+	EvictPayloads();
 }
 
-void FWorldFileSystem::WriteChunkData(const Vector3i& ChunkPosition, const std::vector<uint8_t>& Data)
+void FWorldFileSystem::WriteChunkData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec, const FChunkOccupancy::Entry& Occupancy, const bool IsGenerated)
+{
+	ASSERT(mRegionFiles.find(FRegionFile::ChunkToRegionPosition(ChunkPosition)) != mRegionFiles.end());
+
+	mPayloadCache.Insert(ChunkPosition, Data, DataSize, Codec, true);
+	mOccupancy.Set(ChunkPosition, Occupancy);
+
+	// Streaming into a new area writes a generated chunk with nearly every load
+	if (!IsGenerated)
+		mRegionWriteCounts[FRegionFile::ChunkToRegionPosition(ChunkPosition)] = ++mWriteCount;
+
+	EvictPayloads();
+}
+
+uint64_t FWorldFileSystem::GetWriteCount(const Vector3i& ChunkPosition) const
+{
+	auto Region = mRegionWriteCounts.find(FRegionFile::ChunkToRegionPosition(ChunkPosition));
+	return (Region != mRegionWriteCounts.end()) ? Region->second : 0;
+}
+
+void FWorldFileSystem::WriteRegionData(const Vector3i& ChunkPosition, const uint8_t* Data, const uint32_t DataSize, const uint8_t Codec)
 {
 	const Vector3i RegionID = FRegionFile::ChunkToRegionPosition(ChunkPosition);
 	const Vector3i RegionPosition = FRegionFile::LocalRegionPosition(ChunkPosition);
 
 	ASSERT(mRegionFiles.find(RegionID) != mRegionFiles.end());
 
-	FRegionFile& File = mRegionFiles[RegionID].File;
-	File.WriteChunkData(RegionPosition, Data.data(), Data.size());
+	RegionFileRecord& Record = mRegionFiles[RegionID];
+
+	if (!Record.IsShadow)
+		CreateShadowRegion(RegionID, Record);
+
+	Record.File.WriteChunkData(RegionPosition, Data, DataSize, Codec);
+}
+
+void FWorldFileSystem::EvictPayloads()
+{
+	Vector3i ChunkPosition;
+	FChunkPayloadCache::Entry Evicted;
+
+	while (mPayloadCache.IsOverBudget() && mPayloadCache.TakeLeastRecent(ChunkPosition, Evicted))
+	{
+		if (!Evicted.IsDirty)
+			continue;
+
+		// The chunk's region may have been released since the write
+		AddRegionFileReference(ChunkPosition);
+		WriteRegionData(ChunkPosition, Evicted.Data.data(), (uint32_t)Evicted.Data.size(), Evicted.Codec);
+		RemoveRegionFileReference(ChunkPosition);
+	}
+}
+
+void FWorldFileSystem::FlushPayloads()
+{
+	mPayloadCache.TakeDirty([this](const Vector3i& ChunkPosition, const FChunkPayloadCache::Entry& Dirty)
+	{
+		AddRegionFileReference(ChunkPosition);
+		WriteRegionData(ChunkPosition, Dirty.Data.data(), (uint32_t)Dirty.Data.size(), Dirty.Codec);
+		RemoveRegionFileReference(ChunkPosition);
+	});
+}
+
+void FWorldFileSystem::CreateShadowRegion(const Vector3i& RegionID, RegionFileRecord& Record)
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
 
+	const std::wstring Filepath = FRegionFile::GetFilepath(mWorldName.c_str(), RegionID);
+	const std::wstring ShadowPath = FRegionFile::GetFilepath(mTempDirectoryName.c_str(), RegionID);
+
+	// Reopen the region on a writable copy of the original
+	Record.File.Close();
+	FileSystem.CopyFilename(Filepath.c_str(), ShadowPath.c_str());
+
+	Record.File.Load(mTempDirectoryName.c_str(), RegionID);
+	Record.IsShadow = true;
+	mShadowRegions.push_back(RegionID);
+}
+
+void FWorldFileSystem::EvictCachedRegions(const uint32_t MaxCount)
+{
+	// Closing the region flushes its mapping
+	while (mCachedRegions.size() > MaxCount)
+	{
+		mRegionFiles.erase(mCachedRegions.back());
+		mCachedRegions.pop_back();
+	}
+}
+
+bool FWorldFileSystem::HasShadowRegion(const Vector3i& RegionID) const
+{
+	return std::find(mShadowRegions.begin(), mShadowRegions.end(), RegionID) != mShadowRegions.end();
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "FramePacer.h"
+#include "Clock.h"
+#include "SystemResources\SystemThread.h"
+
+#include <thread>
+
+namespace
+{
+	// Sleeps stop this long before the frame is due, the rest is spun
+	const float SPIN_TIME = 0.002f;
+
+	// Background work always gets this much, even in late frames
+	const float MIN_BACKGROUND_TIME = 0.0005f;
+
+	// Background budget of unpaced frames
+	const float UNPACED_BACKGROUND_TIME = 0.004f;
+
+	// Weight of the newest frame in the smoothed tail time
+	const float TAIL_SMOOTHING = 0.1f;
+}
+
+float    SFramePacer::mTargetFPS = 0.0f;
+uint64_t SFramePacer::mTargetCycles = 0;
+uint64_t SFramePacer::mFrameStart = 0;
+uint64_t SFramePacer::mBackgroundEnd = 0;
+float    SFramePacer::mTailTime = 0.0f;
+
+void SFramePacer::SetTargetFPS(const float FPS)
+{
+	mTargetFPS = FPS > 0.0f ? FPS : 0.0f;
+	mTargetCycles = FPS > 0.0f ? FClock::SecondsToCycles(1.0f / FPS) : 0;
+}
+
+void SFramePacer::BeginFrame()
+{
+	mFrameStart = FClock::ReadSystemTimer();
+	mBackgroundEnd = 0;
+}
+
+uint64_t SFramePacer::GetBackgroundDeadline()
+{
+	const uint64_t Now = FClock::ReadSystemTimer();
+	const uint64_t MinDeadline = Now + FClock::SecondsToCycles(MIN_BACKGROUND_TIME);
+	if (mTargetCycles == 0)
+		return Now + FClock::SecondsToCycles(UNPACED_BACKGROUND_TIME);
+
+	const uint64_t Deadline = mFrameStart + mTargetCycles - FClock::SecondsToCycles(mTailTime);
+	return Deadline > MinDeadline ? Deadline : MinDeadline;
+}
+
+void SFramePacer::EndBackgroundWork()
+{
+	mBackgroundEnd = FClock::ReadSystemTimer();
+}
+
+void SFramePacer::EndFrame()
+{
+	uint64_t Now = FClock::ReadSystemTimer();
+	if (mBackgroundEnd != 0)
+	{
+		const float TailTime = FClock::CyclesToSeconds(Now - mBackgroundEnd);
+		mTailTime += (TailTime - mTailTime) * TAIL_SMOOTHING;
+	}
+
+	if (mTargetCycles == 0)
+		return;
+
+	const uint64_t FrameEnd = mFrameStart + mTargetCycles;
+	const uint64_t SpinCycles = FClock::SecondsToCycles(SPIN_TIME);
+	if (Now + SpinCycles < FrameEnd)
+		SThread::Sleep(FClock::CyclesToSeconds(FrameEnd - SpinCycles - Now));
+
+	for (Now = FClock::ReadSystemTimer(); Now < FrameEnd; Now = FClock::ReadSystemTimer())
+		std::this_thread::yield();
+}
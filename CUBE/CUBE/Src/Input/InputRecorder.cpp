@@ -0,0 +1,236 @@
+#include "Input\InputRecorder.h"
+#include "Input\ButtonEvent.h"
+#include "Input\MouseAxis.h"
+#include "Input\TextEntered.h"
+#include "FileIO\GenericFile.h"
+#include "Debugging\Log.h"
+#include "Misc\Assertions.h"
+#include "STime.h"
+
+#include <cstring>
+
+namespace
+{
+	// Identifies a recording, the version changes whenever the layout of the file changes
+	const uint32_t RECORDING_MAGIC = 0x50524943; // "CIRP"
+	const uint32_t RECORDING_VERSION = 1;
+
+	/**
+	* Starts a recording. The frames follow.
+	*/
+	struct RecordingHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t EventSize; // sizeof(sf::Event) when recorded, events are stored as they are in memory
+	};
+
+	/**
+	* Starts a frame. Each event follows as its type byte and the part of its union that is used.
+	*/
+	struct FrameRecord
+	{
+		float    DeltaTime;
+		float    FixedUpdate;
+		int32_t  MouseDelta[2];
+		uint32_t EventCount;
+	};
+
+	/**
+	* The bytes of an event's union that a recorded event uses, 0 for events that aren't recorded.
+	*/
+	uint32_t GetPayloadSize(const sf::Event::EventType Type)
+	{
+		switch (Type)
+		{
+		case sf::Event::KeyPressed:
+		case sf::Event::KeyReleased:
+			return sizeof(sf::Event::KeyEvent);
+		case sf::Event::MouseButtonPressed:
+		case sf::Event::MouseButtonReleased:
+			return sizeof(sf::Event::MouseButtonEvent);
+		case sf::Event::MouseWheelMoved:
+			return sizeof(sf::Event::MouseWheelEvent);
+		case sf::Event::TextEntered:
+			return sizeof(sf::Event::TextEvent);
+		default:
+			return 0;
+		}
+	}
+
+	void Append(std::vector<uint8_t>& Data, const void* Source, const uint32_t Size)
+	{
+		const uint8_t* Bytes = (const uint8_t*)Source;
+		Data.insert(Data.end(), Bytes, Bytes + Size);
+	}
+}
+
+std::vector<uint8_t> SInputRecorder::mData;
+std::vector<sf::Event> SInputRecorder::mFrameEvents;
+std::wstring SInputRecorder::mFilename;
+std::function<void()> SInputRecorder::mOnReplayFinished;
+uint32_t SInputRecorder::mReadOffset = 0;
+uint32_t SInputRecorder::mFrameCount = 0;
+bool SInputRecorder::mIsRecording = false;
+bool SInputRecorder::mIsReplaying = false;
+
+void SInputRecorder::StartRecording(const wchar_t* Filename)
+{
+	ASSERT(!mIsReplaying && "Replayed input can't be recorded.");
+	if (mIsReplaying)
+		return;
+
+	const RecordingHeader Header = { RECORDING_MAGIC, RECORDING_VERSION, sizeof(sf::Event) };
+	mData.clear();
+	Append(mData, &Header, sizeof(Header));
+	mFrameEvents.clear();
+	mFilename = Filename;
+	mFrameCount = 0;
+	mIsRecording = true;
+}
+
+bool SInputRecorder::StopRecording()
+{
+	if (!mIsRecording)
+		return false;
+	mIsRecording = false;
+
+	bool IsWritten = false;
+	{
+		auto File = IFileSystem::GetInstance().OpenWritable(mFilename.c_str(), false, true);
+		IsWritten = File && File->Write(mData.data(), mData.size()) && File->Flush();
+	}
+
+	if (IsWritten)
+		LOG(Info, General, "Recorded %u frames of input to %S.", mFrameCount, mFilename.c_str());
+	else
+		LOG(Warning, General, "Recorded input couldn't be written to %S.", mFilename.c_str());
+
+	std::vector<uint8_t>().swap(mData);
+	return IsWritten;
+}
+
+bool SInputRecorder::StartReplay(const wchar_t* Filename)
+{
+	ASSERT(!mIsRecording && "Input can't be replayed while recording.");
+	if (mIsRecording)
+		return false;
+
+	auto File = IFileSystem::GetInstance().OpenReadable(Filename);
+	if (!File)
+	{
+		LOG(Warning, General, "Recorded input %S couldn't be opened.", Filename);
+		return false;
+	}
+
+	std::vector<uint8_t> Data(File->GetFileSize());
+	if (Data.size() < sizeof(RecordingHeader) || !File->Read(Data.data(), Data.size()))
+		return false;
+
+	RecordingHeader Header;
+	memcpy(&Header, Data.data(), sizeof(Header));
+	if (Header.Magic != RECORDING_MAGIC || Header.Version != RECORDING_VERSION || Header.EventSize != sizeof(sf::Event))
+	{
+		LOG(Warning, General, "Recorded input %S is from another version and can't be replayed.", Filename);
+		return false;
+	}
+
+	mData.swap(Data);
+	mFilename = Filename;
+	mReadOffset = sizeof(RecordingHeader);
+	mFrameCount = 0;
+	mIsReplaying = true;
+	return true;
+}
+
+void SInputRecorder::StopReplay()
+{
+	mIsReplaying = false;
+	std::vector<uint8_t>().swap(mData);
+}
+
+void SInputRecorder::SetOnReplayFinished(std::function<void()> OnFinished)
+{
+	mOnReplayFinished = std::move(OnFinished);
+}
+
+bool SInputRecorder::IsRecordedEvent(const sf::Event& Event)
+{
+	return GetPayloadSize(Event.type) != 0;
+}
+
+void SInputRecorder::RecordEvent(const sf::Event& Event)
+{
+	ASSERT(IsRecordedEvent(Event));
+	mFrameEvents.push_back(Event);
+}
+
+void SInputRecorder::RecordFrame()
+{
+	const Vector2i MouseDelta = SMouseAxis::GetDelta();
+	const FrameRecord Frame = { STime::GetDeltaTime(), STime::GetFixedUpdate(), { MouseDelta.x, MouseDelta.y }, (uint32_t)mFrameEvents.size() };
+	Append(mData, &Frame, sizeof(Frame));
+
+	for (const sf::Event& Event : mFrameEvents)
+	{
+		const uint8_t Type = (uint8_t)Event.type;
+		Append(mData, &Type, sizeof(Type));
+
+		// Every member of the union starts at the same address
+		Append(mData, &Event.key, GetPayloadSize(Event.type));
+	}
+
+	mFrameEvents.clear();
+	mFrameCount++;
+}
+
+void SInputRecorder::ReplayFrame()
+{
+	FrameRecord Frame;
+	bool IsComplete = mData.size() - mReadOffset >= sizeof(Frame);
+	if (IsComplete)
+	{
+		memcpy(&Frame, mData.data() + mReadOffset, sizeof(Frame));
+		mReadOffset += sizeof(Frame);
+	}
+
+	for (uint32_t i = 0; IsComplete && i < Frame.EventCount; i++)
+	{
+		sf::Event Event;
+		IsComplete = mData.size() - mReadOffset >= sizeof(uint8_t);
+		if (!IsComplete)
+			break;
+		Event.type = (sf::Event::EventType)mData[mReadOffset];
+		mReadOffset += sizeof(uint8_t);
+
+		// An event that isn't recorded can only come from a damaged file
+		const uint32_t PayloadSize = GetPayloadSize(Event.type);
+		IsComplete = PayloadSize != 0 && mData.size() - mReadOffset >= PayloadSize;
+		if (!IsComplete)
+			break;
+		memcpy(&Event.key, mData.data() + mReadOffset, PayloadSize);
+		mReadOffset += PayloadSize;
+
+		if (SButtonEvent::IsButtonEvent(Event))
+			SButtonEvent::AddButtonEvent(Event);
+		else if (SMouseAxis::IsMouseAxisEvent(Event))
+			SMouseAxis::UpdateEvent(Event);
+		else if (Event.type == sf::Event::TextEntered)
+			STextEntered::AddTextEvent(Event);
+	}
+
+	// A partly written frame at the end is dropped, as a recording cut short would leave one
+	if (!IsComplete)
+	{
+		LOG(Info, General, "Replayed %u frames of input from %S.", mFrameCount, mFilename.c_str());
+		StopReplay();
+		if (mOnReplayFinished)
+			mOnReplayFinished();
+		return;
+	}
+
+	SMouseAxis::ReplayDelta(Vector2i{ Frame.MouseDelta[0], Frame.MouseDelta[1] });
+	STime::OverrideDeltaTime(Frame.DeltaTime);
+	STime::SetFixedUpdate(Frame.FixedUpdate);
+	mFrameCount++;
+}
@@ -5,6 +5,8 @@
 Vector2i SMouseAxis::mLastMousePosition;
 Vector2i SMouseAxis::mDefaultMousePosition;
 Vector2i SMouseAxis::mMouseDelta;
+Vector2i SMouseAxis::mMovement;
+std::mutex SMouseAxis::mMovementMutex;
 sf::Window* SMouseAxis::mWindow = nullptr;
 int32_t SMouseAxis::mWheelDelta = 0;
 bool SMouseAxis::mIsLocked = false;
@@ -15,6 +17,13 @@ Vector2i SMouseAxis::GetDelta()
 	return mMouseDelta;
 }
 
+Vector2i SMouseAxis::GetMovement()
+{
+	std::lock_guard<std::mutex> Lock(mMovementMutex);
+	const sf::Vector2i CurrentPosition = sf::Mouse::getPosition(*mWindow);
+	return mMovement + Vector2i(CurrentPosition.x - mLastMousePosition.x, CurrentPosition.y - mLastMousePosition.y);
+}
+
 int32_t SMouseAxis::GetWheelDelta()
 {
 	return mWheelDelta;
@@ -35,10 +44,12 @@ void SMouseAxis::UpdateEvent(const sf::Event& MouseEvent)
 
 void SMouseAxis::UpdateDelta()
 {
+	std::lock_guard<std::mutex> Lock(mMovementMutex);
 	const sf::Vector2i CurrentPosition = sf::Mouse::getPosition(*mWindow);
 	const Vector2i LastPosition = mLastMousePosition;
 	mMouseDelta = Vector2i(CurrentPosition.x - LastPosition.x, CurrentPosition.y - LastPosition.y);
 	
+	mMovement += mMouseDelta;
 	mLastMousePosition = Vector2i{ CurrentPosition.x, CurrentPosition.y };
 
 	if (mIsLocked)
@@ -48,6 +59,13 @@ void SMouseAxis::UpdateDelta()
 	}
 }
 
+void SMouseAxis::ReplayDelta(const Vector2i Delta)
+{
+	std::lock_guard<std::mutex> Lock(mMovementMutex);
+	mMovement += Delta - mMouseDelta;
+	mMouseDelta = Delta;
+}
+
 void SMouseAxis::ResetAxes()
 {
 	mWheelDelta = 0;
@@ -9,93 +9,80 @@ FBox::FBox()
 
 void FBox::TransformAABB(const FMatrix4& Transform)
 {
-	// From 3D Math Primer for Graphics and Game Development p. 310
-	// Start at current center
-	Vector3f NewMin, NewMax;
-	NewMin = NewMax = Transform.GetOrigin();
+	TransformAABBs(Transform, this, this, 1);
+}
 
-	// Test each matrix element and compute new AABB
-	if (Transform.M[0][0] > 0.0f)
-	{
-		NewMin.x += Transform.M[0][0] * Min.x; NewMax.x += Transform.M[0][0] * Max.x;
-	}
-	else
-	{
-		NewMin.x += Transform.M[0][0] * Max.x; NewMax.x += Transform.M[0][0] * Min.x;
-	}
+void FBox::TransformAABBs(const FMatrix4& Transform, const FBox* Boxes, FBox* BoxesOut, const uint32_t Count)
+{
+	static_assert(sizeof(FBox) == 6 * sizeof(float), "Boxes must be tightly packed.");
 
-	if (Transform.M[0][1] > 0.0f)
-	{
-		NewMin.y += Transform.M[0][1] * Min.x; NewMax.y += Transform.M[0][1] * Max.x;
-	}
-	else
-	{
-		NewMin.y += Transform.M[0][1] * Max.x; NewMax.y += Transform.M[0][1] * Min.x;
-	}
+	// Matrix elements in every component, with the absolute value for taking extents through the matrix
+	__m128 Elements[4][3];
+	__m128 AbsElements[3][3];
+	const __m128 SignMask = _mm_set1_ps(-0.0f);
 
-	if (Transform.M[0][2] > 0.0f)
+	for (uint32_t Col = 0; Col < 4; Col++)
 	{
-		NewMin.z += Transform.M[0][2] * Min.x; NewMax.z += Transform.M[0][2] * Max.x;
-	}
-	else
-	{
-		NewMin.z += Transform.M[0][2] * Max.x; NewMax.z += Transform.M[0][2] * Min.x;
+		for (uint32_t Row = 0; Row < 3; Row++)
+		{
+			Elements[Col][Row] = _mm_set1_ps(Transform.M[Col][Row]);
+			if (Col < 3)
+				AbsElements[Col][Row] = _mm_andnot_ps(SignMask, Elements[Col][Row]);
+		}
 	}
 
-	if (Transform.M[1][0] > 0.0f)
-	{
-		NewMin.x += Transform.M[1][0] * Min.y; NewMax.x += Transform.M[1][0] * Max.y;
-	}
-	else
-	{
-		NewMin.x += Transform.M[1][0] * Max.y; NewMax.x += Transform.M[1][0] * Min.y;
-	}
+	const __m128 Half = _mm_set1_ps(0.5f);
 
-	if (Transform.M[1][1] > 0.0f)
+	for (uint32_t i = 0; i < Count; i += 4)
 	{
-		NewMin.y += Transform.M[1][1] * Min.y; NewMax.y += Transform.M[1][1] * Max.y;
-	}
-	else
-	{
-		NewMin.y += Transform.M[1][1] * Max.y; NewMax.y += Transform.M[1][1] * Min.y;
-	}
+		// The last block is padded with copies of its first box
+		const uint32_t BlockCount = Count - i < 4 ? Count - i : 4;
+		FBox Block[4];
+		for (uint32_t j = 0; j < 4; j++)
+			Block[j] = Boxes[i + (j < BlockCount ? j : 0)];
 
-	if (Transform.M[1][2] > 0.0f)
-	{
-		NewMin.z += Transform.M[1][2] * Min.y; NewMax.z += Transform.M[1][2] * Max.y;
-	}
-	else
-	{
-		NewMin.z += Transform.M[1][2] * Max.y; NewMax.z += Transform.M[1][2] * Min.y;
-	}
+		// Min and max of 2 boxes are 4 packed points, which deinterleave to min0 max0 min1 max1
+		const float* In = &Block[0].Min.x;
+		__m128 Low[3], High[3];
+		DeinterleaveVector3(_mm_loadu_ps(In), _mm_loadu_ps(In + 4), _mm_loadu_ps(In + 8), Low[0], Low[1], Low[2]);
+		DeinterleaveVector3(_mm_loadu_ps(In + 12), _mm_loadu_ps(In + 16), _mm_loadu_ps(In + 20), High[0], High[1], High[2]);
 
-	if (Transform.M[2][0] > 0.0f)
-	{
-		NewMin.x += Transform.M[2][0] * Min.z; NewMax.x += Transform.M[2][0] * Max.z;
-	}
-	else
-	{
-		NewMin.x += Transform.M[2][0] * Max.z; NewMax.x += Transform.M[2][0] * Min.z;
-	}
+		// Center and half extent of each axis for the 4 boxes
+		__m128 Center[3], Extent[3];
+		for (uint32_t Axis = 0; Axis < 3; Axis++)
+		{
+			const __m128 Min = _mm_shuffle_ps(Low[Axis], High[Axis], SHUFFLE_PARAM(0, 2, 0, 2));
+			const __m128 Max = _mm_shuffle_ps(Low[Axis], High[Axis], SHUFFLE_PARAM(1, 3, 1, 3));
+			Center[Axis] = _mm_mul_ps(_mm_add_ps(Min, Max), Half);
+			Extent[Axis] = _mm_mul_ps(_mm_sub_ps(Max, Min), Half);
+		}
 
-	if (Transform.M[2][1] > 0.0f)
-	{
-		NewMin.y += Transform.M[2][1] * Min.z; NewMax.y += Transform.M[2][1] * Max.z;
-	}
-	else
-	{
-		NewMin.y += Transform.M[2][1] * Max.z; NewMax.y += Transform.M[2][1] * Min.z;
-	}
+		// The center is transformed as a position, and the extent by the
+		// absolute matrix, which gives the same bounds as testing the sign of every element
+		for (uint32_t Row = 0; Row < 3; Row++)
+		{
+			const __m128 NewCenter = _mm_madd_ps(Elements[0][Row], Center[0], _mm_madd_ps(Elements[1][Row], Center[1], _mm_madd_ps(Elements[2][Row], Center[2], Elements[3][Row])));
+			const __m128 NewExtent = _mm_madd_ps(AbsElements[0][Row], Extent[0], _mm_madd_ps(AbsElements[1][Row], Extent[1], _mm_mul_ps(AbsElements[2][Row], Extent[2])));
 
-	if (Transform.M[2][2] > 0.0f)
-	{
-		NewMin.z += Transform.M[2][2] * Min.z; NewMax.z += Transform.M[2][2] * Max.z;
-	}
-	else
-	{
-		NewMin.z += Transform.M[2][2] * Max.z; NewMax.z += Transform.M[2][2] * Min.z;
-	}
+			const __m128 Min = _mm_sub_ps(NewCenter, NewExtent);
+			const __m128 Max = _mm_add_ps(NewCenter, NewExtent);
+			Low[Row] = _mm_unpacklo_ps(Min, Max);
+			High[Row] = _mm_unpackhi_ps(Min, Max);
+		}
+
+		float* Out = &Block[0].Min.x;
+		__m128 A, B, C;
+		InterleaveVector3(Low[0], Low[1], Low[2], A, B, C);
+		_mm_storeu_ps(Out, A);
+		_mm_storeu_ps(Out + 4, B);
+		_mm_storeu_ps(Out + 8, C);
 
-	Max = NewMax;
-	Min = NewMin;
-}
\ No newline at end of file
+		InterleaveVector3(High[0], High[1], High[2], A, B, C);
+		_mm_storeu_ps(Out + 12, A);
+		_mm_storeu_ps(Out + 16, B);
+		_mm_storeu_ps(Out + 20, C);
+
+		for (uint32_t j = 0; j < BlockCount; j++)
+			BoxesOut[i + j] = Block[j];
+	}
+}
@@ -2,6 +2,90 @@
 #include "Math\Vector4.h"
 #include "Math\Sphere.h"
 #include "Math\SystemMath.h"
+#include "Math\SSEMath.h"
+#include "Math\Matrix4A.h"
+
+#include <cmath>
+
+namespace
+{
+	/**
+	* Loads up to 4 consecutive 16 byte elements and transposes them, so each
+	* output holds one component of every element. Missing elements repeat the first.
+	*/
+	void LoadTransposed(const float* Elements, const uint32_t Count, __m128& X, __m128& Y, __m128& Z, __m128& W)
+	{
+		X = _mm_loadu_ps(Elements);
+		Y = (Count > 1) ? _mm_loadu_ps(Elements + 4) : X;
+		Z = (Count > 2) ? _mm_loadu_ps(Elements + 8) : X;
+		W = (Count > 3) ? _mm_loadu_ps(Elements + 12) : X;
+		_MM_TRANSPOSE4_PS(X, Y, Z, W);
+	}
+
+	/**
+	* Writes up to 4 results from a visibility mask.
+	*/
+	void StoreVisibility(const int32_t Mask, const uint32_t Count, uint8_t* VisibleOut)
+	{
+		for (uint32_t i = 0; i < Count && i < 4; i++)
+			VisibleOut[i] = (uint8_t)((Mask >> i) & 1);
+	}
+
+	/**
+	* Gets a plane with a unit length normal from a plane equation.
+	*/
+	FPlane NormalizedPlane(const FVector4A& Plane)
+	{
+		return FPlane{ (Plane / Plane.Length3()).ToVector4() };
+	}
+}
+
+FFrustum FFrustum::FromMatrix(const FMatrix4& Matrix)
+{
+	return FromMatrix(FMatrix4A{ Matrix });
+}
+
+FFrustum FFrustum::FromMatrix(const FMatrix4A& Matrix)
+{
+	// From Mathematics for 3D Game Programming and Computer Graphics p.107
+	// The transpose holds the rows of the matrix as columns
+	const FMatrix4A Rows = Matrix.Transpose();
+	const FVector4A Row0 = Rows.GetColumn(0);
+	const FVector4A Row1 = Rows.GetColumn(1);
+	const FVector4A Row2 = Rows.GetColumn(2);
+	const FVector4A Row3 = Rows.GetColumn(3);
+
+	FFrustum Frustum;
+	Frustum.SetPlane(Near, NormalizedPlane(Row3 + Row2));
+	Frustum.SetPlane(Far, NormalizedPlane(Row3 - Row2));
+	Frustum.SetPlane(Left, NormalizedPlane(Row3 + Row0));
+	Frustum.SetPlane(Right, NormalizedPlane(Row3 - Row0));
+	Frustum.SetPlane(Bottom, NormalizedPlane(Row3 + Row1));
+	Frustum.SetPlane(Top, NormalizedPlane(Row3 - Row1));
+
+	return Frustum;
+}
+
+FFrustum FFrustum::FromReverseZMatrix(const FMatrix4& Matrix)
+{
+	return FromReverseZMatrix(FMatrix4A{ Matrix });
+}
+
+FFrustum FFrustum::FromReverseZMatrix(const FMatrix4A& Matrix)
+{
+	// Depth is clipped to 0 <= z <= w, the near plane at w
+	const FMatrix4A Rows = Matrix.Transpose();
+	const FVector4A Row2 = Rows.GetColumn(2);
+	const FVector4A Row3 = Rows.GetColumn(3);
+
+	FFrustum Frustum = FromMatrix(Matrix);
+	Frustum.SetPlane(Near, NormalizedPlane(Row3 - Row2));
+
+	// Infinite projections have a constant z, leaving a far plane with no normal
+	Frustum.SetPlane(Far, Row2.Length3().GetX() > 1e-6f ? NormalizedPlane(Row2) : FPlane{ Vector4f{ 0, 0, 0, 1 } });
+
+	return Frustum;
+}
 
 bool FFrustum::IsUniformAABBVisible(const Vector4f& CenterPoint, const float BoxWidth) const
 {
@@ -69,6 +153,71 @@ FFrustum::Intersection FFrustum::IntersectsAABB(const Vector4f& CenterPoint, con
 	return Result;
 }
 
+void FFrustum::CullAABBBatch(const Vector4f* Centers, const uint32_t Count, const Vector3f& HalfExtents, uint8_t* VisibleOut) const
+{
+	static_assert(sizeof(Vector4f) == 4 * sizeof(float), "Box centers must be tightly packed.");
+
+	// Planes in SoA form. Every box has the same effective radius against a plane.
+	__m128 PlaneX[6], PlaneY[6], PlaneZ[6], PlaneW[6], NegRadius[6];
+	for (uint32_t p = 0; p < 6; p++)
+	{
+		const Vector4f& Plane = mPlanes[p].NormalwDistance;
+		PlaneX[p] = _mm_set1_ps(Plane.x);
+		PlaneY[p] = _mm_set1_ps(Plane.y);
+		PlaneZ[p] = _mm_set1_ps(Plane.z);
+		PlaneW[p] = _mm_set1_ps(Plane.w);
+		NegRadius[p] = _mm_set1_ps(-(std::abs(Plane.x) * HalfExtents.x + std::abs(Plane.y) * HalfExtents.y + std::abs(Plane.z) * HalfExtents.z));
+	}
+
+	for (uint32_t i = 0; i < Count; i += 4)
+	{
+		__m128 X, Y, Z, W;
+		LoadTransposed(&Centers[i].x, Count - i, X, Y, Z, W);
+
+		__m128 Visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (uint32_t p = 0; p < 6; p++)
+		{
+			const __m128 Distance = _mm_madd_ps(PlaneX[p], X, _mm_madd_ps(PlaneY[p], Y, _mm_madd_ps(PlaneZ[p], Z, PlaneW[p])));
+			Visible = _mm_and_ps(Visible, _mm_cmpgt_ps(Distance, NegRadius[p]));
+		}
+
+		StoreVisibility(_mm_movemask_ps(Visible), Count - i, VisibleOut + i);
+	}
+}
+
+void FFrustum::CullSphereBatch(const FSphere* Spheres, const uint32_t Count, uint8_t* VisibleOut) const
+{
+	static_assert(sizeof(FSphere) == 4 * sizeof(float), "Spheres must be tightly packed.");
+
+	// Planes in SoA form
+	__m128 PlaneX[6], PlaneY[6], PlaneZ[6], PlaneW[6];
+	for (uint32_t p = 0; p < 6; p++)
+	{
+		const Vector4f& Plane = mPlanes[p].NormalwDistance;
+		PlaneX[p] = _mm_set1_ps(Plane.x);
+		PlaneY[p] = _mm_set1_ps(Plane.y);
+		PlaneZ[p] = _mm_set1_ps(Plane.z);
+		PlaneW[p] = _mm_set1_ps(Plane.w);
+	}
+
+	for (uint32_t i = 0; i < Count; i += 4)
+	{
+		// W holds the sphere radii
+		__m128 X, Y, Z, W;
+		LoadTransposed(&Spheres[i].Center.x, Count - i, X, Y, Z, W);
+		const __m128 NegRadius = _mm_sub_ps(_mm_setzero_ps(), W);
+
+		__m128 Visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (uint32_t p = 0; p < 6; p++)
+		{
+			const __m128 Distance = _mm_madd_ps(PlaneX[p], X, _mm_madd_ps(PlaneY[p], Y, _mm_madd_ps(PlaneZ[p], Z, PlaneW[p])));
+			Visible = _mm_and_ps(Visible, _mm_cmpgt_ps(Distance, NegRadius));
+		}
+
+		StoreVisibility(_mm_movemask_ps(Visible), Count - i, VisibleOut + i);
+	}
+}
+
 void FFrustum::TransformBy(const FMatrix4& Transform)
 {
 	for (int32_t i = 0; i < 6; i++)
@@ -0,0 +1,152 @@
+#include "Math\Matrix4.h"
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+#ifdef __AVX__
+namespace
+{
+	/**
+	* DeinterleaveVector3 for 8 positions, with positions 0-3 in the low lanes and 4-7 in
+	* the high lanes. The shuffles don't cross lanes, so each half regroups like the SSE version.
+	*/
+	__forceinline void Deinterleave(const __m256 A, const __m256 B, const __m256 C, __m256& X, __m256& Y, __m256& Z)
+	{
+		X = _mm256_shuffle_ps(A, _mm256_shuffle_ps(B, C, SHUFFLE_PARAM(2, 2, 1, 1)), SHUFFLE_PARAM(0, 3, 0, 2));
+		Y = _mm256_shuffle_ps(_mm256_shuffle_ps(A, B, SHUFFLE_PARAM(1, 1, 0, 0)), _mm256_shuffle_ps(B, C, SHUFFLE_PARAM(3, 3, 2, 2)), SHUFFLE_PARAM(0, 2, 0, 2));
+		Z = _mm256_shuffle_ps(_mm256_shuffle_ps(A, B, SHUFFLE_PARAM(2, 2, 1, 1)), _mm256_shuffle_ps(C, C, SHUFFLE_PARAM(0, 0, 3, 3)), SHUFFLE_PARAM(0, 2, 0, 2));
+	}
+
+	__forceinline void Interleave(const __m256 X, const __m256 Y, const __m256 Z, __m256& A, __m256& B, __m256& C)
+	{
+		A = _mm256_shuffle_ps(_mm256_shuffle_ps(X, Y, SHUFFLE_PARAM(0, 0, 0, 0)), _mm256_shuffle_ps(Z, X, SHUFFLE_PARAM(0, 0, 1, 1)), SHUFFLE_PARAM(0, 2, 0, 2));
+		B = _mm256_shuffle_ps(_mm256_shuffle_ps(Y, Z, SHUFFLE_PARAM(1, 1, 1, 1)), _mm256_shuffle_ps(X, Y, SHUFFLE_PARAM(2, 2, 2, 2)), SHUFFLE_PARAM(0, 2, 0, 2));
+		C = _mm256_shuffle_ps(_mm256_shuffle_ps(Z, X, SHUFFLE_PARAM(2, 2, 3, 3)), _mm256_shuffle_ps(Y, Z, SHUFFLE_PARAM(3, 3, 3, 3)), SHUFFLE_PARAM(0, 2, 0, 2));
+	}
+
+	__forceinline __m256 LoadHalves(const float* Low, const float* High)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(Low)), _mm_loadu_ps(High), 1);
+	}
+
+	__forceinline void StoreHalves(float* Low, float* High, const __m256 Value)
+	{
+		_mm_storeu_ps(Low, _mm256_castps256_ps128(Value));
+		_mm_storeu_ps(High, _mm256_extractf128_ps(Value, 1));
+	}
+}
+#endif
+
+void FMatrix4::TransformPositions(const Vector3f* Positions, Vector3f* PositionsOut, const uint32_t Count) const
+{
+	static_assert(sizeof(Vector3f) == 3 * sizeof(float), "Positions must be tightly packed.");
+
+	const float* In = &Positions[0].x;
+	float* Out = &PositionsOut[0].x;
+	uint32_t i = 0;
+
+#ifdef __AVX__
+	__m256 Elements[4][3];
+	for (uint32_t Col = 0; Col < 4; Col++)
+	{
+		for (uint32_t Row = 0; Row < 3; Row++)
+			Elements[Col][Row] = _mm256_set1_ps(M[Col][Row]);
+	}
+
+	for (; i + 8 <= Count; i += 8)
+	{
+		const float* Block = In + i * 3;
+		__m256 X, Y, Z;
+		Deinterleave(LoadHalves(Block, Block + 12), LoadHalves(Block + 4, Block + 16), LoadHalves(Block + 8, Block + 20), X, Y, Z);
+
+		__m256 Transformed[3];
+		for (uint32_t Row = 0; Row < 3; Row++)
+		{
+			Transformed[Row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Elements[0][Row], X), _mm256_mul_ps(Elements[1][Row], Y)),
+				_mm256_add_ps(_mm256_mul_ps(Elements[2][Row], Z), Elements[3][Row]));
+		}
+
+		__m256 A, B, C;
+		Interleave(Transformed[0], Transformed[1], Transformed[2], A, B, C);
+
+		float* OutBlock = Out + i * 3;
+		StoreHalves(OutBlock, OutBlock + 12, A);
+		StoreHalves(OutBlock + 4, OutBlock + 16, B);
+		StoreHalves(OutBlock + 8, OutBlock + 20, C);
+	}
+#endif
+
+	// Matrix elements in every component, so each component of 4 positions is computed at once
+	__m128 Elements4[4][3];
+	for (uint32_t Col = 0; Col < 4; Col++)
+	{
+		for (uint32_t Row = 0; Row < 3; Row++)
+			Elements4[Col][Row] = _mm_set1_ps(M[Col][Row]);
+	}
+
+	for (; i + 4 <= Count; i += 4)
+	{
+		const float* Block = In + i * 3;
+		__m128 X, Y, Z;
+		DeinterleaveVector3(_mm_loadu_ps(Block), _mm_loadu_ps(Block + 4), _mm_loadu_ps(Block + 8), X, Y, Z);
+
+		__m128 Transformed[3];
+		for (uint32_t Row = 0; Row < 3; Row++)
+			Transformed[Row] = _mm_madd_ps(Elements4[0][Row], X, _mm_madd_ps(Elements4[1][Row], Y, _mm_madd_ps(Elements4[2][Row], Z, Elements4[3][Row])));
+
+		__m128 A, B, C;
+		InterleaveVector3(Transformed[0], Transformed[1], Transformed[2], A, B, C);
+
+		float* OutBlock = Out + i * 3;
+		_mm_storeu_ps(OutBlock, A);
+		_mm_storeu_ps(OutBlock + 4, B);
+		_mm_storeu_ps(OutBlock + 8, C);
+	}
+
+	for (; i < Count; i++)
+		PositionsOut[i] = TransformPosition(Positions[i]);
+}
+
+void FMatrix4::TransformVectors(const Vector4f* Vectors, Vector4f* VectorsOut, const uint32_t Count) const
+{
+	uint32_t i = 0;
+
+#ifdef __AVX__
+	// Columns in both halves, each half transforms its own vector
+	const __m256 Col0 = _mm256_broadcast_ps((const __m128*)M[0]);
+	const __m256 Col1 = _mm256_broadcast_ps((const __m128*)M[1]);
+	const __m256 Col2 = _mm256_broadcast_ps((const __m128*)M[2]);
+	const __m256 Col3 = _mm256_broadcast_ps((const __m128*)M[3]);
+
+	for (; i + 2 <= Count; i += 2)
+	{
+		const __m256 V = _mm256_loadu_ps(&Vectors[i].x);
+
+		__m256 Sum = _mm256_mul_ps(Col0, _mm256_shuffle_ps(V, V, SHUFFLE_PARAM(0, 0, 0, 0)));
+		Sum = _mm256_add_ps(Sum, _mm256_mul_ps(Col1, _mm256_shuffle_ps(V, V, SHUFFLE_PARAM(1, 1, 1, 1))));
+		Sum = _mm256_add_ps(Sum, _mm256_mul_ps(Col2, _mm256_shuffle_ps(V, V, SHUFFLE_PARAM(2, 2, 2, 2))));
+		Sum = _mm256_add_ps(Sum, _mm256_mul_ps(Col3, _mm256_shuffle_ps(V, V, SHUFFLE_PARAM(3, 3, 3, 3))));
+
+		_mm256_storeu_ps(&VectorsOut[i].x, Sum);
+	}
+#endif
+
+	// Columns stay in registers for the whole batch
+	const __m128 MCol0 = LoadVector(M[0]);
+	const __m128 MCol1 = LoadVector(M[1]);
+	const __m128 MCol2 = LoadVector(M[2]);
+	const __m128 MCol3 = LoadVector(M[3]);
+
+	for (; i < Count; i++)
+	{
+		const __m128 V = LoadVector(&Vectors[i].x);
+
+		__m128 Sum = _mm_mul_ps(MCol0, _mm_replicate_x_ps(V));
+		Sum = _mm_madd_ps(MCol1, _mm_replicate_y_ps(V), Sum);
+		Sum = _mm_madd_ps(MCol2, _mm_replicate_z_ps(V), Sum);
+		Sum = _mm_madd_ps(MCol3, _mm_replicate_w_ps(V), Sum);
+
+		StoreVector(&VectorsOut[i].x, Sum);
+	}
+}
@@ -0,0 +1,211 @@
+#include "Math\SIMDNoise.h"
+#include "Math\SSEMath.h"
+
+namespace
+{
+	// LibNoise's table of random unit gradients, each padded to 4 components.
+	// Included in this namespace so it doesn't clash with the library's copy.
+	#include "LibNoise\vectortable.h"
+
+	// Lattice hashing constants of LibNoise
+	const int32_t X_NOISE_GEN = 1619;
+	const int32_t Y_NOISE_GEN = 31337;
+	const int32_t Z_NOISE_GEN = 6971;
+	const int32_t SEED_NOISE_GEN = 1013;
+	const int32_t SHIFT_NOISE_GEN = 8;
+
+	// Scale of gradient noise output to about [-1, 1]
+	const float GRADIENT_SCALE = 2.12f;
+
+	/**
+	* The gradient table as floats, so gradients load straight into registers.
+	*/
+	struct FGradientTable
+	{
+		float Gradients[256 * 4];
+
+		FGradientTable()
+		{
+			for (uint32_t i = 0; i < 256 * 4; i++)
+				Gradients[i] = (float)noise::g_randomVectors[i];
+		}
+	};
+
+	const FGradientTable GRADIENT_TABLE;
+
+	/**
+	* Multiplies 32 bit integers, keeping the low 32 bits of each product.
+	* SSE2 only has an unsigned 32 to 64 bit multiply of even lanes.
+	*/
+	__forceinline __m128i MultiplyInt(const __m128i A, const __m128i B)
+	{
+		const __m128i Even = _mm_mul_epu32(A, B);
+		const __m128i Odd = _mm_mul_epu32(_mm_srli_si128(A, 4), _mm_srli_si128(B, 4));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(Even, SHUFFLE_PARAM(0, 2, 0, 0)), _mm_shuffle_epi32(Odd, SHUFFLE_PARAM(0, 2, 0, 0)));
+	}
+
+	/**
+	* The lattice cell of each coordinate. LibNoise truncates positive values
+	* and truncates then subtracts 1 from the rest, so 0 is in cell -1.
+	*/
+	__forceinline __m128i LatticeCell(const __m128 Value)
+	{
+		// The comparison mask is -1 where 1 is subtracted
+		const __m128i IsNotPositive = _mm_castps_si128(_mm_cmple_ps(Value, _mm_setzero_ps()));
+		return _mm_add_epi32(_mm_cvttps_epi32(Value), IsNotPositive);
+	}
+
+	__forceinline __m128 SCurve(const __m128 Value, const FSIMDNoise::Quality NoiseQuality)
+	{
+		if (NoiseQuality == FSIMDNoise::Fast)
+			return Value;
+
+		const __m128 Squared = _mm_mul_ps(Value, Value);
+
+		// 3a^2 - 2a^3
+		if (NoiseQuality == FSIMDNoise::Standard)
+			return _mm_mul_ps(Squared, _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(Value, Value)));
+
+		// 6a^5 - 15a^4 + 10a^3
+		const __m128 Polynomial = _mm_madd_ps(Value, _mm_madd_ps(Value, _mm_set1_ps(6.0f), _mm_set1_ps(-15.0f)), _mm_set1_ps(10.0f));
+		return _mm_mul_ps(_mm_mul_ps(Squared, Value), Polynomial);
+	}
+
+	__forceinline __m128 LinearInterp(const __m128 N0, const __m128 N1, const __m128 Alpha)
+	{
+		// Same form as LibNoise, (1 - a) * n0 + a * n1
+		return _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), Alpha), N0), _mm_mul_ps(Alpha, N1));
+	}
+
+	/**
+	* Gradient noise from the lattice point at IX, IY, IZ for each point.
+	*/
+	__forceinline __m128 GradientNoise(const __m128 X, const __m128 Y, const __m128 Z, const __m128i IX, const __m128i IY, const __m128i IZ, const __m128i SeedTerm)
+	{
+		__m128i Index = _mm_add_epi32(MultiplyInt(IX, _mm_set1_epi32(X_NOISE_GEN)), MultiplyInt(IY, _mm_set1_epi32(Y_NOISE_GEN)));
+		Index = _mm_add_epi32(Index, _mm_add_epi32(MultiplyInt(IZ, _mm_set1_epi32(Z_NOISE_GEN)), SeedTerm));
+		Index = _mm_xor_si128(Index, _mm_srai_epi32(Index, SHIFT_NOISE_GEN));
+		Index = _mm_and_si128(Index, _mm_set1_epi32(0xff));
+
+		// Gather each point's gradient, then transpose so registers hold one component each
+		int32_t Indices[FSIMDNoise::LANE_COUNT];
+		_mm_storeu_si128((__m128i*)Indices, Index);
+
+		__m128 GradientX = _mm_loadu_ps(&GRADIENT_TABLE.Gradients[Indices[0] << 2]);
+		__m128 GradientY = _mm_loadu_ps(&GRADIENT_TABLE.Gradients[Indices[1] << 2]);
+		__m128 GradientZ = _mm_loadu_ps(&GRADIENT_TABLE.Gradients[Indices[2] << 2]);
+		__m128 Padding = _mm_loadu_ps(&GRADIENT_TABLE.Gradients[Indices[3] << 2]);
+		_MM_TRANSPOSE4_PS(GradientX, GradientY, GradientZ, Padding);
+
+		const __m128 PointX = _mm_sub_ps(X, _mm_cvtepi32_ps(IX));
+		const __m128 PointY = _mm_sub_ps(Y, _mm_cvtepi32_ps(IY));
+		const __m128 PointZ = _mm_sub_ps(Z, _mm_cvtepi32_ps(IZ));
+
+		__m128 Dot = _mm_mul_ps(GradientX, PointX);
+		Dot = _mm_madd_ps(GradientY, PointY, Dot);
+		Dot = _mm_madd_ps(GradientZ, PointZ, Dot);
+		return _mm_mul_ps(Dot, _mm_set1_ps(GRADIENT_SCALE));
+	}
+
+	/**
+	* Coherent gradient noise at each point, as noise::GradientCoherentNoise3D.
+	*/
+	__m128 GradientCoherentNoise(const __m128 X, const __m128 Y, const __m128 Z, const int32_t Seed, const FSIMDNoise::Quality NoiseQuality)
+	{
+		const __m128i One = _mm_set1_epi32(1);
+		const __m128i X0 = LatticeCell(X);
+		const __m128i Y0 = LatticeCell(Y);
+		const __m128i Z0 = LatticeCell(Z);
+		const __m128i X1 = _mm_add_epi32(X0, One);
+		const __m128i Y1 = _mm_add_epi32(Y0, One);
+		const __m128i Z1 = _mm_add_epi32(Z0, One);
+
+		const __m128 XS = SCurve(_mm_sub_ps(X, _mm_cvtepi32_ps(X0)), NoiseQuality);
+		const __m128 YS = SCurve(_mm_sub_ps(Y, _mm_cvtepi32_ps(Y0)), NoiseQuality);
+		const __m128 ZS = SCurve(_mm_sub_ps(Z, _mm_cvtepi32_ps(Z0)), NoiseQuality);
+
+		const __m128i SeedTerm = _mm_set1_epi32(SEED_NOISE_GEN * Seed);
+
+		// Interpolate the 8 corners of the cell along x, then y, then z
+		__m128 IX0 = LinearInterp(GradientNoise(X, Y, Z, X0, Y0, Z0, SeedTerm), GradientNoise(X, Y, Z, X1, Y0, Z0, SeedTerm), XS);
+		__m128 IX1 = LinearInterp(GradientNoise(X, Y, Z, X0, Y1, Z0, SeedTerm), GradientNoise(X, Y, Z, X1, Y1, Z0, SeedTerm), XS);
+		const __m128 IY0 = LinearInterp(IX0, IX1, YS);
+
+		IX0 = LinearInterp(GradientNoise(X, Y, Z, X0, Y0, Z1, SeedTerm), GradientNoise(X, Y, Z, X1, Y0, Z1, SeedTerm), XS);
+		IX1 = LinearInterp(GradientNoise(X, Y, Z, X0, Y1, Z1, SeedTerm), GradientNoise(X, Y, Z, X1, Y1, Z1, SeedTerm), XS);
+		const __m128 IY1 = LinearInterp(IX0, IX1, YS);
+
+		return LinearInterp(IY0, IY1, ZS);
+	}
+}
+
+FSIMDNoise::FSIMDNoise()
+	: mParameters()
+{
+	mParameters.Frequency = 1.0f;
+	mParameters.Lacunarity = 2.0f;
+	mParameters.Persistence = 0.5f;
+	mParameters.OctaveCount = 6;
+	mParameters.Seed = 0;
+	mParameters.NoiseQuality = Standard;
+}
+
+FSIMDNoise::FSIMDNoise(const Parameters& NoiseParameters)
+	: mParameters(NoiseParameters)
+{
+}
+
+void FSIMDNoise::GetValues(const float* X, const float* Y, const float* Z, float* ValuesOut) const
+{
+	const __m128 Frequency = _mm_set1_ps(mParameters.Frequency);
+	const __m128 Lacunarity = _mm_set1_ps(mParameters.Lacunarity);
+
+	__m128 OctaveX = _mm_mul_ps(_mm_loadu_ps(X), Frequency);
+	__m128 OctaveY = _mm_mul_ps(_mm_loadu_ps(Y), Frequency);
+	__m128 OctaveZ = _mm_mul_ps(_mm_loadu_ps(Z), Frequency);
+	__m128 Value = _mm_setzero_ps();
+	float Persistence = 1.0f;
+
+	// Float coordinates lose lattice precision long before LibNoise wraps them
+	// into integer range, so that wrap is not done here.
+	for (int32_t Octave = 0; Octave < mParameters.OctaveCount; Octave++)
+	{
+		const __m128 Signal = GradientCoherentNoise(OctaveX, OctaveY, OctaveZ, mParameters.Seed + Octave, mParameters.NoiseQuality);
+		Value = _mm_madd_ps(Signal, _mm_set1_ps(Persistence), Value);
+
+		OctaveX = _mm_mul_ps(OctaveX, Lacunarity);
+		OctaveY = _mm_mul_ps(OctaveY, Lacunarity);
+		OctaveZ = _mm_mul_ps(OctaveZ, Lacunarity);
+		Persistence *= mParameters.Persistence;
+	}
+
+	_mm_storeu_ps(ValuesOut, Value);
+}
+
+void FSIMDNoise::GetRow(const double X, const double XStep, const double Y, const double Z, const uint32_t Count, float* ValuesOut) const
+{
+	float XValues[LANE_COUNT];
+	float YValues[LANE_COUNT];
+	float ZValues[LANE_COUNT];
+	float Values[LANE_COUNT];
+
+	for (uint32_t i = 0; i < LANE_COUNT; i++)
+	{
+		YValues[i] = (float)Y;
+		ZValues[i] = (float)Z;
+	}
+
+	for (uint32_t First = 0; First < Count; First += LANE_COUNT)
+	{
+		// Positions are found in double precision like the sampled bounds
+		for (uint32_t i = 0; i < LANE_COUNT; i++)
+			XValues[i] = (float)(X + (First + i) * XStep);
+
+		GetValues(XValues, YValues, ZValues, Values);
+
+		// The last group may have unused lanes
+		const uint32_t ValueCount = (Count - First < LANE_COUNT) ? Count - First : LANE_COUNT;
+		for (uint32_t i = 0; i < ValueCount; i++)
+			ValuesOut[First + i] = Values[i];
+	}
+}
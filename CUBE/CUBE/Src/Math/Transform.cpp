@@ -1,30 +1,75 @@
 #include "Math\Transform.h"
+#include "Math\Matrix4A.h"
+#include <atomic>
 
+namespace
+{
+	// The last revision handed out, none of them are 0
+	std::atomic<uint32_t> LastRevision(0);
+}
+
+uint32_t FTransform::NewRevision()
+{
+	return ++LastRevision;
+}
 
 Vector3f FTransform::GetWorldPosition() const
 {
 	if (!mParent)
 		return mTranslation;
 
-	return mParent->GetWorldPosition() + mTranslation;
+	return LocalToWorldMatrix().GetOrigin();
 }
 
-FMatrix4 FTransform::LocalToWorldMatrix() const
+FMatrix4 FTransform::LocalMatrix() const
 {
-	FMatrix4 LocalToWorld;
-	LocalToWorld.Scale(mScale);
-	LocalToWorld *= mRotation.ToMatrix4();
-	LocalToWorld.SetOrigin(mTranslation);
+	if (mLocalRevision == mRevision)
+		return mLocal;
 
+	FMatrix4 Local;
+	FMatrix4A::FromScaleRotationTranslation(FVector4A{ mScale, 0.0f }, mRotation, FVector4A{ mTranslation, 1.0f }).Store(Local);
+	return Local;
+}
+
+FMatrix4 FTransform::LocalToWorldMatrix() const
+{
 	if (!mParent)
-	{
-		return LocalToWorld;
-	}
+		return LocalMatrix();
 
-	return mParent->LocalToWorldMatrix() * LocalToWorld;
+	if (mLocalToWorldRevision == GetRevision())
+		return mLocalToWorld;
+
+	FMatrix4 LocalToWorld;
+	(FMatrix4A{ mParent->LocalToWorldMatrix() } * FMatrix4A{ LocalMatrix() }).Store(LocalToWorld);
+	return LocalToWorld;
 }
 
 FMatrix4 FTransform::WorldToLocalMatrix() const
 {
-	return LocalToWorldMatrix().GetInverse();
-}
\ No newline at end of file
+	// The local matrix scales, rotates and translates, so the inverse is the negated
+	// translation, the transposed rotation and the reciprocal scale
+	const FMatrix4A Inverse = FMatrix4A{ LocalMatrix() }.GetInverseScaledAffine(FVector4A{ mScale, 0.0f });
+
+	FMatrix4 WorldToLocal;
+	if (mParent)
+		(Inverse * FMatrix4A{ mParent->WorldToLocalMatrix() }).Store(WorldToLocal);
+	else
+		Inverse.Store(WorldToLocal);
+	return WorldToLocal;
+}
+
+void FTransform::UpdateMatrices()
+{
+	if (mLocalRevision != mRevision)
+	{
+		mLocal = LocalMatrix();
+		mLocalRevision = mRevision;
+	}
+
+	const uint32_t Revision = GetRevision();
+	if (mParent && mLocalToWorldRevision != Revision)
+	{
+		mLocalToWorld = LocalToWorldMatrix();
+		mLocalToWorldRevision = Revision;
+	}
+}
@@ -0,0 +1,15 @@
+#include "Memory\ConcurrentPoolAllocator.h"
+
+namespace
+{
+	std::atomic<uint32_t> NextThreadSlot(0);
+	__declspec(thread) uint32_t ThreadSlot = UINT32_MAX;
+}
+
+uint32_t SPoolThreadSlot::Get()
+{
+	if (ThreadSlot == UINT32_MAX)
+		ThreadSlot = NextThreadSlot++;
+
+	return ThreadSlot;
+}
@@ -0,0 +1,60 @@
+#include "Memory\FrameAllocator.h"
+#include "Misc\Assertions.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	// The scratch stack of each thread, created the first time the thread asks for it
+	__declspec(thread) FStackAllocator* ThreadScratch = nullptr;
+
+	// Every scratch stack created, so they can be freed at shutdown
+	std::mutex ScratchMutex;
+	std::vector<std::unique_ptr<FStackAllocator>> ScratchStacks;
+}
+
+void SFrameAllocator::Init(const uint32_t FrameBytes, const uint32_t ScratchBytes)
+{
+	ASSERT(!mFrames[0] && "Frame allocator is already initialized.");
+
+	mFrames[0] = new FStackAllocator(FrameBytes);
+	mFrames[1] = new FStackAllocator(FrameBytes);
+	mCurrentFrame = 0;
+	mScratchBytes = ScratchBytes;
+}
+
+void SFrameAllocator::Shutdown()
+{
+	delete mFrames[0];
+	delete mFrames[1];
+	mFrames[0] = mFrames[1] = nullptr;
+
+	std::lock_guard<std::mutex> Lock(ScratchMutex);
+	ScratchStacks.clear();
+}
+
+void SFrameAllocator::BeginFrame()
+{
+	mCurrentFrame ^= 1;
+	mFrames[mCurrentFrame]->Clear();
+}
+
+FStackAllocator& SFrameAllocator::GetScratch()
+{
+	if (!ThreadScratch)
+	{
+		ASSERT(mScratchBytes > 0 && "Frame allocator is not initialized.");
+		ThreadScratch = new FStackAllocator(mScratchBytes);
+
+		std::lock_guard<std::mutex> Lock(ScratchMutex);
+		ScratchStacks.push_back(std::unique_ptr<FStackAllocator>(ThreadScratch));
+	}
+
+	return *ThreadScratch;
+}
+
+FStackAllocator* SFrameAllocator::mFrames[2] = { nullptr, nullptr };
+uint32_t SFrameAllocator::mCurrentFrame(0);
+uint32_t SFrameAllocator::mScratchBytes(0);
@@ -0,0 +1,90 @@
+#include "Memory\MemoryStats.h"
+#include "Debugging\ConsoleOutput.h"
+#include "Misc\Assertions.h"
+
+#include <cstring>
+
+namespace
+{
+	const char* const TAG_NAMES[EMemoryTag::Count] =
+	{
+		"ChunkBlocks",
+		"ChunkMeshes",
+		"ChunkGeometry",
+		"RegionFiles",
+		"Components",
+		"Textures",
+		"ChunkCache"
+	};
+}
+
+const float SMemoryStats::LOG_INTERVAL = 60.0f;
+
+std::atomic<uint64_t> SMemoryStats::LiveBytes[EMemoryTag::Count];
+std::atomic<uint64_t> SMemoryStats::PeakBytes[EMemoryTag::Count];
+std::atomic<uint64_t> SMemoryStats::Budgets[EMemoryTag::Count];
+float SMemoryStats::TimeSinceLog = 0.0f;
+
+void SMemoryStats::Allocate(const EMemoryTag::Type Tag, const uint64_t Bytes)
+{
+	ASSERT(Tag < EMemoryTag::Count);
+
+	const uint64_t Live = LiveBytes[Tag].fetch_add(Bytes, std::memory_order_relaxed) + Bytes;
+
+	// Another thread may raise the mark meanwhile, then the exchange fails and Peak is reloaded
+	uint64_t Peak = PeakBytes[Tag].load(std::memory_order_relaxed);
+	while (Live > Peak && !PeakBytes[Tag].compare_exchange_weak(Peak, Live, std::memory_order_relaxed))
+		;
+}
+
+void SMemoryStats::Free(const EMemoryTag::Type Tag, const uint64_t Bytes)
+{
+	ASSERT(Tag < EMemoryTag::Count);
+	ASSERT(LiveBytes[Tag].load(std::memory_order_relaxed) >= Bytes && "Freed more memory than was allocated.");
+
+	LiveBytes[Tag].fetch_sub(Bytes, std::memory_order_relaxed);
+}
+
+bool SMemoryStats::IsOverBudget(const EMemoryTag::Type Tag)
+{
+	const uint64_t Budget = GetBudget(Tag);
+	return Budget != 0 && GetLiveBytes(Tag) > Budget;
+}
+
+const char* SMemoryStats::GetName(const EMemoryTag::Type Tag)
+{
+	ASSERT(Tag < EMemoryTag::Count);
+	return TAG_NAMES[Tag];
+}
+
+EMemoryTag::Type SMemoryStats::FindTag(const char* Name)
+{
+	for (uint32_t i = 0; i < EMemoryTag::Count; i++)
+	{
+		if (strcmp(TAG_NAMES[i], Name) == 0)
+			return (EMemoryTag::Type)i;
+	}
+
+	return EMemoryTag::Count;
+}
+
+void SMemoryStats::Update(const float DeltaTime)
+{
+	TimeSinceLog += DeltaTime;
+	if (TimeSinceLog < LOG_INTERVAL)
+		return;
+
+	TimeSinceLog = 0.0f;
+	Log();
+}
+
+void SMemoryStats::Log()
+{
+	FDebug::PrintF("Memory (live / peak / budget KB):\n");
+	for (uint32_t i = 0; i < EMemoryTag::Count; i++)
+	{
+		const EMemoryTag::Type Tag = (EMemoryTag::Type)i;
+		FDebug::PrintF("    %-14s %10llu %10llu %10llu%s\n", GetName(Tag), GetLiveBytes(Tag) / 1024, GetPeakBytes(Tag) / 1024,
+			GetBudget(Tag) / 1024, IsOverBudget(Tag) ? "  over budget" : "");
+	}
+}
@@ -0,0 +1,82 @@
+#include "Memory\PageSource.h"
+#include "SystemResources\SystemVirtualMemory.h"
+#include "Misc\Assertions.h"
+
+namespace
+{
+	size_t AlignUp(const size_t Value, const size_t Alignment)
+	{
+		return (Value + Alignment - 1) / Alignment * Alignment;
+	}
+}
+
+FVirtualPageSource::FVirtualPageSource()
+	: mRanges()
+	, mUsed(0)
+{
+}
+
+FVirtualPageSource::~FVirtualPageSource()
+{
+	for (const Range& Entry : mRanges)
+		SVirtualMemory::Release(Entry.Base);
+}
+
+void* FVirtualPageSource::Allocate(const uint32_t Bytes, const uint32_t Alignment)
+{
+	ASSERT(Alignment <= SVirtualMemory::GetPageSize() && "Pages can't be aligned past the system page size.");
+
+	size_t Offset = AlignUp(mUsed, Alignment);
+	if (mRanges.empty() || Offset + Bytes > mRanges.back().Size)
+	{
+		if (!AddRange(Bytes))
+			return nullptr;
+
+		Offset = 0;
+	}
+
+	Range& Last = mRanges.back();
+	if (Offset + Bytes > Last.Committed)
+	{
+		const size_t Committed = AlignUp(Offset + Bytes, SVirtualMemory::GetPageSize());
+		if (!SVirtualMemory::Commit(Last.Base + Last.Committed, Committed - Last.Committed))
+			return nullptr;
+
+		Last.Committed = Committed;
+	}
+
+	mUsed = Offset + Bytes;
+	return Last.Base + Offset;
+}
+
+bool FVirtualPageSource::AddRange(const size_t Bytes)
+{
+	Range NewRange;
+
+	// Large pages can't be reserved ahead, they are always committed and resident
+	const size_t LargePageSize = SVirtualMemory::GetLargePageSize();
+	if (LargePageSize != 0)
+	{
+		NewRange.Size = AlignUp(Bytes, LargePageSize);
+		NewRange.Base = (uint8_t*)SVirtualMemory::AllocateLargePages(NewRange.Size);
+		NewRange.Committed = NewRange.Size;
+
+		if (NewRange.Base)
+		{
+			mRanges.push_back(NewRange);
+			mUsed = 0;
+			return true;
+		}
+	}
+
+	NewRange.Size = AlignUp(Bytes > RESERVE_BYTES ? Bytes : RESERVE_BYTES, SVirtualMemory::GetPageSize());
+	NewRange.Base = (uint8_t*)SVirtualMemory::Reserve(NewRange.Size);
+	NewRange.Committed = 0;
+
+	if (!NewRange.Base)
+		return false;
+
+	mRanges.push_back(NewRange);
+	mUsed = 0;
+	return true;
+}
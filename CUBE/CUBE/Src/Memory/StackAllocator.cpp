@@ -31,6 +31,19 @@ void* FStackAllocator::Allocate(const uint32_t Bytes, const uint32_t Alignment)
 	return Allocate(Bytes);
 }
 
+void* FStackAllocator::TryAllocate(const uint32_t Bytes, const uint32_t Alignment)
+{
+	ASSERT((Alignment & (Alignment - 1)) == 0x0 && Alignment > 0 && "Alignments must be a power of 2.");
+
+	const uintptr_t DataAddress = reinterpret_cast<uintptr_t>(&mData[mCurrentMarker]);
+	const uint32_t Adjustment = (Alignment - (DataAddress & (Alignment - 1))) & (Alignment - 1);
+	if (Bytes > mCapacity - mCurrentMarker || Adjustment > mCapacity - mCurrentMarker - Bytes)
+		return nullptr;
+
+	mCurrentMarker += Adjustment;
+	return Allocate(Bytes);
+}
+
 FStackAllocator::UMarker FStackAllocator::GetMarker() const
 {
 	return mCurrentMarker;
@@ -47,6 +60,12 @@ void FStackAllocator::ClearToMarker(const UMarker Marker)
 	mCurrentMarker = Marker;
 }
 
+bool FStackAllocator::Owns(const void* Data) const
+{
+	const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+	return Bytes >= mData && Bytes < mData + mCapacity;
+}
+
 
 void FStackAllocator::AlignData(const uint32_t Alignment)
 {
@@ -0,0 +1,42 @@
+#include "Physics\CollisionShapeRegistry.h"
+
+std::mutex FCollisionShapeRegistry::ShapeMutex;
+std::map<FCollisionShapeRegistry::ShapeKey, std::weak_ptr<FCollisionShapeRegistry::SharedShape>> FCollisionShapeRegistry::Shapes;
+
+template <typename CreateFunction>
+FCollisionShapeRegistry::ShapeHandle FCollisionShapeRegistry::FindOrCreate(const ShapeKey& Key, const CreateFunction& Create)
+{
+	std::lock_guard<std::mutex> Lock(ShapeMutex);
+
+	auto Record = Shapes.find(Key);
+	if (Record != Shapes.end())
+	{
+		std::shared_ptr<SharedShape> Shape = Record->second.lock();
+		if (Shape)
+			return Shape;
+	}
+
+	std::shared_ptr<SharedShape> Shape{ new SharedShape{} };
+	Shape->Shape.reset(Create());
+	Shape->Shape->calculateLocalInertia(1, Shape->UnitInertia);
+
+	// Expired records are replaced here, so the map only grows with distinct shapes
+	Shapes[Key] = Shape;
+	return Shape;
+}
+
+FCollisionShapeRegistry::ShapeHandle FCollisionShapeRegistry::GetCapsule(const btScalar Radius, const btScalar Height)
+{
+	return FindOrCreate(ShapeKey{ ShapeType::Capsule, Radius, Height, 0 }, [&]()
+	{
+		return new btCapsuleShape(Radius, Height);
+	});
+}
+
+FCollisionShapeRegistry::ShapeHandle FCollisionShapeRegistry::GetBox(const btVector3& HalfExtents)
+{
+	return FindOrCreate(ShapeKey{ ShapeType::Box, HalfExtents.x(), HalfExtents.y(), HalfExtents.z() }, [&]()
+	{
+		return new btBoxShape(HalfExtents);
+	});
+}
@@ -0,0 +1,79 @@
+#include "Physics\ParallelDispatcher.h"
+#include "Physics\PhysicsTaskPool.h"
+#include "Misc\Assertions.h"
+
+FParallelDispatcher::ConvexConvexAlgorithm::ConvexConvexAlgorithm(btPersistentManifold* Manifold, const btCollisionAlgorithmConstructionInfo& Info,
+																  const btCollisionObjectWrapper* Body0, const btCollisionObjectWrapper* Body1,
+																  btConvexPenetrationDepthSolver* PenetrationSolver, int PerturbationIterations, int PerturbationThreshold)
+	: btConvexConvexAlgorithm(Manifold, Info, Body0, Body1, &mSimplexSolver, PenetrationSolver, PerturbationIterations, PerturbationThreshold)
+	, mSimplexSolver()
+{
+}
+
+btCollisionAlgorithm* FParallelDispatcher::ConvexConvexCreateFunc::CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& Info, const btCollisionObjectWrapper* Body0, const btCollisionObjectWrapper* Body1)
+{
+	void* Memory = Info.m_dispatcher1->allocateCollisionAlgorithm(sizeof(ConvexConvexAlgorithm));
+	return new (Memory) ConvexConvexAlgorithm(Info.m_manifold, Info, Body0, Body1, PenetrationSolver, PerturbationIterations, PerturbationThreshold);
+}
+
+FParallelDispatcher::FParallelDispatcher(btDefaultCollisionConfiguration& CollisionConfig)
+	: btCollisionDispatcher(&CollisionConfig)
+	, mConvexConvexCreateFunc(*static_cast<btConvexConvexAlgorithm::CreateFunc*>(CollisionConfig.getCollisionAlgorithmCreateFunc(BOX_SHAPE_PROXYTYPE, CAPSULE_SHAPE_PROXYTYPE)))
+	, mTaskPool(nullptr)
+	, mPoolMutex()
+{
+	ASSERT(CollisionConfig.getCollisionAlgorithmPool()->getElementSize() >= ALGORITHM_SIZE && "The collision configuration must fit every algorithm.");
+
+	// Every pair that would use the shared simplex solver uses our algorithm instead
+	btCollisionAlgorithmCreateFunc* DefaultFunc = CollisionConfig.getCollisionAlgorithmCreateFunc(BOX_SHAPE_PROXYTYPE, CAPSULE_SHAPE_PROXYTYPE);
+	for (int i = 0; i < MAX_BROADPHASE_COLLISION_TYPES; i++)
+	{
+		for (int j = 0; j < MAX_BROADPHASE_COLLISION_TYPES; j++)
+		{
+			if (m_doubleDispatch[i][j] == DefaultFunc)
+				m_doubleDispatch[i][j] = &mConvexConvexCreateFunc;
+		}
+	}
+}
+
+void FParallelDispatcher::dispatchAllCollisionPairs(btOverlappingPairCache* PairCache, const btDispatcherInfo& DispatchInfo, btDispatcher* Dispatcher)
+{
+	btBroadphasePairArray& Pairs = PairCache->getOverlappingPairArray();
+	if (!mTaskPool || (uint32_t)Pairs.size() < MIN_PARALLEL_PAIRS)
+	{
+		btCollisionDispatcher::dispatchAllCollisionPairs(PairCache, DispatchInfo, Dispatcher);
+		return;
+	}
+
+	// The default pair callback never removes pairs, so the array stays put
+	const btNearCallback NearCallback = getNearCallback();
+	mTaskPool->ParallelFor(Pairs.size(), [&](const uint32_t Index, const uint32_t Worker)
+	{
+		NearCallback(Pairs[Index], *this, DispatchInfo);
+		(void)Worker;
+	});
+}
+
+btPersistentManifold* FParallelDispatcher::getNewManifold(const btCollisionObject* Body0, const btCollisionObject* Body1)
+{
+	std::lock_guard<std::mutex> Lock(mPoolMutex);
+	return btCollisionDispatcher::getNewManifold(Body0, Body1);
+}
+
+void FParallelDispatcher::releaseManifold(btPersistentManifold* Manifold)
+{
+	std::lock_guard<std::mutex> Lock(mPoolMutex);
+	btCollisionDispatcher::releaseManifold(Manifold);
+}
+
+void* FParallelDispatcher::allocateCollisionAlgorithm(int Size)
+{
+	std::lock_guard<std::mutex> Lock(mPoolMutex);
+	return btCollisionDispatcher::allocateCollisionAlgorithm(Size);
+}
+
+void FParallelDispatcher::freeCollisionAlgorithm(void* Algorithm)
+{
+	std::lock_guard<std::mutex> Lock(mPoolMutex);
+	btCollisionDispatcher::freeCollisionAlgorithm(Algorithm);
+}
@@ -1,24 +1,133 @@
 #include "Physics\PhysicsSystem.h"
 #include "STime.h"
+#include "Misc\Assertions.h"
 #include "Components\RigidBody.h"
 #include "Components\Collider.h"
 #include "Debugging\DebugDraw.h"
 #include "SFML\Window\Keyboard.hpp"
+#include "Debugging\CPUProfiler.h"
+#include "Clock.h"
+
+namespace
+{
+	/**
+	* Collision configuration with room for the algorithms of FParallelDispatcher.
+	*/
+	btDefaultCollisionConstructionInfo CollisionConstructionInfo()
+	{
+		btDefaultCollisionConstructionInfo Info;
+		Info.m_customCollisionAlgorithmMaxElementSize = FParallelDispatcher::ALGORITHM_SIZE;
+		return Info;
+	}
+
+	/**
+	* Gathers the objects of broadphase proxies that respond to contacts.
+	*/
+	struct CandidateCollector : public btBroadphaseAabbCallback
+	{
+		explicit CandidateCollector(btAlignedObjectArray<btCollisionObject*>& Candidates)
+			: Candidates(Candidates)
+		{}
+
+		bool process(const btBroadphaseProxy* Proxy) override
+		{
+			btCollisionObject* Object = static_cast<btCollisionObject*>(Proxy->m_clientObject);
+			if (Object->hasContactResponse())
+				Candidates.push_back(Object);
+
+			return true;
+		}
+
+		btAlignedObjectArray<btCollisionObject*>& Candidates;
+	};
+
+	/**
+	* Closest hit of a body's swept sphere, skipping the body, the terrain and
+	* objects the body doesn't collide with.
+	*/
+	struct SweepCallback : public btCollisionWorld::ClosestConvexResultCallback
+	{
+		SweepCallback(const btCollisionObject* Body, const btCollisionObject* Terrain, const btVector3& From, const btVector3& To, const btScalar AllowedPenetration)
+			: ClosestConvexResultCallback(From, To)
+			, Body(Body)
+			, Terrain(Terrain)
+			, AllowedPenetration(AllowedPenetration)
+		{}
+
+		bool needsCollision(btBroadphaseProxy* Proxy) const override
+		{
+			const btCollisionObject* Object = static_cast<const btCollisionObject*>(Proxy->m_clientObject);
+			if (Object == Body || Object == Terrain || !Object->hasContactResponse())
+				return false;
+
+			return ClosestConvexResultCallback::needsCollision(Proxy) && Body->checkCollideWith(Object);
+		}
+
+		btScalar addSingleResult(btCollisionWorld::LocalConvexResult& Result, bool IsNormalInWorldSpace) override
+		{
+			// Motion away from a surface, or just into it, isn't stopped
+			if (Result.m_hitNormalLocal.dot(m_convexToWorld - m_convexFromWorld) >= -AllowedPenetration)
+				return 1;
+
+			return ClosestConvexResultCallback::addSingleResult(Result, IsNormalInWorldSpace);
+		}
+
+		const btCollisionObject* Body;
+		const btCollisionObject* Terrain;
+		btScalar                 AllowedPenetration;
+	};
+
+	/**
+	* Notes if a contact test found any penetrating point.
+	*/
+	struct OverlapCallback : public btCollisionWorld::ContactResultCallback
+	{
+		OverlapCallback()
+			: HasOverlap(false)
+		{}
+
+		btScalar addSingleResult(btManifoldPoint& Point, const btCollisionObjectWrapper* Object0, int Part0, int Index0, const btCollisionObjectWrapper* Object1, int Part1, int Index1) override
+		{
+			(void)Object0; (void)Part0; (void)Index0;
+			(void)Object1; (void)Part1; (void)Index1;
+
+			HasOverlap = HasOverlap || Point.getDistance() <= 0;
+			return 0;
+		}
+
+		bool HasOverlap;
+	};
+}
 
 FPhysicsSystem::FPhysicsSystem(Atlas::FWorld& World)
 	: ISystem(World)
-	, mRigidBodyMutex()
-	, mRigidBodyQueue()
-	, mColliderMutex()
-	, mColliderQueue()
-	, mCollisionConfig()
-	, mCollisionDispatcher(&mCollisionConfig)
+	, mCommandQueue()
+	, mUpdateThread(std::this_thread::get_id())
+	, mCommandBatch()
+	, mPendingAdds()
+	, mMaxSubSteps(DEFAULT_MAX_SUB_STEPS)
+	, mResidentMin(0, 0, 0)
+	, mResidentMax(0, 0, 0)
+	, mHasResidentBox(false)
+	, mStepThread()
+	, mStepMutex()
+	, mStepCondition()
+	, mStepDeltaTime(0.0f)
+	, mIsStepPending(false)
+	, mIsSyncPending(false)
+	, mMustStop(false)
+	, mQueryScratch()
+	, mTaskPool()
+	, mCollisionConfig(CollisionConstructionInfo())
+	, mCollisionDispatcher(mCollisionConfig)
 	, mBroadPhase()
 	, mConstraintSolver()
 	, mDynamicsWorld(&mCollisionDispatcher, &mBroadPhase, &mConstraintSolver, &mCollisionConfig)
 {
 	mDynamicsWorld.setGravity(btVector3{ 0, -10, 0 });
-	mDynamicsWorld.setDebugDrawer(FDebug::Draw::GetInstancePtr());
+
+	// Only bodies that are awake move, sleeping colliders are updated by UpdateColliderBounds
+	mDynamicsWorld.setForceUpdateAllAabbs(false);
 
 	AddSubSystem<FRigidBodySystem>(*this);
 	AddSubSystem<FColliderSystem>(*this);
@@ -27,85 +136,574 @@ FPhysicsSystem::FPhysicsSystem(Atlas::FWorld& World)
 
 FPhysicsSystem::~FPhysicsSystem()
 {
+	SetPipelined(false);
 }
 
 
 void FPhysicsSystem::Update()
 {
-	std::unique_lock<std::mutex> RigidLock(mRigidBodyMutex);
-	while (!mRigidBodyQueue.empty())
+	CPU_PROFILE("PhysicsSystemUpdate");
+
+	// The last pipelined step is done before its timings are reset
+	WaitForStep();
+	mDynamicsWorld.Timings = UpdateTimings{};
+
+	// Queued objects are added and removed at the step boundary
+	const uint64_t QueueBegin = FClock::ReadSystemTimer();
+	ApplyQueuedChanges();
+	mDynamicsWorld.Timings.QueueCycles = FClock::ReadSystemTimer() - QueueBegin;
+	UpdateResidency();
+
+	if (!mStepThread.joinable())
 	{
-		RigidBodyRecord Record = mRigidBodyQueue.front();
-		mRigidBodyQueue.pop();
-		RigidLock.unlock();
+		StepSimulation(STime::GetDeltaTime());
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(mStepMutex);
+		mStepDeltaTime = STime::GetDeltaTime();
+		mIsStepPending = true;
+	}
+
+	mIsSyncPending = true;
+	mStepCondition.notify_all();
+}
 
-		if (Record.ToBeAdded)
+void FPhysicsSystem::ApplyQueuedChanges()
+{
+	WaitForStep();
+
+	// Drain everything queued so far as one batch
+	mCommandBatch.clear();
+	mPendingAdds.clear();
+
+	Command Queued;
+	while (mCommandQueue.Pop(Queued))
+	{
+		if (Queued.Action == Command::Type::AddRigidBody || Queued.Action == Command::Type::AddCollider)
 		{
-			mDynamicsWorld.addRigidBody(Record.RigidBody);
+			mPendingAdds[Queued.Object] = mCommandBatch.size();
 		}
 		else
 		{
-			mDynamicsWorld.removeRigidBody(Record.RigidBody);
-			mDynamicsWorld.getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(Record.RigidBody->getBroadphaseHandle(), mDynamicsWorld.getDispatcher());
+			// An object added and removed in the same batch never reaches the world
+			auto PendingAdd = mPendingAdds.find(Queued.Object);
+			if (PendingAdd != mPendingAdds.end())
+			{
+				mCommandBatch[PendingAdd->second].Object = nullptr;
+				mPendingAdds.erase(PendingAdd);
+				continue;
+			}
 		}
 
-		RigidLock.lock();
+		mCommandBatch.push_back(Queued);
 	}
 
-	RigidLock.unlock();
-
-	std::unique_lock<std::mutex> ColliderLock(mColliderMutex);
-	while (!mColliderQueue.empty())
+	for (const Command& Queued : mCommandBatch)
 	{
-		ColliderRecord Record = mColliderQueue.front();
-		mColliderQueue.pop();
-		ColliderLock.unlock();
+		if (!Queued.Object)
+			continue;
 
-		if (Record.ToBeAdded)
+		switch (Queued.Action)
 		{
-			mDynamicsWorld.addCollisionObject(Record.Collider);
+		case Command::Type::AddRigidBody:
+			mDynamicsWorld.addRigidBody(btRigidBody::upcast(Queued.Object));
+			break;
+		case Command::Type::RemoveRigidBody:
+			mDynamicsWorld.removeRigidBody(btRigidBody::upcast(Queued.Object));
+			mDynamicsWorld.getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(Queued.Object->getBroadphaseHandle(), mDynamicsWorld.getDispatcher());
+			break;
+		case Command::Type::AddCollider:
+			mDynamicsWorld.addCollisionObject(Queued.Object);
+			Queued.Object->setActivationState(ISLAND_SLEEPING);
+			break;
+		case Command::Type::RemoveCollider:
+			mDynamicsWorld.removeCollisionObject(Queued.Object);
+			mDynamicsWorld.getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(Queued.Object->getBroadphaseHandle(), mDynamicsWorld.getDispatcher());
+			break;
 		}
+	}
+}
+
+void FPhysicsSystem::QueueCommand(const Command& NewCommand)
+{
+	while (!mCommandQueue.Push(NewCommand))
+	{
+		// Only the updating thread drains the queue, so it can't wait for itself
+		if (std::this_thread::get_id() == mUpdateThread)
+			ApplyQueuedChanges();
+		else
+			std::this_thread::yield();
+	}
+}
+
+void FPhysicsSystem::ActivateBodiesInBox(const btVector3& Min, const btVector3& Max)
+{
+	WaitForStep();
+
+	btCollisionObjectArray& Objects = mDynamicsWorld.getCollisionObjectArray();
+	for (int32_t i = 0; i < Objects.size(); i++)
+	{
+		btCollisionObject* Object = Objects[i];
+		if (Object->isStaticObject())
+			continue;
+
+		btVector3 ObjectMin, ObjectMax;
+		Object->getCollisionShape()->getAabb(Object->getWorldTransform(), ObjectMin, ObjectMax);
+		if (TestAabbAgainstAabb2(Min, Max, ObjectMin, ObjectMax))
+			Object->activate();
+	}
+}
+
+void FPhysicsSystem::SetResidentBox(const btVector3& Min, const btVector3& Max)
+{
+	mResidentMin = Min;
+	mResidentMax = Max;
+	mHasResidentBox = true;
+}
+
+void FPhysicsSystem::UpdateResidency()
+{
+	btCollisionObjectArray& Objects = mDynamicsWorld.getCollisionObjectArray();
+	for (int32_t i = 0; i < Objects.size(); i++)
+	{
+		btRigidBody* Body = btRigidBody::upcast(Objects[i]);
+		if (!Body || Body->isStaticOrKinematicObject())
+			continue;
+
+		// Every rigidbody's motion state is its game object
+		const Atlas::FGameObject* GameObject = static_cast<const Atlas::FGameObject*>(Body->getMotionState());
+		const bool IsObjectActive = !GameObject || GameObject->IsActive();
+
+		if (IsObjectActive)
+			Body->setCollisionFlags(Body->getCollisionFlags() & ~btCollisionObject::CF_NO_CONTACT_RESPONSE);
 		else
+			Body->setCollisionFlags(Body->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
+
+		btVector3 BodyMin, BodyMax;
+		Body->getAabb(BodyMin, BodyMax);
+
+		const bool IsResident = IsObjectActive && (!mHasResidentBox || TestAabbAgainstAabb2(mResidentMin, mResidentMax, BodyMin, BodyMax));
+		const bool IsHeld = (Body->getActivationState() == DISABLE_SIMULATION);
+
+		// Held bodies keep their velocity, so they carry on as they were once freed
+		if (!IsResident && !IsHeld)
 		{
-			mDynamicsWorld.removeCollisionObject(Record.Collider);
-			mDynamicsWorld.getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(Record.Collider->getBroadphaseHandle(), mDynamicsWorld.getDispatcher());
+			Body->forceActivationState(DISABLE_SIMULATION);
 		}
+		else if (IsResident && IsHeld)
+		{
+			Body->forceActivationState(ACTIVE_TAG);
+			Body->setDeactivationTime(0);
+		}
+	}
+}
 
-		ColliderLock.lock();
+void FPhysicsSystem::RaycastBatch(const btVector3* From, const btVector3* To, const uint32_t Count, RaycastResults& ResultsOut)
+{
+	WaitForStep();
+
+	ResultsOut.Points.resize(Count);
+	ResultsOut.Normals.resize(Count);
+	ResultsOut.Fractions.resize(Count);
+	ResultsOut.Objects.resize(Count);
+
+	mQueryScratch.resize(mTaskPool.GetThreadCount());
+	btBroadphaseInterface& BroadPhase = *mDynamicsWorld.getBroadphase();
+	const btCollisionObject* Terrain = mDynamicsWorld.Terrain;
+	const TerrainRaycast& RaycastTerrain = mDynamicsWorld.RaycastTerrain;
+
+	// The broadphase's own ray test shares one stack, but box tests don't
+	mTaskPool.ParallelFor(Count, [&](const uint32_t Index, const uint32_t Worker)
+	{
+		btAlignedObjectArray<btCollisionObject*>& Candidates = mQueryScratch[Worker].Candidates;
+		Candidates.resize(0);
+
+		// The terrain's shape builds faces for every cell within the ray's bounds, so the
+		// voxel raycast finds its hit instead, and other objects are only tested up to it
+		btCollisionWorld::ClosestRayResultCallback Callback(From[Index], To[Index]);
+		btScalar TerrainFraction;
+		btVector3 TerrainNormal;
+		if (Terrain && RaycastTerrain && RaycastTerrain(From[Index], To[Index], TerrainFraction, TerrainNormal))
+		{
+			Callback.m_closestHitFraction = TerrainFraction;
+			Callback.m_collisionObject = Terrain;
+			Callback.m_hitNormalWorld = TerrainNormal;
+			Callback.m_hitPointWorld = From[Index].lerp(To[Index], TerrainFraction);
+		}
+
+		const btVector3 RayEnd = Callback.hasHit() ? Callback.m_hitPointWorld : To[Index];
+		btVector3 RayMin = From[Index];
+		btVector3 RayMax = From[Index];
+		RayMin.setMin(RayEnd);
+		RayMax.setMax(RayEnd);
+
+		CandidateCollector Collector(Candidates);
+		BroadPhase.aabbTest(RayMin, RayMax, Collector);
+
+		btTransform FromTransform = btTransform::getIdentity();
+		btTransform ToTransform = btTransform::getIdentity();
+		FromTransform.setOrigin(From[Index]);
+		ToTransform.setOrigin(To[Index]);
+
+		// Each object only reports hits closer than the closest so far
+		for (int32_t i = 0; i < Candidates.size(); i++)
+		{
+			btCollisionObject* Object = Candidates[i];
+			if (Object == Terrain)
+				continue;
+
+			btCollisionWorld::rayTestSingle(FromTransform, ToTransform, Object, Object->getCollisionShape(), Object->getWorldTransform(), Callback);
+		}
+
+		const bool HasHit = Callback.hasHit();
+		ResultsOut.Points[Index] = HasHit ? Callback.m_hitPointWorld : To[Index];
+		ResultsOut.Normals[Index] = HasHit ? Callback.m_hitNormalWorld.normalized() : btVector3(0, 0, 0);
+		ResultsOut.Fractions[Index] = HasHit ? Callback.m_closestHitFraction : btScalar(1);
+		ResultsOut.Objects[Index] = HasHit ? Callback.m_collisionObject : nullptr;
+	});
+}
+
+void FPhysicsSystem::OverlapSphereBatch(const btVector3* Centers, const btScalar* Radii, const uint32_t Count, OverlapResults& ResultsOut)
+{
+	WaitForStep();
+
+	mQueryScratch.resize(mTaskPool.GetThreadCount());
+	for (QueryScratch& Scratch : mQueryScratch)
+		Scratch.Overlaps.clear();
+
+	btBroadphaseInterface& BroadPhase = *mDynamicsWorld.getBroadphase();
+
+	mTaskPool.ParallelFor(Count, [&](const uint32_t Index, const uint32_t Worker)
+	{
+		QueryScratch& Scratch = mQueryScratch[Worker];
+		Scratch.Candidates.resize(0);
+
+		const btVector3 Extent(Radii[Index], Radii[Index], Radii[Index]);
+		CandidateCollector Collector(Scratch.Candidates);
+		BroadPhase.aabbTest(Centers[Index] - Extent, Centers[Index] + Extent, Collector);
+
+		btSphereShape Sphere(Radii[Index]);
+		btCollisionObject SphereObject;
+		SphereObject.setCollisionShape(&Sphere);
+		SphereObject.getWorldTransform().setOrigin(Centers[Index]);
+
+		// The dispatcher locks its pools, so contact tests may run on any worker
+		for (int32_t i = 0; i < Scratch.Candidates.size(); i++)
+		{
+			OverlapCallback Callback;
+			mDynamicsWorld.contactPairTest(&SphereObject, Scratch.Candidates[i], Callback);
+
+			if (Callback.HasOverlap)
+				Scratch.Overlaps.push_back(std::make_pair(Index, Scratch.Candidates[i]));
+		}
+	});
+
+	// Group the overlaps of every worker by sphere
+	ResultsOut.FirstObjects.assign(Count, 0);
+	ResultsOut.ObjectCounts.assign(Count, 0);
+
+	uint32_t OverlapCount = 0;
+	for (const QueryScratch& Scratch : mQueryScratch)
+	{
+		for (const auto& Overlap : Scratch.Overlaps)
+		{
+			ResultsOut.ObjectCounts[Overlap.first]++;
+		}
+		OverlapCount += Scratch.Overlaps.size();
+	}
+
+	for (uint32_t i = 1; i < Count; i++)
+		ResultsOut.FirstObjects[i] = ResultsOut.FirstObjects[i - 1] + ResultsOut.ObjectCounts[i - 1];
+
+	// Counts are rebuilt as each sphere's objects are placed
+	ResultsOut.Objects.resize(OverlapCount);
+	std::vector<uint32_t>& NextObjects = ResultsOut.ObjectCounts;
+	NextObjects.assign(Count, 0);
+
+	for (const QueryScratch& Scratch : mQueryScratch)
+	{
+		for (const auto& Overlap : Scratch.Overlaps)
+		{
+			ResultsOut.Objects[ResultsOut.FirstObjects[Overlap.first] + NextObjects[Overlap.first]++] = Overlap.second;
+		}
 	}
+}
 
-	ColliderLock.unlock();
-	
-	mDynamicsWorld.stepSimulation(STime::GetDeltaTime());
+void FPhysicsSystem::SetTerrain(const btCollisionObject* Terrain, TerrainRaycast Raycast)
+{
+	WaitForStep();
+	mDynamicsWorld.Terrain = Terrain;
+	mDynamicsWorld.RaycastTerrain = std::move(Raycast);
+}
+
+void FPhysicsSystem::DynamicsWorld::internalSingleStepSimulation(btScalar TimeStep)
+{
+	btDiscreteDynamicsWorld::internalSingleStepSimulation(TimeStep);
+	Timings.StepCount++;
+}
+
+void FPhysicsSystem::DynamicsWorld::updateAabbs()
+{
+	const uint64_t Begin = FClock::ReadSystemTimer();
+	btDiscreteDynamicsWorld::updateAabbs();
+	Timings.BroadphaseCycles += FClock::ReadSystemTimer() - Begin;
+}
+
+void FPhysicsSystem::DynamicsWorld::computeOverlappingPairs()
+{
+	const uint64_t Begin = FClock::ReadSystemTimer();
+	btDiscreteDynamicsWorld::computeOverlappingPairs();
+	Timings.BroadphaseCycles += FClock::ReadSystemTimer() - Begin;
+}
+
+void FPhysicsSystem::DynamicsWorld::performDiscreteCollisionDetection()
+{
+	// Bounds and pairs are updated within, and counted as the broadphase
+	const uint64_t BroadphaseBefore = Timings.BroadphaseCycles;
+	const uint64_t Begin = FClock::ReadSystemTimer();
+	btDiscreteDynamicsWorld::performDiscreteCollisionDetection();
+	Timings.NarrowphaseCycles += FClock::ReadSystemTimer() - Begin - (Timings.BroadphaseCycles - BroadphaseBefore);
+}
+
+void FPhysicsSystem::DynamicsWorld::solveConstraints(btContactSolverInfo& SolverInfo)
+{
+	const uint64_t Begin = FClock::ReadSystemTimer();
+	btDiscreteDynamicsWorld::solveConstraints(SolverInfo);
+	Timings.SolverCycles += FClock::ReadSystemTimer() - Begin;
+}
+
+void FPhysicsSystem::DynamicsWorld::integrateTransforms(btScalar TimeStep)
+{
+	BT_PROFILE("integrateTransforms");
+
+	const uint64_t Begin = FClock::ReadSystemTimer();
+
+	btTransform PredictedTransform;
+	for (int32_t i = 0; i < m_nonStaticRigidBodies.size(); i++)
+	{
+		btRigidBody* Body = m_nonStaticRigidBodies[i];
+		Body->setHitFraction(1);
+
+		if (!Body->isActive() || Body->isStaticOrKinematicObject())
+			continue;
+
+		Body->predictIntegratedTransform(TimeStep, PredictedTransform);
+
+		const btVector3 From = Body->getWorldTransform().getOrigin();
+		const btVector3 To = PredictedTransform.getOrigin();
+		const btScalar SquareMotion = (To - From).length2();
+
+		if (Body->getCcdSquareMotionThreshold() != 0 && Body->getCcdSquareMotionThreshold() < SquareMotion)
+		{
+			const btScalar Radius = Body->getCcdSweptSphereRadius();
+			btScalar HitFraction = 1;
+
+			// The voxel raycast is much cheaper than sweeping the terrain's faces. It
+			// finds the block the sphere's center enters, so the sphere stops a radius short.
+			btScalar TerrainFraction;
+			btVector3 TerrainNormal;
+			if (RaycastTerrain && RaycastTerrain(From, To, TerrainFraction, TerrainNormal))
+				HitFraction = btMax(btScalar(0), TerrainFraction - Radius / btSqrt(SquareMotion));
+
+			// Other objects only report hits closer than the terrain
+			btSphereShape Sphere(Radius);
+			SweepCallback Callback(Body, Terrain, From, To, getDispatchInfo().m_allowedCcdPenetration);
+			Callback.m_collisionFilterGroup = Body->getBroadphaseProxy()->m_collisionFilterGroup;
+			Callback.m_collisionFilterMask = Body->getBroadphaseProxy()->m_collisionFilterMask;
+			Callback.m_closestHitFraction = HitFraction;
+
+			btTransform SweepEnd = Body->getWorldTransform();
+			SweepEnd.setOrigin(To);
+			convexSweepTest(&Sphere, Body->getWorldTransform(), SweepEnd, Callback);
+			HitFraction = Callback.m_closestHitFraction;
+
+			if (HitFraction < 1)
+			{
+				Body->setHitFraction(HitFraction);
+				Body->predictIntegratedTransform(TimeStep * HitFraction, PredictedTransform);
+				Body->setHitFraction(0);
+			}
+		}
+
+		Body->proceedToTransform(PredictedTransform);
+	}
+
+	Timings.IntegrateCycles += FClock::ReadSystemTimer() - Begin;
+}
+
+void FPhysicsSystem::SetMaxSubSteps(const uint32_t MaxSubSteps)
+{
+	ASSERT(MaxSubSteps > 0);
+	mMaxSubSteps = MaxSubSteps;
+}
+
+void FPhysicsSystem::SetPipelined(const bool Flag)
+{
+	if (Flag == mStepThread.joinable())
+		return;
+
+	if (Flag)
+	{
+		mDynamicsWorld.DefersMotionStates = true;
+		mMustStop = false;
+		mStepThread = std::thread(&FPhysicsSystem::StepThreadLoop, this);
+		return;
+	}
+
+	WaitForStep();
+
+	{
+		std::lock_guard<std::mutex> Lock(mStepMutex);
+		mMustStop = true;
+	}
+	mStepCondition.notify_all();
+
+	mStepThread.join();
+	mDynamicsWorld.DefersMotionStates = false;
+}
+
+void FPhysicsSystem::WaitForStep()
+{
+	if (!mIsSyncPending)
+		return;
+
+	{
+		std::unique_lock<std::mutex> Lock(mStepMutex);
+		mStepCondition.wait(Lock, [this]() { return !mIsStepPending; });
+	}
+
+	mDynamicsWorld.SynchronizeDeferred();
+	mIsSyncPending = false;
+}
+
+void FPhysicsSystem::SetParallel(const bool Flag)
+{
+	if (Flag == IsParallel())
+		return;
+
+	// Workers can't change while a step uses them
+	WaitForStep();
+
+	if (Flag)
+	{
+		// The step's own thread takes part along with the shared workers
+		mTaskPool.Start();
+		mCollisionDispatcher.SetTaskPool(&mTaskPool);
+	}
+	else
+	{
+		mCollisionDispatcher.SetTaskPool(nullptr);
+		mTaskPool.Stop();
+	}
+}
+
+const FPhysicsSystem::UpdateTimings& FPhysicsSystem::GetLastUpdateTimings()
+{
+	WaitForStep();
+	return mDynamicsWorld.Timings;
+}
+
+FPhysicsSystem::WorldStats FPhysicsSystem::GetWorldStats()
+{
+	WaitForStep();
+
+	WorldStats Stats{};
+	btCollisionObjectArray& Objects = mDynamicsWorld.getCollisionObjectArray();
+	Stats.ObjectCount = (uint32_t)Objects.size();
+	for (int32_t i = 0; i < Objects.size(); i++)
+	{
+		const btRigidBody* Body = btRigidBody::upcast(Objects[i]);
+		if (!Body || Body->isStaticOrKinematicObject())
+			continue;
+
+		Stats.RigidBodyCount++;
+		if (Body->getActivationState() == ISLAND_SLEEPING)
+			Stats.SleepingCount++;
+	}
+
+	Stats.PairCount = (uint32_t)mBroadPhase.getOverlappingPairCache()->getNumOverlappingPairs();
+	Stats.ManifoldCount = (uint32_t)mCollisionDispatcher.getNumManifolds();
+
+	// Bullet's allocations aren't tracked, so they are found from what each object, pair and manifold holds
+	Stats.BulletBytes = (uint64_t)Stats.ObjectCount * (sizeof(btDbvtProxy) + sizeof(btDbvtNode) + sizeof(btCollisionObject*)) +
+		(uint64_t)Stats.PairCount * (sizeof(btBroadphasePair) + FParallelDispatcher::ALGORITHM_SIZE) +
+		(uint64_t)Stats.ManifoldCount * (sizeof(btPersistentManifold) + sizeof(btPersistentManifold*));
+	return Stats;
+}
+
+void FPhysicsSystem::StepSimulation(const float DeltaTime)
+{
+	CPU_PROFILE("PhysicsStep");
+
+	ASSERT(STime::GetFixedUpdate() > 0.0f && "Physics needs a fixed update rate.");
+
+	// Frame time is accumulated and simulated in fixed steps, so results don't depend on
+	// the frame rate. Rigidbody motion states are given transforms interpolated between
+	// the last two steps by the time left over, so rendering stays smooth.
+	mDynamicsWorld.stepSimulation(DeltaTime, (int)mMaxSubSteps, STime::GetFixedUpdate());
+}
+
+void FPhysicsSystem::StepThreadLoop()
+{
+	std::unique_lock<std::mutex> Lock(mStepMutex);
+
+	while (true)
+	{
+		mStepCondition.wait(Lock, [this]() { return mIsStepPending || mMustStop; });
+
+		// Steps are always waited for before stopping
+		if (!mIsStepPending)
+			return;
+
+		const float DeltaTime = mStepDeltaTime;
+		Lock.unlock();
+
+		StepSimulation(DeltaTime);
+
+		Lock.lock();
+		mIsStepPending = false;
+		mStepCondition.notify_all();
+	}
 }
 
 void FPhysicsSystem::RenderCollisionObjects()
 {
+	// Debug drawing reads the simulation, so it can't overlap a step. The drawer is only
+	// set while drawing, since the narrowphase would otherwise draw from worker threads.
+	WaitForStep();
+	mDynamicsWorld.setDebugDrawer(FDebug::Draw::GetInstancePtr());
 	mDynamicsWorld.debugDrawWorld();
+	mDynamicsWorld.setDebugDrawer(nullptr);
 }
 
 void FPhysicsSystem::AddCollider(btCollisionObject& CollisionObject)
 {
-	std::unique_lock<std::mutex> ColliderLock(mColliderMutex);
-	mColliderQueue.push(ColliderRecord{ &CollisionObject, true });
+	QueueCommand(Command{ &CollisionObject, Command::Type::AddCollider });
 }
 
 void FPhysicsSystem::RemoveCollider(btCollisionObject& CollisionObject)
 {
-	std::unique_lock<std::mutex> ColliderLock(mColliderMutex);
-	mColliderQueue.push(ColliderRecord{ &CollisionObject, false });
+	QueueCommand(Command{ &CollisionObject, Command::Type::RemoveCollider });
+}
+
+void FPhysicsSystem::UpdateColliderBounds(btCollisionObject& CollisionObject)
+{
+	WaitForStep();
+
+	if (CollisionObject.getBroadphaseHandle())
+		mDynamicsWorld.updateSingleAabb(&CollisionObject);
 }
 
 void FPhysicsSystem::AddRigidBody(btRigidBody& RigidBody)
 {
-	std::unique_lock<std::mutex> RigidLock(mRigidBodyMutex);
-	mRigidBodyQueue.push(RigidBodyRecord{ &RigidBody, true });
+	QueueCommand(Command{ &RigidBody, Command::Type::AddRigidBody });
 }
 
 void FPhysicsSystem::RemoveRigidBody(btRigidBody& RigidBody)
 {
-	std::unique_lock<std::mutex> RigidLock(mRigidBodyMutex);
-	mRigidBodyQueue.push(RigidBodyRecord{ &RigidBody, false });
+	QueueCommand(Command{ &RigidBody, Command::Type::RemoveRigidBody });
 }
 
 void FPhysicsSystem::CheckInterest(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdatedComponent)
@@ -115,6 +713,12 @@ void FPhysicsSystem::CheckInterest(Atlas::FGameObject& GameObject, Atlas::ICompo
 		SubSystem->CheckInterest(GameObject, UpdatedComponent);
 }
 
+void FPhysicsSystem::OnRemoveBatchEnd()
+{
+	// Removed components are destroyed once this returns, a whole despawn leaves the world at once
+	ApplyQueuedChanges();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////// Rigidbody System //////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
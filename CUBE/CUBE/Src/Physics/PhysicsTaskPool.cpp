@@ -0,0 +1,35 @@
+#include "Physics\PhysicsTaskPool.h"
+
+FPhysicsTaskPool::FPhysicsTaskPool()
+	: mIsRunning(false)
+{
+}
+
+void FPhysicsTaskPool::Start()
+{
+	mIsRunning = true;
+}
+
+void FPhysicsTaskPool::Stop()
+{
+	mIsRunning = false;
+}
+
+void FPhysicsTaskPool::ParallelFor(const uint32_t Count, const Task& Work)
+{
+	if (!mIsRunning)
+	{
+		for (uint32_t i = 0; i < Count; i++)
+			Work(i, 0);
+
+		return;
+	}
+
+	// Iterations are taken one at a time, as their cost varies with the bodies involved
+	FJobSystem::GetInstance().ParallelFor(Count, 1, Work);
+}
+
+uint32_t FPhysicsTaskPool::GetThreadCount() const
+{
+	return mIsRunning ? FJobSystem::GetInstance().GetThreadCount() : 1;
+}
@@ -0,0 +1,117 @@
+#include "Physics\RigidBodyPool.h"
+#include "Atlas\GameObject.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+
+FRigidBodyPool::FRigidBodyPool()
+	: mSpawned()
+	, mFree()
+	, mActiveBudget(DEFAULT_ACTIVE_BUDGET)
+{
+}
+
+void FRigidBodyPool::Create(Atlas::FGameObject& Creator, const uint32_t Size, const SetupFunction& Setup)
+{
+	mFree.reserve(mFree.size() + Size);
+
+	for (uint32_t i = 0; i < Size; i++)
+	{
+		Atlas::FGameObject& GameObject = Creator.CreateGameObject();
+		GameObject.AddComponent<Atlas::EComponent::RigidBody>();
+		Setup(GameObject);
+
+		Deactivate(GameObject);
+		mFree.push_back(&GameObject);
+	}
+}
+
+Atlas::FGameObject& FRigidBodyPool::Spawn(const Vector3f& Position, const Vector3f& Velocity)
+{
+	return Spawn(Position, FQuaternion{}, Velocity, Vector3f{});
+}
+
+Atlas::FGameObject& FRigidBodyPool::Spawn(const Vector3f& Position, const FQuaternion& Rotation, const Vector3f& Velocity, const Vector3f& AngularVelocity)
+{
+	ASSERT((!mFree.empty() || !mSpawned.empty()) && "Spawning from a pool that was never created.");
+
+	Atlas::FGameObject* GameObject;
+	if (!mFree.empty())
+	{
+		GameObject = mFree.back();
+		mFree.pop_back();
+	}
+	else
+	{
+		GameObject = mSpawned.front();
+		mSpawned.pop_front();
+	}
+
+	mSpawned.push_back(GameObject);
+	GameObject->SetActive(true);
+	GameObject->Transform.SetLocalPosition(Position);
+	GameObject->Transform.SetRotation(Rotation);
+
+	// Move the body itself, since it only reads its motion state when constructed
+	btTransform Transform;
+	GameObject->getWorldTransform(Transform);
+
+	const btVector3 LinearVelocity{ Velocity.x, Velocity.y, Velocity.z };
+	btRigidBody& Body = GameObject->GetComponent<Atlas::EComponent::RigidBody>().Body;
+	Body.setWorldTransform(Transform);
+	Body.setInterpolationWorldTransform(Transform);
+	Body.setLinearVelocity(LinearVelocity);
+	Body.setInterpolationLinearVelocity(LinearVelocity);
+	Body.setAngularVelocity(btVector3{ AngularVelocity.x, AngularVelocity.y, AngularVelocity.z });
+	Body.clearForces();
+	Body.activate(true);
+
+	return *GameObject;
+}
+
+void FRigidBodyPool::Despawn(Atlas::FGameObject& GameObject)
+{
+	auto Spawned = std::find(mSpawned.begin(), mSpawned.end(), &GameObject);
+	ASSERT(Spawned != mSpawned.end() && "Despawning an object the pool has not spawned.");
+
+	mSpawned.erase(Spawned);
+	Deactivate(GameObject);
+	mFree.push_back(&GameObject);
+}
+
+void FRigidBodyPool::Update()
+{
+	uint32_t AwakeCount = 0;
+	for (Atlas::FGameObject* GameObject : mSpawned)
+	{
+		if (GameObject->GetComponent<Atlas::EComponent::RigidBody>().Body.isActive())
+			AwakeCount++;
+	}
+
+	// Oldest bodies are the first to go
+	for (auto Spawned = mSpawned.begin(); AwakeCount > mActiveBudget && Spawned != mSpawned.end();)
+	{
+		Atlas::FGameObject& GameObject = **Spawned;
+		if (!GameObject.GetComponent<Atlas::EComponent::RigidBody>().Body.isActive())
+		{
+			++Spawned;
+			continue;
+		}
+
+		Spawned = mSpawned.erase(Spawned);
+		Deactivate(GameObject);
+		mFree.push_back(&GameObject);
+		AwakeCount--;
+	}
+}
+
+void FRigidBodyPool::Deactivate(Atlas::FGameObject& GameObject)
+{
+	// The physics system holds the bodies of inactive objects
+	GameObject.SetActive(false);
+
+	btRigidBody& Body = GameObject.GetComponent<Atlas::EComponent::RigidBody>().Body;
+	Body.setLinearVelocity(btVector3{ 0, 0, 0 });
+	Body.setAngularVelocity(btVector3{ 0, 0, 0 });
+	Body.clearForces();
+}
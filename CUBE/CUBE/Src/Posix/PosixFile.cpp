@@ -0,0 +1,510 @@
+#ifndef _WIN32
+
+#include "../../Include/Posix/PosixFile.h"
+
+#include <algorithm>
+#include <codecvt>
+#include <cstring>
+#include <iostream>
+#include <locale>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	// Size of the buffer files are copied through
+	const uint32_t COPY_BUFFER_SIZE = 64 * 1024;
+
+	void PrintError()
+	{
+		std::wcerr << strerror(errno) << std::endl;
+	}
+
+	void PrintError(const wchar_t* File)
+	{
+		std::wcerr << strerror(errno) << L" on file: " << File << std::endl;
+	}
+
+	std::string ToNarrowPath(const wchar_t* Path)
+	{
+		std::wstring_convert<std::codecvt_utf8<wchar_t>> Converter;
+		return Converter.to_bytes(Path);
+	}
+
+	std::wstring ToWidePath(const char* Path)
+	{
+		std::wstring_convert<std::codecvt_utf8<wchar_t>> Converter;
+		return Converter.from_bytes(Path);
+	}
+
+	/**
+	* Copies a file through a buffer, replacing the destination.
+	*/
+	bool CopyFileData(const std::string& From, const std::string& To)
+	{
+		const int Source = open(From.c_str(), O_RDONLY);
+		if (Source == -1)
+			return false;
+
+		struct stat SourceInfo;
+		fstat(Source, &SourceInfo);
+
+		const int Destination = open(To.c_str(), O_WRONLY | O_CREAT | O_TRUNC, SourceInfo.st_mode & 0777);
+		if (Destination == -1)
+		{
+			close(Source);
+			return false;
+		}
+
+		std::vector<uint8_t> Buffer(COPY_BUFFER_SIZE);
+		bool Copied = true;
+
+		for (ssize_t BytesRead = read(Source, Buffer.data(), Buffer.size()); BytesRead != 0; BytesRead = read(Source, Buffer.data(), Buffer.size()))
+		{
+			if (BytesRead < 0 || write(Destination, Buffer.data(), BytesRead) != BytesRead)
+			{
+				Copied = false;
+				break;
+			}
+		}
+
+		close(Source);
+		close(Destination);
+		return Copied;
+	}
+
+	/**
+	* Copies a directory and everything in it.
+	*/
+	bool CopyDirectoryData(const std::string& From, const std::string& To)
+	{
+		DIR* Directory = opendir(From.c_str());
+		if (!Directory)
+			return false;
+
+		bool Copied = (mkdir(To.c_str(), 0755) == 0 || errno == EEXIST);
+
+		for (dirent* Entry = readdir(Directory); Entry && Copied; Entry = readdir(Directory))
+		{
+			if (strcmp(Entry->d_name, ".") == 0 || strcmp(Entry->d_name, "..") == 0)
+				continue;
+
+			const std::string FromPath = From + "/" + Entry->d_name;
+			const std::string ToPath = To + "/" + Entry->d_name;
+
+			struct stat Info;
+			if (lstat(FromPath.c_str(), &Info) != 0)
+				Copied = false;
+			else if (S_ISDIR(Info.st_mode))
+				Copied = CopyDirectoryData(FromPath, ToPath);
+			else
+				Copied = CopyFileData(FromPath, ToPath);
+		}
+
+		closedir(Directory);
+		return Copied;
+	}
+
+	int RemoveEntry(const char* Path, const struct stat* Info, int Flag, struct FTW* Walk)
+	{
+		(void)Info; (void)Flag; (void)Walk;
+		return remove(Path);
+	}
+}
+
+FPosixHandle::FPosixHandle(const int FileDescriptor)
+	: mFileDescriptor(FileDescriptor)
+{
+}
+
+FPosixHandle::~FPosixHandle()
+{
+	if (mFileDescriptor != -1)
+		close(mFileDescriptor);
+
+	mFileDescriptor = -1;
+}
+
+bool FPosixHandle::Read(uint8_t* DataOut, uint32_t NumBytesToRead)
+{
+	if (read(mFileDescriptor, DataOut, NumBytesToRead) == (ssize_t)NumBytesToRead)
+		return true;
+
+	PrintError();
+	return false;
+}
+
+bool FPosixHandle::Write(const uint8_t* Data, const uint32_t NumBytesToWrite)
+{
+	if (write(mFileDescriptor, Data, NumBytesToWrite) == (ssize_t)NumBytesToWrite)
+		return true;
+
+	PrintError();
+	return false;
+}
+
+bool FPosixHandle::ReadAt(const uint64_t Offset, uint8_t* DataOut, const uint32_t NumBytesToRead)
+{
+	if (pread(mFileDescriptor, DataOut, NumBytesToRead, (off_t)Offset) == (ssize_t)NumBytesToRead)
+		return true;
+
+	PrintError();
+	return false;
+}
+
+bool FPosixHandle::WriteAt(const uint64_t Offset, const uint8_t* Data, const uint32_t NumBytesToWrite)
+{
+	if (pwrite(mFileDescriptor, Data, NumBytesToWrite, (off_t)Offset) == (ssize_t)NumBytesToWrite)
+		return true;
+
+	PrintError();
+	return false;
+}
+
+bool FPosixHandle::Seek(const uint64_t Distance)
+{
+	return FileSeek((int64_t)Distance, SEEK_CUR);
+}
+
+bool FPosixHandle::SeekFromEnd(const uint64_t Distance)
+{
+	return FileSeek((int64_t)Distance, SEEK_END);
+}
+
+bool FPosixHandle::SeekFromStart(const uint64_t Distance)
+{
+	return FileSeek((int64_t)Distance, SEEK_SET);
+}
+
+bool FPosixHandle::FileSeek(const int64_t Distance, const int Whence)
+{
+	if (lseek(mFileDescriptor, (off_t)Distance, Whence) == (off_t)-1)
+	{
+		PrintError();
+		return false;
+	}
+
+	return true;
+}
+
+uint32_t FPosixHandle::GetFileSize() const
+{
+	struct stat Info;
+	if (fstat(mFileDescriptor, &Info) != 0)
+		return 0;
+
+	return (uint32_t)Info.st_size;
+}
+
+bool FPosixHandle::Flush()
+{
+	if (fsync(mFileDescriptor) != 0)
+	{
+		PrintError();
+		return false;
+	}
+
+	return true;
+}
+
+FPosixMappedFile::FPosixMappedFile(const int FileDescriptor, const bool ReadOnly)
+	: mFileDescriptor(FileDescriptor)
+	, mData(nullptr)
+	, mFileSize(0)
+	, mReadOnly(ReadOnly)
+{
+	struct stat Info;
+	if (fstat(mFileDescriptor, &Info) == 0)
+		mFileSize = (uint32_t)Info.st_size;
+
+	Map();
+}
+
+FPosixMappedFile::~FPosixMappedFile()
+{
+	Unmap();
+	close(mFileDescriptor);
+	mFileDescriptor = -1;
+}
+
+uint8_t* FPosixMappedFile::GetData()
+{
+	return mData;
+}
+
+uint32_t FPosixMappedFile::GetFileSize() const
+{
+	return mFileSize;
+}
+
+bool FPosixMappedFile::Resize(const uint32_t NewSize)
+{
+	if (NewSize == mFileSize)
+		return true;
+
+	if (mReadOnly)
+		return false;
+
+	Unmap();
+
+	// Mappings can't grow the file, so it is truncated to the new size either way
+	if (ftruncate(mFileDescriptor, (off_t)NewSize) != 0)
+	{
+		PrintError();
+		Map();
+		return false;
+	}
+
+	const uint32_t OldSize = mFileSize;
+	mFileSize = NewSize;
+
+	if (!Map())
+	{
+		mFileSize = OldSize;
+		Map();
+		return false;
+	}
+
+	return true;
+}
+
+bool FPosixMappedFile::Flush()
+{
+	if (mData && !mReadOnly && msync(mData, mFileSize, MS_SYNC) != 0)
+	{
+		PrintError();
+		return false;
+	}
+
+	return true;
+}
+
+bool FPosixMappedFile::Map()
+{
+	// Mapping an empty file fails, so it stays unmapped until it is grown
+	if (mFileSize == 0)
+		return true;
+
+	void* Data = mmap(nullptr, mFileSize, mReadOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, mFileDescriptor, 0);
+	if (Data == MAP_FAILED)
+	{
+		PrintError();
+		return false;
+	}
+
+	mData = (uint8_t*)Data;
+	return true;
+}
+
+void FPosixMappedFile::Unmap()
+{
+	if (mData)
+	{
+		munmap(mData, mFileSize);
+		mData = nullptr;
+	}
+}
+
+FPosixFileSystem::FPosixFileSystem()
+	: IFileSystem()
+{
+	SetProgramDirectory();
+}
+
+int FPosixFileSystem::OpenDescriptor(const wchar_t* Filename, const int Flags)
+{
+	const int FileDescriptor = open(ToNarrowPath(Filename).c_str(), Flags, 0644);
+	if (FileDescriptor == -1)
+		PrintError(Filename);
+
+	return FileDescriptor;
+}
+
+std::unique_ptr<IFileHandle> FPosixFileSystem::OpenWritable(const wchar_t* Filename, const bool AllowShareRead, const bool CreateNew)
+{
+	// Files are always shared, POSIX has no share modes
+	(void)AllowShareRead;
+	const int FileDescriptor = OpenDescriptor(Filename, O_WRONLY | (CreateNew ? O_CREAT | O_TRUNC : 0));
+	if (FileDescriptor != -1)
+		return std::make_unique<FPosixHandle>(FileDescriptor);
+
+	return nullptr;
+}
+
+std::unique_ptr<IFileHandle> FPosixFileSystem::OpenReadable(const wchar_t* Filename)
+{
+	const int FileDescriptor = OpenDescriptor(Filename, O_RDONLY);
+	if (FileDescriptor != -1)
+		return std::make_unique<FPosixHandle>(FileDescriptor);
+
+	return nullptr;
+}
+
+std::unique_ptr<IFileHandle> FPosixFileSystem::OpenReadWritable(const wchar_t* Filename, const bool AllowShareRead, const bool CreateNew)
+{
+	(void)AllowShareRead;
+	const int FileDescriptor = OpenDescriptor(Filename, O_RDWR | (CreateNew ? O_CREAT | O_TRUNC : 0));
+	if (FileDescriptor != -1)
+		return std::make_unique<FPosixHandle>(FileDescriptor);
+
+	return nullptr;
+}
+
+std::unique_ptr<IMappedFile> FPosixFileSystem::OpenMapped(const wchar_t* Filename, const bool CreateNew, const bool ReadOnly)
+{
+	const int FileDescriptor = OpenDescriptor(Filename, (ReadOnly ? O_RDONLY : O_RDWR) | (CreateNew ? O_CREAT | O_TRUNC : 0));
+	if (FileDescriptor == -1)
+		return nullptr;
+
+	std::unique_ptr<FPosixMappedFile> MappedFile = std::make_unique<FPosixMappedFile>(FileDescriptor, ReadOnly);
+
+	// Non-empty files must be mapped to be usable
+	if (MappedFile->GetFileSize() == 0 || MappedFile->GetData())
+		return MappedFile;
+
+	return nullptr;
+}
+
+bool FPosixFileSystem::DeleteFilename(const wchar_t* Filename)
+{
+	if (unlink(ToNarrowPath(Filename).c_str()) == 0)
+		return true;
+
+	PrintError(Filename);
+	return false;
+}
+
+bool FPosixFileSystem::CopyFilename(const wchar_t* From, const wchar_t* To)
+{
+	if (CopyFileData(ToNarrowPath(From), ToNarrowPath(To)))
+		return true;
+
+	PrintError(From);
+	return false;
+}
+
+bool FPosixFileSystem::ReplaceFilename(const wchar_t* From, const wchar_t* To)
+{
+	// Renames replace the destination atomically
+	if (rename(ToNarrowPath(From).c_str(), ToNarrowPath(To).c_str()) == 0)
+		return true;
+
+	PrintError(From);
+	return false;
+}
+
+bool FPosixFileSystem::CurrentDirectory(wchar_t* DataOut, const uint32_t BufferLength)
+{
+	std::vector<char> Directory(PATH_MAX);
+	if (!getcwd(Directory.data(), Directory.size()))
+	{
+		PrintError();
+		return false;
+	}
+
+	const std::wstring WideDirectory = ToWidePath(Directory.data());
+	if (WideDirectory.size() >= BufferLength)
+		return false;
+
+	wcscpy(DataOut, WideDirectory.c_str());
+	return true;
+}
+
+bool FPosixFileSystem::DeleteDirectory(const wchar_t* DirectoryName)
+{
+	// Contents are removed before the directories holding them
+	if (nftw(ToNarrowPath(DirectoryName).c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS) == 0)
+		return true;
+
+	std::wcerr << "Delete directory operation failded on " << DirectoryName << " with code: " << errno << std::endl;
+	return false;
+}
+
+bool FPosixFileSystem::RenameDirectory(const wchar_t* CurrentName, const wchar_t* NewName)
+{
+	if (rename(ToNarrowPath(CurrentName).c_str(), ToNarrowPath(NewName).c_str()) == 0)
+		return true;
+
+	PrintError(CurrentName);
+	return false;
+}
+
+bool FPosixFileSystem::CreateFileDirectory(const wchar_t* DirectoryName)
+{
+	if (mkdir(ToNarrowPath(DirectoryName).c_str(), 0755) == 0)
+	{
+		return true;
+	}
+	else
+	{
+		if (errno == ENOENT)
+			std::wcerr << L"Directory path not found when creating directory." << std::endl;
+	}
+
+	return false;
+}
+
+bool FPosixFileSystem::GetProgramDirectory(wchar_t* DataOut, const uint32_t BufferLength)
+{
+	std::memcpy(DataOut, ProgramDirectory, std::min(BufferLength, ProgramDirectorySize) * sizeof(wchar_t));
+	return BufferLength < ProgramDirectorySize;
+}
+
+bool FPosixFileSystem::SetDirectory(const wchar_t* DirectoryName)
+{
+	if (chdir(ToNarrowPath(DirectoryName).c_str()) == 0)
+		return true;
+
+	PrintError(DirectoryName);
+	return false;
+}
+
+bool FPosixFileSystem::FileExists(const wchar_t* Filename)
+{
+	return access(ToNarrowPath(Filename).c_str(), F_OK) == 0;
+}
+
+bool FPosixFileSystem::SetToProgramDirectory()
+{
+	return SetDirectory(ProgramDirectory);
+}
+
+void FPosixFileSystem::SetProgramDirectory()
+{
+	std::vector<char> Executable(PATH_MAX);
+	const ssize_t Length = readlink("/proc/self/exe", Executable.data(), Executable.size() - 1);
+	if (Length <= 0)
+	{
+		PrintError();
+		return;
+	}
+
+	// Keep the directory of the executable
+	std::string Directory(Executable.data(), Length);
+	Directory.erase(std::min(Directory.find_last_of('/'), Directory.size()));
+
+	const std::wstring WideDirectory = ToWidePath(Directory.c_str());
+	if (WideDirectory.size() >= PROGRAM_DIRECTORY_CAP)
+		return;
+
+	wcscpy(ProgramDirectory, WideDirectory.c_str());
+	ProgramDirectorySize = WideDirectory.size();
+}
+
+bool FPosixFileSystem::CopyFileDirectory(const wchar_t* From, const wchar_t* To)
+{
+	if (CopyDirectoryData(ToNarrowPath(From), ToNarrowPath(To)))
+		return true;
+
+	PrintError(From);
+	return false;
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include "Rendering\BlockTextureArray.h"
+#include "ChunkSystems\BlockTypes.h"
+#include "Rendering\GLBindings.h"
+#include "Rendering\GLState.h"
+
+#include <vector>
+
+namespace
+{
+	// Face layer storage block of DeferredChunkRender.vert
+	const GLuint FACE_LAYER_BINDING = 11;
+
+	const uint32_t TEXTURE_SIZE = FBlockTypes::TEXTURE_SIZE;
+
+	/**
+	* Averages each 2x2 texels of every layer into a level half the size.
+	* @param Source - Layers of a level Size texels wide, a layer after another.
+	*/
+	void Downsample(const std::vector<uint32_t>& Source, const uint32_t Size, const uint32_t LayerCount, std::vector<uint32_t>& DestOut)
+	{
+		const uint32_t Half = Size / 2;
+		DestOut.resize(Half * Half * LayerCount);
+		for (uint32_t Layer = 0; Layer < LayerCount; Layer++)
+		{
+			const uint32_t* Texels = &Source[Layer * Size * Size];
+			for (uint32_t y = 0; y < Half; y++)
+			{
+				for (uint32_t x = 0; x < Half; x++)
+				{
+					const uint32_t Corners[4] = { Texels[x * 2 + y * 2 * Size], Texels[x * 2 + 1 + y * 2 * Size],
+						Texels[x * 2 + (y * 2 + 1) * Size], Texels[x * 2 + 1 + (y * 2 + 1) * Size] };
+
+					// Each 8 bit channel on its own, rounded to nearest
+					uint32_t Texel = 0;
+					for (uint32_t Shift = 0; Shift < 32; Shift += 8)
+					{
+						uint32_t Sum = 2;
+						for (const uint32_t Corner : Corners)
+							Sum += (Corner >> Shift) & 0xFF;
+						Texel |= (Sum / 4) << Shift;
+					}
+					DestOut[Layer * Half * Half + x + y * Half] = Texel;
+				}
+			}
+		}
+	}
+}
+
+FBlockTextureArray::FBlockTextureArray()
+	: mTexture(0)
+	, mFaceBuffer(0)
+	, mBytes(EMemoryTag::Textures)
+	, mIsCompressed(false)
+{
+}
+
+FBlockTextureArray::~FBlockTextureArray()
+{
+	glDeleteTextures(1, &mTexture);
+	glDeleteBuffers(1, &mFaceBuffer);
+
+	// Deleting unbinds the texture, and the new one usually reuses its name,
+	// so the cached binding would filter out the bind below
+	SGLState::Invalidate();
+}
+
+void FBlockTextureArray::Upload(const bool IsCompressed)
+{
+	glDeleteTextures(1, &mTexture);
+	glDeleteBuffers(1, &mFaceBuffer);
+
+	// Deleting unbinds the texture, and the new one usually reuses its name,
+	// so the cached binding would filter out the bind below
+	SGLState::Invalidate();
+
+	// Drivers compress uploads of S3TC levels themselves, levels under a block are padded to one
+	mIsCompressed = IsCompressed && GLEW_EXT_texture_compression_s3tc;
+	const uint32_t LayerCount = FBlockTypes::GetTextureCount();
+	uint32_t LevelCount = 1;
+	while ((TEXTURE_SIZE >> LevelCount) != 0)
+		LevelCount++;
+
+	glGenTextures(1, &mTexture);
+	SGLState::BindTexture(GLTextureBindings::BlockTextures, GL_TEXTURE_2D_ARRAY, mTexture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, LevelCount, mIsCompressed ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_RGBA8, TEXTURE_SIZE, TEXTURE_SIZE, LayerCount);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	std::vector<uint32_t> Level = FBlockTypes::mTextureTexels;
+	std::vector<uint32_t> NextLevel;
+	uint64_t Bytes = 0;
+	for (uint32_t i = 0; i < LevelCount; i++)
+	{
+		const uint32_t Size = TEXTURE_SIZE >> i;
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, 0, Size, Size, LayerCount, GL_RGBA, GL_UNSIGNED_BYTE, Level.data());
+
+		// DXT5 packs each 4x4 block of texels into 16 bytes
+		const uint32_t Blocks = (Size + 3) / 4;
+		Bytes += (uint64_t)LayerCount * (mIsCompressed ? Blocks * Blocks * 16 : Size * Size * sizeof(uint32_t));
+
+		if (i + 1 < LevelCount)
+		{
+			Downsample(Level, Size, LayerCount, NextLevel);
+			Level.swap(NextLevel);
+		}
+	}
+
+	glGenBuffers(1, &mFaceBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mFaceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(FBlockTypes::mFaceTextures), FBlockTypes::mFaceTextures, GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FACE_LAYER_BINDING, mFaceBuffer);
+
+	mBytes.Set(Bytes + sizeof(FBlockTypes::mFaceTextures));
+}
@@ -2,11 +2,13 @@
 #include "Math\PerspectiveMatrix.h"
 #include "Rendering\Screen.h"
 #include "Math\FMath.h"
+#include "Math\Matrix4A.h"
 
 FCamera* FCamera::Main = nullptr;
 
 FCamera::FCamera()
-	: mProjection()
+	: LateLookSpeed(0.0f)
+	, mProjection()
 {
 	// If this is the first camera, assign it to main
 	if (!Main)
@@ -24,13 +26,8 @@ FCamera::~FCamera()
 FFrustum FCamera::GetWorldViewFrustum() 
 {
 	// We can also use the view matrix with the projection to take the frustum
-	// into world coordinates.
-	const FMatrix4 Mat = GetProjection() * Transform.WorldToLocalMatrix();
-
-	FFrustum Frustum;
-	GetFrustumCommon(Frustum, Mat);
-
-	return Frustum;
+	// into world coordinates. The product stays in registers for the plane extraction.
+	return FFrustum::FromReverseZMatrix(FMatrix4A{ mProjection } * FMatrix4A{ Transform.WorldToLocalMatrix() });
 }
 
 FFrustum FCamera::GetViewFrustum()
@@ -45,21 +42,7 @@ FFrustum FCamera::GetViewFrustum()
 
 void FCamera::GetFrustumCommon(FFrustum& Frustum, const FMatrix4& Projection) const
 {
-	// From Mathematics for 3D Game Programming and Computer Graphics p.107
-	const FPlane Left = FPlane{ Projection.GetRow(3) + Projection.GetRow(0) }.Normalize();
-	const FPlane Right = FPlane{ Projection.GetRow(3) - Projection.GetRow(0) }.Normalize();
-	const FPlane Bottom = FPlane{ Projection.GetRow(3) + Projection.GetRow(1) }.Normalize();
-	const FPlane Top = FPlane{ Projection.GetRow(3) - Projection.GetRow(1) }.Normalize();
-	const FPlane Near = FPlane{ Projection.GetRow(3) + Projection.GetRow(2) }.Normalize();
-	const FPlane Far = FPlane{ Projection.GetRow(3) - Projection.GetRow(2) }.Normalize();
-
-	using Plane = FFrustum::PlaneType;
-	Frustum.SetPlane(Plane::Near, Near);
-	Frustum.SetPlane(Plane::Far, Far);
-	Frustum.SetPlane(Plane::Left, Left);
-	Frustum.SetPlane(Plane::Right, Right);
-	Frustum.SetPlane(Plane::Bottom, Bottom);
-	Frustum.SetPlane(Plane::Top, Top);
+	Frustum = FFrustum::FromReverseZMatrix(Projection);
 }
 
 FMatrix4 FCamera::GetProjection()
@@ -0,0 +1,203 @@
+#include "Rendering\CascadedShadowMap.h"
+#include "Rendering\RenderPacket.h"
+#include "Rendering\Screen.h"
+#include "Rendering\GLBindings.h"
+#include "Rendering\GLState.h"
+#include "ChunkSystems\ChunkManager.h"
+#include "Math\OrthoMatrix.h"
+#include "Math\PerspectiveMatrix.h"
+#include "Math\Frustum.h"
+#include "Math\FMath.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+#include <cmath>
+
+#undef min
+#undef max
+
+namespace
+{
+	const float DEFAULT_SHADOW_DISTANCE = 160.0f;
+
+	// Blend between even and logarithmic splits, logarithmic at 1
+	const float SPLIT_LAMBDA = 0.8f;
+
+	// Each cascade moves in steps of its radius over this
+	const float SNAP_DIVISIONS = 4.0f;
+
+	// How far behind a cascade chunks are still caught casting into it
+	const float CASTER_DISTANCE = 128.0f;
+
+	// Slope scaled bias while rendering depth, to keep faces from shadowing themselves
+	const float POLYGON_OFFSET_FACTOR = 2.0f;
+	const float POLYGON_OFFSET_UNITS = 4.0f;
+
+	float SnapToStep(const float Value, const float Step)
+	{
+		return std::floor(Value / Step + 0.5f) * Step;
+	}
+}
+
+FCascadedShadowMap::FCascadedShadowMap()
+	: mDepthProgram()
+	, mViewProjectionUniform(mDepthProgram.FindUniform("uViewProjection"))
+	, mDrawList()
+	, mCasters()
+	, mShadowDistance(DEFAULT_SHADOW_DISTANCE)
+{
+	static_assert(CASCADE_COUNT <= 4, "Split depths are sent to shaders in one vec4.");
+
+	for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+	{
+		mCascades[i].Target.reset(new FDepthRenderTarget{ Vector2ui{ RESOLUTION, RESOLUTION } });
+		mCascades[i].Target->SetTextureUnit(GLTextureBindings::ShadowCascades + i);
+		mCascades[i].Radius = 0.0f;
+		mCascades[i].SplitDepth = 0.0f;
+		mCascades[i].Signature = 0;
+		mCascades[i].IsValid = false;
+	}
+
+	FShader VertexShader{ L"Shaders/DepthChunkRender.vert", GL_VERTEX_SHADER };
+	FShader FragmentShader{ L"Shaders/DepthRender.frag", GL_FRAGMENT_SHADER };
+
+	mDepthProgram.AttachShader(VertexShader);
+	mDepthProgram.AttachShader(FragmentShader);
+	mDepthProgram.LinkProgram();
+}
+
+void FCascadedShadowMap::Update(FChunkManager& ChunkManager, const FRenderView& View, const Vector3f& LightDirection)
+{
+	const FMatrix4& Projection = View.Projection;
+	const FMatrix4& ViewToWorld = View.ViewToWorld;
+
+	const float Near = FPerspectiveMatrix::GetNear(Projection);
+	const float Far = std::min(mShadowDistance, FPerspectiveMatrix::GetFar(Projection));
+
+	// View space direction through each corner of the screen, scaled to a depth of 1.
+	// Taken at the near plane, which is at a depth of 1 with reversed depth.
+	const FMatrix4 InvProjection = Projection.GetInverse();
+	Vector3f Rays[4];
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		const Vector4f Corner = InvProjection.TransformVector(Vector4f{ i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, 1.0f, 1.0f });
+		const Vector3f Position{ Corner.x / Corner.w, Corner.y / Corner.w, Corner.z / Corner.w };
+		Rays[i] = Position / -Position.z;
+	}
+
+	// Cascades are snapped in a space that only turns with the light
+	const Vector3f Up = std::abs(Vector3f::Dot(LightDirection, Vector3f::Up)) > 0.99f ? Vector3f::Forward : Vector3f::Up;
+	const LookAtMatrix LightView{ Vector3f{ 0, 0, 0 }, LightDirection, Up };
+
+	const bool WasBlending = SGLState::IsEnabled(GL_BLEND);
+	const bool WasDepthTesting = SGLState::IsEnabled(GL_DEPTH_TEST);
+	bool HasRendered = false;
+
+	float SplitNear = Near;
+	for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+	{
+		Cascade& Current = mCascades[i];
+
+		const float Fraction = (float)(i + 1) / CASCADE_COUNT;
+		const float SplitFar = FMath::Lerp(Near + (Far - Near) * Fraction, Near * std::pow(Far / Near, Fraction), SPLIT_LAMBDA);
+
+		// Bounding sphere of the slice, which doesn't change size as the camera turns
+		Vector3f SliceCenter{ 0, 0, 0 };
+		for (uint32_t j = 0; j < 4; j++)
+			SliceCenter += (Rays[j] * SplitNear + Rays[j] * SplitFar) / 8.0f;
+
+		float Radius = 0.0f;
+		for (uint32_t j = 0; j < 4; j++)
+		{
+			Radius = std::max(Radius, (Rays[j] * SplitNear - SliceCenter).Length());
+			Radius = std::max(Radius, (Rays[j] * SplitFar - SliceCenter).Length());
+		}
+		Radius = std::ceil(Radius);
+
+		// Steps are whole texels, so the shadow map is sampled the same way after moving
+		const float TexelSize = 2.0f * (Radius + Radius / SNAP_DIVISIONS) / RESOLUTION;
+		const float Step = std::max(TexelSize, SnapToStep(Radius / SNAP_DIVISIONS, TexelSize));
+
+		const Vector3f LightCenter = LightView.TransformPosition(ViewToWorld.TransformPosition(SliceCenter));
+		const Vector3f Center{ SnapToStep(LightCenter.x, Step), SnapToStep(LightCenter.y, Step), SnapToStep(LightCenter.z, Step) };
+
+		// The box holds the sphere wherever it is inside the step, and reaches back toward the light for casters
+		const float HalfSize = Radius + Step;
+		const FOrthoMatrix LightProjection{ Center.x - HalfSize, Center.x + HalfSize, Center.y + HalfSize, Center.y - HalfSize,
+			-Center.z - HalfSize - CASTER_DISTANCE, -Center.z + HalfSize };
+		const FMatrix4 ViewProjection = LightProjection * LightView;
+
+		const uint64_t Signature = ChunkManager.CullShadowCasters(FFrustum::FromMatrix(ViewProjection), mCasters);
+
+		Current.SplitDepth = SplitFar;
+		SplitNear = SplitFar;
+
+		if (Current.IsValid && Current.Center == Center && Current.Radius == Radius &&
+			Current.LightDirection == LightDirection && Current.Signature == Signature)
+			continue;
+
+		if (!HasRendered)
+		{
+			HasRendered = true;
+			SGLState::Disable(GL_BLEND);
+			SGLState::Enable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(POLYGON_OFFSET_FACTOR, POLYGON_OFFSET_UNITS);
+			mDepthProgram.Use();
+		}
+
+		Current.ViewProjection = ViewProjection;
+		Current.Center = Center;
+		Current.Radius = Radius;
+		Current.LightDirection = LightDirection;
+		Current.Signature = Signature;
+		Current.IsValid = true;
+
+		Current.Target->StartWrite();
+		mDepthProgram.SetMatrix(mViewProjectionUniform, 1, GL_FALSE, &ViewProjection, std::true_type{});
+		ChunkManager.RenderShadowCasters(mCasters, LightDirection, mDrawList);
+		Current.Target->EndWrite(SScreen::GetRenderResolution());
+	}
+
+	if (HasRendered)
+	{
+		SGLState::Disable(GL_POLYGON_OFFSET_FILL);
+
+		if (WasBlending)
+			SGLState::Enable(GL_BLEND);
+		if (!WasDepthTesting)
+			SGLState::Disable(GL_DEPTH_TEST);
+	}
+}
+
+void FCascadedShadowMap::Bind(FShaderProgram& Program, const FRenderView& View) const
+{
+	// From view space to the shadow map texture, with depth in [0, 1]
+	FMatrix4 TextureBias;
+	TextureBias.M[0][0] = TextureBias.M[1][1] = TextureBias.M[2][2] = 0.5f;
+	TextureBias.M[3][0] = TextureBias.M[3][1] = TextureBias.M[3][2] = 0.5f;
+
+	const FMatrix4& ViewToWorld = View.ViewToWorld;
+
+	FMatrix4 Matrices[CASCADE_COUNT];
+	Vector4f SplitDepths{ 0, 0, 0, 0 };
+	for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+	{
+		ASSERT(mCascades[i].IsValid && "Update must be called before binding.");
+
+		mCascades[i].Target->StartRead();
+		Matrices[i] = TextureBias * mCascades[i].ViewProjection * ViewToWorld;
+		SplitDepths[i] = mCascades[i].SplitDepth;
+	}
+
+	Program.SetMatrix("uCascadeMatrices", CASCADE_COUNT, GL_FALSE, Matrices, std::true_type{});
+	Program.SetVector("uCascadeSplits", 1, &SplitDepths, std::true_type{});
+}
+
+void FCascadedShadowMap::SetShadowDistance(const float Distance)
+{
+	ASSERT(Distance > 0.0f);
+
+	mShadowDistance = Distance;
+	for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+		mCascades[i].IsValid = false;
+}
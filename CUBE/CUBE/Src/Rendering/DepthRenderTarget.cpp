@@ -1,21 +1,29 @@
 #include "Rendering\DepthRenderTarget.h"
+#include "Rendering\GLState.h"
+#include "Misc\Assertions.h"
 
 
 FDepthRenderTarget::FDepthRenderTarget(const Vector2ui TextureResolution)
 	: mFrameBuffer(0)
+	, mPreviousFrameBuffer(0)
+	, mPreviousClipDepth(GL_NEGATIVE_ONE_TO_ONE)
 	, mDepthTexture(0)
+	, mActiveTexture(0)
 	, mTextureResolution(TextureResolution)
-	, mActiveTexture(GL_TEXTURE0)
+	, mTextureBytes(EMemoryTag::Textures)
 {
 	glGenFramebuffers(1, &mFrameBuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, mFrameBuffer);
+	SGLState::BindFramebuffer(mFrameBuffer);
 	ASSERT(mFrameBuffer != 0);
 
 	glGenTextures(1, &mDepthTexture);
 	SetResolution(TextureResolution);
 
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, mDepthTexture, 0);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// The texture has no stencil, so it is only attached for depth
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mDepthTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	SGLState::BindFramebuffer(0);
 }
 
 
@@ -27,11 +35,16 @@ FDepthRenderTarget::~FDepthRenderTarget()
 
 void FDepthRenderTarget::StartWrite()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, mFrameBuffer);
+	mPreviousFrameBuffer = SGLState::GetFramebuffer();
+	SGLState::BindFramebuffer(mFrameBuffer);
 	glViewport(0, 0, mTextureResolution.x, mTextureResolution.y);
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LEQUAL);
+	// The scene may be rendered with reversed depth
+	mPreviousClipDepth = SGLState::GetClipDepthMode();
+	SGLState::ClipDepthMode(GL_NEGATIVE_ONE_TO_ONE);
+
+	SGLState::Enable(GL_DEPTH_TEST);
+	SGLState::DepthFunc(GL_LEQUAL);
 
 	glClearDepth(1.0f);
 	glClear(GL_DEPTH_BUFFER_BIT);
@@ -41,21 +54,22 @@ void FDepthRenderTarget::StartWrite()
 
 void FDepthRenderTarget::EndWrite(const Vector2ui DefaultViewPort)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// Each framebuffer keeps its own draw buffers, so only the default one is reset
+	SGLState::BindFramebuffer(mPreviousFrameBuffer);
+	SGLState::ClipDepthMode(mPreviousClipDepth);
 	glViewport(0, 0, DefaultViewPort.x, DefaultViewPort.y);
-	glDrawBuffer(GL_BACK);
+	if (mPreviousFrameBuffer == 0)
+		glDrawBuffer(GL_BACK);
 }
 
 void FDepthRenderTarget::StartRead()
 {
-	glActiveTexture(GL_TEXTURE0 + mActiveTexture);
-	glBindTexture(GL_TEXTURE_2D, mDepthTexture);
+	SGLState::BindTexture(mActiveTexture, GL_TEXTURE_2D, mDepthTexture);
 }
 
 void FDepthRenderTarget::EndRead()
 {
-	glActiveTexture(GL_TEXTURE0 + mActiveTexture);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	SGLState::BindTexture(mActiveTexture, GL_TEXTURE_2D, 0);
 }
 
 void FDepthRenderTarget::SetResolution(const Vector2ui NewResolution)
@@ -79,4 +93,6 @@ void FDepthRenderTarget::SetResolution(const Vector2ui NewResolution)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glBindTexture(GL_TEXTURE_2D, 0);
+
+	mTextureBytes.Set((uint64_t)NewResolution.x * NewResolution.y * sizeof(float));
 }
\ No newline at end of file
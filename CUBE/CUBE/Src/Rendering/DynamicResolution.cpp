@@ -0,0 +1,87 @@
+#include "Rendering\DynamicResolution.h"
+#include "Math\FMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+#undef min
+#undef max
+
+namespace
+{
+	const float DEFAULT_BUDGET = 1000.0f / 60.0f;
+
+	// The scale moves in steps, so it doesn't follow noise in the frame time
+	const float SCALE_STEP = 0.05f;
+	const float MIN_SCALE = 0.5f;
+
+	// Fractions of the budget. A step up costs at most about 20% more time, so the
+	// band between them is wide enough that a step up never goes over budget.
+	const float OVER_BUDGET = 0.95f;
+	const float UNDER_BUDGET = 0.7f;
+	const float SCALE_DOWN_TARGET = 0.85f;
+
+	// Weight of each new frame in the smoothed frame time
+	const float SMOOTHING = 0.25f;
+
+	// Frames at a new scale take this long to be measured
+	const uint32_t SETTLE_FRAMES = FDebug::GPUProfiler::FRAME_COUNT + 2;
+}
+
+FDynamicResolution::FDynamicResolution()
+	: mBudget(DEFAULT_BUDGET)
+	, mScale(1.0f)
+	, mFrameTime(0.0f)
+	, mLastFrame(0)
+	, mSettleFrames(0)
+	, mHasFrame(false)
+	, mIsEnabled(true)
+{
+}
+
+void FDynamicResolution::Update(const FDebug::GPUProfiler::FrameResult* Frame)
+{
+	if (!mIsEnabled || !Frame || (mHasFrame && Frame->Frame == mLastFrame))
+		return;
+
+	const float FrameTime = (Frame->End - Frame->Begin) / 1000000.0f;
+	mFrameTime = mHasFrame ? FMath::Lerp(mFrameTime, FrameTime, SMOOTHING) : FrameTime;
+	mLastFrame = Frame->Frame;
+	mHasFrame = true;
+
+	if (mSettleFrames > 0)
+	{
+		mSettleFrames--;
+		return;
+	}
+
+	if (mFrameTime > mBudget * OVER_BUDGET && mScale > MIN_SCALE)
+	{
+		// Time grows with the pixel count, the square of the scale
+		const float Fit = mScale * std::sqrt(mBudget * SCALE_DOWN_TARGET / mFrameTime);
+		const float Stepped = std::floor(Fit / SCALE_STEP) * SCALE_STEP;
+		mScale = std::max(std::min(Stepped, mScale - SCALE_STEP), MIN_SCALE);
+		mSettleFrames = SETTLE_FRAMES;
+	}
+	else if (mFrameTime < mBudget * UNDER_BUDGET && mScale < 1.0f)
+	{
+		mScale = std::min(mScale + SCALE_STEP, 1.0f);
+		mSettleFrames = SETTLE_FRAMES;
+	}
+}
+
+void FDynamicResolution::SetEnabled(const bool Flag)
+{
+	mIsEnabled = Flag;
+	mHasFrame = false;
+	mSettleFrames = 0;
+
+	if (!Flag)
+		mScale = 1.0f;
+}
+
+void FDynamicResolution::SetBudget(const float Milliseconds)
+{
+	mBudget = Milliseconds;
+	mSettleFrames = 0;
+}
@@ -0,0 +1,233 @@
+#include "Rendering\GLState.h"
+
+namespace
+{
+	// Stands in for state that isn't known, no object or enum takes this value
+	const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	const GLenum CACHED_CAPABILITIES[] = { GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_POLYGON_OFFSET_FILL };
+}
+
+GLuint SGLState::Program = UNKNOWN;
+GLuint SGLState::VertexArray = UNKNOWN;
+GLuint SGLState::Framebuffer = UNKNOWN;
+uint32_t SGLState::ActiveUnit = UNKNOWN;
+
+// Zeroed, and no texture is ever bound to target 0, so every unit starts unknown
+GLenum SGLState::TextureTargets[SGLState::TEXTURE_UNIT_COUNT];
+GLuint SGLState::Textures[SGLState::TEXTURE_UNIT_COUNT];
+int8_t SGLState::Capabilities[SGLState::CapabilityCount] = { -1, -1, -1, -1, -1 };
+GLenum SGLState::BlendSource = UNKNOWN;
+GLenum SGLState::BlendDestination = UNKNOWN;
+GLenum SGLState::BlendMode = UNKNOWN;
+GLenum SGLState::DepthFunction = UNKNOWN;
+GLenum SGLState::ClipDepth = UNKNOWN;
+
+SGLState::FrameStats SGLState::CurrentFrameStats = { 0, 0 };
+SGLState::FrameStats SGLState::LastFrameStats = { 0, 0 };
+
+void SGLState::UseProgram(const GLuint NewProgram)
+{
+	if (CountCall(NewProgram == Program))
+	{
+		glUseProgram(NewProgram);
+		Program = NewProgram;
+	}
+}
+
+void SGLState::BindVertexArray(const GLuint NewVertexArray)
+{
+	if (CountCall(NewVertexArray == VertexArray))
+	{
+		glBindVertexArray(NewVertexArray);
+		VertexArray = NewVertexArray;
+	}
+}
+
+void SGLState::BindFramebuffer(const GLuint NewFramebuffer)
+{
+	if (CountCall(NewFramebuffer == Framebuffer))
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, NewFramebuffer);
+		Framebuffer = NewFramebuffer;
+	}
+}
+
+GLuint SGLState::GetFramebuffer()
+{
+	if (Framebuffer == UNKNOWN)
+	{
+		GLint Bound = 0;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &Bound);
+		Framebuffer = Bound;
+	}
+
+	return Framebuffer;
+}
+
+void SGLState::BindTexture(const uint32_t Unit, const GLenum Target, const GLuint Texture)
+{
+	if (Unit < TEXTURE_UNIT_COUNT && TextureTargets[Unit] == Target && Textures[Unit] == Texture)
+	{
+		CountCall(true);
+		return;
+	}
+
+	ActiveTexture(Unit);
+	CountCall(false);
+	glBindTexture(Target, Texture);
+
+	if (Unit < TEXTURE_UNIT_COUNT)
+	{
+		TextureTargets[Unit] = Target;
+		Textures[Unit] = Texture;
+	}
+}
+
+void SGLState::ActiveTexture(const uint32_t Unit)
+{
+	if (CountCall(Unit == ActiveUnit))
+	{
+		glActiveTexture(GL_TEXTURE0 + Unit);
+		ActiveUnit = Unit;
+	}
+}
+
+void SGLState::Enable(const GLenum Capability)
+{
+	SetEnabled(Capability, true);
+}
+
+void SGLState::Disable(const GLenum Capability)
+{
+	SetEnabled(Capability, false);
+}
+
+bool SGLState::IsEnabled(const GLenum Capability)
+{
+	const CachedCapability Cached = GetCachedCapability(Capability);
+	if (Cached == Uncached)
+		return glIsEnabled(Capability) == GL_TRUE;
+
+	if (Capabilities[Cached] < 0)
+		Capabilities[Cached] = glIsEnabled(Capability) == GL_TRUE ? 1 : 0;
+
+	return Capabilities[Cached] == 1;
+}
+
+void SGLState::BlendFunc(const GLenum Source, const GLenum Destination)
+{
+	if (CountCall(Source == BlendSource && Destination == BlendDestination))
+	{
+		glBlendFunc(Source, Destination);
+		BlendSource = Source;
+		BlendDestination = Destination;
+	}
+}
+
+void SGLState::BlendEquation(const GLenum Mode)
+{
+	if (CountCall(Mode == BlendMode))
+	{
+		glBlendEquation(Mode);
+		BlendMode = Mode;
+	}
+}
+
+void SGLState::DepthFunc(const GLenum Function)
+{
+	if (CountCall(Function == DepthFunction))
+	{
+		glDepthFunc(Function);
+		DepthFunction = Function;
+	}
+}
+
+void SGLState::ClipDepthMode(const GLenum Mode)
+{
+	if (CountCall(Mode == ClipDepth))
+	{
+		glClipControl(GL_LOWER_LEFT, Mode);
+		ClipDepth = Mode;
+	}
+}
+
+GLenum SGLState::GetClipDepthMode()
+{
+	if (ClipDepth == UNKNOWN)
+	{
+		GLint Mode = GL_NEGATIVE_ONE_TO_ONE;
+		glGetIntegerv(GL_CLIP_DEPTH_MODE, &Mode);
+		ClipDepth = (GLenum)Mode;
+	}
+
+	return ClipDepth;
+}
+
+void SGLState::Invalidate()
+{
+	Program = UNKNOWN;
+	VertexArray = UNKNOWN;
+	Framebuffer = UNKNOWN;
+	ActiveUnit = UNKNOWN;
+	BlendSource = UNKNOWN;
+	BlendDestination = UNKNOWN;
+	BlendMode = UNKNOWN;
+	DepthFunction = UNKNOWN;
+	ClipDepth = UNKNOWN;
+
+	for (uint32_t i = 0; i < TEXTURE_UNIT_COUNT; i++)
+	{
+		TextureTargets[i] = UNKNOWN;
+		Textures[i] = UNKNOWN;
+	}
+
+	for (uint32_t i = 0; i < CapabilityCount; i++)
+		Capabilities[i] = -1;
+}
+
+void SGLState::EndFrame()
+{
+	LastFrameStats = CurrentFrameStats;
+	CurrentFrameStats = FrameStats{ 0, 0 };
+}
+
+SGLState::CachedCapability SGLState::GetCachedCapability(const GLenum Capability)
+{
+	for (uint32_t i = 0; i < CapabilityCount; i++)
+	{
+		if (CACHED_CAPABILITIES[i] == Capability)
+			return (CachedCapability)i;
+	}
+
+	return Uncached;
+}
+
+void SGLState::SetEnabled(const GLenum Capability, const bool ShouldEnable)
+{
+	const CachedCapability Cached = GetCachedCapability(Capability);
+	const int8_t State = ShouldEnable ? 1 : 0;
+
+	if (Cached == Uncached)
+	{
+		CountCall(false);
+		ShouldEnable ? glEnable(Capability) : glDisable(Capability);
+	}
+	else if (CountCall(Capabilities[Cached] == State))
+	{
+		ShouldEnable ? glEnable(Capability) : glDisable(Capability);
+		Capabilities[Cached] = State;
+	}
+}
+
+bool SGLState::CountCall(const bool IsRedundant)
+{
+	if (IsRedundant)
+	{
+		CurrentFrameStats.Filtered++;
+		return false;
+	}
+
+	CurrentFrameStats.Issued++;
+	return true;
+}
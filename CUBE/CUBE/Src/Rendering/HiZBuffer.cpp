@@ -0,0 +1,269 @@
+#include "Rendering\HiZBuffer.h"
+#include "Rendering\GLBindings.h"
+#include "Rendering\GLUtils.h"
+#include "Rendering\GLState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Work group size of HiZDownsample.comp
+	const uint32_t DOWNSAMPLE_GROUP_SIZE = 8;
+
+	// The read back level is the first no wider or taller than this
+	const uint32_t READBACK_MAX_SIZE = 128;
+
+	// Spheres covering more read back texels are taken as visible, too big to be worth testing
+	const uint32_t READBACK_MAX_TEXELS = 256;
+
+	uint32_t GroupCount(const uint32_t Size)
+	{
+		return (Size + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE;
+	}
+}
+
+FHiZBuffer::FHiZBuffer()
+	: mViewProjection()
+	, mUVScale(1.0f, 1.0f)
+	, mDownsampleProgram()
+	, mResolution()
+	, mTexture(0)
+	, mLevelCount(0)
+	, mIsValid(false)
+	, mNextReadback(0)
+	, mReadbackLevel(0)
+	, mReadbackSize()
+	, mCPUDepth()
+	, mCPUViewProjection()
+	, mCPUUVScale(1.0f, 1.0f)
+	, mHasCPUDepth(false)
+	, mTextureBytes(EMemoryTag::Textures)
+{
+	for (auto& Slot : mReadbacks)
+	{
+		Slot.Buffer = 0;
+		Slot.Fence = nullptr;
+	}
+
+	FShader DownsampleShader{ L"Shaders/HiZDownsample.comp", GL_COMPUTE_SHADER };
+	mDownsampleProgram.AttachShader(DownsampleShader);
+	mDownsampleProgram.LinkProgram();
+}
+
+FHiZBuffer::~FHiZBuffer()
+{
+	ReleaseReadbacks();
+	glDeleteTextures(1, &mTexture);
+}
+
+#undef min
+#undef max
+void FHiZBuffer::Allocate(const Vector2ui& Resolution)
+{
+	if (mTexture != 0)
+		glDeleteTextures(1, &mTexture);
+
+	mResolution = Resolution;
+	mIsValid = false;
+
+	// Levels down to 1x1
+	mLevelCount = 1;
+	for (uint32_t Size = std::max(Resolution.x, Resolution.y); Size > 1; Size /= 2)
+		mLevelCount++;
+
+	mReadbackLevel = 0;
+	while (std::max(Resolution.x >> mReadbackLevel, Resolution.y >> mReadbackLevel) > READBACK_MAX_SIZE)
+		mReadbackLevel++;
+
+	mReadbackSize = Vector2ui{ std::max(Resolution.x >> mReadbackLevel, 1u), std::max(Resolution.y >> mReadbackLevel, 1u) };
+
+	// Readbacks of the old size are dropped
+	ReleaseReadbacks();
+	for (auto& Slot : mReadbacks)
+	{
+		glGenBuffers(1, &Slot.Buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, Slot.Buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, mReadbackSize.x * mReadbackSize.y * sizeof(float), nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glGenTextures(1, &mTexture);
+	glActiveTexture(GL_TEXTURE0 + GLTextureBindings::HiZ);
+	glBindTexture(GL_TEXTURE_2D, mTexture);
+		glTexStorage2D(GL_TEXTURE_2D, mLevelCount, GL_R32F, Resolution.x, Resolution.y);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glActiveTexture(GL_TEXTURE0);
+
+	uint64_t TextureBytes = (uint64_t)READBACK_COUNT * mReadbackSize.x * mReadbackSize.y * sizeof(float);
+	for (uint32_t Level = 0; Level < mLevelCount; Level++)
+		TextureBytes += (uint64_t)std::max(Resolution.x >> Level, 1u) * std::max(Resolution.y >> Level, 1u) * sizeof(float);
+
+	mTextureBytes.Set(TextureBytes);
+}
+
+void FHiZBuffer::Build(const GLuint DepthTexture, const Vector2ui& RenderResolution, const FMatrix4& ViewProjection)
+{
+	// The whole texture is reduced, the cleared depth outside the render never occludes
+	mDownsampleProgram.Use();
+
+	// Copy depth into the first level
+	SGLState::BindTexture(GLTextureBindings::HiZ, GL_TEXTURE_2D, DepthTexture);
+	mDownsampleProgram.SetUniform("uSourceLevel", 0, std::true_type{});
+	mDownsampleProgram.SetUniform("uCopyLevel", 1, std::true_type{});
+	glBindImageTexture(0, mTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glDispatchCompute(GroupCount(mResolution.x), GroupCount(mResolution.y), 1);
+
+	// Reduce each level from the one before it
+	SGLState::BindTexture(GLTextureBindings::HiZ, GL_TEXTURE_2D, mTexture);
+	mDownsampleProgram.SetUniform("uCopyLevel", 0, std::true_type{});
+
+	for (uint32_t Level = 1; Level < mLevelCount; Level++)
+	{
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		const uint32_t Width = std::max(mResolution.x >> Level, 1u);
+		const uint32_t Height = std::max(mResolution.y >> Level, 1u);
+
+		mDownsampleProgram.SetUniform("uSourceLevel", (int32_t)Level - 1, std::true_type{});
+		glBindImageTexture(0, mTexture, Level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute(GroupCount(Width), GroupCount(Height), 1);
+	}
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	mViewProjection = ViewProjection;
+	mUVScale = Vector2f{ (float)RenderResolution.x / mResolution.x, (float)RenderResolution.y / mResolution.y };
+	mIsValid = true;
+
+	ResolveReadbacks();
+	QueueReadback();
+}
+
+bool FHiZBuffer::IsSphereOccluded(const FSphere& Sphere) const
+{
+	if (!mHasCPUDepth)
+		return false;
+
+	// Same test as ChunkCulling.comp, over the box around the sphere
+	Vector3f NDCMin{ 1.0f, 1.0f, 1.0f };
+	Vector3f NDCMax{ -1.0f, -1.0f, -1.0f };
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		const Vector3f Corner{ Sphere.Center.x + (i & 1 ? Sphere.Radius : -Sphere.Radius),
+							   Sphere.Center.y + (i & 2 ? Sphere.Radius : -Sphere.Radius),
+							   Sphere.Center.z + (i & 4 ? Sphere.Radius : -Sphere.Radius) };
+		const Vector4f Clip = mCPUViewProjection.TransformVector(Vector4f{ Corner, 1.0f });
+
+		// Bounds crossing the near plane can't be tested
+		if (Clip.w <= 0.0f)
+			return false;
+
+		const Vector3f NDC{ Clip.x / Clip.w, Clip.y / Clip.w, Clip.z / Clip.w };
+		NDCMin = Vector3f{ std::min(NDCMin.x, NDC.x), std::min(NDCMin.y, NDC.y), std::min(NDCMin.z, NDC.z) };
+		NDCMax = Vector3f{ std::max(NDCMax.x, NDC.x), std::max(NDCMax.y, NDC.y), std::max(NDCMax.z, NDC.z) };
+	}
+
+	// Bounds partly outside that frame's view have no depth to test against
+	if (NDCMin.x < -1.0f || NDCMin.y < -1.0f || NDCMax.x > 1.0f || NDCMax.y > 1.0f)
+		return false;
+
+	const int32_t MaxX = (int32_t)mReadbackSize.x - 1;
+	const int32_t MaxY = (int32_t)mReadbackSize.y - 1;
+	const int32_t FirstX = std::min((int32_t)((NDCMin.x * 0.5f + 0.5f) * mCPUUVScale.x * mReadbackSize.x), MaxX);
+	const int32_t FirstY = std::min((int32_t)((NDCMin.y * 0.5f + 0.5f) * mCPUUVScale.y * mReadbackSize.y), MaxY);
+	const int32_t LastX = std::min((int32_t)((NDCMax.x * 0.5f + 0.5f) * mCPUUVScale.x * mReadbackSize.x), MaxX);
+	const int32_t LastY = std::min((int32_t)((NDCMax.y * 0.5f + 0.5f) * mCPUUVScale.y * mReadbackSize.y), MaxY);
+
+	if ((uint32_t)((LastX - FirstX + 1) * (LastY - FirstY + 1)) > READBACK_MAX_TEXELS)
+		return false;
+
+	// Reversed depth, the nearest point of the bounds has the largest depth and the farthest occluder the smallest
+	const float NearestDepth = NDCMax.z;
+	for (int32_t y = FirstY; y <= LastY; y++)
+	{
+		for (int32_t x = FirstX; x <= LastX; x++)
+		{
+			if (NearestDepth >= mCPUDepth[y * mReadbackSize.x + x])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void FHiZBuffer::QueueReadback()
+{
+	// The slot only comes round again once its readback is resolved or dropped
+	Readback& Slot = mReadbacks[mNextReadback];
+	if (Slot.Fence)
+		return;
+
+	SGLState::BindTexture(GLTextureBindings::HiZ, GL_TEXTURE_2D, mTexture);
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, Slot.Buffer);
+	glGetTexImage(GL_TEXTURE_2D, mReadbackLevel, GL_RED, GL_FLOAT, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	Slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	Slot.ViewProjection = mViewProjection;
+	Slot.UVScale = mUVScale;
+	mNextReadback = (mNextReadback + 1) % READBACK_COUNT;
+}
+
+void FHiZBuffer::ResolveReadbacks()
+{
+	// Readbacks finish in order, starting from the oldest
+	for (uint32_t i = 0; i < READBACK_COUNT; i++)
+	{
+		Readback& Slot = mReadbacks[(mNextReadback + i) % READBACK_COUNT];
+		if (!Slot.Fence)
+			continue;
+
+		const GLenum Status = glClientWaitSync(Slot.Fence, 0, 0);
+		if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED)
+			break;
+
+		glDeleteSync(Slot.Fence);
+		Slot.Fence = nullptr;
+
+		const size_t DepthSize = mReadbackSize.x * mReadbackSize.y;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, Slot.Buffer);
+		const float* Depth = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, DepthSize * sizeof(float), GL_MAP_READ_BIT);
+		if (Depth)
+		{
+			mCPUDepth.resize(DepthSize);
+			memcpy(mCPUDepth.data(), Depth, DepthSize * sizeof(float));
+			mCPUViewProjection = Slot.ViewProjection;
+			mCPUUVScale = Slot.UVScale;
+			mHasCPUDepth = true;
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+}
+
+void FHiZBuffer::ReleaseReadbacks()
+{
+	for (auto& Slot : mReadbacks)
+	{
+		if (Slot.Fence)
+			glDeleteSync(Slot.Fence);
+
+		glDeleteBuffers(1, &Slot.Buffer);
+		Slot.Buffer = 0;
+		Slot.Fence = nullptr;
+	}
+
+	mNextReadback = 0;
+	mHasCPUDepth = false;
+}
+
+void FHiZBuffer::Bind() const
+{
+	SGLState::BindTexture(GLTextureBindings::HiZ, GL_TEXTURE_2D, mTexture);
+}
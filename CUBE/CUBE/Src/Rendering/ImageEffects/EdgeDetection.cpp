@@ -1,5 +1,6 @@
 #include "Rendering\ImageEffects\EdgeDetection.h"
 #include "ResourceHolder.h"
+#include "Rendering\GLState.h"
 
 FEdgeDetection::FEdgeDetection()
 	: mShader()
@@ -18,10 +19,10 @@ FEdgeDetection::~FEdgeDetection()
 void FEdgeDetection::OnPostLightingPass()
 {
 	mShader.Use();
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE);
-	glBlendEquation(GL_MIN);
+	SGLState::Disable(GL_DEPTH_TEST);
+	SGLState::Enable(GL_BLEND);
+	SGLState::BlendFunc(GL_ONE, GL_ONE);
+	SGLState::BlendEquation(GL_MIN);
 	//glDisable(GL_BLEND);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Rendering\ImageEffects\FogPostProcess.h"
 #include "Rendering\GLBindings.h"
+#include "Rendering\GLState.h"
 #include "ResourceHolder.h"
 namespace
 {
@@ -36,14 +37,14 @@ void FFogPostProcess::OnPostLightingPass()
 {
 	mShaderProgram.Use();
 
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendEquation(GL_FUNC_ADD);
-	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+	SGLState::Disable(GL_DEPTH_TEST);
+	SGLState::Enable(GL_BLEND);
+	SGLState::BlendEquation(GL_FUNC_ADD);
+	SGLState::BlendFunc(GL_ONE, GL_SRC1_COLOR);
 
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	
-	glDisable(GL_BLEND);
+	SGLState::Disable(GL_BLEND);
 }
 
 void FFogPostProcess::SetDensity(const float Density)
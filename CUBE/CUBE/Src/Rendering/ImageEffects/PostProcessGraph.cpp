@@ -0,0 +1,113 @@
+#include "Rendering\ImageEffects\PostProcessGraph.h"
+#include "ResourceHolder.h"
+#include "Rendering\GLState.h"
+#include "Debugging\GPUProfiler.h"
+
+FPostProcessGraph::FPostProcessGraph()
+	: mPrograms()
+{
+}
+
+FPostProcessGraph::~FPostProcessGraph()
+{
+}
+
+void FPostProcessGraph::RunPostLightingPass(const std::vector<IImageEffect*>& Effects)
+{
+	uint32_t First = 0;
+	while (First < Effects.size())
+	{
+		// Find the run of effects that can be composited, starting at the first
+		uint32_t End = First;
+		while (End < Effects.size() && Effects[End]->GetCompositeStage())
+			End++;
+
+		// A lone effect has nothing to share its pass with
+		if (End - First < 2)
+		{
+			FDebug::GPUProfiler::Scope Profile{ Effects[First]->GetName() };
+			Effects[First]->OnPostLightingPass();
+			First++;
+			continue;
+		}
+
+		RunComposite(&Effects[First], End - First);
+		First = End;
+	}
+}
+
+void FPostProcessGraph::RunComposite(IImageEffect* const* Effects, const uint32_t Count)
+{
+	FDebug::GPUProfiler::Scope Profile{ "Composite" };
+	FShaderProgram& Program = GetCompositeProgram(Effects, Count);
+
+	for (uint32_t i = 0; i < Count; i++)
+		Effects[i]->OnComposite(Program);
+
+	// Scene * Scale + Add, with Add in the first source and Scale in the second
+	SGLState::Disable(GL_DEPTH_TEST);
+	SGLState::Enable(GL_BLEND);
+	SGLState::BlendEquation(GL_FUNC_ADD);
+	SGLState::BlendFunc(GL_ONE, GL_SRC1_COLOR);
+
+	Program.Use();
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	SGLState::Disable(GL_BLEND);
+}
+
+FShaderProgram& FPostProcessGraph::GetCompositeProgram(IImageEffect* const* Effects, const uint32_t Count)
+{
+	std::string Key;
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		Key += Effects[i]->GetCompositeStage();
+		Key += ' ';
+	}
+
+	auto Itr = mPrograms.find(Key);
+	if (Itr != mPrograms.end())
+		return *Itr->second;
+
+	// Each stage is applied to the result of the ones before it
+	std::string Source = "#version 430 core\n\n#include \"CompositeCommon.glsl\"\n";
+	for (uint32_t i = 0; i < Count; i++)
+		Source += std::string{ "#include \"" } + Effects[i]->GetCompositeStage() + ".glsl\"\n";
+
+	Source +=
+		"\n"
+		"layout (location = 0, index = 0) out vec4 oAdd;\n"
+		"layout (location = 0, index = 1) out vec4 oScale;\n"
+		"\n"
+		"void main()\n"
+		"{\n"
+		"\tCompositePixel_t Pixel = GetCompositePixel(ivec2(gl_FragCoord.xy));\n"
+		"\tvec3 Add = vec3(0.0);\n"
+		"\tvec3 Scale = vec3(1.0);\n"
+		"\tvec3 StageAdd;\n"
+		"\tvec3 StageScale;\n";
+
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		Source += std::string{ "\n\t" } + Effects[i]->GetCompositeStage() + "(Pixel, StageAdd, StageScale);\n";
+		Source += "\tAdd = Add * StageScale + StageAdd;\n";
+		Source += "\tScale *= StageScale;\n";
+	}
+
+	Source +=
+		"\n"
+		"\toAdd = vec4(Add, 1.0);\n"
+		"\toScale = vec4(Scale, 1.0);\n"
+		"}\n";
+
+	FShader FragShader{ Source, GL_FRAGMENT_SHADER };
+
+	std::unique_ptr<FShaderProgram> Program{ new FShaderProgram{} };
+	Program->AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
+	Program->AttachShader(FragShader);
+	Program->LinkProgram();
+
+	FShaderProgram& Result = *Program;
+	mPrograms.emplace(Key, std::move(Program));
+	return Result;
+}
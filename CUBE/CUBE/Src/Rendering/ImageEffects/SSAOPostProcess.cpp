@@ -4,21 +4,56 @@
 #include "Math\FMath.h"
 #include "Rendering\GLUtils.h"
 #include "Rendering\GLBindings.h"
+#include "Rendering\GLState.h"
 #include "Rendering\RenderSystem.h"
+#include "Rendering\RenderTargetPool.h"
 #include "Rendering\Screen.h"
+#include "Misc\Assertions.h"
 #include <random>
 
+namespace
+{
+	// Screen pixels per occlusion texel along each axis
+	uint32_t GetDownsample(const FSSAOPostProcess::Quality Mode)
+	{
+		switch (Mode)
+		{
+		case FSSAOPostProcess::Sixteenth:
+			return 4;
+		case FSSAOPostProcess::Quarter:
+			return 2;
+		default:
+			return 1;
+		}
+	}
+
+	// If the occlusion pass samples the depth buffer
+	bool IsSampled(const FSSAOPostProcess::Quality Mode)
+	{
+		return Mode != FSSAOPostProcess::Off && Mode != FSSAOPostProcess::Traced;
+	}
+}
+
 FSSAOPostProcess::FSSAOPostProcess()
 	: IImageEffect()
+	, mRenderTargets(nullptr)
+	, mDepthDownsample()
 	, mSSAO()
 	, mNoiseTex(0)
 	, mSampleTex(0)
+	, mBlur()
+	, mAmbient(.3f, .3f, .3f)
+	, mQuality(Full)
+	, mResolution()
+	, mSSAOSize()
 {
-	mSSAOBuffer.FBO = 0;
-	mSSAOBuffer.mSSAOTex = 0;
-
 	FRenderSystem::OnResolutionChange.AddListener<FSSAOPostProcess, &FSSAOPostProcess::ResizeRenderTarget>(this);
 
+	FShader DownsampleFrag{ L"Shaders/SSAODepthDownsample.frag.glsl", GL_FRAGMENT_SHADER };
+	mDepthDownsample.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
+	mDepthDownsample.AttachShader(DownsampleFrag);
+	mDepthDownsample.LinkProgram();
+
 	FShader SSAOFrag{ L"Shaders/SSAOPass.frag.glsl", GL_FRAGMENT_SHADER };
 	mSSAO.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
 	mSSAO.AttachShader(SSAOFrag);
@@ -40,6 +75,11 @@ FSSAOPostProcess::~FSSAOPostProcess()
 	glDeleteTextures(1, &mSampleTex);
 }
 
+void FSSAOPostProcess::OnAdded(FRenderTargetPool& RenderTargets)
+{
+	mRenderTargets = &RenderTargets;
+}
+
 void FSSAOPostProcess::GenerateNoiseTexture(const uint32_t Size)
 {
 	std::default_random_engine Generator;
@@ -104,20 +144,65 @@ void FSSAOPostProcess::GenerateSampleTexture(const uint32_t KernalSize)
 
 void FSSAOPostProcess::OnPostLightingPass()
 {
-	GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, mSSAOBuffer.FBO));
+	RenderOcclusion();
 
-	glDisable(GL_BLEND);
-	glDisable(GL_DEPTH_TEST);
-	mSSAO.Use();
+	SGLState::Enable(GL_BLEND);
+	SGLState::BlendFunc(GL_ONE, GL_ONE);
+	SGLState::BlendEquation(GL_FUNC_ADD);
+	mBlur.Use();
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
 
-	GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+void FSSAOPostProcess::OnComposite(FShaderProgram& Program)
+{
+	RenderOcclusion();
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE);
-	glBlendEquation(GL_FUNC_ADD);
-	mBlur.Use();
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	Program.SetVector("uSSAOAmbient", 1, &mAmbient);
+	Program.SetUniform("uSSAODownsample", GetDownsample(mQuality));
+	Program.SetUniform("uSSAOIsOccluded", (uint32_t)IsSampled(mQuality));
+	Program.SetUniform("uSSAOIsTraced", (uint32_t)(mQuality == Traced));
+}
+
+void FSSAOPostProcess::RenderOcclusion()
+{
+	SGLState::Disable(GL_DEPTH_TEST);
+
+	if (IsSampled(mQuality))
+	{
+		ASSERT(mRenderTargets && "Occlusion is only rendered by effects added to a render system.");
+
+		// Depth is never filtered, blending across an edge would make a surface that isn't there
+		const FRenderTargetPool::Target DepthTarget = mRenderTargets->Acquire(FRenderTargetPool::Description{ mSSAOSize, GL_RG32F, GL_NEAREST });
+		const FRenderTargetPool::Target OcclusionTarget = mRenderTargets->Acquire(FRenderTargetPool::Description{ mSSAOSize, GL_R16F, GL_NEAREST });
+
+		// Only the part of the targets covering the scaled scene is drawn
+		const Vector2ui RenderResolution = SScreen::GetRenderResolution();
+		const uint32_t Downsample = GetDownsample(mQuality);
+		const Vector2ui Size{ (RenderResolution.x + Downsample - 1) / Downsample, (RenderResolution.y + Downsample - 1) / Downsample };
+		const GLuint SceneFramebuffer = SGLState::GetFramebuffer();
+
+		SGLState::Disable(GL_BLEND);
+		GL_CHECK(glViewport(0, 0, Size.x, Size.y));
+
+		// Reduce depth first, so the kernel's scattered samples hit a small texture
+		SGLState::BindFramebuffer(DepthTarget.FBO);
+		mDepthDownsample.Use();
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+		SGLState::BindTexture(GLTextureBindings::SSAODepth, GL_TEXTURE_2D, DepthTarget.Texture);
+		SGLState::BindFramebuffer(OcclusionTarget.FBO);
+		mSSAO.Use();
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+		// Depth is only read by the occlusion pass. The occlusion is read by the blur or by
+		// the composite pass drawn after every composited effect is set up, so it's kept to the end of the frame.
+		mRenderTargets->Release(DepthTarget);
+		mRenderTargets->ReleaseAtFrameEnd(OcclusionTarget);
+		SGLState::BindTexture(GLTextureBindings::SSAOTexture, GL_TEXTURE_2D, OcclusionTarget.Texture);
+
+		SGLState::BindFramebuffer(SceneFramebuffer);
+		GL_CHECK(glViewport(0, 0, RenderResolution.x, RenderResolution.y));
+	}
 }
 
 void FSSAOPostProcess::SetRadius(const float Radius)
@@ -145,28 +230,33 @@ void FSSAOPostProcess::SetPower(const float Power)
 
 void FSSAOPostProcess::SetGlobalAmbient(const Vector3f& Ambient)
 {
-	mBlur.SetVector("uAmbient", 1, &Ambient);
+	mAmbient = Ambient;
+	mBlur.SetVector("uSSAOAmbient", 1, &Ambient);
 }
 
-void FSSAOPostProcess::ResizeRenderTarget(const Vector2ui Size)
+void FSSAOPostProcess::SetQuality(const Quality Mode)
 {
-	if (mSSAOBuffer.FBO != 0)
-	{
-		// Using buffer immutable textures, so just reallocate
-		glDeleteFramebuffers(1, &mSSAOBuffer.FBO);
-		glDeleteTextures(1, &mSSAOBuffer.mSSAOTex);
-	}
+	mQuality = Mode;
+
+	// Screen coordinates are scaled down to the occlusion texture, and back up to the GBuffer
+	const uint32_t Downsample = GetDownsample(Mode);
+	mDepthDownsample.SetUniform("uDownsample", Downsample);
+	mSSAO.SetUniform("uDownsample", Downsample);
+	mBlur.SetUniform("uSSAODownsample", Downsample);
+	mBlur.SetUniform("uSSAOIsOccluded", (uint32_t)IsSampled(Mode));
+	mBlur.SetUniform("uSSAOIsTraced", (uint32_t)(Mode == Traced));
+
+	ResizeRenderTarget(mResolution);
+}
+
+void FSSAOPostProcess::ResizeRenderTarget(const Vector2ui Resolution)
+{
+	mResolution = Resolution;
+
+	// Rounded up so every screen pixel has an occlusion texel
+	const uint32_t Downsample = GetDownsample(mQuality);
+	const Vector2ui Size{ (Resolution.x + Downsample - 1) / Downsample, (Resolution.y + Downsample - 1) / Downsample };
 
-	GL_CHECK(glGenFramebuffers(1, &mSSAOBuffer.FBO));
-	GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, mSSAOBuffer.FBO));
-	GL_CHECK(glViewport(0, 0, Size.x, Size.y));
-		GL_CHECK(glGenTextures(1, &mSSAOBuffer.mSSAOTex));
-		GL_CHECK(glActiveTexture(GL_TEXTURE0 + GLTextureBindings::SSAOTexture));
-		GL_CHECK(glBindTexture(GL_TEXTURE_2D, mSSAOBuffer.mSSAOTex));
-			GL_CHECK(glTexStorage2D(GL_TEXTURE_2D, 1, GL_R16F, Size.x, Size.y));
-			GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-			GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-		GL_CHECK(glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mSSAOBuffer.mSSAOTex, 0));
-		GL_CHECK(glDrawBuffer(GL_COLOR_ATTACHMENT0));
-	GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	// Targets of the old size are taken no more, and the pool deletes them once unused
+	mSSAOSize = Size;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Rendering/LightSystems.h"
 #include "ResourceHolder.h"
 #include "Rendering\GLUtils.h"
+#include "Rendering\GLState.h"
 #include "Math\Transform.h"
 #include "Atlas\GameObject.h"
 #include "Atlas\World.h"
@@ -9,9 +10,81 @@
 #include "Input\ButtonEvent.h"
 #include "Rendering\RenderSystem.h"
 #include "Debugging\DebugDraw.h"
+#include "Debugging\GPUProfiler.h"
 #include "Math\Box.h"
+#include "Math\PerspectiveMatrix.h"
 #include "Rendering\Screen.h"
+#include "Debugging\CPUProfiler.h"
+#include "ChunkSystems\Chunk.h"
 #include <limits>
+#include <algorithm>
+#include <cmath>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Tile size and list length of TiledLighting.glsl
+	const uint32_t TILE_SIZE = 16;
+	const uint32_t MAX_LIGHTS_PER_TILE = 128;
+
+	// Shader storage bindings of the lighting shaders
+	const GLuint LIGHT_BINDING = 2;
+	const GLuint TILE_INFO_BINDING = 3;
+	const GLuint TILE_LIGHT_BINDING = 4;
+	const GLuint DIRECTIONAL_LIGHT_BINDING = 5;
+
+	// Lights each streaming buffer has room for before growing
+	const uint32_t INITIAL_LIGHT_CAPACITY = 256;
+
+	// Sizes of TileInfo_t and TileLight_t
+	const uint32_t TILE_INFO_SIZE = 12;
+	const uint32_t TILE_LIGHT_SIZE = 8;
+
+	/**
+	* Finds the screen rect covered by a view space sphere.
+	* @param Sphere - The sphere in view space.
+	* @param Projection - The camera projection.
+	* @param Near - Distance to the near plane.
+	* @param Resolution - The screen resolution.
+	* @param RectOut - To put the x, y, width and height of the rect in pixels.
+	* @return False if the sphere reaches past the near plane, where it may cover the whole screen.
+	*/
+	bool GetScissorRect(const FSphere& Sphere, const FMatrix4& Projection, const float Near, const Vector2ui& Resolution, Vector4i& RectOut)
+	{
+		if (-Sphere.Center.z - Sphere.Radius <= Near)
+			return false;
+
+		float MinX = 1.0f, MinY = 1.0f;
+		float MaxX = -1.0f, MaxY = -1.0f;
+
+		// Project the corners of the sphere's bounds
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			const Vector3f Corner = Sphere.Center + Vector3f{ i & 1 ? Sphere.Radius : -Sphere.Radius,
+															  i & 2 ? Sphere.Radius : -Sphere.Radius,
+															  i & 4 ? Sphere.Radius : -Sphere.Radius };
+			const Vector4f Clip = Projection.TransformVector(Vector4f{ Corner, 1.0f });
+
+			MinX = std::min(MinX, Clip.x / Clip.w);
+			MinY = std::min(MinY, Clip.y / Clip.w);
+			MaxX = std::max(MaxX, Clip.x / Clip.w);
+			MaxY = std::max(MaxY, Clip.y / Clip.w);
+		}
+
+		MinX = std::max(MinX, -1.0f);
+		MinY = std::max(MinY, -1.0f);
+		MaxX = std::min(MaxX, 1.0f);
+		MaxY = std::min(MaxY, 1.0f);
+
+		RectOut.x = (int32_t)std::floor((MinX * 0.5f + 0.5f) * Resolution.x);
+		RectOut.y = (int32_t)std::floor((MinY * 0.5f + 0.5f) * Resolution.y);
+		RectOut.z = std::max((int32_t)std::ceil((MaxX * 0.5f + 0.5f) * Resolution.x) - RectOut.x, 0);
+		RectOut.w = std::max((int32_t)std::ceil((MaxY * 0.5f + 0.5f) * Resolution.y) - RectOut.y, 0);
+		return true;
+	}
+}
 
 ////////////////////////////////////////////////////////////////////////////////////
 //////////////////////// Directional Light /////////////////////////////////////////
@@ -19,7 +92,10 @@
 
 FDirectionalLightSystem::FDirectionalLightSystem(Atlas::FWorld& World, FRenderSystem& RenderSystem)
 	: ILightSystem(World, RenderSystem)
-	, mLightUniformBuffer(GLUniformBindings::DirectionalLight, sizeof(ShaderDirectionalLight))
+	, mShadowMap()
+	, mLightBuffer(GL_SHADER_STORAGE_BUFFER, sizeof(FRenderPacket::DirectionalLight) * INITIAL_LIGHT_CAPACITY)
+	, mCompositeEffect(*this)
+	, mIsComposited(false)
 {
 	AddComponentType<Atlas::EComponent::DirectionalLight>();
 
@@ -35,27 +111,91 @@ FDirectionalLightSystem::~FDirectionalLightSystem()
 
 }
 
-void FDirectionalLightSystem::Update()
+void FDirectionalLightSystem::Extract(FRenderPacket& Packet)
 {
 	using namespace Atlas;
-	mLightShader.Use();
-	ShaderDirectionalLight Light;
 
-	for (const auto& Object : GetGameObjects())
+	const auto& GameObjects = GetGameObjects();
+
+	Packet.DirectionalLights.clear();
+	for (uint32_t i = 0; i < GameObjects.size(); i++)
 	{	
 		// Get light transform and light component
-		FTransform& LightTransform = Object->Transform;
-		const FDirectionalLight& LightComponent = Object->GetComponent<EComponent::DirectionalLight>();
+		FTransform& LightTransform = GameObjects[i]->Transform;
+		const FDirectionalLight& LightComponent = GetComponentAt<EComponent::DirectionalLight>(i);
 
 		// Set light data
+		FRenderPacket::DirectionalLight Light;
 		Light.Direction = LightTransform.GetRotation() * -Vector3f::Forward;
+		Light.Pad0 = 0;
 		Light.Color = LightComponent.Color;
+		Light.Pad1 = 0;
+		Packet.DirectionalLights.push_back(Light);
+	}
+}
+
+void FDirectionalLightSystem::Update()
+{
+	CPU_PROFILE("DirectionalLightSystemUpdate");
 
-		// Send light data
-		mLightUniformBuffer.SetData(0, (uint8_t*)&Light, sizeof(ShaderDirectionalLight));
+	// Last frame's lights are fenced here, after every pass that may have shaded them
+	mLightBuffer.EndFrame();
 
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	const FRenderPacket& Packet = mRenderSystem.GetPacket();
+	const auto& Lights = Packet.DirectionalLights;
+	if (Lights.empty())
+		return;
+
+	FDebug::GPUProfiler& Profiler = FDebug::GPUProfiler::GetInstance();
+
+	// Only the first light casts shadows, traced shadows draw no cascades
+	if (!Packet.IsShadowTraced)
+	{
+		Profiler.BeginPass("ShadowCascades");
+		mShadowMap.Update(mRenderSystem.GetChunkManager(), Packet.View, Lights[0].Direction);
+		Profiler.EndPass();
 	}
+
+	// Send every light at once, then shade them all in one pass
+	mLightBuffer.Upload(Lights.data(), sizeof(FRenderPacket::DirectionalLight) * Lights.size());
+	if (mIsComposited)
+		return;
+
+	Profiler.BeginPass("DirectionalLights");
+	BindLighting(mLightShader);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	Profiler.EndPass();
+}
+
+void FDirectionalLightSystem::BindLighting(FShaderProgram& Program)
+{
+	const FRenderPacket& Packet = mRenderSystem.GetPacket();
+	mLightBuffer.Bind(DIRECTIONAL_LIGHT_BINDING);
+
+	Program.Use();
+	Program.SetUniform("uDirectionalLightCount", (uint32_t)Packet.DirectionalLights.size(), std::true_type{});
+	Program.SetUniform("uIsShadowTraced", (uint32_t)Packet.IsShadowTraced, std::true_type{});
+	if (!Packet.IsShadowTraced)
+		mShadowMap.Bind(Program, Packet.View);
+}
+
+void FDirectionalLightSystem::FCompositeEffect::OnPostLightingPass()
+{
+	// Nothing to fuse with, so the lights are added to the lit scene as during lighting
+	SGLState::Disable(GL_DEPTH_TEST);
+	SGLState::Enable(GL_BLEND);
+	SGLState::BlendFunc(GL_ONE, GL_ONE);
+	SGLState::BlendEquation(GL_FUNC_ADD);
+
+	mLightSystem.BindLighting(mLightSystem.mLightShader);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	SGLState::Disable(GL_BLEND);
+}
+
+void FDirectionalLightSystem::FCompositeEffect::OnComposite(FShaderProgram& Program)
+{
+	mLightSystem.BindLighting(Program);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -64,57 +204,205 @@ void FDirectionalLightSystem::Update()
 
 FPointLightSystem::FPointLightSystem(Atlas::FWorld& World, FRenderSystem& RenderSystem)
 	: ILightSystem(World, RenderSystem)
-	, mUniformBuffer(GLUniformBindings::PointLight, sizeof(ShaderPointLight))
+	, mShadingMode(IsTiledShadingSupported() ? ShadingMode::Tiled : ShadingMode::LightVolumes)
+	, mCullingProgram()
+	, mVolumeShader()
+	, mLightIndexUniform(mVolumeShader.FindUniform("uLightIndex"))
+	, mLightBuffer(GL_SHADER_STORAGE_BUFFER, sizeof(FRenderPacket::PointLight) * INITIAL_LIGHT_CAPACITY)
+	, mTileInfoBuffer(0)
+	, mTileLightBuffer(0)
+	, mTileCapacity(0)
+	, mLightIndex((float)FChunk::CHUNK_SIZE)
+	, mFrustumLights()
+	, mLightVolumes()
+	, mLightVisibility()
 {
 	AddComponentType<Atlas::EComponent::PointLight>();
 
+	FShader VolumeShader{ L"Shaders/DeferredPointLightVolume.frag", GL_FRAGMENT_SHADER };
+
+	mVolumeShader.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
+	mVolumeShader.AttachShader(VolumeShader);
+	mVolumeShader.LinkProgram();
+
+	if (!IsTiledShadingSupported())
+		return;
+
+	FShader CullingShader{ L"Shaders/TiledLightCulling.comp", GL_COMPUTE_SHADER };
+	mCullingProgram.AttachShader(CullingShader);
+	mCullingProgram.LinkProgram();
+
 	FShader FragShader{ L"Shaders/DeferredPointLighting.frag", GL_FRAGMENT_SHADER };
 
 	mLightShader.AttachShader(SShaderHolder::Get("FullScreenQuad.vert"));
 	mLightShader.AttachShader(FragShader);
 	mLightShader.LinkProgram();
+
+	glGenBuffers(1, &mTileInfoBuffer);
+	glGenBuffers(1, &mTileLightBuffer);
 }
 
 
 FPointLightSystem::~FPointLightSystem()
 {
+	glDeleteBuffers(1, &mTileLightBuffer);
+	glDeleteBuffers(1, &mTileInfoBuffer);
 }
 
-void FPointLightSystem::Update()
+void FPointLightSystem::OnGameObjectAdd(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent)
+{
+	mLightIndex.Add(GameObject, static_cast<FPointLight*>(&UpdateComponent)->MaxDistance);
+}
+
+void FPointLightSystem::OnGameObjectRemove(Atlas::FGameObject& GameObject, Atlas::IComponent& UpdateComponent)
+{
+	UpdateComponent; // remove compiler warning
+	mLightIndex.Remove(GameObject);
+}
+
+void FPointLightSystem::Extract(FRenderPacket& Packet)
 {
 	using namespace Atlas;
+
+	// Moved lights are rehashed, ranges may be changed on the component at any time
+	mLightIndex.Update([](FGameObject& Object) { return Object.GetComponent<EComponent::PointLight>().MaxDistance; });
+
+	// Only the lights in cells the view volume reaches are tested, then those lighting only what the terrain hides are dropped
+	mFrustumLights.clear();
+	mLightIndex.QueryFrustum(Packet.View.WorldFrustum, mFrustumLights);
+
+	mLightVolumes.resize(mFrustumLights.size());
+	for (uint32_t i = 0; i < mFrustumLights.size(); i++)
+		mLightVolumes[i] = FSphere{ mFrustumLights[i]->Transform.GetWorldPosition(), mFrustumLights[i]->GetComponent<EComponent::PointLight>().MaxDistance };
+
+	mLightVisibility.assign(mLightVolumes.size(), 1);
+	mRenderSystem.CullOccluded(mLightVolumes.data(), mLightVolumes.size(), mLightVisibility.data());
+
+	Packet.PointLights.clear();
+	mLightPositions.clear();
+	for (uint32_t i = 0; i < mFrustumLights.size(); i++)
+	{
+		if (!mLightVisibility[i] || !mFrustumLights[i]->IsActive())
+			continue;
+
+		const FPointLight& LightComponent = mFrustumLights[i]->GetComponent<EComponent::PointLight>();
+		mLightPositions.push_back(mLightVolumes[i].Center);
+
+		FRenderPacket::PointLight Light;
+		Light.Radius = mLightVolumes[i].Radius;
+		Light.Color = LightComponent.Color;
+		Light.Intensity = LightComponent.Intensity;
+		Light.Constant = LightComponent.Constant;
+		Light.Linear = LightComponent.Linear;
+		Light.Quadratic = LightComponent.Quadratic;
+		Light.Pad0 = 0;
+		Packet.PointLights.push_back(Light);
+	}
+
+	// Move the visible lights to view space in one batch
+	Packet.View.WorldToView.TransformPositions(mLightPositions.data(), mLightPositions.data(), mLightPositions.size());
+	for (uint32_t i = 0; i < mLightPositions.size(); i++)
+		Packet.PointLights[i].Position = mLightPositions[i];
+}
+
+void FPointLightSystem::Update()
+{
+	CPU_PROFILE("PointLightSystemUpdate");
+
+	const FRenderPacket& Packet = mRenderSystem.GetPacket();
+	const auto& Lights = Packet.PointLights;
+	if (Lights.empty())
+		return;
+
+	// Both paths read the lights of the frame from one upload
+	mLightBuffer.Upload(Lights.data(), sizeof(FRenderPacket::PointLight) * Lights.size());
+	mLightBuffer.Bind(LIGHT_BINDING);
+
+	FDebug::GPUProfiler::Scope Profile{ "PointLights" };
+	if (mShadingMode == ShadingMode::Tiled)
+		RenderTiled(Lights);
+	else
+		RenderLightVolumes(Packet.View, Lights);
+
+	mLightBuffer.EndFrame();
+}
+
+void FPointLightSystem::SetShadingMode(const ShadingMode Mode)
+{
+	mShadingMode = IsTiledShadingSupported() ? Mode : ShadingMode::LightVolumes;
+}
+
+bool FPointLightSystem::IsTiledShadingSupported()
+{
+	// Storage buffers are required by FCubeRoot, light volumes read them as well
+	return GLEW_ARB_compute_shader;
+}
+
+void FPointLightSystem::RenderTiled(const std::vector<FRenderPacket::PointLight>& Lights)
+{
+	const Vector2ui Resolution = SScreen::GetRenderResolution();
+	const uint32_t TileCountX = (Resolution.x + TILE_SIZE - 1) / TILE_SIZE;
+	const uint32_t TileCountY = (Resolution.y + TILE_SIZE - 1) / TILE_SIZE;
+	AllocateTiles(TileCountX * TileCountY);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TILE_INFO_BINDING, mTileInfoBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TILE_LIGHT_BINDING, mTileLightBuffer);
+
+	// Bin lights into tiles with the depth of the G-Buffer
+	FDebug::GPUProfiler& Profiler = FDebug::GPUProfiler::GetInstance();
+	Profiler.BeginPass("TiledLightCulling");
+	mCullingProgram.Use();
+	mCullingProgram.SetUniform("uLightCount", (uint32_t)Lights.size(), std::true_type{});
+	glDispatchCompute(TileCountX, TileCountY, 1);
+	Profiler.EndPass();
+
+	// Tile lists are read by the shading pass
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
 	mLightShader.Use();
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
 
-	ShaderPointLight Light;
-	const FFrustum Frustum = FCamera::Main->GetViewFrustum();
-	const FMatrix4 ViewTransform = FCamera::Main->Transform.WorldToLocalMatrix();
+void FPointLightSystem::RenderLightVolumes(const FRenderView& View, const std::vector<FRenderPacket::PointLight>& Lights)
+{
+	const Vector2ui Resolution = SScreen::GetRenderResolution();
+	const FMatrix4& Projection = View.Projection;
+	const float Near = FPerspectiveMatrix::GetNear(Projection);
 
-	for (const auto& Object : GetGameObjects())
+	mVolumeShader.Use();
+	SGLState::Enable(GL_SCISSOR_TEST);
+
+	for (uint32_t i = 0; i < Lights.size(); i++)
 	{
-		const FTransform& Transform = Object->Transform;
-		const FPointLight& LightComponent = Object->GetComponent<EComponent::PointLight>();
+		// Lights reaching past the near plane are drawn over the whole screen
+		Vector4i Rect{ 0, 0, (int32_t)Resolution.x, (int32_t)Resolution.y };
+		GetScissorRect(FSphere{ Lights[i].Position, Lights[i].Radius }, Projection, Near, Resolution, Rect);
 
-		// Check if light is in the view volume
-		const Vector3f LightViewSpace = ViewTransform.TransformPosition(Transform.GetWorldPosition());
-		const FSphere LightVolume{ LightViewSpace, LightComponent.MaxDistance };
+		if (Rect.z == 0 || Rect.w == 0)
+			continue;
 
-		if (Frustum.IsSphereVisible(LightVolume))
-		{
-			// Set light data
-			Light.Position = LightViewSpace;
-			Light.Color = LightComponent.Color;
-			Light.Constant = LightComponent.Constant;
-			Light.Linear = LightComponent.Linear;
-			Light.Quadratic = LightComponent.Quadratic;
-			Light.Intensity = LightComponent.Intensity;
-		
-
-			// Copy to buffer
-			mUniformBuffer.SetData(0, (uint8_t*)&Light, sizeof(ShaderPointLight));
-
-			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-		}
+		glScissor(Rect.x, Rect.y, Rect.z, Rect.w);
+		mVolumeShader.SetUniform(mLightIndexUniform, i, std::true_type{});
+
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	}
+
+	SGLState::Disable(GL_SCISSOR_TEST);
+}
+
+void FPointLightSystem::AllocateTiles(const uint32_t TileCount)
+{
+	if (TileCount <= mTileCapacity)
+		return;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTileInfoBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, TILE_INFO_SIZE * TileCount, nullptr, GL_DYNAMIC_COPY);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTileLightBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, TILE_LIGHT_SIZE * MAX_LIGHTS_PER_TILE * TileCount, nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	mTileCapacity = TileCount;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
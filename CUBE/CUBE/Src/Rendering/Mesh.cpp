@@ -4,8 +4,9 @@
 #include "Rendering\VertexTraits.h"
 #include "SFML\Window\Context.hpp"
 #include "Components\MeshRenderer.h"
-#include "tinyobjloader\tiny_obj_loader.h"
+#include "Rendering\MeshAsset.h"
 #include <fstream>
+#include <cstring>
 
 BMesh::BMesh(const GLuint DrawMode, const uint32_t DefaultBufferSize )
 	: mVertexData(DefaultBufferSize)
@@ -108,6 +109,14 @@ void BMesh::RenderB(const GLenum RenderMode)
 	glDrawElements(RenderMode, mIndexCount, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
 }
 
+void BMesh::RenderInstancedB(const uint32_t InstanceCount, const GLenum RenderMode)
+{
+	ASSERT(mIsActive);
+	GLUtils::ArrayBinder VAOBinding(mVertexArray);
+
+	glDrawElementsInstanced(RenderMode, mIndexCount, GL_UNSIGNED_INT, BUFFER_OFFSET(0), InstanceCount);
+}
+
 void BMesh::DeactivateB()
 {
 	mIsActive = false;
@@ -207,44 +216,8 @@ bool TMesh<MeshVertex>::LoadModel(const char* ModelFilepath)
 {
 	std::vector<MeshVertex> Vertices;
 	std::vector<uint32_t> Indices;
-
-	std::vector<tinyobj::shape_t> Shapes;
-	std::vector<tinyobj::material_t> Materials;
-	std::string Error = tinyobj::LoadObj(Shapes, Materials, ModelFilepath);
-
-	if (!Error.empty()) 
-	{
-		std::cerr << Error << std::endl;
+	if (!SMeshAsset::ReadOBJ(ModelFilepath, Vertices, Indices))
 		return false;
-	}
-
-	for (uint32_t s = 0; s < Shapes.size(); s++)
-	{
-		tinyobj::mesh_t& Mesh = Shapes[s].mesh;
-
-		const uint32_t VerticesSize = Vertices.size();
-		for (uint32_t i = 0; i < Mesh.indices.size(); i++)
-		{
-			Indices.push_back(Mesh.indices[i] + VerticesSize);
-		}
-
-		for (uint32_t i = 0; i < Mesh.positions.size(); i+=3)
-		{
-			const Vector4f P{ Mesh.positions[i + 0], Mesh.positions[i + 1], Mesh.positions[i + 2], 1 };
-			const Vector3f N{ Mesh.normals[i + 0], Mesh.normals[i + 1], Mesh.normals[i + 2] };
-
-			Vertices.push_back(MeshVertex{ P, N, Vector3f{} });
-		}
-
-		for (uint32_t i = 0; i < Mesh.material_ids.size(); i++)
-		{
-			uint32_t MatID = Mesh.material_ids[i];
-			Vertices[Indices[VerticesSize + i * 3]].Color = Vector3f{ Materials[MatID].diffuse[0], Materials[MatID].diffuse[1], Materials[MatID].diffuse[2] };
-			Vertices[Indices[VerticesSize + i * 3 + 1]].Color = Vector3f{ Materials[MatID].diffuse[0], Materials[MatID].diffuse[1], Materials[MatID].diffuse[2] };
-			Vertices[Indices[VerticesSize + i * 3 + 2]].Color = Vector3f{ Materials[MatID].diffuse[0], Materials[MatID].diffuse[1], Materials[MatID].diffuse[2] };
-		}
-
-	}
 
 	AddVertex(Vertices.data(), Vertices.size());
 	AddIndices(Indices.data(), Indices.size());
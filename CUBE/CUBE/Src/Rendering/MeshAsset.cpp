@@ -0,0 +1,218 @@
+#include "Rendering\MeshAsset.h"
+#include "Components\ObjectMesh.h"
+#include "FileIO\GenericFile.h"
+#include "Debugging\ConsoleOutput.h"
+#include "tinyobjloader\tiny_obj_loader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Identifies a cooked mesh, the version changes whenever the layout of the file changes
+	const uint32_t ASSET_MAGIC = 0x48534D43; // "CMSH"
+	const uint32_t ASSET_VERSION = 1;
+
+	/**
+	* Starts an asset. The vertices follow, then the indices.
+	*/
+	struct AssetHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t VertexSize;   // sizeof(MeshVertex) when cooked
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		float    BoundsCenter[3];
+		float    BoundsRadius;
+		uint32_t Pad0;
+	};
+
+	/**
+	* Checks that an asset matches this version and vertex layout, and is complete.
+	*/
+	bool IsValidAsset(const uint8_t* Data, const uint32_t Size, const wchar_t* AssetFilename)
+	{
+		if (Size < sizeof(AssetHeader))
+			return false;
+
+		AssetHeader Header;
+		memcpy(&Header, Data, sizeof(AssetHeader));
+
+		const uint32_t VertexBytes = Header.VertexCount * sizeof(MeshVertex);
+		const uint32_t IndexBytes = Header.IndexCount * sizeof(uint32_t);
+		if (Header.Magic != ASSET_MAGIC || Header.Version != ASSET_VERSION || Header.VertexSize != sizeof(MeshVertex) ||
+			Size != sizeof(AssetHeader) + VertexBytes + IndexBytes)
+		{
+			FDebug::PrintF("Mesh asset %S is out of date and must be cooked again.\n", AssetFilename);
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	* Uploads a valid asset to a mesh.
+	*/
+	void UploadAsset(const uint8_t* Data, TMesh<MeshVertex>& MeshOut, Vector3f& BoundsCenterOut, float& BoundsRadiusOut)
+	{
+		AssetHeader Header;
+		memcpy(&Header, Data, sizeof(AssetHeader));
+
+		// Straight from the asset's bytes to the GL buffers
+		const uint32_t VertexBytes = Header.VertexCount * sizeof(MeshVertex);
+		const MeshVertex* Vertices = (const MeshVertex*)(Data + sizeof(AssetHeader));
+		const uint32_t* Indices = (const uint32_t*)(Data + sizeof(AssetHeader) + VertexBytes);
+		MeshOut.MapAndActivate(Vertices, Header.VertexCount, Indices, Header.IndexCount);
+
+		BoundsCenterOut = Vector3f{ Header.BoundsCenter[0], Header.BoundsCenter[1], Header.BoundsCenter[2] };
+		BoundsRadiusOut = Header.BoundsRadius;
+	}
+}
+
+bool SMeshAsset::ReadOBJ(const char* ModelFilepath, std::vector<MeshVertex>& VerticesOut, std::vector<uint32_t>& IndicesOut)
+{
+	std::vector<tinyobj::shape_t> Shapes;
+	std::vector<tinyobj::material_t> Materials;
+	std::string Error = tinyobj::LoadObj(Shapes, Materials, ModelFilepath);
+
+	if (!Error.empty())
+	{
+		std::cerr << Error << std::endl;
+		return false;
+	}
+
+	for (uint32_t s = 0; s < Shapes.size(); s++)
+	{
+		tinyobj::mesh_t& Mesh = Shapes[s].mesh;
+
+		const uint32_t VerticesSize = VerticesOut.size();
+		for (uint32_t i = 0; i < Mesh.indices.size(); i++)
+		{
+			IndicesOut.push_back(Mesh.indices[i] + VerticesSize);
+		}
+
+		for (uint32_t i = 0; i < Mesh.positions.size(); i += 3)
+		{
+			const Vector4f P{ Mesh.positions[i + 0], Mesh.positions[i + 1], Mesh.positions[i + 2], 1 };
+			const Vector3f N{ Mesh.normals[i + 0], Mesh.normals[i + 1], Mesh.normals[i + 2] };
+
+			VerticesOut.push_back(MeshVertex{ P, N, Vector3f{} });
+		}
+
+		for (uint32_t i = 0; i < Mesh.material_ids.size(); i++)
+		{
+			uint32_t MatID = Mesh.material_ids[i];
+			VerticesOut[IndicesOut[VerticesSize + i * 3]].Color = Vector3f{ Materials[MatID].diffuse[0], Materials[MatID].diffuse[1], Materials[MatID].diffuse[2] };
+			VerticesOut[IndicesOut[VerticesSize + i * 3 + 1]].Color = Vector3f{ Materials[MatID].diffuse[0], Materials[MatID].diffuse[1], Materials[MatID].diffuse[2] };
+			VerticesOut[IndicesOut[VerticesSize + i * 3 + 2]].Color = Vector3f{ Materials[MatID].diffuse[0], Materials[MatID].diffuse[1], Materials[MatID].diffuse[2] };
+		}
+	}
+
+	return true;
+}
+
+bool SMeshAsset::Cook(const char* ModelFilepath, const wchar_t* AssetFilename)
+{
+	std::vector<MeshVertex> Vertices;
+	std::vector<uint32_t> Indices;
+	if (!ReadOBJ(ModelFilepath, Vertices, Indices))
+		return false;
+
+	Vector3f BoundsCenter;
+	float BoundsRadius;
+	ComputeBounds(Vertices.data(), Vertices.size(), BoundsCenter, BoundsRadius);
+
+	AssetHeader Header;
+	Header.Magic = ASSET_MAGIC;
+	Header.Version = ASSET_VERSION;
+	Header.VertexSize = sizeof(MeshVertex);
+	Header.VertexCount = Vertices.size();
+	Header.IndexCount = Indices.size();
+	Header.BoundsCenter[0] = BoundsCenter.x;
+	Header.BoundsCenter[1] = BoundsCenter.y;
+	Header.BoundsCenter[2] = BoundsCenter.z;
+	Header.BoundsRadius = BoundsRadius;
+	Header.Pad0 = 0;
+
+	// Written in one go, so a partly written asset fails the size check on load
+	const uint32_t VertexBytes = Vertices.size() * sizeof(MeshVertex);
+	const uint32_t IndexBytes = Indices.size() * sizeof(uint32_t);
+	std::vector<uint8_t> Data(sizeof(AssetHeader) + VertexBytes + IndexBytes);
+	memcpy(Data.data(), &Header, sizeof(AssetHeader));
+	memcpy(Data.data() + sizeof(AssetHeader), Vertices.data(), VertexBytes);
+	memcpy(Data.data() + sizeof(AssetHeader) + VertexBytes, Indices.data(), IndexBytes);
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	if (FileSystem.FileExists(AssetFilename))
+		FileSystem.DeleteFilename(AssetFilename);
+
+	auto File = FileSystem.OpenWritable(AssetFilename, false, true);
+	if (!File || !File->Write(Data.data(), Data.size()))
+		return false;
+
+	return File->Flush();
+}
+
+bool SMeshAsset::Load(const wchar_t* AssetFilename, TMesh<MeshVertex>& MeshOut, Vector3f& BoundsCenterOut, float& BoundsRadiusOut)
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	if (!FileSystem.FileExists(AssetFilename))
+		return false;
+
+	auto File = FileSystem.OpenMapped(AssetFilename, false, true);
+	if (!File || !IsValidAsset(File->GetData(), File->GetFileSize(), AssetFilename))
+		return false;
+
+	UploadAsset(File->GetData(), MeshOut, BoundsCenterOut, BoundsRadiusOut);
+	return true;
+}
+
+bool SMeshAsset::Read(const wchar_t* AssetFilename, std::vector<uint8_t>& AssetOut)
+{
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	if (!FileSystem.FileExists(AssetFilename))
+		return false;
+
+	auto File = FileSystem.OpenReadable(AssetFilename);
+	if (!File)
+		return false;
+
+	AssetOut.resize(File->GetFileSize());
+	if (!File->Read(AssetOut.data(), AssetOut.size()))
+		return false;
+
+	return IsValidAsset(AssetOut.data(), AssetOut.size(), AssetFilename);
+}
+
+void SMeshAsset::Upload(const std::vector<uint8_t>& Asset, TMesh<MeshVertex>& MeshOut, Vector3f& BoundsCenterOut, float& BoundsRadiusOut)
+{
+	UploadAsset(Asset.data(), MeshOut, BoundsCenterOut, BoundsRadiusOut);
+}
+
+void SMeshAsset::ComputeBounds(const MeshVertex* Vertices, const uint32_t VertexCount, Vector3f& CenterOut, float& RadiusOut)
+{
+	CenterOut = Vector3f{};
+	RadiusOut = 0.0f;
+	if (VertexCount == 0)
+		return;
+
+	Vector3f Min{ Vertices[0].Position.x, Vertices[0].Position.y, Vertices[0].Position.z };
+	Vector3f Max = Min;
+	for (uint32_t i = 1; i < VertexCount; i++)
+	{
+		const Vector3f Position{ Vertices[i].Position.x, Vertices[i].Position.y, Vertices[i].Position.z };
+		Min = Vector3f{ std::min(Min.x, Position.x), std::min(Min.y, Position.y), std::min(Min.z, Position.z) };
+		Max = Vector3f{ std::max(Max.x, Position.x), std::max(Max.y, Position.y), std::max(Max.z, Position.z) };
+	}
+
+	CenterOut = (Min + Max) / 2.0f;
+	for (uint32_t i = 0; i < VertexCount; i++)
+	{
+		const Vector3f Position{ Vertices[i].Position.x, Vertices[i].Position.y, Vertices[i].Position.z };
+		RadiusOut = std::max(RadiusOut, (Position - CenterOut).Length());
+	}
+}
@@ -0,0 +1,195 @@
+#include "Rendering\ParticleSystem.h"
+#include "Rendering\GLBindings.h"
+#include "Rendering\GLState.h"
+#include "Debugging\GPUProfiler.h"
+
+#include <algorithm>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Work group size of ParticleEmit.comp and ParticleSimulate.comp
+	const uint32_t PARTICLE_GROUP_SIZE = 256;
+
+	// Shader storage bindings of the particle shaders
+	const GLuint PARTICLE_BINDING = 8;
+	const GLuint BURST_BINDING = 9;
+
+	// Laid out as Particle of the particle shaders
+	const uint32_t PARTICLE_SIZE = 32;
+
+	// Vertices of a particle's cube, 2 triangles a face
+	const GLsizei CUBE_VERTICES = 36;
+
+	// Frames too long to step in one go are simulated as if they weren't, so particles don't tunnel through blocks
+	const float MAX_DELTA_TIME = 0.05f;
+
+	uint32_t GroupCount(const uint32_t Count)
+	{
+		return (Count + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE;
+	}
+}
+
+FParticleSystem::FParticleSystem()
+	: mBursts()
+	, mFrameBursts()
+	, mSpawnedFrames()
+	, mEmitProgram()
+	, mSimulateProgram()
+	, mRenderProgram()
+	, mParticleBuffer(0)
+	, mBurstBuffer(0)
+	, mVertexArray(0)
+	, mNextSlot(0)
+	, mFrameSpawnSlot(0)
+	, mFrameSpawnCount(0)
+	, mFrameFirstLive(0)
+	, mFrameLiveCount(0)
+	, mFrameSeed(0)
+	, mFrameDeltaTime(0.0f)
+{
+	FShader EmitShader{ L"Shaders/ParticleEmit.comp", GL_COMPUTE_SHADER };
+	mEmitProgram.AttachShader(EmitShader);
+	mEmitProgram.LinkProgram();
+
+	FShader SimulateShader{ L"Shaders/ParticleSimulate.comp", GL_COMPUTE_SHADER };
+	mSimulateProgram.AttachShader(SimulateShader);
+	mSimulateProgram.LinkProgram();
+
+	// Shaded into the G-Buffer as every other object is
+	FShader RenderVert{ L"Shaders/ParticleRender.vert", GL_VERTEX_SHADER };
+	FShader RenderFrag{ L"Shaders/DeferredRender.frag", GL_FRAGMENT_SHADER };
+	mRenderProgram.AttachShader(RenderVert);
+	mRenderProgram.AttachShader(RenderFrag);
+	mRenderProgram.LinkProgram();
+
+	// Cleared slots have no life left, so the ring starts empty
+	glGenBuffers(1, &mParticleBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mParticleBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)PARTICLE_SIZE * MAX_PARTICLES, nullptr, GL_DYNAMIC_COPY);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+	glGenBuffers(1, &mBurstBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mBurstBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPUBurst) * MAX_BURSTS_PER_FRAME, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glGenVertexArrays(1, &mVertexArray);
+
+	mBursts.reserve(MAX_BURSTS_PER_FRAME);
+	mFrameBursts.reserve(MAX_BURSTS_PER_FRAME);
+}
+
+FParticleSystem::~FParticleSystem()
+{
+	glDeleteBuffers(1, &mParticleBuffer);
+	glDeleteBuffers(1, &mBurstBuffer);
+	glDeleteVertexArrays(1, &mVertexArray);
+}
+
+void FParticleSystem::Emit(const Burst& NewBurst)
+{
+	if (!Instance || NewBurst.Count == 0 || NewBurst.Lifetime <= 0.0f)
+		return;
+
+	if (Instance->mBursts.size() < MAX_BURSTS_PER_FRAME)
+		Instance->mBursts.push_back(NewBurst);
+}
+
+void FParticleSystem::CloseFrame(const float DeltaTime)
+{
+	mFrameDeltaTime = std::min(DeltaTime, MAX_DELTA_TIME);
+	mFrameSeed++;
+
+	// Frames whose particles all died no longer hold live slots
+	for (SpawnedFrame& Frame : mSpawnedFrames)
+		Frame.TimeLeft -= DeltaTime;
+	while (!mSpawnedFrames.empty() && mSpawnedFrames.front().TimeLeft <= 0.0f)
+		mSpawnedFrames.pop_front();
+
+	// Bursts past the size of the ring would overwrite their own particles
+	mFrameBursts.clear();
+	mFrameSpawnSlot = mNextSlot;
+	mFrameSpawnCount = 0;
+	float LongestLifetime = 0.0f;
+	for (const Burst& Queued : mBursts)
+	{
+		const uint32_t Count = std::min(Queued.Count, MAX_PARTICLES - mFrameSpawnCount);
+		if (Count == 0)
+			break;
+
+		mFrameBursts.push_back(GPUBurst{ Vector4f{ Queued.Position, Queued.Radius }, Vector4f{ Queued.Velocity, Queued.Speed },
+			mFrameSpawnCount, Count, Queued.BlockType, Queued.Lifetime });
+		mFrameSpawnCount += Count;
+		LongestLifetime = std::max(LongestLifetime, Queued.Lifetime);
+	}
+	mBursts.clear();
+
+	if (mFrameSpawnCount > 0)
+	{
+		mSpawnedFrames.push_back(SpawnedFrame{ LongestLifetime, mFrameSpawnCount });
+		mNextSlot = (mNextSlot + mFrameSpawnCount) % MAX_PARTICLES;
+	}
+
+	// Live slots run up to the next slot, from the oldest frame that may have a particle left
+	uint32_t LiveCount = 0;
+	for (const SpawnedFrame& Frame : mSpawnedFrames)
+		LiveCount += Frame.Count;
+	mFrameLiveCount = std::min(LiveCount, MAX_PARTICLES);
+	mFrameFirstLive = (mNextSlot + MAX_PARTICLES - mFrameLiveCount) % MAX_PARTICLES;
+}
+
+void FParticleSystem::Simulate(const GLuint DepthTexture, const GLuint GBufferTexture)
+{
+	if (mFrameLiveCount == 0)
+		return;
+
+	FDebug::GPUProfiler::Scope Profile{ "Particles" };
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_BINDING, mParticleBuffer);
+
+	if (mFrameSpawnCount > 0)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mBurstBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GPUBurst) * mFrameBursts.size(), mFrameBursts.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BURST_BINDING, mBurstBuffer);
+
+		mEmitProgram.Use();
+		mEmitProgram.SetUniform("uFirstSlot", mFrameSpawnSlot, std::true_type{});
+		mEmitProgram.SetUniform("uSpawnCount", mFrameSpawnCount, std::true_type{});
+		mEmitProgram.SetUniform("uBurstCount", (uint32_t)mFrameBursts.size(), std::true_type{});
+		mEmitProgram.SetUniform("uSeed", mFrameSeed, std::true_type{});
+		glDispatchCompute(GroupCount(mFrameSpawnCount), 1, 1);
+
+		// Spawned particles are moved the frame they spawn
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	SGLState::BindTexture(GLTextureBindings::GBuffer0, GL_TEXTURE_2D, GBufferTexture);
+	SGLState::BindTexture(GLTextureBindings::Depth, GL_TEXTURE_2D, DepthTexture);
+
+	mSimulateProgram.Use();
+	mSimulateProgram.SetUniform("uFirstSlot", mFrameFirstLive, std::true_type{});
+	mSimulateProgram.SetUniform("uLiveCount", mFrameLiveCount, std::true_type{});
+	mSimulateProgram.SetUniform("uDeltaTime", mFrameDeltaTime, std::true_type{});
+	glDispatchCompute(GroupCount(mFrameLiveCount), 1, 1);
+
+	// Particles are read by the G-Buffer draw
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void FParticleSystem::Render()
+{
+	if (mFrameLiveCount == 0)
+		return;
+
+	// Slots whose particle died are drawn as degenerate cubes
+	mRenderProgram.Use();
+	mRenderProgram.SetUniform("uFirstSlot", mFrameFirstLive, std::true_type{});
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_BINDING, mParticleBuffer);
+	SGLState::BindVertexArray(mVertexArray);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTICES, mFrameLiveCount);
+	SGLState::BindVertexArray(0);
+}
@@ -0,0 +1,144 @@
+#include "Rendering\ProgramBinaryCache.h"
+#include "FileIO\GenericFile.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const wchar_t* CACHE_DIRECTORY = L"ShaderCache";
+
+	// Identifies a cache file, changed whenever its layout changes
+	const uint32_t CACHE_MAGIC = 0x31425056; // "VPB1"
+
+	struct CacheHeader
+	{
+		uint32_t Magic;
+		GLenum   Format;
+		uint64_t Key;
+		uint32_t BinarySize;
+		uint32_t Pad0;
+	};
+
+	const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+}
+
+uint64_t SProgramBinaryCache::GetBaseKey()
+{
+	// Binaries are only valid for the driver that made them
+	static uint64_t BaseKey = 0;
+	if (BaseKey == 0)
+	{
+		BaseKey = FNV_OFFSET;
+
+		const GLenum DriverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+		for (const GLenum Name : DriverStrings)
+		{
+			const char* String = (const char*)glGetString(Name);
+			if (String)
+				BaseKey = CombineKey(BaseKey, String, strlen(String));
+		}
+	}
+
+	return BaseKey;
+}
+
+uint64_t SProgramBinaryCache::CombineKey(uint64_t Key, const void* Data, const size_t DataSize)
+{
+	const uint8_t* Bytes = (const uint8_t*)Data;
+	for (size_t i = 0; i < DataSize; i++)
+		Key = (Key ^ Bytes[i]) * FNV_PRIME;
+
+	return Key;
+}
+
+bool SProgramBinaryCache::Load(const uint64_t Key, const GLuint Program)
+{
+	if (!IsSupported())
+		return false;
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	const std::wstring Filename = GetFilename(Key);
+	if (!FileSystem.FileExists(Filename.c_str()))
+		return false;
+
+	auto File = FileSystem.OpenReadable(Filename.c_str());
+	if (!File || File->GetFileSize() < sizeof(CacheHeader))
+		return false;
+
+	CacheHeader Header;
+	if (!File->Read((uint8_t*)&Header, sizeof(CacheHeader)))
+		return false;
+
+	// A hash collision or a partly written file is a miss
+	if (Header.Magic != CACHE_MAGIC || Header.Key != Key || Header.BinarySize != File->GetFileSize() - sizeof(CacheHeader))
+		return false;
+
+	std::vector<uint8_t> Binary(Header.BinarySize);
+	if (!File->Read(Binary.data(), Header.BinarySize))
+		return false;
+
+	// Drivers may reject their own binaries after an update, which fails the link
+	glProgramBinary(Program, Header.Format, Binary.data(), Header.BinarySize);
+
+	GLint IsLinked = GL_FALSE;
+	glGetProgramiv(Program, GL_LINK_STATUS, &IsLinked);
+	return IsLinked == GL_TRUE;
+}
+
+void SProgramBinaryCache::Save(const uint64_t Key, const GLuint Program)
+{
+	if (!IsSupported())
+		return;
+
+	GLint BinarySize = 0;
+	glGetProgramiv(Program, GL_PROGRAM_BINARY_LENGTH, &BinarySize);
+	if (BinarySize <= 0)
+		return;
+
+	std::vector<uint8_t> Data(sizeof(CacheHeader) + BinarySize);
+	CacheHeader Header;
+	Header.Magic = CACHE_MAGIC;
+	Header.Key = Key;
+	Header.Pad0 = 0;
+
+	GLsizei WrittenSize = 0;
+	glGetProgramBinary(Program, BinarySize, &WrittenSize, &Header.Format, Data.data() + sizeof(CacheHeader));
+	if (WrittenSize <= 0)
+		return;
+
+	Header.BinarySize = WrittenSize;
+	memcpy(Data.data(), &Header, sizeof(CacheHeader));
+
+	IFileSystem& FileSystem = IFileSystem::GetInstance();
+	FileSystem.CreateFileDirectory(CACHE_DIRECTORY);
+
+	auto File = FileSystem.OpenWritable(GetFilename(Key).c_str(), false, true);
+	if (File)
+	{
+		File->Write(Data.data(), sizeof(CacheHeader) + WrittenSize);
+		File->Flush();
+	}
+}
+
+bool SProgramBinaryCache::IsSupported()
+{
+	// Queried once, negative until then
+	static GLint FormatCount = -1;
+	if (FormatCount < 0)
+	{
+		FormatCount = 0;
+		if (GLEW_ARB_get_program_binary)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &FormatCount);
+	}
+
+	return FormatCount > 0;
+}
+
+std::wstring SProgramBinaryCache::GetFilename(const uint64_t Key)
+{
+	wchar_t Filename[64];
+	swprintf_s(Filename, L"%s/%016llx.bin", CACHE_DIRECTORY, Key);
+	return std::wstring{ Filename };
+}
@@ -1,6 +1,7 @@
 #include "Rendering\RenderSystem.h"
 #include "ResourceHolder.h"
 #include "Input\ButtonEvent.h"
+#include "Input\MouseAxis.h"
 #include "ChunkSystems\ChunkManager.h"
 #include "Rendering\Camera.h"
 #include "Rendering\Screen.h"
@@ -18,6 +19,11 @@
 #include "Components\MeshRenderer.h"
 #include "ChunkSystems\BlockTypes.h"
 #include "Rendering\GLUtils.h"
+#include "Rendering\GLState.h"
+#include "Math\PerspectiveMatrix.h"
+#include "Debugging\GPUProfiler.h"
+#include "Debugging\CPUProfiler.h"
+#include <algorithm>
 
 // Shader buffer blocks info
 namespace
@@ -52,6 +58,21 @@ namespace
 			Size = 8
 		};
 	}
+
+	namespace GBufferLayoutBlock
+	{
+		enum : uint32_t
+		{
+			IsCompact = 0,
+			Size = 4
+		};
+	}
+
+	// Shader storage binding of the model matrices read by DeferredRender.vert
+	const GLuint MODEL_TRANSFORM_BINDING = 6;
+
+	// Objects the model matrix buffer has room for before growing
+	const uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
 }
 
 TEvent<Vector2ui> FRenderSystem::OnResolutionChange;
@@ -61,20 +82,54 @@ FRenderSystem::FRenderSystem(Atlas::FWorld& World, sf::Window& GameWindow, FChun
 	, mWindow(GameWindow)
 	, mChunkManager(ChunkManager)
 	, mDeferredRender()
+	, mFirstInstanceUniform(mDeferredRender.FindUniform("uFirstInstance"))
 	, mChunkRender()
+	, mChunkDepthPrePass()
+	, mFarTerrainRender()
+	, mRenderTargets()
 	, mGBuffer()
+	, mSceneTarget()
+	, mGBufferBytes(EMemoryTag::Textures)
+	, mHiZBuffer()
+	, mDynamicResolution()
+	, mParticles()
+	, mBlockTextures()
 	, mPostProcesses()
+	, mPostProcessGraph()
+	, mActiveEffects()
 	, mTransformBlock(GLUniformBindings::TransformBlock, TransformBuffer::Size)
 	, mResolutionBlock(GLUniformBindings::ResolutionBlock, ResolutionBlock::Size)
 	, mProjectionInfoBlock(GLUniformBindings::ProjectionInfoBlock, ProjectionInfoBlock::Size)
+	, mGBufferLayoutBlock(GLUniformBindings::GBufferLayoutBlock, GBufferLayoutBlock::Size)
 	, mBlockInfoBuffer(0)
+	, mGBufferLayout(GBufferLayout::Wide)
+	, mIsDepthPrePassEnabled(false)
+	, mIsLightingComposited(true)
+	, mIsShadowTraced(false)
+	, mIsBlockTextureCompressed(false)
+	, mModelTransformBuffer(GL_SHADER_STORAGE_BUFFER, sizeof(FMatrix4) * INITIAL_INSTANCE_CAPACITY)
+	, mMeshInstances()
+	, mMeshBounds()
+	, mMeshVisibility()
+	, mPacket()
+	, mLightSystems()
+	, mLightSystemMask(~0u)
+	, mRenderThread()
+	, mRenderMutex()
+	, mRenderCondition()
+	, mIsFramePending(false)
+	, mIsContextReleased(false)
+	, mMustStop(false)
 {
 	mGBuffer.FBO = 0;
 	mGBuffer.DepthTex = 0;
 	mGBuffer.ColorTex[0] = 0;
+	mSceneTarget.FBO = 0;
+	mSceneTarget.Texture = 0;
 
+	SetGBufferLayout(GBufferLayout::Wide);
 	SetResolution(Vector2ui{ GameWindow.getSize().x, GameWindow.getSize().y });
-	glEnable(GL_CULL_FACE);
+	SGLState::Enable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
 	glClearColor(0, 0, 0, 1.0f);
 
@@ -82,6 +137,9 @@ FRenderSystem::FRenderSystem(Atlas::FWorld& World, sf::Window& GameWindow, FChun
 	LoadSubSystems();
 
 	AddComponentType<Atlas::EComponent::MeshRenderer>();
+
+	// World bounds are cached in the renderers
+	AddWriteType<Atlas::EComponent::MeshRenderer>();
 }
 
 void FRenderSystem::LoadShaders()
@@ -97,19 +155,32 @@ void FRenderSystem::LoadShaders()
 	mDeferredRender.LinkProgram();
 
 	FShader DeferredChunkVert{ L"Shaders/DeferredChunkRender.vert", GL_VERTEX_SHADER };
+	FShader DeferredChunkFrag{ L"Shaders/DeferredChunkRender.frag", GL_FRAGMENT_SHADER };
 	mChunkRender.AttachShader(DeferredChunkVert);
-	mChunkRender.AttachShader(DeferredFrag);
+	mChunkRender.AttachShader(DeferredChunkFrag);
 	mChunkRender.LinkProgram();
+
+	// No fragment shader, only depth is written
+	FShader ChunkDepthVert{ L"Shaders/ChunkDepthPrePass.vert", GL_VERTEX_SHADER };
+	mChunkDepthPrePass.AttachShader(ChunkDepthVert);
+	mChunkDepthPrePass.LinkProgram();
+
+	FShader FarTerrainVert{ L"Shaders/FarTerrain.vert", GL_VERTEX_SHADER };
+	mFarTerrainRender.AttachShader(FarTerrainVert);
+	mFarTerrainRender.AttachShader(DeferredFrag);
+	mFarTerrainRender.LinkProgram();
 }
 
 void FRenderSystem::LoadSubSystems()
 {
-	AddSubSystem<FDirectionalLightSystem>(*this);
-	AddSubSystem<FPointLightSystem>(*this);
+	mLightSystems.push_back(&AddSubSystem<FDirectionalLightSystem>(*this));
+	mLightSystems.push_back(&AddSubSystem<FPointLightSystem>(*this));
 }
 
 FRenderSystem::~FRenderSystem()
 {
+	SetThreaded(false);
+
 	glDeleteBuffers(1, &mBlockInfoBuffer);
 	glDeleteFramebuffers(1, &mGBuffer.FBO);
 	glDeleteTextures(2, mGBuffer.ColorTex);
@@ -127,12 +198,22 @@ void FRenderSystem::Start()
 		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glActiveTexture(GL_TEXTURE0);
+
+	mBlockTextures.Upload(mIsBlockTextureCompressed);
+}
+
+void FRenderSystem::SetCompressedBlockTextures(const bool Flag)
+{
+	mIsBlockTextureCompressed = Flag;
+	if (mBlockTextures.IsUploaded() && mBlockTextures.IsCompressed() != Flag)
+		mBlockTextures.Upload(Flag);
 }
 
 uint32_t FRenderSystem::AddPostProcess(std::unique_ptr<IImageEffect> PostProcess)
 {
 	uint32_t ID = mPostProcesses.size();
 
+	PostProcess->OnAdded(mRenderTargets);
 	mPostProcesses.push_back(PostProcessRecord{ std::move(PostProcess)});
 	return ID;
 }
@@ -149,13 +230,252 @@ void FRenderSystem::DisablePostProcess(const uint32_t ID)
 	mPostProcesses[ID].IsActive = false;
 }
 
+bool FRenderSystem::IsPostProcessEnabled(const uint32_t ID) const
+{
+	ASSERT(ID < mPostProcesses.size());
+	return mPostProcesses[ID].IsActive;
+}
+
+const IImageEffect& FRenderSystem::GetPostProcess(const uint32_t ID) const
+{
+	ASSERT(ID < mPostProcesses.size());
+	return *mPostProcesses[ID].Process;
+}
+
+void FRenderSystem::SetLightSystemEnabled(const uint32_t Index, const bool Flag)
+{
+	ASSERT(Index < mLightSystems.size());
+	if (Flag)
+		mLightSystemMask |= 1u << Index;
+	else
+		mLightSystemMask &= ~(1u << Index);
+}
+
+bool FRenderSystem::IsLightSystemEnabled(const uint32_t Index) const
+{
+	ASSERT(Index < mLightSystems.size());
+	return (mLightSystemMask & (1u << Index)) != 0;
+}
+
+const ILightSystem& FRenderSystem::GetLightSystem(const uint32_t Index) const
+{
+	ASSERT(Index < mLightSystems.size());
+	return *mLightSystems[Index];
+}
+
 void FRenderSystem::SetModelTransform(const FTransform& WorldTransform)
 {
-	mTransformBlock.SetData(TransformBuffer::Model, WorldTransform.LocalToWorldMatrix());
+	mTransformBlock.Stage(TransformBuffer::Model, WorldTransform.LocalToWorldMatrix());
 }
 
 void FRenderSystem::Update()
 {
+	CPU_PROFILE("RenderSystemUpdate");
+
+	// The packet is only refilled once the last frame was submitted from it
+	WaitForRender();
+	ExtractPacket();
+
+	if (!mRenderThread.joinable())
+	{
+		Submit();
+		return;
+	}
+
+	// The render thread takes the context until the frame is submitted
+	mWindow.setActive(false);
+	mIsContextReleased = true;
+
+	{
+		std::lock_guard<std::mutex> Lock(mRenderMutex);
+		mIsFramePending = true;
+	}
+	mRenderCondition.notify_all();
+}
+
+void FRenderSystem::SetThreaded(const bool Flag)
+{
+	if (Flag == mRenderThread.joinable())
+		return;
+
+	if (Flag)
+	{
+		mMustStop = false;
+		mRenderThread = std::thread(&FRenderSystem::RenderThreadLoop, this);
+		return;
+	}
+
+	WaitForRender();
+
+	{
+		std::lock_guard<std::mutex> Lock(mRenderMutex);
+		mMustStop = true;
+	}
+	mRenderCondition.notify_all();
+
+	mRenderThread.join();
+}
+
+void FRenderSystem::WaitForRender()
+{
+	if (!mIsContextReleased)
+		return;
+
+	{
+		std::unique_lock<std::mutex> Lock(mRenderMutex);
+		mRenderCondition.wait(Lock, [this]() { return !mIsFramePending; });
+	}
+
+	mWindow.setActive(true);
+	mIsContextReleased = false;
+}
+
+void FRenderSystem::RenderThreadLoop()
+{
+	std::unique_lock<std::mutex> Lock(mRenderMutex);
+
+	while (true)
+	{
+		mRenderCondition.wait(Lock, [this]() { return mIsFramePending || mMustStop; });
+
+		// Frames are always waited for before stopping
+		if (!mIsFramePending)
+			return;
+
+		Lock.unlock();
+
+		// A context is current on one thread at a time, so it's released for the main thread
+		mWindow.setActive(true);
+		Submit();
+		mWindow.setActive(false);
+
+		Lock.lock();
+		mIsFramePending = false;
+		mRenderCondition.notify_all();
+	}
+}
+
+void FRenderSystem::CullOccluded(const FSphere* Spheres, const uint32_t Count, uint8_t* VisibleInOut) const
+{
+	// The pyramid's readback is only written while building it on the render thread
+	for (uint32_t i = 0; i < Count; i++)
+	{
+		if (VisibleInOut[i] && mHiZBuffer.IsSphereOccluded(Spheres[i]))
+			VisibleInOut[i] = 0;
+	}
+}
+
+void FRenderSystem::ExtractPacket()
+{
+	FRenderView& View = mPacket.View;
+	View.WorldToView = FCamera::Main->Transform.WorldToLocalMatrix();
+	View.ViewToWorld = FCamera::Main->Transform.LocalToWorldMatrix();
+	View.Projection = FCamera::Main->GetProjection();
+	View.WorldFrustum = FCamera::Main->GetWorldViewFrustum();
+	View.ViewFrustum = FCamera::Main->GetViewFrustum();
+	View.Position = FCamera::Main->Transform.GetWorldPosition();
+	View.Rotation = FCamera::Main->Transform.GetRotation();
+	View.LookSpeed = FCamera::Main->LateLookSpeed;
+	View.MouseMovement = View.LookSpeed != 0.0f ? SMouseAxis::GetMovement() : Vector2i{ 0, 0 };
+
+	// Frames are measured a few frames late, the scale reacts to the latest one
+	mDynamicResolution.Update(FDebug::GPUProfiler::GetInstance().GetLastResult());
+	const Vector2ui Resolution = SScreen::GetResolution();
+	const float Scale = mDynamicResolution.GetScale();
+	mPacket.RenderResolution = Vector2ui{ std::max((uint32_t)(Resolution.x * Scale), 1u), std::max((uint32_t)(Resolution.y * Scale), 1u) };
+
+	// Objects and each light type fill separate parts of the packet, disabled light types are left as they are
+	mPacket.LightSystemMask = mLightSystemMask;
+	const FBlockVolume* BlockVolume = mChunkManager.GetBlockVolume();
+	mPacket.HasBlockVolume = BlockVolume && BlockVolume->IsEnabled();
+	mPacket.IsShadowTraced = mIsShadowTraced && mPacket.HasBlockVolume;
+	Atlas::FSystemScheduler& Scheduler = GetWorld().GetSystemManager().GetScheduler();
+	Scheduler.Add(*this, [this]() { ExtractMeshes(); });
+	for (uint32_t i = 0; i < mLightSystems.size(); i++)
+	{
+		ILightSystem* LightSystem = mLightSystems[i];
+		if (mPacket.LightSystemMask & (1u << i))
+			Scheduler.Add(*LightSystem, [this, LightSystem]() { LightSystem->Extract(mPacket); });
+	}
+	Scheduler.Run();
+
+	// The console queues its text and runs commands, which may draw debug shapes
+	FDebug::GameConsole::GetInstance().Render();
+	FDebug::Draw::GetInstance().CloseFrame();
+	mParticles.CloseFrame(STime::GetDeltaTime());
+}
+
+void FRenderSystem::ExtractMeshes()
+{
+	const FRenderView& View = mPacket.View;
+
+	mMeshInstances.clear();
+	mMeshBounds.clear();
+	const auto& GameObjects = GetGameObjects();
+	for (uint32_t i = 0; i < GameObjects.size(); i++)
+	{
+		Atlas::FGameObject* GameObject = GameObjects[i];
+		if (!GameObject->IsActive())
+			continue;
+
+		// Meshes still loading have no buffers or bounds yet
+		auto& Mesh = GetComponentAt<Atlas::EComponent::MeshRenderer>(i);
+		if (!Mesh.Mesh->Mesh.IsActive())
+			continue;
+
+		mMeshInstances.push_back(MeshInstance{ Mesh.Mesh, &GameObject->Transform });
+
+		FSphere Bounds;
+		Mesh.GetWorldBounds(GameObject->Transform, Bounds.Center, Bounds.Radius);
+		mMeshBounds.push_back(Bounds);
+	}
+
+	// Only objects in view and not hidden by the terrain are batched
+	mMeshVisibility.resize(mMeshInstances.size());
+	View.WorldFrustum.CullSphereBatch(mMeshBounds.data(), mMeshBounds.size(), mMeshVisibility.data());
+	CullOccluded(mMeshBounds.data(), mMeshBounds.size(), mMeshVisibility.data());
+
+	uint32_t VisibleCount = 0;
+	for (uint32_t i = 0; i < mMeshInstances.size(); i++)
+	{
+		if (mMeshVisibility[i])
+			mMeshInstances[VisibleCount++] = mMeshInstances[i];
+	}
+	mMeshInstances.resize(VisibleCount);
+
+	// Objects sharing a mesh are drawn with one instanced draw
+	std::sort(mMeshInstances.begin(), mMeshInstances.end(), [](const MeshInstance& Lhs, const MeshInstance& Rhs)
+	{
+		return std::less<FObjectMesh*>()(Lhs.Mesh, Rhs.Mesh);
+	});
+
+	mPacket.Meshes.clear();
+	mPacket.ModelTransforms.clear();
+	for (const auto& Instance : mMeshInstances)
+	{
+		mPacket.Meshes.push_back(Instance.Mesh);
+		mPacket.ModelTransforms.push_back(Instance.Transform->LocalToWorldMatrix());
+	}
+}
+
+void FRenderSystem::Submit()
+{
+	// Setup and resizing since the last frame may have changed state directly
+	SGLState::Invalidate();
+
+	FDebug::GPUProfiler& Profiler = FDebug::GPUProfiler::GetInstance();
+	Profiler.BeginFrame();
+
+	// Traced shadows and occlusion read the blocks around the camera, as do particles
+	if (mPacket.HasBlockVolume)
+		mChunkManager.GetBlockVolume()->Bind();
+
+	// Particles collide with the last frame's depth, so they move before it is cleared or rescaled
+	mParticles.Simulate(mGBuffer.DepthTex, mGBuffer.ColorTex[0]);
+
+	if (mPacket.RenderResolution != SScreen::GetRenderResolution())
+		SetRenderResolution(mPacket.RenderResolution);
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	
 	ConstructGBuffer();
@@ -163,25 +483,68 @@ void FRenderSystem::Update()
 	for (auto& Record : mPostProcesses)
 	{
 		if (Record.IsActive)
+		{
+			FDebug::GPUProfiler::Scope Profile{ Record.Process->GetName() };
 			Record.Process->OnPreLightingPass();
+		}
 	}
 
+	// Composited directional lights are shaded with the effects after lighting, in the same pass where they're compatible
+	FDirectionalLightSystem& DirectionalLights = static_cast<FDirectionalLightSystem&>(*mLightSystems[SubSystems::DirectionalLight]);
+	const bool IsLightingComposited = mIsLightingComposited && (mPacket.LightSystemMask & (1u << SubSystems::DirectionalLight)) && !mPacket.DirectionalLights.empty();
+	DirectionalLights.SetComposited(IsLightingComposited);
+
+	Profiler.BeginPass("Lighting");
 	LightingPass();
+	Profiler.EndPass();
 
+	// Compatible effects are composited in one pass
+	mActiveEffects.clear();
+	if (IsLightingComposited)
+		mActiveEffects.push_back(&DirectionalLights.GetCompositeEffect());
 	for (auto& Record : mPostProcesses)
 	{
 		if (Record.IsActive)
-			Record.Process->OnPostLightingPass();
+			mActiveEffects.push_back(Record.Process.get());
+	}
+
+	Profiler.BeginPass("PostProcess");
+	mPostProcessGraph.RunPostLightingPass(mActiveEffects);
+	Profiler.EndPass();
+
+	// Scaled scenes are filtered up to the screen, overlays stay sharp on top
+	const Vector2ui Resolution = SScreen::GetResolution();
+	const Vector2ui RenderResolution = SScreen::GetRenderResolution();
+	if (RenderResolution != Resolution)
+	{
+		FDebug::GPUProfiler::Scope Profile{ "Upscale" };
+		SGLState::BindFramebuffer(0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, mSceneTarget.FBO);
+		glBlitFramebuffer(0, 0, RenderResolution.x, RenderResolution.y, 0, 0, Resolution.x, Resolution.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glViewport(0, 0, Resolution.x, Resolution.y);
+
+		// Overlays are drawn to the screen, nothing reads the scene after the blit
+		mRenderTargets.Release(mSceneTarget);
+		mSceneTarget.FBO = 0;
+		mSceneTarget.Texture = 0;
 	}
 
 	// Render overlayed facilities
-	glDisable(GL_BLEND);
+	Profiler.BeginPass("Overlay");
+	SGLState::Disable(GL_BLEND);
 	FDebug::Draw::GetInstance().Render();
-	FDebug::GameConsole::GetInstance().Render();
 	FDebug::Text::GetInstance().Render();
+	Profiler.EndPass();
+	Profiler.EndFrame();
+
+	mTransformBlock.EndFrame();
+	mProjectionInfoBlock.EndFrame();
 
 	// Display renderings
 	mWindow.display();
+	mRenderTargets.EndFrame();
+	SGLState::EndFrame();
 }
 
 void FRenderSystem::SetResolution(const Vector2ui& Resolution)
@@ -189,44 +552,147 @@ void FRenderSystem::SetResolution(const Vector2ui& Resolution)
 	SScreen::SetResolution(Resolution);
 	mWindow.setSize(sf::Vector2u{ Resolution.x, Resolution.y });
 	AllocateGBuffer(Resolution);
+	mHiZBuffer.Allocate(Resolution);
 
-	mResolutionBlock.SetData(ResolutionBlock::Resolution, Resolution);
+	// Scaled again from the next frame
+	SetRenderResolution(Resolution);
 	OnResolutionChange.Invoke(Resolution);
+
+	// Frames only take targets of the new size, which are created as they are first taken
+	mRenderTargets.DeleteUnused();
+}
+
+void FRenderSystem::SetRenderResolution(const Vector2ui& Resolution)
+{
+	SScreen::SetRenderResolution(Resolution);
+	mResolutionBlock.SetData(ResolutionBlock::Resolution, Resolution);
+}
+
+void FRenderSystem::SetGBufferLayout(const GBufferLayout Layout)
+{
+	mGBufferLayout = Layout;
+
+	const uint32_t IsCompact = Layout == GBufferLayout::Compact ? 1 : 0;
+	mGBufferLayoutBlock.SetData(GBufferLayoutBlock::IsCompact, (uint8_t*)&IsCompact, sizeof(uint32_t));
+
+	// Nothing to reallocate before the first resolution is set
+	if (mGBuffer.FBO != 0)
+		AllocateGBuffer(SScreen::GetResolution());
 }
 
 void FRenderSystem::RenderGeometry()
 {
+	// The view is read as late as possible, right before it is uploaded
+	LatchView();
 	TransferViewProjectionData();
 
 	// Render geometry
+	mChunkManager.PrepareRender(*this);
+	if (mIsDepthPrePassEnabled)
+	{
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		mChunkDepthPrePass.Use();
+		mChunkManager.Render(*this);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		// Depth is final, each pixel is shaded once by the chunk that wrote it
+		glDepthMask(GL_FALSE);
+		SGLState::DepthFunc(GL_EQUAL);
+	}
+
 	mChunkRender.Use();
 	mChunkManager.Render(*this);
 
+	if (mIsDepthPrePassEnabled)
+	{
+		glDepthMask(GL_TRUE);
+		SGLState::DepthFunc(GL_GEQUAL);
+	}
+
+	// Drawn after the chunks, so the terrain is only shaded where no chunk is in front of it
+	mFarTerrainRender.Use();
+	mChunkManager.RenderFarTerrain();
+
+	mParticles.Render();
+
+	const auto& Meshes = mPacket.Meshes;
+	if (Meshes.empty())
+		return;
+
+	mModelTransformBuffer.Upload(mPacket.ModelTransforms.data(), sizeof(FMatrix4) * mPacket.ModelTransforms.size());
+	mModelTransformBuffer.Bind(MODEL_TRANSFORM_BINDING);
+
 	mDeferredRender.Use();
-	for (auto& GameObject : GetGameObjects())
+	for (uint32_t First = 0; First < Meshes.size();)
 	{
-		auto& Transform = GameObject->Transform;
-		auto& Mesh = GameObject->GetComponent<Atlas::EComponent::MeshRenderer>();
+		FObjectMesh* Mesh = Meshes[First];
+
+		uint32_t End = First + 1;
+		while (End < Meshes.size() && Meshes[End] == Mesh)
+			End++;
 
-		SetModelTransform(Transform);
-		Mesh.Mesh->Mesh.Render();
+		mDeferredRender.SetUniform(mFirstInstanceUniform, First, std::true_type{});
+		Mesh->Mesh.RenderInstanced(End - First);
+		First = End;
 	}
+
+	mModelTransformBuffer.EndFrame();
 }
 
-void FRenderSystem::TransferViewProjectionData()
+void FRenderSystem::LatchView()
 {
-	// Send view data
-	mTransformBlock.SetData(TransformBuffer::View, FCamera::Main->Transform.WorldToLocalMatrix());
-
-	// Send projection data
-	FMatrix4 Projection = FCamera::Main->GetProjection();
-	mTransformBlock.SetData(TransformBuffer::Projection, Projection);
-	mTransformBlock.SetData(TransformBuffer::InvProjection, Projection.GetInverse());
+	FRenderView& View = mPacket.View;
+	if (View.LookSpeed == 0.0f)
+		return;
+
+	const Vector2i Movement = SMouseAxis::GetMovement() - View.MouseMovement;
+	if (Movement.x == 0 && Movement.y == 0)
+		return;
+
+	// Pitch about the flattened right axis then yaw, as CFlyingCamera turns
+	Vector3f Forward = View.Rotation * Vector3f::Forward;
+	Forward.y = 0.0f;
+	Forward.Normalize();
+	const Vector3f Right = Vector3f::Cross(Forward, Vector3f::Up);
+
+	const FQuaternion Turn = FQuaternion{ Vector3f::Up, -(float)Movement.x * View.LookSpeed } * FQuaternion{ Right, (float)Movement.y * View.LookSpeed };
+	const FQuaternion Rotation = Turn * View.Rotation;
+	if (abs(Vector3f::Dot(Rotation * Vector3f::Forward, Vector3f::Up)) >= 0.9f)
+		return;
+
+	// The turn about the camera in its own space, so the matrices needn't be rebuilt
+	const FQuaternion LocalTurn = View.Rotation.Inverse() * Turn * View.Rotation;
+	const FMatrix4 ViewTurn = LocalTurn.ToMatrix4();
+	const FMatrix4 InverseViewTurn = LocalTurn.Inverse().ToMatrix4();
+
+	View.WorldToView = InverseViewTurn * View.WorldToView;
+	View.ViewToWorld = View.ViewToWorld * ViewTurn;
+	View.Rotation = Rotation;
+	View.MouseMovement += Movement;
+
+	// Point lights were moved to view space when extracted
+	for (FRenderPacket::PointLight& Light : mPacket.PointLights)
+		Light.Position = InverseViewTurn.TransformPosition(Light.Position);
+}
 
-	const float Near = Projection.M[3][2] / (Projection.M[2][2] - 1.0);
-	const float Far = Projection.M[3][2] / (Projection.M[2][2] + 1.0);
-	mProjectionInfoBlock.SetData(ProjectionInfoBlock::Near, Near);
-	mProjectionInfoBlock.SetData(ProjectionInfoBlock::Far, Far);
+void FRenderSystem::TransferViewProjectionData()
+{
+	// Stage view data
+	mTransformBlock.Stage(TransformBuffer::View, mPacket.View.WorldToView);
+
+	// Stage projection data
+	const FMatrix4& Projection = mPacket.View.Projection;
+	mTransformBlock.Stage(TransformBuffer::Projection, Projection);
+	mTransformBlock.Stage(TransformBuffer::InvProjection, Projection.GetInverse());
+
+	const float Near = FPerspectiveMatrix::GetNear(Projection);
+	const float Far = FPerspectiveMatrix::GetFar(Projection);
+	mProjectionInfoBlock.Stage(ProjectionInfoBlock::Near, Near);
+	mProjectionInfoBlock.Stage(ProjectionInfoBlock::Far, Far);
+
+	// Each block is written with one copy
+	mTransformBlock.Commit();
+	mProjectionInfoBlock.Commit();
 }
 
 void FRenderSystem::AllocateGBuffer(const Vector2ui& Resolution)
@@ -242,7 +708,7 @@ void FRenderSystem::AllocateGBuffer(const Vector2ui& Resolution)
 	// Create targets with input parameters
 	glGenTextures(1, mGBuffer.ColorTex);
 	glBindTexture(GL_TEXTURE_2D, mGBuffer.ColorTex[0]);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32UI, Resolution.x, Resolution.y);
+	glTexStorage2D(GL_TEXTURE_2D, 1, mGBufferLayout == GBufferLayout::Compact ? GL_RG32UI : GL_RGBA32UI, Resolution.x, Resolution.y);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glActiveTexture(GL_TEXTURE0 + GLTextureBindings::GBuffer0);
@@ -261,61 +727,84 @@ void FRenderSystem::AllocateGBuffer(const Vector2ui& Resolution)
 	glActiveTexture(GL_TEXTURE0);
 
 	glGenFramebuffers(1, &mGBuffer.FBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, mGBuffer.FBO);
+	SGLState::BindFramebuffer(mGBuffer.FBO);
 
 	// Set attachments
 	GL_CHECK(glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mGBuffer.ColorTex[0], 0));
 	GL_CHECK(glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mGBuffer.DepthTex, 0));
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	SGLState::BindFramebuffer(0);
+
+	const uint64_t ColorBytes = mGBufferLayout == GBufferLayout::Compact ? 8 : 16;
+	mGBufferBytes.Set((uint64_t)Resolution.x * Resolution.y * (ColorBytes + sizeof(float)));
 }
 
 void FRenderSystem::ConstructGBuffer()
 {
 	// Open G-Buffer for writing and enable deferred render shader.
-	const Vector2ui Resolution = SScreen::GetResolution();
-	glBindFramebuffer(GL_FRAMEBUFFER, mGBuffer.FBO);
+	const Vector2ui Resolution = SScreen::GetRenderResolution();
+	SGLState::BindFramebuffer(mGBuffer.FBO);
 	glViewport(0, 0, Resolution.x, Resolution.y);
 	
 	static const GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0 };
 	static const GLuint UZeros[] = { 0, 0, 0, 0 };
-	static const GLfloat FOnes[] = { 1, 1, 1, 1 };
+	static const GLfloat FZeros[] = { 0, 0, 0, 0 };
 
+	// Reversed depth, cleared to the far plane at 0
 	glDrawBuffers(1, DrawBuffers);
 	glClearBufferuiv(GL_COLOR, 0, UZeros);
-	glClearBufferfv(GL_DEPTH, 0, FOnes);
+	glClearBufferfv(GL_DEPTH, 0, FZeros);
 
 	// Make sure depth testing is enabled
-	glDisable(GL_BLEND);
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LEQUAL);
+	SGLState::ClipDepthMode(GL_ZERO_TO_ONE);
+	SGLState::Disable(GL_BLEND);
+	SGLState::Enable(GL_DEPTH_TEST);
+	SGLState::DepthFunc(GL_GEQUAL);
 	
+	FDebug::GPUProfiler& Profiler = FDebug::GPUProfiler::GetInstance();
+	Profiler.BeginPass("GBuffer");
 	RenderGeometry();
+	Profiler.EndPass();
 
-	// Close the G-Buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// Close the G-Buffer, scaled scenes are lit in their own target to be scaled up after
+	if (Resolution != SScreen::GetResolution())
+	{
+		// Same format as the back buffer at its full size, so scaling up is a plain filtered blit
+		// and the target is shared by every render resolution
+		mSceneTarget = mRenderTargets.Acquire(FRenderTargetPool::Description{ SScreen::GetResolution(), GL_RGBA8, GL_LINEAR });
+		SGLState::BindFramebuffer(mSceneTarget.FBO);
+		glClearBufferfv(GL_COLOR, 0, FZeros);
+	}
+	else
+	{
+		SGLState::BindFramebuffer(0);
+		glDrawBuffer(GL_BACK);
+	}
 	glViewport(0, 0, Resolution.x, Resolution.y);
-	glDrawBuffer(GL_BACK);
 
-	// Set GBuffers for reading
-	glActiveTexture(GL_TEXTURE0 + GLTextureBindings::GBuffer0);
-	glBindTexture(GL_TEXTURE_2D, mGBuffer.ColorTex[0]);
+	// Depth pyramid for next frame's occlusion culling
+	FDebug::GPUProfiler::Scope Profile{ "HiZ" };
+	mHiZBuffer.Build(mGBuffer.DepthTex, Resolution, mPacket.View.Projection * mPacket.View.WorldToView);
 
-	glActiveTexture(GL_TEXTURE0 + GLTextureBindings::Depth);
-	glBindTexture(GL_TEXTURE_2D, mGBuffer.DepthTex);
+	// Set GBuffers for reading
+	SGLState::BindTexture(GLTextureBindings::GBuffer0, GL_TEXTURE_2D, mGBuffer.ColorTex[0]);
+	SGLState::BindTexture(GLTextureBindings::Depth, GL_TEXTURE_2D, mGBuffer.DepthTex);
 }
 
 void FRenderSystem::LightingPass()
 {
 	// No depth testing for lighting and post-processes
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE);
-	glBlendEquation(GL_FUNC_ADD);
-
-	auto& SubSystems = GetSubSystems();
-	for (auto& SubSystem : SubSystems)
-		SubSystem->Update();
+	SGLState::Disable(GL_DEPTH_TEST);
+	SGLState::Enable(GL_BLEND);
+	SGLState::BlendFunc(GL_ONE, GL_ONE);
+	SGLState::BlendEquation(GL_FUNC_ADD);
+
+	// The packet's mask is read, the renderer's may change while the frame is submitted
+	for (uint32_t i = 0; i < mLightSystems.size(); i++)
+	{
+		if (mPacket.LightSystemMask & (1u << i))
+			mLightSystems[i]->Update();
+	}
 }
 
 //FBox FRenderSystem::GetViewBounds() const
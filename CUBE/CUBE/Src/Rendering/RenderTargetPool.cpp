@@ -0,0 +1,171 @@
+#include "Rendering\RenderTargetPool.h"
+#include "Rendering\GLBindings.h"
+#include "Rendering\GLState.h"
+#include "Rendering\GLUtils.h"
+#include "Misc\Assertions.h"
+
+namespace
+{
+	// Bytes of a texel of the formats targets are taken with
+	uint64_t TexelBytes(const GLenum Format)
+	{
+		switch (Format)
+		{
+		case GL_R8:
+			return 1;
+		case GL_R16F:
+			return 2;
+		case GL_RGBA8:
+		case GL_R32F:
+		case GL_RG16F:
+			return 4;
+		case GL_RG32F:
+		case GL_RGBA16F:
+		case GL_RG32UI:
+			return 8;
+		case GL_RGBA32F:
+		case GL_RGBA32UI:
+			return 16;
+		default:
+			ASSERT(!"Unknown render target format.");
+			return 4;
+		}
+	}
+
+	uint64_t TargetBytes(const FRenderTargetPool::Description& Desc)
+	{
+		return (uint64_t)Desc.Size.x * Desc.Size.y * TexelBytes(Desc.Format);
+	}
+}
+
+FRenderTargetPool::FRenderTargetPool()
+	: mEntries()
+	, mFrame(0)
+	, mByteCount(0)
+	, mBytes(EMemoryTag::Textures)
+{
+}
+
+FRenderTargetPool::~FRenderTargetPool()
+{
+	while (!mEntries.empty())
+		DeleteEntry(mEntries.size() - 1);
+}
+
+FRenderTargetPool::Target FRenderTargetPool::Acquire(const Description& Desc)
+{
+	ASSERT(Desc.Size.x > 0 && Desc.Size.y > 0);
+
+	for (Entry& Free : mEntries)
+	{
+		if (!Free.IsTaken && Free.Desc == Desc)
+		{
+			Free.IsTaken = true;
+			Free.LastFrame = mFrame;
+			return Free.Handle;
+		}
+	}
+
+	Entry Created;
+	Created.Desc = Desc;
+	Created.LastFrame = mFrame;
+	Created.IsTaken = true;
+	Created.IsFrameHeld = false;
+
+	// Created on a unit of its own, so the state cache of the units passes read from stays valid
+	GL_CHECK(glGenTextures(1, &Created.Handle.Texture));
+	SGLState::BindTexture(GLTextureBindings::RenderTargetPool, GL_TEXTURE_2D, Created.Handle.Texture);
+		GL_CHECK(glTexStorage2D(GL_TEXTURE_2D, 1, Desc.Format, Desc.Size.x, Desc.Size.y));
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, Desc.Filter));
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, Desc.Filter));
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	SGLState::BindTexture(GLTextureBindings::RenderTargetPool, GL_TEXTURE_2D, 0);
+
+	// The framebuffer bound by the pass taking the target is kept
+	const GLuint BoundFramebuffer = SGLState::GetFramebuffer();
+	GL_CHECK(glGenFramebuffers(1, &Created.Handle.FBO));
+	SGLState::BindFramebuffer(Created.Handle.FBO);
+		GL_CHECK(glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, Created.Handle.Texture, 0));
+		GL_CHECK(glDrawBuffer(GL_COLOR_ATTACHMENT0));
+	SGLState::BindFramebuffer(BoundFramebuffer);
+
+	mEntries.push_back(Created);
+	mByteCount += TargetBytes(Desc);
+	mBytes.Set(mByteCount);
+	return Created.Handle;
+}
+
+void FRenderTargetPool::Release(const Target& Taken)
+{
+	Entry& Released = FindEntry(Taken);
+	ASSERT(Released.IsTaken && !Released.IsFrameHeld);
+	Released.IsTaken = false;
+}
+
+void FRenderTargetPool::ReleaseAtFrameEnd(const Target& Taken)
+{
+	Entry& Released = FindEntry(Taken);
+	ASSERT(Released.IsTaken && !Released.IsFrameHeld);
+	Released.IsFrameHeld = true;
+}
+
+void FRenderTargetPool::EndFrame()
+{
+	for (uint32_t i = 0; i < mEntries.size();)
+	{
+		Entry& Next = mEntries[i];
+		if (Next.IsFrameHeld)
+		{
+			Next.IsFrameHeld = false;
+			Next.IsTaken = false;
+		}
+
+		if (!Next.IsTaken && mFrame - Next.LastFrame >= MAX_UNUSED_FRAMES)
+			DeleteEntry(i);
+		else
+			i++;
+	}
+
+	mFrame++;
+}
+
+void FRenderTargetPool::DeleteUnused()
+{
+	for (uint32_t i = 0; i < mEntries.size();)
+	{
+		if (!mEntries[i].IsTaken)
+			DeleteEntry(i);
+		else
+			i++;
+	}
+}
+
+FRenderTargetPool::Entry& FRenderTargetPool::FindEntry(const Target& Taken)
+{
+	for (Entry& Next : mEntries)
+	{
+		if (Next.Handle.FBO == Taken.FBO)
+			return Next;
+	}
+
+	ASSERT(!"Target wasn't taken from this pool.");
+	return mEntries.front();
+}
+
+void FRenderTargetPool::DeleteEntry(const uint32_t Index)
+{
+	Entry& Deleted = mEntries[Index];
+
+	// Order doesn't matter, targets are found by description
+	if (SGLState::GetFramebuffer() == Deleted.Handle.FBO)
+		SGLState::BindFramebuffer(0);
+	glDeleteFramebuffers(1, &Deleted.Handle.FBO);
+	glDeleteTextures(1, &Deleted.Handle.Texture);
+
+	mByteCount -= TargetBytes(Deleted.Desc);
+	mBytes.Set(mByteCount);
+
+	Deleted = mEntries.back();
+	mEntries.pop_back();
+}
@@ -1,17 +1,28 @@
 #include "..\..\Include\Rendering\Screen.h"
 
 TVector2<uint32_t> SScreen::ScreenResolution;
+TVector2<uint32_t> SScreen::RenderResolution;
 
 void SScreen::SetResolution(const TVector2<uint32_t> Resolution)
 {
 	ScreenResolution = Resolution;
 }
 
+void SScreen::SetRenderResolution(const TVector2<uint32_t> Resolution)
+{
+	RenderResolution = Resolution;
+}
+
 TVector2<uint32_t> SScreen::GetResolution()
 {
 	return ScreenResolution;
 }
 
+TVector2<uint32_t> SScreen::GetRenderResolution()
+{
+	return RenderResolution;
+}
+
 float SScreen::GetAspectRatio()
 {
 	return (float)ScreenResolution.x / (float)ScreenResolution.y;
@@ -1,40 +1,89 @@
 #include "Rendering\ShaderProgram.h"
 #include "SystemResources\SystemFile.h"
 #include "Debugging\ConsoleOutput.h"
+#include "Rendering\ProgramBinaryCache.h"
+#include "ChunkSystems\ChunkSize.h"
 
 #include <GL\glew.h>
 #include <GL\GL.h>
 #include "SFML\Window\Context.hpp"
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
+namespace
+{
+	// From GL_KHR_parallel_shader_compile, which this GLEW predates
+	const GLenum COMPLETION_STATUS = 0x91B1;
+	typedef void (GLAPIENTRY *MaxShaderCompilerThreadsProc)(GLuint Count);
+
+	bool HasExtension(const char* Name)
+	{
+		GLint ExtensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &ExtensionCount);
+		for (GLint i = 0; i < ExtensionCount; i++)
+		{
+			if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), Name) == 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	/**
+	* Checked once, letting the driver compile on as many threads as it likes.
+	*/
+	bool IsParallelCompileSupported()
+	{
+		static int8_t IsSupported = -1;
+		if (IsSupported < 0)
+		{
+			IsSupported = HasExtension("GL_KHR_parallel_shader_compile") || HasExtension("GL_ARB_parallel_shader_compile") ? 1 : 0;
+
+#ifdef _WIN32
+			MaxShaderCompilerThreadsProc MaxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)wglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+			if (!MaxShaderCompilerThreads)
+				MaxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)wglGetProcAddress("glMaxShaderCompilerThreadsARB");
+			if (IsSupported && MaxShaderCompilerThreads)
+				MaxShaderCompilerThreads(0xFFFFFFFF);
+#endif
+		}
+
+		return IsSupported == 1;
+	}
+}
+
 /////////////////////////
 //// FShader ////////////
 
 FShader::FShader(const wchar_t* SourceFile, GLenum ShaderType)
-	: mID()
+	: mID(0)
 	, mType(ShaderType)
+	, mSource(ReadShader(SourceFile))
 {
-	mID = glCreateShader(ShaderType);
-
-	const std::string ShaderSource = ReadShader(SourceFile);
-	const char* SourcePtr = ShaderSource.c_str();
-	glShaderSource(mID, 1, &SourcePtr, nullptr);
-
-	glCompileShader(mID);
+	AddBuildDefines(mSource);
+}
 
-#ifndef NDEBUG
-	CheckShaderErrors(mID);
-#endif
+FShader::FShader(const std::string& Source, GLenum ShaderType)
+	: mID(0)
+	, mType(ShaderType)
+	, mSource(Source)
+{
+	ResolveIncludes(mSource);
+	AddBuildDefines(mSource);
 }
 
 FShader::~FShader()
 {
-	glDeleteShader(mID);
+	if (mID != 0)
+		glDeleteShader(mID);
 }
 
 GLuint FShader::GetID() const
 {
+	if (mID == 0)
+		Compile();
+
 	return mID;
 }
 
@@ -56,33 +105,62 @@ std::string FShader::ReadShader(const wchar_t* SourceFile) const
 		ShaderSource.resize(ShaderSize);
 		ShaderFile->Read((uint8_t*)ShaderSource.data(), ShaderSize);
 
-		// Parse #includes and add source data
-		size_t StringHead = 0;
-		size_t FirstChar = ShaderSource.find("#include", StringHead);
-		while (FirstChar != std::string::npos)
-		{
-			// Get the file to include, then delete that line
-			std::size_t FileStart = ShaderSource.find('"', FirstChar);
-			std::size_t FileEnd = ShaderSource.find('"', FileStart + 1);
-			std::string IncludeFile = ShaderSource.substr(FileStart + 1, FileEnd - FileStart - 1);
-			ShaderSource.erase(ShaderSource.begin() + FirstChar, ShaderSource.begin() + FileEnd + 1);
-
-			// Read the included shader and insert it in the #include position
-			std::wstring WIncludeFile{ IncludeFile.begin(), IncludeFile.end() };
-			WIncludeFile.insert(0, L"Shaders/");
-			std::string IncludeSource = ReadShader(WIncludeFile.data());
-			ShaderSource.insert(FirstChar, IncludeSource, 0, std::string::npos);
-
-			// Update string head to past the included file
-			StringHead += FirstChar + IncludeSource.length();
-			FirstChar = ShaderSource.find("#include", StringHead);
-		}
+		ResolveIncludes(ShaderSource);
 		return ShaderSource;
 	}
 
 	return std::string();
 }
 
+void FShader::ResolveIncludes(std::string& ShaderSource) const
+{
+	size_t FirstChar = ShaderSource.find("#include");
+	while (FirstChar != std::string::npos)
+	{
+		// Get the file to include, then delete that line
+		std::size_t FileStart = ShaderSource.find('"', FirstChar);
+		std::size_t FileEnd = ShaderSource.find('"', FileStart + 1);
+		std::string IncludeFile = ShaderSource.substr(FileStart + 1, FileEnd - FileStart - 1);
+		ShaderSource.erase(ShaderSource.begin() + FirstChar, ShaderSource.begin() + FileEnd + 1);
+
+		// Read the included shader and insert it in the #include position
+		std::wstring WIncludeFile{ IncludeFile.begin(), IncludeFile.end() };
+		WIncludeFile.insert(0, L"Shaders/");
+		std::string IncludeSource = ReadShader(WIncludeFile.data());
+		ShaderSource.insert(FirstChar, IncludeSource, 0, std::string::npos);
+
+		// Continue past the included file, its own includes are already resolved
+		FirstChar = ShaderSource.find("#include", FirstChar + IncludeSource.length());
+	}
+}
+
+void FShader::AddBuildDefines(std::string& ShaderSource) const
+{
+	const std::string Defines = "#define CHUNK_SIZE_BITS " + std::to_string(CHUNK_SIZE_BITS) + "\n";
+
+	// Nothing but comments may come before #version, so the defines follow its line
+	const std::size_t Version = ShaderSource.find("#version");
+	const std::size_t VersionEnd = (Version != std::string::npos) ? ShaderSource.find('\n', Version) : std::string::npos;
+	if (VersionEnd != std::string::npos)
+		ShaderSource.insert(VersionEnd + 1, Defines);
+	else
+		ShaderSource.insert(0, Defines);
+}
+
+void FShader::Compile() const
+{
+	mID = glCreateShader(mType);
+
+	const char* SourcePtr = mSource.c_str();
+	glShaderSource(mID, 1, &SourcePtr, nullptr);
+
+	glCompileShader(mID);
+
+#ifndef NDEBUG
+	CheckShaderErrors(mID);
+#endif
+}
+
 
 #ifndef NDEBUG
 void FShader::CheckShaderErrors(GLuint Shader) const
@@ -111,12 +189,23 @@ void FShader::CheckShaderErrors(GLuint Shader) const
 FShaderProgram::FShaderProgram()
 	:mID(glCreateProgram())
 	, mUniforms()
+	, mHandles()
+	, mHandleNames()
+	, mShaders()
+	, mLinkKey(0)
+	, mIsLinkPending(false)
 {
 
 }
 
 FShaderProgram::FShaderProgram(const std::initializer_list<const FShader*> Shaders)
 	: mID(glCreateProgram())
+	, mUniforms()
+	, mHandles()
+	, mHandleNames()
+	, mShaders()
+	, mLinkKey(0)
+	, mIsLinkPending(false)
 {
 	for (auto Itr = Shaders.begin(); Itr != Shaders.end(); Itr++)
 	{
@@ -133,13 +222,56 @@ FShaderProgram::~FShaderProgram()
 
 void FShaderProgram::AttachShader(const FShader& Shader)
 {
-	glAttachShader(mID, Shader.GetID());
+	mShaders.push_back(&Shader);
 }
 
 void FShaderProgram::LinkProgram()
 {
+	// Key of the sources of every stage, in the order they were attached
+	uint64_t Key = SProgramBinaryCache::GetBaseKey();
+	for (const FShader* Shader : mShaders)
+	{
+		const GLenum Type = Shader->GetType();
+		Key = SProgramBinaryCache::CombineKey(Key, &Type, sizeof(GLenum));
+		Key = SProgramBinaryCache::CombineKey(Key, Shader->GetSource().data(), Shader->GetSource().size());
+	}
+
+	if (SProgramBinaryCache::Load(Key, mID))
+	{
+		mShaders.clear();
+		ResolveUniforms();
+		return;
+	}
+
+	// Set up before compiling, so the shaders compile in parallel too
+	IsParallelCompileSupported();
+
+	for (const FShader* Shader : mShaders)
+		glAttachShader(mID, Shader->GetID());
+	mShaders.clear();
+
+	glProgramParameteri(mID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(mID);
 
+	// Anything asking for the result waits on the link, so that's left for first use
+	mLinkKey = Key;
+	mIsLinkPending = true;
+}
+
+bool FShaderProgram::IsLinkComplete() const
+{
+	if (!mIsLinkPending || !IsParallelCompileSupported())
+		return true;
+
+	GLint IsComplete = GL_FALSE;
+	glGetProgramiv(mID, COMPLETION_STATUS, &IsComplete);
+	return IsComplete == GL_TRUE;
+}
+
+void FShaderProgram::FinishLink()
+{
+	mIsLinkPending = false;
+
 	// Detach all attached shaders
 	GLsizei ShaderCount;
 	glGetProgramiv(mID, GL_ATTACHED_SHADERS, &ShaderCount);
@@ -155,6 +287,59 @@ void FShaderProgram::LinkProgram()
 #ifndef NDEBUG
 	CheckProgramErrors();
 #endif
+
+	GLint IsLinked = GL_FALSE;
+	glGetProgramiv(mID, GL_LINK_STATUS, &IsLinked);
+	if (IsLinked == GL_TRUE)
+	{
+		SProgramBinaryCache::Save(mLinkKey, mID);
+		ResolveUniforms();
+	}
+}
+
+void FShaderProgram::ResolveUniforms()
+{
+	// Name lookups of active uniforms never reach GL after this
+	mUniforms.clear();
+
+	GLint UniformCount = 0;
+	GLint MaxNameLength = 0;
+	glGetProgramiv(mID, GL_ACTIVE_UNIFORMS, &UniformCount);
+	glGetProgramiv(mID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &MaxNameLength);
+
+	std::vector<GLchar> Name(MaxNameLength + 1);
+	for (GLint i = 0; i < UniformCount; i++)
+	{
+		GLsizei Length = 0;
+		GLint Size = 0;
+		GLenum Type = 0;
+		glGetActiveUniform(mID, i, Name.size(), &Length, &Size, &Type, Name.data());
+
+		// Arrays are also found by the name without their first index
+		std::string UniformName(Name.data(), Length);
+		mUniforms[UniformName].Bind(mID, UniformName.c_str());
+		if (UniformName.size() > 3 && UniformName.compare(UniformName.size() - 3, 3, "[0]") == 0)
+			mUniforms[UniformName.substr(0, UniformName.size() - 3)] = mUniforms[UniformName];
+	}
+
+	for (uint32_t i = 0; i < mHandles.size(); i++)
+		mHandles[i].Bind(mID, mHandleNames[i].c_str());
+}
+
+FShaderProgram::UniformHandle FShaderProgram::FindUniform(const char* Name)
+{
+	mHandleNames.push_back(Name);
+	mHandles.push_back(FUniform{});
+
+	// Handles found after the link was finished are resolved now
+	GLint IsLinked = GL_FALSE;
+	if (!mIsLinkPending)
+		glGetProgramiv(mID, GL_LINK_STATUS, &IsLinked);
+
+	if (IsLinked == GL_TRUE)
+		mHandles.back().Bind(mID, Name);
+
+	return mHandles.size() - 1;
 }
 
 #ifndef NDEBUG
@@ -0,0 +1,28 @@
+#include "Rendering\StagedUniformBlock.h"
+#include "Misc\Assertions.h"
+
+FStagedUniformBlock::FStagedUniformBlock(const GLuint BindingIndex, const uint32_t BlockSize)
+	: mBuffer(GL_UNIFORM_BUFFER, BlockSize)
+	, mStaging(BlockSize, 0)
+	, mBindingIndex(BindingIndex)
+	, mIsDirty(false)
+{
+}
+
+void FStagedUniformBlock::Stage(const uint32_t DataOffset, const void* Data, const uint32_t DataSize)
+{
+	ASSERT(DataOffset + DataSize <= mStaging.size() && "Staged data is outside of the uniform block.");
+
+	memcpy(mStaging.data() + DataOffset, Data, DataSize);
+	mIsDirty = true;
+}
+
+void FStagedUniformBlock::Commit()
+{
+	if (!mIsDirty)
+		return;
+
+	mBuffer.Upload(mStaging.data(), mStaging.size());
+	mBuffer.Bind(mBindingIndex);
+	mIsDirty = false;
+}
@@ -0,0 +1,120 @@
+#include "Rendering\StreamingBuffer.h"
+#include "Misc\Assertions.h"
+
+#include <cstring>
+
+namespace
+{
+	const GLbitfield STREAMING_MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	// Nanoseconds waited on a fence between flushes
+	const GLuint64 FENCE_TIMEOUT = 1000000;
+
+	// Alignment of each frame's region of vertex data
+	const GLint VERTEX_OFFSET_ALIGNMENT = 16;
+}
+
+FStreamingBuffer::FStreamingBuffer(const GLenum Target, const GLsizeiptr FrameCapacity)
+	: mMappedData(nullptr)
+	, mBuffer(0)
+	, mTarget(Target)
+	, mFrameCapacity(0)
+	, mFrameStride(0)
+	, mUploadedBytes(0)
+	, mFrame(0)
+{
+	ASSERT(FrameCapacity > 0);
+	ASSERT((Target == GL_SHADER_STORAGE_BUFFER || Target == GL_UNIFORM_BUFFER || Target == GL_ARRAY_BUFFER) && "Unsupported streaming buffer target.");
+
+	for (uint32_t i = 0; i < FRAME_COUNT; i++)
+		mFences[i] = nullptr;
+
+	Allocate(FrameCapacity);
+}
+
+FStreamingBuffer::~FStreamingBuffer()
+{
+	for (uint32_t i = 0; i < FRAME_COUNT; i++)
+	{
+		if (mFences[i])
+			glDeleteSync(mFences[i]);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &mBuffer);
+}
+
+void FStreamingBuffer::Upload(const void* Data, const GLsizeiptr DataSize)
+{
+	ASSERT(mUploadedBytes == 0 && "Only one upload may be made each frame.");
+
+	if (DataSize > mFrameCapacity)
+	{
+		// Every region may still be read, so the old buffer is only deleted once the GPU is done with it
+		for (uint32_t i = 0; i < FRAME_COUNT; i++)
+			WaitForFence(mFences[i]);
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &mBuffer);
+
+		Allocate(DataSize > mFrameCapacity * 2 ? DataSize : mFrameCapacity * 2);
+	}
+
+	WaitForFence(mFences[mFrame]);
+
+	memcpy(mMappedData + mFrame * mFrameStride, Data, DataSize);
+	mUploadedBytes = DataSize;
+}
+
+void FStreamingBuffer::Bind(const GLuint BindingIndex) const
+{
+	ASSERT(mUploadedBytes > 0 && "Nothing was uploaded this frame.");
+	ASSERT(mTarget != GL_ARRAY_BUFFER && "Vertex data is bound with GetBuffer and GetFrameOffset.");
+	glBindBufferRange(mTarget, BindingIndex, mBuffer, mFrame * mFrameStride, mUploadedBytes);
+}
+
+void FStreamingBuffer::EndFrame()
+{
+	if (mUploadedBytes == 0)
+		return;
+
+	mFences[mFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	mFrame = (mFrame + 1) % FRAME_COUNT;
+	mUploadedBytes = 0;
+}
+
+void FStreamingBuffer::Allocate(const GLsizeiptr FrameCapacity)
+{
+	GLint Alignment = VERTEX_OFFSET_ALIGNMENT;
+	if (mTarget != GL_ARRAY_BUFFER)
+		glGetIntegerv(mTarget == GL_SHADER_STORAGE_BUFFER ? GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT : GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &Alignment);
+
+	mFrameCapacity = FrameCapacity;
+	mFrameStride = (FrameCapacity + Alignment - 1) / Alignment * Alignment;
+
+	glGenBuffers(1, &mBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, mFrameStride * FRAME_COUNT, nullptr, STREAMING_MAP_FLAGS);
+	mMappedData = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, mFrameStride * FRAME_COUNT, STREAMING_MAP_FLAGS);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	ASSERT(mMappedData && "Failed to map the streaming buffer.");
+}
+
+void FStreamingBuffer::WaitForFence(GLsync& Fence)
+{
+	if (!Fence)
+		return;
+
+	GLenum Status = glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+	while (Status == GL_TIMEOUT_EXPIRED)
+		Status = glClientWaitSync(Fence, 0, FENCE_TIMEOUT);
+
+	glDeleteSync(Fence);
+	Fence = nullptr;
+}
@@ -0,0 +1,106 @@
+#include "Rendering\UploadRing.h"
+#include "Misc\Assertions.h"
+
+#include <cstring>
+
+namespace
+{
+	const GLbitfield RING_MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+FUploadRing::FUploadRing(const GLsizeiptr Capacity)
+	: mFences()
+	, mMappedData(nullptr)
+	, mBuffer(0)
+	, mCapacity(Capacity)
+	, mHead(0)
+	, mUsedBytes(0)
+	, mUnfencedBytes(0)
+{
+	ASSERT(Capacity > 0);
+
+	glGenBuffers(1, &mBuffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, mBuffer);
+	glBufferStorage(GL_COPY_READ_BUFFER, mCapacity, nullptr, RING_MAP_FLAGS);
+	mMappedData = (uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, mCapacity, RING_MAP_FLAGS);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	ASSERT(mMappedData && "Failed to map the upload ring.");
+}
+
+FUploadRing::~FUploadRing()
+{
+	for (auto& Fence : mFences)
+		glDeleteSync(Fence.Sync);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, mBuffer);
+	glUnmapBuffer(GL_COPY_READ_BUFFER);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	glDeleteBuffers(1, &mBuffer);
+}
+
+bool FUploadRing::Stage(const void* Data, const GLsizeiptr DataSize, GLintptr& OffsetOut)
+{
+	if (DataSize > mCapacity)
+		return false;
+
+	// Data is never split, so skip the end of the ring if it doesn't fit
+	GLintptr Offset = mHead;
+	GLsizeiptr WrapBytes = 0;
+	if (Offset + DataSize > mCapacity)
+	{
+		WrapBytes = mCapacity - Offset;
+		Offset = 0;
+	}
+
+	if (mUsedBytes + WrapBytes + DataSize > mCapacity)
+	{
+		ReclaimSpace();
+		if (mUsedBytes + WrapBytes + DataSize > mCapacity)
+			return false;
+	}
+
+	memcpy(mMappedData + Offset, Data, DataSize);
+
+	mHead = Offset + DataSize;
+	mUsedBytes += WrapBytes + DataSize;
+	mUnfencedBytes += WrapBytes + DataSize;
+
+	OffsetOut = Offset;
+	return true;
+}
+
+void FUploadRing::CopyTo(const GLintptr Offset, const GLsizeiptr DataSize, const GLuint Destination, const GLintptr DestinationOffset) const
+{
+	glBindBuffer(GL_COPY_READ_BUFFER, mBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, Destination);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, Offset, DestinationOffset, DataSize);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void FUploadRing::EndFrame()
+{
+	if (mUnfencedBytes > 0)
+	{
+		mFences.push_back(FrameFence{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), mUnfencedBytes });
+		mUnfencedBytes = 0;
+	}
+
+	ReclaimSpace();
+}
+
+void FUploadRing::ReclaimSpace()
+{
+	while (!mFences.empty())
+	{
+		const GLenum Status = glClientWaitSync(mFences.front().Sync, 0, 0);
+		if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED)
+			break;
+
+		glDeleteSync(mFences.front().Sync);
+		mUsedBytes -= mFences.front().Bytes;
+		mFences.pop_front();
+	}
+}
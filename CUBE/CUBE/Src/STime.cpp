@@ -5,6 +5,9 @@ uint64_t STime::mFrameStart = 0;
 uint64_t STime::mFrameEnd = 0;
 float STime::mDeltaTime = 1.0f / 30.0f;
 float STime::mFixedUpdate = 0;
+float STime::mDeltaHistory[STime::SMOOTHED_FRAMES];
+uint32_t STime::mDeltaHistoryCount = 0;
+bool STime::mIsSmoothed = false;
 
 void STime::StartGameTimer()
 {
@@ -32,6 +35,18 @@ void STime::UpdateGameTimer()
 		DeltaTime = 1.0f / 30.0f;
 	}
 
+	mDeltaHistory[mDeltaHistoryCount % SMOOTHED_FRAMES] = DeltaTime;
+	mDeltaHistoryCount++;
+
+	if (mIsSmoothed)
+	{
+		const uint32_t Count = mDeltaHistoryCount < SMOOTHED_FRAMES ? mDeltaHistoryCount : SMOOTHED_FRAMES;
+		float Total = 0.0f;
+		for (uint32_t i = 0; i < Count; i++)
+			Total += mDeltaHistory[i];
+		DeltaTime = Total / Count;
+	}
+
 	// Set delta time for this frame
 	mDeltaTime = DeltaTime;
 	mFrameStart = mFrameEnd;
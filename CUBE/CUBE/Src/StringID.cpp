@@ -2,33 +2,45 @@
 #include "Debugging\ConsoleOutput.h"
 #include "Misc/Assertions.h"
 #include "Misc/StringUtil.h"
+
+#include <mutex>
 #include <unordered_map>
 
+#if STRING_ID_NAMES_ENABLED
 static std::unordered_map<uint32_t, std::string> NameMap;
+static std::mutex NameMapMutex;
+#endif
 
-FStringID::FStringID(const char* Name)
+FStringID::FStringID(const FString::FDynamicString Name)
+	: mID(FString::HashCRC32(Name))
 {
-	mID = FString::HashCRC32(Name);
-	
-	if (NameMap.find(mID) == NameMap.end())
-	{
-		// Name is a new entry into the namemap
-		NameMap[mID] = Name;
-	}
-	
-	if (NameMap[mID] != Name)
-	{
-		FDebug::PrintF("StringID: %s maps to an already used index and must be changed.", Name);
-	}
+#if STRING_ID_NAMES_ENABLED
+	AddName(mID, Name.String);
+#endif
 }
 
-FStringID::FStringID(const std::string& Name)
-	: FStringID(Name.c_str())
+const std::string FStringID::GetName() const
 {
+#if STRING_ID_NAMES_ENABLED
+	std::lock_guard<std::mutex> Lock(NameMapMutex);
+	auto Found = NameMap.find(mID);
+	ASSERT(Found != NameMap.end() && "Trying to retrieve a key that is not in NameMap");
+	return Found != NameMap.end() ? Found->second : std::string();
+#else
+	return std::string();
+#endif
 }
 
-const std::string FStringID::GetName() const
+void FStringID::AddName(const StringID ID, const char* Name)
 {
-	ASSERT(NameMap.find(mID) != NameMap.end() && "Trying to retrieve a key that is not in NameMap");
-	return NameMap[mID];
+#if STRING_ID_NAMES_ENABLED
+	std::lock_guard<std::mutex> Lock(NameMapMutex);
+
+	// Name is a new entry into the namemap if the id isn't in it yet
+	auto Found = NameMap.emplace(ID, Name).first;
+	if (Found->second != Name)
+	{
+		FDebug::PrintF("StringID: %s maps to an already used index and must be changed.", Name);
+	}
+#endif
 }
\ No newline at end of file
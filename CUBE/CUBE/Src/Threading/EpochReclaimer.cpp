@@ -0,0 +1,129 @@
+#include "Threading\EpochReclaimer.h"
+#include "Common.h"
+#include "Misc\Assertions.h"
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
+
+#undef min
+#undef max
+
+namespace
+{
+	// Threads given a reader slot so far
+	std::atomic<uint32_t> ReaderCount(0);
+
+	// The reader slot of the calling thread plus 1, or 0 until it first pins
+	THREAD_LOCAL uint32_t ReaderSlot = 0;
+
+	uint32_t GetReaderSlot()
+	{
+		if (ReaderSlot == 0)
+		{
+			ReaderSlot = ReaderCount.fetch_add(1) + 1;
+			ASSERT(ReaderSlot <= FEpochReclaimer::MAX_READERS && "Too many threads read epoch protected data.");
+		}
+
+		return ReaderSlot - 1;
+	}
+}
+
+FEpochReclaimer::Guard::Guard(FEpochReclaimer& Reclaimer)
+	: mReclaimer(Reclaimer)
+{
+	mReclaimer.Pin();
+}
+
+FEpochReclaimer::Guard::~Guard()
+{
+	mReclaimer.Unpin();
+}
+
+FEpochReclaimer::FEpochReclaimer()
+	: mEpoch()
+	, mRetired()
+	, mRetiredMutex()
+{
+	// Epochs start at 1, so 0 marks unpinned readers
+	mEpoch = 1;
+	for (uint32_t i = 0; i < MAX_READERS; i++)
+	{
+		mReaderEpochs[i] = 0;
+		mReaderDepths[i] = 0;
+	}
+}
+
+FEpochReclaimer::~FEpochReclaimer()
+{
+	for (Retired& Item : mRetired)
+		Item.Free();
+}
+
+void FEpochReclaimer::Retire(std::function<void()> Free)
+{
+	// Readers pinned after this epoch advances can only see what replaced the data
+	std::lock_guard<std::mutex> Lock(mRetiredMutex);
+	mRetired.push_back(Retired{ mEpoch.load(), std::move(Free) });
+}
+
+void FEpochReclaimer::Reclaim()
+{
+	// Readers pinning from here on read the new epoch, those already pinned are found below
+	uint64_t OldestEpoch = mEpoch.fetch_add(1) + 1;
+
+	const uint32_t Readers = std::min(ReaderCount.load(), MAX_READERS);
+	for (uint32_t i = 0; i < Readers; i++)
+	{
+		const uint64_t ReaderEpoch = mReaderEpochs[i].load();
+		if (ReaderEpoch != 0)
+			OldestEpoch = std::min(OldestEpoch, ReaderEpoch);
+	}
+
+	// Free outside of the lock, so retiring isn't held up by what frees
+	std::vector<Retired> Expired;
+	{
+		std::lock_guard<std::mutex> Lock(mRetiredMutex);
+		auto Kept = std::stable_partition(mRetired.begin(), mRetired.end(), [OldestEpoch](const Retired& Item)
+		{
+			return Item.Epoch >= OldestEpoch;
+		});
+
+		std::move(Kept, mRetired.end(), std::back_inserter(Expired));
+		mRetired.erase(Kept, mRetired.end());
+	}
+
+	for (Retired& Item : Expired)
+		Item.Free();
+}
+
+void FEpochReclaimer::Synchronize()
+{
+	ASSERT((ReaderSlot == 0 || mReaderDepths[ReaderSlot - 1] == 0) && "Synchronizing while pinned never returns.");
+
+	const uint64_t Epoch = mEpoch.fetch_add(1) + 1;
+
+	const uint32_t Readers = std::min(ReaderCount.load(), MAX_READERS);
+	for (uint32_t i = 0; i < Readers; i++)
+	{
+		for (uint64_t ReaderEpoch = mReaderEpochs[i].load(); ReaderEpoch != 0 && ReaderEpoch < Epoch; ReaderEpoch = mReaderEpochs[i].load())
+			std::this_thread::yield();
+	}
+}
+
+void FEpochReclaimer::Pin()
+{
+	// The store is ordered before every read of the data by the reader
+	const uint32_t Slot = GetReaderSlot();
+	if (mReaderDepths[Slot]++ == 0)
+		mReaderEpochs[Slot].store(mEpoch.load());
+}
+
+void FEpochReclaimer::Unpin()
+{
+	const uint32_t Slot = ReaderSlot - 1;
+	ASSERT(ReaderSlot != 0 && mReaderDepths[Slot] != 0);
+
+	if (--mReaderDepths[Slot] == 0)
+		mReaderEpochs[Slot].store(0, std::memory_order_release);
+}
@@ -0,0 +1,362 @@
+#include "Threading\JobSystem.h"
+#include "SystemResources\SystemThread.h"
+#include "Common.h"
+#include "Clock.h"
+#include "Misc\Assertions.h"
+#include "Debugging\CPUProfiler.h"
+
+#include <algorithm>
+
+#undef min
+#undef max
+
+namespace
+{
+	// The worker queue of the calling thread plus 1, or 0 on threads that aren't workers
+	THREAD_LOCAL uint32_t ThreadQueue = 0;
+
+	/**
+	* A loop split by ParallelFor, shared by every participant.
+	*/
+	struct LoopRecord
+	{
+		const FJobSystem::LoopWork* Task;
+		uint32_t                    Count;
+		uint32_t                    GrainSize;
+		std::atomic<uint32_t>       NextIndex;
+		std::atomic<uint32_t>       NextParticipant;
+	};
+
+	/**
+	* Runs ranges of a loop until none are left.
+	*/
+	void RunLoopRanges(LoopRecord& Loop, const uint32_t Participant)
+	{
+		for (uint32_t Begin = Loop.NextIndex.fetch_add(Loop.GrainSize); Begin < Loop.Count; Begin = Loop.NextIndex.fetch_add(Loop.GrainSize))
+		{
+			const uint32_t End = std::min(Begin + Loop.GrainSize, Loop.Count);
+			for (uint32_t i = Begin; i < End; i++)
+				(*Loop.Task)(i, Participant);
+		}
+	}
+}
+
+FJobCounter::FJobCounter()
+	: mCount()
+	, mMutex()
+	, mHeldJobs()
+{
+	mCount = 0;
+}
+
+FJobSystem::FJobSystem()
+	: mWorkers()
+	, mQueues()
+	, mMainQueue()
+	, mQueuedJobs()
+	, mQueuedMainJobs()
+	, mNextQueue()
+	, mWakeMutex()
+	, mWakeCondition()
+	, mMainThreadID(std::this_thread::get_id())
+	, mMustStop(false)
+{
+	mQueuedJobs = 0;
+	mQueuedMainJobs = 0;
+	mNextQueue = 0;
+}
+
+FJobSystem::~FJobSystem()
+{
+	Stop();
+}
+
+void FJobSystem::Start(const uint32_t WorkerCount, const bool UseCoreHints)
+{
+	Stop();
+
+	mMainThreadID = std::this_thread::get_id();
+	if (UseCoreHints)
+		SThread::SetCurrentThreadCore(0);
+
+	mMustStop = false;
+	for (uint32_t i = 0; i < WorkerCount; i++)
+		mQueues.push_back(std::unique_ptr<JobQueue>(new JobQueue));
+
+	for (uint32_t i = 0; i < WorkerCount; i++)
+	{
+		mWorkers.push_back(std::thread(&FJobSystem::WorkerThreadLoop, this, i, UseCoreHints));
+	}
+}
+
+void FJobSystem::Stop()
+{
+	if (mWorkers.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> Lock(mWakeMutex);
+		mMustStop = true;
+	}
+	mWakeCondition.notify_all();
+
+	for (std::thread& Worker : mWorkers)
+		Worker.join();
+
+	mWorkers.clear();
+	mQueues.clear();
+}
+
+void FJobSystem::Submit(Job NewJob, FJobCounter* Counter, const EJobAffinity Affinity)
+{
+	if (Counter)
+		Counter->mCount++;
+
+	Enqueue(JobRecord{ std::move(NewJob), Counter, Affinity });
+}
+
+void FJobSystem::SubmitAfter(FJobCounter& Dependency, Job NewJob, FJobCounter* Counter, const EJobAffinity Affinity)
+{
+	if (Counter)
+		Counter->mCount++;
+
+	{
+		// The count only reaches 0 under the lock, so a held job is always released
+		std::lock_guard<std::mutex> Lock(Dependency.mMutex);
+		if (!Dependency.IsDone())
+		{
+			Dependency.mHeldJobs.push_back(JobRecord{ std::move(NewJob), Counter, Affinity });
+			return;
+		}
+	}
+
+	Enqueue(JobRecord{ std::move(NewJob), Counter, Affinity });
+}
+
+void FJobSystem::Wait(FJobCounter& Counter)
+{
+	const bool IsMain = IsMainThread();
+
+	while (!Counter.IsDone())
+	{
+		if (TryRunJob(IsMain))
+			continue;
+
+		std::unique_lock<std::mutex> Lock(mWakeMutex);
+		mWakeCondition.wait(Lock, [this, &Counter, IsMain]()
+		{
+			return Counter.IsDone() || mQueuedJobs > 0 || (IsMain && mQueuedMainJobs > 0);
+		});
+	}
+
+	// The last job may still hold the counter's lock, and the counter may be destroyed after returning
+	std::lock_guard<std::mutex> Lock(Counter.mMutex);
+}
+
+void FJobSystem::RunMainThreadJobs(const uint64_t Deadline)
+{
+	ASSERT(IsMainThread() && "Main thread jobs can't run on other threads.");
+
+	while (mQueuedMainJobs > 0)
+	{
+		if (Deadline != 0 && FClock::ReadSystemTimer() > Deadline)
+			return;
+
+		std::unique_lock<std::mutex> Lock(mMainQueue.Mutex);
+		if (mMainQueue.Jobs.empty())
+			return;
+
+		JobRecord Record = std::move(mMainQueue.Jobs.front());
+		mMainQueue.Jobs.pop_front();
+		mQueuedMainJobs--;
+		Lock.unlock();
+
+		RunJob(Record);
+	}
+}
+
+void FJobSystem::ParallelFor(const uint32_t Count, const uint32_t GrainSize, const LoopWork& Task)
+{
+	const uint32_t RangeCount = (Count + GrainSize - 1) / GrainSize;
+
+	// Waking the workers costs more than a single range
+	if (mWorkers.empty() || RangeCount < 2)
+	{
+		for (uint32_t i = 0; i < Count; i++)
+			Task(i, 0);
+
+		return;
+	}
+
+	LoopRecord Loop;
+	Loop.Task = &Task;
+	Loop.Count = Count;
+	Loop.GrainSize = GrainSize;
+	Loop.NextIndex = 0;
+	Loop.NextParticipant = 1;
+
+	// Helpers that start after every range is taken return right away
+	FJobCounter Helpers;
+	const uint32_t HelperCount = std::min<uint32_t>(mWorkers.size(), RangeCount - 1);
+	for (uint32_t i = 0; i < HelperCount; i++)
+	{
+		Submit([&Loop]() { RunLoopRanges(Loop, Loop.NextParticipant++); }, &Helpers);
+	}
+
+	RunLoopRanges(Loop, 0);
+	Wait(Helpers);
+}
+
+uint32_t FJobSystem::GetDefaultWorkerCount()
+{
+	const uint32_t CoreCount = SThread::GetCoreCount();
+	return (CoreCount > 1) ? CoreCount - 1 : 0;
+}
+
+void FJobSystem::WorkerThreadLoop(const uint32_t Worker, const bool UseCoreHints)
+{
+	ThreadQueue = Worker + 1;
+	FDebug::CPUProfiler::SetThreadName("Job Worker");
+	if (UseCoreHints)
+		SThread::SetCurrentThreadCore(Worker + 1);
+
+	while (true)
+	{
+		if (TryRunJob(false))
+			continue;
+
+		// Queued jobs are finished before stopping
+		std::unique_lock<std::mutex> Lock(mWakeMutex);
+		mWakeCondition.wait(Lock, [this]() { return mMustStop || mQueuedJobs > 0; });
+
+		if (mMustStop && mQueuedJobs == 0)
+			return;
+	}
+}
+
+void FJobSystem::Enqueue(JobRecord&& Record)
+{
+	if (Record.Affinity == EJobAffinity::MainThread)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(mMainQueue.Mutex);
+			mMainQueue.Jobs.push_back(std::move(Record));
+			mQueuedMainJobs++;
+		}
+
+		// Only the main thread can take it, so every sleeping thread is woken to reach it
+		WakeThreads(true);
+		return;
+	}
+
+	if (mWorkers.empty())
+	{
+		RunJob(Record);
+		return;
+	}
+
+	// Workers push to their own queue, other threads spread jobs between them
+	const uint32_t QueueIndex = (ThreadQueue > 0) ? ThreadQueue - 1 : mNextQueue++ % mQueues.size();
+	JobQueue& Queue = *mQueues[QueueIndex];
+	{
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		Queue.Jobs.push_back(std::move(Record));
+		mQueuedJobs++;
+	}
+
+	WakeThreads(false);
+}
+
+bool FJobSystem::TryRunJob(const bool IsMain)
+{
+	JobRecord Record;
+	bool HasJob = false;
+
+	if (IsMain && mQueuedMainJobs > 0)
+	{
+		std::lock_guard<std::mutex> Lock(mMainQueue.Mutex);
+		if (!mMainQueue.Jobs.empty())
+		{
+			Record = std::move(mMainQueue.Jobs.front());
+			mMainQueue.Jobs.pop_front();
+			mQueuedMainJobs--;
+			HasJob = true;
+		}
+	}
+
+	// The newest job of the thread's own queue is likely still in cache
+	if (!HasJob && ThreadQueue > 0)
+	{
+		JobQueue& Queue = *mQueues[ThreadQueue - 1];
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		if (!Queue.Jobs.empty())
+		{
+			Record = std::move(Queue.Jobs.back());
+			Queue.Jobs.pop_back();
+			mQueuedJobs--;
+			HasJob = true;
+		}
+	}
+
+	// Steal the oldest job of another queue, starting after the thread's own
+	const uint32_t QueueCount = mQueues.size();
+	for (uint32_t i = 0; !HasJob && i < QueueCount && mQueuedJobs > 0; i++)
+	{
+		JobQueue& Queue = *mQueues[(ThreadQueue + i) % QueueCount];
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		if (!Queue.Jobs.empty())
+		{
+			Record = std::move(Queue.Jobs.front());
+			Queue.Jobs.pop_front();
+			mQueuedJobs--;
+			HasJob = true;
+		}
+	}
+
+	if (HasJob)
+		RunJob(Record);
+
+	return HasJob;
+}
+
+void FJobSystem::RunJob(JobRecord& Record)
+{
+	Record.Work();
+
+	if (Record.Counter)
+		FinishJob(*Record.Counter);
+}
+
+void FJobSystem::FinishJob(FJobCounter& Counter)
+{
+	std::vector<JobRecord> Released;
+	bool IsDone = false;
+	{
+		std::lock_guard<std::mutex> Lock(Counter.mMutex);
+		if (--Counter.mCount == 0)
+		{
+			Released.swap(Counter.mHeldJobs);
+			IsDone = true;
+		}
+	}
+
+	// The counter may be destroyed by a waiting thread from here on
+	for (JobRecord& Record : Released)
+		Enqueue(std::move(Record));
+
+	if (IsDone)
+		WakeThreads(true);
+}
+
+void FJobSystem::WakeThreads(const bool WakeAll)
+{
+	// Taking the lock orders the wake after a sleeping thread's last check
+	{
+		std::lock_guard<std::mutex> Lock(mWakeMutex);
+	}
+
+	if (WakeAll)
+		mWakeCondition.notify_all();
+	else
+		mWakeCondition.notify_one();
+}
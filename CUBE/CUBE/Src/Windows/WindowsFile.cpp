@@ -61,6 +61,43 @@ bool FWindowsHandle::Write(const uint8_t* Data, const uint32_t NumBytesToWrite)
 	return false;
 }
 
+bool FWindowsHandle::ReadAt(const uint64_t Offset, uint8_t* DataOut, const uint32_t NumBytesToRead)
+{
+	// The position given by the overlapped structure is used instead of the file pointer
+	OVERLAPPED Position = {};
+	Position.Offset = (DWORD)Offset;
+	Position.OffsetHigh = (DWORD)(Offset >> 32);
+
+	DWORD BytesRead = 0;
+
+	if (ReadFile(mFileHandle, DataOut, NumBytesToRead, &BytesRead, &Position))
+	{
+		if (NumBytesToRead == BytesRead)
+			return true;
+	}
+
+	PrintError();
+	return false;
+}
+
+bool FWindowsHandle::WriteAt(const uint64_t Offset, const uint8_t* Data, const uint32_t NumBytesToWrite)
+{
+	OVERLAPPED Position = {};
+	Position.Offset = (DWORD)Offset;
+	Position.OffsetHigh = (DWORD)(Offset >> 32);
+
+	DWORD BytesWritten = 0;
+
+	if (WriteFile(mFileHandle, Data, NumBytesToWrite, &BytesWritten, &Position))
+	{
+		if (BytesWritten == NumBytesToWrite)
+			return true;
+	}
+
+	PrintError();
+	return false;
+}
+
 bool FWindowsHandle::Seek(const uint64_t Distance)
 {
 	return FileSeek(Distance, FILE_CURRENT);
@@ -96,12 +133,135 @@ uint32_t FWindowsHandle::GetFileSize() const
 	return ::GetFileSize(mFileHandle, nullptr);
 }
 
+bool FWindowsHandle::Flush()
+{
+	if (!FlushFileBuffers(mFileHandle))
+	{
+		PrintError();
+		return false;
+	}
+
+	return true;
+}
+
 FWindowsHandle::~FWindowsHandle()
 {
 	CloseHandle(mFileHandle);
 	mFileHandle = nullptr;
 };
 
+FWindowsMappedFile::FWindowsMappedFile(HANDLE FileHandle, const bool ReadOnly)
+	: mFileHandle(FileHandle)
+	, mMappingHandle(nullptr)
+	, mData(nullptr)
+	, mFileSize(::GetFileSize(FileHandle, nullptr))
+	, mReadOnly(ReadOnly)
+{
+	Map();
+}
+
+FWindowsMappedFile::~FWindowsMappedFile()
+{
+	Unmap();
+	CloseHandle(mFileHandle);
+	mFileHandle = nullptr;
+}
+
+uint8_t* FWindowsMappedFile::GetData()
+{
+	return mData;
+}
+
+uint32_t FWindowsMappedFile::GetFileSize() const
+{
+	return mFileSize;
+}
+
+bool FWindowsMappedFile::Resize(const uint32_t NewSize)
+{
+	if (NewSize == mFileSize)
+		return true;
+
+	if (mReadOnly)
+		return false;
+
+	Unmap();
+
+	// Growing is done by the mapping itself, shrinking needs the file truncated first
+	if (NewSize < mFileSize)
+	{
+		if (SetFilePointer(mFileHandle, NewSize, nullptr, FILE_BEGIN) == INVALID_SET_FILE_POINTER || !SetEndOfFile(mFileHandle))
+		{
+			PrintError();
+			Map();
+			return false;
+		}
+	}
+
+	const uint32_t OldSize = mFileSize;
+	mFileSize = NewSize;
+
+	if (!Map())
+	{
+		mFileSize = OldSize;
+		Map();
+		return false;
+	}
+
+	return true;
+}
+
+bool FWindowsMappedFile::Flush()
+{
+	if (mData && !mReadOnly && !FlushViewOfFile(mData, 0))
+	{
+		PrintError();
+		return false;
+	}
+
+	return true;
+}
+
+bool FWindowsMappedFile::Map()
+{
+	// Mapping an empty file fails, so it stays unmapped until it is grown
+	if (mFileSize == 0)
+		return true;
+
+	mMappingHandle = CreateFileMapping(mFileHandle, nullptr, mReadOnly ? PAGE_READONLY : PAGE_READWRITE, 0, mFileSize, nullptr);
+	if (mMappingHandle == nullptr)
+	{
+		PrintError();
+		return false;
+	}
+
+	mData = (uint8_t*)MapViewOfFile(mMappingHandle, mReadOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, mFileSize);
+	if (mData == nullptr)
+	{
+		PrintError();
+		CloseHandle(mMappingHandle);
+		mMappingHandle = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+void FWindowsMappedFile::Unmap()
+{
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+		mData = nullptr;
+	}
+
+	if (mMappingHandle)
+	{
+		CloseHandle(mMappingHandle);
+		mMappingHandle = nullptr;
+	}
+}
+
 FWindowsFileSystem::FWindowsFileSystem()
 	: IFileSystem()
 {
@@ -158,6 +318,29 @@ std::unique_ptr<IFileHandle> FWindowsFileSystem::OpenReadWritable(const wchar_t*
 	return nullptr;
 }
 
+std::unique_ptr<IMappedFile> FWindowsFileSystem::OpenMapped(const wchar_t* Filename, const bool CreateNew, const bool ReadOnly)
+{
+	DWORD Access = ReadOnly ? GENERIC_READ : GENERIC_WRITE | GENERIC_READ;
+	DWORD ShareMode = FILE_SHARE_READ; // Mapped files can still be copied
+	DWORD Creation = CreateNew ? CREATE_ALWAYS : OPEN_EXISTING;
+
+	HANDLE FileHandle = CreateFile(Filename, Access, ShareMode, nullptr, Creation, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (FileHandle != INVALID_HANDLE_VALUE)
+	{
+		std::unique_ptr<FWindowsMappedFile> MappedFile = std::make_unique<FWindowsMappedFile>(FileHandle, ReadOnly);
+
+		// Non-empty files must be mapped to be usable
+		if (MappedFile->GetFileSize() == 0 || MappedFile->GetData())
+			return std::move(MappedFile);
+
+		return nullptr;
+	}
+
+	PrintError(Filename);
+	return nullptr;
+}
+
 bool FWindowsFileSystem::DeleteFilename(const wchar_t* Filename)
 {
 	if (DeleteFile(Filename))
@@ -170,6 +353,24 @@ bool FWindowsFileSystem::DeleteFilename(const wchar_t* Filename)
 	return false;
 }
 
+bool FWindowsFileSystem::CopyFilename(const wchar_t* From, const wchar_t* To)
+{
+	if (CopyFile(From, To, FALSE))
+		return true;
+
+	PrintError(From);
+	return false;
+}
+
+bool FWindowsFileSystem::ReplaceFilename(const wchar_t* From, const wchar_t* To)
+{
+	if (MoveFileEx(From, To, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		return true;
+
+	PrintError(From);
+	return false;
+}
+
 bool FWindowsFileSystem::CurrentDirectory(wchar_t* DataOut, const uint32_t BufferLength)
 {
 	const DWORD DataWritten = GetCurrentDirectory(BufferLength, DataOut);
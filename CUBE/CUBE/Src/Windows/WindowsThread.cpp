@@ -0,0 +1,59 @@
+#include "Windows\WindowsThread.h"
+#include "Common.h"
+#include <Windows.h>
+
+// Missing from older SDKs, ignored by systems before Windows 10 1803
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+	#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+uint32_t SWindowsThread::GetCoreCount()
+{
+	DWORD_PTR ProcessMask, SystemMask;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &ProcessMask, &SystemMask) || ProcessMask == 0)
+		return 1;
+
+	uint32_t Count = 0;
+	for (; ProcessMask != 0; ProcessMask &= ProcessMask - 1)
+		Count++;
+
+	return Count;
+}
+
+void SWindowsThread::SetCurrentThreadCore(const uint32_t Core)
+{
+	DWORD_PTR ProcessMask, SystemMask;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &ProcessMask, &SystemMask) || ProcessMask == 0)
+		return;
+
+	// Find the processor of the given index among those the process may run on
+	uint32_t Skip = Core % GetCoreCount();
+	DWORD Processor = 0;
+	for (;; Processor++)
+	{
+		if ((ProcessMask & ((DWORD_PTR)1 << Processor)) && Skip-- == 0)
+			break;
+	}
+
+	SetThreadIdealProcessor(GetCurrentThread(), Processor);
+}
+
+void SWindowsThread::Sleep(const float Seconds)
+{
+	// Each thread waits on its own timer, created on first use
+	static THREAD_LOCAL HANDLE Timer = nullptr;
+	if (!Timer)
+	{
+		Timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (!Timer)
+			Timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+	}
+
+	// Negative due times are relative, in 100 nanosecond units
+	LARGE_INTEGER DueTime;
+	DueTime.QuadPart = -(LONGLONG)(Seconds * 10000000.0f);
+	if (Timer && SetWaitableTimer(Timer, &DueTime, 0, nullptr, nullptr, FALSE))
+		WaitForSingleObject(Timer, INFINITE);
+	else
+		::Sleep((DWORD)(Seconds * 1000.0f));
+}
@@ -0,0 +1,70 @@
+#include "Windows\WindowsVirtualMemory.h"
+#include <Windows.h>
+
+namespace
+{
+	/**
+	* Finds the large page size, enabling the lock pages privilege large pages are allocated with.
+	*/
+	size_t QueryLargePageSize()
+	{
+		HANDLE Token;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &Token))
+			return 0;
+
+		TOKEN_PRIVILEGES Privileges;
+		Privileges.PrivilegeCount = 1;
+		Privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+		// AdjustTokenPrivileges succeeds without the privilege being held, so the error has to be checked too
+		const bool IsEnabled = LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &Privileges.Privileges[0].Luid) &&
+			AdjustTokenPrivileges(Token, FALSE, &Privileges, 0, nullptr, nullptr) &&
+			GetLastError() == ERROR_SUCCESS;
+
+		CloseHandle(Token);
+		return IsEnabled ? GetLargePageMinimum() : 0;
+	}
+
+	size_t QueryPageSize()
+	{
+		SYSTEM_INFO Info;
+		GetSystemInfo(&Info);
+		return Info.dwPageSize;
+	}
+
+	const size_t PageSize = QueryPageSize();
+	const size_t LargePageSize = QueryLargePageSize();
+}
+
+size_t SWindowsVirtualMemory::GetPageSize()
+{
+	return PageSize;
+}
+
+size_t SWindowsVirtualMemory::GetLargePageSize()
+{
+	return LargePageSize;
+}
+
+void* SWindowsVirtualMemory::Reserve(const size_t Bytes)
+{
+	return VirtualAlloc(nullptr, Bytes, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool SWindowsVirtualMemory::Commit(void* Address, const size_t Bytes)
+{
+	return VirtualAlloc(Address, Bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+void* SWindowsVirtualMemory::AllocateLargePages(const size_t Bytes)
+{
+	if (LargePageSize == 0)
+		return nullptr;
+
+	return VirtualAlloc(nullptr, Bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+}
+
+void SWindowsVirtualMemory::Release(void* Address)
+{
+	VirtualFree(Address, 0, MEM_RELEASE);
+}
@@ -20,6 +20,14 @@
 #include "Atlas\ComponentTypes.h"
 #include "Components\SoundListener.h"
 #include "Components\SoundEmitter.h"
+#include "Components\FlythroughBenchmark.h"
+#include "Components\RenderBenchmark.h"
+#include "Components\PhysicsBenchmark.h"
+#include "Debugging\MicroBenchmarks.h"
+#include "Debugging\ECSBenchmark.h"
+#include "Debugging\ConsoleVariables.h"
+#include "Input\InputRecorder.h"
+#include "SystemResources\SystemFile.h"
 
 #include "FileIO\RegionFile.h"
 
@@ -30,70 +38,354 @@
 #include "ChunkSystems\BlockTypes.h"
 #include "Components\MeshRenderer.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
 using namespace Atlas;
 
-int main()
+namespace
 {
+	/**
+	* Adds a block texture of grey grain about white, so blocks keep the tone of their
+	* color with some variation. Bricks are laid in rows, with darker mortar between them.
+	* @param Seed - Varies the grain between textures.
+	* @return The layer of the texture.
+	*/
+	uint32_t AddBlockTexture(const uint32_t Seed, const bool IsBrick)
+	{
+		const uint32_t Size = FBlockTypes::TEXTURE_SIZE;
+		std::vector<uint32_t> Texels(Size * Size);
+		for (uint32_t y = 0; y < Size; y++)
+		{
+			for (uint32_t x = 0; x < Size; x++)
+			{
+				uint32_t Hash = (x + y * Size + Seed * Size * Size) * 2654435761u;
+				Hash ^= Hash >> 15;
+				Hash *= 2246822519u;
+				Hash ^= Hash >> 13;
+				float Shade = 0.8f + 0.2f * (Hash & 0xFF) / 255.0f;
+
+				// Bricks are 8 by 4 texels, every other row offset by half a brick
+				if (IsBrick && (y % 4 == 0 || (x + (y / 4) % 2 * 4) % 8 == 0))
+					Shade = 0.6f;
+
+				const uint32_t Grey = (uint32_t)(Shade * 255.0f);
+				Texels[x + y * Size] = Grey | (Grey << 8) | (Grey << 16) | 0xFF000000u;
+			}
+		}
+		return FBlockTypes::AddTexture(Texels.data());
+	}
+
+	void AddBlockTypes()
+	{
+		const Vector4f BlockColors[5] =
+		{
+			Vector4f{ 0.11f, 0.35f, 0.15f },		// Grass
+			Vector4f{ 0.47f, 0.28f, 0.0f },		// Dirt
+			Vector4f{ 1.0f, 0.98f, 0.98f },		// Snow
+			Vector4f{ 0.59f, 0.086f, 0.043f },	// DarkBrick
+			Vector4f{0.69f, 0.086f, 0.43f},		// LightBrick
+			Vector4f{ 1.0f, 0.85f, 0.5f }		// Lamp
+		};
+
+		enum Type : uint8_t
+		{
+			Air,
+			Grass,
+			Dirt,
+			Snow,
+			DarkBrick,
+			LightBrick,
+			Lamp
+		};
+
+		FOR(i, 5)
+		{
+			FBlockTypes::AddBlock(i+1, BlockColors[i]);
+		}
+		FBlockTypes::AddBlock(Lamp, BlockColors[Lamp - 1], 15);
+
+		// Lamps keep their flat color
+		FBlockTypes::SetBlockTexture(Grass, AddBlockTexture(Grass, false));
+		FBlockTypes::SetBlockTexture(Dirt, AddBlockTexture(Dirt, false));
+		FBlockTypes::SetBlockTexture(Snow, AddBlockTexture(Snow, false));
+		FBlockTypes::SetBlockTexture(DarkBrick, AddBlockTexture(DarkBrick, true));
+		FBlockTypes::SetBlockTexture(LightBrick, AddBlockTexture(LightBrick, true));
+	}
+
+	/**
+	* Adds the post processes frames are rendered with, SSAO and fog enabled.
+	*/
+	void AddPostProcesses(FRenderSystem& Renderer)
+	{
+		std::unique_ptr<FEdgeDetection> EdgeDetection{ new FEdgeDetection{} };
+		Renderer.AddPostProcess(std::move(EdgeDetection));
+
+		std::unique_ptr<FSSAOPostProcess> SSAO{ new FSSAOPostProcess{} };
+		SSAO->SetGlobalAmbient(Vector3f{ .3f, .3f, .3f });
+		SSAO->SetPower(1.25f);
+		SSAO->SetRadius(1.25f);
+		SSAO->SetQuality(FSSAOPostProcess::Quarter); // Chunk meshes bake their own occlusion
+
+		// The sample textures are rebuilt when the sizes change, the renderer owns the effect after
+		FSSAOPostProcess* SSAOSettings = SSAO.get();
+		FDebug::ConsoleVariables::RegisterInt("SSAOKernelSize", 16, "Samples taken for each pixel's ambient occlusion",
+			[SSAOSettings](const int32_t Size) { SSAOSettings->SetKernalSize((uint32_t)std::max(Size, 1)); });
+		FDebug::ConsoleVariables::RegisterInt("SSAONoiseSize", 4, "Width of the tiled noise rotating the samples",
+			[SSAOSettings](const int32_t Size) { SSAOSettings->SetNoiseSize((uint32_t)std::max(Size, 1)); });
+		Renderer.AddPostProcess(std::move(SSAO));
+
+		std::unique_ptr<FFogPostProcess> FogPostProcess{ new FFogPostProcess{} };
+		FogPostProcess->SetBounds(0, 1);
+		FogPostProcess->SetColor(Vector3f{ .6f, .6f, .6f });
+		FogPostProcess->SetDensity(0.000009f);
+		Renderer.AddPostProcess(std::move(FogPostProcess));
+
+		//Renderer.EnablePostProcess(0);
+		Renderer.EnablePostProcess(1);
+		Renderer.EnablePostProcess(2);
+	}
+
+	/**
+	* Simulates the world without a window, as a dedicated server would.
+	* Chunks stream around a camera that is never rendered.
+	*/
+	int RunHeadless()
+	{
+		FCubeRoot Root{ FCubeRoot::Headless{} };
+		AddBlockTypes();
+
+		FCamera Focus;
+		Focus.Transform.SetLocalPosition(Vector3f{ 560.0f, 320.0f, 560.0f });
+		Focus.SetProjection(FPerspectiveMatrix{ 16.0f / 9.0f, 35.0f, 0.1f });
+
+		Root.GetChunkManager().LoadWorld(L"NewWorld");
+		Root.Start();
+		return 0;
+	}
+
+	/**
+	* Flies the same path through a world on every run and writes its statistics,
+	* see CFlythroughBenchmark. Fails if they regressed against the baseline.
+	* @param World - The world to load, ShortPrettyWorld if empty.
+	* @param Results - The JSON file to write, Benchmark.json if empty.
+	* @param Baseline - The results to compare against, none if empty.
+	*/
+	int RunBenchmark(const std::string& World, const std::string& Results, const std::string& Baseline)
+	{
+		const Vector2ui Resolution{ 1920, 1080 };
+		FCubeRoot Root{ L"CUBE Benchmark", Resolution, sf::Style::Default };
+
+		// Runs are compared with each other, so they don't take the config's view distance
+		Root.GetChunkManager().SetViewDistance(14);
+		AddBlockTypes();
+
+		FCamera Camera;
+		Camera.SetProjection(FPerspectiveMatrix{ (float)Resolution.x / (float)Resolution.y, 35.0f, 0.1f });
+
+		const std::wstring WorldName = World.empty() ? std::wstring{ L"ShortPrettyWorld" } : std::wstring{ World.begin(), World.end() };
+		Root.GetChunkManager().LoadWorld(WorldName.c_str());
+
+		// A loop over the world at a fixed height, with a climb and a dive to stream new layers
+		const std::vector<Vector3f> Path =
+		{
+			Vector3f{ 160.0f, 300.0f, 160.0f },
+			Vector3f{ 560.0f, 300.0f, 200.0f },
+			Vector3f{ 800.0f, 360.0f, 560.0f },
+			Vector3f{ 560.0f, 260.0f, 800.0f },
+			Vector3f{ 200.0f, 300.0f, 560.0f },
+			Vector3f{ 160.0f, 300.0f, 160.0f }
+		};
+
+		// The warmup streams in the start of the path
+		Camera.Transform.SetLocalPosition(Path.front());
+
+		bool Passed = false;
+		auto& Benchmark = *Root.GetGameObjectManager().CreateGameObject().AddBehavior<CFlythroughBenchmark>();
+		Benchmark.SetPath(Path, 0.5f);
+		Benchmark.SetOutput(Results.empty() ? std::wstring{ L"Benchmark.json" } : std::wstring{ Results.begin(), Results.end() },
+			std::wstring{ Baseline.begin(), Baseline.end() }, 0.1f);
+		Benchmark.SetOnFinished([&Root, &Passed](const bool HasPassed)
+		{
+			Passed = HasPassed;
+			Root.Stop();
+		});
+
+		Root.Start();
+		return Passed ? 0 : 1;
+	}
+
+	/**
+	* Renders fixed camera shots of a world and writes the GPU time of each pass,
+	* with each post process and light system toggled, see CRenderBenchmark.
+	* @param World - The world to load, ShortPrettyWorld if empty.
+	* @param Results - The JSON file to write, RenderBenchmark.json if empty.
+	* @param FrameCount - Frames measured for each configuration of each shot.
+	*/
+	int RunRenderBenchmark(const std::string& World, const std::string& Results, const uint32_t FrameCount)
+	{
+		const Vector2ui Resolution{ 1920, 1080 };
+		FCubeRoot Root{ L"CUBE Render Benchmark", Resolution, sf::Style::Default };
+		AddBlockTypes();
+
+		FCamera Camera;
+		Camera.SetProjection(FPerspectiveMatrix{ (float)Resolution.x / (float)Resolution.y, 35.0f, 0.1f });
+
+		auto& Renderer = Root.GetRenderSystem();
+		AddPostProcesses(Renderer);
+
+		const std::wstring WorldName = World.empty() ? std::wstring{ L"ShortPrettyWorld" } : std::wstring{ World.begin(), World.end() };
+		Root.GetChunkManager().LoadWorld(WorldName.c_str());
+
+		auto& GameObjectManager = Root.GetGameObjectManager();
+		auto& DirectionalLight = GameObjectManager.CreateGameObject();
+		DirectionalLight.AddComponent<Atlas::EComponent::DirectionalLight>().Color = Vector3f(.6f, .6f, .6f);
+		DirectionalLight.Transform.SetRotation(FQuaternion{ -130, -20, 0 });
+
+		// A grid of lights over the ground in front of the lights shot
+		std::vector<FGameObject*> Lights;
+		for (int32_t x = 0; x < 16; x++)
+		{
+			for (int32_t z = 0; z < 16; z++)
+			{
+				auto& Light = GameObjectManager.CreateGameObject();
+				Light.Transform.SetLocalPosition(Vector3f{ 480.0f + x * 10.0f, 270.0f, 480.0f + z * 10.0f });
+				FPointLight& PLight = Light.AddComponent<Atlas::EComponent::PointLight>();
+				PLight.Color = Vector3f((x % 3) == 0 ? 1.0f : .2f, (x % 3) == 1 ? 1.0f : .2f, (x % 3) == 2 ? 1.0f : .2f);
+				PLight.Constant = 0.1f;
+				PLight.Linear = 0.3f;
+				PLight.Quadratic = 0.6f;
+				PLight.Intensity = 200.0f;
+				PLight.MaxDistance = 16;
+				Lights.push_back(&Light);
+			}
+		}
+
+		auto& Benchmark = *GameObjectManager.CreateGameObject().AddBehavior<CRenderBenchmark>();
+		Benchmark.SetRenderSystem(Renderer);
+		Benchmark.AddShot(CRenderBenchmark::Shot{ "SurfaceVista", Vector3f{ 160.0f, 340.0f, 160.0f }, Vector3f{ 560.0f, 280.0f, 560.0f }, 14, {} });
+		Benchmark.AddShot(CRenderBenchmark::Shot{ "Cave", Vector3f{ 560.0f, 200.0f, 560.0f }, Vector3f{ 600.0f, 196.0f, 600.0f }, 14, {} });
+		Benchmark.AddShot(CRenderBenchmark::Shot{ "PointLights", Vector3f{ 440.0f, 300.0f, 440.0f }, Vector3f{ 560.0f, 270.0f, 560.0f }, 14, Lights });
+		Benchmark.AddShot(CRenderBenchmark::Shot{ "MaxViewDistance", Vector3f{ 560.0f, 360.0f, 560.0f }, Vector3f{ 960.0f, 320.0f, 960.0f }, 32, {} });
+		Benchmark.SetFrameCount(FrameCount);
+		Benchmark.SetOutput(Results.empty() ? std::wstring{ L"RenderBenchmark.json" } : std::wstring{ Results.begin(), Results.end() });
+		Benchmark.SetDevice(std::string{ (const char*)glGetString(GL_VENDOR) } + " " + (const char*)glGetString(GL_RENDERER));
+		Benchmark.SetOnFinished([&Root]() { Root.Stop(); });
+
+		Root.Start();
+		return 0;
+	}
+
+	/**
+	* Drops grids of rigidbodies onto the streamed terrain of a headless engine and writes
+	* the time each part of a step took, see CPhysicsBenchmark.
+	* @param World - The world to load, ShortPrettyWorld if empty.
+	* @param Results - The JSON file to write, PhysicsBenchmark.json if empty.
+	*/
+	int RunPhysicsBenchmark(const std::string& World, const std::string& Results)
+	{
+		FCubeRoot Root{ FCubeRoot::Headless{} };
+		AddBlockTypes();
+
+		// Bodies are spawned on the surface under the camera
+		FCamera Focus;
+		Focus.Transform.SetLocalPosition(Vector3f{ 560.0f, 300.0f, 560.0f });
+		Focus.SetProjection(FPerspectiveMatrix{ 16.0f / 9.0f, 35.0f, 0.1f });
+
+		const std::wstring WorldName = World.empty() ? std::wstring{ L"ShortPrettyWorld" } : std::wstring{ World.begin(), World.end() };
+		Root.GetChunkManager().LoadWorld(WorldName.c_str());
+
+		auto& Benchmark = *Root.GetGameObjectManager().CreateGameObject().AddBehavior<CPhysicsBenchmark>();
+		Benchmark.SetPhysicsSystem(Root.GetPhysicsSystem());
+		Benchmark.SetOutput(Results.empty() ? std::wstring{ L"PhysicsBenchmark.json" } : std::wstring{ Results.begin(), Results.end() });
+		Benchmark.SetOnFinished([&Root]() { Root.Stop(); });
+
+		Root.Start();
+		return 0;
+	}
+
+	/**
+	* Checks the chunk kernels, then times them on fixed corpora and writes their results, see SMicroBenchmarks.
+	* Runs without a window or engine systems, only the file system is needed.
+	* @param Results - The JSON file to write, MicroBenchmarks.json if empty.
+	* @return 1 if a check failed, otherwise 0.
+	*/
+	int RunMicroBenchmarks(const std::string& Results)
+	{
+		new FFileSystem;
+		AddBlockTypes();
+
+		// The corpora and the chunk the kernels run on
+		FChunk::SharedMeshPool.SetMaxSize(8);
+
+		const bool IsVerified = SMicroBenchmarks::Verify();
+
+		const std::wstring ResultFilename = Results.empty() ? std::wstring{ L"MicroBenchmarks.json" } : std::wstring{ Results.begin(), Results.end() };
+		SMicroBenchmarks::Run(ResultFilename.c_str());
+
+		delete IFileSystem::GetInstancePtr();
+		return IsVerified ? 0 : 1;
+	}
+
+	/**
+	* Spawns, updates and destroys gameobjects of mixed components in a headless engine,
+	* see SECSBenchmark. No world is loaded, so only the gameobjects cost anything.
+	* @param Results - The JSON file to write, ECSBenchmark.json if empty.
+	*/
+	int RunECSBenchmark(const std::string& Results)
+	{
+		FCubeRoot Root{ FCubeRoot::Headless{} };
+
+		const std::wstring ResultFilename = Results.empty() ? std::wstring{ L"ECSBenchmark.json" } : std::wstring{ Results.begin(), Results.end() };
+		SECSBenchmark::Run(Root.GetGameObjectManager(), ResultFilename.c_str());
+		return 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && std::string{ argv[1] } == "-headless")
+		return RunHeadless();
+
+	// -benchmark [World] [Results.json] [Baseline.json]
+	if (argc > 1 && std::string{ argv[1] } == "-benchmark")
+		return RunBenchmark(argc > 2 ? argv[2] : "", argc > 3 ? argv[3] : "", argc > 4 ? argv[4] : "");
+
+	// -renderbench [World] [Results.json] [FrameCount]
+	if (argc > 1 && std::string{ argv[1] } == "-renderbench")
+		return RunRenderBenchmark(argc > 2 ? argv[2] : "", argc > 3 ? argv[3] : "", argc > 4 ? (uint32_t)std::max(atoi(argv[4]), 1) : 120);
+
+	// -microbench [Results.json]
+	if (argc > 1 && std::string{ argv[1] } == "-microbench")
+		return RunMicroBenchmarks(argc > 2 ? argv[2] : "");
+
+	// -physicsbench [World] [Results.json]
+	if (argc > 1 && std::string{ argv[1] } == "-physicsbench")
+		return RunPhysicsBenchmark(argc > 2 ? argv[2] : "", argc > 3 ? argv[3] : "");
+
+	// -ecsbench [Results.json]
+	if (argc > 1 && std::string{ argv[1] } == "-ecsbench")
+		return RunECSBenchmark(argc > 2 ? argv[2] : "");
+
 	const Vector2ui Resolution{ 1920, 1080 };
 	FCubeRoot Root{ L"CUBE", Resolution, sf::Style::Default };
-	Root.GetChunkManager().SetViewDistance(14);
 
 	SMouseAxis::SetDefaultMousePosition(Resolution / 2);
 	SMouseAxis::SetMouseVisible(false);
 	SMouseAxis::SetMouseLock(true);
 
-	const Vector4f BlockColors[5] =
-	{
-		Vector4f{ 0.11f, 0.35f, 0.15f },		// Grass
-		Vector4f{ 0.47f, 0.28f, 0.0f },		// Dirt
-		Vector4f{ 1.0f, 0.98f, 0.98f },		// Snow
-		Vector4f{ 0.59f, 0.086f, 0.043f },	// DarkBrick
-		Vector4f{0.69f, 0.086f, 0.43f}		// LightBrick
-	};
-
-	enum Type : uint8_t
-	{
-		Air,
-		Grass,
-		Dirt,
-		Snow,
-		DarkBrick,
-		LightBrick
-	};
-
-	FOR(i, 5)
-	{
-		FBlockTypes::AddBlock(i+1, BlockColors[i]);
-	}
+	AddBlockTypes();
 
 	FCamera Camera;
 	const Vector3f CameraPosition = Vector3f{ 560.0f, 320.0f, 560.0f };
 	Camera.Transform.SetLocalPosition(CameraPosition);
-	Camera.SetProjection(FPerspectiveMatrix{ (float)Resolution.x / (float)Resolution.y, 35.0f, 0.1f, 600.0f });
-
-	auto& Renderer = Root.GetRenderSystem();
-	std::unique_ptr<FEdgeDetection> EdgeDetection{ new FEdgeDetection{} };
-	Renderer.AddPostProcess(std::move(EdgeDetection));
-
-	std::unique_ptr<FSSAOPostProcess> SSAO{ new FSSAOPostProcess{} };
-	SSAO->SetGlobalAmbient(Vector3f{ .3f, .3f, .3f });
-	SSAO->SetKernalSize(16);
-	SSAO->SetNoiseSize(4);
-	SSAO->SetPower(1.25f);
-	SSAO->SetRadius(1.25f);
-	Renderer.AddPostProcess(std::move(SSAO));
-
-	std::unique_ptr<FFogPostProcess> FogPostProcess{ new FFogPostProcess{} };
-	FogPostProcess->SetBounds(0, 1);
-	FogPostProcess->SetColor(Vector3f{ .6f, .6f, .6f });
-	FogPostProcess->SetDensity(0.000009f);
-	Renderer.AddPostProcess(std::move(FogPostProcess));
-
-	//Renderer.EnablePostProcess(0);
-	Renderer.EnablePostProcess(1);
-	Renderer.EnablePostProcess(2);
+	Camera.SetProjection(FPerspectiveMatrix{ (float)Resolution.x / (float)Resolution.y, 35.0f, 0.1f });
+
+	AddPostProcesses(Root.GetRenderSystem());
 
 	auto& ChunkManager = Root.GetChunkManager();
+	ChunkManager.SetMeshCaching(true);
 	ChunkManager.LoadWorld(L"NewWorld");
 
 
@@ -115,13 +407,8 @@ int main()
 	DirectionalLight.Transform.SetRotation(FQuaternion{ -130, -20, 0 });
 
 
-	SMeshHolder::Load("Box");
-	auto& BoxMesh = SMeshHolder::Get("Box");
-	BoxMesh.Mesh.LoadModel("Box.obj");
-
-	SMeshHolder::Load("Sword");
-	auto& SwordMesh = SMeshHolder::Get("Sword");
-	SwordMesh.Mesh.LoadModel("Sword.obj");
+	FObjectMesh::LoadAsync("Box", L"Box.cmesh", "Box.obj");
+	FObjectMesh::LoadAsync("Sword", L"Sword.cmesh", "Sword.obj");
 
 	//auto& PointLight = GameObjectManager.CreateGameObject();
 	//PointLight.Transform.SetPosition(Vector3f{ 260.0f, 245.0f, 260.0f });
@@ -138,6 +425,18 @@ int main()
 	Sword.Transform.SetLocalPosition(Vector3f{ 300.0f, 270.0f, 300.0f });
 	Sword.Transform.Rotate(FQuaternion{ 90, 90, -45 });
 
+	// -record Input.rec or -replay Input.rec, a replay ends the session when it runs out
+	const std::string InputMode = argc > 2 ? argv[1] : "";
+	const std::string InputFile = argc > 2 ? argv[2] : "";
+	if (InputMode == "-record")
+	{
+		SInputRecorder::StartRecording(std::wstring{ InputFile.begin(), InputFile.end() }.c_str());
+	}
+	else if (InputMode == "-replay" && SInputRecorder::StartReplay(std::wstring{ InputFile.begin(), InputFile.end() }.c_str()))
+	{
+		SInputRecorder::SetOnReplayFinished([&Root]() { Root.Stop(); });
+	}
+
 	Root.Start();
 
 }